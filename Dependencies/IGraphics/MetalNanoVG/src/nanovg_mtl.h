@@ -61,6 +61,12 @@ enum MNVGTarget {
   MNVG_UNKNOWN,
 };
 
+// The block compressed texture formats of mnvgCreateCompressedImage().
+enum MNVGcompressedFormat {
+  MNVG_COMPRESSED_BC7,
+  MNVG_COMPRESSED_ASTC_4X4,
+};
+
 struct MNVGframebuffer {
   NVGcontext* ctx;
   int image;
@@ -102,6 +108,13 @@ void* mnvgCommandQueue(NVGcontext* ctx);
 // Creates an image id from a `id<MTLTexture>` object pointer.
 int mnvgCreateImageFromHandle(NVGcontext* ctx, void* textureId, int imageFlags);
 
+// Creates an RGBA image from the first mip level of a block compressed
+// texture, with 16 bytes per 4x4 block. Returns 0 if the device doesn't
+// support the format, so the caller can load the uncompressed image instead.
+int mnvgCreateCompressedImage(NVGcontext* ctx, enum MNVGcompressedFormat format,
+                              int width, int height, const void* data,
+                              int dataSize, int imageFlags);
+
 // Returns a pointer to the corresponded `id<MTLDevice>` object.
 void* mnvgDevice(NVGcontext* ctx);
 
@@ -115,6 +128,34 @@ void mnvgReadPixels(NVGcontext* ctx, int image, int x, int y, int width,
 // Returns the current OS target.
 enum MNVGTarget mnvgTarget(void);
 
+// Uses a MTLBinaryArchive at the specified file path for the render pipelines,
+// so that they are not compiled again in later sessions. The archive and its
+// folder are created if they don't exist, and the archive is written back when
+// the context is deleted if pipelines were added to it. Requires macOS 11 /
+// iOS 14, returns 0 if the archive can't be used.
+int mnvgSetBinaryArchivePath(NVGcontext* ctx, const char* path);
+
+// Compiles a shader from Metal Shading Language source, with the named vertex
+// and fragment functions, for drawing with mnvgDrawShader(). Returns NULL and
+// copies the compiler's messages to `error` if it can't be compiled. The
+// shader must be deleted with mnvgDeleteShader().
+void* mnvgCreateShader(NVGcontext* ctx, const char* source,
+                       const char* vertexFunction,
+                       const char* fragmentFunction, char* error,
+                       int errorSize);
+
+// Draws a triangle strip of 4 vertices with a shader, over the specified
+// rectangle of an image, in pixels from its top left, replacing its pixels.
+// The `data` is bound to buffer(0) of the fragment function, and the size of
+// the rectangle as a float2 to buffer(1). The drawing is committed straight
+// away, so anything drawn to the image by NanoVG must be flushed with
+// nvgEndFrame() first.
+void mnvgDrawShader(NVGcontext* ctx, void* shader, int image, int x, int y,
+                    int width, int height, const void* data, int dataSize);
+
+// Deletes a shader created with mnvgCreateShader().
+void mnvgDeleteShader(void* shader);
+
 #ifdef __cplusplus
 }
 #endif
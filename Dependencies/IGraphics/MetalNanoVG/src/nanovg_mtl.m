@@ -118,6 +118,13 @@ typedef struct MNVGfragUniforms MNVGfragUniforms;
 }
 @end
 
+@interface MNVGshader : NSObject
+@property (nonatomic, strong) id<MTLFunction> vertexFunction;
+@property (nonatomic, strong) id<MTLFunction> fragmentFunction;
+@property (nonatomic, strong) id<MTLRenderPipelineState> pipelineState;
+@property (nonatomic, assign) MTLPixelFormat pixelFormat;
+@end
+
 @interface MNVGbuffers : NSObject {
  @public
   id<MTLCommandBuffer> commandBuffer;
@@ -185,9 +192,14 @@ typedef struct MNVGfragUniforms MNVGfragUniforms;
 @property (nonatomic, strong) id<MTLSamplerState> pseudoSampler;
 @property (nonatomic, strong) id<MTLTexture> pseudoTexture;
 @property (nonatomic, strong) MTLVertexDescriptor* vertexDescriptor;
+@property (nonatomic, strong) id binaryArchive;  // id<MTLBinaryArchive>
+@property (nonatomic, strong) NSURL* binaryArchiveURL;
+@property (nonatomic, assign) BOOL binaryArchiveChanged;
 
 - (MNVGtexture*)allocTexture;
 
+- (void)checkError:(NSError*)error withMessage:(const char*)message;
+
 - (void)convexFill:(MNVGcall*)call;
 
 -(void)fill:(MNVGcall*)call;
@@ -252,6 +264,9 @@ typedef struct MNVGfragUniforms MNVGfragUniforms;
 
 - (void)triangles:(MNVGcall*)call;
 
+- (id<MTLRenderPipelineState>)newPipelineStateWithDescriptor:
+    (MTLRenderPipelineDescriptor*)descriptor error:(NSError**)error;
+
 - (void)updateRenderPipelineStatesForBlend:(MNVGblend*)blend
                                pixelFormat:(MTLPixelFormat)pixelFormat;
 
@@ -548,11 +563,209 @@ int mnvgCreateImageFromHandle(NVGcontext* ctx, void* textureId, int imageFlags)
   return tex->id;
 }
 
+int mnvgCreateCompressedImage(NVGcontext* ctx, enum MNVGcompressedFormat format,
+                              int width, int height, const void* data,
+                              int dataSize, int imageFlags) {
+#if TARGET_OS_SIMULATOR
+  return 0;
+#else
+  MNVGcontext* mtl = (__bridge MNVGcontext*)nvgInternalParams(ctx)->userPtr;
+  id<MTLDevice> device = mtl.metalLayer.device;
+  MTLPixelFormat pixelFormat = MTLPixelFormatInvalid;
+
+  if (format == MNVG_COMPRESSED_BC7) {
+#if TARGET_OS_OSX
+    if (@available(macOS 11.0, *)) {
+      if (device.supportsBCTextureCompression)
+        pixelFormat = MTLPixelFormatBC7_RGBAUnorm;
+    } else {
+      pixelFormat = MTLPixelFormatBC7_RGBAUnorm;
+    }
+#elif TARGET_OS_IOS && !TARGET_OS_MACCATALYST
+    if (@available(iOS 16.4, *)) {
+      if (device.supportsBCTextureCompression)
+        pixelFormat = MTLPixelFormatBC7_RGBAUnorm;
+    }
+#endif
+  } else if (format == MNVG_COMPRESSED_ASTC_4X4) {
+    if (@available(macOS 11.0, iOS 13.0, tvOS 13.0, *)) {
+      if ([device supportsFamily:MTLGPUFamilyApple2])
+        pixelFormat = MTLPixelFormatASTC_4x4_LDR;
+    }
+  }
+
+  const NSUInteger bytesPerRow = ((width + 3) / 4) * 16;
+  if (pixelFormat == MTLPixelFormatInvalid || width <= 0 || height <= 0 ||
+      (NSUInteger)dataSize < bytesPerRow * ((height + 3) / 4))
+    return 0;
+
+  MTLTextureDescriptor* textureDescriptor = [MTLTextureDescriptor
+      texture2DDescriptorWithPixelFormat:pixelFormat
+      width:width
+      height:height
+      mipmapped:NO];
+  textureDescriptor.usage = MTLTextureUsageShaderRead;
+  id<MTLTexture> texture = [device newTextureWithDescriptor:textureDescriptor];
+  if (texture == nil) return 0;
+
+  [texture replaceRegion:MTLRegionMake2D(0, 0, width, height)
+             mipmapLevel:0
+               withBytes:data
+             bytesPerRow:bytesPerRow];
+
+  MNVGtexture* tex = [mtl allocTexture];
+  if (tex == nil) return 0;
+
+  MTLSamplerDescriptor* samplerDescriptor = [MTLSamplerDescriptor new];
+  samplerDescriptor.minFilter = MTLSamplerMinMagFilterLinear;
+  samplerDescriptor.magFilter = MTLSamplerMinMagFilterLinear;
+  samplerDescriptor.sAddressMode = MTLSamplerAddressModeClampToEdge;
+  samplerDescriptor.tAddressMode = MTLSamplerAddressModeClampToEdge;
+
+  tex->type = NVG_TEXTURE_RGBA;
+  tex->tex = texture;
+  tex->flags = imageFlags;
+  tex->sampler = [device newSamplerStateWithDescriptor:samplerDescriptor];
+
+  return tex->id;
+#endif  // TARGET_OS_SIMULATOR
+}
+
 void* mnvgDevice(NVGcontext* ctx) {
   MNVGcontext* mtl = (__bridge MNVGcontext*)nvgInternalParams(ctx)->userPtr;
   return (__bridge void*)mtl.metalLayer.device;
 }
 
+int mnvgSetBinaryArchivePath(NVGcontext* ctx, const char* path) {
+  MNVGcontext* mtl = (__bridge MNVGcontext*)nvgInternalParams(ctx)->userPtr;
+  if (@available(macOS 11.0, iOS 14.0, tvOS 14.0, *)) {
+    NSURL* url = [NSURL fileURLWithPath:[NSString stringWithUTF8String:path]];
+    [[NSFileManager defaultManager]
+              createDirectoryAtURL:[url URLByDeletingLastPathComponent]
+        withIntermediateDirectories:YES
+                         attributes:nil
+                              error:nil];
+    MTLBinaryArchiveDescriptor* descriptor = [MTLBinaryArchiveDescriptor new];
+    if ([[NSFileManager defaultManager] fileExistsAtPath:url.path]) {
+      descriptor.url = url;
+    }
+    NSError* error = nil;
+    id<MTLBinaryArchive> archive =
+        [mtl.metalLayer.device newBinaryArchiveWithDescriptor:descriptor
+                                                        error:&error];
+    if (archive == nil && descriptor.url != nil) {
+      // The archive is from another OS or GPU, start again.
+      descriptor.url = nil;
+      archive = [mtl.metalLayer.device newBinaryArchiveWithDescriptor:descriptor
+                                                                error:&error];
+    }
+    if (archive == nil) return 0;
+    mtl.binaryArchive = archive;
+    mtl.binaryArchiveURL = url;
+    mtl.binaryArchiveChanged = NO;
+    return 1;
+  }
+  return 0;
+}
+
+void* mnvgCreateShader(NVGcontext* ctx, const char* source,
+                       const char* vertexFunction,
+                       const char* fragmentFunction, char* error,
+                       int errorSize) {
+  MNVGcontext* mtl = (__bridge MNVGcontext*)nvgInternalParams(ctx)->userPtr;
+  id<MTLDevice> device = mtl.metalLayer.device;
+  NSError* compileError = nil;
+  id<MTLLibrary> library =
+      [device newLibraryWithSource:[NSString stringWithUTF8String:source]
+                           options:nil
+                             error:&compileError];
+
+  MNVGshader* shader = nil;
+  if (library != nil) {
+    shader = [MNVGshader new];
+    shader.vertexFunction = [library newFunctionWithName:
+        [NSString stringWithUTF8String:vertexFunction]];
+    shader.fragmentFunction = [library newFunctionWithName:
+        [NSString stringWithUTF8String:fragmentFunction]];
+    shader.pixelFormat = MTLPixelFormatInvalid;
+    if (shader.vertexFunction == nil || shader.fragmentFunction == nil)
+      shader = nil;
+  }
+
+  if (shader == nil) {
+    if (error != NULL && errorSize > 0) {
+      const char* message = compileError != nil
+          ? compileError.localizedDescription.UTF8String
+          : "Shader function not found";
+      strncpy(error, message, errorSize - 1);
+      error[errorSize - 1] = '\0';
+    }
+    return NULL;
+  }
+
+  return (void*)CFBridgingRetain(shader);
+}
+
+void mnvgDrawShader(NVGcontext* ctx, void* shader, int image, int x, int y,
+                    int width, int height, const void* data, int dataSize) {
+  MNVGcontext* mtl = (__bridge MNVGcontext*)nvgInternalParams(ctx)->userPtr;
+  MNVGshader* mnvgShader = (__bridge MNVGshader*)shader;
+  MNVGtexture* tex = [mtl findTexture:image];
+  if (tex == nil || width <= 0 || height <= 0) return;
+
+  id<MTLTexture> texture = tex->tex;
+  if (mnvgShader.pipelineState == nil ||
+      mnvgShader.pixelFormat != texture.pixelFormat) {
+    MTLRenderPipelineDescriptor* descriptor =
+        [MTLRenderPipelineDescriptor new];
+    descriptor.vertexFunction = mnvgShader.vertexFunction;
+    descriptor.fragmentFunction = mnvgShader.fragmentFunction;
+    descriptor.colorAttachments[0].pixelFormat = texture.pixelFormat;
+    NSError* error = nil;
+    mnvgShader.pipelineState =
+        [mtl newPipelineStateWithDescriptor:descriptor error:&error];
+    [mtl checkError:error withMessage:"init shader pipeline state"];
+    mnvgShader.pixelFormat = texture.pixelFormat;
+    if (mnvgShader.pipelineState == nil) return;
+  }
+
+  MTLRenderPassDescriptor* pass = [MTLRenderPassDescriptor renderPassDescriptor];
+  pass.colorAttachments[0].texture = texture;
+  pass.colorAttachments[0].loadAction = MTLLoadActionLoad;
+  pass.colorAttachments[0].storeAction = MTLStoreActionStore;
+
+  id<MTLCommandBuffer> commandBuffer = [mtl.commandQueue commandBuffer];
+  id<MTLRenderCommandEncoder> encoder =
+      [commandBuffer renderCommandEncoderWithDescriptor:pass];
+  [encoder setRenderPipelineState:mnvgShader.pipelineState];
+  [encoder setViewport:(MTLViewport){x, y, width, height, 0.0, 1.0}];
+
+  const float dummy = 0.0f;
+  const vector_float2 size = {(float)width, (float)height};
+  // setFragmentBytes is limited to 4 KB, larger uniforms need a buffer
+  if (data != NULL && dataSize > 4096) {
+    id<MTLBuffer> buffer =
+        [mtl.metalLayer.device newBufferWithBytes:data
+                                           length:dataSize
+                                          options:MTLResourceStorageModeShared];
+    [encoder setFragmentBuffer:buffer offset:0 atIndex:0];
+  } else if (data != NULL && dataSize > 0) {
+    [encoder setFragmentBytes:data length:dataSize atIndex:0];
+  } else {
+    [encoder setFragmentBytes:&dummy length:sizeof(dummy) atIndex:0];
+  }
+  [encoder setFragmentBytes:&size length:sizeof(size) atIndex:1];
+  [encoder drawPrimitives:MTLPrimitiveTypeTriangleStrip
+              vertexStart:0
+              vertexCount:4];
+  [encoder endEncoding];
+  [commandBuffer commit];
+}
+
+void mnvgDeleteShader(void* shader) {
+  if (shader != NULL) CFBridgingRelease(shader);
+}
+
 void* mnvgImageHandle(NVGcontext* ctx, int image) {
   MNVGcontext* mtl = (__bridge MNVGcontext*)nvgInternalParams(ctx)->userPtr;
   MNVGtexture* tex = [mtl findTexture:image];
@@ -1264,6 +1477,15 @@ enum MNVGTarget mnvgTarget() {
 }
 
 - (void)renderDelete {
+  if (@available(macOS 11.0, iOS 14.0, tvOS 14.0, *)) {
+    if (_binaryArchive != nil && _binaryArchiveChanged) {
+      [(id<MTLBinaryArchive>)_binaryArchive serializeToURL:_binaryArchiveURL
+                                                     error:nil];
+    }
+  }
+  _binaryArchive = nil;
+  _binaryArchiveURL = nil;
+
   for (MNVGbuffers* buffers in _cbuffers) {
     buffers->commandBuffer = nil;
     buffers->viewSizeBuffer = nil;
@@ -1764,6 +1986,32 @@ error:
                      vertexCount:call->triangleCount];
 }
 
+// Creates a pipeline state from the binary archive if it holds one for the
+// descriptor, otherwise compiles it and adds it to the archive.
+- (id<MTLRenderPipelineState>)newPipelineStateWithDescriptor:
+    (MTLRenderPipelineDescriptor*)descriptor error:(NSError**)error {
+  if (@available(macOS 11.0, iOS 14.0, tvOS 14.0, *)) {
+    if (_binaryArchive != nil) {
+      id<MTLBinaryArchive> archive = (id<MTLBinaryArchive>)_binaryArchive;
+      descriptor.binaryArchives = @[archive];
+      id<MTLRenderPipelineState> state = [_metalLayer.device
+          newRenderPipelineStateWithDescriptor:descriptor
+                                       options:MTLPipelineOptionFailOnBinaryArchiveMiss
+                                    reflection:nil
+                                         error:nil];
+      if (state != nil) return state;
+
+      descriptor.binaryArchives = nil;
+      if ([archive addRenderPipelineFunctionsWithDescriptor:descriptor
+                                                      error:nil]) {
+        _binaryArchiveChanged = YES;
+      }
+    }
+  }
+  return [_metalLayer.device newRenderPipelineStateWithDescriptor:descriptor
+                                                            error:error];
+}
+
 - (void)updateRenderPipelineStatesForBlend:(MNVGblend*)blend
                                pixelFormat:(MTLPixelFormat)pixelFormat {
   if (_pipelineState != nil &&
@@ -1799,15 +2047,14 @@ error:
   _blendFunc->dstAlpha = blend->dstAlpha;
 
   NSError* error;
-  _pipelineState = [_metalLayer.device
-      newRenderPipelineStateWithDescriptor:pipelineStateDescriptor
-                                     error:&error];
+  _pipelineState = [self newPipelineStateWithDescriptor:pipelineStateDescriptor
+                                                  error:&error];
   [self checkError:error withMessage:"init pipeline state"];
 
   pipelineStateDescriptor.fragmentFunction = nil;
   colorAttachmentDescriptor.writeMask = MTLColorWriteMaskNone;
-  _stencilOnlyPipelineState = [_metalLayer.device
-      newRenderPipelineStateWithDescriptor:pipelineStateDescriptor
+  _stencilOnlyPipelineState =
+      [self newPipelineStateWithDescriptor:pipelineStateDescriptor
                                      error:&error];
   [self checkError:error withMessage:"init pipeline stencil only state"];
 
@@ -1840,3 +2087,6 @@ error:
 
 @implementation MNVGtexture
 @end
+
+@implementation MNVGshader
+@end
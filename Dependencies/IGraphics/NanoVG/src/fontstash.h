@@ -24,8 +24,17 @@
 enum FONSflags {
 	FONS_ZERO_TOPLEFT = 1,
 	FONS_ZERO_BOTTOMLEFT = 2,
+	FONS_SDF = 4,	// Glyphs are stored once as signed distance fields and scaled to the text size, see fonsSetSDF()
 };
 
+// The size in pixels at which glyphs are rendered in SDF mode, and the distance in pixels either side of the edge the field covers.
+#ifndef FONS_SDF_SIZE
+#define FONS_SDF_SIZE 48
+#endif
+#ifndef FONS_SDF_SPREAD
+#define FONS_SDF_SPREAD 6
+#endif
+
 enum FONSalign {
 	// Horizontal align
 	FONS_ALIGN_LEFT 	= 1<<0,	// Default
@@ -100,6 +109,10 @@ void fonsGetAtlasSize(FONScontext* s, int* width, int* height);
 int fonsExpandAtlas(FONScontext* s, int width, int height);
 // Resets the whole stash.
 int fonsResetAtlas(FONScontext* stash, int width, int height);
+// Stores glyphs as signed distance fields rendered at FONS_SDF_SIZE, so one glyph serves every text size.
+// The atlas then holds distances rather than coverage, with the edge at 0.5, which the renderer has to threshold. Blur is ignored.
+// Call fonsResetAtlas() afterwards, since glyphs already in the atlas are in the other format.
+void fonsSetSDF(FONScontext* s, int enabled);
 
 // Add fonts
 int fonsAddFont(FONScontext* s, const char* name, const char* path, int faceIdx);
@@ -817,6 +830,14 @@ void fonsSetBlur(FONScontext* stash, float blur)
 	fons__getState(stash)->blur = blur;
 }
 
+void fonsSetSDF(FONScontext* stash, int enabled)
+{
+	if (enabled)
+		stash->params.flags |= FONS_SDF;
+	else
+		stash->params.flags &= ~FONS_SDF;
+}
+
 void fonsSetAlign(FONScontext* stash, int align)
 {
 	fons__getState(stash)->align = align;
@@ -1054,6 +1075,94 @@ static void fons__blur(FONScontext* stash, unsigned char* dst, int w, int h, int
 //	fons__blurcols(dst, w, h, dstStride, alpha);
 }
 
+#define FONS_SDF_INF 1e20f
+
+// One pass of the Felzenszwalb & Huttenlocher squared euclidean distance transform, along a row or column of the grid.
+static void fons__edt1d(float* grid, int offset, int stride, int length, float* f, int* v, float* z)
+{
+	int q, k, r;
+	float s;
+	v[0] = 0;
+	z[0] = -FONS_SDF_INF;
+	z[1] = FONS_SDF_INF;
+	f[0] = grid[offset];
+	for (q = 1, k = 0; q < length; q++) {
+		f[q] = grid[offset + q*stride];
+		do {
+			r = v[k];
+			s = (f[q] - f[r] + (float)(q*q - r*r)) / (float)(q - r) / 2.0f;
+		} while (s <= z[k] && --k > -1);
+		k++;
+		v[k] = q;
+		z[k] = s;
+		z[k+1] = FONS_SDF_INF;
+	}
+	for (q = 0, k = 0; q < length; q++) {
+		while (z[k+1] < q) k++;
+		r = v[k];
+		grid[offset + q*stride] = f[r] + (float)((q - r)*(q - r));
+	}
+}
+
+static void fons__edt(float* grid, int w, int h, float* f, int* v, float* z)
+{
+	int x, y;
+	for (x = 0; x < w; x++)
+		fons__edt1d(grid, x, w, h, f, v, z);
+	for (y = 0; y < h; y++)
+		fons__edt1d(grid, y*w, 1, w, f, v, z);
+}
+
+// Replaces the coverage of a rendered glyph with its signed distance field, 0.5 on the edge and FONS_SDF_SPREAD pixels either side of it mapped to 0..1.
+// Partially covered pixels place the edge within the pixel, as in Mapbox's TinySDF.
+static void fons__sdf(unsigned char* dst, int w, int h, int dstStride)
+{
+	int x, y, n = w*h, len = fons__maxi(w, h);
+	float* outer = (float*)malloc(sizeof(float) * n);
+	float* inner = (float*)malloc(sizeof(float) * n);
+	float* f = (float*)malloc(sizeof(float) * len);
+	float* z = (float*)malloc(sizeof(float) * (len+1));
+	int* v = (int*)malloc(sizeof(int) * len);
+
+	if (outer != NULL && inner != NULL && f != NULL && z != NULL && v != NULL) {
+		for (y = 0; y < h; y++) {
+			for (x = 0; x < w; x++) {
+				float a = dst[x + y*dstStride] / 255.0f;
+				int i = x + y*w;
+				if (a == 1.0f) {
+					outer[i] = 0.0f;
+					inner[i] = FONS_SDF_INF;
+				} else if (a == 0.0f) {
+					outer[i] = FONS_SDF_INF;
+					inner[i] = 0.0f;
+				} else {
+					float d = 0.5f - a;
+					outer[i] = d > 0.0f ? d*d : 0.0f;
+					inner[i] = d < 0.0f ? d*d : 0.0f;
+				}
+			}
+		}
+
+		fons__edt(outer, w, h, f, v, z);
+		fons__edt(inner, w, h, f, v, z);
+
+		for (y = 0; y < h; y++) {
+			for (x = 0; x < w; x++) {
+				int i = x + y*w;
+				float d = sqrtf(outer[i]) - sqrtf(inner[i]);
+				float c = 255.0f * (0.5f - d / (2.0f * FONS_SDF_SPREAD));
+				dst[x + y*dstStride] = (unsigned char)(c < 0.0f ? 0.0f : (c > 255.0f ? 255.0f : c + 0.5f));
+			}
+		}
+	}
+
+	free(outer);
+	free(inner);
+	free(f);
+	free(z);
+	free(v);
+}
+
 static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned int codepoint,
 								 short isize, short iblur, int bitmapOption)
 {
@@ -1071,6 +1180,14 @@ static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned in
 	if (iblur > 20) iblur = 20;
 	pad = iblur+2;
 
+	if (stash->params.flags & FONS_SDF) {
+		// Every size shares the one glyph, with room around it for the field.
+		isize = FONS_SDF_SIZE*10;
+		size = FONS_SDF_SIZE;
+		iblur = 0;
+		pad = FONS_SDF_SPREAD+2;
+	}
+
 	// Reset allocator.
 	stash->nscratch = 0;
 
@@ -1183,6 +1300,12 @@ static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned in
 		fons__blur(stash, bdst, gw, gh, stash->params.width, iblur);
 	}
 
+	// Distance field, inside the empty border
+	if (stash->params.flags & FONS_SDF) {
+		bdst = &stash->texData[(glyph->x0+1) + (glyph->y0+1) * stash->params.width];
+		fons__sdf(bdst, gw-2, gh-2, stash->params.width);
+	}
+
 	stash->dirtyRect[0] = fons__mini(stash->dirtyRect[0], glyph->x0);
 	stash->dirtyRect[1] = fons__mini(stash->dirtyRect[1], glyph->y0);
 	stash->dirtyRect[2] = fons__maxi(stash->dirtyRect[2], glyph->x1);
@@ -1193,10 +1316,45 @@ static FONSglyph* fons__getGlyph(FONScontext* stash, FONSfont* font, unsigned in
 
 static void fons__getQuad(FONScontext* stash, FONSfont* font,
 						   int prevGlyphIndex, FONSglyph* glyph,
-						   float scale, float spacing, float* x, float* y, FONSquad* q)
+						   float scale, float spacing, short isize, float* x, float* y, FONSquad* q)
 {
 	float rx,ry,xoff,yoff,x0,y0,x1,y1;
 
+	if (stash->params.flags & FONS_SDF) {
+		// The glyph is at FONS_SDF_SIZE, so it is scaled to the text size, without snapping to whole pixels.
+		float gs = (float)isize / (float)glyph->size;
+
+		if (prevGlyphIndex != -1) {
+			float adv = fons__tt_getGlyphKernAdvance(&font->font, prevGlyphIndex, glyph->index) * scale;
+			*x += adv + spacing;
+		}
+
+		xoff = (glyph->xoff+1) * gs;
+		yoff = (glyph->yoff+1) * gs;
+		x0 = (float)(glyph->x0+1);
+		y0 = (float)(glyph->y0+1);
+		x1 = (float)(glyph->x1-1);
+		y1 = (float)(glyph->y1-1);
+
+		q->x0 = *x + xoff;
+		q->x1 = q->x0 + (x1 - x0) * gs;
+		if (stash->params.flags & FONS_ZERO_TOPLEFT) {
+			q->y0 = *y + yoff;
+			q->y1 = q->y0 + (y1 - y0) * gs;
+		} else {
+			q->y0 = *y - yoff;
+			q->y1 = q->y0 - (y1 - y0) * gs;
+		}
+
+		q->s0 = x0 * stash->itw;
+		q->t0 = y0 * stash->ith;
+		q->s1 = x1 * stash->itw;
+		q->t1 = y1 * stash->ith;
+
+		*x += glyph->xadv / 10.0f * gs;
+		return;
+	}
+
 	if (prevGlyphIndex != -1) {
 		float adv = fons__tt_getGlyphKernAdvance(&font->font, prevGlyphIndex, glyph->index) * scale;
 		*x += (int)(adv + spacing + 0.5f);
@@ -1344,7 +1502,7 @@ float fonsDrawText(FONScontext* stash,
 			continue;
 		glyph = fons__getGlyph(stash, font, codepoint, isize, iblur, FONS_GLYPH_BITMAP_REQUIRED);
 		if (glyph != NULL) {
-			fons__getQuad(stash, font, prevGlyphIndex, glyph, scale, state->spacing, &x, &y, &q);
+			fons__getQuad(stash, font, prevGlyphIndex, glyph, scale, state->spacing, isize, &x, &y, &q);
 
 			if (stash->nverts+6 > FONS_VERTEX_COUNT)
 				fons__flush(stash);
@@ -1429,7 +1587,7 @@ int fonsTextIterNext(FONScontext* stash, FONStextIter* iter, FONSquad* quad)
 		glyph = fons__getGlyph(stash, iter->font, iter->codepoint, iter->isize, iter->iblur, iter->bitmapOption);
 		// If the iterator was initialized with FONS_GLYPH_BITMAP_OPTIONAL, then the UV coordinates of the quad will be invalid.
 		if (glyph != NULL)
-			fons__getQuad(stash, iter->font, iter->prevGlyphIndex, glyph, iter->scale, iter->spacing, &iter->nextx, &iter->nexty, quad);
+			fons__getQuad(stash, iter->font, iter->prevGlyphIndex, glyph, iter->scale, iter->spacing, iter->isize, &iter->nextx, &iter->nexty, quad);
 		iter->prevGlyphIndex = glyph != NULL ? glyph->index : -1;
 		break;
 	}
@@ -1526,7 +1684,7 @@ float fonsTextBounds(FONScontext* stash,
 			continue;
 		glyph = fons__getGlyph(stash, font, codepoint, isize, iblur, FONS_GLYPH_BITMAP_OPTIONAL);
 		if (glyph != NULL) {
-			fons__getQuad(stash, font, prevGlyphIndex, glyph, scale, state->spacing, &x, &y, &q);
+			fons__getQuad(stash, font, prevGlyphIndex, glyph, scale, state->spacing, isize, &x, &y, &q);
 			if (q.x0 < minx) minx = q.x0;
 			if (q.x1 > maxx) maxx = q.x1;
 			if (stash->params.flags & FONS_ZERO_TOPLEFT) {
@@ -125,6 +125,7 @@ struct NVGcontext {
 	struct FONScontext* fs;
 	int fontImages[NVG_MAX_FONTIMAGES];
 	int fontImageIdx;
+	int fontImageFlags;
 	int drawCallCount;
 	int fillTriCount;
 	int strokeTriCount;
@@ -324,7 +325,8 @@ NVGcontext* nvgCreateInternal(NVGparams* params)
 	if (ctx->fs == NULL) goto error;
 
 	// Create font texture
-	ctx->fontImages[0] = ctx->params.renderCreateTexture(ctx->params.userPtr, NVG_TEXTURE_ALPHA, fontParams.width, fontParams.height, 0, NULL);
+	ctx->fontImageFlags = 0;
+	ctx->fontImages[0] = ctx->params.renderCreateTexture(ctx->params.userPtr, NVG_TEXTURE_ALPHA, fontParams.width, fontParams.height, ctx->fontImageFlags, NULL);
 	if (ctx->fontImages[0] == 0) goto error;
 	ctx->fontImageIdx = 0;
 
@@ -2245,6 +2247,94 @@ void nvgFill(NVGcontext* ctx)
 	}
 }
 
+int nvgShapesSupported(NVGcontext* ctx)
+{
+	return ctx->params.renderShapes != NULL;
+}
+
+// Sends one shape's quad. ex, ey are the half extents of the quad in the shape's coordinates, and (ax, ay) is the direction
+// of its u axis in user space. The quad is transformed on the CPU, as paths are, which interpolates the shape coordinates exactly.
+static int nvg__renderShape(NVGcontext* ctx, float cx, float cy, float ax, float ay, float ex, float ey, const float* shape, float strokeWidth, NVGcolor color)
+{
+	NVGstate* state = nvg__getState(ctx);
+	NVGshapeVertex verts[6];
+	float corners[4][2];
+	float scale = nvg__getAverageScale(state->xform);
+	float aa = ctx->fringeWidth / nvg__maxf(scale, 1e-6f);
+	float halfStroke = nvg__maxf(strokeWidth, 0.0f) * 0.5f;
+	float alpha = color.a * state->alpha;
+	// Two triangles, in the same order as text quads.
+	static const int order[6] = {0, 2, 1, 0, 3, 2};
+	static const float signs[4][2] = {{-1,-1}, {1,-1}, {1,1}, {-1,1}};
+	int i, j;
+
+	if (ctx->params.renderShapes == NULL)
+		return 0;
+
+	ex += halfStroke + aa;
+	ey += halfStroke + aa;
+
+	for (i = 0; i < 4; i++) {
+		float u = signs[i][0] * ex, v = signs[i][1] * ey;
+		// The v axis is the u axis turned clockwise by 90 degrees, in y-down coordinates.
+		nvgTransformPoint(&corners[i][0], &corners[i][1], state->xform, cx + u*ax - v*ay, cy + u*ay + v*ax);
+	}
+
+	for (i = 0; i < 6; i++) {
+		NVGshapeVertex* vtx = &verts[i];
+		j = order[i];
+		vtx->x = corners[j][0];
+		vtx->y = corners[j][1];
+		vtx->u = signs[j][0] * ex;
+		vtx->v = signs[j][1] * ey;
+		memcpy(vtx->shape, shape, sizeof(vtx->shape));
+		vtx->stroke[0] = halfStroke;
+		vtx->stroke[1] = aa;
+		vtx->color[0] = color.r * alpha;
+		vtx->color[1] = color.g * alpha;
+		vtx->color[2] = color.b * alpha;
+		vtx->color[3] = alpha;
+	}
+
+	if (!ctx->params.renderShapes(ctx->params.userPtr, state->compositeOperation, &state->scissor, verts, 6, ctx->fringeWidth))
+		return 0;
+
+	ctx->drawCallCount++;
+	ctx->fillTriCount += 2;
+	return 1;
+}
+
+int nvgShapeRoundedRect(NVGcontext* ctx, float x, float y, float w, float h, float r, float strokeWidth, NVGcolor color)
+{
+	float shape[4];
+	shape[0] = 0.0f;
+	shape[1] = nvg__absf(w) * 0.5f;
+	shape[2] = nvg__absf(h) * 0.5f;
+	shape[3] = nvg__clampf(r, 0.0f, nvg__minf(shape[1], shape[2]));
+	return nvg__renderShape(ctx, x + w*0.5f, y + h*0.5f, 1.0f, 0.0f, shape[1], shape[2], shape, strokeWidth, color);
+}
+
+int nvgShapeArc(NVGcontext* ctx, float cx, float cy, float r, float a0, float a1, float strokeWidth, NVGcolor color)
+{
+	float shape[4];
+	float da = a1 - a0, mid, half;
+
+	// Clockwise, as nvgArc().
+	if (nvg__absf(da) >= NVG_PI*2)
+		da = NVG_PI*2;
+	else
+		while (da < 0.0f) da += NVG_PI*2;
+
+	half = da * 0.5f;
+	mid = a0 + half;
+	shape[0] = 1.0f;
+	shape[1] = nvg__absf(r);
+	shape[2] = nvg__sinf(half);
+	shape[3] = nvg__cosf(half);
+	// The v axis points at the middle of the arc, so the u axis is behind it by 90 degrees.
+	return nvg__renderShape(ctx, cx, cy, nvg__sinf(mid), -nvg__cosf(mid), shape[1], shape[1], shape, strokeWidth, color);
+}
+
 void nvgStroke(NVGcontext* ctx)
 {
 	NVGstate* state = nvg__getState(ctx);
@@ -2332,6 +2422,28 @@ void nvgFontSize(NVGcontext* ctx, float size)
 	state->fontSize = size;
 }
 
+void nvgTextSDF(NVGcontext* ctx, int enabled)
+{
+	int i, iw, ih, flags = enabled ? NVG_IMAGE_SDF : 0;
+
+	if (flags == ctx->fontImageFlags) return;
+
+	// The glyphs in the atlas are in the other format, so the font images are made again with the new flags, at the size of the current one.
+	nvgImageSize(ctx, ctx->fontImages[ctx->fontImageIdx], &iw, &ih);
+	for (i = 0; i < NVG_MAX_FONTIMAGES; i++) {
+		if (ctx->fontImages[i] != 0) {
+			nvgDeleteImage(ctx, ctx->fontImages[i]);
+			ctx->fontImages[i] = 0;
+		}
+	}
+
+	ctx->fontImageFlags = flags;
+	ctx->fontImages[0] = ctx->params.renderCreateTexture(ctx->params.userPtr, NVG_TEXTURE_ALPHA, iw, ih, flags, NULL);
+	ctx->fontImageIdx = 0;
+	fonsSetSDF(ctx->fs, enabled);
+	fonsResetAtlas(ctx->fs, iw, ih);
+}
+
 void nvgFontBlur(NVGcontext* ctx, float blur)
 {
 	NVGstate* state = nvg__getState(ctx);
@@ -2414,7 +2526,7 @@ static int nvg__allocTextAtlas(NVGcontext* ctx)
 			iw *= 2;
 		if (iw > NVG_MAX_FONTIMAGE_SIZE || ih > NVG_MAX_FONTIMAGE_SIZE)
 			iw = ih = NVG_MAX_FONTIMAGE_SIZE;
-		ctx->fontImages[ctx->fontImageIdx+1] = ctx->params.renderCreateTexture(ctx->params.userPtr, NVG_TEXTURE_ALPHA, iw, ih, 0, NULL);
+		ctx->fontImages[ctx->fontImageIdx+1] = ctx->params.renderCreateTexture(ctx->params.userPtr, NVG_TEXTURE_ALPHA, iw, ih, ctx->fontImageFlags, NULL);
 	}
 	++ctx->fontImageIdx;
 	fonsResetAtlas(ctx->fs, iw, ih);
@@ -2429,6 +2541,12 @@ static void nvg__renderText(NVGcontext* ctx, NVGvertex* verts, int nverts)
 	// Render triangles.
 	paint.image = ctx->fontImages[ctx->fontImageIdx];
 
+	// For distance fields, the half width of the edge as a distance, for about a pixel of antialiasing at this size.
+	if (ctx->fontImageFlags & NVG_IMAGE_SDF) {
+		float size = state->fontSize * nvg__getFontScale(state) * ctx->devicePxRatio;
+		paint.feather = FONS_SDF_SIZE / (4.0f * FONS_SDF_SPREAD * nvg__maxf(size, 1.0f));
+	}
+
 	// Apply global alpha
 	paint.innerColor.a *= state->alpha;
 	paint.outerColor.a *= state->alpha;
@@ -142,6 +142,7 @@ enum NVGimageFlags {
 	NVG_IMAGE_FLIPY				= 1<<3,		// Flips (inverses) image in Y direction when rendered.
 	NVG_IMAGE_PREMULTIPLIED		= 1<<4,		// Image data has premultiplied alpha.
 	NVG_IMAGE_NEAREST			= 1<<5,		// Image interpolation is Nearest instead Linear
+	NVG_IMAGE_SDF				= 1<<6,		// Alpha image holding a signed distance field, which is thresholded at 0.5 when rendered. Used for the font atlas by nvgTextSDF()
 };
 
 // Begin drawing a new frame
@@ -508,6 +509,25 @@ void nvgFill(NVGcontext* ctx);
 // Fills the current path with current stroke style.
 void nvgStroke(NVGcontext* ctx);
 
+//
+// Analytic shapes
+//
+// Rounded rectangles, circles and arcs can be drawn without building a path. Each is sent to the renderer as one quad,
+// which a shader fills with the shape's signed distance, antialiased over about a pixel. Consecutive shapes with the
+// same scissor and composite operation are drawn together. The shapes are drawn with the current transform,
+// scissor, composite operation and global alpha, in a solid color, and don't change the current path.
+// Each returns 0, and draws nothing, if the renderer doesn't support them (the GL back-ends do), so that the caller can draw a path instead.
+
+// Returns 1 if the renderer can draw analytic shapes.
+int nvgShapesSupported(NVGcontext* ctx);
+
+// Fills a rounded rectangle, or strokes it centred on its edge if strokeWidth is greater than 0.
+int nvgShapeRoundedRect(NVGcontext* ctx, float x, float y, float w, float h, float r, float strokeWidth, NVGcolor color);
+
+// Fills a pie slice of a circle, or strokes the arc with butt caps if strokeWidth is greater than 0.
+// The angles are in radians, and the arc goes clockwise from a0 to a1, as nvgArc() with NVG_CW. Use 0 and 2*NVG_PI for a whole circle.
+int nvgShapeArc(NVGcontext* ctx, float cx, float cy, float r, float a0, float a1, float strokeWidth, NVGcolor color);
+
 
 //
 // Text
@@ -573,6 +593,11 @@ void nvgFontSize(NVGcontext* ctx, float size);
 // Sets the blur of current text style.
 void nvgFontBlur(NVGcontext* ctx, float blur);
 
+// Renders text from glyphs stored once as signed distance fields, which are scaled to each size, rather than rasterizing every size.
+// Text stays sharp when scaled or transformed, and the atlas holds one copy of each glyph, but small text loses the hinting of rasterized glyphs.
+// Font blur is ignored while this is enabled. The renderer must support NVG_IMAGE_SDF (the GL back-ends do). Call it outside nvgBeginFrame()/nvgEndFrame().
+void nvgTextSDF(NVGcontext* ctx, int enabled);
+
 // Sets the letter spacing of current text style.
 void nvgTextLetterSpacing(NVGcontext* ctx, float spacing);
 
@@ -639,6 +664,16 @@ struct NVGvertex {
 };
 typedef struct NVGvertex NVGvertex;
 
+// A vertex of an analytic shape's quad.
+struct NVGshapeVertex {
+	float x,y;			// Position.
+	float u,v;			// Position in the shape's coordinates, centred on it, and for arcs rotated so that the middle of the arc is along +v.
+	float shape[4];		// Rounded rectangle: 0, half width, half height, corner radius. Arc: 1, radius, sine and cosine of half its angle.
+	float stroke[2];	// Half the stroke width, or 0 to fill. The antialiasing width in the shape's coordinates.
+	float color[4];		// Premultiplied color.
+};
+typedef struct NVGshapeVertex NVGshapeVertex;
+
 struct NVGpath {
 	int first;
 	int count;
@@ -668,6 +703,7 @@ struct NVGparams {
 	void (*renderStroke)(void* uptr, NVGpaint* paint, NVGcompositeOperationState compositeOperation, NVGscissor* scissor, float fringe, float strokeWidth, const NVGpath* paths, int npaths);
 	void (*renderTriangles)(void* uptr, NVGpaint* paint, NVGcompositeOperationState compositeOperation, NVGscissor* scissor, const NVGvertex* verts, int nverts, float fringe);
 	void (*renderDelete)(void* uptr);
+	int (*renderShapes)(void* uptr, NVGcompositeOperationState compositeOperation, NVGscissor* scissor, const NVGshapeVertex* verts, int nverts, float fringe); // Optional, see nvgShapesSupported(). Returns 0 if the shapes weren't drawn.
 };
 typedef struct NVGparams NVGparams;
 
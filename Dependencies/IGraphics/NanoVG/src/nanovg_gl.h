@@ -165,6 +165,7 @@ enum GLNVGcallType {
 	GLNVG_CONVEXFILL,
 	GLNVG_STROKE,
 	GLNVG_TRIANGLES,
+	GLNVG_SHAPES,
 };
 
 struct GLNVGcall {
@@ -230,6 +231,7 @@ typedef struct GLNVGfragUniforms GLNVGfragUniforms;
 
 struct GLNVGcontext {
 	GLNVGshader shader;
+	GLNVGshader shapeShader; // for analytic shapes, prog is 0 if it couldn't be made
 	GLNVGtexture* textures;
 	float view[2];
 	int ntextures;
@@ -258,6 +260,14 @@ struct GLNVGcontext {
 	unsigned char* uniforms;
 	int cuniforms;
 	int nuniforms;
+	struct NVGshapeVertex* shapeVerts;
+	int cshapeVerts;
+	int nshapeVerts;
+	NVGscissor shapeScissor; // the scissor of the last shapes call, which the next shapes can be added to
+	GLuint shapeBuf;
+#if defined NANOVG_GL3
+	GLuint shapeArr;
+#endif
 
 	// cached state
 	#if NANOVG_GL_USE_STATE_FILTER
@@ -465,6 +475,9 @@ static int glnvg__createShader(GLNVGshader* shader, const char* name, const char
 
 	glBindAttribLocation(prog, 0, "vertex");
 	glBindAttribLocation(prog, 1, "tcoord");
+	glBindAttribLocation(prog, 2, "shape");
+	glBindAttribLocation(prog, 3, "stroke");
+	glBindAttribLocation(prog, 4, "color");
 
 	glLinkProgram(prog);
 	glGetProgramiv(prog, GL_LINK_STATUS, &status);
@@ -652,6 +665,7 @@ static int glnvg__renderCreate(void* uptr)
 		"#endif\n"
 		"		if (texType == 1) color = vec4(color.xyz*color.w,color.w);"
 		"		if (texType == 2) color = vec4(color.x);"
+		"		if (texType == 3) color = vec4(smoothstep(0.5 - feather, 0.5 + feather, color.x));"
 		"		// Apply color tint and alpha.\n"
 		"		color *= innerCol;\n"
 		"		// Combine alpha\n"
@@ -667,6 +681,7 @@ static int glnvg__renderCreate(void* uptr)
 		"#endif\n"
 		"		if (texType == 1) color = vec4(color.xyz*color.w,color.w);"
 		"		if (texType == 2) color = vec4(color.x);"
+		"		if (texType == 3) color = vec4(smoothstep(0.5 - feather, 0.5 + feather, color.x));"
 		"		color *= scissor;\n"
 		"		result = color * innerCol;\n"
 		"	}\n"
@@ -677,6 +692,127 @@ static int glnvg__renderCreate(void* uptr)
 		"#endif\n"
 		"}\n";
 
+	// Analytic shapes, see nvgShapeRoundedRect() and nvgShapeArc(). The shape is passed with every vertex, so that many can be drawn at once.
+	static const char* shapeVertShader =
+		"#ifdef NANOVG_GL3\n"
+		"	uniform vec2 viewSize;\n"
+		"	in vec2 vertex;\n"
+		"	in vec2 tcoord;\n"
+		"	in vec4 shape;\n"
+		"	in vec2 stroke;\n"
+		"	in vec4 color;\n"
+		"	out vec2 fpos;\n"
+		"	out vec2 flocal;\n"
+		"	out vec4 fshape;\n"
+		"	out vec2 fstroke;\n"
+		"	out vec4 fcolor;\n"
+		"#else\n"
+		"	uniform vec2 viewSize;\n"
+		"	attribute vec2 vertex;\n"
+		"	attribute vec2 tcoord;\n"
+		"	attribute vec4 shape;\n"
+		"	attribute vec2 stroke;\n"
+		"	attribute vec4 color;\n"
+		"	varying vec2 fpos;\n"
+		"	varying vec2 flocal;\n"
+		"	varying vec4 fshape;\n"
+		"	varying vec2 fstroke;\n"
+		"	varying vec4 fcolor;\n"
+		"#endif\n"
+		"void main(void) {\n"
+		"	fpos = vertex;\n"
+		"	flocal = tcoord;\n"
+		"	fshape = shape;\n"
+		"	fstroke = stroke;\n"
+		"	fcolor = color;\n"
+		"	gl_Position = vec4(2.0*vertex.x/viewSize.x - 1.0, 1.0 - 2.0*vertex.y/viewSize.y, 0, 1);\n"
+		"}\n";
+
+	static const char* shapeFragShader =
+		"#ifdef GL_ES\n"
+		"#if defined(GL_FRAGMENT_PRECISION_HIGH) || defined(NANOVG_GL3)\n"
+		" precision highp float;\n"
+		"#else\n"
+		" precision mediump float;\n"
+		"#endif\n"
+		"#endif\n"
+		"#ifdef NANOVG_GL3\n"
+		"#ifdef USE_UNIFORMBUFFER\n"
+		"	layout(std140) uniform frag {\n"
+		"		mat3 scissorMat;\n"
+		"		mat3 paintMat;\n"
+		"		vec4 innerCol;\n"
+		"		vec4 outerCol;\n"
+		"		vec2 scissorExt;\n"
+		"		vec2 scissorScale;\n"
+		"		vec2 extent;\n"
+		"		float radius;\n"
+		"		float feather;\n"
+		"		float strokeMult;\n"
+		"		float strokeThr;\n"
+		"		int texType;\n"
+		"		int type;\n"
+		"	};\n"
+		"#else\n"
+		"	uniform vec4 frag[UNIFORMARRAY_SIZE];\n"
+		"#endif\n"
+		"	in vec2 fpos;\n"
+		"	in vec2 flocal;\n"
+		"	in vec4 fshape;\n"
+		"	in vec2 fstroke;\n"
+		"	in vec4 fcolor;\n"
+		"	out vec4 outColor;\n"
+		"#else\n"
+		"	uniform vec4 frag[UNIFORMARRAY_SIZE];\n"
+		"	varying vec2 fpos;\n"
+		"	varying vec2 flocal;\n"
+		"	varying vec4 fshape;\n"
+		"	varying vec2 fstroke;\n"
+		"	varying vec4 fcolor;\n"
+		"#endif\n"
+		"#ifndef USE_UNIFORMBUFFER\n"
+		"	#define scissorMat mat3(frag[0].xyz, frag[1].xyz, frag[2].xyz)\n"
+		"	#define scissorExt frag[8].xy\n"
+		"	#define scissorScale frag[8].zw\n"
+		"#endif\n"
+		"\n"
+		"float sdroundrect(vec2 pt, vec2 ext, float rad) {\n"
+		"	vec2 ext2 = ext - vec2(rad,rad);\n"
+		"	vec2 d = abs(pt) - ext2;\n"
+		"	return min(max(d.x,d.y),0.0) + length(max(d,0.0)) - rad;\n"
+		"}\n"
+		"// A pie slice of radius r centred on +y, c is the sine and cosine of half its angle.\n"
+		"float sdpie(vec2 p, vec2 c, float r) {\n"
+		"	p.x = abs(p.x);\n"
+		"	float l = length(p) - r;\n"
+		"	float m = length(p - c*clamp(dot(p,c),0.0,r));\n"
+		"	return max(l, m*sign(c.y*p.x - c.x*p.y));\n"
+		"}\n"
+		"float scissorMask(vec2 p) {\n"
+		"	vec2 sc = (abs((scissorMat * vec3(p,1.0)).xy) - scissorExt);\n"
+		"	sc = vec2(0.5,0.5) - sc * scissorScale;\n"
+		"	return clamp(sc.x,0.0,1.0) * clamp(sc.y,0.0,1.0);\n"
+		"}\n"
+		"\n"
+		"void main(void) {\n"
+		"	float d;\n"
+		"	if (fshape.x < 0.5) {		// Rounded rect\n"
+		"		d = sdroundrect(flocal, fshape.yz, fshape.w);\n"
+		"		if (fstroke.x > 0.0) d = abs(d) - fstroke.x;\n"
+		"	} else if (fstroke.x > 0.0) {	// Arc, the ring cut by the pie slice, which makes butt caps\n"
+		"		d = max(abs(length(flocal) - fshape.y) - fstroke.x, sdpie(flocal, fshape.zw, fshape.y + fstroke.x + 2.0*fstroke.y));\n"
+		"	} else {					// Pie slice\n"
+		"		d = sdpie(flocal, fshape.zw, fshape.y);\n"
+		"	}\n"
+		"	float coverage = clamp(0.5 - d/fstroke.y, 0.0, 1.0);\n"
+		"	vec4 result = fcolor * (coverage * scissorMask(fpos));\n"
+		"#ifdef NANOVG_GL3\n"
+		"	outColor = result;\n"
+		"#else\n"
+		"	gl_FragColor = result;\n"
+		"#endif\n"
+		"}\n";
+
 	glnvg__checkError(gl, "init");
 
 	if (gl->flags & NVG_ANTIALIAS) {
@@ -690,15 +826,32 @@ static int glnvg__renderCreate(void* uptr)
 	glnvg__checkError(gl, "uniform locations");
 	glnvg__getUniforms(&gl->shader);
 
+	// Without the shape shader, nvgShapeRoundedRect() and nvgShapeArc() return 0 and paths are drawn instead
+	if (glnvg__createShader(&gl->shapeShader, "shape", shaderHeader, NULL, shapeVertShader, shapeFragShader)) {
+		glnvg__getUniforms(&gl->shapeShader);
+	} else {
+		glnvg__deleteShader(&gl->shapeShader);
+		memset(&gl->shapeShader, 0, sizeof(gl->shapeShader));
+	}
+
 	// Create dynamic vertex array
 #if defined NANOVG_GL3
 	glGenVertexArrays(1, &gl->vertArr);
 #endif
 	glGenBuffers(1, &gl->vertBuf);
 
+	if (gl->shapeShader.prog != 0) {
+#if defined NANOVG_GL3
+		glGenVertexArrays(1, &gl->shapeArr);
+#endif
+		glGenBuffers(1, &gl->shapeBuf);
+	}
+
 #if NANOVG_GL_USE_UNIFORMBUFFER
 	// Create UBOs
 	glUniformBlockBinding(gl->shader.prog, gl->shader.loc[GLNVG_LOC_FRAG], GLNVG_FRAG_BINDING);
+	if (gl->shapeShader.prog != 0)
+		glUniformBlockBinding(gl->shapeShader.prog, gl->shapeShader.loc[GLNVG_LOC_FRAG], GLNVG_FRAG_BINDING);
 	glGenBuffers(1, &gl->fragBuf);
 	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &align);
 #endif
@@ -957,13 +1110,16 @@ static int glnvg__convertPaint(GLNVGcontext* gl, GLNVGfragUniforms* frag, NVGpai
 		if (tex->type == NVG_TEXTURE_RGBA)
 			frag->texType = (tex->flags & NVG_IMAGE_PREMULTIPLIED) ? 0 : 1;
 		else
-			frag->texType = 2;
+			frag->texType = (tex->flags & NVG_IMAGE_SDF) ? 3 : 2;
 		#else
 		if (tex->type == NVG_TEXTURE_RGBA)
 			frag->texType = (tex->flags & NVG_IMAGE_PREMULTIPLIED) ? 0.0f : 1.0f;
 		else
-			frag->texType = 2.0f;
+			frag->texType = (tex->flags & NVG_IMAGE_SDF) ? 3.0f : 2.0f;
 		#endif
+		// A distance field is thresholded with feather as the half width of the edge
+		if (tex->flags & NVG_IMAGE_SDF)
+			frag->feather = paint->feather;
 //		printf("frag->texType = %d\n", frag->texType);
 	} else {
 		frag->type = NSVG_SHADER_FILLGRAD;
@@ -1124,8 +1280,53 @@ static void glnvg__triangles(GLNVGcontext* gl, GLNVGcall* call)
 	glDrawArrays(GL_TRIANGLES, call->triangleOffset, call->triangleCount);
 }
 
+// Draws a run of analytic shapes with the shape program, then goes back to the path program for the calls after them.
+static void glnvg__shapes(GLNVGcontext* gl, GLNVGcall* call)
+{
+	glUseProgram(gl->shapeShader.prog);
+#if defined NANOVG_GL3
+	glBindVertexArray(gl->shapeArr);
+#endif
+	glBindBuffer(GL_ARRAY_BUFFER, gl->shapeBuf);
+	glEnableVertexAttribArray(0);
+	glEnableVertexAttribArray(1);
+	glEnableVertexAttribArray(2);
+	glEnableVertexAttribArray(3);
+	glEnableVertexAttribArray(4);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(NVGshapeVertex), (const GLvoid*)(size_t)0);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(NVGshapeVertex), (const GLvoid*)(2*sizeof(float)));
+	glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(NVGshapeVertex), (const GLvoid*)(4*sizeof(float)));
+	glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(NVGshapeVertex), (const GLvoid*)(8*sizeof(float)));
+	glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(NVGshapeVertex), (const GLvoid*)(10*sizeof(float)));
+	glUniform2fv(gl->shapeShader.loc[GLNVG_LOC_VIEWSIZE], 1, gl->view);
+
+#if NANOVG_GL_USE_UNIFORMBUFFER
+	glBindBufferRange(GL_UNIFORM_BUFFER, GLNVG_FRAG_BINDING, gl->fragBuf, call->uniformOffset, sizeof(GLNVGfragUniforms));
+#else
+	glUniform4fv(gl->shapeShader.loc[GLNVG_LOC_FRAG], NANOVG_GL_UNIFORMARRAY_SIZE, &(nvg__fragUniformPtr(gl, call->uniformOffset)->uniformArray[0][0]));
+#endif
+
+	// A transform that mirrors would turn the quads around
+	glDisable(GL_CULL_FACE);
+	glDrawArrays(GL_TRIANGLES, call->triangleOffset, call->triangleCount);
+	glEnable(GL_CULL_FACE);
+	glnvg__checkError(gl, "shapes");
+
+	glDisableVertexAttribArray(2);
+	glDisableVertexAttribArray(3);
+	glDisableVertexAttribArray(4);
+	glUseProgram(gl->shader.prog);
+#if defined NANOVG_GL3
+	glBindVertexArray(gl->vertArr);
+#endif
+	glBindBuffer(GL_ARRAY_BUFFER, gl->vertBuf);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(NVGvertex), (const GLvoid*)(size_t)0);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(NVGvertex), (const GLvoid*)(0 + 2*sizeof(float)));
+}
+
 static void glnvg__renderCancel(void* uptr) {
 	GLNVGcontext* gl = (GLNVGcontext*)uptr;
+	gl->nshapeVerts = 0;
 	gl->nverts = 0;
 	gl->npaths = 0;
 	gl->ncalls = 0;
@@ -1216,6 +1417,12 @@ static void glnvg__renderFlush(void* uptr)
 		glBufferData(GL_UNIFORM_BUFFER, gl->nuniforms * gl->fragSize, gl->uniforms, GL_STREAM_DRAW);
 #endif
 
+		// Upload the shapes' vertices, which have their own buffer and layout
+		if (gl->nshapeVerts > 0) {
+			glBindBuffer(GL_ARRAY_BUFFER, gl->shapeBuf);
+			glBufferData(GL_ARRAY_BUFFER, gl->nshapeVerts * sizeof(NVGshapeVertex), gl->shapeVerts, GL_STREAM_DRAW);
+		}
+
 		// Upload vertex data
 #if defined NANOVG_GL3
 		glBindVertexArray(gl->vertArr);
@@ -1246,6 +1453,8 @@ static void glnvg__renderFlush(void* uptr)
 				glnvg__stroke(gl, call);
 			else if (call->type == GLNVG_TRIANGLES)
 				glnvg__triangles(gl, call);
+			else if (call->type == GLNVG_SHAPES)
+				glnvg__shapes(gl, call);
 		}
 
 		glDisableVertexAttribArray(0);
@@ -1260,6 +1469,7 @@ static void glnvg__renderFlush(void* uptr)
 	}
 
 	// Reset calls
+	gl->nshapeVerts = 0;
 	gl->nverts = 0;
 	gl->npaths = 0;
 	gl->ncalls = 0;
@@ -1526,6 +1736,72 @@ error:
 	if (gl->ncalls > 0) gl->ncalls--;
 }
 
+static int glnvg__allocShapeVerts(GLNVGcontext* gl, int n)
+{
+	int ret = 0;
+	if (gl->nshapeVerts+n > gl->cshapeVerts) {
+		NVGshapeVertex* verts;
+		int cverts = glnvg__maxi(gl->nshapeVerts + n, 1024) + gl->cshapeVerts/2; // 1.5x Overallocate
+		verts = (NVGshapeVertex*)realloc(gl->shapeVerts, sizeof(NVGshapeVertex) * cverts);
+		if (verts == NULL) return -1;
+		gl->shapeVerts = verts;
+		gl->cshapeVerts = cverts;
+	}
+	ret = gl->nshapeVerts;
+	gl->nshapeVerts += n;
+	return ret;
+}
+
+static int glnvg__renderShapes(void* uptr, NVGcompositeOperationState compositeOperation, NVGscissor* scissor,
+							   const NVGshapeVertex* verts, int nverts, float fringe)
+{
+	GLNVGcontext* gl = (GLNVGcontext*)uptr;
+	GLNVGblend blend;
+	GLNVGcall* call;
+	GLNVGfragUniforms* frag;
+	NVGpaint paint;
+	int offset;
+
+	if (gl->shapeShader.prog == 0) return 0;
+
+	blend = glnvg__blendCompositeOperation(compositeOperation);
+	offset = glnvg__allocShapeVerts(gl, nverts);
+	if (offset == -1) return 0;
+	memcpy(&gl->shapeVerts[offset], verts, sizeof(NVGshapeVertex) * nverts);
+
+	// Shapes straight after shapes with the same scissor and blending join their call, their vertices follow on
+	call = gl->ncalls > 0 ? &gl->calls[gl->ncalls-1] : NULL;
+	if (call != NULL && call->type == GLNVG_SHAPES && memcmp(&call->blendFunc, &blend, sizeof(blend)) == 0
+		&& memcmp(&gl->shapeScissor, scissor, sizeof(NVGscissor)) == 0) {
+		call->triangleCount += nverts;
+		return 1;
+	}
+
+	call = glnvg__allocCall(gl);
+	if (call == NULL) goto error;
+
+	call->type = GLNVG_SHAPES;
+	call->blendFunc = blend;
+	call->triangleOffset = offset;
+	call->triangleCount = nverts;
+	gl->shapeScissor = *scissor;
+
+	// Only the scissor is used from the uniforms
+	call->uniformOffset = glnvg__allocFragUniforms(gl, 1);
+	if (call->uniformOffset == -1) goto error;
+	frag = nvg__fragUniformPtr(gl, call->uniformOffset);
+	memset(&paint, 0, sizeof(paint));
+	nvgTransformIdentity(paint.xform);
+	glnvg__convertPaint(gl, frag, &paint, scissor, 1.0f, fringe, -1.0f);
+
+	return 1;
+
+error:
+	if (gl->ncalls > 0 && gl->calls[gl->ncalls-1].type == GLNVG_SHAPES && gl->calls[gl->ncalls-1].triangleOffset == offset) gl->ncalls--;
+	gl->nshapeVerts = offset;
+	return 0;
+}
+
 static void glnvg__renderDelete(void* uptr)
 {
 	GLNVGcontext* gl = (GLNVGcontext*)uptr;
@@ -1533,6 +1809,13 @@ static void glnvg__renderDelete(void* uptr)
 	if (gl == NULL) return;
 
 	glnvg__deleteShader(&gl->shader);
+	glnvg__deleteShader(&gl->shapeShader);
+	if (gl->shapeBuf != 0)
+		glDeleteBuffers(1, &gl->shapeBuf);
+#if defined NANOVG_GL3
+	if (gl->shapeArr != 0)
+		glDeleteVertexArrays(1, &gl->shapeArr);
+#endif
 
 #if NANOVG_GL3
 #if NANOVG_GL_USE_UNIFORMBUFFER
@@ -1553,6 +1836,7 @@ static void glnvg__renderDelete(void* uptr)
 
 	free(gl->paths);
 	free(gl->verts);
+	free(gl->shapeVerts);
 	free(gl->uniforms);
 	free(gl->calls);
 
@@ -1589,6 +1873,7 @@ NVGcontext* nvgCreateGLES3(int flags)
 	params.renderStroke = glnvg__renderStroke;
 	params.renderTriangles = glnvg__renderTriangles;
 	params.renderDelete = glnvg__renderDelete;
+	params.renderShapes = glnvg__renderShapes;
 	params.userPtr = gl;
 	params.edgeAntiAlias = flags & NVG_ANTIALIAS ? 1 : 0;
 
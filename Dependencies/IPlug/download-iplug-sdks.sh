@@ -1,6 +1,7 @@
 #!/usr/bin/env bash
 
 rm -r VST3_SDK
+rm -r CLAP_SDK
 rm -r WAM_AWP
 rm -r WAM_SDK
 git clone https://github.com/iplug2/audioworklet-polyfill WAM_AWP
@@ -13,6 +14,8 @@ git submodule update --init base
 git submodule update --init public.sdk
 git submodule update --init doc
 cd ..
+git clone https://github.com/free-audio/clap.git CLAP_SDK
 git checkout ./VST3_SDK/README.md
+git checkout ./CLAP_SDK/README.md
 git checkout ./WAM_SDK/readme.txt
 git checkout ./WAM_AWP/readme.txt
\ No newline at end of file
@@ -55,7 +55,7 @@ public:
   void ProcessBlock(sample** inputs, sample** outputs, int nFrames) override;
   void OnIdle() override;
 private:
-  IBufferSender<2> mScopeSender;
+  IBufferFrameSender<2> mScopeSender;
   IBufferSender<1> mDisplaySender;
   IPeakSender<2> mMeterSender;
   ISender<1> mRTTextSender;
@@ -13,62 +13,55 @@ void IPlugConvoEngine::ProcessBlock(sample** inputs, sample** outputs, int nFram
 {
   sample* inputL = inputs[0];
   sample* outputL = outputs[0];
-  
-  mEngine.Add(inputs, nFrames, 1);
+  sample* pWet = mWet.Get();
 
-  int nAvailableSamples = std::min(mEngine.Avail(nFrames), nFrames);
+  // the engine outputs silence until its latency has passed, so there is no need to check what is available
+  mEngine.ProcessBlock(inputs, &pWet, nFrames);
 
   const sample dryGain = GetParam(kParamDry)->Value();
   const sample wetGain = GetParam(kParamWet)->Value();
 
-  // If not enough samples are available yet, then only output the dry signal
-  for (auto i = 0; i < nFrames - nAvailableSamples; ++i)
+  // Apply the dry/wet mix
+  for (auto i = 0; i < nFrames; ++i)
   {
-    *outputL++ = dryGain * *inputL++;
-  }
-
-  // Output samples from the convolution engine
-  if (nAvailableSamples > 0)
-  {
-    // Apply the dry/wet mix
-    WDL_FFT_REAL* pWetSignal = mEngine.Get()[0];
-    for (auto i = 0; i < nAvailableSamples; ++i)
-    {
-      *outputL++ = dryGain * *inputL++ + wetGain * *pWetSignal++;
-    }
-
-    // Remove the sample block from the convolution engine's buffer
-    mEngine.Advance(nAvailableSamples);
+    outputL[i] = dryGain * inputL[i] + wetGain * pWet[i];
   }
 }
 
 void IPlugConvoEngine::OnReset()
 {
-  if (GetSampleRate() != mSampleRate)
+  if (GetSampleRate() != mSampleRate || GetBlockSize() != mBlockSize)
   {
     mSampleRate = GetSampleRate();
+    mBlockSize = GetBlockSize();
+    mWet.Resize(mBlockSize);
+    mEngine.Reset(1, mBlockSize);
 
-    static constexpr int irLength = sizeof(mIR) / sizeof(mIR[0]);
-    static constexpr double irSampleRate = 44100.;
-    mImpulse.SetNumChannels(1);
+    // Resample the impulse response on the engine's loader thread, which is also how a newly chosen impulse would be loaded while playing.
+    mEngine.LoadImpulse([this](WDL_ImpulseBuffer& impulse) {
+      static constexpr int irLength = sizeof(mIR) / sizeof(mIR[0]);
+      static constexpr double irSampleRate = 44100.;
+      impulse.SetNumChannels(1);
 
 #if defined USE_WDL_RESAMPLER
-    mResampler.SetMode(false, 0, true); // Sinc, default size
-    mResampler.SetFeedMode(true); // Input driven
+      mResampler.SetMode(false, 0, true); // Sinc, default size
+      mResampler.SetFeedMode(true); // Input driven
 #elif defined USE_R8BRAIN
-    mResampler = std::make_unique<CDSPResampler16IR>(irSampleRate, mSampleRate, mBlockLength);
+      mResampler = std::make_unique<CDSPResampler16IR>(irSampleRate, mSampleRate, mBlockLength);
 #endif
 
-    // Resample the impulse response.
-    auto len = mImpulse.SetLength(ResampleLength(irLength, irSampleRate, mSampleRate));
-    if (len)
-    {
-      Resample(mIR, irLength, irSampleRate, mImpulse.impulses[0].Get(), len, mSampleRate);
-    }
-    
-    // Tie the impulse response to the convolution engine.
-    mEngine.SetImpulse(&mImpulse);
-    
+      auto len = impulse.SetLength(ResampleLength(irLength, irSampleRate, mSampleRate));
+      if (len)
+      {
+        Resample(mIR, irLength, irSampleRate, impulse.impulses[0].Get(), len, mSampleRate);
+      }
+
+      return len > 0;
+    });
+
+    // Wait for it here, so that rendering starts with the impulse in place.
+    mEngine.WaitUntilLoaded();
+
     SetLatency(mEngine.GetLatency());
   }
 }
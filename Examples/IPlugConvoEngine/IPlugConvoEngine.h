@@ -9,7 +9,7 @@
   #define WDL_FFT_REALSIZE 8
 #endif
 
-#include "convoengine.h"
+#include "PartitionedConvolution.h"
 
 #if defined USE_WDL_RESAMPLER
   #include "resample.h"
@@ -48,9 +48,7 @@ private:
   
   static const float mIR[512];
 
-  WDL_ImpulseBuffer mImpulse;
-//  WDL_ConvolutionEngine_Div mEngine; // < low latency version
-  WDL_ConvolutionEngine mEngine;
+  WDL_TypedBuf<sample> mWet;
   
   static constexpr int mBlockLength = 64;
 
@@ -61,5 +59,9 @@ private:
   #endif
 
   double mSampleRate = 0.0;
+  int mBlockSize = 0;
+
+  // last, so that the loader thread is stopped before the resampler it uses is destroyed
+  CrossfadingConvolutionEngine mEngine; // the head on the audio thread, long tails on worker threads, impulses loaded in the background
 #endif
 };
@@ -50,7 +50,31 @@ public:
       mAMPEnv.Release();
     }
 
+    float GetLevel() const override
+    {
+      return static_cast<float>(std::fabs(mAMPEnv.GetPrevOutput()) * mGain);
+    }
+
+    void Kill() override
+    {
+      mAMPEnv.Kill(true);
+    }
+
     void ProcessSamplesAccumulating(T** inputs, T** outputs, int nInputs, int nOutputs, int startIdx, int nFrames) override
+    {
+      T* pVoiceOutput = mVoiceBuffer.Get();
+      Render(inputs, pVoiceOutput, startIdx, nFrames);
+
+      // make sound output for each output channel
+      for(auto i = 0; i < nFrames; i++)
+      {
+        outputs[0][startIdx + i] += pVoiceOutput[i];
+        outputs[1][startIdx + i] = outputs[0][startIdx + i];
+      }
+    }
+
+    /** Render this voice's mono output for a block into pDest, starting at pDest[0]. Used both by ProcessSamplesAccumulating() and the VoiceBank */
+    void Render(T** inputs, T* pDest, int startIdx, int nFrames)
     {
       // inputs to the synthesizer can just fetch a value every block, like this:
 //      double gate = mInputs[kVoiceControlGate].endValue;
@@ -62,14 +86,16 @@ public:
       
       // convert from "1v/oct" pitch space to frequency in Hertz
       double osc1Freq = 440. * pow(2., pitch + pitchBend + inputs[kModLFO][0]);
-      
-      // make sound output for each output channel
-      for(auto i = startIdx; i < startIdx + nFrames; i++)
+
+      // the frequency is constant over the block, so render the oscillator in one go
+      mOSC.SetFreqCPS(osc1Freq);
+      mOSC.ProcessBlock(pDest, nFrames);
+
+      for(auto i = 0; i < nFrames; i++)
       {
-        float noise = mTimbreBuffer.Get()[i] * Rand();
+        float noise = mTimbreBuffer.Get()[startIdx + i] * Rand();
         // an MPE synth can use pressure here in addition to gain
-        outputs[0][i] += (mOSC.Process(osc1Freq) + noise) * mAMPEnv.Process(inputs[kModSustainSmoother][i]) * mGain;
-        outputs[1][i] = outputs[0][i];
+        pDest[i] = (pDest[i] + noise) * mAMPEnv.Process(inputs[kModSustainSmoother][startIdx + i]) * mGain;
       }
     }
 
@@ -79,6 +105,7 @@ public:
       mAMPEnv.SetSampleRate(sampleRate);
       
       mTimbreBuffer.Resize(blockSize);
+      mVoiceBuffer.Resize(blockSize);
     }
 
     void SetProgramNumber(int pgm) override
@@ -98,6 +125,7 @@ public:
 
   private:
     WDL_TypedBuf<float> mTimbreBuffer;
+    WDL_TypedBuf<T> mVoiceBuffer;
 
     // noise generator for test
     uint32_t mRandSeed = 0;
@@ -112,6 +140,58 @@ public:
 
   };
 
+#pragma mark - VoiceBank
+  /** Renders the busy voices kLanes at a time into lane buffers, then sums each group of lanes into the output with a single pass,
+   * instead of every voice accumulating into the output separately */
+  class VoiceBank : public SynthVoiceBank
+  {
+  public:
+    static constexpr int kLanes = 4;
+
+    void ProcessVoicesAccumulating(SynthVoice* const* voices, int nVoices, T** inputs, T** outputs, int nInputs, int nOutputs, int startIdx, int nFrames) override
+    {
+      T* pOutput = outputs[0] + startIdx;
+
+      for (auto v = 0; v < nVoices; v += kLanes)
+      {
+        const int nLanes = std::min(kLanes, nVoices - v);
+        T* pLanes[kLanes];
+
+        for (auto l = 0; l < kLanes; l++)
+        {
+          pLanes[l] = mLaneData.Get() + (l * mBlockSize);
+
+          if (l < nLanes)
+            static_cast<Voice*>(voices[v + l])->Render(inputs, pLanes[l], startIdx, nFrames);
+          else
+            memset(pLanes[l], 0, nFrames * sizeof(T));
+        }
+
+        const T* pL0 = pLanes[0];
+        const T* pL1 = pLanes[1];
+        const T* pL2 = pLanes[2];
+        const T* pL3 = pLanes[3];
+
+        for (auto i = 0; i < nFrames; i++)
+        {
+          pOutput[i] += (pL0[i] + pL1[i]) + (pL2[i] + pL3[i]);
+        }
+      }
+
+      memcpy(outputs[1] + startIdx, pOutput, nFrames * sizeof(T));
+    }
+
+    void SetSampleRateAndBlockSize(double sampleRate, int blockSize) override
+    {
+      mBlockSize = blockSize;
+      mLaneData.Resize(kLanes * blockSize);
+    }
+
+  private:
+    WDL_TypedBuf<T> mLaneData;
+    int mBlockSize = 0;
+  };
+
 public:
 #pragma mark -
   IPlugInstrumentDSP(int nVoices)
@@ -122,6 +202,13 @@ public:
       mSynth.AddVoice(new Voice(), 0);
     }
 
+    // render the voices in lanes, rather than one at a time
+    mSynth.SetVoiceBank(&mVoiceBank);
+
+    // steal the least audible voice, and stop rendering release tails below -90dB
+    mSynth.SetStealMode(VoiceAllocator::kStealModeQuietest);
+    mSynth.SetSilenceThreshold(static_cast<float>(DBToAmp(-90.)));
+
     // some MidiSynth API examples:
     // mSynth.SetKeyToPitchFn([](int k){return (k - 69.)/24.;}); // quarter-tone scale
     // mSynth.SetNoteGlideTime(0.5); // portamento
@@ -212,6 +299,7 @@ public:
   
 public:
   MidiSynth mSynth { VoiceAllocator::kPolyModePoly, MidiSynth::kDefaultBlockSize };
+  VoiceBank mVoiceBank;
   WDL_TypedBuf<T> mModulationsData; // Sample data for global modulations (e.g. smoothed sustain)
   WDL_PtrList<T> mModulations; // Ptrlist for global modulations
   LogParamSmooth<T, kNumModulations> mParamSmoother;
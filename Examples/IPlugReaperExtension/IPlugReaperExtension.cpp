@@ -69,7 +69,8 @@ IPlugReaperExtension::IPlugReaperExtension(reaper_plugin_info_t* pRec)
 
 void IPlugReaperExtension::OnIdle()
 {
-  int tracks = CountTracks(0);
+  // the snapshot is only rebuilt when the project changes, rather than querying Reaper every tick
+  int tracks = static_cast<int>(GetProjectSnapshot(false)->mTracks.size());
   
   if(tracks != mPrevTrackCount) {
     mPrevTrackCount = tracks;
@@ -36,10 +36,13 @@ IPlugResponsiveUI::IPlugResponsiveUI(const InstanceInfo& info)
       }
     };
 
-    // Layout controls on resize
+    // Layout controls on resize, only resizing the controls whose bounds change
     if(pGraphics->NControls()) {
       for (int ctrlIdx = 0; ctrlIdx < pGraphics->NControls(); ctrlIdx++) {
-        pGraphics->GetControl(ctrlIdx)->SetTargetAndDrawRECTs(GetBounds(ctrlIdx, b));
+        IControl* pControl = pGraphics->GetControl(ctrlIdx);
+        const IRECT bounds = GetBounds(ctrlIdx, b);
+        if (bounds != pControl->GetRECT())
+          pControl->SetTargetAndDrawRECTs(bounds);
       }
       return;
     }
@@ -59,6 +59,7 @@ void IPlugSOUL::ProcessBlock(sample** inputs, sample** outputs, int nFrames)
     mSOULParams[paramIdx].setValue(GetParam(paramIdx)->Value());
   }
   
+  // the endpoints are bound straight to IPlug's buffers, render() overwrites the outputs so they don't need clearing
   if constexpr (DSP::numAudioInputChannels > 0) {
     for (auto i=0; i<DSP::numAudioInputChannels; i++) {
       renderCtx.inputChannels[i] = inputs[i];
@@ -66,20 +67,23 @@ void IPlugSOUL::ProcessBlock(sample** inputs, sample** outputs, int nFrames)
   }
   
   for (auto i=0; i<DSP::numAudioOutputChannels; i++) {
-    memset(outputs[i], 0, nFrames * sizeof(sample));
     renderCtx.outputChannels[i] = outputs[i];
   }
   
   renderCtx.numFrames = nFrames;
   
-  mDSP.setTempo(GetTempo());
-  mDSP.setPosition(mTimeInfo.mSamplePos, mTimeInfo.mPPQPos, mTimeInfo.mLastBar);
-  mDSP.setTimeSignature(mTimeInfo.mNumerator, mTimeInfo.mDenominator);
-  mDSP.setTransportState(mTimeInfo.mTransportIsRunning ? 1 : 0);
+  if constexpr (DSP::hasTimelineEndpoints) {
+    mDSP.setTempo(GetTempo());
+    mDSP.setPosition(mTimeInfo.mSamplePos, mTimeInfo.mPPQPos, mTimeInfo.mLastBar);
+    mDSP.setTimeSignature(mTimeInfo.mNumerator, mTimeInfo.mDenominator);
+    mDSP.setTransportState(mTimeInfo.mTransportIsRunning ? 1 : 0);
+  }
   
-  if(mIncomingMIDIMessages.size()) {
-    renderCtx.incomingMIDI.messages = std::addressof (mIncomingMIDIMessages[0]);
-    renderCtx.incomingMIDI.numMessages = static_cast<uint32_t>(mIncomingMIDIMessages.size());
+  if constexpr (DSP::hasMIDIInput) {
+    if(mIncomingMIDIMessages.size()) {
+      renderCtx.incomingMIDI.messages = std::addressof (mIncomingMIDIMessages[0]);
+      renderCtx.incomingMIDI.numMessages = static_cast<uint32_t>(mIncomingMIDIMessages.size());
+    }
   }
   
   mDSP.render(renderCtx);
@@ -88,13 +92,30 @@ void IPlugSOUL::ProcessBlock(sample** inputs, sample** outputs, int nFrames)
 
 void IPlugSOUL::ProcessMidiMsg(const IMidiMsg& msg)
 {
-  mIncomingMIDIMessages.push_back({static_cast<uint32_t>(msg.mOffset), msg.mStatus, msg.mData1, msg.mData2});
+  // drop messages rather than allocate on the audio thread
+  if constexpr (DSP::hasMIDIInput) {
+    if(mIncomingMIDIMessages.size() < mIncomingMIDIMessages.capacity())
+      mIncomingMIDIMessages.push_back({static_cast<uint32_t>(msg.mOffset), msg.mStatus, msg.mData1, msg.mData2});
+  }
 }
 
 void IPlugSOUL::OnReset()
 {
-  mDSP.init(GetSampleRate(), mSessionID++);
-  mIncomingMIDIMessages.reserve(GetBlockSize());
+  // init() runs the processor's initialisation code, at the same sample rate restoring the state it left is enough
+  if (GetSampleRate() != mInitSampleRate) {
+    mDSP.init(GetSampleRate(), mSessionID++);
+    mInitSampleRate = GetSampleRate();
+  }
+  else {
+    mDSP.reset();
+  }
+  
+  // both clear the parameter events, so send the current values again
+  for (auto i=0; i<DSP::numParameters; i++) {
+    mSOULParams[i].setValue(GetParam(i)->Value());
+  }
+  
+  mIncomingMIDIMessages.reserve(std::max(GetBlockSize(), kMinMIDIMessages));
 }
 
 void IPlugSOUL::OnParamChange(int paramIdx)
@@ -21,8 +21,10 @@ public:
   void OnReset() override;
   void OnParamChange(int paramIdx) override;
 private:
+  static constexpr int kMinMIDIMessages = 256;
   DSP mDSP;
   int mSessionID = 0;
+  double mInitSampleRate = 0.;
   IPlugQueue<int> mParamsToUpdate {DSP::numParameters};
   std::vector<DSP::Parameter> mSOULParams;
   std::vector<DSP::MIDIMessage> mIncomingMIDIMessages;
@@ -20,6 +20,22 @@ function SAMFD(msgTag, dataSize, msg) {
   console.log("SAMFD msgTag:" + msgTag + " msg:" + msg);
 }
 
+// Batched messages, if the delegate has EnableMessageBatching(true). Each message is [functionName, args...]
+function IPlugBatchFD(msgs) {
+  for (var i = 0; i < msgs.length; i++) {
+    var func = window[msgs[i][0]];
+
+    if (typeof func === 'function')
+      func.apply(null, msgs[i].slice(1));
+  }
+}
+
+// Binary messages, if the delegate has EnableBinaryMessages(true). The buffer is only valid during this call
+function SBMFD(info, buffer) {
+  var data = new Uint8Array(buffer, 0, info.dataSize);
+  console.log(info.msg + " binary message of " + data.length + " bytes");
+}
+
 function SMMFD(statusByte, dataByte1, dataByte2) {
   console.log("Got MIDI Message" + status + ":" + dataByte1 + ":" + dataByte2);
 }
@@ -533,8 +533,7 @@ IVKnobControl::IVKnobControl(const IRECT& bounds, IActionFunction aF, const char
 
 void IVKnobControl::Draw(IGraphics& g)
 {
-  DrawBackground(g, mRECT);
-  DrawLabel(g);
+  DrawStaticLayer(g);
   DrawWidget(g);
   DrawValue(g, mValueMouseOver);
 }
@@ -691,8 +690,7 @@ IVSliderControl::IVSliderControl(const IRECT& bounds, IActionFunction aF, const
 
 void IVSliderControl::Draw(IGraphics& g)
 {
-  DrawBackground(g, mRECT);
-  DrawLabel(g);
+  DrawStaticLayer(g);
   DrawWidget(g);
   DrawValue(g, mValueMouseOver);
 }
@@ -1195,9 +1193,7 @@ void IVGroupControl::SetBoundsBasedOnGroup(const char* groupName, float padL, fl
   GetUI()->ForControlInGroup(mGroupName.Get(), [&unionRect](IControl* pControl) { unionRect = unionRect.Union(pControl->GetRECT()); });
   float halfLabelHeight = mLabelBounds.H()/2.f;
   unionRect.GetVPadded(halfLabelHeight);
-  mRECT = unionRect.GetPadded(padL, padT, padR, padB);
-  
-  OnResize();
+  SetRECT(unionRect.GetPadded(padL, padT, padR, padB));
 }
 
 IVColorSwatchControl::IVColorSwatchControl(const IRECT& bounds, const char* label, ColorChosenFunc func, const IVStyle& style, ECellLayout layout,
@@ -24,6 +24,9 @@
 #include "IVMultiSliderControl.h"
 #include "IRTTextControl.h"
 #include "IVDisplayControl.h"
+#include "IVScrollingDisplayControl.h"
+#include "IVSpectrumAnalyzerControl.h"
+#include "IGPUShaderControl.h"
 #include "ILEDControl.h"
 #include "IPopupMenuControl.h"
 
@@ -0,0 +1,160 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @ingroup IControls
+ * @copydoc IGPUShaderControl
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "IControl.h"
+#include "ISender.h"
+
+BEGIN_IPLUG_NAMESPACE
+BEGIN_IGRAPHICS_NAMESPACE
+
+/** A control that draws a fragment shader on the GPU, with NanoVG on GL or Metal and with Skia, for meters and visualisers that are drawn entirely by the GPU.
+ * The shader is given in each back end's language, see IShaderSource, and only the one for the back end in use needs to be set.
+ * The shader is drawn into a layer, which is only drawn again when the uniforms change or the control is resized, so a shader that shows data runs once per new data, not once per frame.
+ * The uniforms can be set with SetUniforms(), or straight from the ISenderData<MAXNC, T> that an ISender or IFrameSender sends to the control's tag,
+ * which is copied into uData with the values of channel c from c * kValuesPerChannel
+ * @ingroup IControls */
+template <int MAXNC = 1, typename T = float>
+class IGPUShaderControl : public IControl
+{
+public:
+  static_assert(sizeof(T) % sizeof(float) == 0, "The sender data must be floats, e.g. float or std::array<float, N>");
+  static constexpr int kValuesPerChannel = static_cast<int>(sizeof(T) / sizeof(float));
+
+  /** Constructs an IGPUShaderControl
+   * @param bounds The rectangular area that the control occupies
+   * @param source The shader sources, which are copied. Its mNUniforms defaults to MAXNC * kValuesPerChannel if it is 0 */
+  IGPUShaderControl(const IRECT& bounds, const IShaderSource& source)
+  : IControl(bounds)
+  , mGLSL(source.mGLSL ? source.mGLSL : "")
+  , mMSL(source.mMSL ? source.mMSL : "")
+  , mSkSL(source.mSkSL ? source.mSkSL : "")
+  , mUniforms(source.mNUniforms > 0 ? source.mNUniforms : MAXNC * kValuesPerChannel, 0.f)
+  {
+    mIgnoreMouse = true;
+  }
+
+  void Draw(IGraphics& g) override
+  {
+    if (!mShader && !mCompileFailed)
+      CompileShader(g);
+
+    if (!mShader)
+      return;
+
+    if (mUniformsChanged || !g.CheckLayer(mLayer))
+    {
+      g.StartLayer(this, mRECT);
+      g.DrawAPIShader(mShader.get(), mRECT, mUniforms.data());
+      mLayer = g.EndLayer();
+      mUniformsChanged = false;
+    }
+
+    g.DrawLayer(mLayer, &mBlend);
+  }
+
+  void OnResize() override
+  {
+    mUniformsChanged = true;
+    SetDirty(false);
+  }
+
+  void OnMsgFromDelegate(int msgTag, int dataSize, const void* pData) override
+  {
+    if (IsDisabled() || dataSize != sizeof(ISenderData<MAXNC, T>))
+      return;
+
+    if (msgTag == ISender<>::kUpdateMessage)
+    {
+      IByteStream stream(pData, dataSize);
+      ISenderData<MAXNC, T> d;
+      stream.Get(&d, 0);
+      SetSenderData(d);
+    }
+    else if (msgTag == ISender<>::kFrameMessage)
+    {
+      SetSenderData(*static_cast<const ISenderData<MAXNC, T>*>(pData));
+    }
+  }
+
+  /** Set some of the uniforms, and draw the shader again on the next frame
+   * @param pValues The values
+   * @param nValues The number of values, which is limited to the number of uniforms
+   * @param offset The index in uData of the first value */
+  void SetUniforms(const float* pValues, int nValues, int offset = 0)
+  {
+    nValues = std::min(nValues, NUniforms() - offset);
+
+    if (offset < 0 || nValues <= 0)
+      return;
+
+    std::copy(pValues, pValues + nValues, mUniforms.begin() + offset);
+    mUniformsChanged = true;
+    SetDirty(false);
+  }
+
+  /** @return The number of floats in uData */
+  int NUniforms() const { return static_cast<int>(mUniforms.size()); }
+
+  /** @return The compiler's messages, if the shader couldn't be compiled */
+  const char* GetShaderError() const { return mError.Get(); }
+
+private:
+  void CompileShader(IGraphics& g)
+  {
+    IShaderSource source;
+    source.mGLSL = mGLSL.Get();
+    source.mMSL = mMSL.Get();
+    source.mSkSL = mSkSL.Get();
+    source.mNUniforms = NUniforms();
+
+    mShader.reset(g.CreateAPIShader(source, mError));
+
+    if (!mShader)
+    {
+      DBGMSG("IGPUShaderControl: %s\n", mError.Get());
+      mCompileFailed = true;
+    }
+  }
+
+  void SetSenderData(const ISenderData<MAXNC, T>& d)
+  {
+    for (auto c = std::max(d.chanOffset, 0); c < std::min(d.chanOffset + d.nChans, MAXNC); c++)
+    {
+      float values[kValuesPerChannel];
+      memcpy(values, &d.vals[c], sizeof(values));
+      SetUniforms(values, kValuesPerChannel, c * kValuesPerChannel);
+    }
+  }
+
+  WDL_String mGLSL;
+  WDL_String mMSL;
+  WDL_String mSkSL;
+  WDL_String mError;
+  std::vector<float> mUniforms;
+  std::unique_ptr<APIShader> mShader;
+  ILayerPtr mLayer;
+  bool mUniformsChanged = true;
+  bool mCompileFailed = false;
+};
+
+END_IGRAPHICS_NAMESPACE
+END_IPLUG_NAMESPACE
@@ -0,0 +1,158 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @ingroup SpecialControls
+ * @copydoc IMemoryStatsControl
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include "IControl.h"
+#include "IPlugMemoryStats.h"
+
+BEGIN_IPLUG_NAMESPACE
+BEGIN_IGRAPHICS_NAMESPACE
+
+/** Debug overlay listing the memory counted by the plug-in's IMemoryStats by category, the memory shared by every instance, and the instances in the process that use the most.
+ * It reads the stats about twice a second, rather than every frame, since reading them measures the presets.
+ * This is a special control that lives outside the main IGraphics control stack, see IGraphics::ShowMemoryStats().
+ * @ingroup SpecialControls */
+class IMemoryStatsControl : public IControl
+{
+public:
+  static constexpr int kMaxInstances = 5;
+  static constexpr int kNumRows = 1 + IMemoryStats::kNumCategories + 1 + 2 + kMaxInstances;
+  static constexpr float kRowHeight = 14.f;
+
+  /** @param bounds The bounds of the overlay, of which the height should be at least kNumRows * kRowHeight plus the padding
+   * @param pStats The plug-in's stats, or nullptr to only show those of the process */
+  IMemoryStatsControl(const IRECT& bounds, const IMemoryStats* pStats)
+  : IControl(bounds)
+  , mStats(pStats)
+  {
+    mIgnoreMouse = true;
+  }
+
+  bool IsDirty() override
+  {
+    // at 60 fps, twice a second
+    if (mFramesUntilUpdate-- > 0)
+      return false;
+
+    mFramesUntilUpdate = 30;
+    Update();
+    return true;
+  }
+
+  void Draw(IGraphics& g) override
+  {
+    g.FillRect(IColor(220, 0, 0, 0), mRECT);
+
+    IRECT row = mRECT.GetPadded(-4.f).GetFromTop(kRowHeight);
+
+    for (const Row& r : mRows)
+    {
+      g.DrawText(r.heading ? mHeadingText : mLabelText, r.label.Get(), row);
+      g.DrawText(mValueText, r.value.Get(), row);
+      row.Translate(0.f, kRowHeight);
+    }
+  }
+
+  /** @return A number of bytes as a string with units, e.g. "1.5 MB" */
+  static void FormatBytes(int64_t bytes, WDL_String& str)
+  {
+    const double b = static_cast<double>(bytes);
+
+    if (b >= 1024. * 1024. * 1024.)
+      str.SetFormatted(32, "%.2f GB", b / (1024. * 1024. * 1024.));
+    else if (b >= 1024. * 1024.)
+      str.SetFormatted(32, "%.1f MB", b / (1024. * 1024.));
+    else if (b >= 1024.)
+      str.SetFormatted(32, "%.1f KB", b / 1024.);
+    else
+      str.SetFormatted(32, "%d B", static_cast<int>(bytes));
+  }
+
+private:
+  struct Row
+  {
+    WDL_String label;
+    WDL_String value;
+    bool heading = false;
+  };
+
+  void AddRow(const char* label, int64_t bytes, bool heading = false)
+  {
+    mRows.emplace_back();
+    mRows.back().label.Set(label);
+    mRows.back().heading = heading;
+    FormatBytes(bytes, mRows.back().value);
+  }
+
+  void Update()
+  {
+    mRows.clear();
+
+    if (mStats)
+    {
+      WDL_String title;
+      title.SetFormatted(128, "%s #%d", mStats->GetName(), mStats->GetID());
+      AddRow(title.Get(), mStats->GetTotalBytes(), true);
+
+      for (auto c = 0; c < IMemoryStats::kNumCategories; c++)
+      {
+        const auto category = static_cast<IMemoryStats::ECategory>(c);
+        AddRow(IMemoryStats::GetCategoryName(category), mStats->GetBytes(category));
+      }
+    }
+
+    const IMemoryStats& shared = IMemoryStats::Shared();
+    AddRow("Shared bitmap cache", shared.GetBytes(IMemoryStats::kBitmaps), true);
+
+    // totals are read inside ForEach(), so that no stats are destroyed while they are read
+    std::vector<std::pair<int64_t, WDL_String>> instances;
+    int64_t processTotal = 0;
+
+    IMemoryStats::ForEach([&](const IMemoryStats& stats) {
+      const int64_t total = stats.GetTotalBytes();
+      processTotal += total;
+
+      if (&stats != &shared)
+      {
+        instances.emplace_back(total, WDL_String());
+        instances.back().second.SetFormatted(128, "%s #%d", stats.GetName(), stats.GetID());
+      }
+    });
+
+    WDL_String processLabel;
+    processLabel.SetFormatted(64, "Process, %d instances", static_cast<int>(instances.size()));
+    AddRow(processLabel.Get(), processTotal, true);
+
+    std::sort(instances.begin(), instances.end(), [](const std::pair<int64_t, WDL_String>& a, const std::pair<int64_t, WDL_String>& b) { return a.first > b.first; });
+
+    for (auto i = 0; i < std::min(static_cast<int>(instances.size()), kMaxInstances); i++)
+      AddRow(instances[i].second.Get(), instances[i].first);
+  }
+
+  const IMemoryStats* mStats;
+  std::vector<Row> mRows;
+  int mFramesUntilUpdate = 0;
+  IText mHeadingText = IText(13, COLOR_WHITE, DEFAULT_FONT, EAlign::Near, EVAlign::Middle);
+  IText mLabelText = IText(12, COLOR_LIGHT_GRAY, DEFAULT_FONT, EAlign::Near, EVAlign::Middle);
+  IText mValueText = IText(12, COLOR_WHITE, DEFAULT_FONT, EAlign::Far, EVAlign::Middle);
+};
+
+END_IGRAPHICS_NAMESPACE
+END_IPLUG_NAMESPACE
@@ -14,6 +14,9 @@
  * @ingroup SpecialControls
  */
 
+#include <algorithm>
+#include <cctype>
+
 #include "IPopupMenuControl.h"
 
 #ifdef IGRAPHICS_NANOVG
@@ -92,7 +95,7 @@ void IPopupMenuControl::Draw(IGraphics& g)
       DrawPanelShadow(g, pMenuPanel);
       DrawPanelBackground(g, pMenuPanel); 
       
-      int nItems = pMenuPanel->mMenu.NItems();
+      int nItems = pMenuPanel->NRows();
       int nCells = pMenuPanel->mCellBounds.GetSize();
       int startCell = 0;
       int endCell = nCells-1;
@@ -126,10 +129,10 @@ void IPopupMenuControl::Draw(IGraphics& g)
       for(auto i = startCell; i <= endCell; i++)
       {
         IRECT* pCellRect = pMenuPanel->mCellBounds.Get(i);
-        IPopupMenu::Item* pMenuItem = pMenuPanel->mMenu.GetItem(startCell + pMenuPanel->mScrollItemOffset + cellOffset++);
+        IPopupMenu::Item* pMenuItem = pMenuPanel->GetRowItem(startCell + pMenuPanel->mScrollItemOffset + cellOffset++);
     
         if(!pMenuItem)
-          return;
+          break; // a filtered panel has fewer rows than cells
     
         if(pMenuItem->GetIsSeparator())
           DrawSeparator(g, *pCellRect, &pMenuPanel->mBlend);
@@ -155,6 +158,9 @@ void IPopupMenuControl::Draw(IGraphics& g)
             DrawSubMenuArrow(g, *pCellRect, pMenuItem, sel, &pMenuPanel->mBlend);
         }
       }
+      
+      if(pMenuPanel->mFiltered)
+        DrawSearchText(g, pMenuPanel->mTargetRECT, pMenuPanel->GetQuery(), &pMenuPanel->mBlend);
     }
   }
   
@@ -241,19 +247,81 @@ void IPopupMenuControl::OnMouseOut()
 
 void IPopupMenuControl::OnMouseWheel(float x, float y, const IMouseMod& mod, float d)
 {
-  //FIXME:
-//  if(mActiveMenuPanel)
-//  {
-//    if(mActiveMenuPanel->mScroller)
-//    {
-//      if(d > 0.)
-//        mActiveMenuPanel->ScrollUp();
-//      else
-//        mActiveMenuPanel->ScrollDown();
-//    }
-//
-//    SetDirty(false);
-//  }
+  if(mActiveMenuPanel && mActiveMenuPanel->mScroller)
+  {
+    mActiveMenuPanel->ScrollBy(d > 0.f ? -3 : 3);
+    mMouseCellBounds = mActiveMenuPanel->HitTestCells(x, y);
+    SetDirty(false);
+  }
+}
+
+bool IPopupMenuControl::OnKeyDown(float x, float y, const IKeyPress& key)
+{
+  if(!mTypeToFilter || GetState() != kExpanded || !mActiveMenuPanel)
+    return false;
+  
+  MenuPanel* pMenuPanel = mActiveMenuPanel;
+  std::string query = pMenuPanel->GetQuery();
+  
+  switch (key.VK)
+  {
+    case kVK_ESCAPE:
+      if(query.empty())
+      {
+        mMouseCellBounds = nullptr;
+        CollapseEverything();
+        return true;
+      }
+      query.clear();
+      break;
+    case kVK_BACK:
+      while(!query.empty()) // remove the last UTF-8 character
+      {
+        const bool continuation = (static_cast<unsigned char>(query.back()) & 0xC0) == 0x80;
+        query.pop_back();
+        
+        if(!continuation)
+          break;
+      }
+      break;
+    case kVK_RETURN:
+      for(auto i = 0; i < pMenuPanel->mCellBounds.GetSize(); i++)
+      {
+        IPopupMenu::Item* pItem = pMenuPanel->GetCellItem(i);
+        
+        if(pItem && pItem->GetIsChoosable())
+        {
+          mMouseCellBounds = pMenuPanel->mCellBounds.Get(i);
+          CollapseEverything();
+          break;
+        }
+      }
+      return true;
+    default:
+      if(key.C || static_cast<unsigned char>(key.utf8[0]) < 0x20 || key.utf8[0] == 0x7F)
+        return false;
+      query += key.utf8;
+      break;
+  }
+  
+  pMenuPanel->SetQuery(query.c_str());
+  mMouseCellBounds = nullptr;
+  
+  // the cells now show other items, so close any submenu that was opened from one of them
+  const int panelIdx = mMenuPanels.Find(pMenuPanel);
+  
+  for (auto mr = 0; mr < mMenuPanels.GetSize(); mr++)
+  {
+    if(mMenuPanels.Get(mr)->mParentIdx == panelIdx)
+    {
+      mMenuPanels.Get(mr)->mShouldDraw = false;
+      mSubMenuOpened = false;
+    }
+  }
+  
+  pMenuPanel->mHighlightedCell = nullptr;
+  SetDirty(false);
+  return true;
 }
 
 void IPopupMenuControl::DrawCalloutArrow(IGraphics& g, const IRECT& bounds, IBlend* pBlend)
@@ -436,6 +504,18 @@ void IPopupMenuControl::DrawSeparator(IGraphics& g, const IRECT& bounds, IBlend*
     g.FillRect(mSeparatorColor, bounds, &BLEND_25);
 }
 
+void IPopupMenuControl::DrawSearchText(IGraphics& g, const IRECT& bounds, const char* str, IBlend* pBlend)
+{
+  IText text = mText.WithFGColor(mItemMouseoverColor).WithAlign(EAlign::Center).WithSize(mText.mSize * 0.75f);
+  IRECT textBounds;
+  g.MeasureText(text, str, textBounds);
+  
+  const float w = std::min(textBounds.W() + TEXT_HPAD * 2.f, bounds.W());
+  const IRECT badge(bounds.R - w, bounds.T, bounds.R, bounds.T + textBounds.H() + 2.f);
+  g.FillRoundRect(mCellBackGroundColor, badge, mRoundness, pBlend);
+  g.DrawText(text, str, badge, pBlend);
+}
+
 void IPopupMenuControl::CreatePopupMenu(IPopupMenu& menu, const IRECT& bounds)
 {
   mMenu = &menu;
@@ -459,19 +539,30 @@ void IPopupMenuControl::CreatePopupMenu(IPopupMenu& menu, const IRECT& bounds)
 
 IRECT IPopupMenuControl::GetLargestCellRectForMenu(IPopupMenu& menu, float x, float y) const
 {
-  IRECT span;
+  const IGraphics* pGraphics = GetUI();
+  float maxW = 0.f;
+  float maxH = 0.f;
   
   for (auto i = 0; i < menu.NItems(); ++i)
   {
-    IPopupMenu::Item* pItem = menu.GetItem(i);
-    IRECT textBounds;
+    const IPopupMenu::Item* pItem = menu.GetItem(i);
+    float w, h;
     
-    const IGraphics* pGraphics = GetUI();
+    // measuring is the slow part of opening a long menu, so each item is only measured again if its text or our font size changed
+    if (!pItem->GetMeasuredTextSize(this, mText.mSize, w, h))
+    {
+      IRECT textBounds;
+      pGraphics->MeasureText(mText, pItem->GetText(), textBounds);
+      w = textBounds.W();
+      h = textBounds.H();
+      pItem->SetMeasuredTextSize(this, mText.mSize, w, h);
+    }
     
-    pGraphics->MeasureText(mText, pItem->GetText(), textBounds);
-    span = span.Union(textBounds);
+    maxW = std::max(maxW, w);
+    maxH = std::max(maxH, h);
   }
   
+  IRECT span(0.f, 0.f, maxW, maxH);
   span.HPad(TEXT_HPAD); // add some padding because we don't want to be flush to the edges
   span.Pad(TICK_SIZE, 0, ARROW_SIZE, 0);
   
@@ -513,7 +604,11 @@ void IPopupMenuControl::CalculateMenuPanels(float x, float y)
   for(auto i = 0; i < mActiveMenuPanel->mCellBounds.GetSize(); i++)
   {
     IRECT* pCellRect = mActiveMenuPanel->mCellBounds.Get(i);
-    IPopupMenu::Item* pMenuItem = mActiveMenuPanel->mMenu.GetItem(i);
+    IPopupMenu::Item* pMenuItem = mActiveMenuPanel->GetCellItem(i);
+    
+    if(!pMenuItem)
+      continue;
+    
     IPopupMenu* pSubMenu = pMenuItem->GetSubmenu();
     
     if(pCellRect == mMouseCellBounds)
@@ -810,10 +905,10 @@ void IPopupMenuControl::CollapseEverything()
     
     if(mMouseCellBounds == pR)
     {
-      int itemChosen = mActiveMenuPanel->mScrollItemOffset + i;
-      IPopupMenu::Item* pItem = pClickedMenu->GetItem(itemChosen);
+      int itemChosen = mActiveMenuPanel->GetRowItemIdx(mActiveMenuPanel->mScrollItemOffset + i);
+      IPopupMenu::Item* pItem = mActiveMenuPanel->GetCellItem(i);
 
-      if(pItem->GetIsChoosable())
+      if(pItem && pItem->GetIsChoosable())
       {
         pClickedMenu->SetChosenItemIdx(itemChosen);
         mActiveMenuPanel->mClickedCell = pR;
@@ -1011,8 +1106,105 @@ IRECT* IPopupMenuControl::MenuPanel::HitTestCells(float x, float y) const
   for(auto i = 0; i < mCellBounds.GetSize(); i++)
   {
     IRECT* pR = mCellBounds.Get(i);
-    if(pR->Contains(x, y) && mMenu.GetItem(i)->GetEnabled())
-      return pR;
+    
+    if(pR->Contains(x, y))
+    {
+      const IPopupMenu::Item* pItem = GetCellItem(i);
+      
+      if(CellIsScrollArrow(i) || (pItem && pItem->GetEnabled()))
+        return pR;
+    }
   }
   return nullptr;
 }
+
+bool IPopupMenuControl::MenuPanel::CellIsScrollArrow(int cellIdx) const
+{
+  const int nRows = NRows();
+  const int nCells = mCellBounds.GetSize();
+  
+  if(nRows <= nCells)
+    return false;
+  
+  return (cellIdx == 0 && mScrollItemOffset > 0) || (cellIdx == nCells - 1 && mScrollItemOffset < nRows - nCells);
+}
+
+IPopupMenu::Item* IPopupMenuControl::MenuPanel::GetCellItem(int cellIdx) const
+{
+  if(CellIsScrollArrow(cellIdx))
+    return nullptr;
+  
+  return GetRowItem(mScrollItemOffset + cellIdx);
+}
+
+void IPopupMenuControl::MenuPanel::SetQuery(const char* query)
+{
+  auto toLower = [](const char* str) {
+    std::string lower(str);
+    std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return lower;
+  };
+  
+  const std::string lowerQuery = toLower(query);
+  
+  // a subsequence match: the characters of the query appear in order
+  auto matches = [&lowerQuery](const std::string& text) {
+    size_t pos = 0;
+    
+    for (auto c : lowerQuery)
+    {
+      pos = text.find(c, pos);
+      
+      if(pos == std::string::npos)
+        return false;
+      
+      pos++;
+    }
+    
+    return true;
+  };
+  
+  const bool extendsQuery = mFiltered && lowerQuery.size() > mQuery.size() && lowerQuery.compare(0, mQuery.size(), mQuery) == 0;
+  
+  mQuery = lowerQuery;
+  mScrollItemOffset = 0;
+  mHighlightedCell = nullptr;
+  
+  if(mQuery.empty())
+  {
+    mFiltered = false;
+    mRows.clear();
+    return;
+  }
+  
+  if(mSearchIndex.size() != static_cast<size_t>(mMenu.NItems()))
+  {
+    mSearchIndex.clear();
+    mSearchIndex.reserve(mMenu.NItems());
+    
+    for (auto i = 0; i < mMenu.NItems(); i++)
+      mSearchIndex.push_back(toLower(mMenu.GetItem(i)->GetText()));
+  }
+  
+  auto isCandidate = [&](int itemIdx) {
+    const IPopupMenu::Item* pItem = mMenu.GetItem(itemIdx);
+    return !pItem->GetIsSeparator() && !pItem->GetIsTitle() && matches(mSearchIndex[itemIdx]);
+  };
+  
+  if(extendsQuery) // typing another character can only remove matches, so only the current ones are searched
+  {
+    mRows.erase(std::remove_if(mRows.begin(), mRows.end(), [&](int itemIdx) { return !isCandidate(itemIdx); }), mRows.end());
+  }
+  else
+  {
+    mRows.clear();
+    
+    for (auto i = 0; i < mMenu.NItems(); i++)
+    {
+      if(isCandidate(i))
+        mRows.push_back(i);
+    }
+  }
+  
+  mFiltered = true;
+}
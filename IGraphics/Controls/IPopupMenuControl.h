@@ -16,6 +16,9 @@
  * @copydoc IPopupMenuControl
  */
 
+#include <string>
+#include <vector>
+
 #include "IControl.h"
 
 BEGIN_IPLUG_NAMESPACE
@@ -66,6 +69,7 @@ public:
   void OnMouseOver(float x, float y, const IMouseMod& mod) override;
   void OnMouseOut() override;
   void OnMouseWheel(float x, float y, const IMouseMod& mod, float d) override;
+  bool OnKeyDown(float x, float y, const IKeyPress& key) override;
   void OnEndAnimation() override;
 
   //IPopupMenuControl
@@ -97,6 +101,10 @@ public:
   virtual void DrawDownArrow(IGraphics& g, const IRECT& bounds, bool sel, IBlend* pBlend);
   /** Override this method to change the way a cell separator is drawn  */
   virtual void DrawSeparator(IGraphics& g, const IRECT& bounds, IBlend* pBlend);
+  /** Override this method to change the way the text typed to filter a menu panel is drawn
+   * @param bounds The top right corner of the panel
+   * @param str The text typed so far */
+  virtual void DrawSearchText(IGraphics& g, const IRECT& bounds, const char* str, IBlend* pBlend);
   
   /** Call this to set the Panel color */
   void SetPanelColor(IColor color) { mPanelBackgroundColor = color; }
@@ -138,6 +146,10 @@ public:
   /** Set the bounds that the menu can potentially occupy, if not the full graphics context */
   void SetMaxBounds(const IRECT& bounds) { mMaxBounds = bounds; }
 
+  /** Set if typing while the menu is open filters the items of the panel under the mouse, to those whose text contains the typed characters in order, ignoring case.
+   * Return chooses the first match, backspace removes a character and escape clears the text or closes the menu. On by default */
+  void SetTypeToFilter(bool enable) { mTypeToFilter = enable; }
+
 private:
   /** Get an IRECT represents the maximum dimensions of the longest text item in the menu */
   IRECT GetLargestCellRectForMenu(IPopupMenu& menu, float x, float y) const;
@@ -174,7 +186,38 @@ private:
 
     void ScrollUp() { mScrollItemOffset--; mScrollItemOffset = Clip(mScrollItemOffset, 0, mCellBounds.GetSize()-1); }
 
-    void ScrollDown() { mScrollItemOffset++; mScrollItemOffset = Clip(mScrollItemOffset, 0, mMenu.NItems()-mCellBounds.GetSize()); }
+    void ScrollDown() { mScrollItemOffset++; mScrollItemOffset = Clip(mScrollItemOffset, 0, NRows()-mCellBounds.GetSize()); }
+
+    /** Scroll by a number of rows, e.g. with the mouse wheel */
+    void ScrollBy(int nRows) { mScrollItemOffset = Clip(mScrollItemOffset + nRows, 0, std::max(NRows()-mCellBounds.GetSize(), 0)); }
+
+    /** @return The number of rows shown by the panel, which is the number of items of the menu unless it is filtered */
+    int NRows() const { return mFiltered ? static_cast<int>(mRows.size()) : mMenu.NItems(); }
+
+    /** @return The index in the menu of the item shown in a row, or -1 if there isn't one */
+    int GetRowItemIdx(int row) const
+    {
+      if (row < 0 || row >= NRows())
+        return -1;
+
+      return mFiltered ? mRows[row] : row;
+    }
+
+    /** @return The item shown in a row, or nullptr if there isn't one */
+    IPopupMenu::Item* GetRowItem(int row) const { return mMenu.GetItem(GetRowItemIdx(row)); }
+
+    /** @return The item shown in a cell, taking the scroll offset into account, or nullptr if there isn't one or the cell is a scroll arrow */
+    IPopupMenu::Item* GetCellItem(int cellIdx) const;
+
+    /** @return \c true if a cell is showing a scroll arrow rather than an item */
+    bool CellIsScrollArrow(int cellIdx) const;
+
+    /** Filter the rows to the items that match a search
+     * @param query The text typed so far, an empty string shows all the items */
+    void SetQuery(const char* query);
+
+    /** @return The text the rows are filtered with */
+    const char* GetQuery() const { return mQuery.c_str(); }
 
     /** Checks if any of the expanded cells for this panel contain a x, y coordinate, and if so returns an IRECT pointer to the cell bounds
      * @param x X position to test
@@ -198,6 +241,11 @@ private:
     int mParentIdx = 0; // An index into the IPopupMenuControl::mMenuPanels lists, representing the parent menu panel
     bool mScroller = false;
     int mScrollItemOffset = 0;
+
+    std::string mQuery; // the text the rows are filtered with
+    bool mFiltered = false; // if true, mRows holds the indices of the items that match mQuery
+    std::vector<int> mRows;
+    std::vector<std::string> mSearchIndex; // the lower case text of each item, built the first time the panel is filtered
       
 #ifndef IGRAPHICS_NANOVG
     ILayerPtr mShadowLayer;
@@ -218,6 +266,7 @@ private:
   bool mForcedSouth = true; // if set true, a menu in the lower half of the GUI will appear below it's control if there is enough room for it.
   bool mSubmenuOnRight = true; // If set true, the submenu will be drawn on the right of the parent menu.... on the left if false.
   bool mSubMenuOpened = false; // Is set true when a submenu panel is open and false when menu is collapsed.
+  bool mTypeToFilter = true; // Set by SetTypeToFilter()
 
   float mCellGap = 2.f; // The gap between cells in pixels
   float mSeparatorSize = 2.; // The size in pixels of a separator. This could be width or height
@@ -108,7 +108,7 @@ public:
       TriggerMidiMsgFromKeyPress(mLastTouchedKey, (int) (mLastVelocity * 127.f));
     }
 
-    SetDirty(true);
+    SetKeyDirty(mLastTouchedKey, true);
   }
 
   void OnMouseUp(float x, float y, const IMouseMod& mod) override
@@ -121,8 +121,6 @@ public:
       mLastTouchedKey = -1;
       mMouseOverKey = -1;
       mLastVelocity = 0.;
-
-      SetDirty(false);
     }
   }
 
@@ -156,7 +154,7 @@ public:
       SetKeyIsPressed(prevKey, false);
     }
 
-    SetDirty(true);
+    SetKeyDirty(mLastTouchedKey, true);
 
   }
 
@@ -179,8 +177,6 @@ public:
       mLastTouchedKey = -1;
       mMouseOverKey = -1;
       mLastVelocity = 0.;
-
-      SetDirty(false);
     }
   }
 
@@ -217,8 +213,6 @@ public:
         break;
       default: break;
     }
-
-    SetDirty(false);
   }
 
   void DrawKey(IGraphics& g, const IRECT& bounds, const IColor& color)
@@ -231,6 +225,30 @@ public:
       g.FillRect(color, bounds/*, &blend*/);
   }
 
+  /** Add a key to the batch drawn by the next call to DrawKeyBatch(), unless it is outside the region being drawn */
+  void AddKeyToBatch(const IRECT& bounds, const IColor& color)
+  {
+    if (!bounds.Intersects(mDrawRegion))
+      return;
+
+    mKeyBatchBounds.push_back(bounds);
+    mKeyBatchColors.push_back(color);
+  }
+
+  /** Draw and clear the keys added with AddKeyToBatch(), with one fill per run of the same color */
+  void DrawKeyBatch(IGraphics& g, bool rounded, const IBlend* pBlend = nullptr)
+  {
+    const int nKeys = static_cast<int>(mKeyBatchBounds.size());
+
+    if (rounded)
+      g.FillRoundRects(mKeyBatchColors.data(), mKeyBatchBounds.data(), nKeys, 0., 0., mRoundness, mRoundness, pBlend);
+    else
+      g.FillRects(mKeyBatchColors.data(), mKeyBatchBounds.data(), nKeys, pBlend);
+
+    mKeyBatchBounds.clear();
+    mKeyBatchColors.clear();
+  }
+
   void Draw(IGraphics& g) override
   {
     IColor shadowColor = IColor(60, 0, 0, 0);
@@ -238,53 +256,70 @@ public:
     float BKBottom = mRECT.T + mRECT.H() * mBKHeightRatio;
     float BKWidth = GetBKWidth();
 
+    mDrawRegion = g.GetDrawRegion();
+
+    // the keys are drawn in passes, so that each pass is a batch of rectangles, see IGraphics::FillRects()
     // first draw white keys
     for (int i = 0; i < NKeys(); ++i)
     {
       if (!IsBlackKey(i))
-      {
-        float kL = *GetKeyXPos(i);
-        IRECT keyBounds = IRECT(kL, mRECT.T, kL + mWKWidth, mRECT.B);
+        AddKeyToBatch(GetWhiteKeyBounds(i), i == mHighlight ? mHK_COLOR : mWK_COLOR);
+    }
+    DrawKeyBatch(g, mRoundedKeys);
 
-        DrawKey(g, keyBounds, i == mHighlight ? mHK_COLOR : mWK_COLOR);
+    // draw played white keys
+    for (int i = 0; i < NKeys(); ++i)
+    {
+      if (!IsBlackKey(i) && GetKeyIsPressed(i))
+        AddKeyToBatch(GetWhiteKeyBounds(i), mPK_COLOR);
+    }
+    DrawKeyBatch(g, mRoundedKeys);
 
-        if (GetKeyIsPressed(i))
+    if (mDrawShadows)
+    {
+      for (int i = 0; i < NKeys(); ++i)
+      {
+        if (!IsBlackKey(i) && GetKeyIsPressed(i))
         {
-          // draw played white key
-          DrawKey(g, keyBounds, mPK_COLOR);
-
-          if (mDrawShadows)
-          {
-            IRECT shadowBounds = keyBounds;
-            shadowBounds.R = shadowBounds.L + 0.35f * shadowBounds.W();
-            
-            if(!mRoundedKeys)
-              g.FillRect(shadowColor, shadowBounds, &mBlend);
-            else {
-              g.FillRoundRect(shadowColor, shadowBounds, 0., 0., mRoundness, mRoundness, &mBlend); // this one looks strange with rounded corners
-            }
-          }
+          IRECT shadowBounds = GetWhiteKeyBounds(i);
+          shadowBounds.R = shadowBounds.L + 0.35f * shadowBounds.W();
+          AddKeyToBatch(shadowBounds, shadowColor);
         }
-        if (mDrawFrame && i != 0)
+      }
+      DrawKeyBatch(g, mRoundedKeys, &mBlend); // this one looks strange with rounded corners
+    }
+
+    if (mDrawFrame)
+    {
+      g.PathClear();
+
+      for (int i = 1; i < NKeys(); ++i)
+      {
+        if (!IsBlackKey(i))
         { // only draw the left border if it doesn't overlay mRECT left border
-          g.DrawLine(mFR_COLOR, kL, mRECT.T, kL, mRECT.B, &mBlend, mFrameThickness);
+          float kL = *GetKeyXPos(i);
+          g.PathMoveTo(kL, mRECT.T);
+          g.PathLineTo(kL, mRECT.B);
+
           if (i == NKeys() - 2 && IsBlackKey(NKeys() - 1))
-            g.DrawLine(mFR_COLOR, kL + mWKWidth, mRECT.T, kL + mWKWidth, mRECT.B, &mBlend, mFrameThickness);
+          {
+            g.PathMoveTo(kL + mWKWidth, mRECT.T);
+            g.PathLineTo(kL + mWKWidth, mRECT.B);
+          }
         }
       }
+
+      g.PathStroke(mFR_COLOR, mFrameThickness, IStrokeOptions(), &mBlend);
     }
 
-    // then blacks
-    for (int i = 0; i < NKeys(); ++i)
+    // then blacks, first the underlying shadows
+    if (mDrawShadows)
     {
-      if (IsBlackKey(i))
+      for (int i = 0; i < NKeys() - 1; ++i)
       {
-        float kL = *GetKeyXPos(i);
-        IRECT keyBounds = IRECT(kL, mRECT.T, kL + BKWidth, BKBottom);
-        // first draw underlying shadows
-        if (mDrawShadows && !GetKeyIsPressed(i) && i < NKeys() - 1)
+        if (IsBlackKey(i) && !GetKeyIsPressed(i))
         {
-          IRECT shadowBounds = keyBounds;
+          IRECT shadowBounds = GetBlackKeyBounds(i, BKWidth, BKBottom);
           float w = shadowBounds.W();
           shadowBounds.L += 0.6f * w;
           if (GetKeyIsPressed(i + 1))
@@ -294,29 +329,61 @@ public:
             shadowBounds.B = shadowBounds.T + 1.05f * shadowBounds.H();
           }
           shadowBounds.R = shadowBounds.L + w;
-          DrawKey(g, shadowBounds, shadowColor);
+          AddKeyToBatch(shadowBounds, shadowColor);
         }
-        DrawKey(g, keyBounds, (i == mHighlight ? mHK_COLOR : mBK_COLOR.WithContrast(IsDisabled() ? GRAYED_ALPHA : 0.f)));
+      }
+      DrawKeyBatch(g, mRoundedKeys);
+    }
 
-        if (GetKeyIsPressed(i))
-        {
-          // draw pressed black key
-          IColor cBP = mPK_COLOR;
-          cBP.A = (int) mBKAlpha;
-          g.FillRect(cBP, keyBounds, &mBlend);
-        }
+    const IColor bkColor = mBK_COLOR.WithContrast(IsDisabled() ? GRAYED_ALPHA : 0.f);
+
+    for (int i = 0; i < NKeys(); ++i)
+    {
+      if (IsBlackKey(i))
+        AddKeyToBatch(GetBlackKeyBounds(i, BKWidth, BKBottom), i == mHighlight ? mHK_COLOR : bkColor);
+    }
+    DrawKeyBatch(g, mRoundedKeys);
 
-        if(!mRoundedKeys)
+    // draw pressed black keys
+    IColor cBP = mPK_COLOR;
+    cBP.A = (int) mBKAlpha;
+
+    for (int i = 0; i < NKeys(); ++i)
+    {
+      if (IsBlackKey(i) && GetKeyIsPressed(i))
+        AddKeyToBatch(GetBlackKeyBounds(i, BKWidth, BKBottom), cBP);
+    }
+    DrawKeyBatch(g, false, &mBlend);
+
+    if (!mRoundedKeys)
+    {
+      g.PathClear();
+
+      for (int i = 0; i < NKeys(); ++i)
+      {
+        if (IsBlackKey(i))
         {
+          float kL = *GetKeyXPos(i);
           // draw l, r and bottom if they don't overlay the mRECT borders
           if (mBKHeightRatio != 1.0)
-            g.DrawLine(mFR_COLOR, kL, BKBottom, kL + BKWidth, BKBottom, &mBlend);
+          {
+            g.PathMoveTo(kL, BKBottom);
+            g.PathLineTo(kL + BKWidth, BKBottom);
+          }
           if (i > 0)
-            g.DrawLine(mFR_COLOR, kL, mRECT.T, kL, BKBottom, &mBlend);
+          {
+            g.PathMoveTo(kL, mRECT.T);
+            g.PathLineTo(kL, BKBottom);
+          }
           if (i != NKeys() - 1)
-            g.DrawLine(mFR_COLOR, kL + BKWidth, mRECT.T, kL + BKWidth, BKBottom, &mBlend);
+          {
+            g.PathMoveTo(kL + BKWidth, mRECT.T);
+            g.PathLineTo(kL + BKWidth, BKBottom);
+          }
         }
       }
+
+      g.PathStroke(mFR_COLOR, 1.f, IStrokeOptions(), &mBlend);
     }
 
     if (mDrawFrame)
@@ -391,13 +458,26 @@ public:
   void SetKeyIsPressed(int key, bool pressed)
   {
     mPressedKeys.Get()[key] = pressed;
-    SetDirty(false);
+    SetKeyDirty(key);
   }
   
   void SetKeyHighlight(int key)
   {
+    if (mHighlight > -1)
+      SetKeyDirty(mHighlight);
+
     mHighlight = key;
-    SetDirty(false);
+
+    if (key > -1)
+      SetKeyDirty(key);
+  }
+
+  /** Mark the part of the keyboard that is drawn differently when a key is pressed or highlighted as dirty, see IControl::SetDirtyRegion()
+   * @param key The key index, or -1 to mark the whole keyboard
+   * @param triggerAction See IControl::SetDirty() */
+  void SetKeyDirty(int key, bool triggerAction = false)
+  {
+    SetDirtyRegion(GetKeyDirtyRegion(key), triggerAction);
   }
 
   void ClearNotesFromMidi()
@@ -512,6 +592,33 @@ public:
 //  double GetVelocity() const { return mVelocity * 127.f; }
 
 private:
+  IRECT GetWhiteKeyBounds(int key)
+  {
+    const float kL = *GetKeyXPos(key);
+    return IRECT(kL, mRECT.T, kL + mWKWidth, mRECT.B);
+  }
+
+  IRECT GetBlackKeyBounds(int key, float width, float bottom)
+  {
+    const float kL = *GetKeyXPos(key);
+    return IRECT(kL, mRECT.T, kL + width, bottom);
+  }
+
+  // a key and its neighbours, which its shadows and theirs can fall on
+  IRECT GetKeyDirtyRegion(int key)
+  {
+    if (key < 0 || key >= NKeys() || mShowNoteAndVel)
+      return mRECT;
+
+    const float l = *GetKeyXPos(std::max(key - 1, 0));
+    const float r = key + 2 < NKeys() ? *GetKeyXPos(key + 2) + mWKWidth : mRECT.R;
+    IRECT region = IRECT(l, mRECT.T, r, mRECT.B).GetPadded(mFrameThickness);
+#ifdef _DEBUG
+    region = region.Union(IRECT(mRECT.L + 20, mRECT.B - 20, mRECT.L + 160, mRECT.B)); // the last touched key text
+#endif
+    return region;
+  }
+
   void RecreateKeyBounds(bool keepWidth)
   {
     if (keepWidth)
@@ -726,6 +833,9 @@ protected:
   WDL_TypedBuf<bool> mPressedKeys;
   WDL_TypedBuf<float> mKeyXPos;
   int mHighlight = -1;
+  IRECT mDrawRegion;
+  std::vector<IRECT> mKeyBatchBounds;
+  std::vector<IColor> mKeyBatchColors;
 };
 
 /** Vectorial "wheel" control for pitchbender/modwheel
@@ -81,6 +81,80 @@ public:
       g.DrawRect(GetColor(kFR), mWidgetBounds, &mBlend, mStyle.frameThickness);
   }
 
+  void DrawWidget(IGraphics& g) override
+  {
+    if (!mBatchedDrawing)
+    {
+      IVTrackControlBase::DrawWidget(g);
+      return;
+    }
+    
+    const int nVals = NVals();
+    const IRECT* pTracks = mTrackBounds.Get();
+    
+    // each pass is a batch of rectangles, the tracks don't overlap, so this looks the same as drawing them one at a time
+    if (mHighlightedTrack > -1 && mHighlightedTrack < nVals)
+      g.FillRect(GetColor(kHL), pTracks[mHighlightedTrack]);
+    
+    if (HasTrackNames())
+    {
+      for (int ch = 0; ch < nVals; ch++)
+        DrawTrackName(g, pTracks[ch], ch);
+    }
+    
+    mBatchBounds.clear();
+    mBatchColors.clear();
+    mPeakBounds.clear();
+    
+    IRECT mouseOverBounds;
+    bool drawMouseOver = false;
+    
+    for (int ch = 0; ch < nVals; ch++)
+    {
+      IRECT fillRect;
+      const bool drawHandle = GetTrackHandleBounds(pTracks[ch], ch, fillRect);
+      
+      if (drawHandle)
+      {
+        mBatchBounds.push_back(fillRect);
+        mBatchColors.push_back(ch == mHighlightedTrack ? GetColor(kX1) : GetColor(kFG));
+      }
+      
+      if (!GetStepped())
+        mPeakBounds.push_back(GetTrackPeakBounds(fillRect, ch));
+      
+      if (drawHandle && ch == mMouseOverTrack)
+      {
+        mouseOverBounds = fillRect;
+        drawMouseOver = true;
+      }
+    }
+    
+    g.FillRects(mBatchColors.data(), mBatchBounds.data(), static_cast<int>(mBatchBounds.size()), &mBlend);
+    
+    if (drawMouseOver)
+      g.FillRect(GetColor(kHL), mouseOverBounds, &mBlend);
+    
+    mBatchColors.assign(mPeakBounds.size(), GetColor(kFR));
+    g.FillRects(mBatchColors.data(), mPeakBounds.data(), static_cast<int>(mPeakBounds.size()), &mBlend);
+    
+    if (mStyle.drawFrame && mDrawTrackFrame)
+    {
+      mBatchColors.assign(nVals, GetColor(kFR));
+      g.DrawRects(mBatchColors.data(), pTracks, nVals, &mBlend, mStyle.frameThickness);
+    }
+  }
+  
+  /** Draw the tracks in a few batches, one for each part of the track across all the tracks, rather than drawing each track in turn.
+   * This is much faster with many tracks, e.g. in a 128 step sequencer, but it draws the default track parts,
+   * so don't enable it in a subclass that overrides DrawTrack(), DrawTrackBackground(), DrawTrackHandle() or DrawPeak()
+   * @param enable \c true to batch the drawing */
+  void SetBatchedDrawing(bool enable)
+  {
+    mBatchedDrawing = enable;
+    SetDirty(false);
+  }
+
   void SnapToMouse(float x, float y, EDirection direction, const IRECT& bounds, int valIdx = -1 /* TODO:: not used*/, double minClip = 0., double maxClip = 1.) override
   {
     bounds.Constrain(x, y);
@@ -255,6 +329,10 @@ protected:
   int mPrevSliderHit = -1;
   int mSliderHit = -1;
   double mGrain = 0.001;
+  bool mBatchedDrawing = false;
+  std::vector<IRECT> mBatchBounds;
+  std::vector<IColor> mBatchColors;
+  std::vector<IRECT> mPeakBounds;
 };
 
 /** A vectorial multi-toggle control, could be used for a trigger in a step sequencer or tarnce gate
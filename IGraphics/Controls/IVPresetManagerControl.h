@@ -129,13 +129,18 @@ private:
 class IVDiskPresetManagerControl : public IDirBrowseControlBase
 {
 public:
-  IVDiskPresetManagerControl(const IRECT& bounds, const char* presetPath, const char* fileExtension, bool showFileExtensions = true, const IVStyle& style = DEFAULT_STYLE)
+  /** @param indexFilePath If not nullptr, the presets are listed on a worker thread and the listing is kept in this file, see IDirBrowseControlBase::UseBackgroundIndex(). Pass "" to list them on a worker without keeping an index file */
+  IVDiskPresetManagerControl(const IRECT& bounds, const char* presetPath, const char* fileExtension, bool showFileExtensions = true, const IVStyle& style = DEFAULT_STYLE, const char* indexFilePath = nullptr)
   : IDirBrowseControlBase(bounds, fileExtension, showFileExtensions)
   , mStyle(style)
   {
     mIgnoreMouse = true;
     AddPath(presetPath, "");
-    SetupMenu();
+
+    if (indexFilePath)
+      UseBackgroundIndex(strlen(indexFilePath) ? indexFilePath : nullptr);
+    else
+      SetupMenu();
   }
   
   void Draw(IGraphics& g) override { /* NO-OP */ }
@@ -23,6 +23,31 @@
 BEGIN_IPLUG_NAMESPACE
 BEGIN_IGRAPHICS_NAMESPACE
 
+/** Copy the channels that are drawn out of an ISender message into a control's buffer. The message is viewed in place, so only the first nChans channels are copied,
+ * rather than the whole ISenderData, which is mostly unused channels for a control made for more channels than it is sent
+ * @param buf The control's buffer
+ * @param pData The message data, from OnMsgFromDelegate()
+ * @param dataSize The size of the message data in bytes */
+template <int MAXNC, typename T>
+void CopySenderChannels(ISenderData<MAXNC, T>& buf, const void* pData, int dataSize)
+{
+  IByteStream stream(pData, dataSize);
+  const ISenderData<MAXNC, T>* pView = nullptr;
+
+  if (stream.GetView(pView, 0) < 0)
+  {
+    // a message that isn't aligned for the view has to be copied whole
+    stream.Get(&buf, 0);
+    return;
+  }
+
+  buf.ctrlTag = pView->ctrlTag;
+  buf.nChans = Clip(pView->nChans, 0, MAXNC);
+  buf.chanOffset = pView->chanOffset;
+  buf.samplePos = pView->samplePos;
+  std::copy_n(pView->vals.begin(), buf.nChans, buf.vals.begin());
+}
+
 /** Vectorial multi-channel capable oscilloscope control
  * @ingroup IControls */
 template <int MAXNC = 1, int MAXBUF = 128>
@@ -61,17 +86,19 @@ public:
 
     float xPerData = r.W() / (float) MAXBUF;
 
-    for (int c = 0; c < mBuf.nChans; c++)
+    const ISenderData<MAXNC, std::array<float, MAXBUF>>& buf = mFrame ? *mFrame : mBuf;
+
+    for (int c = 0; c < buf.nChans; c++)
     {
       float xHi = 0.f;
-      float yHi = mBuf.vals[c][0] * maxY;
+      float yHi = buf.vals[c][0] * maxY;
       yHi = Clip(yHi, -maxY, maxY);
 
       g.PathMoveTo(r.L + xHi, r.MH() - yHi);
       for (int s = 1; s < MAXBUF; s++)
       {
         xHi = ((float) s * xPerData);
-        yHi = mBuf.vals[c][s] * maxY;
+        yHi = buf.vals[c][s] * maxY;
         yHi = Clip(yHi, -maxY, maxY);
         g.PathLineTo(r.L + xHi, r.MH() - yHi);
       }
@@ -90,17 +117,105 @@ public:
   {
     if (!IsDisabled() && msgTag == ISender<>::kUpdateMessage)
     {
-      IByteStream stream(pData, dataSize);
-
-      int pos = 0;
-      pos = stream.Get(&mBuf, pos);
+      CopySenderChannels(mBuf, pData, dataSize);
+      mFrame = nullptr;
 
       SetDirty(false);
     }
+    else if (msgTag == ISender<>::kFrameMessage)
+    {
+      // The frame belongs to an IFrameSender and stays valid until it next transmits, so just keep the pointer
+      assert(dataSize == sizeof(ISenderData<MAXNC, std::array<float, MAXBUF>>));
+      mFrame = static_cast<const ISenderData<MAXNC, std::array<float, MAXBUF>>*>(pData);
+
+      if (!IsDisabled())
+        SetDirty(false);
+    }
   }
 
 private:
   ISenderData<MAXNC, std::array<float, MAXBUF>> mBuf;
+  const ISenderData<MAXNC, std::array<float, MAXBUF>>* mFrame = nullptr;
+  float mPadding = 2.f;
+};
+
+/** Vectorial multi-channel capable oscilloscope control that draws decimated waveforms from an IEnvelopeSender,
+ * as a filled min/max band with the RMS level inside it
+ * @ingroup IControls */
+template <int MAXNC = 1, int MAXPOINTS = 128>
+class IVEnvelopeScopeControl : public IControl
+                             , public IVectorBase
+{
+public:
+  /** Constructs an IVEnvelopeScopeControl
+   * @param bounds The rectangular area that the control occupies
+   * @param label A CString to label the control
+   * @param style, /see IVStyle */
+  IVEnvelopeScopeControl(const IRECT& bounds, const char* label = "", const IVStyle& style = DEFAULT_STYLE)
+  : IControl(bounds)
+  , IVectorBase(style)
+  {
+    AttachIControl(this, label);
+  }
+
+  void Draw(IGraphics& g) override
+  {
+    DrawBackground(g, mRECT);
+    DrawWidget(g);
+    DrawLabel(g);
+
+    if(mStyle.drawFrame)
+      g.DrawRect(GetColor(kFR), mWidgetBounds, &mBlend, mStyle.frameThickness);
+  }
+
+  void DrawWidget(IGraphics& g) override
+  {
+    g.DrawHorizontalLine(GetColor(kSH), mWidgetBounds, 0.5, &mBlend, mStyle.frameThickness);
+
+    IRECT r = mWidgetBounds.GetPadded(-mPadding);
+
+    const float maxY = (r.H() / 2.f); // y +/- centre
+    const float xPerData = r.W() / (float) (MAXPOINTS - 1);
+
+    auto yPos = [&](float v) { return r.MH() - Clip(v * maxY, -maxY, maxY); };
+
+    for (int c = 0; c < mBuf.nChans; c++)
+    {
+      const ISenderEnvelope<MAXPOINTS>& env = mBuf.vals[c];
+
+      g.PathMoveTo(r.L, yPos(env.hi[0]));
+      for (int p = 1; p < MAXPOINTS; p++)
+        g.PathLineTo(r.L + (float) p * xPerData, yPos(env.hi[p]));
+      for (int p = MAXPOINTS - 1; p >= 0; p--)
+        g.PathLineTo(r.L + (float) p * xPerData, yPos(env.lo[p]));
+      g.PathClose();
+      g.PathFill(GetColor(kFG).WithOpacity(0.5f), IFillOptions(), &mBlend);
+
+      g.PathMoveTo(r.L, yPos(env.rms[0]));
+      for (int p = 1; p < MAXPOINTS; p++)
+        g.PathLineTo(r.L + (float) p * xPerData, yPos(env.rms[p]));
+      g.PathStroke(GetColor(kFG), mTrackSize, IStrokeOptions(), &mBlend);
+    }
+  }
+
+  void OnResize() override
+  {
+    SetTargetRECT(MakeRects(mRECT));
+    SetDirty(false);
+  }
+
+  void OnMsgFromDelegate(int msgTag, int dataSize, const void* pData) override
+  {
+    if (!IsDisabled() && msgTag == ISender<>::kUpdateMessage)
+    {
+      CopySenderChannels(mBuf, pData, dataSize);
+
+      SetDirty(false);
+    }
+  }
+
+private:
+  ISenderData<MAXNC, ISenderEnvelope<MAXPOINTS>> mBuf;
   float mPadding = 2.f;
 };
 
@@ -0,0 +1,371 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @ingroup IControls
+ * @copydoc IVScrollViewControl
+ */
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+#include "IControl.h"
+
+BEGIN_IPLUG_NAMESPACE
+BEGIN_IGRAPHICS_NAMESPACE
+
+/** A vertical list of rows, for lists much longer than the control such as a preset browser with thousands of entries.
+ * It is one control whatever the number of rows: only the rows that are visible are drawn, and their contents are asked for when they are drawn.
+ * The rows are drawn in a ring of layers ("tiles") a few rows tall. Scrolling draws the tiles as bitmaps at a new offset, and only the tiles that
+ * come into view are drawn again, so the cost of a frame doesn't depend on the number of rows. The selection and the row under the mouse are drawn on top.
+ * Override DrawRow() to draw something other than a line of text
+ * @ingroup IControls */
+class IVScrollViewControl : public IControl
+                          , public IVectorBase
+{
+public:
+  /** Called to get the text of a row, when it is drawn */
+  using RowTextFunc = std::function<void(int row, WDL_String& str)>;
+  /** Called with the row that was selected or double clicked */
+  using RowFunc = std::function<void(int row)>;
+
+  static constexpr float kScrollBarWidth = 8.f;
+
+  /** Constructs an IVScrollViewControl
+   * @param bounds The rectangular area that the control occupies
+   * @param nRows The number of rows
+   * @param textFunc Called to get the text of a row when it is drawn, can be nullptr if DrawRow() is overridden
+   * @param selectFunc Called when the user selects a row
+   * @param label A CString to label the control
+   * @param style, /see IVStyle
+   * @param rowHeight The height of each row
+   * @param tileRows The number of rows in each tile */
+  IVScrollViewControl(const IRECT& bounds, int nRows, RowTextFunc textFunc, RowFunc selectFunc = nullptr, const char* label = "",
+                      const IVStyle& style = DEFAULT_STYLE, float rowHeight = 20.f, int tileRows = 8)
+  : IControl(bounds)
+  , IVectorBase(style.WithShowValue(false))
+  , mTextFunc(textFunc)
+  , mSelectFunc(selectFunc)
+  , mNRows(std::max(nRows, 0))
+  , mRowHeight(std::max(rowHeight, 1.f))
+  , mTileRows(std::max(tileRows, 1))
+  {
+    AttachIControl(this, label);
+  }
+
+  /** Draw one row. The default draws the text given by the RowTextFunc with the style's value text
+   * @param g The graphics context, which is drawing into a tile
+   * @param r The bounds of the row
+   * @param row The index of the row */
+  virtual void DrawRow(IGraphics& g, const IRECT& r, int row)
+  {
+    if (!mTextFunc)
+      return;
+
+    mRowStr.Set("");
+    mTextFunc(row, mRowStr);
+    g.DrawText(mStyle.valueText.WithAlign(EAlign::Near), mRowStr.Get(), r.GetHPadded(-mStyle.frameThickness - 4.f));
+  }
+
+  /** Change the number of rows. The scroll position and selection are kept if they are still in range
+   * @param nRows The number of rows */
+  void SetNumRows(int nRows)
+  {
+    mNRows = std::max(nRows, 0);
+
+    if (mSelectedRow >= mNRows)
+      mSelectedRow = -1;
+
+    if (mMouseOverRow >= mNRows)
+      mMouseOverRow = -1;
+
+    InvalidateRows();
+    ScrollTo(mScrollPos);
+  }
+
+  /** @return The number of rows */
+  int NRows() const { return mNRows; }
+
+  /** Draw rows again, when their contents have changed
+   * @param first The first row to draw again
+   * @param last The last row to draw again, or -1 for all the rows from first */
+  void InvalidateRows(int first = 0, int last = -1)
+  {
+    const int firstTile = std::max(first, 0) / mTileRows;
+    const int lastTile = last < 0 ? INT_MAX : last / mTileRows;
+
+    for (auto& tile : mTileIndices)
+    {
+      if (tile >= firstTile && tile <= lastTile)
+        tile = -1;
+    }
+
+    SetDirty(false);
+  }
+
+  /** Scroll to a position
+   * @param pos The distance of the top of the view from the top of the first row */
+  void ScrollTo(float pos)
+  {
+    const float newPos = Clip(pos, 0.f, GetMaxScrollPos());
+
+    if (newPos != mScrollPos)
+    {
+      mScrollPos = newPos;
+      SetDirty(false);
+    }
+  }
+
+  /** Scroll as little as possible to show a row
+   * @param row The index of the row */
+  void ScrollToRow(int row)
+  {
+    const float top = static_cast<float>(row) * mRowHeight;
+
+    if (top < mScrollPos)
+      ScrollTo(top);
+    else if (top + mRowHeight > mScrollPos + mWidgetBounds.H())
+      ScrollTo(top + mRowHeight - mWidgetBounds.H());
+  }
+
+  /** @return The scroll position, see ScrollTo() */
+  float GetScrollPos() const { return mScrollPos; }
+
+  /** Select a row and scroll to it, without calling the select function
+   * @param row The index of the row, or -1 for none */
+  void SetSelectedRow(int row)
+  {
+    mSelectedRow = row >= 0 && row < mNRows ? row : -1;
+
+    if (mSelectedRow >= 0)
+      ScrollToRow(mSelectedRow);
+
+    SetDirty(false);
+  }
+
+  /** @return The index of the selected row, or -1 for none */
+  int GetSelectedRow() const { return mSelectedRow; }
+
+  /** @param func Called with the row that the user double clicks */
+  void SetDoubleClickFunc(RowFunc func) { mDoubleClickFunc = func; }
+
+  void Draw(IGraphics& g) override
+  {
+    DrawBackground(g, mRECT);
+    DrawWidget(g);
+    DrawLabel(g);
+
+    if (mStyle.drawFrame)
+      g.DrawRect(GetColor(kFR), mWidgetBounds, &mBlend, mStyle.frameThickness);
+  }
+
+  void DrawWidget(IGraphics& g) override
+  {
+    if (!mNRows || mWidgetBounds.Empty() || mTiles.empty())
+      return;
+
+    const IRECT listBounds = GetListBounds();
+    const float tileHeight = mRowHeight * mTileRows;
+    const float scale = g.GetDrawScale() * g.GetScreenScale();
+    const int firstTile = static_cast<int>(mScrollPos / tileHeight);
+    const int lastTile = std::min(static_cast<int>((mScrollPos + listBounds.H()) / tileHeight), (mNRows - 1) / mTileRows);
+
+    g.PathClipRegion(listBounds);
+
+    for (int tile = firstTile; tile <= lastTile; tile++)
+    {
+      const int slot = tile % static_cast<int>(mTiles.size());
+      ILayerPtr& layer = mTiles[slot];
+
+      if (mTileIndices[slot] != tile || !g.CheckLayer(layer))
+      {
+        DrawTile(g, tile, listBounds);
+        mTileIndices[slot] = tile;
+      }
+
+      // snapped to a device pixel so that tiles are drawn 1:1
+      float top = listBounds.T + static_cast<float>(tile) * tileHeight - mScrollPos;
+      top = std::round(top * scale) / scale;
+      const IRECT& tileBounds = layer->Bounds();
+      g.DrawBitmap(layer->GetBitmap(), IRECT(tileBounds.L, top, tileBounds.R, top + tileBounds.H()), 0, 0, &mBlend);
+    }
+
+    if (mMouseOverRow >= 0)
+      g.FillRect(GetColor(kHL), GetRowBounds(mMouseOverRow), &mBlend);
+
+    if (mSelectedRow >= 0)
+      g.FillRect(GetColor(kX1).WithOpacity(0.5f), GetRowBounds(mSelectedRow), &mBlend);
+
+    g.PathClipRegion();
+
+    if (GetMaxScrollPos() > 0.f)
+      g.FillRoundRect(GetColor(kFG), GetScrollBarHandleBounds(), kScrollBarWidth / 2.f, &mBlend);
+  }
+
+  void OnResize() override
+  {
+    SetTargetRECT(MakeRects(mRECT));
+    const float tileHeight = mRowHeight * mTileRows;
+    const int nTiles = static_cast<int>(std::ceil(mWidgetBounds.H() / tileHeight)) + 1;
+    mTiles.clear();
+    mTiles.resize(nTiles);
+    mTileIndices.assign(nTiles, -1);
+    ScrollTo(mScrollPos);
+    SetDirty(false);
+  }
+
+  void OnMouseDown(float x, float y, const IMouseMod& mod) override
+  {
+    mDraggingScrollBar = GetMaxScrollPos() > 0.f && GetScrollBarBounds().Contains(x, y);
+
+    if (mDraggingScrollBar)
+    {
+      if (!GetScrollBarHandleBounds().Contains(x, y))
+        ScrollTo((y - GetScrollBarBounds().T) / GetScrollBarBounds().H() * GetContentHeight() - GetListBounds().H() / 2.f);
+
+      return;
+    }
+
+    const int row = GetRowAt(x, y);
+
+    if (row >= 0)
+    {
+      SetSelectedRow(row);
+
+      if (mSelectFunc)
+        mSelectFunc(row);
+    }
+  }
+
+  void OnMouseUp(float x, float y, const IMouseMod& mod) override
+  {
+    mDraggingScrollBar = false;
+  }
+
+  void OnMouseDrag(float x, float y, float dX, float dY, const IMouseMod& mod) override
+  {
+    if (mDraggingScrollBar)
+      ScrollTo(mScrollPos + dY * GetContentHeight() / GetScrollBarBounds().H());
+  }
+
+  void OnMouseDblClick(float x, float y, const IMouseMod& mod) override
+  {
+    const int row = GetRowAt(x, y);
+
+    if (row >= 0 && mDoubleClickFunc)
+      mDoubleClickFunc(row);
+  }
+
+  void OnMouseWheel(float x, float y, const IMouseMod& mod, float d) override
+  {
+    ScrollTo(mScrollPos - d * mRowHeight * 3.f);
+    OnMouseOver(x, y, mod);
+  }
+
+  void OnMouseOver(float x, float y, const IMouseMod& mod) override
+  {
+    const int row = GetRowAt(x, y);
+
+    if (row != mMouseOverRow)
+    {
+      mMouseOverRow = row;
+      SetDirty(false);
+    }
+
+    IControl::OnMouseOver(x, y, mod);
+  }
+
+  void OnMouseOut() override
+  {
+    mMouseOverRow = -1;
+    IControl::OnMouseOut();
+  }
+
+  /** @param x The X coordinate
+   * @param y The Y coordinate
+   * @return The index of the row at a point, or -1 if there isn't one */
+  int GetRowAt(float x, float y) const
+  {
+    const IRECT listBounds = GetListBounds();
+
+    if (!listBounds.Contains(x, y))
+      return -1;
+
+    const int row = static_cast<int>((y - listBounds.T + mScrollPos) / mRowHeight);
+    return row < mNRows ? row : -1;
+  }
+
+private:
+  float GetContentHeight() const { return static_cast<float>(mNRows) * mRowHeight; }
+
+  float GetMaxScrollPos() const { return std::max(GetContentHeight() - GetListBounds().H(), 0.f); }
+
+  IRECT GetListBounds() const
+  {
+    return GetContentHeight() > mWidgetBounds.H() ? mWidgetBounds.GetReducedFromRight(kScrollBarWidth) : mWidgetBounds;
+  }
+
+  IRECT GetScrollBarBounds() const { return mWidgetBounds.GetFromRight(kScrollBarWidth); }
+
+  IRECT GetScrollBarHandleBounds() const
+  {
+    const IRECT track = GetScrollBarBounds();
+    const float contentHeight = GetContentHeight();
+    const float handleHeight = std::max(track.H() * GetListBounds().H() / contentHeight, kScrollBarWidth);
+    const float top = track.T + (track.H() - handleHeight) * (mScrollPos / GetMaxScrollPos());
+    return IRECT(track.L, top, track.R, top + handleHeight).GetPadded(-1.f);
+  }
+
+  IRECT GetRowBounds(int row) const
+  {
+    const IRECT listBounds = GetListBounds();
+    const float top = listBounds.T + static_cast<float>(row) * mRowHeight - mScrollPos;
+    return IRECT(listBounds.L, top, listBounds.R, top + mRowHeight);
+  }
+
+  void DrawTile(IGraphics& g, int tile, const IRECT& listBounds)
+  {
+    const IRECT tileBounds(listBounds.L, listBounds.T, listBounds.R, listBounds.T + std::ceil(mRowHeight * mTileRows));
+    const int firstRow = tile * mTileRows;
+
+    g.StartLayer(this, tileBounds);
+
+    for (int i = 0; i < mTileRows && firstRow + i < mNRows; i++)
+    {
+      const float top = tileBounds.T + static_cast<float>(i) * mRowHeight;
+      DrawRow(g, IRECT(tileBounds.L, top, tileBounds.R, top + mRowHeight), firstRow + i);
+    }
+
+    mTiles[tile % static_cast<int>(mTiles.size())] = g.EndLayer();
+  }
+
+  RowTextFunc mTextFunc;
+  RowFunc mSelectFunc;
+  RowFunc mDoubleClickFunc;
+  int mNRows;
+  const float mRowHeight;
+  const int mTileRows;
+  float mScrollPos = 0.f;
+  int mSelectedRow = -1;
+  int mMouseOverRow = -1;
+  bool mDraggingScrollBar = false;
+  WDL_String mRowStr;
+  std::vector<ILayerPtr> mTiles;
+  std::vector<int> mTileIndices; // the tile each layer holds, or -1 if it must be drawn
+};
+
+END_IGRAPHICS_NAMESPACE
+END_IPLUG_NAMESPACE
@@ -0,0 +1,292 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @ingroup IControls
+ * @copydoc IVScrollingDisplayBase
+ */
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include "IControl.h"
+#include "ISender.h"
+
+BEGIN_IPLUG_NAMESPACE
+BEGIN_IGRAPHICS_NAMESPACE
+
+/** A base for controls that show a history of columns scrolling from right to left, such as a waveform or a spectrogram.
+ * The history is kept in a ring of layers ("tiles") a few columns wide. When a column is added, only the tile it is in is drawn again, and the other tiles
+ * are drawn as bitmaps at an offset, so the cost of a frame doesn't depend on the length of the history.
+ * The values of each column are kept as well, in order to draw all the tiles again when the control is resized or the layers are lost */
+class IVScrollingDisplayBase : public IControl
+                             , public IVectorBase
+{
+public:
+  /** Constructs an IVScrollingDisplayBase
+   * @param bounds The rectangular area that the control occupies
+   * @param label A CString to label the control
+   * @param style, /see IVStyle
+   * @param nColumns The number of columns of history shown across the control
+   * @param nValuesPerColumn The number of values in each column
+   * @param tileColumns The number of columns in each tile, which is the most that are drawn in a frame */
+  IVScrollingDisplayBase(const IRECT& bounds, const char* label, const IVStyle& style, int nColumns, int nValuesPerColumn, int tileColumns = 8)
+  : IControl(bounds)
+  , IVectorBase(style)
+  , mNColumns(std::max(nColumns, 1))
+  , mNValuesPerColumn(std::max(nValuesPerColumn, 1))
+  , mTileColumns(std::max(tileColumns, 1))
+  , mNTiles((mNColumns + mTileColumns - 1) / mTileColumns + 1)
+  , mNStoredColumns(mNTiles * mTileColumns)
+  , mValues(mNStoredColumns * mNValuesPerColumn, 0.f)
+  , mTiles(mNTiles)
+  , mTileIndices(mNTiles, -1)
+  {
+    AttachIControl(this, label);
+  }
+
+  /** Draw one column of the history
+   * @param g The graphics context, which is drawing into a tile
+   * @param r The bounds of the column
+   * @param pValues The nValuesPerColumn values of the column */
+  virtual void DrawColumn(IGraphics& g, const IRECT& r, const float* pValues) = 0;
+
+  /** Add a column to the right of the history, scrolling the older columns left
+   * @param pValues nValuesPerColumn values, which are copied */
+  void AddColumn(const float* pValues)
+  {
+    float* pColumn = GetColumn(mNColumnsAdded);
+    std::copy(pValues, pValues + mNValuesPerColumn, pColumn);
+    mNColumnsAdded++;
+    mTileIndices[GetTileSlot(GetTileIndex(mNColumnsAdded - 1))] = -1; // the current tile must be drawn again
+    SetDirty(false);
+  }
+
+  /** Clear the history */
+  void ClearHistory()
+  {
+    mNColumnsAdded = 0;
+    std::fill(mTileIndices.begin(), mTileIndices.end(), -1);
+    SetDirty(false);
+  }
+
+  void Draw(IGraphics& g) override
+  {
+    DrawBackground(g, mRECT);
+    DrawWidget(g);
+    DrawLabel(g);
+
+    if (mStyle.drawFrame)
+      g.DrawRect(GetColor(kFR), mWidgetBounds, &mBlend, mStyle.frameThickness);
+  }
+
+  void DrawWidget(IGraphics& g) override
+  {
+    if (!mNColumnsAdded || mWidgetBounds.Empty())
+      return;
+
+    const float columnWidth = GetColumnWidth();
+    const float tileWidth = columnWidth * mTileColumns;
+    const float scale = g.GetDrawScale() * g.GetScreenScale();
+    const int64_t firstTile = GetTileIndex(std::max<int64_t>(mNColumnsAdded - mNColumns, 0));
+    const int64_t lastTile = GetTileIndex(mNColumnsAdded - 1);
+
+    g.PathClipRegion(mWidgetBounds);
+
+    for (int64_t tile = firstTile; tile <= lastTile; tile++)
+    {
+      const int slot = GetTileSlot(tile);
+      ILayerPtr& layer = mTiles[slot];
+
+      if (mTileIndices[slot] != tile || !g.CheckLayer(layer))
+      {
+        DrawTile(g, tile, columnWidth, tileWidth);
+        mTileIndices[slot] = tile;
+      }
+
+      // the newest column is at the right edge, snapped to a device pixel so that tiles are drawn 1:1
+      float left = mWidgetBounds.R - static_cast<float>(mNColumnsAdded - tile * mTileColumns) * columnWidth;
+      left = std::round(left * scale) / scale;
+      const IRECT& tileBounds = layer->Bounds();
+      g.DrawBitmap(layer->GetBitmap(), IRECT(left, tileBounds.T, left + tileBounds.W(), tileBounds.B), 0, 0, &mBlend);
+    }
+
+    g.PathClipRegion();
+  }
+
+  void OnResize() override
+  {
+    SetTargetRECT(MakeRects(mRECT));
+    std::fill(mTileIndices.begin(), mTileIndices.end(), -1);
+    SetDirty(false);
+  }
+
+protected:
+  /** @return The number of values in each column */
+  int NValuesPerColumn() const { return mNValuesPerColumn; }
+
+private:
+  float GetColumnWidth() const { return mWidgetBounds.W() / static_cast<float>(mNColumns); }
+
+  int64_t GetTileIndex(int64_t column) const { return column / mTileColumns; }
+
+  int GetTileSlot(int64_t tile) const { return static_cast<int>(tile % mNTiles); }
+
+  float* GetColumn(int64_t column) { return mValues.data() + (column % mNStoredColumns) * mNValuesPerColumn; }
+
+  void DrawTile(IGraphics& g, int64_t tile, float columnWidth, float tileWidth)
+  {
+    const IRECT tileBounds(mWidgetBounds.L, mWidgetBounds.T, mWidgetBounds.L + std::ceil(tileWidth), mWidgetBounds.B);
+    const int64_t firstColumn = tile * mTileColumns;
+    const int64_t oldestColumn = std::max<int64_t>(mNColumnsAdded - mNStoredColumns, 0);
+
+    g.StartLayer(this, tileBounds);
+
+    for (int i = 0; i < mTileColumns; i++)
+    {
+      const int64_t column = firstColumn + i;
+
+      if (column < oldestColumn || column >= mNColumnsAdded)
+        continue;
+
+      const float left = tileBounds.L + i * columnWidth;
+      DrawColumn(g, IRECT(left, tileBounds.T, left + columnWidth, tileBounds.B), GetColumn(column));
+    }
+
+    mTiles[GetTileSlot(tile)] = g.EndLayer();
+  }
+
+  const int mNColumns;
+  const int mNValuesPerColumn;
+  const int mTileColumns;
+  const int mNTiles;
+  const int mNStoredColumns;
+  int64_t mNColumnsAdded = 0;
+  std::vector<float> mValues;
+  std::vector<ILayerPtr> mTiles;
+  std::vector<int64_t> mTileIndices; // the tile each layer holds, or -1 if it must be drawn
+};
+
+/** A scrolling waveform, that shows the minimum and maximum of each buffer sent by an IBufferSender as a column, with a lane per channel
+ * @ingroup IControls */
+template <int MAXNC = 1, int MAXBUF = 128>
+class IVScrollingWaveformControl : public IVScrollingDisplayBase
+{
+public:
+  /** Constructs an IVScrollingWaveformControl
+   * @param bounds The rectangular area that the control occupies
+   * @param label A CString to label the control
+   * @param style, /see IVStyle
+   * @param nColumns The number of buffers of history shown across the control */
+  IVScrollingWaveformControl(const IRECT& bounds, const char* label = "", const IVStyle& style = DEFAULT_STYLE, int nColumns = 256)
+  : IVScrollingDisplayBase(bounds, label, style, nColumns, MAXNC * 2)
+  {
+  }
+
+  void DrawColumn(IGraphics& g, const IRECT& r, const float* pValues) override
+  {
+    for (int c = 0; c < MAXNC; c++)
+    {
+      const IRECT lane = r.SubRectVertical(MAXNC, c);
+      const float mid = lane.MH();
+      const float halfH = lane.H() / 2.f;
+      const float top = mid - Clip(pValues[c * 2 + 1], -1.f, 1.f) * halfH;
+      const float bottom = mid - Clip(pValues[c * 2], -1.f, 1.f) * halfH;
+      g.FillRect(GetColor(static_cast<EVColor>(kX1 + (c % 3))), IRECT(r.L, top, r.R, std::max(bottom, top + 1.f)));
+    }
+  }
+
+  void OnMsgFromDelegate(int msgTag, int dataSize, const void* pData) override
+  {
+    if (!IsDisabled() && msgTag == ISender<>::kUpdateMessage)
+    {
+      IByteStream stream(pData, dataSize);
+
+      ISenderData<MAXNC, std::array<float, MAXBUF>> d;
+      stream.Get(&d, 0);
+
+      std::array<float, MAXNC * 2> column {};
+
+      for (int c = d.chanOffset; c < std::min(d.chanOffset + d.nChans, MAXNC); c++)
+      {
+        const auto minMax = std::minmax_element(d.vals[c].begin(), d.vals[c].end());
+        column[c * 2] = *minMax.first;
+        column[c * 2 + 1] = *minMax.second;
+      }
+
+      AddColumn(column.data());
+    }
+  }
+};
+
+/** A scrolling spectrogram (waterfall), that shows each frame of bin magnitudes sent by an ISender<1, QUEUE_SIZE, std::array<float, NBINS>> as a column,
+ * with the lowest bin at the bottom. Magnitudes are linear, and are shown in decibels between the floor and ceiling, from the background
+ * color through kX1 to white
+ * @ingroup IControls */
+template <int NBINS = 128>
+class IVSpectrogramControl : public IVScrollingDisplayBase
+{
+public:
+  /** Constructs an IVSpectrogramControl
+   * @param bounds The rectangular area that the control occupies
+   * @param label A CString to label the control
+   * @param style, /see IVStyle
+   * @param nColumns The number of frames of history shown across the control
+   * @param floorDB The magnitude shown as the background color
+   * @param ceilingDB The magnitude shown as white */
+  IVSpectrogramControl(const IRECT& bounds, const char* label = "", const IVStyle& style = DEFAULT_STYLE, int nColumns = 256, float floorDB = -90.f, float ceilingDB = 0.f)
+  : IVScrollingDisplayBase(bounds, label, style, nColumns, NBINS)
+  , mFloorDB(floorDB)
+  , mCeilingDB(ceilingDB)
+  {
+  }
+
+  void DrawColumn(IGraphics& g, const IRECT& r, const float* pValues) override
+  {
+    const float binHeight = r.H() / NBINS;
+
+    for (int bin = 0; bin < NBINS; bin++)
+    {
+      const float db = static_cast<float>(AmpToDB(std::max(pValues[bin], 1e-9f)));
+      const float v = Clip((db - mFloorDB) / (mCeilingDB - mFloorDB), 0.f, 1.f);
+
+      if (v <= 0.f)
+        continue;
+
+      const IColor color = v < 0.5f ? IColor::LinearInterpolateBetween(GetColor(kBG), GetColor(kX1), v * 2.f)
+                                    : IColor::LinearInterpolateBetween(GetColor(kX1), COLOR_WHITE, v * 2.f - 1.f);
+      const float bottom = r.B - bin * binHeight;
+      g.FillRect(color, IRECT(r.L, bottom - binHeight, r.R, bottom));
+    }
+  }
+
+  void OnMsgFromDelegate(int msgTag, int dataSize, const void* pData) override
+  {
+    if (!IsDisabled() && msgTag == ISender<>::kUpdateMessage)
+    {
+      IByteStream stream(pData, dataSize);
+
+      ISenderData<1, std::array<float, NBINS>> d;
+      stream.Get(&d, 0);
+      AddColumn(d.vals[0].data());
+    }
+  }
+
+private:
+  float mFloorDB;
+  float mCeilingDB;
+};
+
+END_IGRAPHICS_NAMESPACE
+END_IPLUG_NAMESPACE
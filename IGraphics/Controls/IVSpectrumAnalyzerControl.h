@@ -0,0 +1,146 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @ingroup IControls
+ * @copydoc IVSpectrumAnalyzerControl
+ */
+
+#include <array>
+#include <chrono>
+#include <cmath>
+
+#include "IControl.h"
+#include "ISender.h"
+
+BEGIN_IPLUG_NAMESPACE
+BEGIN_IGRAPHICS_NAMESPACE
+
+/** Vectorial multi-channel spectrum analyzer, that shows the log-frequency spectra sent by an ISpectrumSender (see IPlug/Extras/ISpectrumSender.h).
+ * The spectra are smoothed in decibels on the GUI thread, with separate attack and release times, so the display is steady however often the sender publishes
+ * @ingroup IControls */
+template <int MAXNC = 1, int NBINS = 128>
+class IVSpectrumAnalyzerControl : public IControl
+                                , public IVectorBase
+{
+public:
+  /** Constructs an IVSpectrumAnalyzerControl
+   * @param bounds The rectangular area that the control occupies
+   * @param label A CString to label the control
+   * @param style, /see IVStyle
+   * @param floorDB The level at the bottom of the display
+   * @param ceilingDB The level at the top of the display */
+  IVSpectrumAnalyzerControl(const IRECT& bounds, const char* label = "", const IVStyle& style = DEFAULT_STYLE, float floorDB = -90.f, float ceilingDB = 0.f)
+  : IControl(bounds)
+  , IVectorBase(style)
+  , mFloorDB(floorDB)
+  , mCeilingDB(ceilingDB)
+  {
+    for (auto& chan : mSmoothedDB)
+      chan.fill(floorDB);
+
+    AttachIControl(this, label);
+  }
+
+  /** Set the smoothing of the display
+   * @param attackMs The time for the display to rise most of the way to a louder level
+   * @param releaseMs The time for the display to fall most of the way to a quieter level */
+  void SetSmoothing(float attackMs, float releaseMs)
+  {
+    mAttackMs = std::max(attackMs, 0.f);
+    mReleaseMs = std::max(releaseMs, 0.f);
+  }
+
+  void Draw(IGraphics& g) override
+  {
+    DrawBackground(g, mRECT);
+    DrawWidget(g);
+    DrawLabel(g);
+
+    if (mStyle.drawFrame)
+      g.DrawRect(GetColor(kFR), mWidgetBounds, &mBlend, mStyle.frameThickness);
+  }
+
+  void DrawWidget(IGraphics& g) override
+  {
+    const IRECT r = mWidgetBounds.GetPadded(-mPadding);
+
+    for (auto db = std::ceil(mCeilingDB / 20.f) * 20.f; db > mFloorDB; db -= 20.f)
+      g.DrawHorizontalLine(GetColor(kSH), r, (db - mFloorDB) / (mCeilingDB - mFloorDB), &mBlend, mStyle.frameThickness);
+
+    for (auto c = 0; c < MAXNC; c++)
+    {
+      if (!mActive[c])
+        continue;
+
+      for (auto b = 0; b < NBINS; b++)
+      {
+        mPointsX[b] = r.L + r.W() * (b + 0.5f) / NBINS;
+        mPointsY[b] = r.B - r.H() * Clip((mSmoothedDB[c][b] - mFloorDB) / (mCeilingDB - mFloorDB), 0.f, 1.f);
+      }
+
+      g.PathPolyline(mPointsX.data(), mPointsY.data(), NBINS, true);
+      g.PathStroke(GetColor(static_cast<EVColor>(kX1 + (c % 3))), mTrackSize, IStrokeOptions(), &mBlend);
+    }
+  }
+
+  void OnResize() override
+  {
+    SetTargetRECT(MakeRects(mRECT));
+    SetDirty(false);
+  }
+
+  void OnMsgFromDelegate(int msgTag, int dataSize, const void* pData) override
+  {
+    if (IsDisabled() || msgTag != ISender<>::kFrameMessage || dataSize != sizeof(ISenderData<MAXNC, std::array<float, NBINS>>))
+      return;
+
+    const auto* pFrame = static_cast<const ISenderData<MAXNC, std::array<float, NBINS>>*>(pData);
+
+    // the coefficients depend on the time since the last spectrum, as the sender publishes at its own rate
+    const double now = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    const float elapsedMs = mLastTimeMs > 0. ? static_cast<float>(std::min(now - mLastTimeMs, 1000.)) : 1000.f;
+    const float attack = mAttackMs > 0.f ? 1.f - std::exp(-elapsedMs / mAttackMs) : 1.f;
+    const float release = mReleaseMs > 0.f ? 1.f - std::exp(-elapsedMs / mReleaseMs) : 1.f;
+    mLastTimeMs = now;
+
+    for (auto c = pFrame->chanOffset; c < std::min(pFrame->chanOffset + pFrame->nChans, MAXNC); c++)
+    {
+      mActive[c] = true;
+
+      for (auto b = 0; b < NBINS; b++)
+      {
+        const float db = static_cast<float>(AmpToDB(std::max(pFrame->vals[c][b], 1e-9f)));
+        float& smoothed = mSmoothedDB[c][b];
+        smoothed += (db - smoothed) * (db > smoothed ? attack : release);
+      }
+    }
+
+    SetDirty(false);
+  }
+
+private:
+  float mFloorDB;
+  float mCeilingDB;
+  float mAttackMs = 10.f;
+  float mReleaseMs = 300.f;
+  double mLastTimeMs = 0.;
+  float mPadding = 2.f;
+  std::array<std::array<float, NBINS>, MAXNC> mSmoothedDB;
+  std::array<bool, MAXNC> mActive {};
+  std::array<float, NBINS> mPointsX;
+  std::array<float, NBINS> mPointsY;
+};
+
+END_IGRAPHICS_NAMESPACE
+END_IPLUG_NAMESPACE
@@ -72,6 +72,25 @@ static std::string GetFontString(const char* fontName, const char* styleName, do
 
 StaticStorage<IGraphicsCanvas::Font> IGraphicsCanvas::sFontCache;
 
+// Replays the path commands batched by IGraphicsCanvas::FlushPathCommands() in a single call
+EM_JS(void, IPlugInstallPathReplay, (), {
+  Module.IPlugReplayPath = function(ctx, cmds) {
+    var i = 0;
+    while (i < cmds.length) {
+      switch (cmds[i++]) {
+        case 0: ctx.beginPath(); break;
+        case 1: ctx.closePath(); break;
+        case 2: ctx.arc(cmds[i], cmds[i + 1], cmds[i + 2], cmds[i + 3], cmds[i + 4], cmds[i + 5] != 0); i += 6; break;
+        case 3: ctx.moveTo(cmds[i], cmds[i + 1]); i += 2; break;
+        case 4: ctx.lineTo(cmds[i], cmds[i + 1]); i += 2; break;
+        case 5: ctx.bezierCurveTo(cmds[i], cmds[i + 1], cmds[i + 2], cmds[i + 3], cmds[i + 4], cmds[i + 5]); i += 6; break;
+        case 6: ctx.quadraticCurveTo(cmds[i], cmds[i + 1], cmds[i + 2], cmds[i + 3]); i += 4; break;
+        default: return;
+      }
+    }
+  };
+});
+
 #pragma mark - Utilities
 
 BEGIN_IPLUG_NAMESPACE
@@ -94,6 +113,7 @@ IGraphicsCanvas::IGraphicsCanvas(IGEditorDelegate& dlg, int w, int h, int fps, f
 {
   StaticStorage<Font>::Accessor storage(sFontCache);
   storage.Retain();
+  IPlugInstallPathReplay();
 }
 
 IGraphicsCanvas::~IGraphicsCanvas()
@@ -104,6 +124,12 @@ IGraphicsCanvas::~IGraphicsCanvas()
 
 void IGraphicsCanvas::DrawBitmap(const IBitmap& bitmap, const IRECT& bounds, int srcX, int srcY, const IBlend* pBlend)
 {
+  if (mRecordingList) // not recorded by this back-end
+    return;
+
+  ProfileDrawCall(IDrawProfiler::ECall::Bitmap);
+  FlushPathCommands();
+
   val context = GetContext();
   val img = *bitmap.GetAPIBitmap()->GetBitmap();
   context.call<void>("save");
@@ -115,49 +141,145 @@ void IGraphicsCanvas::DrawBitmap(const IBitmap& bitmap, const IRECT& bounds, int
   sr.Scale(bs * bitmap.GetDrawScale());
 
   PathRect(bounds);
+  FlushPathCommands();
   context.call<void>("clip");
-  context.call<void>("drawImage", img, srcX * bs, srcY * bs, sr.W(), sr.H(), bounds.L, bounds.T, bounds.W(), bounds.H());
+  context.call<void>("drawImage", img, (srcX + bitmap.X()) * bs, (srcY + bitmap.Y()) * bs, sr.W(), sr.H(), bounds.L, bounds.T, bounds.W(), bounds.H());
   GetContext().call<void>("restore");
   PathClear();
 }
 
 void IGraphicsCanvas::PathClear()
 {
+  if (mRecordingList)
+  {
+    mRecordingList->Add(IDisplayList::ECommand::Clear);
+    return;
+  }
+
+  if (mBatchPaths)
+  {
+    // beginPath() discards everything since the last flush, so there's no need to send it
+    mPathCommands.Resize(0, false);
+    AddPathCommand(EPathCommand::Clear);
+    return;
+  }
+
   GetContext().call<void>("beginPath");
 }
 
 void IGraphicsCanvas::PathClose()
 {
+  if (mRecordingList)
+  {
+    mRecordingList->Add(IDisplayList::ECommand::Close);
+    return;
+  }
+
+  if (mBatchPaths)
+  {
+    AddPathCommand(EPathCommand::Close);
+    return;
+  }
+
   GetContext().call<void>("closePath");
 }
 
 void IGraphicsCanvas::PathArc(float cx, float cy, float r, float a1, float a2, EWinding winding)
 {
+  if (mRecordingList)
+  {
+    mRecordingList->Add(IDisplayList::ECommand::Arc, cx, cy, r, a1, a2, winding == EWinding::CW ? 1.f : 0.f);
+    return;
+  }
+
+  if (mBatchPaths)
+  {
+    AddPathCommand(EPathCommand::Arc, cx, cy, r, DegToRad(a1 - 90.f), DegToRad(a2 - 90.f), winding == EWinding::CCW ? 1.f : 0.f);
+    return;
+  }
+
   GetContext().call<void>("arc", cx, cy, r, DegToRad(a1 - 90.f), DegToRad(a2 - 90.f), winding == EWinding::CCW);
 }
 
 void IGraphicsCanvas::PathMoveTo(float x, float y)
 {
+  if (mRecordingList)
+  {
+    mRecordingList->Add(IDisplayList::ECommand::MoveTo, x, y);
+    return;
+  }
+
+  if (mBatchPaths)
+  {
+    AddPathCommand(EPathCommand::MoveTo, x, y);
+    return;
+  }
+
   GetContext().call<void>("moveTo", x, y);
 }
 
 void IGraphicsCanvas::PathLineTo(float x, float y)
 {
+  if (mRecordingList)
+  {
+    mRecordingList->Add(IDisplayList::ECommand::LineTo, x, y);
+    return;
+  }
+
+  if (mBatchPaths)
+  {
+    AddPathCommand(EPathCommand::LineTo, x, y);
+    return;
+  }
+
   GetContext().call<void>("lineTo", x, y);
 }
 
 void IGraphicsCanvas::PathCubicBezierTo(float c1x, float c1y, float c2x, float c2y, float x2, float y2)
 {
+  if (mRecordingList)
+  {
+    mRecordingList->Add(IDisplayList::ECommand::CubicBezierTo, c1x, c1y, c2x, c2y, x2, y2);
+    return;
+  }
+
+  if (mBatchPaths)
+  {
+    AddPathCommand(EPathCommand::CubicBezierTo, c1x, c1y, c2x, c2y, x2, y2);
+    return;
+  }
+
   GetContext().call<void>("bezierCurveTo", c1x, c1y, c2x, c2y, x2, y2);
 }
 
 void IGraphicsCanvas::PathQuadraticBezierTo(float cx, float cy, float x2, float y2)
 {
+  if (mRecordingList)
+  {
+    mRecordingList->Add(IDisplayList::ECommand::QuadraticBezierTo, cx, cy, x2, y2);
+    return;
+  }
+
+  if (mBatchPaths)
+  {
+    AddPathCommand(EPathCommand::QuadraticBezierTo, cx, cy, x2, y2);
+    return;
+  }
+
   GetContext().call<void>("quadraticCurveTo", cx, cy, x2, y2);
 }
 
 void IGraphicsCanvas::PathStroke(const IPattern& pattern, float thickness, const IStrokeOptions& options, const IBlend* pBlend)
 {
+  if (mRecordingList)
+  {
+    mRecordingList->AddStroke(pattern, thickness, options, pBlend);
+    return;
+  }
+
+  ProfileDrawCall(IDrawProfiler::ECall::Stroke);
+  FlushPathCommands();
+
   val context = GetContext();
   
   switch (options.mCapOption)
@@ -195,6 +317,15 @@ void IGraphicsCanvas::PathStroke(const IPattern& pattern, float thickness, const
 
 void IGraphicsCanvas::PathFill(const IPattern& pattern, const IFillOptions& options, const IBlend* pBlend)
 {
+  if (mRecordingList)
+  {
+    mRecordingList->AddFill(pattern, options, pBlend);
+    return;
+  }
+
+  ProfileDrawCall(IDrawProfiler::ECall::Fill);
+  FlushPathCommands();
+
   val context = GetContext();
   std::string fillRule(options.mFillRule == EFillRule::Winding ? "nonzero" : "evenodd");
   
@@ -281,6 +412,10 @@ void IGraphicsCanvas::PrepareAndMeasureText(const IText& text, const char* str,
   
   context.set("font", fontString);
   
+  if (FindTextMeasurement(text, str, r, x, y))
+    return;
+  
+  const IRECT anchorRect = r;
   const double textWidth = context.call<val>("measureText", std::string(str))["width"].as<double>();
   const double textHeight = text.mSize;
   const double ascender = pFont->mAscenderRatio * textHeight;
@@ -301,6 +436,7 @@ void IGraphicsCanvas::PrepareAndMeasureText(const IText& text, const char* str,
   }
   
   r = IRECT((float) x, (float) (y - ascender), (float) (x + textWidth), (float) (y + textHeight - ascender));
+  AddTextMeasurement(text, str, anchorRect, r, x, y);
 }
 
 float IGraphicsCanvas::DoMeasureText(const IText& text, const char* str, IRECT& bounds) const
@@ -314,6 +450,11 @@ float IGraphicsCanvas::DoMeasureText(const IText& text, const char* str, IRECT&
 
 void IGraphicsCanvas::DoDrawText(const IText& text, const char* str, const IRECT& bounds, const IBlend* pBlend)
 {
+  if (mRecordingList) // not recorded by this back-end
+    return;
+
+  FlushPathCommands();
+
   IRECT measured = bounds;
   val context = GetContext();
   double x, y;
@@ -329,6 +470,15 @@ void IGraphicsCanvas::DoDrawText(const IText& text, const char* str, const IRECT
 
 void IGraphicsCanvas::PathTransformSetMatrix(const IMatrix& m)
 {
+  if (mRecordingList)
+  {
+    mRecordingList->AddMatrix(m);
+    return;
+  }
+
+  // path points are transformed as they are added, so they must reach the context first
+  FlushPathCommands();
+
   const double scale = GetBackingPixelScale();
   IMatrix t = IMatrix().Scale(scale, scale).Translate(XTranslate(), YTranslate()).Transform(m);
 
@@ -337,6 +487,8 @@ void IGraphicsCanvas::PathTransformSetMatrix(const IMatrix& m)
 
 void IGraphicsCanvas::SetClipRegion(const IRECT& r)
 {
+  FlushPathCommands();
+
   val context = GetContext();
   context.call<void>("restore");
   context.call<void>("save");
@@ -346,6 +498,48 @@ void IGraphicsCanvas::SetClipRegion(const IRECT& r)
   context.call<void>("beginPath");
 }
 
+void IGraphicsCanvas::SetPathBatching(bool enable)
+{
+  FlushPathCommands();
+  mBatchPaths = enable;
+}
+
+void IGraphicsCanvas::EndFrame()
+{
+  FlushPathCommands();
+}
+
+void IGraphicsCanvas::AddPathCommand(EPathCommand cmd, float a, float b, float c, float d, float e, float f)
+{
+  static constexpr int sNumArgs[] = { 0, 0, 6, 2, 2, 6, 4 };
+  
+  if (!mPathCommands.GetSize())
+    mBatchContext = GetContext();
+  
+  const int nArgs = sNumArgs[static_cast<int>(cmd)];
+  const int pos = mPathCommands.GetSize();
+  float* pCmd = mPathCommands.ResizeOK(pos + 1 + nArgs, false);
+  
+  if (!pCmd)
+    return;
+  
+  const float args[] = { a, b, c, d, e, f };
+  pCmd[pos] = static_cast<float>(cmd);
+  memcpy(pCmd + pos + 1, args, nArgs * sizeof(float));
+}
+
+void IGraphicsCanvas::FlushPathCommands()
+{
+  if (!mPathCommands.GetSize())
+    return;
+  
+  // the view onto the wasm heap is only valid until the next allocation, which the replay doesn't make
+  val commands = val(typed_memory_view(mPathCommands.GetSize(), mPathCommands.Get()));
+  val::module_property("IPlugReplayPath")(mBatchContext, commands);
+  mPathCommands.Resize(0, false);
+  mBatchContext = val::undefined();
+}
+
 bool IGraphicsCanvas::BitmapExtSupported(const char* ext)
 {
   char extLower[32];
@@ -355,7 +549,22 @@ bool IGraphicsCanvas::BitmapExtSupported(const char* ext)
 
 APIBitmap* IGraphicsCanvas::LoadAPIBitmap(const char* fileNameOrResID, int scale, EResourceLocation location, const char* ext)
 {
-  return new Bitmap(GetPreloadedImages()[fileNameOrResID], fileNameOrResID + 1, scale);
+  val image = GetPreloadedImages()[fileNameOrResID];
+  
+  if (image.isUndefined())
+  {
+    // not preloaded, so draw a blank bitmap of the right size until the image has been fetched
+    val size = GetLazyImages().isUndefined() ? val::undefined() : GetLazyImages()[fileNameOrResID];
+    
+    if (size.isUndefined())
+      return nullptr;
+    
+    Bitmap* pBitmap = new Bitmap(size[0].as<int>(), size[1].as<int>(), scale, 1.f);
+    val::module_property("IPlugFetchLazyImage")(std::string(fileNameOrResID), *pBitmap->GetBitmap());
+    return pBitmap;
+  }
+  
+  return new Bitmap(image, fileNameOrResID + 1, scale);
 }
 
 APIBitmap* IGraphicsCanvas::LoadAPIBitmap(const char* name, const void* pData, int dataSize, int scale)
@@ -517,6 +726,8 @@ bool IGraphicsCanvas::AssetsLoaded()
 
 void IGraphicsCanvas::GetLayerBitmapData(const ILayerPtr& layer, RawBitmapData& data)
 {
+  FlushPathCommands();
+
   const APIBitmap* pBitmap = layer->GetAPIBitmap();
   int size = pBitmap->GetWidth() * pBitmap->GetHeight() * 4;
   val context = pBitmap->GetBitmap()->call<val>("getContext", std::string("2d"));
@@ -536,6 +747,8 @@ void IGraphicsCanvas::GetLayerBitmapData(const ILayerPtr& layer, RawBitmapData&
 
 void IGraphicsCanvas::ApplyShadowMask(ILayerPtr& layer, RawBitmapData& mask, const IShadow& shadow)
 {
+  FlushPathCommands();
+
   const APIBitmap* pBitmap = layer->GetAPIBitmap();
   int size = pBitmap->GetWidth() * pBitmap->GetHeight() * 4;
   
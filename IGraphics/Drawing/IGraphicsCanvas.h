@@ -43,6 +43,13 @@ public:
 
   void DrawResize() override {};
 
+  void EndFrame() override;
+
+  /** Batch path commands in wasm memory, and replay them with a single call into JavaScript when the path is stroked or filled (or the transform, clip or layer changes),
+   * rather than making a call for every moveTo(), lineTo() etc. This draws the same, but is much faster for complex paths
+   * @param enable \c true to batch path commands */
+  void SetPathBatching(bool enable);
+
   void PathClear() override;
   void PathClose() override;
   void PathArc(float cx, float cy, float r, float a1, float a2, EWinding winding) override;
@@ -77,6 +84,12 @@ protected:
   void DoDrawText(const IText& text, const char* str, const IRECT& bounds, const IBlend* pBlend) override;
     
 private:
+  /** The path commands in mPathCommands, which must match the replay function in IGraphicsCanvas.cpp */
+  enum class EPathCommand { Clear, Close, Arc, MoveTo, LineTo, CubicBezierTo, QuadraticBezierTo };
+  
+  void AddPathCommand(EPathCommand cmd, float a = 0.f, float b = 0.f, float c = 0.f, float d = 0.f, float e = 0.f, float f = 0.f);
+  void FlushPathCommands();
+  
   void PrepareAndMeasureText(const IText& text, const char* str, IRECT& r, double& x, double & y) const;
     
   val GetContext() const
@@ -100,6 +113,10 @@ private:
   void SetCanvasBlendMode(val& context, const IBlend* pBlend);
     
   std::vector<val> mLoadingFonts;
+  
+  bool mBatchPaths = false;
+  WDL_TypedBuf<float> mPathCommands; // each command followed by its arguments
+  val mBatchContext = val::undefined(); // the context that the batched commands are for
 
   static StaticStorage<Font> sFontCache;
 };
@@ -8,6 +8,7 @@
  ==============================================================================
 */
 
+#include <array>
 #include <cmath>
 
 #include "IGraphicsNanoVG.h"
@@ -66,18 +67,56 @@
 
 #include <string>
 #include <map>
+#include <vector>
 
 using namespace iplug;
 using namespace igraphics;
 
 #pragma mark - Private Classes and Structs
 
+#include "stb_image.h"
+
+#if defined IGRAPHICS_GL && defined IGRAPHICS_SHARED_TEXTURES
+
+/** A GL texture owned by no NanoVG context, which every instance whose GL context is in the platform's share group can draw. Deleted when the last Bitmap using it is */
+struct SharedTexture
+{
+  GLuint mTexture = 0;
+  int mWidth = 0;
+  int mHeight = 0;
+  int mRefCount = 0;
+};
+
+static StaticStorage<SharedTexture> sSharedTextureCache;
+
+/** Create a texture with the same parameters as nvgCreateImageRGBA() with no image flags */
+static GLuint CreateSharedGLTexture(int width, int height, const unsigned char* pPixels)
+{
+  GLuint texture = 0;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pPixels);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  
+  return texture;
+}
+#endif
+
 class IGraphicsNanoVG::Bitmap : public APIBitmap
 {
 public:
   Bitmap(NVGcontext* pContext, const char* path, double sourceScale, int nvgImageID, bool shared = false);
   Bitmap(IGraphicsNanoVG* pGraphics, NVGcontext* pContext, int width, int height, float scale, float drawScale);
   Bitmap(NVGcontext* pContext, int width, int height, const uint8_t* pData, float scale, float drawScale);
+#if defined IGRAPHICS_GL && defined IGRAPHICS_SHARED_TEXTURES
+  Bitmap(NVGcontext* pContext, SharedTexture* pTexture, double sourceScale);
+#endif
   virtual ~Bitmap();
   NVGframebuffer* GetFBO() const { return mFBO; }
 private:
@@ -85,6 +124,9 @@ private:
   NVGcontext* mVG;
   NVGframebuffer* mFBO = nullptr;
   bool mSharedTexture = false;
+#if defined IGRAPHICS_GL && defined IGRAPHICS_SHARED_TEXTURES
+  SharedTexture* mSharedGLTexture = nullptr;
+#endif
 };
 
 IGraphicsNanoVG::Bitmap::Bitmap(NVGcontext* pContext, const char* path, double sourceScale, int nvgImageID, bool shared)
@@ -127,8 +169,40 @@ IGraphicsNanoVG::Bitmap::Bitmap(NVGcontext* pContext, int width, int height, con
   SetBitmap(idx, width, height, scale, drawScale);
 }
 
+#if defined IGRAPHICS_GL && defined IGRAPHICS_SHARED_TEXTURES
+IGraphicsNanoVG::Bitmap::Bitmap(NVGcontext* pContext, SharedTexture* pTexture, double sourceScale)
+{
+  // N.B. the caller holds the lock on sSharedTextureCache
+  mVG = pContext;
+  mSharedGLTexture = pTexture;
+  mSharedGLTexture->mRefCount++;
+  
+  const int nvgImageID = nvglCreateImageFromHandle(mVG, pTexture->mTexture, pTexture->mWidth, pTexture->mHeight, NVG_IMAGE_NODELETE);
+  
+  SetBitmap(nvgImageID, pTexture->mWidth, pTexture->mHeight, sourceScale, 1.f);
+}
+#endif
+
 IGraphicsNanoVG::Bitmap::~Bitmap()
 {
+#if defined IGRAPHICS_GL && defined IGRAPHICS_SHARED_TEXTURES
+  if (mSharedGLTexture)
+  {
+    // the image was created with NVG_IMAGE_NODELETE, so this leaves the texture for the other instances
+    nvgDeleteImage(mVG, GetBitmap());
+    
+    StaticStorage<SharedTexture>::Accessor storage(sSharedTextureCache);
+    
+    if (--mSharedGLTexture->mRefCount == 0)
+    {
+      glDeleteTextures(1, &mSharedGLTexture->mTexture);
+      storage.Remove(mSharedGLTexture);
+    }
+    
+    return;
+  }
+#endif
+  
   if(!mSharedTexture)
   {
     if(mFBO)
@@ -153,6 +227,91 @@ static void nvgReadPixels(NVGcontext* pContext, int image, int x, int y, int wid
 #endif
 }
 
+// Compressed textures
+#if defined IGRAPHICS_GL
+  #ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+    #define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+  #endif
+  #ifndef GL_COMPRESSED_RGBA_ASTC_4x4_KHR
+    #define GL_COMPRESSED_RGBA_ASTC_4x4_KHR 0x93B0
+  #endif
+#endif
+
+/** Create an image from the first mip level of a KTX (version 1) file holding a BC7 or ASTC 4x4 texture, see Scripts/make_compressed_textures.py
+ * @return The NanoVG image, or 0 if the file is not valid or the GPU doesn't support the format. The GL context must be current */
+static int nvgCreateCompressedImage(NVGcontext* pContext, const uint8_t* pData, int size)
+{
+  static const uint8_t kIdentifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+  static const int kHeaderSize = 64;
+
+  if (size < kHeaderSize + 4 || memcmp(pData, kIdentifier, sizeof(kIdentifier)))
+    return 0;
+
+  auto getU32 = [pData](int offset) {
+    uint32_t value;
+    memcpy(&value, pData + offset, sizeof(value));
+    return value;
+  };
+
+  // the fields after the identifier: endianness, glType, glTypeSize, glFormat, glInternalFormat, glBaseInternalFormat, width, height, ... bytesOfKeyValueData
+  if (getU32(12) != 0x04030201)
+    return 0;
+
+  const uint32_t internalFormat = getU32(28);
+  const int width = static_cast<int>(getU32(36));
+  const int height = static_cast<int>(getU32(40));
+  const uint32_t imageOffset = kHeaderSize + getU32(60);
+
+  if (width <= 0 || height <= 0 || imageOffset > static_cast<uint32_t>(size - 4))
+    return 0;
+
+  const uint32_t imageSize = getU32(imageOffset);
+  const uint8_t* pImage = pData + imageOffset + 4;
+
+  if (imageSize > static_cast<uint32_t>(size) - imageOffset - 4)
+    return 0;
+
+#if defined IGRAPHICS_GL
+  if (internalFormat != GL_COMPRESSED_RGBA_BPTC_UNORM && internalFormat != GL_COMPRESSED_RGBA_ASTC_4x4_KHR)
+    return 0;
+
+  while (glGetError() != GL_NO_ERROR) {}
+
+  GLuint texture = 0;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glCompressedTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, static_cast<GLsizei>(imageSize), pImage);
+
+  // the driver doesn't support the format
+  if (glGetError() != GL_NO_ERROR)
+  {
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glDeleteTextures(1, &texture);
+    return 0;
+  }
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  // NanoVG owns the texture, and deletes it with the image
+  return nvglCreateImageFromHandle(pContext, texture, width, height, 0);
+#elif defined IGRAPHICS_METAL
+  MNVGcompressedFormat format;
+
+  if (internalFormat == 0x8E8C) // GL_COMPRESSED_RGBA_BPTC_UNORM
+    format = MNVG_COMPRESSED_BC7;
+  else if (internalFormat == 0x93B0) // GL_COMPRESSED_RGBA_ASTC_4x4_KHR
+    format = MNVG_COMPRESSED_ASTC_4X4;
+  else
+    return 0;
+
+  return mnvgCreateCompressedImage(pContext, format, width, height, pImage, static_cast<int>(imageSize), 0);
+#endif
+}
+
 #pragma mark - Utilities
 
 BEGIN_IPLUG_NAMESPACE
@@ -278,6 +437,13 @@ IBitmap IGraphicsNanoVG::LoadBitmap(const char* name, int nStates, bool framesAr
   StaticStorage<APIBitmap>::Accessor storage(mBitmapCache);
   APIBitmap* pAPIBitmap = storage.Find(name, targetScale);
   
+  // Draw a higher scale that is already loaded, rather than decoding another file
+  if (!pAPIBitmap && GetDerivedBitmapScales())
+  {
+    for (int scale = MAX_IMG_SCALE; scale > targetScale && !pAPIBitmap; scale--)
+      pAPIBitmap = storage.Find(name, scale);
+  }
+
   // If the bitmap is not already cached at the targetScale
   if (!pAPIBitmap)
   {
@@ -297,7 +463,13 @@ IBitmap IGraphicsNanoVG::LoadBitmap(const char* name, int nStates, bool framesAr
       return IBitmap(); // return invalid IBitmap
     }
 
-    pAPIBitmap = LoadAPIBitmap(fullPathOrResourceID.Get(), sourceScale, resourceFound, ext);
+    // the pixels decoded by PrefetchBitmaps() may be for a higher scale
+    pAPIBitmap = LoadPrefetchedAPIBitmap(name, sourceScale);
+
+    if (pAPIBitmap)
+      sourceScale = pAPIBitmap->GetScale();
+    else
+      pAPIBitmap = LoadAPIBitmap(fullPathOrResourceID.Get(), sourceScale, resourceFound, ext);
     
     storage.Add(pAPIBitmap, name, sourceScale);
 
@@ -309,6 +481,17 @@ IBitmap IGraphicsNanoVG::LoadBitmap(const char* name, int nStates, bool framesAr
 
 APIBitmap* IGraphicsNanoVG::LoadAPIBitmap(const char* fileNameOrResID, int scale, EResourceLocation location, const char* ext)
 {
+#if defined IGRAPHICS_GL && defined IGRAPHICS_SHARED_TEXTURES
+  if (GLContextIsShared())
+  {
+    if (APIBitmap* pBitmap = LoadSharedAPIBitmap(fileNameOrResID, scale, location, ext, nullptr, 0))
+      return pBitmap;
+  }
+#endif
+  
+  if (APIBitmap* pBitmap = LoadCompressedAPIBitmap(fileNameOrResID, scale, location))
+    return pBitmap;
+
   int idx = 0;
   int nvgImageFlags = 0;
   
@@ -347,6 +530,124 @@ APIBitmap* IGraphicsNanoVG::LoadAPIBitmap(const char* fileNameOrResID, int scale
   return new Bitmap(mVG, fileNameOrResID, scale, idx, location == EResourceLocation::kPreloadedTexture);
 }
 
+bool IGraphicsNanoVG::DecodeAPIBitmap(const char* fileNameOrResID, EResourceLocation location, const char* ext, int& width, int& height, RawBitmapData& pixels)
+{
+  const void* pData = nullptr;
+  int dataSize = 0;
+
+#ifdef OS_WIN
+  if (location == EResourceLocation::kWinBinary)
+  {
+    int ktxSize = 0;
+
+    // a compressed texture is loaded instead, see LoadCompressedAPIBitmap()
+    if (LoadWinResource(fileNameOrResID, "ktx", ktxSize, GetWinModuleHandle()))
+      return false;
+
+    pData = LoadWinResource(fileNameOrResID, ext, dataSize, GetWinModuleHandle());
+
+    if (!pData)
+      return false;
+  }
+  else
+#endif
+  if (location == EResourceLocation::kAbsolutePath)
+  {
+    WDL_String ktxPath(fileNameOrResID);
+    ktxPath.Append(".ktx");
+
+    if (FILE* pFile = fopen(ktxPath.Get(), "rb"))
+    {
+      fclose(pFile);
+      return false;
+    }
+  }
+  else
+  {
+    return false;
+  }
+
+  int n = 0;
+
+  // decode in the same way as nvgCreateImage()
+  stbi_set_unpremultiply_on_load(1);
+  stbi_convert_iphone_png_to_rgb(1);
+
+  unsigned char* pPixels = pData ? stbi_load_from_memory((const stbi_uc*) pData, dataSize, &width, &height, &n, 4)
+                                 : stbi_load(fileNameOrResID, &width, &height, &n, 4);
+
+  if (!pPixels)
+    return false;
+
+  pixels.Resize(width * height * 4);
+  memcpy(pixels.Get(), pPixels, pixels.GetSize());
+  stbi_image_free(pPixels);
+
+  return true;
+}
+
+APIBitmap* IGraphicsNanoVG::CreateAPIBitmapFromPixels(int width, int height, const uint8_t* pPixels, int rowBytes, float scale)
+{
+  // the pixels are straight RGBA, as decoded by DecodeAPIBitmap()
+  if (rowBytes != width * 4)
+    return nullptr;
+
+  ActivateGLContext(); // no-op on non WIN/GL
+  APIBitmap* pBitmap = new Bitmap(mVG, width, height, pPixels, scale, 1.f);
+  DeactivateGLContext(); // no-op on non WIN/GL
+
+  return pBitmap;
+}
+
+APIBitmap* IGraphicsNanoVG::LoadCompressedAPIBitmap(const char* fileNameOrResID, int scale, EResourceLocation location)
+{
+  std::vector<uint8_t> fileData;
+  const uint8_t* pData = nullptr;
+  int size = 0;
+
+#ifdef OS_WIN
+  if (location == EResourceLocation::kWinBinary)
+  {
+    pData = static_cast<const uint8_t*>(LoadWinResource(fileNameOrResID, "ktx", size, GetWinModuleHandle()));
+  }
+  else
+#endif
+  if (location == EResourceLocation::kAbsolutePath)
+  {
+    WDL_String path(fileNameOrResID);
+    path.Append(".ktx");
+
+    if (FILE* pFile = fopen(path.Get(), "rb"))
+    {
+      fseek(pFile, 0, SEEK_END);
+      const long fileSize = ftell(pFile);
+      fseek(pFile, 0, SEEK_SET);
+
+      if (fileSize > 0)
+      {
+        fileData.resize(fileSize);
+
+        if (fread(fileData.data(), 1, fileData.size(), pFile) == fileData.size())
+        {
+          pData = fileData.data();
+          size = static_cast<int>(fileSize);
+        }
+      }
+
+      fclose(pFile);
+    }
+  }
+
+  if (!pData || size <= 0)
+    return nullptr;
+
+  ActivateGLContext(); // no-op on non WIN/GL
+  const int idx = nvgCreateCompressedImage(mVG, pData, size);
+  DeactivateGLContext(); // no-op on non WIN/GL
+
+  return idx ? new Bitmap(mVG, fileNameOrResID, scale, idx) : nullptr;
+}
+
 APIBitmap* IGraphicsNanoVG::LoadAPIBitmap(const char* name, const void* pData, int dataSize, int scale)
 {
   StaticStorage<APIBitmap>::Accessor storage(mBitmapCache);
@@ -354,14 +655,22 @@ APIBitmap* IGraphicsNanoVG::LoadAPIBitmap(const char* name, const void* pData, i
 
   if (!pBitmap)
   {
-    int idx = 0;
-    int nvgImageFlags = 0;
+#if defined IGRAPHICS_GL && defined IGRAPHICS_SHARED_TEXTURES
+    if (GLContextIsShared())
+      pBitmap = LoadSharedAPIBitmap(name, scale, EResourceLocation::kNotFound, nullptr, pData, dataSize);
+    
+    if (!pBitmap)
+#endif
+    {
+      int idx = 0;
+      int nvgImageFlags = 0;
 
-    ActivateGLContext();
-    idx = idx = nvgCreateImageMem(mVG, nvgImageFlags, (unsigned char*)pData, dataSize);
-    DeactivateGLContext();
+      ActivateGLContext();
+      idx = idx = nvgCreateImageMem(mVG, nvgImageFlags, (unsigned char*)pData, dataSize);
+      DeactivateGLContext();
 
-    pBitmap = new Bitmap(mVG, name, scale, idx, false);
+      pBitmap = new Bitmap(mVG, name, scale, idx, false);
+    }
 
     storage.Add(pBitmap, name, scale);
   }
@@ -369,6 +678,54 @@ APIBitmap* IGraphicsNanoVG::LoadAPIBitmap(const char* name, const void* pData, i
   return pBitmap;
 }
 
+#if defined IGRAPHICS_GL && defined IGRAPHICS_SHARED_TEXTURES
+APIBitmap* IGraphicsNanoVG::LoadSharedAPIBitmap(const char* name, int scale, EResourceLocation location, const char* ext, const void* pData, int dataSize)
+{
+  StaticStorage<SharedTexture>::Accessor storage(sSharedTextureCache);
+  SharedTexture* pTexture = storage.Find(name, scale);
+  
+  if (!pTexture)
+  {
+    int w = 0, h = 0, n = 0;
+    unsigned char* pPixels = nullptr;
+    
+    // decode in the same way as nvgCreateImage()
+    stbi_set_unpremultiply_on_load(1);
+    stbi_convert_iphone_png_to_rgb(1);
+    
+#ifdef OS_WIN
+    if (location == EResourceLocation::kWinBinary)
+      pData = LoadWinResource(name, ext, dataSize, GetWinModuleHandle());
+#endif
+    
+    if (pData)
+      pPixels = stbi_load_from_memory((const stbi_uc*) pData, dataSize, &w, &h, &n, 4);
+    else if (location == EResourceLocation::kAbsolutePath)
+      pPixels = stbi_load(name, &w, &h, &n, 4);
+    
+    if (!pPixels)
+      return nullptr;
+    
+    pTexture = new SharedTexture;
+    pTexture->mWidth = w;
+    pTexture->mHeight = h;
+    
+    ActivateGLContext(); // no-op on non WIN/GL
+    pTexture->mTexture = CreateSharedGLTexture(w, h, pPixels);
+    DeactivateGLContext(); // no-op on non WIN/GL
+    
+    stbi_image_free(pPixels);
+    storage.Add(pTexture, name, scale);
+  }
+  
+  ActivateGLContext(); // no-op on non WIN/GL
+  APIBitmap* pBitmap = new Bitmap(mVG, pTexture, scale);
+  DeactivateGLContext(); // no-op on non WIN/GL
+  
+  return pBitmap;
+}
+#endif
+
 APIBitmap* IGraphicsNanoVG::CreateAPIBitmap(int width, int height, float scale, double drawScale, bool cacheable)
 {
   if (mInDraw)
@@ -446,12 +803,125 @@ void IGraphicsNanoVG::ApplyShadowMask(ILayerPtr& layer, RawBitmapData& mask, con
   }
 }
 
+void IGraphicsNanoVG::DrawBlurPass(const APIBitmap* pSource, const IRECT& bounds, float blurSize, bool vertical)
+{
+  static constexpr int kMaxTaps = 8; // on each side of the centre
+  
+  // the CPU blur's kernel, with taps spread out for large blurs, relying on the bilinear filtering of the layer's texture in between
+  const int extent = static_cast<int>(std::ceil(blurSize)) - 1;
+  const int step = std::max(1, (extent + kMaxTaps - 1) / kMaxTaps);
+  const float blurConst = 4.5f / (blurSize * blurSize);
+  const float pixelScale = pSource->GetScale() * pSource->GetDrawScale();
+  
+  std::array<float, kMaxTaps + 1> weights;
+  int nTaps = 0;
+  float norm = 0.f;
+  
+  for (int i = 0; i <= extent && nTaps <= kMaxTaps; i += step)
+  {
+    weights[nTaps] = std::exp(-(i * i) * blurConst);
+    norm += nTaps ? 2.f * weights[nTaps] : weights[nTaps];
+    nTaps++;
+  }
+  
+  NVGpaint imgPaint;
+  nvgTransformScale(imgPaint.xform, 1.0 / pixelScale, 1.0 / pixelScale);
+  imgPaint.extent[0] = pSource->GetWidth();
+  imgPaint.extent[1] = pSource->GetHeight();
+  imgPaint.image = pSource->GetBitmap();
+  imgPaint.radius = imgPaint.feather = 0.f;
+  
+  // accumulate the weighted, offset copies of the source
+  nvgGlobalCompositeBlendFunc(mVG, NVG_ONE, NVG_ONE);
+  
+  for (int t = 1 - nTaps; t < nTaps; t++)
+  {
+    const float offset = static_cast<float>(t * step) / pixelScale;
+    imgPaint.xform[4] = bounds.L + (vertical ? 0.f : offset);
+    imgPaint.xform[5] = bounds.T + (vertical ? offset : 0.f);
+    imgPaint.innerColor = imgPaint.outerColor = nvgRGBAf(1, 1, 1, weights[std::abs(t)] / norm);
+    
+    nvgBeginPath(mVG);
+    nvgRect(mVG, bounds.L, bounds.T, bounds.W(), bounds.H());
+    nvgFillPaint(mVG, imgPaint);
+    nvgFill(mVG);
+  }
+  
+  nvgGlobalCompositeOperation(mVG, NVG_SOURCE_OVER);
+  nvgBeginPath(mVG);
+}
+
+bool IGraphicsNanoVG::ApplyGPULayerDropShadow(ILayerPtr& layer, const IShadow& shadow)
+{
+  const APIBitmap* pBitmap = layer->GetAPIBitmap();
+  const int width = pBitmap->GetWidth();
+  const int height = pBitmap->GetHeight();
+  const float blurSize = GetShadowBlurSize(layer, shadow);
+  
+  // a separable gaussian, horizontally into one layer and vertically from that into another, all on the GPU
+  // the temporary layers own their bitmaps
+  APIBitmap* horizontalBitmap = CreateAPIBitmap(width, height, pBitmap->GetScale(), pBitmap->GetDrawScale());
+  APIBitmap* shadowBitmap = CreateAPIBitmap(width, height, pBitmap->GetScale(), pBitmap->GetDrawScale());
+  ILayer horizontalLayer(horizontalBitmap, layer->Bounds(), nullptr, IRECT());
+  ILayer shadowLayer(shadowBitmap, layer->Bounds(), nullptr, IRECT());
+  IBitmap shadowLayerBitmap(shadowBitmap, 1, false);
+  
+  IRECT bounds(layer->Bounds());
+  
+  PathTransformSave();
+  
+  PushLayer(&horizontalLayer);
+  DrawBlurPass(pBitmap, bounds, blurSize, false);
+  PopLayer();
+  
+  PushLayer(&shadowLayer);
+  DrawBlurPass(horizontalBitmap, bounds, blurSize, true);
+  IBlend blend1(EBlend::SrcIn, 1.0);
+  PathRect(layer->Bounds());
+  PathFill(shadow.mPattern, IFillOptions(), &blend1);
+  PopLayer();
+  
+  PushLayer(layer.get());
+  
+  if (!shadow.mDrawForeground)
+  {
+    nvgGlobalCompositeBlendFunc(mVG, NVG_ZERO, NVG_ZERO);
+    PathRect(layer->Bounds());
+    nvgFillColor(mVG, NanoVGColor(COLOR_TRANSPARENT));
+    nvgFill(mVG);
+    nvgGlobalCompositeOperation(mVG, NVG_SOURCE_OVER);
+  }
+  
+  IBlend blend2(EBlend::DstOver, shadow.mOpacity);
+  bounds.Translate(shadow.mXOffset, shadow.mYOffset);
+  DrawBitmap(shadowLayerBitmap, bounds, 0, 0, &blend2);
+  PopLayer();
+  
+  PathTransformRestore();
+  
+  return true;
+}
+
 void IGraphicsNanoVG::OnViewInitialized(void* pContext)
 {  
 #if defined IGRAPHICS_METAL
   mVG = nvgCreateContext(pContext, NVG_ANTIALIAS | NVG_TRIPLE_BUFFER); //TODO: NVG_STENCIL_STROKES currently has issues
+
+  if (mVG && *GetShaderCachePath())
+  {
+    WDL_String archivePath(GetShaderCachePath());
+    archivePath.AppendFormatted(32, "%cnanovg.metallib", WDL_DIRCHAR);
+
+    if (!mnvgSetBinaryArchivePath(mVG, archivePath.Get()))
+      DBGMSG("Could not use a Metal binary archive for NanoVG.\n");
+  }
 #else
   mVG = nvgCreateContext(NVG_ANTIALIAS /*| NVG_STENCIL_STROKES*/);
+
+  #ifdef IGRAPHICS_NANOVG_SDF_TEXT // glyphs are kept as distance fields and scaled, rather than rasterized at every size and scale. Not with Metal, whose shaders are precompiled
+  if (mVG)
+    nvgTextSDF(mVG, 1);
+  #endif
 #endif
 
   if (mVG == nullptr)
@@ -498,8 +968,10 @@ void IGraphicsNanoVG::BeginFrame()
 
 #ifdef IGRAPHICS_GL
     glViewport(0, 0, WindowWidth() * GetScreenScale(), WindowHeight() * GetScreenScale());
+  #ifndef IGRAPHICS_PRESERVE_BACKBUFFER // cleared in EndFrame(), only where the frame is composited
     glClearColor(0.f, 0.f, 0.f, 0.f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+  #endif
   #if defined OS_MAC
     glGetIntegerv(GL_FRAMEBUFFER_BINDING, &mInitialFBO); // stash apple fbo
   #endif
@@ -517,11 +989,20 @@ void IGraphicsNanoVG::EndFrame()
   
   NVGpaint img = nvgImagePattern(mVG, 0, 0, WindowWidth(), WindowHeight(), 0, mMainFrameBuffer->image, 1.0f);
 
+#if defined IGRAPHICS_GL && defined IGRAPHICS_PRESERVE_BACKBUFFER
+  // the back buffer still holds the previous frame, so only the regions drawn in this frame are copied from the FBO
+  IRECT composite = mCompositeRECT.GetScaled(GetDrawScale()).Intersect(IRECT(0, 0, WindowWidth(), WindowHeight()));
+  composite.PixelAlign(GetScreenScale());
+  mCompositeRECT = IRECT();
+#else
+  const IRECT composite(0, 0, WindowWidth(), WindowHeight());
+#endif
+
   nvgSave(mVG);
   nvgResetTransform(mVG);
   nvgTranslate(mVG, mXTranslation, mYTranslation);
   nvgBeginPath(mVG);
-  nvgRect(mVG, 0, 0, WindowWidth(), WindowHeight());
+  nvgRect(mVG, composite.L, composite.T, composite.W(), composite.H());
   nvgFillPaint(mVG, img);
   nvgFill(mVG);
   nvgRestore(mVG);
@@ -530,14 +1011,60 @@ void IGraphicsNanoVG::EndFrame()
   glBindFramebuffer(GL_FRAMEBUFFER, mInitialFBO); // restore apple fbo
 #endif
 
+#if defined IGRAPHICS_GL && defined IGRAPHICS_PRESERVE_BACKBUFFER
+  // the composite is blended, so clear what it covers first. NanoVG disables the scissor test itself when it renders
+  const float screenScale = GetScreenScale();
+  glEnable(GL_SCISSOR_TEST);
+  glScissor(static_cast<GLint>((composite.L + mXTranslation) * screenScale), static_cast<GLint>((WindowHeight() - composite.B - mYTranslation) * screenScale),
+            static_cast<GLsizei>(composite.W() * screenScale), static_cast<GLsizei>(composite.H() * screenScale));
+  glClearColor(0.f, 0.f, 0.f, 0.f);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+  glDisable(GL_SCISSOR_TEST);
+#endif
+
   nvgEndFrame(mVG);
   
   mInDraw = false;
   ClearFBOStack();
 }
 
+bool IGraphicsNanoVG::BeginOffscreenDraw()
+{
+  // the context only exists while the view does, and it must be current on this thread
+  if (!mVG || !mMainFrameBuffer || mInDraw)
+    return false;
+
+  mInDraw = true;
+
+#if defined OS_MAC && defined IGRAPHICS_GL
+  glGetIntegerv(GL_FRAMEBUFFER_BINDING, &mInitialFBO); // stash apple fbo
+#endif
+
+  nvgBindFramebuffer(mMainFrameBuffer);
+  nvgBeginFrame(mVG, WindowWidth(), WindowHeight(), GetScreenScale());
+  return true;
+}
+
+void IGraphicsNanoVG::EndOffscreenDraw()
+{
+  nvgEndFrame(mVG);
+  nvgBindFramebuffer(nullptr);
+
+#if defined OS_MAC && defined IGRAPHICS_GL
+  glBindFramebuffer(GL_FRAMEBUFFER, mInitialFBO); // restore apple fbo
+#endif
+
+  mInDraw = false;
+  ClearFBOStack();
+}
+
 void IGraphicsNanoVG::DrawBitmap(const IBitmap& bitmap, const IRECT& dest, int srcX, int srcY, const IBlend* pBlend)
 {
+  if (mRecordingList) // not recorded by this back-end
+    return;
+
+  ProfileDrawCall(IDrawProfiler::ECall::Bitmap);
+
   APIBitmap* pAPIBitmap = bitmap.GetAPIBitmap();
   
   assert(pAPIBitmap);
@@ -548,10 +1075,11 @@ void IGraphicsNanoVG::DrawBitmap(const IBitmap& bitmap, const IRECT& dest, int s
 
   nvgTransformScale(imgPaint.xform, scale, scale);
 
-  imgPaint.xform[4] = dest.L - srcX;
-  imgPaint.xform[5] = dest.T - srcY;
-  imgPaint.extent[0] = bitmap.W() * bitmap.GetScale();
-  imgPaint.extent[1] = bitmap.H() * bitmap.GetScale();
+  // the extent is that of the whole image, which may be an atlas page containing the bitmap
+  imgPaint.xform[4] = dest.L - (srcX + bitmap.X());
+  imgPaint.xform[5] = dest.T - (srcY + bitmap.Y());
+  imgPaint.extent[0] = pAPIBitmap->GetWidth();
+  imgPaint.extent[1] = pAPIBitmap->GetHeight();
   imgPaint.image = pAPIBitmap->GetBitmap();
   imgPaint.radius = imgPaint.feather = 0.f;
   imgPaint.innerColor = imgPaint.outerColor = nvgRGBAf(1, 1, 1, BlendWeight(pBlend));
@@ -569,41 +1097,106 @@ void IGraphicsNanoVG::DrawBitmap(const IBitmap& bitmap, const IRECT& dest, int s
 
 void IGraphicsNanoVG::PathClear()
 {
+  if (mRecordingList)
+  {
+    mRecordingList->Add(IDisplayList::ECommand::Clear);
+    return;
+  }
+
   nvgBeginPath(mVG);
 }
 
 void IGraphicsNanoVG::PathClose()
 {
+  if (mRecordingList)
+  {
+    mRecordingList->Add(IDisplayList::ECommand::Close);
+    return;
+  }
+
   nvgClosePath(mVG);
 }
 
 void IGraphicsNanoVG::PathArc(float cx, float cy, float r, float a1, float a2, EWinding winding)
 {
+  if (mRecordingList)
+  {
+    mRecordingList->Add(IDisplayList::ECommand::Arc, cx, cy, r, a1, a2, winding == EWinding::CW ? 1.f : 0.f);
+    return;
+  }
+
   nvgArc(mVG, cx, cy, r, DegToRad(a1 - 90.f), DegToRad(a2 - 90.f), winding == EWinding::CW ? NVG_CW : NVG_CCW);
 }
 
 void IGraphicsNanoVG::PathMoveTo(float x, float y)
 {
+  if (mRecordingList)
+  {
+    mRecordingList->Add(IDisplayList::ECommand::MoveTo, x, y);
+    return;
+  }
+
   nvgMoveTo(mVG, x, y);
 }
 
 void IGraphicsNanoVG::PathLineTo(float x, float y)
 {
+  if (mRecordingList)
+  {
+    mRecordingList->Add(IDisplayList::ECommand::LineTo, x, y);
+    return;
+  }
+
   nvgLineTo(mVG, x, y);
 }
 
+void IGraphicsNanoVG::DoPathPolyline(const float* x, const float* y, int nPoints, bool moveToFirst)
+{
+  if (mRecordingList)
+  {
+    IGraphics::DoPathPolyline(x, y, nPoints, moveToFirst);
+    return;
+  }
+
+  if (moveToFirst)
+    nvgMoveTo(mVG, x[0], y[0]);
+  else
+    nvgLineTo(mVG, x[0], y[0]);
+
+  for (auto i = 1; i < nPoints; i++)
+    nvgLineTo(mVG, x[i], y[i]);
+}
+
 void IGraphicsNanoVG::PathCubicBezierTo(float c1x, float c1y, float c2x, float c2y, float x2, float y2)
 {
+  if (mRecordingList)
+  {
+    mRecordingList->Add(IDisplayList::ECommand::CubicBezierTo, c1x, c1y, c2x, c2y, x2, y2);
+    return;
+  }
+
   nvgBezierTo(mVG, c1x, c1y, c2x, c2y, x2, y2);
 }
 
 void IGraphicsNanoVG::PathQuadraticBezierTo(float cx, float cy, float x2, float y2)
 {
+  if (mRecordingList)
+  {
+    mRecordingList->Add(IDisplayList::ECommand::QuadraticBezierTo, cx, cy, x2, y2);
+    return;
+  }
+
   nvgQuadTo(mVG, cx, cy, x2, y2);
 }
 
 void IGraphicsNanoVG::PathSetWinding(bool clockwise)
 {
+  if (mRecordingList)
+  {
+    mRecordingList->Add(IDisplayList::ECommand::SetWinding, clockwise ? 1.f : 0.f);
+    return;
+  }
+
   nvgPathWinding(mVG, clockwise ? NVG_CW : NVG_CCW);
 }
 
@@ -639,9 +1232,15 @@ void IGraphicsNanoVG::PrepareAndMeasureText(const IText& text, const char* str,
   }
   
   nvgTextAlign(mVG, align);
+  
+  if (FindTextMeasurement(text, str, r, x, y))
+    return;
+  
+  const IRECT anchorRect = r;
   nvgTextBounds(mVG, x, y, str, NULL, fbounds);
   
   r = IRECT(fbounds[0], fbounds[1], fbounds[2], fbounds[3]);
+  AddTextMeasurement(text, str, anchorRect, r, x, y);
 }
 
 float IGraphicsNanoVG::DoMeasureText(const IText& text, const char* str, IRECT& bounds) const
@@ -656,6 +1255,9 @@ float IGraphicsNanoVG::DoMeasureText(const IText& text, const char* str, IRECT&
 
 void IGraphicsNanoVG::DoDrawText(const IText& text, const char* str, const IRECT& bounds, const IBlend* pBlend)
 {
+  if (mRecordingList) // not recorded by this back-end
+    return;
+
   IRECT measured = bounds;
   double x, y;
   
@@ -671,6 +1273,14 @@ void IGraphicsNanoVG::DoDrawText(const IText& text, const char* str, const IRECT
 
 void IGraphicsNanoVG::PathStroke(const IPattern& pattern, float thickness, const IStrokeOptions& options, const IBlend* pBlend)
 {
+  if (mRecordingList)
+  {
+    mRecordingList->AddStroke(pattern, thickness, options, pBlend);
+    return;
+  }
+
+  ProfileDrawCall(IDrawProfiler::ECall::Stroke);
+
   // First set options
   switch (options.mCapOption)
   {
@@ -706,6 +1316,14 @@ void IGraphicsNanoVG::PathStroke(const IPattern& pattern, float thickness, const
 
 void IGraphicsNanoVG::PathFill(const IPattern& pattern, const IFillOptions& options, const IBlend* pBlend)
 {
+  if (mRecordingList)
+  {
+    mRecordingList->AddFill(pattern, options, pBlend);
+    return;
+  }
+
+  ProfileDrawCall(IDrawProfiler::ECall::Fill);
+
   switch(options.mFillRule)
   {
     // This concept of fill vs. even/odd winding does not really translate to nanovg.
@@ -758,6 +1376,259 @@ bool IGraphicsNanoVG::LoadAPIFont(const char* fontID, const PlatformFontPtr& fon
   return false;
 }
 
+#pragma mark - Shaders
+
+/** A fragment shader drawn over a rectangle, a GL program with a quad, or a Metal pipeline, see IGraphics::CreateAPIShader() */
+class IGraphicsNanoVG::Shader : public APIShader
+{
+public:
+#if defined IGRAPHICS_GL
+  Shader(GLuint program, int nUniforms)
+  : APIShader(nUniforms)
+  , mProgram(program)
+  {
+    mSizeLocation = glGetUniformLocation(mProgram, "uSize");
+    mDataLocation = glGetUniformLocation(mProgram, "uData");
+
+    static const float quad[] = { -1.f, 1.f, 1.f, 1.f, -1.f, -1.f, 1.f, -1.f };
+  #if defined IGRAPHICS_GL3 || defined IGRAPHICS_GLES3
+    glGenVertexArrays(1, &mVertexArray);
+    glBindVertexArray(mVertexArray);
+  #endif
+    glGenBuffers(1, &mVertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, mVertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+  #if defined IGRAPHICS_GL3 || defined IGRAPHICS_GLES3
+    glBindVertexArray(0);
+  #endif
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+
+  ~Shader()
+  {
+    glDeleteBuffers(1, &mVertexBuffer);
+  #if defined IGRAPHICS_GL3 || defined IGRAPHICS_GLES3
+    glDeleteVertexArrays(1, &mVertexArray);
+  #endif
+    glDeleteProgram(mProgram);
+  }
+
+  void Draw(int x, int y, int width, int height, const float* pUniforms)
+  {
+    glViewport(x, y, width, height);
+    glDisable(GL_BLEND);
+    glDisable(GL_CULL_FACE);
+    glDisable(GL_SCISSOR_TEST);
+    glDisable(GL_STENCIL_TEST);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+
+    glUseProgram(mProgram);
+    glUniform2f(mSizeLocation, static_cast<float>(width), static_cast<float>(height));
+    if (NUniforms())
+      glUniform1fv(mDataLocation, NUniforms(), pUniforms);
+
+  #if defined IGRAPHICS_GL3 || defined IGRAPHICS_GLES3
+    glBindVertexArray(mVertexArray);
+  #else
+    glBindBuffer(GL_ARRAY_BUFFER, mVertexBuffer);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+  #endif
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+  #if defined IGRAPHICS_GL3 || defined IGRAPHICS_GLES3
+    glBindVertexArray(0);
+  #else
+    glDisableVertexAttribArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  #endif
+    glUseProgram(0);
+  }
+
+private:
+  GLuint mProgram = 0;
+  GLuint mVertexBuffer = 0;
+  GLuint mVertexArray = 0;
+  GLint mSizeLocation = -1;
+  GLint mDataLocation = -1;
+#elif defined IGRAPHICS_METAL
+  Shader(void* pShader, int nUniforms)
+  : APIShader(nUniforms)
+  , mShader(pShader)
+  {}
+
+  ~Shader()
+  {
+    mnvgDeleteShader(mShader);
+  }
+
+  void Draw(NVGcontext* pContext, int image, int x, int y, int width, int height, const float* pUniforms)
+  {
+    mnvgDrawShader(pContext, mShader, image, x, y, width, height, pUniforms, NUniforms() * static_cast<int>(sizeof(float)));
+  }
+
+private:
+  void* mShader = nullptr;
+#endif
+};
+
+#if defined IGRAPHICS_GL
+static GLuint CompileGLShader(GLenum type, const char* source, WDL_String& error)
+{
+  GLuint shader = glCreateShader(type);
+  glShaderSource(shader, 1, &source, nullptr);
+  glCompileShader(shader);
+
+  GLint status = GL_FALSE;
+  glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+
+  if (status != GL_TRUE)
+  {
+    char log[1024] = {};
+    glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+    error.Set(log);
+    glDeleteShader(shader);
+    return 0;
+  }
+
+  return shader;
+}
+#endif
+
+APIShader* IGraphicsNanoVG::CreateAPIShader(const IShaderSource& source, WDL_String& error)
+{
+  const int nUniforms = std::max(source.mNUniforms, 0);
+
+#if defined IGRAPHICS_GL
+  if (!source.mGLSL)
+  {
+    error.Set("No GLSL source");
+    return nullptr;
+  }
+
+  #if defined IGRAPHICS_GL3
+  const char* header = "#version 150 core\n#define ATTRIBUTE in\n#define VARYING_OUT out\n#define VARYING_IN in\nout vec4 iplug_FragColor;\n";
+  #elif defined IGRAPHICS_GLES3
+  const char* header = "#version 300 es\nprecision highp float;\n#define ATTRIBUTE in\n#define VARYING_OUT out\n#define VARYING_IN in\nout vec4 iplug_FragColor;\n";
+  #elif defined IGRAPHICS_GLES2
+  const char* header = "#version 100\nprecision highp float;\n#define ATTRIBUTE attribute\n#define VARYING_OUT varying\n#define VARYING_IN varying\n#define iplug_FragColor gl_FragColor\n";
+  #else
+  const char* header = "#version 120\n#define ATTRIBUTE attribute\n#define VARYING_OUT varying\n#define VARYING_IN varying\n#define iplug_FragColor gl_FragColor\n";
+  #endif
+
+  // the vertex shader can't declare the fragment output
+  WDL_String vertexSource(header);
+  const char* fragOutput = strstr(vertexSource.Get(), "out vec4 iplug_FragColor;\n");
+  if (fragOutput)
+    vertexSource.SetLen(static_cast<int>(fragOutput - vertexSource.Get()));
+  vertexSource.Append("ATTRIBUTE vec2 aPosition;\n"
+                      "VARYING_OUT vec2 vUV;\n"
+                      "void main() {\n"
+                      "  vUV = vec2(aPosition.x * 0.5 + 0.5, 0.5 - aPosition.y * 0.5);\n"
+                      "  gl_Position = vec4(aPosition, 0.0, 1.0);\n"
+                      "}\n");
+
+  WDL_String fragmentSource(header);
+  fragmentSource.AppendFormatted(128, "VARYING_IN vec2 vUV;\nuniform vec2 uSize;\nuniform float uData[%d];\n", std::max(nUniforms, 1));
+  fragmentSource.Append(source.mGLSL);
+  fragmentSource.Append("\nvoid main() {\n  iplug_FragColor = shade(vUV, uSize);\n}\n");
+
+  GLuint vertexShader = CompileGLShader(GL_VERTEX_SHADER, vertexSource.Get(), error);
+  GLuint fragmentShader = vertexShader ? CompileGLShader(GL_FRAGMENT_SHADER, fragmentSource.Get(), error) : 0;
+
+  if (!fragmentShader)
+  {
+    if (vertexShader)
+      glDeleteShader(vertexShader);
+    return nullptr;
+  }
+
+  GLuint program = glCreateProgram();
+  glAttachShader(program, vertexShader);
+  glAttachShader(program, fragmentShader);
+  glBindAttribLocation(program, 0, "aPosition");
+  glLinkProgram(program);
+  glDeleteShader(vertexShader);
+  glDeleteShader(fragmentShader);
+
+  GLint status = GL_FALSE;
+  glGetProgramiv(program, GL_LINK_STATUS, &status);
+
+  if (status != GL_TRUE)
+  {
+    char log[1024] = {};
+    glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+    error.Set(log);
+    glDeleteProgram(program);
+    return nullptr;
+  }
+
+  return new Shader(program, nUniforms);
+#elif defined IGRAPHICS_METAL
+  if (!source.mMSL)
+  {
+    error.Set("No MSL source");
+    return nullptr;
+  }
+
+  WDL_String mslSource("#include <metal_stdlib>\n"
+                       "using namespace metal;\n"
+                       "struct IShaderVertexOut { float4 position [[position]]; float2 uv; };\n"
+                       "vertex IShaderVertexOut iplug_shader_vertex(uint vid [[vertex_id]]) {\n"
+                       "  IShaderVertexOut out;\n"
+                       "  out.uv = float2(vid & 1, vid >> 1);\n"
+                       "  out.position = float4(out.uv.x * 2.0 - 1.0, 1.0 - out.uv.y * 2.0, 0.0, 1.0);\n"
+                       "  return out;\n"
+                       "}\n");
+  mslSource.Append(source.mMSL);
+  mslSource.Append("\nfragment float4 iplug_shader_fragment(IShaderVertexOut in [[stage_in]], constant float* uData [[buffer(0)]], constant float2& size [[buffer(1)]]) {\n"
+                   "  return shade(in.uv, size, uData);\n"
+                   "}\n");
+
+  char log[1024] = {};
+  void* pShader = mnvgCreateShader(mVG, mslSource.Get(), "iplug_shader_vertex", "iplug_shader_fragment", log, sizeof(log));
+
+  if (!pShader)
+  {
+    error.Set(log);
+    return nullptr;
+  }
+
+  return new Shader(pShader, nUniforms);
+#endif
+}
+
+void IGraphicsNanoVG::DrawAPIShader(APIShader* pAPIShader, const IRECT& bounds, const float* pUniforms)
+{
+  Shader* pShader = dynamic_cast<Shader*>(pAPIShader);
+
+  if (mRecordingList || !pShader) // not recorded by this back-end
+    return;
+
+  // the rectangle in pixels of the current frame buffer, from its top left
+  const float scale = static_cast<float>(GetBackingPixelScale());
+  const IRECT target = mLayers.empty() ? GetBounds() : mLayers.top()->Bounds();
+  IRECT r = bounds.Intersect(target).GetTranslated(-target.L, -target.T).GetScaled(scale);
+  r.PixelAlign();
+
+  if (r.Empty())
+    return;
+
+  nvgEndFrame(mVG); // draw what is queued before the shader
+
+#if defined IGRAPHICS_GL
+  const int targetHeight = static_cast<int>(std::round(target.H() * scale));
+  pShader->Draw(static_cast<int>(r.L), targetHeight - static_cast<int>(r.B), static_cast<int>(r.W()), static_cast<int>(r.H()), pUniforms);
+#elif defined IGRAPHICS_METAL
+  const NVGframebuffer* pFBO = mLayers.empty() ? mMainFrameBuffer : dynamic_cast<const Bitmap*>(mLayers.top()->GetAPIBitmap())->GetFBO();
+  pShader->Draw(mVG, pFBO->image, static_cast<int>(r.L), static_cast<int>(r.T), static_cast<int>(r.W()), static_cast<int>(r.H()), pUniforms);
+#endif
+
+  UpdateLayer();
+  PathTransformSetMatrix(GetTransformMatrix());
+}
+
 void IGraphicsNanoVG::UpdateLayer()
 {
   if (mLayers.empty())
@@ -783,6 +1654,12 @@ void IGraphicsNanoVG::UpdateLayer()
 
 void IGraphicsNanoVG::PathTransformSetMatrix(const IMatrix& m)
 {
+  if (mRecordingList)
+  {
+    mRecordingList->AddMatrix(m);
+    return;
+  }
+
   double xTranslate = 0.0;
   double yTranslate = 0.0;
   
@@ -805,6 +1682,63 @@ void IGraphicsNanoVG::SetClipRegion(const IRECT& r)
   nvgScissor(mVG, r.L, r.T, r.W(), r.H());
 }
 
+#ifdef IGRAPHICS_DRAWFILL_DIRECT
+template <typename F>
+bool IGraphicsNanoVG::DrawShape(const IColor& color, const IBlend* pBlend, F drawFunc)
+{
+  if (mRecordingList || !nvgShapesSupported(mVG))
+    return false;
+
+  NanoVGSetBlendMode(mVG, pBlend);
+  const bool drawn = drawFunc(NanoVGColor(color, pBlend)) != 0;
+  nvgGlobalCompositeOperation(mVG, NVG_SOURCE_OVER);
+
+  if (drawn)
+  {
+    ProfileDrawCall(IDrawProfiler::ECall::Fill);
+    nvgBeginPath(mVG); // as after a path has been filled or stroked
+  }
+
+  return drawn;
+}
+
+void IGraphicsNanoVG::DrawRoundRect(const IColor& color, const IRECT& bounds, float cornerRadius, const IBlend* pBlend, float thickness)
+{
+  if (!DrawShape(color, pBlend, [&](NVGcolor c) { return nvgShapeRoundedRect(mVG, bounds.L, bounds.T, bounds.W(), bounds.H(), cornerRadius, thickness, c); }))
+    IGraphics::DrawRoundRect(color, bounds, cornerRadius, pBlend, thickness);
+}
+
+void IGraphicsNanoVG::DrawArc(const IColor& color, float cx, float cy, float r, float a1, float a2, const IBlend* pBlend, float thickness)
+{
+  if (!DrawShape(color, pBlend, [&](NVGcolor c) { return nvgShapeArc(mVG, cx, cy, r, DegToRad(a1 - 90.f), DegToRad(a2 - 90.f), thickness, c); }))
+    IGraphics::DrawArc(color, cx, cy, r, a1, a2, pBlend, thickness);
+}
+
+void IGraphicsNanoVG::DrawCircle(const IColor& color, float cx, float cy, float r, const IBlend* pBlend, float thickness)
+{
+  if (!DrawShape(color, pBlend, [&](NVGcolor c) { return nvgShapeArc(mVG, cx, cy, r, 0.f, NVG_PI * 2.f, thickness, c); }))
+    IGraphics::DrawCircle(color, cx, cy, r, pBlend, thickness);
+}
+
+void IGraphicsNanoVG::FillRoundRect(const IColor& color, const IRECT& bounds, float cornerRadius, const IBlend* pBlend)
+{
+  if (!DrawShape(color, pBlend, [&](NVGcolor c) { return nvgShapeRoundedRect(mVG, bounds.L, bounds.T, bounds.W(), bounds.H(), cornerRadius, 0.f, c); }))
+    IGraphics::FillRoundRect(color, bounds, cornerRadius, pBlend);
+}
+
+void IGraphicsNanoVG::FillArc(const IColor& color, float cx, float cy, float r, float a1, float a2, const IBlend* pBlend)
+{
+  if (!DrawShape(color, pBlend, [&](NVGcolor c) { return nvgShapeArc(mVG, cx, cy, r, DegToRad(a1 - 90.f), DegToRad(a2 - 90.f), 0.f, c); }))
+    IGraphics::FillArc(color, cx, cy, r, a1, a2, pBlend);
+}
+
+void IGraphicsNanoVG::FillCircle(const IColor& color, float cx, float cy, float r, const IBlend* pBlend)
+{
+  if (!DrawShape(color, pBlend, [&](NVGcolor c) { return nvgShapeArc(mVG, cx, cy, r, 0.f, NVG_PI * 2.f, 0.f, c); }))
+    IGraphics::FillCircle(color, cx, cy, r, pBlend);
+}
+#endif
+
 void IGraphicsNanoVG::DrawDottedLine(const IColor& color, float x1, float y1, float x2, float y2, const IBlend* pBlend, float thickness, float dashLen)
 {
   const float xd = x1 - x2;
@@ -903,6 +1837,9 @@ void IGraphicsNanoVG::ClearFBOStack()
 
 void IGraphicsNanoVG::DrawFastDropShadow(const IRECT& innerBounds, const IRECT& outerBounds, float xyDrop, float roundness, float blur, IBlend* pBlend)
 {
+  if (mRecordingList) // not recorded by this back-end
+    return;
+
   NVGpaint shadowPaint = nvgBoxGradient(mVG, innerBounds.L + xyDrop, innerBounds.T + xyDrop, innerBounds.W(), innerBounds.H(), roundness, blur, NanoVGColor(COLOR_BLACK_DROP_SHADOW, pBlend), NanoVGColor(COLOR_TRANSPARENT, nullptr));
   nvgBeginPath(mVG);
   nvgRect(mVG, outerBounds.L, outerBounds.T, outerBounds.W(), outerBounds.H());
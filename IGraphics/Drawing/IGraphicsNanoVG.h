@@ -32,18 +32,22 @@
   #define NANOVG_GL2 1
   #define nvgCreateContext(flags) nvgCreateGL2(flags)
   #define nvgDeleteContext(context) nvgDeleteGL2(context)
+  #define nvglCreateImageFromHandle(ctx, tex, w, h, flags) nvglCreateImageFromHandleGL2(ctx, tex, w, h, flags)
 #elif defined IGRAPHICS_GLES2
   #define NANOVG_GLES2 1
   #define nvgCreateContext(flags) nvgCreateGLES2(flags)
   #define nvgDeleteContext(context) nvgDeleteGLES2(context)
+  #define nvglCreateImageFromHandle(ctx, tex, w, h, flags) nvglCreateImageFromHandleGLES2(ctx, tex, w, h, flags)
 #elif defined IGRAPHICS_GL3
   #define NANOVG_GL3 1
   #define nvgCreateContext(flags) nvgCreateGL3(flags)
   #define nvgDeleteContext(context) nvgDeleteGL3(context)
+  #define nvglCreateImageFromHandle(ctx, tex, w, h, flags) nvglCreateImageFromHandleGL3(ctx, tex, w, h, flags)
 #elif defined IGRAPHICS_GLES3
   #define NANOVG_GLES3 1
   #define nvgCreateContext(flags) nvgCreateGLES3(flags)
   #define nvgDeleteContext(context) nvgDeleteGLES3(context)
+  #define nvglCreateImageFromHandle(ctx, tex, w, h, flags) nvglCreateImageFromHandleGLES3(ctx, tex, w, h, flags)
 #elif defined IGRAPHICS_METAL
   #define nvgCreateContext(layer, flags) nvgCreateMTL(layer, flags)
   #define nvgDeleteContext(context) nvgDeleteMTL(context)
@@ -82,6 +86,7 @@ class IGraphicsNanoVG : public IGraphics
 {
 private:
   class Bitmap;
+  class Shader;
   
 public:
   IGraphicsNanoVG(IGEditorDelegate& dlg, int w, int h, int fps, float scale);
@@ -94,6 +99,8 @@ public:
   void OnViewInitialized(void* pContext) override;
   void OnViewDestroyed() override;
   void DrawResize() override;
+  bool BeginOffscreenDraw() override;
+  void EndOffscreenDraw() override;
 
   void DrawBitmap(const IBitmap& bitmap, const IRECT& dest, int srcX, int srcY, const IBlend* pBlend) override;
 
@@ -101,6 +108,19 @@ public:
   void DrawDottedRect(const IColor& color, const IRECT& bounds, const IBlend* pBlend, float thickness, float dashLen) override;
 
   void DrawFastDropShadow(const IRECT& innerBounds, const IRECT& outerBounds, float xyDrop = 5.f, float roundness = 0.f, float blur = 10.f, IBlend* pBlend = nullptr) override;
+
+#ifdef IGRAPHICS_DRAWFILL_DIRECT
+  // drawn as analytic shapes by the GL back-ends, without building and tessellating a path, see nvgShapeRoundedRect() and nvgShapeArc()
+  void DrawRoundRect(const IColor& color, const IRECT& bounds, float cornerRadius, const IBlend* pBlend, float thickness) override;
+  void DrawArc(const IColor& color, float cx, float cy, float r, float a1, float a2, const IBlend* pBlend, float thickness) override;
+  void DrawCircle(const IColor& color, float cx, float cy, float r, const IBlend* pBlend, float thickness) override;
+  void FillRoundRect(const IColor& color, const IRECT& bounds, float cornerRadius, const IBlend* pBlend) override;
+  void FillArc(const IColor& color, float cx, float cy, float r, float a1, float a2, const IBlend* pBlend) override;
+  void FillCircle(const IColor& color, float cx, float cy, float r, const IBlend* pBlend) override;
+#endif
+
+  APIShader* CreateAPIShader(const IShaderSource& source, WDL_String& error) override;
+  void DrawAPIShader(APIShader* pShader, const IRECT& bounds, const float* pUniforms) override;
   
   void PathClear() override;
   void PathClose() override;
@@ -124,9 +144,28 @@ public:
   void DeleteFBO(NVGframebuffer* pBuffer);
   
 protected:
+#ifdef IGRAPHICS_DRAWFILL_DIRECT
+  /** Draws an analytic shape, if the context supports them and no display list is being recorded
+   * @param drawFunc Draws the shape with the color, returning 0 if it wasn't drawn
+   * @return \c true if the shape was drawn, otherwise the caller draws a path */
+  template <typename F>
+  bool DrawShape(const IColor& color, const IBlend* pBlend, F drawFunc);
+#endif
+
   APIBitmap* LoadAPIBitmap(const char* fileNameOrResID, int scale, EResourceLocation location, const char* ext) override;
   APIBitmap* LoadAPIBitmap(const char* name, const void* pData, int dataSize, int scale) override;
+#if defined IGRAPHICS_GL && defined IGRAPHICS_SHARED_TEXTURES
+  /** Load a bitmap into a texture that is shared with the other instances in the process, see GLContextIsShared()
+   * @return The bitmap, or nullptr if it could not be decoded */
+  APIBitmap* LoadSharedAPIBitmap(const char* name, int scale, EResourceLocation location, const char* ext, const void* pData, int dataSize);
+#endif
+  /** Load a BC7 or ASTC texture that was made from a bitmap by Scripts/make_compressed_textures.py: <name>.png.ktx next to the file,
+   * or a resource of type KTX with the same name on Windows
+   * @return The bitmap, or nullptr if there is no texture or the GPU doesn't support its format, in which case the bitmap itself is loaded */
+  APIBitmap* LoadCompressedAPIBitmap(const char* fileNameOrResID, int scale, EResourceLocation location);
   APIBitmap* CreateAPIBitmap(int width, int height, float scale, double drawScale, bool cacheable = false) override;
+  APIBitmap* CreateAPIBitmapFromPixels(int width, int height, const uint8_t* pPixels, int rowBytes, float scale) override;
+  bool DecodeAPIBitmap(const char* fileNameOrResID, EResourceLocation location, const char* ext, int& width, int& height, RawBitmapData& pixels) override;
 
   bool LoadAPIFont(const char* fontID, const PlatformFontPtr& font) override;
 
@@ -143,14 +182,26 @@ protected:
 
   void GetLayerBitmapData(const ILayerPtr& layer, RawBitmapData& data) override;
   void ApplyShadowMask(ILayerPtr& layer, RawBitmapData& mask, const IShadow& shadow) override;
+  bool ApplyGPULayerDropShadow(ILayerPtr& layer, const IShadow& shadow) override;
 
   float DoMeasureText(const IText& text, const char* str, IRECT& bounds) const override;
   void DoDrawText(const IText& text, const char* str, const IRECT& bounds, const IBlend* pBlend) override;
+  void DoPathPolyline(const float* x, const float* y, int nPoints, bool moveToFirst) override;
 
 private:
+  /** Draw a 1D gaussian blur of a bitmap, as weighted copies added together
+   * @param pSource The bitmap to blur
+   * @param bounds The bounds of the bitmap, in the current layer
+   * @param blurSize The extent of the kernel in pixels, see IGraphics::GetShadowBlurSize()
+   * @param vertical \c true to blur vertically, \c false horizontally */
+  void DrawBlurPass(const APIBitmap* pSource, const IRECT& bounds, float blurSize, bool vertical);
+
   void PrepareAndMeasureText(const IText& text, const char* str, IRECT& r, double& x, double & y) const;
   void PathTransformSetMatrix(const IMatrix& m) override;
   void SetClipRegion(const IRECT& r) override;
+#if defined IGRAPHICS_GL && defined IGRAPHICS_PRESERVE_BACKBUFFER
+  void CompleteRegion(const IRECT& bounds) override { mCompositeRECT = mCompositeRECT.Union(bounds); }
+#endif
   void UpdateLayer() override;
   void ClearFBOStack();
   
@@ -161,6 +212,9 @@ private:
   NVGcontext* mVG = nullptr;
   NVGframebuffer* mMainFrameBuffer = nullptr;
   int mInitialFBO = 0;
+#if defined IGRAPHICS_GL && defined IGRAPHICS_PRESERVE_BACKBUFFER
+  IRECT mCompositeRECT; // the union of the regions drawn this frame, the only part of mMainFrameBuffer copied to the back buffer
+#endif
 };
 
 END_IGRAPHICS_NAMESPACE
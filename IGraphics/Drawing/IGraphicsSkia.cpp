@@ -1,5 +1,7 @@
 #include <cmath>
+#include <cstring>
 #include <map>
+#include <unordered_map>
 
 #include "IGraphicsSkia.h"
 
@@ -8,10 +10,12 @@
 #include "SkDashPathEffect.h"
 #include "SkGradientShader.h"
 #include "SkMaskFilter.h"
+#include "SkImageFilters.h"
 #include "SkFont.h"
 #include "SkFontMetrics.h"
 #include "SkTypeface.h"
 #include "SkVertices.h"
+#include "SkRuntimeEffect.h"
 #include "SkSwizzle.h"
 #pragma warning( pop )
 
@@ -37,10 +41,31 @@
   #pragma comment(lib, "skshaper.lib")
   #pragma comment(lib, "skunicode.lib")
   #pragma comment(lib, "opengl32.lib")
+  #if defined IGRAPHICS_VULKAN
+    #pragma comment(lib, "vulkan-1.lib")
+  #endif
+#endif
+
+#ifndef IGRAPHICS_CPU
+  #include "SkStream.h"
+  #include "include/gpu/GrContextOptions.h"
+  #if !defined OS_WIN
+    #include <sys/stat.h>
+  #endif
 #endif
 
 #if defined IGRAPHICS_GL
   #include "gl/GrGLInterface.h"
+#elif defined IGRAPHICS_VULKAN
+  #if defined OS_WIN
+    #define VK_USE_PLATFORM_WIN32_KHR
+  #else
+    #error IGRAPHICS_VULKAN is only implemented for IGRAPHICS_SKIA on OS_WIN
+  #endif
+  #include <vulkan/vulkan.h>
+  #include "include/gpu/GrBackendSemaphore.h"
+  #include "include/gpu/GrBackendSurfaceMutableState.h"
+  #include "include/gpu/vk/GrVkBackendContext.h"
 #endif
 
 using namespace iplug;
@@ -50,6 +75,18 @@ extern std::map<std::string, MTLTexturePtr> gTextureMap;
 
 #pragma mark - Private Classes and Structs
 
+/** A display list recorded natively as an SkPicture */
+class SkiaDisplayList : public IDisplayList
+{
+public:
+  SkiaDisplayList(const IRECT& bounds, sk_sp<SkPicture> picture)
+  : IDisplayList(bounds)
+  , mPicture(std::move(picture))
+  {}
+
+  sk_sp<SkPicture> mPicture;
+};
+
 class IGraphicsSkia::Bitmap : public APIBitmap
 {
 public:
@@ -94,6 +131,7 @@ IGraphicsSkia::Bitmap::Bitmap(const void* pData, int size, double sourceScale)
 IGraphicsSkia::Bitmap::Bitmap(sk_sp<SkImage> image, double sourceScale)
 {
   mDrawable.mImage = image;
+  mDrawable.mIsSurface = false;
   SetBitmap(&mDrawable, mDrawable.mImage->width(), mDrawable.mImage->height(), sourceScale, 1.f);
 }
 
@@ -109,6 +147,518 @@ struct IGraphicsSkia::Font
 // Fonts
 StaticStorage<IGraphicsSkia::Font> IGraphicsSkia::sFontCache;
 
+#ifdef IGRAPHICS_VULKAN
+/** A Vulkan instance and a device with a queue that can draw and present to windows, which can be shared by several windows */
+struct SkiaVulkanDevice
+{
+  static constexpr uint32_t kAPIVersion = VK_API_VERSION_1_1;
+
+  ~SkiaVulkanDevice()
+  {
+    if (mDevice != VK_NULL_HANDLE)
+      vkDestroyDevice(mDevice, nullptr);
+
+    if (mInstance != VK_NULL_HANDLE)
+      vkDestroyInstance(mInstance, nullptr);
+  }
+
+  /** @return \c false if there is no Vulkan driver, or no device that can present to a window */
+  bool Create()
+  {
+    VkApplicationInfo appInfo = { VK_STRUCTURE_TYPE_APPLICATION_INFO };
+    appInfo.pEngineName = "IGraphics";
+    appInfo.apiVersion = kAPIVersion;
+
+    const char* instanceExtensions[] = { VK_KHR_SURFACE_EXTENSION_NAME, VK_KHR_WIN32_SURFACE_EXTENSION_NAME };
+    VkInstanceCreateInfo instanceInfo = { VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO };
+    instanceInfo.pApplicationInfo = &appInfo;
+    instanceInfo.enabledExtensionCount = 2;
+    instanceInfo.ppEnabledExtensionNames = instanceExtensions;
+
+    if (vkCreateInstance(&instanceInfo, nullptr, &mInstance) != VK_SUCCESS)
+      return false;
+
+    uint32_t nDevices = 0;
+    vkEnumeratePhysicalDevices(mInstance, &nDevices, nullptr);
+    std::vector<VkPhysicalDevice> devices(nDevices);
+    vkEnumeratePhysicalDevices(mInstance, &nDevices, devices.data());
+
+    for (auto device : devices)
+    {
+      uint32_t nFamilies = 0;
+      vkGetPhysicalDeviceQueueFamilyProperties(device, &nFamilies, nullptr);
+      std::vector<VkQueueFamilyProperties> families(nFamilies);
+      vkGetPhysicalDeviceQueueFamilyProperties(device, &nFamilies, families.data());
+
+      for (uint32_t i = 0; i < nFamilies && mPhysicalDevice == VK_NULL_HANDLE; i++)
+      {
+        if ((families[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) && vkGetPhysicalDeviceWin32PresentationSupportKHR(device, i))
+        {
+          mPhysicalDevice = device;
+          mQueueFamily = i;
+        }
+      }
+
+      if (mPhysicalDevice != VK_NULL_HANDLE)
+        break;
+    }
+
+    if (mPhysicalDevice == VK_NULL_HANDLE)
+      return false;
+
+    const float priority = 1.f;
+    VkDeviceQueueCreateInfo queueInfo = { VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO };
+    queueInfo.queueFamilyIndex = mQueueFamily;
+    queueInfo.queueCount = 1;
+    queueInfo.pQueuePriorities = &priority;
+
+    const char* deviceExtensions[] = { VK_KHR_SWAPCHAIN_EXTENSION_NAME };
+    VkDeviceCreateInfo deviceInfo = { VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO };
+    deviceInfo.queueCreateInfoCount = 1;
+    deviceInfo.pQueueCreateInfos = &queueInfo;
+    deviceInfo.enabledExtensionCount = 1;
+    deviceInfo.ppEnabledExtensionNames = deviceExtensions;
+
+    if (vkCreateDevice(mPhysicalDevice, &deviceInfo, nullptr, &mDevice) != VK_SUCCESS)
+      return false;
+
+    vkGetDeviceQueue(mDevice, mQueueFamily, 0, &mQueue);
+    return true;
+  }
+
+  sk_sp<GrDirectContext> MakeGrContext(const GrContextOptions& options) const
+  {
+    GrVkBackendContext backendContext;
+    backendContext.fInstance = mInstance;
+    backendContext.fPhysicalDevice = mPhysicalDevice;
+    backendContext.fDevice = mDevice;
+    backendContext.fQueue = mQueue;
+    backendContext.fGraphicsQueueIndex = mQueueFamily;
+    backendContext.fMaxAPIVersion = kAPIVersion;
+    backendContext.fGetProc = [](const char* name, VkInstance instance, VkDevice device) {
+      return device != VK_NULL_HANDLE ? vkGetDeviceProcAddr(device, name) : vkGetInstanceProcAddr(instance, name);
+    };
+
+    return GrDirectContext::MakeVulkan(backendContext, options);
+  }
+
+  VkInstance mInstance = VK_NULL_HANDLE;
+  VkPhysicalDevice mPhysicalDevice = VK_NULL_HANDLE;
+  VkDevice mDevice = VK_NULL_HANDLE;
+  VkQueue mQueue = VK_NULL_HANDLE;
+  uint32_t mQueueFamily = 0;
+};
+
+/** A surface and swapchain for a window, on a SkiaVulkanDevice, with the swapchain images wrapped as Skia surfaces.
+ * As in Skia's own window contexts, there is one more backbuffer than swapchain image, each with a semaphore that presentation waits on,
+ * so a semaphore is never reused whilst the GPU might still be signalling it */
+struct IGraphicsSkia::VulkanContext
+{
+  struct Backbuffer
+  {
+    uint32_t mImageIndex = 0;
+    VkSemaphore mRenderSemaphore = VK_NULL_HANDLE;
+  };
+
+  ~VulkanContext()
+  {
+    DestroySwapchain(nullptr);
+
+    if (mWindowSurface != VK_NULL_HANDLE)
+      vkDestroySurfaceKHR(mInstance, mWindowSurface, nullptr);
+  }
+
+  /** Create a surface for the window on a device
+   * @return \c false if the device can't present to the window */
+  bool Create(std::shared_ptr<SkiaVulkanDevice> device, HWND hWnd)
+  {
+    mVulkanDevice = device;
+    mInstance = device->mInstance;
+    mPhysicalDevice = device->mPhysicalDevice;
+    mDevice = device->mDevice;
+    mQueue = device->mQueue;
+    mQueueFamily = device->mQueueFamily;
+
+    VkWin32SurfaceCreateInfoKHR surfaceInfo = { VK_STRUCTURE_TYPE_WIN32_SURFACE_CREATE_INFO_KHR };
+    surfaceInfo.hinstance = reinterpret_cast<HINSTANCE>(GetWindowLongPtr(hWnd, GWLP_HINSTANCE));
+    surfaceInfo.hwnd = hWnd;
+
+    if (vkCreateWin32SurfaceKHR(mInstance, &surfaceInfo, nullptr, &mWindowSurface) != VK_SUCCESS)
+      return false;
+
+    VkBool32 canPresent = VK_FALSE;
+    vkGetPhysicalDeviceSurfaceSupportKHR(mPhysicalDevice, mQueueFamily, mWindowSurface, &canPresent);
+    return canPresent == VK_TRUE;
+  }
+
+  /** (Re)create the swapchain, for a window of a size in pixels
+   * @return \c false if the window has no area, e.g. when it is minimized */
+  bool CreateSwapchain(GrDirectContext* pContext, int width, int height)
+  {
+    vkDeviceWaitIdle(mDevice);
+    DestroyBackbuffers();
+    mSwapchainInvalid = false;
+    mWidth = width;
+    mHeight = height;
+
+    VkSurfaceCapabilitiesKHR caps;
+    vkGetPhysicalDeviceSurfaceCapabilitiesKHR(mPhysicalDevice, mWindowSurface, &caps);
+
+    VkExtent2D extent = caps.currentExtent;
+
+    if (extent.width == UINT32_MAX) // the surface size is set by the swapchain
+      extent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+
+    if (!extent.width || !extent.height)
+      return false;
+
+    uint32_t nFormats = 0;
+    vkGetPhysicalDeviceSurfaceFormatsKHR(mPhysicalDevice, mWindowSurface, &nFormats, nullptr);
+    std::vector<VkSurfaceFormatKHR> formats(nFormats);
+    vkGetPhysicalDeviceSurfaceFormatsKHR(mPhysicalDevice, mWindowSurface, &nFormats, formats.data());
+
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    SkColorType colorType = kBGRA_8888_SkColorType;
+
+    for (const auto& f : formats)
+    {
+      if (f.format == VK_FORMAT_B8G8R8A8_UNORM || f.format == VK_FORMAT_R8G8B8A8_UNORM)
+      {
+        format = f.format;
+        colorType = f.format == VK_FORMAT_B8G8R8A8_UNORM ? kBGRA_8888_SkColorType : kRGBA_8888_SkColorType;
+        break;
+      }
+    }
+
+    if (format == VK_FORMAT_UNDEFINED)
+      return false;
+
+    const VkImageUsageFlags usage = (caps.supportedUsageFlags & VK_IMAGE_USAGE_SAMPLED_BIT)
+                                  | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+    VkSwapchainCreateInfoKHR swapchainInfo = { VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR };
+    swapchainInfo.surface = mWindowSurface;
+    swapchainInfo.minImageCount = caps.maxImageCount ? std::min(caps.minImageCount + 1, caps.maxImageCount) : caps.minImageCount + 1;
+    swapchainInfo.imageFormat = format;
+    swapchainInfo.imageColorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+    swapchainInfo.imageExtent = extent;
+    swapchainInfo.imageArrayLayers = 1;
+    swapchainInfo.imageUsage = usage;
+    swapchainInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    swapchainInfo.preTransform = caps.currentTransform;
+    swapchainInfo.compositeAlpha = (caps.supportedCompositeAlpha & VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR) ? VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR : VK_COMPOSITE_ALPHA_INHERIT_BIT_KHR;
+    swapchainInfo.presentMode = VK_PRESENT_MODE_FIFO_KHR; // vsync, and the only mode that is always supported
+    swapchainInfo.clipped = VK_TRUE;
+    swapchainInfo.oldSwapchain = mSwapchain;
+
+    VkSwapchainKHR swapchain = VK_NULL_HANDLE;
+    const VkResult result = vkCreateSwapchainKHR(mDevice, &swapchainInfo, nullptr, &swapchain);
+
+    if (mSwapchain != VK_NULL_HANDLE)
+      vkDestroySwapchainKHR(mDevice, mSwapchain, nullptr);
+
+    mSwapchain = swapchain;
+
+    if (result != VK_SUCCESS)
+      return false;
+
+    uint32_t nImages = 0;
+    vkGetSwapchainImagesKHR(mDevice, mSwapchain, &nImages, nullptr);
+    std::vector<VkImage> images(nImages);
+    vkGetSwapchainImagesKHR(mDevice, mSwapchain, &nImages, images.data());
+
+    for (auto image : images)
+    {
+      GrVkImageInfo imageInfo;
+      imageInfo.fImage = image;
+      imageInfo.fImageTiling = VK_IMAGE_TILING_OPTIMAL;
+      imageInfo.fImageLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+      imageInfo.fFormat = format;
+      imageInfo.fImageUsageFlags = usage;
+      imageInfo.fLevelCount = 1;
+      imageInfo.fCurrentQueueFamily = mQueueFamily;
+      imageInfo.fSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+      GrBackendRenderTarget backendRT(extent.width, extent.height, imageInfo);
+      mSurfaces.push_back(SkSurface::MakeFromBackendRenderTarget(pContext, backendRT, kTopLeft_GrSurfaceOrigin, colorType, nullptr, nullptr));
+    }
+
+    mBackbuffers.resize(nImages + 1);
+
+    for (auto& backbuffer : mBackbuffers)
+    {
+      VkSemaphoreCreateInfo semaphoreInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+      vkCreateSemaphore(mDevice, &semaphoreInfo, nullptr, &backbuffer.mRenderSemaphore);
+    }
+
+    mBackbufferIdx = 0;
+    return true;
+  }
+
+  /** Acquire the next swapchain image, recreating the swapchain if the window has changed
+   * @return The surface to draw the frame into, or nullptr if there is nothing to present to */
+  sk_sp<SkSurface> AcquireSurface(GrDirectContext* pContext)
+  {
+    if (mSwapchainInvalid && !CreateSwapchain(pContext, mWidth, mHeight))
+      return nullptr;
+
+    if (mBackbuffers.empty())
+      return nullptr;
+
+    mBackbufferIdx = (mBackbufferIdx + 1) % mBackbuffers.size();
+    Backbuffer& backbuffer = mBackbuffers[mBackbufferIdx];
+
+    VkSemaphoreCreateInfo semaphoreInfo = { VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO };
+    VkSemaphore acquireSemaphore = VK_NULL_HANDLE;
+    vkCreateSemaphore(mDevice, &semaphoreInfo, nullptr, &acquireSemaphore);
+
+    const VkResult result = vkAcquireNextImageKHR(mDevice, mSwapchain, UINT64_MAX, acquireSemaphore, VK_NULL_HANDLE, &backbuffer.mImageIndex);
+
+    if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
+    {
+      vkDestroySemaphore(mDevice, acquireSemaphore, nullptr);
+      mSwapchainInvalid = true; // try again next frame
+      return nullptr;
+    }
+
+    // Skia waits for the image to be released by the presentation engine before drawing to it, and deletes the semaphore afterwards
+    sk_sp<SkSurface> surface = mSurfaces[backbuffer.mImageIndex];
+    GrBackendSemaphore beSemaphore;
+    beSemaphore.initVulkan(acquireSemaphore);
+
+    if (!surface->wait(1, &beSemaphore))
+      vkDestroySemaphore(mDevice, acquireSemaphore, nullptr);
+
+    return surface;
+  }
+
+  /** Submit the frame drawn into the surface returned by AcquireSurface() and present it */
+  void Present(GrDirectContext* pContext)
+  {
+    Backbuffer& backbuffer = mBackbuffers[mBackbufferIdx];
+    SkSurface* pSurface = mSurfaces[backbuffer.mImageIndex].get();
+
+    GrBackendSemaphore beSemaphore;
+    beSemaphore.initVulkan(backbuffer.mRenderSemaphore);
+
+    GrFlushInfo flushInfo;
+    flushInfo.fNumSemaphores = 1;
+    flushInfo.fSignalSemaphores = &beSemaphore;
+    GrBackendSurfaceMutableState presentState(VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, mQueueFamily);
+    pSurface->flush(flushInfo, &presentState);
+    pContext->submit();
+
+    VkPresentInfoKHR presentInfo = { VK_STRUCTURE_TYPE_PRESENT_INFO_KHR };
+    presentInfo.waitSemaphoreCount = 1;
+    presentInfo.pWaitSemaphores = &backbuffer.mRenderSemaphore;
+    presentInfo.swapchainCount = 1;
+    presentInfo.pSwapchains = &mSwapchain;
+    presentInfo.pImageIndices = &backbuffer.mImageIndex;
+
+    const VkResult result = vkQueuePresentKHR(mQueue, &presentInfo);
+
+    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR)
+      mSwapchainInvalid = true;
+  }
+
+  /** Release the Skia surfaces that wrap the swapchain images. Must be called after the device is idle */
+  void DestroyBackbuffers()
+  {
+    mSurfaces.clear();
+
+    for (auto& backbuffer : mBackbuffers)
+      vkDestroySemaphore(mDevice, backbuffer.mRenderSemaphore, nullptr);
+
+    mBackbuffers.clear();
+  }
+
+  /** Destroy the swapchain, which must happen before the GrDirectContext is destroyed
+   * @param pContext The context, if it will still be used by other windows, so that it lets go of its resources for the swapchain images first */
+  void DestroySwapchain(GrDirectContext* pContext)
+  {
+    if (mDevice == VK_NULL_HANDLE)
+      return;
+
+    vkDeviceWaitIdle(mDevice);
+    DestroyBackbuffers();
+
+    if (pContext)
+      pContext->flushAndSubmit(true);
+
+    if (mSwapchain != VK_NULL_HANDLE)
+      vkDestroySwapchainKHR(mDevice, mSwapchain, nullptr);
+
+    mSwapchain = VK_NULL_HANDLE;
+  }
+
+  std::shared_ptr<SkiaVulkanDevice> mVulkanDevice;
+  VkInstance mInstance = VK_NULL_HANDLE;
+  VkSurfaceKHR mWindowSurface = VK_NULL_HANDLE;
+  VkPhysicalDevice mPhysicalDevice = VK_NULL_HANDLE;
+  VkDevice mDevice = VK_NULL_HANDLE;
+  VkQueue mQueue = VK_NULL_HANDLE;
+  uint32_t mQueueFamily = 0;
+  VkSwapchainKHR mSwapchain = VK_NULL_HANDLE;
+  std::vector<sk_sp<SkSurface>> mSurfaces;
+  std::vector<Backbuffer> mBackbuffers;
+  size_t mBackbufferIdx = 0;
+  int mWidth = 0;
+  int mHeight = 0;
+  bool mSwapchainInvalid = false;
+};
+#endif
+
+#ifndef IGRAPHICS_CPU
+/** Keeps the shaders and pipelines that Skia compiles in files, one per key, so that later sessions don't compile them again, see IGraphics::SetShaderCachePath().
+ * GL stores program binaries, Metal and Vulkan store the generated shader source or SPIR-V. There is one cache per binary, which is used by all of its editors */
+class SkiaShaderCache : public GrContextOptions::PersistentCache
+{
+public:
+  /** Set the folder for the cache, which is created if needed. An empty path disables the cache */
+  void SetPath(const char* path)
+  {
+    WDL_MutexLock lock(&mMutex);
+
+    if (!strcmp(path, mPath.Get()))
+      return;
+
+    mPath.Set(path);
+    mPathExists = false;
+  }
+
+  bool Enabled()
+  {
+    WDL_MutexLock lock(&mMutex);
+    return mPath.GetLength() > 0;
+  }
+
+  sk_sp<SkData> load(const SkData& key) override
+  {
+    WDL_String file;
+
+    if (!GetFilePath(key, file, false))
+      return nullptr;
+
+    return SkData::MakeFromFileName(file.Get());
+  }
+
+  void store(const SkData& key, const SkData& data) override
+  {
+    WDL_String file;
+
+    if (!GetFilePath(key, file, true))
+      return;
+
+    SkFILEWStream stream(file.Get());
+
+    if (stream.isValid())
+      stream.write(data.data(), data.size());
+  }
+
+private:
+  bool GetFilePath(const SkData& key, WDL_String& file, bool create)
+  {
+    WDL_MutexLock lock(&mMutex);
+
+    if (!mPath.GetLength())
+      return false;
+
+    if (create && !mPathExists)
+      mPathExists = CreateFolders(mPath.Get());
+
+    // FNV-1a, the keys are descriptions of the programs, which can be long
+    uint64_t hash = 14695981039346656037ULL;
+    const uint8_t* pKey = key.bytes();
+
+    for (size_t i = 0; i < key.size(); i++)
+      hash = (hash ^ pKey[i]) * 1099511628211ULL;
+
+    file.SetFormatted(mPath.GetLength() + 64, "%s%c%016llx_%zu.skc", mPath.Get(), WDL_DIRCHAR, (unsigned long long) hash, key.size());
+    return true;
+  }
+
+  static bool CreateFolders(const char* path)
+  {
+    WDL_String folder(path);
+    char* pPath = folder.Get();
+
+    for (char* pChar = pPath + 1; ; pChar++)
+    {
+      const bool end = !*pChar;
+
+      if (end || *pChar == '/' || *pChar == '\\')
+      {
+        const char sep = *pChar;
+        *pChar = '\0';
+#ifdef OS_WIN
+        wchar_t folderW[MAX_PATH];
+        UTF8ToUTF16(folderW, pPath, MAX_PATH);
+        CreateDirectoryW(folderW, NULL);
+#else
+        mkdir(pPath, S_IRWXU | S_IRWXG | S_IRWXO);
+#endif
+        *pChar = sep;
+      }
+
+      if (end)
+        break;
+    }
+
+#ifdef OS_WIN
+    wchar_t pathW[MAX_PATH];
+    UTF8ToUTF16(pathW, path, MAX_PATH);
+    const DWORD attributes = GetFileAttributesW(pathW);
+    return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+#else
+    struct stat info;
+    return !stat(path, &info) && S_ISDIR(info.st_mode);
+#endif
+  }
+
+  WDL_Mutex mMutex;
+  WDL_String mPath;
+  bool mPathExists = false;
+};
+
+// declared before the shared context, so that it is destroyed after it
+static SkiaShaderCache sShaderCache;
+
+/** @return The options for the GrDirectContexts this editor creates, with the shader cache if one is set */
+static GrContextOptions MakeContextOptions(const char* shaderCachePath)
+{
+  GrContextOptions options;
+
+  if (shaderCachePath && *shaderCachePath)
+    sShaderCache.SetPath(shaderCachePath);
+
+  if (sShaderCache.Enabled())
+  {
+    options.fPersistentCache = &sShaderCache;
+    options.fShaderCacheStrategy = GrContextOptions::ShaderCacheStrategy::kBackendBinary;
+  }
+
+  return options;
+}
+#endif
+
+#if defined IGRAPHICS_METAL || defined IGRAPHICS_VULKAN
+/** The GPU context shared by the editors in the process that enable it, see IGraphicsSkia::EnableSharedGPUContext() */
+struct SkiaSharedGPUContext
+{
+  WDL_Mutex mMutex;
+  sk_sp<GrDirectContext> mContext;
+  int mNUsers = 0;
+#if defined IGRAPHICS_METAL
+  void* mMTLDevice = nullptr;
+  void* mMTLCommandQueue = nullptr;
+#elif defined IGRAPHICS_VULKAN
+  std::shared_ptr<SkiaVulkanDevice> mVulkanDevice;
+#endif
+};
+
+static SkiaSharedGPUContext sSharedGPUContext;
+#endif
+
 #pragma mark - Utility conversions
 
 BEGIN_IPLUG_NAMESPACE
@@ -162,7 +712,100 @@ SkTileMode SkiaTileMode(const IPattern& pattern)
   return SkTileMode::kClamp;
 }
 
-SkPaint SkiaPaint(const IPattern& pattern, const IBlend* pBlend)
+/** Gradient shaders made recently, keyed by what they were made from, so that a gradient drawn every frame (e.g. by each styled IVControl) is only made once.
+ * Patterns are compared by contents, so a pattern that changes simply makes a new entry, and entries that haven't been used for a while are dropped */
+class SkiaShaderCache
+{
+public:
+  static constexpr size_t kMaxEntries = 256;
+  static constexpr uint32_t kPruneInterval = 60; // frames
+  static constexpr uint32_t kMaxUnusedFrames = 120;
+
+  struct Key
+  {
+    Key() { memset(this, 0, sizeof(Key)); } // so that the padding compares equal too
+
+    bool operator==(const Key& other) const { return memcmp(this, &other, sizeof(Key)) == 0; }
+
+    int mType;
+    int mExtend;
+    int mNStops;
+    double mTransform[6];
+    SkColor mColors[8]; // after the blend is applied
+    SkScalar mPositions[8];
+  };
+
+  struct KeyHash
+  {
+    size_t operator()(const Key& key) const
+    {
+      // FNV-1a
+      const uint8_t* pBytes = reinterpret_cast<const uint8_t*>(&key);
+      uint64_t hash = 14695981039346656037ULL;
+
+      for (size_t i = 0; i < sizeof(Key); i++)
+      {
+        hash ^= pBytes[i];
+        hash *= 1099511628211ULL;
+      }
+
+      return static_cast<size_t>(hash);
+    }
+  };
+
+  sk_sp<SkShader> Find(const Key& key)
+  {
+    auto it = mEntries.find(key);
+
+    if (it == mEntries.end())
+      return nullptr;
+
+    it->second.mLastUsed = mFrame;
+    return it->second.mShader;
+  }
+
+  void Add(const Key& key, sk_sp<SkShader> shader)
+  {
+    if (mEntries.size() >= kMaxEntries)
+    {
+      Prune(0);
+
+      if (mEntries.size() >= kMaxEntries) // all used this frame, e.g. an animated gradient
+        mEntries.clear();
+    }
+
+    mEntries[key] = { std::move(shader), mFrame };
+  }
+
+  void NextFrame()
+  {
+    if (!(++mFrame % kPruneInterval))
+      Prune(kMaxUnusedFrames);
+  }
+
+private:
+  struct Entry
+  {
+    sk_sp<SkShader> mShader;
+    uint32_t mLastUsed;
+  };
+
+  void Prune(uint32_t maxUnusedFrames)
+  {
+    for (auto it = mEntries.begin(); it != mEntries.end();)
+    {
+      if (mFrame - it->second.mLastUsed > maxUnusedFrames)
+        it = mEntries.erase(it);
+      else
+        ++it;
+    }
+  }
+
+  std::unordered_map<Key, Entry, KeyHash> mEntries;
+  uint32_t mFrame = 0;
+};
+
+SkPaint SkiaPaint(const IPattern& pattern, const IBlend* pBlend, SkiaShaderCache* pShaderCache)
 {
   SkPaint paint;
   paint.setAntiAlias(true);
@@ -203,6 +846,26 @@ SkPaint SkiaPaint(const IPattern& pattern, const IBlend* pBlend)
       positions[i] = stop.mOffset;
     }
 
+    SkiaShaderCache::Key key;
+
+    if (pShaderCache)
+    {
+      key.mType = static_cast<int>(pattern.mType);
+      key.mExtend = static_cast<int>(pattern.mExtend);
+      key.mNStops = numStops;
+      const IMatrix& t = pattern.mTransform;
+      const double transform[6] = { t.mXX, t.mYX, t.mXY, t.mYY, t.mTX, t.mTY };
+      std::copy(transform, transform + 6, key.mTransform);
+      std::copy(colors, colors + numStops, key.mColors);
+      std::copy(positions, positions + numStops, key.mPositions);
+
+      if (sk_sp<SkShader> shader = pShaderCache->Find(key))
+      {
+        paint.setShader(std::move(shader));
+        return paint;
+      }
+    }
+
     switch (pattern.mType)
     {
     case EPatternType::Linear:
@@ -231,6 +894,9 @@ SkPaint SkiaPaint(const IPattern& pattern, const IBlend* pBlend)
     default:
       break;
     }
+
+    if (pShaderCache && paint.getShader())
+      pShaderCache->Add(key, paint.refShader());
   }
     
   return paint;
@@ -243,6 +909,7 @@ END_IPLUG_NAMESPACE
 
 IGraphicsSkia::IGraphicsSkia(IGEditorDelegate& dlg, int w, int h, int fps, float scale)
 : IGraphics(dlg, w, h, fps, scale)
+, mShaderCache(std::make_unique<SkiaShaderCache>())
 {
   mMainPath.setIsVolatile(true);
   
@@ -252,6 +919,8 @@ IGraphicsSkia::IGraphicsSkia(IGEditorDelegate& dlg, int w, int h, int fps, float
   DBGMSG("IGraphics Skia METAL @ %i FPS\n", fps);
 #elif defined IGRAPHICS_GL
   DBGMSG("IGraphics Skia GL @ %i FPS\n", fps);
+#elif defined IGRAPHICS_VULKAN
+  DBGMSG("IGraphics Skia Vulkan @ %i FPS\n", fps);
 #endif
   StaticStorage<Font>::Accessor storage(sFontCache);
   storage.Retain();
@@ -306,22 +975,106 @@ APIBitmap* IGraphicsSkia::LoadAPIBitmap(const char* name, const void* pData, int
   return new Bitmap(pData, dataSize, scale);
 }
 
+#ifdef IGRAPHICS_METAL
+static sk_sp<GrDirectContext> MakeMetalContext(void* pDevice, void* pCommandQueue, const GrContextOptions& options)
+{
+  GrMtlBackendContext backendContext = {};
+  backendContext.fDevice.retain((__bridge GrMTLHandle) pDevice);
+  backendContext.fQueue.retain((__bridge GrMTLHandle) pCommandQueue);
+  return GrDirectContext::MakeMetal(backendContext, options);
+}
+#endif
+
 void IGraphicsSkia::OnViewInitialized(void* pContext)
 {
+  // a GrDirectContext must only be used on one thread, so it is only shared by editors drawing on the UI thread
+  const bool share = mShareGPUContext && !(GetUseRenderThread() && PlatformSupportsRenderThread());
+#ifndef IGRAPHICS_CPU
+  const GrContextOptions options = MakeContextOptions(GetShaderCachePath());
+#endif
+
 #if defined IGRAPHICS_GL
   auto glInterface = GrGLMakeNativeInterface();
-  mGrContext = GrDirectContext::MakeGL(glInterface);
+  mGrContext = GrDirectContext::MakeGL(glInterface, options);
 #elif defined IGRAPHICS_METAL
   CAMetalLayer* pMTLLayer = (CAMetalLayer*) pContext;
   id<MTLDevice> device = pMTLLayer.device;
-  id<MTLCommandQueue> commandQueue = [device newCommandQueue];
-  GrMtlBackendContext backendContext = {};
-  backendContext.fDevice.retain((__bridge GrMTLHandle) device);
-  backendContext.fQueue.retain((__bridge GrMTLHandle) commandQueue);
-  mGrContext = GrDirectContext::MakeMetal(backendContext);
   mMTLDevice = (void*) device;
-  mMTLCommandQueue = (void*) commandQueue;
   mMTLLayer = pContext;
+
+  if (share)
+  {
+    WDL_MutexLock lock(&sSharedGPUContext.mMutex);
+
+    if (!sSharedGPUContext.mContext)
+    {
+      sSharedGPUContext.mMTLDevice = (void*) device;
+      sSharedGPUContext.mMTLCommandQueue = (void*) [device newCommandQueue];
+      sSharedGPUContext.mContext = MakeMetalContext(sSharedGPUContext.mMTLDevice, sSharedGPUContext.mMTLCommandQueue, options);
+    }
+
+    // the shared context can only draw to layers on its own device
+    if (sSharedGPUContext.mContext && sSharedGPUContext.mMTLDevice == (void*) device)
+    {
+      sSharedGPUContext.mNUsers++;
+      mGrContext = sSharedGPUContext.mContext;
+      mMTLCommandQueue = sSharedGPUContext.mMTLCommandQueue;
+      mSharingGPUContext = true;
+    }
+  }
+
+  if (!mGrContext)
+  {
+    mMTLCommandQueue = (void*) [device newCommandQueue];
+    mGrContext = MakeMetalContext(mMTLDevice, mMTLCommandQueue, options);
+  }
+#elif defined IGRAPHICS_VULKAN
+  mVulkan = std::make_unique<VulkanContext>();
+
+  if (share)
+  {
+    WDL_MutexLock lock(&sSharedGPUContext.mMutex);
+
+    if (!sSharedGPUContext.mContext)
+    {
+      auto device = std::make_shared<SkiaVulkanDevice>();
+
+      if (device->Create())
+      {
+        sSharedGPUContext.mVulkanDevice = device;
+        sSharedGPUContext.mContext = device->MakeGrContext(options);
+      }
+    }
+
+    if (sSharedGPUContext.mContext && mVulkan->Create(sSharedGPUContext.mVulkanDevice, (HWND) GetWindow()))
+    {
+      sSharedGPUContext.mNUsers++;
+      mGrContext = sSharedGPUContext.mContext;
+      mSharingGPUContext = true;
+    }
+    else if (!sSharedGPUContext.mNUsers)
+    {
+      sSharedGPUContext.mContext = nullptr;
+      sSharedGPUContext.mVulkanDevice = nullptr;
+    }
+  }
+
+  if (!mGrContext)
+  {
+    auto device = std::make_shared<SkiaVulkanDevice>();
+    mVulkan = std::make_unique<VulkanContext>();
+
+    if (device->Create() && mVulkan->Create(device, (HWND) GetWindow()))
+      mGrContext = device->MakeGrContext(options);
+  }
+
+  if (!mGrContext)
+    DBGMSG("Could not create a Vulkan context.\n");
+#endif
+
+#ifndef IGRAPHICS_CPU
+  if (mGrContext && mGPUResourceCacheLimit)
+    mGrContext->setResourceCacheLimit(mGPUResourceCacheLimit);
 #endif
 
   DrawResize();
@@ -336,10 +1089,60 @@ void IGraphicsSkia::OnViewDestroyed()
   mScreenSurface = nullptr;
   mGrContext = nullptr;
 #elif defined IGRAPHICS_METAL
-  [(id<MTLCommandQueue>) mMTLCommandQueue release];
+  mSurface = nullptr;
+  mScreenSurface = nullptr;
+  mGrContext = nullptr;
+
+  if (!mSharingGPUContext)
+    [(id<MTLCommandQueue>) mMTLCommandQueue release];
+
   mMTLCommandQueue = nullptr;
   mMTLLayer = nullptr;
   mMTLDevice = nullptr;
+#elif defined IGRAPHICS_VULKAN
+  mSurface = nullptr;
+  mScreenSurface = nullptr;
+
+  // the swapchain surfaces and the context must go before the device
+  if (mVulkan)
+    mVulkan->DestroySwapchain(mSharingGPUContext ? mGrContext.get() : nullptr);
+
+  mGrContext = nullptr;
+#endif
+
+#if defined IGRAPHICS_METAL || defined IGRAPHICS_VULKAN
+  if (mSharingGPUContext)
+  {
+    WDL_MutexLock lock(&sSharedGPUContext.mMutex);
+
+    if (--sSharedGPUContext.mNUsers == 0)
+    {
+      sSharedGPUContext.mContext = nullptr;
+    #if defined IGRAPHICS_METAL
+      [(id<MTLCommandQueue>) sSharedGPUContext.mMTLCommandQueue release];
+      sSharedGPUContext.mMTLCommandQueue = nullptr;
+      sSharedGPUContext.mMTLDevice = nullptr;
+    #elif defined IGRAPHICS_VULKAN
+      sSharedGPUContext.mVulkanDevice = nullptr;
+    #endif
+    }
+
+    mSharingGPUContext = false;
+  }
+#endif
+
+#ifdef IGRAPHICS_VULKAN
+  mVulkan = nullptr;
+#endif
+}
+
+void IGraphicsSkia::SetGPUResourceCacheLimit(size_t bytes)
+{
+  mGPUResourceCacheLimit = bytes;
+
+#ifndef IGRAPHICS_CPU
+  if (mGrContext && bytes)
+    mGrContext->setResourceCacheLimit(bytes);
 #endif
 }
 
@@ -348,11 +1151,16 @@ void IGraphicsSkia::DrawResize()
   auto w = static_cast<int>(std::ceil(static_cast<float>(WindowWidth()) * GetScreenScale()));
   auto h = static_cast<int>(std::ceil(static_cast<float>(WindowHeight()) * GetScreenScale()));
   
-#if defined IGRAPHICS_GL || defined IGRAPHICS_METAL
+#if defined IGRAPHICS_GL || defined IGRAPHICS_METAL || defined IGRAPHICS_VULKAN
   if (mGrContext.get())
   {
     SkImageInfo info = SkImageInfo::MakeN32Premul(w, h);
     mSurface = SkSurface::MakeRenderTarget(mGrContext.get(), SkBudgeted::kYes, info);
+
+  #ifdef IGRAPHICS_VULKAN
+    mScreenSurface = nullptr;
+    mVulkan->CreateSwapchain(mGrContext.get(), w, h);
+  #endif
   }
 #else
   #ifdef OS_WIN
@@ -383,6 +1191,18 @@ void IGraphicsSkia::DrawResize()
   }
 }
 
+bool IGraphicsSkia::BeginOffscreenDraw()
+{
+#ifdef IGRAPHICS_CPU
+  // a raster surface needs no window, so an IGraphics that has never been opened can draw
+  if (!mSurface)
+    DrawResize();
+#endif
+
+  // on the GPU the surface only exists while there is a context
+  return mSurface != nullptr;
+}
+
 void IGraphicsSkia::BeginFrame()
 {
 #if defined IGRAPHICS_GL
@@ -427,6 +1247,9 @@ void IGraphicsSkia::BeginFrame()
     mMTLDrawable = (void*) drawable;
     assert(mScreenSurface);
   }
+#elif defined IGRAPHICS_VULKAN
+  if (mGrContext.get())
+    mScreenSurface = mVulkan->AcquireSurface(mGrContext.get()); // nullptr whilst the window is minimized, the frame is drawn but not presented
 #endif
 
   IGraphics::BeginFrame();
@@ -434,6 +1257,8 @@ void IGraphicsSkia::BeginFrame()
 
 void IGraphicsSkia::EndFrame()
 {
+  mShaderCache->NextFrame();
+
 #ifdef IGRAPHICS_CPU
   #if defined OS_MAC || defined OS_IOS
     SkPixmap pixmap;
@@ -446,18 +1271,44 @@ void IGraphicsSkia::EndFrame()
     SkCGDrawBitmap(pCGContext, bmp, 0, 0);
     CGContextRestoreGState(pCGContext);
   #elif defined OS_WIN
-    auto w = WindowWidth() * GetScreenScale();
-    auto h = WindowHeight() * GetScreenScale();
+    const int w = mSurface->width();
+    const int h = mSurface->height();
     BITMAPINFO* bmpInfo = reinterpret_cast<BITMAPINFO*>(mSurfaceMemory.Get());
+
+    // only copy the pixels that were drawn, rounded out to whole pixels
+    IRECT present = mPresentRECT.GetScaled(GetBackingPixelScale());
+    present.PixelAlign();
+    const int l = Clip(static_cast<int>(present.L), 0, w);
+    const int t = Clip(static_cast<int>(present.T), 0, h);
+    const int r = Clip(static_cast<int>(present.R), 0, w);
+    const int b = Clip(static_cast<int>(present.B), 0, h);
+    mPresentRECT = IRECT();
+
     HWND hWnd = (HWND) GetWindow();
     PAINTSTRUCT ps;
     HDC hdc = BeginPaint(hWnd, &ps);
-    StretchDIBits(hdc, 0, 0, w, h, 0, 0, w, h, bmpInfo->bmiColors, bmpInfo, DIB_RGB_COLORS, SRCCOPY);
+
+    if (r > l && b > t)
+    {
+      // describe the drawn rows as a DIB of their own, as the meaning of a source y offset into a top-down DIB varies
+      BITMAPINFOHEADER header = bmpInfo->bmiHeader;
+      header.biHeight = -(b - t);
+      const uint32_t* pRows = reinterpret_cast<const uint32_t*>(bmpInfo->bmiColors) + t * w;
+      StretchDIBits(hdc, l, t, r - l, b - t, l, 0, r - l, b - t, pRows, reinterpret_cast<BITMAPINFO*>(&header), DIB_RGB_COLORS, SRCCOPY);
+    }
+
     ReleaseDC(hWnd, hdc);
     EndPaint(hWnd, &ps);
   #else
     #error NOT IMPLEMENTED
   #endif
+#elif defined IGRAPHICS_VULKAN
+  if (mScreenSurface)
+  {
+    mSurface->draw(mScreenSurface->getCanvas(), 0.0, 0.0, nullptr);
+    mVulkan->Present(mGrContext.get());
+    mScreenSurface = nullptr;
+  }
 #else // GPU
   mSurface->draw(mScreenSurface->getCanvas(), 0.0, 0.0, nullptr);
     
@@ -475,6 +1326,8 @@ void IGraphicsSkia::EndFrame()
 
 void IGraphicsSkia::DrawBitmap(const IBitmap& bitmap, const IRECT& dest, int srcX, int srcY, const IBlend* pBlend)
 {
+  ProfileDrawCall(IDrawProfiler::ECall::Bitmap);
+
   SkPaint p;
   
   p.setAntiAlias(true);
@@ -491,7 +1344,7 @@ void IGraphicsSkia::DrawBitmap(const IBitmap& bitmap, const IRECT& dest, int src
   mCanvas->clipRect(SkiaRect(dest));
   mCanvas->translate(dest.L, dest.T);
   mCanvas->scale(scale1, scale1);
-  mCanvas->translate(-srcX * scale2, -srcY * scale2);
+  mCanvas->translate(-(srcX + bitmap.X()) * scale2, -(srcY + bitmap.Y()) * scale2);
   
 #ifdef IGRAPHICS_CPU
   auto samplingOptions = SkSamplingOptions(SkFilterMode::kLinear, SkMipmapMode::kNone);
@@ -507,6 +1360,28 @@ void IGraphicsSkia::DrawBitmap(const IBitmap& bitmap, const IRECT& dest, int src
   mCanvas->restore();
 }
 
+void IGraphicsSkia::DoPathPolyline(const float* x, const float* y, int nPoints, bool moveToFirst)
+{
+  mPolylinePoints.resize(nPoints);
+
+  for (auto i = 0; i < nPoints; i++)
+    mPolylinePoints[i].set(x[i], y[i]);
+
+  mMatrix.mapPoints(mPolylinePoints.data(), nPoints);
+
+  if (moveToFirst)
+  {
+    mMainPath.addPoly(mPolylinePoints.data(), nPoints, false);
+  }
+  else
+  {
+    mMainPath.incReserve(nPoints);
+
+    for (const SkPoint& point : mPolylinePoints)
+      mMainPath.lineTo(point);
+  }
+}
+
 void IGraphicsSkia::PathArc(float cx, float cy, float r, float a1, float a2, EWinding winding)
 {
   SkPath arc;
@@ -589,6 +1464,11 @@ void IGraphicsSkia::PrepareAndMeasureText(const IText& text, const char* str, IR
   font.setSubpixel(true);
   font.setSize(text.mSize * pFont->mData->GetHeightEMRatio());
   
+  if (FindTextMeasurement(text, str, r, x, y))
+    return;
+  
+  const IRECT anchorRect = r;
+  
   // Draw / measure
   const double textWidth = font.measureText(str, strlen(str), SkTextEncoding::kUTF8, nullptr/* &bounds*/);
   font.getMetrics(&metrics);
@@ -612,6 +1492,7 @@ void IGraphicsSkia::PrepareAndMeasureText(const IText& text, const char* str, IR
   }
   
   r = IRECT((float) x, (float) y + ascender, (float) (x + textWidth), (float) (y + ascender + textHeight));
+  AddTextMeasurement(text, str, anchorRect, r, x, y);
 }
 
 float IGraphicsSkia::DoMeasureText(const IText& text, const char* str, IRECT& bounds) const
@@ -646,7 +1527,9 @@ void IGraphicsSkia::DoDrawText(const IText& text, const char* str, const IRECT&
 
 void IGraphicsSkia::PathStroke(const IPattern& pattern, float thickness, const IStrokeOptions& options, const IBlend* pBlend)
 {
-  SkPaint paint = SkiaPaint(pattern, pBlend);
+  ProfileDrawCall(IDrawProfiler::ECall::Stroke);
+
+  SkPaint paint = SkiaPaint(pattern, pBlend, mShaderCache.get());
   paint.setStyle(SkPaint::kStroke_Style);
 
   switch (options.mCapOption)
@@ -690,7 +1573,9 @@ void IGraphicsSkia::PathStroke(const IPattern& pattern, float thickness, const I
 
 void IGraphicsSkia::PathFill(const IPattern& pattern, const IFillOptions& options, const IBlend* pBlend)
 {
-  SkPaint paint = SkiaPaint(pattern, pBlend);
+  ProfileDrawCall(IDrawProfiler::ECall::Fill);
+
+  SkPaint paint = SkiaPaint(pattern, pBlend, mShaderCache.get());
   paint.setStyle(SkPaint::kFill_Style);
   
   if (options.mFillRule == EFillRule::Winding)
@@ -805,6 +1690,14 @@ void IGraphicsSkia::PathTransformSetMatrix(const IMatrix& m)
     
   if (!mCanvas)
     return;
+  
+  if (mPictureRecorder)
+  {
+    // whilst recording a display list the matrix is relative to the start of the recording, without the global scale
+    mMatrix = SkMatrix::MakeAll(m.mXX, m.mXY, m.mTX, m.mYX, m.mYY, m.mTY, 0, 0, 1);
+    mCanvas->setMatrix(mMatrix);
+    return;
+  }
     
   if (!mLayers.empty())
   {
@@ -827,6 +1720,9 @@ void IGraphicsSkia::PathTransformSetMatrix(const IMatrix& m)
 
 void IGraphicsSkia::SetClipRegion(const IRECT& r)
 {
+  if (mPictureRecorder)
+    return;
+  
   mCanvas->restoreToCount(0);
   mCanvas->save();
   mCanvas->setMatrix(mClipMatrix);
@@ -857,11 +1753,90 @@ APIBitmap* IGraphicsSkia::CreateAPIBitmap(int width, int height, float scale, do
   return new Bitmap(std::move(surface), width, height, scale, drawScale);
 }
 
+APIBitmap* IGraphicsSkia::CreateAPIBitmapFromPixels(int width, int height, const uint8_t* pPixels, int rowBytes, float scale)
+{
+  // the pixels are in the format read by GetLayerBitmapData(), and are uploaded to the GPU when the image is first drawn
+  SkImageInfo info = SkImageInfo::MakeN32Premul(width, height);
+  sk_sp<SkImage> image = SkImage::MakeRasterCopy(SkPixmap(info, pPixels, rowBytes));
+  
+  return image ? new Bitmap(image, scale) : nullptr;
+}
+
+bool IGraphicsSkia::DecodeAPIBitmap(const char* fileNameOrResID, EResourceLocation location, const char* ext, int& width, int& height, RawBitmapData& pixels)
+{
+  sk_sp<SkData> data;
+
+#ifdef OS_WIN
+  if (location == EResourceLocation::kWinBinary)
+  {
+    int size = 0;
+    const void* pData = LoadWinResource(fileNameOrResID, ext, size, GetWinModuleHandle());
+
+    if (pData)
+      data = SkData::MakeWithoutCopy(pData, size);
+  }
+  else
+#endif
+  if (location == EResourceLocation::kAbsolutePath)
+    data = SkData::MakeFromFileName(fileNameOrResID);
+
+  sk_sp<SkImage> image = data ? SkImage::MakeFromEncoded(data) : nullptr;
+
+  if (!image)
+    return false;
+
+  // reading the pixels of an encoded image decodes it on the CPU, in the format taken by CreateAPIBitmapFromPixels()
+  width = image->width();
+  height = image->height();
+  pixels.Resize(width * height * 4);
+
+  return image->readPixels(SkImageInfo::MakeN32Premul(width, height), pixels.Get(), width * 4, 0, 0);
+}
+
 void IGraphicsSkia::UpdateLayer()
 {
   mCanvas = mLayers.empty() ? mSurface->getCanvas() : mLayers.top()->GetAPIBitmap()->GetBitmap()->mSurface->getCanvas();
 }
 
+void IGraphicsSkia::StartDisplayList(const IRECT& bounds)
+{
+  assert(!mPictureRecorder && "Display lists cannot be nested");
+  
+  PathTransformSave();
+  mTransform = IMatrix();
+  mMainPath.reset();
+  mRecordingBounds = bounds;
+  mPictureRecorder = std::make_unique<SkPictureRecorder>();
+  mPreRecordingCanvas = mCanvas;
+  mCanvas = mPictureRecorder->beginRecording(SkiaRect(bounds));
+  PathTransformSetMatrix(mTransform);
+}
+
+IDisplayListPtr IGraphicsSkia::EndDisplayList()
+{
+  if (!mPictureRecorder)
+    return nullptr;
+  
+  sk_sp<SkPicture> picture = mPictureRecorder->finishRecordingAsPicture();
+  mPictureRecorder = nullptr;
+  mCanvas = mPreRecordingCanvas;
+  mMainPath.reset();
+  PathTransformRestore();
+  
+  return std::make_unique<SkiaDisplayList>(mRecordingBounds, std::move(picture));
+}
+
+void IGraphicsSkia::DrawDisplayList(const IDisplayListPtr& list, const IMatrix& t)
+{
+  if (!list)
+    return;
+  
+  // display lists are only ever created by this back-end's EndDisplayList()
+  const SkiaDisplayList* pList = static_cast<const SkiaDisplayList*>(list.get());
+  const SkMatrix matrix = SkMatrix::MakeAll(t.mXX, t.mXY, t.mTX, t.mYX, t.mYY, t.mTY, 0, 0, 1);
+  mCanvas->drawPicture(pList->mPicture, &matrix, nullptr);
+}
+
 static size_t CalcRowBytes(int width)
 {
   width = ((width + 7) & (-8));
@@ -914,7 +1889,7 @@ void IGraphicsSkia::ApplyShadowMask(ILayerPtr& layer, RawBitmapData& mask, const
   m = SkMatrix::Scale(scale, scale);
   pCanvas->setMatrix(m);
   pCanvas->translate(-layer->Bounds().L, -layer->Bounds().T);
-  SkPaint p = SkiaPaint(shadow.mPattern, &blend);
+  SkPaint p = SkiaPaint(shadow.mPattern, &blend, mShaderCache.get());
   p.setBlendMode(SkBlendMode::kSrcIn);
   pCanvas->drawPaint(p);
 
@@ -926,6 +1901,45 @@ void IGraphicsSkia::ApplyShadowMask(ILayerPtr& layer, RawBitmapData& mask, const
   }
 }
 
+bool IGraphicsSkia::ApplyGPULayerDropShadow(ILayerPtr& layer, const IShadow& shadow)
+{
+  SkiaDrawable* pDrawable = layer->GetAPIBitmap()->GetBitmap();
+  double scale = layer->GetAPIBitmap()->GetDrawScale() * layer->GetAPIBitmap()->GetScale();
+  
+  // the CPU blur's kernel is exp(-4.5 * (i / blurSize)^2), a gaussian with a sigma of blurSize / 3
+  const float sigma = GetShadowBlurSize(layer, shadow) / 3.f;
+  
+  SkCanvas* pCanvas = pDrawable->mSurface->getCanvas();
+  sk_sp<SkImage> content = pDrawable->mSurface->makeImageSnapshot();
+  
+  SkMatrix m;
+  m.reset();
+  
+  pCanvas->clear(SK_ColorTRANSPARENT);
+  pCanvas->setMatrix(m);
+  
+  SkPaint blurPaint;
+  blurPaint.setImageFilter(SkImageFilters::Blur(sigma, sigma, SkTileMode::kDecal, nullptr));
+  pCanvas->drawImage(content.get(), shadow.mXOffset * scale, shadow.mYOffset * scale, SkSamplingOptions(), &blurPaint);
+  
+  IBlend blend(EBlend::Default, shadow.mOpacity);
+  m = SkMatrix::Scale(scale, scale);
+  pCanvas->setMatrix(m);
+  pCanvas->translate(-layer->Bounds().L, -layer->Bounds().T);
+  SkPaint p = SkiaPaint(shadow.mPattern, &blend, mShaderCache.get());
+  p.setBlendMode(SkBlendMode::kSrcIn);
+  pCanvas->drawPaint(p);
+  
+  if (shadow.mDrawForeground)
+  {
+    m.reset();
+    pCanvas->setMatrix(m);
+    pCanvas->drawImage(content.get(), 0.0, 0.0);
+  }
+  
+  return true;
+}
+
 void IGraphicsSkia::DrawFastDropShadow(const IRECT& innerBounds, const IRECT& outerBounds, float xyDrop, float roundness, float blur, IBlend* pBlend)
 {
   SkRect r = SkiaRect(innerBounds.GetTranslated(xyDrop, xyDrop));
@@ -937,6 +1951,89 @@ void IGraphicsSkia::DrawFastDropShadow(const IRECT& innerBounds, const IRECT& ou
   mCanvas->drawRoundRect(r, roundness, roundness, paint);
 }
 
+#pragma mark - Shaders
+
+/** A runtime effect, with the SkSL of an IShaderSource wrapped in a main() that maps the coordinates to the drawn rectangle */
+class IGraphicsSkia::Shader : public APIShader
+{
+public:
+  Shader(sk_sp<SkRuntimeEffect> effect, int nUniforms)
+  : APIShader(nUniforms)
+  , mEffect(std::move(effect))
+  {
+    const SkRuntimeEffect::Uniform* pData = mEffect->findUniform("uData");
+    const SkRuntimeEffect::Uniform* pSize = mEffect->findUniform("uSize");
+    const SkRuntimeEffect::Uniform* pBounds = mEffect->findUniform("uBounds");
+    mDataOffset = pData ? pData->offset : 0;
+    mSizeOffset = pSize ? pSize->offset : 0;
+    mBoundsOffset = pBounds ? pBounds->offset : 0;
+  }
+
+  sk_sp<SkShader> MakeShader(const IRECT& bounds, float scale, const float* pUniforms) const
+  {
+    sk_sp<SkData> data = SkData::MakeZeroInitialized(mEffect->uniformSize());
+    uint8_t* pBytes = static_cast<uint8_t*>(data->writable_data());
+    const float size[2] = { bounds.W() * scale, bounds.H() * scale };
+    const float rect[4] = { bounds.L, bounds.T, bounds.W(), bounds.H() };
+
+    if (NUniforms())
+      memcpy(pBytes + mDataOffset, pUniforms, NUniforms() * sizeof(float));
+    memcpy(pBytes + mSizeOffset, size, sizeof(size));
+    memcpy(pBytes + mBoundsOffset, rect, sizeof(rect));
+
+    return mEffect->makeShader(std::move(data), nullptr, 0, nullptr, false);
+  }
+
+private:
+  sk_sp<SkRuntimeEffect> mEffect;
+  size_t mDataOffset = 0;
+  size_t mSizeOffset = 0;
+  size_t mBoundsOffset = 0;
+};
+
+APIShader* IGraphicsSkia::CreateAPIShader(const IShaderSource& source, WDL_String& error)
+{
+  if (!source.mSkSL)
+  {
+    error.Set("No SkSL source");
+    return nullptr;
+  }
+
+  const int nUniforms = std::max(source.mNUniforms, 0);
+
+  WDL_String skslSource;
+  skslSource.SetFormatted(128, "uniform float uData[%d];\nuniform float2 uSize;\nuniform float4 uBounds;\n", std::max(nUniforms, 1));
+  skslSource.Append(source.mSkSL);
+  skslSource.Append("\nhalf4 main(float2 p) {\n  return half4(shade((p - uBounds.xy) / uBounds.zw, uSize));\n}\n");
+
+  auto [effect, errorText] = SkRuntimeEffect::MakeForShader(SkString(skslSource.Get()));
+
+  if (!effect)
+  {
+    error.Set(errorText.c_str());
+    return nullptr;
+  }
+
+  return new Shader(std::move(effect), nUniforms);
+}
+
+void IGraphicsSkia::DrawAPIShader(APIShader* pAPIShader, const IRECT& bounds, const float* pUniforms)
+{
+  Shader* pShader = dynamic_cast<Shader*>(pAPIShader);
+
+  if (!pShader || bounds.Empty())
+    return;
+
+  SkPaint paint;
+  paint.setShader(pShader->MakeShader(bounds, static_cast<float>(GetBackingPixelScale()), pUniforms));
+  paint.setBlendMode(SkBlendMode::kSrc);
+
+  PathClipRegion();
+  PathTransformSetMatrix(IMatrix());
+  mCanvas->drawRect(SkiaRect(bounds), paint);
+  PathTransformSetMatrix(GetTransformMatrix());
+}
+
 const char* IGraphicsSkia::GetDrawingAPIStr()
 {
 #ifdef IGRAPHICS_CPU
@@ -947,5 +2044,7 @@ const char* IGraphicsSkia::GetDrawingAPIStr()
   return "SKIA | GL3";
 #elif defined IGRAPHICS_METAL
   return "SKIA | Metal";
+#elif defined IGRAPHICS_VULKAN
+  return "SKIA | Vulkan";
 #endif
 }
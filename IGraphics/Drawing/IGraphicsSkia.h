@@ -12,11 +12,16 @@
 #define SK_GL
 #endif
 
+#if defined IGRAPHICS_VULKAN
+#define SK_VULKAN
+#endif
+
 #pragma warning( push )
 #pragma warning( disable : 4244 )
 #include "SkSurface.h"
 #include "SkPath.h"
 #include "SkCanvas.h"
+#include "SkPictureRecorder.h"
 #include "SkImage.h"
 #include "GrDirectContext.h"
 #pragma warning( pop )
@@ -36,8 +41,11 @@ SkColor SkiaColor(const IColor& color, const IBlend* pBlend);
 /** Get SkTileMode for IPattern */
 SkTileMode SkiaTileMode(const IPattern& pattern);
 
-/** Converts IPattern to SkPaint */
-SkPaint SkiaPaint(const IPattern& pattern, const IBlend* pBlend);
+class SkiaShaderCache;
+
+/** Converts IPattern to SkPaint
+ * @param pShaderCache If not nullptr, gradient shaders are taken from and added to this cache rather than made every time */
+SkPaint SkiaPaint(const IPattern& pattern, const IBlend* pBlend, SkiaShaderCache* pShaderCache = nullptr);
 
 /** IGraphics draw class using Skia
 *   @ingroup DrawClasses */
@@ -45,7 +53,9 @@ class IGraphicsSkia : public IGraphics
 {
 private:
   class Bitmap;
+  class Shader;
   struct Font;
+  struct VulkanContext;
 public:
   IGraphicsSkia(IGEditorDelegate& dlg, int w, int h, int fps, float scale);
   ~IGraphicsSkia();
@@ -57,6 +67,17 @@ public:
   void OnViewInitialized(void* pContext) override;
   void OnViewDestroyed() override;
   void DrawResize() override;
+  bool BeginOffscreenDraw() override;
+
+  /** Share one GrDirectContext between the editors in the process that enable this, so that shaders are compiled and glyphs and images are uploaded once,
+   * within one resource budget. Only used with Metal and Vulkan, as a GL context can't be shared, and not with a render thread, as a GrDirectContext must only
+   * be used on one thread. Takes effect when the window is next opened
+   * @param enable Set \c true to share the GPU context */
+  void EnableSharedGPUContext(bool enable) { mShareGPUContext = enable; }
+
+  /** Set how much GPU memory Skia may keep for cached textures and buffers, see GrDirectContext::setResourceCacheLimit(). With a shared context, this is the budget for all of the editors sharing it
+   * @param bytes The limit in bytes, or 0 to keep Skia's default */
+  void SetGPUResourceCacheLimit(size_t bytes);
 
   void DrawBitmap(const IBitmap& bitmap, const IRECT& dest, int srcX, int srcY, const IBlend* pBlend) override;
 
@@ -108,6 +129,9 @@ public:
   //void FillEllipse(const IColor& color, float x, float y, float r1, float r2, float angle, const IBlend* pBlend) override;
 #endif
   void DrawFastDropShadow(const IRECT& innerBounds, const IRECT& outerBounds, float xyDrop, float roundness, float blur, IBlend* pBlend) override;
+
+  APIShader* CreateAPIShader(const IShaderSource& source, WDL_String& error) override;
+  void DrawAPIShader(APIShader* pShader, const IRECT& bounds, const float* pUniforms) override;
   
   IColor GetPoint(int x, int y) override;
   void* GetDrawContext() override { return (void*) mCanvas; }
@@ -117,16 +141,24 @@ public:
   bool FlippedBitmap() const override { return false; }
 
   APIBitmap* CreateAPIBitmap(int width, int height, float scale, double drawScale, bool cacheable = false) override;
+  APIBitmap* CreateAPIBitmapFromPixels(int width, int height, const uint8_t* pPixels, int rowBytes, float scale) override;
+  bool DecodeAPIBitmap(const char* fileNameOrResID, EResourceLocation location, const char* ext, int& width, int& height, RawBitmapData& pixels) override;
 
   void GetLayerBitmapData(const ILayerPtr& layer, RawBitmapData& data) override;
   void ApplyShadowMask(ILayerPtr& layer, RawBitmapData& mask, const IShadow& shadow) override;
+  bool ApplyGPULayerDropShadow(ILayerPtr& layer, const IShadow& shadow) override;
 
   void UpdateLayer() override;
+  
+  void StartDisplayList(const IRECT& bounds) override;
+  IDisplayListPtr EndDisplayList() override;
+  void DrawDisplayList(const IDisplayListPtr& list, const IMatrix& transform) override;
     
 protected:
     
   float DoMeasureText(const IText& text, const char* str, IRECT& bounds) const override;
   void DoDrawText(const IText& text, const char* str, const IRECT& bounds, const IBlend* pBlend) override;
+  void DoPathPolyline(const float* x, const float* y, int nPoints, bool moveToFirst) override;
 
   bool LoadAPIFont(const char* fontID, const PlatformFontPtr& font) override;
 
@@ -137,24 +169,40 @@ private:
 
   void PathTransformSetMatrix(const IMatrix& m) override;
   void SetClipRegion(const IRECT& r) override;
+#if defined OS_WIN && defined IGRAPHICS_CPU
+  void CompleteRegion(const IRECT& bounds) override { mPresentRECT = mPresentRECT.Union(bounds); }
+#endif
     
   void RenderPath(SkPaint& paint);
     
   sk_sp<SkSurface> mSurface;
   SkCanvas* mCanvas = nullptr;
+  std::unique_ptr<SkPictureRecorder> mPictureRecorder;
+  SkCanvas* mPreRecordingCanvas = nullptr;
+  IRECT mRecordingBounds;
   SkPath mMainPath;
+  std::vector<SkPoint> mPolylinePoints; // scratch space for DoPathPolyline()
   SkMatrix mMatrix;
   SkMatrix mClipMatrix;
   SkMatrix mFinalMatrix;
 
 #if defined OS_WIN && defined IGRAPHICS_CPU
   WDL_TypedBuf<uint8_t> mSurfaceMemory;
+  IRECT mPresentRECT; // the union of the regions drawn this frame, the only pixels copied to the window
 #endif
   
 #ifndef IGRAPHICS_CPU
   sk_sp<GrDirectContext> mGrContext;
   sk_sp<SkSurface> mScreenSurface;
 #endif
+
+#ifdef IGRAPHICS_VULKAN
+  std::unique_ptr<VulkanContext> mVulkan;
+#endif
+
+  bool mShareGPUContext = false;
+  bool mSharingGPUContext = false;
+  size_t mGPUResourceCacheLimit = 0;
   
 #ifdef IGRAPHICS_METAL
   void* mMTLDevice;
@@ -163,6 +211,8 @@ private:
   void* mMTLLayer;
 #endif
 
+  std::unique_ptr<SkiaShaderCache> mShaderCache; // gradient shaders for the patterns drawn recently
+
   static StaticStorage<Font> sFontCache;
 };
 
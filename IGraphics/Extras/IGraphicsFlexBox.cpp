@@ -31,6 +31,39 @@ void IFlexBox::CalcLayout(YGDirection direction)
   YGNodeCalculateLayout(mRootNodeRef, YGUndefined, YGUndefined, direction);
 }
 
+void IFlexBox::CalcLayout(ItemChangedFunc func, YGDirection direction)
+{
+  YGNodeCalculateLayout(mRootNodeRef, YGUndefined, YGUndefined, direction);
+  
+  // item bounds include the root position, so if the root has moved every item must be checked
+  const IRECT rootBounds = GetRootBounds();
+  const bool rootMoved = rootBounds.L != mRootBounds.L || rootBounds.T != mRootBounds.T;
+  const int nItems = static_cast<int>(YGNodeGetChildCount(mRootNodeRef));
+  const int nPrevItems = static_cast<int>(mItemBounds.size());
+  
+  mRootBounds = rootBounds;
+  mItemBounds.resize(nItems);
+  
+  for (int i = 0; i < nItems; i++)
+  {
+    YGNodeRef child = YGNodeGetChild(mRootNodeRef, i);
+    
+    if (!YGNodeGetHasNewLayout(child) && !rootMoved && i < nPrevItems)
+      continue;
+    
+    YGNodeSetHasNewLayout(child, false);
+    const IRECT bounds = GetItemBounds(i);
+    
+    if (i < nPrevItems && bounds == mItemBounds[i])
+      continue;
+    
+    mItemBounds[i] = bounds;
+    func(i, bounds);
+  }
+  
+  YGNodeSetHasNewLayout(mRootNodeRef, false);
+}
+
 YGNodeRef IFlexBox::AddItem(float width, float height, YGAlign alignSelf, float grow, float shrink, float margin)
 {
   int index = mNodeCounter;
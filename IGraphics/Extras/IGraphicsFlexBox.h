@@ -1,5 +1,8 @@
 #pragma once
 
+#include <functional>
+#include <vector>
+
 #include "Yoga.h"
 #include "IGraphicsStructs.h"
 
@@ -11,11 +14,17 @@ BEGIN_IGRAPHICS_NAMESPACE
 class IFlexBox
 {
 public:
+  /** Called by CalcLayout() for an item whose bounds have changed
+   * @param nodeIndex The index of the item
+   * @param bounds The new bounds of the item, see GetItemBounds() */
+  using ItemChangedFunc = std::function<void(int nodeIndex, const IRECT& bounds)>;
+
   IFlexBox();
   
   ~IFlexBox();
   
-  /** Initialize the IFlexBox flex container
+  /** Initialize the IFlexBox flex container. This can be called again with new bounds when the container is resized, keeping the items,
+   * in which case only the parts of the layout that depend on the changed bounds are recalculated
    * @param r The IRECT bounds for the flex container
    * @param direction https://yogalayout.com/docs/flex-direction
    * @param justify https://yogalayout.com/docs/justify-content
@@ -41,6 +50,13 @@ public:
   /** Calculate the layout, call after add all items
    * @param direction https://yogalayout.com/docs/layout-direction */
   void CalcLayout(YGDirection direction = YGDirectionLTR);
+
+  /** Calculate the layout incrementally, and call a function for each item whose bounds have changed since the last call, e.g. to update a control
+   * with IControl::SetTargetAndDrawRECTs() and mark it dirty. Yoga only recalculates the nodes that have been dirtied by style changes since the
+   * last layout, and only the items it has laid out again are compared with their previous bounds. The first call reports every item
+   * @param func Called for each item whose bounds have changed
+   * @param direction https://yogalayout.com/docs/layout-direction */
+  void CalcLayout(ItemChangedFunc func, YGDirection direction = YGDirectionLTR);
   
   /** Get an IRECT of the root node bounds */
   IRECT GetRootBounds() const;
@@ -50,6 +66,8 @@ public:
   
 private:
   int mNodeCounter = 0;
+  std::vector<IRECT> mItemBounds; // the bounds last reported by CalcLayout(ItemChangedFunc, ...)
+  IRECT mRootBounds;
   YGConfigRef mConfigRef;
   YGNodeRef mRootNodeRef;
 };
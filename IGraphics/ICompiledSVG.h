@@ -0,0 +1,299 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc ICompiledSVG
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "nanosvg.h"
+
+#include "IPlugPlatform.h"
+
+BEGIN_IPLUG_NAMESPACE
+BEGIN_IGRAPHICS_NAMESPACE
+
+/** ICompiledSVG reads and writes SVGs that have already been parsed by NanoSVG, so that loading them doesn't parse any XML.
+ * Scripts/compile_svgs.py writes <name>.svg.svgbin next to each SVG, and with the NanoSVG renderer LoadSVG() picks that up in place of the SVG
+ * (or, on Windows, a resource of type SVGBIN with the same name as the SVG, e.g. KNOB_FN SVGBIN "knob.svg.svgbin").
+ * The LoadSVG() overload taking memory also accepts compiled data, e.g. embedded with Scripts/bin2c.py.
+ *
+ * The format is the NanoSVG image itself, already flattened to cubic beziers with their transforms applied, in little endian order:
+ * a header of "ISVB", the version, the width and height and the number of shapes, then each shape's style, paints and paths.
+ * The image is parsed with the units and dpi given to the script, so those passed to LoadSVG() don't apply to it. Skia draws SVGs from their XML, so it ignores compiled SVGs */
+class ICompiledSVG
+{
+public:
+  static constexpr uint32_t kMagic = 'I' | ('S' << 8) | ('V' << 16) | ('B' << 24);
+  static constexpr uint32_t kVersion = 1;
+
+  /** @return \c true if the data starts with the header of a compiled SVG */
+  static bool IsCompiled(const void* pData, int dataSize)
+  {
+    uint32_t magic = 0;
+
+    if (dataSize < static_cast<int>(sizeof(magic)))
+      return false;
+
+    memcpy(&magic, pData, sizeof(magic));
+    return magic == kMagic;
+  }
+
+  /** Make a NanoSVG image from compiled data
+   * @return The image, to be freed with nsvgDelete(), or nullptr if the data is not a valid compiled SVG */
+  static NSVGimage* Read(const void* pData, int dataSize)
+  {
+    Reader reader {static_cast<const uint8_t*>(pData), static_cast<size_t>(dataSize), 0};
+
+    if (!IsCompiled(pData, dataSize))
+      return nullptr;
+
+    reader.pos = sizeof(uint32_t);
+
+    uint32_t version = 0, nShapes = 0;
+
+    if (!reader.Read(version) || version != kVersion)
+      return nullptr;
+
+    NSVGimage* pImage = static_cast<NSVGimage*>(calloc(1, sizeof(NSVGimage)));
+
+    if (!pImage)
+      return nullptr;
+
+    bool ok = reader.Read(pImage->width) && reader.Read(pImage->height) && reader.Read(nShapes);
+    NSVGshape** ppNextShape = &pImage->shapes;
+
+    for (uint32_t s = 0; ok && s < nShapes; s++)
+    {
+      NSVGshape* pShape = static_cast<NSVGshape*>(calloc(1, sizeof(NSVGshape)));
+
+      if (!pShape)
+      {
+        ok = false;
+        break;
+      }
+
+      // linked before it's filled in, so that nsvgDelete() frees it if the data turns out to be truncated
+      *ppNextShape = pShape;
+      ppNextShape = &pShape->next;
+      ok = ReadShape(reader, *pShape);
+    }
+
+    if (!ok)
+    {
+      nsvgDelete(pImage);
+      return nullptr;
+    }
+
+    return pImage;
+  }
+
+  /** Write a NanoSVG image in the compiled format, used by Scripts/compile_svgs.py
+   * @param pImage The image, as returned by nsvgParse()
+   * @param data The buffer to append the compiled SVG to */
+  static void Write(const NSVGimage* pImage, std::vector<uint8_t>& data)
+  {
+    uint32_t nShapes = 0;
+
+    for (const NSVGshape* pShape = pImage->shapes; pShape; pShape = pShape->next)
+      nShapes++;
+
+    Put(data, kMagic);
+    Put(data, kVersion);
+    Put(data, pImage->width);
+    Put(data, pImage->height);
+    Put(data, nShapes);
+
+    for (const NSVGshape* pShape = pImage->shapes; pShape; pShape = pShape->next)
+    {
+      uint32_t nPaths = 0;
+
+      for (const NSVGpath* pPath = pShape->paths; pPath; pPath = pPath->next)
+        nPaths++;
+
+      // NanoSVG leaves the bytes after the id, and the focal point of linear gradients, uninitialised, so they're zeroed to keep the output reproducible
+      char id[sizeof(pShape->id)] = {};
+      strncpy(id, pShape->id, sizeof(id) - 1);
+
+      PutBytes(data, id, sizeof(id));
+      WritePaint(data, pShape->fill);
+      WritePaint(data, pShape->stroke);
+      Put(data, pShape->opacity);
+      Put(data, pShape->strokeWidth);
+      Put(data, pShape->strokeDashOffset);
+      PutBytes(data, pShape->strokeDashArray, sizeof(pShape->strokeDashArray));
+      Put(data, pShape->strokeDashCount);
+      Put(data, pShape->strokeLineJoin);
+      Put(data, pShape->strokeLineCap);
+      Put(data, pShape->miterLimit);
+      Put(data, pShape->fillRule);
+      Put(data, pShape->flags);
+      PutBytes(data, pShape->bounds, sizeof(pShape->bounds));
+      Put(data, nPaths);
+
+      for (const NSVGpath* pPath = pShape->paths; pPath; pPath = pPath->next)
+      {
+        Put(data, pPath->npts);
+        Put(data, pPath->closed);
+        PutBytes(data, pPath->bounds, sizeof(pPath->bounds));
+        PutBytes(data, pPath->pts, pPath->npts * 2 * sizeof(float));
+      }
+    }
+  }
+
+private:
+  struct Reader
+  {
+    const uint8_t* pData;
+    size_t size;
+    size_t pos;
+
+    bool ReadBytes(void* pDest, size_t n)
+    {
+      if (n > size - pos)
+        return false;
+
+      memcpy(pDest, pData + pos, n);
+      pos += n;
+      return true;
+    }
+
+    template <typename T>
+    bool Read(T& value) { return ReadBytes(&value, sizeof(T)); }
+  };
+
+  static bool ReadPaint(Reader& reader, NSVGpaint& paint)
+  {
+    if (!reader.Read(paint.type))
+      return false;
+
+    switch (paint.type)
+    {
+      case NSVG_PAINT_NONE:
+        return true;
+      case NSVG_PAINT_COLOR:
+        return reader.Read(paint.color);
+      case NSVG_PAINT_LINEAR_GRADIENT:
+      case NSVG_PAINT_RADIAL_GRADIENT:
+      {
+        int nStops = 0;
+
+        if (!reader.Read(nStops) || nStops < 1 || static_cast<size_t>(nStops) > (reader.size - reader.pos) / sizeof(NSVGgradientStop))
+        {
+          paint.type = NSVG_PAINT_NONE;
+          return false;
+        }
+
+        // allocated as NanoSVG does, with the stops following the struct, so that nsvgDelete() can free it
+        paint.gradient = static_cast<NSVGgradient*>(calloc(1, sizeof(NSVGgradient) + sizeof(NSVGgradientStop) * (nStops - 1)));
+
+        if (!paint.gradient)
+        {
+          paint.type = NSVG_PAINT_NONE;
+          return false;
+        }
+
+        NSVGgradient& gradient = *paint.gradient;
+        gradient.nstops = nStops;
+
+        return reader.ReadBytes(gradient.xform, sizeof(gradient.xform)) && reader.Read(gradient.spread) && reader.Read(gradient.fx) && reader.Read(gradient.fy)
+               && reader.ReadBytes(gradient.stops, sizeof(NSVGgradientStop) * nStops);
+      }
+      default:
+        paint.type = NSVG_PAINT_NONE;
+        return false;
+    }
+  }
+
+  static bool ReadShape(Reader& reader, NSVGshape& shape)
+  {
+    uint32_t nPaths = 0;
+
+    if (!reader.ReadBytes(shape.id, sizeof(shape.id)) || !ReadPaint(reader, shape.fill) || !ReadPaint(reader, shape.stroke))
+      return false;
+
+    shape.id[sizeof(shape.id) - 1] = '\0';
+
+    if (!(reader.Read(shape.opacity) && reader.Read(shape.strokeWidth) && reader.Read(shape.strokeDashOffset)
+          && reader.ReadBytes(shape.strokeDashArray, sizeof(shape.strokeDashArray)) && reader.Read(shape.strokeDashCount)
+          && reader.Read(shape.strokeLineJoin) && reader.Read(shape.strokeLineCap) && reader.Read(shape.miterLimit)
+          && reader.Read(shape.fillRule) && reader.Read(shape.flags) && reader.ReadBytes(shape.bounds, sizeof(shape.bounds)) && reader.Read(nPaths)))
+      return false;
+
+    shape.strokeDashCount = std::min<char>(std::max<char>(shape.strokeDashCount, 0), 8);
+
+    NSVGpath** ppNextPath = &shape.paths;
+
+    for (uint32_t p = 0; p < nPaths; p++)
+    {
+      NSVGpath* pPath = static_cast<NSVGpath*>(calloc(1, sizeof(NSVGpath)));
+
+      if (!pPath)
+        return false;
+
+      *ppNextPath = pPath;
+      ppNextPath = &pPath->next;
+
+      if (!reader.Read(pPath->npts) || !reader.Read(pPath->closed) || !reader.ReadBytes(pPath->bounds, sizeof(pPath->bounds)))
+        return false;
+
+      if (pPath->npts < 0 || static_cast<size_t>(pPath->npts) > (reader.size - reader.pos) / (2 * sizeof(float)))
+        return false;
+
+      const size_t ptsSize = static_cast<size_t>(pPath->npts) * 2 * sizeof(float);
+      pPath->pts = static_cast<float*>(malloc(ptsSize ? ptsSize : sizeof(float)));
+
+      if (!pPath->pts || !reader.ReadBytes(pPath->pts, ptsSize))
+        return false;
+    }
+
+    return true;
+  }
+
+  static void WritePaint(std::vector<uint8_t>& data, const NSVGpaint& paint)
+  {
+    Put(data, paint.type);
+
+    if (paint.type == NSVG_PAINT_COLOR)
+    {
+      Put(data, paint.color);
+    }
+    else if (paint.type == NSVG_PAINT_LINEAR_GRADIENT || paint.type == NSVG_PAINT_RADIAL_GRADIENT)
+    {
+      const NSVGgradient& gradient = *paint.gradient;
+      Put(data, gradient.nstops);
+      PutBytes(data, gradient.xform, sizeof(gradient.xform));
+      Put(data, gradient.spread);
+      Put(data, paint.type == NSVG_PAINT_RADIAL_GRADIENT ? gradient.fx : 0.f);
+      Put(data, paint.type == NSVG_PAINT_RADIAL_GRADIENT ? gradient.fy : 0.f);
+      PutBytes(data, gradient.stops, sizeof(NSVGgradientStop) * gradient.nstops);
+    }
+  }
+
+  static void PutBytes(std::vector<uint8_t>& data, const void* pSrc, size_t n)
+  {
+    const uint8_t* pBytes = static_cast<const uint8_t*>(pSrc);
+    data.insert(data.end(), pBytes, pBytes + n);
+  }
+
+  template <typename T>
+  static void Put(std::vector<uint8_t>& data, const T& value) { PutBytes(data, &value, sizeof(T)); }
+};
+
+END_IGRAPHICS_NAMESPACE
+END_IPLUG_NAMESPACE
@@ -8,7 +8,9 @@
  ==============================================================================
 */
 
+#include <algorithm>
 #include <cmath>
+#include <cstddef>
 #include <cstring>
 #define WDL_NO_SUPPORT_UTF8
 #include "dirscan.h"
@@ -78,6 +80,80 @@ END_IPLUG_NAMESPACE
 using namespace iplug;
 using namespace igraphics;
 
+// every allocation starts with the arena it came from, or nullptr for the heap
+static constexpr size_t kControlAllocHeader = alignof(std::max_align_t);
+
+IControlArena::~IControlArena()
+{
+  assert(mNumLive == 0 && "Controls from an arena must be deleted before it is");
+  
+  for (auto& chunk : mChunks)
+    ::operator delete(chunk.mData);
+}
+
+void* IControlArena::Allocate(size_t size)
+{
+  size = (size + kControlAllocHeader - 1) & ~(kControlAllocHeader - 1);
+  
+  if (mCurrentChunk < 0 || mUsed + size > mChunks[mCurrentChunk].mSize)
+  {
+    // move on to the next free chunk that is large enough, or add one
+    int next = mCurrentChunk + 1;
+    
+    while (next < static_cast<int>(mChunks.size()) && mChunks[next].mSize < size)
+      next++;
+    
+    if (next >= static_cast<int>(mChunks.size()))
+    {
+      const size_t chunkSize = std::max(mChunkSize, size);
+      mChunks.push_back({static_cast<char*>(::operator new(chunkSize)), chunkSize});
+      next = static_cast<int>(mChunks.size()) - 1;
+    }
+    
+    mCurrentChunk = next;
+    mUsed = 0;
+  }
+  
+  void* p = mChunks[mCurrentChunk].mData + mUsed;
+  mUsed += size;
+  mNumLive++;
+  return p;
+}
+
+void IControlArena::Release()
+{
+  assert(mNumLive > 0);
+  
+  if (--mNumLive == 0)
+  {
+    // every control has gone, e.g. after RemoveAllControls(), so start again at the beginning
+    mCurrentChunk = -1;
+    mUsed = 0;
+  }
+}
+
+void* IControl::operator new(size_t size)
+{
+  IControlArena* pArena = IControlArena::Current();
+  char* p = static_cast<char*>(pArena ? pArena->Allocate(size + kControlAllocHeader) : ::operator new(size + kControlAllocHeader));
+  *reinterpret_cast<IControlArena**>(p) = pArena;
+  return p + kControlAllocHeader;
+}
+
+void IControl::operator delete(void* p)
+{
+  if (!p)
+    return;
+  
+  char* pBase = static_cast<char*>(p) - kControlAllocHeader;
+  IControlArena* pArena = *reinterpret_cast<IControlArena**>(pBase);
+  
+  if (pArena)
+    pArena->Release();
+  else
+    ::operator delete(pBase);
+}
+
 IControl::IControl(const IRECT& bounds, int paramIdx, IActionFunction aF)
 : mRECT(bounds)
 , mTargetRECT(bounds)
@@ -114,6 +190,10 @@ void IControl::SetParamIdx(int paramIdx, int valIdx)
 {
   assert(valIdx > kNoValIdx && valIdx < NVals());
   mVals.at(valIdx).idx = paramIdx;
+
+  if (mGraphics)
+    mGraphics->InvalidateParamIndex();
+
   SetDirty(false);
 }
 
@@ -201,6 +281,10 @@ void IControl::SetDirty(bool triggerAction, int valIdx)
   ForValIdx(valIdx, setValue);
   
   mDirty = true;
+  mDirtyRegion = IRECT();
+
+  if (mGraphics)
+    mGraphics->AddDirtyControl(this);
   
   if (triggerAction)
   {
@@ -220,6 +304,26 @@ void IControl::SetDirty(bool triggerAction, int valIdx)
   }
 }
 
+void IControl::SetDirtyRegion(const IRECT& subRect, bool triggerAction, int valIdx)
+{
+  const bool wholeControlDirty = mDirty && mDirtyRegion.Empty();
+  const IRECT prevRegion = mDirty ? mDirtyRegion : IRECT();
+  const IRECT region = subRect.Intersect(mRECT);
+
+  SetDirty(triggerAction, valIdx);
+
+  if (!wholeControlDirty && !region.Empty())
+    mDirtyRegion = prevRegion.Empty() ? region : prevRegion.Union(region);
+}
+
+IRECT IControl::GetDirtyRECT() const
+{
+  if (mDirty && !mDirtyRegion.Empty() && !mAnimationFunc)
+    return mDirtyRegion;
+
+  return mRECT;
+}
+
 void IControl::Animate()
 {
   if (GetAnimationFunction())
@@ -286,6 +390,12 @@ void IControl::OnPopupMenuSelection(IPopupMenu* pSelectedMenu, int valIdx)
   }
 }
 
+void IControl::InvalidateControlIndex()
+{
+  if (mGraphics)
+    mGraphics->InvalidateControlIndex();
+}
+
 void IControl::SetPosition(float x, float y)
 {
   if (x < 0.f) x = 0.f;
@@ -426,6 +536,19 @@ void IControl::StartAnimation(int duration)
   mAnimationDuration = Milliseconds(duration);
 }
 
+void IControl::StartTween(float* pValue, float to, int duration, IEaseFunc ease)
+{
+  if (mGraphics)
+  {
+    mGraphics->StartTween(this, pValue, to, duration, ease);
+  }
+  else
+  {
+    *pValue = to;
+    SetDirty(false);
+  }
+}
+
 double IControl::GetAnimationProgress() const
 {
   if(!mAnimationFunc)
@@ -1047,11 +1170,56 @@ void IDirBrowseControlBase::SetupMenu()
   mMainMenu.Clear();
   mSelectedIndex = -1;
 
+  // with a background index the menu is built from its latest listing, rather than the file system
+  std::shared_ptr<const IDirIndex::Snapshot> pSnapshot;
+  std::function<void(const std::string&, IPopupMenu&)> addIndexedDir;
+
+  if (mIndex)
+  {
+    mIndexGeneration = mIndex->GetGeneration();
+    pSnapshot = mIndex->GetSnapshot();
+
+    addIndexedDir = [&](const std::string& path, IPopupMenu& menuToAddTo) {
+      const IDirIndex::Dir* pDir = pSnapshot->Find(path);
+
+      if (!pDir)
+        return;
+
+      for (const std::string& subdir : pDir->subdirs)
+      {
+        IPopupMenu* pNewMenu = new IPopupMenu();
+        menuToAddTo.AddItem(subdir.c_str(), pNewMenu, -2);
+        addIndexedDir(IDirIndex::JoinPath(path, subdir), *pNewMenu);
+      }
+
+      for (const IDirIndex::File& file : pDir->files)
+        AddFileItem(file.name.c_str(), IDirIndex::JoinPath(path, file.name).c_str(), menuToAddTo);
+
+      if (!mShowEmptySubmenus)
+        menuToAddTo.RemoveEmptySubmenus();
+    };
+  }
+
+  auto addDir = [&](const char* path, IPopupMenu& menuToAddTo) {
+    if (mIndex)
+    {
+      std::string root(path);
+
+      // the same trimming as IDirIndex::AddPath()
+      while (root.size() > 1 && (root.back() == '/' || root.back() == '\\'))
+        root.pop_back();
+
+      addIndexedDir(root, menuToAddTo);
+    }
+    else
+      ScanDirectory(path, menuToAddTo);
+  };
+
   int idx = 0;
 
   if (mPaths.GetSize() == 1)
   {
-    ScanDirectory(mPaths.Get(0)->Get(), mMainMenu);
+    addDir(mPaths.Get(0)->Get(), mMainMenu);
   }
   else
   {
@@ -1059,11 +1227,53 @@ void IDirBrowseControlBase::SetupMenu()
     {
       IPopupMenu* pNewMenu = new IPopupMenu();
       mMainMenu.AddItem(mPathLabels.Get(p)->Get(), idx++, pNewMenu);
-      ScanDirectory(mPaths.Get(p)->Get(), *pNewMenu);
+      addDir(mPaths.Get(p)->Get(), *pNewMenu);
     }
   }
   
   CollectSortedItems(&mMainMenu);
+
+  if (mIndex)
+    mIndex->Rescan();
+}
+
+void IDirBrowseControlBase::UseBackgroundIndex(const char* indexFilePath, double rescanIntervalMs)
+{
+  mIndex = std::make_unique<IDirIndex>(mExtension.Get());
+
+  for (int p = 0; p < mPaths.GetSize(); p++)
+    mIndex->AddPath(mPaths.Get(p)->Get());
+
+  mIndex->SetIndexFile(indexFilePath);
+  mIndex->SetRescanInterval(rescanIntervalMs);
+  mIndex->Start();
+
+  SetupMenu();
+}
+
+bool IDirBrowseControlBase::IsDirty()
+{
+  // the menu isn't rebuilt while it is open, since the open menu points to its items
+  if (mIndex && mIndex->GetGeneration() != mIndexGeneration && GetUI() && GetUI()->GetControlInPopupMenu() != this)
+  {
+    WDL_String selectedPath;
+
+    if (mSelectedIndex > -1 && mSelectedIndex < mItems.GetSize())
+      selectedPath.Set(mFiles.Get(mItems.Get(mSelectedIndex)->GetTag())->Get());
+
+    SetupMenu();
+
+    for (int i = 0; selectedPath.GetLength() && i < mItems.GetSize(); i++)
+    {
+      if (!strcmp(mFiles.Get(mItems.Get(i)->GetTag())->Get(), selectedPath.Get()))
+      {
+        mSelectedIndex = i;
+        break;
+      }
+    }
+  }
+
+  return IControl::IsDirty();
 }
 
 //void IDirBrowseControlBase::GetSelectedItemLabel(WDL_String& label)
@@ -1089,6 +1299,18 @@ void IDirBrowseControlBase::SetupMenu()
 //    path.Set("");
 //}
 
+void IDirBrowseControlBase::AddFileItem(const char* fileName, const char* fullPath, IPopupMenu& menuToAddTo)
+{
+  WDL_String menuEntry {fileName};
+  
+  if(!mShowFileExtensions)
+    menuEntry.Set(fileName, std::max(menuEntry.GetLength() - mExtension.GetLength() - 1, 0));
+  
+  IPopupMenu::Item* pItem = new IPopupMenu::Item(menuEntry.Get(), IPopupMenu::Item::kNoFlags, mFiles.GetSize());
+  menuToAddTo.AddItem(pItem, -2 /* sort alphabetically */);
+  mFiles.Add(new WDL_String(fullPath));
+}
+
 void IDirBrowseControlBase::ScanDirectory(const char* path, IPopupMenu& menuToAddTo)
 {
   WDL_DirScan d;
@@ -1113,16 +1335,9 @@ void IDirBrowseControlBase::ScanDirectory(const char* path, IPopupMenu& menuToAd
           const char* a = strstr(f, mExtension.Get());
           if (a && a > f && strlen(a) == strlen(mExtension.Get()))
           {
-            WDL_String menuEntry {f};
-            
-            if(!mShowFileExtensions)
-              menuEntry.Set(f, (int) (a - f) - 1);
-            
-            IPopupMenu::Item* pItem = new IPopupMenu::Item(menuEntry.Get(), IPopupMenu::Item::kNoFlags, mFiles.GetSize());
-            menuToAddTo.AddItem(pItem, -2 /* sort alphabetically */);
-            WDL_String* pFullPath = new WDL_String("");
-            d.GetCurrentFullFN(pFullPath);
-            mFiles.Add(pFullPath);
+            WDL_String fullPath;
+            d.GetCurrentFullFN(&fullPath);
+            AddFileItem(f, fullPath.Get(), menuToAddTo);
           }
         }
       }
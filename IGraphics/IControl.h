@@ -33,10 +33,75 @@
 #include "ptrlist.h"
 
 #include "IGraphics.h"
+#include "IPlugDirIndex.h"
 
 BEGIN_IPLUG_NAMESPACE
 BEGIN_IGRAPHICS_NAMESPACE
 
+/** Chunked storage for the controls created in IGEditorDelegate::LayoutUI(), so that they sit next to each other in creation order, which is the order IGraphics visits them every frame,
+ * rather than wherever the heap puts them. See IGraphics::EnableControlArena(). Controls deleted while others are alive are not reclaimed, the memory is reused once every control in the arena has gone */
+class IControlArena
+{
+public:
+  /** @param chunkSize The size of each chunk, controls larger than this get a chunk of their own */
+  IControlArena(size_t chunkSize = 64 * 1024)
+  : mChunkSize(chunkSize)
+  {}
+  
+  ~IControlArena();
+  
+  IControlArena(const IControlArena&) = delete;
+  IControlArena& operator=(const IControlArena&) = delete;
+  
+  /** @return Storage for a control, aligned for any type */
+  void* Allocate(size_t size);
+  
+  /** Called when a control allocated here is deleted */
+  void Release();
+  
+  /** @return The number of controls allocated here that have not been deleted */
+  int NumLive() const { return mNumLive; }
+  
+  /** @return The arena that controls constructed on this thread are allocated from, if any */
+  static IControlArena*& Current()
+  {
+    static thread_local IControlArena* sCurrent = nullptr;
+    return sCurrent;
+  }
+  
+  /** Allocates controls constructed on this thread from an arena for its lifetime */
+  class Scope
+  {
+  public:
+    Scope(IControlArena* pArena)
+    : mPrev(Current())
+    {
+      Current() = pArena;
+    }
+    
+    ~Scope() { Current() = mPrev; }
+    
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+    
+  private:
+    IControlArena* mPrev;
+  };
+  
+private:
+  struct Chunk
+  {
+    char* mData;
+    size_t mSize;
+  };
+  
+  size_t mChunkSize;
+  std::vector<Chunk> mChunks;
+  int mCurrentChunk = -1;
+  size_t mUsed = 0; // in the current chunk
+  int mNumLive = 0;
+};
+
 /** The lowest level base class of an IGraphics control. A control is anything on the GUI 
 *  @ingroup BaseControls */
 class IControl
@@ -76,7 +141,15 @@ public:
   void operator=(const IControl&) = delete;
   
   /** Destructor. Clean up any resources that your control owns. */
-  virtual ~IControl() {}
+  virtual ~IControl()
+  {
+    if (mGraphics && (mInDirtyList || mInAnimationList || mNumTweens))
+      mGraphics->RemoveFromDirtyTracking(this);
+  }
+
+  /** Controls are allocated from IControlArena::Current() when there is one, otherwise from the heap */
+  static void* operator new(size_t size);
+  static void operator delete(void* p);
 
   /** Implement this method to respond to a mouse down event on this control. 
    * @param x The X coordinate of the mouse event
@@ -159,6 +232,16 @@ public:
   /** Implement to receive MIDI messages sent to the control if mWantsMidi == true, see IEditorDelegate:SendMidiMsgFromDelegate() */
   virtual void OnMidi(const IMidiMsg& msg) {};
 
+  /** Called with the MIDI messages sent to the UI since the last timer tick, if mWantsMidi == true. The default calls OnMidi() for each one,
+   * override it to handle them together, for instance to redraw once
+   * @param pMsgs The messages, in the order they were sent
+   * @param nMsgs The number of messages */
+  virtual void OnMidiMsgs(const IMidiMsg* pMsgs, int nMsgs)
+  {
+    for (int i = 0; i < nMsgs; i++)
+      OnMidi(pMsgs[i]);
+  }
+
   /** @return true if supports this gesture */
   virtual bool OnGesture(const IGestureInfo& info);
   
@@ -271,7 +354,13 @@ public:
   
   /** Assign the control to a control group @see Control Groups
    * @param groupName A CString indicating the control group that this control should belong to */
-  void SetGroup(const char* groupName) { mGroup.Set(groupName); }
+  void SetGroup(const char* groupName)
+  {
+    mGroup.Set(groupName);
+    
+    if (mGraphics)
+      mGraphics->InvalidateGroupIndex();
+  }
   
   /** Get the group that the control belongs to, if any
    * @return A CString indicating the control group that this control belongs to (may be empty) */
@@ -306,7 +395,7 @@ public:
 
   /** Set the rectangular draw area for this control, within the graphics context
    * @param bounds The control's bounds */
-  void SetRECT(const IRECT& bounds) { mRECT = bounds; mMouseIsOver = false; OnResize(); }
+  void SetRECT(const IRECT& bounds) { mRECT = bounds; mMouseIsOver = false; InvalidateControlIndex(); OnResize(); }
   
   /** Get the rectangular mouse tracking target area, within the graphics context for this control
    * @return The control's target bounds within the graphics context */
@@ -314,11 +403,11 @@ public:
 
   /** Set the rectangular mouse tracking target area, within the graphics context for this control
    * @param bounds The control's new target bounds within the graphics context */
-  void SetTargetRECT(const IRECT& bounds) { mTargetRECT = bounds; mMouseIsOver = false; }
+  void SetTargetRECT(const IRECT& bounds) { mTargetRECT = bounds; mMouseIsOver = false; InvalidateControlIndex(); }
   
   /** Set BOTH the draw rect and the target area, within the graphics context for this control
    * @param bounds The control's new draw and target bounds within the graphics context */
-  void SetTargetAndDrawRECTs(const IRECT& bounds) { mRECT = mTargetRECT = bounds; mMouseIsOver = false; OnResize(); }
+  void SetTargetAndDrawRECTs(const IRECT& bounds) { mRECT = mTargetRECT = bounds; mMouseIsOver = false; InvalidateControlIndex(); OnResize(); }
 
   /** Set the position of the control, preserving the width and height. This may need to be overriden if you maintain custom positioning data in your control
    * @param x the new x coordinate of the top left corner of the control
@@ -390,8 +479,19 @@ public:
    * NOTE: it is easy to forget that this method always sets the control dirty, the argument refers to whether a consecutive action should be performed */
   virtual void SetDirty(bool triggerAction = true, int valIdx = kNoValIdx);
 
+  /** Mark part of the control as dirty, so that only that region is redrawn on the next display refresh, rather than the whole control.
+   * Regions marked before the control is drawn are combined, and marking the whole control with SetDirty() overrides them.
+   * The control's Draw() is clipped to the region, use IGraphics::GetDrawRegion() to skip drawing what is outside it
+   * @param subRect The region that changed, which is clipped to the control's bounds
+   * @param triggerAction See SetDirty()
+   * @param valIdx See SetDirty() */
+  void SetDirtyRegion(const IRECT& subRect, bool triggerAction = false, int valIdx = kNoValIdx);
+
+  /** @return The region of the control to redraw, which is the whole control unless only SetDirtyRegion() has been called since it was drawn */
+  IRECT GetDirtyRECT() const;
+
   /* Set the control clean, i.e. Called by IGraphics draw loop after control has been drawn */
-  virtual void SetClean() { mDirty = false; }
+  virtual void SetClean() { mDirty = false; mDirtyRegion = IRECT(); }
 
   /* Called at each display refresh by the IGraphics draw loop, triggers the control's AnimationFunc if it is set */
   void Animate();
@@ -411,7 +511,13 @@ public:
   int GetTag() const { return GetUI()->GetControlTag(this); }
   
   /** Specify whether this control wants to know about MIDI messages sent to the UI. See OnMIDIMsg() */
-  void SetWantsMidi(bool enable = true) { mWantsMidi = enable; }
+  void SetWantsMidi(bool enable = true)
+  {
+    mWantsMidi = enable;
+
+    if (mGraphics)
+      mGraphics->InvalidateMidiIndex();
+  }
 
   /** @return /c true if this control wants to know about MIDI messages send to the UI. See OnMIDIMsg() */
   bool GetWantsMidi() const { return mWantsMidi; }
@@ -474,16 +580,27 @@ public:
   
   /** Set the animation function
    * @param func A std::function conforming to IAnimationFunction */
-  void SetAnimation(IAnimationFunction func) { mAnimationFunc = func;}
+  void SetAnimation(IAnimationFunction func) { mAnimationFunc = func; if (func && mGraphics) mGraphics->AddAnimatingControl(this); }
   
   /** Set the animation function and starts it
    * @param func A std::function conforming to IAnimationFunction
    * @param duration Duration in milliseconds for the animation  */
-  void SetAnimation(IAnimationFunction func, int duration) { mAnimationFunc = func; StartAnimation(duration); }
+  void SetAnimation(IAnimationFunction func, int duration) { SetAnimation(func); StartAnimation(duration); }
 
   /** Get the control's animation function, if it exists */
   IAnimationFunction GetAnimationFunction() { return mAnimationFunc; }
 
+  /** Move one of the control's values, such as the opacity of a hover highlight, to a new value over time, see IGraphics::StartTween().
+   * The control is marked dirty each frame until it gets there. If the control isn't attached to an IGraphics the value is set straight away
+   * @param pValue The value, normally a member of the control, that Draw() uses
+   * @param to The value to end at
+   * @param duration Duration in milliseconds
+   * @param ease The easing function, such as EaseQuadraticInOut<double> from Easing.h, or nullptr for linear */
+  void StartTween(float* pValue, float to, int duration, IEaseFunc ease = nullptr);
+
+  /** @return \c true if any of the control's values are being moved by StartTween() */
+  bool IsTweening() const { return mNumTweens > 0; }
+
   /** Get the control's action function, if it exists */
   IActionFunction GetActionFunction() { return mActionFunc; }
 
@@ -503,6 +620,9 @@ public:
   
 #pragma mark - IControl Member variables
 protected:
+
+  /** Tell the graphics context that this control's bounds have changed, if it keeps a control index. Call this if you assign mRECT or mTargetRECT directly */
+  void InvalidateControlIndex();
   
   /** A helper template function to call a method for an individual value, or for all values
    * @param valIdx If this is > kNoValIdx execute the function for an individual value. If equal to kNoValIdx call the function for all values
@@ -521,18 +641,28 @@ protected:
     }
   }
     
+  // the members read by IGraphics for every control on every frame come first, so that they share cache lines
   IRECT mRECT;
   IRECT mTargetRECT;
+  IRECT mDirtyRegion; // empty if the whole control is dirty
+  bool mDirty = true;
+  bool mHide = false;
+  bool mDisabled = false;
+  /** if mGraphics::mHandleMouseOver = true, this will be true when the mouse is over control. If you need finer grained control of mouseovers, you can override OnMouseOver() and OnMouseOut() */
+  bool mMouseIsOver = false;
+  IBlend mBlend;
+private:
+  IAnimationFunction mAnimationFunc = nullptr;
+  bool mInDirtyList = false; // used by IGraphics incremental dirty tracking
+  bool mInAnimationList = false;
+  int mNumTweens = 0; // the control's tweens in the IGraphics animation scheduler
+protected:
   
   /** Controls can be grouped for hiding and showing panels */
   WDL_String mGroup;
   
   IText mText;
-  IBlend mBlend;
   int mTextEntryLength = DEFAULT_TEXT_ENTRY_LEN;
-  bool mDirty = true;
-  bool mHide = false;
-  bool mDisabled = false;
   bool mDisablePrompt = true;
   bool mDblAsSingleClick = false;
   bool mMouseOverWhenDisabled = false;
@@ -541,8 +671,6 @@ protected:
   bool mWantsMidi = false;
   bool mWantsMultiTouch = false;
   bool mPromptShowsParamLabel = false;
-  /** if mGraphics::mHandleMouseOver = true, this will be true when the mouse is over control. If you need finer grained control of mouseovers, you can override OnMouseOver() and OnMouseOut() */
-  bool mMouseIsOver = false;
   WDL_String mTooltip;
 
   IColor mPTHighlightColor = COLOR_RED;
@@ -552,6 +680,9 @@ protected:
   {
     assert(nVals > 0);
     mVals.resize(nVals);
+
+    if (mGraphics)
+      mGraphics->InvalidateParamIndex();
   }
 
 #if defined VST3_API || defined VST3C_API
@@ -567,12 +698,13 @@ private:
   IGraphics* mGraphics = nullptr;
   IActionFunction mActionFunc = nullptr;
   IActionFunction mAnimationEndActionFunc = nullptr;
-  IAnimationFunction mAnimationFunc = nullptr;
   TimePoint mAnimationStartTime;
   Milliseconds mAnimationDuration;
   std::vector<ParamTuple> mVals { {kNoParameter, 0.} };
   std::unordered_map<EGestureType, IGestureFunc> mGestureFuncs;
   EGestureType mLastGesture = EGestureType::Unknown;
+
+  friend class IGraphics;
 };
 
 #pragma mark - Base Controls
@@ -650,6 +782,7 @@ public:
   void SetColor(EVColor colorIdx, const IColor& color)
   {
     mStyle.colorSpec.mColors[static_cast<int>(colorIdx)] = color;
+    InvalidateStaticLayer();
     mControl->SetDirty(false);
   }
 
@@ -658,6 +791,7 @@ public:
   void SetColors(const IVColorSpec& spec)
   {
     mStyle.colorSpec = spec;
+    InvalidateStaticLayer();
   }
 
   /** Get value of a specific EVColor in the IVControl */ 
@@ -666,21 +800,21 @@ public:
     return mStyle.colorSpec.GetColor(color);
   }
   
-  void SetLabelStr(const char* label) { mLabelStr.Set(label); mControl->SetDirty(false); }
+  void SetLabelStr(const char* label) { mLabelStr.Set(label); InvalidateStaticLayer(); mControl->SetDirty(false); }
   void SetValueStr(const char* value) { mValueStr.Set(value); mControl->SetDirty(false); }
-  void SetWidgetFrac(float frac) { mStyle.widgetFrac = Clip(frac, 0.f, 1.f);  mControl->OnResize(); mControl->SetDirty(false); }
+  void SetWidgetFrac(float frac) { mStyle.widgetFrac = Clip(frac, 0.f, 1.f);  mControl->OnResize(); InvalidateStaticLayer(); mControl->SetDirty(false); }
   void SetAngle(float angle) { mStyle.angle = Clip(angle, 0.f, 360.f);  mControl->SetDirty(false); }
-  void SetShowLabel(bool show) { mStyle.showLabel = show;  mControl->OnResize(); mControl->SetDirty(false); }
-  void SetShowValue(bool show) { mStyle.showValue = show;  mControl->OnResize(); mControl->SetDirty(false); }
-  void SetRoundness(float roundness) { mStyle.roundness = Clip(roundness, 0.f, 1.f); mControl->SetDirty(false); }
-  void SetDrawFrame(bool draw) { mStyle.drawFrame = draw; mControl->SetDirty(false); }
-  void SetDrawShadows(bool draw) { mStyle.drawShadows = draw; mControl->SetDirty(false); }
-  void SetEmboss(bool draw) { mStyle.emboss = draw; mControl->SetDirty(false); }
-  void SetShadowOffset(float offset) { mStyle.shadowOffset = offset; mControl->SetDirty(false); }
-  void SetFrameThickness(float thickness) { mStyle.frameThickness = thickness; mControl->SetDirty(false); }
+  void SetShowLabel(bool show) { mStyle.showLabel = show;  mControl->OnResize(); InvalidateStaticLayer(); mControl->SetDirty(false); }
+  void SetShowValue(bool show) { mStyle.showValue = show;  mControl->OnResize(); InvalidateStaticLayer(); mControl->SetDirty(false); }
+  void SetRoundness(float roundness) { mStyle.roundness = Clip(roundness, 0.f, 1.f); InvalidateStaticLayer(); mControl->SetDirty(false); }
+  void SetDrawFrame(bool draw) { mStyle.drawFrame = draw; InvalidateStaticLayer(); mControl->SetDirty(false); }
+  void SetDrawShadows(bool draw) { mStyle.drawShadows = draw; InvalidateStaticLayer(); mControl->SetDirty(false); }
+  void SetEmboss(bool draw) { mStyle.emboss = draw; InvalidateStaticLayer(); mControl->SetDirty(false); }
+  void SetShadowOffset(float offset) { mStyle.shadowOffset = offset; InvalidateStaticLayer(); mControl->SetDirty(false); }
+  void SetFrameThickness(float thickness) { mStyle.frameThickness = thickness; InvalidateStaticLayer(); mControl->SetDirty(false); }
   void SetSplashRadius(float radius) { mSplashRadius = radius * mMaxSplashRadius; }
   void SetSplashPoint(float x, float y) { mSplashPoint.x = x; mSplashPoint.y = y; }
-  void SetShape(EVShape shape) { mShape = shape; mControl->SetDirty(false); }
+  void SetShape(EVShape shape) { mShape = shape; InvalidateStaticLayer(); mControl->SetDirty(false); }
 
   /** Set the Style of this IVControl
    * @param style */
@@ -690,6 +824,29 @@ public:
     SetColors(style.colorSpec);
   }
 
+  /** Enable caching of the parts of this IVControl that don't depend on its value (the background and label by default) in a layer.
+   * The layer is redrawn automatically when the control is resized, the draw scale changes, or the style, colors, label or disabled state change.
+   * @param cache Set \c true to render the static parts once and composite the cached layer on subsequent draws */
+  void SetCacheStaticLayer(bool cache)
+  {
+    mCacheStaticLayer = cache;
+    
+    if(!cache)
+      mStaticLayer = nullptr;
+    
+    InvalidateStaticLayer();
+  }
+  
+  /** @return \c true if the static parts of this IVControl are cached in a layer */
+  bool GetCacheStaticLayer() const { return mCacheStaticLayer; }
+  
+  /** Mark the static layer as needing to be redrawn. Call this if an override of DrawStatic() depends on state that has changed */
+  void InvalidateStaticLayer()
+  {
+    if(mStaticLayer)
+      mStaticLayer->Invalidate();
+  }
+
   /** Get the style of this IVControl
    * @return IVStyle */
   IVStyle GetStyle() const { return mStyle; }
@@ -736,6 +893,43 @@ public:
     g.FillRect(GetColor(kBG), rect, &blend);
   }
   
+  /** Draw the parts of the IVControl that don't depend on its value. If SetCacheStaticLayer() is enabled, these are rendered via DrawStaticLayer()
+   * @param g The graphics context */
+  virtual void DrawStatic(IGraphics& g)
+  {
+    DrawBackground(g, mControl->GetRECT());
+    DrawLabel(g);
+  }
+  
+  /** Call DrawStatic(), either directly or via a cached layer if SetCacheStaticLayer() is enabled
+   * @param g The graphics context */
+  void DrawStaticLayer(IGraphics& g)
+  {
+    if(!mCacheStaticLayer)
+    {
+      DrawStatic(g);
+      return;
+    }
+    
+    // the disabled state is baked into the layer via the control's blend
+    const float blendWeight = mControl->GetBlend().mWeight;
+    
+    if(blendWeight != mStaticLayerBlendWeight)
+    {
+      mStaticLayerBlendWeight = blendWeight;
+      InvalidateStaticLayer();
+    }
+    
+    if(!g.CheckLayer(mStaticLayer))
+    {
+      g.StartLayer(mControl, mControl->GetRECT());
+      DrawStatic(g);
+      mStaticLayer = g.EndLayer();
+    }
+    
+    g.DrawLayer(mStaticLayer);
+  }
+  
   /** Draw the IVControl main widget (override) */
   virtual void DrawWidget(IGraphics& g)
   {
@@ -1074,6 +1268,8 @@ public:
     if(mValueInWidget)
       mValueBounds = mWidgetBounds;
     
+    InvalidateStaticLayer();
+    
     return clickableArea;
   }
   
@@ -1093,6 +1289,9 @@ protected:
   WDL_String mLabelStr;
   WDL_String mValueStr;
   EVShape mShape = EVShape::Rectangle;
+  ILayerPtr mStaticLayer; // Cached background and label, when mCacheStaticLayer is enabled
+  float mStaticLayerBlendWeight = -1.f; // The blend weight the static layer was last drawn with
+  bool mCacheStaticLayer = false;
 };
 
 /** A base class for controls that can do do multitouch */
@@ -1506,9 +1705,29 @@ protected:
     
     const float trackPos = static_cast<float>(GetValue(chIdx));
     
+    IRECT fillRect;
+    
+    if(GetTrackHandleBounds(r, chIdx, fillRect))
+      DrawTrackHandle(g, fillRect, chIdx, trackPos > mBaseValue);
+    
+    if(!GetStepped())
+      DrawPeak(g, GetTrackPeakBounds(fillRect, chIdx), chIdx, trackPos > mBaseValue);
+
+    if(mStyle.drawFrame && mDrawTrackFrame)
+      g.DrawRect(GetColor(kFR), r, &mBlend, mStyle.frameThickness);
+  }
+
+  /** Get the bounds of the handle of a track, as drawn by DrawTrack()
+   * @param r The bounds of the track
+   * @param chIdx channel index
+   * @param fillRect Set to the bounds of the handle
+   * @return \c true if the handle is drawn */
+  bool GetTrackHandleBounds(const IRECT& r, int chIdx, IRECT& fillRect) const
+  {
+    const float trackPos = static_cast<float>(GetValue(chIdx));
+    
     const bool stepped = GetStepped();
     
-    IRECT fillRect;
     const float bv = static_cast<float>(mBaseValue);
 
     if(bv > 0.f)
@@ -1557,35 +1776,34 @@ protected:
         }
       }
       
-      if(mZeroValueStepHasBounds || GetValue(chIdx) > 0.)
-        DrawTrackHandle(g, fillRect, chIdx, trackPos > mBaseValue);
+      return mZeroValueStepHasBounds || GetValue(chIdx) > 0.;
+    }
+    
+    return true;
+  }
+  
+  /** Get the bounds of the peak of a track that isn't stepped, as drawn by DrawTrack()
+   * @param fillRect The bounds of the handle, from GetTrackHandleBounds()
+   * @param chIdx channel index
+   * @return The bounds of the peak */
+  IRECT GetTrackPeakBounds(const IRECT& fillRect, int chIdx) const
+  {
+    const float trackPos = static_cast<float>(GetValue(chIdx));
+    
+    if(mDirection == EDirection::Vertical)
+    {
+      return IRECT(fillRect.L,
+                   trackPos < mBaseValue ? fillRect.B : fillRect.T,
+                   fillRect.R,
+                   trackPos < mBaseValue ? fillRect.B - mPeakSize: fillRect.T + mPeakSize);
     }
     else
     {
-      DrawTrackHandle(g, fillRect, chIdx, trackPos > mBaseValue);
-      
-      IRECT peakRect;
-      
-      if(mDirection == EDirection::Vertical)
-      {
-        peakRect = IRECT(fillRect.L,
-                         trackPos < mBaseValue ? fillRect.B : fillRect.T,
-                         fillRect.R,
-                         trackPos < mBaseValue ? fillRect.B - mPeakSize: fillRect.T + mPeakSize);
-      }
-      else
-      {
-        peakRect = IRECT(trackPos < mBaseValue ? fillRect.L + mPeakSize : fillRect.R - mPeakSize,
-                         fillRect.T,
-                         trackPos < mBaseValue ? fillRect.L : fillRect.R,
-                         fillRect.B);
-      }
-      
-      DrawPeak(g, peakRect, chIdx, trackPos > mBaseValue);
+      return IRECT(trackPos < mBaseValue ? fillRect.L + mPeakSize : fillRect.R - mPeakSize,
+                   fillRect.T,
+                   trackPos < mBaseValue ? fillRect.L : fillRect.R,
+                   fillRect.B);
     }
-
-    if(mStyle.drawFrame && mDrawTrackFrame)
-      g.DrawRect(GetColor(kFR), r, &mBlend, mStyle.frameThickness);
   }
 
   virtual void DrawTrackBackground(IGraphics& g, const IRECT& r, int chIdx)
@@ -1738,11 +1956,20 @@ public:
 
   void SetupMenu();
 
+  /** List the paths on a worker thread with an IDirIndex, rather than scanning them in SetupMenu(), so that slow drives don't block the UI.
+   * The menu is empty until the index has been read or the first scan has finished, and it is rebuilt when the index changes, keeping the selected file. Call this after AddPath()
+   * @param indexFilePath A file to keep the index in, so that the menu is filled straight away next time and later scans only list the folders that have changed, or nullptr
+   * @param rescanIntervalMs How often the worker checks the folders for changes, or 0 to only check them when the menu is set up again */
+  void UseBackgroundIndex(const char* indexFilePath = nullptr, double rescanIntervalMs = 5000.);
+
+  bool IsDirty() override;
+
 //  void GetSelectedItemLabel(WDL_String& label);
 //  void GetSelectedItemPath(WDL_String& path);
 
 private:
   void ScanDirectory(const char* path, IPopupMenu& menuToAddTo);
+  void AddFileItem(const char* fileName, const char* fullPath, IPopupMenu& menuToAddTo);
   void CollectSortedItems(IPopupMenu* pMenu);
   
 protected:
@@ -1756,6 +1983,8 @@ protected:
   WDL_PtrList<WDL_String> mFiles;
   WDL_PtrList<IPopupMenu::Item> mItems; // ptr to item for each file
   WDL_String mExtension;
+  std::unique_ptr<IDirIndex> mIndex;
+  int mIndexGeneration = -1; // the generation of mIndex that the menu was built from
 };
 
 /**@}*/
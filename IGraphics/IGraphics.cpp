@@ -8,7 +8,10 @@
  ==============================================================================
 */
 
+#include <atomic>
+
 #include "IGraphics.h"
+#include "ICompiledSVG.h"
 
 #define NANOSVG_IMPLEMENTATION
 #pragma warning(disable:4244) // float conversion
@@ -32,11 +35,16 @@ using VST3_API_BASE = iplug::IPlugVST3Controller;
 #include "IControls.h"
 #include "IGraphicsLiveEdit.h"
 #include "IFPSDisplayControl.h"
+#include "IMemoryStatsControl.h"
 #include "ICornerResizerControl.h"
 #include "IPopupMenuControl.h"
 #include "ITextEntryControl.h"
 #include "IBubbleControl.h"
 
+#ifdef SVG_USE_SKIA
+#include "IGraphicsSkia.h" // for SkiaBlendMode()
+#endif
+
 using namespace iplug;
 using namespace igraphics;
 
@@ -64,6 +72,10 @@ IGraphics::~IGraphics()
   // Thus, this prevents a call to a pure virtual in ReleaseMouseCapture
     
   mCursorHidden = false;
+  
+  // finish any background loads, before the SVG cache can be released
+  mResourceLoader = nullptr;
+  
   RemoveAllControls();
     
   StaticStorage<APIBitmap>::Accessor bitmapStorage(sBitmapCache);
@@ -81,6 +93,7 @@ void IGraphics::SetScreenScale(float scale)
   PlatformResize(GetDelegate()->EditorResizeFromUI(windowWidth, windowHeight, true));
   ForAllControls(&IControl::OnRescale);
   SetAllControlsDirty();
+  mTextMeasureCache.Clear(); // back-ends may measure text differently at different pixel scales
   DrawResize();
 }
 
@@ -98,6 +111,7 @@ void IGraphics::Resize(int w, int h, float scale, bool needsPlatformResize)
   mDrawScale = scale;
   mWidth = w;
   mHeight = h;
+  InvalidateControlIndex();
   
   if (mCornerResizer)
     mCornerResizer->OnRescale();
@@ -106,12 +120,138 @@ void IGraphics::Resize(int w, int h, float scale, bool needsPlatformResize)
   int windowHeight = WindowHeight() * GetPlatformWindowScale();
     
   PlatformResize(GetDelegate()->EditorResizeFromUI(windowWidth, windowHeight, needsPlatformResize));
+
+  // a drag or a host resize only redraws the live resize layer, the controls catch up when it settles
+  if (mLiveResizeEnabled && (mResizingInProcess || !needsPlatformResize))
+  {
+    mLiveResizing = true;
+    mLiveResizeFrameDirty = true;
+    mLastLiveResizeTime = std::chrono::high_resolution_clock::now();
+    DrawResize();
+    return;
+  }
+
   ForAllControls(&IControl::OnResize);
   SetAllControlsDirty();
+  mTextMeasureCache.Clear();
   DrawResize();
   
   if(mLayoutOnResize)
-    GetDelegate()->LayoutUI(this);
+    DoLayoutUI();
+}
+
+void IGraphics::EnableLiveResize(bool enable, int settleTime, const IColor& fillColor)
+{
+  mLiveResizeSettleTime = Milliseconds(settleTime);
+  mLiveResizeFillColor = fillColor;
+
+  if (enable == mLiveResizeEnabled)
+    return;
+
+  mLiveResizeEnabled = enable;
+
+  if (!enable && mLiveResizing)
+    EndLiveResize();
+}
+
+void IGraphics::EndLiveResize()
+{
+  mLiveResizing = false;
+  mLiveResizeFrameDirty = false;
+  mLiveResizeLayer = nullptr;
+
+  ForAllControls(&IControl::OnResize);
+
+  if (GetResizerMode() == EUIResizerMode::Scale)
+    ForAllControls(&IControl::OnRescale);
+
+  SetAllControlsDirty();
+  mTextMeasureCache.Clear();
+
+  if (mLayoutOnResize)
+    DoLayoutUI();
+}
+
+void IGraphics::DrawLiveResize(float scale)
+{
+  const IRECT bounds = GetBounds();
+
+  if (!mLiveResizeLayer)
+  {
+    // the one full quality frame of the resize, the special controls are drawn over it where they are now
+    StartLayer(nullptr, bounds);
+    ForStandardControlsFunc([this, bounds, scale](IControl* pControl) { DrawControl(pControl, bounds, scale); });
+    mLiveResizeLayer = EndLayer();
+  }
+
+  PrepareRegion(bounds);
+
+  if (GetResizerMode() == EUIResizerMode::Scale)
+  {
+    // the layer was drawn in the same coordinates, so the new draw scale scales it
+    DrawFittedLayer(mLiveResizeLayer, bounds, nullptr);
+  }
+  else
+  {
+    const IRECT& layerBounds = mLiveResizeLayer->Bounds();
+
+    if (layerBounds.R < bounds.R)
+      FillRect(mLiveResizeFillColor, IRECT(layerBounds.R, bounds.T, bounds.R, bounds.B));
+
+    if (layerBounds.B < bounds.B)
+      FillRect(mLiveResizeFillColor, IRECT(bounds.L, layerBounds.B, std::min(layerBounds.R, bounds.R), bounds.B));
+
+    DrawLayer(mLiveResizeLayer);
+  }
+
+  CompleteRegion(bounds);
+
+  ForSpecialControlsFunc([this, bounds, scale](IControl* pControl) { DrawControl(pControl, bounds, scale); });
+}
+
+void IGraphics::InitOffscreen(float screenScale)
+{
+  mScreenScale = screenScale;
+  DrawResize();
+  DoLayoutUI();
+  SetAllControlsDirty();
+}
+
+bool IGraphics::DrawToBitmapData(RawBitmapData& data, int& width, int& height, int& rowBytes)
+{
+  width = height = rowBytes = 0;
+
+  if (!BeginOffscreenDraw())
+    return false;
+
+  const IRECT bounds = GetBounds();
+  StartLayer(nullptr, bounds);
+  Draw(bounds, GetBackingPixelScale());
+  ILayerPtr layer = EndLayer();
+  GetLayerBitmapData(layer, data);
+  EndOffscreenDraw();
+
+  width = layer->GetAPIBitmap()->GetWidth();
+  height = layer->GetAPIBitmap()->GetHeight();
+  rowBytes = height ? data.GetSize() / height : 0;
+
+  return data.GetSize() > 0;
+}
+
+void IGraphics::DoLayoutUI()
+{
+  IControlArena::Scope arenaScope(mControlArenaEnabled ? mControlArena.get() : nullptr);
+  GetDelegate()->LayoutUI(this);
+}
+
+void IGraphics::EnableControlArena(bool enable)
+{
+  if (enable && !mControlArena)
+    mControlArena = std::make_unique<IControlArena>();
+  else if (!enable && mControlArena && !mControlArena->NumLive())
+    mControlArena = nullptr; // an arena that still has controls in it is kept until this IGraphics is destroyed, but no longer used
+  
+  mControlArenaEnabled = enable;
 }
 
 void IGraphics::SetLayoutOnResize(bool layoutOnResize)
@@ -119,10 +259,39 @@ void IGraphics::SetLayoutOnResize(bool layoutOnResize)
   mLayoutOnResize = layoutOnResize;
 }
 
+void IGraphics::EnableControlIndex(bool enable, float cellSize)
+{
+  mControlIndexEnabled = enable;
+  mControlIndexCellSize = cellSize;
+  InvalidateControlIndex();
+}
+
+void IGraphics::UpdateControlIndex()
+{
+  if (!mControlIndexEnabled || mControlIndexValid)
+    return;
+
+  mControlIndex.Reset(GetBounds(), mControlIndexCellSize, NControls());
+
+  for (auto c = 0; c < NControls(); c++)
+  {
+    IControl* pControl = GetControl(c);
+    // N.B. Padding covers the outline padding in DrawControl()
+    mControlIndex.Add(c, pControl->GetRECT().Union(pControl->GetTargetRECT()).GetPadded(1.f));
+  }
+
+  mControlIndexValid = true;
+}
+
 void IGraphics::RemoveControlWithTag(int ctrlTag)
 {
-  mControls.DeletePtr(GetControlWithTag(ctrlTag), true);
-  mCtrlTags.erase(ctrlTag);
+  IControl* pControl = GetControlWithTag(ctrlTag);
+  UntagControl(pControl);
+  mControls.DeletePtr(pControl, true);
+  InvalidateControlIndex();
+  InvalidateGroupIndex();
+  InvalidateParamIndex();
+  InvalidateMidiIndex();
   SetAllControlsDirty();
 }
 
@@ -145,12 +314,14 @@ void IGraphics::RemoveControls(int fromIdx)
     if(pControl == mInPopupMenu)
       mInPopupMenu = nullptr;
     
-    if(pControl->GetTag() > kNoTag)
-      mCtrlTags.erase(pControl->GetTag());
-    
+    UntagControl(pControl);
     mControls.Delete(idx--, true);
   }
   
+  InvalidateControlIndex();
+  InvalidateGroupIndex();
+  InvalidateParamIndex();
+  InvalidateMidiIndex();
   SetAllControlsDirty();
 }
 
@@ -173,16 +344,22 @@ void IGraphics::RemoveControl(IControl* pControl)
   if(pControl == mInPopupMenu)
     mInPopupMenu = nullptr;
   
-  if(pControl->GetTag() > kNoTag)
-    mCtrlTags.erase(pControl->GetTag());
-  
+  UntagControl(pControl);
   mControls.DeletePtr(pControl, true);
+  InvalidateControlIndex();
+  InvalidateGroupIndex();
+  InvalidateParamIndex();
+  InvalidateMidiIndex();
   
   SetAllControlsDirty();
 }
 
 void IGraphics::RemoveAllControls()
 {
+  // cached SVG rasters are drawing context resources, so must be released along with the controls' layers
+  mSVGRasterCache.Clear();
+  mDigitAtlases.clear();
+  
   ReleaseMouseCapture();
   ClearMouseOver();
 
@@ -190,6 +367,7 @@ void IGraphics::RemoveAllControls()
   mTextEntryControl = nullptr;
   mCornerResizer = nullptr;
   mPerfDisplay = nullptr;
+  mMemoryStatsDisplay = nullptr;
     
 #ifndef NDEBUG
   mLiveEdit = nullptr;
@@ -198,7 +376,111 @@ void IGraphics::RemoveAllControls()
   mBubbleControls.Empty(true);
   
   mCtrlTags.clear();
+  mCtrlTagsByControl.clear();
   mControls.Empty(true);
+  InvalidateControlIndex();
+  InvalidateGroupIndex();
+  InvalidateParamIndex();
+  InvalidateMidiIndex();
+}
+
+void IGraphics::UntagControl(IControl* pControl)
+{
+  const auto it = mCtrlTagsByControl.find(pControl);
+
+  if (it != mCtrlTagsByControl.end())
+  {
+    mCtrlTags.erase(it->second);
+    mCtrlTagsByControl.erase(it);
+  }
+}
+
+void IGraphics::UpdateGroupIndex()
+{
+  if (mGroupIndexValid)
+    return;
+
+  for (auto& group : mCtrlGroups)
+    group.second.clear();
+
+  for (auto c = 0; c < NControls(); c++)
+  {
+    IControl* pControl = GetControl(c);
+
+    if (CStringHasContents(pControl->GetGroup()))
+      mCtrlGroups[pControl->GetGroup()].push_back(pControl);
+  }
+
+  mGroupIndexValid = true;
+}
+
+void IGraphics::UpdateParamIndex()
+{
+  if (mParamIndexValid)
+    return;
+
+  for (auto& controls : mParamControls)
+    controls.clear();
+
+  for (auto c = 0; c < NControls(); c++)
+  {
+    IControl* pControl = GetControl(c);
+
+    for (auto v = 0; v < pControl->NVals(); v++)
+    {
+      const int paramIdx = pControl->GetParamIdx(v);
+
+      if (paramIdx > kNoParameter)
+      {
+        if (paramIdx >= static_cast<int>(mParamControls.size()))
+          mParamControls.resize(paramIdx + 1);
+
+        mParamControls[paramIdx].push_back({pControl, v});
+      }
+    }
+  }
+
+  mParamIndexValid = true;
+}
+
+const std::vector<std::pair<IControl*, int>>* IGraphics::GetControlsWithParam(int paramIdx)
+{
+  UpdateParamIndex();
+
+  if (paramIdx <= kNoParameter || paramIdx >= static_cast<int>(mParamControls.size()) || mParamControls[paramIdx].empty())
+    return nullptr;
+
+  return &mParamControls[paramIdx];
+}
+
+const std::vector<IControl*>& IGraphics::GetControlsWantingMidi()
+{
+  if (!mMidiIndexValid)
+  {
+    mMidiControls.clear();
+
+    for (auto c = 0; c < NControls(); c++)
+    {
+      IControl* pControl = GetControl(c);
+
+      if (pControl->GetWantsMidi())
+        mMidiControls.push_back(pControl);
+    }
+
+    mMidiIndexValid = true;
+  }
+
+  return mMidiControls;
+}
+
+const std::vector<IControl*>* IGraphics::GetControlsInGroup(const char* group)
+{
+  if (!CStringHasContents(group))
+    return nullptr;
+
+  UpdateGroupIndex();
+  const auto it = mCtrlGroups.find(group);
+  return (it != mCtrlGroups.end() && !it->second.empty()) ? &it->second : nullptr;
 }
 
 void IGraphics::SetControlPosition(int idx, float x, float y)
@@ -275,6 +557,7 @@ void IGraphics::AttachBackground(const char* fileName)
   IControl* pBG = new IBitmapControl(0, 0, LoadBitmap(fileName, 1, false), kNoParameter, EBlend::Default);
   pBG->SetDelegate(*GetDelegate());
   mControls.Insert(0, pBG);
+  InvalidateControlIndex();
 }
 
 void IGraphics::AttachSVGBackground(const char* fileName)
@@ -282,6 +565,7 @@ void IGraphics::AttachSVGBackground(const char* fileName)
   IControl* pBG = new ISVGControl(GetBounds(), LoadSVG(fileName), true);
   pBG->SetDelegate(*GetDelegate());
   mControls.Insert(0, pBG);
+  InvalidateControlIndex();
 }
 
 void IGraphics::AttachPanelBackground(const IPattern& color)
@@ -289,6 +573,7 @@ void IGraphics::AttachPanelBackground(const IPattern& color)
   IControl* pBG = new IPanelControl(GetBounds(), color);
   pBG->SetDelegate(*GetDelegate());
   mControls.Insert(0, pBG);
+  InvalidateControlIndex();
 }
 
 IControl* IGraphics::AttachControl(IControl* pControl, int ctrlTag, const char* group)
@@ -300,11 +585,21 @@ IControl* IGraphics::AttachControl(IControl* pControl, int ctrlTag, const char*
     
     if (!result.second)
       return nullptr;
+    
+    mCtrlTagsByControl[pControl] = ctrlTag;
   }
   
   pControl->SetDelegate(*GetDelegate());
   pControl->SetGroup(group);
   mControls.Add(pControl);
+  InvalidateControlIndex();
+  InvalidateGroupIndex();
+  InvalidateParamIndex();
+  InvalidateMidiIndex();
+  AddDirtyControl(pControl);
+
+  if (pControl->GetAnimationFunction())
+    AddAnimatingControl(pControl);
     
   pControl->OnAttached();
   return pControl;
@@ -419,6 +714,30 @@ void IGraphics::ShowBubbleControl(IControl* pCaller, float x, float y, const cha
     mBubbleControls.Get(0)->ShowBubble(pCaller, x, y, str, dir, minimumContentBounds);
 }
 
+void IGraphics::EnableDrawProfiler(bool enable, int maxEvents)
+{
+  if (enable)
+  {
+    if (!mDrawProfiler)
+      mDrawProfiler = std::make_unique<IDrawProfiler>(maxEvents);
+  }
+  else
+    mDrawProfiler = nullptr;
+  
+  SetAllControlsDirty();
+}
+
+void IGraphics::ShowDrawProfileHeatmap(bool enable)
+{
+  if (enable)
+    EnableDrawProfiler(true);
+  
+  if (mDrawProfiler)
+    mDrawProfiler->SetShowHeatmap(enable);
+  
+  SetAllControlsDirty();
+}
+
 void IGraphics::ShowFPSDisplay(bool enable)
 {
   if (enable)
@@ -438,6 +757,25 @@ void IGraphics::ShowFPSDisplay(bool enable)
   SetAllControlsDirty();
 }
 
+void IGraphics::ShowMemoryStats(bool enable)
+{
+  if (enable)
+  {
+    if (!mMemoryStatsDisplay)
+    {
+      const float h = IMemoryStatsControl::kNumRows * IMemoryStatsControl::kRowHeight + 8.f;
+      mMemoryStatsDisplay = std::make_unique<IMemoryStatsControl>(GetBounds().GetPadded(-10).GetFromTRHC(260, h), GetDelegate()->GetMemoryStats());
+      mMemoryStatsDisplay->SetDelegate(*GetDelegate());
+    }
+  }
+  else
+  {
+    mMemoryStatsDisplay = nullptr;
+  }
+
+  SetAllControlsDirty();
+}
+
 IControl* IGraphics::GetControlWithTag(int ctrlTag) const
 {
   const auto it = mCtrlTags.find(ctrlTag);
@@ -465,33 +803,64 @@ void IGraphics::DisableControl(int paramIdx, bool disable)
 
 void IGraphics::ForControlWithParam(int paramIdx, std::function<void(IControl* pControl)> func)
 {
-  for (auto c = 0; c < NControls(); c++)
+  if (const std::vector<std::pair<IControl*, int>>* pControls = GetControlsWithParam(paramIdx))
   {
-    IControl* pControl = GetControl(c);
+    // a copy, since the function may relink controls
+    const std::vector<std::pair<IControl*, int>> controls = *pControls;
+    const IControl* pLast = nullptr;
 
-    if (pControl->LinkedToParam(paramIdx) > kNoValIdx)
+    for (const auto& link : controls)
     {
-      func(pControl);
-      // Could be more than one, don't break until we check them all.
+      if (link.first != pLast) // once per control, even if it has several values linked to the parameter
+        func(link.first);
+
+      pLast = link.first;
     }
   }
 }
 
 void IGraphics::ForControlInGroup(const char* group, std::function<void(IControl* pControl)> func)
 {
-  for (auto c = 0; c < NControls(); c++)
+  if (const std::vector<IControl*>* pControls = GetControlsInGroup(group))
   {
-    IControl* pControl = GetControl(c);
+    // a copy, since the function may change groups
+    const std::vector<IControl*> controls = *pControls;
 
-    if (CStringHasContents(pControl->GetGroup()))
+    for (auto pControl : controls)
+      func(pControl);
+  }
+}
+
+void IGraphics::HideGroup(const char* group, bool hide)
+{
+  if (const std::vector<IControl*>* pControls = GetControlsInGroup(group))
+  {
+    for (auto pControl : *pControls)
     {
-      if (strcmp(pControl->GetGroup(), group) == 0)
-        func(pControl);
-      // Could be more than one, don't break until we check them all.
+      if (pControl->IsHidden() != hide)
+        pControl->Hide(hide);
     }
   }
 }
 
+void IGraphics::DisableGroup(const char* group, bool disable)
+{
+  if (const std::vector<IControl*>* pControls = GetControlsInGroup(group))
+  {
+    for (auto pControl : *pControls)
+    {
+      if (pControl->IsDisabled() != disable)
+        pControl->SetDisabled(disable);
+    }
+  }
+}
+
+int IGraphics::NControlsInGroup(const char* group)
+{
+  const std::vector<IControl*>* pControls = GetControlsInGroup(group);
+  return pControls ? static_cast<int>(pControls->size()) : 0;
+}
+
 void IGraphics::ForStandardControlsFunc(std::function<void(IControl* pControl)> func)
 {
   for (auto c = 0; c < NControls(); c++)
@@ -501,9 +870,16 @@ void IGraphics::ForStandardControlsFunc(std::function<void(IControl* pControl)>
 void IGraphics::ForAllControlsFunc(std::function<void(IControl* pControl)> func)
 {
   ForStandardControlsFunc(func);
-  
+  ForSpecialControlsFunc(func);
+}
+
+void IGraphics::ForSpecialControlsFunc(std::function<void(IControl* pControl)> func)
+{
   if (mPerfDisplay)
     func(mPerfDisplay.get());
+
+  if (mMemoryStatsDisplay)
+    func(mMemoryStatsDisplay.get());
   
 #ifndef NDEBUG
   if (mLiveEdit)
@@ -547,7 +923,112 @@ void IGraphics::SetAllControlsDirty()
 
 void IGraphics::SetAllControlsClean()
 {
-  ForAllControls(&IControl::SetClean);
+  if (mIncrementalDirtyTracking)
+  {
+    // controls that are not queued are already clean
+    for (auto i = 0; i < mDirtyControls.GetSize(); i++)
+    {
+      IControl* pControl = mDirtyControls.Get(i);
+      pControl->mInDirtyList = false;
+      pControl->SetClean();
+    }
+
+    mDirtyControls.Empty();
+    ForSpecialControlsFunc([](IControl* pControl) { pControl->SetClean(); });
+  }
+  else
+    ForAllControls(&IControl::SetClean);
+}
+
+void IGraphics::EnableIncrementalDirtyTracking(bool enable)
+{
+  if (enable == mIncrementalDirtyTracking)
+    return;
+
+  mIncrementalDirtyTracking = enable;
+
+  auto clearFlags = [](IControl* pControl) { pControl->mInDirtyList = pControl->mInAnimationList = false; };
+  
+  for (auto i = 0; i < mDirtyControls.GetSize(); i++)
+    clearFlags(mDirtyControls.Get(i));
+
+  for (auto i = 0; i < mAnimatingControls.GetSize(); i++)
+    clearFlags(mAnimatingControls.Get(i));
+
+  mDirtyControls.Empty();
+  mAnimatingControls.Empty();
+
+  if (enable)
+  {
+    // seed the lists with the current state
+    ForAllControlsFunc([this](IControl* pControl) {
+      if (pControl->GetAnimationFunction())
+        AddAnimatingControl(pControl);
+    });
+
+    SetAllControlsDirty();
+  }
+}
+
+void IGraphics::AddDirtyControl(IControl* pControl)
+{
+  if (mIncrementalDirtyTracking && !pControl->mInDirtyList)
+  {
+    pControl->mInDirtyList = true;
+    mDirtyControls.Add(pControl);
+  }
+
+  if (mAdaptiveFPS)
+    NoteFrameActivity();
+}
+
+void IGraphics::AddAnimatingControl(IControl* pControl)
+{
+  if (mIncrementalDirtyTracking && !pControl->mInAnimationList)
+  {
+    pControl->mInAnimationList = true;
+    mAnimatingControls.Add(pControl);
+  }
+}
+
+void IGraphics::RemoveFromDirtyTracking(IControl* pControl)
+{
+  if (pControl->mInDirtyList)
+    mDirtyControls.DeletePtr(pControl);
+
+  if (pControl->mInAnimationList)
+    mAnimatingControls.DeletePtr(pControl);
+
+  pControl->mInDirtyList = pControl->mInAnimationList = false;
+
+  StopTweens(pControl);
+}
+
+void IGraphics::StartTween(IControl* pControl, float* pValue, float to, int duration, IEaseFunc ease)
+{
+  // a value that moves to another control's tweens is no longer counted for the first
+  if (IControl* pPrevControl = mAnimationScheduler.Stop(pValue))
+    pPrevControl->mNumTweens--;
+
+  mAnimationScheduler.Start(pControl, pValue, to, duration, ease, std::chrono::high_resolution_clock::now());
+  pControl->mNumTweens++;
+
+  if (mAdaptiveFPS)
+    NoteFrameActivity();
+}
+
+void IGraphics::StopTween(float* pValue)
+{
+  if (IControl* pControl = mAnimationScheduler.Stop(pValue))
+    pControl->mNumTweens--;
+}
+
+void IGraphics::StopTweens(IControl* pControl)
+{
+  if (pControl->mNumTweens)
+    mAnimationScheduler.RemoveControl(pControl);
+
+  pControl->mNumTweens = 0;
 }
 
 void IGraphics::AssignParamNameToolTips()
@@ -628,20 +1109,207 @@ void IGraphics::PromptUserInput(IControl& control, const IRECT& bounds, int valI
   }
 }
 
-void IGraphics::DrawText(const IText& text, const char* str, const IRECT& bounds, const IBlend* pBlend)
+void IGraphics::DrawText(const IText& text, const char* str, const IRECT& bounds, const IBlend* pBlend)
+{
+  if (!str || str[0] == '\0')
+    return;
+  
+  if (mDigitAtlasEnabled && DrawTextFromDigitAtlas(text, str, bounds, pBlend))
+    return;
+    
+  DoDrawText(text, str, bounds, pBlend);
+}
+
+float IGraphics::MeasureText(const IText& text, const char* str, IRECT& bounds) const
+{
+  if (!str || str[0] == '\0')
+    return 0.f;
+    
+  return DoMeasureText(text, str, bounds);
+}
+
+void IGraphics::EnableTextMeasureCache(bool enable, int maxEntries)
+{
+  mTextMeasureCacheEnabled = enable;
+  mTextMeasureCache.SetMaxEntries(maxEntries);
+  
+  if (!enable)
+    mTextMeasureCache.Clear();
+}
+
+void IGraphics::EnableDigitAtlas(bool enable)
+{
+  mDigitAtlasEnabled = enable;
+  
+  if (!enable)
+    mDigitAtlases.clear();
+  
+  SetAllControlsDirty();
+}
+
+bool IGraphics::DrawTextFromDigitAtlas(const IText& text, const char* str, const IRECT& bounds, const IBlend* pBlend)
+{
+  // the glyphs can only be drawn 1:1 under a translation, and layers can't be started whilst recording a display list
+  const bool translationOnly = mTransform.mXX == 1.0 && mTransform.mYY == 1.0 && mTransform.mXY == 0.0 && mTransform.mYX == 0.0;
+  
+  if (!translationOnly || mRecordingList || text.mAngle != 0.f)
+    return false;
+  
+  for (const char* pChar = str; *pChar; pChar++)
+  {
+    if (IDigitAtlas::GetCharIdx(*pChar) < 0)
+      return false;
+  }
+  
+  const IDigitAtlas& atlas = GetDigitAtlas(text);
+  const float scale = GetBackingPixelScale();
+  
+  float width = 0.f;
+  
+  for (const char* pChar = str; *pChar; pChar++)
+    width += atlas.mAdvances[IDigitAtlas::GetCharIdx(*pChar)];
+  
+  float x = bounds.L;
+  float y = bounds.T;
+  
+  switch (text.mAlign)
+  {
+    case EAlign::Near:     x = bounds.L;                  break;
+    case EAlign::Center:   x = bounds.MW() - width / 2.f; break;
+    case EAlign::Far:      x = bounds.R - width;          break;
+  }
+  
+  switch (text.mVAlign)
+  {
+    case EVAlign::Top:     y = bounds.T;                               break;
+    case EVAlign::Middle:  y = bounds.MH() - atlas.mTextHeight / 2.f;  break;
+    case EVAlign::Bottom:  y = bounds.B - atlas.mTextHeight;           break;
+  }
+  
+  // start on a device pixel, so that the glyphs are drawn 1:1
+  x = std::round((x + mTransform.mTX) * scale) / scale - static_cast<float>(mTransform.mTX);
+  y = std::round((y + mTransform.mTY) * scale) / scale - static_cast<float>(mTransform.mTY);
+  
+  const IBitmap bitmap = atlas.mLayer->GetBitmap();
+  const float top = y - IDigitAtlas::kPadding;
+  
+  for (const char* pChar = str; *pChar; pChar++)
+  {
+    const int idx = IDigitAtlas::GetCharIdx(*pChar);
+    const float left = x - IDigitAtlas::kPadding;
+    
+    if (*pChar != ' ')
+      DrawBitmap(bitmap, IRECT(left, top, left + atlas.mCellWidth, top + atlas.mCellHeight), idx * atlas.mCellWidth, 0, pBlend);
+    
+    x += atlas.mAdvances[idx];
+  }
+  
+  return true;
+}
+
+const IDigitAtlas& IGraphics::GetDigitAtlas(const IText& text)
+{
+  static constexpr int kMaxDigitAtlases = 16;
+  
+  const float screenScale = GetScreenScale();
+  const float drawScale = GetDrawScale();
+  
+  for (auto it = mDigitAtlases.begin(); it != mDigitAtlases.end(); ++it)
+  {
+    if ((*it)->Matches(text, screenScale, drawScale))
+    {
+      std::rotate(mDigitAtlases.begin(), it, it + 1);
+      return *mDigitAtlases.front();
+    }
+  }
+  
+  auto pAtlas = std::make_unique<IDigitAtlas>();
+  const IText glyphText = text.WithAlign(EAlign::Near).WithVAlign(EVAlign::Top);
+  const float scale = GetBackingPixelScale();
+  
+  pAtlas->mText = text;
+  pAtlas->mScreenScale = screenScale;
+  pAtlas->mDrawScale = drawScale;
+  
+  // measure the advances between zeros, as the bounds of a glyph don't include its side bearings, and a space has no bounds
+  IRECT r;
+  const float zerosWidth = MeasureText(glyphText, "00", r);
+  float maxWidth = 0.f;
+  
+  for (auto i = 0; i < IDigitAtlas::kNumChars; i++)
+  {
+    const char glyph[2] = { IDigitAtlas::kChars[i], '\0' };
+    const char between[4] = { '0', IDigitAtlas::kChars[i], '0', '\0' };
+    const float advance = MeasureText(glyphText, between, r = IRECT()) - zerosWidth;
+    
+    pAtlas->mAdvances[i] = std::max(std::round(advance * scale) / scale, 0.f);
+    maxWidth = std::max(maxWidth, std::max(advance, MeasureText(glyphText, glyph, r = IRECT())));
+  }
+  
+  MeasureText(glyphText, IDigitAtlas::kChars, r = IRECT());
+  pAtlas->mTextHeight = r.H();
+  pAtlas->mCellWidth = static_cast<int>(std::ceil(maxWidth)) + 2 * IDigitAtlas::kPadding;
+  pAtlas->mCellHeight = static_cast<int>(std::ceil(r.H())) + 2 * IDigitAtlas::kPadding;
+  
+  // rendering into a layer resets the transform, so restore it afterwards
+  const IMatrix transform = mTransform;
+  
+  StartLayer(nullptr, IRECT(0.f, 0.f, static_cast<float>(pAtlas->mCellWidth * IDigitAtlas::kNumChars), static_cast<float>(pAtlas->mCellHeight)));
+  
+  for (auto i = 0; i < IDigitAtlas::kNumChars; i++)
+  {
+    const char glyph[2] = { IDigitAtlas::kChars[i], '\0' };
+    const float left = static_cast<float>(i * pAtlas->mCellWidth + IDigitAtlas::kPadding);
+    const float top = static_cast<float>(IDigitAtlas::kPadding);
+    
+    if (glyph[0] != ' ')
+      DoDrawText(glyphText, glyph, IRECT(left, top, left, top));
+  }
+  
+  pAtlas->mLayer = EndLayer();
+  
+  mTransform = transform;
+  PathTransformSetMatrix(mTransform);
+  
+  mDigitAtlases.insert(mDigitAtlases.begin(), std::move(pAtlas));
+  
+  if (mDigitAtlases.size() > kMaxDigitAtlases)
+    mDigitAtlases.pop_back();
+  
+  return *mDigitAtlases.front();
+}
+
+bool IGraphics::FindTextMeasurement(const IText& text, const char* str, IRECT& r, double& x, double& y) const
 {
-  if (!str || str[0] == '\0')
-    return;
-    
-  DoDrawText(text, str, bounds, pBlend);
+  if (!mTextMeasureCacheEnabled)
+    return false;
+  
+  const ITextMeasureCache::Measurement* pMeasurement = mTextMeasureCache.Find(text, str);
+  
+  if (!pMeasurement)
+    return false;
+  
+  float anchorX, anchorY;
+  ITextMeasureCache::GetAnchor(text, r, anchorX, anchorY);
+  x = anchorX + pMeasurement->x;
+  y = anchorY + pMeasurement->y;
+  r = pMeasurement->bounds.GetTranslated(anchorX, anchorY);
+  return true;
 }
 
-float IGraphics::MeasureText(const IText& text, const char* str, IRECT& bounds) const
+void IGraphics::AddTextMeasurement(const IText& text, const char* str, const IRECT& anchorRect, const IRECT& r, double x, double y) const
 {
-  if (!str || str[0] == '\0')
-    return 0.f;
-    
-  return DoMeasureText(text, str, bounds);
+  if (!mTextMeasureCacheEnabled)
+    return;
+  
+  float anchorX, anchorY;
+  ITextMeasureCache::GetAnchor(text, anchorRect, anchorX, anchorY);
+  
+  ITextMeasureCache::Measurement measurement;
+  measurement.x = static_cast<float>(x - anchorX);
+  measurement.y = static_cast<float>(y - anchorY);
+  measurement.bounds = r.GetTranslated(-anchorX, -anchorY);
+  mTextMeasureCache.Add(text, str, measurement);
 }
 
 void IGraphics::DrawText(const IText& text, const char* str, float x, float y, const IBlend* pBlend)
@@ -777,23 +1445,96 @@ void IGraphics::PathRadialLine(float cx, float cy, float angle, float rMin, floa
 
 bool IGraphics::IsDirty(IRECTList& rects)
 {
+  if (mResourceLoader)
+    mResourceLoader->ProcessCompletions();
+  
+  if (mAsyncBitmapsScaled)
+  {
+    // controls with bitmaps that have been scaled in the background load them from the cache
+    mAsyncBitmapsScaled = false;
+    ForAllControls(&IControl::OnRescale);
+    SetAllControlsDirty();
+  }
+  
+  // dirty controls stay dirty until a tick at the target rate
+  if (mAdaptiveFPS && !AdaptiveFrameDue())
+    return false;
+
   if (mDisplayTickFunc)
     mDisplayTickFunc();
 
-  ForAllControlsFunc([](IControl* pControl) { pControl->Animate(); } );
+  if (mLiveResizing)
+  {
+    if (std::chrono::high_resolution_clock::now() - mLastLiveResizeTime < mLiveResizeSettleTime)
+    {
+      // nothing but the live resize layer is drawn until the resize settles
+      const bool resized = mLiveResizeFrameDirty;
+
+      if (resized)
+        rects.Add(GetBounds());
+
+      mLiveResizeFrameDirty = false;
+
+      if (mAdaptiveFPS)
+        UpdateAdaptiveFrameRate(true);
+
+      return resized;
+    }
+
+    EndLiveResize();
+  }
 
   bool dirty = false;
+
+  // all the active tweens in one pass, marking their controls dirty, before any are asked
+  if (mAnimationScheduler.NTweens())
+  {
+    mAnimationScheduler.Tick(std::chrono::high_resolution_clock::now(), [](IControl* pControl, bool finished) {
+      if (finished)
+        pControl->mNumTweens--;
+
+      pControl->SetDirty(false);
+    });
+  }
     
   auto func = [&dirty, &rects](IControl* pControl) {
     if (pControl->IsDirty())
     {
       // N.B padding outlines for single line outlines
-      rects.Add(pControl->GetRECT().GetPadded(0.75));
+      rects.Add(pControl->GetDirtyRECT().GetPadded(0.75));
       dirty = true;
     }
   };
-    
-  ForAllControlsFunc(func);
+
+  if (mIncrementalDirtyTracking)
+  {
+    // only animating and queued controls, plus the special controls which are always polled
+    for (auto i = mAnimatingControls.GetSize() - 1; i >= 0; i--)
+    {
+      IControl* pControl = mAnimatingControls.Get(i);
+      pControl->Animate();
+
+      if (!pControl->GetAnimationFunction())
+      {
+        pControl->mInAnimationList = false;
+        mAnimatingControls.Delete(i);
+      }
+      
+      func(pControl);
+    }
+
+    ForSpecialControlsFunc([](IControl* pControl) { pControl->Animate(); } );
+
+    for (auto i = 0; i < mDirtyControls.GetSize(); i++)
+      func(mDirtyControls.Get(i));
+
+    ForSpecialControlsFunc(func);
+  }
+  else
+  {
+    ForAllControlsFunc([](IControl* pControl) { pControl->Animate(); } );
+    ForAllControlsFunc(func);
+  }
 
 #ifdef USE_IDLE_CALLS
   if (dirty)
@@ -807,9 +1548,78 @@ bool IGraphics::IsDirty(IRECTList& rects)
   }
 #endif
 
+  if (mAdaptiveFPS)
+    UpdateAdaptiveFrameRate(dirty || ControlIsCaptured() || mDisplayTickFunc);
+
   return dirty;
 }
 
+void IGraphics::EnableAdaptiveFrameRate(bool enable, int idleFPS, int activeFPS)
+{
+  const int prevFPS = GetTargetFPS();
+
+  mAdaptiveFPS = enable;
+  mIdleFPS = std::max(idleFPS, 1);
+  mActiveFPS = std::max(activeFPS, 0);
+  mFrameRateIdle = false;
+  mLastActivityTime = GetTimestamp();
+
+  if (GetTargetFPS() != prevFPS)
+    OnTargetFPSChanged(GetTargetFPS());
+}
+
+int IGraphics::GetTargetFPS() const
+{
+  if (!mAdaptiveFPS)
+    return FPS();
+
+  return mFrameRateIdle ? mIdleFPS : mActiveFPS;
+}
+
+bool IGraphics::AdaptiveFrameDue()
+{
+  const int fps = GetTargetFPS();
+  const double now = GetTimestamp();
+
+  // allow a quarter of a frame of jitter, so that a timer or display link running at the target rate doesn't skip every other tick
+  if (fps > 0 && now - mLastFrameTime < 0.75 / fps)
+    return false;
+
+  mLastFrameTime = now;
+  return true;
+}
+
+void IGraphics::UpdateAdaptiveFrameRate(bool active)
+{
+  const double now = GetTimestamp();
+
+  if (active)
+    mLastActivityTime = now;
+
+  if (!mFrameRateIdle && now - mLastActivityTime > ADAPTIVE_FPS_IDLE_DELAY)
+  {
+    mFrameRateIdle = true;
+    OnTargetFPSChanged(mIdleFPS);
+  }
+  else if (mFrameRateIdle && active)
+  {
+    mFrameRateIdle = false;
+    OnTargetFPSChanged(mActiveFPS);
+  }
+}
+
+void IGraphics::NoteFrameActivity()
+{
+  mLastActivityTime = GetTimestamp();
+
+  if (mFrameRateIdle)
+  {
+    mFrameRateIdle = false;
+    mLastFrameTime = 0.; // draw the change on the next tick
+    OnTargetFPSChanged(mActiveFPS);
+  }
+}
+
 void IGraphics::BeginFrame()
 {
   if(mPerfDisplay)
@@ -833,12 +1643,21 @@ void IGraphics::DrawControl(IControl* pControl, const IRECT& bounds, float scale
     if (clipBounds.W() <= 0.0 || clipBounds.H() <= 0)
       return;
     
+    if (mDrawProfiler)
+    {
+      const int idx = GetControlIdx(pControl);
+      mDrawProfiler->BeginControl(idx < 0 ? -2 : idx, pControl->GetTag());
+    }
+    
     PrepareRegion(clipBounds);
     pControl->Draw(*this);
 #ifdef AAX_API
     pControl->DrawPTHighlight(*this);
 #endif
 
+    if (mDrawProfiler)
+      mDrawProfiler->EndControl();
+
 #ifndef NDEBUG
     if (mShowControlBounds)
     {
@@ -853,7 +1672,44 @@ void IGraphics::DrawControl(IControl* pControl, const IRECT& bounds, float scale
 
 void IGraphics::Draw(const IRECT& bounds, float scale)
 {
-  ForAllControlsFunc([this, bounds, scale](IControl* pControl) { DrawControl(pControl, bounds, scale); });
+  if (mControlIndexEnabled)
+  {
+    // only visit the controls whose cells overlap the region, keeping the front-to-back order
+    UpdateControlIndex();
+    mControlIndex.GetItemsIn(bounds, mControlIndexResults);
+
+    for (auto i = 0; i < mControlIndexResults.GetSize(); i++)
+      DrawControl(GetControl(mControlIndexResults.Get()[i]), bounds, scale);
+
+    ForSpecialControlsFunc([this, bounds, scale](IControl* pControl) { DrawControl(pControl, bounds, scale); });
+  }
+  else
+    ForAllControlsFunc([this, bounds, scale](IControl* pControl) { DrawControl(pControl, bounds, scale); });
+
+  if (mDrawProfiler && mDrawProfiler->GetShowHeatmap())
+  {
+    const double maxCost = mDrawProfiler->GetMaxAverageCost();
+    const IText text(12.f, COLOR_WHITE, DEFAULT_FONT, EAlign::Near, EVAlign::Top);
+    
+    PrepareRegion(bounds);
+    
+    for (auto i = 1; i < NControls(); i++)
+    {
+      IControl* pControl = GetControl(i);
+      const double cost = mDrawProfiler->GetAverageCost(i);
+      
+      if (pControl->IsHidden() || cost <= 0. || !pControl->GetRECT().Intersects(bounds))
+        continue;
+      
+      const float frac = maxCost > 0. ? static_cast<float>(cost / maxCost) : 0.f;
+      WDL_String str;
+      str.SetFormatted(32, "%.3fms", cost * 1000.);
+      FillRect(IColor(static_cast<int>(40.f + 160.f * frac), 255, static_cast<int>(255.f * (1.f - frac)), 0), pControl->GetRECT());
+      DrawText(text, str.Get(), pControl->GetRECT());
+    }
+    
+    CompleteRegion(bounds);
+  }
 
 #ifndef NDEBUG
   if (mShowAreaDrawn)
@@ -875,8 +1731,15 @@ void IGraphics::Draw(IRECTList& rects)
   float scale = GetBackingPixelScale();
     
   BeginFrame();
+  
+  if (mDrawProfiler)
+    mDrawProfiler->BeginFrame();
     
-  if (mStrict)
+  if (mLiveResizing)
+  {
+    DrawLiveResize(scale);
+  }
+  else if (mStrict)
   {
     IRECT r = rects.Bounds();
     r.PixelAlign(scale);
@@ -892,6 +1755,9 @@ void IGraphics::Draw(IRECTList& rects)
   }
   
   EndFrame();
+  
+  if (mDrawProfiler)
+    mDrawProfiler->EndFrame();
 }
 
 void IGraphics::SetStrictDrawing(bool strict)
@@ -1212,9 +2078,20 @@ int IGraphics::GetMouseControlIdx(float x, float y, bool mouseOver)
 {
   if (!mouseOver || mEnableMouseOver)
   {
+    UpdateControlIndex();
+
+    // with the index enabled only the controls in the cell under the mouse are candidates
+    const WDL_TypedBuf<int>* pCandidates = mControlIndexEnabled ? &mControlIndex.GetItemsAt(x, y) : nullptr;
+    const int nCandidates = pCandidates ? pCandidates->GetSize() : NControls();
+
     // Search from front to back
-    for (auto c = NControls() - 1; c >= (mouseOver ? 1 : 0); --c)
+    for (auto i = nCandidates - 1; i >= 0; --i)
     {
+      const int c = pCandidates ? pCandidates->Get()[i] : i;
+
+      if (c < (mouseOver ? 1 : 0))
+        break;
+
       IControl* pControl = GetControl(c);
 
 #ifndef NDEBUG
@@ -1453,7 +2330,7 @@ void IGraphics::EnableLiveEdit(bool enable)
 
 // Skia has its own implementation for SVGs. On all other platforms we use NanoSVG, because it works.
 #ifdef SVG_USE_SKIA
-ISVG IGraphics::LoadSVG(const char* fileName, const char* units, float dpi)
+ISVG IGraphics::LoadSVGResource(const char* fileName, const char* units, float dpi)
 {
   StaticStorage<SVGHolder>::Accessor storage(sSVGCache);
   SVGHolder* pHolder = storage.Find(fileName);
@@ -1471,15 +2348,20 @@ ISVG IGraphics::LoadSVG(const char* fileName, const char* units, float dpi)
     }
   }
   
-  return ISVG(pHolder->mSVGDom);
+  return ISVG(pHolder->mSVGDom, pHolder->mPicture);
 }
 
 ISVG IGraphics::LoadSVG(const char* name, const void* pData, int dataSize, const char* units, float dpi)
 {
-  StaticStorage<SVGHolder>::Accessor storage(sSVGCache);
-  SVGHolder* pHolder = storage.Find(name);
-
-  if (!pHolder)
+  {
+    StaticStorage<SVGHolder>::Accessor storage(sSVGCache);
+    SVGHolder* pHolder = storage.Find(name);
+    
+    if (pHolder)
+      return ISVG(pHolder->mSVGDom, pHolder->mPicture);
+  }
+  
+  // parse without holding the lock on the cache, so that SVGs can be loaded in parallel
   {
     sk_sp<SkSVGDOM> svgDOM;
     SkDOM xmlDom;
@@ -1507,22 +2389,45 @@ ISVG IGraphics::LoadSVG(const char* name, const void* pData, int dataSize, const
       nsvgDelete(pImage);
     }
 
-    pHolder = new SVGHolder(svgDOM);
-    storage.Add(pHolder, name);
-  }
+    sk_sp<SkPicture> picture;
+
+#ifndef IGRAPHICS_NO_SKIA_SVG_PICTURE
+    // record the DOM into a picture once, so that drawing plays back the canvas calls rather than walking the DOM every time
+    if (!svgDOM->containerSize().isEmpty())
+    {
+      SkPictureRecorder recorder;
+      svgDOM->render(recorder.beginRecording(SkRect::MakeSize(svgDOM->containerSize())));
+      picture = recorder.finishRecordingAsPicture();
+    }
+#endif
 
-  return ISVG(pHolder->mSVGDom);
+    StaticStorage<SVGHolder>::Accessor storage(sSVGCache);
+    SVGHolder* pHolder = storage.Find(name);
+    
+    // another thread may have loaded the same SVG in the meantime
+    if (!pHolder)
+    {
+      pHolder = new SVGHolder(svgDOM, picture);
+      storage.Add(pHolder, name);
+    }
+    
+    return ISVG(pHolder->mSVGDom, pHolder->mPicture);
+  }
 }
 
 #else
-ISVG IGraphics::LoadSVG(const char* fileName, const char* units, float dpi)
+ISVG IGraphics::LoadSVGResource(const char* fileName, const char* units, float dpi)
 {
   StaticStorage<SVGHolder>::Accessor storage(sSVGCache);
   SVGHolder* pHolder = storage.Find(fileName);
 
   if(!pHolder)
   {
-    WDL_TypedBuf<uint8_t> svgData = LoadResource(fileName, "svg");
+    WDL_TypedBuf<uint8_t> svgData = LoadCompiledSVGResource(fileName);
+    
+    if (svgData.GetSize() == 0)
+      svgData = LoadResource(fileName, "svg");
+    
     if (svgData.GetSize() == 0)
     {
       return ISVG(nullptr);
@@ -1538,23 +2443,43 @@ ISVG IGraphics::LoadSVG(const char* fileName, const char* units, float dpi)
 
 ISVG IGraphics::LoadSVG(const char* name, const void* pData, int dataSize, const char* units, float dpi)
 {
-  StaticStorage<SVGHolder>::Accessor storage(sSVGCache);
-  SVGHolder* pHolder = storage.Find(name);
-
-  if (!pHolder)
   {
-    NSVGimage* pImage = nullptr;
+    StaticStorage<SVGHolder>::Accessor storage(sSVGCache);
+    SVGHolder* pHolder = storage.Find(name);
+    
+    if (pHolder)
+      return ISVG(pHolder->mImage);
+  }
+  
+  // parse without holding the lock on the cache, so that SVGs can be loaded in parallel
+  NSVGimage* pImage = nullptr;
 
+  if (ICompiledSVG::IsCompiled(pData, dataSize))
+  {
+    pImage = ICompiledSVG::Read(pData, dataSize);
+  }
+  else
+  {
     // Because we're taking a const void* pData, but NanoSVG takes a void*, 
     WDL_String svgStr;
     svgStr.Set((const char*)pData, dataSize);
     pImage = nsvgParse(svgStr.Get(), units, dpi);
+  }
 
-    if (!pImage)
-      return ISVG(nullptr);
-    
+  if (!pImage)
+    return ISVG(nullptr);
+  
+  StaticStorage<SVGHolder>::Accessor storage(sSVGCache);
+  SVGHolder* pHolder = storage.Find(name);
+  
+  // another thread may have loaded the same SVG in the meantime
+  if (pHolder)
+  {
+    nsvgDelete(pImage);
+  }
+  else
+  {
     pHolder = new SVGHolder(pImage);
-
     storage.Add(pHolder, name);
   }
 
@@ -1562,6 +2487,151 @@ ISVG IGraphics::LoadSVG(const char* name, const void* pData, int dataSize, const
 }
 #endif
 
+WDL_TypedBuf<uint8_t> IGraphics::LoadCompiledSVGResource(const char* fileName)
+{
+  WDL_TypedBuf<uint8_t> result;
+
+#ifndef SVG_USE_SKIA
+  WDL_String path;
+  const EResourceLocation location = LocateResource(fileName, "svg", path, GetBundleID(), GetWinModuleHandle(), GetSharedResourcesSubPath());
+
+#ifdef OS_WIN
+  if (location == EResourceLocation::kWinBinary)
+  {
+    int size = 0;
+    
+    if (const void* pResData = LoadWinResource(fileName, "svgbin", size, GetWinModuleHandle()))
+    {
+      result.Resize(size);
+      memcpy(result.Get(), pResData, size);
+    }
+  }
+#endif
+  if (location == EResourceLocation::kAbsolutePath)
+  {
+    path.Append(".svgbin");
+
+    if (FILE* pFile = fopen(path.Get(), "rb"))
+    {
+      fseek(pFile, 0, SEEK_END);
+      const long size = ftell(pFile);
+      fseek(pFile, 0, SEEK_SET);
+
+      if (size > 0)
+      {
+        result.Resize(static_cast<int>(size));
+
+        if (fread(result.Get(), 1, size, pFile) != static_cast<size_t>(size))
+          result.Resize(0);
+      }
+
+      fclose(pFile);
+    }
+  }
+#endif
+
+  return result;
+}
+
+ISVG IGraphics::LoadSVG(const char* fileName, const char* units, float dpi)
+{
+  if (mResourceLoader)
+    mResourceLoader->WaitFor(fileName);
+  
+  return LoadSVGResource(fileName, units, dpi);
+}
+
+void IGraphics::LoadSVGAsync(const char* fileName, ISVGLoadedFunc completionHandler, const char* units, float dpi)
+{
+  IResourceLoader& loader = GetResourceLoader();
+  std::string name(fileName);
+  std::string unitsStr(units);
+  
+  loader.Add(fileName, [this, &loader, name, unitsStr, dpi, completionHandler]() {
+    ISVG svg = LoadSVGResource(name.c_str(), unitsStr.c_str(), dpi);
+    
+    if (completionHandler)
+      loader.AddCompletion([svg, completionHandler]() { completionHandler(svg); });
+  });
+}
+
+void IGraphics::PrefetchSVGs(const std::initializer_list<const char*>& fileNames)
+{
+  for (auto fileName : fileNames)
+    LoadSVGAsync(fileName, nullptr);
+}
+
+void IGraphics::PrefetchBitmaps(const std::initializer_list<const char*>& fileNames, int targetScale)
+{
+  IResourceLoader& loader = GetResourceLoader();
+
+  for (auto fileName : fileNames)
+  {
+    const char* ext = fileName + strlen(fileName) - 1;
+    while (ext >= fileName && *ext != '.') --ext;
+    ++ext;
+
+    if (!BitmapExtSupported(ext))
+      continue;
+
+    WDL_String fullPath;
+    int sourceScale = 0;
+    const EResourceLocation location = SearchImageResource(fileName, ext, fullPath, targetScale ? targetScale : MAX_IMG_SCALE, sourceScale);
+
+    if (location == EResourceLocation::kNotFound)
+      continue;
+
+    std::string name(fileName);
+    std::string path(fullPath.Get());
+    std::string extStr(ext);
+
+    loader.Add(fileName, [this, name, path, extStr, location, sourceScale]() {
+      auto pBitmap = std::make_unique<PrefetchedBitmap>();
+      pBitmap->mScale = sourceScale;
+
+      if (DecodeAPIBitmap(path.c_str(), location, extStr.c_str(), pBitmap->mWidth, pBitmap->mHeight, pBitmap->mPixels))
+      {
+        std::lock_guard<std::mutex> lock(mPrefetchedBitmapsMutex);
+        mPrefetchedBitmaps[name] = std::move(pBitmap);
+      }
+    });
+  }
+}
+
+APIBitmap* IGraphics::LoadPrefetchedAPIBitmap(const char* name, int sourceScale)
+{
+  if (!mResourceLoader)
+    return nullptr;
+
+  mResourceLoader->WaitFor(name);
+
+  std::unique_ptr<PrefetchedBitmap> pBitmap;
+
+  {
+    std::lock_guard<std::mutex> lock(mPrefetchedBitmapsMutex);
+    auto it = mPrefetchedBitmaps.find(name);
+
+    if (it == mPrefetchedBitmaps.end())
+      return nullptr;
+
+    pBitmap = std::move(it->second);
+    mPrefetchedBitmaps.erase(it);
+  }
+
+  if (pBitmap->mScale != sourceScale && !(mDerivedBitmapScales && pBitmap->mScale > sourceScale))
+    return nullptr;
+
+  return CreateAPIBitmapFromPixels(pBitmap->mWidth, pBitmap->mHeight, pBitmap->mPixels.Get(), pBitmap->mWidth * 4, static_cast<float>(pBitmap->mScale));
+}
+
+IResourceLoader& IGraphics::GetResourceLoader()
+{
+  if (!mResourceLoader)
+    mResourceLoader = std::make_unique<IResourceLoader>();
+  
+  return *mResourceLoader;
+}
+
 WDL_TypedBuf<uint8_t> IGraphics::LoadResource(const char* fileNameOrResID, const char* fileType)
 {
   WDL_TypedBuf<uint8_t> result;
@@ -1640,24 +2710,38 @@ IBitmap IGraphics::LoadBitmap(const char* name, int nStates, bool framesAreHoriz
     if (!bitmapTypeSupported)
       return IBitmap(); // return invalid IBitmap
 
-    EResourceLocation resourceLocation = SearchImageResource(name, ext, fullPath, targetScale, sourceScale);
+    // Scale down a higher scale that is already loaded, rather than decoding another file
+    if (mDerivedBitmapScales)
+    {
+      for (int scale = MAX_IMG_SCALE; scale > targetScale && !pAPIBitmap; scale--)
+        pAPIBitmap = storage.Find(name, scale);
+    }
+
+    if (!pAPIBitmap)
+    {
+      EResourceLocation resourceLocation = SearchImageResource(name, ext, fullPath, targetScale, sourceScale);
+
+      if (resourceLocation == EResourceLocation::kNotFound)
+      {
+        // If no resource exists then search the cache for a suitable match
+        pAPIBitmap = SearchBitmapInCache(name, targetScale, sourceScale);
+      }
+      else
+      {
+        // Try in the cache for a mismatched bitmap
+        if (sourceScale != targetScale)
+          pAPIBitmap = storage.Find(name, sourceScale);
+
+        // Load the resource if no match found, from the pixels decoded by PrefetchBitmaps() if there are any
+        if (!pAPIBitmap)
+        {
+          loadedBitmap = std::unique_ptr<APIBitmap>(LoadPrefetchedAPIBitmap(name, sourceScale));
 
-    if (resourceLocation == EResourceLocation::kNotFound)
-    {
-      // If no resource exists then search the cache for a suitable match
-      pAPIBitmap = SearchBitmapInCache(name, targetScale, sourceScale);
-    }
-    else
-    {
-      // Try in the cache for a mismatched bitmap
-      if (sourceScale != targetScale)
-        pAPIBitmap = storage.Find(name, sourceScale);
+          if (!loadedBitmap)
+            loadedBitmap = std::unique_ptr<APIBitmap>(LoadAPIBitmap(fullPath.Get(), sourceScale, resourceLocation, ext));
 
-      // Load the resource if no match found
-      if (!pAPIBitmap)
-      {
-        loadedBitmap = std::unique_ptr<APIBitmap>(LoadAPIBitmap(fullPath.Get(), sourceScale, resourceLocation, ext));
-        pAPIBitmap= loadedBitmap.get();
+          pAPIBitmap= loadedBitmap.get();
+        }
       }
     }
 
@@ -1667,6 +2751,13 @@ IBitmap IGraphics::LoadBitmap(const char* name, int nStates, bool framesAreHoriz
     // Scale or retain if needed (N.B. - scaling retains in the cache)
     if (pAPIBitmap->GetScale() != targetScale)
     {
+      // Keep the loaded scale, which is drawn until an asynchronously scaled bitmap is ready, and from which other scales can be derived
+      if (loadedBitmap && (mAsyncBitmapScaling || mDerivedBitmapScales))
+      {
+        pAPIBitmap = loadedBitmap.get();
+        RetainBitmap(IBitmap(loadedBitmap.release(), nStates, framesAreHorizontal, name), name);
+      }
+
       return ScaleBitmap(IBitmap(pAPIBitmap, nStates, framesAreHorizontal, name), name, targetScale);
     }
     else if (loadedBitmap)
@@ -1718,6 +2809,13 @@ IBitmap IGraphics::LoadBitmap(const char *name, const void *pData, int dataSize,
     // Scale or retain if needed (N.B. - scaling retains in the cache)
     if (pAPIBitmap->GetScale() != targetScale)
     {
+      // Keep the loaded scale, which is drawn until an asynchronously scaled bitmap is ready, and from which other scales can be derived
+      if (loadedBitmap && (mAsyncBitmapScaling || mDerivedBitmapScales))
+      {
+        pAPIBitmap = loadedBitmap.get();
+        RetainBitmap(IBitmap(loadedBitmap.release(), nStates, framesAreHorizontal, name), name);
+      }
+
       return ScaleBitmap(IBitmap(pAPIBitmap, nStates, framesAreHorizontal, name), name, targetScale);
     }
     else if (loadedBitmap)
@@ -1739,10 +2837,239 @@ void IGraphics::RetainBitmap(const IBitmap& bitmap, const char* cacheName)
 {
   StaticStorage<APIBitmap>::Accessor storage(sBitmapCache);
   storage.Add(bitmap.GetAPIBitmap(), cacheName, bitmap.GetScale());
+  // the cache is shared by every instance, so its bitmaps are counted until they are deleted, when the last instance releases them
+  bitmap.GetAPIBitmap()->TrackMemory(&IMemoryStats::Shared(), IMemoryStats::kBitmaps);
+}
+
+/** The Lanczos (a = 3) weights for resampling one axis of a frame, with the taps clamped to the edges of the frame */
+struct ResampleAxis
+{
+  ResampleAxis(int inSize, int outSize)
+  {
+    const float ratio = static_cast<float>(inSize) / static_cast<float>(outSize);
+    const float filterScale = std::max(ratio, 1.f); // when downscaling the filter is widened, to average the pixels it skips
+    const float support = 3.f * filterScale;
+
+    mNTaps = static_cast<int>(std::ceil(support)) * 2 + 1;
+    mIndices.resize(outSize * mNTaps);
+    mWeights.resize(outSize * mNTaps);
+
+    for (auto o = 0; o < outSize; o++)
+    {
+      const float centre = (o + 0.5f) * ratio - 0.5f;
+      const int first = static_cast<int>(std::floor(centre - support)) + 1;
+      float sum = 0.f;
+
+      for (auto t = 0; t < mNTaps; t++)
+      {
+        const float w = Lanczos3((first + t - centre) / filterScale);
+        mIndices[o * mNTaps + t] = Clip(first + t, 0, inSize - 1);
+        mWeights[o * mNTaps + t] = w;
+        sum += w;
+      }
+
+      for (auto t = 0; t < mNTaps; t++)
+        mWeights[o * mNTaps + t] /= sum;
+    }
+  }
+
+  static float Lanczos3(float x)
+  {
+    if (x == 0.f)
+      return 1.f;
+
+    if (std::fabs(x) >= 3.f)
+      return 0.f;
+
+    const float px = static_cast<float>(PI) * x;
+    return 3.f * std::sin(px) * std::sin(px / 3.f) / (px * px);
+  }
+
+  int mNTaps;
+  std::vector<int> mIndices;
+  std::vector<float> mWeights;
+};
+
+/** A bitmap being scaled on the resource loader's threads. The frames of a filmstrip are resampled separately, so that they don't bleed into each other */
+struct BitmapScaleJob
+{
+  static constexpr int kRowsPerBand = 32;
+
+  BitmapScaleJob(int inW, int inH, int outW, int outH, int nFramesX, int nFramesY)
+  : mInW(inW), mInH(inH), mOutW(outW), mOutH(outH)
+  , mNFramesX(nFramesX), mNFramesY(nFramesY)
+  , mAxisX(inW / nFramesX, outW / nFramesX)
+  , mAxisY(inH / nFramesY, outH / nFramesY)
+  , mOutRowBytes(outW * 4)
+  , mOutPixels(mOutRowBytes * outH)
+  , mNBandsLeft(NBands())
+  {}
+
+  int NBands() const { return (mOutH + kRowsPerBand - 1) / kRowsPerBand; }
+
+  /** @return The input row (or column) of output pixel o's tap t on an axis, in a bitmap of frames */
+  static int InputIndex(const ResampleAxis& axis, int inFrameSize, int outFrameSize, int o, int t)
+  {
+    return (o / outFrameSize) * inFrameSize + axis.mIndices[(o % outFrameSize) * axis.mNTaps + t];
+  }
+
+  /** Resample a band of output rows, filtering the input rows it needs horizontally and then vertically
+   * @return \c true if this was the last band to finish */
+  bool ScaleBand(int band)
+  {
+    const int inFW = mInW / mNFramesX, inFH = mInH / mNFramesY;
+    const int oFW = mOutW / mNFramesX, oFH = mOutH / mNFramesY;
+    const int y0 = band * kRowsPerBand;
+    const int y1 = std::min(y0 + kRowsPerBand, mOutH);
+
+    int rowLo = mInH, rowHi = -1;
+
+    for (auto y = y0; y < y1; y++)
+    {
+      for (auto t = 0; t < mAxisY.mNTaps; t++)
+      {
+        const int row = InputIndex(mAxisY, inFH, oFH, y, t);
+        rowLo = std::min(rowLo, row);
+        rowHi = std::max(rowHi, row);
+      }
+    }
+
+    std::vector<float> rows((rowHi - rowLo + 1) * mOutW * 4);
+
+    for (auto row = rowLo; row <= rowHi; row++)
+    {
+      const uint8_t* pIn = mInPixels.Get() + row * mInRowBytes;
+      float* pRow = rows.data() + (row - rowLo) * mOutW * 4;
+
+      for (auto x = 0; x < mOutW; x++)
+      {
+        const float* pWeights = mAxisX.mWeights.data() + (x % oFW) * mAxisX.mNTaps;
+        float sum[4] = {};
+
+        for (auto t = 0; t < mAxisX.mNTaps; t++)
+        {
+          const uint8_t* pPixel = pIn + InputIndex(mAxisX, inFW, oFW, x, t) * 4;
+
+          for (auto c = 0; c < 4; c++)
+            sum[c] += pPixel[c] * pWeights[t];
+        }
+
+        std::copy(sum, sum + 4, pRow + x * 4);
+      }
+    }
+
+    for (auto y = y0; y < y1; y++)
+    {
+      const float* pWeights = mAxisY.mWeights.data() + (y % oFH) * mAxisY.mNTaps;
+      uint8_t* pOut = mOutPixels.data() + y * mOutRowBytes;
+
+      for (auto x = 0; x < mOutW; x++)
+      {
+        float sum[4] = {};
+
+        for (auto t = 0; t < mAxisY.mNTaps; t++)
+        {
+          const float* pPixel = rows.data() + ((InputIndex(mAxisY, inFH, oFH, y, t) - rowLo) * mOutW + x) * 4;
+
+          for (auto c = 0; c < 4; c++)
+            sum[c] += pPixel[c] * pWeights[t];
+        }
+
+        // the filter rings, so clamp the colour to the alpha to keep the pixel premultiplied
+        const int alpha = Clip(static_cast<int>(std::lround(sum[mAlphaChannel])), 0, 255);
+
+        for (auto c = 0; c < 4; c++)
+          pOut[x * 4 + c] = static_cast<uint8_t>(c == mAlphaChannel ? alpha : Clip(static_cast<int>(std::lround(sum[c])), 0, alpha));
+      }
+    }
+
+    return mNBandsLeft.fetch_sub(1) == 1;
+  }
+
+  const int mInW, mInH, mOutW, mOutH;
+  const int mNFramesX, mNFramesY;
+  int mAlphaChannel = 3;
+  const ResampleAxis mAxisX, mAxisY;
+  RawBitmapData mInPixels;
+  int mInRowBytes = 0;
+  const int mOutRowBytes;
+  std::vector<uint8_t> mOutPixels;
+  std::atomic<int> mNBandsLeft;
+};
+
+bool IGraphics::ScaleBitmapAsync(const IBitmap& inBitmap, const char* name, int scale)
+{
+  const int nFramesX = inBitmap.GetFramesAreHorizontal() ? inBitmap.N() : 1;
+  const int nFramesY = inBitmap.GetFramesAreHorizontal() ? 1 : inBitmap.N();
+  const int outW = inBitmap.W() * scale;
+  const int outH = inBitmap.H() * scale;
+
+  if (outW < nFramesX || outH < nFramesY)
+    return false;
+
+  // draw the bitmap into a layer at its own scale to read its pixels, as the drawing API's bitmaps may be on the GPU
+  int screenScale = GetRoundedScreenScale();
+  float drawScale = GetDrawScale();
+
+  mScreenScale = inBitmap.GetScale();
+  mDrawScale = inBitmap.GetDrawScale();
+
+  IRECT bounds = IRECT(0, 0, inBitmap.W() / inBitmap.GetDrawScale(), inBitmap.H() / inBitmap.GetDrawScale());
+  StartLayer(nullptr, bounds, true);
+  DrawBitmap(inBitmap, bounds, 0, 0, nullptr);
+  ILayerPtr layer = EndLayer();
+
+  mScreenScale = screenScale;
+  mDrawScale = drawScale;
+
+  const APIBitmap* pLayerBitmap = layer->GetAPIBitmap();
+  auto pJob = std::make_shared<BitmapScaleJob>(pLayerBitmap->GetWidth(), pLayerBitmap->GetHeight(), outW, outH, nFramesX, nFramesY);
+  GetLayerBitmapData(layer, pJob->mInPixels);
+
+  if (pJob->mInPixels.GetSize() < pJob->mInW * pJob->mInH * 4)
+    return false;
+
+  pJob->mInRowBytes = pJob->mInPixels.GetSize() / pJob->mInH;
+  pJob->mAlphaChannel = AlphaChannel();
+
+  const auto key = std::make_pair(std::string(name), scale);
+  mAsyncBitmapScales.insert(key);
+
+  IResourceLoader& loader = GetResourceLoader();
+  const int nStates = inBitmap.N();
+  const bool framesAreHorizontal = inBitmap.GetFramesAreHorizontal();
+
+  for (auto band = 0; band < pJob->NBands(); band++)
+  {
+    loader.Add(name, [this, &loader, pJob, band, key, nStates, framesAreHorizontal]() {
+      if (!pJob->ScaleBand(band))
+        return;
+
+      loader.AddCompletion([this, pJob, key, nStates, framesAreHorizontal]() {
+        mAsyncBitmapScales.erase(key);
+
+        if (APIBitmap* pAPIBitmap = CreateAPIBitmapFromPixels(pJob->mOutW, pJob->mOutH, pJob->mOutPixels.data(), pJob->mOutRowBytes, static_cast<float>(key.second)))
+          RetainBitmap(IBitmap(pAPIBitmap, nStates, framesAreHorizontal, key.first.c_str()), key.first.c_str());
+        else
+          mAsyncBitmapScaling = false; // the back-end can't create bitmaps from pixels, so the controls will scale their bitmaps synchronously
+
+        mAsyncBitmapsScaled = true;
+      });
+    });
+  }
+
+  return true;
 }
 
 IBitmap IGraphics::ScaleBitmap(const IBitmap& inBitmap, const char* name, int scale)
 {
+  if (mAsyncBitmapScaling)
+  {
+    // the nearest scale is drawn until the scaled bitmap is ready
+    if (mAsyncBitmapScales.count(std::make_pair(std::string(name), scale)) || ScaleBitmapAsync(inBitmap, name, scale))
+      return inBitmap;
+  }
+
   int screenScale = GetRoundedScreenScale();
   float drawScale = GetDrawScale();
 
@@ -1867,6 +3194,13 @@ void IGraphics::CreatePopupMenu(IControl& control, IPopupMenu& menu, const IRECT
 void IGraphics::EndDragResize()
 {
   mResizingInProcess = false;
+
+  // resizing the controls rescales them too
+  if (mLiveResizing)
+  {
+    EndLiveResize();
+    return;
+  }
   
   if (GetResizerMode() == EUIResizerMode::Scale)
   {
@@ -1878,12 +3212,17 @@ void IGraphics::EndDragResize()
 
 void IGraphics::StartLayer(IControl* pControl, const IRECT& r, bool cacheable)
 {
+  ProfileDrawCall(IDrawProfiler::ECall::Layer);
+
   auto pixelBackingScale = GetBackingPixelScale();
   IRECT alignedBounds = r.GetPixelAligned(pixelBackingScale);
   const int w = static_cast<int>(std::ceil(pixelBackingScale * std::ceil(alignedBounds.W())));
   const int h = static_cast<int>(std::ceil(pixelBackingScale * std::ceil(alignedBounds.H())));
 
-  PushLayer(new ILayer(CreateAPIBitmap(w, h, GetScreenScale(), GetDrawScale(), cacheable), alignedBounds, pControl, pControl ? pControl->GetRECT() : IRECT()));
+  APIBitmap* pBitmap = CreateAPIBitmap(w, h, GetScreenScale(), GetDrawScale(), cacheable);
+  pBitmap->TrackMemory(GetDelegate() ? GetDelegate()->GetMemoryStats() : nullptr, IMemoryStats::kLayers);
+
+  PushLayer(new ILayer(pBitmap, alignedBounds, pControl, pControl ? pControl->GetRECT() : IRECT()));
 }
 
 void IGraphics::ResumeLayer(ILayerPtr& layer)
@@ -1904,6 +3243,78 @@ ILayerPtr IGraphics::EndLayer()
   return ILayerPtr(PopLayer());
 }
 
+void IGraphics::StartDisplayList(const IRECT& bounds)
+{
+  assert(!mRecordingList && "Display lists cannot be nested");
+  
+  // record transforms relative to the current one, so that the list can be replayed anywhere
+  PathTransformSave();
+  mTransform = IMatrix();
+  PathClear();
+  mRecordingList = std::make_unique<IDisplayList>(bounds);
+}
+
+IDisplayListPtr IGraphics::EndDisplayList()
+{
+  IDisplayListPtr list = std::move(mRecordingList);
+  PathClear();
+  PathTransformRestore();
+  return list;
+}
+
+void IGraphics::DrawDisplayList(const IDisplayListPtr& list, const IMatrix& transform)
+{
+  if (!list)
+    return;
+  
+  using ECommand = IDisplayList::ECommand;
+  
+  IMatrix base = mTransform;
+  base.Transform(transform);
+  PathTransformSetMatrix(base);
+  PathClear();
+  
+  for (auto i = 0; i < list->NCommands(); i++)
+  {
+    const IDisplayList::Command& cmd = list->GetCommand(i);
+    const float* v = cmd.v;
+    
+    switch (cmd.type)
+    {
+      case ECommand::Clear:             PathClear();                                                                 break;
+      case ECommand::Close:             PathClose();                                                                 break;
+      case ECommand::Arc:               PathArc(v[0], v[1], v[2], v[3], v[4], v[5] ? EWinding::CW : EWinding::CCW);  break;
+      case ECommand::MoveTo:            PathMoveTo(v[0], v[1]);                                                      break;
+      case ECommand::LineTo:            PathLineTo(v[0], v[1]);                                                      break;
+      case ECommand::CubicBezierTo:     PathCubicBezierTo(v[0], v[1], v[2], v[3], v[4], v[5]);                       break;
+      case ECommand::QuadraticBezierTo: PathQuadraticBezierTo(v[0], v[1], v[2], v[3]);                               break;
+      case ECommand::SetWinding:        PathSetWinding(v[0] != 0.f);                                                 break;
+      case ECommand::Fill:
+      {
+        const IDisplayList::Paint& paint = list->GetPaint(cmd.idx);
+        PathFill(paint.pattern, paint.fillOptions, paint.hasBlend ? &paint.blend : nullptr);
+        break;
+      }
+      case ECommand::Stroke:
+      {
+        const IDisplayList::Paint& paint = list->GetPaint(cmd.idx);
+        PathStroke(paint.pattern, paint.thickness, paint.strokeOptions, paint.hasBlend ? &paint.blend : nullptr);
+        break;
+      }
+      case ECommand::SetMatrix:
+      {
+        IMatrix m = base;
+        m.Transform(list->GetMatrix(cmd.idx));
+        PathTransformSetMatrix(m);
+        break;
+      }
+    }
+  }
+  
+  PathClear();
+  PathTransformSetMatrix(mTransform);
+}
+
 void IGraphics::PushLayer(ILayer* pLayer)
 {
   mLayers.push(pLayer);
@@ -1974,8 +3385,17 @@ void IGraphics::DrawRotatedLayer(const ILayerPtr& layer, double angle)
   PathTransformRestore();
 }
 
+float IGraphics::GetShadowBlurSize(const ILayerPtr& layer, const IShadow& shadow)
+{
+  const float scale = layer->GetAPIBitmap()->GetScale() * layer->GetAPIBitmap()->GetDrawScale();
+  return std::max(1.f, (shadow.mBlurSize * scale) + 1.f);
+}
+
 void IGraphics::ApplyLayerDropShadow(ILayerPtr& layer, const IShadow& shadow)
 {
+  if (mGPULayerShadows && ApplyGPULayerDropShadow(layer, shadow))
+    return;
+  
   auto GaussianBlurSwap = [](uint8_t* out, uint8_t* in, uint8_t* kernel, int width, int height,
                              int outStride, int inStride, int kernelSize, uint32_t norm)
   {
@@ -2042,8 +3462,7 @@ void IGraphics::ApplyLayerDropShadow(ILayerPtr& layer, const IShadow& shadow)
     
   // Form kernel (reference blurSize from zero (which will be no blur))
   bool flipped = FlippedBitmap();
-  float scale = layer->GetAPIBitmap()->GetScale() * layer->GetAPIBitmap()->GetDrawScale();
-  float blurSize = std::max(1.f, (shadow.mBlurSize * scale) + 1.f);
+  float blurSize = GetShadowBlurSize(layer, shadow);
   float blurConst = 4.5f / (blurSize * blurSize);
   int iSize = static_cast<int>(ceil(blurSize));
   int width = layer->GetAPIBitmap()->GetWidth();
@@ -2351,23 +3770,104 @@ void IGraphics::DrawGrid(const IColor& color, const IRECT& bounds, float gridSiz
 
 void IGraphics::DrawData(const IColor& color, const IRECT& bounds, float* normYPoints, int nPoints, float* normXPoints, const IBlend* pBlend, float thickness)
 {
+  if (nPoints < 1)
+    return;
+  
   PathClear();
   
-  float xPos = bounds.L;
-
-  PathMoveTo(xPos, bounds.B - (bounds.H() * normYPoints[0]));
+  mDataX.resize(nPoints);
+  mDataY.resize(nPoints);
+  
+  const float xStep = nPoints > 1 ? bounds.W() / (float) (nPoints - 1) : 0.f;
+  
+  for (auto i = 0; i < nPoints; i++)
+  {
+    mDataX[i] = normXPoints ? bounds.L + (bounds.W() * normXPoints[i]) : bounds.L + xStep * i;
+    mDataY[i] = bounds.B - (bounds.H() * normYPoints[i]);
+  }
+  
+  PathPolyline(mDataX.data(), mDataY.data(), nPoints, true);
+  PathStroke(color, thickness, IStrokeOptions(), pBlend);
+}
 
+void IGraphics::PathPolyline(const float* x, const float* y, int nPoints, bool simplify, bool moveToFirst)
+{
+  if (nPoints < 1)
+    return;
+  
+  // the size of a point in device pixels, ignoring rotation
+  const float scale = GetBackingPixelScale() * static_cast<float>(std::sqrt(std::fabs(mTransform.mXX * mTransform.mYY - mTransform.mXY * mTransform.mYX)));
+  
+  if (!simplify || nPoints < 4 || scale <= 0.f)
+  {
+    DoPathPolyline(x, y, nPoints, moveToFirst);
+    return;
+  }
+  
+  mPolylineX.resize(nPoints);
+  mPolylineY.resize(nPoints);
+  
+  int nOut = 0;
+  int lastAdded = -1;
+  
+  auto addPoint = [&](int i) {
+    if (i == lastAdded)
+      return;
+    
+    mPolylineX[nOut] = x[i];
+    mPolylineY[nOut] = y[i];
+    nOut++;
+    lastAdded = i;
+  };
+  
+  // each run of points in a pixel column is reduced to its lowest and highest points, in the order they occur, and the ends of the line are kept
+  auto addRun = [&](int start, int end) {
+    int lo = start, hi = start;
+    
+    for (auto i = start + 1; i < end; i++)
+    {
+      if (y[i] < y[lo]) lo = i;
+      if (y[i] > y[hi]) hi = i;
+    }
+    
+    if (start == 0)
+      addPoint(0);
+    
+    addPoint(std::min(lo, hi));
+    addPoint(std::max(lo, hi));
+    
+    if (end == nPoints)
+      addPoint(nPoints - 1);
+  };
+  
+  int runStart = 0;
+  float runColumn = std::floor(x[0] * scale);
+  
   for (auto i = 1; i < nPoints; i++)
   {
-    if(normXPoints)
-      xPos = bounds.L + (bounds.W() * normXPoints[i]);
-    else
-      xPos = bounds.L + ((bounds.W() / (float) (nPoints - 1) * i));
+    const float column = std::floor(x[i] * scale);
     
-    PathLineTo(xPos, bounds.B - (bounds.H() * normYPoints[i]));
+    if (column != runColumn)
+    {
+      addRun(runStart, i);
+      runStart = i;
+      runColumn = column;
+    }
   }
   
-  PathStroke(color, thickness, IStrokeOptions(), pBlend);
+  addRun(runStart, nPoints);
+  DoPathPolyline(mPolylineX.data(), mPolylineY.data(), nOut, moveToFirst);
+}
+
+void IGraphics::DoPathPolyline(const float* x, const float* y, int nPoints, bool moveToFirst)
+{
+  if (moveToFirst)
+    PathMoveTo(x[0], y[0]);
+  else
+    PathLineTo(x[0], y[0]);
+  
+  for (auto i = 1; i < nPoints; i++)
+    PathLineTo(x[i], y[i]);
 }
 
 void IGraphics::DrawDottedLine(const IColor& color, float x1, float y1, float x2, float y2, const IBlend* pBlend, float thickness, float dashLen)
@@ -2481,6 +3981,48 @@ void IGraphics::FillRoundRect(const IColor& color, const IRECT& bounds, float cR
   PathFill(color, IFillOptions(), pBlend);
 }
 
+void IGraphics::DrawRects(const IColor* colors, const IRECT* bounds, int nRects, const IBlend* pBlend, float thickness)
+{
+  for (auto i = 0; i < nRects;)
+  {
+    IColor color = colors[i];
+    PathClear();
+    
+    for (; i < nRects && color == colors[i]; i++)
+      PathRect(bounds[i]);
+    
+    PathStroke(color, thickness, IStrokeOptions(), pBlend);
+  }
+}
+
+void IGraphics::FillRects(const IColor* colors, const IRECT* bounds, int nRects, const IBlend* pBlend)
+{
+  for (auto i = 0; i < nRects;)
+  {
+    IColor color = colors[i];
+    PathClear();
+    
+    for (; i < nRects && color == colors[i]; i++)
+      PathRect(bounds[i]);
+    
+    PathFill(color, IFillOptions(), pBlend);
+  }
+}
+
+void IGraphics::FillRoundRects(const IColor* colors, const IRECT* bounds, int nRects, float cRTL, float cRTR, float cRBR, float cRBL, const IBlend* pBlend)
+{
+  for (auto i = 0; i < nRects;)
+  {
+    IColor color = colors[i];
+    PathClear();
+    
+    for (; i < nRects && color == colors[i]; i++)
+      PathRoundRect(bounds[i], cRTL, cRTR, cRBR, cRBL);
+    
+    PathFill(color, IFillOptions(), pBlend);
+  }
+}
+
 void IGraphics::FillConvexPolygon(const IColor& color, float* x, float* y, int nPoints, const IBlend* pBlend)
 {
   PathClear();
@@ -2658,6 +4200,9 @@ void IGraphics::PathTransformMatrix(const IMatrix& matrix)
 
 void IGraphics::PathClipRegion(const IRECT r)
 {
+  if (mRecordingList)
+    return;
+  
   IRECT drawArea = mLayers.empty() ? mClipRECT : mLayers.top()->Bounds();
   IRECT clip = r.Empty() ? drawArea : r.Intersect(drawArea);
   PathTransformSetMatrix(IMatrix());
@@ -2677,6 +4222,9 @@ void IGraphics::DrawFittedBitmap(const IBitmap& bitmap, const IRECT& bounds, con
 
 void IGraphics::DrawSVG(const ISVG& svg, const IRECT& dest, const IBlend* pBlend)
 {
+  if (mSVGRasterCacheEnabled && DrawSVGFromRasterCache(svg, dest, pBlend))
+    return;
+  
   float xScale = dest.W() / svg.W();
   float yScale = dest.H() / svg.H();
   float scale = xScale < yScale ? xScale : yScale;
@@ -2688,6 +4236,58 @@ void IGraphics::DrawSVG(const ISVG& svg, const IRECT& dest, const IBlend* pBlend
   PathTransformRestore();
 }
 
+void IGraphics::EnableSVGRasterCache(bool enable, size_t maxBytes)
+{
+  mSVGRasterCacheEnabled = enable;
+  mSVGRasterCache.SetMaxBytes(maxBytes);
+  
+  if (!enable)
+    mSVGRasterCache.Clear();
+  
+  SetAllControlsDirty();
+}
+
+bool IGraphics::DrawSVGFromRasterCache(const ISVG& svg, const IRECT& dest, const IBlend* pBlend)
+{
+  // a raster can only be drawn 1:1 under a translation, and layers can't be started whilst recording a display list
+  const bool translationOnly = mTransform.mXX == 1.0 && mTransform.mYY == 1.0 && mTransform.mXY == 0.0 && mTransform.mYX == 0.0;
+  
+  if (!svg.IsValid() || !translationOnly || mRecordingList)
+    return false;
+  
+  const float scale = GetBackingPixelScale();
+  const int w = static_cast<int>(std::ceil(dest.W() * scale));
+  const int h = static_cast<int>(std::ceil(dest.H() * scale));
+  const size_t bytes = static_cast<size_t>(w) * static_cast<size_t>(h) * 4;
+  
+  if (w <= 0 || h <= 0 || !mSVGRasterCache.Fits(bytes))
+    return false;
+  
+  const ISVGRasterCache::Key key {svg.GetID(), w, h, GetScreenScale(), GetDrawScale()};
+  const ILayerPtr* pLayer = mSVGRasterCache.Find(key);
+  
+  if (!pLayer)
+  {
+    // rendering into a layer resets the transform, so restore it afterwards
+    const IMatrix transform = mTransform;
+    const IRECT bounds(0.f, 0.f, dest.W(), dest.H());
+    const float xScale = dest.W() / svg.W();
+    const float yScale = dest.H() / svg.H();
+    
+    StartLayer(nullptr, bounds);
+    PathTransformScale(std::min(xScale, yScale));
+    DoDrawSVG(svg);
+    pLayer = mSVGRasterCache.Add(key, EndLayer(), bytes);
+    
+    mTransform = transform;
+    PathTransformSetMatrix(mTransform);
+  }
+  
+  DrawBitmap((*pLayer)->GetBitmap(), dest, 0, 0, pBlend);
+  
+  return true;
+}
+
 void IGraphics::DrawRotatedSVG(const ISVG& svg, float destCtrX, float destCtrY, float width, float height, double angle, const IBlend* pBlend)
 {
   PathTransformSave();
@@ -2742,7 +4342,29 @@ void IGraphics::DoDrawSVG(const ISVG& svg, const IBlend* pBlend)
 {
 #ifdef SVG_USE_SKIA
   SkCanvas* canvas = static_cast<SkCanvas*>(GetDrawContext());
-  svg.mSVGDom->render(canvas); //TODO: blend
+  SkPaint paint;
+  
+  if (pBlend)
+  {
+    paint.setBlendMode(SkiaBlendMode(pBlend));
+    paint.setAlpha(Clip(static_cast<int>(pBlend->mWeight * 255), 0, 255));
+  }
+  
+  if (svg.mPicture)
+  {
+    canvas->drawPicture(svg.mPicture, nullptr, pBlend ? &paint : nullptr);
+  }
+  else
+  {
+    // the blend applies to the SVG as a whole, not to each of its shapes
+    if (pBlend)
+      canvas->saveLayer(nullptr, &paint);
+    
+    svg.mSVGDom->render(canvas);
+    
+    if (pBlend)
+      canvas->restore();
+  }
 #else
   NSVGimage* pImage = svg.mImage;
   
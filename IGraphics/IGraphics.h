@@ -48,10 +48,17 @@
 #include "IGraphicsStructs.h"
 #include "IGraphicsPopupMenu.h"
 #include "IGraphicsEditorDelegate.h"
+#include "IGraphicsDrawProfiler.h"
+#include "IGraphicsAnimationScheduler.h"
+#include "IGraphicsRenderThread.h"
+#include "IGraphicsResourceLoader.h"
 
 #include "nanosvg.h"
 
+#include <mutex>
+#include <set>
 #include <stack>
+#include <string>
 #include <memory>
 #include <vector>
 #include <unordered_map>
@@ -72,10 +79,12 @@ BEGIN_IPLUG_NAMESPACE
 class IParam;
 BEGIN_IGRAPHICS_NAMESPACE
 class IControl;
+class IControlArena;
 class IPopupMenuControl;
 class ITextEntryControl;
 class ICornerResizerControl;
 class IFPSDisplayControl;
+class IMemoryStatsControl;
 class IBubbleControl;
 
 /**  The lowest level base class of an IGraphics context */
@@ -105,6 +114,13 @@ public:
    * @param pBlend Optional blend method */
   virtual void DrawSVG(const ISVG& svg, const IRECT& bounds, const IBlend* pBlend = 0);
 
+  /** Cache SVGs drawn with DrawSVG() as bitmaps at the size and scale they are drawn at, rather than rendering their paths every time.
+   * Only used when the current transform is a translation, with the blend applied to the whole bitmap rather than each shape.
+   * Bitmaps are rebuilt lazily when the size or scale changes, and the least recently used are released to stay within the memory budget
+   * @param enable Set \c true to enable the cache
+   * @param maxBytes The memory budget for the cached bitmaps */
+  void EnableSVGRasterCache(bool enable, size_t maxBytes = 32 * 1024 * 1024);
+
   /** Draw an SVG image to the graphics context with rotation
    * @param svg The SVG image to draw to the graphics context
    * @param destCentreX The X coordinate of the centre point at which to rotate the image around
@@ -183,6 +199,15 @@ public:
    * @param thickness Optional line thickness */
   virtual void DrawRect(const IColor& color, const IRECT& bounds, const IBlend* pBlend = 0, float thickness = 1.f);
 
+  /** Draw a number of rectangles, each with its own color. This draws runs of rectangles with the same color as one path, so one draw call
+   * per run rather than per rectangle, see FillRects()
+   * @param colors Pointer to the first element in an array of nRects colors
+   * @param bounds Pointer to the first element in an array of nRects rectangles
+   * @param nRects The number of rectangles
+   * @param pBlend Optional blend method
+   * @param thickness Optional line thickness */
+  virtual void DrawRects(const IColor* colors, const IRECT* bounds, int nRects, const IBlend* pBlend = 0, float thickness = 1.f);
+
   /** Draw a rounded rectangle to the graphics context
    * @param color The color to draw the shape with
    * @param bounds The rectangular region to draw the shape in
@@ -289,6 +314,37 @@ public:
    * @param cRBL The bottom left corner radius in pixels
    * @param pBlend Optional blend method */
   virtual void FillRoundRect(const IColor& color, const IRECT& bounds, float cRTL, float cRTR, float cRBR, float cRBL, const IBlend* pBlend = 0);
+
+  /** Fill a number of rectangles, each with its own color. This fills runs of rectangles with the same color as one path, so one draw call
+   * per run rather than per rectangle. Order the rectangles to keep colors together, e.g. draw all the idle keys of a keyboard and then the pressed ones.
+   * Where rectangles in a run overlap, the overlap is only filled once, which differs from FillRect() for translucent colors
+   * @param colors Pointer to the first element in an array of nRects colors
+   * @param bounds Pointer to the first element in an array of nRects rectangles
+   * @param nRects The number of rectangles
+   * @param pBlend Optional blend method */
+  virtual void FillRects(const IColor* colors, const IRECT* bounds, int nRects, const IBlend* pBlend = 0);
+
+  /** Fill a number of rounded rectangles, each with its own color, see FillRects()
+   * @param colors Pointer to the first element in an array of nRects colors
+   * @param bounds Pointer to the first element in an array of nRects rectangles
+   * @param nRects The number of rectangles
+   * @param cornerRadius The corner radius in pixels
+   * @param pBlend Optional blend method */
+  void FillRoundRects(const IColor* colors, const IRECT* bounds, int nRects, float cornerRadius = 5.f, const IBlend* pBlend = 0)
+  {
+    FillRoundRects(colors, bounds, nRects, cornerRadius, cornerRadius, cornerRadius, cornerRadius, pBlend);
+  }
+
+  /** Fill a number of rounded rectangles, each with its own color, see FillRects()
+   * @param colors Pointer to the first element in an array of nRects colors
+   * @param bounds Pointer to the first element in an array of nRects rectangles
+   * @param nRects The number of rectangles
+   * @param cRTL The top left corner radius in pixels
+   * @param cRTR The top right corner radius in pixels
+   * @param cRBR The bottom right corner radius in pixels
+   * @param cRBL The bottom left corner radius in pixels
+   * @param pBlend Optional blend method */
+  virtual void FillRoundRects(const IColor* colors, const IRECT* bounds, int nRects, float cRTL, float cRTR, float cRBR, float cRBL, const IBlend* pBlend = 0);
   
   /** Fill a circle with a color
    * @param color The color to fill the shape with
@@ -351,6 +407,19 @@ public:
    * @param bounds after calling the method this IRECT will be updated with the rectangular region the text will occupy */
   virtual float MeasureText(const IText& text, const char* str, IRECT& bounds) const;
 
+  /** Cache the measurements of text drawn or measured with DrawText() and MeasureText() by font, size, alignment and string, so that text that is drawn
+   * every frame is only measured by the back-end when it changes. The least recently used strings are evicted when the cache is full, and the cache is cleared
+   * when the UI is resized or rescaled. Supported by the NanoVG, Skia and Canvas back-ends
+   * @param enable Set \c true to enable the cache
+   * @param maxEntries The number of measured strings to keep */
+  void EnableTextMeasureCache(bool enable, int maxEntries = 1024);
+
+  /** Draw strings made only of digits, signs, separators, spaces and the letters of common units ("dBHzkms") from glyphs pre-rendered into a layer, see IDigitAtlas,
+   * rather than rasterizing the font every time. Useful for many constantly updating numeric readouts. An atlas is rendered for each font, size and color that is drawn,
+   * and used when the current transform is a translation and the text isn't rotated. Glyphs are positioned by their advances without kerning, rounded to device pixels
+   * @param enable Set \c true to enable the digit atlas */
+  void EnableDigitAtlas(bool enable);
+
   /** Get the color at an X, Y location in the graphics context
    * @param x The X coordinate of the pixel
    * @param y The Y coordinate of the pixel
@@ -385,10 +454,38 @@ public:
    * @param inBitmap The source bitmap to find a scaled version of
    * @return IBitmap The scaled bitmap */
   IBitmap GetScaledBitmap(IBitmap& inBitmap);
+
+  /** Scale bitmaps on background threads, when they are loaded at a scale that isn't cached, e.g. when the window moves to a screen with a different scale.
+   * The bitmap is resampled with a Lanczos filter, which is sharper than the filter used to draw bitmaps at other scales, in bands of rows across the resource loader's threads.
+   * Until it is ready, ScaleBitmap() returns the nearest cached scale, which is drawn scaled, and when it is ready IControl::OnRescale() is called on all the controls to pick it up.
+   * Only used by back-ends that implement CreateAPIBitmapFromPixels() (Skia), NanoVG draws bitmaps at their loaded scale
+   * @param enable Set \c true to scale bitmaps in the background */
+  void EnableAsyncBitmapScaling(bool enable) { mAsyncBitmapScaling = enable; }
+
+  /** Make the lower scales of bitmaps from a higher scale that is already loaded or prefetched, rather than decoding the lower scale's file, e.g. knob.png when knob@2x.png is loaded.
+   * The lower scale is made by ScaleBitmap() (in the background with EnableAsyncBitmapScaling()), and NanoVG draws the higher scale's texture scaled down
+   * @param enable Set \c true to derive lower scales of bitmaps */
+  void EnableDerivedBitmapScales(bool enable) { mDerivedBitmapScales = enable; }
+
+  /** @return \c true if lower scales of bitmaps are derived from higher ones, see EnableDerivedBitmapScales() */
+  bool GetDerivedBitmapScales() const { return mDerivedBitmapScales; }
   
   /** Checks a file extension and reports whether this drawing API supports loading that extension */
   virtual bool BitmapExtSupported(const char* ext) = 0;
   
+  /** Compile a fragment shader, in the language of this drawing back end, see IShaderSource and IGPUShaderControl. Call this whilst drawing, so the graphics context is current
+   * @param source The sources of the shader, the one for this back end must not be null
+   * @param error Set to the compiler's messages if the shader can't be compiled
+   * @return The shader, which the caller owns, or nullptr if it can't be compiled or the back end doesn't support shaders */
+  virtual APIShader* CreateAPIShader(const IShaderSource& source, WDL_String& error) { error.Set("Shaders are not supported by this drawing API"); return nullptr; }
+
+  /** Draw a shader created with CreateAPIShader() over a rectangle of the current layer or frame, replacing its pixels. The transform and clip are not applied,
+   * and afterwards the clip is the whole layer or frame again. Not recorded into display lists
+   * @param pShader The shader
+   * @param bounds Where to draw the shader
+   * @param pUniforms pShader->NUniforms() floats for the shader's uData array */
+  virtual void DrawAPIShader(APIShader* pShader, const IRECT& bounds, const float* pUniforms) {}
+
   /** NanoVG only */
   virtual void DrawFastDropShadow(const IRECT& innerBounds, const IRECT& outerBounds, float xyDrop = 5.f, float roundness = 0.f, float blur = 10.f, IBlend* pBlend = nullptr) { /* NO-OP*/ }
   
@@ -540,6 +637,41 @@ public:
   * @param shadow - the shadow to add */
   void ApplyLayerDropShadow(ILayerPtr& layer, const IShadow& shadow);
 
+  /** Blur layer drop shadows on the GPU, without reading the layer back to the CPU, on back-ends that support it (NanoVG and Skia).
+   * The result is close to, but not exactly the same as, the CPU blur, which is used otherwise
+   * @param enable Set \c true to blur shadows on the GPU */
+  void EnableGPULayerShadows(bool enable) { mGPULayerShadows = enable; }
+  
+  /** Start recording path drawing into a display list, instead of drawing it. Unlike a layer, a display list is resolution independent and can be replayed with any transform.
+   * The path, fill, stroke and transform calls made until EndDisplayList() are recorded, relative to the current transform. Clipping is not recorded,
+   * and text and bitmaps are only recorded by back-ends with native support (Skia), being ignored by the others whilst recording
+   * @param bounds The area the drawing is expected to cover */
+  virtual void StartDisplayList(const IRECT& bounds);
+  
+  /** Finish recording a display list
+   * @return IDisplayListPtr The immutable recording */
+  virtual IDisplayListPtr EndDisplayList();
+  
+  /** Replay a display list, on top of the current transform
+   * @param list The recording to draw
+   * @param transform An additional transform to apply to the recording */
+  virtual void DrawDisplayList(const IDisplayListPtr& list, const IMatrix& transform = IMatrix());
+
+  /** Get this IGraphics ready to draw without a window, with DrawToBitmapData(), by setting its backing scale and laying out the controls with the delegate's LayoutUI().
+   * Unlike SetScreenScale() and Resize(), this doesn't ask the plug-in's window to resize. Call it once, after the IGraphics has been made, on the thread that will draw it, see ISnapshotRenderer
+   * @param screenScale The backing scale of the bitmaps, e.g. 2 for thumbnails of retina quality */
+  void InitOffscreen(float screenScale = 1.f);
+
+  /** Draw every control into a bitmap instead of the window, e.g. for a preset thumbnail, a documentation screenshot or a visual regression test.
+   * Skia with IGRAPHICS_CPU draws in memory, so it can do this on any thread, with an IGraphics that has no window. The back-ends that need a drawing context, NanoVG and Skia on the GPU,
+   * can only do it where their context is current, such as on the UI thread of an open editor between frames, and return \c false otherwise
+   * @param data Filled with the premultiplied pixels, in rows of rowBytes, with the channel order of the back-end, see AlphaChannel(). Rows run bottom up if FlippedBitmap() is \c true
+   * @param width Set to the width of the bitmap in pixels, which is the width of the UI times GetBackingPixelScale()
+   * @param height Set to the height of the bitmap in pixels
+   * @param rowBytes Set to the number of bytes in each row of data
+   * @return \c true if the UI was drawn */
+  bool DrawToBitmapData(RawBitmapData& data, int& width, int& height, int& rowBytes);
+
 protected:
   /** Get the contents of a layers pixels as bitmap data
    * @param layer The layer to get the data from
@@ -551,6 +683,15 @@ protected:
    * @param mask The mask of the shadow as raw bitmap data
    * @param shadow The shadow specification */
   virtual void ApplyShadowMask(ILayerPtr& layer, RawBitmapData& mask, const IShadow& shadow) = 0;
+
+  /** Implemented by a graphics backend to blur and apply a drop shadow to a layer without reading it back, see EnableGPULayerShadows()
+   * @param layer The layer to apply the shadow to
+   * @param shadow The shadow specification
+   * @return \c true if the shadow was applied, \c false to use the CPU blur */
+  virtual bool ApplyGPULayerDropShadow(ILayerPtr& layer, const IShadow& shadow) { return false; }
+
+  /** @return The extent of a shadow's blur kernel in pixels of the layer's bitmap, where the kernel weight is exp(-4.5 * (i / extent)^2) */
+  static float GetShadowBlurSize(const ILayerPtr& layer, const IShadow& shadow);
   
   /** Implemented by a graphics backend to prepare for drawing to the layer at the top of the stack */
   virtual void UpdateLayer() {}
@@ -648,6 +789,15 @@ public:
    * @param nPoints The number of points in the coordinate arrays */
   void PathConvexPolygon(float* x, float* y, int nPoints);
 
+  /** Add a polyline to the current path. This is faster than calling PathLineTo() for each point, as the back-end appends the points in bulk
+   * @param x Pointer to the first element in an array of X coordinates
+   * @param y Pointer to the first element in an array of Y coordinates
+   * @param nPoints The number of points in the coordinate arrays
+   * @param simplify If \c true, runs of points in the same device pixel column are reduced to their lowest and highest points, which looks the same when stroked.
+   * Use this for dense data, such as waveforms with more points than pixels
+   * @param moveToFirst If \c true the polyline starts a new sub-path, otherwise it continues from the current point */
+  void PathPolyline(const float* x, const float* y, int nPoints, bool simplify = false, bool moveToFirst = true);
+
   /** Move the current point in the current path
    * @param x The X coordinate
    * @param y The Y coordinate */
@@ -752,6 +902,31 @@ private:
 
   void DoDrawSVG(const ISVG& svg, const IBlend* pBlend = nullptr);
   
+  /** Draw an SVG from the raster cache, rasterizing it if necessary
+   * @return \c true if the SVG was drawn, \c false if it can't be drawn from the cache with the current transform */
+  bool DrawSVGFromRasterCache(const ISVG& svg, const IRECT& dest, const IBlend* pBlend);
+
+  /** Draw text from a digit atlas, rendering the atlas if necessary
+   * @return \c true if the text was drawn, \c false if it has characters that aren't in the atlas, or can't be drawn from it with the current transform */
+  bool DrawTextFromDigitAtlas(const IText& text, const char* str, const IRECT& bounds, const IBlend* pBlend);
+
+  /** @return The digit atlas for the text at the current scale, rendering it if necessary */
+  const IDigitAtlas& GetDigitAtlas(const IText& text);
+  
+  /** Load an SVG from disk or from windows resource, without waiting for any background load of the same resource */
+  ISVG LoadSVGResource(const char* fileNameOrResID, const char* units, float dpi);
+
+  /** Load the compiled version of an SVG that was written by Scripts/compile_svgs.py next to it, or as a windows resource of type SVGBIN, see ICompiledSVG
+   * @return The compiled data, or an empty buffer if the SVG has not been compiled */
+  WDL_TypedBuf<uint8_t> LoadCompiledSVGResource(const char* fileNameOrResID);
+  
+  /** @return The resource loader, creating it if necessary */
+  IResourceLoader& GetResourceLoader();
+
+  /** Start scaling a bitmap on the resource loader's threads, see EnableAsyncBitmapScaling()
+   * @return \c true if the bitmap is being scaled, \c false if it can't be scaled in the background */
+  bool ScaleBitmapAsync(const IBitmap& inBitmap, const char* cacheName, int targetScale);
+  
   /** Prepare a particular area of the display for drawing, normally resulting in clipping of the region.
    * @param bounds The rectangular region to prepare  */
   void PrepareRegion(const IRECT& bounds)
@@ -933,6 +1108,17 @@ protected:
   /* Implemented on Windows to restore previous GL context calls ReleaseDC */
   virtual void DeactivateGLContext() {};
 
+  /** Called by the platform classes and on resize to lay out the UI with IGEditorDelegate::LayoutUI(), allocating the controls it creates from the control arena if it is enabled */
+  void DoLayoutUI();
+
+  /** Implemented by a platform to change the rate of its timer or display link, when the adaptive frame rate changes, see EnableAdaptiveFrameRate()
+   * @param fps The new target frame rate, 0 for the refresh rate of the display */
+  virtual void OnTargetFPSChanged(int fps) {}
+
+  /** @return \c true if the platform created this instance's GL context in a share group with the GL contexts of the other instances in the process,
+   * so that a texture uploaded by one instance can be drawn by all of them. Implemented on Windows when IGRAPHICS_SHARED_TEXTURES is defined */
+  virtual bool GLContextIsShared() const { return false; }
+
   /** \todo
    * @param control \todo
    * @param text \todo
@@ -1031,10 +1217,112 @@ public:
   /** Enables strict drawing mode. \todo explain strict drawing
    * @param strict Set /c true to enable strict drawing mode */
   void SetStrictDrawing(bool strict);
+  
+  /** Request that IsDirty() regions are drawn on a dedicated render thread (see IRenderThread) rather than on the platform's UI thread, so that
+   * a slow frame doesn't stall event handling. Only used if PlatformSupportsRenderThread() returns \c true, and takes effect when the window is next opened.
+   * Whilst the render thread is running, code that reads or modifies controls from outside of IGraphics event handling must hold LockControlState()
+   * @param use Set \c true to draw on a render thread */
+  void SetUseRenderThread(bool use) { mUseRenderThread = use; }
+
+  /** @return \c true if a render thread has been requested with SetUseRenderThread() */
+  bool GetUseRenderThread() const { return mUseRenderThread; }
+  
+  /** Set a folder where the drawing back-end keeps the shaders and pipelines it compiles, so that they are not compiled again when the UI is next opened,
+   * which removes the stutter of the first frames that draw each kind of path, gradient or image. Skia keeps its programs with GrContextOptions::PersistentCache,
+   * and NanoVG on Metal keeps its pipelines in a MTLBinaryArchive. The folder is created if needed, a good place is inside INIPath(), e.g. INIPath(path, BUNDLE_NAME); path.Append("ShaderCache");
+   * Takes effect when the window is next opened
+   * @param path The full path of the folder, or an empty string to disable the cache */
+  void SetShaderCachePath(const char* path) { mShaderCachePath.Set(path); }
+
+  /** @return The folder set with SetShaderCachePath(), or an empty string */
+  const char* GetShaderCachePath() const { return mShaderCachePath.Get(); }
+
+  /** @return \c true if drawing is currently happening on a dedicated render thread */
+  bool RenderThreadRunning() const { return mRenderThread != nullptr; }
+  
+  /** @return \c true if this platform and drawing back-end combination can draw on a dedicated render thread */
+  virtual bool PlatformSupportsRenderThread() const { return false; }
+  
+  /** Lock the control state against the render thread, if it is running. Held by the platform whilst handling events and by IGEditorDelegate whilst updating controls
+   * @return A lock that owns the control state mutex until it goes out of scope, or an empty lock if there is no render thread */
+  std::unique_lock<std::recursive_mutex> LockControlState()
+  {
+    return mRenderThread ? std::unique_lock<std::recursive_mutex>(mRenderThread->GetControlStateMutex()) : std::unique_lock<std::recursive_mutex>();
+  }
 
   /* Enables layout on resize. This means IGEditorDelegate:LayoutUI() will be called when the GUI is resized */
   void SetLayoutOnResize(bool layoutOnResize);
 
+  /** Enables a cheap live resize, for UIs that are too slow to lay out and redraw on every step of a resize. While the ICornerResizerControl is dragged,
+   * or the host resizes the window, the controls aren't resized, rescaled or laid out. Instead the first frame of the resize is drawn once into a layer,
+   * and each frame just draws that layer: scaled up or down with EUIResizerMode::Scale, or at its original size with EUIResizerMode::Size, the area it
+   * doesn't cover filled with fillColor. When no resize has happened for settleTime, or the corner resizer is released, IControl::OnResize() and OnRescale()
+   * are called, the UI is laid out if SetLayoutOnResize() is on, and everything is redrawn at full quality.
+   * A one-off resize by the host, such as choosing a window size from a menu, shows the layer for settleTime too. Resizes from the plug-in's own UI that aren't a drag, are drawn straight away
+   * @param enable Set \c true to enable live resize
+   * @param settleTime How long after the last resize to draw at full quality, in milliseconds
+   * @param fillColor The color of the area the layer doesn't cover, when the window is made larger with EUIResizerMode::Size */
+  void EnableLiveResize(bool enable, int settleTime = 150, const IColor& fillColor = COLOR_GRAY);
+
+  /** @return \c true if a live resize is in progress, and the controls are waiting to be resized, see EnableLiveResize() */
+  bool GetLiveResizing() const { return mLiveResizing; }
+
+  /** Enables a spatial index of the controls, so that mouse hit testing and drawing dirty regions only visit the controls in the area
+   * rather than every control. This is worthwhile for UIs with many hundreds of controls. Controls must change their bounds via
+   * IControl::SetRECT(), SetTargetRECT() or SetTargetAndDrawRECTs() (or call InvalidateControlIndex()) for the index to stay in sync.
+   * @param enable Set \c true to enable the index
+   * @param cellSize The size of the grid cells, in UI coordinates */
+  void EnableControlIndex(bool enable, float cellSize = 64.f);
+
+  /** Allocates the controls created in IGEditorDelegate::LayoutUI() from an IControlArena owned by this IGraphics, so that they are contiguous in memory
+   * in the order they are drawn. Call this before the UI is laid out, e.g. in mMakeGraphicsFunc. Controls created in LayoutUI() must then be owned by
+   * this IGraphics (attached, or deleted before it is), which is the usual case
+   * @param enable Set \c true to allocate controls from the arena */
+  void EnableControlArena(bool enable);
+
+  /** Enables incremental dirty tracking. Rather than every control being polled for Animate() and IsDirty() on each frame,
+   * controls are queued when IControl::SetDirty() is called or an animation is set, so the per-frame cost scales with the number of controls that changed.
+   * In this mode IsDirty() is only asked of queued controls and the special controls, so a control that overrides IControl::IsDirty()
+   * to report its own state should call SetDirty() when that state changes.
+   * @param enable Set \c true to enable incremental dirty tracking */
+  void EnableIncrementalDirtyTracking(bool enable);
+
+  /** Called by IControl::SetDirty() to queue a control for redrawing with incremental dirty tracking
+   * @param pControl The control that is dirty */
+  void AddDirtyControl(IControl* pControl);
+
+  /** Called by IControl::SetAnimation() to register a control with an active animation with incremental dirty tracking
+   * @param pControl The control that is animating */
+  void AddAnimatingControl(IControl* pControl);
+
+  /** Called when a control is destroyed, to remove it from the incremental dirty tracking lists and stop its tweens
+   * @param pControl The control to remove */
+  void RemoveFromDirtyTracking(IControl* pControl);
+
+  /** Move a control's value to a new value over time, with the tween evaluated by the IAnimationScheduler along with all of the other active tweens,
+   * once per frame before the controls are asked if they are dirty. Only the control is marked dirty while the value changes, and with
+   * incremental dirty tracking a control with no tweens isn't visited at all. A tween of the same value that is already running is replaced, starting from where the value is now
+   * @param pControl The control that draws the value
+   * @param pValue The value, which must stay valid until the tween finishes, or the control is destroyed
+   * @param to The value to end at
+   * @param duration Duration in milliseconds
+   * @param ease The easing function, such as EaseQuadraticInOut<double> from Easing.h, or nullptr for linear */
+  void StartTween(IControl* pControl, float* pValue, float to, int duration, IEaseFunc ease = nullptr);
+
+  /** Stop a tween started with StartTween(), leaving the value where it is
+   * @param pValue The value */
+  void StopTween(float* pValue);
+
+  /** Stop all of a control's tweens, leaving the values where they are
+   * @param pControl The control */
+  void StopTweens(IControl* pControl);
+
+  /** @return The scheduler that evaluates the tweens */
+  const IAnimationScheduler& GetAnimationScheduler() const { return mAnimationScheduler; }
+
+  /** Mark the control index as out of date, so that it is rebuilt the next time it is used. Called automatically when controls are added, removed or change bounds */
+  void InvalidateControlIndex() { mControlIndexValid = false; }
+
   /** Gets the width of the graphics context
    * @return A whole number representing the width of the graphics context in pixels on a 1:1 screen */
   int Width() const { return mWidth; }
@@ -1055,6 +1343,21 @@ public:
    * @return A whole number representing the desired frame rate at which the graphics context is redrawn. NOTE: the actual frame rate might be different */
   int FPS() const { return mFPS; }
 
+  /** Enables an adaptive frame rate. When nothing has been dirty, captured or ticked for ADAPTIVE_FPS_IDLE_DELAY seconds, the UI drops to idleFPS,
+   * and it goes back to activeFPS as soon as a control is dirtied. Platforms with a timer reschedule it, platforms driven by the display skip ticks,
+   * so an idle UI costs a fraction of the CPU and GPU time. On iOS an activeFPS of 0 allows ProMotion displays to run at their highest refresh rate
+   * @param enable Set \c true to enable the adaptive frame rate
+   * @param idleFPS The frame rate when the UI is idle
+   * @param activeFPS The frame rate when the UI is active, 0 for the refresh rate of the display */
+  void EnableAdaptiveFrameRate(bool enable, int idleFPS = 10, int activeFPS = 0);
+
+  /** @return The frame rate that the UI is currently aiming for, which is FPS() unless the adaptive frame rate is enabled, 0 for the refresh rate of the display */
+  int GetTargetFPS() const;
+
+  /** @return \c true if the adaptive frame rate is enabled and the UI is idle. With IGRAPHICS_RENDER_ON_DEMAND, iOS stops the display link altogether while this is the case,
+   * and starts it again when a control is dirtied or the view is touched */
+  bool IsFrameRateIdle() const { return mAdaptiveFPS && mFrameRateIdle; }
+
   /** Gets the graphics context scaling factor.
    * @return The scaling applied to the graphics context */
   float GetDrawScale() const { return mDrawScale; }
@@ -1082,6 +1385,9 @@ public:
 
   /** @return Get a persistant IPopupMenu (remember to clear it before use) */
   IPopupMenu& GetPromptMenu() { return mPromptPopupMenu; }
+
+  /** @return The control whose pop-up menu is open, or nullptr */
+  IControl* GetControlInPopupMenu() const { return mInPopupMenu; }
   
   /** @return True if a platform text entry in is progress */
   bool IsInPlatformTextEntry() { return mInTextEntry != nullptr && !mTextEntryControl; }
@@ -1152,6 +1458,11 @@ public:
    * @return An IRECT that corresponds to the entire UI area, with, L = 0, T = 0, R = Width() and B  = Height() */
   IRECT GetBounds() const { return IRECT(0.f, 0.f, (float) Width(), (float) Height()); }
 
+  /** Get the region that is being drawn, which drawing is clipped to. Controls that are expensive to draw can skip what is outside it,
+   * for instance after IControl::SetDirtyRegion(). When drawing into a layer, this is the bounds of the layer
+   * @return The region being drawn */
+  IRECT GetDrawRegion() const { return mLayers.empty() ? mClipRECT : mLayers.top()->Bounds(); }
+
   /** Sets a function that is called at the frame rate, prior to checking for dirty controls 
  * @param func The function to call */
   void SetDisplayTickFunc(IDisplayTickFunc func) { mDisplayTickFunc = func; }
@@ -1185,6 +1496,13 @@ private:
   
   /** \todo */
   virtual void DrawResize() {}
+
+  /** Called by DrawToBitmapData() to get the back-end ready to draw into a layer, outside of a frame
+   * @return \c false if it can't draw now, e.g. because it has no drawing context on this thread */
+  virtual bool BeginOffscreenDraw() { return false; }
+
+  /** Called by DrawToBitmapData() after it has drawn, if BeginOffscreenDraw() returned \c true */
+  virtual void EndOffscreenDraw() {}
   
   /** Draw a region of the graphics (redrawing all contained items)
    * @param bounds \todo
@@ -1204,13 +1522,40 @@ private:
    * @param isContext Determines if the menu is a contextual menu or not
    * @param valIdx The value index for the control value that the prompt relates to */
   void DoCreatePopupMenu(IControl& control, IPopupMenu& menu, const IRECT& bounds, int valIdx, bool isContext);
+
+  /** Remove a control from the tag maps, if it has a tag */
+  void UntagControl(IControl* pControl);
+
+  /** Rebuild mCtrlGroups, if a control has been attached, removed or regrouped since it was last built */
+  void UpdateGroupIndex();
+
+  /** @return The standard controls in a group, or nullptr if there are none */
+  const std::vector<IControl*>* GetControlsInGroup(const char* group);
+
+  /** Rebuild mParamControls, if a control has been attached, removed or relinked since it was last built */
+  void UpdateParamIndex();
   
+  /** @return \c true if enough time has passed since the last frame for the adaptive frame rate */
+  bool AdaptiveFrameDue();
+
+  /** Called after checking for dirty controls, drops to the idle frame rate when the UI has been inactive for long enough */
+  void UpdateAdaptiveFrameRate(bool active);
+
+  /** Called when a control is dirtied, goes back to the active frame rate */
+  void NoteFrameActivity();
+
   /** Called by ICornerResizer when drag resize commences */
   void StartDragResize() { mResizingInProcess = true; }
   
   /** Called when drag resize ends */
   void EndDragResize();
 
+  /** Resizes the controls and redraws at full quality at the end of a live resize, see EnableLiveResize() */
+  void EndLiveResize();
+
+  /** Draws the live resize layer instead of the controls, drawing it first if there isn't one yet, see EnableLiveResize() */
+  void DrawLiveResize(float scale);
+
 #pragma mark - Control management
 public:
   /** For all controls, including the "special controls" call a method
@@ -1226,6 +1571,10 @@ public:
   /** For all standard controls in the main control stack perform a function
    * @param func A std::function to perform on each control */
   void ForStandardControlsFunc(std::function<void(IControl* pControl)> func);
+
+  /** For the "special controls" only (e.g. the corner resizer, popup menu and text entry controls), call a method
+   * @param func A std::function to perform on each control */
+  void ForSpecialControlsFunc(std::function<void(IControl* pControl)> func);
   
   /** For all standard controls in the main control stack that are linked to a specific parameter, call a method
    * @param method The method to call
@@ -1243,6 +1592,38 @@ public:
    * @param group CString specificying the goupd name
    * @param func A std::function to perform on each control */
   void ForControlInGroup(const char* group, std::function<void(IControl* pControl)> func);
+
+  /** Hide or show all the standard controls in a group, e.g. the controls of a page. The groups are indexed, so this only visits the controls in the group,
+   * and controls that are already hidden or shown are left alone, rather than being made dirty again
+   * @param group CString specifying the group name
+   * @param hide \c true to hide the controls */
+  void HideGroup(const char* group, bool hide);
+
+  /** Disable or enable all the standard controls in a group, see HideGroup()
+   * @param group CString specifying the group name
+   * @param disable \c true to disable the controls */
+  void DisableGroup(const char* group, bool disable);
+
+  /** @param group CString specifying the group name
+   * @return The number of standard controls in the group */
+  int NControlsInGroup(const char* group);
+
+  /** Called when a control's group changes, so that the group index is rebuilt when it is next needed */
+  void InvalidateGroupIndex() { mGroupIndexValid = false; }
+
+  /** Called when the parameters a control is linked to change, so that the parameter index is rebuilt when it is next needed */
+  void InvalidateParamIndex() { mParamIndexValid = false; }
+
+  /** Get the standard controls linked to a parameter, from an index that is only rebuilt after controls are attached, removed or linked to other parameters, rather than by searching the control stack
+   * @param paramIdx The parameter index
+   * @return Each control linked to the parameter with the index of its value that is linked, in stack order, or nullptr if there are none. Valid until controls are next attached, removed or relinked */
+  const std::vector<std::pair<IControl*, int>>* GetControlsWithParam(int paramIdx);
+
+  /** Called when a control starts or stops wanting MIDI, so that the MIDI index is rebuilt when it is next needed */
+  void InvalidateMidiIndex() { mMidiIndexValid = false; }
+
+  /** @return The standard controls that want MIDI messages sent to the UI, see IControl::SetWantsMidi(), in stack order. Valid until controls are next attached, removed or change whether they want MIDI */
+  const std::vector<IControl*>& GetControlsWantingMidi();
   
   /** Attach an IBitmapControl as the lowest IControl in the control stack to be the background for the graphics context
    * @param fileName CString fileName resource id for the bitmap image */
@@ -1294,6 +1675,30 @@ public:
   
   /** @return \c true if performance display is shown */
   bool ShowingFPSDisplay() { return mPerfDisplay != nullptr; }
+
+  /** Shows a control listing the memory used by the plug-in by category, by the caches shared between instances, and by the other instances in the process, see IMemoryStats
+   * @param enable \c true to show */
+  void ShowMemoryStats(bool enable);
+
+  /** @return \c true if the memory stats are shown */
+  bool ShowingMemoryStats() { return mMemoryStatsDisplay != nullptr; }
+  
+  /** Enable recording of per-control draw times and draw call counts, see IDrawProfiler
+   * @param enable \c true to start profiling, \c false to stop and discard the recorded events
+   * @param maxEvents The size of the ring buffer of events */
+  void EnableDrawProfiler(bool enable, int maxEvents = 16384);
+  
+  /** @return Ptr to the draw profiler, or nullptr if it is not enabled */
+  IDrawProfiler* GetDrawProfiler() { return mDrawProfiler.get(); }
+  
+  /** Show the smoothed draw time of each control as a heatmap over the UI, the most expensive control in red. Enables the draw profiler if necessary
+   * @param enable \c true to show the heatmap */
+  void ShowDrawProfileHeatmap(bool enable);
+  
+  /** Write the events recorded by the draw profiler in the Chrome trace event JSON format, to be viewed in chrome://tracing or https://ui.perfetto.dev
+   * @param path The absolute path of the file to write
+   * @return \c true on success, \c false if the draw profiler is not enabled or the file could not be written */
+  bool WriteDrawProfile(const char* path) const { return mDrawProfiler ? mDrawProfiler->WriteChromeTrace(path) : false; }
   
   /** Attach an IControl to the graphics context and add it to the top of the control stack. The control is owned by the graphics context and will be deleted when the context is deleted.
    * @param pControl A pointer to an IControl to attach.
@@ -1328,13 +1733,8 @@ public:
    * @return The tag assigned to the control when it was attached, or kNoTag (-1) */
   int GetControlTag(const IControl* pControl) const
   {
-    for (auto itr = mCtrlTags.begin(); itr != mCtrlTags.end(); ++itr)
-    {
-      if (itr->second == pControl)
-        return itr->first;
-    }
-    
-    return kNoTag;
+    const auto it = mCtrlTagsByControl.find(pControl);
+    return it != mCtrlTagsByControl.end() ? it->second : kNoTag;
   }
   
   /** Check to see if any control is captured */
@@ -1611,6 +2011,25 @@ public:
    * @return An ISVG representing the image */
   virtual ISVG LoadSVG(const char* name, const void* pData, int dataSize, const char* units = "px", float dpi = 72.f);
 
+  /** Load an SVG from disk or from windows resource on a background thread. The SVG is added to the same cache as LoadSVG(), and a call to LoadSVG()
+   * for the same resource before it has finished waits for it rather than parsing it again
+   * @param fileNameOrResID A CString absolute path or resource ID
+   * @param completionHandler Called on the UI thread when the SVG has loaded, with an invalid ISVG if loading failed. May be nullptr
+   * @param units \todo
+   * @param dpi The dots per inch of the SVG file */
+  void LoadSVGAsync(const char* fileNameOrResID, ISVGLoadedFunc completionHandler, const char* units = "px", float dpi = 72.f);
+
+  /** Start loading a list of SVGs on background threads, so that they are ready by the time they are loaded with LoadSVG() in LayoutUI().
+   * Called by MakeGraphics() with the list defined by IGRAPHICS_PREFETCH_SVGS in config.h, if it exists
+   * @param fileNamesOrResIDs The SVGs to load */
+  void PrefetchSVGs(const std::initializer_list<const char*>& fileNamesOrResIDs);
+
+  /** Start decoding a list of bitmaps on background threads, so that LoadBitmap() in LayoutUI() only has to create their textures rather than decoding each file in turn.
+   * Called by MakeGraphics() with the list defined by IGRAPHICS_PREFETCH_BITMAPS in config.h, if it exists. Only used by back-ends that implement DecodeAPIBitmap()
+   * @param fileNames The bitmaps to decode
+   * @param targetScale The scale to decode, or 0 for the highest scale there is a file for, from which the lower scales can be derived with EnableDerivedBitmapScales() */
+  void PrefetchBitmaps(const std::initializer_list<const char*>& fileNames, int targetScale = 0);
+
   /** Load a resource from the file system, the bundle, or a Windows resource, and returns its data
    * @param fileNameOrResID CString file name or resource ID
    * @param fileType Type of the file (e.g "png", "svg", "ttf")
@@ -1631,6 +2050,21 @@ public:
   void ClearGestureRegions();
 
 protected:
+  /** Called by the platform when the window opens, to start the render thread if it has been requested with SetUseRenderThread()
+   * @param renderFunc Called on the render thread to draw the dirty regions, including any graphics context activation and buffer swapping */
+  void StartRenderThread(IRenderThread::RenderFunc renderFunc)
+  {
+    if (mUseRenderThread && PlatformSupportsRenderThread() && !mRenderThread)
+      mRenderThread = std::make_unique<IRenderThread>(renderFunc);
+  }
+  
+  /** Called by the platform before the window closes, blocks until the current frame is complete */
+  void StopRenderThread() { mRenderThread = nullptr; }
+
+  /** Called by the drawing back-ends to count a draw call when the draw profiler is enabled
+   * @param call The kind of draw call */
+  void ProfileDrawCall(IDrawProfiler::ECall call) { if (mDrawProfiler) mDrawProfiler->Count(call); }
+
   /** Drawing API method to load a bitmap, called internally
    * @param fileNameOrResID A CString absolute path or resource ID
    * @param scale Integer to identify the scale of the resource, for multi-scale bitmaps
@@ -1656,6 +2090,33 @@ protected:
    * @return APIBitmap* The new API Bitmap */
   virtual APIBitmap* CreateAPIBitmap(int width, int height, float scale, double drawScale, bool cacheable = false) = 0;
 
+  /** Creates a new API bitmap from pixels, in the format read by GetLayerBitmapData() or decoded by DecodeAPIBitmap(). Used by EnableAsyncBitmapScaling() and PrefetchBitmaps(), which aren't used by back-ends that return nullptr
+   * @param width The width in pixels
+   * @param height The height in pixels
+   * @param pPixels The pixels
+   * @param rowBytes The number of bytes between the starts of rows
+   * @param scale The scale in relation to 1:1 pixels
+   * @return APIBitmap* The new API Bitmap, or nullptr if the back-end can't create bitmaps from pixels */
+  virtual APIBitmap* CreateAPIBitmapFromPixels(int width, int height, const uint8_t* pPixels, int rowBytes, float scale) { return nullptr; }
+
+  /** Decode a bitmap file or resource into pixels in the format taken by CreateAPIBitmapFromPixels(), with rows of width * 4 bytes, for PrefetchBitmaps().
+   * Called on a worker thread, so it mustn't use the graphics context
+   * @param fileNameOrResID The absolute path or resource ID found by SearchImageResource()
+   * @param location Where the bitmap is
+   * @param ext The file extension
+   * @param width Set to the width in pixels
+   * @param height Set to the height in pixels
+   * @param pixels Filled with the pixels
+   * @return \c true if the bitmap was decoded, \c false if it can't be, or should be loaded by LoadAPIBitmap() instead */
+  virtual bool DecodeAPIBitmap(const char* fileNameOrResID, EResourceLocation location, const char* ext, int& width, int& height, RawBitmapData& pixels) { return false; }
+
+  /** Take the pixels that PrefetchBitmaps() decoded for a bitmap, waiting for them if they are still being decoded, and create an APIBitmap from them.
+   * The pixels are used if they are for sourceScale, or for a higher scale with EnableDerivedBitmapScales(), and are dropped otherwise
+   * @param name The name of the bitmap
+   * @param sourceScale The scale of the file that would be loaded, found by SearchImageResource()
+   * @return The APIBitmap, which the caller owns, or nullptr if the bitmap must be loaded with LoadAPIBitmap() */
+  APIBitmap* LoadPrefetchedAPIBitmap(const char* name, int sourceScale);
+
   /** Drawing API method to load a font from a PlatformFontPtr, called internally
    * @param fontID A CString that will be used to reference the font
    * @param font Valid PlatformFontPtr, loaded via LoadPlatformFont
@@ -1711,6 +2172,31 @@ protected:
    * @param bounds \todo
    * @param rect \todo */
   void DoMeasureTextRotation(const IText& text, const IRECT& bounds, IRECT& rect) const;
+
+  /** Add a polyline to the current path, see PathPolyline(). Back-ends override this to append the points in bulk
+   * @param x Pointer to the first element in an array of X coordinates
+   * @param y Pointer to the first element in an array of Y coordinates
+   * @param nPoints The number of points, at least one
+   * @param moveToFirst If \c true the polyline starts a new sub-path, otherwise it continues from the current point */
+  virtual void DoPathPolyline(const float* x, const float* y, int nPoints, bool moveToFirst);
+
+  /** Called by back-ends that support EnableTextMeasureCache() before measuring text
+   * @param text The text properties
+   * @param str The string
+   * @param r The bounds to lay the text out in, which is set to the measured bounds if the text is cached
+   * @param x Set to the text origin to draw at, if the text is cached
+   * @param y Set to the text origin to draw at, if the text is cached
+   * @return \c true if the text was in the cache, otherwise the back-end should measure it and call AddTextMeasurement() */
+  bool FindTextMeasurement(const IText& text, const char* str, IRECT& r, double& x, double& y) const;
+
+  /** Called by back-ends that support EnableTextMeasureCache() after measuring text
+   * @param text The text properties
+   * @param str The string
+   * @param anchorRect The bounds the text was laid out in
+   * @param r The measured bounds of the text
+   * @param x The text origin to draw at
+   * @param y The text origin to draw at */
+  void AddTextMeasurement(const IText& text, const char* str, const IRECT& anchorRect, const IRECT& r, double x, double y) const;
   
   /** \todo
    * @param text \todo
@@ -1732,15 +2218,38 @@ private:
     mMouseOver = nullptr;
     mMouseOverIdx = -1;
   }
+
+  /** Rebuild the control index if it is enabled and out of date */
+  void UpdateControlIndex();
   
   WDL_PtrList<IControl> mControls;
   std::unordered_map<int, IControl*> mCtrlTags;
+  std::unordered_map<const IControl*, int> mCtrlTagsByControl; // the reverse of mCtrlTags, for GetControlTag()
+  std::unordered_map<std::string, std::vector<IControl*>> mCtrlGroups; // the standard controls in each group, in stack order, rebuilt by UpdateGroupIndex()
+  bool mGroupIndexValid = false;
+  std::vector<std::vector<std::pair<IControl*, int>>> mParamControls; // the standard controls and value indices linked to each parameter, rebuilt by UpdateParamIndex()
+  bool mParamIndexValid = false;
+  std::vector<IControl*> mMidiControls; // the standard controls that want MIDI, rebuilt by GetControlsWantingMidi()
+  bool mMidiIndexValid = false;
+  WDL_PtrList<IControl> mDirtyControls; // controls queued by SetDirty() with incremental dirty tracking
+  WDL_PtrList<IControl> mAnimatingControls; // controls with an animation function with incremental dirty tracking
+  IAnimationScheduler mAnimationScheduler;
+  bool mIncrementalDirtyTracking = false;
+  IRECTGrid mControlIndex;
+  WDL_TypedBuf<int> mControlIndexResults;
+  float mControlIndexCellSize = 64.f;
+  bool mControlIndexEnabled = false;
+  std::unique_ptr<IControlArena> mControlArena;
+  bool mControlArenaEnabled = false;
+  bool mControlIndexValid = false;
 
   // Order (front-to-back) ToolTip / PopUp / TextEntry / LiveEdit / Corner / PerfDisplay
   std::unique_ptr<ICornerResizerControl> mCornerResizer;
   WDL_PtrList<IBubbleControl> mBubbleControls;
   std::unique_ptr<IPopupMenuControl> mPopupControl;
   std::unique_ptr<IFPSDisplayControl> mPerfDisplay;
+  std::unique_ptr<IMemoryStatsControl> mMemoryStatsDisplay;
+  std::unique_ptr<IDrawProfiler> mDrawProfiler;
   std::unique_ptr<ITextEntryControl> mTextEntryControl;
   std::unique_ptr<IControl> mLiveEdit;
   
@@ -1779,8 +2288,16 @@ private:
   bool mEnableTooltips = false;
   bool mShowControlBounds = false;
   bool mShowAreaDrawn = false;
+  bool mUseRenderThread = false;
   bool mResizingInProcess = false;
   bool mLayoutOnResize = false;
+  bool mLiveResizeEnabled = false;
+  bool mLiveResizing = false;
+  bool mLiveResizeFrameDirty = false;
+  Milliseconds mLiveResizeSettleTime = Milliseconds(150);
+  TimePoint mLastLiveResizeTime;
+  IColor mLiveResizeFillColor = COLOR_GRAY;
+  ILayerPtr mLiveResizeLayer; // the UI as it was at the start of a live resize
   bool mEnableMultiTouch = false;
   EUIResizerMode mGUISizeMode = EUIResizerMode::Scale;
   double mPrevTimestamp = 0.;
@@ -1803,6 +2320,42 @@ protected:
   friend class ITextEntryControl;
   
   std::stack<ILayer*> mLayers;
+  std::unique_ptr<IRenderThread> mRenderThread;
+  IDisplayListPtr mRecordingList;
+  ISVGRasterCache mSVGRasterCache;
+  std::unique_ptr<IResourceLoader> mResourceLoader;
+  bool mAsyncBitmapScaling = false;
+  bool mAsyncBitmapsScaled = false; // bitmaps have been scaled since controls were last rescaled
+  std::set<std::pair<std::string, int>> mAsyncBitmapScales; // the names and scales being scaled
+  bool mDerivedBitmapScales = false;
+
+  struct PrefetchedBitmap
+  {
+    int mWidth = 0;
+    int mHeight = 0;
+    int mScale = 0;
+    RawBitmapData mPixels;
+  };
+
+  std::mutex mPrefetchedBitmapsMutex;
+  std::unordered_map<std::string, std::unique_ptr<PrefetchedBitmap>> mPrefetchedBitmaps; // decoded by PrefetchBitmaps(), until LoadBitmap() takes them
+  bool mSVGRasterCacheEnabled = false;
+  bool mGPULayerShadows = false;
+  WDL_String mShaderCachePath;
+  bool mAdaptiveFPS = false;
+  bool mFrameRateIdle = false;
+  int mIdleFPS = 10;
+  int mActiveFPS = 0;
+  double mLastActivityTime = 0.;
+  double mLastFrameTime = 0.;
+  mutable ITextMeasureCache mTextMeasureCache; // measuring text is const, but fills the cache
+  bool mTextMeasureCacheEnabled = false;
+  std::vector<float> mDataX; // scratch space for DrawData()
+  std::vector<float> mDataY;
+  std::vector<float> mPolylineX; // scratch space for PathPolyline()
+  std::vector<float> mPolylineY;
+  std::vector<std::unique_ptr<IDigitAtlas>> mDigitAtlases; // most recently used first
+  bool mDigitAtlasEnabled = false;
 
   IRECT mClipRECT;
   IMatrix mTransform;
@@ -0,0 +1,159 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc IAnimationScheduler
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include "IGraphicsStructs.h"
+
+BEGIN_IPLUG_NAMESPACE
+BEGIN_IGRAPHICS_NAMESPACE
+
+/** An easing function mapping progress from 0 to 1 to an eased progress, such as EaseQuadraticInOut<double> from Easing.h */
+using IEaseFunc = double (*)(double);
+
+/** A value that is being moved from one value to another over time, by the IAnimationScheduler */
+struct ITween
+{
+  IControl* pControl = nullptr; // the control that draws the value, which is marked dirty while it changes
+  float* pValue = nullptr; // the value, normally a member of pControl
+  float from = 0.f;
+  float to = 0.f;
+  TimePoint startTime;
+  double duration = 0.; // milliseconds
+  IEaseFunc ease = nullptr; // nullptr for linear
+};
+
+/** Evaluates all of the UI's active tweens in one pass per frame, and marks only the controls they belong to dirty.
+ * Unlike an IAnimationFunction, which each control runs for itself, a tween is just data: the scheduler holds the active ones in a compact array,
+ * and a control with no active tweens costs nothing, so hover and fade effects on every control of a large UI stay cheap.
+ * Owned by IGraphics, use IGraphics::StartTween() or IControl::StartTween() rather than calling it directly */
+class IAnimationScheduler
+{
+public:
+  IAnimationScheduler()
+  {
+    mTweens.reserve(64);
+  }
+
+  /** Start moving a value to a new value, from where it is now. A tween of the same value that is already running is replaced, so a hover fade
+   * that is reversed half way turns around smoothly
+   * @param pControl The control to mark dirty while the value changes
+   * @param pValue The value to move, which must outlive the tween, or be stopped with Stop() or RemoveControl() first
+   * @param to The value to end at
+   * @param duration The time to take, in milliseconds. If it is 0 or less the value is set on the next frame
+   * @param ease The easing function, or nullptr for linear
+   * @param now The current time
+   * @return \c true if a new tween was added, \c false if one was replaced */
+  bool Start(IControl* pControl, float* pValue, float to, double duration, IEaseFunc ease, TimePoint now)
+  {
+    ITween tween;
+    tween.pControl = pControl;
+    tween.pValue = pValue;
+    tween.from = *pValue;
+    tween.to = to;
+    tween.startTime = now;
+    tween.duration = duration;
+    tween.ease = ease;
+
+    for (auto& existing : mTweens)
+    {
+      if (existing.pValue == pValue)
+      {
+        existing = tween;
+        return false;
+      }
+    }
+
+    mTweens.push_back(tween);
+    return true;
+  }
+
+  /** Stop the tween of a value, leaving it where it is
+   * @return The control it belonged to, or nullptr if the value wasn't being tweened */
+  IControl* Stop(const float* pValue)
+  {
+    for (auto i = 0; i < NTweens(); i++)
+    {
+      if (mTweens[i].pValue == pValue)
+      {
+        IControl* pControl = mTweens[i].pControl;
+        RemoveAt(i);
+        return pControl;
+      }
+    }
+
+    return nullptr;
+  }
+
+  /** Stop all of a control's tweens, leaving the values where they are
+   * @return The number of tweens removed */
+  int RemoveControl(const IControl* pControl)
+  {
+    const auto prevSize = mTweens.size();
+    mTweens.erase(std::remove_if(mTweens.begin(), mTweens.end(), [pControl](const ITween& t) { return t.pControl == pControl; }), mTweens.end());
+    return static_cast<int>(prevSize - mTweens.size());
+  }
+
+  /** Stop all tweens */
+  void Clear() { mTweens.clear(); }
+
+  /** @return The number of active tweens */
+  int NTweens() const { return static_cast<int>(mTweens.size()); }
+
+  /** Called by IGraphics once per frame, to set each tweened value for the time, and remove the tweens that have finished
+   * @param now The time of the frame
+   * @param updateFunc Called as updateFunc(IControl* pControl, bool finished) after each value is set, to mark the control dirty. It may start or stop tweens */
+  template <typename F>
+  void Tick(TimePoint now, F&& updateFunc)
+  {
+    for (auto i = 0; i < NTweens();)
+    {
+      ITween& tween = mTweens[i];
+      const double elapsed = std::chrono::duration_cast<Milliseconds>(now - tween.startTime).count();
+      const bool finished = tween.duration <= 0. || elapsed >= tween.duration;
+      const double progress = finished ? 1. : std::max(elapsed / tween.duration, 0.);
+      const double eased = tween.ease ? tween.ease(progress) : progress;
+
+      *tween.pValue = finished ? tween.to : tween.from + static_cast<float>(eased) * (tween.to - tween.from);
+
+      IControl* pControl = tween.pControl;
+
+      if (finished)
+        RemoveAt(i);
+      else
+        i++;
+
+      updateFunc(pControl, finished);
+    }
+  }
+
+private:
+  // the order of the tweens doesn't matter, so a finished one is replaced by the last
+  void RemoveAt(int idx)
+  {
+    if (idx != NTweens() - 1)
+      mTweens[idx] = mTweens.back();
+
+    mTweens.pop_back();
+  }
+
+  std::vector<ITween> mTweens;
+};
+
+END_IGRAPHICS_NAMESPACE
+END_IPLUG_NAMESPACE
@@ -21,6 +21,9 @@ static constexpr int DEFAULT_FPS = 60;
 // Only looked at if USE_IDLE_CALLS is defined.
 static constexpr int IDLE_TICKS = 20;
 
+// If the adaptive frame rate is enabled, the UI drops to the idle frame rate after this many seconds without activity.
+static constexpr double ADAPTIVE_FPS_IDLE_DELAY = 0.5;
+
 static constexpr int DEFAULT_ANIMATION_DURATION = 100;
 
 #ifndef CONTROL_BOUNDS_COLOR
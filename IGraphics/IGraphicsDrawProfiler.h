@@ -0,0 +1,241 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc IDrawProfiler
+ */
+
+#include <cstdio>
+#include <vector>
+
+#include "wdlstring.h"
+
+#include "IGraphicsUtilities.h"
+
+BEGIN_IPLUG_NAMESPACE
+BEGIN_IGRAPHICS_NAMESPACE
+
+/** A single timed draw event recorded by the IDrawProfiler */
+struct IDrawProfileEvent
+{
+  static constexpr int kFrameEvent = -1;
+
+  int controlIdx = kFrameEvent; // index of the control in the control stack, kFrameEvent for a whole frame, or -2 for special controls
+  int tag = kNoTag;
+  int frame = 0;
+  double startTime = 0.; // seconds, as returned by GetTimestamp()
+  double duration = 0.; // seconds
+  int nFills = 0;
+  int nStrokes = 0;
+  int nBitmaps = 0;
+  int nLayers = 0;
+};
+
+/** Records the time taken, and the number of fills, strokes, bitmap draws and layers created by each control on each frame in a fixed size ring buffer.
+ * Owned by IGraphics and enabled with IGraphics::EnableDrawProfiler(). The results can be shown as a heatmap over the UI, or written out in
+ * the Chrome trace event format, to be viewed in chrome://tracing or https://ui.perfetto.dev */
+class IDrawProfiler
+{
+public:
+  enum class ECall { Fill, Stroke, Bitmap, Layer };
+
+  /** @param maxEvents The size of the ring buffer of events, the oldest events are overwritten when full */
+  IDrawProfiler(int maxEvents = 16384)
+  : mEvents(maxEvents)
+  {
+  }
+
+  /** Called by IGraphics at the start of each frame */
+  void BeginFrame()
+  {
+    mFrame++;
+    mFrameEvent = IDrawProfileEvent();
+    mFrameEvent.frame = mFrame;
+    mFrameEvent.startTime = GetTimestamp();
+  }
+
+  /** Called by IGraphics at the end of each frame */
+  void EndFrame()
+  {
+    mFrameEvent.duration = GetTimestamp() - mFrameEvent.startTime;
+    Record(mFrameEvent);
+  }
+
+  /** Called by IGraphics before a control is drawn
+   * @param controlIdx The index of the control in the control stack
+   * @param tag The control's tag */
+  void BeginControl(int controlIdx, int tag)
+  {
+    mControlEvent = IDrawProfileEvent();
+    mControlEvent.controlIdx = controlIdx;
+    mControlEvent.tag = tag;
+    mControlEvent.frame = mFrame;
+    mControlEvent.startTime = GetTimestamp();
+    mInControl = true;
+  }
+
+  /** Called by IGraphics after a control is drawn */
+  void EndControl()
+  {
+    mControlEvent.duration = GetTimestamp() - mControlEvent.startTime;
+    mInControl = false;
+
+    const int idx = mControlEvent.controlIdx;
+
+    if (idx >= 0)
+    {
+      if (idx >= static_cast<int>(mAverageCost.size()))
+        mAverageCost.resize(idx + 1, 0.);
+
+      mAverageCost[idx] += (mControlEvent.duration - mAverageCost[idx]) * kAverageCoeff;
+    }
+
+    Record(mControlEvent);
+  }
+
+  /** Called by the drawing back-ends, counts a draw call against the current frame and control */
+  void Count(ECall call)
+  {
+    int IDrawProfileEvent::* pCounter = nullptr;
+
+    switch (call)
+    {
+      case ECall::Fill:   pCounter = &IDrawProfileEvent::nFills;   break;
+      case ECall::Stroke: pCounter = &IDrawProfileEvent::nStrokes; break;
+      case ECall::Bitmap: pCounter = &IDrawProfileEvent::nBitmaps; break;
+      case ECall::Layer:  pCounter = &IDrawProfileEvent::nLayers;  break;
+    }
+
+    mFrameEvent.*pCounter += 1;
+
+    if (mInControl)
+      mControlEvent.*pCounter += 1;
+  }
+
+  /** @param controlIdx The index of a control in the control stack
+   * @return The smoothed draw time of the control in seconds, 0 if it has not been drawn */
+  double GetAverageCost(int controlIdx) const
+  {
+    return (controlIdx >= 0 && controlIdx < static_cast<int>(mAverageCost.size())) ? mAverageCost[controlIdx] : 0.;
+  }
+
+  /** @return The largest smoothed draw time of any control in seconds */
+  double GetMaxAverageCost() const
+  {
+    double maxCost = 0.;
+
+    for (auto cost : mAverageCost)
+      maxCost = std::max(maxCost, cost);
+
+    return maxCost;
+  }
+
+  /** @return The number of events currently held in the ring buffer */
+  int NEvents() const { return mNumEvents; }
+
+  /** @param i The index of the event, 0 being the oldest held
+   * @return The event */
+  const IDrawProfileEvent& GetEvent(int i) const
+  {
+    const int size = static_cast<int>(mEvents.size());
+    return mEvents[(mWritePos - mNumEvents + i + size) % size];
+  }
+
+  /** Discard all recorded events and averages */
+  void Clear()
+  {
+    mNumEvents = 0;
+    mWritePos = 0;
+    mAverageCost.clear();
+  }
+
+  /** Append the recorded events to a string in the Chrome trace event JSON format
+   * @param str The string to append to */
+  void GetChromeTrace(WDL_String& str) const
+  {
+    str.Append("{\"traceEvents\":[");
+
+    for (auto i = 0; i < mNumEvents; i++)
+    {
+      const IDrawProfileEvent& e = GetEvent(i);
+
+      if (i > 0)
+        str.Append(",");
+
+      if (e.controlIdx == IDrawProfileEvent::kFrameEvent)
+        str.AppendFormatted(256, "{\"name\":\"Frame %i\",\"cat\":\"frame\"", e.frame);
+      else if (e.controlIdx < 0)
+        str.Append("{\"name\":\"Special control\",\"cat\":\"control\"");
+      else
+        str.AppendFormatted(256, "{\"name\":\"Control %i\",\"cat\":\"control\"", e.controlIdx);
+
+      str.AppendFormatted(512, ",\"ph\":\"X\",\"pid\":0,\"tid\":0,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%i,\"tag\":%i,\"fills\":%i,\"strokes\":%i,\"bitmaps\":%i,\"layers\":%i}}",
+                          e.startTime * 1000000., e.duration * 1000000., e.frame, e.tag, e.nFills, e.nStrokes, e.nBitmaps, e.nLayers);
+    }
+
+    str.Append("],\"displayTimeUnit\":\"ms\"}");
+  }
+
+  /** Write the recorded events to a file in the Chrome trace event JSON format
+   * @param path The absolute path of the file to write
+   * @return \c true on success */
+  bool WriteChromeTrace(const char* path) const
+  {
+    WDL_String str;
+    GetChromeTrace(str);
+
+    FILE* pFile = fopen(path, "wb");
+
+    if (!pFile)
+      return false;
+
+    const bool success = fwrite(str.Get(), 1, str.GetLength(), pFile) == static_cast<size_t>(str.GetLength());
+    fclose(pFile);
+
+    return success;
+  }
+
+  /** Show the smoothed draw cost of each control as a heatmap over the UI */
+  void SetShowHeatmap(bool show) { mShowHeatmap = show; }
+
+  /** @return \c true if the heatmap overlay is shown */
+  bool GetShowHeatmap() const { return mShowHeatmap; }
+
+private:
+  static constexpr double kAverageCoeff = 0.1;
+
+  void Record(const IDrawProfileEvent& event)
+  {
+    const int size = static_cast<int>(mEvents.size());
+
+    if (!size)
+      return;
+
+    mEvents[mWritePos] = event;
+    mWritePos = (mWritePos + 1) % size;
+    mNumEvents = std::min(mNumEvents + 1, size);
+  }
+
+  std::vector<IDrawProfileEvent> mEvents;
+  std::vector<double> mAverageCost;
+  IDrawProfileEvent mFrameEvent;
+  IDrawProfileEvent mControlEvent;
+  int mWritePos = 0;
+  int mNumEvents = 0;
+  int mFrame = 0;
+  bool mInControl = false;
+  bool mShowHeatmap = false;
+};
+
+END_IGRAPHICS_NAMESPACE
+END_IPLUG_NAMESPACE
@@ -11,6 +11,7 @@
 #include "IGraphicsEditorDelegate.h"
 #include "IGraphics.h"
 #include "IControl.h"
+#include "IPlugStartupTimer.h"
 
 using namespace iplug;
 using namespace igraphics;
@@ -26,6 +27,8 @@ IGEditorDelegate::~IGEditorDelegate()
 
 void* IGEditorDelegate::OpenWindow(void* pParent)
 {
+  ENTER_STARTUP_TIMING_SCOPE(kEditorOpen)
+
   if(!mGraphics)
   {
     mGraphics = std::unique_ptr<IGraphics>(CreateGraphics());
@@ -70,6 +73,8 @@ void IGEditorDelegate::SendControlValueFromDelegate(int ctrlTag, double normaliz
   if(!mGraphics)
     return;
 
+  auto lock = mGraphics->LockControlState();
+
   IControl* pControl = mGraphics->GetControlWithTag(ctrlTag);
   
   assert(pControl);
@@ -84,6 +89,8 @@ void IGEditorDelegate::SendControlMsgFromDelegate(int ctrlTag, int msgTag, int d
 {
   if(!mGraphics)
     return;
+
+  auto lock = mGraphics->LockControlState();
   
   IControl* pControl = mGraphics->GetControlWithTag(ctrlTag);
   
@@ -95,52 +102,94 @@ void IGEditorDelegate::SendControlMsgFromDelegate(int ctrlTag, int msgTag, int d
   }
 }
 
+void IGEditorDelegate::SendControlMsgsFromDelegate(const ControlMsg* pMsgs, int nMsgs)
+{
+  if(!mGraphics)
+    return;
+
+  // one lock for all of them, e.g. a meter bridge fed by several senders
+  auto lock = mGraphics->LockControlState();
+
+  for (int i = 0; i < nMsgs; i++)
+  {
+    IControl* pControl = mGraphics->GetControlWithTag(pMsgs[i].ctrlTag);
+
+    assert(pControl);
+
+    if(pControl)
+      pControl->OnMsgFromDelegate(pMsgs[i].msgTag, pMsgs[i].dataSize, pMsgs[i].pData);
+  }
+}
+
 void IGEditorDelegate::SendParameterValueFromDelegate(int paramIdx, double value, bool normalized)
 {
   if(mGraphics)
   {
+    auto lock = mGraphics->LockControlState();
+
     if (!normalized)
       value = GetParam(paramIdx)->ToNormalized(value);
 
-    for (int c = 0; c < mGraphics->NControls(); c++)
-    {
-      IControl* pControl = mGraphics->GetControl(c);
-      
-      int nVals = pControl->NVals();
-      
-      for(int v = 0; v < nVals; v++)
-      {
-        if (pControl->GetParamIdx(v) == paramIdx)
-        {
-          pControl->SetValueFromDelegate(value, v);
-          // Could be more than one, don't break until we check them all.
-        }
-      }
-
-    }
+    SetLinkedControlValues(paramIdx, value);
   }
   
   IEditorDelegate::SendParameterValueFromDelegate(paramIdx, value, normalized);
 }
 
-void IGEditorDelegate::SendMidiMsgFromDelegate(const IMidiMsg& msg)
+void IGEditorDelegate::SendParameterValuesFromDelegate(const ParamTuple* pParams, int nParams, bool normalized)
 {
   if(mGraphics)
   {
-    for (auto c = 0; c < mGraphics->NControls(); c++) // TODO: could keep a map
+    // one lock for all of them, e.g. when a preset is loaded
+    auto lock = mGraphics->LockControlState();
+
+    for (int i = 0; i < nParams; i++)
     {
-      IControl* pControl = mGraphics->GetControl(c);
-      
-      if (pControl->GetWantsMidi())
-      {
-        pControl->OnMidi(msg);
-      }
+      const double value = normalized ? pParams[i].value : GetParam(pParams[i].idx)->ToNormalized(pParams[i].value);
+      SetLinkedControlValues(pParams[i].idx, value);
     }
   }
+
+  for (int i = 0; i < nParams; i++)
+    IEditorDelegate::SendParameterValueFromDelegate(pParams[i].idx, pParams[i].value, normalized);
+}
+
+void IGEditorDelegate::SetLinkedControlValues(int paramIdx, double normalizedValue)
+{
+  if (const auto* pControls = mGraphics->GetControlsWithParam(paramIdx))
+  {
+    for (const auto& link : *pControls)
+      link.first->SetValueFromDelegate(normalizedValue, link.second);
+  }
+}
+
+void IGEditorDelegate::SendMidiMsgFromDelegate(const IMidiMsg& msg)
+{
+  if(mGraphics)
+  {
+    auto lock = mGraphics->LockControlState();
+
+    for (IControl* pControl : mGraphics->GetControlsWantingMidi())
+      pControl->OnMidi(msg);
+  }
   
   IEditorDelegate::SendMidiMsgFromDelegate(msg);
 }
 
+void IGEditorDelegate::SendMidiMsgsFromDelegate(const IMidiMsg* pMsgs, int nMsgs)
+{
+  if(mGraphics)
+  {
+    auto lock = mGraphics->LockControlState();
+
+    for (IControl* pControl : mGraphics->GetControlsWantingMidi())
+      pControl->OnMidiMsgs(pMsgs, nMsgs);
+  }
+  
+  for (int i = 0; i < nMsgs; i++)
+    IEditorDelegate::SendMidiMsgFromDelegate(pMsgs[i]);
+}
+
 bool IGEditorDelegate::SerializeEditorSize(IByteChunk& data) const
 {
   bool savedOK = true;
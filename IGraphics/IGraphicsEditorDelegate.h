@@ -52,8 +52,11 @@ public:
   //The rest should be final, but the WebSocketEditorDelegate needs to override them
   void SendControlValueFromDelegate(int ctrlTag, double normalizedValue) override;
   void SendControlMsgFromDelegate(int ctrlTag, int msgTag, int dataSize = 0, const void* pData = nullptr) override;
+  void SendControlMsgsFromDelegate(const ControlMsg* pMsgs, int nMsgs) override;
   void SendMidiMsgFromDelegate(const IMidiMsg& msg) override;
+  void SendMidiMsgsFromDelegate(const IMidiMsg* pMsgs, int nMsgs) override;
   void SendParameterValueFromDelegate(int paramIdx, double value, bool normalized) override;
+  void SendParameterValuesFromDelegate(const ParamTuple* pParams, int nParams, bool normalized) override;
 
   /** Called to create the IGraphics instance for this editor. Default impl calls  mMakeGraphicsFunc */
   virtual IGraphics* CreateGraphics()
@@ -92,6 +95,9 @@ protected:
   std::function<IGraphics*()> mMakeGraphicsFunc = nullptr;
   std::function<void(IGraphics* pGraphics)> mLayoutFunc = nullptr;
 private:
+  /** Set the value of the controls linked to a parameter, which must be called with the control state locked */
+  void SetLinkedControlValues(int paramIdx, double normalizedValue);
+
   std::unique_ptr<IGraphics> mGraphics;
   int mLastWidth = 0;
   int mLastHeight = 0;
@@ -74,8 +74,33 @@ public:
     {
     }
     
-    void SetText(const char* str) { mText.Set(str); }
+    void SetText(const char* str) { mText.Set(str); mMeasuredBy = nullptr; }
     const char* GetText() const { return mText.Get(); }; // TODO: Text -> Str!
+
+    /** Get the size of the text, as measured by a menu renderer such as IPopupMenuControl, so that it measures a long menu once rather than each time it opens
+     * @param pOwner The renderer that measured it
+     * @param textSize The font size it was measured with
+     * @param w Set to the width, if it was measured by the same owner and size
+     * @param h Set to the height, if it was measured by the same owner and size
+     * @return \c true if the text was measured by the same owner and size and hasn't changed since */
+    bool GetMeasuredTextSize(const void* pOwner, float textSize, float& w, float& h) const
+    {
+      if (mMeasuredBy != pOwner || mMeasuredTextSize != textSize)
+        return false;
+
+      w = mMeasuredW;
+      h = mMeasuredH;
+      return true;
+    }
+
+    /** Store the size of the text, see GetMeasuredTextSize() */
+    void SetMeasuredTextSize(const void* pOwner, float textSize, float w, float h) const
+    {
+      mMeasuredBy = pOwner;
+      mMeasuredTextSize = textSize;
+      mMeasuredW = w;
+      mMeasuredH = h;
+    }
     
     bool GetEnabled() const { return !(mFlags & kDisabled); }
     bool GetChecked() const { return (mFlags & kChecked) != 0; }
@@ -111,6 +136,11 @@ public:
     std::unique_ptr<IPopupMenu> mSubmenu;
     int mFlags;
     int mTag = -1;
+
+    mutable const void* mMeasuredBy = nullptr;
+    mutable float mMeasuredTextSize = 0.f;
+    mutable float mMeasuredW = 0.f;
+    mutable float mMeasuredH = 0.f;
   };
   
   #pragma mark -
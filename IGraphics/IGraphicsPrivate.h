@@ -25,6 +25,8 @@
 #include "ptrlist.h"
 #include "heapbuf.h"
 
+// with Skia, SVGs are loaded with Skia's SVG module and recorded into an SkPicture that is played back to draw them.
+// Define IGRAPHICS_NO_SKIA_SVG to draw them with NanoSVG and IGraphics paths instead, or IGRAPHICS_NO_SKIA_SVG_PICTURE to render the DOM on every draw
 #if defined IGRAPHICS_SKIA && !defined IGRAPHICS_NO_SKIA_SVG
 #define SVG_USE_SKIA
 #endif
@@ -35,6 +37,8 @@
   #pragma warning( disable : 5030 )
   #include "SkSVGDOM.h"
   #include "include/core/SkCanvas.h"
+  #include "include/core/SkPicture.h"
+  #include "include/core/SkPictureRecorder.h"
   #include "include/core/SkStream.h"
   #include "src/xml/SkDOM.h"
   #pragma warning( pop )
@@ -43,6 +47,7 @@
 #endif
 
 #include "IPlugPlatform.h"
+#include "IPlugMemoryStats.h"
 
 #if defined IGRAPHICS_NANOVG
   #define BITMAP_DATA_TYPE int;
@@ -149,12 +154,43 @@ public:
   /** @return the draw scale of the bitmap */
   float GetDrawScale() const { return mDrawScale; }
 
+  /** Count the bitmap's pixels against a category of the memory stats, until it is deleted. Pixels count as 32 bits, since the back ends store them as RGBA, in memory or on the GPU
+   * @param pStats The stats to count against, or nullptr to stop counting
+   * @param category The category to count against */
+  void TrackMemory(IMemoryStats* pStats, IMemoryStats::ECategory category)
+  {
+    mMemory.Set(pStats, category, static_cast<int64_t>(mWidth) * mHeight * 4);
+  }
+
 private:
   BitmapData mBitmap; // for most drawing APIs BitmapData is a pointer. For Nanovg it is an integer index
   int mWidth;
   int mHeight;
   float mScale;
   float mDrawScale;
+  IMemoryStats::Allocation mMemory;
+};
+
+/** A base class for a fragment shader compiled by a drawing back end, see IGraphics::CreateAPIShader().
+ * It holds the back end's program or pipeline, which belongs to the graphics context, so it must be deleted before the context is, e.g. by the control that uses it */
+class APIShader
+{
+public:
+  /** @param nUniforms The number of floats in the shader's uData array */
+  APIShader(int nUniforms)
+  : mNUniforms(nUniforms)
+  {}
+
+  virtual ~APIShader() {}
+
+  APIShader(const APIShader&) = delete;
+  APIShader& operator=(const APIShader&) = delete;
+
+  /** @return The number of floats in the shader's uData array */
+  int NUniforms() const { return mNUniforms; }
+
+private:
+  int mNUniforms;
 };
 
 /** Used to retrieve font info directly from a raw memory buffer. */
@@ -449,20 +485,23 @@ using PlatformFontPtr = std::unique_ptr<PlatformFont>;
 #ifdef SVG_USE_SKIA
 struct SVGHolder
 {
-  SVGHolder(sk_sp<SkSVGDOM> svgDom)
+  SVGHolder(sk_sp<SkSVGDOM> svgDom, sk_sp<SkPicture> picture)
   : mSVGDom(svgDom)
+  , mPicture(picture)
   {
   }
   
   ~SVGHolder()
   {
     mSVGDom = nullptr;
+    mPicture = nullptr;
   }
   
   SVGHolder(const SVGHolder&) = delete;
   SVGHolder& operator=(const SVGHolder&) = delete;
   
   sk_sp<SkSVGDOM> mSVGDom;
+  sk_sp<SkPicture> mPicture;
 };
 #else
 /** Used internally to manage SVG data*/
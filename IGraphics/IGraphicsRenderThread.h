@@ -0,0 +1,140 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc IRenderThread
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "IGraphicsStructs.h"
+
+BEGIN_IPLUG_NAMESPACE
+BEGIN_IGRAPHICS_NAMESPACE
+
+/** A dedicated thread that draws the dirty regions submitted by the UI thread, so that a slow frame doesn't stall the platform's event handling.
+ * The UI thread keeps calling IsDirty() from its timer and submits the dirty regions, which are accumulated in a pending list until the render
+ * thread swaps it with the list it draws from. Access to control state is serialized by the control state mutex, which the render thread holds
+ * for the duration of a draw and the UI thread holds whilst handling events, see IGraphics::LockControlState() */
+class IRenderThread
+{
+public:
+  using RenderFunc = std::function<void(IRECTList& rects)>;
+
+  /** @param renderFunc Called on the render thread with the control state mutex held, to draw the dirty regions */
+  IRenderThread(RenderFunc renderFunc)
+  : mRenderFunc(renderFunc)
+  {
+    mThread = std::thread(&IRenderThread::ThreadLoop, this);
+  }
+
+  ~IRenderThread()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mPendingMutex);
+      mRunning = false;
+    }
+
+    mPendingCV.notify_one();
+    mThread.join();
+  }
+
+  IRenderThread(const IRenderThread&) = delete;
+  IRenderThread& operator=(const IRenderThread&) = delete;
+
+  /** Called on the UI thread to add regions to be drawn on the next frame
+   * @param rects The dirty regions */
+  void Submit(const IRECTList& rects)
+  {
+    if (!rects.Size())
+      return;
+
+    {
+      std::lock_guard<std::mutex> lock(mPendingMutex);
+
+      for (auto i = 0; i < rects.Size(); i++)
+        mPending.Add(rects.Get(i));
+    }
+
+    mPendingCV.notify_one();
+  }
+
+  /** @return \c true if the render thread is drawing, or has regions waiting to be drawn. The UI thread can use this to skip frames rather than queue them */
+  bool IsBusy() const { return mBusy.load(std::memory_order_acquire); }
+
+  /** @return The mutex that must be held in order to read or modify control state whilst the render thread is running */
+  std::recursive_mutex& GetControlStateMutex() { return mControlStateMutex; }
+
+  /** @return \c true if called from the render thread */
+  bool IsRenderThread() const { return std::this_thread::get_id() == mThread.get_id(); }
+
+private:
+  void ThreadLoop()
+  {
+    while (true)
+    {
+      {
+        std::unique_lock<std::mutex> lock(mPendingMutex);
+        mPendingCV.wait(lock, [this]() { return !mRunning || mPending.Size() > 0; });
+
+        if (!mRunning)
+          return;
+
+        mBusy.store(true, std::memory_order_release);
+
+        // swap the double buffered lists, so the UI thread can keep submitting whilst this frame is drawn
+        mDrawing.Clear();
+
+        for (auto i = 0; i < mPending.Size(); i++)
+          mDrawing.Add(mPending.Get(i));
+
+        mPending.Clear();
+      }
+
+      // the UI thread may be holding the control state whilst it stops this thread, so don't block on it indefinitely
+      std::unique_lock<std::recursive_mutex> lock(mControlStateMutex, std::try_to_lock);
+
+      while (!lock.owns_lock())
+      {
+        if (!mRunning)
+          return;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        lock.try_lock();
+      }
+
+      mRenderFunc(mDrawing);
+      lock.unlock();
+
+      mBusy.store(false, std::memory_order_release);
+    }
+  }
+
+  RenderFunc mRenderFunc;
+  IRECTList mPending;
+  IRECTList mDrawing;
+  std::mutex mPendingMutex;
+  std::condition_variable mPendingCV;
+  std::recursive_mutex mControlStateMutex;
+  std::atomic<bool> mBusy {false};
+  std::atomic<bool> mRunning {true};
+  std::thread mThread;
+};
+
+END_IGRAPHICS_NAMESPACE
+END_IPLUG_NAMESPACE
@@ -0,0 +1,136 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc IResourceLoader
+ */
+
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "IPlugPlatform.h"
+#include "IPlugTaskScheduler.h"
+
+BEGIN_IPLUG_NAMESPACE
+BEGIN_IGRAPHICS_NAMESPACE
+
+/** Loads resources for IGraphics in the background, on the process wide TaskScheduler at UI priority, so that instances don't each start their own threads.
+ * Tasks are identified by the name of the resource they load, so that a synchronous load of the same resource can wait for it (or run it straight away if no worker has picked it up yet).
+ * Completion functions are queued and called on the UI thread by ProcessCompletions(). With no worker threads, tasks are run immediately on the calling thread */
+class IResourceLoader
+{
+public:
+  /** @param pScheduler The scheduler to run the tasks on */
+  IResourceLoader(TaskScheduler::Ptr pScheduler = TaskScheduler::Get())
+  : mScheduler(std::move(pScheduler))
+  {
+  }
+
+  /** Cancels the tasks that haven't started, and waits for the others, since they use the IGraphics that owns this */
+  ~IResourceLoader()
+  {
+    std::unordered_multimap<std::string, TaskScheduler::TaskPtr> tasks;
+
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      tasks.swap(mTasks);
+    }
+
+    for (auto& task : tasks)
+      task.second->Cancel();
+
+    for (auto& task : tasks)
+      task.second->Wait();
+  }
+
+  IResourceLoader(const IResourceLoader&) = delete;
+  IResourceLoader& operator=(const IResourceLoader&) = delete;
+
+  /** Queue a task to load a resource
+   * @param name The name of the resource the task loads
+   * @param task The function that loads it, called on a worker thread */
+  void Add(const char* name, std::function<void()> task)
+  {
+    TaskScheduler::TaskPtr pTask = mScheduler->Submit(TaskScheduler::kPriorityUI, [task = std::move(task)](const TaskScheduler::Task&) { task(); });
+
+    if (pTask->IsDone())
+      return;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    // forget the tasks that have finished
+    for (auto it = mTasks.begin(); it != mTasks.end();)
+      it = it->second->IsDone() ? mTasks.erase(it) : std::next(it);
+
+    mTasks.emplace(name, std::move(pTask));
+  }
+
+  /** Block until any task loading the named resource has completed. If it hasn't started yet it is run on the calling thread
+   * @param name The name of the resource */
+  void WaitFor(const char* name)
+  {
+    std::vector<TaskScheduler::TaskPtr> tasks;
+
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      auto range = mTasks.equal_range(name);
+
+      for (auto it = range.first; it != range.second; ++it)
+        tasks.push_back(it->second);
+
+      mTasks.erase(range.first, range.second);
+    }
+
+    for (auto& pTask : tasks)
+    {
+      if (!pTask->RunIfPending())
+        pTask->Wait();
+    }
+  }
+
+  /** Queue a function to be called on the UI thread, by ProcessCompletions() */
+  void AddCompletion(std::function<void()> completion)
+  {
+    std::lock_guard<std::mutex> lock(mCompletionMutex);
+    mCompletions.push_back(std::move(completion));
+  }
+
+  /** Call any queued completion functions, on the UI thread */
+  void ProcessCompletions()
+  {
+    std::vector<std::function<void()>> completions;
+
+    {
+      std::lock_guard<std::mutex> lock(mCompletionMutex);
+      completions.swap(mCompletions);
+    }
+
+    for (auto& completion : completions)
+      completion();
+  }
+
+private:
+  TaskScheduler::Ptr mScheduler;
+  std::unordered_multimap<std::string, TaskScheduler::TaskPtr> mTasks;
+  std::mutex mMutex;
+
+  std::mutex mCompletionMutex;
+  std::vector<std::function<void()>> mCompletions;
+};
+
+END_IGRAPHICS_NAMESPACE
+END_IPLUG_NAMESPACE
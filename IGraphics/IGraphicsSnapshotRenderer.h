@@ -0,0 +1,191 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc ISnapshotRenderer
+ */
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "IPlugSignal.h"
+#include "IGraphicsEditorDelegate.h"
+#include "IControl.h"
+
+BEGIN_IPLUG_NAMESPACE
+BEGIN_IGRAPHICS_NAMESPACE
+
+/** ISnapshotRenderer draws the plug-in's UI into bitmaps on a worker thread, with the controls showing a given set of parameter values, e.g. for preset browser thumbnails,
+ * documentation screenshots or visual regression tests, without blocking the editor, which doesn't need to be open.
+ *
+ * The worker makes its own IGraphics with the delegate's CreateGraphics() and LayoutUI(), which is never opened in a window, and draws it with IGraphics::DrawToBitmapData().
+ * That needs a back-end that draws in memory, Skia with IGRAPHICS_CPU, since NanoVG and GPU Skia have no drawing context on the worker, and their snapshots fail.
+ * The layout function runs on the worker, so it shouldn't touch the editor's IGraphics, and controls that message the plug-in or read parameter display text in OnAttached() or Draw() see the plug-in's current state,
+ * rather than the snapshot. The controls are given the snapshot's values with IControl::SetValueFromDelegate() */
+class ISnapshotRenderer
+{
+public:
+  /** A drawn snapshot, see IGraphics::DrawToBitmapData() for the format of the pixels */
+  struct Snapshot
+  {
+    int tag = 0;
+    int width = 0;
+    int height = 0;
+    int rowBytes = 0;
+    RawBitmapData pixels;
+  };
+
+  /** Called on the worker thread with each snapshot that was drawn. The snapshot can be moved from, e.g. into a queue for the UI thread */
+  using SnapshotFunc = std::function<void(Snapshot& snapshot)>;
+
+  /** @param delegate The editor delegate, whose CreateGraphics() and LayoutUI() make the UI
+   * @param func Called on the worker thread with each snapshot
+   * @param screenScale The backing scale of the snapshots, e.g. 0.5 for small thumbnails */
+  ISnapshotRenderer(IGEditorDelegate& delegate, SnapshotFunc func, float screenScale = 1.f)
+  : mDelegate(delegate)
+  , mFunc(func)
+  , mScreenScale(screenScale)
+  {
+    mThread = std::thread(&ISnapshotRenderer::ThreadLoop, this);
+  }
+
+  ~ISnapshotRenderer()
+  {
+    mRunning = false;
+    mSignal.Notify();
+    mThread.join();
+  }
+
+  ISnapshotRenderer(const ISnapshotRenderer&) = delete;
+  ISnapshotRenderer& operator=(const ISnapshotRenderer&) = delete;
+
+  /** Ask for a snapshot of the UI with the controls linked to parameters showing these values. This doesn't block
+   * @param tag Passed back with the snapshot, e.g. the index of the preset
+   * @param normalizedValues The normalised value of each parameter, by index */
+  void Submit(int tag, const std::vector<double>& normalizedValues)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mRequestMutex);
+      mRequests.push_back({tag, normalizedValues});
+    }
+
+    mSignal.Notify();
+  }
+
+  /** Ask for a snapshot of the UI with the plug-in's current parameter values. Call this on the main thread
+   * @param tag Passed back with the snapshot */
+  void SubmitCurrent(int tag)
+  {
+    std::vector<double> values(mDelegate.NParams());
+
+    for (int i = 0; i < mDelegate.NParams(); i++)
+      values[i] = mDelegate.GetParam(i)->GetNormalized();
+
+    Submit(tag, values);
+  }
+
+  /** @return The number of snapshots that have been asked for, but not drawn yet */
+  int NPending() const
+  {
+    std::lock_guard<std::mutex> lock(mRequestMutex);
+    return static_cast<int>(mRequests.size()) + (mDrawing ? 1 : 0);
+  }
+
+private:
+  struct Request
+  {
+    int tag;
+    std::vector<double> values;
+  };
+
+  void ThreadLoop()
+  {
+    // the IGraphics is made, drawn and destroyed on this thread only
+    std::unique_ptr<IGraphics> pGraphics;
+    std::vector<Request> requests;
+
+    while (mRunning)
+    {
+      mSignal.Wait();
+
+      {
+        std::lock_guard<std::mutex> lock(mRequestMutex);
+        requests.swap(mRequests);
+        mDrawing = !requests.empty();
+      }
+
+      for (const Request& request : requests)
+      {
+        if (!mRunning)
+          break;
+
+        if (!pGraphics)
+        {
+          pGraphics.reset(mDelegate.CreateGraphics());
+
+          if (!pGraphics)
+            break;
+
+          pGraphics->InitOffscreen(mScreenScale);
+        }
+
+        Draw(*pGraphics, request);
+      }
+
+      requests.clear();
+
+      std::lock_guard<std::mutex> lock(mRequestMutex);
+      mDrawing = false;
+    }
+  }
+
+  void Draw(IGraphics& graphics, const Request& request)
+  {
+    const int nValues = static_cast<int>(request.values.size());
+
+    graphics.ForAllControlsFunc([&](IControl* pControl) {
+      for (int v = 0; v < pControl->NVals(); v++)
+      {
+        const int paramIdx = pControl->GetParamIdx(v);
+
+        if (paramIdx > kNoParameter && paramIdx < nValues)
+          pControl->SetValueFromDelegate(request.values[paramIdx], v);
+      }
+    });
+
+    Snapshot snapshot;
+    snapshot.tag = request.tag;
+
+    if (graphics.DrawToBitmapData(snapshot.pixels, snapshot.width, snapshot.height, snapshot.rowBytes))
+      mFunc(snapshot);
+  }
+
+  IGEditorDelegate& mDelegate;
+  SnapshotFunc mFunc;
+  const float mScreenScale;
+
+  std::atomic<bool> mRunning {true};
+  IPlugSignal mSignal;
+  std::thread mThread;
+
+  mutable std::mutex mRequestMutex;
+  std::vector<Request> mRequests;
+  bool mDrawing = false;
+};
+
+END_IGRAPHICS_NAMESPACE
+END_IPLUG_NAMESPACE
@@ -19,6 +19,10 @@
 #include <functional>
 #include <chrono>
 #include <numeric>
+#include <vector>
+#include <list>
+#include <string>
+#include <unordered_map>
 
 #include "IPlugUtilities.h"
 #include "IPlugLogger.h"
@@ -40,6 +44,7 @@ struct IVec2;
 struct IMouseInfo;
 struct IColor;
 struct IGestureInfo;
+struct ISVG;
 
 using IActionFunction = std::function<void(IControl*)>;
 using IAnimationFunction = std::function<void(IControl*)>;
@@ -51,6 +56,7 @@ using IGestureFunc = std::function<void(IControl*, const IGestureInfo&)>;
 using IPopupFunction = std::function<void(IPopupMenu* pMenu)>;
 using IDisplayTickFunc = std::function<void()>;
 using IUIAppearanceChangedFunc = std::function<void(EUIAppearance appearance)>;
+using ISVGLoadedFunc = std::function<void(const ISVG& svg)>;
 using ITouchID = uintptr_t;
 
 /** A click action function that does nothing */
@@ -100,6 +106,15 @@ public:
   {
   }
 
+  /** IBitmap Constructor for a region of another bitmap, such as an image packed into an atlas page by Scripts/pack_bitmaps.py.
+   * Drawing many regions of the same page avoids switching textures between draws
+   @param page The bitmap containing the region
+   @param region The region, in the unscaled coordinates of the page
+   @param n Number of frames (for multi frame film-strip bitmaps)
+   @param framesAreHorizontal framesAreHorizontal \c true if the frames are positioned horizontally
+   @param name Resource name for the bitmap */
+  inline IBitmap(const IBitmap& page, const IRECT& region, int n, bool framesAreHorizontal, const char* name = "");
+
   IBitmap()
   : mAPIBitmap(nullptr)
   , mW(0)
@@ -109,6 +124,12 @@ public:
   {
   }
   
+  /** @return The horizontal offset of the bitmap within its APIBitmap in pixels, non zero for a region of an atlas page */
+  int X() const { return mX; }
+
+  /** @return The vertical offset of the bitmap within its APIBitmap in pixels, non zero for a region of an atlas page */
+  int Y() const { return mY; }
+
   /** @return overall bitmap width in pixels */
   int W() const { return mW; }
 
@@ -145,6 +166,9 @@ public:
 private:
   /** Pointer to the API specific bitmap */
   APIBitmap* mAPIBitmap;
+  /** Offset of the bitmap within the API bitmap (in pixels) */
+  int mX = 0;
+  int mY = 0;
   /** Bitmap width (in pixels) */
   int mW;
   /** Bitmap height (in pixels) */
@@ -163,8 +187,9 @@ private:
 #ifdef SVG_USE_SKIA
 struct ISVG
 {
-  ISVG(sk_sp<SkSVGDOM> svgDom)
+  ISVG(sk_sp<SkSVGDOM> svgDom, sk_sp<SkPicture> picture = nullptr)
   : mSVGDom(svgDom)
+  , mPicture(picture)
   {
   }
   
@@ -189,7 +214,12 @@ struct ISVG
   /** @return \true if the SVG has valid data */
   inline bool IsValid() const { return mSVGDom != nullptr; }
   
+  /** @return An identifier for the underlying SVG data, shared by every ISVG loaded from the same resource */
+  const void* GetID() const { return mSVGDom.get(); }
+  
   sk_sp<SkSVGDOM> mSVGDom;
+  /** The SVG recorded when it was loaded, which is played back rather than walking the DOM on every draw, or nullptr if IGRAPHICS_NO_SKIA_SVG_PICTURE is defined */
+  sk_sp<SkPicture> mPicture;
 };
 #else
 struct ISVG
@@ -220,6 +250,9 @@ struct ISVG
   /** @return \true if the SVG has valid data */
   inline bool IsValid() const { return mImage != nullptr; }
   
+  /** @return An identifier for the underlying SVG data, shared by every ISVG loaded from the same resource */
+  const void* GetID() const { return mImage; }
+  
   NSVGimage* mImage = nullptr;
 };
 #endif
@@ -1735,6 +1768,19 @@ struct IGestureInfo
   EGestureType type = EGestureType::Unknown;
 };
 
+// defined here, since IRECT is incomplete where IBitmap is declared
+IBitmap::IBitmap(const IBitmap& page, const IRECT& region, int n, bool framesAreHorizontal, const char* name)
+: mAPIBitmap(page.GetAPIBitmap())
+, mX(page.X() + static_cast<int>(region.L))
+, mY(page.Y() + static_cast<int>(region.T))
+, mW(static_cast<int>(region.W()))
+, mH(static_cast<int>(region.H()))
+, mN(n)
+, mFramesAreHorizontal(framesAreHorizontal)
+, mResourceName(name, static_cast<int>(strlen(name)))
+{
+}
+
 /** Used to manage a list of rectangular areas and optimize them for drawing to the screen. */
 class IRECTList
 {
@@ -1993,6 +2039,114 @@ private:
   WDL_TypedBuf<IRECT> mRects;
 };
 
+/** A uniform grid of cells over a rectangular area, used to quickly find the items whose rectangles overlap a point or region.
+ * IGraphics uses this to avoid visiting every control when hit testing and drawing. Items are identified by an index.
+ * Rectangles that extend beyond the grid bounds are clamped to the edge cells, so queries outside the bounds are still correct */
+class IRECTGrid
+{
+public:
+  IRECTGrid()
+  {}
+
+  IRECTGrid(const IRECTGrid&) = delete;
+  IRECTGrid& operator=(const IRECTGrid&) = delete;
+
+  /** Remove all items and set up the cells
+   * @param bounds The area covered by the grid
+   * @param cellSize The width and height of each cell
+   * @param nItems The number of items that will be added, i.e. one more than the highest index */
+  void Reset(const IRECT& bounds, float cellSize, int nItems)
+  {
+    mBounds = bounds;
+    mCellSize = std::max(cellSize, 1.f);
+    mNumCols = std::max(1, static_cast<int>(std::ceil(bounds.W() / mCellSize)));
+    mNumRows = std::max(1, static_cast<int>(std::ceil(bounds.H() / mCellSize)));
+
+    if (static_cast<int>(mCells.size()) < mNumCols * mNumRows)
+      mCells.resize(mNumCols * mNumRows);
+
+    for (auto& cell : mCells)
+      cell.Resize(0, false);
+
+    mStamps.Resize(nItems, false);
+    memset(mStamps.Get(), 0, nItems * sizeof(uint32_t));
+    mStamp = 0;
+  }
+
+  /** Add an item to every cell its rectangle overlaps. Add items in ascending index order, so that queries return them in that order
+   * @param idx The item index
+   * @param r The item's rectangle */
+  void Add(int idx, const IRECT& r)
+  {
+    if (r.Empty())
+      return;
+
+    const int c0 = GetCol(r.L), c1 = GetCol(r.R);
+    const int r0 = GetRow(r.T), r1 = GetRow(r.B);
+
+    for (auto row = r0; row <= r1; row++)
+      for (auto col = c0; col <= c1; col++)
+        mCells[row * mNumCols + col].Add(idx);
+  }
+
+  /** @return The items that may contain the point, in ascending order. These are candidates only and need their own hit test */
+  const WDL_TypedBuf<int>& GetItemsAt(float x, float y) const
+  {
+    return mCells[GetRow(y) * mNumCols + GetCol(x)];
+  }
+
+  /** Collect the items that may overlap a region, each one once and in ascending order
+   * @param r The region to query
+   * @param result Filled with the candidate item indices */
+  void GetItemsIn(const IRECT& r, WDL_TypedBuf<int>& result)
+  {
+    result.Resize(0, false);
+
+    if (++mStamp == 0)
+    {
+      memset(mStamps.Get(), 0, mStamps.GetSize() * sizeof(uint32_t));
+      mStamp = 1;
+    }
+
+    const int c0 = GetCol(r.L), c1 = GetCol(r.R);
+    const int r0 = GetRow(r.T), r1 = GetRow(r.B);
+    uint32_t* pStamps = mStamps.Get();
+
+    for (auto row = r0; row <= r1; row++)
+    {
+      for (auto col = c0; col <= c1; col++)
+      {
+        const WDL_TypedBuf<int>& cell = mCells[row * mNumCols + col];
+
+        for (auto i = 0; i < cell.GetSize(); i++)
+        {
+          const int idx = cell.Get()[i];
+
+          if (pStamps[idx] != mStamp)
+          {
+            pStamps[idx] = mStamp;
+            result.Add(idx);
+          }
+        }
+      }
+    }
+
+    std::sort(result.Get(), result.Get() + result.GetSize());
+  }
+
+private:
+  int GetCol(float x) const { return Clip(static_cast<int>(std::floor((x - mBounds.L) / mCellSize)), 0, mNumCols - 1); }
+  int GetRow(float y) const { return Clip(static_cast<int>(std::floor((y - mBounds.T) / mCellSize)), 0, mNumRows - 1); }
+
+  IRECT mBounds;
+  float mCellSize = 64.f;
+  int mNumCols = 1;
+  int mNumRows = 1;
+  std::vector<WDL_TypedBuf<int>> mCells = std::vector<WDL_TypedBuf<int>>(1);
+  WDL_TypedBuf<uint32_t> mStamps;
+  uint32_t mStamp = 0;
+};
+
 /** Used to store transformation matrices */
 struct IMatrix
 {
@@ -2368,6 +2522,395 @@ private:
 /** ILayerPtr is a managed pointer for transferring the ownership of layers */
 using ILayerPtr = std::unique_ptr<ILayer>;
 
+/** The sources of a fragment shader for IGraphics::CreateAPIShader(), one per shading language, so that a control can draw with each drawing back end.
+ * Each source defines a function that returns the premultiplied color of a pixel, given its position in the drawn rectangle from 0 to 1, with 0, 0 at the top left,
+ * and the size of the rectangle in pixels. The uniforms are an array of mNUniforms floats named uData, which the back end declares before the source:
+ * - GLSL (NanoVG with GL), used as a global:     vec4 shade(vec2 uv, vec2 size)
+ * - MSL (NanoVG with Metal), passed as data:      float4 shade(float2 uv, float2 size, constant float* uData)
+ * - SkSL (Skia), used as a global:                float4 shade(float2 uv, float2 size)
+ * The GLSL is compiled for the GL version in use, so it should stick to what GLSL 1.20 and GLSL ES 1.00 share */
+struct IShaderSource
+{
+  const char* mGLSL = nullptr;
+  const char* mMSL = nullptr;
+  const char* mSkSL = nullptr;
+  int mNUniforms = 0;
+};
+
+/** An immutable recording of path drawing, made with IGraphics::StartDisplayList() and IGraphics::EndDisplayList() and replayed with IGraphics::DrawDisplayList().
+ * Back-ends with native support (Skia) subclass this to hold their own recording, otherwise the path commands are stored here and replayed through the path API. */
+class IDisplayList
+{
+public:
+  enum class ECommand { Clear, Close, Arc, MoveTo, LineTo, CubicBezierTo, QuadraticBezierTo, SetWinding, Stroke, Fill, SetMatrix };
+
+  /** A single recorded call. The meaning of the values depends on the command, and idx refers to a recorded paint or matrix */
+  struct Command
+  {
+    ECommand type;
+    float v[6];
+    int idx;
+  };
+
+  /** The pattern and options of a recorded fill or stroke */
+  struct Paint
+  {
+    Paint(const IPattern& pattern)
+    : pattern(pattern)
+    {}
+
+    IPattern pattern;
+    IFillOptions fillOptions;
+    IStrokeOptions strokeOptions;
+    float thickness = 1.f;
+    IBlend blend;
+    bool hasBlend = false;
+  };
+
+  /** @param bounds The area the recording is expected to draw into */
+  IDisplayList(const IRECT& bounds)
+  : mBounds(bounds)
+  {}
+
+  virtual ~IDisplayList() {}
+
+  IDisplayList(const IDisplayList&) = delete;
+  IDisplayList& operator=(const IDisplayList&) = delete;
+
+  /** @return The area the recording is expected to draw into */
+  const IRECT& Bounds() const { return mBounds; }
+
+  /** @return The number of recorded commands */
+  int NCommands() const { return static_cast<int>(mCommands.size()); }
+
+  /** @return The recorded command at an index */
+  const Command& GetCommand(int idx) const { return mCommands[idx]; }
+
+  /** @return The recorded paint referred to by a fill or stroke command */
+  const Paint& GetPaint(int idx) const { return mPaints[idx]; }
+
+  /** @return The recorded matrix referred to by a SetMatrix command, relative to the transform at the start of the recording */
+  const IMatrix& GetMatrix(int idx) const { return mMatrices[idx]; }
+
+  /** Called by the drawing back-ends whilst recording */
+  void Add(ECommand type, float v0 = 0.f, float v1 = 0.f, float v2 = 0.f, float v3 = 0.f, float v4 = 0.f, float v5 = 0.f, int idx = 0)
+  {
+    mCommands.push_back({type, {v0, v1, v2, v3, v4, v5}, idx});
+  }
+
+  /** Called by the drawing back-ends whilst recording a fill */
+  void AddFill(const IPattern& pattern, const IFillOptions& options, const IBlend* pBlend)
+  {
+    Paint paint(pattern);
+    paint.fillOptions = options;
+    AddPaint(ECommand::Fill, paint, pBlend);
+  }
+
+  /** Called by the drawing back-ends whilst recording a stroke */
+  void AddStroke(const IPattern& pattern, float thickness, const IStrokeOptions& options, const IBlend* pBlend)
+  {
+    Paint paint(pattern);
+    paint.strokeOptions = options;
+    paint.thickness = thickness;
+    AddPaint(ECommand::Stroke, paint, pBlend);
+  }
+
+  /** Called by the drawing back-ends whilst recording a change of transform */
+  void AddMatrix(const IMatrix& m)
+  {
+    mMatrices.push_back(m);
+    Add(ECommand::SetMatrix, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, static_cast<int>(mMatrices.size()) - 1);
+  }
+
+private:
+  void AddPaint(ECommand type, Paint& paint, const IBlend* pBlend)
+  {
+    if (pBlend)
+    {
+      paint.blend = *pBlend;
+      paint.hasBlend = true;
+    }
+
+    mPaints.push_back(paint);
+    Add(type, 0.f, 0.f, 0.f, 0.f, 0.f, 0.f, static_cast<int>(mPaints.size()) - 1);
+  }
+
+  IRECT mBounds;
+  std::vector<Command> mCommands;
+  std::vector<Paint> mPaints;
+  std::vector<IMatrix> mMatrices;
+};
+
+/** IDisplayListPtr is a managed pointer for transferring the ownership of display lists */
+using IDisplayListPtr = std::unique_ptr<IDisplayList>;
+
+/** A least recently used cache of SVGs rasterized into layers, keyed by the SVG, its size in pixels and the scales it was rendered at.
+ * Used by IGraphics::DrawSVG() when enabled with IGraphics::EnableSVGRasterCache(), entries are evicted when the total size exceeds the memory budget */
+class ISVGRasterCache
+{
+public:
+  struct Key
+  {
+    const void* pSVG;
+    int width; // in pixels
+    int height; // in pixels
+    float screenScale;
+    float drawScale;
+
+    bool operator==(const Key& other) const
+    {
+      return pSVG == other.pSVG && width == other.width && height == other.height && screenScale == other.screenScale && drawScale == other.drawScale;
+    }
+  };
+
+  /** @param maxBytes The memory budget for the cached bitmaps */
+  ISVGRasterCache(size_t maxBytes = 32 * 1024 * 1024)
+  : mMaxBytes(maxBytes)
+  {}
+
+  ISVGRasterCache(const ISVGRasterCache&) = delete;
+  ISVGRasterCache& operator=(const ISVGRasterCache&) = delete;
+
+  /** Set the memory budget, evicting entries if necessary */
+  void SetMaxBytes(size_t maxBytes)
+  {
+    mMaxBytes = maxBytes;
+    Trim(0);
+  }
+
+  /** @return The total size of the cached bitmaps in bytes */
+  size_t GetBytes() const { return mBytes; }
+
+  /** @return \c true if a bitmap of this size can be cached at all */
+  bool Fits(size_t bytes) const { return bytes <= mMaxBytes; }
+
+  /** Look up a rasterized SVG, marking it as the most recently used
+   * @return Ptr to the cached layer, or nullptr if it is not cached */
+  const ILayerPtr* Find(const Key& key)
+  {
+    auto it = mMap.find(key);
+
+    if (it == mMap.end())
+      return nullptr;
+
+    mEntries.splice(mEntries.begin(), mEntries, it->second);
+    return &it->second->layer;
+  }
+
+  /** Add a rasterized SVG, evicting the least recently used entries to stay within the budget
+   * @return Ptr to the cached layer */
+  const ILayerPtr* Add(const Key& key, ILayerPtr layer, size_t bytes)
+  {
+    Trim(bytes);
+    mEntries.push_front({key, std::move(layer), bytes});
+    mMap[key] = mEntries.begin();
+    mBytes += bytes;
+    return &mEntries.front().layer;
+  }
+
+  /** Remove all entries, releasing their bitmaps */
+  void Clear()
+  {
+    mMap.clear();
+    mEntries.clear();
+    mBytes = 0;
+  }
+
+private:
+  struct Entry
+  {
+    Key key;
+    ILayerPtr layer;
+    size_t bytes;
+  };
+
+  struct KeyHash
+  {
+    size_t operator()(const Key& key) const
+    {
+      size_t hash = std::hash<const void*>()(key.pSVG);
+      hash ^= std::hash<int>()(key.width) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+      hash ^= std::hash<int>()(key.height) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+      hash ^= std::hash<float>()(key.screenScale * key.drawScale) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+      return hash;
+    }
+  };
+
+  /** Evict entries until there is room for the given number of bytes */
+  void Trim(size_t bytes)
+  {
+    while (!mEntries.empty() && mBytes + bytes > mMaxBytes)
+    {
+      mBytes -= mEntries.back().bytes;
+      mMap.erase(mEntries.back().key);
+      mEntries.pop_back();
+    }
+  }
+
+  std::list<Entry> mEntries; // most recently used first
+  std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> mMap;
+  size_t mBytes = 0;
+  size_t mMaxBytes;
+};
+
+/** A least recently used cache of text measured by the drawing back-ends, keyed by the font, size, alignment and string.
+ * Used by IGraphics::MeasureText() and IGraphics::DrawText() when enabled with IGraphics::EnableTextMeasureCache(), so that labels and value readouts
+ * that are drawn every frame are only measured when they change. Measurements are stored relative to the alignment anchor of the text's bounds
+ * (e.g. the top left for EAlign::Near and EVAlign::Top), so the same entry is used wherever the text is drawn */
+class ITextMeasureCache
+{
+public:
+  /** The text origin passed to the back-end's text drawing call, and the measured bounds, relative to the anchor */
+  struct Measurement
+  {
+    float x = 0.f;
+    float y = 0.f;
+    IRECT bounds;
+  };
+
+  /** @param maxEntries The number of measured strings to keep */
+  ITextMeasureCache(int maxEntries = 1024)
+  : mMaxEntries(maxEntries)
+  {}
+
+  ITextMeasureCache(const ITextMeasureCache&) = delete;
+  ITextMeasureCache& operator=(const ITextMeasureCache&) = delete;
+
+  /** Set the number of measured strings to keep, evicting entries if necessary */
+  void SetMaxEntries(int maxEntries)
+  {
+    mMaxEntries = std::max(maxEntries, 0);
+    Trim(0);
+  }
+
+  /** @return The number of measured strings in the cache */
+  int GetNEntries() const { return static_cast<int>(mEntries.size()); }
+
+  /** Look up a measurement, marking it as the most recently used
+   * @return Ptr to the measurement, or nullptr if the text is not cached */
+  const Measurement* Find(const IText& text, const char* str)
+  {
+    MakeKey(text, str);
+    auto it = mMap.find(mKey);
+
+    if (it == mMap.end())
+      return nullptr;
+
+    mEntries.splice(mEntries.begin(), mEntries, it->second);
+    return &it->second->measurement;
+  }
+
+  /** Add a measurement, evicting the least recently used entry if the cache is full */
+  void Add(const IText& text, const char* str, const Measurement& measurement)
+  {
+    if (!mMaxEntries)
+      return;
+
+    MakeKey(text, str);
+
+    if (mMap.find(mKey) != mMap.end())
+      return;
+
+    Trim(1);
+    mEntries.push_front({mKey, measurement});
+    mMap[mEntries.front().key] = mEntries.begin();
+  }
+
+  /** Remove all entries */
+  void Clear()
+  {
+    mMap.clear();
+    mEntries.clear();
+  }
+
+  /** Get the anchor of the bounds that measurements are relative to, which depends on the alignment of the text */
+  static void GetAnchor(const IText& text, const IRECT& bounds, float& x, float& y)
+  {
+    switch (text.mAlign)
+    {
+      case EAlign::Near:     x = bounds.L;       break;
+      case EAlign::Center:   x = bounds.MW();    break;
+      case EAlign::Far:      x = bounds.R;       break;
+    }
+
+    switch (text.mVAlign)
+    {
+      case EVAlign::Top:     y = bounds.T;       break;
+      case EVAlign::Middle:  y = bounds.MH();    break;
+      case EVAlign::Bottom:  y = bounds.B;       break;
+    }
+  }
+
+private:
+  struct Entry
+  {
+    std::string key;
+    Measurement measurement;
+  };
+
+  /** Builds the key in mKey, which keeps its capacity, so that lookups don't allocate */
+  void MakeKey(const IText& text, const char* str)
+  {
+    const char align[2] = { static_cast<char>('0' + static_cast<int>(text.mAlign)), static_cast<char>('0' + static_cast<int>(text.mVAlign)) };
+    mKey.assign(text.mFont);
+    mKey.push_back('\0');
+    mKey.append(reinterpret_cast<const char*>(&text.mSize), sizeof(text.mSize));
+    mKey.append(align, 2);
+    mKey.append(str);
+  }
+
+  /** Evict entries until there is room for the given number of entries */
+  void Trim(int nEntries)
+  {
+    while (!mEntries.empty() && GetNEntries() + nEntries > mMaxEntries)
+    {
+      mMap.erase(mEntries.back().key);
+      mEntries.pop_back();
+    }
+  }
+
+  std::list<Entry> mEntries; // most recently used first
+  std::unordered_map<std::string, std::list<Entry>::iterator> mMap;
+  std::string mKey;
+  int mMaxEntries;
+};
+
+/** The glyphs used by numeric readouts pre-rendered into a layer, for a font, size and color. Used by IGraphics::DrawText() when enabled with IGraphics::EnableDigitAtlas().
+ * Each glyph is in a cell of the layer, and its advance is rounded to device pixels, so that strings can be drawn as a row of bitmaps without rasterizing the font */
+struct IDigitAtlas
+{
+  static constexpr char kChars[] = "0123456789+-.,:%/ dBHzkms";
+  static constexpr int kNumChars = sizeof(kChars) - 1;
+  /** The padding around each glyph in its cell, in points, for antialiasing and glyphs that overhang their advance */
+  static constexpr int kPadding = 2;
+
+  /** @return The index of the character's cell, or -1 if the character isn't in the atlas */
+  static int GetCharIdx(char c)
+  {
+    const char* pChar = c ? strchr(kChars, c) : nullptr;
+    return pChar ? static_cast<int>(pChar - kChars) : -1;
+  }
+
+  /** @return \c true if this atlas was rendered for the text at these scales */
+  bool Matches(const IText& text, float screenScale, float drawScale) const
+  {
+    return !strcmp(mText.mFont, text.mFont) && mText.mSize == text.mSize && mText.mFGColor.A == text.mFGColor.A && mText.mFGColor.R == text.mFGColor.R
+      && mText.mFGColor.G == text.mFGColor.G && mText.mFGColor.B == text.mFGColor.B && mScreenScale == screenScale && mDrawScale == drawScale;
+  }
+
+  IText mText;
+  float mScreenScale = 1.f;
+  float mDrawScale = 1.f;
+  ILayerPtr mLayer;
+  /** The size of each cell in points, including the padding */
+  int mCellWidth = 0;
+  int mCellHeight = 0;
+  /** The height of the text's layout box, which is used for vertical alignment */
+  float mTextHeight = 0.f;
+  /** The advance of each glyph in points, rounded to device pixels */
+  float mAdvances[kNumChars] = {};
+};
+
 /** Used to specify properties of a drop-shadow to a layer. Use with IGraphics::ApplyLayerDropShadow() */
 struct IShadow
 {
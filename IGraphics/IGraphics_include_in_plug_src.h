@@ -40,11 +40,24 @@
   BEGIN_IPLUG_NAMESPACE
   BEGIN_IGRAPHICS_NAMESPACE
 
+  /** Start decoding the SVGs listed in IGRAPHICS_PREFETCH_SVGS in config.h, e.g. #define IGRAPHICS_PREFETCH_SVGS KNOB_FN, BACKGROUND_FN
+   * and the bitmaps listed in IGRAPHICS_PREFETCH_BITMAPS, so that they are ready by the time LayoutUI() loads them */
+  static inline void PrefetchResources(IGraphics* pGraphics)
+  {
+  #ifdef IGRAPHICS_PREFETCH_SVGS
+    pGraphics->PrefetchSVGs({IGRAPHICS_PREFETCH_SVGS});
+  #endif
+  #ifdef IGRAPHICS_PREFETCH_BITMAPS
+    pGraphics->PrefetchBitmaps({IGRAPHICS_PREFETCH_BITMAPS});
+  #endif
+  }
+
   #if defined OS_WIN
   IGraphics* MakeGraphics(IGEditorDelegate& dlg, int w, int h, int fps = 0, float scale = 1.)
   {
     IGraphicsWin* pGraphics = new IGraphicsWin(dlg, w, h, fps, scale);
     pGraphics->SetWinModuleHandle(gHINSTANCE);
+    PrefetchResources(pGraphics);
     return pGraphics;
   }
   #elif defined OS_MAC
@@ -53,6 +66,7 @@
     IGraphicsMac* pGraphics = new IGraphicsMac(dlg, w, h, fps, scale);
     pGraphics->SetBundleID(BUNDLE_ID);
     pGraphics->SetSharedResourcesSubPath(SHARED_RESOURCES_SUBPATH);
+    PrefetchResources(pGraphics);
     
     return pGraphics;
   }
@@ -61,6 +75,7 @@
   {
     IGraphicsIOS* pGraphics = new IGraphicsIOS(dlg, w, h, fps, scale);
     pGraphics->SetBundleID(BUNDLE_ID);
+    PrefetchResources(pGraphics);
 
     return pGraphics;
   }
@@ -68,6 +83,7 @@
   IGraphics* MakeGraphics(IGEditorDelegate& dlg, int w, int h, int fps = 0, float scale = 1.)
   {
     gGraphics = new IGraphicsWeb(dlg, w, h, fps, scale);
+    PrefetchResources(gGraphics);
     return gGraphics;
   }
   #else
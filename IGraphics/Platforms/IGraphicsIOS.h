@@ -78,6 +78,7 @@ protected:
   
   IPopupMenu* CreatePlatformPopupMenu(IPopupMenu& menu, const IRECT& bounds, bool& isAsync) override;
   void CreatePlatformTextEntry(int paramIdx, const IText& text, const IRECT& bounds, int length, const char* str) override;
+  void OnTargetFPSChanged(int fps) override;
 
 private:
   void* mView = nullptr;
@@ -104,7 +104,7 @@ void* IGraphicsIOS::OpenWindow(void* pParent)
   
   SetScreenScale([UIScreen mainScreen].scale);
   
-  GetDelegate()->LayoutUI(this);
+  DoLayoutUI();
   GetDelegate()->OnUIOpen();
   
   [view setMultipleTouchEnabled:MultiTouchEnabled()];
@@ -228,6 +228,13 @@ void IGraphicsIOS::CreatePlatformTextEntry(int paramIdx, const IText& text, cons
   [(IGRAPHICS_VIEW*) mView createTextEntry: paramIdx : text: str: length: areaRect];
 }
 
+void IGraphicsIOS::OnTargetFPSChanged(int fps)
+{
+  // 0 lets a ProMotion display run at its highest rate
+  if (mView)
+    [(IGRAPHICS_VIEW*) mView setDisplayLinkFPS:fps];
+}
+
 bool IGraphicsIOS::OpenURL(const char* url, const char* msgWindowTitle, const char* confirmMsg, const char* errMsgOnFailure)
 {
   NSURL* pNSURL = nullptr;
@@ -71,6 +71,7 @@ using namespace igraphics;
   int mTextFieldLength;
   IColorPickerHandlerFunc mColorPickerHandlerFunc;
   float mPrevX, mPrevY;
+  bool mInBackground;
 }
 - (id) initWithIGraphics: (IGraphicsIOS*) pGraphics;
 - (BOOL) isOpaque;
@@ -102,6 +103,10 @@ using namespace igraphics;
 
 - (void) traitCollectionDidChange: (UITraitCollection*) previousTraitCollection;
 
+//display link
+- (void) setDisplayLinkFPS: (int) fps;
+- (void) resumeDisplayLink;
+
 @property (readonly) CAMetalLayer* metalLayer;
 @property (nonatomic, strong) CADisplayLink *displayLink;
 
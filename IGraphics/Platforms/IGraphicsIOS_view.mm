@@ -296,6 +296,7 @@ extern StaticStorage<CoreTextFontDescriptor> sFontDescriptorCache;
 
 - (void) touchesBegan:(NSSet*) touches withEvent:(UIEvent*) event
 {
+  [self resumeDisplayLink];
   [self onTouchEvent:ETouchEvent::Began withTouches:touches withEvent:event];
 }
 
@@ -326,7 +327,7 @@ extern StaticStorage<CoreTextFontDescriptor> sFontDescriptorCache;
   {
     self.displayLink = [CADisplayLink displayLinkWithTarget:self selector:@selector(redraw:)];
     [self.displayLink addToRunLoop:[NSRunLoop mainRunLoop] forMode:NSRunLoopCommonModes];
-    self.displayLink.preferredFramesPerSecond = mGraphics->FPS();
+    [self setDisplayLinkFPS:mGraphics->GetTargetFPS()];
   }
   else
   {
@@ -358,6 +359,40 @@ extern StaticStorage<CoreTextFontDescriptor> sFontDescriptorCache;
 #else
   [self drawRect:CGRect()];
 #endif
+
+#ifdef IGRAPHICS_RENDER_ON_DEMAND
+  // nothing has changed for a while, so stop until a control is dirtied or the view is touched
+  if (mGraphics && mGraphics->IsFrameRateIdle())
+    [self.displayLink setPaused:YES];
+#endif
+}
+
+- (void) setDisplayLinkFPS: (int) fps
+{
+  if (!self.displayLink)
+    return;
+  
+  if (@available(iOS 15.0, *))
+  {
+    // a range lets the system lower the rate to save power, 0 asks for the highest rate of a ProMotion display
+    // (on iPhone that also needs CADisableMinimumFrameDurationOnPhone in the Info.plist)
+    const float maxFPS = static_cast<float>(fps > 0 ? fps : UIScreen.mainScreen.maximumFramesPerSecond);
+    self.displayLink.preferredFrameRateRange = CAFrameRateRangeMake(std::min(maxFPS, 30.f), maxFPS, maxFPS);
+  }
+  else
+  {
+    self.displayLink.preferredFramesPerSecond = fps;
+  }
+  
+  // a change of rate means the UI has gone idle or become active again
+  if (!mGraphics || !mGraphics->IsFrameRateIdle())
+    [self resumeDisplayLink];
+}
+
+- (void) resumeDisplayLink
+{
+  if (!mInBackground)
+    [self.displayLink setPaused:NO];
 }
 
 - (BOOL) isOpaque
@@ -801,6 +836,8 @@ extern StaticStorage<CoreTextFontDescriptor> sFontDescriptorCache;
 
 -(BOOL) gestureRecognizer:(UIGestureRecognizer*) gestureRecognizer shouldReceiveTouch:(UITouch*) touch
 {
+  [self resumeDisplayLink];
+  
   CGPoint pos = [touch locationInView:touch.view];
   
   auto ds = mGraphics->GetDrawScale();
@@ -837,11 +874,13 @@ extern StaticStorage<CoreTextFontDescriptor> sFontDescriptorCache;
 
 - (void) applicationDidEnterBackgroundNotification:(NSNotification*) notification
 {
+  mInBackground = true;
   [self.displayLink setPaused:YES];
 }
 
 - (void) applicationWillEnterForegroundNotification:(NSNotification*) notification
 {
+  mInBackground = false;
   [self.displayLink setPaused:NO];
 }
 
@@ -8,4 +8,7 @@
  ==============================================================================
 */
 
-/\todo
+/** \todo Implement IGraphicsLinux.
+ * When the XCB window is written, CPU backends (Skia raster, LICE) should present with MIT-SHM images (xcb_shm_put_image) where the server supports it,
+ * falling back to xcb_put_image, and should only copy the dirty rects that IGraphics::IsDirty() reports rather than the whole frame.
+ * GL backends should create their context with EGL, so that GLES works on embedded boards without GLX */
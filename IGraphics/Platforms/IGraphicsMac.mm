@@ -99,7 +99,7 @@ void* IGraphicsMac::OpenWindow(void* pParent)
     
   OnViewInitialized([pView layer]);
   SetScreenScale([[NSScreen mainScreen] backingScaleFactor]);
-  GetDelegate()->LayoutUI(this);
+  DoLayoutUI();
   UpdateTooltips();
   GetDelegate()->OnUIOpen();
   
@@ -549,6 +549,12 @@ void IGraphicsMac::CreatePlatformTextEntry(int paramIdx, const IText& text, cons
   }
 }
 
+void IGraphicsMac::OnTargetFPSChanged(int fps)
+{
+  if (mView)
+    [(IGRAPHICS_VIEW*) mView updateTimerFPS];
+}
+
 ECursor IGraphicsMac::SetMouseCursor(ECursor cursorType)
 {
   if (mView)
@@ -115,8 +115,6 @@ using namespace igraphics;
 
 @interface IGRAPHICS_VIEW : VIEW_BASE <NSTextFieldDelegate/*, WKScriptMessageHandler*/>
 {
-  CVDisplayLinkRef mDisplayLink;
-  dispatch_source_t mDisplaySource;
   NSTimer* mTimer;
   
   NSTrackingArea* mTrackingArea;
@@ -133,11 +131,16 @@ using namespace igraphics;
 - (BOOL) isOpaque;
 - (BOOL) acceptsFirstResponder;
 - (BOOL) acceptsFirstMouse: (NSEvent*) pEvent;
+- (void) viewWillMoveToWindow: (NSWindow*) pNewWindow;
 - (void) viewDidMoveToWindow;
+- (void) viewDidUnhide;
+- (void) windowDidChangeScreen: (NSNotification*) pNotification;
+- (void) windowDidChangeOcclusionState: (NSNotification*) pNotification;
 - (void) viewDidChangeBackingProperties: (NSNotification*) pNotification;
 - (void) drawRect: (NSRect) bounds;
 - (void) render;
 - (void) killTimer;
+- (void) updateTimerFPS;
 - (void) onTimer: (NSTimer*) pTimer;
 - (void) viewDidChangeEffectiveAppearance;
 //mouse
@@ -14,6 +14,9 @@
 #import <Metal/Metal.h>
 #endif
 
+#include <algorithm>
+#include <vector>
+
 #include "wdlutf8.h"
 
 #import "IGraphicsMac_view.h"
@@ -295,6 +298,18 @@ static int MacKeyEventToVK(NSEvent* pEvent, int& flag)
 
 @implementation IGRAPHICS_FORMATTER
 
+- (void) updateTimerFPS
+{
+#ifndef IGRAPHICS_CVDISPLAYLINK
+  // the display link runs at the refresh rate, and IGraphics::IsDirty() skips ticks, but a timer can be slowed down
+  if (mTimer)
+  {
+    [self killTimer];
+    [self setTimer];
+  }
+#endif
+}
+
 - (void) dealloc
 {
   [filterCharacterSet release];
@@ -407,6 +422,9 @@ extern StaticStorage<CoreTextFontDescriptor> sFontDescriptorCache;
     NSOpenGLPFAAccelerated,
     NSOpenGLPFANoRecovery,
     NSOpenGLPFADoubleBuffer,
+  #ifdef IGRAPHICS_PRESERVE_BACKBUFFER
+    NSOpenGLPFABackingStore, // keep the back buffer after swapping, see IGraphicsNanoVG::EndFrame()
+  #endif
     NSOpenGLPFAAlphaSize, 8,
     NSOpenGLPFAColorSize, 24,
     NSOpenGLPFADepthSize, 0,
@@ -448,6 +466,7 @@ extern StaticStorage<CoreTextFontDescriptor> sFontDescriptorCache;
 }
 #endif
 
+#ifdef IGRAPHICS_CVDISPLAYLINK
 static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink, const CVTimeStamp* now, const CVTimeStamp* outputTime, CVOptionFlags flagsIn, CVOptionFlags* flagsOut, void* displayLinkContext)
 {
   dispatch_source_t source = (dispatch_source_t) displayLinkContext;
@@ -456,6 +475,197 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink, const CVTimeSt
   return kCVReturnSuccess;
 }
 
+/** One CVDisplayLink for each display, shared by all the views in the process that are on it, rather than one per view.
+ * Ticks are merged into a dispatch source on the main queue, which renders the views that are visible, and the link is stopped while none are,
+ * e.g. when their windows are occluded or minimized. All methods are called on the main thread */
+class SharedDisplayLink
+{
+public:
+  /** Render the view on the ticks of the link for a display, moving it from the one it was on */
+  static void AddView(IGRAPHICS_VIEW* pView, CGDirectDisplayID displayID)
+  {
+    RemoveView(pView);
+    
+    SharedDisplayLink* pLink = Find(displayID);
+    
+    if (!pLink)
+    {
+      pLink = new SharedDisplayLink(displayID);
+      Links().push_back(pLink);
+    }
+    
+    pLink->mViews.push_back(pView);
+    pLink->UpdateRunning();
+  }
+  
+  /** Stop rendering the view, and release the link if it was the last view on it */
+  static void RemoveView(IGRAPHICS_VIEW* pView)
+  {
+    auto& links = Links();
+    
+    for (auto it = links.begin(); it != links.end(); ++it)
+    {
+      auto& views = (*it)->mViews;
+      auto viewIt = std::find(views.begin(), views.end(), pView);
+      
+      if (viewIt != views.end())
+      {
+        views.erase(viewIt);
+        
+        if (views.empty())
+        {
+          delete *it;
+          links.erase(it);
+        }
+        
+        return;
+      }
+    }
+  }
+  
+  /** Move the view to the link for a display, if it is on one */
+  static void MoveView(IGRAPHICS_VIEW* pView, CGDirectDisplayID displayID)
+  {
+    SharedDisplayLink* pLink = FindView(pView);
+    
+    if (pLink && pLink->mDisplayID != displayID)
+      AddView(pView, displayID);
+  }
+  
+  /** Restart links that have visible views again, call this when visibility may have changed */
+  static void UpdateAll()
+  {
+    for (auto pLink : Links())
+      pLink->UpdateRunning();
+  }
+  
+  static bool ViewIsVisible(IGRAPHICS_VIEW* pView)
+  {
+    NSWindow* pWindow = [pView window];
+    return pWindow && ([pWindow occlusionState] & NSWindowOcclusionStateVisible) && ![pView isHiddenOrHasHiddenAncestor];
+  }
+
+private:
+  SharedDisplayLink(CGDirectDisplayID displayID)
+  : mDisplayID(displayID)
+  {
+    mSource = dispatch_source_create(DISPATCH_SOURCE_TYPE_DATA_ADD, 0, 0, dispatch_get_main_queue());
+    dispatch_source_set_event_handler(mSource, ^(){
+      Tick();
+    });
+    dispatch_resume(mSource);
+    
+    CVReturn cvReturn = CVDisplayLinkCreateWithCGDisplay(displayID, &mDisplayLink);
+    
+    if (cvReturn != kCVReturnSuccess)
+      cvReturn = CVDisplayLinkCreateWithActiveCGDisplays(&mDisplayLink);
+    
+    assert(cvReturn == kCVReturnSuccess);
+    
+    cvReturn = CVDisplayLinkSetOutputCallback(mDisplayLink, &displayLinkCallback, (void*) mSource);
+    assert(cvReturn == kCVReturnSuccess);
+  }
+  
+  ~SharedDisplayLink()
+  {
+    CVDisplayLinkStop(mDisplayLink);
+    CVDisplayLinkRelease(mDisplayLink);
+    dispatch_source_cancel(mSource);
+    dispatch_release(mSource);
+  }
+  
+  SharedDisplayLink(const SharedDisplayLink&) = delete;
+  SharedDisplayLink& operator=(const SharedDisplayLink&) = delete;
+  
+  static std::vector<SharedDisplayLink*>& Links()
+  {
+    static std::vector<SharedDisplayLink*> sLinks;
+    return sLinks;
+  }
+  
+  static SharedDisplayLink* Find(CGDirectDisplayID displayID)
+  {
+    for (auto pLink : Links())
+    {
+      if (pLink->mDisplayID == displayID)
+        return pLink;
+    }
+    
+    return nullptr;
+  }
+  
+  static SharedDisplayLink* FindView(IGRAPHICS_VIEW* pView)
+  {
+    for (auto pLink : Links())
+    {
+      if (std::find(pLink->mViews.begin(), pLink->mViews.end(), pView) != pLink->mViews.end())
+        return pLink;
+    }
+    
+    return nullptr;
+  }
+  
+  bool AnyViewVisible() const
+  {
+    return std::any_of(mViews.begin(), mViews.end(), [](IGRAPHICS_VIEW* pView) { return ViewIsVisible(pView); });
+  }
+  
+  void UpdateRunning()
+  {
+    const bool run = AnyViewVisible();
+    
+    if (run && !CVDisplayLinkIsRunning(mDisplayLink))
+      CVDisplayLinkStart(mDisplayLink);
+    else if (!run && CVDisplayLinkIsRunning(mDisplayLink))
+      CVDisplayLinkStop(mDisplayLink);
+  }
+  
+  void Tick()
+  {
+    // rendering can close a view, which can delete this link, so work on a copy and check the views are still here
+    const std::vector<IGRAPHICS_VIEW*> views = mViews;
+    const CGDirectDisplayID displayID = mDisplayID;
+    bool anyVisible = false;
+    
+    for (auto pView : views)
+    {
+      SharedDisplayLink* pLink = Find(displayID);
+      
+      if (!pLink || std::find(pLink->mViews.begin(), pLink->mViews.end(), pView) == pLink->mViews.end())
+        continue;
+      
+      if (ViewIsVisible(pView))
+      {
+        anyVisible = true;
+        [pView render];
+      }
+    }
+    
+    if (!anyVisible)
+    {
+      if (SharedDisplayLink* pLink = Find(displayID))
+        pLink->UpdateRunning();
+    }
+  }
+  
+  CGDirectDisplayID mDisplayID;
+  CVDisplayLinkRef mDisplayLink = nullptr;
+  dispatch_source_t mSource = nullptr;
+  std::vector<IGRAPHICS_VIEW*> mViews;
+};
+
+/** @return The display the view's window is on, or the main display if it isn't in one yet */
+static CGDirectDisplayID DisplayForView(IGRAPHICS_VIEW* pView)
+{
+  NSScreen* pScreen = [[pView window] screen];
+  
+  if (!pScreen)
+    return CGMainDisplayID();
+  
+  return (CGDirectDisplayID) [pScreen.deviceDescription[@"NSScreenNumber"] unsignedIntegerValue];
+}
+#endif
+
 - (void) onTimer: (NSTimer*) pTimer
 {
   [self render];
@@ -464,37 +674,20 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink, const CVTimeSt
 - (void) setTimer
 {
 #ifdef IGRAPHICS_CVDISPLAYLINK
-  mDisplaySource = dispatch_source_create(DISPATCH_SOURCE_TYPE_DATA_ADD, 0, 0, dispatch_get_main_queue());
-  dispatch_source_set_event_handler(mDisplaySource, ^(){
-    [self render];
-  });
-  dispatch_resume(mDisplaySource);
-
-  CVReturn cvReturn;
-
-  cvReturn = CVDisplayLinkCreateWithActiveCGDisplays(&mDisplayLink);
-  
-  assert(cvReturn == kCVReturnSuccess);
-
-  cvReturn = CVDisplayLinkSetOutputCallback(mDisplayLink, &displayLinkCallback, (void*) mDisplaySource);
-  assert(cvReturn == kCVReturnSuccess);
+  SharedDisplayLink::AddView(self, DisplayForView(self));
+#else
+  int fps = mGraphics->GetTargetFPS();
 
-  #ifdef IGRAPHICS_GL
-  CGLContextObj cglContext = [[self openGLContext] CGLContextObj];
-  CGLPixelFormatObj cglPixelFormat = [[self pixelFormat] CGLPixelFormatObj];
-  CVDisplayLinkSetCurrentCGDisplayFromOpenGLContext(mDisplayLink, cglContext, cglPixelFormat);
-  #endif
-  
-  CGDirectDisplayID viewDisplayID =
-      (CGDirectDisplayID) [self.window.screen.deviceDescription[@"NSScreenNumber"] unsignedIntegerValue];;
+  if (fps <= 0)
+  {
+    if (@available(macOS 12.0, *))
+      fps = static_cast<int>(self.window.screen.maximumFramesPerSecond);
 
-  cvReturn = CVDisplayLinkSetCurrentCGDisplay(mDisplayLink, viewDisplayID);
+    if (fps <= 0)
+      fps = mGraphics->FPS();
+  }
 
-  assert(cvReturn == kCVReturnSuccess);
-  
-  CVDisplayLinkStart(mDisplayLink);
-#else
-  double sec = 1.0 / (double) mGraphics->FPS();
+  double sec = 1.0 / (double) fps;
   mTimer = [NSTimer timerWithTimeInterval:sec target:self selector:@selector(onTimer:) userInfo:nil repeats:YES];
   [[NSRunLoop currentRunLoop] addTimer: mTimer forMode: (NSString*) kCFRunLoopCommonModes];
 #endif
@@ -503,10 +696,7 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink, const CVTimeSt
 - (void) killTimer
 {
 #ifdef IGRAPHICS_CVDISPLAYLINK
-  CVDisplayLinkStop(mDisplayLink);
-  dispatch_source_cancel(mDisplaySource);
-  CVDisplayLinkRelease(mDisplayLink);
-  mDisplayLink = nil;
+  SharedDisplayLink::RemoveView(self);
 #else
   [mTimer invalidate];
   mTimer = nullptr;
@@ -554,6 +744,19 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink, const CVTimeSt
   return YES;
 }
 
+- (void) viewWillMoveToWindow: (NSWindow*) pNewWindow
+{
+  NSWindow* pWindow = [self window];
+  
+  if (pWindow)
+  {
+    [[NSNotificationCenter defaultCenter] removeObserver:self name:NSWindowDidChangeScreenNotification object:pWindow];
+    [[NSNotificationCenter defaultCenter] removeObserver:self name:NSWindowDidChangeOcclusionStateNotification object:pWindow];
+  }
+  
+  [super viewWillMoveToWindow:pNewWindow];
+}
+
 - (void) viewDidMoveToWindow
 {
   NSWindow* pWindow = [self window];
@@ -563,6 +766,21 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink, const CVTimeSt
     [pWindow makeFirstResponder: self];
     [pWindow setAcceptsMouseMovedEvents: YES];
     
+    [[NSNotificationCenter defaultCenter] addObserver:self
+                                             selector:@selector(windowDidChangeScreen:)
+                                                 name:NSWindowDidChangeScreenNotification
+                                               object:pWindow];
+    
+    [[NSNotificationCenter defaultCenter] addObserver:self
+                                             selector:@selector(windowDidChangeOcclusionState:)
+                                                 name:NSWindowDidChangeOcclusionStateNotification
+                                               object:pWindow];
+    
+#ifdef IGRAPHICS_CVDISPLAYLINK
+    SharedDisplayLink::MoveView(self, DisplayForView(self));
+    SharedDisplayLink::UpdateAll();
+#endif
+    
     CGFloat newScale = [pWindow backingScaleFactor];
 
     if (mGraphics)
@@ -589,6 +807,28 @@ static CVReturn displayLinkCallback(CVDisplayLinkRef displayLink, const CVTimeSt
   }
 }
 
+- (void) viewDidUnhide
+{
+  [super viewDidUnhide];
+#ifdef IGRAPHICS_CVDISPLAYLINK
+  SharedDisplayLink::UpdateAll();
+#endif
+}
+
+- (void) windowDidChangeScreen: (NSNotification*) pNotification
+{
+#ifdef IGRAPHICS_CVDISPLAYLINK
+  SharedDisplayLink::MoveView(self, DisplayForView(self));
+#endif
+}
+
+- (void) windowDidChangeOcclusionState: (NSNotification*) pNotification
+{
+#ifdef IGRAPHICS_CVDISPLAYLINK
+  SharedDisplayLink::UpdateAll();
+#endif
+}
+
 - (void) viewDidChangeBackingProperties:(NSNotification*) pNotification
 {
   NSWindow* pWindow = [self window];
@@ -599,6 +599,47 @@ EMSCRIPTEN_BINDINGS(events) {
   function("file_dialog_callback", file_dialog_callback);
 }
 
+// Fetches an image listed in Module.lazyImages and draws it into the placeholder canvas that stands in for it, keeping the response with the Cache API for repeat visits
+EM_JS(void, IPlugInstallLazyImageLoader, (), {
+  Module.lazyImagesLoaded = Module.lazyImagesLoaded || 0;
+  Module.IPlugFetchLazyImage = function(path, canvas) {
+    var url = (Module.lazyImagesURL || '.') + path;
+    var request = function() {
+      if (typeof caches === 'undefined')
+        return fetch(url);
+      
+      return caches.open(Module.lazyImagesCacheName || 'iplug-resources').then(function(cache) {
+        return cache.match(url).then(function(cached) {
+          if (cached)
+            return cached;
+          
+          return fetch(url).then(function(response) {
+            if (response.ok)
+              cache.put(url, response.clone());
+            return response;
+          });
+        });
+      });
+    };
+    
+    request().then(function(response) {
+      if (!response.ok)
+        throw new Error(response.status);
+      return response.blob();
+    }).then(function(blob) {
+      return createImageBitmap(blob);
+    }).then(function(image) {
+      var ctx = canvas.getContext('2d');
+      ctx.clearRect(0, 0, canvas.width, canvas.height);
+      ctx.drawImage(image, 0, 0, canvas.width, canvas.height);
+      Module.preloadedImages[path] = canvas;
+      Module.lazyImagesLoaded++;
+    }).catch(function(e) {
+      console.error('Failed to fetch ' + url + ': ' + e);
+    });
+  };
+});
+
 #pragma mark -
 
 IGraphicsWeb::IGraphicsWeb(IGEditorDelegate& dlg, int w, int h, int fps, float scale)
@@ -608,6 +649,9 @@ IGraphicsWeb::IGraphicsWeb(IGEditorDelegate& dlg, int w, int h, int fps, float s
   
   DBGMSG("Preloaded %i images\n", keys["length"].as<int>());
   
+  if (!GetLazyImages().isUndefined())
+    IPlugInstallLazyImageLoader();
+  
   emscripten_set_mousedown_callback("#canvas", this, 1, mouse_callback);
   emscripten_set_mouseup_callback("#canvas", this, 1, mouse_callback);
   emscripten_set_mousemove_callback("#canvas", this, 1, mouse_callback);
@@ -644,7 +688,7 @@ void* IGraphicsWeb::OpenWindow(void* pHandle)
 
   SetScreenScale(std::ceil(std::max(emscripten_get_device_pixel_ratio(), 1.)));
 
-  GetDelegate()->LayoutUI(this);
+  DoLayoutUI();
   GetDelegate()->OnUIOpen();
   
   return nullptr;
@@ -728,6 +772,16 @@ void IGraphicsWeb::OnMainLoopTimer()
     gGraphics->SetScreenScale(screenScale);
   }
 
+  // redraw when on demand images arrive, as they will have been drawn as placeholders
+  static int sLazyImagesLoaded = 0;
+  val lazyImagesLoaded = val::global("Module")["lazyImagesLoaded"];
+  
+  if (!lazyImagesLoaded.isUndefined() && lazyImagesLoaded.as<int>() != sLazyImagesLoaded)
+  {
+    sLazyImagesLoaded = lazyImagesLoaded.as<int>();
+    gGraphics->SetAllControlsDirty();
+  }
+
   if (gGraphics->IsDirty(rects))
   {
     gGraphics->SetAllControlsClean();
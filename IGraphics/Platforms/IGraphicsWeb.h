@@ -36,6 +36,12 @@ static val GetPreloadedImages()
   return val::global("Module")["preloadedImages"];
 }
 
+/** @return The images listed by Scripts/make_lazy_images.py, which are fetched on demand, or undefined */
+static val GetLazyImages()
+{
+  return val::global("Module")["lazyImages"];
+}
+
 extern void GetScreenDimensions(int& width, int& height);
 
 /** IGraphics platform class for the web
@@ -33,6 +33,12 @@ static int nWndClassReg = 0;
 static const char* wndClassName = "IPlugWndClass";
 static double sFPS = 0.0;
 
+#if defined IGRAPHICS_GL && defined IGRAPHICS_SHARED_TEXTURES
+// The GL contexts of every open instance, which are all put in one share group so that textures can be shared between them
+static WDL_PtrList<HGLRC__> sGLContexts;
+static WDL_Mutex sGLContextsMutex;
+#endif
+
 #define PARAM_EDIT_ID 99
 #define IPLUG_TIMER_ID 2
 
@@ -40,6 +46,254 @@ static double sFPS = 0.0;
 
 #define WM_VBLANK (WM_USER+1)
 
+// Nasty kernel level definitions for wait for vblank.  Including the
+// proper include file requires "d3dkmthk.h" from the driver development
+// kit.  Instead we define the minimum needed to call the three methods we need.
+// and use LoadLibrary/GetProcAddress to accomplish the same thing.
+// See https://docs.microsoft.com/en-us/windows-hardware/drivers/ddi/d3dkmthk/
+//
+// Heres another link (rant) with a lot of good information about vsync on firefox
+// https://www.vsynctester.com/firefoxisbroken.html
+// https://bugs.chromium.org/p/chromium/issues/detail?id=467617
+
+// structs to use
+typedef UINT32 D3DKMT_HANDLE;
+typedef UINT D3DDDI_VIDEO_PRESENT_SOURCE_ID;
+typedef struct _D3DKMT_OPENADAPTERFROMHDC {
+  HDC                            hDc;
+  D3DKMT_HANDLE                  hAdapter;
+  LUID                           AdapterLuid;
+  D3DDDI_VIDEO_PRESENT_SOURCE_ID VidPnSourceId;
+} D3DKMT_OPENADAPTERFROMHDC;
+typedef struct _D3DKMT_CLOSEADAPTER {
+  D3DKMT_HANDLE hAdapter;
+} D3DKMT_CLOSEADAPTER;
+typedef struct _D3DKMT_WAITFORVERTICALBLANKEVENT {
+  D3DKMT_HANDLE                  hAdapter;
+  D3DKMT_HANDLE                  hDevice;
+  D3DDDI_VIDEO_PRESENT_SOURCE_ID VidPnSourceId;
+} D3DKMT_WAITFORVERTICALBLANKEVENT;
+
+// entry points
+typedef NTSTATUS(WINAPI* D3DKMTOpenAdapterFromHdc)(D3DKMT_OPENADAPTERFROMHDC* Arg1);
+typedef NTSTATUS(WINAPI* D3DKMTCloseAdapter)(const D3DKMT_CLOSEADAPTER* Arg1);
+typedef NTSTATUS(WINAPI* D3DKMTWaitForVerticalBlankEvent)(const D3DKMT_WAITFORVERTICALBLANKEVENT* Arg1);
+typedef HRESULT(WINAPI* DwmFlushFunc)();
+
+/** One thread for the whole process that waits for the vertical blank and posts WM_VBLANK to every registered IGraphicsWin window,
+ * so that open editors repaint together, rather than each with its own thread or timer. It is started with the first window and stopped with the last */
+class VBlankThread
+{
+public:
+  static VBlankThread& Get()
+  {
+    static VBlankThread sInstance;
+    return sInstance;
+  }
+
+  void AddWindow(HWND hWnd)
+  {
+    WDL_MutexLock threadLock(&mThreadMutex);
+
+    {
+      WDL_MutexLock lock(&mMutex);
+      mWindows.Add(hWnd);
+    }
+
+    if (mThread == INVALID_HANDLE_VALUE)
+    {
+      mShutdown = false;
+      DWORD threadId = 0;
+      mThread = ::CreateThread(NULL, 0, ThreadProc, this, 0, &threadId);
+    }
+  }
+
+  void RemoveWindow(HWND hWnd)
+  {
+    WDL_MutexLock threadLock(&mThreadMutex);
+    bool last = false;
+
+    {
+      WDL_MutexLock lock(&mMutex);
+      mWindows.DeletePtr(hWnd);
+      last = !mWindows.GetSize();
+    }
+
+    if (last && mThread != INVALID_HANDLE_VALUE)
+    {
+      mShutdown = true;
+      ::WaitForSingleObject(mThread, 10000);
+      ::CloseHandle(mThread);
+      mThread = INVALID_HANDLE_VALUE;
+    }
+  }
+
+  /** @return The running count of vblank events, which is sent with each WM_VBLANK so that late messages can be skipped */
+  DWORD GetCount() const { return mCount; }
+
+private:
+  static DWORD WINAPI ThreadProc(LPVOID lpParam)
+  {
+    return static_cast<VBlankThread*>(lpParam)->Run();
+  }
+
+  void Notify()
+  {
+    WDL_MutexLock lock(&mMutex);
+    mCount++;
+
+    for (auto i = 0; i < mWindows.GetSize(); i++)
+      ::PostMessage(mWindows.Get(i), WM_VBLANK, mCount, 0);
+  }
+
+  /** @return The first registered window, whose DC is used to find the adapter to wait on */
+  HWND GetAnyWindow()
+  {
+    WDL_MutexLock lock(&mMutex);
+    return mWindows.Get(0);
+  }
+
+  DWORD Run()
+  {
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
+
+    // TODO: get expected vsync value.  For now we will use a fallback
+    // of 60Hz
+    float rateFallback = 60.0f;
+    int rateMS = (int)(1000.0f / rateFallback);
+
+    // We need to try to load the module and entry points to wait on v blank.
+    // if anything fails, we try DwmFlush(), which returns after the compositor's next frame,
+    // and failing that to sleeping for some number of milliseconds.
+    //
+    // TODO: handle low power modes
+
+    D3DKMTOpenAdapterFromHdc pOpen = nullptr;
+    D3DKMTCloseAdapter pClose = nullptr;
+    D3DKMTWaitForVerticalBlankEvent pWait = nullptr;
+    DwmFlushFunc pDwmFlush = nullptr;
+    HINSTANCE hInst = LoadLibrary("gdi32.dll");
+    HINSTANCE hDwmInst = nullptr;
+    if (hInst != nullptr)
+    {
+      pOpen  = (D3DKMTOpenAdapterFromHdc)GetProcAddress((HMODULE)hInst, "D3DKMTOpenAdapterFromHdc");
+      pClose = (D3DKMTCloseAdapter)GetProcAddress((HMODULE)hInst, "D3DKMTCloseAdapter");
+      pWait  = (D3DKMTWaitForVerticalBlankEvent)GetProcAddress((HMODULE)hInst, "D3DKMTWaitForVerticalBlankEvent");
+    }
+
+    if (!pOpen || !pClose || !pWait)
+    {
+      hDwmInst = LoadLibrary("dwmapi.dll");
+
+      if (hDwmInst != nullptr)
+        pDwmFlush = (DwmFlushFunc)GetProcAddress((HMODULE)hDwmInst, "DwmFlush");
+    }
+
+    if (!pOpen || !pClose || !pWait)
+    {
+      // composition may be off, in which case DwmFlush() fails at once and we sleep instead.
+      // This is really just a last resort and not expected on modern hardware and Windows OS installs.
+      while (mShutdown == false)
+      {
+        if (!pDwmFlush || FAILED((*pDwmFlush)()))
+          Sleep(rateMS);
+
+        Notify();
+      }
+    }
+    else
+    {
+      // we have a good set of functions to call.  We need to keep
+      // track of the adapter and reask for it if the device is lost.
+      bool adapterIsOpen = false;
+      DWORD adapterLastFailTime = 0;
+      _D3DKMT_WAITFORVERTICALBLANKEVENT we = { 0 };
+
+      while (mShutdown == false)
+      {
+        if (!adapterIsOpen)
+        {
+          // reacquire the adapter (at most once a second).
+          if (adapterLastFailTime < ::GetTickCount() - 1000)
+          {
+            // try to get adapter
+            D3DKMT_OPENADAPTERFROMHDC openAdapterData = { 0 };
+            HWND hWnd = GetAnyWindow();
+            HDC hDC = GetDC(hWnd);
+            openAdapterData.hDc = hDC;
+            NTSTATUS status = hDC ? (*pOpen)(&openAdapterData) : E_FAIL;
+            if (status == S_OK)
+            {
+              // success, setup wait request parameters.
+              adapterLastFailTime = 0;
+              adapterIsOpen = true;
+              we.hAdapter = openAdapterData.hAdapter;
+              we.hDevice = 0;
+              we.VidPnSourceId = openAdapterData.VidPnSourceId;
+            }
+            else
+            {
+              // failed
+              adapterLastFailTime = ::GetTickCount();
+            }
+
+            if (hDC)
+              ReleaseDC(hWnd, hDC);
+          }
+        }
+
+        if (adapterIsOpen)
+        {
+          // Finally we can wait on VBlank
+          NTSTATUS status = (*pWait)(&we);
+          if (status != S_OK)
+          {
+            // failed, close now and try again on the next pass.
+            _D3DKMT_CLOSEADAPTER ca;
+            ca.hAdapter = we.hAdapter;
+            (*pClose)(&ca);
+            adapterIsOpen = false;
+          }
+        }
+
+        // Temporary fallback for lost adapter or failed call.
+        if (!adapterIsOpen)
+        {
+          ::Sleep(rateMS);
+        }
+
+        // notify logic
+        Notify();
+      }
+
+      // cleanup adapter before leaving
+      if (adapterIsOpen)
+      {
+        _D3DKMT_CLOSEADAPTER ca;
+        ca.hAdapter = we.hAdapter;
+        (*pClose)(&ca);
+        adapterIsOpen = false;
+      }
+    }
+
+    // release module resources
+    if (hInst != nullptr)
+      FreeLibrary((HMODULE)hInst);
+
+    if (hDwmInst != nullptr)
+      FreeLibrary((HMODULE)hDwmInst);
+
+    return 0;
+  }
+
+  WDL_Mutex mThreadMutex; // serializes starting and stopping the thread, which never takes it
+  WDL_Mutex mMutex; // protects mWindows
+  WDL_PtrList<HWND__> mWindows;
+  HANDLE mThread = INVALID_HANDLE_VALUE;
+  volatile bool mShutdown = false;
+  volatile DWORD mCount = 0; // running count of vblank events since the thread started
+};
+
 #ifdef IGRAPHICS_GL3
 typedef HGLRC(WINAPI* PFNWGLCREATECONTEXTATTRIBSARBPROC) (HDC hDC, HGLRC hShareContext, const int* attribList);
 #define WGL_CONTEXT_MAJOR_VERSION_ARB     0x2091
@@ -48,6 +302,14 @@ typedef HGLRC(WINAPI* PFNWGLCREATECONTEXTATTRIBSARBPROC) (HDC hDC, HGLRC hShareC
 #define WGL_CONTEXT_CORE_PROFILE_BIT_ARB  0x00000001
 #endif
 
+// its best to get below 16ms because the windows time quanta is slightly above 15ms.
+static UINT GetTimerInterval(int fps, int defaultFPS)
+{
+  int mSec = static_cast<int>(std::floorf(1000.0f / (fps > 0 ? fps : defaultFPS)));
+  if (mSec < 20) mSec = 15;
+  return static_cast<UINT>(mSec);
+}
+
 #pragma mark - Private Classes and Structs
 
 // Fonts
@@ -197,12 +459,12 @@ void IGraphicsWin::OnDisplayTimer(int vBlankCount)
 {
   // Check the message vblank with the current one to see if we are way behind. If so, then throw these away.
   DWORD msgCount = vBlankCount;
-  DWORD curCount = mVBlankCount;
+  DWORD curCount = VBlankThread::Get().GetCount();
 
   if(mVSYNCEnabled)
   {
     // skip until the actual vblank is at a certain number.
-    if (mVBlankSkipUntil != 0 && mVBlankSkipUntil > mVBlankCount)
+    if (mVBlankSkipUntil != 0 && mVBlankSkipUntil > curCount)
     {
       return;
     }
@@ -250,6 +512,25 @@ void IGraphicsWin::OnDisplayTimer(int vBlankCount)
       SetScreenScale(scale);
   }
 
+#ifdef IGRAPHICS_GL
+  if (mRenderThread && !mParamEditWnd)
+  {
+    // leave the controls dirty until the render thread has caught up, rather than queuing frames
+    if (mRenderThread->IsBusy())
+      return;
+
+    IRECTList rects;
+
+    if (IsDirty(rects))
+    {
+      SetAllControlsClean();
+      mRenderThread->Submit(rects);
+    }
+
+    return;
+  }
+#endif
+
   // TODO: this is far too aggressive for slow drawing animations and data changing.  We need to
   // gate the rate of updates to a certain percentage of the wall clock time.
   IRECTList rects;
@@ -285,7 +566,7 @@ void IGraphicsWin::OnDisplayTimer(int vBlankCount)
       if(mVSYNCEnabled)
       {
         // Check and see if we are still in this frame.
-        curCount = mVBlankCount;
+        curCount = VBlankThread::Get().GetCount();
         if (msgCount != curCount)
         {
           // we are late, skip the next vblank to give us a breather.
@@ -307,16 +588,15 @@ LRESULT CALLBACK IGraphicsWin::WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARA
     SetWindowLongPtr(hWnd, GWLP_USERDATA, (LPARAM)(lpcs->lpCreateParams));
     IGraphicsWin* pGraphics = (IGraphicsWin*)GetWindowLongPtr(hWnd, GWLP_USERDATA);
 
-    if(pGraphics->mVSYNCEnabled) // use VBLANK thread
+    if(pGraphics->mVSYNCEnabled) // use the VBLANK thread shared by all instances
     {
       assert((pGraphics->FPS() == 60) && "If you want to run at frame rates other than 60FPS");
-      pGraphics->StartVBlankThread(hWnd);
+      VBlankThread::Get().AddWindow(hWnd);
+      pGraphics->mVBlankRegistered = true;
     }
-    else // use WM_TIMER -- its best to get below 16ms because the windows time quanta is slightly above 15ms.
+    else // use WM_TIMER
     {
-      int mSec = static_cast<int>(std::floorf(1000.0f / (pGraphics->FPS())));
-      if (mSec < 20) mSec = 15;
-      SetTimer(hWnd, IPLUG_TIMER_ID, mSec, NULL);
+      SetTimer(hWnd, IPLUG_TIMER_ID, GetTimerInterval(pGraphics->GetTargetFPS(), pGraphics->FPS()), NULL);
     }
 
     SetFocus(hWnd); // gets scroll wheel working straight away
@@ -331,6 +611,9 @@ LRESULT CALLBACK IGraphicsWin::WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARA
     return DefWindowProc(hWnd, msg, wParam, lParam);
   }
 
+  // serialize event handling with drawing, if drawing happens on a render thread
+  auto controlStateLock = pGraphics->LockControlState();
+
   if (pGraphics->mParamEditWnd && pGraphics->mParamEditMsg == kEditing)
   {
     if (msg == WM_RBUTTONDOWN || (msg == WM_LBUTTONDOWN))
@@ -918,6 +1201,7 @@ void IGraphicsWin::PlatformResize(bool parentHasResized)
 #ifdef IGRAPHICS_GL
 void IGraphicsWin::DrawResize()
 {
+  auto controlStateLock = LockControlState();
   ActivateGLContext();
   IGRAPHICS_DRAW_CLASS::DrawResize();
   DeactivateGLContext();
@@ -1024,7 +1308,11 @@ void IGraphicsWin::CreateGLContext()
   {
     sizeof(PIXELFORMATDESCRIPTOR),
     1,
+#ifdef IGRAPHICS_PRESERVE_BACKBUFFER
+    PFD_DRAW_TO_WINDOW | PFD_SUPPORT_OPENGL | PFD_DOUBLEBUFFER | PFD_SWAP_COPY, //Flags, keep the back buffer after swapping, see IGraphicsNanoVG::EndFrame()
+#else
     PFD_DRAW_TO_WINDOW | PFD_SUPPORT_OPENGL | PFD_DOUBLEBUFFER, //Flags
+#endif
     PFD_TYPE_RGBA, // The kind of framebuffer. RGBA or palette.
     32, // Colordepth of the framebuffer.
     0, 0, 0, 0, 0, 0,
@@ -1075,10 +1363,32 @@ void IGraphicsWin::CreateGLContext()
   glGetError();
 
   ReleaseDC(mPlugWnd, dc);
+
+#ifdef IGRAPHICS_SHARED_TEXTURES
+  {
+    WDL_MutexLock lock(&sGLContextsMutex);
+
+    // nothing has been created in the new context yet, so it can join the share group of any other instance's context
+    mGLContextShared = !sGLContexts.GetSize() || wglShareLists(sGLContexts.Get(0), mHGLRC);
+
+    if (mGLContextShared)
+      sGLContexts.Add(mHGLRC);
+    else
+      DBGMSG("Could not share GL context, textures will not be shared with other instances\n");
+  }
+#endif
 }
 
 void IGraphicsWin::DestroyGLContext()
 {
+#ifdef IGRAPHICS_SHARED_TEXTURES
+  {
+    WDL_MutexLock lock(&sGLContextsMutex);
+    sGLContexts.DeletePtr(mHGLRC);
+    mGLContextShared = false;
+  }
+#endif
+
   wglMakeCurrent(NULL, NULL);
   wglDeleteContext(mHGLRC);
 }
@@ -1148,7 +1458,7 @@ void* IGraphicsWin::OpenWindow(void* pParent)
 
   SetScreenScale(screenScale); // resizes draw context
 
-  GetDelegate()->LayoutUI(this);
+  DoLayoutUI();
 
   if (MultiTouchEnabled() && GetSystemMetrics(SM_DIGITIZER) & NID_MULTI_INPUT)
   {
@@ -1191,6 +1501,24 @@ void* IGraphicsWin::OpenWindow(void* pParent)
 #endif
   }
 
+  if (mPlugWnd)
+  {
+#if defined IGRAPHICS_GL
+    StartRenderThread([this](IRECTList& rects) {
+      ActivateGLContext();
+      Draw(rects);
+      SwapBuffers((HDC) GetPlatformContext());
+      DeactivateGLContext();
+    });
+
+    if (RenderThreadRunning())
+      wglMakeCurrent(NULL, NULL); // the context can only be current on one thread
+#elif defined IGRAPHICS_VULKAN
+    // there is no context to make current, so the render thread records and presents the frame with the GrDirectContext
+    StartRenderThread([this](IRECTList& rects) { Draw(rects); });
+#endif
+  }
+
   GetDelegate()->OnUIOpen();
   
   return mPlugWnd;
@@ -1268,11 +1596,16 @@ void IGraphicsWin::CloseWindow()
 {
   if (mPlugWnd)
   {
-    if(mVSYNCEnabled)
-      StopVBlankThread();
+    if(mVBlankRegistered)
+    {
+      VBlankThread::Get().RemoveWindow(mPlugWnd);
+      mVBlankRegistered = false;
+    }
     else
       KillTimer(mPlugWnd, IPLUG_TIMER_ID);
 
+    StopRenderThread();
+
 #ifdef IGRAPHICS_GL
     ActivateGLContext();
 #endif
@@ -1479,6 +1812,13 @@ IPopupMenu* IGraphicsWin::CreatePlatformPopupMenu(IPopupMenu& menu, const IRECT&
   return nullptr;
 }
 
+void IGraphicsWin::OnTargetFPSChanged(int fps)
+{
+  // the VBlank thread ticks at the refresh rate, and IGraphics::IsDirty() skips ticks, but the timer can be slowed down
+  if (mPlugWnd && !mVSYNCEnabled)
+    SetTimer(mPlugWnd, IPLUG_TIMER_ID, GetTimerInterval(fps, FPS()), NULL);
+}
+
 void IGraphicsWin::CreatePlatformTextEntry(int paramIdx, const IText& text, const IRECT& bounds, int length, const char* str)
 {
   if (mParamEditWnd)
@@ -2042,190 +2382,6 @@ void IGraphicsWin::CachePlatformFont(const char* fontID, const PlatformFontPtr&
     hfontStorage.Add(new HFontHolder(hfont), fontID);
 }
 
-DWORD WINAPI VBlankRun(LPVOID lpParam)
-{
-  IGraphicsWin* pGraphics = (IGraphicsWin*)lpParam;
-  return pGraphics->OnVBlankRun();
-}
-
-void IGraphicsWin::StartVBlankThread(HWND hWnd)
-{
-  mVBlankWindow = hWnd;
-  mVBlankShutdown = false;
-  DWORD threadId = 0;
-  mVBlankThread = ::CreateThread(NULL, 0, VBlankRun, this, 0, &threadId);
-}
-
-void IGraphicsWin::StopVBlankThread()
-{
-  if (mVBlankThread != INVALID_HANDLE_VALUE)
-  {
-    mVBlankShutdown = true;
-    ::WaitForSingleObject(mVBlankThread, 10000);
-    mVBlankThread = INVALID_HANDLE_VALUE;
-    mVBlankWindow = 0;
-  }
-}
-
-// Nasty kernel level definitions for wait for vblank.  Including the
-// proper include file requires "d3dkmthk.h" from the driver development
-// kit.  Instead we define the minimum needed to call the three methods we need.
-// and use LoadLibrary/GetProcAddress to accomplish the same thing.
-// See https://docs.microsoft.com/en-us/windows-hardware/drivers/ddi/d3dkmthk/
-//
-// Heres another link (rant) with a lot of good information about vsync on firefox
-// https://www.vsynctester.com/firefoxisbroken.html
-// https://bugs.chromium.org/p/chromium/issues/detail?id=467617
-
-// structs to use
-typedef UINT32 D3DKMT_HANDLE;
-typedef UINT D3DDDI_VIDEO_PRESENT_SOURCE_ID;
-typedef struct _D3DKMT_OPENADAPTERFROMHDC {
-  HDC                            hDc;
-  D3DKMT_HANDLE                  hAdapter;
-  LUID                           AdapterLuid;
-  D3DDDI_VIDEO_PRESENT_SOURCE_ID VidPnSourceId;
-} D3DKMT_OPENADAPTERFROMHDC;
-typedef struct _D3DKMT_CLOSEADAPTER {
-  D3DKMT_HANDLE hAdapter;
-} D3DKMT_CLOSEADAPTER;
-typedef struct _D3DKMT_WAITFORVERTICALBLANKEVENT {
-  D3DKMT_HANDLE                  hAdapter;
-  D3DKMT_HANDLE                  hDevice;
-  D3DDDI_VIDEO_PRESENT_SOURCE_ID VidPnSourceId;
-} D3DKMT_WAITFORVERTICALBLANKEVENT;
-
-// entry points
-typedef NTSTATUS(WINAPI* D3DKMTOpenAdapterFromHdc)(D3DKMT_OPENADAPTERFROMHDC* Arg1);
-typedef NTSTATUS(WINAPI* D3DKMTCloseAdapter)(const D3DKMT_CLOSEADAPTER* Arg1);
-typedef NTSTATUS(WINAPI* D3DKMTWaitForVerticalBlankEvent)(const D3DKMT_WAITFORVERTICALBLANKEVENT* Arg1);
-
-DWORD IGraphicsWin::OnVBlankRun()
-{
-  SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL);
-
-  // TODO: get expected vsync value.  For now we will use a fallback
-  // of 60Hz
-  float rateFallback = 60.0f;
-  int rateMS = (int)(1000.0f / rateFallback);
-
-  // We need to try to load the module and entry points to wait on v blank.
-  // if anything fails, we try to gracefully fallback to sleeping for some
-  // number of milliseconds.
-  //
-  // TODO: handle low power modes
-
-  D3DKMTOpenAdapterFromHdc pOpen = nullptr;
-  D3DKMTCloseAdapter pClose = nullptr;
-  D3DKMTWaitForVerticalBlankEvent pWait = nullptr;
-  HINSTANCE hInst = LoadLibrary("gdi32.dll");
-  if (hInst != nullptr)
-  {
-    pOpen  = (D3DKMTOpenAdapterFromHdc)GetProcAddress((HMODULE)hInst, "D3DKMTOpenAdapterFromHdc");
-    pClose = (D3DKMTCloseAdapter)GetProcAddress((HMODULE)hInst, "D3DKMTCloseAdapter");
-    pWait  = (D3DKMTWaitForVerticalBlankEvent)GetProcAddress((HMODULE)hInst, "D3DKMTWaitForVerticalBlankEvent");
-  }
-
-  // if we don't get bindings to the methods we will fallback
-  // to a crummy sleep loop for now.  This is really just a last
-  // resort and not expected on modern hardware and Windows OS
-  // installs.
-  if (!pOpen || !pClose || !pWait)
-  {
-    while (mVBlankShutdown == false)
-    {
-      Sleep(rateMS);
-      VBlankNotify();
-    }
-  }
-  else
-  {
-    // we have a good set of functions to call.  We need to keep
-    // track of the adapter and reask for it if the device is lost.
-    bool adapterIsOpen = false;
-    DWORD adapterLastFailTime = 0;
-    _D3DKMT_WAITFORVERTICALBLANKEVENT we = { 0 };
-
-    while (mVBlankShutdown == false)
-    {
-      if (!adapterIsOpen)
-      {
-        // reacquire the adapter (at most once a second).
-        if (adapterLastFailTime < ::GetTickCount() - 1000)
-        {
-          // try to get adapter
-          D3DKMT_OPENADAPTERFROMHDC openAdapterData = { 0 };
-          HDC hDC = GetDC(mVBlankWindow);
-          openAdapterData.hDc = hDC;
-          NTSTATUS status = (*pOpen)(&openAdapterData);
-          if (status == S_OK)
-          {
-            // success, setup wait request parameters.
-            adapterLastFailTime = 0;
-            adapterIsOpen = true;
-            we.hAdapter = openAdapterData.hAdapter;
-            we.hDevice = 0;
-            we.VidPnSourceId = openAdapterData.VidPnSourceId;
-          }
-          else
-          {
-            // failed
-            adapterLastFailTime = ::GetTickCount();
-          }
-          DeleteDC(hDC);
-        }
-      }
-
-      if (adapterIsOpen)
-      {
-        // Finally we can wait on VBlank
-        NTSTATUS status = (*pWait)(&we);
-        if (status != S_OK)
-        {
-          // failed, close now and try again on the next pass.
-          _D3DKMT_CLOSEADAPTER ca;
-          ca.hAdapter = we.hAdapter;
-          (*pClose)(&ca);
-          adapterIsOpen = false;
-        }
-      }
-
-      // Temporary fallback for lost adapter or failed call.
-      if (!adapterIsOpen)
-      {
-        ::Sleep(rateMS);
-      }
-
-      // notify logic
-      VBlankNotify();
-    }
-
-    // cleanup adapter before leaving
-    if (adapterIsOpen)
-    {
-      _D3DKMT_CLOSEADAPTER ca;
-      ca.hAdapter = we.hAdapter;
-      (*pClose)(&ca);
-      adapterIsOpen = false;
-    }
-  }
-
-  // release module resource
-  if (hInst != nullptr)
-  {
-    FreeLibrary((HMODULE)hInst);
-    hInst = nullptr;
-  }
-
-  return 0;
-}
-
-void IGraphicsWin::VBlankNotify()
-{
-  mVBlankCount++;
-  ::PostMessage(mVBlankWindow, WM_VBLANK, mVBlankCount, 0);
-}
-
 #ifndef NO_IGRAPHICS
 #if defined IGRAPHICS_SKIA
   #include "IGraphicsSkia.cpp"
@@ -55,6 +55,10 @@ public:
 
   void* OpenWindow(void* pParent) override;
   void CloseWindow() override;
+
+#ifdef IGRAPHICS_GL
+  bool PlatformSupportsRenderThread() const override { return true; }
+#endif
   bool WindowIsOpen() override { return (mPlugWnd); }
 
   void UpdateTooltips() override {}
@@ -89,11 +93,10 @@ public:
   static LRESULT CALLBACK ParamEditProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam);
   static BOOL CALLBACK FindMainWindow(HWND hWnd, LPARAM lParam);
 
-  DWORD OnVBlankRun();
-
 protected:
   IPopupMenu* CreatePlatformPopupMenu(IPopupMenu& menu, const IRECT& bounds, bool& isAsync) override;
   void CreatePlatformTextEntry(int paramIdx, const IText& text, const IRECT& bounds, int length, const char* str) override;
+  void OnTargetFPSChanged(int fps) override;
 
   void SetTooltip(const char* tooltip);
   void ShowTooltip();
@@ -128,9 +131,11 @@ private:
   void DestroyGLContext();
   void ActivateGLContext() override;
   void DeactivateGLContext() override;
+  bool GLContextIsShared() const override { return mGLContextShared; }
   HGLRC mHGLRC = nullptr;
   HGLRC mStartHGLRC = nullptr;
   HDC mStartHDC = nullptr;
+  bool mGLContextShared = false;
 #endif
 
   HINSTANCE mHInstance = nullptr;
@@ -143,13 +148,7 @@ private:
   HFONT mEditFont = nullptr;
   DWORD mPID = 0;
 
-  void StartVBlankThread(HWND hWnd);
-  void StopVBlankThread();
-  void VBlankNotify();
-  HWND mVBlankWindow = 0; // Window to post messages to for every vsync
-  volatile bool mVBlankShutdown = false; // Flag to indiciate that the vsync thread should shutdown
-  HANDLE mVBlankThread = INVALID_HANDLE_VALUE; //ID of thread.
-  volatile DWORD mVBlankCount = 0; // running count of vblank events since the start of the window.
+  bool mVBlankRegistered = false; // true if mPlugWnd gets WM_VBLANK from the vblank thread shared by all the instances in the process
   int mVBlankSkipUntil = 0; // support for skipping vblank notification if the last callback took  too long.  This helps keep the message pump clear in the case of overload.
   bool mVSYNCEnabled = false;
   
@@ -8,6 +8,8 @@
  ==============================================================================
 */
 
+#include <algorithm>
+
 #include "IPlugAAX.h"
 #include "IPlugAAX_view_interface.h"
 #include "AAX_CBinaryTaperDelegate.h"
@@ -139,6 +141,10 @@ AAX_Result IPlugAAX::EffectInit()
   mBypassParameter->SetType(AAX_eParameterType_Discrete);
   mParameterManager.AddParameter(mBypassParameter);
       
+  mParamChangeSeqs.assign(NParams(), 0);
+  mChangedParams.clear();
+  mChangedParams.reserve(NParams());
+  
   for (int i=0; i<NParams(); i++)
   {
     IParam* pParam = GetParam(i);
@@ -215,7 +221,8 @@ AAX_Result IPlugAAX::EffectInit()
   AAX_CSampleRate sr;
   Controller()->GetSampleRate(&sr);
   SetSampleRate(sr);
-  OnReset();
+  EnsureDeferredInit();
+  ResetFromAPI();
   
   return AAX_SUCCESS;
 }
@@ -238,11 +245,18 @@ AAX_Result IPlugAAX::UpdateParameterNormalizedValue(AAX_CParamID paramID, double
   
   if ((paramIdx > kNoParameter) && (paramIdx < NParams())) 
   {
-    ENTER_PARAMS_MUTEX
+    // the value is atomic, so it is set straight away for the UI and state, but OnParamChange() is called by the audio thread,
+    // once per batch of changes, rather than taking the params mutex, and waiting for the render to finish, for every parameter
     GetParam(paramIdx)->SetNormalized(iValue);
     SendParameterValueFromAPI(paramIdx, iValue, true);
-    OnParamChange(paramIdx, kHost);
-    LEAVE_PARAMS_MUTEX
+    
+    if (paramIdx < static_cast<int>(mParamChangeSeqs.size()))
+    {
+      if (mParamChangeSeqs[paramIdx] == 0)
+        mChangedParams.push_back(paramIdx);
+      
+      mParamChangeSeqs[paramIdx] = kParamChangeUnposted;
+    }
   }
   
   // Now the control has changed
@@ -253,6 +267,96 @@ AAX_Result IPlugAAX::UpdateParameterNormalizedValue(AAX_CParamID paramID, double
   return result;
 }
 
+AAX_Result IPlugAAX::GenerateCoefficients()
+{
+  // the host calls this once it has made a batch of parameter updates
+  PostParamBlock();
+  
+  return AAX_CIPlugParameters::GenerateCoefficients();
+}
+
+AAX_Result IPlugAAX::TimerWakeup()
+{
+  // changes left over from a batch larger than a block go out as the algorithm applies the earlier ones
+  if (!mChangedParams.empty())
+    PostParamBlock();
+  
+  return AAX_CIPlugParameters::TimerWakeup();
+}
+
+/** Sequence numbers wrap, so a is after b if it is less than half the range ahead */
+static inline bool ParamBlockSeqIsAfter(uint32_t a, uint32_t b)
+{
+  return static_cast<int32_t>(a - b) > 0;
+}
+
+void IPlugAAX::PostParamBlock()
+{
+  if (mChangedParams.empty())
+    return;
+  
+  const uint32_t applied = mAppliedParamBlockSeq.load(std::memory_order_acquire);
+  
+  // forget the changes the algorithm has applied
+  auto it = std::remove_if(mChangedParams.begin(), mChangedParams.end(), [&](int paramIdx) {
+    uint32_t& seq = mParamChangeSeqs[paramIdx];
+    
+    if (seq == kParamChangeUnposted || ParamBlockSeqIsAfter(seq, applied))
+      return false;
+    
+    seq = 0;
+    return true;
+  });
+  
+  mChangedParams.erase(it, mChangedParams.end());
+  
+  if (mChangedParams.empty())
+    return;
+  
+  if (++mParamBlockSeq == 0 || mParamBlockSeq == kParamChangeUnposted)
+    mParamBlockSeq = 1;
+  
+  // changes that were posted before are posted again, in case the packet they were in was replaced before the algorithm saw it
+  const int nChanges = std::min(static_cast<int>(mChangedParams.size()), AAX_PARAM_BLOCK_SIZE);
+  
+  for (auto i = 0; i < nChanges; i++)
+  {
+    const int paramIdx = mChangedParams[i];
+    uint32_t& seq = mParamChangeSeqs[paramIdx];
+    
+    if (seq == kParamChangeUnposted)
+      seq = mParamBlockSeq;
+    
+    mParamBlock.mChanges[i].mParamIdx = paramIdx;
+    mParamBlock.mChanges[i].mSeq = seq;
+  }
+  
+  mParamBlock.mSeq = mParamBlockSeq;
+  mParamBlock.mNumChanges = nChanges;
+  
+  Controller()->PostPacket(AAX_FIELD_INDEX(AAX_SIPlugRenderInfo, mParamBlock), &mParamBlock, sizeof(AAX_SIPlugParamBlock));
+}
+
+void IPlugAAX::ApplyParamBlock(const AAX_SIPlugParamBlock* pBlock)
+{
+  const uint32_t applied = mAppliedParamBlockSeq.load(std::memory_order_relaxed);
+  
+  if (!pBlock || !ParamBlockSeqIsAfter(pBlock->mSeq, applied))
+    return;
+  
+  const int nChanges = std::min(pBlock->mNumChanges, AAX_PARAM_BLOCK_SIZE);
+  
+  for (auto i = 0; i < nChanges; i++)
+  {
+    const AAX_SIPlugParamBlock::Change& change = pBlock->mChanges[i];
+    
+    if (ParamBlockSeqIsAfter(change.mSeq, applied) && change.mParamIdx >= 0 && change.mParamIdx < NParams())
+      OnParamChange(change.mParamIdx, kHost);
+  }
+  
+  mAppliedParamBlockSeq.store(pBlock->mSeq, std::memory_order_release);
+}
+
 void IPlugAAX::RenderAudio(AAX_SIPlugRenderInfo* pRenderInfo, const TParamValPair* inSynchronizedParamValues[], int32_t inNumSynchronizedParamValues)
 {
   TRACE
@@ -275,7 +379,7 @@ void IPlugAAX::RenderAudio(AAX_SIPlugRenderInfo* pRenderInfo, const TParamValPai
     for (auto i = 0; i<packets_count; i++, pMidiPacket++)
     {
       IMidiMsg msg(pMidiPacket->mTimestamp, pMidiPacket->mData[0], pMidiPacket->mData[1], pMidiPacket->mData[2]);
-      ProcessMidiMsg(msg);
+      ScheduleMidiMsg(msg);
       mMidiMsgsFromProcessor.Push(msg);
     }
   }
@@ -290,7 +394,8 @@ void IPlugAAX::RenderAudio(AAX_SIPlugRenderInfo* pRenderInfo, const TParamValPai
   if (numSamples > GetBlockSize())
   {
     SetBlockSize(numSamples);
-    OnReset();
+    EnsureDeferredInit();
+    ResetFromAPI();
   }
 
   if (!IsInstrument())
@@ -324,8 +429,13 @@ void IPlugAAX::RenderAudio(AAX_SIPlugRenderInfo* pRenderInfo, const TParamValPai
     AttachBuffers(ERoute::kOutput, 0, maxNOutChans, pRenderInfo->mAudioOutputs, numSamples);
   }
   
-  if (bypass) 
+  if (bypass)
+  {
+    ENTER_PARAMS_MUTEX
+    ApplyParamBlock(pRenderInfo->mParamBlock);
+    LEAVE_PARAMS_MUTEX
     PassThroughBuffers(0.0f, numSamples);
+  }
   else 
   {
     int32_t num, denom;
@@ -359,10 +469,11 @@ void IPlugAAX::RenderAudio(AAX_SIPlugRenderInfo* pRenderInfo, const TParamValPai
     
     while (mMidiMsgsFromEditor.Pop(msg))
     {
-      ProcessMidiMsg(msg);
+      ScheduleMidiMsg(msg);
     }
     
     ENTER_PARAMS_MUTEX
+    ApplyParamBlock(pRenderInfo->mParamBlock);
     ProcessBuffers(0.0f, numSamples);
     LEAVE_PARAMS_MUTEX
   }
@@ -451,13 +562,13 @@ AAX_Result IPlugAAX::GetChunkSize(AAX_CTypeID chunkID, uint32_t* pSize) const
     
   if (chunkID == GetUniqueID())
   {
-    IByteChunk chunk;
-    
     //IByteChunk::InitChunkWithIPlugVer(&IPlugChunk);
+    // GetChunk() is called straight after this, and gets the same snapshot without serializing again
+    const IByteChunk* pChunk = GetStateSnapshot();
     
-    if (SerializeState(chunk))
+    if (pChunk)
     {
-      *pSize = chunk.Size();
+      *pSize = pChunk->Size();
     }
     
     return AAX_SUCCESS;
@@ -475,14 +586,13 @@ AAX_Result IPlugAAX::GetChunk(AAX_CTypeID chunkID, AAX_SPlugInChunk* pChunk) con
 
   if (chunkID == GetUniqueID())
   {
-    IByteChunk chunk;
-    
     //IByteChunk::InitChunkWithIPlugVer(&IPlugChunk); // TODO: IPlugVer should be in chunk!
+    const IByteChunk* pState = GetStateSnapshot();
     
-    if (SerializeState(chunk))
+    if (pState)
     {
-      pChunk->fSize = chunk.Size();
-      memcpy(pChunk->fData, chunk.GetData(), chunk.Size());
+      pChunk->fSize = pState->Size();
+      memcpy(pChunk->fData, pState->GetData(), pState->Size());
       return AAX_SUCCESS;
     }
   }
@@ -501,7 +611,7 @@ AAX_Result IPlugAAX::SetChunk(AAX_CTypeID chunkID, const AAX_SPlugInChunk* pChun
     chunk.PutBytes(pChunk->fData, pChunk->fSize);
     int pos = 0;
     //IByteChunk::GetIPlugVerFromChunk(chunk, pos); // TODO: IPlugVer should be in chunk!
-    pos = UnserializeState(chunk, pos);
+    pos = UnserializeStateSnapshot(chunk, pos);
     
     for (int i = 0; i< NParams(); i++)
       SetParameterNormalizedValue(mParamIDs.Get(i)->Get(), GetParam(i)->GetNormalized());
@@ -611,6 +721,7 @@ void IPlugAAX::SetLatency(int latency)
 
 bool IPlugAAX::SendMidiMsg(const IMidiMsg& msg)
 {
-  mMidiOutputQueue.Add(msg);
-  return true;
+  IMidiMsg msgInBlock = msg;
+  msgInBlock.mOffset += GetSegmentStart();
+  return mMidiOutputQueue.Add(msgInBlock);
 }
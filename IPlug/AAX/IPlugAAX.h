@@ -16,6 +16,8 @@
  * @copydoc IPlugAAX
  */
 
+#include <atomic>
+#include <vector>
 
 #include "IPlugPlatform.h"
 #include "IPlugAPIBase.h"
@@ -73,6 +75,11 @@ private:
 };
 
 /**  AAX API base class for an IPlug plug-in
+*   Only the AAX Native process procedure is described. AAX DSP (HDX) needs the algorithm built separately with the TI DSP toolchain and the AAX DSP SDK,
+*   with no C++ runtime, so ProcessBlock() can't be offloaded to it. AAX Hybrid stems are plumbed through AAX_SIPlugSetupInfo, but left as AAX_eStemFormat_None,
+*   because IPlugAAX doesn't implement RenderAudio_Hybrid()
+*   Parameter updates from the host set the IParam values straight away, and are batched into one AAX_SIPlugParamBlock packet per GenerateCoefficients() call,
+*   from which the audio thread calls OnParamChange() at the start of the next render, so automating hundreds of parameters costs one packet and one lock per batch
 *   @ingroup APIClasses */
 class IPlugAAX : public IPlugAPIBase
                , public IPlugProcessor
@@ -103,6 +110,8 @@ public:
   //AAX_CIPlugParameters Overrides
   static AAX_CEffectParameters *AAX_CALLBACK Create();
   AAX_Result EffectInit() override;
+  AAX_Result GenerateCoefficients() override;
+  AAX_Result TimerWakeup() override;
   void RenderAudio(AAX_SIPlugRenderInfo* ioRenderInfo, const TParamValPair* inSynchronizedParamValues[], int32_t inNumSynchronizedParamValues) override;
   
   //AAX_CEffectParameters Overrides
@@ -119,12 +128,29 @@ public:
   void DirtyPTCompareState() { mNumPlugInChanges++; }
 
 private:
+  /** Post the parameter changes that the algorithm hasn't applied yet, as one packet, on the data model thread */
+  void PostParamBlock();
+  
+  /** Call OnParamChange() for the changes in a block that haven't been applied yet, on the audio thread, inside the params mutex */
+  void ApplyParamBlock(const AAX_SIPlugParamBlock* pBlock);
+  
+  static constexpr uint32_t kParamChangeUnposted = 0xFFFFFFFF;
+  
   AAX_CParameter<bool>* mBypassParameter = nullptr;
   AAX_ITransport* mTransport = nullptr;
   WDL_PtrList<WDL_String> mParamIDs;
-  IMidiQueue mMidiOutputQueue;
+  IFixedMidiQueue mMidiOutputQueue;
   int mMaxNChansForMainInputBus = 0;
   WDL_String mTrackName;
+  
+  // data model thread: for each parameter, the batch its latest change was posted in, 0 if the algorithm has applied it, or kParamChangeUnposted
+  std::vector<uint32_t> mParamChangeSeqs;
+  std::vector<int> mChangedParams;
+  uint32_t mParamBlockSeq = 0;
+  AAX_SIPlugParamBlock mParamBlock {};
+  
+  // written by the audio thread, the latest batch it has applied
+  std::atomic<uint32_t> mAppliedParamBlockSeq {0};
 };
 
 IPlugAAX* MakePlug(const InstanceInfo& info);
@@ -187,6 +187,9 @@ AAX_Result  AAX_CIPlugParameters::StaticDescribe(AAX_IEffectDescriptor * ioDescr
   //Add a "state number" counter for deferred parameter updates
   err = compDesc->AddDataInPort ( AAX_FIELD_INDEX(AAX_SIPlugRenderInfo, mCurrentStateNum), sizeof(uint64_t));
   
+  //Add the block of parameter changes, posted once per batch of updates rather than once per parameter
+  err = compDesc->AddDataInPort ( AAX_FIELD_INDEX(AAX_SIPlugRenderInfo, mParamBlock), sizeof(AAX_SIPlugParamBlock));
+  
   //Additional properties on the algorithm
   AAX_IPropertyMap* const properties = compDesc->NewPropertyMap ();
   if (!properties)
@@ -196,7 +199,7 @@ AAX_Result  AAX_CIPlugParameters::StaticDescribe(AAX_IEffectDescriptor * ioDescr
     if (setupInfo.mUseHostGeneratedGUI)
         err = properties->AddProperty ( AAX_eProperty_UsesClientGUI, true );
   
-  // AAX Hybrid
+  // AAX Hybrid, not used by IPlugAAX, see the IPlugAAX class comment
   AAX_ASSERT((AAX_eStemFormat_None != setupInfo.mHybridInputStemFormat) == (AAX_eStemFormat_None != setupInfo.mHybridOutputStemFormat));
   if ((AAX_eStemFormat_None != setupInfo.mHybridInputStemFormat) && (AAX_eStemFormat_None != setupInfo.mHybridOutputStemFormat))
   {
@@ -33,6 +33,10 @@
 #define kMaxAuxOutputStems 32
 #define kSynchronizedParameterQueueSize 32
 
+#ifndef AAX_PARAM_BLOCK_SIZE
+  #define AAX_PARAM_BLOCK_SIZE 512 // the most parameter changes in one AAX_SIPlugParamBlock, a batch with more is spread over several render calls
+#endif
+
 BEGIN_IPLUG_NAMESPACE
 
 struct AAX_SIPlugSetupInfo
@@ -124,6 +128,22 @@ struct AAX_SIPlugPrivateData
   AAX_CIPlugParameters* mMonolithicParametersPtr;
 };
 
+/** The parameter changes of one or more batches of host updates, posted once per GenerateCoefficients() call to the algorithm, see IPlugAAX.
+ * Each change is stamped with the sequence number of the batch it was posted in. Changes are posted again until the algorithm has applied a block with a later sequence number,
+ * so the block can be delivered as an unbuffered packet, of which the algorithm only sees the latest */
+struct AAX_SIPlugParamBlock
+{
+  struct Change
+  {
+    int32_t mParamIdx;
+    uint32_t mSeq;
+  };
+
+  uint32_t mSeq; // the latest batch in the block, 0 before anything is posted
+  int32_t mNumChanges;
+  Change mChanges[AAX_PARAM_BLOCK_SIZE];
+};
+
 struct AAX_SIPlugRenderInfo
 {
   float** mAudioInputs;
@@ -141,6 +161,7 @@ struct AAX_SIPlugRenderInfo
   
   int64_t* mCurrentStateNum;
   int32_t* mSideChainP;
+  AAX_SIPlugParamBlock* mParamBlock;
 };
 
 class AAX_CIPlugParameters : public AAX_CEffectParameters
@@ -120,8 +120,8 @@ void IPlugAPP::AppProcess(double** inputs, double** outputs, int nFrames)
 {
   SetChannelConnections(ERoute::kInput, 0, MaxNChannels(ERoute::kInput), !IsInstrument()); //TODO: go elsewhere - enable inputs
   SetChannelConnections(ERoute::kOutput, 0, MaxNChannels(ERoute::kOutput), true); //TODO: go elsewhere
-  AttachBuffers(ERoute::kInput, 0, NChannelsConnected(ERoute::kInput), inputs, GetBlockSize());
-  AttachBuffers(ERoute::kOutput, 0, NChannelsConnected(ERoute::kOutput), outputs, GetBlockSize());
+  AttachBuffers(ERoute::kInput, 0, NChannelsConnected(ERoute::kInput), inputs, nFrames);
+  AttachBuffers(ERoute::kOutput, 0, NChannelsConnected(ERoute::kOutput), outputs, nFrames);
   
   if(mMidiMsgsFromCallback.ElementsAvailable())
   {
@@ -129,7 +129,7 @@ void IPlugAPP::AppProcess(double** inputs, double** outputs, int nFrames)
     
     while (mMidiMsgsFromCallback.Pop(msg))
     {
-      ProcessMidiMsg(msg);
+      ScheduleMidiMsg(msg);
       mMidiMsgsFromProcessor.Push(msg); // queue incoming MIDI for UI
     }
   }
@@ -152,13 +152,13 @@ void IPlugAPP::AppProcess(double** inputs, double** outputs, int nFrames)
 
     while (mMidiMsgsFromEditor.Pop(msg))
     {
-      ProcessMidiMsg(msg);
+      ScheduleMidiMsg(msg);
     }
   }
 
   //Do not handle Sysex messages here - SendSysexMsgFromUI overridden
 
   ENTER_PARAMS_MUTEX
-  ProcessBuffers(0.0, GetBlockSize());
+  ProcessBuffers(0.0, nFrames);
   LEAVE_PARAMS_MUTEX
 }
@@ -39,7 +39,19 @@ void IPlugAPPHost::PopulateSampleRateList(HWND hwndDlg, RtAudio::DeviceInfo* inp
 
   std::vector<int> matchedSRs;
 
-  if (inputDevInfo->probed && outputDevInfo->probed)
+  // a separate input device that can't run at the output's rate is converted to it, see IPlugAPPHost::GetInputSampleRate()
+  bool separateInputDevice = inputDevInfo->probed && inputDevInfo->name != outputDevInfo->name;
+#ifdef OS_WIN
+  if (mState.mAudioDriverType == kDeviceASIO)
+    separateInputDevice = false;
+#endif
+
+  if (separateInputDevice && outputDevInfo->probed)
+  {
+    for (auto sr : outputDevInfo->sampleRates)
+      matchedSRs.push_back(sr);
+  }
+  else if (inputDevInfo->probed && outputDevInfo->probed)
   {
     for (int i=0; i<inputDevInfo->sampleRates.size(); i++)
     {
@@ -209,6 +221,12 @@ void IPlugAPPHost::PopulateAudioDialogs(HWND hwndDlg)
 
   LRESULT iovsidx = SendDlgItemMessage(hwndDlg, IDC_COMBO_AUDIO_BUF_SIZE, CB_FINDSTRINGEXACT, -1, (LPARAM) str.Get());
   SendDlgItemMessage(hwndDlg, IDC_COMBO_AUDIO_BUF_SIZE, CB_SETCURSEL, iovsidx, 0);
+
+#ifdef IDC_CB_LOW_LATENCY // older projects' resources don't have the low latency options
+  SendDlgItemMessage(hwndDlg, IDC_CB_LOW_LATENCY, BM_SETCHECK, mState.mLowLatency ? BST_CHECKED : BST_UNCHECKED, 0);
+  SendDlgItemMessage(hwndDlg, IDC_CB_EXCLUSIVE, BM_SETCHECK, mState.mExclusive ? BST_CHECKED : BST_UNCHECKED, 0);
+  SendDlgItemMessage(hwndDlg, IDC_CB_REALTIME, BM_SETCHECK, mState.mRealtime ? BST_CHECKED : BST_UNCHECKED, 0);
+#endif
 }
 
 bool IPlugAPPHost::PopulateMidiDialogs(HWND hwndDlg)
@@ -454,6 +472,17 @@ WDL_DLGRET IPlugAPPHost::PreferencesDlgProc(HWND hwndDlg, UINT uMsg, WPARAM wPar
             mState.mBufferSize = atoi(kBufferSizeOptions[iovsidx].c_str());
           }
           break;
+#ifdef IDC_CB_LOW_LATENCY
+        case IDC_CB_LOW_LATENCY:
+          mState.mLowLatency = SendDlgItemMessage(hwndDlg, IDC_CB_LOW_LATENCY, BM_GETCHECK, 0, 0) == BST_CHECKED;
+          break;
+        case IDC_CB_EXCLUSIVE:
+          mState.mExclusive = SendDlgItemMessage(hwndDlg, IDC_CB_EXCLUSIVE, BM_GETCHECK, 0, 0) == BST_CHECKED;
+          break;
+        case IDC_CB_REALTIME:
+          mState.mRealtime = SendDlgItemMessage(hwndDlg, IDC_CB_REALTIME, BM_GETCHECK, 0, 0) == BST_CHECKED;
+          break;
+#endif
         case IDC_COMBO_AUDIO_SR:
           if (HIWORD(wParam) == CBN_SELCHANGE)
           {
@@ -12,9 +12,24 @@
 
 #ifdef OS_WIN
 #include <sys/stat.h>
+#elif defined OS_MAC
+#include <mach/mach.h>
+#include <mach/mach_time.h>
+#include <mach/thread_policy.h>
 #endif
 
 #include "IPlugLogger.h"
+#include "wavwrite.h"
+
+#ifdef APP_NETDSP_NODE
+#include "NetDSP/IPlugNetDSP.h"
+#endif
+
+#include <chrono>
+#include <cmath>
+
+// for now include WDL's resampler here, so that app projects don't need to build it. Projects that build resample.cpp themselves for the app target should remove it from that target
+#include "resample.cpp"
 
 using namespace iplug;
 
@@ -67,6 +82,7 @@ bool IPlugAPPHost::Init()
   SelectMIDIDevice(ERoute::kOutput, mState.mMidiOutDev.Get());
   
   mIPlug->OnParamReset(kReset);
+  mIPlug->EnsureDeferredInit();
   mIPlug->OnActivate(true);
   
   return true;
@@ -120,6 +136,9 @@ bool IPlugAPPHost::InitState()
 
       mState.mBufferSize = GetPrivateProfileInt("audio", "buffer", 512, mINIPath.Get());
       mState.mAudioSR = GetPrivateProfileInt("audio", "sr", 44100, mINIPath.Get());
+      mState.mLowLatency = GetPrivateProfileInt("audio", "lowlatency", 0, mINIPath.Get());
+      mState.mExclusive = GetPrivateProfileInt("audio", "exclusive", 0, mINIPath.Get());
+      mState.mRealtime = GetPrivateProfileInt("audio", "realtime", 0, mINIPath.Get());
 
       //midi
       GetPrivateProfileString("midi", "indev", "no input", buf, STRBUFSZ, mINIPath.Get()); mState.mMidiInDev.Set(buf);
@@ -190,6 +209,13 @@ void IPlugAPPHost::UpdateINI()
   str.SetFormatted(32, "%i", mState.mAudioSR);
   WritePrivateProfileString("audio", "sr", str.Get(), ini);
 
+  sprintf(buf, "%u", mState.mLowLatency);
+  WritePrivateProfileString("audio", "lowlatency", buf, ini);
+  sprintf(buf, "%u", mState.mExclusive);
+  WritePrivateProfileString("audio", "exclusive", buf, ini);
+  sprintf(buf, "%u", mState.mRealtime);
+  WritePrivateProfileString("audio", "realtime", buf, ini);
+
   WritePrivateProfileString("midi", "indev", mState.mMidiInDev.Get(), ini);
   WritePrivateProfileString("midi", "outdev", mState.mMidiOutDev.Get(), ini);
 
@@ -347,6 +373,9 @@ bool IPlugAPPHost::AudioSettingsInStateAreEqual(AppState& os, AppState& ns)
   if (os.mAudioInChanR != ns.mAudioInChanR) return false;
   if (os.mAudioOutChanL != ns.mAudioOutChanL) return false;
   if (os.mAudioOutChanR != ns.mAudioOutChanR) return false;
+  if (os.mLowLatency != ns.mLowLatency) return false;
+  if (os.mExclusive != ns.mExclusive) return false;
+  if (os.mRealtime != ns.mRealtime) return false;
 //  if (os.mAudioInIsMono != ns.mAudioInIsMono) return false;
 
   return true;
@@ -571,6 +600,59 @@ void IPlugAPPHost::CloseAudio()
     
     mDAC->closeStream();
   }
+  
+  // the output stream has stopped, so nothing reads what the input stream pushes
+  if (mInputDAC)
+  {
+    try
+    {
+      if (mInputDAC->isStreamRunning())
+        mInputDAC->abortStream();
+      
+      if (mInputDAC->isStreamOpen())
+        mInputDAC->closeStream();
+    }
+    catch (RtAudioError& e)
+    {
+      e.printMessage();
+    }
+    
+    mInputDAC = nullptr;
+  }
+  
+  mUseAsyncResampler = false;
+}
+
+uint32_t IPlugAPPHost::GetInputSampleRate(uint32_t inId, uint32_t outId, uint32_t sr)
+{
+  if (inId == outId)
+    return sr;
+  
+  RtAudio::DeviceInfo info = mDAC->getDeviceInfo(inId);
+  
+  if (!info.probed || info.sampleRates.empty())
+    return sr;
+  
+  auto supports = [&info](uint32_t rate) {
+    return std::find(info.sampleRates.begin(), info.sampleRates.end(), rate) != info.sampleRates.end();
+  };
+  
+  if (supports(sr))
+    return sr;
+  
+  if (info.preferredSampleRate && supports(info.preferredSampleRate))
+    return info.preferredSampleRate;
+  
+  // the closest rate, so the conversion is as gentle as it can be
+  uint32_t closest = info.sampleRates[0];
+  
+  for (auto rate : info.sampleRates)
+  {
+    if (std::abs(static_cast<double>(rate) - sr) < std::abs(static_cast<double>(closest) - sr))
+      closest = rate;
+  }
+  
+  return closest;
 }
 
 bool IPlugAPPHost::InitAudio(uint32_t inId, uint32_t outId, uint32_t sr, uint32_t iovs)
@@ -593,22 +675,54 @@ bool IPlugAPPHost::InitAudio(uint32_t inId, uint32_t outId, uint32_t sr, uint32_
 
   RtAudio::StreamOptions options;
   options.flags = RTAUDIO_NONINTERLEAVED;
+  
+  if (mState.mLowLatency)
+    options.flags |= RTAUDIO_MINIMIZE_LATENCY; // smallest buffer the device allows on CoreAudio, fewest periods on ALSA
+  
+  if (mState.mExclusive)
+    options.flags |= RTAUDIO_HOG_DEVICE; // hog mode on CoreAudio, direct hw device on ALSA
+  
+  if (mState.mRealtime)
+  {
+    options.flags |= RTAUDIO_SCHEDULE_REALTIME; // used by the APIs that create their own callback thread
+    options.priority = 70;
+  }
+  
   // options.streamName = BUNDLE_NAME; // JACK stream name, not used on other streams
 
-  mBufIndex = 0;
+  const uint32_t inputSR = iParams.nChannels > 0 ? GetInputSampleRate(inId, outId, sr) : sr;
+  mUseAsyncResampler = inputSR != sr;
+
   mSamplesElapsed = 0;
   mSampleRate = (double) sr;
   mVecWait = 0;
   mAudioEnding = false;
   mAudioDone = false;
-  
-  mIPlug->SetBlockSize(APP_SIGNAL_VECTOR_SIZE);
-  mIPlug->SetSampleRate(mSampleRate);
-  mIPlug->OnReset();
+  mScheduleRealtime = mState.mRealtime;
 
   try
   {
-    mDAC->openStream(&oParams, iParams.nChannels > 0 ? &iParams : nullptr, RTAUDIO_FLOAT64, sr, &mBufferSize, &AudioCallback, this, &options /*, &ErrorCallback */);
+    mDAC->openStream(&oParams, iParams.nChannels > 0 && !mUseAsyncResampler ? &iParams : nullptr, RTAUDIO_FLOAT64, sr, &mBufferSize, &AudioCallback, this, &options /*, &ErrorCallback */);
+    
+    if (mUseAsyncResampler)
+    {
+      // the input device runs on its own clock, in a stream of its own. Its buffer is the same length of time as the output's, so neither side waits long for the other
+      DBGMSG("input device can't run at %i sr, converting from %i sr\n", sr, inputSR);
+      
+      mInputBufferSize = std::max(static_cast<uint32_t>(std::lround(static_cast<double>(mBufferSize) * inputSR / sr)), 16u);
+      mInputDAC = std::make_unique<RtAudio>(mDAC->getCurrentApi());
+      mInputDAC->openStream(nullptr, &iParams, RTAUDIO_FLOAT64, inputSR, &mInputBufferSize, &AudioInputCallback, this, &options);
+      
+      mAsyncResampler.Init(iParams.nChannels, inputSR, sr, mInputBufferSize, mBufferSize);
+      mResamplerInputPtrs.assign(iParams.nChannels, nullptr);
+      mResampledInput.assign(static_cast<size_t>(mBufferSize) * 2 * iParams.nChannels, 0.);
+    }
+    
+    // process at the buffer size the stream settled on, so that there's no extra latency or splitting of the device's buffers
+    mIPlug->SetBlockSize(mBufferSize ? mBufferSize : APP_SIGNAL_VECTOR_SIZE);
+    mIPlug->SetSampleRate(mSampleRate);
+    mIPlug->EnsureDeferredInit();
+    mIPlug->ResetFromAPI();
     
     for (int i = 0; i < iParams.nChannels; i++)
     {
@@ -620,6 +734,9 @@ bool IPlugAPPHost::InitAudio(uint32_t inId, uint32_t outId, uint32_t sr, uint32_
       mOutputBufPtrs.Add(nullptr); //will be set in callback
     }
     
+    if (mInputDAC)
+      mInputDAC->startStream();
+    
     mDAC->startStream();
 
     mActiveState = mState;
@@ -663,6 +780,470 @@ bool IPlugAPPHost::InitMidi()
   return true;
 }
 
+#pragma mark - Offline rendering
+
+/** Read a PCM (16, 24 or 32 bit) or floating point (32 or 64 bit) WAV file into one buffer per channel */
+static bool ReadWavFile(const char* path, std::vector<std::vector<double>>& channels, int& sampleRate)
+{
+  FILE* fp = fopen(path, "rb");
+  
+  if (!fp)
+    return false;
+  
+  auto readU32 = [](const uint8_t* p) { return (uint32_t) p[0] | ((uint32_t) p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24); };
+  auto readU16 = [](const uint8_t* p) { return (uint16_t) (p[0] | (p[1] << 8)); };
+  
+  uint8_t header[12];
+  int format = 0, nChans = 0, bps = 0;
+  std::vector<uint8_t> data;
+  
+  if (fread(header, 1, 12, fp) != 12 || memcmp(header, "RIFF", 4) || memcmp(header + 8, "WAVE", 4))
+  {
+    fclose(fp);
+    return false;
+  }
+  
+  uint8_t chunkHeader[8];
+  
+  while (fread(chunkHeader, 1, 8, fp) == 8)
+  {
+    const uint32_t chunkSize = readU32(chunkHeader + 4);
+    
+    if (!memcmp(chunkHeader, "fmt ", 4) && chunkSize >= 16)
+    {
+      std::vector<uint8_t> fmt(chunkSize);
+      
+      if (fread(fmt.data(), 1, chunkSize, fp) != chunkSize)
+        break;
+      
+      format = readU16(fmt.data());
+      nChans = readU16(fmt.data() + 2);
+      sampleRate = (int) readU32(fmt.data() + 4);
+      bps = readU16(fmt.data() + 14);
+      
+      if (format == 0xFFFE && chunkSize >= 26) // WAVE_FORMAT_EXTENSIBLE, the sub format GUID starts with the format tag
+        format = readU16(fmt.data() + 24);
+    }
+    else if (!memcmp(chunkHeader, "data", 4))
+    {
+      data.resize(chunkSize);
+      data.resize(fread(data.data(), 1, chunkSize, fp));
+      break;
+    }
+    else
+    {
+      fseek(fp, chunkSize, SEEK_CUR);
+    }
+    
+    if (chunkSize & 1) // chunks are word aligned
+      fseek(fp, 1, SEEK_CUR);
+  }
+  
+  fclose(fp);
+  
+  const bool isFloat = format == 3 && (bps == 32 || bps == 64);
+  const bool isPCM = format == 1 && (bps == 16 || bps == 24 || bps == 32);
+  
+  if (!nChans || !(isFloat || isPCM))
+    return false;
+  
+  const int bytesPerSample = bps / 8;
+  const int nFrames = (int) (data.size() / (bytesPerSample * nChans));
+  const uint8_t* pData = data.data();
+  
+  channels.assign(nChans, std::vector<double>(nFrames));
+  
+  for (int s = 0; s < nFrames; s++)
+  {
+    for (int c = 0; c < nChans; c++, pData += bytesPerSample)
+    {
+      double sample;
+      
+      if (isFloat && bps == 32)
+      {
+        float f;
+        memcpy(&f, pData, sizeof(float));
+        sample = f;
+      }
+      else if (isFloat)
+        memcpy(&sample, pData, sizeof(double));
+      else if (bps == 16)
+        sample = (int16_t) readU16(pData) / 32768.;
+      else if (bps == 24)
+        sample = ((int32_t) (((uint32_t) pData[0] << 8) | ((uint32_t) pData[1] << 16) | ((uint32_t) pData[2] << 24)) >> 8) / 8388608.;
+      else
+        sample = (int32_t) readU32(pData) / 2147483648.;
+      
+      channels[c][s] = sample;
+    }
+  }
+  
+  return true;
+}
+
+bool IPlugAPPHost::RenderFile(const char* inputPath, const char* outputPath)
+{
+  std::vector<std::vector<double>> inputs;
+  int sampleRate = 0;
+  
+  if (!ReadWavFile(inputPath, inputs, sampleRate))
+  {
+    DBGMSG("Could not read %s\n", inputPath);
+    return false;
+  }
+  
+  const int blockSize = APP_SIGNAL_VECTOR_SIZE;
+  const int nIns = mIPlug->MaxNChannels(ERoute::kInput);
+  const int nOuts = mIPlug->MaxNChannels(ERoute::kOutput);
+  const int nInputFrames = inputs.empty() ? 0 : (int) inputs[0].size();
+  const int latency = mIPlug->GetLatency();
+  const int nFrames = nInputFrames + mIPlug->GetTailSize();
+  
+  mIPlug->SetRenderingOffline(true);
+  mIPlug->SetBlockSize(blockSize);
+  mIPlug->SetSampleRate(sampleRate);
+  mIPlug->EnsureDeferredInit();
+  mIPlug->ResetFromAPI();
+  
+  // missing input channels are silent, so a mono file feeds the first input of a stereo plug-in
+  std::vector<std::vector<double>> inBufs(nIns, std::vector<double>(blockSize));
+  std::vector<std::vector<double>> outBufs(nOuts, std::vector<double>(blockSize));
+  std::vector<double*> inPtrs(nIns), outPtrs(nOuts);
+  
+  for (int c = 0; c < nIns; c++)
+    inPtrs[c] = inBufs[c].data();
+  
+  for (int c = 0; c < nOuts; c++)
+    outPtrs[c] = outBufs[c].data();
+  
+  WaveWriter writer(outputPath, 24, std::min(nOuts, 2), sampleRate, 0);
+  
+  if (!nOuts || !writer.Status())
+  {
+    DBGMSG("Could not write %s\n", outputPath);
+    return false;
+  }
+  
+  // run for the latency beyond the end, and drop that much from the start, so the output lines up with the input
+  for (int pos = 0; pos < nFrames + latency; pos += blockSize)
+  {
+    const int n = std::min(blockSize, nFrames + latency - pos);
+    
+    for (int c = 0; c < nIns; c++)
+    {
+      const int nFromFile = c < (int) inputs.size() ? Clip(nInputFrames - pos, 0, n) : 0;
+      
+      if (nFromFile)
+        memcpy(inPtrs[c], inputs[c].data() + pos, nFromFile * sizeof(double));
+      
+      memset(inPtrs[c] + nFromFile, 0, (n - nFromFile) * sizeof(double));
+    }
+    
+    mIPlug->AppProcess(inPtrs.data(), outPtrs.data(), n);
+    
+    const int skip = Clip(latency - pos, 0, n);
+    
+    if (n > skip)
+      writer.WriteDoublesNI(outPtrs.data(), skip, n - skip, nOuts);
+  }
+  
+  return true;
+}
+
+//static
+bool IPlugAPPHost::RenderOffline(const std::vector<std::string>& inputPaths, const char* outputFolder, int nThreads)
+{
+  nThreads = Clip(nThreads, 1, std::max((int) inputPaths.size(), 1));
+  
+  // the instances are made up front, as plug-in constructors aren't expected to be thread safe
+  std::vector<std::unique_ptr<IPlugAPPHost>> hosts;
+  
+  for (int i = 0; i < nThreads; i++)
+  {
+    hosts.push_back(std::make_unique<IPlugAPPHost>());
+    hosts.back()->mIPlug->SetHost("standalone", hosts.back()->mIPlug->GetPluginVersion(false));
+    hosts.back()->mIPlug->OnParamReset(kReset);
+    hosts.back()->mIPlug->OnActivate(true);
+  }
+  
+  std::atomic<int> nextFile {0};
+  std::atomic<bool> success {true};
+  
+  auto renderFiles = [&](IPlugAPPHost* pHost) {
+    int i;
+    
+    while ((i = nextFile++) < (int) inputPaths.size())
+    {
+      WDL_String outputPath;
+      WDL_String inputPath(inputPaths[i].c_str());
+      
+      if (CStringHasContents(outputFolder))
+      {
+        outputPath.Set(outputFolder);
+        
+        if (outputPath.Get()[outputPath.GetLength() - 1] != WDL_DIRCHAR)
+          outputPath.Append(WDL_DIRCHAR_STR);
+        
+        outputPath.Append(inputPath.get_filepart());
+      }
+      else
+      {
+        inputPath.remove_fileext();
+        outputPath.SetFormatted(MAX_PATH_LEN, "%s-render.wav", inputPath.Get());
+      }
+      
+      if (!pHost->RenderFile(inputPaths[i].c_str(), outputPath.Get()))
+        success = false;
+    }
+  };
+  
+  std::vector<std::thread> threads;
+  
+  for (int i = 1; i < nThreads; i++)
+    threads.emplace_back(renderFiles, hosts[i].get());
+  
+  renderFiles(hosts[0].get());
+  
+  for (auto& thread : threads)
+    thread.join();
+  
+  return success;
+}
+
+//static
+bool IPlugAPPHost::Benchmark(const BenchmarkConfig& config)
+{
+  using clock = std::chrono::steady_clock;
+  
+  IPlugAPPHost host;
+  IPlugAPP* pPlug = host.mIPlug.get();
+  pPlug->SetHost("standalone", pPlug->GetPluginVersion(false));
+  pPlug->OnParamReset(kReset);
+  pPlug->EnsureDeferredInit();
+  pPlug->OnActivate(true);
+  
+  const int nIns = pPlug->MaxNChannels(ERoute::kInput);
+  const int nOuts = pPlug->MaxNChannels(ERoute::kOutput);
+  const int nParams = pPlug->NParams();
+  bool keptUp = true;
+  
+  WDL_String version;
+  pPlug->GetPluginVersionStr(version);
+  printf("%s %s\n", pPlug->GetPluginName(), version.Get());
+  printf("%8s %6s %12s %14s %10s %12s\n", "sr", "block", "ns/sample", "worst block us", "worst %", "allocations");
+  
+  for (auto sampleRate : config.mSampleRates)
+  {
+    for (auto blockSize : config.mBlockSizes)
+    {
+      pPlug->SetBlockSize(blockSize);
+      pPlug->SetSampleRate(sampleRate);
+      pPlug->EnsureDeferredInit();
+      pPlug->ResetFromAPI();
+      
+      std::vector<std::vector<double>> inBufs(nIns, std::vector<double>(blockSize));
+      std::vector<std::vector<double>> outBufs(nOuts, std::vector<double>(blockSize));
+      std::vector<double*> inPtrs(nIns), outPtrs(nOuts);
+      
+      for (int c = 0; c < nIns; c++)
+        inPtrs[c] = inBufs[c].data();
+      
+      for (int c = 0; c < nOuts; c++)
+        outPtrs[c] = outBufs[c].data();
+      
+      const int nWarmUpBlocks = sampleRate / blockSize;
+      const int nBlocks = std::max(1, (int) (config.mSeconds * sampleRate / blockSize));
+      const int noteLength = sampleRate / 8;
+      uint32_t seed = 1;
+      int position = 0;
+      int note = -1;
+      double totalSeconds = 0.;
+      double worstSeconds = 0.;
+      const int64_t startAllocations = GetAudioThreadAllocationCount();
+      
+      for (int b = -nWarmUpBlocks; b < nBlocks; b++)
+      {
+        for (auto& buf : inBufs)
+        {
+          for (auto& x : buf)
+          {
+            seed = seed * 1664525 + 1013904223;
+            x = (seed / 2147483648.) - 1.;
+          }
+        }
+        
+        // a note every eighth of a second, cycling through a few octaves
+        if (config.mMidi && pPlug->DoesMIDIIn() && (position + blockSize) / noteLength != position / noteLength)
+        {
+          const int offset = noteLength - (position % noteLength) - 1;
+          IMidiMsg msg;
+          
+          if (note >= 0)
+          {
+            msg.MakeNoteOffMsg(note, offset);
+            pPlug->mMidiMsgsFromCallback.Push(msg);
+          }
+          
+          note = 36 + ((position / noteLength) * 7) % 48;
+          msg.MakeNoteOnMsg(note, 100, offset);
+          pPlug->mMidiMsgsFromCallback.Push(msg);
+        }
+        
+        if (config.mAutomation && nParams)
+        {
+          const int paramIdx = (b + nWarmUpBlocks) % nParams;
+          const double value = 0.5 + 0.5 * std::sin(2. * PI * position / sampleRate);
+          
+          // there's no UI or other thread touching the parameters, so no need for the params mutex
+          pPlug->GetParam(paramIdx)->SetNormalized(value);
+          pPlug->OnParamChange(paramIdx, kHost, 0);
+        }
+        
+        const auto start = clock::now();
+        pPlug->AppProcess(inPtrs.data(), outPtrs.data(), blockSize);
+        const double seconds = std::chrono::duration<double>(clock::now() - start).count();
+        
+        position += blockSize;
+        
+        if (b < 0)
+          continue;
+        
+        totalSeconds += seconds;
+        worstSeconds = std::max(worstSeconds, seconds);
+      }
+      
+      const int64_t allocations = startAllocations < 0 ? -1 : GetAudioThreadAllocationCount() - startAllocations;
+      const double worstPercent = 100. * worstSeconds * sampleRate / blockSize;
+      
+      keptUp &= worstPercent < 100.;
+      
+      printf("%8d %6d %12.2f %14.2f %10.1f %12s\n", sampleRate, blockSize, 1e9 * totalSeconds / (double(nBlocks) * blockSize),
+             1e6 * worstSeconds, worstPercent, allocations < 0 ? "n/a" : std::to_string(allocations).c_str());
+    }
+  }
+  
+  return keptUp;
+}
+
+#ifdef APP_NETDSP_NODE
+//static
+bool IPlugAPPHost::RunNetDSPNode(int port)
+{
+  IPlugAPPHost host;
+  IPlugAPP* pPlug = host.mIPlug.get();
+  pPlug->SetHost("standalone", pPlug->GetPluginVersion(false));
+  pPlug->OnParamReset(kReset);
+  pPlug->EnsureDeferredInit();
+  pPlug->OnActivate(true);
+  
+  auto resetFunc = [pPlug](double sampleRate, int chunkSize) {
+    pPlug->SetBlockSize(chunkSize);
+    pPlug->SetSampleRate(sampleRate);
+    pPlug->EnsureDeferredInit();
+    pPlug->ResetFromAPI();
+    printf("%i Hz, %i frame chunks\n", (int) sampleRate, chunkSize);
+  };
+  
+  auto processFunc = [pPlug](double** inputs, double** outputs, int nFrames) {
+    pPlug->AppProcess(inputs, outputs, nFrames);
+    return pPlug->GetLatency();
+  };
+  
+  INetDSPNode node(pPlug->MaxNChannels(ERoute::kInput), pPlug->MaxNChannels(ERoute::kOutput), resetFunc, processFunc);
+  
+  if (!node.Open(port))
+  {
+    printf("Couldn't listen on port %i\n", port);
+    return false;
+  }
+  
+  printf("%s NetDSP node listening on port %i\n", pPlug->GetPluginName(), port);
+  node.Run();
+  return true;
+}
+#endif
+
+//static
+bool IPlugAPPHost::RunFromCommandLine(int argc, char** argv, int& exitCode)
+{
+  if (argc < 2)
+    return false;
+  
+  auto parseList = [](const char* str) {
+    std::vector<int> values;
+    
+    for (const char* p = str; *p; p++)
+    {
+      if (p == str || p[-1] == ',')
+        values.push_back(atoi(p));
+    }
+    
+    return values;
+  };
+  
+  if (!strcmp(argv[1], "--render"))
+  {
+    std::vector<std::string> inputPaths;
+    const char* outputFolder = nullptr;
+    int nThreads = 1;
+    
+    for (int i = 2; i < argc; i++)
+    {
+      if (!strcmp(argv[i], "--threads") && i + 1 < argc)
+        nThreads = atoi(argv[++i]);
+      else if (!strcmp(argv[i], "--out") && i + 1 < argc)
+        outputFolder = argv[++i];
+      else
+        inputPaths.push_back(argv[i]);
+    }
+    
+    exitCode = (!inputPaths.empty() && RenderOffline(inputPaths, outputFolder, nThreads)) ? 0 : 1;
+    return true;
+  }
+  
+  if (!strcmp(argv[1], "--benchmark"))
+  {
+    BenchmarkConfig config;
+    
+    for (int i = 2; i < argc; i++)
+    {
+      if (!strcmp(argv[i], "--sr") && i + 1 < argc)
+        config.mSampleRates = parseList(argv[++i]);
+      else if (!strcmp(argv[i], "--block") && i + 1 < argc)
+        config.mBlockSizes = parseList(argv[++i]);
+      else if (!strcmp(argv[i], "--seconds") && i + 1 < argc)
+        config.mSeconds = atof(argv[++i]);
+      else if (!strcmp(argv[i], "--no-midi"))
+        config.mMidi = false;
+      else if (!strcmp(argv[i], "--no-automation"))
+        config.mAutomation = false;
+    }
+    
+    exitCode = Benchmark(config) ? 0 : 1;
+    return true;
+  }
+  
+#ifdef APP_NETDSP_NODE
+  if (!strcmp(argv[1], "--netdsp-node"))
+  {
+    int port = kNetDSPDefaultPort;
+    
+    for (int i = 2; i < argc; i++)
+    {
+      if (!strcmp(argv[i], "--port") && i + 1 < argc)
+        port = atoi(argv[++i]);
+    }
+    
+    exitCode = RunNetDSPNode(port) ? 0 : 1;
+    return true;
+  }
+#endif
+  
+  return false;
+}
+
+#pragma mark -
+
 void ApplyFades(double *pBuffer, int nChans, int nFrames, bool down)
 {
   for (int i = 0; i < nChans; i++)
@@ -682,6 +1263,53 @@ void ApplyFades(double *pBuffer, int nChans, int nFrames, bool down)
   }
 }
 
+/** Give the calling thread real-time scheduling, if the driver hasn't already. RTAUDIO_SCHEDULE_REALTIME only covers the callback threads that RtAudio creates itself,
+ * so this covers ASIO's, where the "Pro Audio" MMCSS task gets it serviced ahead of normal threads, and threads on macOS without a time constraint policy */
+static void MakeCallbackThreadRealtime(double sampleRate, uint32_t bufferSize)
+{
+#if defined OS_WIN
+  typedef HANDLE (__stdcall *TAvSetMmThreadCharacteristicsPtr)(LPCWSTR TaskName, LPDWORD TaskIndex);
+  static TAvSetMmThreadCharacteristicsPtr sAvSetMmThreadCharacteristics = nullptr;
+  
+  if (!sAvSetMmThreadCharacteristics)
+  {
+    HMODULE hAvrt = LoadLibraryW(L"AVRT.dll");
+    
+    if (hAvrt)
+      sAvSetMmThreadCharacteristics = (TAvSetMmThreadCharacteristicsPtr) GetProcAddress(hAvrt, "AvSetMmThreadCharacteristicsW");
+  }
+  
+  if (sAvSetMmThreadCharacteristics)
+  {
+    DWORD taskIndex = 0;
+    sAvSetMmThreadCharacteristics(L"Pro Audio", &taskIndex);
+  }
+#elif defined OS_MAC
+  thread_time_constraint_policy_data_t policy;
+  mach_msg_type_number_t count = THREAD_TIME_CONSTRAINT_POLICY_COUNT;
+  boolean_t isDefault = false;
+  thread_port_t thread = mach_thread_self();
+  
+  // the HAL's IO threads already have a time constraint policy, so leave those alone
+  if (thread_policy_get(thread, THREAD_TIME_CONSTRAINT_POLICY, (thread_policy_t) &policy, &count, &isDefault) == KERN_SUCCESS && isDefault)
+  {
+    mach_timebase_info_data_t timebase;
+    mach_timebase_info(&timebase);
+    
+    const double periodNs = 1e9 * bufferSize / sampleRate;
+    const uint32_t period = static_cast<uint32_t>(periodNs * timebase.denom / timebase.numer);
+    
+    policy.period = period;
+    policy.computation = period / 2;
+    policy.constraint = period;
+    policy.preemptible = true;
+    thread_policy_set(thread, THREAD_TIME_CONSTRAINT_POLICY, (thread_policy_t) &policy, THREAD_TIME_CONSTRAINT_POLICY_COUNT);
+  }
+  
+  mach_port_deallocate(mach_task_self(), thread);
+#endif
+}
+
 // static
 int IPlugAPPHost::AudioCallback(void* pOutputBuffer, void* pInputBuffer, uint32_t nFrames, double streamTime, RtAudioStreamStatus status, void* pUserData)
 {
@@ -693,6 +1321,30 @@ int IPlugAPPHost::AudioCallback(void* pOutputBuffer, void* pInputBuffer, uint32_
   double* pInputBufferD = static_cast<double*>(pInputBuffer);
   double* pOutputBufferD = static_cast<double*>(pOutputBuffer);
 
+  static thread_local bool sThreadIsRealtime = false;
+  
+  if (_this->mScheduleRealtime && !sThreadIsRealtime)
+  {
+    MakeCallbackThreadRealtime(_this->mSampleRate, nFrames);
+    sThreadIsRealtime = true;
+  }
+  
+  if (_this->mUseAsyncResampler)
+  {
+    // the input comes from the input device's stream, converted to this stream's rate and clock
+    if (static_cast<size_t>(nFrames) * nins <= _this->mResampledInput.size())
+    {
+      _this->mAsyncResampler.Pull(_this->mResampledInput.data(), nFrames);
+      pInputBufferD = _this->mResampledInput.data();
+    }
+    else
+    {
+      // the device asked for far more than its buffer size, which AsyncResampler can't convert in one go
+      memset(pOutputBufferD, 0, nFrames * nouts * sizeof(double));
+      return 0;
+    }
+  }
+  
   bool startWait = _this->mVecWait >= APP_N_VECTOR_WAIT; // wait APP_N_VECTOR_WAIT * iovs before processing audio, to avoid clicks
   bool doFade = _this->mVecWait == APP_N_VECTOR_WAIT || _this->mAudioEnding;
   
@@ -701,33 +1353,35 @@ int IPlugAPPHost::AudioCallback(void* pOutputBuffer, void* pInputBuffer, uint32_
     if (doFade)
       ApplyFades(pInputBufferD, nins, nFrames, _this->mAudioEnding);
     
-    for (int i = 0; i < nFrames; i++)
+    // the stream is non-interleaved, so the plug-in can process the device's buffers in place,
+    // in one go unless the device delivers more than the block size
+    const int blockSize = _this->mIPlug->GetBlockSize();
+    
+    for (int offset = 0; offset < static_cast<int>(nFrames); offset += blockSize)
     {
-      _this->mBufIndex %= APP_SIGNAL_VECTOR_SIZE;
-
-      if (_this->mBufIndex == 0)
+      const int n = std::min(blockSize, static_cast<int>(nFrames) - offset);
+      
+      for (int c = 0; c < nins; c++)
       {
-        for (int c = 0; c < nins; c++)
-        {
-          _this->mInputBufPtrs.Set(c, (pInputBufferD + (c * nFrames)) + i);
-        }
-        
-        for (int c = 0; c < nouts; c++)
-        {
-          _this->mOutputBufPtrs.Set(c, (pOutputBufferD + (c * nFrames)) + i);
-        }
-        
-        _this->mIPlug->AppProcess(_this->mInputBufPtrs.GetList(), _this->mOutputBufPtrs.GetList(), APP_SIGNAL_VECTOR_SIZE);
-
-        _this->mSamplesElapsed += APP_SIGNAL_VECTOR_SIZE;
+        _this->mInputBufPtrs.Set(c, pInputBufferD + (c * nFrames) + offset);
       }
       
       for (int c = 0; c < nouts; c++)
       {
-        pOutputBufferD[c * nFrames + i] *= APP_MULT;
+        _this->mOutputBufPtrs.Set(c, pOutputBufferD + (c * nFrames) + offset);
       }
-
-      _this->mBufIndex++;
+      
+      _this->mIPlug->AppProcess(_this->mInputBufPtrs.GetList(), _this->mOutputBufPtrs.GetList(), n);
+      
+      _this->mSamplesElapsed += n;
+    }
+    
+    for (int c = 0; c < nouts; c++)
+    {
+      double* pOutput = pOutputBufferD + (c * nFrames);
+      
+      for (int i = 0; i < nFrames; i++)
+        pOutput[i] *= APP_MULT;
     }
     
     if (doFade)
@@ -746,6 +1400,31 @@ int IPlugAPPHost::AudioCallback(void* pOutputBuffer, void* pInputBuffer, uint32_
   return 0;
 }
 
+// static
+int IPlugAPPHost::AudioInputCallback(void* pOutputBuffer, void* pInputBuffer, uint32_t nFrames, double streamTime, RtAudioStreamStatus status, void* pUserData)
+{
+  IPlugAPPHost* _this = (IPlugAPPHost*) pUserData;
+  
+  static thread_local bool sThreadIsRealtime = false;
+  
+  // the input's buffers are the same length of time as the output's, so the output's rate gives the right period
+  if (_this->mScheduleRealtime && !sThreadIsRealtime)
+  {
+    MakeCallbackThreadRealtime(_this->mSampleRate, static_cast<uint32_t>(_this->mBufferSize));
+    sThreadIsRealtime = true;
+  }
+  
+  const double* pInputBufferD = static_cast<const double*>(pInputBuffer);
+  const int nins = static_cast<int>(_this->mResamplerInputPtrs.size());
+  
+  for (int c = 0; c < nins; c++)
+    _this->mResamplerInputPtrs[c] = pInputBufferD + (c * nFrames);
+  
+  _this->mAsyncResampler.Push(_this->mResamplerInputPtrs.data(), nFrames);
+  
+  return 0;
+}
+
 // static
 void IPlugAPPHost::MIDICallback(double deltatime, std::vector<uint8_t>* pMsg, void* pUserData)
 {
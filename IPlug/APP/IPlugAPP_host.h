@@ -33,6 +33,8 @@
 #include <vector>
 #include <limits>
 #include <memory>
+#include <atomic>
+#include <thread>
 
 #include "wdltypes.h"
 #include "wdlstring.h"
@@ -41,6 +43,7 @@
 #include "IPlugConstants.h"
 
 #include "IPlugAPP.h"
+#include "IPlugAPP_resampler.h"
 
 #include "config.h"
 
@@ -100,6 +103,10 @@ public:
     uint32_t mAudioOutChanL;
     uint32_t mAudioOutChanR;
     
+    uint32_t mLowLatency; // RTAUDIO_MINIMIZE_LATENCY
+    uint32_t mExclusive; // RTAUDIO_HOG_DEVICE
+    uint32_t mRealtime; // RTAUDIO_SCHEDULE_REALTIME, plus MMCSS/time constraint scheduling of the callback thread
+    
     AppState()
     : mAudioInDev(DEFAULT_INPUT_DEV)
     , mAudioOutDev(DEFAULT_OUTPUT_DEV)
@@ -115,6 +122,10 @@ public:
     , mAudioInChanR(2)
     , mAudioOutChanL(1)
     , mAudioOutChanR(2)
+    
+    , mLowLatency(0)
+    , mExclusive(0)
+    , mRealtime(0)
     {
     }
     
@@ -133,6 +144,10 @@ public:
     , mAudioInChanR(obj.mAudioInChanR)
     , mAudioOutChanL(obj.mAudioInChanL)
     , mAudioOutChanR(obj.mAudioInChanR)
+    
+    , mLowLatency(obj.mLowLatency)
+    , mExclusive(obj.mExclusive)
+    , mRealtime(obj.mRealtime)
     {
     }
     
@@ -150,7 +165,11 @@ public:
               rhs.mAudioInChanL == mAudioInChanL &&
               rhs.mAudioInChanR == mAudioInChanR &&
               rhs.mAudioOutChanL == mAudioOutChanL &&
-              rhs.mAudioOutChanR == mAudioOutChanR
+              rhs.mAudioOutChanR == mAudioOutChanR &&
+              
+              rhs.mLowLatency == mLowLatency &&
+              rhs.mExclusive == mExclusive &&
+              rhs.mRealtime == mRealtime
 
       );
     }
@@ -160,6 +179,43 @@ public:
   static IPlugAPPHost* Create();
   static std::unique_ptr<IPlugAPPHost> sInstance;
   
+  /** Render WAV files through the plug-in's default state, with no audio or MIDI devices open, as fast as possible with IPlugProcessor::GetRenderingOffline() set.
+   * The output is compensated for the plug-in's latency and extended by its tail. Each thread has its own instance of the plug-in, and renders the next file in the list until there are none left
+   * @param inputPaths The WAV files to render, which may be PCM or floating point, at any sample rate
+   * @param outputFolder The folder to write to, or nullptr/empty to write "name-render.wav" alongside each input. Outputs are 24 bit, and at most stereo, as WaveWriter supports
+   * @param nThreads The number of files to render at a time
+   * @return \c true if every file rendered */
+  static bool RenderOffline(const std::vector<std::string>& inputPaths, const char* outputFolder, int nThreads = 1);
+  
+  /** Benchmark settings for Benchmark() */
+  struct BenchmarkConfig
+  {
+    std::vector<int> mSampleRates {44100, 96000};
+    std::vector<int> mBlockSizes {32, 64, 512};
+    double mSeconds = 10.; // of audio per sample rate and block size, after a second of warm up
+    bool mMidi = true; // play notes, if the plug-in takes MIDI
+    bool mAutomation = true; // move each parameter in turn, one change per block
+  };
+  
+  /** Time the plug-in's ProcessBlock() on synthetic audio (white noise), MIDI and automation input, with no audio or MIDI devices open, printing a line per sample rate and block size to stdout with
+   * the mean ns/sample, the worst block's time, and that as a percentage of the block's real-time duration. The number of allocations inside ProcessBlock() is also printed, when the
+   * plug-in is built with IPLUG_COUNT_AUDIO_THREAD_ALLOCATIONS
+   * @return \c true if the plug-in kept up with real-time in every block */
+  static bool Benchmark(const BenchmarkConfig& config);
+  
+#ifdef APP_NETDSP_NODE
+  /** Run the plug-in headless as an INetDSPNode, processing the audio that an INetDSPClient in another copy of the plug-in sends, and sending it back. This doesn't return unless the port can't be opened
+   * @param port The UDP port to listen on
+   * @return \c false if the port can't be opened */
+  static bool RunNetDSPNode(int port);
+#endif
+  
+  /** Handles command lines that run the app headless, without opening its window, so that it can be used in scripts:
+   * "--render [--threads N] [--out folder] file.wav ..." runs RenderOffline(), and "--benchmark [--sr 44100,48000] [--block 64,512] [--seconds N] [--no-midi] [--no-automation]" runs Benchmark().
+   * When built with APP_NETDSP_NODE, "--netdsp-node [--port N]" runs RunNetDSPNode()
+   * @return \c true if the command line asked for one of these, with exitCode set to the process exit code */
+  static bool RunFromCommandLine(int argc, char** argv, int& exitCode);
+  
   void PopulateSampleRateList(HWND hwndDlg, RtAudio::DeviceInfo* pInputDevInfo, RtAudio::DeviceInfo* pOutputDevInfo);
   void PopulateAudioInputList(HWND hwndDlg, RtAudio::DeviceInfo* pInfo);
   void PopulateAudioOutputList(HWND hwndDlg, RtAudio::DeviceInfo* pInfo);
@@ -200,6 +256,11 @@ public:
   bool InitMidi();
   void CloseAudio();
   bool InitAudio(uint32_t inId, uint32_t outId, uint32_t sr, uint32_t iovs);
+  
+  /** When the input device is a different device to the output, and can't run at the output's sample rate, it gets its own stream at a rate it does support,
+   * and its audio is converted to the output's rate and clock by an AsyncResampler
+   * @return The sample rate to run the input device at, which is sr unless it needs converting */
+  uint32_t GetInputSampleRate(uint32_t inId, uint32_t outId, uint32_t sr);
   bool AudioSettingsInStateAreEqual(AppState& os, AppState& ns);
   bool MIDISettingsInStateAreEqual(AppState& os, AppState& ns);
 
@@ -207,7 +268,11 @@ public:
   bool TryToChangeAudio();
   bool SelectMIDIDevice(ERoute direction, const char* portName);
   
+  bool RenderFile(const char* inputPath, const char* outputPath);
+  
   static int AudioCallback(void* pOutputBuffer, void* pInputBuffer, uint32_t nFrames, double streamTime, RtAudioStreamStatus status, void* pUserData);
+  /** The input stream's callback, when the input device runs at a different sample rate to the output device */
+  static int AudioInputCallback(void* pOutputBuffer, void* pInputBuffer, uint32_t nFrames, double streamTime, RtAudioStreamStatus status, void* pUserData);
   static void MIDICallback(double deltatime, std::vector<uint8_t>* pMsg, void* pUserData);
   static void ErrorCallback(RtAudioError::Type type, const std::string& errorText);
 
@@ -218,6 +283,8 @@ public:
 private:
   std::unique_ptr<IPlugAPP> mIPlug = nullptr;
   std::unique_ptr<RtAudio> mDAC = nullptr;
+  /** The input device's own stream, when it is resampled to the output device's rate, otherwise nullptr */
+  std::unique_ptr<RtAudio> mInputDAC = nullptr;
   std::unique_ptr<RtMidiIn> mMidiIn = nullptr;
   std::unique_ptr<RtMidiOut> mMidiOut = nullptr;
   int mMidiOutChannel = -1;
@@ -234,10 +301,10 @@ private:
   uint32_t mSamplesElapsed = 0;
   uint32_t mVecWait = 0;
   uint32_t mBufferSize = 512;
-  uint32_t mBufIndex = 0; // index for signal vector, loops from 0 to mSigVS
   bool mExiting = false;
   bool mAudioEnding = false;
   bool mAudioDone = false;
+  bool mScheduleRealtime = false;
 
   /** The index of the operating systems default input device, -1 if not detected */
   int32_t mDefaultInputDev = -1;
@@ -254,6 +321,12 @@ private:
   
   WDL_PtrList<double> mInputBufPtrs;
   WDL_PtrList<double> mOutputBufPtrs;
+  
+  AsyncResampler mAsyncResampler;
+  bool mUseAsyncResampler = false;
+  uint32_t mInputBufferSize = 512;
+  std::vector<const double*> mResamplerInputPtrs;
+  std::vector<double> mResampledInput;
 
   friend class IPlugAPP;
 };
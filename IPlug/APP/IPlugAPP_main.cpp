@@ -34,6 +34,11 @@ int WINAPI WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR lpszCmdPa
 {
   try
   {
+    int exitCode = 0;
+    
+    if (IPlugAPPHost::RunFromCommandLine(__argc, __argv, exitCode)) // headless, so doesn't need the single instance check
+      return exitCode;
+    
 #ifndef APP_ALLOW_MULTIPLE_INSTANCES
     HANDLE hMutex = OpenMutex(MUTEX_ALL_ACCESS, 0, BUNDLE_NAME); // BUNDLE_NAME used because it won't have spaces in it
     
@@ -167,6 +172,11 @@ int main(int argc, char *argv[])
   if(AppIsSandboxed())
     DBGMSG("App is sandboxed, file system access etc restricted!\n");
   
+  int exitCode = 0;
+  
+  if (IPlugAPPHost::RunFromCommandLine(argc, argv, exitCode))
+    return exitCode;
+  
   return NSApplicationMain(argc,  (const char **) argv);
 }
 
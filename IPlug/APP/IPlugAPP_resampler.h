@@ -0,0 +1,251 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc AsyncResampler
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "resample.h"
+
+#include "IPlugPlatform.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+static_assert(sizeof(WDL_ResampleSample) == sizeof(double), "AsyncResampler copies doubles into WDL_Resampler's buffer");
+
+/** Converts audio between two devices that run on different clocks, for the standalone app when the input device can't run at the output device's sample rate.
+ * The input device's callback Push()es its audio into a lock free FIFO, and the output device's callback Pull()s the same number of frames as it plays, resampled with WDL_Resampler.
+ * The two clocks never run at exactly their nominal ratio, so the FIFO's fill level is tracked, and the ratio is trimmed to hold it at a target of about one buffer of each device,
+ * which is all the latency that is added besides the resampler's short sinc filter. The sinc filter uses WDL_Resampler's SSE/AVX path where it is built with one, and its length is kept short
+ * so that its latency is a few samples. Both callbacks run without locks or allocations; an under or overrun (a device stopping, or a glitch) outputs silence until the FIFO refills */
+class AsyncResampler
+{
+public:
+  /** Allocate, call before either device's stream starts
+   * @param nChans The number of channels
+   * @param inputRate The input device's sample rate
+   * @param outputRate The output device's sample rate
+   * @param inputBlockSize The input device's buffer size
+   * @param outputBlockSize The output device's buffer size
+   * @param sincSize The number of sinc filter taps, more for less aliasing but more latency and CPU */
+  void Init(int nChans, double inputRate, double outputRate, int inputBlockSize, int outputBlockSize, int sincSize = 16)
+  {
+    mNChans = std::max(nChans, 1);
+    mInputRate = inputRate;
+    mOutputRate = outputRate;
+
+    // the fill level swings by a buffer of each device between callbacks, the minimum it reaches has to cover what Pull() reads, plus the filter
+    const int outputBlockAtInputRate = static_cast<int>(outputBlockSize * inputRate / outputRate) + 1;
+    mTarget = inputBlockSize + outputBlockAtInputRate + sincSize;
+
+    int capacity = 1;
+
+    while (capacity < 4 * (mTarget + inputBlockSize + outputBlockAtInputRate))
+      capacity <<= 1;
+
+    mFIFO.assign(static_cast<size_t>(capacity) * mNChans, 0.);
+    mMask = capacity - 1;
+    mMaxFrames = outputBlockSize * 2;
+    mScratch.assign(static_cast<size_t>(mMaxFrames) * mNChans, 0.);
+
+    mResampler.SetMode(false, 0, true, sincSize, 32);
+    mResampler.SetFeedMode(false);
+
+    Reset();
+
+    // a worst case prepare, so that WDL_Resampler sizes its input buffer now rather than on the audio thread
+    WDL_ResampleSample* pIn;
+    mResampler.ResamplePrepare(mMaxFrames, mNChans, &pIn);
+    mResampler.Reset();
+  }
+
+  /** Empty the FIFO and wait for it to fill again. Only call this when neither callback is running */
+  void Reset()
+  {
+    mWritePos.store(0, std::memory_order_relaxed);
+    mReadPos.store(0, std::memory_order_relaxed);
+    mPriming = true;
+    mAverageFill = mTarget;
+    mIntegral = 0.;
+    mCorrection = 0.;
+    mResampler.Reset();
+    mResampler.SetRates(mInputRate, mOutputRate);
+  }
+
+  /** Called by the input device's callback
+   * @param pInputs Non-interleaved input, one pointer per channel
+   * @param nFrames The number of frames */
+  void Push(const double* const* pInputs, int nFrames)
+  {
+    const uint64_t writePos = mWritePos.load(std::memory_order_relaxed);
+    const uint64_t readPos = mReadPos.load(std::memory_order_acquire);
+    const int space = static_cast<int>(mMask + 1 - (writePos - readPos));
+
+    if (nFrames > space)
+    {
+      mNumOverruns.fetch_add(1, std::memory_order_relaxed);
+      return; // Pull() hasn't kept up, so it drops whole buffers until it has caught up
+    }
+
+    for (int s = 0; s < nFrames; s++)
+    {
+      double* pFrame = mFIFO.data() + ((writePos + s) & mMask) * mNChans;
+
+      for (int c = 0; c < mNChans; c++)
+        pFrame[c] = pInputs[c][s];
+    }
+
+    mWritePos.store(writePos + nFrames, std::memory_order_release);
+  }
+
+  /** Called by the output device's callback, to get the input resampled to the output's rate
+   * @param pOutput Non-interleaved output, nFrames per channel, one channel after another
+   * @param nFrames The output device's number of frames */
+  void Pull(double* pOutput, int nFrames)
+  {
+    const uint64_t readPos = mReadPos.load(std::memory_order_relaxed);
+    const uint64_t writePos = mWritePos.load(std::memory_order_acquire);
+    const int fill = static_cast<int>(writePos - readPos);
+
+    if (mPriming)
+    {
+      if (fill < mTarget)
+      {
+        memset(pOutput, 0, sizeof(double) * nFrames * mNChans);
+        return;
+      }
+
+      // start from the target, so there's no correction to settle
+      mReadPos.store(writePos - mTarget, std::memory_order_release);
+      Restart();
+      PullFromFIFO(pOutput, nFrames);
+      return;
+    }
+
+    // the fill level is a saw tooth, as the two devices' buffers arrive, so its average is what the two clocks are doing.
+    // The loop is a PI controller in seconds, so it behaves the same for any buffer sizes, critically damped to settle in a few seconds without overshoot
+    const double dt = nFrames / mOutputRate;
+    mAverageFill += (fill - mAverageFill) * std::min(dt / kAverageTime, 1.);
+    const double error = (mAverageFill - mTarget) / mInputRate; // seconds of audio too many in the FIFO
+    mIntegral = Clip(mIntegral + error * kIntegralGain * dt, -kMaxCorrection, kMaxCorrection);
+    mCorrection = Clip(error * kProportionalGain + mIntegral, -kMaxCorrection, kMaxCorrection);
+
+    // reading faster when the FIFO is fuller than the target
+    mResampler.SetRates(mInputRate * (1. + mCorrection), mOutputRate);
+
+    PullFromFIFO(pOutput, nFrames);
+  }
+
+  /** @return The latency added, in output frames, at the target fill level */
+  int GetLatency() const { return static_cast<int>(mTarget * mOutputRate / mInputRate); }
+
+  /** @return The ratio trim that is tracking the drift between the devices' clocks, e.g. 0.0001 when the input is running 100ppm faster than its nominal rate relative to the output */
+  double GetDriftCorrection() const { return mCorrection; }
+
+  /** @return The number of input buffers dropped because the FIFO was full */
+  int GetNumOverruns() const { return mNumOverruns.load(std::memory_order_relaxed); }
+
+  /** @return The number of times the FIFO ran dry */
+  int GetNumUnderruns() const { return mNumUnderruns.load(std::memory_order_relaxed); }
+
+private:
+  static constexpr double kAverageTime = 0.5; // seconds
+  static constexpr double kProportionalGain = 0.6; // per second
+  static constexpr double kIntegralGain = 0.09; // per second squared
+  static constexpr double kMaxCorrection = 0.005; // 5000ppm, far more than real clocks drift, but a bound on how far a glitch can bend the pitch
+
+  static double Clip(double x, double lo, double hi) { return std::min(std::max(x, lo), hi); }
+
+  // restart the control loop after priming, keeping the integral, which holds the clocks' drift
+  void Restart()
+  {
+    mPriming = false;
+    mAverageFill = mTarget;
+    mResampler.Reset();
+    mResampler.SetRates(mInputRate * (1. + mCorrection), mOutputRate);
+  }
+
+  void PullFromFIFO(double* pOutput, int nFrames)
+  {
+    if (nFrames > mMaxFrames)
+    {
+      // the device asked for more than it said it would, which is rare enough that the overflow is output as silence
+      memset(pOutput, 0, sizeof(double) * nFrames * mNChans);
+      return;
+    }
+
+    WDL_ResampleSample* pIn;
+    const int nIn = mResampler.ResamplePrepare(nFrames, mNChans, &pIn);
+
+    const uint64_t readPos = mReadPos.load(std::memory_order_relaxed);
+    const uint64_t writePos = mWritePos.load(std::memory_order_acquire);
+
+    if (static_cast<int>(writePos - readPos) < nIn)
+    {
+      mNumUnderruns.fetch_add(1, std::memory_order_relaxed);
+      mPriming = true;
+      memset(pOutput, 0, sizeof(double) * nFrames * mNChans);
+      return;
+    }
+
+    for (int s = 0; s < nIn; s++)
+    {
+      const double* pFrame = mFIFO.data() + ((readPos + s) & mMask) * mNChans;
+      memcpy(pIn + s * mNChans, pFrame, sizeof(double) * mNChans);
+    }
+
+    mReadPos.store(readPos + nIn, std::memory_order_release);
+
+    const int nOut = mResampler.ResampleOut(mScratch.data(), nIn, nFrames, mNChans);
+
+    for (int c = 0; c < mNChans; c++)
+    {
+      double* pChan = pOutput + c * nFrames;
+
+      for (int s = 0; s < nOut; s++)
+        pChan[s] = mScratch[s * mNChans + c];
+
+      for (int s = nOut; s < nFrames; s++)
+        pChan[s] = 0.;
+    }
+  }
+
+  WDL_Resampler mResampler;
+  std::vector<double> mFIFO; // interleaved, at the input rate
+  std::vector<double> mScratch; // interleaved, at the output rate
+  uint64_t mMask = 0;
+  std::atomic<uint64_t> mWritePos {0};
+  std::atomic<uint64_t> mReadPos {0};
+  std::atomic<int> mNumOverruns {0};
+  std::atomic<int> mNumUnderruns {0};
+
+  int mNChans = 1;
+  double mInputRate = 44100.;
+  double mOutputRate = 44100.;
+  int mTarget = 0;
+  int mMaxFrames = 0;
+
+  // only used by Pull()
+  bool mPriming = true;
+  double mAverageFill = 0.;
+  double mIntegral = 0.;
+  double mCorrection = 0.;
+};
+
+END_IPLUG_NAMESPACE
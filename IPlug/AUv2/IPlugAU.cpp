@@ -10,6 +10,7 @@
 
 #include <algorithm>
 #include <CoreMIDI/CoreMIDI.h>
+#include <Block.h>
 
 #include "heapbuf.h"
 
@@ -77,7 +78,7 @@ inline void IPlugAU::PutStrInDict(CFMutableDictionaryRef pDict, const char* key,
   CFDictionarySetValue(pDict, cfKey.Get(), cfValue.Get());
 }
 
-inline void IPlugAU::PutDataInDict(CFMutableDictionaryRef pDict, const char* key, IByteChunk* pChunk)
+inline void IPlugAU::PutDataInDict(CFMutableDictionaryRef pDict, const char* key, const IByteChunk* pChunk)
 {
   CFStrLocal cfKey(key);
   CFDataRef pData = CFDataCreate(0, pChunk->GetData(), pChunk->Size());
@@ -527,7 +528,6 @@ OSStatus IPlugAU::GetProperty(AudioUnitPropertyID propID, AudioUnitScope scope,
         memset(pInfo, 0, sizeof(AudioUnitParameterInfo));
         pInfo->flags = kAudioUnitParameterFlag_CFNameRelease |
                        kAudioUnitParameterFlag_HasCFNameString |
-                       kAudioUnitParameterFlag_IsWritable |
                        kAudioUnitParameterFlag_IsReadable;
         
         #ifndef IPLUG1_COMPATIBILITY
@@ -537,7 +537,10 @@ OSStatus IPlugAU::GetProperty(AudioUnitPropertyID propID, AudioUnitScope scope,
         ENTER_PARAMS_MUTEX
         IParam* pParam = GetParam(element);
         
-        if (!pParam->GetCanAutomate())  pInfo->flags |= kAudioUnitParameterFlag_NonRealTime;
+        // output parameters, like meters, are read only for the host
+        if (pParam->GetIsOutput()) pInfo->flags |= kAudioUnitParameterFlag_MeterReadOnly;
+        else pInfo->flags |= kAudioUnitParameterFlag_IsWritable;
+        if (!pParam->GetCanAutomate() && !pParam->GetIsOutput())  pInfo->flags |= kAudioUnitParameterFlag_NonRealTime;
         if (pParam->GetMeta()) pInfo->flags |= kAudioUnitParameterFlag_IsElementMeta;
         if (pParam->NDisplayTexts()) pInfo->flags |= kAudioUnitParameterFlag_ValuesHaveStrings;
 
@@ -1097,6 +1100,33 @@ OSStatus IPlugAU::GetProperty(AudioUnitPropertyID propID, AudioUnitScope scope,
       }
       return noErr;
     }
+#if defined(__MAC_11_0)
+    case kAudioUnitProperty_RenderContextObserver: // 60
+    {
+      if (__builtin_available(macOS 11.0, *))
+      {
+        if (pData == 0)
+        {
+          *pWriteable = false;
+          *pDataSize = sizeof(AURenderContextObserver);
+        }
+        else
+        {
+          // the host calls this before rendering on a new thread or device, with the workgroup that the plug-in's worker threads should join
+          if (!mRenderContextObserver)
+          {
+            mRenderContextObserver = Block_copy(^(const AudioUnitRenderContext* pContext) {
+              mAudioWorkgroup.SetOSWorkgroup(pContext ? (void*) pContext->workgroup : nullptr);
+            });
+          }
+
+          *((AURenderContextObserver*) pData) = (AURenderContextObserver) mRenderContextObserver;
+        }
+        return noErr;
+      }
+      return kAudioUnitErr_InvalidProperty;
+    }
+#endif
     default:
     {
       return kAudioUnitErr_InvalidProperty;
@@ -1164,7 +1194,8 @@ OSStatus IPlugAU::SetProperty(AudioUnitPropertyID propID, AudioUnitScope scope,
     case kAudioUnitProperty_SampleRate:                  // 2,
     {
       SetSampleRate(*((Float64*) pData));
-      OnReset();
+      EnsureDeferredInit();
+      ResetFromAPI();
       return noErr;
     }
     NO_OP(kAudioUnitProperty_ParameterList);             // 3,
@@ -1213,7 +1244,8 @@ OSStatus IPlugAU::SetProperty(AudioUnitPropertyID propID, AudioUnitScope scope,
     {
       SetBlockSize(*((UInt32*) pData));
       ResizeScratchBuffers();
-      OnReset();
+      EnsureDeferredInit();
+      ResetFromAPI();
       return noErr;
     }
     NO_OP(kAudioUnitProperty_SetExternalBuffer);         // 15,
@@ -1227,8 +1259,9 @@ OSStatus IPlugAU::SetProperty(AudioUnitPropertyID propID, AudioUnitScope scope,
       SetBypassed(bypassed);
       
       // TODO: should the following be called here?
+      EnsureDeferredInit();
       OnActivate(!bypassed);
-      OnReset();
+      ResetFromAPI();
       return noErr;
     }
     NO_OP(kAudioUnitProperty_LastRenderError);           // 22,
@@ -1452,12 +1485,12 @@ OSStatus IPlugAU::GetState(CFPropertyListRef* ppPropList)
   PutNumberInDict(pDict, kAUPresetManufacturerKey, &(plugManID), kCFNumberSInt32Type);
   PutStrInDict(pDict, kAUPresetNameKey, GetPresetName(GetCurrentPresetIdx()));
 
-  IByteChunk chunk;
   //InitChunkWithIPlugVer(&IPlugChunk); // TODO: IPlugVer should be in chunk!
+  const IByteChunk* pChunk = GetStateSnapshot();
 
-  if (SerializeState(chunk))
+  if (pChunk)
   {
-    PutDataInDict(pDict, kAUPresetDataKey, &chunk);
+    PutDataInDict(pDict, kAUPresetDataKey, pChunk);
   }
 
   *ppPropList = pDict;
@@ -1496,7 +1529,7 @@ OSStatus IPlugAU::SetState(CFPropertyListRef pPropList)
   //  int pos;
   //  IByteChunk::GetIPlugVerFromChunk(chunk, pos)
   
-  if (!UnserializeState(chunk, 0))
+  if (!UnserializeStateSnapshot(chunk, 0))
   {
     return kAudioUnitErr_InvalidPropertyValue;
   }
@@ -1617,10 +1650,9 @@ OSStatus IPlugAU::RenderProc(void* pPlug, AudioUnitRenderActionFlags* pFlags, co
     // Pull input buffers.
     if (renderSampleTime != _this->mLastRenderSampleTime)
     {
-      BufferList bufList;
-      AudioBufferList* pInBufList = (AudioBufferList*) &bufList;
-
       int nIn = _this->mInBuses.GetSize();
+      _this->mNInPlaceBufs = 0;
+      bool sidechainSilent = nIn > 1;
 
       for (int i = 0; i < nIn; ++i)
       {
@@ -1629,12 +1661,20 @@ OSStatus IPlugAU::RenderProc(void* pPlug, AudioUnitRenderActionFlags* pFlags, co
 
         if (pInBus->mConnected)
         {
-          pInBufList->mNumberBuffers = pInBus->mNHostChannels;
+          AudioBufferList* pInBufList = (AudioBufferList*) &(pInBusConn->mBufList);
+
+          // the layout only changes with the channel count, but upstream units may replace the data pointers with their own, so those are reset every time
+          if (pInBufList->mNumberBuffers != pInBus->mNHostChannels)
+          {
+            pInBufList->mNumberBuffers = pInBus->mNHostChannels;
+
+            for (int b = 0; b < pInBufList->mNumberBuffers; ++b)
+              pInBufList->mBuffers[b].mNumberChannels = 1;
+          }
 
           for (int b = 0; b < pInBufList->mNumberBuffers; ++b)
           {
             AudioBuffer* pBuffer = &(pInBufList->mBuffers[b]);
-            pBuffer->mNumberChannels = 1;
             pBuffer->mDataByteSize = nFrames * sizeof(AudioSampleType);
             pBuffer->mData = 0;
           }
@@ -1675,12 +1715,24 @@ OSStatus IPlugAU::RenderProc(void* pPlug, AudioUnitRenderActionFlags* pFlags, co
             return r;   // Something went wrong upstream.
           }
 
+          if (i > 0 && !(flags & kAudioUnitRenderAction_OutputIsSilence))
+            sidechainSilent = false;
+
           for (int c = 0, chIdx = pInBus->mPlugChannelStartIdx; c < pInBus->mNHostChannels; ++c, ++chIdx)
           {
             _this->AttachBuffers(ERoute::kInput, chIdx, 1, (AudioSampleType**) &(pInBufList->mBuffers[c].mData), nFrames);
           }
+
+          if (i == 0)
+          {
+            _this->mNInPlaceBufs = std::min(pInBus->mNHostChannels, _this->mInPlaceBufs.GetSize());
+
+            for (int c = 0; c < _this->mNInPlaceBufs; ++c)
+              _this->mInPlaceBufs.Get()[c] = (AudioSampleType*) pInBufList->mBuffers[c].mData;
+          }
         }
       }
+      _this->SetSidechainSilent(sidechainSilent);
       _this->mLastRenderSampleTime = renderSampleTime;
     }
   
@@ -1702,7 +1754,13 @@ OSStatus IPlugAU::RenderProc(void* pPlug, AudioUnitRenderActionFlags* pFlags, co
     for (int c = 0, chIdx = pOutBus->mPlugChannelStartIdx; c < pOutBufList->mNumberBuffers; ++c, ++chIdx)
     {
       if (!(pOutBufList->mBuffers[c].mData)) // Downstream unit didn't give us buffers.
-        pOutBufList->mBuffers[c].mData = _this->mOutScratchBuf.Get() + chIdx * nFrames;
+      {
+        // process in-place in the input buffers where there are any, as AUEffectBase does, rather than in the scratch buffers
+        if (outputBusIdx == 0 && c < _this->mNInPlaceBufs && _this->mInPlaceBufs.Get()[c])
+          pOutBufList->mBuffers[c].mData = _this->mInPlaceBufs.Get()[c];
+        else
+          pOutBufList->mBuffers[c].mData = _this->mOutScratchBuf.Get() + chIdx * nFrames;
+      }
 
       _this->AttachBuffers(ERoute::kOutput, chIdx, 1, (AudioSampleType**) &(pOutBufList->mBuffers[c].mData), nFrames);
     }
@@ -1743,7 +1801,7 @@ OSStatus IPlugAU::RenderProc(void* pPlug, AudioUnitRenderActionFlags* pFlags, co
         
         while (_this->mMidiMsgsFromEditor.Pop(msg))
         {
-          _this->ProcessMidiMsg(msg);
+          _this->ScheduleMidiMsg(msg);
         }
       }
       
@@ -1877,6 +1935,9 @@ IPlugAU::~IPlugAU()
   mOutBuses.Empty(true);
   mInBusConnections.Empty(true);
   mPropertyListeners.Empty(true);
+
+  if (mRenderContextObserver)
+    Block_release(mRenderContextObserver);
 }
 
 void IPlugAU::SendAUEvent(AudioUnitEventType type, AudioComponentInstance ci, int idx)
@@ -1903,6 +1964,11 @@ void IPlugAU::InformHostOfParamChange(int idx, double normalizedValue)
   SendAUEvent(kAudioUnitEvent_ParameterValueChange, mCI, idx);
 }
 
+void IPlugAU::InformHostOfOutputParamChange(int idx, double normalizedValue)
+{
+  SendAUEvent(kAudioUnitEvent_ParameterValueChange, mCI, idx);
+}
+
 void IPlugAU::EndInformHostOfParamChange(int idx)
 {
   Trace(TRACELOC, "%d", idx);
@@ -1982,6 +2048,8 @@ void IPlugAU::ResizeScratchBuffers()
   mOutScratchBuf.Resize(NOutputs);
   memset(mInScratchBuf.Get(), 0, NInputs * sizeof(AudioSampleType));
   memset(mOutScratchBuf.Get(), 0, NOutputs * sizeof(AudioSampleType));
+  mInPlaceBufs.Resize(MaxNChannels(ERoute::kInput));
+  mNInPlaceBufs = 0;
 }
 
 void IPlugAU::InformListeners(AudioUnitPropertyID propID, AudioUnitScope scope)
@@ -2018,7 +2086,7 @@ bool IPlugAU::SendMidiMsg(const IMidiMsg& msg)
   packetList.packet[0].data[1] = msg.mData1;
   packetList.packet[0].data[2] = msg.mData2;
   packetList.packet[0].length = 3;
-  packetList.packet[0].timeStamp = msg.mOffset;
+  packetList.packet[0].timeStamp = msg.mOffset + GetSegmentStart();
   packetList.numPackets = 1;
   
   if(mMidiCallback.midiOutputCallback)
@@ -2081,7 +2149,7 @@ bool IPlugAU::SendSysEx(const ISysEx& sysEx)
   
   while (bytesLeft) {
     ByteCount packetSize = listSize < 256 ? listSize : 256;
-    pPkt = MIDIPacketListAdd(pPktlist, listSize, pPkt, sysEx.mOffset /* TODO: is this correct? */, packetSize, sysEx.mData);
+    pPkt = MIDIPacketListAdd(pPktlist, listSize, pPkt, sysEx.mOffset + GetSegmentStart() /* TODO: is this correct? */, packetSize, sysEx.mData);
     bytesLeft -= packetSize;
   }
   
@@ -2255,6 +2323,7 @@ OSStatus IPlugAU::DoInitialize(IPlugAU* _this)
 
   _this->mActive = true;
   _this->OnParamReset(kReset);
+  _this->EnsureDeferredInit();
   _this->OnActivate(true);
   
   return noErr;
@@ -2439,7 +2508,8 @@ OSStatus IPlugAU::DoRender(IPlugAU* _this, AudioUnitRenderActionFlags* ioActionF
 //static
 OSStatus IPlugAU::DoReset(IPlugAU* _this)
 {
-  _this->OnReset();
+  _this->EnsureDeferredInit();
+  _this->ResetFromAPI();
   return noErr;
 }
 
@@ -2453,7 +2523,7 @@ OSStatus IPlugAU::DoMIDIEvent(IPlugAU* _this, UInt32 inStatus, UInt32 inData1, U
     msg.mData1 = inData1;
     msg.mData2 = inData2;
     msg.mOffset = inOffsetSampleFrame;
-    _this->ProcessMidiMsg(msg);
+    _this->ScheduleMidiMsg(msg);
     _this->mMidiMsgsFromProcessor.Push(msg);
     return noErr;
   }
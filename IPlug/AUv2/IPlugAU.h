@@ -64,6 +64,7 @@ public:
   void BeginInformHostOfParamChange(int idx) override;
   void InformHostOfParamChange(int idx, double normalizedValue) override;
   void EndInformHostOfParamChange(int idx) override;
+  void InformHostOfOutputParamChange(int idx, double normalizedValue) override;
   void InformHostOfPresetChange() override;
   void InformHostOfParameterDetailsChange() override;
   
@@ -116,6 +117,8 @@ private:
     AudioUnitRenderProc mUpstreamRenderProc;
     AURenderCallbackStruct mUpstreamRenderCallback;
     EAUInputType mInputType;
+    /** The buffer list that input is pulled into, whose layout is kept between renders. It is cleared with the rest of the connection */
+    BufferList mBufList;
   };
   
   struct PropertyListener
@@ -194,7 +197,7 @@ protected:
 
   static void PutNumberInDict(CFMutableDictionaryRef pDict, const char* key, void* pNumber, CFNumberType type);
   static void PutStrInDict(CFMutableDictionaryRef pDict, const char* key, const char* value);
-  static void PutDataInDict(CFMutableDictionaryRef pDict, const char* key, IByteChunk* pChunk);
+  static void PutDataInDict(CFMutableDictionaryRef pDict, const char* key, const IByteChunk* pChunk);
   static bool GetNumberFromDict(CFDictionaryRef pDict, const char* key, void* pNumber, CFNumberType type);
   static bool GetStrFromDict(CFDictionaryRef pDict, const char* key, char* value);
   static bool GetDataFromDict(CFDictionaryRef pDict, const char* key, IByteChunk* pChunk);
@@ -213,10 +216,15 @@ private:
   WDL_PtrList<PropertyListener> mPropertyListeners;
   WDL_TypedBuf<AudioSampleType> mInScratchBuf;
   WDL_TypedBuf<AudioSampleType> mOutScratchBuf;
+  /** The buffers pulled for input bus 0 in the current render cycle, which output bus 0 is processed into in-place when the host doesn't supply output buffers */
+  WDL_TypedBuf<AudioSampleType*> mInPlaceBufs;
+  int mNInPlaceBufs = 0;
   WDL_PtrList<AURenderCallbackStruct> mRenderNotify;
   AUMIDIOutputCallbackStruct mMidiCallback;
   AudioTimeStamp mLastRenderTimeStamp;
   WDL_String mTrackName;
+  /** The AURenderContextObserver block returned for kAudioUnitProperty_RenderContextObserver, made on first request and owned by the plug-in */
+  void* mRenderContextObserver = nullptr;
   template <class Plug, bool DoesMIDIIn>
   friend class IPlugAUFactory;
 };
@@ -23,6 +23,9 @@ struct BufferedAudioBus {
     AudioBufferList const* originalAudioBufferList = nullptr;
     AudioBufferList* mutableAudioBufferList = nullptr;
 
+    // true once the channel layout of mutableAudioBufferList has been written, see prepareInputBufferList()
+    bool layoutPrepared = false;
+
     void init(AVAudioFormat* defaultFormat, AVAudioChannelCount maxChannels) {
         maxFrames = 0;
         pcmBuffer = nullptr;
@@ -41,6 +44,7 @@ struct BufferedAudioBus {
 
         originalAudioBufferList = pcmBuffer.audioBufferList;
         mutableAudioBufferList = pcmBuffer.mutableAudioBufferList;
+        layoutPrepared = false;
     }
     
     void deallocateRenderResources() {
@@ -55,17 +59,22 @@ struct BufferedAudioBus {
 /*
  BufferedOutputBus
  
- This class provides a prepareOutputBufferList method to copy the internal buffer pointers
+ This class provides a prepareOutputBufferList method to copy the input or internal buffer pointers
  to the output buffer list in case the client passed in null buffer pointers.
  */
 struct BufferedOutputBus: BufferedAudioBus {
-    void prepareOutputBufferList(AudioBufferList* outBufferList, AVAudioFrameCount frameCount, bool zeroFill) {
+    void prepareOutputBufferList(AudioBufferList* outBufferList, AVAudioFrameCount frameCount, bool zeroFill, AudioBufferList const* inPlaceBufferList = nullptr) {
         UInt32 byteSize = frameCount * sizeof(float);
         for (UInt32 i = 0; i < outBufferList->mNumberBuffers; ++i) {
             outBufferList->mBuffers[i].mNumberChannels = originalAudioBufferList->mBuffers[i].mNumberChannels;
             outBufferList->mBuffers[i].mDataByteSize = byteSize;
             if (outBufferList->mBuffers[i].mData == nullptr) {
-                outBufferList->mBuffers[i].mData = originalAudioBufferList->mBuffers[i].mData;
+                // if the host passes null buffers, process in-place in the input buffers where there are any
+                if (inPlaceBufferList && i < inPlaceBufferList->mNumberBuffers && inPlaceBufferList->mBuffers[i].mData) {
+                    outBufferList->mBuffers[i].mData = inPlaceBufferList->mBuffers[i].mData;
+                } else {
+                    outBufferList->mBuffers[i].mData = originalAudioBufferList->mBuffers[i].mData;
+                }
             }
             if (zeroFill) {
                 memset(outBufferList->mBuffers[i].mData, 0, byteSize);
@@ -119,16 +128,26 @@ struct BufferedInputBus : BufferedAudioBus {
      pointers from the originalAudioBufferList.
      
      The upstream audio unit may overwrite these with its own pointers, so each
-     render cycle this function needs to be called to reset them.
+     render cycle this function needs to be called to reset them. The channel
+     layout is only written when the buffers are allocated.
      */
     void prepareInputBufferList(UInt32 frameCount) {
         UInt32 byteSize = std::min(frameCount, maxFrames) * sizeof(float);
-        mutableAudioBufferList->mNumberBuffers = originalAudioBufferList->mNumberBuffers;
+        const UInt32 numBuffers = originalAudioBufferList->mNumberBuffers;
 
-        for (UInt32 i = 0; i < originalAudioBufferList->mNumberBuffers; ++i) {
-            mutableAudioBufferList->mBuffers[i].mNumberChannels = originalAudioBufferList->mBuffers[i].mNumberChannels;
-            mutableAudioBufferList->mBuffers[i].mData = originalAudioBufferList->mBuffers[i].mData;
+        if (!layoutPrepared) {
+            mutableAudioBufferList->mNumberBuffers = numBuffers;
+
+            for (UInt32 i = 0; i < numBuffers; ++i) {
+                mutableAudioBufferList->mBuffers[i].mNumberChannels = originalAudioBufferList->mBuffers[i].mNumberChannels;
+            }
+
+            layoutPrepared = true;
+        }
+
+        for (UInt32 i = 0; i < numBuffers; ++i) {
             mutableAudioBufferList->mBuffers[i].mDataByteSize = byteSize;
+            mutableAudioBufferList->mBuffers[i].mData = originalAudioBufferList->mBuffers[i].mData;
         }
     }
 };
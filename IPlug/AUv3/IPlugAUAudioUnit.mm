@@ -235,13 +235,18 @@ static AUAudioUnitPreset* NewAUPreset(NSInteger number, NSString* pName)
     AudioUnitParameterOptions options = 0;
     
     options |= kAudioUnitParameterFlag_IsReadable;
-    options |= kAudioUnitParameterFlag_IsWritable;
+    
+    // output parameters, like meters, are read only for the host
+    if (pParam->GetIsOutput())
+      options |= kAudioUnitParameterFlag_MeterReadOnly;
+    else
+      options |= kAudioUnitParameterFlag_IsWritable;
     
     #ifndef IPLUG1_COMPATIBILITY // unfortunately this flag was not set for IPlug1, and it breaks state
     options |= kAudioUnitParameterFlag_IsHighResolution;
     #endif
     
-    if (!pParam->GetCanAutomate()) options |= kAudioUnitParameterFlag_NonRealTime;
+    if (!pParam->GetCanAutomate() && !pParam->GetIsOutput()) options |= kAudioUnitParameterFlag_NonRealTime;
     if (pParam->GetMeta()) options |= kAudioUnitParameterFlag_IsElementMeta;
 
     switch (pParam->Type())
@@ -523,7 +528,8 @@ static AUAudioUnitPreset* NewAUPreset(NSInteger number, NSString* pName)
   double sr = mBufferedOutputBuses.Get(0)->bus.format.sampleRate;
   
   mPlug->Prepare(sr, maxBlockSize);
-  mPlug->OnReset();
+  mPlug->EnsureDeferredInit();
+  mPlug->ResetFromAPI();
   
   return YES;
 }
@@ -588,7 +594,8 @@ static AUAudioUnitPreset* NewAUPreset(NSInteger number, NSString* pName)
       pPlug->AttachInputBuffers(pInAudioBufferList);
     }
     
-    outputBuses->Get(outputBusNumber)->prepareOutputBufferList(outputData, frameCount, true);
+    // ProcessBlock() writes every output channel, so there is no need to zero them, and output bus 0 is processed in-place when the host allows it
+    outputBuses->Get(outputBusNumber)->prepareOutputBufferList(outputData, frameCount, false, outputBusNumber == 0 ? pInAudioBufferList : nullptr);
     
     int lastOutputBusConnected = outputBuses->GetSize() - 1; // Buffers are allways connected it seems (AUM, Cubasis)
     
@@ -740,11 +747,11 @@ static AUAudioUnitPreset* NewAUPreset(NSInteger number, NSString* pName)
   [pDict setValue:[NSNumber numberWithInt: mPlug->GetMfrID()] forKey:[NSString stringWithUTF8String: kAUPresetManufacturerKey]];
   [pDict setValue:[NSString stringWithUTF8String: mPlug->GetPresetName(mPlug->GetCurrentPresetIdx())] forKey:[NSString stringWithUTF8String: kAUPresetNameKey]];
 
-  IByteChunk chunk;
 //  IByteChunk::InitChunkWithIPlugVer(chunk);
-  mPlug->SerializeState(chunk);
+  const IByteChunk* pChunk = mPlug->GetStateSnapshot();
   NSMutableData* pData = [[NSMutableData alloc] init];
-  [pData replaceBytesInRange:NSMakeRange (0, chunk.Size()) withBytes:chunk.GetData()];
+  if (pChunk)
+    [pData replaceBytesInRange:NSMakeRange (0, pChunk->Size()) withBytes:pChunk->GetData()];
   [pDict setValue:pData forKey:[NSString stringWithUTF8String: kAUPresetDataKey]];
 #endif
   return pDict;
@@ -760,7 +767,7 @@ static AUAudioUnitPreset* NewAUPreset(NSInteger number, NSString* pName)
   chunk.PutBytes([pData bytes], static_cast<int>([pData length]));
   int pos = 0;
 //  IByteChunk::GetIPlugVerFromChunk(chunk, pos);
-  mPlug->UnserializeState(chunk, pos);
+  mPlug->UnserializeStateSnapshot(chunk, pos);
 #endif
   
 //  [super setFullState: newFullState]; // this hangs auval
@@ -861,6 +868,26 @@ static AUAudioUnitPreset* NewAUPreset(NSInteger number, NSString* pName)
   return mPlug->DoesMPE() ? YES : NO;
 }
 
+#if defined(__MAC_12_0) || defined(__IPHONE_15_0)
+// Hosts that use MIDI event lists send MIDI 2.0 if we ask for it, see IPlugProcessor::SetMidi2Input()
+- (MIDIProtocolID) AudioUnitMIDIProtocol API_AVAILABLE(macos(12), ios(15))
+{
+  return mPlug->GetMidi2Input() ? kMIDIProtocol_2_0 : kMIDIProtocol_1_0;
+}
+#endif
+
+#if defined(__MAC_11_0) || defined(__IPHONE_14_0)
+// Called by the OS before the host renders on a new thread or device, with the workgroup that the plug-in's worker threads should join, see IPlugProcessor::GetAudioWorkgroup()
+- (AURenderContextObserver) renderContextObserver API_AVAILABLE(macos(11), ios(14))
+{
+  IPlugAUv3* pPlug = mPlug;
+
+  return ^(const AudioUnitRenderContext* pContext) {
+    pPlug->GetAudioWorkgroup().SetOSWorkgroup(pContext ? (__bridge void*) pContext->workgroup : nullptr);
+  };
+}
+#endif
+
 - (NSData*) getDataFromExternal
 {
   int dataSize = 0;
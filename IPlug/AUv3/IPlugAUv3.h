@@ -43,18 +43,23 @@ class IPlugAUv3 : public IPlugAPIBase
                 , public IPlugProcessor
 {
 public:
+  /** Host parameter ramps (AURenderEventParameterRamp) are followed in steps of this many samples */
+  static constexpr int kParamRampStep = 16;
+
   IPlugAUv3(const InstanceInfo& info, const Config& config);
   
   //IPlugAPIBase
   void BeginInformHostOfParamChange(int idx) override;
   void InformHostOfParamChange(int idx, double normalizedValue) override;
   void EndInformHostOfParamChange(int idx) override;
+  void InformHostOfOutputParamChange(int idx, double normalizedValue) override { InformHostOfParamChange(idx, normalizedValue); }
   void InformHostOfPresetChange() override {};
 
   //IPlugProcessor
   bool SendMidiMsg(const IMidiMsg& msg) override;
 //  bool SendMidiMsgs(WDL_TypedBuf<IMidiMsg>& msgs) override;
   bool SendSysEx(const ISysEx& msg) override;
+  void ProcessScheduledParamChange(int paramIdx, double normalizedValue, int offset) override;
 
   //IPlugAUv3
   void ProcessWithEvents(AudioTimeStamp const* timestamp, uint32_t frameCount, AURenderEvent const* events, ITimeInfo& timeInfo);
@@ -80,11 +85,37 @@ public:
   virtual void* GetDataFromExternal(int& dataSize) { return nullptr; }
 
 private:
-//  void HandleOneEvent(AURenderEvent const* event, int64_t startTime);
-//  void PerformAllSimultaneousEvents(int64_t now, AURenderEvent const*& event);
+  /** A parameter ramp from the host, which can last for several blocks */
+  struct ParamRamp
+  {
+    int paramIdx;
+    double startValue; // normalised
+    double endValue; // normalised
+    int64_t startOffset; // the start of the ramp relative to the start of the current block, so negative once it has started
+    int64_t duration;
+    int64_t nextStep; // the time into the ramp of the next step to schedule
+  };
+
+  /** Schedules a parameter change from the host, and remembers it as the start of any ramp that follows it in the same block */
+  void ScheduleHostParamChange(int paramIdx, double normalizedValue, int offset);
+
+  /** @return The value a parameter will have reached at an offset in the current block, from the host's events so far */
+  double GetHostParamValue(int paramIdx, int offset) const;
+
+  /** Schedules the steps of a ramp up to an offset in the current block
+   * @return \c true if the ramp has finished */
+  bool AdvanceParamRamp(ParamRamp& ramp, int64_t untilOffset);
+
+  /** Ends a ramp in progress on a parameter, having scheduled its steps up to an offset */
+  void StopParamRamp(int paramIdx, int offset);
+
   WDL_IntKeyedArray<uint64_t> mParamAddressMap;
   void* mAUAudioUnit = nullptr;
   AudioTimeStamp mLastTimeStamp;
+  WDL_TypedBuf<ParamRamp> mParamRamps; // at most one per parameter, with the memory reserved in Prepare()
+  WDL_TypedBuf<double> mHostParamValues; // the last value the host set each parameter to in the block numbered in mHostParamBlocks
+  WDL_TypedBuf<uint32_t> mHostParamBlocks;
+  uint32_t mBlockCount = 0;
 };
 
 IPlugAUv3* MakePlug(const InstanceInfo& info);
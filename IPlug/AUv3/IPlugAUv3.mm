@@ -10,6 +10,7 @@
 
 #import <AudioToolbox/AudioToolbox.h>
 #include <CoreMIDI/CoreMIDI.h>
+#include <algorithm>
 
 #include "IPlugAUv3.h"
 #import "IPlugAUAudioUnit.h"
@@ -55,7 +56,7 @@ bool IPlugAUv3::SendMidiMsg(const IMidiMsg& msg)
 {
   uint8_t data[3] = { msg.mStatus, msg.mData1, msg.mData2 };
   
-  int64_t sampleTime = mLastTimeStamp.mSampleTime + msg.mOffset;
+  int64_t sampleTime = mLastTimeStamp.mSampleTime + msg.mOffset + GetSegmentStart();
   
   return [(__bridge IPLUG_AUAUDIOUNIT*) mAUAudioUnit sendMidiData: sampleTime : sizeof(data) : data];
 }
@@ -67,57 +68,11 @@ bool IPlugAUv3::SendMidiMsg(const IMidiMsg& msg)
 
 bool IPlugAUv3::SendSysEx(const ISysEx& msg)
 {
-  int64_t sampleTime = mLastTimeStamp.mSampleTime + msg.mOffset;
+  int64_t sampleTime = mLastTimeStamp.mSampleTime + msg.mOffset + GetSegmentStart();
 
   return [(__bridge IPLUG_AUAUDIOUNIT*) mAUAudioUnit sendMidiData: sampleTime : msg.mSize : msg.mData];
 }
 
-//void IPlugAUv3::HandleOneEvent(AURenderEvent const *event, AUEventSampleTime startTime)
-//{
-//  switch (event->head.eventType)
-//  {
-//    case AURenderEventParameter:
-//    case AURenderEventParameterRamp:
-//    {
-//      AUParameterEvent const& paramEvent = event->parameter;
-//      const int paramIdx = GetParamIdx(paramEvent.parameterAddress);
-//      const double value = (double) paramEvent.value;
-//      const int sampleOffset = (int) (paramEvent.eventSampleTime - startTime);
-//      ENTER_PARAMS_MUTEX
-//      GetParam(paramIdx)->Set(value);
-//      LEAVE_PARAMS_MUTEX
-//      OnParamChange(paramIdx, EParamSource::kHost, sampleOffset);
-//      break;
-//    }
-//
-//    case AURenderEventMIDI:
-//    {
-//      IMidiMsg msg;
-//      msg.mStatus = event->MIDI.data[0];
-//      msg.mData1 = event->MIDI.data[1];
-//      msg.mData2 = event->MIDI.data[2];
-//      msg.mOffset = (int) (event->MIDI.eventSampleTime - startTime);
-//      ProcessMidiMsg(msg);
-//      mMidiMsgsFromProcessor.Push(msg);
-//      break;
-//    }
-//    default:
-//      break;
-//  }
-//}
-//
-//void IPlugAUv3::PerformAllSimultaneousEvents(AUEventSampleTime now, AURenderEvent const *&event)
-//{
-//  do {
-//    HandleOneEvent(event, now);
-//
-//    // Go to next event.
-//    event = event->head.next;
-//
-//    // While event is not null and is simultaneous (or late).
-//  } while (event && event->head.eventSampleTime <= now);
-//}
-
 void IPlugAUv3::ProcessWithEvents(AudioTimeStamp const* pTimestamp, uint32_t frameCount, AURenderEvent const* pEvents, ITimeInfo& timeInfo)
 {
   SetTimeInfo(timeInfo);
@@ -125,7 +80,7 @@ void IPlugAUv3::ProcessWithEvents(AudioTimeStamp const* pTimestamp, uint32_t fra
   IMidiMsg midiMsg;
   while (mMidiMsgsFromEditor.Pop(midiMsg))
   {
-    ProcessMidiMsg(midiMsg);
+    ScheduleMidiMsg(midiMsg);
   }
   
   mLastTimeStamp = *pTimestamp;
@@ -141,11 +96,46 @@ void IPlugAUv3::ProcessWithEvents(AudioTimeStamp const* pTimestamp, uint32_t fra
         const AUMIDIEvent& midiEvent = pEvent->MIDI;
 
         midiMsg = {static_cast<int>(midiEvent.eventSampleTime - now), midiEvent.data[0], midiEvent.data[1], midiEvent.data[2] };
-        ProcessMidiMsg(midiMsg);
+        ScheduleMidiMsg(midiMsg);
         mMidiMsgsFromProcessor.Push(midiMsg);
       }
       break;
 
+#if defined(__MAC_12_0) || defined(__IPHONE_15_0)
+      case AURenderEventMIDIEventList:
+      {
+        const AUMIDIEventList& midiEventList = pEvent->MIDIEventsList;
+        const int offset = static_cast<int>(midiEventList.eventSampleTime - now);
+        const MIDIEventPacket* pPacket = &midiEventList.eventList.packet[0];
+
+        for (UInt32 packetIdx = 0; packetIdx < midiEventList.eventList.numPackets; packetIdx++)
+        {
+          // a packet holds one or more Universal MIDI Packets, whose size in words depends on their message type
+          static const UInt32 sUMPWords[16] = { 1, 1, 1, 2, 2, 4, 1, 1, 2, 2, 2, 3, 3, 4, 4, 4 };
+
+          for (UInt32 wordIdx = 0; wordIdx < pPacket->wordCount; wordIdx += sUMPWords[pPacket->words[wordIdx] >> 28])
+          {
+            const UInt32 word0 = pPacket->words[wordIdx];
+            const UInt32 messageType = word0 >> 28;
+
+            if (messageType == IMidi2Msg::kMessageType && wordIdx + 1 < pPacket->wordCount)
+            {
+              ScheduleMidi2Msg(IMidi2Msg(offset, word0, pPacket->words[wordIdx + 1]));
+            }
+            else if (messageType == 0x2) // MIDI 1.0 channel voice message
+            {
+              midiMsg = {offset, static_cast<uint8_t>(word0 >> 16), static_cast<uint8_t>((word0 >> 8) & 0x7F), static_cast<uint8_t>(word0 & 0x7F)};
+              ScheduleMidiMsg(midiMsg);
+              mMidiMsgsFromProcessor.Push(midiMsg);
+            }
+          }
+
+          pPacket = MIDIEventPacketNext(pPacket);
+        }
+      }
+      break;
+#endif
+
       case AURenderEventParameter:
       case AURenderEventParameterRamp:
       {
@@ -154,26 +144,44 @@ void IPlugAUv3::ProcessWithEvents(AudioTimeStamp const* pTimestamp, uint32_t fra
         if (paramEvent.parameterAddress < NParams())
         {
           const int paramIdx = GetParamIdx(paramEvent.parameterAddress);
-          
-          const double value = (double) paramEvent.value;
-          const int sampleOffset = (int) (paramEvent.eventSampleTime - now);
-          ENTER_PARAMS_MUTEX
-          GetParam(paramIdx)->Set(value);
-          LEAVE_PARAMS_MUTEX
-          OnParamChange(paramIdx, EParamSource::kHost, sampleOffset);
+          const double value = GetParam(paramIdx)->ToNormalized((double) paramEvent.value);
+          const int sampleOffset = std::max(std::min(static_cast<int>(paramEvent.eventSampleTime - now), static_cast<int>(frameCount) - 1), 0);
+
+          // a new event replaces a ramp in progress from where it has got to
+          StopParamRamp(paramIdx, sampleOffset);
+
+          if (pEvent->head.eventType == AURenderEventParameterRamp && paramEvent.rampDurationSampleFrames > 0 && mParamRamps.GetSize() < NParams())
+          {
+            ParamRamp ramp {paramIdx, GetHostParamValue(paramIdx, sampleOffset), value, sampleOffset, paramEvent.rampDurationSampleFrames, 0};
+            mParamRamps.Add(ramp);
+          }
+          else
+            ScheduleHostParamChange(paramIdx, value, sampleOffset);
         }
 
         break;
       }
-      break;
 
       default:
         break;
     }
   }
 
+  // ramps continue through the rest of the block, and into the next ones
+  for (int i = mParamRamps.GetSize() - 1; i >= 0; i--)
+  {
+    ParamRamp& ramp = mParamRamps.Get()[i];
+
+    if (AdvanceParamRamp(ramp, frameCount))
+      mParamRamps.Delete(i);
+    else
+      ramp.startOffset -= frameCount;
+  }
+
+  mBlockCount++;
+
   ENTER_PARAMS_MUTEX;
-  ProcessBuffers(0.f, framesRemaining); // what about bufferOffset
+  ProcessBuffers(0.f, framesRemaining);
   LEAVE_PARAMS_MUTEX;
     
   //Output SYSEX from the editor, which has bypassed ProcessSysEx()
@@ -182,38 +190,66 @@ void IPlugAUv3::ProcessWithEvents(AudioTimeStamp const* pTimestamp, uint32_t fra
     ISysEx smsg {mSysexBuf.mOffset, mSysexBuf.mData, mSysexBuf.mSize};
     SendSysEx(smsg);
   }
-  
+}
 
-//  while (framesRemaining > 0) {
-//    // If there are no more events, we can process the entire remaining segment and exit.
-//    if (event == nullptr) {
-////      uint32_t const bufferOffset = frameCount - framesRemaining;
-// TODO - ProcessBuffers should be within param mutex lock
-//      ProcessBuffers(0.f, framesRemaining); // what about bufferOffset
-//      return;
-//    }
-//
-//    // **** start late events late.
-//    auto timeZero = AUEventSampleTime(0);
-//    auto headEventTime = event->head.eventSampleTime;
-//    uint32_t const framesThisSegment = uint32_t(std::max(timeZero, headEventTime - now));
-//
-//    // Compute everything before the next event.
-//    if (framesThisSegment > 0)
-//    {
-////      uint32_t const bufferOffset = frameCount - framesRemaining;
-// TODO - ProcessBuffers should be within param mutex lock
-//      ProcessBuffers(0.f, framesThisSegment); // what about bufferOffset
-//
-//      // Advance frames.
-//      framesRemaining -= framesThisSegment;
-//
-//      // Advance time.
-//      now += AUEventSampleTime(framesThisSegment);
-//    }
-//
-//    PerformAllSimultaneousEvents(now, event);
-//  }
+void IPlugAUv3::ProcessScheduledParamChange(int paramIdx, double normalizedValue, int offset)
+{
+  ENTER_PARAMS_MUTEX
+  GetParam(paramIdx)->SetNormalized(normalizedValue);
+  LEAVE_PARAMS_MUTEX
+  OnParamChange(paramIdx, kHost, offset);
+}
+
+void IPlugAUv3::ScheduleHostParamChange(int paramIdx, double normalizedValue, int offset)
+{
+  mHostParamValues.Get()[paramIdx] = normalizedValue;
+  mHostParamBlocks.Get()[paramIdx] = mBlockCount;
+  ScheduleParamChange(paramIdx, normalizedValue, offset);
+}
+
+double IPlugAUv3::GetHostParamValue(int paramIdx, int offset) const
+{
+  // with sample accurate events, earlier changes in this block haven't been applied to the parameter yet
+  if (mHostParamBlocks.Get()[paramIdx] == mBlockCount)
+    return mHostParamValues.Get()[paramIdx];
+
+  return GetParam(paramIdx)->GetNormalized();
+}
+
+bool IPlugAUv3::AdvanceParamRamp(ParamRamp& ramp, int64_t untilOffset)
+{
+  // without sample accurate events each change is applied straight away, so only the last step before untilOffset matters
+  if (!GetSampleAccurateEvents())
+  {
+    const int64_t lastStep = ((untilOffset - 1 - ramp.startOffset) / kParamRampStep) * kParamRampStep;
+    ramp.nextStep = std::max(ramp.nextStep, std::min(lastStep, ((ramp.duration - 1) / kParamRampStep) * kParamRampStep));
+  }
+
+  while (ramp.nextStep < ramp.duration && ramp.startOffset + ramp.nextStep < untilOffset)
+  {
+    // each step has the value the ramp reaches at its end, so the last one is the target
+    const double t = static_cast<double>(std::min(ramp.nextStep + kParamRampStep, ramp.duration)) / static_cast<double>(ramp.duration);
+    const int offset = static_cast<int>(std::max<int64_t>(ramp.startOffset + ramp.nextStep, 0));
+    ScheduleHostParamChange(ramp.paramIdx, ramp.startValue + (ramp.endValue - ramp.startValue) * t, offset);
+    ramp.nextStep += kParamRampStep;
+  }
+
+  return ramp.nextStep >= ramp.duration;
+}
+
+void IPlugAUv3::StopParamRamp(int paramIdx, int offset)
+{
+  for (int i = 0; i < mParamRamps.GetSize(); i++)
+  {
+    ParamRamp& ramp = mParamRamps.Get()[i];
+
+    if (ramp.paramIdx == paramIdx)
+    {
+      AdvanceParamRamp(ramp, offset);
+      mParamRamps.Delete(i);
+      return;
+    }
+  }
 }
 
 // this is called on a secondary thread (not main thread, not audio thread)
@@ -315,4 +351,12 @@ void IPlugAUv3::Prepare(double sampleRate, uint32_t blockSize)
   SetChannelConnections(ERoute::kOutput, 0, MaxNChannels(ERoute::kOutput), false);
   SetBlockSize(blockSize);
   SetSampleRate(sampleRate);
+
+  // reserved here, so that ramps don't allocate on the audio thread
+  mParamRamps.Resize(NParams(), false);
+  mParamRamps.Resize(0, false);
+  mHostParamValues.Resize(NParams());
+  mHostParamBlocks.Resize(NParams());
+  memset(mHostParamBlocks.Get(), 0, NParams() * sizeof(uint32_t));
+  mBlockCount = 1;
 }
@@ -0,0 +1,972 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#include <cstdio>
+#include <climits>
+#include "IPlugCLAP.h"
+#include "IPlugPluginBase.h"
+
+using namespace iplug;
+
+#if defined OS_WIN
+static const char* kClapWindowAPI = CLAP_WINDOW_API_WIN32;
+#elif defined OS_MAC
+static const char* kClapWindowAPI = CLAP_WINDOW_API_COCOA;
+#else
+static const char* kClapWindowAPI = CLAP_WINDOW_API_X11;
+#endif
+
+template <class EVENT>
+static void InitClapEvent(EVENT& event, uint16_t type, uint32_t time)
+{
+  memset(&event, 0, sizeof(EVENT));
+  event.header.size = sizeof(EVENT);
+  event.header.time = time;
+  event.header.space_id = CLAP_CORE_EVENT_SPACE_ID;
+  event.header.type = type;
+}
+
+IPlugCLAP::IPlugCLAP(const InstanceInfo& info, const Config& config)
+  : IPlugAPIBase(config, kAPICLAP)
+  , IPlugProcessor(config, kAPICLAP)
+  , mHost(info.mHost)
+{
+  Trace(TRACELOC, "%s", config.pluginName);
+
+  memset(&mPlugin, 0, sizeof(clap_plugin));
+  mPlugin.desc = info.mDescriptor;
+  mPlugin.plugin_data = this;
+  mPlugin.init = ClapInit;
+  mPlugin.destroy = ClapDestroy;
+  mPlugin.activate = ClapActivate;
+  mPlugin.deactivate = ClapDeactivate;
+  mPlugin.start_processing = ClapStartProcessing;
+  mPlugin.stop_processing = ClapStopProcessing;
+  mPlugin.reset = ClapReset;
+  mPlugin.process = ClapProcess;
+  mPlugin.get_extension = ClapGetExtension;
+  mPlugin.on_main_thread = ClapOnMainThread;
+
+  // Default everything to connected, ports the host doesn't pass are disconnected when processing
+  SetChannelConnections(ERoute::kInput, 0, MaxNChannels(ERoute::kInput), true);
+  SetChannelConnections(ERoute::kOutput, 0, MaxNChannels(ERoute::kOutput), true);
+
+  SetBlockSize(DEFAULT_BLOCK_SIZE);
+}
+
+#pragma mark - IPlugAPIBase
+
+void IPlugCLAP::BeginInformHostOfParamChange(int idx)
+{
+  mParamsToHost.Push(ParamToHost { ParamToHost::kBegin, idx, 0. });
+}
+
+void IPlugCLAP::InformHostOfParamChange(int idx, double normalizedValue)
+{
+  mParamsToHost.Push(ParamToHost { ParamToHost::kValue, idx, GetParam(idx)->FromNormalized(normalizedValue) });
+
+  // the changes are sent from process(), or from flush() if the host isn't processing
+  if (mHostParams)
+    mHostParams->request_flush(mHost);
+}
+
+void IPlugCLAP::EndInformHostOfParamChange(int idx)
+{
+  mParamsToHost.Push(ParamToHost { ParamToHost::kEnd, idx, 0. });
+
+  if (mHostParams)
+    mHostParams->request_flush(mHost);
+}
+
+void IPlugCLAP::InformHostOfPresetChange()
+{
+  if (mHostParams)
+    mHostParams->rescan(mHost, CLAP_PARAM_RESCAN_VALUES | CLAP_PARAM_RESCAN_TEXT);
+
+  if (mHostState)
+    mHostState->mark_dirty(mHost);
+}
+
+void IPlugCLAP::DirtyParametersFromUI()
+{
+  // rather than a value event for every parameter, have the host read them all back
+  InformHostOfPresetChange();
+}
+
+bool IPlugCLAP::EditorResize(int viewWidth, int viewHeight)
+{
+  bool resized = false;
+
+  if (HasUI())
+  {
+    if (viewWidth != GetEditorWidth() || viewHeight != GetEditorHeight())
+    {
+      SetEditorSize(viewWidth, viewHeight);
+
+      if (mHostGUI)
+        resized = mHostGUI->request_resize(mHost, viewWidth, viewHeight);
+    }
+  }
+
+  return resized;
+}
+
+#pragma mark - IPlugProcessor
+
+void IPlugCLAP::SetLatency(int samples)
+{
+  IPlugProcessor::SetLatency(samples);
+
+  // the latency may only change while the plug-in is deactivated, otherwise the host has to restart it
+  if (mActive)
+    mHost->request_restart(mHost);
+  else if (mHostLatency)
+    mHostLatency->changed(mHost);
+}
+
+bool IPlugCLAP::SendMidiMsg(const IMidiMsg& msg)
+{
+  clap_event_midi event;
+  InitClapEvent(event, CLAP_EVENT_MIDI, msg.mOffset + GetSegmentStart());
+  event.port_index = 0;
+  event.data[0] = msg.mStatus;
+  event.data[1] = msg.mData1;
+  event.data[2] = msg.mData2;
+
+  return PushOutputEvent(&event.header);
+}
+
+bool IPlugCLAP::SendSysEx(const ISysEx& msg)
+{
+  // the host copies the data before process() returns
+  clap_event_midi_sysex event;
+  InitClapEvent(event, CLAP_EVENT_MIDI_SYSEX, msg.mOffset + GetSegmentStart());
+  event.port_index = 0;
+  event.buffer = msg.mData;
+  event.size = msg.mSize;
+
+  return PushOutputEvent(&event.header);
+}
+
+bool IPlugCLAP::ExecuteParallel(ParallelTask task, void* pContext, int nTasks)
+{
+  // the host only accepts requests from inside process()
+  if (!mHostThreadPool || !mInProcess || nTasks <= 0)
+    return false;
+
+  mParallelTask = task;
+  mParallelContext = pContext;
+
+  const bool executed = mHostThreadPool->request_exec(mHost, nTasks);
+
+  mParallelTask = nullptr;
+  mParallelContext = nullptr;
+
+  return executed;
+}
+
+bool IPlugCLAP::PushOutputEvent(const clap_event_header* pEvent)
+{
+  return mOutEvents && mOutEvents->try_push(mOutEvents, pEvent);
+}
+
+#pragma mark - Processing
+
+void IPlugCLAP::ProcessInputEvents(const clap_input_events* pInEvents)
+{
+  IMidiMsg msg;
+
+  while (mMidiMsgsFromEditor.Pop(msg))
+  {
+    ScheduleMidiMsg(msg);
+  }
+
+  if (!pInEvents)
+    return;
+
+  const uint32_t nEvents = pInEvents->size(pInEvents);
+
+  for (uint32_t i = 0; i < nEvents; i++)
+  {
+    const clap_event_header* pHeader = pInEvents->get(pInEvents, i);
+
+    if (pHeader->space_id != CLAP_CORE_EVENT_SPACE_ID)
+      continue;
+
+    const int offset = static_cast<int>(pHeader->time);
+
+    switch (pHeader->type)
+    {
+      case CLAP_EVENT_PARAM_VALUE:
+      {
+        const clap_event_param_value* pEvent = reinterpret_cast<const clap_event_param_value*>(pHeader);
+        const int idx = static_cast<int>(pEvent->param_id);
+
+        // values for a single note or key are polyphonic modulation, which isn't supported
+        if (idx >= 0 && idx < NParams() && pEvent->note_id < 0 && pEvent->key < 0)
+          ScheduleParamChange(idx, GetParam(idx)->ToNormalized(pEvent->value), offset);
+
+        break;
+      }
+      case CLAP_EVENT_NOTE_ON:
+      case CLAP_EVENT_NOTE_OFF:
+      case CLAP_EVENT_NOTE_CHOKE:
+      {
+        const clap_event_note* pEvent = reinterpret_cast<const clap_event_note*>(pHeader);
+
+        // wildcard note offs, for all keys or channels, aren't supported
+        if (pEvent->key < 0 || pEvent->channel < 0)
+          break;
+
+        if (pHeader->type == CLAP_EVENT_NOTE_ON)
+          msg.MakeNoteOnMsg(pEvent->key, std::max(1, static_cast<int>(std::round(pEvent->velocity * 127.))), offset, pEvent->channel);
+        else
+          msg.MakeNoteOffMsg(pEvent->key, offset, pEvent->channel);
+
+        ScheduleMidiMsg(msg);
+        break;
+      }
+      case CLAP_EVENT_NOTE_EXPRESSION:
+      {
+        const clap_event_note_expression* pEvent = reinterpret_cast<const clap_event_note_expression*>(pHeader);
+
+        if (pEvent->key < 0 || pEvent->channel < 0)
+          break;
+
+        IMidi2Msg msg2;
+
+        switch (pEvent->expression_id)
+        {
+          // CLAP tuning is in semitones, per-note pitch bend is +/- kDefaultPerNotePitchBendRange semitones
+          case CLAP_NOTE_EXPRESSION_TUNING: msg2.MakePerNotePitchBendMsg(pEvent->key, pEvent->value / IMidi2Msg::kDefaultPerNotePitchBendRange, offset, pEvent->channel); break;
+          // CLAP volume is a gain from 0 to 4, where 1 is unity
+          case CLAP_NOTE_EXPRESSION_VOLUME: msg2.MakePerNoteControllerMsg(pEvent->key, IMidi2Msg::kPerNoteVolume, pEvent->value / 4., offset, pEvent->channel); break;
+          case CLAP_NOTE_EXPRESSION_PAN: msg2.MakePerNoteControllerMsg(pEvent->key, IMidi2Msg::kPerNotePan, pEvent->value, offset, pEvent->channel); break;
+          case CLAP_NOTE_EXPRESSION_VIBRATO: msg2.MakePerNoteControllerMsg(pEvent->key, IMidi2Msg::kPerNoteModulation, pEvent->value, offset, pEvent->channel); break;
+          case CLAP_NOTE_EXPRESSION_EXPRESSION: msg2.MakePerNoteControllerMsg(pEvent->key, IMidi2Msg::kPerNoteExpression, pEvent->value, offset, pEvent->channel); break;
+          case CLAP_NOTE_EXPRESSION_BRIGHTNESS: msg2.MakePerNoteControllerMsg(pEvent->key, IMidi2Msg::kPerNoteTimbre, pEvent->value, offset, pEvent->channel); break;
+          case CLAP_NOTE_EXPRESSION_PRESSURE: msg2.MakePolyPressureMsg(pEvent->key, pEvent->value, offset, pEvent->channel); break;
+          default: continue;
+        }
+
+        ScheduleMidi2Msg(msg2);
+        break;
+      }
+      case CLAP_EVENT_MIDI:
+      {
+        const clap_event_midi* pEvent = reinterpret_cast<const clap_event_midi*>(pHeader);
+        ScheduleMidiMsg(IMidiMsg(offset, pEvent->data[0], pEvent->data[1], pEvent->data[2]));
+        break;
+      }
+      case CLAP_EVENT_MIDI_SYSEX:
+      {
+        const clap_event_midi_sysex* pEvent = reinterpret_cast<const clap_event_midi_sysex*>(pHeader);
+        ScheduleSysEx(ISysEx(offset, pEvent->buffer, static_cast<int>(pEvent->size)));
+        break;
+      }
+      case CLAP_EVENT_TRANSPORT:
+      {
+        // a transport change within the block, e.g. a tempo or time signature change
+        ITimeInfo timeInfo;
+        const double tempoIncrement = GetTimeInfo(*reinterpret_cast<const clap_event_transport*>(pHeader), timeInfo);
+        AddTransportChange(offset, timeInfo, tempoIncrement);
+        break;
+      }
+      case CLAP_EVENT_MIDI2:
+      {
+        const clap_event_midi2* pEvent = reinterpret_cast<const clap_event_midi2*>(pHeader);
+        IMidi2Msg msg2;
+        msg2.mOffset = offset;
+        msg2.mWords[0] = pEvent->data[0];
+        msg2.mWords[1] = pEvent->data[1];
+
+        if (msg2.IsChannelVoiceMsg())
+          ScheduleMidi2Msg(msg2);
+
+        break;
+      }
+      default:
+        break;
+    }
+  }
+}
+
+void IPlugCLAP::ProcessOutputEvents()
+{
+  ParamToHost change;
+
+  while (mParamsToHost.Pop(change))
+  {
+    if (change.mType == ParamToHost::kValue)
+    {
+      clap_event_param_value event;
+      InitClapEvent(event, CLAP_EVENT_PARAM_VALUE, 0);
+      event.param_id = change.mIdx;
+      event.note_id = -1;
+      event.port_index = -1;
+      event.channel = -1;
+      event.key = -1;
+      event.value = change.mValue;
+      PushOutputEvent(&event.header);
+    }
+    else
+    {
+      clap_event_param_gesture event;
+      InitClapEvent(event, change.mType == ParamToHost::kBegin ? CLAP_EVENT_PARAM_GESTURE_BEGIN : CLAP_EVENT_PARAM_GESTURE_END, 0);
+      event.param_id = change.mIdx;
+      PushOutputEvent(&event.header);
+    }
+  }
+}
+
+void IPlugCLAP::ProcessScheduledParamChange(int paramIdx, double normalizedValue, int offset)
+{
+  ENTER_PARAMS_MUTEX
+  IParam* pParam = GetParam(paramIdx);
+  pParam->SetNormalized(normalizedValue);
+  OnParamChange(paramIdx, kHost, offset);
+  LEAVE_PARAMS_MUTEX
+
+  // the change was counted when it was scheduled, so this bypasses SendParameterValueFromAPI()
+  mParamChangeFromProcessor.Push(ParamTuple { paramIdx, pParam->Value() });
+}
+
+void IPlugCLAP::PrepareProcessContext(const clap_process* pProcess)
+{
+  ITimeInfo timeInfo;
+  double tempoIncrement = 0.;
+
+  if (pProcess->transport)
+    tempoIncrement = GetTimeInfo(*pProcess->transport, timeInfo);
+
+  SetTimeInfo(timeInfo, tempoIncrement);
+}
+
+double IPlugCLAP::GetTimeInfo(const clap_event_transport& transport, ITimeInfo& timeInfo) const
+{
+  const uint32_t flags = transport.flags;
+  double tempoIncrement = 0.;
+
+  if ((flags & CLAP_TRANSPORT_HAS_TEMPO) && transport.tempo > 0.0)
+  {
+    timeInfo.mTempo = transport.tempo;
+    tempoIncrement = transport.tempo_inc;
+  }
+
+  if (flags & CLAP_TRANSPORT_HAS_BEATS_TIMELINE)
+  {
+    timeInfo.mPPQPos = static_cast<double>(transport.song_pos_beats) / CLAP_BEATTIME_FACTOR;
+    timeInfo.mLastBar = static_cast<double>(transport.bar_start) / CLAP_BEATTIME_FACTOR;
+
+    if (flags & CLAP_TRANSPORT_IS_LOOP_ACTIVE)
+    {
+      timeInfo.mCycleStart = static_cast<double>(transport.loop_start_beats) / CLAP_BEATTIME_FACTOR;
+      timeInfo.mCycleEnd = static_cast<double>(transport.loop_end_beats) / CLAP_BEATTIME_FACTOR;
+    }
+  }
+
+  if (flags & CLAP_TRANSPORT_HAS_SECONDS_TIMELINE)
+    timeInfo.mSamplePos = static_cast<double>(transport.song_pos_seconds) / CLAP_SECTIME_FACTOR * GetSampleRate();
+
+  if ((flags & CLAP_TRANSPORT_HAS_TIME_SIGNATURE) && transport.tsig_num > 0 && transport.tsig_denom > 0)
+  {
+    timeInfo.mNumerator = transport.tsig_num;
+    timeInfo.mDenominator = transport.tsig_denom;
+  }
+
+  timeInfo.mTransportIsRunning = flags & CLAP_TRANSPORT_IS_PLAYING;
+  timeInfo.mTransportLoopEnabled = flags & CLAP_TRANSPORT_IS_LOOP_ACTIVE;
+
+  return tempoIncrement;
+}
+
+void IPlugCLAP::AttachPortBuffers(ERoute direction, const clap_audio_buffer* pBuffers, uint32_t nPorts, int nFrames, bool doublePrecision)
+{
+  const int maxNChans = MaxNChannels(direction);
+  SetChannelConnections(direction, 0, maxNChans, false);
+
+  // ports are laid out one after the other in the IPlug channels, each taking the most channels its bus has in any I/O config
+  for (int port = 0, chanOffset = 0; port < static_cast<int>(nPorts) && chanOffset < maxNChans; port++)
+  {
+    const int nChans = std::min(static_cast<int>(pBuffers[port].channel_count), maxNChans - chanOffset);
+    SetChannelConnections(direction, chanOffset, nChans, true);
+
+    if (doublePrecision)
+      IPlugProcessor::AttachBuffers(direction, chanOffset, nChans, pBuffers[port].data64, nFrames);
+    else
+      IPlugProcessor::AttachBuffers(direction, chanOffset, nChans, pBuffers[port].data32, nFrames);
+
+    chanOffset += MaxNChannelsForBus(direction, port);
+  }
+}
+
+bool IPlugCLAP::IsDoublePrecision(const clap_process* pProcess)
+{
+  if (pProcess->audio_outputs_count)
+    return pProcess->audio_outputs[0].data64 != nullptr;
+
+  return pProcess->audio_inputs_count && pProcess->audio_inputs[0].data64 != nullptr;
+}
+
+bool IPlugCLAP::IsSidechainSilent(const clap_process* pProcess, bool doublePrecision)
+{
+  if (pProcess->audio_inputs_count < 2 || !pProcess->frames_count)
+    return false;
+
+  for (uint32_t port = 1; port < pProcess->audio_inputs_count; port++)
+  {
+    const clap_audio_buffer& buffer = pProcess->audio_inputs[port];
+
+    for (uint32_t c = 0; c < buffer.channel_count; c++)
+    {
+      // a constant channel holds its first sample throughout
+      const bool constant = c < 64 && (buffer.constant_mask & (uint64_t(1) << c));
+      const double value = doublePrecision ? buffer.data64[c][0] : buffer.data32[c][0];
+
+      if (!constant || value != 0.)
+        return false;
+    }
+  }
+
+  return true;
+}
+
+#pragma mark - clap_plugin
+
+bool IPlugCLAP::ClapInit(const clap_plugin* pPlugin)
+{
+  IPlugCLAP* _this = GetPlug(pPlugin);
+  const clap_host* pHost = _this->mHost;
+
+  _this->mHostParams = static_cast<const clap_host_params*>(pHost->get_extension(pHost, CLAP_EXT_PARAMS));
+  _this->mHostState = static_cast<const clap_host_state*>(pHost->get_extension(pHost, CLAP_EXT_STATE));
+  _this->mHostLatency = static_cast<const clap_host_latency*>(pHost->get_extension(pHost, CLAP_EXT_LATENCY));
+  _this->mHostGUI = static_cast<const clap_host_gui*>(pHost->get_extension(pHost, CLAP_EXT_GUI));
+  _this->mHostThreadPool = static_cast<const clap_host_thread_pool*>(pHost->get_extension(pHost, CLAP_EXT_THREAD_POOL));
+
+  if (_this->GetHost() == kHostUninit)
+  {
+    int ver = 0, rmaj = 0, rmin = 0;
+
+    if (pHost->version)
+      sscanf(pHost->version, "%d.%d.%d", &ver, &rmaj, &rmin);
+
+    _this->SetHost(pHost->name ? pHost->name : "", (ver << 16) + (rmaj << 8) + rmin);
+  }
+
+  _this->OnParamReset(kReset);
+  _this->CreateTimer();
+
+  return true;
+}
+
+void IPlugCLAP::ClapDestroy(const clap_plugin* pPlugin)
+{
+  IPlugCLAP* _this = GetPlug(pPlugin);
+
+  if (_this->mWindowOpen)
+    _this->CloseWindow();
+
+  delete _this;
+}
+
+bool IPlugCLAP::ClapActivate(const clap_plugin* pPlugin, double sampleRate, uint32_t minFrames, uint32_t maxFrames)
+{
+  IPlugCLAP* _this = GetPlug(pPlugin);
+  _this->SetSampleRate(sampleRate);
+  _this->SetBlockSize(static_cast<int>(maxFrames));
+  _this->mActive = true;
+  _this->EnsureDeferredInit();
+  _this->ResetFromAPI();
+  _this->OnActivate(true);
+  return true;
+}
+
+void IPlugCLAP::ClapDeactivate(const clap_plugin* pPlugin)
+{
+  IPlugCLAP* _this = GetPlug(pPlugin);
+  _this->OnActivate(false);
+  _this->mActive = false;
+}
+
+bool IPlugCLAP::ClapStartProcessing(const clap_plugin* pPlugin)
+{
+  return true;
+}
+
+void IPlugCLAP::ClapStopProcessing(const clap_plugin* pPlugin)
+{
+}
+
+void IPlugCLAP::ClapReset(const clap_plugin* pPlugin)
+{
+  GetPlug(pPlugin)->ResetFromAPI();
+}
+
+clap_process_status IPlugCLAP::ClapProcess(const clap_plugin* pPlugin, const clap_process* pProcess)
+{
+  TRACE
+  IPlugCLAP* _this = GetPlug(pPlugin);
+  const int nFrames = static_cast<int>(pProcess->frames_count);
+  const bool doublePrecision = IsDoublePrecision(pProcess);
+
+  _this->mInProcess = true;
+  _this->mOutEvents = pProcess->out_events;
+  _this->PrepareProcessContext(pProcess);
+  _this->ProcessInputEvents(pProcess->in_events);
+  _this->ProcessOutputEvents();
+
+  _this->AttachPortBuffers(ERoute::kInput, pProcess->audio_inputs, pProcess->audio_inputs_count, nFrames, doublePrecision);
+  _this->AttachPortBuffers(ERoute::kOutput, pProcess->audio_outputs, pProcess->audio_outputs_count, nFrames, doublePrecision);
+  _this->SetSidechainSilent(IsSidechainSilent(pProcess, doublePrecision));
+
+  ENTER_PARAMS_MUTEX_STATIC
+  if (doublePrecision)
+    _this->ProcessBuffers(0.0, nFrames); // double precision
+  else
+    _this->ProcessBuffers(0.f, nFrames); // single precision
+  LEAVE_PARAMS_MUTEX_STATIC
+
+  // dispatch any events that weren't consumed by ProcessBuffers(), e.g. those at the very end of the block
+  _this->FlushScheduledEvents();
+
+  //Output SYSEX from the editor, which has bypassed ProcessSysEx()
+  while (_this->mSysExDataFromEditor.Pop(_this->mSysexBuf))
+  {
+    ISysEx smsg {_this->mSysexBuf.mOffset, _this->mSysexBuf.mData, _this->mSysexBuf.mSize};
+    _this->SendSysEx(smsg);
+  }
+
+  _this->mOutEvents = nullptr;
+  _this->mInProcess = false;
+
+  return CLAP_PROCESS_CONTINUE;
+}
+
+void IPlugCLAP::ClapOnMainThread(const clap_plugin* pPlugin)
+{
+}
+
+const void* IPlugCLAP::ClapGetExtension(const clap_plugin* pPlugin, const char* id)
+{
+  IPlugCLAP* _this = GetPlug(pPlugin);
+
+  static const clap_plugin_audio_ports sAudioPorts = { ClapAudioPortsCount, ClapAudioPortsGet };
+  static const clap_plugin_note_ports sNotePorts = { ClapNotePortsCount, ClapNotePortsGet };
+  static const clap_plugin_params sParams = { ClapParamsCount, ClapParamsGetInfo, ClapParamsGetValue, ClapParamsValueToText, ClapParamsTextToValue, ClapParamsFlush };
+  static const clap_plugin_state sState = { ClapStateSave, ClapStateLoad };
+  static const clap_plugin_latency sLatency = { ClapLatencyGet };
+  static const clap_plugin_tail sTail = { ClapTailGet };
+  static const clap_plugin_render sRender = { ClapRenderHasHardRealtimeRequirement, ClapRenderSet };
+  static const clap_plugin_thread_pool sThreadPool = { ClapThreadPoolExec };
+  static const clap_plugin_gui sGUI = {
+    ClapGUIIsAPISupported, ClapGUIGetPreferredAPI, ClapGUICreate, ClapGUIDestroy, ClapGUISetScale, ClapGUIGetSize, ClapGUICanResize, ClapGUIGetResizeHints,
+    ClapGUIAdjustSize, ClapGUISetSize, ClapGUISetParent, ClapGUISetTransient, ClapGUISuggestTitle, ClapGUIShow, ClapGUIHide
+  };
+
+  if (!strcmp(id, CLAP_EXT_AUDIO_PORTS)) return &sAudioPorts;
+  if (!strcmp(id, CLAP_EXT_NOTE_PORTS) && (_this->DoesMIDIIn() || _this->DoesMIDIOut())) return &sNotePorts;
+  if (!strcmp(id, CLAP_EXT_PARAMS)) return &sParams;
+  if (!strcmp(id, CLAP_EXT_STATE)) return &sState;
+  if (!strcmp(id, CLAP_EXT_LATENCY)) return &sLatency;
+  if (!strcmp(id, CLAP_EXT_TAIL)) return &sTail;
+  if (!strcmp(id, CLAP_EXT_RENDER)) return &sRender;
+  if (!strcmp(id, CLAP_EXT_THREAD_POOL)) return &sThreadPool;
+  if (!strcmp(id, CLAP_EXT_GUI) && _this->HasUI()) return &sGUI;
+
+  return nullptr;
+}
+
+#pragma mark - clap_plugin_audio_ports, clap_plugin_note_ports
+
+uint32_t IPlugCLAP::ClapAudioPortsCount(const clap_plugin* pPlugin, bool isInput)
+{
+  const ERoute direction = isInput ? ERoute::kInput : ERoute::kOutput;
+  return GetPlug(pPlugin)->MaxNBuses(direction);
+}
+
+bool IPlugCLAP::ClapAudioPortsGet(const clap_plugin* pPlugin, uint32_t index, bool isInput, clap_audio_port_info* pInfo)
+{
+  IPlugCLAP* _this = GetPlug(pPlugin);
+  const ERoute direction = isInput ? ERoute::kInput : ERoute::kOutput;
+  const int nBuses = _this->MaxNBuses(direction);
+
+  if (static_cast<int>(index) >= nBuses)
+    return false;
+
+  const int nChans = _this->MaxNChannelsForBus(direction, index);
+  WDL_String busName;
+  _this->GetBusName(direction, index, nBuses, busName);
+
+  pInfo->id = index;
+  strncpy(pInfo->name, busName.Get(), CLAP_NAME_SIZE - 1);
+  pInfo->name[CLAP_NAME_SIZE - 1] = '\0';
+  pInfo->flags = CLAP_AUDIO_PORT_SUPPORTS_64BITS | CLAP_AUDIO_PORT_REQUIRES_COMMON_SAMPLE_SIZE;
+#ifdef SAMPLE_TYPE_DOUBLE
+  pInfo->flags |= CLAP_AUDIO_PORT_PREFERS_64BITS;
+#endif
+  if (index == 0)
+    pInfo->flags |= CLAP_AUDIO_PORT_IS_MAIN;
+  pInfo->channel_count = nChans;
+  pInfo->port_type = nChans == 1 ? CLAP_PORT_MONO : nChans == 2 ? CLAP_PORT_STEREO : nullptr;
+  // the main buses can be processed in place if they match
+  pInfo->in_place_pair = (index == 0 && _this->MaxNChannelsForBus(isInput ? ERoute::kOutput : ERoute::kInput, 0) == nChans) ? 0 : CLAP_INVALID_ID;
+
+  return true;
+}
+
+uint32_t IPlugCLAP::ClapNotePortsCount(const clap_plugin* pPlugin, bool isInput)
+{
+  IPlugCLAP* _this = GetPlug(pPlugin);
+  return (isInput ? _this->DoesMIDIIn() : _this->DoesMIDIOut()) ? 1 : 0;
+}
+
+bool IPlugCLAP::ClapNotePortsGet(const clap_plugin* pPlugin, uint32_t index, bool isInput, clap_note_port_info* pInfo)
+{
+  IPlugCLAP* _this = GetPlug(pPlugin);
+
+  if (index > 0 || !ClapNotePortsCount(pPlugin, isInput))
+    return false;
+
+  pInfo->id = 0;
+
+  if (isInput)
+  {
+    // note events and expressions are converted, so the plug-in sees MIDI 1.0, or MIDI 2.0 if it asks for it
+    pInfo->supported_dialects = CLAP_NOTE_DIALECT_CLAP | CLAP_NOTE_DIALECT_MIDI;
+
+    if (_this->DoesMPE())
+      pInfo->supported_dialects |= CLAP_NOTE_DIALECT_MIDI_MPE;
+
+    if (_this->GetMidi2Input())
+      pInfo->supported_dialects |= CLAP_NOTE_DIALECT_MIDI2;
+
+    pInfo->preferred_dialect = _this->GetMidi2Input() ? CLAP_NOTE_DIALECT_MIDI2 : CLAP_NOTE_DIALECT_MIDI;
+    strncpy(pInfo->name, "MIDI Input", CLAP_NAME_SIZE);
+  }
+  else
+  {
+    pInfo->supported_dialects = CLAP_NOTE_DIALECT_MIDI;
+    pInfo->preferred_dialect = CLAP_NOTE_DIALECT_MIDI;
+    strncpy(pInfo->name, "MIDI Output", CLAP_NAME_SIZE);
+  }
+
+  return true;
+}
+
+#pragma mark - clap_plugin_params
+
+uint32_t IPlugCLAP::ClapParamsCount(const clap_plugin* pPlugin)
+{
+  return GetPlug(pPlugin)->NParams();
+}
+
+bool IPlugCLAP::ClapParamsGetInfo(const clap_plugin* pPlugin, uint32_t paramIdx, clap_param_info* pInfo)
+{
+  IPlugCLAP* _this = GetPlug(pPlugin);
+
+  if (static_cast<int>(paramIdx) >= _this->NParams())
+    return false;
+
+  ENTER_PARAMS_MUTEX_STATIC
+  const IParam* pParam = _this->GetParam(paramIdx);
+  const IParam::EParamType type = pParam->Type();
+
+  memset(pInfo, 0, sizeof(clap_param_info));
+  pInfo->id = paramIdx;
+  pInfo->flags = 0;
+
+  if (pParam->GetCanAutomate())
+    pInfo->flags |= CLAP_PARAM_IS_AUTOMATABLE;
+
+  if (pParam->GetIsOutput())
+    pInfo->flags |= CLAP_PARAM_IS_READONLY;
+
+  if (pParam->GetStepped() || type == IParam::kTypeBool || type == IParam::kTypeInt || type == IParam::kTypeEnum)
+    pInfo->flags |= CLAP_PARAM_IS_STEPPED;
+
+  pInfo->cookie = nullptr;
+  strncpy(pInfo->name, pParam->GetName(), CLAP_NAME_SIZE - 1);
+  strncpy(pInfo->module, pParam->GetGroup(), CLAP_PATH_SIZE - 1);
+  pInfo->min_value = pParam->GetMin();
+  pInfo->max_value = pParam->GetMax();
+  pInfo->default_value = pParam->GetDefault();
+  LEAVE_PARAMS_MUTEX_STATIC
+
+  return true;
+}
+
+bool IPlugCLAP::ClapParamsGetValue(const clap_plugin* pPlugin, clap_id paramID, double* pValue)
+{
+  IPlugCLAP* _this = GetPlug(pPlugin);
+
+  if (static_cast<int>(paramID) >= _this->NParams())
+    return false;
+
+  ENTER_PARAMS_MUTEX_STATIC
+  *pValue = _this->GetParam(paramID)->Value();
+  LEAVE_PARAMS_MUTEX_STATIC
+
+  return true;
+}
+
+bool IPlugCLAP::ClapParamsValueToText(const clap_plugin* pPlugin, clap_id paramID, double value, char* pDisplay, uint32_t size)
+{
+  IPlugCLAP* _this = GetPlug(pPlugin);
+
+  if (static_cast<int>(paramID) >= _this->NParams() || !size)
+    return false;
+
+  const IParam* pParam = _this->GetParam(paramID);
+  WDL_String display;
+  pParam->GetDisplay(value, false, display);
+
+  if (CStringHasContents(pParam->GetLabel()))
+  {
+    display.Append(" ");
+    display.Append(pParam->GetLabel());
+  }
+
+  strncpy(pDisplay, display.Get(), size - 1);
+  pDisplay[size - 1] = '\0';
+
+  return true;
+}
+
+bool IPlugCLAP::ClapParamsTextToValue(const clap_plugin* pPlugin, clap_id paramID, const char* pDisplay, double* pValue)
+{
+  IPlugCLAP* _this = GetPlug(pPlugin);
+
+  if (static_cast<int>(paramID) >= _this->NParams())
+    return false;
+
+  *pValue = _this->GetParam(paramID)->StringToValue(pDisplay);
+  return true;
+}
+
+void IPlugCLAP::ClapParamsFlush(const clap_plugin* pPlugin, const clap_input_events* pInEvents, const clap_output_events* pOutEvents)
+{
+  IPlugCLAP* _this = GetPlug(pPlugin);
+
+  // flush() is only called when process() isn't, so the events are dispatched straight away
+  _this->mOutEvents = pOutEvents;
+  _this->ProcessInputEvents(pInEvents);
+  _this->ProcessOutputEvents();
+  _this->FlushScheduledEvents();
+  _this->mOutEvents = nullptr;
+}
+
+#pragma mark - clap_plugin_state, clap_plugin_latency, clap_plugin_tail
+
+bool IPlugCLAP::ClapStateSave(const clap_plugin* pPlugin, const clap_ostream* pStream)
+{
+  IPlugCLAP* _this = GetPlug(pPlugin);
+  IByteChunk& chunk = _this->mState;
+
+  bool changed = true;
+  const IByteChunk* pState = _this->GetStateSnapshot(&changed);
+
+  if (!pState)
+    return false;
+
+  // mState still holds the last chunk that was handed to the host if nothing has changed
+  if (changed || !chunk.Size())
+  {
+    chunk.Clear();
+    IByteChunk::InitChunkWithIPlugVer(chunk);
+    chunk.PutChunk(pState);
+  }
+
+  const uint8_t* pData = chunk.GetData();
+  int64_t remaining = chunk.Size();
+
+  while (remaining > 0)
+  {
+    const int64_t written = pStream->write(pStream, pData, remaining);
+
+    if (written <= 0)
+      return false;
+
+    pData += written;
+    remaining -= written;
+  }
+
+  return true;
+}
+
+bool IPlugCLAP::ClapStateLoad(const clap_plugin* pPlugin, const clap_istream* pStream)
+{
+  IPlugCLAP* _this = GetPlug(pPlugin);
+  IByteChunk& chunk = _this->mState;
+  uint8_t buffer[4096];
+  int64_t bytesRead;
+
+  chunk.Clear();
+
+  // the stream may hand over the data in any number of pieces
+  while ((bytesRead = pStream->read(pStream, buffer, sizeof(buffer))) > 0)
+    chunk.PutBytes(buffer, static_cast<int>(bytesRead));
+
+  if (bytesRead < 0)
+    return false;
+
+  int pos = 0;
+  IByteChunk::GetIPlugVerFromChunk(chunk, pos);
+  pos = _this->UnserializeStateSnapshot(chunk, pos);
+  _this->ModifyCurrentPreset();
+
+  if (pos < 0)
+    return false;
+
+  _this->OnRestoreState();
+  return true;
+}
+
+uint32_t IPlugCLAP::ClapLatencyGet(const clap_plugin* pPlugin)
+{
+  return GetPlug(pPlugin)->GetLatency();
+}
+
+uint32_t IPlugCLAP::ClapTailGet(const clap_plugin* pPlugin)
+{
+  // negative tail sizes are infinite, as is anything from INT32_MAX for CLAP
+  const int tailSize = GetPlug(pPlugin)->GetTailSize();
+  return tailSize < 0 ? INT32_MAX : tailSize;
+}
+
+#pragma mark - clap_plugin_render, clap_plugin_thread_pool
+
+bool IPlugCLAP::ClapRenderHasHardRealtimeRequirement(const clap_plugin* pPlugin)
+{
+  return false;
+}
+
+bool IPlugCLAP::ClapRenderSet(const clap_plugin* pPlugin, clap_plugin_render_mode mode)
+{
+  GetPlug(pPlugin)->SetRenderingOffline(mode == CLAP_RENDER_OFFLINE);
+  return true;
+}
+
+void IPlugCLAP::ClapThreadPoolExec(const clap_plugin* pPlugin, uint32_t taskIdx)
+{
+  IPlugCLAP* _this = GetPlug(pPlugin);
+
+  // called on the host's threads while ExecuteParallel() waits in request_exec()
+  if (_this->mParallelTask)
+    _this->mParallelTask(_this->mParallelContext, static_cast<int>(taskIdx));
+}
+
+#pragma mark - clap_plugin_gui
+
+bool IPlugCLAP::ClapGUIIsAPISupported(const clap_plugin* pPlugin, const char* api, bool isFloating)
+{
+  return !isFloating && !strcmp(api, kClapWindowAPI);
+}
+
+bool IPlugCLAP::ClapGUIGetPreferredAPI(const clap_plugin* pPlugin, const char** pAPI, bool* pIsFloating)
+{
+  *pAPI = kClapWindowAPI;
+  *pIsFloating = false;
+  return true;
+}
+
+bool IPlugCLAP::ClapGUICreate(const clap_plugin* pPlugin, const char* api, bool isFloating)
+{
+  // the window is opened once the host gives us its parent in set_parent()
+  return ClapGUIIsAPISupported(pPlugin, api, isFloating);
+}
+
+void IPlugCLAP::ClapGUIDestroy(const clap_plugin* pPlugin)
+{
+  IPlugCLAP* _this = GetPlug(pPlugin);
+
+  if (_this->mWindowOpen)
+  {
+    _this->CloseWindow();
+    _this->mWindowOpen = false;
+  }
+}
+
+bool IPlugCLAP::ClapGUISetScale(const clap_plugin* pPlugin, double scale)
+{
+  // the editor gets the scale from its window
+  return false;
+}
+
+bool IPlugCLAP::ClapGUIGetSize(const clap_plugin* pPlugin, uint32_t* pWidth, uint32_t* pHeight)
+{
+  IPlugCLAP* _this = GetPlug(pPlugin);
+  *pWidth = _this->GetEditorWidth();
+  *pHeight = _this->GetEditorHeight();
+  return true;
+}
+
+bool IPlugCLAP::ClapGUICanResize(const clap_plugin* pPlugin)
+{
+  return GetPlug(pPlugin)->GetHostResizeEnabled();
+}
+
+bool IPlugCLAP::ClapGUIGetResizeHints(const clap_plugin* pPlugin, clap_gui_resize_hints* pHints)
+{
+  const bool canResize = ClapGUICanResize(pPlugin);
+  pHints->can_resize_horizontally = canResize;
+  pHints->can_resize_vertically = canResize;
+  pHints->preserve_aspect_ratio = false;
+  pHints->aspect_ratio_width = 0;
+  pHints->aspect_ratio_height = 0;
+  return canResize;
+}
+
+bool IPlugCLAP::ClapGUIAdjustSize(const clap_plugin* pPlugin, uint32_t* pWidth, uint32_t* pHeight)
+{
+  int w = static_cast<int>(*pWidth);
+  int h = static_cast<int>(*pHeight);
+  GetPlug(pPlugin)->ConstrainEditorResize(w, h);
+  *pWidth = w;
+  *pHeight = h;
+  return true;
+}
+
+bool IPlugCLAP::ClapGUISetSize(const clap_plugin* pPlugin, uint32_t width, uint32_t height)
+{
+  GetPlug(pPlugin)->OnParentWindowResize(static_cast<int>(width), static_cast<int>(height));
+  return true;
+}
+
+bool IPlugCLAP::ClapGUISetParent(const clap_plugin* pPlugin, const clap_window* pWindow)
+{
+  IPlugCLAP* _this = GetPlug(pPlugin);
+
+  if (_this->mWindowOpen)
+    _this->CloseWindow();
+
+  _this->OpenWindow(pWindow->ptr);
+  _this->mWindowOpen = true;
+  return true;
+}
+
+bool IPlugCLAP::ClapGUISetTransient(const clap_plugin* pPlugin, const clap_window* pWindow)
+{
+  return false;
+}
+
+void IPlugCLAP::ClapGUISuggestTitle(const clap_plugin* pPlugin, const char* title)
+{
+}
+
+bool IPlugCLAP::ClapGUIShow(const clap_plugin* pPlugin)
+{
+  return true;
+}
+
+bool IPlugCLAP::ClapGUIHide(const clap_plugin* pPlugin)
+{
+  return true;
+}
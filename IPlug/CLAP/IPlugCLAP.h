@@ -0,0 +1,170 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#ifndef _IPLUGAPI_
+#define _IPLUGAPI_
+// Only load one API class!
+
+/**
+ * @file
+ * @copydoc IPlugCLAP
+ */
+
+#include "clap/clap.h"
+
+#include "IPlugAPIBase.h"
+#include "IPlugProcessor.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** Used to pass various instance info to the API class */
+struct InstanceInfo
+{
+  const clap_plugin_descriptor* mDescriptor;
+  const clap_host* mHost;
+};
+
+/**  CLAP API base class for an IPlug plug-in
+ * Events arrive timestamped, so parameter changes and MIDI are scheduled, and split ProcessBlock() if SetSampleAccurateEvents() is enabled.
+ * Parameters are exposed with their real ranges, and changes from the UI are sent to the host from process() or params flush().
+ * The host's thread-pool extension is exposed through ExecuteParallel()
+ *   @ingroup APIClasses */
+class IPlugCLAP : public IPlugAPIBase
+                , public IPlugProcessor
+{
+public:
+  IPlugCLAP(const InstanceInfo& info, const Config& config);
+
+  //IPlugAPIBase
+  void BeginInformHostOfParamChange(int idx) override;
+  void InformHostOfParamChange(int idx, double normalizedValue) override;
+  void EndInformHostOfParamChange(int idx) override;
+  void InformHostOfPresetChange() override;
+  bool EditorResize(int viewWidth, int viewHeight) override;
+  void DirtyParametersFromUI() override;
+
+  //IPlugProcessor
+  void SetLatency(int samples) override;
+  bool SendMidiMsg(const IMidiMsg& msg) override;
+  bool SendSysEx(const ISysEx& msg) override;
+  bool ExecuteParallel(ParallelTask task, void* pContext, int nTasks) override;
+
+  //IPlugCLAP
+  const clap_plugin* GetClapPlugin() const { return &mPlugin; }
+  const clap_host* GetClapHost() const { return mHost; }
+
+private:
+  /** A parameter gesture or value from the UI, waiting to be sent to the host in the next process() or flush() */
+  struct ParamToHost
+  {
+    enum EType { kBegin, kValue, kEnd };
+
+    EType mType;
+    int mIdx;
+    double mValue;
+  };
+
+  static IPlugCLAP* GetPlug(const clap_plugin* pPlugin) { return static_cast<IPlugCLAP*>(pPlugin->plugin_data); }
+
+  // clap_plugin
+  static bool ClapInit(const clap_plugin* pPlugin);
+  static void ClapDestroy(const clap_plugin* pPlugin);
+  static bool ClapActivate(const clap_plugin* pPlugin, double sampleRate, uint32_t minFrames, uint32_t maxFrames);
+  static void ClapDeactivate(const clap_plugin* pPlugin);
+  static bool ClapStartProcessing(const clap_plugin* pPlugin);
+  static void ClapStopProcessing(const clap_plugin* pPlugin);
+  static void ClapReset(const clap_plugin* pPlugin);
+  static clap_process_status ClapProcess(const clap_plugin* pPlugin, const clap_process* pProcess);
+  static const void* ClapGetExtension(const clap_plugin* pPlugin, const char* id);
+  static void ClapOnMainThread(const clap_plugin* pPlugin);
+
+  // clap_plugin_audio_ports, clap_plugin_note_ports
+  static uint32_t ClapAudioPortsCount(const clap_plugin* pPlugin, bool isInput);
+  static bool ClapAudioPortsGet(const clap_plugin* pPlugin, uint32_t index, bool isInput, clap_audio_port_info* pInfo);
+  static uint32_t ClapNotePortsCount(const clap_plugin* pPlugin, bool isInput);
+  static bool ClapNotePortsGet(const clap_plugin* pPlugin, uint32_t index, bool isInput, clap_note_port_info* pInfo);
+
+  // clap_plugin_params
+  static uint32_t ClapParamsCount(const clap_plugin* pPlugin);
+  static bool ClapParamsGetInfo(const clap_plugin* pPlugin, uint32_t paramIdx, clap_param_info* pInfo);
+  static bool ClapParamsGetValue(const clap_plugin* pPlugin, clap_id paramID, double* pValue);
+  static bool ClapParamsValueToText(const clap_plugin* pPlugin, clap_id paramID, double value, char* pDisplay, uint32_t size);
+  static bool ClapParamsTextToValue(const clap_plugin* pPlugin, clap_id paramID, const char* pDisplay, double* pValue);
+  static void ClapParamsFlush(const clap_plugin* pPlugin, const clap_input_events* pInEvents, const clap_output_events* pOutEvents);
+
+  // clap_plugin_state, clap_plugin_latency, clap_plugin_tail
+  static bool ClapStateSave(const clap_plugin* pPlugin, const clap_ostream* pStream);
+  static bool ClapStateLoad(const clap_plugin* pPlugin, const clap_istream* pStream);
+  static uint32_t ClapLatencyGet(const clap_plugin* pPlugin);
+  static uint32_t ClapTailGet(const clap_plugin* pPlugin);
+
+  // clap_plugin_render, clap_plugin_thread_pool
+  static bool ClapRenderHasHardRealtimeRequirement(const clap_plugin* pPlugin);
+  static bool ClapRenderSet(const clap_plugin* pPlugin, clap_plugin_render_mode mode);
+  static void ClapThreadPoolExec(const clap_plugin* pPlugin, uint32_t taskIdx);
+
+  // clap_plugin_gui
+  static bool ClapGUIIsAPISupported(const clap_plugin* pPlugin, const char* api, bool isFloating);
+  static bool ClapGUIGetPreferredAPI(const clap_plugin* pPlugin, const char** pAPI, bool* pIsFloating);
+  static bool ClapGUICreate(const clap_plugin* pPlugin, const char* api, bool isFloating);
+  static void ClapGUIDestroy(const clap_plugin* pPlugin);
+  static bool ClapGUISetScale(const clap_plugin* pPlugin, double scale);
+  static bool ClapGUIGetSize(const clap_plugin* pPlugin, uint32_t* pWidth, uint32_t* pHeight);
+  static bool ClapGUICanResize(const clap_plugin* pPlugin);
+  static bool ClapGUIGetResizeHints(const clap_plugin* pPlugin, clap_gui_resize_hints* pHints);
+  static bool ClapGUIAdjustSize(const clap_plugin* pPlugin, uint32_t* pWidth, uint32_t* pHeight);
+  static bool ClapGUISetSize(const clap_plugin* pPlugin, uint32_t width, uint32_t height);
+  static bool ClapGUISetParent(const clap_plugin* pPlugin, const clap_window* pWindow);
+  static bool ClapGUISetTransient(const clap_plugin* pPlugin, const clap_window* pWindow);
+  static void ClapGUISuggestTitle(const clap_plugin* pPlugin, const char* title);
+  static bool ClapGUIShow(const clap_plugin* pPlugin);
+  static bool ClapGUIHide(const clap_plugin* pPlugin);
+
+  void ProcessInputEvents(const clap_input_events* pInEvents);
+  void ProcessOutputEvents();
+  void PrepareProcessContext(const clap_process* pProcess);
+  /** Converts a CLAP transport to IPlug time info
+   * @return The change in tempo per sample */
+  double GetTimeInfo(const clap_event_transport& transport, ITimeInfo& timeInfo) const;
+  void AttachPortBuffers(ERoute direction, const clap_audio_buffer* pBuffers, uint32_t nPorts, int nFrames, bool doublePrecision);
+  void ProcessScheduledParamChange(int paramIdx, double normalizedValue, int offset) override;
+  bool PushOutputEvent(const clap_event_header* pEvent);
+
+  /** @return \c true if the host passed double precision audio */
+  static bool IsDoublePrecision(const clap_process* pProcess);
+
+  /** @return \c true if every channel of the side-chain ports is flagged constant zero by the host, see IsSidechainActive() */
+  static bool IsSidechainSilent(const clap_process* pProcess, bool doublePrecision);
+
+  clap_plugin mPlugin;
+  const clap_host* mHost;
+  const clap_host_params* mHostParams = nullptr;
+  const clap_host_state* mHostState = nullptr;
+  const clap_host_latency* mHostLatency = nullptr;
+  const clap_host_gui* mHostGUI = nullptr;
+  const clap_host_thread_pool* mHostThreadPool = nullptr;
+
+  IPlugQueue<ParamToHost> mParamsToHost {PARAM_TRANSFER_SIZE};
+  const clap_output_events* mOutEvents = nullptr; // only valid during process() or flush()
+  IByteChunk mState; // Persistent storage if the host asks for plugin state.
+
+  ParallelTask mParallelTask = nullptr;
+  void* mParallelContext = nullptr;
+
+  bool mActive = false;
+  bool mInProcess = false;
+  bool mWindowOpen = false;
+};
+
+IPlugCLAP* MakePlug(const InstanceInfo& info);
+
+END_IPLUG_NAMESPACE
+
+#endif
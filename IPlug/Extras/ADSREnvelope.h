@@ -297,8 +297,168 @@ public:
     mPrevOutput = (result * mLevel);
     return mPrevOutput;
   }
+  
+  /** Process a block of the envelope. Rather than branching on the stage every sample like Process(), this works out how many samples are left
+  * in the current stage, and fills them with a linear or exponential ramp in a loop that the compiler can vectorise. The samples where the stage
+  * changes go through Process(), so the stage transitions and callbacks are the same. The ramps are calculated directly rather than accumulated,
+  * so with T = float a stage can end a sample earlier or later than with Process()
+  * @param pOutput Buffer for nFrames values
+  * @param nFrames The number of samples to process
+  * @param sustainLevel The sustain level, which is constant for the block, see Process()
+  * @return The sample at which the envelope went idle, after which the output is silent, so a voice can stop processing. nFrames if the envelope is still busy */
+  int ProcessBlock(T* pOutput, int nFrames, T sustainLevel = 0.)
+  {
+    int s = 0;
+    
+    while (s < nFrames)
+    {
+      if (mStage == kIdle)
+      {
+        const int idleFrame = s;
+        
+        for (; s < nFrames; s++)
+          pOutput[s] = Process(sustainLevel);
+        
+        return idleFrame;
+      }
+      else if (mStage == kSustain)
+      {
+        for (; s < nFrames; s++)
+          pOutput[s] = Process(sustainLevel);
+      }
+      else
+      {
+        s += ProcessSegment(pOutput + s, nFrames - s, sustainLevel);
+        
+        // the sample that crosses into the next stage
+        if (s < nFrames)
+          pOutput[s++] = Process(sustainLevel);
+      }
+    }
+    
+    return nFrames;
+  }
 
 private:
+  /** Fill the samples of the current ramp stage, up to but not including the one that would end the stage
+   * @return The number of samples filled */
+  int ProcessSegment(T* pOutput, int nFrames, T sustainLevel)
+  {
+    const T value = mEnvValue;
+    // the result before velocity scaling is value * resultGain + resultOffset, as in Process()
+    T resultGain = mReleaseLevel;
+    T resultOffset = 0.;
+    int n = 0;
+    
+    switch (mStage)
+    {
+      case kAttack:
+      {
+        if (mAttackIncr == 0.)
+          return 0;
+        
+        const T incr = mAttackIncr * mScalar;
+        resultGain = 1.;
+        n = CountSteps(nFrames, [&](int i) { return value + i * incr <= ENV_VALUE_HIGH; });
+        FillLinear(pOutput, n, value, incr, resultGain * mLevel, resultOffset * mLevel);
+        mEnvValue = value + n * incr;
+        break;
+      }
+      case kDecay:
+      case kRelease:
+      {
+        if (mStage == kRelease && mReleaseIncr == 0.)
+          return 0;
+        
+        const T ratio = 1. - (mStage == kDecay ? mDecayIncr : mReleaseIncr) * mScalar;
+        
+        if (mStage == kDecay)
+        {
+          resultGain = 1. - sustainLevel;
+          resultOffset = sustainLevel;
+        }
+        
+        n = ratio > 0. ? CountSteps(nFrames, [&](int i) { return value * std::pow(ratio, i) >= ENV_VALUE_LOW; }) : 0;
+        FillExp(pOutput, n, value, ratio, resultGain * mLevel, resultOffset * mLevel);
+        mEnvValue = value * std::pow(ratio, n);
+        break;
+      }
+      case kReleasedToRetrigger:
+      case kReleasedToEndEarly:
+      {
+        const T incr = mStage == kReleasedToRetrigger ? mRetriggerReleaseIncr : mEarlyReleaseIncr;
+        n = CountSteps(nFrames, [&](int i) { return value - i * incr >= ENV_VALUE_LOW; });
+        FillLinear(pOutput, n, value, -incr, resultGain * mLevel, resultOffset * mLevel);
+        mEnvValue = value - n * incr;
+        break;
+      }
+      default:
+        return 0;
+    }
+    
+    if (n > 0)
+    {
+      mPrevResult = mEnvValue * resultGain + resultOffset;
+      mPrevOutput = mPrevResult * mLevel;
+    }
+    
+    return n;
+  }
+  
+  /** @return The number of steps, up to maxSteps, for which inStage(step) is true, given that it is true up to a point and then false */
+  template <typename InStageFunc>
+  static int CountSteps(int maxSteps, InStageFunc inStage)
+  {
+    int lo = 0, hi = maxSteps;
+    
+    while (lo < hi)
+    {
+      const int mid = lo + (hi - lo + 1) / 2;
+      
+      if (inStage(mid))
+        lo = mid;
+      else
+        hi = mid - 1;
+    }
+    
+    return lo;
+  }
+  
+  /** pOutput[i] = (start + (i + 1) * incr) * gain + offset */
+  static void FillLinear(T* pOutput, int nFrames, T start, T incr, T gain, T offset)
+  {
+    for (auto i = 0; i < nFrames; i++)
+      pOutput[i] = (start + (i + 1) * incr) * gain + offset;
+  }
+  
+  /** pOutput[i] = (start * ratio^(i + 1)) * gain + offset, four samples at a time */
+  static void FillExp(T* pOutput, int nFrames, T start, T ratio, T gain, T offset)
+  {
+    T powers[4];
+    T power = ratio;
+    
+    for (auto j = 0; j < 4; j++)
+    {
+      powers[j] = power * gain;
+      power *= ratio;
+    }
+    
+    const T ratio4 = std::pow(ratio, 4);
+    T base = start;
+    int i = 0;
+    
+    for (; i + 4 <= nFrames; i += 4)
+    {
+      for (auto j = 0; j < 4; j++)
+        pOutput[i + j] = base * powers[j] + offset;
+      
+      base *= ratio4;
+    }
+    
+    for (auto j = 0; j < (nFrames & 3); j++)
+      pOutput[i + j] = base * powers[j] + offset;
+  }
+  
   inline T CalcIncrFromTimeLinear(T timeMS, T sr) const
   {
     if (timeMS <= 0.) return 0.;
@@ -0,0 +1,337 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * Multi-channel cascade of biquads (second order sections) in transposed direct form II,
+ * with designs from Robert Bristow-Johnson's Audio EQ Cookbook:
+ * - https://www.w3.org/TR/audio-eq-cookbook/
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+
+#include "IPlugPlatform.h"
+#include "IPlugUtilities.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+#define BIQUADMODES_VALIST "LowPass", "HighPass", "BandPass", "Notch", "AllPass", "Bell", "LowShelf", "HighShelf"
+
+/** The coefficients of one second order section, normalised so that a0 is 1 */
+struct BiquadCoeffs
+{
+  double b0 = 1., b1 = 0., b2 = 0., a1 = 0., a2 = 0.;
+
+  enum EMode
+  {
+    kLowPass = 0,
+    kHighPass,
+    kBandPass,
+    kNotch,
+    kAllPass,
+    kBell,
+    kLowShelf,
+    kHighShelf,
+    kNumModes
+  };
+
+  bool operator == (const BiquadCoeffs& other) const
+  {
+    return b0 == other.b0 && b1 == other.b1 && b2 == other.b2 && a1 == other.a1 && a2 == other.a2;
+  }
+
+  bool operator != (const BiquadCoeffs& other) const { return !(*this == other); }
+
+  /** Designs a section with the Audio EQ Cookbook formulae
+   * @param mode The filter type
+   * @param freqCPS The cutoff or centre frequency in Hz
+   * @param Q The quality factor, which sets the bandwidth of the bell and the slope of the shelves
+   * @param gainDB The gain in dB of the bell and the shelves, ignored by the other modes
+   * @param sampleRate The sample rate in Hz
+   * @return The normalised coefficients */
+  static BiquadCoeffs Design(EMode mode, double freqCPS, double Q, double gainDB, double sampleRate)
+  {
+    const double w0 = 2. * PI * Clip(freqCPS, 1., 0.49 * sampleRate) / sampleRate;
+    const double cosw0 = std::cos(w0);
+    const double alpha = std::sin(w0) / (2. * std::max(Q, 0.01));
+    const double A = std::pow(10., gainDB / 40.);
+
+    double b0 = 1., b1 = 0., b2 = 0., a0 = 1., a1 = 0., a2 = 0.;
+
+    switch (mode)
+    {
+      case kLowPass:
+        b0 = (1. - cosw0) / 2.; b1 = 1. - cosw0; b2 = b0;
+        a0 = 1. + alpha; a1 = -2. * cosw0; a2 = 1. - alpha;
+        break;
+      case kHighPass:
+        b0 = (1. + cosw0) / 2.; b1 = -(1. + cosw0); b2 = b0;
+        a0 = 1. + alpha; a1 = -2. * cosw0; a2 = 1. - alpha;
+        break;
+      case kBandPass: // 0 dB peak gain
+        b0 = alpha; b1 = 0.; b2 = -alpha;
+        a0 = 1. + alpha; a1 = -2. * cosw0; a2 = 1. - alpha;
+        break;
+      case kNotch:
+        b0 = 1.; b1 = -2. * cosw0; b2 = 1.;
+        a0 = 1. + alpha; a1 = -2. * cosw0; a2 = 1. - alpha;
+        break;
+      case kAllPass:
+        b0 = 1. - alpha; b1 = -2. * cosw0; b2 = 1. + alpha;
+        a0 = 1. + alpha; a1 = -2. * cosw0; a2 = 1. - alpha;
+        break;
+      case kBell:
+        b0 = 1. + alpha * A; b1 = -2. * cosw0; b2 = 1. - alpha * A;
+        a0 = 1. + alpha / A; a1 = -2. * cosw0; a2 = 1. - alpha / A;
+        break;
+      case kLowShelf:
+      {
+        const double sq = 2. * std::sqrt(A) * alpha;
+        b0 = A * ((A + 1.) - (A - 1.) * cosw0 + sq);
+        b1 = 2. * A * ((A - 1.) - (A + 1.) * cosw0);
+        b2 = A * ((A + 1.) - (A - 1.) * cosw0 - sq);
+        a0 = (A + 1.) + (A - 1.) * cosw0 + sq;
+        a1 = -2. * ((A - 1.) + (A + 1.) * cosw0);
+        a2 = (A + 1.) + (A - 1.) * cosw0 - sq;
+        break;
+      }
+      case kHighShelf:
+      {
+        const double sq = 2. * std::sqrt(A) * alpha;
+        b0 = A * ((A + 1.) + (A - 1.) * cosw0 + sq);
+        b1 = -2. * A * ((A - 1.) + (A + 1.) * cosw0);
+        b2 = A * ((A + 1.) + (A - 1.) * cosw0 - sq);
+        a0 = (A + 1.) - (A - 1.) * cosw0 + sq;
+        a1 = 2. * ((A - 1.) - (A + 1.) * cosw0);
+        a2 = (A + 1.) - (A - 1.) * cosw0 - sq;
+        break;
+      }
+      default:
+        break;
+    }
+
+    return { b0 / a0, b1 / a0, b2 / a0, a1 / a0, a2 / a0 };
+  }
+
+  /** @return The gain in dB of the section at a frequency, e.g. for drawing an EQ curve */
+  double GetResponseDB(double freqCPS, double sampleRate) const
+  {
+    using cdouble = std::complex<double>;
+
+    const cdouble z1 = std::polar(1., -2. * PI * freqCPS / sampleRate);
+    const cdouble z2 = z1 * z1;
+    const cdouble h = (b0 + b1 * z1 + b2 * z2) / (1. + a1 * z1 + a2 * z2);
+
+    return 20. * std::log10(std::max(std::abs(h), 1e-12));
+  }
+};
+
+/** A cascade of NSECTIONS biquads, each applied to NC channels, in transposed direct form II.
+ * The state is laid out by section then channel, and the channels are processed together in the inner loop, so that the compiler can vectorise across them.
+ * Sections set with SetSection() are interpolated linearly from their previous coefficients over the next call to ProcessBlock(), so that automation doesn't click */
+template<typename T = double, int NC = 1, int NSECTIONS = 1>
+class BiquadCascade
+{
+public:
+  BiquadCascade()
+  {
+    Reset();
+  }
+
+  /** Sets the coefficients of one section
+   * @param section The section, from 0 to NSECTIONS - 1
+   * @param coeffs The new coefficients
+   * @param immediate \c true to use the coefficients straight away, rather than interpolating to them during the next block */
+  void SetSection(int section, const BiquadCoeffs& coeffs, bool immediate = false)
+  {
+    assert(section >= 0 && section < NSECTIONS);
+
+    mTarget[section] = coeffs;
+
+    if (immediate)
+      mCoeffs[section] = coeffs;
+  }
+
+  /** Designs and sets the coefficients of one section with BiquadCoeffs::Design() */
+  void SetSection(int section, BiquadCoeffs::EMode mode, double freqCPS, double Q, double gainDB, double sampleRate, bool immediate = false)
+  {
+    SetSection(section, BiquadCoeffs::Design(mode, freqCPS, Q, gainDB, sampleRate), immediate);
+  }
+
+  const BiquadCoeffs& GetSection(int section) const { return mTarget[section]; }
+
+  /** Sets how many of the sections are processed, so that an EQ can switch bands off without a branch per sample
+   * @param nSections The number from the start of the cascade, up to NSECTIONS */
+  void SetNumActiveSections(int nSections) { mNActiveSections = Clip(nSections, 0, NSECTIONS); }
+
+  int NActiveSections() const { return mNActiveSections; }
+
+  /** @return The gain in dB of the active sections at a frequency, e.g. for drawing an EQ curve */
+  double GetResponseDB(double freqCPS, double sampleRate) const
+  {
+    double gain = 0.;
+
+    for (auto i = 0; i < mNActiveSections; i++)
+      gain += mTarget[i].GetResponseDB(freqCPS, sampleRate);
+
+    return gain;
+  }
+
+  void ProcessBlock(T** inputs, T** outputs, int nChans, int nFrames)
+  {
+    assert(nChans <= NC);
+
+    if (nFrames <= 0)
+      return;
+
+    for (auto i = 0; i < mNActiveSections; i++)
+    {
+      if (mCoeffs[i] != mTarget[i])
+      {
+        ProcessBlockInterpolating(inputs, outputs, nChans, nFrames);
+        return;
+      }
+    }
+
+    double x[NC];
+
+    for (auto s = 0; s < nFrames; s++)
+    {
+      for (auto c = 0; c < nChans; c++)
+        x[c] = (double) inputs[c][s];
+
+      for (auto i = 0; i < mNActiveSections; i++)
+      {
+        const BiquadCoeffs& k = mCoeffs[i];
+        double* z1 = mZ1[i];
+        double* z2 = mZ2[i];
+
+        for (auto c = 0; c < nChans; c++)
+        {
+          const double y = k.b0 * x[c] + z1[c];
+          z1[c] = k.b1 * x[c] - k.a1 * y + z2[c];
+          z2[c] = k.b2 * x[c] - k.a2 * y;
+          x[c] = y;
+        }
+      }
+
+      for (auto c = 0; c < nChans; c++)
+        outputs[c][s] = (T) x[c];
+    }
+
+    FlushDenormals();
+  }
+
+  /** Processes one sample of one channel with the current coefficients, for callers that don't need the output as a buffer. No interpolation is done */
+  inline T ProcessSample(T input, int chan)
+  {
+    double x = (double) input;
+
+    for (auto i = 0; i < mNActiveSections; i++)
+    {
+      const BiquadCoeffs& k = mCoeffs[i];
+      const double y = k.b0 * x + mZ1[i][chan];
+      mZ1[i][chan] = k.b1 * x - k.a1 * y + mZ2[i][chan];
+      mZ2[i][chan] = k.b2 * x - k.a2 * y;
+      x = y;
+    }
+
+    return (T) x;
+  }
+
+  /** Clears the state of every section and channel, and finishes any interpolation */
+  void Reset()
+  {
+    for (auto i = 0; i < NSECTIONS; i++)
+    {
+      mCoeffs[i] = mTarget[i];
+
+      for (auto c = 0; c < NC; c++)
+      {
+        mZ1[i][c] = 0.;
+        mZ2[i][c] = 0.;
+      }
+    }
+  }
+
+  /** Flushes denormal values out of the state, which decaying silence would otherwise leave there. ProcessBlock() does this at the end of each block */
+  void FlushDenormals()
+  {
+    for (auto i = 0; i < NSECTIONS; i++)
+    {
+      for (auto c = 0; c < NC; c++)
+      {
+        if (std::fabs(mZ1[i][c]) < 1e-30) mZ1[i][c] = 0.;
+        if (std::fabs(mZ2[i][c]) < 1e-30) mZ2[i][c] = 0.;
+      }
+    }
+  }
+
+private:
+  void ProcessBlockInterpolating(T** inputs, T** outputs, int nChans, int nFrames)
+  {
+    BiquadCoeffs k[NSECTIONS];
+    BiquadCoeffs inc[NSECTIONS];
+    const double r = 1. / nFrames;
+
+    for (auto i = 0; i < mNActiveSections; i++)
+    {
+      k[i] = mCoeffs[i];
+      inc[i] = { (mTarget[i].b0 - k[i].b0) * r, (mTarget[i].b1 - k[i].b1) * r, (mTarget[i].b2 - k[i].b2) * r,
+                 (mTarget[i].a1 - k[i].a1) * r, (mTarget[i].a2 - k[i].a2) * r };
+    }
+
+    double x[NC];
+
+    for (auto s = 0; s < nFrames; s++)
+    {
+      for (auto c = 0; c < nChans; c++)
+        x[c] = (double) inputs[c][s];
+
+      for (auto i = 0; i < mNActiveSections; i++)
+      {
+        BiquadCoeffs& ki = k[i];
+        ki.b0 += inc[i].b0; ki.b1 += inc[i].b1; ki.b2 += inc[i].b2; ki.a1 += inc[i].a1; ki.a2 += inc[i].a2;
+
+        double* z1 = mZ1[i];
+        double* z2 = mZ2[i];
+
+        for (auto c = 0; c < nChans; c++)
+        {
+          const double y = ki.b0 * x[c] + z1[c];
+          z1[c] = ki.b1 * x[c] - ki.a1 * y + z2[c];
+          z2[c] = ki.b2 * x[c] - ki.a2 * y;
+          x[c] = y;
+        }
+      }
+
+      for (auto c = 0; c < nChans; c++)
+        outputs[c][s] = (T) x[c];
+    }
+
+    // land exactly on the targets, rather than on the accumulated increments
+    for (auto i = 0; i < mNActiveSections; i++)
+      mCoeffs[i] = mTarget[i];
+
+    FlushDenormals();
+  }
+
+  double mZ1[NSECTIONS][NC];
+  double mZ2[NSECTIONS][NC];
+  BiquadCoeffs mCoeffs[NSECTIONS];
+  BiquadCoeffs mTarget[NSECTIONS];
+  int mNActiveSections = NSECTIONS;
+};
+
+END_IPLUG_NAMESPACE
@@ -9,6 +9,7 @@
 */
 
 #include "IPlugCocoaEditorDelegate.h"
+#include "IPlugStartupTimer.h"
 #import "IPlugCocoaViewController.h"
 
 using namespace iplug;
@@ -24,6 +25,7 @@ CocoaEditorDelegate::~CocoaEditorDelegate()
 
 void* CocoaEditorDelegate::OpenWindow(void* pParent)
 {
+  ENTER_STARTUP_TIMING_SCOPE(kEditorOpen)
 #ifdef OS_IOS
   IPlugCocoaViewController* vc = (IPlugCocoaViewController*) [(PLATFORM_VIEW*) pParent nextResponder];
   [vc setEditorDelegate: this];
@@ -0,0 +1,527 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+/**
+ * @file
+ * @copydoc IPlugEEL
+ */
+
+#include "IPlugEEL.h"
+
+#include <cctype>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "mutex.h"
+
+#ifndef IPLUG_EEL_NO_HOSTSTUBS
+static WDL_Mutex sEELMutex;
+
+void NSEEL_HOSTSTUB_EnterMutex() { sEELMutex.Enter(); }
+void NSEEL_HOSTSTUB_LeaveMutex() { sEELMutex.Leave(); }
+#endif
+
+using namespace iplug;
+
+static constexpr int kCollectIntervalMs = 100; // how often the compiler thread frees code that the audio thread has replaced
+
+IPlugEEL::Program::~Program()
+{
+  // the code that defines the common functions goes last
+  if (mSample) NSEEL_code_free(mSample);
+  if (mBlock) NSEEL_code_free(mBlock);
+  if (mSlider) NSEEL_code_free(mSlider);
+  if (mInit) NSEEL_code_free(mInit);
+
+  if (mVM)
+    NSEEL_VM_free(mVM);
+}
+
+IPlugEEL::IPlugEEL(const char* name, int nInputs, int nOutputs)
+: mName(name)
+, mNInputs(std::min(std::max(nInputs, 0), kMaxChannels))
+, mNOutputs(std::min(std::max(nOutputs, 0), kMaxChannels))
+{
+  for (auto i = 0; i < kMaxSliders; i++)
+    mSliderValues[i].store(0., std::memory_order_relaxed);
+
+  mCompiler = std::thread(&IPlugEEL::CompilerLoop, this);
+}
+
+IPlugEEL::~IPlugEEL()
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mRunning = false;
+  }
+
+  mWakeUp.notify_all();
+  mCompiler.join();
+
+  delete mPending.exchange(nullptr);
+  delete mRetired.exchange(nullptr);
+}
+
+bool IPlugEEL::Init(const char* sourceCode)
+{
+  std::string error;
+  Program* pProgram = Compile(sourceCode, error);
+  SetError(error);
+
+  if (!pProgram)
+  {
+    DBGMSG("IPlugEEL-%s: %s\n", mName.Get(), error.c_str());
+    return false;
+  }
+
+  mSliders = pProgram->mSliders;
+
+  for (const Slider& slider : mSliders)
+    mSliderValues[slider.mNumber - 1].store(slider.mDefault, std::memory_order_relaxed);
+
+  mSlidersChanged.store(true, std::memory_order_release);
+
+  // handed over like a background compile, in case the audio thread is already running
+  delete mPending.exchange(pProgram, std::memory_order_acq_rel);
+  return true;
+}
+
+bool IPlugEEL::InitFromFile(const char* path)
+{
+  std::string sourceCode;
+
+  if (!ReadFile(path, sourceCode))
+  {
+    SetError(std::string("could not read ") + path);
+    return false;
+  }
+
+  return Init(sourceCode.c_str());
+}
+
+void IPlugEEL::SetSourceCode(const char* sourceCode)
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mRequest = sourceCode;
+    mHasRequest = true;
+  }
+
+  mWakeUp.notify_all();
+}
+
+bool IPlugEEL::LoadFile(const char* path)
+{
+  std::string sourceCode;
+
+  if (!ReadFile(path, sourceCode))
+  {
+    SetError(std::string("could not read ") + path);
+    return false;
+  }
+
+  SetSourceCode(sourceCode.c_str());
+  return true;
+}
+
+void IPlugEEL::WaitUntilCompiled()
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+  mIdle.wait(lock, [&]() { return !mHasRequest && !mCompiling; });
+}
+
+bool IPlugEEL::GetLastError(WDL_String& error) const
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  error.Set(mLastError.c_str());
+  return !mLastError.empty();
+}
+
+void IPlugEEL::SetError(const std::string& error)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  mLastError = error;
+}
+
+void IPlugEEL::SetSampleRate(double sampleRate)
+{
+  mSampleRate.store(sampleRate, std::memory_order_relaxed);
+  mResetRequested.store(true, std::memory_order_release);
+}
+
+void IPlugEEL::SetParameterValue(int sliderIdx, double value)
+{
+  assert(sliderIdx >= 0 && sliderIdx < NParams()); // Seems like we don't have enough sliders!
+
+  mSliderValues[mSliders[sliderIdx].mNumber - 1].store(value, std::memory_order_relaxed);
+  mSlidersChanged.store(true, std::memory_order_release);
+}
+
+int IPlugEEL::CreateIPlugParameters(IPlugAPIBase* pPlug, int startIdx, bool setToDefault)
+{
+  assert(pPlug != nullptr);
+
+  if (NParams() == 0)
+    return -1;
+
+  for (auto i = 0; i < NParams(); i++)
+  {
+    assert(startIdx + i < pPlug->NParams()); // plugin needs to have enough params!
+
+    const Slider& slider = mSliders[i];
+    IParam* pParam = pPlug->GetParam(startIdx + i);
+    const double currentValue = pParam->Value();
+
+    if (slider.mEnumLabels.size())
+    {
+      const int nEnums = static_cast<int>(slider.mEnumLabels.size());
+      pParam->InitEnum(slider.mLabel.Get(), Clip(static_cast<int>(slider.mDefault), 0, nEnums - 1), nEnums);
+
+      for (auto e = 0; e < nEnums; e++)
+        pParam->SetDisplayText(e, slider.mEnumLabels[e].c_str());
+    }
+    else
+    {
+      const double step = slider.mStep > 0. ? slider.mStep : 0.001;
+      pParam->InitDouble(slider.mLabel.Get(), slider.mDefault, slider.mMin, slider.mMax, step);
+    }
+
+    if (setToDefault)
+      pParam->SetToDefault();
+    else
+      pParam->Set(currentValue);
+
+    SetParameterValue(i, pParam->Value());
+  }
+
+  return startIdx;
+}
+
+void IPlugEEL::ProcessBlock(sample** inputs, sample** outputs, int nFrames)
+{
+  bool reset = mResetRequested.exchange(false, std::memory_order_acquire);
+
+  // the last code that was replaced must have been freed, so there is somewhere to put this one
+  if (mRetired.load(std::memory_order_acquire) == nullptr)
+  {
+    if (Program* pNew = mPending.exchange(nullptr, std::memory_order_acq_rel))
+    {
+      mRetired.store(mActive.release(), std::memory_order_release);
+      mActive.reset(pNew);
+      reset = true;
+    }
+  }
+
+  Program* pProgram = mActive.get();
+
+  if (!pProgram)
+  {
+    for (auto c = 0; c < mNOutputs; c++)
+      memset(outputs[c], 0, nFrames * sizeof(sample));
+
+    return;
+  }
+
+  const int nSpl = std::max(mNInputs, mNOutputs);
+
+  if (reset)
+  {
+    *pProgram->mSrate = mSampleRate.load(std::memory_order_relaxed);
+    *pProgram->mNumCh = nSpl;
+
+    if (pProgram->mInit)
+      NSEEL_code_execute(pProgram->mInit);
+  }
+
+  if (mSlidersChanged.exchange(false, std::memory_order_acquire) || reset)
+  {
+    for (const Slider& slider : pProgram->mSliders)
+      *pProgram->mSliderVars[slider.mNumber - 1] = mSliderValues[slider.mNumber - 1].load(std::memory_order_relaxed);
+
+    if (pProgram->mSlider)
+      NSEEL_code_execute(pProgram->mSlider);
+  }
+
+  *pProgram->mSamplesBlock = nFrames;
+
+  if (pProgram->mBlock)
+    NSEEL_code_execute(pProgram->mBlock);
+
+  EEL_F** spl = pProgram->mSpl;
+
+  for (auto s = 0; s < nFrames; s++)
+  {
+    for (auto c = 0; c < nSpl; c++)
+      *spl[c] = c < mNInputs ? inputs[c][s] : 0.;
+
+    if (pProgram->mSample)
+      NSEEL_code_execute(pProgram->mSample);
+
+    for (auto c = 0; c < mNOutputs; c++)
+      outputs[c][s] = static_cast<sample>(*spl[c]);
+  }
+}
+
+IPlugEEL::Program* IPlugEEL::Compile(const std::string& sourceCode, std::string& error) const
+{
+  enum ESection { kHeader, kInit, kSlider, kBlock, kSample, kIgnored };
+
+  std::string sections[kIgnored + 1];
+  int firstLines[kIgnored + 1] = {};
+  ESection section = kHeader;
+  std::vector<Slider> sliders;
+  int lineNumber = 0;
+  size_t pos = 0;
+
+  while (pos < sourceCode.size())
+  {
+    size_t end = sourceCode.find('\n', pos);
+
+    if (end == std::string::npos)
+      end = sourceCode.size();
+
+    std::string line = sourceCode.substr(pos, end - pos);
+    pos = end + 1;
+    lineNumber++;
+
+    if (line.size() && line.back() == '\r')
+      line.pop_back();
+
+    if (line.size() && line[0] == '@')
+    {
+      const std::string name = line.substr(1, line.find_first_of(" \t") - 1);
+
+      if (name == "init") section = kInit;
+      else if (name == "slider") section = kSlider;
+      else if (name == "block") section = kBlock;
+      else if (name == "sample") section = kSample;
+      else section = kIgnored;
+
+      if (sections[section].empty())
+        firstLines[section] = lineNumber;
+
+      // keep the line count, so that errors point at the right line
+      sections[section] += "\n";
+      continue;
+    }
+
+    if (section == kHeader)
+    {
+      Slider slider;
+
+      if (ParseSlider(line.c_str(), slider))
+      {
+        for (const Slider& existing : sliders)
+        {
+          if (existing.mNumber == slider.mNumber)
+          {
+            error = "slider" + std::to_string(slider.mNumber) + " is declared twice";
+            return nullptr;
+          }
+        }
+
+        sliders.push_back(slider);
+      }
+    }
+    else
+      sections[section] += line + "\n";
+  }
+
+  std::unique_ptr<Program> pProgram(new Program);
+  pProgram->mVM = NSEEL_VM_alloc();
+
+  if (!pProgram->mVM)
+  {
+    error = "could not allocate the VM";
+    return nullptr;
+  }
+
+  for (auto c = 0; c < std::max(mNInputs, mNOutputs); c++)
+  {
+    const std::string name = "spl" + std::to_string(c);
+    pProgram->mSpl[c] = NSEEL_VM_regvar(pProgram->mVM, name.c_str());
+  }
+
+  for (const Slider& slider : sliders)
+    pProgram->mSliderVars[slider.mNumber - 1] = NSEEL_VM_regvar(pProgram->mVM, slider.mVarName.Get());
+
+  pProgram->mSrate = NSEEL_VM_regvar(pProgram->mVM, "srate");
+  pProgram->mSamplesBlock = NSEEL_VM_regvar(pProgram->mVM, "samplesblock");
+  pProgram->mNumCh = NSEEL_VM_regvar(pProgram->mVM, "num_ch");
+  pProgram->mSliders = std::move(sliders);
+
+  struct SectionInfo { ESection section; const char* name; NSEEL_CODEHANDLE* pHandle; int flags; };
+
+  const SectionInfo infos[] = {
+    { kInit, "@init", &pProgram->mInit, NSEEL_CODE_COMPILE_FLAG_COMMONFUNCS | NSEEL_CODE_COMPILE_FLAG_COMMONFUNCS_RESET },
+    { kSlider, "@slider", &pProgram->mSlider, NSEEL_CODE_COMPILE_FLAG_COMMONFUNCS },
+    { kBlock, "@block", &pProgram->mBlock, NSEEL_CODE_COMPILE_FLAG_COMMONFUNCS },
+    { kSample, "@sample", &pProgram->mSample, NSEEL_CODE_COMPILE_FLAG_COMMONFUNCS }
+  };
+
+  for (const SectionInfo& info : infos)
+  {
+    const std::string& code = sections[info.section];
+
+    if (code.find_first_not_of(" \t\r\n") == std::string::npos)
+      continue;
+
+    // the section's text starts with the newline of its @ line
+    *info.pHandle = NSEEL_code_compile_ex(pProgram->mVM, code.c_str(), firstLines[info.section] - 1, info.flags);
+
+    if (!*info.pHandle)
+    {
+      const char* codeError = NSEEL_code_getcodeerror(pProgram->mVM);
+      error = std::string(info.name) + ": " + (codeError ? codeError : "compile error");
+      return nullptr;
+    }
+  }
+
+  error.clear();
+  return pProgram.release();
+}
+
+bool IPlugEEL::ReadFile(const char* path, std::string& contents)
+{
+  FILE* pFile = fopen(path, "rb");
+
+  if (!pFile)
+    return false;
+
+  char buffer[4096];
+  size_t n;
+  contents.clear();
+
+  while ((n = fread(buffer, 1, sizeof(buffer), pFile)) > 0)
+    contents.append(buffer, n);
+
+  fclose(pFile);
+  return true;
+}
+
+bool IPlugEEL::ParseSlider(const char* line, Slider& slider)
+{
+  if (strncmp(line, "slider", 6))
+    return false;
+
+  char* pEnd = nullptr;
+  const long number = strtol(line + 6, &pEnd, 10);
+
+  if (pEnd == line + 6 || *pEnd != ':' || number < 1 || number > kMaxSliders)
+    return false;
+
+  const char* pText = pEnd + 1;
+  const char* pOpen = strchr(pText, '<');
+  const char* pClose = pOpen ? strchr(pOpen, '>') : nullptr;
+
+  // no range, e.g. a file slider
+  if (!pClose)
+    return false;
+
+  slider.mNumber = static_cast<int>(number);
+
+  const char* pEquals = strchr(pText, '=');
+
+  if (pEquals && pEquals < pOpen)
+  {
+    std::string name(pText, pEquals - pText);
+
+    while (name.size() && isspace(static_cast<unsigned char>(name.back())))
+      name.pop_back();
+
+    slider.mVarName.Set(name.c_str());
+    pText = pEquals + 1;
+  }
+  else
+    slider.mVarName.SetFormatted(16, "slider%d", slider.mNumber);
+
+  slider.mDefault = strtod(pText, nullptr);
+
+  const std::string range(pOpen + 1, pClose - pOpen - 1);
+  const size_t braceOpen = range.find('{');
+  const std::string numbers = range.substr(0, braceOpen);
+  const char* pNumber = numbers.c_str();
+
+  slider.mMin = strtod(pNumber, &pEnd);
+
+  if (*pEnd == ',')
+    slider.mMax = strtod(pEnd + 1, &pEnd);
+
+  if (*pEnd == ',')
+    slider.mStep = strtod(pEnd + 1, &pEnd);
+
+  if (braceOpen != std::string::npos)
+  {
+    const size_t braceClose = range.find('}', braceOpen);
+    const std::string labels = range.substr(braceOpen + 1, braceClose == std::string::npos ? std::string::npos : braceClose - braceOpen - 1);
+    size_t start = 0;
+
+    while (start <= labels.size())
+    {
+      const size_t comma = std::min(labels.find(',', start), labels.size());
+      slider.mEnumLabels.push_back(labels.substr(start, comma - start));
+      start = comma + 1;
+    }
+  }
+
+  // a leading minus hides the slider in JSFX, it is still a parameter here
+  const char* pLabel = pClose + 1;
+
+  if (*pLabel == '-')
+    pLabel++;
+
+  slider.mLabel.Set(pLabel);
+
+  if (!slider.mLabel.GetLength())
+    slider.mLabel.Set(slider.mVarName.Get());
+
+  return true;
+}
+
+void IPlugEEL::CompilerLoop()
+{
+  std::unique_lock<std::mutex> lock(mMutex);
+
+  while (true)
+  {
+    mWakeUp.wait_for(lock, std::chrono::milliseconds(kCollectIntervalMs), [&]() { return !mRunning || mHasRequest; });
+
+    delete mRetired.exchange(nullptr, std::memory_order_acq_rel);
+
+    if (!mRunning)
+      return;
+
+    if (!mHasRequest)
+      continue;
+
+    const std::string sourceCode = std::move(mRequest);
+    mRequest.clear();
+    mHasRequest = false;
+    mCompiling = true;
+    lock.unlock();
+
+    std::string error;
+    Program* pProgram = Compile(sourceCode, error);
+
+    if (pProgram)
+    {
+      // code that was never swapped in is simply replaced
+      delete mPending.exchange(pProgram, std::memory_order_acq_rel);
+    }
+    else
+      DBGMSG("IPlugEEL-%s: %s\n", mName.Get(), error.c_str());
+
+    lock.lock();
+    mLastError = error;
+    mCompiling = false;
+    mIdle.notify_all();
+  }
+}
@@ -0,0 +1,186 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc IPlugEEL
+ */
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "eel2/ns-eel.h"
+#include "wdlstring.h"
+
+#include "IPlugAPIBase.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** Runs JSFX style EEL2 code as DSP, compiled to native code by WDL's eel2 JIT, for prototyping at close to native speed.
+ * The code has \c sliderN:default<min,max,step>Name lines, from which IParams can be made with CreateIPlugParameters(), and \c @init, \c @slider, \c @block and \c @sample sections.
+ * As in JSFX, \c spl0 ... \c splN are the channels of the current sample, and \c srate, \c samplesblock and \c num_ch are set by IPlugEEL.
+ * A slider can be given a variable name, e.g. \c slider1:gain_db=0<-24,24,0.1>Gain (dB), and \c {A,B,C} after the step makes it an enum.
+ * Functions defined in \c @init can be called from the other sections. Other sections, such as \c @gfx and \c @serialize, are ignored.
+ *
+ * SetSourceCode() and LoadFile() compile on a worker thread, and the new code is swapped in at the start of a block by ProcessBlock() without locking.
+ * The new code starts from its own \c @init, with the current slider values. If it doesn't compile, the old code keeps running and GetLastError() says why.
+ *
+ * The eel2 sources must be built with the plug-in: nseel-caltab.c, nseel-cfunc.c, nseel-compiler.c, nseel-eval.c, nseel-lextab.c, nseel-ram.c and nseel-yylex.c from WDL/eel2,
+ * and on x86_64 asm-nseel-x64-sse.asm assembled with nasm (or the prebuilt asm-nseel-x64.obj / asm-nseel-x64-macho.o). Define EEL_TARGET_PORTABLE to use the portable interpreter instead.
+ * IPlugEEL.cpp implements NSEEL_HOSTSTUB_EnterMutex() and NSEEL_HOSTSTUB_LeaveMutex() unless IPLUG_EEL_NO_HOSTSTUBS is defined, for plug-ins that already use eel2 elsewhere */
+class IPlugEEL
+{
+public:
+  static constexpr int kMaxChannels = 64;
+  static constexpr int kMaxSliders = 64;
+
+  /** @param name A name for debug messages
+   * @param nInputs The number of input channels passed to ProcessBlock()
+   * @param nOutputs The number of output channels passed to ProcessBlock(). The spl variables of outputs without an input are zeroed for each sample */
+  IPlugEEL(const char* name, int nInputs, int nOutputs);
+  ~IPlugEEL();
+
+  IPlugEEL(const IPlugEEL&) = delete;
+  IPlugEEL& operator=(const IPlugEEL&) = delete;
+
+  /** Compile code on the calling thread and make it the running code. Call this in the plug-in's constructor, before CreateIPlugParameters(), so that the sliders are known
+   * @param sourceCode The EEL code
+   * @return \c true if it compiled, otherwise see GetLastError() */
+  bool Init(const char* sourceCode);
+
+  /** Read a file and compile it on the calling thread, see Init()
+   * @param path The full path of the file
+   * @return \c true if it was read and compiled */
+  bool InitFromFile(const char* path);
+
+  /** Compile new code in the background, replacing any compile that has not started yet. Call this from any thread except the audio thread.
+   * The sliders of the new code are matched to the parameters by index, so it should keep the same sliders
+   * @param sourceCode The EEL code */
+  void SetSourceCode(const char* sourceCode);
+
+  /** Read a file and compile it in the background, see SetSourceCode()
+   * @param path The full path of the file
+   * @return \c false if the file could not be read */
+  bool LoadFile(const char* path);
+
+  /** Block until the code passed to SetSourceCode() is compiled, e.g. in a test or offline render */
+  void WaitUntilCompiled();
+
+  /** @param error Set to the error of the last compile, or empty if it succeeded
+   * @return \c true if there was an error */
+  bool GetLastError(WDL_String& error) const;
+
+  /** Set the sample rate, which runs \c @init again at the start of the next block, as JSFX does when playback starts. Call this from OnReset() */
+  void SetSampleRate(double sampleRate);
+
+  /** Set a slider, which runs \c @slider at the start of the next block. Call this from OnParamChange() with the parameter's value
+   * @param sliderIdx The index of the slider in the order they appear in the code, which is the parameter's index minus the startIdx given to CreateIPlugParameters()
+   * @param value The non-normalized value. Enums count from 0 */
+  void SetParameterValue(int sliderIdx, double value);
+
+  /** Set the plug-in's parameters up from the sliders of the code passed to Init()
+   * @param pPlug The plug-in, which must have enough parameters
+   * @param startIdx The index of the parameter for the first slider
+   * @param setToDefault If \c true the parameters are set to their defaults
+   * @return The index of the first parameter, or -1 if there are no sliders */
+  int CreateIPlugParameters(IPlugAPIBase* pPlug, int startIdx = 0, bool setToDefault = true);
+
+  /** @return The number of sliders in the code passed to Init() */
+  int NParams() const { return static_cast<int>(mSliders.size()); }
+
+  /** Run the code for a block. Any channels of the outputs beyond nOutputs are left alone
+   * @param inputs The input buffers, can be nullptr if there are no inputs
+   * @param outputs The output buffers, which can be the same buffers as the inputs
+   * @param nFrames The number of frames */
+  void ProcessBlock(sample** inputs, sample** outputs, int nFrames);
+
+private:
+  /** A \c sliderN: line */
+  struct Slider
+  {
+    int mNumber = 0; // N, from 1
+    WDL_String mVarName; // sliderN unless it was named
+    WDL_String mLabel;
+    double mDefault = 0.;
+    double mMin = 0.;
+    double mMax = 1.;
+    double mStep = 0.;
+    std::vector<std::string> mEnumLabels;
+  };
+
+  /** Compiled code, with its own VM */
+  struct Program
+  {
+    ~Program();
+
+    NSEEL_VMCTX mVM = nullptr;
+    NSEEL_CODEHANDLE mInit = nullptr;
+    NSEEL_CODEHANDLE mSlider = nullptr;
+    NSEEL_CODEHANDLE mBlock = nullptr;
+    NSEEL_CODEHANDLE mSample = nullptr;
+    EEL_F* mSpl[kMaxChannels] = {};
+    EEL_F* mSliderVars[kMaxSliders] = {};
+    EEL_F* mSrate = nullptr;
+    EEL_F* mSamplesBlock = nullptr;
+    EEL_F* mNumCh = nullptr;
+    std::vector<Slider> mSliders;
+  };
+
+  /** Parse and compile code
+   * @param error Set if it doesn't compile
+   * @return The program, or nullptr on error */
+  Program* Compile(const std::string& sourceCode, std::string& error) const;
+
+  /** Read a whole file
+   * @return \c true if it was read */
+  static bool ReadFile(const char* path, std::string& contents);
+
+  /** Parse a \c sliderN: line
+   * @return \c true if it is a slider that can be a parameter */
+  static bool ParseSlider(const char* line, Slider& slider);
+
+  void SetError(const std::string& error);
+  void CompilerLoop();
+
+  const WDL_String mName;
+  const int mNInputs;
+  const int mNOutputs;
+  std::vector<Slider> mSliders; // the sliders of the code passed to Init(), which the parameters were made from
+  std::atomic<double> mSliderValues[kMaxSliders];
+  std::atomic<bool> mSlidersChanged {true};
+  std::atomic<double> mSampleRate {DEFAULT_SAMPLE_RATE};
+  std::atomic<bool> mResetRequested {true};
+
+  std::atomic<Program*> mPending {nullptr}; // compiled, waiting for the audio thread
+  std::atomic<Program*> mRetired {nullptr}; // replaced by the audio thread, waiting for the compiler thread to free it
+
+  // audio thread
+  std::unique_ptr<Program> mActive;
+
+  // compiler thread, guarded by mMutex
+  std::string mRequest;
+  std::string mLastError;
+  bool mHasRequest = false;
+  bool mCompiling = false;
+  bool mRunning = true;
+  std::thread mCompiler;
+  mutable std::mutex mMutex;
+  std::condition_variable mWakeUp;
+  std::condition_variable mIdle;
+};
+
+END_IPLUG_NAMESPACE
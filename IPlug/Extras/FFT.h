@@ -0,0 +1,397 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc FFT
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "fft.h"
+
+#if defined IPLUG_FFT_USE_ACCELERATE
+  #include <Accelerate/Accelerate.h>
+#elif defined IPLUG_FFT_USE_IPP
+  #include <ipps.h>
+#elif defined IPLUG_FFT_USE_PFFFT
+  #if WDL_FFT_REALSIZE != 4
+    #error PFFFT only works with WDL_FFT_REALSIZE 4
+  #endif
+  #include "pffft.h"
+#endif
+
+#include "IPlugPlatform.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** Power of two FFTs of WDL_FFT_REAL data, with a choice of backend made when compiling:
+ * - IPLUG_FFT_USE_ACCELERATE uses vDSP, on macOS and iOS. Link Accelerate.framework
+ * - IPLUG_FFT_USE_IPP uses Intel IPP. Add its include and library paths
+ * - IPLUG_FFT_USE_PFFFT uses PFFFT, a portable SSE/NEON FFT, for float only. Add pffft.c and pffft.h to the project
+ * - otherwise WDL/fft.c, which must be compiled into the project
+ *
+ * Whatever the backend, the results are in natural order and scaled as WDL's are, so code can switch backends without changes:
+ * - Complex(): forward gives the DFT, inverse gives size times the input of the forward transform
+ * - Real(): forward packs the DC and Nyquist bins into the first complex value, then bins 1 to size / 2 - 1, all doubled as with WDL_real_fft(). Inverse of that gives 2 * size times the input
+ *
+ * An FFT object holds its own buffers, so use one per thread. SetSize() allocates, the transforms don't.
+ * ConvolutionFFT() lets WDL_ConvolutionEngine, and so PartitionedConvolutionEngine, use the same backend, see IPLUG_FFT_CONVOLUTION_HOOK */
+class FFT
+{
+public:
+  static constexpr int kMaxSize = 32768; // WDL's largest FFT
+  static constexpr int kMaxOrder = 15;
+
+  enum EBackend
+  {
+    kWDL = 0,
+    kAccelerate,
+    kIPP,
+    kPFFFT
+  };
+
+  FFT(int size = 0)
+  {
+    WDL_fft_init();
+
+    if (size)
+      SetSize(size);
+  }
+
+  ~FFT() { Free(); }
+
+  FFT(const FFT&) = delete;
+  FFT& operator=(const FFT&) = delete;
+
+  /** @param size The size, a power of two from 4 to kMaxSize, in complex values for Complex() and real values for Real()
+   * @return \c true if the size is supported */
+  bool SetSize(int size)
+  {
+    int order = 2;
+
+    while ((1 << order) < size && order < kMaxOrder)
+      order++;
+
+    if ((1 << order) != size)
+      return false;
+
+    if (size == mSize)
+      return true;
+
+    Free();
+    mSize = size;
+    mOrder = order;
+    mScratch.resize(size);
+
+#if defined IPLUG_FFT_USE_ACCELERATE
+  #if WDL_FFT_REALSIZE == 8
+    mSetup = vDSP_create_fftsetupD(order, kFFTRadix2);
+  #else
+    mSetup = vDSP_create_fftsetup(order, kFFTRadix2);
+  #endif
+    mSplit.resize(2 * size);
+#elif defined IPLUG_FFT_USE_IPP
+    int specSize = 0, specBufferSize = 0, bufferSize = 0, realBufferSize = 0;
+  #if WDL_FFT_REALSIZE == 8
+    ippsFFTGetSize_C_64fc(order, IPP_FFT_NODIV_BY_ANY, ippAlgHintNone, &specSize, &specBufferSize, &bufferSize);
+    mComplexSpecMem = ippsMalloc_8u(specSize);
+    Ipp8u* pSpecBuffer = specBufferSize ? ippsMalloc_8u(specBufferSize) : nullptr;
+    ippsFFTInit_C_64fc(&mComplexSpec, order, IPP_FFT_NODIV_BY_ANY, ippAlgHintNone, mComplexSpecMem, pSpecBuffer);
+    ippsFree(pSpecBuffer);
+
+    ippsFFTGetSize_R_64f(order, IPP_FFT_NODIV_BY_ANY, ippAlgHintNone, &specSize, &specBufferSize, &realBufferSize);
+    mRealSpecMem = ippsMalloc_8u(specSize);
+    pSpecBuffer = specBufferSize ? ippsMalloc_8u(specBufferSize) : nullptr;
+    ippsFFTInit_R_64f(&mRealSpec, order, IPP_FFT_NODIV_BY_ANY, ippAlgHintNone, mRealSpecMem, pSpecBuffer);
+    ippsFree(pSpecBuffer);
+  #else
+    ippsFFTGetSize_C_32fc(order, IPP_FFT_NODIV_BY_ANY, ippAlgHintNone, &specSize, &specBufferSize, &bufferSize);
+    mComplexSpecMem = ippsMalloc_8u(specSize);
+    Ipp8u* pSpecBuffer = specBufferSize ? ippsMalloc_8u(specBufferSize) : nullptr;
+    ippsFFTInit_C_32fc(&mComplexSpec, order, IPP_FFT_NODIV_BY_ANY, ippAlgHintNone, mComplexSpecMem, pSpecBuffer);
+    ippsFree(pSpecBuffer);
+
+    ippsFFTGetSize_R_32f(order, IPP_FFT_NODIV_BY_ANY, ippAlgHintNone, &specSize, &specBufferSize, &realBufferSize);
+    mRealSpecMem = ippsMalloc_8u(specSize);
+    pSpecBuffer = specBufferSize ? ippsMalloc_8u(specBufferSize) : nullptr;
+    ippsFFTInit_R_32f(&mRealSpec, order, IPP_FFT_NODIV_BY_ANY, ippAlgHintNone, mRealSpecMem, pSpecBuffer);
+    ippsFree(pSpecBuffer);
+  #endif
+    mWorkBuffer = ippsMalloc_8u(std::max(std::max(bufferSize, realBufferSize), 1));
+#elif defined IPLUG_FFT_USE_PFFFT
+    // PFFFT needs sizes that are multiples of 16 complex or 32 real values, smaller ones fall back to WDL
+    if (size >= 16)
+      mComplexSetup = pffft_new_setup(size, PFFFT_COMPLEX);
+    if (size >= 32)
+      mRealSetup = pffft_new_setup(size, PFFFT_REAL);
+
+    mAligned = static_cast<float*>(pffft_aligned_malloc(2 * size * sizeof(float)));
+    mWork = static_cast<float*>(pffft_aligned_malloc(2 * size * sizeof(float)));
+#endif
+    return true;
+  }
+
+  int GetSize() const { return mSize; }
+
+  /** In place complex FFT, in natural order
+   * @param pData GetSize() complex values
+   * @param inverse \c true for the inverse transform, which is not scaled */
+  void Complex(WDL_FFT_COMPLEX* pData, bool inverse)
+  {
+    assert(mSize);
+
+#if defined IPLUG_FFT_USE_ACCELERATE
+  #if WDL_FFT_REALSIZE == 8
+    DSPDoubleSplitComplex split = { mSplit.data(), mSplit.data() + mSize };
+    vDSP_ctozD(reinterpret_cast<DSPDoubleComplex*>(pData), 2, &split, 1, mSize);
+    vDSP_fft_zipD(mSetup, &split, 1, mOrder, inverse ? kFFTDirection_Inverse : kFFTDirection_Forward);
+    vDSP_ztocD(&split, 1, reinterpret_cast<DSPDoubleComplex*>(pData), 2, mSize);
+  #else
+    DSPSplitComplex split = { mSplit.data(), mSplit.data() + mSize };
+    vDSP_ctoz(reinterpret_cast<DSPComplex*>(pData), 2, &split, 1, mSize);
+    vDSP_fft_zip(mSetup, &split, 1, mOrder, inverse ? kFFTDirection_Inverse : kFFTDirection_Forward);
+    vDSP_ztoc(&split, 1, reinterpret_cast<DSPComplex*>(pData), 2, mSize);
+  #endif
+#elif defined IPLUG_FFT_USE_IPP
+  #if WDL_FFT_REALSIZE == 8
+    if (inverse)
+      ippsFFTInv_CToC_64fc_I(reinterpret_cast<Ipp64fc*>(pData), mComplexSpec, mWorkBuffer);
+    else
+      ippsFFTFwd_CToC_64fc_I(reinterpret_cast<Ipp64fc*>(pData), mComplexSpec, mWorkBuffer);
+  #else
+    if (inverse)
+      ippsFFTInv_CToC_32fc_I(reinterpret_cast<Ipp32fc*>(pData), mComplexSpec, mWorkBuffer);
+    else
+      ippsFFTFwd_CToC_32fc_I(reinterpret_cast<Ipp32fc*>(pData), mComplexSpec, mWorkBuffer);
+  #endif
+#else
+  #if defined IPLUG_FFT_USE_PFFFT
+    if (mComplexSetup)
+    {
+      // PFFFT wants 16 byte aligned data
+      memcpy(mAligned, pData, mSize * sizeof(WDL_FFT_COMPLEX));
+      pffft_transform_ordered(mComplexSetup, mAligned, mAligned, mWork, inverse ? PFFFT_BACKWARD : PFFFT_FORWARD);
+      memcpy(pData, mAligned, mSize * sizeof(WDL_FFT_COMPLEX));
+      return;
+    }
+  #endif
+    const int* pPermute = WDL_fft_permute_tab(mSize);
+
+    if (inverse)
+    {
+      for (auto k = 0; k < mSize; k++)
+        mScratch[pPermute[k]] = pData[k];
+
+      memcpy(pData, mScratch.data(), mSize * sizeof(WDL_FFT_COMPLEX));
+      WDL_fft(pData, mSize, 1);
+    }
+    else
+    {
+      WDL_fft(pData, mSize, 0);
+
+      for (auto k = 0; k < mSize; k++)
+        mScratch[k] = pData[pPermute[k]];
+
+      memcpy(pData, mScratch.data(), mSize * sizeof(WDL_FFT_COMPLEX));
+    }
+#endif
+  }
+
+  /** In place real FFT, in natural order, packed as WDL_real_fft() packs it
+   * @param pData GetSize() real values, or GetSize() / 2 complex values
+   * @param inverse \c true for the inverse transform, which is not scaled */
+  void Real(WDL_FFT_REAL* pData, bool inverse)
+  {
+    assert(mSize);
+    const int half = mSize / 2;
+
+#if defined IPLUG_FFT_USE_ACCELERATE
+    // vDSP's packing and scaling are the same as WDL's
+  #if WDL_FFT_REALSIZE == 8
+    DSPDoubleSplitComplex split = { mSplit.data(), mSplit.data() + half };
+    vDSP_ctozD(reinterpret_cast<DSPDoubleComplex*>(pData), 2, &split, 1, half);
+    vDSP_fft_zripD(mSetup, &split, 1, mOrder, inverse ? kFFTDirection_Inverse : kFFTDirection_Forward);
+    vDSP_ztocD(&split, 1, reinterpret_cast<DSPDoubleComplex*>(pData), 2, half);
+  #else
+    DSPSplitComplex split = { mSplit.data(), mSplit.data() + half };
+    vDSP_ctoz(reinterpret_cast<DSPComplex*>(pData), 2, &split, 1, half);
+    vDSP_fft_zrip(mSetup, &split, 1, mOrder, inverse ? kFFTDirection_Inverse : kFFTDirection_Forward);
+    vDSP_ztoc(&split, 1, reinterpret_cast<DSPComplex*>(pData), 2, half);
+  #endif
+#elif defined IPLUG_FFT_USE_IPP
+    // IPP's Perm format is packed like WDL's, but not doubled
+  #if WDL_FFT_REALSIZE == 8
+    if (inverse)
+      ippsFFTInv_PermToR_64f_I(pData, mRealSpec, mWorkBuffer);
+    else
+    {
+      ippsFFTFwd_RToPerm_64f_I(pData, mRealSpec, mWorkBuffer);
+      ippsMulC_64f_I(2., pData, mSize);
+    }
+  #else
+    if (inverse)
+      ippsFFTInv_PermToR_32f_I(pData, mRealSpec, mWorkBuffer);
+    else
+    {
+      ippsFFTFwd_RToPerm_32f_I(pData, mRealSpec, mWorkBuffer);
+      ippsMulC_32f_I(2.f, pData, mSize);
+    }
+  #endif
+#else
+  #if defined IPLUG_FFT_USE_PFFFT
+    if (mRealSetup)
+    {
+      // PFFFT's ordered output is packed like WDL's, but not doubled
+      memcpy(mAligned, pData, mSize * sizeof(float));
+      pffft_transform_ordered(mRealSetup, mAligned, mAligned, mWork, inverse ? PFFFT_BACKWARD : PFFFT_FORWARD);
+      const float scale = inverse ? 1.f : 2.f;
+
+      for (auto i = 0; i < mSize; i++)
+        pData[i] = mAligned[i] * scale;
+
+      return;
+    }
+  #endif
+    WDL_FFT_COMPLEX* pBins = reinterpret_cast<WDL_FFT_COMPLEX*>(pData);
+    const int* pPermute = WDL_fft_permute_tab(half);
+
+    if (inverse)
+    {
+      mScratch[0] = pBins[0];
+
+      for (auto k = 1; k < half; k++)
+        mScratch[pPermute[k]] = pBins[k];
+
+      memcpy(pBins, mScratch.data(), half * sizeof(WDL_FFT_COMPLEX));
+      WDL_real_fft(pData, mSize, 1);
+    }
+    else
+    {
+      WDL_real_fft(pData, mSize, 0);
+      mScratch[0] = pBins[0];
+
+      for (auto k = 1; k < half; k++)
+        mScratch[k] = pBins[pPermute[k]];
+
+      memcpy(pBins, mScratch.data(), half * sizeof(WDL_FFT_COMPLEX));
+    }
+#endif
+  }
+
+  /** @return The backend chosen when compiling */
+  static constexpr EBackend GetBackend()
+  {
+#if defined IPLUG_FFT_USE_ACCELERATE
+    return kAccelerate;
+#elif defined IPLUG_FFT_USE_IPP
+    return kIPP;
+#elif defined IPLUG_FFT_USE_PFFFT
+    return kPFFFT;
+#else
+    return kWDL;
+#endif
+  }
+
+  /** An in place complex FFT with WDL_fft()'s signature, for WDL_ConvolutionEngine. With the WDL backend this is WDL_fft() itself, and the bins stay in its permuted order,
+   * which is all the convolution needs. Otherwise each thread gets an FFT per size, which is allocated on the first transform of that size on that thread */
+  static void ConvolutionFFT(WDL_FFT_COMPLEX* pData, int size, int isInverse)
+  {
+    if (GetBackend() == kWDL)
+    {
+      WDL_fft(pData, size, isInverse);
+      return;
+    }
+
+    thread_local std::unique_ptr<FFT> sFFTs[kMaxOrder + 1];
+    int order = 2;
+
+    while ((1 << order) < size && order < kMaxOrder)
+      order++;
+
+    if (!sFFTs[order])
+      sFFTs[order].reset(new FFT(size));
+
+    sFFTs[order]->Complex(pData, isInverse != 0);
+  }
+
+private:
+  void Free()
+  {
+#if defined IPLUG_FFT_USE_ACCELERATE
+  #if WDL_FFT_REALSIZE == 8
+    if (mSetup)
+      vDSP_destroy_fftsetupD(mSetup);
+  #else
+    if (mSetup)
+      vDSP_destroy_fftsetup(mSetup);
+  #endif
+    mSetup = nullptr;
+#elif defined IPLUG_FFT_USE_IPP
+    ippsFree(mComplexSpecMem);
+    ippsFree(mRealSpecMem);
+    ippsFree(mWorkBuffer);
+    mComplexSpecMem = mRealSpecMem = mWorkBuffer = nullptr;
+    mComplexSpec = nullptr;
+    mRealSpec = nullptr;
+#elif defined IPLUG_FFT_USE_PFFFT
+    if (mComplexSetup)
+      pffft_destroy_setup(mComplexSetup);
+    if (mRealSetup)
+      pffft_destroy_setup(mRealSetup);
+    pffft_aligned_free(mAligned);
+    pffft_aligned_free(mWork);
+    mComplexSetup = mRealSetup = nullptr;
+    mAligned = mWork = nullptr;
+#endif
+    mSize = 0;
+  }
+
+  int mSize = 0;
+  int mOrder = 0;
+  std::vector<WDL_FFT_COMPLEX> mScratch;
+
+#if defined IPLUG_FFT_USE_ACCELERATE
+  #if WDL_FFT_REALSIZE == 8
+  FFTSetupD mSetup = nullptr;
+  #else
+  FFTSetup mSetup = nullptr;
+  #endif
+  std::vector<WDL_FFT_REAL> mSplit;
+#elif defined IPLUG_FFT_USE_IPP
+  #if WDL_FFT_REALSIZE == 8
+  IppsFFTSpec_C_64fc* mComplexSpec = nullptr;
+  IppsFFTSpec_R_64f* mRealSpec = nullptr;
+  #else
+  IppsFFTSpec_C_32fc* mComplexSpec = nullptr;
+  IppsFFTSpec_R_32f* mRealSpec = nullptr;
+  #endif
+  Ipp8u* mComplexSpecMem = nullptr;
+  Ipp8u* mRealSpecMem = nullptr;
+  Ipp8u* mWorkBuffer = nullptr;
+#elif defined IPLUG_FFT_USE_PFFFT
+  PFFFT_Setup* mComplexSetup = nullptr;
+  PFFFT_Setup* mRealSetup = nullptr;
+  float* mAligned = nullptr;
+  float* mWork = nullptr;
+#endif
+};
+
+/** Put this at global scope in one source file of a project that defines WDL_CONVO_FFT=IPlugConvolutionFFT project wide, to route WDL_ConvolutionEngine's FFTs through FFT */
+#define IPLUG_FFT_CONVOLUTION_HOOK \
+  void IPlugConvolutionFFT(WDL_FFT_COMPLEX* pData, int size, int isInverse) { iplug::FFT::ConvolutionFFT(pData, size, isInverse); }
+
+END_IPLUG_NAMESPACE
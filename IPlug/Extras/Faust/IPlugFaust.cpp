@@ -43,18 +43,97 @@ void IPlugFaust::ProcessBlock(sample** inputs, sample** outputs, int nFrames)
   {
     assert(mDSP->getSampleRate() != 0); // did you forget to call SetSampleRate?
 
-    if (mOverSampler)
-      mOverSampler->ProcessBlock(inputs, outputs, nFrames, 2, 2 /* TODO: flexible channel count */,
-        [&](sample** inputs, sample** outputs, int nFrames) //TODO:: badness capture = allocated
-        {
-          mDSP->compute(nFrames, inputs, outputs);
-        });
+    if (mRamps && mRamps->NMoving())
+      ProcessRamps(inputs, outputs, nFrames);
     else
-      mDSP->compute(nFrames, inputs, outputs);
+      ComputeBlock(inputs, outputs, nFrames);
   }
   //    else silence?
 }
 
+void IPlugFaust::ComputeBlock(sample** inputs, sample** outputs, int nFrames)
+{
+  if (mOverSampler)
+    mOverSampler->ProcessBlock(inputs, outputs, nFrames, 2, 2 /* TODO: flexible channel count */,
+      [&](sample** inputs, sample** outputs, int nFrames) //TODO:: badness capture = allocated
+      {
+        mDSP->compute(nFrames, inputs, outputs);
+      });
+  else
+    mDSP->compute(nFrames, inputs, outputs);
+}
+
+void IPlugFaust::ProcessRamps(sample** inputs, sample** outputs, int nFrames)
+{
+  const int nInputs = static_cast<int>(mRampInputs.size());
+  const int nOutputs = static_cast<int>(mRampOutputs.size());
+
+  for (auto s = 0; s < nFrames; s += kRampBlockSize)
+  {
+    const int chunkSize = std::min(kRampBlockSize, nFrames - s);
+
+    mRamps->ProcessBlock(chunkSize);
+
+    for (auto r = 0; r < chunkSize; r += mRampGranularity)
+    {
+      const int segmentSize = std::min(mRampGranularity, chunkSize - r);
+
+      // Faust reads its zones once per compute(), so each segment sees the ramp's value at its start
+      for (auto p : mRampedParams)
+        *mZones.Get(p) = mRamps->Get(p)[r];
+
+      for (auto c = 0; c < nInputs; c++)
+        mRampInputs[c] = inputs[c] + s + r;
+
+      for (auto c = 0; c < nOutputs; c++)
+        mRampOutputs[c] = outputs[c] + s + r;
+
+      ComputeBlock(mRampInputs.data(), mRampOutputs.data(), segmentSize);
+    }
+  }
+}
+
+void IPlugFaust::SetZone(int paramIdx, FAUSTFLOAT value)
+{
+  if (mRamps && paramIdx < mRamps->NParams())
+  {
+    if (mParams.Get(paramIdx)->Type() == IParam::kTypeDouble)
+    {
+      mRamps->SetTarget(paramIdx, value);
+      return;
+    }
+
+    mRamps->SetValue(paramIdx, value);
+  }
+
+  *(mZones.Get(paramIdx)) = value;
+}
+
+void IPlugFaust::ResetParameterRamps()
+{
+  if (!mRampsEnabled || !mDSP || mZones.GetSize() != NParams())
+  {
+    mRamps = nullptr;
+    return;
+  }
+
+  mRamps = std::make_unique<ParamSmoothers<FAUSTFLOAT>>(NParams(), mRampTimeMs);
+  mRamps->Reset(mSampleRate, kRampBlockSize);
+  mRampedParams.clear();
+
+  for (auto p = 0; p < NParams(); p++)
+  {
+    mRamps->SetValue(p, *mZones.Get(p));
+
+    if (mParams.Get(p)->Type() == IParam::kTypeDouble)
+      mRampedParams.push_back(p);
+  }
+
+  const int nChans = mOverSampler ? 2 : 0; /* TODO: flexible channel count */
+  mRampInputs.resize(std::max(nChans, mDSP->getNumInputs()));
+  mRampOutputs.resize(std::max(nChans, mDSP->getNumOutputs()));
+}
+
 void IPlugFaust::SetParameterValueNormalised(int paramIdx, double normalizedValue)
 {
   if (paramIdx > kNoParameter && paramIdx >= NParams())
@@ -66,7 +145,7 @@ void IPlugFaust::SetParameterValueNormalised(int paramIdx, double normalizedValu
     mParams.Get(paramIdx)->SetNormalized(normalizedValue);
 
     if (mZones.GetSize() == NParams())
-      *(mZones.Get(paramIdx)) = mParams.Get(paramIdx)->Value();
+      SetZone(paramIdx, mParams.Get(paramIdx)->Value());
     else
       DBGMSG("IPlugFaust-%s:: Missing zone for parameter %s\n", mName.Get(), mParams.Get(paramIdx)->GetName());
   }
@@ -81,7 +160,7 @@ void IPlugFaust::SetParameterValue(int paramIdx, double nonNormalizedValue)
     mParams.Get(paramIdx)->Set(nonNormalizedValue);
 
     if (mZones.GetSize() == NParams())
-      *(mZones.Get(paramIdx)) = nonNormalizedValue;
+      SetZone(paramIdx, nonNormalizedValue);
     else
       DBGMSG("IPlugFaust-%s:: Missing zone for parameter %s\n", mName.Get(), mParams.Get(paramIdx)->GetName());
   }
@@ -95,7 +174,11 @@ void IPlugFaust::SetParameterValue(const char* labelToLookup, double nonNormaliz
   dest = mMap.Get(labelToLookup, nullptr);
   //    mParams.Get(paramIdx)->Set(nonNormalizedValue); // TODO: we are not updating the IPlug parameter
 
-  if (dest)
+  const int paramIdx = mRamps ? FindExistingParameterWithName(labelToLookup) : -1;
+
+  if (paramIdx > -1 && mZones.GetSize() == NParams())
+    SetZone(paramIdx, nonNormalizedValue);
+  else if (dest)
     *dest = nonNormalizedValue;
   else
     DBGMSG("IPlugFaust-%s:: No parameter named %s\n", mName.Get(), labelToLookup);
@@ -167,7 +250,7 @@ void IPlugFaust::AddOrUpdateParam(IParam::EParamType type, const char* label, FA
   mZones.Add(zone);
 }
 
-void IPlugFaust::BuildParameterMap()
+void IPlugFaust::BuildParameterMap(bool setToDefault)
 {
   for (auto p = 0; p < NParams(); p++)
   {
@@ -176,9 +259,11 @@ void IPlugFaust::BuildParameterMap()
 
   if (mIPlugParamStartIdx > -1 && mPlug != nullptr) // if we've already linked parameters
   {
-    CreateIPlugParameters(mPlug, mIPlugParamStartIdx);
+    CreateIPlugParameters(mPlug, mIPlugParamStartIdx, -1, setToDefault);
   }
 
+  ResetParameterRamps(); // the zones and parameters may have changed
+
   for (auto p = 0; p < NParams(); p++)
   {
     DBGMSG("%i %s\n", p, mParams.Get(p)->GetName());
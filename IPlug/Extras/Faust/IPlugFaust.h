@@ -30,6 +30,7 @@
 #include "IPlugAPIBase.h"
 
 #include "Oversampler.h"
+#include "Smoothers.h"
 
 #ifndef FAUST_SHARE_PATH
   #if defined OS_MAC || defined OS_LINUX
@@ -68,6 +69,11 @@ public:
    * @param path The absolute path to process.svg for this instance. */
   virtual void GetDrawPath(WDL_String& path) {}
 
+  /** In FaustGen this sets the options used to compile the .dsp file, e.g. {"-vec", "-vs", "32"}. The options for the FAUST_COMPILED code are those that were set when CompileCPP() generated it.
+   * There is a NO-OP implementation here so that when not using the JIT compiler, the same class can be used interchangeably
+   * @param options The faust compiler options */
+  virtual void SetCompileOptions(std::initializer_list<const char*> options) {}
+
   /** Call this method from FaustGen in order to execute a shell command and compile the C++ code against the IPlugFaust_arch architecture file
    * There is a NO-OP implementation here so that when not using the JIT compiler, the same class can be used interchangeably
    * @return \c true on success */
@@ -101,6 +107,24 @@ public:
       mDSP->init(((int) sampleRate) * multiplier);
       SyncFaustParams();
     }
+
+    mSampleRate = sampleRate;
+    ResetParameterRamps();
+  }
+
+  /** Smooth continuous parameters in IPlugFaust instead of in the .dsp code, so sliders don't need si.smoo, which costs CPU on every sample.
+   * Whilst parameters move, ProcessBlock() splits compute() into segments of granularity frames and sets the zones to a ParamSmoothers ramp at the start of each one.
+   * Combined with IPlugProcessor::SetSampleAccurateEvents(), changes also land at their offsets in the block.
+   * Buttons, checkboxes and enums are not smoothed. Call this after Init(), not from the audio thread. With ramps enabled, SetParameterValue() should be called on the audio thread, e.g. from OnParamChange()
+   * @param enable \c true to smooth the parameters
+   * @param timeMs The smoothing time
+   * @param granularity The number of frames between zone updates, smaller is smoother but splits compute() more often */
+  void SetParameterRamps(bool enable, double timeMs = 5., int granularity = 16)
+  {
+    mRampTimeMs = timeMs;
+    mRampGranularity = std::max(1, granularity);
+    mRampsEnabled = enable;
+    ResetParameterRamps();
   }
 
   void ProcessMidiMsg(const IMidiMsg& msg)
@@ -172,9 +196,25 @@ public:
 protected:
   void AddOrUpdateParam(IParam::EParamType type, const char* label, FAUSTFLOAT* zone, FAUSTFLOAT init = 0., FAUSTFLOAT min = 0., FAUSTFLOAT max = 0., FAUSTFLOAT step = 1.);
   
-  void BuildParameterMap();
+  /** Maps the FAUST zones by name and, if parameters are linked, updates the plug-in's parameters
+   * @param setToDefault If false the linked parameters keep their current values, e.g. across a FaustGen hot swap */
+  void BuildParameterMap(bool setToDefault = true);
 
   int FindExistingParameterWithName(const char* name);
+
+  /** Write a value to a parameter's zone, or if parameter ramps are enabled and it is continuous, smooth towards it */
+  void SetZone(int paramIdx, FAUSTFLOAT value);
+
+  /** Reallocate the parameter ramps, when they are enabled, starting from the current zone values. Called when the DSP, the parameters or the sample rate change */
+  void ResetParameterRamps();
+
+  /** Compute a block, through the oversampler if there is one */
+  void ComputeBlock(sample** inputs, sample** outputs, int nFrames);
+
+  /** Compute a block in segments of mRampGranularity frames, setting the zones of the ramped parameters before each one */
+  void ProcessRamps(sample** inputs, sample** outputs, int nFrames);
+
+  static constexpr int kRampBlockSize = 256; // the ramps are computed in chunks of this many frames, so they don't depend on the host's block size
     
   void OnUITimer(Timer& timer)
   {
@@ -195,6 +235,15 @@ protected:
   
   IPlugAPIBase* mPlug = nullptr;
   bool mInitialized = false;
+
+  bool mRampsEnabled = false;
+  double mRampTimeMs = 5.;
+  int mRampGranularity = 16;
+  double mSampleRate = DEFAULT_SAMPLE_RATE;
+  std::unique_ptr<ParamSmoothers<FAUSTFLOAT>> mRamps;
+  std::vector<int> mRampedParams; // the continuous parameters, whose zones are written from the ramps
+  std::vector<sample*> mRampInputs;
+  std::vector<sample*> mRampOutputs;
 };
 
 END_IPLUG_NAMESPACE
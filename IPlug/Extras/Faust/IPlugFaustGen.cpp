@@ -24,8 +24,40 @@ int FaustGen::sFaustGenCounter = 0;
 int FaustGen::Factory::sFactoryCounter = 0;
 bool FaustGen::sAutoRecompile = false;
 std::map<std::string, FaustGen::Factory *> FaustGen::Factory::sFactoryMap;
+WDL_String FaustGen::Factory::sMachineCodeCachePath;
 Timer* FaustGen::sTimer = nullptr;
 
+static bool CreateFolders(const char* path)
+{
+  WDL_String folder(path);
+  char* pPath = folder.Get();
+
+  for (char* pChar = pPath + 1; ; pChar++)
+  {
+    const bool end = !*pChar;
+
+    if (end || *pChar == '/' || *pChar == '\\')
+    {
+      const char sep = *pChar;
+      *pChar = '\0';
+#ifdef OS_WIN
+      wchar_t folderW[MAX_PATH];
+      UTF8ToUTF16(folderW, pPath, MAX_PATH);
+      CreateDirectoryW(folderW, NULL);
+#else
+      mkdir(pPath, S_IRWXU | S_IRWXG | S_IRWXO);
+#endif
+      *pChar = sep;
+    }
+
+    if (end)
+      break;
+  }
+
+  StatType buf;
+  return GetStat(path, &buf) == 0;
+}
+
 FaustGen::Factory::Factory(const char* name, const char* libraryPath, const char* drawPath, const char* inputDSP)
 {
   mPreviousTime = TimeZero();
@@ -41,7 +73,19 @@ FaustGen::Factory::Factory(const char* name, const char* libraryPath, const char
 
 FaustGen::Factory::~Factory()
 {
+  if (mPendingCompile.valid())
+  {
+    CompileResult result = mPendingCompile.get();
+
+    if (result.mFactory)
+      deleteDSPFactory(result.mFactory);
+  }
+
   FreeDSPFactory();
+
+  for (auto pFactory : mRetiredFactories)
+    deleteDSPFactory(pFactory);
+
   mSourceCodeStr.Set("");
   mBitCodeStr.Set("");
 }
@@ -79,36 +123,97 @@ llvm_dsp_factory* FaustGen::Factory::CreateFactoryFromBitCode()
   */
 }
 
-llvm_dsp_factory *FaustGen::Factory::CreateFactoryFromSourceCode()
+llvm_dsp_factory* FaustGen::Factory::CompileFactory(const std::string& name, const std::string& sourceCode, const std::vector<std::string>& options, int optimizationLevel,
+                                                     const std::string& cachePath, std::string& error)
 {
-  WDL_String name;
-  name.SetFormatted(64, "FaustGen-%d", mInstanceIdx);
+  WDL_String cacheFile;
 
-  SetDefaultCompileOptions();
-  PrintCompileOptions();
+  if (cachePath.length() && CreateFolders(cachePath.c_str()))
+  {
+    // FNV-1a, of everything that changes the machine code
+    uint64_t hash = 14695981039346656037ULL;
 
-  // Prepare compile options
-  std::string error;
-  const char* argv[64];
+    auto addToHash = [&hash](const std::string& str) {
+      for (size_t i = 0; i <= str.length(); i++) // including the terminator, to separate the strings
+        hash = (hash ^ static_cast<uint8_t>(str.c_str()[i])) * 1099511628211ULL;
+    };
+
+    addToHash(sourceCode);
+
+    for (auto& option : options)
+      addToHash(option);
 
-  const int N = (int) mCompileOptions.size();
+    addToHash(std::to_string(optimizationLevel));
+    addToHash(FAUSTGEN_VERSION);
+    addToHash(getCLibFaustVersion());
+    addToHash(GetLLVMArchStr());
+
+    cacheFile.SetFormatted(static_cast<int>(cachePath.length() + name.length()) + 64, "%s%c%s_%016llx.fmc", cachePath.c_str(), WDL_DIRCHAR, name.c_str(), (unsigned long long) hash);
+
+    if (FILE* pFile = fopen(cacheFile.Get(), "rb"))
+    {
+      std::string machineCode;
+      fseek(pFile, 0, SEEK_END);
+      machineCode.resize(static_cast<size_t>(std::max(ftell(pFile), 0L)));
+      fseek(pFile, 0, SEEK_SET);
+      const bool read = fread(&machineCode[0], 1, machineCode.size(), pFile) == machineCode.size();
+      fclose(pFile);
+
+      std::string readError;
+      llvm_dsp_factory* pFactory = read && machineCode.size() ? readDSPFactoryFromMachine(machineCode, GetLLVMArchStr(), readError) : nullptr;
+
+      if (pFactory)
+      {
+        DBGMSG("FaustGen-%s: Loaded from the machine code cache\n", name.c_str());
+        return pFactory;
+      }
+    }
+  }
+
+  const char* argv[64];
+  const int N = (int) options.size();
 
   assert(N < 64);
 
-  for (auto i = 0; i< N; i++)
+  for (auto i = 0; i < N; i++)
+  {
+    argv[i] = options[i].c_str();
+  }
+
+  argv[N] = 0; // NULL terminated argv
+
+  llvm_dsp_factory* pFactory = createDSPFactoryFromString(name, sourceCode, N, argv, GetLLVMArchStr(), error, optimizationLevel);
+
+  if (pFactory && cacheFile.GetLength())
   {
-    argv[i] = mCompileOptions[i].c_str();
+    const std::string machineCode = writeDSPFactoryToMachine(pFactory, GetLLVMArchStr());
+
+    if (FILE* pFile = fopen(cacheFile.Get(), "wb"))
+    {
+      fwrite(machineCode.data(), 1, machineCode.size(), pFile);
+      fclose(pFile);
+    }
   }
 
+  return pFactory;
+}
+
+llvm_dsp_factory *FaustGen::Factory::CreateFactoryFromSourceCode()
+{
+  WDL_String name;
+  name.SetFormatted(64, "FaustGen-%d", mInstanceIdx);
+
+  SetDefaultCompileOptions();
+  PrintCompileOptions();
+
   // Generate SVG file // this shouldn't get called if we not making SVGs
 //  if (!generateAuxFilesFromString(name.Get(), mSourceCodeStr.Get(), N, argv, error))
 //  {
 //    DBGMSG("FaustGen-%s: Generate SVG error : %s\n", error.c_str());
 //  }
 
-  argv[N] = 0; // NULL terminated argv
-
-  llvm_dsp_factory* pFactory = createDSPFactoryFromString(name.Get(), mSourceCodeStr.Get(), N, argv, GetLLVMArchStr(), error, mOptimizationLevel);
+  std::string error;
+  llvm_dsp_factory* pFactory = CompileFactory(name.Get(), mSourceCodeStr.Get(), mCompileOptions, mOptimizationLevel, sMachineCodeCachePath.Get(), error);
 
   if(error.length())
     DBGMSG("%s\n", error.c_str());
@@ -259,7 +364,7 @@ void FaustGen::Factory::SetDefaultCompileOptions()
   // Clear and set default value
   mCompileOptions.clear();
 
-  if (sizeof(sample) == 8)
+  if (sizeof(sample) == 8 && std::find(mOptions.begin(), mOptions.end(), "-double") == mOptions.end())
     AddCompileOption("-double");
 
   // All library paths
@@ -275,13 +380,23 @@ void FaustGen::Factory::SetDefaultCompileOptions()
     AddCompileOption("-O", mDrawPath.Get());
   }
 
-  // All options set in the 'compileoptions' message
-  for (auto c : mOptions)
+  // All options set with SetCompileOptions()
+  mOptimizationLevel = LLVM_OPTIMIZATION;
+
+  for (auto i = 0; i < mOptions.size(); i++)
   {
+    const std::string& c = mOptions[i];
+
     // '-opt v' : parsed for LLVM optimization level
     if (c == "-opt")
     {
-      mOptimizationLevel = atoi(c.c_str());
+      if (i + 1 < mOptions.size())
+        mOptimizationLevel = atoi(mOptions[++i].c_str());
+    }
+    else if (c == "-omp")
+    {
+      // the LLVM backend has no OpenMP runtime, only the C++ generated by CompileCPP() uses it
+      DBGMSG("FaustGen-%s: -omp is only used when compiling C++, ignored by the JIT\n", mName.Get());
     }
     else
     {
@@ -345,34 +460,40 @@ void FaustGen::Factory::RemoveInstance(FaustGen* pDSP)
   }
 }
 
-bool FaustGen::Factory::LoadFile(const char* file)
+bool FaustGen::Factory::ReadSourceFile(const char* file)
 {
-  // Delete the existing Faust module
-  //FreeDSPFactory();
   WDL_String fileStr(file);
+  WDL_FileRead infile(file);
 
-  mBitCodeStr.Set("");
+  if (infile.IsOpen() == false)
+    return false;
 
-  WDL_FileRead infile(file);
+  std::vector<char> buffer(infile.GetSize() + 1); // +1 to have space for the terminating zero
+  infile.Read(buffer.data(), static_cast<int>(infile.GetSize()));
+  buffer[infile.GetSize()] = '\0'; // put in the string terminating zero
 
-  if (infile.IsOpen() == true)
-  {
-    std::vector<char> buffer(infile.GetSize() + 1); // +1 to have space for the terminating zero
-    infile.Read(buffer.data(), static_cast<int>(infile.GetSize()));
-    buffer[infile.GetSize()] = '\0'; // put in the string terminating zero
+  StatType buf;
+  GetStat(fileStr.Get(), &buf);
+  mPreviousTime = GetModifiedTime(buf);
 
-    StatType buf;
-    GetStat(fileStr.Get(), &buf);
-    mPreviousTime = GetModifiedTime(buf);
+  mSourceCodeStr.Set(buffer.data());
 
-    mSourceCodeStr.Set(buffer.data());
-    
-    // Add path of file to library path
-    fileStr.remove_filepart(true);
-    AddLibraryPath(fileStr.Get());
-    
-    mInputDSPFile.Set(file);
-    
+  // Add path of file to library path
+  fileStr.remove_filepart(true);
+  AddLibraryPath(fileStr.Get());
+
+  mInputDSPFile.Set(file);
+  return true;
+}
+
+bool FaustGen::Factory::LoadFile(const char* file)
+{
+  // Delete the existing Faust module
+  //FreeDSPFactory();
+  mBitCodeStr.Set("");
+
+  if (ReadSourceFile(file))
+  {
     // Update all instances
     for (auto inst : mInstances)
     {
@@ -387,6 +508,76 @@ bool FaustGen::Factory::LoadFile(const char* file)
   return false;
 }
 
+void FaustGen::Factory::StartCompile()
+{
+  if (mPendingCompile.valid() || !ReadSourceFile(mInputDSPFile.Get()))
+    return;
+
+  mBitCodeStr.Set("");
+  SetDefaultCompileOptions();
+  PrintCompileOptions();
+
+  WDL_String name;
+  name.SetFormatted(64, "FaustGen-%d", mInstanceIdx);
+
+  // the worker only uses copies, the instances keep running the old factory until CheckCompile() swaps it
+  mPendingCompile = std::async(std::launch::async, [name = std::string(name.Get()), source = std::string(mSourceCodeStr.Get()), options = mCompileOptions,
+                                                    optimizationLevel = mOptimizationLevel, cachePath = std::string(sMachineCodeCachePath.Get())]() {
+    CompileResult result;
+    result.mFactory = CompileFactory(name, source, options, optimizationLevel, cachePath, result.mError);
+    return result;
+  });
+}
+
+void FaustGen::Factory::CheckCompile()
+{
+  FreeRetiredFactories();
+
+  if (!mPendingCompile.valid() || mPendingCompile.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+    return;
+
+  CompileResult result = mPendingCompile.get();
+
+  if (!result.mFactory)
+  {
+    // the instances keep running the last DSP that compiled
+    DBGMSG("FaustGen-%s: Invalid Faust code or compile options : %s\n", mName.Get(), result.mError.c_str());
+    return;
+  }
+
+  DBGMSG("FaustGen-%s: Background compilation succeeded, swapping the DSP\n", mName.Get());
+
+  if (mLLVMFactory)
+    mRetiredFactories.push_back(mLLVMFactory);
+
+  mLLVMFactory = result.mFactory;
+
+  for (auto inst : mInstances)
+  {
+    inst->SetErrored(false);
+    inst->HotSwap();
+  }
+}
+
+void FaustGen::Factory::FreeRetiredFactories()
+{
+  if (mRetiredFactories.empty())
+    return;
+
+  for (auto inst : mInstances)
+  {
+    inst->FreeFadedDSP();
+
+    if (inst->IsCrossfading())
+      return;
+  }
+
+  for (auto pFactory : mRetiredFactories)
+    deleteDSPFactory(pFactory);
+
+  mRetiredFactories.clear();
+}
+
 bool FaustGen::Factory::WriteToFile(const char* file)
 {
   return false;
@@ -399,8 +590,7 @@ void FaustGen::Factory::SetCompileOptions(std::initializer_list<const char*> opt
   if (options.size() == 0)
     DBGMSG("FaustGen-%s: No argument entered, no additional compilation option will be used", mName.Get());
 
-  //TODO
-//  mOptions = options;
+  mOptions.assign(options.begin(), options.end());
 //
 //  /*
 //  if (optimize) {
@@ -464,6 +654,11 @@ FaustGen::~FaustGen()
 
   FreeDSP();
 
+  // the faded DSP belongs to a retired factory, which the factory deletes when the last instance is removed
+  mFadingDSP = nullptr;
+  mFadingMidiUI = nullptr;
+  mFadingMidiHandler = nullptr;
+
   if(mFactory)
     mFactory->RemoveInstance(this);
 }
@@ -501,6 +696,167 @@ void FaustGen::Init()
     mMidiHandler->startMidi();
 }
 
+void FaustGen::HotSwap()
+{
+  if (!mDSP)
+  {
+    Init();
+    return;
+  }
+
+  // keep the parameter values across the swap, matching them by label
+  std::map<std::string, FAUSTFLOAT> values;
+
+  for (auto p = 0; p < NParams() && p < mZones.GetSize(); p++)
+  {
+    values[mParams.Get(p)->GetName()] = *mZones.Get(p);
+  }
+
+  const int sampleRate = mDSP->getSampleRate();
+
+  // build the new DSP outside of the lock, so that the audio thread keeps running the old one meanwhile
+  MidiHandlerPtr newMidiHandler = std::make_unique<iplug2_midi_handler>();
+  std::unique_ptr<MidiUI> newMidiUI = std::make_unique<MidiUI>(newMidiHandler.get());
+  std::unique_ptr<::dsp> newDSP(mFactory->CreateDSPInstance(newMidiHandler));
+
+  if (!newDSP)
+    return;
+
+  newDSP->buildUserInterface(newMidiUI.get());
+  newDSP->init(sampleRate);
+
+  assert((newDSP->getNumInputs() <= mMaxNInputs) && (newDSP->getNumOutputs() <= mMaxNOutputs)); // don't have enough buffers to process the DSP
+
+  {
+    WDL_MutexLock lock(&mMutex);
+
+    const bool sameIO = (newDSP->getNumInputs() == mDSP->getNumInputs()) && (newDSP->getNumOutputs() == mDSP->getNumOutputs());
+
+    mFadingDSP = std::move(mDSP);
+    mFadingMidiHandler = std::move(mMidiHandler);
+    mFadingMidiUI = std::move(mMidiUI);
+
+    mDSP = std::move(newDSP);
+    mMidiHandler = std::move(newMidiHandler);
+    mMidiUI = std::move(newMidiUI);
+
+    mZones.Empty(); // remove existing pointers to zones
+    mMap.DeleteAll();
+    mDSP->buildUserInterface(this);
+
+    for (auto p = 0; p < NParams() && p < mZones.GetSize(); p++)
+    {
+      IParam* pParam = mParams.Get(p);
+      auto itr = values.find(pParam->GetName());
+
+      if (itr != values.end())
+        pParam->Set(itr->second);
+
+      *mZones.Get(p) = pParam->Value();
+    }
+
+    BuildParameterMap(false); // keep the values the host has, rather than going back to the defaults
+
+    // no crossfade when the channel layout changed or when oversampling, the old DSP is just dropped
+    if (sameIO && !mOverSampler)
+    {
+      const int nOutputs = mDSP->getNumOutputs();
+      mFadeLength = std::max(1, sampleRate * FAUST_CROSSFADE_MS / 1000);
+      mFadeBuffers.assign(nOutputs, std::vector<sample>(kCrossfadeBlockSize));
+      mFadeBufferPtrs.resize(nOutputs);
+      mFadeInputs.resize(mDSP->getNumInputs());
+      mFadeOutputs.resize(nOutputs);
+
+      for (auto c = 0; c < nOutputs; c++)
+        mFadeBufferPtrs[c] = mFadeBuffers[c].data();
+    }
+    else
+      mFadeLength = 0;
+
+    mFadePos = 0;
+  }
+
+  if (!mFadeLength)
+    FreeFadedDSP();
+  else if (mFadingMidiHandler)
+    mFadingMidiHandler->stopMidi();
+
+  mInitialized = true;
+
+  if(mPlug)
+    mPlug->OnParamReset(EParamSource::kRecompile);
+
+  if(mOnCompileFunc)
+    mOnCompileFunc();
+
+  mMidiHandler->startMidi();
+}
+
+void FaustGen::ProcessCrossfade(sample** inputs, sample** outputs, int nFrames)
+{
+  const int nInputs = static_cast<int>(mFadeInputs.size());
+  const int nOutputs = static_cast<int>(mFadeOutputs.size());
+
+  for (auto s = 0; s < nFrames; s += kCrossfadeBlockSize)
+  {
+    const int blockSize = std::min(kCrossfadeBlockSize, nFrames - s);
+
+    for (auto c = 0; c < nInputs; c++)
+      mFadeInputs[c] = inputs[c] + s;
+
+    for (auto c = 0; c < nOutputs; c++)
+      mFadeOutputs[c] = outputs[c] + s;
+
+    // the old DSP goes into the scratch buffers first, since the outputs may alias the inputs
+    mFadingDSP->compute(blockSize, mFadeInputs.data(), mFadeBufferPtrs.data());
+    mDSP->compute(blockSize, mFadeInputs.data(), mFadeOutputs.data());
+
+    for (auto c = 0; c < nOutputs; c++)
+    {
+      const sample* pOld = mFadeBufferPtrs[c];
+      sample* pOut = mFadeOutputs[c];
+
+      for (auto i = 0; i < blockSize; i++)
+      {
+        const sample gain = std::min(static_cast<sample>(mFadePos + i) / static_cast<sample>(mFadeLength), static_cast<sample>(1.));
+        pOut[i] = pOld[i] + (pOut[i] - pOld[i]) * gain;
+      }
+    }
+
+    mFadePos += blockSize;
+  }
+}
+
+void FaustGen::FreeFadedDSP()
+{
+  MidiHandlerPtr midiHandler;
+  std::unique_ptr<MidiUI> midiUI;
+  std::unique_ptr<::dsp> dsp;
+
+  {
+    WDL_MutexLock lock(&mMutex);
+
+    if (!mFadingDSP || mFadePos < mFadeLength)
+      return;
+
+    // move out, so the deletes happen outside of the lock
+    dsp = std::move(mFadingDSP);
+    midiUI = std::move(mFadingMidiUI);
+    midiHandler = std::move(mFadingMidiHandler);
+  }
+
+  if (midiHandler)
+    midiHandler->stopMidi();
+}
+
+void FaustGen::SetCompileOptions(std::initializer_list<const char*> options)
+{
+  mFactory->SetCompileOptions(options);
+
+  if (mInitialized)
+    mFactory->StartCompile();
+}
+
 void FaustGen::GetDrawPath(WDL_String& path)
 {
   assert(!CStringHasContents(mFactory->mDrawPath.Get()));
@@ -526,8 +882,23 @@ bool FaustGen::CompileCPP()
     outputFile = inputFile;
     outputFile.remove_fileext();
     outputFile.AppendFormatted(1024, ".tmp");
-    //-double
-    command.SetFormatted(1024, "%s -cn %s -i -a %s -o %s %s", FAUST_EXE, f.second->mName.Get(), archFile.Get(), outputFile.Get(), inputFile.Get());
+
+    // the same options as the JIT, so that FAUST_COMPILED builds compute the same way
+    WDL_String options;
+    const std::vector<std::string>& factoryOptions = f.second->mOptions;
+
+    if (sizeof(sample) == 8 && std::find(factoryOptions.begin(), factoryOptions.end(), "-double") == factoryOptions.end())
+      options.Append(" -double");
+
+    for (auto i = 0; i < factoryOptions.size(); i++)
+    {
+      if (factoryOptions[i] == "-opt") // LLVM only
+        i++;
+      else
+        options.AppendFormatted(1024, " %s", factoryOptions[i].c_str());
+    }
+
+    command.SetFormatted(4096, "%s -cn %s%s -i -a %s -o %s %s", FAUST_EXE, f.second->mName.Get(), options.Get(), archFile.Get(), outputFile.Get(), inputFile.Get());
 
     DBGMSG("exec: %s\n", command.Get());
 
@@ -584,31 +955,41 @@ void FaustGen::OnTimer(Timer& timer)
   WDL_String* pInputFile;
   bool recompile = false;
 
+  // swap in any factories that finished compiling, and free the DSPs that are done crossfading
   for (auto f : Factory::sFactoryMap)
   {
-    pInputFile = &f.second->mInputDSPFile;
-    StatType buf;
-    GetStat(pInputFile->Get(), &buf);
-    StatTime oldTime = f.second->mPreviousTime;
-    StatTime newTime = GetModifiedTime(buf);
-
-    if(!Equal(newTime, oldTime))
-    {
-      WDL_MutexLock lock(&mMutex);
+    llvm_dsp_factory* pBefore = f.second->mLLVMFactory;
+    f.second->CheckCompile();
 
+    if (f.second->mLLVMFactory != pBefore)
       recompile = true;
-      f.second->FreeDSPFactory();
-      DBGMSG("FaustGen-%s: File change detected ----------------------------------\n", mName.Get());
-      DBGMSG("FaustGen-%s: JIT compiling %s\n", mName.Get(), pInputFile->Get());
-      f.second->LoadFile(pInputFile->Get());
+  }
+
+  if (++mTimerTicks >= FAUST_RECOMPILE_INTERVAL / FAUST_SWAP_POLL_INTERVAL)
+  {
+    mTimerTicks = 0;
+
+    for (auto f : Factory::sFactoryMap)
+    {
+      pInputFile = &f.second->mInputDSPFile;
+      StatType buf;
+      GetStat(pInputFile->Get(), &buf);
+      StatTime oldTime = f.second->mPreviousTime;
+      StatTime newTime = GetModifiedTime(buf);
+
+      if(!Equal(newTime, oldTime))
+      {
+        DBGMSG("FaustGen-%s: File change detected ----------------------------------\n", mName.Get());
+        DBGMSG("FaustGen-%s: JIT compiling %s in the background\n", mName.Get(), pInputFile->Get());
+        f.second->StartCompile(); // the DSP keeps running until the new factory is ready
+      }
+
+      f.second->mPreviousTime = newTime;
     }
-      
-    f.second->mPreviousTime = newTime;
   }
 
   if(recompile)
   {
-    // TODO: should check for successfull JIT
     DBGMSG("FaustGen-%s: Statically compiling all FAUST blocks\n", mName.Get());
     CompileCPP();
     //WDL_String objFile;
@@ -631,7 +1012,7 @@ void FaustGen::SetAutoRecompile(bool enable)
   if(enable)
   {
     if(sTimer == nullptr)
-      sTimer = Timer::Create(std::bind(&FaustGen::OnTimer, this, std::placeholders::_1), FAUST_RECOMPILE_INTERVAL);
+      sTimer = Timer::Create(std::bind(&FaustGen::OnTimer, this, std::placeholders::_1), FAUST_SWAP_POLL_INTERVAL);
   }
   else
   {
@@ -649,7 +1030,12 @@ void FaustGen::ProcessBlock(sample** inputs, sample** outputs, int nFrames)
 {
   WDL_MutexLock lock(&mMutex);
   if(!mErrored)
-    IPlugFaust::ProcessBlock(inputs, outputs, nFrames);
+  {
+    if (mFadingDSP && mFadePos < mFadeLength)
+      ProcessCrossfade(inputs, outputs, nFrames);
+    else
+      IPlugFaust::ProcessBlock(inputs, outputs, nFrames);
+  }
   else
     memset(outputs[0], 0, nFrames * mMaxNOutputs * sizeof(sample));
 }
@@ -21,6 +21,7 @@ using FaustGen = iplug::IPlugFaust; // not used, except for CompileCPP();
 
 #ifndef FAUST_COMPILED
 
+#include <future>
 #include <iostream>
 #include <string>
 #include <set>
@@ -82,6 +83,8 @@ static inline StatTime TimeZero() { return (StatTime) 0; }
 
 #define FAUST_CLASS_PREFIX "F"
 #define FAUST_RECOMPILE_INTERVAL 5000 //ms
+#define FAUST_SWAP_POLL_INTERVAL 100 //ms, how often a background compile is checked for completion
+#define FAUST_CROSSFADE_MS 20 // the crossfade from the old DSP to the recompiled one
 
 #ifndef FAUST_EXE
   #if defined OS_MAC || defined OS_LINUX
@@ -138,6 +141,20 @@ class FaustGen : public IPlugFaust
       
     llvm_dsp_factory* CreateFactoryFromBitCode();
     llvm_dsp_factory* CreateFactoryFromSourceCode();
+
+    /** Compile a factory, or read it from the machine code cache when one is set and holds the same source, options and libfaust version. Thread safe
+     * @return The factory, or nullptr with error set if the source doesn't compile */
+    static llvm_dsp_factory* CompileFactory(const std::string& name, const std::string& sourceCode, const std::vector<std::string>& options, int optimizationLevel,
+                                            const std::string& cachePath, std::string& error);
+
+    /** Read the source file again, and start compiling it on a worker thread. Called on the timer thread when the file has changed */
+    void StartCompile();
+
+    /** If a compile started by StartCompile() has finished, swap its DSP into all the instances, or keep the old one and report the error */
+    void CheckCompile();
+
+    /** Delete the factories replaced by CheckCompile(), when no instance is crossfading from a DSP they created */
+    void FreeRetiredFactories();
     
     /** If DSP already exists will return it, otherwise create it
      * @return pointer to the DSP instance */
@@ -158,6 +175,10 @@ class FaustGen : public IPlugFaust
     void RemoveInstance(FaustGen* pDSP);
 
     bool LoadFile(const char* file);
+
+    /** Read a source file into mSourceCodeStr, without compiling it
+     * @return \c true if the file was read */
+    bool ReadSourceFile(const char* file);
     bool WriteToFile(const char* file);
     void SetCompileOptions(std::initializer_list<const char*> options);
 
@@ -192,6 +213,15 @@ class FaustGen : public IPlugFaust
     std::set<FaustGen*> mInstances;
 
     llvm_dsp_factory* mLLVMFactory = nullptr;
+    std::vector<llvm_dsp_factory*> mRetiredFactories; // replaced by a recompile, kept whilst instances crossfade from their DSPs
+
+    struct CompileResult
+    {
+      llvm_dsp_factory* mFactory = nullptr;
+      std::string mError;
+    };
+
+    std::future<CompileResult> mPendingCompile;
     WDL_FastString mSourceCodeStr;
     WDL_FastString mBitCodeStr;
     WDL_String mDrawPath;
@@ -206,6 +236,7 @@ class FaustGen : public IPlugFaust
     int mOptimizationLevel = LLVM_OPTIMIZATION;
     static int sFactoryCounter;
     static std::map<std::string, Factory*> sFactoryMap;
+    static WDL_String sMachineCodeCachePath;
     WDL_String mInputDSPFile;
     StatTime mPreviousTime;
   };
@@ -227,6 +258,13 @@ public:
   /** Call this method after constructing the class to JIT compile */
   void Init() override;
 
+  /** Set the options libfaust compiles with, which CompileCPP() also passes to the faust command line, so FAUST_COMPILED builds compute the same way.
+   * Call this before Init(). If the DSP is already running it is recompiled in the background and swapped in when auto recompile is enabled.
+   * Useful options are "-vec", "-vs", "32" for vector code, "-sch" for the work stealing scheduler, "-omp" for OpenMP (C++ only, needs the plug-in built with OpenMP),
+   * "-double" for double precision internally when sample is float, and "-opt", "3" for the LLVM optimization level (JIT only)
+   * @param options The options, a value that follows a flag is its own entry */
+  void SetCompileOptions(std::initializer_list<const char*> options) override;
+
   void LoadFile(const char* path) { mFactory->FreeDSPFactory(); mFactory->LoadFile(path); }
   
   /** This method allows SVG files generated by a specific instance of FaustGen can be located. The path to the SVG file for process.svg will be returned, if drawPath has been specified in the constructor.
@@ -240,7 +278,15 @@ public:
 
   //bool CompileObjectFile(const char* fileName);
 
+  /** Poll the .dsp files for changes, and recompile them in the background. The new DSP replaces the old one with a short crossfade, keeping the values of parameters with the same names
+   * @param enable Set \c true to recompile when the files change */
   void SetAutoRecompile(bool enable);
+
+  /** Set a folder where compiled factories are kept as machine code, so that .dsp files that haven't changed since the last session are not compiled again.
+   * The cache is keyed by a hash of the source code, compile options and libfaust version, so changes to imported libraries alone are not detected.
+   * The folder is created if needed, e.g. INIPath(path, BUNDLE_NAME); path.Append("FaustCache");
+   * @param path The full path of the folder, or an empty string to disable the cache */
+  static void SetMachineCodeCachePath(const char* path) { Factory::sMachineCodeCachePath.Set(path); }
   
   void SetCompileFunc(std::function<void()> func) { mOnCompileFunc = func; }
   
@@ -251,6 +297,21 @@ public:
   void SetErrored(bool errored) { mErrored = errored; }
   
 private:
+  /** Replace the DSP with a new instance from the factory's recompiled code, on the timer thread. The values of parameters with the same names are copied to the new DSP,
+   * which is crossfaded in by ProcessBlock() */
+  void HotSwap();
+
+  /** Compute both the old and new DSPs, and crossfade between them */
+  void ProcessCrossfade(sample** inputs, sample** outputs, int nFrames);
+
+  /** Delete the DSP that has been crossfaded out, on the timer thread */
+  void FreeFadedDSP();
+
+  /** @return \c true if a DSP from the previous factory is still being crossfaded out */
+  bool IsCrossfading() { WDL_MutexLock lock(&mMutex); return mFadingDSP != nullptr; }
+
+  static constexpr int kCrossfadeBlockSize = 64;
+
   Factory* mFactory = nullptr;
   static Timer* sTimer;
   static int sFaustGenCounter;
@@ -259,6 +320,17 @@ private:
   int mMaxNOutputs = -1;
   bool mErrored = false;
   std::function<void()> mOnCompileFunc = nullptr;
+  int mTimerTicks = 0;
+
+  std::unique_ptr<::dsp> mFadingDSP; // the DSP being crossfaded out after a hot swap
+  MidiHandlerPtr mFadingMidiHandler;
+  std::unique_ptr<MidiUI> mFadingMidiUI;
+  int mFadePos = 0;
+  int mFadeLength = 0;
+  std::vector<std::vector<sample>> mFadeBuffers;
+  std::vector<sample*> mFadeInputs;
+  std::vector<sample*> mFadeOutputs;
+  std::vector<sample*> mFadeBufferPtrs;
   
   WDL_Mutex mMutex;
 };
@@ -0,0 +1,181 @@
+/*
+Downsampler2x4.h
+
+Downsamples by a factor 2 four channels at once, with the channels
+interleaved. Equivalent to four instances of Downsampler2xFPU, using SIMD
+where available (see Vec4.h).
+
+Template parameters:
+- NC: number of coefficients, > 0
+- T: float or double
+
+--- Legal stuff ---
+
+This program is free software. It comes without any warranty, to
+the extent permitted by applicable law. You can redistribute it
+and/or modify it under the terms of the Do What The Fuck You Want
+To Public License, Version 2, as published by Sam Hocevar. See
+http://sam.zoy.org/wtfpl/COPYING for more details.
+
+*/
+
+#pragma once
+
+#include <array>
+#include <cassert>
+#include "Vec4.h"
+
+namespace hiir
+{
+
+template <int NC, typename T>
+class Downsampler2x4
+{
+public:
+
+  enum { NBR_COEFS = NC };
+  enum { NBR_CHANNELS = 4 };
+
+  Downsampler2x4 ();
+
+  /*
+  Name: set_coefs
+  Description:
+  Sets filter coefficients, for all the channels. Generate them with the
+  PolyphaseIir2Designer class.
+  Call this function before doing any processing.
+  Input parameters:
+  - coef_arr: Array of coefficients. There should be as many coefficients as
+  mentioned in the class template parameter.
+  */
+  void set_coefs (const double coef_arr [NBR_COEFS]);
+
+  /*
+  Name: process_sample
+  Description:
+  Downsamples (x2) one pair of samples of each channel, to generate one
+  output sample for each channel.
+  Input parameters:
+  - in_0: The first samples of the pair
+  - in_1: The second samples of the pair
+  Returns: Samplerate-reduced samples.
+  */
+  inline Vec4 <T> process_sample (Vec4 <T> in_0, Vec4 <T> in_1);
+
+  /*
+  Name: process_block
+  Description:
+  Downsamples (x2) a block of interleaved samples.
+  Input and output blocks may overlap, see assert() for details.
+  Input parameters:
+  - in_ptr: Input array, containing nbr_spl * 8 interleaved samples.
+  - nbr_spl: Number of samples per channel to output, > 0
+  Output parameters:
+  - out_ptr: Array for the output samples, capacity: nbr_spl * 4 interleaved
+  samples.
+  */
+  void process_block (T out_ptr [], const T in_ptr [], long nbr_spl);
+
+  /*
+  Name: clear_buffers
+  Description:
+  Clears filter memory, as if it processed silence since an infinite amount
+  of time.
+  */
+  void clear_buffers ();
+
+private:
+  std::array<Vec4 <T>, NBR_COEFS> _coef;
+  std::array<Vec4 <T>, NBR_COEFS> _x;
+  std::array<Vec4 <T>, NBR_COEFS> _y;
+
+private:
+  bool operator == (const Downsampler2x4 &other);
+  bool operator != (const Downsampler2x4 &other);
+
+};  // class Downsampler2x4
+
+template <int NC, typename T>
+Downsampler2x4 <NC, T>::Downsampler2x4 ()
+{
+  for (int i = 0; i < NBR_COEFS; ++i)
+  {
+    _coef [i] = Vec4 <T>::zero ();
+  }
+  clear_buffers ();
+}
+
+template <int NC, typename T>
+void Downsampler2x4 <NC, T>::set_coefs (const double coef_arr [NBR_COEFS])
+{
+  assert (coef_arr != 0);
+
+  for (int i = 0; i < NBR_COEFS; ++i)
+  {
+    _coef [i] = Vec4 <T>::set1 (static_cast <T> (coef_arr [i]));
+  }
+}
+
+template <int NC, typename T>
+Vec4 <T> Downsampler2x4 <NC, T>::process_sample (Vec4 <T> in_0, Vec4 <T> in_1)
+{
+  // the same stages as StageProcFPU::process_sample_pos(), two coefficients at a time
+  Vec4 <T> spl_0 = in_1;
+  Vec4 <T> spl_1 = in_0;
+
+  for (int i = 0; i + 1 < NBR_COEFS; i += 2)
+  {
+    const Vec4 <T> temp_0 = (spl_0 - _y [i + 0]) * _coef [i + 0] + _x [i + 0];
+    const Vec4 <T> temp_1 = (spl_1 - _y [i + 1]) * _coef [i + 1] + _x [i + 1];
+
+    _x [i + 0] = spl_0;
+    _x [i + 1] = spl_1;
+
+    _y [i + 0] = temp_0;
+    _y [i + 1] = temp_1;
+
+    spl_0 = temp_0;
+    spl_1 = temp_1;
+  }
+
+  if (NBR_COEFS & 1)
+  {
+    const int last = NBR_COEFS - 1;
+    const Vec4 <T> temp = (spl_0 - _y [last]) * _coef [last] + _x [last];
+    _x [last] = spl_0;
+    _y [last] = temp;
+    spl_0 = temp;
+  }
+
+  return Vec4 <T>::set1 (static_cast <T> (0.5f)) * (spl_0 + spl_1);
+}
+
+template <int NC, typename T>
+void Downsampler2x4 <NC, T>::process_block (T out_ptr [], const T in_ptr [], long nbr_spl)
+{
+  assert (in_ptr != 0);
+  assert (out_ptr != 0);
+  assert (out_ptr <= in_ptr || out_ptr >= in_ptr + nbr_spl * NBR_CHANNELS * 2);
+  assert (nbr_spl > 0);
+
+  long pos = 0;
+  do
+  {
+    const T* pair_ptr = in_ptr + pos * NBR_CHANNELS * 2;
+    process_sample (Vec4 <T>::load (pair_ptr), Vec4 <T>::load (pair_ptr + NBR_CHANNELS)).store (out_ptr + pos * NBR_CHANNELS);
+    ++pos;
+  }
+  while (pos < nbr_spl);
+}
+
+template <int NC, typename T>
+void Downsampler2x4 <NC, T>::clear_buffers ()
+{
+  for (int i = 0; i < NBR_COEFS; ++i)
+  {
+    _x [i] = Vec4 <T>::zero ();
+    _y [i] = Vec4 <T>::zero ();
+  }
+}
+
+} // namespace hiir
@@ -0,0 +1,185 @@
+/*
+Upsampler2x4.h
+
+Upsamples by a factor 2 four channels at once, with the channels
+interleaved. Equivalent to four instances of Upsampler2xFPU, using SIMD
+where available (see Vec4.h).
+
+Template parameters:
+- NC: number of coefficients, > 0
+- T: float or double
+
+--- Legal stuff ---
+
+This program is free software. It comes without any warranty, to
+the extent permitted by applicable law. You can redistribute it
+and/or modify it under the terms of the Do What The Fuck You Want
+To Public License, Version 2, as published by Sam Hocevar. See
+http://sam.zoy.org/wtfpl/COPYING for more details.
+
+*/
+
+#pragma once
+
+#include <array>
+#include <cassert>
+#include "Vec4.h"
+
+namespace hiir
+{
+
+template <int NC, typename T>
+class Upsampler2x4
+{
+public:
+
+  enum { NBR_COEFS = NC };
+  enum { NBR_CHANNELS = 4 };
+
+  Upsampler2x4 ();
+
+  /*
+  Name: set_coefs
+  Description:
+  Sets filter coefficients, for all the channels. Generate them with the
+  PolyphaseIir2Designer class.
+  Call this function before doing any processing.
+  Input parameters:
+  - coef_arr: Array of coefficients. There should be as many coefficients as
+  mentioned in the class template parameter.
+  */
+  void set_coefs (const double coef_arr [NBR_COEFS]);
+
+  /*
+  Name: process_sample
+  Description:
+    Upsamples (x2) one sample of each channel, generating two output samples
+    for each channel.
+  Input parameters:
+    - input: The input samples.
+  Output parameters:
+    - out_0: First output samples.
+    - out_1: Second output samples.
+  */
+  inline void process_sample (Vec4 <T> &out_0, Vec4 <T> &out_1, Vec4 <T> input);
+
+  /*
+  Name: process_block
+  Description:
+    Upsamples (x2) a block of interleaved samples.
+    Input and output blocks must not overlap.
+  Input parameters:
+    - in_ptr: Input array, containing nbr_spl * 4 interleaved samples.
+    - nbr_spl: Number of input samples per channel to process, > 0
+  Output parameters:
+    - out_ptr: Output sample array, capacity: nbr_spl * 8 interleaved samples.
+  */
+  void process_block (T out_ptr [], const T in_ptr [], long nbr_spl);
+
+  /*
+  Name: clear_buffers
+  Description:
+    Clears filter memory, as if it processed silence since an infinite amount
+    of time.
+  */
+  void clear_buffers ();
+
+private:
+  std::array<Vec4 <T>, NBR_COEFS> _coef;
+  std::array<Vec4 <T>, NBR_COEFS> _x;
+  std::array<Vec4 <T>, NBR_COEFS> _y;
+
+private:
+  bool operator == (const Upsampler2x4 &other);
+  bool operator != (const Upsampler2x4 &other);
+
+};  // class Upsampler2x4
+
+template <int NC, typename T>
+Upsampler2x4 <NC, T>::Upsampler2x4 ()
+{
+  for (int i = 0; i < NBR_COEFS; ++i)
+  {
+    _coef [i] = Vec4 <T>::zero ();
+  }
+  clear_buffers ();
+}
+
+template <int NC, typename T>
+void Upsampler2x4 <NC, T>::set_coefs (const double coef_arr [NBR_COEFS])
+{
+  assert (coef_arr != 0);
+
+  for (int i = 0; i < NBR_COEFS; ++i)
+  {
+    _coef [i] = Vec4 <T>::set1 (static_cast <T> (coef_arr [i]));
+  }
+}
+
+template <int NC, typename T>
+void Upsampler2x4 <NC, T>::process_sample (Vec4 <T> &out_0, Vec4 <T> &out_1, Vec4 <T> input)
+{
+  // the same stages as StageProcFPU::process_sample_pos(), two coefficients at a time
+  Vec4 <T> even = input;
+  Vec4 <T> odd = input;
+
+  for (int i = 0; i + 1 < NBR_COEFS; i += 2)
+  {
+    const Vec4 <T> temp_0 = (even - _y [i + 0]) * _coef [i + 0] + _x [i + 0];
+    const Vec4 <T> temp_1 = (odd - _y [i + 1]) * _coef [i + 1] + _x [i + 1];
+
+    _x [i + 0] = even;
+    _x [i + 1] = odd;
+
+    _y [i + 0] = temp_0;
+    _y [i + 1] = temp_1;
+
+    even = temp_0;
+    odd = temp_1;
+  }
+
+  if (NBR_COEFS & 1)
+  {
+    const int last = NBR_COEFS - 1;
+    const Vec4 <T> temp = (even - _y [last]) * _coef [last] + _x [last];
+    _x [last] = even;
+    _y [last] = temp;
+    even = temp;
+  }
+
+  out_0 = even;
+  out_1 = odd;
+}
+
+template <int NC, typename T>
+void Upsampler2x4 <NC, T>::process_block (T out_ptr [], const T in_ptr [], long nbr_spl)
+{
+  assert (out_ptr != 0);
+  assert (in_ptr != 0);
+  assert (out_ptr >= in_ptr + nbr_spl * NBR_CHANNELS || in_ptr >= out_ptr + nbr_spl * NBR_CHANNELS * 2);
+  assert (nbr_spl > 0);
+
+  long pos = 0;
+  do
+  {
+    Vec4 <T> out_0;
+    Vec4 <T> out_1;
+    process_sample (out_0, out_1, Vec4 <T>::load (in_ptr + pos * NBR_CHANNELS));
+    out_0.store (out_ptr + pos * NBR_CHANNELS * 2);
+    out_1.store (out_ptr + pos * NBR_CHANNELS * 2 + NBR_CHANNELS);
+    ++ pos;
+  }
+  while (pos < nbr_spl);
+}
+
+template <int NC, typename T>
+void Upsampler2x4 <NC, T>::clear_buffers ()
+{
+  for (int i = 0; i < NBR_COEFS; ++i)
+  {
+    _x [i] = Vec4 <T>::zero ();
+    _y [i] = Vec4 <T>::zero ();
+  }
+}
+
+} // namespace hiir
@@ -0,0 +1,149 @@
+/*
+Vec4.h
+
+Four lanes of samples, one per channel, for the channel interleaved
+Upsampler2x4 and Downsampler2x4. Uses SSE2, NEON or wasm SIMD where IPlugPlatform.h
+detects them, otherwise a plain array, which compilers can often vectorise.
+
+--- Legal stuff ---
+
+This program is free software. It comes without any warranty, to
+the extent permitted by applicable law. You can redistribute it
+and/or modify it under the terms of the Do What The Fuck You Want
+To Public License, Version 2, as published by Sam Hocevar. See
+http://sam.zoy.org/wtfpl/COPYING for more details.
+
+*/
+
+#pragma once
+
+#include "IPlugPlatform.h"
+
+#if defined IPLUG_SIMD_SSE2
+  #include <emmintrin.h>
+#elif defined IPLUG_SIMD_NEON
+  #include <arm_neon.h>
+#elif defined IPLUG_SIMD_WASM
+  #include <wasm_simd128.h>
+#endif
+
+namespace hiir
+{
+
+template <typename T>
+struct Vec4
+{
+  T _v [4];
+
+  static inline Vec4 zero () { return set1 (0); }
+  static inline Vec4 set1 (T x) { Vec4 r; for (int i = 0; i < 4; ++i) { r._v [i] = x; } return r; }
+  static inline Vec4 load (const T ptr []) { Vec4 r; for (int i = 0; i < 4; ++i) { r._v [i] = ptr [i]; } return r; }
+  inline void store (T ptr []) const { for (int i = 0; i < 4; ++i) { ptr [i] = _v [i]; } }
+
+  friend inline Vec4 operator + (const Vec4 &a, const Vec4 &b) { Vec4 r; for (int i = 0; i < 4; ++i) { r._v [i] = a._v [i] + b._v [i]; } return r; }
+  friend inline Vec4 operator - (const Vec4 &a, const Vec4 &b) { Vec4 r; for (int i = 0; i < 4; ++i) { r._v [i] = a._v [i] - b._v [i]; } return r; }
+  friend inline Vec4 operator * (const Vec4 &a, const Vec4 &b) { Vec4 r; for (int i = 0; i < 4; ++i) { r._v [i] = a._v [i] * b._v [i]; } return r; }
+};
+
+#if defined IPLUG_SIMD_SSE2
+
+template <>
+struct Vec4 <float>
+{
+  __m128 _v;
+
+  static inline Vec4 zero () { return { _mm_setzero_ps () }; }
+  static inline Vec4 set1 (float x) { return { _mm_set1_ps (x) }; }
+  static inline Vec4 load (const float ptr []) { return { _mm_loadu_ps (ptr) }; }
+  inline void store (float ptr []) const { _mm_storeu_ps (ptr, _v); }
+
+  friend inline Vec4 operator + (const Vec4 &a, const Vec4 &b) { return { _mm_add_ps (a._v, b._v) }; }
+  friend inline Vec4 operator - (const Vec4 &a, const Vec4 &b) { return { _mm_sub_ps (a._v, b._v) }; }
+  friend inline Vec4 operator * (const Vec4 &a, const Vec4 &b) { return { _mm_mul_ps (a._v, b._v) }; }
+};
+
+template <>
+struct Vec4 <double>
+{
+  __m128d _lo;
+  __m128d _hi;
+
+  static inline Vec4 zero () { return { _mm_setzero_pd (), _mm_setzero_pd () }; }
+  static inline Vec4 set1 (double x) { return { _mm_set1_pd (x), _mm_set1_pd (x) }; }
+  static inline Vec4 load (const double ptr []) { return { _mm_loadu_pd (ptr), _mm_loadu_pd (ptr + 2) }; }
+  inline void store (double ptr []) const { _mm_storeu_pd (ptr, _lo); _mm_storeu_pd (ptr + 2, _hi); }
+
+  friend inline Vec4 operator + (const Vec4 &a, const Vec4 &b) { return { _mm_add_pd (a._lo, b._lo), _mm_add_pd (a._hi, b._hi) }; }
+  friend inline Vec4 operator - (const Vec4 &a, const Vec4 &b) { return { _mm_sub_pd (a._lo, b._lo), _mm_sub_pd (a._hi, b._hi) }; }
+  friend inline Vec4 operator * (const Vec4 &a, const Vec4 &b) { return { _mm_mul_pd (a._lo, b._lo), _mm_mul_pd (a._hi, b._hi) }; }
+};
+
+#elif defined IPLUG_SIMD_NEON
+
+template <>
+struct Vec4 <float>
+{
+  float32x4_t _v;
+
+  static inline Vec4 zero () { return { vdupq_n_f32 (0.f) }; }
+  static inline Vec4 set1 (float x) { return { vdupq_n_f32 (x) }; }
+  static inline Vec4 load (const float ptr []) { return { vld1q_f32 (ptr) }; }
+  inline void store (float ptr []) const { vst1q_f32 (ptr, _v); }
+
+  friend inline Vec4 operator + (const Vec4 &a, const Vec4 &b) { return { vaddq_f32 (a._v, b._v) }; }
+  friend inline Vec4 operator - (const Vec4 &a, const Vec4 &b) { return { vsubq_f32 (a._v, b._v) }; }
+  friend inline Vec4 operator * (const Vec4 &a, const Vec4 &b) { return { vmulq_f32 (a._v, b._v) }; }
+};
+
+template <>
+struct Vec4 <double>
+{
+  float64x2_t _lo;
+  float64x2_t _hi;
+
+  static inline Vec4 zero () { return { vdupq_n_f64 (0.), vdupq_n_f64 (0.) }; }
+  static inline Vec4 set1 (double x) { return { vdupq_n_f64 (x), vdupq_n_f64 (x) }; }
+  static inline Vec4 load (const double ptr []) { return { vld1q_f64 (ptr), vld1q_f64 (ptr + 2) }; }
+  inline void store (double ptr []) const { vst1q_f64 (ptr, _lo); vst1q_f64 (ptr + 2, _hi); }
+
+  friend inline Vec4 operator + (const Vec4 &a, const Vec4 &b) { return { vaddq_f64 (a._lo, b._lo), vaddq_f64 (a._hi, b._hi) }; }
+  friend inline Vec4 operator - (const Vec4 &a, const Vec4 &b) { return { vsubq_f64 (a._lo, b._lo), vsubq_f64 (a._hi, b._hi) }; }
+  friend inline Vec4 operator * (const Vec4 &a, const Vec4 &b) { return { vmulq_f64 (a._lo, b._lo), vmulq_f64 (a._hi, b._hi) }; }
+};
+
+#elif defined IPLUG_SIMD_WASM
+
+template <>
+struct Vec4 <float>
+{
+  v128_t _v;
+
+  static inline Vec4 zero () { return { wasm_f32x4_splat (0.f) }; }
+  static inline Vec4 set1 (float x) { return { wasm_f32x4_splat (x) }; }
+  static inline Vec4 load (const float ptr []) { return { wasm_v128_load (ptr) }; }
+  inline void store (float ptr []) const { wasm_v128_store (ptr, _v); }
+
+  friend inline Vec4 operator + (const Vec4 &a, const Vec4 &b) { return { wasm_f32x4_add (a._v, b._v) }; }
+  friend inline Vec4 operator - (const Vec4 &a, const Vec4 &b) { return { wasm_f32x4_sub (a._v, b._v) }; }
+  friend inline Vec4 operator * (const Vec4 &a, const Vec4 &b) { return { wasm_f32x4_mul (a._v, b._v) }; }
+};
+
+template <>
+struct Vec4 <double>
+{
+  v128_t _lo;
+  v128_t _hi;
+
+  static inline Vec4 zero () { return { wasm_f64x2_splat (0.), wasm_f64x2_splat (0.) }; }
+  static inline Vec4 set1 (double x) { return { wasm_f64x2_splat (x), wasm_f64x2_splat (x) }; }
+  static inline Vec4 load (const double ptr []) { return { wasm_v128_load (ptr), wasm_v128_load (ptr + 2) }; }
+  inline void store (double ptr []) const { wasm_v128_store (ptr, _lo); wasm_v128_store (ptr + 2, _hi); }
+
+  friend inline Vec4 operator + (const Vec4 &a, const Vec4 &b) { return { wasm_f64x2_add (a._lo, b._lo), wasm_f64x2_add (a._hi, b._hi) }; }
+  friend inline Vec4 operator - (const Vec4 &a, const Vec4 &b) { return { wasm_f64x2_sub (a._lo, b._lo), wasm_f64x2_sub (a._hi, b._hi) }; }
+  friend inline Vec4 operator * (const Vec4 &a, const Vec4 &b) { return { wasm_f64x2_mul (a._lo, b._lo), wasm_f64x2_mul (a._hi, b._hi) }; }
+};
+
+#endif
+
+} // namespace hiir
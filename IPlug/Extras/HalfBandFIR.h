@@ -0,0 +1,257 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @brief Linear phase half-band FIR filters for 2x up and down sampling, used by OverSampler in kLinearPhase mode
+ */
+
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+#include "HIIR/Vec4.h"
+
+#include "IPlugPlatform.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** Design a linear phase half-band low pass kernel, with a Kaiser window. Every other tap of a half-band kernel is zero apart from the centre tap,
+ * which is 0.5, so only the remaining taps are returned, i.e. h[0], h[2] ... h[nTaps - 1]. With nTaps of the form 4m + 3 the centre tap is odd,
+ * and there are 2m + 2 of them
+ * @param nTaps The length of the kernel, of the form 4m + 3
+ * @param attenuationDb The stop band attenuation in dB, which sets the window's beta
+ * @return The taps at even indices, which are the only ones that need multiplying */
+static inline std::vector<double> DesignHalfBandFIR(int nTaps, double attenuationDb)
+{
+  assert((nTaps - 3) % 4 == 0);
+
+  auto besselI0 = [](double x) {
+    double sum = 1., term = 1.;
+
+    for (auto k = 1; k < 50; k++)
+    {
+      term *= (x / (2. * k)) * (x / (2. * k));
+      sum += term;
+    }
+
+    return sum;
+  };
+
+  const double beta = attenuationDb > 50. ? 0.1102 * (attenuationDb - 8.7) : 0.5842 * std::pow(attenuationDb - 21., 0.4) + 0.07886 * (attenuationDb - 21.);
+  const double centre = (nTaps - 1) / 2.;
+  std::vector<double> taps;
+  double sum = 0.;
+
+  for (auto i = 0; i < nTaps; i += 2)
+  {
+    const double t = i - centre;
+    const double r = t / centre;
+    const double window = besselI0(beta * std::sqrt(1. - r * r)) / besselI0(beta);
+    const double sinc = std::sin(0.5 * PI * t) / (PI * t);
+    taps.push_back(sinc * window);
+    sum += taps.back();
+  }
+
+  // normalise so that the taps sum to 0.5, giving unity gain at DC along with the centre tap
+  for (auto& tap : taps)
+    tap *= 0.5 / sum;
+
+  return taps;
+}
+
+/** Upsamples four channel interleaved audio by a factor of 2, with a half-band FIR kernel from DesignHalfBandFIR()
+ * The odd outputs only depend on the centre tap, so they are a delayed copy of the input */
+template <typename T>
+class HalfBandFIRUpsampler2x4
+{
+public:
+  static constexpr int kNumChannels = 4;
+
+  /** @param taps The taps returned by DesignHalfBandFIR() */
+  void SetKernel(const std::vector<double>& taps)
+  {
+    mCoefs.clear();
+
+    // doubled to make up for the energy lost by inserting zeros
+    for (auto tap : taps)
+      mCoefs.push_back(hiir::Vec4<T>::set1(static_cast<T>(2. * tap)));
+
+    mHistory.resize(2 * mCoefs.size());
+    Clear();
+  }
+
+  void Clear()
+  {
+    for (auto& x : mHistory)
+      x = hiir::Vec4<T>::zero();
+
+    mPos = 0;
+  }
+
+  /** @return The group delay in samples at the output rate */
+  int GetLatency() const { return static_cast<int>(mCoefs.size()) - 1; }
+
+  /** @param pOut The output, nFrames * 2 interleaved samples
+   * @param pIn The input, nFrames interleaved samples
+   * @param nFrames The number of input samples per channel */
+  void ProcessBlock(T* pOut, const T* pIn, int nFrames)
+  {
+    const int nCoefs = static_cast<int>(mCoefs.size());
+    const int centre = nCoefs / 2 - 1;
+
+    for (auto s = 0; s < nFrames; s++)
+    {
+      // the history is stored twice, so that the newest nCoefs inputs are always contiguous from mPos
+      mPos = (mPos == 0 ? nCoefs : mPos) - 1;
+      mHistory[mPos] = mHistory[mPos + nCoefs] = hiir::Vec4<T>::load(pIn + s * kNumChannels);
+
+      const hiir::Vec4<T>* pHistory = mHistory.data() + mPos;
+      hiir::Vec4<T> even = mCoefs[0] * pHistory[0];
+
+      for (auto k = 1; k < nCoefs; k++)
+        even = even + mCoefs[k] * pHistory[k];
+
+      even.store(pOut + s * kNumChannels * 2);
+      pHistory[centre].store(pOut + s * kNumChannels * 2 + kNumChannels);
+    }
+  }
+
+private:
+  std::vector<hiir::Vec4<T>> mCoefs;
+  std::vector<hiir::Vec4<T>> mHistory;
+  int mPos = 0;
+};
+
+/** Downsamples four channel interleaved audio by a factor of 2, with a half-band FIR kernel from DesignHalfBandFIR() */
+template <typename T>
+class HalfBandFIRDownsampler2x4
+{
+public:
+  static constexpr int kNumChannels = 4;
+
+  /** @param taps The taps returned by DesignHalfBandFIR() */
+  void SetKernel(const std::vector<double>& taps)
+  {
+    mCoefs.clear();
+
+    for (auto tap : taps)
+      mCoefs.push_back(hiir::Vec4<T>::set1(static_cast<T>(tap)));
+
+    mEvenHistory.resize(2 * mCoefs.size());
+    mOddHistory.resize(2 * mCoefs.size());
+    Clear();
+  }
+
+  void Clear()
+  {
+    for (auto& x : mEvenHistory)
+      x = hiir::Vec4<T>::zero();
+
+    for (auto& x : mOddHistory)
+      x = hiir::Vec4<T>::zero();
+
+    mPos = 0;
+  }
+
+  /** @return The group delay in samples at the input rate */
+  int GetLatency() const { return static_cast<int>(mCoefs.size()) - 1; }
+
+  /** @param pOut The output, nFrames interleaved samples
+   * @param pIn The input, nFrames * 2 interleaved samples
+   * @param nFrames The number of output samples per channel */
+  void ProcessBlock(T* pOut, const T* pIn, int nFrames)
+  {
+    const int nCoefs = static_cast<int>(mCoefs.size());
+    const int centre = nCoefs / 2 - 1;
+    const hiir::Vec4<T> half = hiir::Vec4<T>::set1(static_cast<T>(0.5));
+
+    for (auto s = 0; s < nFrames; s++)
+    {
+      // y[n] = sum(h[2k] * x[2n - 2k]) + 0.5 * x[2n - c], where the centre tap c = 2 * centre + 1
+      mPos = (mPos == 0 ? nCoefs : mPos) - 1;
+      mEvenHistory[mPos] = mEvenHistory[mPos + nCoefs] = hiir::Vec4<T>::load(pIn + s * kNumChannels * 2);
+
+      const hiir::Vec4<T>* pEven = mEvenHistory.data() + mPos;
+      const hiir::Vec4<T>* pOdd = mOddHistory.data() + mPos;
+      hiir::Vec4<T> sum = mCoefs[0] * pEven[0];
+
+      for (auto k = 1; k < nCoefs; k++)
+        sum = sum + mCoefs[k] * pEven[k];
+
+      // pOdd[k] is x[2(n - k) - 1] until this frame's odd input is stored below
+      sum = sum + half * pOdd[centre];
+      sum.store(pOut + s * kNumChannels);
+
+      const int next = (mPos == 0 ? nCoefs : mPos) - 1;
+      mOddHistory[next] = mOddHistory[next + nCoefs] = hiir::Vec4<T>::load(pIn + s * kNumChannels * 2 + kNumChannels);
+    }
+  }
+
+private:
+  std::vector<hiir::Vec4<T>> mCoefs;
+  std::vector<hiir::Vec4<T>> mEvenHistory;
+  std::vector<hiir::Vec4<T>> mOddHistory;
+  int mPos = 0;
+};
+
+/** A delay line for four channel interleaved audio, used to pad the latency of the FIR cascade to a whole number of samples at the base rate */
+template <typename T>
+class InterleavedDelay4
+{
+public:
+  static constexpr int kNumChannels = 4;
+
+  /** Allocate for delays up to maxDelay, so that SetDelay() doesn't allocate */
+  void Reserve(int maxDelay)
+  {
+    mBuffer.reserve(maxDelay);
+  }
+
+  void SetDelay(int delay)
+  {
+    mBuffer.resize(delay);
+    Clear();
+  }
+
+  void Clear()
+  {
+    for (auto& x : mBuffer)
+      x = hiir::Vec4<T>::zero();
+
+    mPos = 0;
+  }
+
+  /** Delay a block in place
+   * @param pData nFrames interleaved samples */
+  void ProcessBlock(T* pData, int nFrames)
+  {
+    const int delay = static_cast<int>(mBuffer.size());
+
+    if (!delay)
+      return;
+
+    for (auto s = 0; s < nFrames; s++)
+    {
+      const hiir::Vec4<T> delayed = mBuffer[mPos];
+      mBuffer[mPos] = hiir::Vec4<T>::load(pData + s * kNumChannels);
+      delayed.store(pData + s * kNumChannels);
+      mPos = (mPos + 1) % delay;
+    }
+  }
+
+private:
+  std::vector<hiir::Vec4<T>> mBuffer;
+  int mPos = 0;
+};
+
+END_IPLUG_NAMESPACE
@@ -0,0 +1,396 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @brief Senders for ITU-R BS.1770 true-peak and loudness metering
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <vector>
+
+#include "IPlugPlatform.h"
+#include "IPlugQueue.h"
+#include "IPlugUtilities.h"
+#include "ISender.h"
+#include "Biquad.h"
+#include "Oversampler.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** ITruePeakSender sends the true-peak level of each block to the GUI, as in ITU-R BS.1770 annex 2.
+ * Each block is up sampled four times with OverSampler, whose stages process four channels at once, and the peak is the largest absolute value
+ * of either the input or the up sampled signal. Values are linear, so controls that draw IPeakSender data can draw them too.
+ * Call Reset() with the maximum block size in OnReset(), larger blocks are split */
+template <int MAXNC = 1, int QUEUE_SIZE = 64>
+class ITruePeakSender : public ISender<MAXNC, QUEUE_SIZE, float>
+{
+public:
+  ITruePeakSender(double minThresholdDb = -90.)
+  : ISender<MAXNC, QUEUE_SIZE, float>()
+  , mThreshold(static_cast<float>(DBToAmp(minThresholdDb)))
+  , mOverSampler(EFactor::k4x, true, MAXNC, 0)
+  {
+    // only captures this, so that the std::function doesn't allocate when it is copied on the audio thread
+    mPeakFunc = [this](sample** inputs, sample** /*outputs*/, int nFrames) {
+      for (auto c = 0; c < mNChansInBlock; c++)
+      {
+        float peak = mPeaks[c];
+
+        for (auto s = 0; s < nFrames; s++)
+          peak = std::max(peak, std::fabs((float) inputs[c][s]));
+
+        mPeaks[c] = peak;
+      }
+    };
+
+    Reset();
+  }
+
+  /** Sets the maximum block size and clears the over sampler. Call this in OnReset(), not while ProcessBlock() can be called
+   * @param blockSize The largest number of frames that will be passed to ProcessBlock() at once */
+  void Reset(int blockSize = DEFAULT_BLOCK_SIZE)
+  {
+    mMaxBlockSize = std::max(blockSize, 1);
+    mOverSampler.Reset(mMaxBlockSize);
+  }
+
+  /** Queue true peaks from sample buffers into the sender, checking the data is over the required threshold. This can be called on the realtime audio thread. */
+  void ProcessBlock(sample** inputs, int nFrames, int ctrlTag, int nChans = MAXNC, int chanOffset = 0)
+  {
+    assert(chanOffset + nChans <= MAXNC);
+
+    ISenderData<MAXNC, float> d {ctrlTag, nChans, chanOffset};
+
+    mNChansInBlock = nChans;
+    mPeaks.fill(0.f);
+
+    for (auto c = 0; c < nChans; c++)
+    {
+      mInputs[c] = inputs[chanOffset + c];
+
+      for (auto s = 0; s < nFrames; s++)
+        mPeaks[c] = std::max(mPeaks[c], std::fabs((float) mInputs[c][s]));
+    }
+
+    for (auto pos = 0; pos < nFrames; pos += mMaxBlockSize)
+    {
+      const int n = std::min(mMaxBlockSize, nFrames - pos);
+
+      for (auto c = 0; c < nChans; c++)
+        mChunk[c] = mInputs[c] + pos;
+
+      mOverSampler.ProcessBlock(mChunk.data(), nullptr, n, nChans, 0, mPeakFunc);
+    }
+
+    float sum = 0.f;
+
+    for (auto c = 0; c < nChans; c++)
+    {
+      d.vals[chanOffset + c] = mPeaks[c];
+      sum += mPeaks[c];
+    }
+
+    if (sum > mThreshold || mPreviousSum > mThreshold)
+      ISender<MAXNC, QUEUE_SIZE, float>::PushData(d);
+
+    mPreviousSum = sum;
+  }
+
+private:
+  float mPreviousSum = 1.f;
+  float mThreshold = 0.01f;
+  int mMaxBlockSize = DEFAULT_BLOCK_SIZE;
+  int mNChansInBlock = 0;
+  std::array<float, MAXNC> mPeaks {};
+  std::array<sample*, MAXNC> mInputs {};
+  std::array<sample*, MAXNC> mChunk {};
+  OverSampler<sample> mOverSampler;
+  typename OverSampler<sample>::BlockProcessFunc mPeakFunc;
+};
+
+/** ILoudnessSender measures loudness as in ITU-R BS.1770 and EBU R 128, and sends it to the GUI.
+ * The audio thread only K-weights the input with a BiquadCascade and sums its weighted power over 100 ms, pushing one value per 100 ms onto a lock-free queue.
+ * TransmitData(), on the main thread, keeps the gating history and sends an ISenderData<3, float> to the control,
+ * with the momentary (400 ms), short-term (3 s) and integrated loudness in LUFS, in that order. Silence is kMinLUFS.
+ * The integrated loudness gates 400 ms blocks with 75% overlap at -70 LUFS and then at 10 LU below the ungated level.
+ * Block loudness is kept in a 0.1 LU histogram, so the relative gate is exact to within a bin and the history never grows */
+template <int MAXNC = 2, int QUEUE_SIZE = 64>
+class ILoudnessSender
+{
+public:
+  static constexpr int kUpdateMessage = ISender<>::kUpdateMessage;
+  static constexpr int kMomentaryIdx = 0;
+  static constexpr int kShortTermIdx = 1;
+  static constexpr int kIntegratedIdx = 2;
+
+  static constexpr float kMinLUFS = -120.f;
+  static constexpr double kAbsoluteGate = -70.;
+  static constexpr double kRelativeGate = -10.;
+  static constexpr int kHopsPerMomentary = 4; // 400 ms
+  static constexpr int kHopsPerShortTerm = 30; // 3 s
+  static constexpr double kHistogramMin = kAbsoluteGate;
+  static constexpr double kHistogramStep = 0.1;
+  static constexpr int kHistogramSize = 1000; // -70 to +30 LUFS
+
+  using TData = ISenderData<3, float>;
+
+  ILoudnessSender(double sampleRate = DEFAULT_SAMPLE_RATE)
+  {
+    mChannelWeights.fill(1.f);
+    mHistogramCounts.resize(kHistogramSize);
+    mHistogramEnergies.resize(kHistogramSize);
+    Reset(sampleRate);
+  }
+
+  /** Sets the weight of a channel's power in the sum. BS.1770 uses 1.0 for left, right and centre, 1.41 for the surround channels and 0 for the LFE
+   * @param chanIdx The channel, counting from the chanOffset passed to ProcessBlock()
+   * @param weight The weight, 0 excludes the channel */
+  void SetChannelWeight(int chanIdx, float weight)
+  {
+    assert(chanIdx >= 0 && chanIdx < MAXNC);
+    mChannelWeights[chanIdx] = weight;
+  }
+
+  /** Recomputes the K-weighting filters for the sample rate and clears the filters and all of the measurements. Call this in OnReset(), not while ProcessBlock() can be called */
+  void Reset(double sampleRate)
+  {
+    mSampleRate = sampleRate;
+    mHopSize = std::max(1, static_cast<int>(std::lround(sampleRate * 0.1)));
+    mHopPos = 0;
+    mHopSum = 0.;
+
+    // the BS.1770 pre-filter (a high shelf modelling the head) and RLB high pass, designed for any sample rate
+    {
+      const double f0 = 1681.974450955533;
+      const double G = 3.999843853973347;
+      const double Q = 0.7071752369554196;
+      const double K = std::tan(PI * f0 / sampleRate);
+      const double Vh = std::pow(10., G / 20.);
+      const double Vb = std::pow(Vh, 0.4996667741545416);
+      const double a0 = 1. + K / Q + K * K;
+      mKWeighting.SetSection(0, { (Vh + Vb * K / Q + K * K) / a0, 2. * (K * K - Vh) / a0, (Vh - Vb * K / Q + K * K) / a0,
+                                  2. * (K * K - 1.) / a0, (1. - K / Q + K * K) / a0 }, true);
+    }
+
+    {
+      const double f0 = 38.13547087602444;
+      const double Q = 0.5003270373238773;
+      const double K = std::tan(PI * f0 / sampleRate);
+      const double a0 = 1. + K / Q + K * K;
+      mKWeighting.SetSection(1, { 1., -2., 1., 2. * (K * K - 1.) / a0, (1. - K / Q + K * K) / a0 }, true);
+    }
+
+    mKWeighting.Reset();
+
+    mResetPending = true;
+  }
+
+  /** K-weights sample buffers and queues their power every 100 ms. This can be called on the realtime audio thread. */
+  void ProcessBlock(sample** inputs, int nFrames, int ctrlTag, int nChans = MAXNC, int chanOffset = 0)
+  {
+    assert(chanOffset + nChans <= MAXNC);
+
+    int pos = 0;
+
+    while (pos < nFrames)
+    {
+      const int n = std::min(nFrames - pos, mHopSize - mHopPos);
+
+      for (auto c = 0; c < nChans; c++)
+      {
+        const float weight = mChannelWeights[c];
+
+        if (weight == 0.f)
+          continue;
+
+        const sample* pIn = inputs[chanOffset + c] + pos;
+        double sum = 0.;
+
+        for (auto s = 0; s < n; s++)
+        {
+          const double y = mKWeighting.ProcessSample(pIn[s], c);
+          sum += y * y;
+        }
+
+        mHopSum += weight * sum;
+      }
+
+      mKWeighting.FlushDenormals();
+
+      pos += n;
+      mHopPos += n;
+
+      if (mHopPos == mHopSize)
+      {
+        mQueue.Push({ctrlTag, mHopSum / mHopSize});
+        mHopPos = 0;
+        mHopSum = 0.;
+      }
+    }
+  }
+
+  /** Clears the integrated loudness, e.g. when the user restarts a measurement. Call this on the main thread */
+  void ResetIntegrated()
+  {
+    std::fill(mHistogramCounts.begin(), mHistogramCounts.end(), 0);
+    std::fill(mHistogramEnergies.begin(), mHistogramEnergies.end(), 0.);
+    mIntegrated = kMinLUFS;
+  }
+
+  /** Pops the 100 ms powers off the queue, updates the measurements and sends the latest to the control with IEditorDelegate::SendControlMsgFromDelegate().
+   *  This must be called on the main thread - typically in MyPlugin::OnIdle() */
+  void TransmitData(IEditorDelegate& dlg)
+  {
+    if (mResetPending.exchange(false))
+    {
+      mHops.fill(0.);
+      mNHops = 0;
+      mHopWriteIdx = 0;
+      ResetIntegrated();
+    }
+
+    Hop hop;
+    int ctrlTag = kNoTag;
+
+    while (mQueue.Pop(hop))
+    {
+      ctrlTag = hop.ctrlTag;
+      AddHop(hop.power);
+    }
+
+    if (ctrlTag == kNoTag)
+      return;
+
+    TData d {ctrlTag, 3, 0};
+    d.vals[kMomentaryIdx] = ToLUFS(MeanPower(kHopsPerMomentary));
+    d.vals[kShortTermIdx] = ToLUFS(MeanPower(kHopsPerShortTerm));
+    d.vals[kIntegratedIdx] = mIntegrated;
+
+    dlg.SendControlMsgFromDelegate(ctrlTag, kUpdateMessage, sizeof(TData), &d);
+  }
+
+private:
+  struct Hop
+  {
+    int ctrlTag = kNoTag;
+    double power = 0.;
+  };
+
+  static double ToLoudness(double power)
+  {
+    return -0.691 + 10. * std::log10(power);
+  }
+
+  static float ToLUFS(double power)
+  {
+    return power > 0. ? std::max(kMinLUFS, static_cast<float>(ToLoudness(power))) : kMinLUFS;
+  }
+
+  double MeanPower(int nHops) const
+  {
+    const int n = std::min(nHops, mNHops);
+
+    if (n == 0)
+      return 0.;
+
+    double sum = 0.;
+
+    for (auto i = 1; i <= n; i++)
+      sum += mHops[(mHopWriteIdx - i + kHopsPerShortTerm) % kHopsPerShortTerm];
+
+    return sum / nHops; // a window that hasn't filled yet counts the missing audio as silence
+  }
+
+  void AddHop(double power)
+  {
+    mHops[mHopWriteIdx] = power;
+    mHopWriteIdx = (mHopWriteIdx + 1) % kHopsPerShortTerm;
+    mNHops = std::min(mNHops + 1, kHopsPerShortTerm);
+
+    // every 100 ms completes a 400 ms gating block
+    if (mNHops < kHopsPerMomentary)
+      return;
+
+    const double blockPower = MeanPower(kHopsPerMomentary);
+
+    if (blockPower <= 0.)
+      return;
+
+    const double loudness = ToLoudness(blockPower);
+
+    if (loudness <= kAbsoluteGate)
+      return;
+
+    const int bin = std::min(kHistogramSize - 1, static_cast<int>((loudness - kHistogramMin) / kHistogramStep));
+    mHistogramCounts[bin]++;
+    mHistogramEnergies[bin] += blockPower;
+
+    UpdateIntegrated();
+  }
+
+  void UpdateIntegrated()
+  {
+    uint64_t count = 0;
+    double energy = 0.;
+
+    for (auto i = 0; i < kHistogramSize; i++)
+    {
+      count += mHistogramCounts[i];
+      energy += mHistogramEnergies[i];
+    }
+
+    if (count == 0)
+    {
+      mIntegrated = kMinLUFS;
+      return;
+    }
+
+    const double relativeGate = ToLoudness(energy / count) + kRelativeGate;
+    const int firstBin = std::max(0, static_cast<int>(std::ceil((relativeGate - kHistogramMin) / kHistogramStep)));
+
+    count = 0;
+    energy = 0.;
+
+    for (auto i = firstBin; i < kHistogramSize; i++)
+    {
+      count += mHistogramCounts[i];
+      energy += mHistogramEnergies[i];
+    }
+
+    mIntegrated = count ? ToLUFS(energy / count) : kMinLUFS;
+  }
+
+  // audio thread
+  double mSampleRate = DEFAULT_SAMPLE_RATE;
+  int mHopSize = 4800;
+  int mHopPos = 0;
+  double mHopSum = 0.;
+  BiquadCascade<double, MAXNC, 2> mKWeighting;
+  std::array<float, MAXNC> mChannelWeights;
+  IPlugQueue<Hop> mQueue {QUEUE_SIZE};
+  std::atomic<bool> mResetPending {true};
+
+  // main thread
+  std::array<double, kHopsPerShortTerm> mHops {};
+  int mHopWriteIdx = 0;
+  int mNHops = 0;
+  std::vector<uint64_t> mHistogramCounts;
+  std::vector<double> mHistogramEnergies;
+  float mIntegrated = kMinLUFS;
+};
+
+END_IPLUG_NAMESPACE
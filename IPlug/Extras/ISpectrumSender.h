@@ -0,0 +1,289 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @brief A sender that analyses audio into log-frequency spectra on a worker thread, for IVSpectrumAnalyzerControl
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+#include "FFT.h"
+#include "IPlugPlatform.h"
+#include "IPlugQueue.h"
+#include "IPlugUtilities.h"
+#include "ISender.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** ISpectrumSender sends the magnitude spectra of sample buffers to the GUI, as NBINS log-frequency bins per channel.
+ * The audio thread only copies samples into a lock-free queue. A worker thread applies a Hann window to overlapping blocks, runs the FFT with FFT, which uses the backend chosen when compiling,
+ * reduces each spectrum to the log-frequency bins, and publishes the latest spectra in an IFrameSender, so the GUI thread only draws them.
+ * Magnitudes are linear, with a full scale sine at 1. Controls receive ISender<>::kFrameMessage with an ISenderData<MAXNC, std::array<float, NBINS>>.
+ * As with WDL_ConvolutionEngine, WDL/fft.c must be compiled into the project, and WDL_FFT_REALSIZE defined consistently, whichever backend is used */
+template <int MAXNC = 1, int NBINS = 128, int QUEUE_SIZE = 256>
+class ISpectrumSender
+{
+public:
+  static constexpr int kChunkSize = 64;
+  static constexpr int kMaxFFTSize = FFT::kMaxSize;
+  static constexpr int kIdleWaitMs = 100; // the worker sleeps until the audio thread queues a chunk, this only bounds the wait
+
+  using TFrame = ISenderData<MAXNC, std::array<float, NBINS>>;
+
+  /** @param fftSize The FFT size, which is rounded up to a power of two from 128 to kMaxFFTSize
+   * @param overlap The number of FFTs per FFT size of input, e.g. 4 for 75% overlap
+   * @param minFreq The frequency of the bottom of the lowest bin, the highest bin ends at Nyquist */
+  ISpectrumSender(int fftSize = 2048, int overlap = 4, double minFreq = 20.)
+  {
+    mMinFreq = minFreq;
+    mQueue.SetSignal(&mSignal);
+    Configure(fftSize, overlap, mSampleRate);
+  }
+
+  ~ISpectrumSender()
+  {
+    Stop();
+  }
+
+  ISpectrumSender(const ISpectrumSender&) = delete;
+  ISpectrumSender& operator=(const ISpectrumSender&) = delete;
+
+  /** Change the FFT size and overlap. This must not be called concurrently with ProcessBlock(), e.g. call it in OnReset() */
+  void SetFFTSize(int fftSize, int overlap = 4)
+  {
+    Configure(fftSize, overlap, mSampleRate);
+  }
+
+  /** Set the sample rate, which the log-frequency bins depend on. This must not be called concurrently with ProcessBlock(), e.g. call it in OnReset() */
+  void SetSampleRate(double sampleRate)
+  {
+    if (sampleRate != mSampleRate)
+      Configure(mFFTSize, mOverlap, sampleRate);
+  }
+
+  /** @return The centre frequency of a bin in Hz, for labelling a display */
+  double GetBinFrequency(int bin) const
+  {
+    return mMinFreq * std::pow(mSampleRate / 2. / mMinFreq, (bin + 0.5) / NBINS);
+  }
+
+  /** @return The number of chunks of samples dropped because the worker thread fell behind */
+  int GetNumDroppedChunks() const { return mNDropped.load(std::memory_order_relaxed); }
+
+  /** Queue sample buffers for analysis. This can be called on the realtime audio thread */
+  void ProcessBlock(sample** inputs, int nFrames, int ctrlTag, int nChans = MAXNC, int chanOffset = 0)
+  {
+    nChans = std::min(nChans, MAXNC - chanOffset);
+
+    for (auto s = 0; s < nFrames; s++)
+    {
+      for (auto c = 0; c < nChans; c++)
+        mChunk.samples[c][mChunk.nFrames] = static_cast<float>(inputs[chanOffset + c][s]);
+
+      if (++mChunk.nFrames == kChunkSize)
+      {
+        mChunk.ctrlTag = ctrlTag;
+        mChunk.nChans = nChans;
+        mChunk.chanOffset = chanOffset;
+
+        if (!mQueue.Push(mChunk))
+          mNDropped.fetch_add(1, std::memory_order_relaxed);
+
+        mChunk.nFrames = 0;
+      }
+    }
+  }
+
+  /** If a new spectrum has been published, sends a pointer to it to its control.
+   *  This must be called on the main thread - typically in MyPlugin::OnIdle() */
+  void TransmitData(IEditorDelegate& dlg)
+  {
+    mFrameSender.TransmitData(dlg);
+  }
+
+private:
+  struct Chunk
+  {
+    std::array<std::array<float, kChunkSize>, MAXNC> samples;
+    int nFrames = 0;
+    int nChans = MAXNC;
+    int chanOffset = 0;
+    int ctrlTag = kNoTag;
+  };
+
+  void Configure(int fftSize, int overlap, double sampleRate)
+  {
+    Stop();
+
+    int size = kChunkSize * 2;
+    while (size < fftSize && size < kMaxFFTSize)
+      size *= 2;
+
+    mFFTSize = size;
+    mFFT.SetSize(size);
+    mOverlap = Clip(overlap, 1, mFFTSize / kChunkSize);
+    mHopSize = mFFTSize / mOverlap;
+    mSampleRate = sampleRate;
+
+    mHistory.assign(MAXNC * mFFTSize, 0.f);
+    mFFTBuffer.assign(mFFTSize, 0.f);
+    mWindow.resize(mFFTSize);
+    mMagnitudes.resize(mFFTSize / 2 + 1);
+
+    double windowSum = 0.;
+    for (auto i = 0; i < mFFTSize; i++)
+    {
+      mWindow[i] = static_cast<float>(0.5 - 0.5 * std::cos(2. * PI * i / mFFTSize));
+      windowSum += mWindow[i];
+    }
+    mMagnitudeScale = static_cast<float>(1. / windowSum); // a sine's peak is windowSum / 2, and FFT::Real() doubles it
+
+    // the edges of the log-frequency bins, in FFT bins
+    const double nyquist = mSampleRate / 2.;
+    const double minFreq = std::min(mMinFreq, nyquist / 2.);
+    for (auto b = 0; b <= NBINS; b++)
+      mBinEdges[b] = static_cast<float>(minFreq * std::pow(nyquist / minFreq, static_cast<double>(b) / NBINS) * mFFTSize / mSampleRate);
+
+    mHistoryPos = 0;
+    mSinceLastFFT = 0;
+    mChunk.nFrames = 0;
+
+    Chunk chunk;
+    while (mQueue.Pop(chunk)) {}
+
+    mRunning.store(true);
+    mWorker = std::thread(&ISpectrumSender::WorkerLoop, this);
+  }
+
+  void Stop()
+  {
+    mRunning.store(false);
+    mSignal.Notify();
+
+    if (mWorker.joinable())
+      mWorker.join();
+  }
+
+  void WorkerLoop()
+  {
+    Chunk chunk;
+
+    while (mRunning.load())
+    {
+      if (!mQueue.Pop(chunk))
+      {
+        mQueue.Wait(kIdleWaitMs);
+        continue;
+      }
+
+      for (auto c = 0; c < chunk.nChans; c++)
+        std::copy(chunk.samples[c].begin(), chunk.samples[c].end(), mHistory.begin() + c * mFFTSize + mHistoryPos);
+
+      mHistoryPos = (mHistoryPos + kChunkSize) % mFFTSize;
+      mSinceLastFFT += kChunkSize;
+
+      if (mSinceLastFFT >= mHopSize)
+      {
+        mSinceLastFFT = 0;
+        Analyse(chunk);
+      }
+    }
+  }
+
+  void Analyse(const Chunk& chunk)
+  {
+    TFrame& frame = mFrameSender.BeginFrame();
+    frame.ctrlTag = chunk.ctrlTag;
+    frame.nChans = chunk.nChans;
+    frame.chanOffset = chunk.chanOffset;
+
+    const int halfSize = mFFTSize / 2;
+
+    for (auto c = 0; c < chunk.nChans; c++)
+    {
+      // unroll the history ring, oldest sample first
+      const float* pHistory = mHistory.data() + c * mFFTSize;
+      for (auto i = 0; i < mFFTSize; i++)
+        mFFTBuffer[i] = pHistory[(mHistoryPos + i) % mFFTSize] * mWindow[i];
+
+      mFFT.Real(mFFTBuffer.data(), false);
+
+      const WDL_FFT_COMPLEX* pBins = reinterpret_cast<const WDL_FFT_COMPLEX*>(mFFTBuffer.data());
+      mMagnitudes[0] = static_cast<float>(std::fabs(pBins[0].re)) * mMagnitudeScale * 0.5f;
+      mMagnitudes[halfSize] = static_cast<float>(std::fabs(pBins[0].im)) * mMagnitudeScale * 0.5f;
+
+      for (auto k = 1; k < halfSize; k++)
+      {
+        const WDL_FFT_COMPLEX& bin = pBins[k];
+        mMagnitudes[k] = static_cast<float>(std::sqrt(bin.re * bin.re + bin.im * bin.im)) * mMagnitudeScale;
+      }
+
+      for (auto b = 0; b < NBINS; b++)
+      {
+        const float lo = mBinEdges[b];
+        const float hi = mBinEdges[b + 1];
+        const int first = static_cast<int>(std::ceil(lo));
+        const int last = std::min(static_cast<int>(std::floor(hi)), halfSize);
+
+        if (first <= last)
+        {
+          // the peak of the FFT bins in the band
+          frame.vals[chunk.chanOffset + c][b] = *std::max_element(mMagnitudes.begin() + first, mMagnitudes.begin() + last + 1);
+        }
+        else
+        {
+          // the band is narrower than an FFT bin, so interpolate at its centre
+          const float centre = std::min((lo + hi) / 2.f, static_cast<float>(halfSize));
+          const int k = std::min(static_cast<int>(centre), halfSize - 1);
+          const float frac = centre - k;
+          frame.vals[chunk.chanOffset + c][b] = mMagnitudes[k] + frac * (mMagnitudes[k + 1] - mMagnitudes[k]);
+        }
+      }
+    }
+
+    mFrameSender.EndFrame();
+  }
+
+  // audio thread
+  Chunk mChunk;
+  IPlugQueue<Chunk> mQueue {QUEUE_SIZE};
+  IPlugSignal mSignal;
+  std::atomic<int> mNDropped {0};
+
+  // worker thread
+  std::vector<float> mHistory;
+  FFT mFFT;
+  std::vector<WDL_FFT_REAL> mFFTBuffer;
+  std::vector<float> mWindow;
+  std::vector<float> mMagnitudes;
+  std::array<float, NBINS + 1> mBinEdges {};
+  float mMagnitudeScale = 1.f;
+  int mHistoryPos = 0;
+  int mSinceLastFFT = 0;
+  IFrameSender<MAXNC, std::array<float, NBINS>> mFrameSender;
+
+  int mFFTSize = 2048;
+  int mOverlap = 4;
+  int mHopSize = 512;
+  double mSampleRate = DEFAULT_SAMPLE_RATE;
+  double mMinFreq = 20.;
+  std::atomic<bool> mRunning {false};
+  std::thread mWorker;
+};
+
+END_IPLUG_NAMESPACE
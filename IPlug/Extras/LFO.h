@@ -12,10 +12,13 @@
 
 /**
  * @file
- * @brief Basic unoptimized tempo-syncable LFO implementation
+ * @brief Basic unoptimized tempo-syncable LFO implementation, and a bank of LFOs for modulating many targets
  */
 
+#include <vector>
+
 #include "Oscillator.h"
+#include "ITransportMap.h"
 
 BEGIN_IPLUG_NAMESPACE
 
@@ -141,6 +144,16 @@ public:
     
     IOscillator<T>::mPhase = phase;
   }
+
+  /** Block process function that follows the host transport through the block, so that the sync stays exact across tempo changes and loop wraps within it
+   * @param transport The transport map, see IPlugProcessor::GetTransportMap()
+   * @param startIdx The offset of pOutput in the host's block, e.g. IPlugProcessor::GetSegmentStart() */
+  void ProcessBlock(T* pOutput, int nFrames, const ITransportMap& transport, int startIdx = 0)
+  {
+    transport.ForEachSegment(startIdx, nFrames, [&](int idx, int n, double ppqPos, double tempo) {
+      ProcessBlock(pOutput + idx, n, ppqPos, transport.GetTransportIsRunning(), tempo);
+    });
+  }
   
   void SetShape(int lfoShape)
   {
@@ -188,6 +201,19 @@ private:
   };
   
   inline T DoProcess(T phase)
+  {
+    mLastOutput = Shape(phase, mShape, mPolarity) * mLevelScalar;
+    
+    return mLastOutput;
+  }
+
+public:
+  /** Evaluate a shape, without the level scalar
+   * @param phase The phase, between 0 and 1
+   * @param shape The shape
+   * @param polarity Whether the output is between 0 and 1, or -1 and 1
+   * @return The value of the shape at phase */
+  static inline T Shape(T phase, EShape shape, EPolarity polarity)
   {
     auto triangle         = [](T x){ return (2. * (1. - std::abs((WrapPhase(x + 0.25) * 2.) -1.))) - 1.; };
     auto triangleUnipolar = [](T x){ return 1. - std::abs((x * 2.) - 1. ); };
@@ -200,9 +226,9 @@ private:
     
     T output = 0.;
     
-    if(mPolarity == EPolarity::kUnipolar)
+    if(polarity == EPolarity::kUnipolar)
     {
-      switch (mShape) {
+      switch (shape) {
         case kTriangle: output = triangleUnipolar(phase); break;
         case kSquare:   output = squareUnipolar(phase); break;
         case kRampUp:   output = rampupUnipolar(phase); break;
@@ -213,7 +239,7 @@ private:
     }
     else
     {
-      switch (mShape) {
+      switch (shape) {
         case kTriangle: output = triangle(phase); break;
         case kSquare:   output = square(phase); break;
         case kRampUp:   output = rampup(phase); break;
@@ -223,9 +249,7 @@ private:
       }
     }
     
-    mLastOutput = output * mLevelScalar;
-    
-    return mLastOutput;
+    return output;
   }
 
 private:
@@ -237,4 +261,171 @@ private:
   ERateMode mRateMode = ERateMode::kHz;
 };
 
+/** A bank of NLFOs LFOs, with the same shapes, polarities and rate modes as LFO, for modulating many targets at once, e.g. per voice.
+ * Each LFO's phase is worked out once per block as a start and an increment, and the shapes are read from lookup tables that are shared
+ * by every bank, so each LFO costs one branch free loop per block. The output is one buffer per LFO */
+template<typename T = double, int NLFOs = 32>
+class LFOBank
+{
+public:
+  using EShape = typename LFO<T>::EShape;
+  using EPolarity = typename LFO<T>::EPolarity;
+  using ERateMode = typename LFO<T>::ERateMode;
+  
+  static constexpr int kTableSize = 2048;
+  
+  LFOBank()
+  {
+    for (auto i = 0; i < NLFOs; i++)
+    {
+      mQNScalar[i] = 1.;
+      mLevelScalar[i] = 1.;
+      SetShape(i, LFO<T>::kTriangle);
+    }
+  }
+  
+  void SetSampleRate(double sampleRate) { mSampleRate = sampleRate; }
+  
+  void SetFreqCPS(int lfo, double freqHz) { mFreqHz[lfo] = freqHz; }
+  
+  void SetShape(int lfo, int lfoShape)
+  {
+    mShape[lfo] = (EShape) Clip(lfoShape, 0, LFO<T>::kNumShapes-1);
+    UpdateTable(lfo);
+  }
+  
+  void SetPolarity(int lfo, bool bipolar)
+  {
+    mPolarity[lfo] = bipolar ? EPolarity::kBipolar : EPolarity::kUnipolar;
+    UpdateTable(lfo);
+  }
+  
+  void SetScalar(int lfo, T scalar) { mLevelScalar[lfo] = scalar; }
+  
+  void SetQNScalar(int lfo, T scalar) { mQNScalar[lfo] = scalar; }
+  
+  void SetQNScalarFromDivision(int lfo, int division)
+  {
+    mQNScalar[lfo] = LFO<T>::GetQNScalar(static_cast<typename LFO<T>::ETempoDivison>(Clip(division, 0, (int) LFO<T>::kNumDivisions - 1)));
+  }
+  
+  void SetRateMode(int lfo, bool sync) { mRateMode[lfo] = sync ? ERateMode::kBPM : ERateMode::kHz; }
+  
+  void SetPhase(int lfo, double phase) { mPhase[lfo] = phase; }
+  
+  void Reset()
+  {
+    for (auto i = 0; i < NLFOs; i++)
+      mPhase[i] = 0.;
+  }
+  
+  T GetLastOutput(int lfo) const { return mLastOutput[lfo]; }
+  
+  /** Process a block of every LFO, see LFO::ProcessBlock()
+   * @param outputs NLFOs buffers of nFrames samples, one per LFO */
+  void ProcessBlock(T** outputs, int nFrames, double qnPos = 0., bool transportIsRunning = false, double tempo = 120.)
+  {
+    const double samplesPerBeat = mSampleRate * (60.0 / (tempo == 0.0 ? 1.0 : tempo));
+    
+    for (auto i = 0; i < NLFOs; i++)
+    {
+      // the phase of sample s is start + s * incr, wrapped
+      double start, incr;
+      
+      if (mRateMode[i] == ERateMode::kBPM)
+      {
+        incr = mQNScalar[i] / samplesPerBeat;
+        start = transportIsRunning ? qnPos * mQNScalar[i] : mPhase[i] + incr;
+      }
+      else
+      {
+        incr = mFreqHz[i] / mSampleRate;
+        start = mPhase[i] + incr;
+      }
+      
+      start -= std::floor(start);
+      
+      const T* pTable = mTables[i];
+      const T scalar = mLevelScalar[i];
+      const T interpolate = mShape[i] == LFO<T>::kSquare ? 0. : 1.; // a step is exact without interpolating, which would smear it
+      T* pOutput = outputs[i];
+      
+      for (auto s = 0; s < nFrames; s++)
+      {
+        double phase = start + s * incr;
+        phase = (phase - std::floor(phase)) * kTableSize;
+        const int idx = static_cast<int>(phase);
+        const T frac = static_cast<T>(phase - idx) * interpolate;
+        pOutput[s] = (pTable[idx] + frac * (pTable[idx + 1] - pTable[idx])) * scalar;
+      }
+      
+      const double end = start + (nFrames - 1) * incr;
+      mPhase[i] = end - std::floor(end);
+      
+      if (nFrames > 0)
+        mLastOutput[i] = pOutput[nFrames - 1];
+    }
+  }
+
+  /** Process a block of every LFO following the host transport through the block, see LFO::ProcessBlock()
+   * @param outputs NLFOs buffers of nFrames samples, one per LFO
+   * @param transport The transport map, see IPlugProcessor::GetTransportMap()
+   * @param startIdx The offset of the outputs in the host's block, e.g. IPlugProcessor::GetSegmentStart() */
+  void ProcessBlock(T** outputs, int nFrames, const ITransportMap& transport, int startIdx = 0)
+  {
+    T* segmentOutputs[NLFOs];
+    
+    transport.ForEachSegment(startIdx, nFrames, [&](int idx, int n, double ppqPos, double tempo) {
+      for (auto i = 0; i < NLFOs; i++)
+        segmentOutputs[i] = outputs[i] + idx;
+      
+      ProcessBlock(segmentOutputs, n, ppqPos, transport.GetTransportIsRunning(), tempo);
+    });
+  }
+  
+private:
+  void UpdateTable(int lfo)
+  {
+    mTables[lfo] = GetTable(mShape[lfo], mPolarity[lfo]);
+  }
+  
+  /** @return The shared table for a shape and polarity, with a guard point. All the tables are built by the first call */
+  static const T* GetTable(EShape shape, EPolarity polarity)
+  {
+    static const std::vector<T> sTables = [](){
+      std::vector<T> tables(LFO<T>::kNumShapes * 2 * (kTableSize + 1));
+      
+      for (auto shape = 0; shape < LFO<T>::kNumShapes; shape++)
+      {
+        for (auto bipolar = 0; bipolar < 2; bipolar++)
+        {
+          T* pTable = tables.data() + (shape * 2 + bipolar) * (kTableSize + 1);
+          const EPolarity polarity = bipolar ? EPolarity::kBipolar : EPolarity::kUnipolar;
+          
+          for (auto i = 0; i < kTableSize; i++)
+            pTable[i] = LFO<T>::Shape(T(i) / kTableSize, (EShape) shape, polarity);
+          
+          // the guard point is the value approaching a phase of 1 rather than at 0, so that the ramps don't interpolate across the wrap
+          pTable[kTableSize] = 2 * pTable[kTableSize - 1] - pTable[kTableSize - 2];
+        }
+      }
+      
+      return tables;
+    }();
+    
+    return sTables.data() + (shape * 2 + (polarity == EPolarity::kBipolar ? 1 : 0)) * (kTableSize + 1);
+  }
+  
+  double mSampleRate = 44100.;
+  double mPhase[NLFOs] = {};
+  double mFreqHz[NLFOs] = {};
+  T mQNScalar[NLFOs] = {};
+  T mLevelScalar[NLFOs] = {};
+  T mLastOutput[NLFOs] = {};
+  EShape mShape[NLFOs] = {};
+  EPolarity mPolarity[NLFOs] = {};
+  ERateMode mRateMode[NLFOs] = {};
+  const T* mTables[NLFOs] = {};
+};
+
 END_IPLUG_NAMESPACE
@@ -0,0 +1,398 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc Lookahead
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "heapbuf.h"
+
+#include "IPlugPlatform.h"
+#include "IPlugUtilities.h"
+#include "IPlugProcessor.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** The maximum (or minimum) of the last N values, by a monotonic queue: each value is pushed and popped once, so it costs O(1) per sample whatever the window length.
+ * The queue is a preallocated ring rather than a std::deque, so Process() never allocates
+ * @tparam T The sample type
+ * @tparam Max \c true for the maximum, \c false for the minimum */
+template <typename T = sample, bool Max = true>
+class SlidingWindowExtremum
+{
+public:
+  SlidingWindowExtremum(int windowLength = 1)
+  {
+    SetWindowLength(windowLength);
+  }
+
+  /** Allocate for a window and clear it. Not for the audio thread
+   * @param windowLength The number of values, including the latest one, that the extreme is taken over */
+  void SetWindowLength(int windowLength)
+  {
+    mLength = std::max(windowLength, 1);
+    uint32_t size = 1;
+
+    while (size < static_cast<uint32_t>(mLength))
+      size <<= 1;
+
+    mMask = size - 1;
+    mValues.Resize(size);
+    mIndices.Resize(size);
+    Reset();
+  }
+
+  int GetWindowLength() const { return mLength; }
+
+  void Reset()
+  {
+    mHead = mTail = mCount = 0;
+  }
+
+  /** @param x The next value
+   * @return The extreme of x and the windowLength - 1 values before it */
+  inline T Process(T x)
+  {
+    T* pValues = mValues.Get();
+    uint32_t* pIndices = mIndices.Get();
+
+    // values that x beats can never be the extreme again
+    while (mTail != mHead && !Beats(pValues[(mTail - 1) & mMask], x))
+      mTail--;
+
+    pValues[mTail & mMask] = x;
+    pIndices[mTail & mMask] = mCount;
+    mTail++;
+
+    // unsigned, so that the comparison survives mCount wrapping
+    if (mCount - pIndices[mHead & mMask] >= static_cast<uint32_t>(mLength))
+      mHead++;
+
+    mCount++;
+    return pValues[mHead & mMask];
+  }
+
+  /** Process() a block. pDest can be pSrc */
+  void ProcessBlock(const T* pSrc, T* pDest, int nFrames)
+  {
+    for (auto s = 0; s < nFrames; s++)
+      pDest[s] = Process(pSrc[s]);
+  }
+
+private:
+  static inline bool Beats(T a, T b) { return Max ? a > b : a < b; }
+
+  WDL_TypedBuf<T> mValues;
+  WDL_TypedBuf<uint32_t> mIndices;
+  uint32_t mMask = 0;
+  uint32_t mHead = 0;
+  uint32_t mTail = 0;
+  uint32_t mCount = 0;
+  int mLength = 1;
+};
+
+template <typename T = sample>
+using SlidingWindowMax = SlidingWindowExtremum<T, true>;
+
+template <typename T = sample>
+using SlidingWindowMin = SlidingWindowExtremum<T, false>;
+
+/** A lookahead buffer for limiters, compressors and true peak meters, which delays the signal by the lookahead time and lets the DSP see the frames that are coming.
+ * The frames are kept interleaved in a ring that is written twice, one copy after the other, so that any window of up to GetCapacity() frames is contiguous without copying.
+ * Positions are counted in the delayed output's time: after Write() of a block, position 0 is the frame that ReadDelayed() outputs first, position p + GetLookahead() is the
+ * newest frame that p has to look ahead to, and negative positions are older frames. A typical limiter:
+ * \code
+ * mLookahead.Write(inputs, nFrames);
+ * mLookahead.GetPeaks(mLookahead.GetLookahead(), nFrames, mPeaks); // the peaks of the frames just written
+ * mPeakHold.ProcessBlock(mPeaks, mPeaks, nFrames); // a SlidingWindowMax over GetLookahead() + 1 frames, so mPeaks[p] covers positions p to p + GetLookahead()
+ * mLookahead.ReadDelayed(outputs, nFrames);
+ * // apply the gain computed from mPeaks to outputs
+ * \endcode
+ * @tparam T The sample type */
+template <typename T = sample>
+class Lookahead
+{
+public:
+  /** A window of frames, which stays valid until the next Write() */
+  struct Window
+  {
+    const T* mData = nullptr; // interleaved, mNChans samples per frame
+    int mNChans = 0;
+    int mNFrames = 0;
+
+    const T* Frame(int frameIdx) const { return mData + frameIdx * mNChans; }
+    T Get(int frameIdx, int chanIdx) const { return mData[frameIdx * mNChans + chanIdx]; }
+  };
+
+  /** @param pProcessor If not nullptr, the processor whose latency SetLookahead() sets */
+  Lookahead(IPlugProcessor* pProcessor = nullptr)
+  : mProcessor(pProcessor)
+  {}
+
+  /** Allocate and clear the buffer. Not for the audio thread, call it in your constructor or OnReset()
+   * @param nChans The number of channels
+   * @param maxLookahead The longest lookahead, in frames
+   * @param maxBlockSize The most frames that will be written at once, e.g. GetBlockSize()
+   * @param history How many frames before position 0 should stay readable */
+  void Resize(int nChans, int maxLookahead, int maxBlockSize, int history = 0)
+  {
+    uint32_t capacity = 1;
+
+    while (capacity < static_cast<uint32_t>(maxLookahead + maxBlockSize + history))
+      capacity <<= 1;
+
+    mNChans = nChans;
+    mMaxLookahead = maxLookahead;
+    mMaxBlockSize = maxBlockSize;
+    mCapacity = capacity;
+    mLookahead = std::min(mLookahead, maxLookahead);
+    mBuffer.Resize(2 * capacity * nChans);
+    Reset();
+  }
+
+  /** Clear the buffer, as if silence had been written for ever */
+  void Reset()
+  {
+    memset(mBuffer.Get(), 0, mBuffer.GetSize() * sizeof(T));
+    mWritePos = 0;
+    mNFramesWritten = 0;
+  }
+
+  /** Set the lookahead and, if there is a processor, its latency with IPlugProcessor::SetLatency(), so it must not be called on the audio thread.
+   * The delayed signal jumps, so change it when processing is stopped, e.g. in OnReset()
+   * @param nFrames The lookahead in frames, at most the maxLookahead given to Resize()
+   * @param extraLatency Latency of the plug-in's other processing, which is added to the lookahead when it is reported */
+  void SetLookahead(int nFrames, int extraLatency = 0)
+  {
+    assert(nFrames <= mMaxLookahead);
+    mLookahead = Clip(nFrames, 0, mMaxLookahead);
+
+    if (mProcessor)
+      mProcessor->SetLatency(mLookahead + extraLatency);
+  }
+
+  int GetLookahead() const { return mLookahead; }
+  int NChans() const { return mNChans; }
+
+  /** @return The longest window that is always contiguous */
+  int GetCapacity() const { return static_cast<int>(mCapacity); }
+
+  /** Add a block of frames
+   * @param inputs One buffer per channel
+   * @param nFrames The number of frames, at most the maxBlockSize given to Resize() */
+  void Write(T** inputs, int nFrames)
+  {
+    assert(nFrames <= mMaxBlockSize);
+    T* pBuffer = mBuffer.Get();
+    const int nChans = mNChans;
+    const uint32_t mask = mCapacity - 1;
+
+    for (auto s = 0; s < nFrames; s++)
+    {
+      T* pFrame = pBuffer + mWritePos * nChans;
+      T* pMirror = pFrame + mCapacity * nChans;
+
+      for (auto c = 0; c < nChans; c++)
+        pFrame[c] = pMirror[c] = inputs[c][s];
+
+      mWritePos = (mWritePos + 1) & mask;
+    }
+
+    mNFramesWritten = nFrames;
+  }
+
+  /** @param pos The position of the first frame, in the delayed time of the last block written, see the class description
+   * @param nFrames The number of frames, positions pos to pos + nFrames - 1, which must not be newer than the newest frame written
+   * @return The frames, contiguous */
+  Window GetWindow(int pos, int nFrames) const
+  {
+    assert(nFrames <= GetCapacity() && pos + nFrames <= mNFramesWritten + mLookahead);
+    const uint32_t start = (mWritePos - static_cast<uint32_t>(mNFramesWritten + mLookahead - pos)) & (mCapacity - 1);
+    return Window { mBuffer.Get() + start * mNChans, mNChans, nFrames };
+  }
+
+  /** Copy the delayed block, positions 0 to nFrames - 1, to planar buffers
+   * @param outputs One buffer per channel, which can be the inputs of the last Write()
+   * @param nFrames The number of frames, usually that of the last Write() */
+  void ReadDelayed(T** outputs, int nFrames) const
+  {
+    const Window window = GetWindow(0, nFrames);
+
+    for (auto c = 0; c < mNChans; c++)
+    {
+      T* pOut = outputs[c];
+
+      for (auto s = 0; s < nFrames; s++)
+        pOut[s] = window.Get(s, c);
+    }
+  }
+
+  /** The largest absolute sample of each frame, across all channels, for peak detection
+   * @param pos The position of the first frame, see GetWindow()
+   * @param nFrames The number of frames
+   * @param pDest One value per frame */
+  void GetPeaks(int pos, int nFrames, T* pDest) const
+  {
+    const Window window = GetWindow(pos, nFrames);
+    MaxAbsPerFrame(window.mData, mNChans, nFrames, pDest);
+  }
+
+  /** The largest absolute sample of each interleaved frame, vectorised for mono and stereo
+   * @param pSrc The interleaved frames
+   * @param nChans The number of channels per frame
+   * @param nFrames The number of frames
+   * @param pDest One value per frame */
+  static void MaxAbsPerFrame(const double* pSrc, int nChans, int nFrames, double* pDest)
+  {
+    int s = 0;
+#if defined IPLUG_SIMD_SSE2
+    const __m128d absMask = _mm_castsi128_pd(_mm_set1_epi64x(0x7FFFFFFFFFFFFFFFLL));
+    if (nChans == 1)
+    {
+      for (; s + 2 <= nFrames; s += 2)
+        _mm_storeu_pd(pDest + s, _mm_and_pd(_mm_loadu_pd(pSrc + s), absMask));
+    }
+    else if (nChans == 2)
+    {
+      for (; s + 2 <= nFrames; s += 2)
+      {
+        const __m128d f0 = _mm_and_pd(_mm_loadu_pd(pSrc + 2 * s), absMask);
+        const __m128d f1 = _mm_and_pd(_mm_loadu_pd(pSrc + 2 * s + 2), absMask);
+        _mm_storeu_pd(pDest + s, _mm_max_pd(_mm_unpacklo_pd(f0, f1), _mm_unpackhi_pd(f0, f1)));
+      }
+    }
+#elif defined IPLUG_SIMD_NEON
+    if (nChans == 1)
+    {
+      for (; s + 2 <= nFrames; s += 2)
+        vst1q_f64(pDest + s, vabsq_f64(vld1q_f64(pSrc + s)));
+    }
+    else if (nChans == 2)
+    {
+      for (; s + 2 <= nFrames; s += 2)
+      {
+        const float64x2x2_t lr = vld2q_f64(pSrc + 2 * s);
+        vst1q_f64(pDest + s, vmaxq_f64(vabsq_f64(lr.val[0]), vabsq_f64(lr.val[1])));
+      }
+    }
+#elif defined IPLUG_SIMD_WASM
+    if (nChans == 1)
+    {
+      for (; s + 2 <= nFrames; s += 2)
+        wasm_v128_store(pDest + s, wasm_f64x2_abs(wasm_v128_load(pSrc + s)));
+    }
+    else if (nChans == 2)
+    {
+      for (; s + 2 <= nFrames; s += 2)
+      {
+        const v128_t f0 = wasm_f64x2_abs(wasm_v128_load(pSrc + 2 * s));
+        const v128_t f1 = wasm_f64x2_abs(wasm_v128_load(pSrc + 2 * s + 2));
+        wasm_v128_store(pDest + s, wasm_f64x2_pmax(wasm_i64x2_shuffle(f0, f1, 0, 2), wasm_i64x2_shuffle(f0, f1, 1, 3)));
+      }
+    }
+#endif
+    for (; s < nFrames; s++)
+    {
+      const double* pFrame = pSrc + s * nChans;
+      double peak = 0.;
+
+      for (auto c = 0; c < nChans; c++)
+        peak = std::max(peak, std::fabs(pFrame[c]));
+
+      pDest[s] = peak;
+    }
+  }
+
+  /** Float version of MaxAbsPerFrame() */
+  static void MaxAbsPerFrame(const float* pSrc, int nChans, int nFrames, float* pDest)
+  {
+    int s = 0;
+#if defined IPLUG_SIMD_SSE2
+    const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+    if (nChans == 1)
+    {
+      for (; s + 4 <= nFrames; s += 4)
+        _mm_storeu_ps(pDest + s, _mm_and_ps(_mm_loadu_ps(pSrc + s), absMask));
+    }
+    else if (nChans == 2)
+    {
+      for (; s + 4 <= nFrames; s += 4)
+      {
+        const __m128 f01 = _mm_and_ps(_mm_loadu_ps(pSrc + 2 * s), absMask);
+        const __m128 f23 = _mm_and_ps(_mm_loadu_ps(pSrc + 2 * s + 4), absMask);
+        const __m128 l = _mm_shuffle_ps(f01, f23, _MM_SHUFFLE(2, 0, 2, 0));
+        const __m128 r = _mm_shuffle_ps(f01, f23, _MM_SHUFFLE(3, 1, 3, 1));
+        _mm_storeu_ps(pDest + s, _mm_max_ps(l, r));
+      }
+    }
+#elif defined IPLUG_SIMD_NEON
+    if (nChans == 1)
+    {
+      for (; s + 4 <= nFrames; s += 4)
+        vst1q_f32(pDest + s, vabsq_f32(vld1q_f32(pSrc + s)));
+    }
+    else if (nChans == 2)
+    {
+      for (; s + 4 <= nFrames; s += 4)
+      {
+        const float32x4x2_t lr = vld2q_f32(pSrc + 2 * s);
+        vst1q_f32(pDest + s, vmaxq_f32(vabsq_f32(lr.val[0]), vabsq_f32(lr.val[1])));
+      }
+    }
+#elif defined IPLUG_SIMD_WASM
+    if (nChans == 1)
+    {
+      for (; s + 4 <= nFrames; s += 4)
+        wasm_v128_store(pDest + s, wasm_f32x4_abs(wasm_v128_load(pSrc + s)));
+    }
+    else if (nChans == 2)
+    {
+      for (; s + 4 <= nFrames; s += 4)
+      {
+        const v128_t f01 = wasm_f32x4_abs(wasm_v128_load(pSrc + 2 * s));
+        const v128_t f23 = wasm_f32x4_abs(wasm_v128_load(pSrc + 2 * s + 4));
+        wasm_v128_store(pDest + s, wasm_f32x4_pmax(wasm_i32x4_shuffle(f01, f23, 0, 2, 4, 6), wasm_i32x4_shuffle(f01, f23, 1, 3, 5, 7)));
+      }
+    }
+#endif
+    for (; s < nFrames; s++)
+    {
+      const float* pFrame = pSrc + s * nChans;
+      float peak = 0.f;
+
+      for (auto c = 0; c < nChans; c++)
+        peak = std::max(peak, std::fabs(pFrame[c]));
+
+      pDest[s] = peak;
+    }
+  }
+
+private:
+  IPlugProcessor* mProcessor;
+  WDL_TypedBuf<T> mBuffer; // 2 * mCapacity frames, the second half mirroring the first
+  int mNChans = 0;
+  int mMaxLookahead = 0;
+  int mMaxBlockSize = 0;
+  int mLookahead = 0;
+  uint32_t mCapacity = 1;
+  uint32_t mWritePos = 0;
+  int mNFramesWritten = 0;
+};
+
+END_IPLUG_NAMESPACE
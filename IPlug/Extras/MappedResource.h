@@ -0,0 +1,281 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc MappedResource
+ */
+
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifdef OS_WIN
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+#ifdef IPLUG_RESOURCE_DECOMPRESS
+  #include "zlib/zlib.h"
+#endif
+
+#include "IPlugLogger.h"
+#include "IPlugPaths.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** A read-only view of a resource, such as an impulse response or a wavetable, that doesn't copy it to the heap.
+ * A file in the bundle or on disk is memory mapped, so its pages are shared by every instance and only loaded when they are touched.
+ * A Windows resource is used in place, since it is already mapped with the binary, and so is data embedded with Scripts/bin2c.py.
+ *
+ * Resources are cached for the process, so instances that load the same one share it, and it is released with the last reference.
+ * With IPLUG_RESOURCE_DECOMPRESS defined (which needs WDL's zlib), gzip data, e.g. from bin2c.py -c gzip, is inflated the first time GetData() is called
+ * and the inflated copy is also shared. Without it, compressed data is returned as it is. */
+class MappedResource
+{
+public:
+  using Ptr = std::shared_ptr<const MappedResource>;
+
+  /** Find and map a resource, or share the one that is already mapped. The arguments are as for LocateResource()
+   * @param fileNameOrResID The file name or resource ID
+   * @param type The resource type, e.g. "wav"
+   * @param bundleID The bundle ID on macOS and iOS
+   * @param pHInstance The HMODULE on Windows
+   * @param sharedResourcesSubPath The shared resources sub folder, if any
+   * @return The resource, or nullptr if it wasn't found */
+  static Ptr Load(const char* fileNameOrResID, const char* type, const char* bundleID = nullptr, void* pHInstance = nullptr, const char* sharedResourcesSubPath = nullptr)
+  {
+    WDL_String location;
+    const EResourceLocation result = LocateResource(fileNameOrResID, type, location, bundleID, pHInstance, sharedResourcesSubPath);
+
+    if (result == EResourceLocation::kNotFound)
+      return nullptr;
+
+    std::string key(location.Get());
+    key += ":";
+    key += type;
+
+    return FindOrCreate(key, [&](MappedResource& resource) {
+      if (result == EResourceLocation::kWinBinary)
+      {
+        int size = 0;
+        resource.mData = static_cast<const uint8_t*>(LoadWinResource(location.Get(), type, size, pHInstance));
+        resource.mSize = size;
+      }
+      else if (result == EResourceLocation::kAbsolutePath)
+        resource.MapFile(location.Get());
+
+      return resource.mData != nullptr;
+    });
+  }
+
+  /** Wrap data that lives as long as the process, such as a bin2c.py array, so that it is decompressed once if needed and then shared
+   * @param pData The data
+   * @param size The size in bytes
+   * @return The resource */
+  static Ptr FromMemory(const void* pData, size_t size)
+  {
+    char key[32];
+    snprintf(key, sizeof(key), "%p", pData);
+
+    return FindOrCreate(key, [&](MappedResource& resource) {
+      resource.mData = static_cast<const uint8_t*>(pData);
+      resource.mSize = size;
+      return true;
+    });
+  }
+
+  ~MappedResource()
+  {
+#ifdef OS_WIN
+    if (mMapping)
+    {
+      UnmapViewOfFile(mMapping);
+      CloseHandle(mMapHandle);
+      CloseHandle(mMapFile);
+    }
+#else
+    if (mMapping)
+      munmap(mMapping, mSize);
+#endif
+  }
+
+  MappedResource(const MappedResource&) = delete;
+  MappedResource& operator=(const MappedResource&) = delete;
+
+  /** @return The resource's data, decompressed if it is compressed and IPLUG_RESOURCE_DECOMPRESS is defined. This is thread safe, but the first call
+   * for a compressed resource inflates it, so don't make that call on the audio thread */
+  const uint8_t* GetData() const
+  {
+#ifdef IPLUG_RESOURCE_DECOMPRESS
+    if (IsCompressed())
+    {
+      std::call_once(mDecompressOnce, [this]() { Decompress(); });
+      return mDecompressed.data();
+    }
+#endif
+    return mData;
+  }
+
+  /** @return The size of GetData() in bytes */
+  size_t GetSize() const
+  {
+#ifdef IPLUG_RESOURCE_DECOMPRESS
+    if (IsCompressed())
+    {
+      std::call_once(mDecompressOnce, [this]() { Decompress(); });
+      return mDecompressed.size();
+    }
+#endif
+    return mSize;
+  }
+
+  /** @return The data as stored, which is compressed if IsCompressed() */
+  const uint8_t* GetStoredData() const { return mData; }
+  size_t GetStoredSize() const { return mSize; }
+
+  /** @return \c true if the data starts with the gzip magic number */
+  bool IsCompressed() const { return mSize > 18 && mData[0] == 0x1f && mData[1] == 0x8b; }
+
+  /** @return \c true if the data is a memory mapped file */
+  bool IsMemoryMapped() const { return mMapping != nullptr; }
+
+private:
+  MappedResource() = default;
+
+  template <class Creator>
+  static Ptr FindOrCreate(const std::string& key, Creator create)
+  {
+    static std::mutex sMutex;
+    static std::map<std::string, std::weak_ptr<const MappedResource>> sCache;
+
+    std::lock_guard<std::mutex> lock(sMutex);
+    auto it = sCache.find(key);
+
+    if (it != sCache.end())
+    {
+      if (Ptr pShared = it->second.lock())
+        return pShared;
+    }
+
+    std::shared_ptr<MappedResource> pResource(new MappedResource);
+
+    if (!create(*pResource))
+      return nullptr;
+
+    // expired entries are left in the map, they are tiny and get reused by the next load of the same resource
+    sCache[key] = pResource;
+    return pResource;
+  }
+
+  void MapFile(const char* path)
+  {
+#ifdef OS_WIN
+    wchar_t pathW[MAX_WIN32_PATH_LEN];
+    UTF8ToUTF16(pathW, path, MAX_WIN32_PATH_LEN);
+    mMapFile = CreateFileW(pathW, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (mMapFile == INVALID_HANDLE_VALUE)
+      return;
+
+    LARGE_INTEGER size;
+
+    if (GetFileSizeEx(mMapFile, &size) && size.QuadPart > 0)
+      mMapHandle = CreateFileMappingW(mMapFile, NULL, PAGE_READONLY, 0, 0, NULL);
+
+    if (mMapHandle)
+      mMapping = MapViewOfFile(mMapHandle, FILE_MAP_READ, 0, 0, 0);
+
+    if (!mMapping)
+    {
+      if (mMapHandle)
+        CloseHandle(mMapHandle);
+      CloseHandle(mMapFile);
+      return;
+    }
+
+    mSize = static_cast<size_t>(size.QuadPart);
+#else
+    const int fd = open(path, O_RDONLY);
+
+    if (fd < 0)
+      return;
+
+    struct stat info;
+
+    if (fstat(fd, &info) == 0 && info.st_size > 0)
+    {
+      void* pMapping = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_SHARED, fd, 0);
+
+      if (pMapping != MAP_FAILED)
+      {
+        mMapping = pMapping;
+        mSize = static_cast<size_t>(info.st_size);
+      }
+    }
+
+    close(fd); // the mapping keeps the file open
+#endif
+    mData = static_cast<const uint8_t*>(mMapping);
+  }
+
+#ifdef IPLUG_RESOURCE_DECOMPRESS
+  void Decompress() const
+  {
+    // the gzip trailer ends with the uncompressed size modulo 2^32
+    const uint8_t* pSize = mData + mSize - 4;
+    mDecompressed.resize(pSize[0] | (pSize[1] << 8) | (pSize[2] << 16) | (static_cast<size_t>(pSize[3]) << 24));
+
+    z_stream stream;
+    memset(&stream, 0, sizeof(stream));
+
+    if (inflateInit2(&stream, 16 + MAX_WBITS) != Z_OK) // 16 selects the gzip wrapper
+    {
+      mDecompressed.clear();
+      return;
+    }
+
+    stream.next_in = const_cast<Bytef*>(mData);
+    stream.avail_in = static_cast<uInt>(mSize);
+    stream.next_out = mDecompressed.data();
+    stream.avail_out = static_cast<uInt>(mDecompressed.size());
+
+    if (inflate(&stream, Z_FINISH) != Z_STREAM_END)
+    {
+      DBGMSG("Could not decompress the resource\n");
+      mDecompressed.clear();
+    }
+
+    inflateEnd(&stream);
+  }
+
+  mutable std::once_flag mDecompressOnce;
+  mutable std::vector<uint8_t> mDecompressed;
+#endif
+
+  const uint8_t* mData = nullptr;
+  size_t mSize = 0;
+  void* mMapping = nullptr;
+#ifdef OS_WIN
+  HANDLE mMapFile = INVALID_HANDLE_VALUE;
+  HANDLE mMapHandle = NULL;
+#endif
+};
+
+END_IPLUG_NAMESPACE
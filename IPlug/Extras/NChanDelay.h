@@ -1,71 +1,250 @@
 /*
  ==============================================================================
- 
- This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers. 
- 
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
  See LICENSE.txt for  more info.
- 
+
  ==============================================================================
 */
 
 #pragma once
 #include "IPlugPlatform.h"
+#include "IPlugUtilities.h"
+#include "IPlugAlignedBuf.h"
+#include "heapbuf.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
 
 BEGIN_IPLUG_NAMESPACE
 
-// A static delayline used to delay bypassed signals to match mLatency in AAX/VST3/AU
+/** A multi-channel delay line, used to delay bypassed signals to match mLatency in AAX/VST3/AU, with fractional, modulated reads for chorus and flangers.
+ * The channels are interleaved in one power of two sized ring, so each sample's taps for every channel are next to each other in memory,
+ * and wrapping is a mask rather than a modulo */
 template<typename T>
 class NChanDelayLine
 {
 public:
+  enum EInterpolation
+  {
+    kLinear = 0,
+    kLagrange, // 3rd order, minimum delay of 1 sample
+    kAllpass,  // 1st order, keeps the high frequencies, but only suitable for slowly changing delays
+  };
+
   NChanDelayLine(int nInputChans = 2, int nOutputChans = 2)
   : mNInChans(nInputChans)
   , mNOutChans(nOutputChans)
-  {}
+  {
+    Allocate(0);
+  }
 
+  /** Set a fixed whole number delay, for ProcessBlock() without delay times. This clears the buffer
+   * @param delayTimeSamples The delay in samples */
   void SetDelayTime(int delayTimeSamples)
   {
     mDTSamples = delayTimeSamples;
-    mBuffer.Resize(mNInChans * delayTimeSamples);
-    mWriteAddress = 0;
-    ClearBuffer();
+    Allocate(delayTimeSamples);
+  }
+
+  /** Allocate for delay times up to maxDelayTimeSamples, for ProcessBlock() with delay times. This clears the buffer
+   * @param maxDelayTimeSamples The longest delay that will be read, in samples */
+  void SetMaxDelayTime(double maxDelayTimeSamples)
+  {
+    Allocate(static_cast<int>(std::ceil(maxDelayTimeSamples)));
   }
 
+  /** Change the fixed delay without clearing the buffer, crossfading from the old delay to the new one in the ProcessBlock() calls that follow.
+   * This doesn't allocate, so it can be called on the audio thread, but the new delay must be no longer than the one allocated for by SetDelayTime() or SetMaxDelayTime()
+   * @param delayTimeSamples The new delay in samples
+   * @param nFrames The length of the crossfade in samples, 0 to switch at once */
+  void CrossfadeToDelayTime(int delayTimeSamples, int nFrames)
+  {
+    assert(delayTimeSamples <= mMaxDelay);
+    const uint32_t delay = std::min(delayTimeSamples, mMaxDelay);
+
+    if (delay == mDTSamples)
+      return;
+
+    mFadeFromDTSamples = mDTSamples;
+    mDTSamples = delay;
+    mFadeLength = std::max(nFrames, 0);
+    mFadeRemaining = mFadeLength;
+  }
+
+  /** @return \c true while a crossfade started by CrossfadeToDelayTime() is in progress */
+  bool IsCrossfading() const { return mFadeRemaining > 0; }
+
+  void SetInterpolation(EInterpolation interpolation) { mInterpolation = interpolation; }
+
   void ClearBuffer()
   {
-    memset(mBuffer.Get(), 0, mNInChans * mDTSamples * sizeof(T));
+    memset(mBuffer.Get(), 0, mBuffer.GetSize() * sizeof(T));
+    memset(mAllpassState.Get(), 0, mAllpassState.GetSize() * sizeof(T));
   }
 
+  /** Delay by the time set with SetDelayTime() or CrossfadeToDelayTime(). The inputs and outputs can be the same buffers */
   void ProcessBlock(T** inputs, T** outputs, int nFrames)
+  {
+    DispatchNChans(NChans(), [&](auto fixed) { ProcessBlockT<decltype(fixed)::value>(inputs, outputs, nFrames); });
+  }
+
+  /** Delay by a time for each sample, shared by all the channels, with the interpolation set by SetInterpolation()
+   * @param inputs The input buffers, one per channel
+   * @param outputs The output buffers, one per channel
+   * @param nFrames The number of samples per channel
+   * @param delayTimes The delay time in samples for each sample, clipped to the maximum passed to SetMaxDelayTime() */
+  void ProcessBlock(T** inputs, T** outputs, int nFrames, const T* delayTimes)
+  {
+    DispatchNChans(NChans(), [&](auto fixed) { ProcessBlockModulatedT<decltype(fixed)::value>(inputs, outputs, nFrames, delayTimes); });
+  }
+
+private:
+  /** The body of the fixed delay ProcessBlock(). NCHANS is the number of channels if it is mono or stereo, so the channel loops are unrolled, otherwise 0 */
+  template <int NCHANS>
+  void ProcessBlockT(T** inputs, T** outputs, int nFrames)
+  {
+    T* buffer = mBuffer.Get();
+    const int nChans = NCHANS ? NCHANS : NChans();
+    auto s = 0;
+
+    // equal gain, since both taps are the same signal a few samples apart
+    for (; s < nFrames && mFadeRemaining > 0; ++s, --mFadeRemaining)
+    {
+      const T fade = static_cast<T>(mFadeRemaining) / static_cast<T>(mFadeLength + 1);
+      const T* pFrom = buffer + ((mWriteAddress - mFadeFromDTSamples) & mMask) * nChans;
+      const T* pTo = buffer + ((mWriteAddress - mDTSamples) & mMask) * nChans;
+      T* pWrite = buffer + mWriteAddress * nChans;
+
+      for (auto c = 0; c < nChans; c++)
+      {
+        const T input = inputs[c][s];
+        const T from = mFadeFromDTSamples ? pFrom[c] : input;
+        const T to = mDTSamples ? pTo[c] : input;
+        outputs[c][s] = to + fade * (from - to);
+        pWrite[c] = input;
+      }
+
+      mWriteAddress = (mWriteAddress + 1) & mMask;
+    }
+
+    for (; s < nFrames; ++s)
+    {
+      const uint32_t readAddress = (mWriteAddress - mDTSamples) & mMask;
+      T* pWrite = buffer + mWriteAddress * nChans;
+      const T* pRead = buffer + readAddress * nChans;
+
+      // read before writing, so that a delay of zero is the input
+      for (auto c = 0; c < nChans; c++)
+      {
+        const T input = inputs[c][s];
+        outputs[c][s] = mDTSamples ? pRead[c] : input;
+        pWrite[c] = input;
+      }
+
+      mWriteAddress = (mWriteAddress + 1) & mMask;
+    }
+  }
+
+  /** The body of the modulated ProcessBlock(), see ProcessBlockT() */
+  template <int NCHANS>
+  void ProcessBlockModulatedT(T** inputs, T** outputs, int nFrames, const T* delayTimes)
   {
     T* buffer = mBuffer.Get();
+    T* allpassState = mAllpassState.Get();
+    const int nChans = NCHANS ? NCHANS : NChans();
+    const T minDelay = mInterpolation == kLagrange ? 1. : 0.;
+    const T maxDelay = static_cast<T>(mMaxDelay);
 
-    for (auto s = 0 ; s < nFrames; ++s)
+    for (auto s = 0; s < nFrames; ++s)
     {
-      int32_t readAddress = mWriteAddress - mDTSamples;
-      readAddress %= mDTSamples;
+      T* pWrite = buffer + mWriteAddress * nChans;
+
+      // write before reading, so that delays shorter than a sample can be read
+      for (auto c = 0; c < nChans; c++)
+        pWrite[c] = inputs[c][s];
+
+      const T delay = Clip(delayTimes[s], minDelay, maxDelay);
+      const int whole = static_cast<int>(delay);
+      const T frac = delay - whole;
+      // the taps one sample either side, ordered from newest to oldest
+      const T* p0 = buffer + ((mWriteAddress - whole) & mMask) * nChans;
+      const T* p1 = buffer + ((mWriteAddress - whole - 1) & mMask) * nChans;
 
-      for (auto c = 0; c < mNInChans; c++)
+      switch (mInterpolation)
       {
-        if (c < mNOutChans)
+        case kLinear:
         {
-          T input = inputs[c][s];
-          const int offset = c * mDTSamples;
-          outputs[c][s] = buffer[offset + readAddress];
-          buffer[offset + mWriteAddress] = input;
+          for (auto c = 0; c < nChans; c++)
+            outputs[c][s] = p0[c] + frac * (p1[c] - p0[c]);
+          break;
+        }
+        case kLagrange:
+        {
+          const T* pM1 = buffer + ((mWriteAddress - whole + 1) & mMask) * nChans;
+          const T* p2 = buffer + ((mWriteAddress - whole - 2) & mMask) * nChans;
+          const T fm1 = frac - 1., fm2 = frac - 2., fp1 = frac + 1.;
+          const T cM1 = -frac * fm1 * fm2 / 6.;
+          const T c0 = fp1 * fm1 * fm2 / 2.;
+          const T c1 = -fp1 * frac * fm2 / 2.;
+          const T c2 = fp1 * frac * fm1 / 6.;
+
+          for (auto c = 0; c < nChans; c++)
+            outputs[c][s] = cM1 * pM1[c] + c0 * p0[c] + c1 * p1[c] + c2 * p2[c];
+          break;
+        }
+        case kAllpass:
+        {
+          // (eta + z^-1) / (1 + eta z^-1) has a delay of frac at DC
+          const T eta = (1. - frac) / (1. + frac);
+
+          for (auto c = 0; c < nChans; c++)
+          {
+            const T output = eta * (p0[c] - allpassState[c]) + p1[c];
+            allpassState[c] = output;
+            outputs[c][s] = output;
+          }
+          break;
         }
       }
 
-      mWriteAddress++;
-      mWriteAddress %= mDTSamples;
+      mWriteAddress = (mWriteAddress + 1) & mMask;
     }
   }
 
-private:
-  WDL_TypedBuf<T> mBuffer;
+  int NChans() const { return static_cast<int>(std::min(mNInChans, mNOutChans)); }
+
+  void Allocate(int maxDelay)
+  {
+    // room for the Lagrange taps around the longest delay
+    uint32_t size = 1;
+
+    while (size < static_cast<uint32_t>(maxDelay) + 3)
+      size <<= 1;
+
+    mMaxDelay = maxDelay;
+    mMask = size - 1;
+    mBuffer.Resize(mNInChans * size);
+    mAllpassState.Resize(mNInChans);
+    mWriteAddress = 0;
+    mFadeRemaining = 0;
+    ClearBuffer();
+  }
+
+  IAlignedBuf<T> mBuffer;
+  WDL_TypedBuf<T> mAllpassState;
   uint32_t mNInChans, mNOutChans;
   uint32_t mWriteAddress = 0;
   uint32_t mDTSamples = 0;
+  uint32_t mFadeFromDTSamples = 0; // the delay being faded from, see CrossfadeToDelayTime()
+  int mFadeLength = 0;
+  int mFadeRemaining = 0;
+  uint32_t mMask = 0;
+  int mMaxDelay = 0;
+  EInterpolation mInterpolation = kLinear;
 } WDL_FIXALIGN;
 
 END_IPLUG_NAMESPACE
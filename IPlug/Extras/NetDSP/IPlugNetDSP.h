@@ -0,0 +1,639 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @brief Experimental offloading of a plug-in's DSP to another machine on the local network.
+ * The plug-in uses an INetDSPClient to stream its input to a headless APP build of itself running as an INetDSPNode ("MyPlugin --netdsp-node", built with APP_NETDSP_NODE),
+ * which processes it and streams the result back. Audio goes over UDP rather than the WebSocket server's TCP connections, because a retransmitted packet is already too late to play,
+ * and holding up the packets behind it would only make the jitter buffer bigger. Only audio is sent, parameters and MIDI can be sent alongside it with the OSC classes.
+ * On Windows, link ws2_32.lib
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "jnetlib/netinc.h"
+
+#include "IPlugPlatform.h"
+#include "IPlugConstants.h"
+#include "IPlugLogger.h"
+#include "IPlugSignal.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+static constexpr int kNetDSPDefaultPort = 9030;
+static constexpr uint32_t kNetDSPMagic = 0x444E5049; // "IPND"
+static constexpr uint16_t kNetDSPVersion = 1;
+static constexpr int kNetDSPMaxPacketBytes = 65000; // a little under the largest UDP datagram
+
+enum ENetDSPPacketType : uint8_t
+{
+  kNetDSPAudio = 1, // client to node, audio to process
+  kNetDSPProcessed = 2 // node to client, the processed audio
+};
+
+/** The header of every NetDSP datagram, which is followed by nChans * nFrames 32 bit floats, one channel after another.
+ * Fields are in host byte order, which is little endian on every platform iPlug2 supports */
+struct NetDSPHeader
+{
+  uint32_t magic = kNetDSPMagic;
+  uint16_t version = kNetDSPVersion;
+  uint8_t type = kNetDSPAudio;
+  uint8_t nChans = 0; // the channels of audio in this packet
+  uint8_t nReturnChans = 0; // audio packets: the channels the client wants back
+  uint8_t reserved[3] = {};
+  uint32_t session = 0; // chosen by the client each time it resets, so that the node resets the plug-in too
+  uint32_t seq = 0; // the chunk's index in the session
+  uint32_t sampleRate = 0;
+  uint16_t nFrames = 0;
+  uint16_t reserved2 = 0;
+  int32_t latency = 0; // processed packets: the latency of the node's plug-in, in samples
+};
+
+static_assert(sizeof(NetDSPHeader) == 32, "NetDSPHeader must have no padding");
+
+/** A non-blocking UDP socket, for INetDSPClient and INetDSPNode */
+class NetDSPSocket
+{
+public:
+  NetDSPSocket()
+  {
+#ifdef _WIN32
+    static const bool sSocketLibOpen = []() { WSADATA wsaData; return WSAStartup(MAKEWORD(2, 2), &wsaData) == 0; }();
+    (void) sSocketLibOpen;
+#endif
+  }
+
+  ~NetDSPSocket() { Close(); }
+
+  NetDSPSocket(const NetDSPSocket&) = delete;
+  NetDSPSocket& operator=(const NetDSPSocket&) = delete;
+
+  /** @param port The port to receive on, or 0 for any, as a client does
+   * @return \c false if the socket can't be made, or the port is in use */
+  bool Open(int port)
+  {
+    Close();
+
+    mSocket = socket(AF_INET, SOCK_DGRAM, 0);
+
+    if (mSocket == INVALID_SOCKET)
+      return false;
+
+    // room for a burst of packets whilst the receiving thread isn't scheduled
+    int bufferSize = 1 << 20;
+    setsockopt(mSocket, SOL_SOCKET, SO_RCVBUF, (char*) &bufferSize, sizeof(bufferSize));
+    setsockopt(mSocket, SOL_SOCKET, SO_SNDBUF, (char*) &bufferSize, sizeof(bufferSize));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+
+    if (bind(mSocket, (struct sockaddr*) &addr, sizeof(addr)))
+    {
+      Close();
+      return false;
+    }
+
+    SET_SOCK_BLOCK(mSocket, false);
+    return true;
+  }
+
+  void Close()
+  {
+    if (mSocket != INVALID_SOCKET)
+    {
+      closesocket(mSocket);
+      mSocket = INVALID_SOCKET;
+    }
+  }
+
+  bool IsOpen() const { return mSocket != INVALID_SOCKET; }
+
+  /** Wait until there is something to receive
+   * @return \c false if the timeout passed first */
+  bool Wait(int timeoutMs)
+  {
+    fd_set readSet;
+    FD_ZERO(&readSet);
+    FD_SET(mSocket, &readSet);
+    struct timeval timeout = { timeoutMs / 1000, (timeoutMs % 1000) * 1000 };
+    return select(static_cast<int>(mSocket) + 1, &readSet, nullptr, nullptr, &timeout) > 0;
+  }
+
+  /** @return The size of the datagram received, or 0 or less if there was none */
+  int Receive(void* pData, int size, struct sockaddr_in* pFrom = nullptr)
+  {
+    socklen_t fromLen = sizeof(struct sockaddr_in);
+    return static_cast<int>(recvfrom(mSocket, (char*) pData, size, 0, (struct sockaddr*) pFrom, pFrom ? &fromLen : nullptr));
+  }
+
+  bool Send(const void* pData, int size, const struct sockaddr_in& to)
+  {
+    return sendto(mSocket, (const char*) pData, size, 0, (const struct sockaddr*) &to, sizeof(to)) == size;
+  }
+
+  /** Look up an address
+   * @param host A dotted IPv4 address, or a host name
+   * @return \c false if the host isn't found */
+  static bool MakeAddress(const char* host, int port, struct sockaddr_in& addr)
+  {
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    addr.sin_addr.s_addr = inet_addr(host);
+
+    if (addr.sin_addr.s_addr == INADDR_NONE)
+    {
+      struct hostent* pHost = gethostbyname(host);
+
+      if (!pHost || pHost->h_addrtype != AF_INET)
+        return false;
+
+      memcpy(&addr.sin_addr, pHost->h_addr_list[0], sizeof(addr.sin_addr));
+    }
+
+    return true;
+  }
+
+private:
+  SOCKET mSocket = INVALID_SOCKET;
+};
+
+/** The plug-in's end of NetDSP offloading. ProcessBlock() splits the host's blocks into fixed size chunks, which are sent to the node as they fill, and plays the processed
+ * chunks that have come back a fixed number of chunks later, so the added latency is exactly GetLatency() whatever the network does, and a chunk that is late is heard as a
+ * dropout rather than as a shift in time. Sending and receiving happen on two threads of its own, ProcessBlock() only copies, doesn't lock, and doesn't allocate.
+ * @code
+ * void OnReset() override
+ * {
+ *   mNetDSP.Reset(GetSampleRate(), NInChansConnected(), NOutChansConnected());
+ *   SetLatency(mNetDSP.GetLatency());
+ * }
+ *
+ * void OnIdle() override
+ * {
+ *   if (mNetDSP.GetLatency() != GetLatency()) // the node's own latency has become known, or changed
+ *     SetLatency(mNetDSP.GetLatency());
+ * }
+ *
+ * void ProcessBlock(sample** inputs, sample** outputs, int nFrames) override
+ * {
+ *   mNetDSP.ProcessBlock(inputs, outputs, nFrames);
+ * }
+ * @endcode */
+class INetDSPClient
+{
+  static constexpr int kNumSlots = 64;
+
+public:
+  INetDSPClient()
+  {
+    for (auto& stamp : mReceiveStamps)
+      stamp.store(-1, std::memory_order_relaxed);
+  }
+
+  ~INetDSPClient() { Disconnect(); }
+
+  INetDSPClient(const INetDSPClient&) = delete;
+  INetDSPClient& operator=(const INetDSPClient&) = delete;
+
+  /** Start streaming to a node. Call this on the main thread
+   * @param host The node's address or host name
+   * @param port The port the node is listening on
+   * @return \c false if the host isn't found, or a socket can't be opened */
+  bool Connect(const char* host, int port = kNetDSPDefaultPort)
+  {
+    Disconnect();
+
+    if (!NetDSPSocket::MakeAddress(host, port, mNodeAddress) || !mSocket.Open(0))
+      return false;
+
+    mRunning = true;
+    mSendThread = std::thread(&INetDSPClient::RunSendThread, this);
+    mReceiveThread = std::thread(&INetDSPClient::RunReceiveThread, this);
+    return true;
+  }
+
+  /** Stop streaming. ProcessBlock() outputs silence until Connect() is called again */
+  void Disconnect()
+  {
+    mRunning = false;
+    mSendSignal.Notify();
+
+    if (mSendThread.joinable())
+      mSendThread.join();
+
+    if (mReceiveThread.joinable())
+      mReceiveThread.join();
+
+    mSocket.Close();
+  }
+
+  /** Set the format and allocate, from the plug-in's OnReset(). This starts a new session, so the node resets its plug-in too
+   * @param sampleRate The sample rate
+   * @param nInputs The number of channels to send
+   * @param nOutputs The number of channels to receive
+   * @param chunkSize The number of frames in each packet, the node processes in blocks of this size. Smaller is less latency, but more packets
+   * @param jitterChunks How many chunks later the processed audio is played, which has to cover the round trip and the node's processing time, at least 2 */
+  void Reset(double sampleRate, int nInputs, int nOutputs, int chunkSize = 128, int jitterChunks = 3)
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    mSampleRate = sampleRate;
+    mNInputs = Clip(nInputs, 0, 255);
+    mNOutputs = Clip(nOutputs, 0, 255);
+    mJitterChunks = Clip(jitterChunks, 2, kNumSlots / 2);
+
+    // both directions have to fit in one datagram
+    const int maxChans = std::max(std::max(mNInputs, mNOutputs), 1);
+    mChunkSize = Clip(chunkSize, 16, static_cast<int>((kNetDSPMaxPacketBytes - sizeof(NetDSPHeader)) / (maxChans * sizeof(float))));
+
+    mSendPacketBytes = static_cast<int>(sizeof(NetDSPHeader) + mNInputs * mChunkSize * sizeof(float));
+    mSendPackets.assign(static_cast<size_t>(kNumSlots) * mSendPacketBytes, 0);
+    mReceiveChunks.assign(static_cast<size_t>(kNumSlots) * mNOutputs * mChunkSize, 0.f);
+    mPlayChunk.assign(static_cast<size_t>(mNOutputs) * mChunkSize, 0.f);
+    mReceiveBuffer.assign(kNetDSPMaxPacketBytes, 0);
+
+    for (auto& stamp : mReceiveStamps)
+      stamp.store(-1, std::memory_order_relaxed);
+
+    mSession = static_cast<uint32_t>(std::chrono::steady_clock::now().time_since_epoch().count()) ^ (mSession * 2654435761u) ^ 1u;
+    mChunkSeq = 0;
+    mChunkPos = 0;
+    mSendWritten.store(0, std::memory_order_release);
+    mSent = 0;
+    mNodeLatency.store(0, std::memory_order_relaxed);
+  }
+
+  /** Send the input to the node, and output what it has sent back, from the plug-in's ProcessBlock()
+   * @param inputs The input, which may be nullptr if there are no inputs
+   * @param outputs The output, which may be the same buffers as the input */
+  void ProcessBlock(sample** inputs, sample** outputs, int nFrames)
+  {
+    if (!mChunkSize)
+    {
+      for (int c = 0; c < mNOutputs; c++)
+        memset(outputs[c], 0, nFrames * sizeof(sample));
+
+      return;
+    }
+
+    for (int done = 0; done < nFrames;)
+    {
+      if (mChunkPos == 0)
+        BeginChunk();
+
+      const int n = std::min(nFrames - done, mChunkSize - mChunkPos);
+      float* pSend = reinterpret_cast<float*>(SendPacket(mChunkSeq) + sizeof(NetDSPHeader));
+
+      // the input is read before the output is written, in case they are the same buffers
+      for (int c = 0; c < mNInputs; c++)
+      {
+        float* pDest = pSend + c * mChunkSize + mChunkPos;
+
+        for (int s = 0; s < n; s++)
+          pDest[s] = static_cast<float>(inputs[c][done + s]);
+      }
+
+      for (int c = 0; c < mNOutputs; c++)
+      {
+        const float* pSrc = mPlayChunk.data() + c * mChunkSize + mChunkPos;
+
+        for (int s = 0; s < n; s++)
+          outputs[c][done + s] = static_cast<sample>(pSrc[s]);
+      }
+
+      done += n;
+      mChunkPos += n;
+
+      if (mChunkPos == mChunkSize)
+      {
+        mChunkSeq++;
+        mChunkPos = 0;
+        mSendWritten.store(mChunkSeq, std::memory_order_release);
+        mSendSignal.Notify();
+      }
+    }
+  }
+
+  /** @return The latency to report with SetLatency(), the jitter buffer plus the node's plug-in latency, in samples */
+  int GetLatency() const { return mJitterChunks * mChunkSize + mNodeLatency.load(std::memory_order_relaxed); }
+
+  /** @return The number of chunks that hadn't arrived in time to be played, since the last Reset() */
+  int GetNumLateChunks() const { return mNumLateChunks.load(std::memory_order_relaxed); }
+
+  /** @return \c true if the node has sent something back in the last second */
+  bool GetNodeIsResponding() const
+  {
+    const int64_t last = mLastReceiveMs.load(std::memory_order_relaxed);
+    return last && NowMs() - last < 1000;
+  }
+
+private:
+  static int Clip(int x, int lo, int hi) { return std::min(std::max(x, lo), hi); }
+
+  static int64_t NowMs()
+  {
+    using namespace std::chrono;
+    return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+  }
+
+  char* SendPacket(int64_t seq) { return mSendPackets.data() + (seq % kNumSlots) * mSendPacketBytes; }
+
+  // write the next packet's header, and take the chunk to play from the jitter buffer
+  void BeginChunk()
+  {
+    NetDSPHeader header;
+    header.type = kNetDSPAudio;
+    header.nChans = static_cast<uint8_t>(mNInputs);
+    header.nReturnChans = static_cast<uint8_t>(mNOutputs);
+    header.session = mSession;
+    header.seq = static_cast<uint32_t>(mChunkSeq);
+    header.sampleRate = static_cast<uint32_t>(mSampleRate);
+    header.nFrames = static_cast<uint16_t>(mChunkSize);
+    memcpy(SendPacket(mChunkSeq), &header, sizeof(header));
+
+    const int64_t playSeq = mChunkSeq - mJitterChunks;
+    bool received = false;
+
+    if (playSeq >= 0)
+    {
+      std::atomic<int64_t>& stamp = mReceiveStamps[playSeq % kNumSlots];
+
+      // the receiving thread marks the slot while it writes, so a copy that overlapped a write is discarded
+      if (stamp.load(std::memory_order_acquire) == playSeq)
+      {
+        memcpy(mPlayChunk.data(), ReceiveChunk(playSeq), mPlayChunk.size() * sizeof(float));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        received = stamp.load(std::memory_order_relaxed) == playSeq;
+      }
+
+      if (!received)
+        mNumLateChunks.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    if (!received)
+      std::fill(mPlayChunk.begin(), mPlayChunk.end(), 0.f);
+  }
+
+  float* ReceiveChunk(int64_t seq) { return mReceiveChunks.data() + (seq % kNumSlots) * mNOutputs * mChunkSize; }
+
+  void RunSendThread()
+  {
+    while (mRunning)
+    {
+      mSendSignal.Wait(50.);
+
+      std::lock_guard<std::mutex> lock(mMutex);
+      const int64_t written = mSendWritten.load(std::memory_order_acquire);
+
+      // ProcessBlock() reuses slots, so if this has fallen far behind, only the latest chunk is still worth sending
+      if (written - mSent > kNumSlots / 2)
+        mSent = written - 1;
+
+      for (; mSent < written; mSent++)
+        mSocket.Send(SendPacket(mSent), mSendPacketBytes, mNodeAddress);
+    }
+  }
+
+  void RunReceiveThread()
+  {
+    while (mRunning)
+    {
+      if (!mSocket.Wait(50))
+        continue;
+
+      std::lock_guard<std::mutex> lock(mMutex);
+      int size;
+
+      while (!mReceiveBuffer.empty() && (size = mSocket.Receive(mReceiveBuffer.data(), static_cast<int>(mReceiveBuffer.size()))) > 0)
+        HandlePacket(size);
+    }
+  }
+
+  void HandlePacket(int size)
+  {
+    NetDSPHeader header;
+
+    if (size < static_cast<int>(sizeof(header)))
+      return;
+
+    memcpy(&header, mReceiveBuffer.data(), sizeof(header));
+
+    if (header.magic != kNetDSPMagic || header.version != kNetDSPVersion || header.type != kNetDSPProcessed || header.session != mSession
+        || header.nChans != mNOutputs || header.nFrames != mChunkSize || size != static_cast<int>(sizeof(header) + mNOutputs * mChunkSize * sizeof(float)))
+      return;
+
+    const int64_t seq = header.seq;
+    const int64_t written = mSendWritten.load(std::memory_order_acquire);
+
+    // too late to be played, or so early that it would overwrite a chunk that is still to be played
+    if (seq < written - mJitterChunks || seq >= written + kNumSlots / 2)
+      return;
+
+    std::atomic<int64_t>& stamp = mReceiveStamps[seq % kNumSlots];
+    stamp.store(-1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(ReceiveChunk(seq), mReceiveBuffer.data() + sizeof(header), mNOutputs * mChunkSize * sizeof(float));
+    stamp.store(seq, std::memory_order_release);
+
+    mNodeLatency.store(header.latency, std::memory_order_relaxed);
+    mLastReceiveMs.store(NowMs(), std::memory_order_relaxed);
+  }
+
+  NetDSPSocket mSocket;
+  struct sockaddr_in mNodeAddress = {};
+  std::thread mSendThread;
+  std::thread mReceiveThread;
+  std::atomic<bool> mRunning {false};
+  IPlugSignal mSendSignal;
+  std::mutex mMutex; // held by Reset() and the network threads, never by ProcessBlock()
+
+  double mSampleRate = 44100.;
+  int mNInputs = 0;
+  int mNOutputs = 0;
+  int mChunkSize = 0;
+  int mJitterChunks = 3;
+  uint32_t mSession = 0;
+
+  // written by ProcessBlock()
+  int64_t mChunkSeq = 0;
+  int mChunkPos = 0;
+  std::vector<float> mPlayChunk;
+  std::vector<char> mSendPackets;
+  int mSendPacketBytes = 0;
+  std::atomic<int64_t> mSendWritten {0};
+
+  // the send thread's
+  int64_t mSent = 0;
+
+  // written by the receive thread
+  std::vector<float> mReceiveChunks;
+  std::atomic<int64_t> mReceiveStamps[kNumSlots];
+  std::vector<char> mReceiveBuffer;
+  std::atomic<int> mNodeLatency {0};
+  std::atomic<int> mNumLateChunks {0};
+  std::atomic<int64_t> mLastReceiveMs {0};
+};
+
+/** The processing end of NetDSP offloading, which a headless APP runs with IPlugAPPHost::RunNetDSPNode(). It processes each chunk as it arrives and sends it straight back,
+ * on the thread that calls Run(), which is the node's audio thread. It serves one client at a time, a new session from any client resets it */
+class INetDSPNode
+{
+public:
+  /** Called when a session starts, to reset the plug-in for the client's sample rate and chunk size */
+  using ResetFunc = std::function<void(double sampleRate, int chunkSize)>;
+
+  /** Called for each chunk, to process it
+   * @return The plug-in's latency in samples */
+  using ProcessFunc = std::function<int(double** inputs, double** outputs, int nFrames)>;
+
+  /** @param nInputs The plug-in's number of inputs, what the client sends is zero padded or truncated to this
+   * @param nOutputs The plug-in's number of outputs */
+  INetDSPNode(int nInputs, int nOutputs, ResetFunc resetFunc, ProcessFunc processFunc)
+  : mNInputs(nInputs)
+  , mNOutputs(nOutputs)
+  , mResetFunc(resetFunc)
+  , mProcessFunc(processFunc)
+  {
+    mReceiveBuffer.assign(kNetDSPMaxPacketBytes, 0);
+    mSendBuffer.assign(kNetDSPMaxPacketBytes, 0);
+  }
+
+  /** @return \c false if the port can't be opened */
+  bool Open(int port = kNetDSPDefaultPort) { return mSocket.Open(port); }
+
+  /** Serve clients until Stop() is called from another thread */
+  void Run()
+  {
+    mRunning = true;
+
+    while (mRunning)
+    {
+      if (!mSocket.Wait(50))
+        continue;
+
+      struct sockaddr_in from;
+      int size;
+
+      while ((size = mSocket.Receive(mReceiveBuffer.data(), static_cast<int>(mReceiveBuffer.size()), &from)) > 0)
+        HandlePacket(size, from);
+    }
+  }
+
+  void Stop() { mRunning = false; }
+
+private:
+  void HandlePacket(int size, const struct sockaddr_in& from)
+  {
+    NetDSPHeader header;
+
+    if (size < static_cast<int>(sizeof(header)))
+      return;
+
+    memcpy(&header, mReceiveBuffer.data(), sizeof(header));
+
+    if (header.magic != kNetDSPMagic || header.version != kNetDSPVersion || header.type != kNetDSPAudio || !header.nFrames || !header.sampleRate
+        || size != static_cast<int>(sizeof(header) + header.nChans * header.nFrames * sizeof(float))
+        || sizeof(header) + header.nReturnChans * header.nFrames * sizeof(float) > kNetDSPMaxPacketBytes)
+      return;
+
+    if (header.session != mSession || header.nFrames != mChunkSize || header.sampleRate != mSampleRate)
+    {
+      mSession = header.session;
+      mChunkSize = header.nFrames;
+      mSampleRate = header.sampleRate;
+      mNextSeq = 0;
+
+      mInputs.assign(static_cast<size_t>(mNInputs) * mChunkSize, 0.);
+      mOutputs.assign(static_cast<size_t>(mNOutputs) * mChunkSize, 0.);
+      mInputPtrs.resize(mNInputs);
+      mOutputPtrs.resize(mNOutputs);
+
+      for (int c = 0; c < mNInputs; c++)
+        mInputPtrs[c] = mInputs.data() + c * mChunkSize;
+
+      for (int c = 0; c < mNOutputs; c++)
+        mOutputPtrs[c] = mOutputs.data() + c * mChunkSize;
+
+      mResetFunc(mSampleRate, mChunkSize);
+      DBGMSG("NetDSP session %u, %u Hz, %i frame chunks\n", mSession, mSampleRate, mChunkSize);
+    }
+
+    // a chunk that arrives after a later one is dropped, processing it would take the plug-in back in time. Lost chunks just leave a gap
+    if (header.seq < mNextSeq)
+      return;
+
+    mNextSeq = header.seq + 1;
+
+    const float* pIn = reinterpret_cast<const float*>(mReceiveBuffer.data() + sizeof(header));
+
+    for (int c = 0; c < mNInputs; c++)
+    {
+      double* pDest = mInputPtrs[c];
+
+      for (int s = 0; s < mChunkSize; s++)
+        pDest[s] = c < header.nChans ? pIn[c * mChunkSize + s] : 0.;
+    }
+
+    const int latency = mProcessFunc(mInputPtrs.data(), mOutputPtrs.data(), mChunkSize);
+
+    NetDSPHeader reply = header;
+    reply.type = kNetDSPProcessed;
+    reply.nChans = header.nReturnChans;
+    reply.nReturnChans = 0;
+    reply.latency = latency;
+    memcpy(mSendBuffer.data(), &reply, sizeof(reply));
+
+    float* pOut = reinterpret_cast<float*>(mSendBuffer.data() + sizeof(reply));
+
+    for (int c = 0; c < reply.nChans; c++)
+    {
+      for (int s = 0; s < mChunkSize; s++)
+        pOut[c * mChunkSize + s] = c < mNOutputs ? static_cast<float>(mOutputPtrs[c][s]) : 0.f;
+    }
+
+    mSocket.Send(mSendBuffer.data(), static_cast<int>(sizeof(reply) + reply.nChans * mChunkSize * sizeof(float)), from);
+  }
+
+  NetDSPSocket mSocket;
+  std::atomic<bool> mRunning {false};
+  const int mNInputs;
+  const int mNOutputs;
+  ResetFunc mResetFunc;
+  ProcessFunc mProcessFunc;
+
+  uint32_t mSession = 0;
+  uint32_t mSampleRate = 0;
+  int mChunkSize = 0;
+  uint32_t mNextSeq = 0;
+
+  std::vector<char> mReceiveBuffer;
+  std::vector<char> mSendBuffer;
+  std::vector<double> mInputs;
+  std::vector<double> mOutputs;
+  std::vector<double*> mInputPtrs;
+  std::vector<double*> mOutputPtrs;
+};
+
+END_IPLUG_NAMESPACE
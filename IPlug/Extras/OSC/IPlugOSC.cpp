@@ -228,13 +228,31 @@ void OSCInterface::OnTimer(Timer& timer)
   for (auto i = 0; i < nDevices; i++)
   {
     auto* pDev = gDevices.Get(i);
-    if (pDev->mHasInput)
+    if (pDev->mHasInput && !pDev->mHasInputThread)
       pDev->RunInput();
   }
 
+  ForEachIncomingMessage([this](char* pMsg, int size) {
+    OscMessageRead rmsg(pMsg, size);
+
+    const char* mstr = rmsg.GetMessage();
+    if (mstr && *mstr)
+      OnOSCMessage(rmsg);
+  });
+
+  for (auto i = 0; i < nDevices; i++)
+  {
+    auto* pDev = gDevices.Get(i);
+    if (pDev->mHasOutput)
+      pDev->RunOutput();  // send queued messages
+  }
+}
+
+void OSCInterface::ForEachIncomingMessage(const std::function<void(char* pMsg, int size)>& func)
+{
   if (mIncomingEvents.GetSize())
   {
-    static WDL_HeapBuf tmp;
+    WDL_HeapBuf& tmp = mIncomingEventsCopy;
 
     mIncomingEvents_mutex.Enter();
     tmp.CopyFrom(&mIncomingEvents, false);
@@ -264,11 +282,7 @@ void OSCInterface::OnTimer(Timer& timer)
 
       while (rd_pos + rd_sz <= evt->sz && rd_sz >= 0)
       {
-        OscMessageRead rmsg((char*)evt->msg + rd_pos, rd_sz);
-
-        const char* mstr = rmsg.GetMessage();
-        if (mstr && *mstr)
-          OnOSCMessage(rmsg);
+        func((char*)evt->msg + rd_pos, rd_sz);
 
         rd_pos += rd_sz + 4;
         if (rd_pos >= evt->sz) break;
@@ -278,13 +292,6 @@ void OSCInterface::OnTimer(Timer& timer)
       }
     }
   }
-
-  for (auto i = 0; i < nDevices; i++)
-  {
-    auto* pDev = gDevices.Get(i);
-    if (pDev->mHasOutput)
-      pDev->RunOutput();  // send queued messages
-  }
 }
 
 OSCInterface::OSCInterface(OSCLogFunc logFunc)
@@ -439,6 +446,15 @@ void OSCSender::SetDestination(const char* ip, int port)
   }
 }
 
+void OSCSender::SetBundling(int maxPacketSize, int sendSleepMs)
+{
+  if (mDevice)
+  {
+    mDevice->mMaxMacketSize = std::max(maxPacketSize, MAX_OSC_MSG_LEN + 24); // there must be room for a message in its bundle
+    mDevice->mSendSleep = std::max(sendSleepMs, 0);
+  }
+}
+
 void OSCSender::SendOSCMessage(OscMessageWrite& msg)
 {
   int len;
@@ -452,10 +468,18 @@ OSCReceiver::OSCReceiver(int port, OSCLogFunc logFunc)
   SetReceivePort(port);
 }
 
+OSCReceiver::~OSCReceiver()
+{
+  StopNetworkThread();
+}
+
 void OSCReceiver::SetReceivePort(int port)
 {
   if (port != mPort)
   {
+    const bool useThread = mNetworkThreadRunning;
+    StopNetworkThread();
+
     if (mDevice != nullptr)
     {
       gDevices.DeletePtr(mDevice, true);
@@ -467,5 +491,88 @@ void OSCReceiver::SetReceivePort(int port)
     
     if(mLogFunc)
       mLogFunc(log);
+
+    if (useThread)
+      StartNetworkThread();
+  }
+}
+
+void OSCReceiver::SetUseNetworkThread(bool enable, int queueSize)
+{
+  StopNetworkThread();
+
+  if (enable)
+  {
+    mQueue = std::make_unique<IPlugQueue<QueuedMessage>>(queueSize);
+    StartNetworkThread();
+  }
+}
+
+int OSCReceiver::ProcessOSCQueue()
+{
+  int count = 0;
+
+  while (mQueue && mQueue->Pop(mPoppedMessage))
+  {
+    OscMessageRead rmsg(mPoppedMessage.mData, mPoppedMessage.mSize);
+
+    const char* mstr = rmsg.GetMessage();
+    if (mstr && *mstr)
+      OnOSCMessage(rmsg);
+
+    count++;
+  }
+
+  return count;
+}
+
+void OSCReceiver::StartNetworkThread()
+{
+  if (!mDevice || mDevice->mSendSocket == INVALID_SOCKET || !mQueue)
+    return;
+
+  mDevice->mHasInputThread = true;
+  mNetworkThreadRunning = true;
+  mNetworkThread = std::thread(&OSCReceiver::RunNetworkThread, this);
+}
+
+void OSCReceiver::StopNetworkThread()
+{
+  mNetworkThreadRunning = false;
+
+  if (mNetworkThread.joinable())
+    mNetworkThread.join();
+
+  if (mDevice)
+    mDevice->mHasInputThread = false;
+}
+
+void OSCReceiver::RunNetworkThread()
+{
+  const SOCKET s = mDevice->mSendSocket;
+
+  while (mNetworkThreadRunning)
+  {
+    fd_set readSet;
+    FD_ZERO(&readSet);
+    FD_SET(s, &readSet);
+
+    // the timeout is only so that the thread notices when it should stop
+    struct timeval timeout = { 0, 50000 };
+
+    if (select(static_cast<int>(s) + 1, &readSet, nullptr, nullptr, &timeout) > 0)
+    {
+      mDevice->RunInput();
+
+      ForEachIncomingMessage([this](char* pMsg, int size) {
+        if (size > 0 && size <= MAX_OSC_MSG_LEN)
+        {
+          QueuedMessage& msg = mReadMessage;
+          msg.mSize = size;
+          memcpy(msg.mData, pMsg, size);
+          mQueue->Push(msg);
+        }
+      });
+    }
   }
 }
@@ -17,16 +17,19 @@
  *
  */
 
+#include <atomic>
 #include <cstring>
 #include <ctime>
 #include <functional>
 #include <memory>
+#include <thread>
 
 #include "jnetlib/jnetlib.h"
 
 #include "IPlugPlatform.h"
 #include "IPlugLogger.h"
 #include "IPlugOSC_msg.h"
+#include "IPlugQueue.h"
 #include "IPlugTimer.h"
 
 
@@ -84,6 +87,7 @@ public:
   double mLastOpenTime = 0;
   bool mHasInput = false;
   bool mHasOutput = false;
+  std::atomic<bool> mHasInputThread {false}; // if true, an OSCReceiver's network thread calls RunInput() rather than the timer
   
   SOCKET mSendSocket;
   int mMaxMacketSize, mSendSleep;
@@ -138,6 +142,13 @@ private:
   static void MessageCallback(void *d1, int dev_idx, int msglen, void *msg);
 
   void OnTimer(Timer& timer);
+
+protected:
+  /** Take the messages that have been received for this interface, splitting bundles
+   * @param func Called with each message, whose buffer is only valid during the call */
+  void ForEachIncomingMessage(const std::function<void(char* pMsg, int size)>& func);
+
+private:
   
   // these are non-owned refs
   WDL_PtrList<OSCDevice> mDevices;
@@ -147,6 +158,7 @@ protected:
   static std::unique_ptr<Timer> mTimer;
   static int sInstances;
   WDL_HeapBuf mIncomingEvents;  // incomingEvent list, each is 8-byte aligned
+  WDL_HeapBuf mIncomingEventsCopy;
   WDL_Mutex mIncomingEvents_mutex;
 };
 
@@ -168,6 +180,12 @@ public:
   /**
    * @param msg */
   void SendOSCMessage(OscMessageWrite& msg);
+
+  /** Messages sent in one timer tick are packed into #bundle packets. Set how big those packets are, and the pause between them.
+   * The defaults are conservative, a bigger packet size means far fewer packets when sending a lot of messages, e.g. every parameter
+   * @param maxPacketSize The largest packet in bytes. 1472 fits in one ethernet frame, larger packets are fragmented by the network but are fine locally
+   * @param sendSleepMs How long to sleep between packets, in milliseconds, in case the receiver can't keep up, or 0 */
+  void SetBundling(int maxPacketSize, int sendSleepMs);
 private:
   int mPort = 0;
   WDL_String mDestIP;
@@ -181,18 +199,45 @@ public:
    * @param port 
    * @param logFunc */
   OSCReceiver(int port = 8000, OSCLogFunc logFunc = nullptr);
+
+  virtual ~OSCReceiver();
   
   /** Set the Receive Port object
    * @param port */
   void SetReceivePort(int port);
+
+  /** Receive on a dedicated thread that waits on the socket, rather than polling it every OSC_TIMER_RATE ms on the main thread, for low latency control.
+   * Messages are then queued, and OnOSCMessage() is called by ProcessOSCQueue() on whichever thread calls it, such as the audio thread
+   * @param enable \c true to start the thread, \c false to go back to the timer
+   * @param queueSize The number of messages that can wait for ProcessOSCQueue(), more are dropped */
+  void SetUseNetworkThread(bool enable, int queueSize = 256);
+
+  /** Call OnOSCMessage() for each message queued by the network thread, see SetUseNetworkThread(). This doesn't allocate or lock, so it can be called from the audio thread
+   * @return The number of messages */
+  int ProcessOSCQueue();
   
   /** \todo */
   virtual void OnOSCMessage(OscMessageRead& msg) = 0;
   
 private:
+  struct QueuedMessage
+  {
+    int mSize = 0;
+    char mData[MAX_OSC_MSG_LEN];
+  };
+
+  void StartNetworkThread();
+  void StopNetworkThread();
+  void RunNetworkThread();
+
   OSCDevice* mDevice = nullptr;
   int mPort = 0;
   char mReadBuf[MAX_OSC_MSG_LEN] = {};
+  std::unique_ptr<IPlugQueue<QueuedMessage>> mQueue;
+  std::thread mNetworkThread;
+  std::atomic<bool> mNetworkThreadRunning {false};
+  QueuedMessage mPoppedMessage;
+  QueuedMessage mReadMessage;
 };
 
 
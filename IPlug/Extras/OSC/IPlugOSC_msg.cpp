@@ -15,6 +15,7 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <ctype.h>
 #include "IPlugOSC_msg.h"
 
 using namespace iplug;
@@ -385,3 +386,98 @@ void OscMessageWrite::DebugDump(const char* label, char* dump, int dumplen)
     rmsg.DebugDump(label, dump, dumplen);    
   }
 }
+
+// OSCDispatcher
+
+uint32_t OSCDispatcher::Hash(const char* str, size_t len)
+{
+  // FNV-1a
+  uint32_t hash = 2166136261u;
+
+  for (size_t i = 0; i < len; i++)
+    hash = (hash ^ static_cast<uint8_t>(str[i])) * 16777619u;
+
+  return hash;
+}
+
+const OSCDispatcher::Entry* OSCDispatcher::Find(const char* pattern, size_t len) const
+{
+  auto it = mEntries.find(Hash(pattern, len));
+
+  if (it == mEntries.end())
+    return nullptr;
+
+  for (const auto& entry : it->second)
+  {
+    if (entry.mPattern.size() == len && !memcmp(entry.mPattern.data(), pattern, len))
+      return &entry;
+  }
+
+  return nullptr;
+}
+
+void OSCDispatcher::AddHandler(const char* pattern, Handler handler)
+{
+  RemoveHandler(pattern);
+  mEntries[Hash(pattern, strlen(pattern))].push_back(Entry { pattern, handler });
+}
+
+void OSCDispatcher::RemoveHandler(const char* pattern)
+{
+  auto it = mEntries.find(Hash(pattern, strlen(pattern)));
+
+  if (it == mEntries.end())
+    return;
+
+  auto& entries = it->second;
+
+  for (auto e = entries.begin(); e != entries.end(); ++e)
+  {
+    if (e->mPattern == pattern)
+    {
+      entries.erase(e);
+      break;
+    }
+  }
+}
+
+bool OSCDispatcher::Dispatch(OscMessageRead& msg) const
+{
+  const char* address = msg.GetMessage();
+  const size_t len = strlen(address);
+
+  if (const Entry* pEntry = Find(address, len))
+  {
+    pEntry->mHandler(msg, -1);
+    return true;
+  }
+
+  // an integer after the last slash can match a pattern ending in "/#"
+  const char* pLastSlash = strrchr(address, '/');
+
+  if (!pLastSlash || !isdigit(static_cast<unsigned char>(pLastSlash[1])))
+    return false;
+
+  char* pEnd = nullptr;
+  const long index = strtol(pLastSlash + 1, &pEnd, 10);
+
+  if (*pEnd || index > INT32_MAX)
+    return false;
+
+  const size_t prefixLen = pLastSlash - address + 1;
+  char pattern[MAX_OSC_MSG_LEN];
+
+  if (prefixLen + 2 > sizeof(pattern))
+    return false;
+
+  memcpy(pattern, address, prefixLen);
+  pattern[prefixLen] = '#';
+
+  if (const Entry* pEntry = Find(pattern, prefixLen + 1))
+  {
+    pEntry->mHandler(msg, static_cast<int>(index));
+    return true;
+  }
+
+  return false;
+}
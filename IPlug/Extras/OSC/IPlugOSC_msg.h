@@ -19,6 +19,12 @@
 
 #include "IPlugPlatform.h"
 
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
 BEGIN_IPLUG_NAMESPACE
 
 #define MAX_OSC_MSG_LEN 1024
@@ -81,4 +87,41 @@ private:
   bool m_msgok;
 };
 
+/** A table of handlers for incoming messages, looked up by a hash of the address rather than comparing it with every address a plug-in understands.
+ * Call Dispatch() from OnOSCMessage(). Patterns are either an address such as "/transport/play", or one ending in "/#", such as "/param/#",
+ * which matches any non-negative integer in that place, e.g. "/param/42", and passes the integer to the handler */
+class OSCDispatcher
+{
+public:
+  /** @param msg The message, to pop arguments from
+   * @param index The integer matched by a pattern ending in "/#", otherwise -1 */
+  using Handler = std::function<void(OscMessageRead& msg, int index)>;
+
+  /** Add a handler, replacing any with the same pattern
+   * @param pattern The address pattern, see OSCDispatcher
+   * @param handler Called for messages that match */
+  void AddHandler(const char* pattern, Handler handler);
+
+  /** Remove a handler
+   * @param pattern The pattern it was added with */
+  void RemoveHandler(const char* pattern);
+
+  /** Call the handler that matches a message's address. This only allocates if a handler does
+   * @param msg The message
+   * @return \c true if a handler was called */
+  bool Dispatch(OscMessageRead& msg) const;
+
+private:
+  struct Entry
+  {
+    std::string mPattern;
+    Handler mHandler;
+  };
+
+  static uint32_t Hash(const char* str, size_t len);
+  const Entry* Find(const char* pattern, size_t len) const;
+
+  std::unordered_map<uint32_t, std::vector<Entry>> mEntries;
+};
+
 END_IPLUG_NAMESPACE
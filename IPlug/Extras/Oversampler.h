@@ -12,16 +12,24 @@
 
 #define OVERSAMPLING_FACTORS_VA_LIST "None", "2x", "4x", "8x", "16x"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <functional>
 #include <cmath>
 
 #include "HIIR/FPUUpsampler2x.h"
 #include "HIIR/FPUDownsampler2x.h"
+#include "HIIR/Upsampler2x4.h"
+#include "HIIR/Downsampler2x4.h"
+#include "HalfBandFIR.h"
 
 #include "heapbuf.h"
 #include "ptrlist.h"
 
 #include "IPlugPlatform.h"
+#include "IPlugAlignedBuf.h"
+#include "IPlugUtilities.h"
 
 BEGIN_IPLUG_NAMESPACE
 
@@ -37,16 +45,33 @@ enum EFactor
   kNumFactors
 };
 
+enum EOverSamplingMode
+{
+  kMinimumLatency = 0, // polyphase IIR, which is not linear phase, but has a group delay of only a few samples
+  kLinearPhase         // half-band FIR, with a latency that depends on the factor, see OverSampler::GetLatency()
+};
+
+/** Up-samples, processes and down-samples audio by a factor of 2, 4, 8 or 16, with cascades of half-band filters.
+ * ProcessBlock() filters four channels at once with channel interleaved stages, which use SSE2 or NEON where available.
+ * In kMinimumLatency mode the stages are HIIR polyphase IIR filters, in kLinearPhase mode ProcessBlock() uses half-band FIR filters instead.
+ * Process() and ProcessGen() process a single channel, one sample at a time, and always use the IIR filters.
+ * The latency should be reported to the host with IPlugProcessor::SetLatency(), see SetLatencyChangedFunc().
+ * By default changing the factor resets the filters, which clicks if it is done while processing, see SetFactorFadeLength() to change it during playback */
 template<typename T = double>
 class OverSampler
 {
 public:
   using BlockProcessFunc = std::function<void(T**, T**, int)>;
+  using LatencyChangedFunc = std::function<void(int latency)>;
+  
+  static constexpr int kNumGroupChannels = 4;
+  static constexpr int kNumStages = kNumFactors - 1;
   
-  OverSampler(EFactor factor = kNone, bool blockProcessing = true, int nInChannels = 1, int nOutChannels = 1)
+  OverSampler(EFactor factor = kNone, bool blockProcessing = true, int nInChannels = 1, int nOutChannels = 1, EOverSamplingMode mode = kMinimumLatency)
   : mBlockProcessing(blockProcessing)
   , mNInChannels(nInChannels)
   , mNOutChannels(nOutChannels)
+  , mMode(mode)
   {
     
     static constexpr double coeffs2x[12] = { 0.036681502163648017, 0.13654762463195794, 0.27463175937945444, 0.42313861743656711, 0.56109869787919531, 0.67754004997416184, 0.76974183386322703, 0.83988962484963892, 0.89226081800387902, 0.9315419599631839, 0.96209454837808417, 0.98781637073289585 };
@@ -54,36 +79,70 @@ public:
     static constexpr double coeffs8x[3] = {0.055748680811302048, 0.24305119574153072, 0.64669913119268196 };
     static constexpr double coeffs16x[2] = {0.10717745346023573, 0.53091435354504557 };
 
-    for (auto c = 0; c < mNInChannels; c++)
+    // single channel filters for Process() and ProcessGen()
+    mUpsampler2x.set_coefs(coeffs2x);
+    mUpsampler4x.set_coefs(coeffs4x);
+    mUpsampler8x.set_coefs(coeffs8x);
+    mUpsampler16x.set_coefs(coeffs16x);
+    
+    mDownsampler2x.set_coefs(coeffs2x);
+    mDownsampler4x.set_coefs(coeffs4x);
+    mDownsampler8x.set_coefs(coeffs8x);
+    mDownsampler16x.set_coefs(coeffs16x);
+    
+    // channel interleaved filters for ProcessBlock(), one per group of four channels
+    for (auto g = 0; g < NGroups(mNInChannels); g++)
     {
-      mUpsampler2x.Add(new Upsampler2xFPU<12, T>());
-      mUpsampler4x.Add(new Upsampler2xFPU<4, T>());
-      mUpsampler8x.Add(new Upsampler2xFPU<3, T>());
-      mUpsampler16x.Add(new Upsampler2xFPU<2, T>());
+      mGroupUpsampler2x.Add(new Upsampler2x4<12, T>());
+      mGroupUpsampler4x.Add(new Upsampler2x4<4, T>());
+      mGroupUpsampler8x.Add(new Upsampler2x4<3, T>());
+      mGroupUpsampler16x.Add(new Upsampler2x4<2, T>());
       
-      mUpsampler2x.Get(c)->set_coefs(coeffs2x);
-      mUpsampler4x.Get(c)->set_coefs(coeffs4x);
-      mUpsampler8x.Get(c)->set_coefs(coeffs8x);
-      mUpsampler16x.Get(c)->set_coefs(coeffs16x);
+      mGroupUpsampler2x.Get(g)->set_coefs(coeffs2x);
+      mGroupUpsampler4x.Get(g)->set_coefs(coeffs4x);
+      mGroupUpsampler8x.Get(g)->set_coefs(coeffs8x);
+      mGroupUpsampler16x.Get(g)->set_coefs(coeffs16x);
       
-      // ptr location doesn't matter at this stage
-      mNextInputPtrs.Add(mUp2x.Get());
+      for (auto stage = 0; stage < kNumStages; stage++)
+      {
+        mGroupFIRUpsamplers.Add(new HalfBandFIRUpsampler2x4<T>());
+        mGroupFIRUpsamplers.Get(g * kNumStages + stage)->SetKernel(GetFIRKernel(stage));
+      }
+      
+      mGroupFIRDelays.Add(new InterleavedDelay4<T>());
+      mGroupFIRDelays.Get(g)->Reserve(1 << kNumStages); // the padding is less than the highest rate, so switching factors never allocates
     }
     
-    for (auto c = 0; c < mNOutChannels; c++)
+    for (auto g = 0; g < NGroups(mNOutChannels); g++)
     {
-      mDownsampler2x.Add(new Downsampler2xFPU<12, T>());
-      mDownsampler4x.Add(new Downsampler2xFPU<4, T>());
-      mDownsampler8x.Add(new Downsampler2xFPU<3, T>());
-      mDownsampler16x.Add(new Downsampler2xFPU<2, T>());
+      mGroupDownsampler2x.Add(new Downsampler2x4<12, T>());
+      mGroupDownsampler4x.Add(new Downsampler2x4<4, T>());
+      mGroupDownsampler8x.Add(new Downsampler2x4<3, T>());
+      mGroupDownsampler16x.Add(new Downsampler2x4<2, T>());
       
-      mDownsampler2x.Get(c)->set_coefs(coeffs2x);
-      mDownsampler4x.Get(c)->set_coefs(coeffs4x);
-      mDownsampler8x.Get(c)->set_coefs(coeffs8x);
-      mDownsampler16x.Get(c)->set_coefs(coeffs16x);
+      mGroupDownsampler2x.Get(g)->set_coefs(coeffs2x);
+      mGroupDownsampler4x.Get(g)->set_coefs(coeffs4x);
+      mGroupDownsampler8x.Get(g)->set_coefs(coeffs8x);
+      mGroupDownsampler16x.Get(g)->set_coefs(coeffs16x);
       
+      for (auto stage = 0; stage < kNumStages; stage++)
+      {
+        mGroupFIRDownsamplers.Add(new HalfBandFIRDownsampler2x4<T>());
+        mGroupFIRDownsamplers.Get(g * kNumStages + stage)->SetKernel(GetFIRKernel(stage));
+      }
+    }
+    
+    for (auto c = 0; c < mNInChannels; c++)
+    {
       // ptr location doesn't matter at this stage
-      mNextOutputPtrs.Add(mDown2x.Get());
+      mInputPtrs.Add(nullptr);
+      mNextInputPtrs.Add(nullptr);
+    }
+    
+    for (auto c = 0; c < mNOutChannels; c++)
+    {
+      mOutputPtrs.Add(nullptr);
+      mNextOutputPtrs.Add(nullptr);
     }
         
     SetOverSampling(factor);
@@ -93,84 +152,95 @@ public:
   
   ~OverSampler()
   {
-    mUpsampler2x.Empty(true);
-    mDownsampler2x.Empty(true);
-    mUpsampler4x.Empty(true);
-    mDownsampler4x.Empty(true);
-    mUpsampler8x.Empty(true);
-    mDownsampler8x.Empty(true);
-    mUpsampler16x.Empty(true);
-    mDownsampler16x.Empty(true);
+    mGroupUpsampler2x.Empty(true);
+    mGroupDownsampler2x.Empty(true);
+    mGroupUpsampler4x.Empty(true);
+    mGroupDownsampler4x.Empty(true);
+    mGroupUpsampler8x.Empty(true);
+    mGroupDownsampler8x.Empty(true);
+    mGroupUpsampler16x.Empty(true);
+    mGroupDownsampler16x.Empty(true);
+    mGroupFIRUpsamplers.Empty(true);
+    mGroupFIRDownsamplers.Empty(true);
+    mGroupFIRDelays.Empty(true);
   }
 
   OverSampler(const OverSampler&) = delete;
   OverSampler& operator=(const OverSampler&) = delete;
     
+  /** Allocate the buffers for the largest block size the plug-in will see, e.g. IPlugProcessor::GetMaxBlockSize(), so that a Reset() for a block size up to it
+   * only clears the filters, and can be called from OnReset() without allocating. Call it from the constructor, before the audio thread starts
+   * @param maxBlockSize The largest number of frames that will be passed to ProcessBlock(), or 0 to allocate for each block size passed to Reset() */
+  void SetMaxBlockSize(int maxBlockSize)
+  {
+    mMaxBlockSize = std::max(maxBlockSize, 0);
+    Reset(mBlockSize);
+  }
+  
+  /** Allocate the buffers for a block size, and clear the filters. A factor change that is still fading is completed
+   * @param blockSize The largest number of frames that will be passed to ProcessBlock() */
   void Reset(int blockSize = DEFAULT_BLOCK_SIZE)
   {
-    int numBufSamples = 1;
+    mBlockSize = blockSize;
     
-    if(mBlockProcessing)
-      numBufSamples = blockSize;
-    else
-    {
-      numBufSamples = 1;
-      blockSize = 1;
-    }
+    // buffers already sized for the maximum block size stay as they are
+    blockSize = mBlockProcessing ? std::max(blockSize, mMaxBlockSize) : 1;
     
-    numBufSamples *= mNInChannels;
+    mFactor = mRequestedFactor;
+    mRate = 1 << mFactor;
+    mPendingFactor.store(mFactor, std::memory_order_relaxed);
+    mFadeDir = 0;
+    mWritePos = 0;
     
-    mUp2x.Resize(2 * numBufSamples);
-    mUp4x.Resize(4 * numBufSamples);
-    mUp8x.Resize(8 * numBufSamples);
-    mUp16x.Resize(16 * numBufSamples);
+    // the per-sample functions only ever need one sample's worth of each rate
+    mUp2x.Resize(2);
+    mUp4x.Resize(4);
+    mUp8x.Resize(8);
+    mUp16x.Resize(16);
     
-    mDown2x.Resize(2 * numBufSamples);
-    mDown4x.Resize(4 * numBufSamples);
-    mDown8x.Resize(8 * numBufSamples);
-    mDown16x.Resize(16 * numBufSamples);
+    mDown2x.Resize(2);
+    mDown4x.Resize(4);
+    mDown8x.Resize(8);
+    mDown16x.Resize(16);
     
-    mUp16BufferPtrs.Empty();
-    mUp8BufferPtrs.Empty();
-    mUp4BufferPtrs.Empty();
-    mUp2BufferPtrs.Empty();
+    // ProcessBlock() ping-pongs each group of channels between two interleaved buffers, rather than keeping a buffer per stage,
+    // then de-interleaves the highest rate into one buffer per channel for the function to process.
+    // They are sized for the largest factor that can be faded to, so that changing factor never allocates
+    mAllocatedFactor = std::max(mFactor, mFadeLength > 0 ? mMaxFactor : kNone);
+    const int nUpSamples = (1 << mAllocatedFactor) * blockSize;
     
-    mDown16BufferPtrs.Empty();
-    mDown8BufferPtrs.Empty();
-    mDown4BufferPtrs.Empty();
-    mDown2BufferPtrs.Empty();
+    mInterleaved[0].Resize(kNumGroupChannels * nUpSamples);
+    mInterleaved[1].Resize(kNumGroupChannels * nUpSamples);
+    mUpData.Resize(mNInChannels * nUpSamples);
+    mDownData.Resize(mInPlace ? 0 : mNOutChannels * nUpSamples);
     
     for (auto c = 0; c < mNInChannels; c++)
-    {
-      mUpsampler2x.Get(c)->clear_buffers();
-      mUpsampler4x.Get(c)->clear_buffers();
-      mUpsampler8x.Get(c)->clear_buffers();
-      mUpsampler16x.Get(c)->clear_buffers();
-      
-      mUp2BufferPtrs.Add(mUp2x.Get() + c * 2 * blockSize);
-      mUp4BufferPtrs.Add(mUp4x.Get() + (c * 4 * blockSize));
-      mUp8BufferPtrs.Add(mUp8x.Get() + (c * 8 * blockSize));
-      mUp16BufferPtrs.Add(mUp16x.Get() + (c * 16 * blockSize));
-    }
+      mInputPtrs.Set(c, mUpData.Get() + c * nUpSamples);
     
     for (auto c = 0; c < mNOutChannels; c++)
+      mOutputPtrs.Set(c, mInPlace ? mInputPtrs.Get(c) : mDownData.Get() + c * nUpSamples);
+    
+    ClearStages(0, 0);
+  }
+  
+  /** Let ProcessBlock() pass the same buffers to the function for input and output, which saves a buffer per channel at the highest rate.
+   * Only set this if the function can process in place, and the number of output channels is no more than the number of input channels
+   * @param inPlace \c true if the function can process in place */
+  void SetProcessInPlace(bool inPlace)
+  {
+    assert(!inPlace || mNOutChannels <= mNInChannels);
+    
+    if (inPlace != mInPlace)
     {
-      mDownsampler2x.Get(c)->clear_buffers();
-      mDownsampler4x.Get(c)->clear_buffers();
-      mDownsampler8x.Get(c)->clear_buffers();
-      mDownsampler16x.Get(c)->clear_buffers();
-      
-      mDown2BufferPtrs.Add(mDown2x.Get() + c * 2 * blockSize);
-      mDown4BufferPtrs.Add(mDown4x.Get() + (c * 4 * blockSize));
-      mDown8BufferPtrs.Add(mDown8x.Get() + (c * 8 * blockSize));
-      mDown16BufferPtrs.Add(mDown16x.Get() + (c * 16 * blockSize));
+      mInPlace = inPlace;
+      Reset(mBlockSize);
     }
   }
 
   /** Over sample an input block with a per-block function (up sample input -> process with function -> down sample)
    * @param inputs Two-dimensional array containing the non-interleaved input buffers of audio samples for all channels
    * @param outputs Two-dimensional array for audio output (non-interleaved).
-   * @param nFrames The block size for this block: number of samples per channel.
+   * @param nFrames The block size for this block: number of samples per channel. Must be less or equal to the block size passed to Reset()
    * @param nInChans The number of input channels to process. Must be less or equal to the number of channels passed to the constructor
    * @param nOutChans The number of output channels to process. Must be less or equal to the number of channels passed to the constructor
    * @param func The function that processes the audio sample at the higher sampling rate. NOTE: std::function can call malloc if you pass in captures */
@@ -178,74 +248,65 @@ public:
   {
     assert(nInChans <= mNInChannels);
     assert(nOutChans <= mNOutChannels);
+    assert(nFrames <= (mBlockProcessing ? mBlockSize : 1));
     
-    if(mRate != mPrevRate)
-    {
-      switch (mRate) {
-        case 2:
-          mInPtrLoopSrc = &mUp2BufferPtrs;
-          mOutPtrLoopSrc = &mDown2BufferPtrs;
-          break;
-        case 4:
-          mInPtrLoopSrc = &mUp4BufferPtrs;
-          mOutPtrLoopSrc = &mDown4BufferPtrs;
-          break;
-        case 8:
-          mInPtrLoopSrc = &mUp8BufferPtrs;
-          mOutPtrLoopSrc = &mDown8BufferPtrs;
-          break;
-        case 16:
-          mInPtrLoopSrc = &mUp16BufferPtrs;
-          mOutPtrLoopSrc = &mDown16BufferPtrs;
-          break;
-        default:
-          break;
-      }
-      
-      mPrevRate = mRate;
+    UpdateFactorFade();
+    
+    if (mRate == 1)
+    {
+      func(inputs, outputs, nFrames);
+      ApplyFactorFade(outputs, nOutChans, nFrames);
+      return;
     }
+    
+    const int nUpSamples = nFrames * mRate;
 
-    for(auto c = 0; c < nInChans; c++) {
-      if (mRate >= 2) {
-        mUpsampler2x.Get(c)->process_block(mUp2BufferPtrs.Get(c), inputs[c], nFrames);
-      }
-      if (mRate >= 4) {
-        mUpsampler4x.Get(c)->process_block(mUp4BufferPtrs.Get(c), mUp2BufferPtrs.Get(c), nFrames * 2);
-      }
-      if (mRate >= 8) {
-        mUpsampler8x.Get(c)->process_block(mUp8BufferPtrs.Get(c), mUp4BufferPtrs.Get(c), nFrames * 4);
-      }
-      if (mRate == 16) {
-        mUpsampler16x.Get(c)->process_block(mUp16BufferPtrs.Get(c), mUp8BufferPtrs.Get(c), nFrames * 8);
+    for (auto g = 0; g < NGroups(nInChans); g++)
+    {
+      T* pSrc = mInterleaved[0].Get();
+      T* pDst = mInterleaved[1].Get();
+      
+      Interleave(pSrc, inputs, g, nInChans, nFrames);
+      
+      for (auto stage = 0; stage < mFactor; stage++)
+      {
+        UpsampleGroup(g, stage, pDst, pSrc, nFrames << stage);
+        std::swap(pSrc, pDst);
       }
+      
+      if (mMode == kLinearPhase)
+        mGroupFIRDelays.Get(g)->ProcessBlock(pSrc, nUpSamples);
+      
+      Deinterleave(mInputPtrs.GetList(), pSrc, g, nInChans, nUpSamples);
     }
     
-    if (mRate == 1) {
-      func(inputs, outputs, nFrames);
-    } else {
-      for (auto i = 0; i < mRate; i++) {
-        for(auto c = 0; c < nInChans; c++) {
-          mNextInputPtrs.Set(c, mInPtrLoopSrc->Get(c) + (i * nFrames));
-          mNextOutputPtrs.Set(c, mOutPtrLoopSrc->Get(c) + (i * nFrames));
-        }
-        func(mNextInputPtrs.GetList(), mNextOutputPtrs.GetList(), nFrames);
+    for (auto i = 0; i < mRate; i++) {
+      for(auto c = 0; c < nInChans; c++) {
+        mNextInputPtrs.Set(c, mInputPtrs.Get(c) + (i * nFrames));
       }
+      for(auto c = 0; c < nOutChans; c++) {
+        mNextOutputPtrs.Set(c, mOutputPtrs.Get(c) + (i * nFrames));
+      }
+      func(mNextInputPtrs.GetList(), mNextOutputPtrs.GetList(), nFrames);
     }
     
-    for(auto c = 0; c < nOutChans; c++) {
-      if (mRate == 16) {
-        mDownsampler16x.Get(c)->process_block(mDown8BufferPtrs.Get(c), mDown16BufferPtrs.Get(c), nFrames * 8);
-      }
-      if (mRate >= 8) {
-        mDownsampler8x.Get(c)->process_block(mDown4BufferPtrs.Get(c), mDown8BufferPtrs.Get(c), nFrames * 4);
-      }
-      if (mRate >= 4) {
-        mDownsampler4x.Get(c)->process_block(mDown2BufferPtrs.Get(c), mDown4BufferPtrs.Get(c), nFrames * 2);
-      }
-      if (mRate >= 2) {
-        mDownsampler2x.Get(c)->process_block(outputs[c], mDown2BufferPtrs.Get(c), nFrames);
+    for (auto g = 0; g < NGroups(nOutChans); g++)
+    {
+      T* pSrc = mInterleaved[0].Get();
+      T* pDst = mInterleaved[1].Get();
+      
+      Interleave(pSrc, mOutputPtrs.GetList(), g, nOutChans, nUpSamples);
+      
+      for (auto stage = mFactor - 1; stage >= 0; stage--)
+      {
+        DownsampleGroup(g, stage, pDst, pSrc, nFrames << stage);
+        std::swap(pSrc, pDst);
       }
+      
+      Deinterleave(outputs, pSrc, g, nOutChans, nFrames);
     }
+    
+    ApplyFactorFade(outputs, nOutChans, nFrames);
   }
   
   /** Over sample an input sample with a per-sample function (up-sample input -> process with function -> down-sample)
@@ -254,66 +315,70 @@ public:
    * @return The audio sample output */
   T Process(T input, std::function<T(T)> func)
   {
+    UpdateFactorFade();
+    
     T output;
 
     if(mRate == 16)
     {
-      mUpsampler2x.Get(0)->process_sample(mUp2x.Get()[0], mUp2x.Get()[1], input);
-      mUpsampler4x.Get(0)->process_block(mUp4x.Get(), mUp2x.Get(), 2);
-      mUpsampler8x.Get(0)->process_block(mUp8x.Get(), mUp4x.Get(), 4);
-      mUpsampler16x.Get(0)->process_block(mUp16x.Get(), mUp8x.Get(), 8);
+      mUpsampler2x.process_sample(mUp2x.Get()[0], mUp2x.Get()[1], input);
+      mUpsampler4x.process_block(mUp4x.Get(), mUp2x.Get(), 2);
+      mUpsampler8x.process_block(mUp8x.Get(), mUp4x.Get(), 4);
+      mUpsampler16x.process_block(mUp16x.Get(), mUp8x.Get(), 8);
 
       for (auto i = 0; i < 16; i++)
       {
         mDown16x.Get()[i] = func(mUp16x.Get()[i]);
       }
 
-      mDownsampler16x.Get(0)->process_block(mDown8x.Get(), mDown16x.Get(), 8);
-      mDownsampler8x.Get(0)->process_block(mDown4x.Get(), mDown8x.Get(), 4);
-      mDownsampler4x.Get(0)->process_block(mDown2x.Get(), mDown4x.Get(), 2);
-      output = mDownsampler2x.Get(0)->process_sample(mDown2x.Get());
+      mDownsampler16x.process_block(mDown8x.Get(), mDown16x.Get(), 8);
+      mDownsampler8x.process_block(mDown4x.Get(), mDown8x.Get(), 4);
+      mDownsampler4x.process_block(mDown2x.Get(), mDown4x.Get(), 2);
+      output = mDownsampler2x.process_sample(mDown2x.Get());
     }
     else if (mRate == 8)
     {
-      mUpsampler2x.Get(0)->process_sample(mUp2x.Get()[0], mUp2x.Get()[1], input);
-      mUpsampler4x.Get(0)->process_block(mUp4x.Get(), mUp2x.Get(), 2);
-      mUpsampler8x.Get(0)->process_block(mUp8x.Get(), mUp4x.Get(), 4);
+      mUpsampler2x.process_sample(mUp2x.Get()[0], mUp2x.Get()[1], input);
+      mUpsampler4x.process_block(mUp4x.Get(), mUp2x.Get(), 2);
+      mUpsampler8x.process_block(mUp8x.Get(), mUp4x.Get(), 4);
 
       for (auto i = 0; i < 8; i++)
       {
         mDown8x.Get()[i] = func(mUp8x.Get()[i]);
       }
 
-      mDownsampler8x.Get(0)->process_block(mDown4x.Get(), mDown8x.Get(), 4);
-      mDownsampler4x.Get(0)->process_block(mDown2x.Get(), mDown4x.Get(), 2);
-      output = mDownsampler2x.Get(0)->process_sample(mDown2x.Get());
+      mDownsampler8x.process_block(mDown4x.Get(), mDown8x.Get(), 4);
+      mDownsampler4x.process_block(mDown2x.Get(), mDown4x.Get(), 2);
+      output = mDownsampler2x.process_sample(mDown2x.Get());
     }
     else if (mRate == 4)
     {
-      mUpsampler2x.Get(0)->process_sample(mUp2x.Get()[0], mUp2x.Get()[1], input);
-      mUpsampler4x.Get(0)->process_block(mUp4x.Get(), mUp2x.Get(), 2);
+      mUpsampler2x.process_sample(mUp2x.Get()[0], mUp2x.Get()[1], input);
+      mUpsampler4x.process_block(mUp4x.Get(), mUp2x.Get(), 2);
 
       for (auto i = 0; i < 4; i++)
       {
         mDown4x.Get()[i] = func(mUp4x.Get()[i]);
       }
 
-      mDownsampler4x.Get(0)->process_block(mDown2x.Get(), mDown4x.Get(), 2);
-      output = mDownsampler2x.Get(0)->process_sample(mDown2x.Get());
+      mDownsampler4x.process_block(mDown2x.Get(), mDown4x.Get(), 2);
+      output = mDownsampler2x.process_sample(mDown2x.Get());
     }
     else if (mRate == 2)
     {
-      mUpsampler2x.Get(0)->process_sample(mUp2x.Get()[0], mUp2x.Get()[1], input);
+      mUpsampler2x.process_sample(mUp2x.Get()[0], mUp2x.Get()[1], input);
 
       mDown2x.Get()[0] = func(mUp2x.Get()[0]);
       mDown2x.Get()[1] = func(mUp2x.Get()[1]);
-      output = mDownsampler2x.Get(0)->process_sample(mDown2x.Get());
+      output = mDownsampler2x.process_sample(mDown2x.Get());
     }
     else
     {
       output = func(input);
     }
 
+    T* pOutput = &output;
+    ApplyFactorFade(&pOutput, 1, 1);
     return output;
   }
 
@@ -322,6 +387,8 @@ public:
    * @return The audio sample output */
   T ProcessGen(std::function<T()> genFunc)
   {
+    UpdateFactorFade();
+    
     auto ProcessDown16x = [&](T input)
     {
       mDown16x.Get()[mWritePos] = (T) input;
@@ -331,10 +398,10 @@ public:
 
       if(mWritePos == 0)
       {
-        mDownsampler16x.Get(0)->process_block(mDown8x.Get(), mDown16x.Get(), 8);
-        mDownsampler8x.Get(0)->process_block(mDown4x.Get(), mDown8x.Get(), 4);
-        mDownsampler4x.Get(0)->process_block(mDown2x.Get(), mDown4x.Get(), 2);
-        mDownSamplerOutput = mDownsampler2x.Get(0)->process_sample(mDown2x.Get());
+        mDownsampler16x.process_block(mDown8x.Get(), mDown16x.Get(), 8);
+        mDownsampler8x.process_block(mDown4x.Get(), mDown8x.Get(), 4);
+        mDownsampler4x.process_block(mDown2x.Get(), mDown4x.Get(), 2);
+        mDownSamplerOutput = mDownsampler2x.process_sample(mDown2x.Get());
       }
     };
 
@@ -347,9 +414,9 @@ public:
 
       if(mWritePos == 0)
       {
-        mDownsampler8x.Get(0)->process_block(mDown4x.Get(), mDown8x.Get(), 4);
-        mDownsampler4x.Get(0)->process_block(mDown2x.Get(), mDown4x.Get(), 2);
-        mDownSamplerOutput = mDownsampler2x.Get(0)->process_sample(mDown2x.Get());
+        mDownsampler8x.process_block(mDown4x.Get(), mDown8x.Get(), 4);
+        mDownsampler4x.process_block(mDown2x.Get(), mDown4x.Get(), 2);
+        mDownSamplerOutput = mDownsampler2x.process_sample(mDown2x.Get());
       }
     };
 
@@ -362,8 +429,8 @@ public:
 
       if(mWritePos == 0)
       {
-        mDownsampler4x.Get(0)->process_block(mDown2x.Get(), mDown4x.Get(), 2);
-        mDownSamplerOutput = mDownsampler2x.Get(0)->process_sample(mDown2x.Get());
+        mDownsampler4x.process_block(mDown2x.Get(), mDown4x.Get(), 2);
+        mDownSamplerOutput = mDownsampler2x.process_sample(mDown2x.Get());
       }
     };
 
@@ -375,7 +442,7 @@ public:
 
       if(mWritePos == 0)
       {
-        mDownSamplerOutput = mDownsampler2x.Get(0)->process_sample(mDown2x.Get());
+        mDownSamplerOutput = mDownsampler2x.process_sample(mDown2x.Get());
       }
     };
 
@@ -398,20 +465,89 @@ public:
     if(mRate > 1)
       output = mDownSamplerOutput;
 
+    T* pOutput = &output;
+    ApplyFactorFade(&pOutput, 1, 1);
     return output;
   }
 
+  /** Change the over sampling factor. If a fade length has been set with SetFactorFadeLength(), and the buffers are allocated for the factor, this can be called while processing,
+   * from any thread, and the processing thread fades out, switches factor and fades back in. Otherwise the factor changes immediately, and the filters and buffers are reset.
+   * The latency is reported straight away, so that the host can compensate for the new factor
+   * @param factor The new factor */
   void SetOverSampling(EFactor factor)
   {
-    if(factor != mFactor)
+    if(factor != mRequestedFactor)
     {
-      mFactor = factor;
-      mRate = std::pow(2, (int) factor);
+      mRequestedFactor = factor;
       
-      Reset();
+      if (mFadeLength > 0 && factor <= mAllocatedFactor)
+      {
+        mPendingFactor.store(factor, std::memory_order_release);
+      }
+      else
+      {
+        Reset(mBlockSize);
+      }
+      
+      UpdateLatency();
     }
   }
   
+  /** Let the factor change while processing without clicks. When SetOverSampling() is called, the output fades out over nSamples at the old factor,
+   * the processing switches to the new factor at the start of the next block, and fades back in over nSamples. The up sampling stages that both factors use keep running throughout,
+   * and the others are cleared while the output is silent. Reset() allocates the buffers for maxFactor, so that no factor up to it allocates, changes to higher factors still reset.
+   * A true crossfade is not possible, since it would call the processing function at both rates. Call Reset() afterwards to allocate the buffers
+   * @param nSamples The length of each fade in samples at the base rate, or 0 to reset when the factor changes, which is the default
+   * @param maxFactor The highest factor that will be faded to */
+  void SetFactorFadeLength(int nSamples, EFactor maxFactor = k16x)
+  {
+    mFadeLength = std::max(nSamples, 0);
+    mMaxFactor = maxFactor;
+  }
+  
+  /** Switch between the IIR and linear phase FIR filters for ProcessBlock(). This resets the filters, so it should not be called while processing
+   * @param mode kMinimumLatency or kLinearPhase */
+  void SetMode(EOverSamplingMode mode)
+  {
+    if (mode != mMode)
+    {
+      mMode = mode;
+      
+      Reset(mBlockSize);
+      UpdateLatency();
+    }
+  }
+  
+  EOverSamplingMode GetMode() const { return mMode; }
+  
+  /** @return The delay that the up and down sampling filters add, in samples at the base rate. In kMinimumLatency mode this is the group
+   * delay of the IIR filters at DC, rounded to the nearest sample, the group delay rises towards the top of the pass band. During a fade this is the new factor's latency */
+  int GetLatency() const { return GetLatency(mRequestedFactor, mMode); }
+  
+  /** @param factor The over sampling factor
+   * @param mode The filter mode
+   * @return The latency in samples at the base rate of an OverSampler set to factor and mode */
+  static int GetLatency(EFactor factor, EOverSamplingMode mode)
+  {
+    if (mode == kLinearPhase)
+      return (GetFIRDelay(factor) + GetFIRPadding(factor)) >> factor;
+    
+    static const std::array<int, kNumFactors> sIIRLatencies = ComputeIIRLatencies();
+    return sIIRLatencies[factor];
+  }
+  
+  /** Set a function to call whenever the factor or mode changes the latency, which will usually call IPlugProcessor::SetLatency(), so that
+   * the host can compensate for it. It is called immediately, with the current latency
+   * @param func The function to call with the new latency, in samples at the base rate */
+  void SetLatencyChangedFunc(LatencyChangedFunc func)
+  {
+    mLatencyChangedFunc = func;
+    mLatency = GetLatency();
+    
+    if (mLatencyChangedFunc)
+      mLatencyChangedFunc(mLatency);
+  }
+  
   static EFactor RateToFactor(int rate)
   {
     switch (rate)
@@ -425,60 +561,336 @@ public:
     }
   }
   
+  /** @return The rate at which the processing function is being called, relative to the base rate. During a fade this is the old factor's rate until the output has faded out,
+   * so a processing function that depends on the rate should check it for each block */
   int GetRate()
   {
     return mRate;
   }
 
 private:
-  EFactor mFactor = kNone;
-  int mPrevRate = 0;
+  static int NGroups(int nChans) { return (nChans + kNumGroupChannels - 1) / kNumGroupChannels; }
+  
+  /** Up sample a group of channels by one stage of the cascade, where stage 0 is 1x to 2x */
+  void UpsampleGroup(int group, int stage, T* pDst, const T* pSrc, int nFrames)
+  {
+    if (mMode == kLinearPhase)
+    {
+      mGroupFIRUpsamplers.Get(group * kNumStages + stage)->ProcessBlock(pDst, pSrc, nFrames);
+      return;
+    }
+    
+    switch (stage)
+    {
+      case 0: mGroupUpsampler2x.Get(group)->process_block(pDst, pSrc, nFrames); break;
+      case 1: mGroupUpsampler4x.Get(group)->process_block(pDst, pSrc, nFrames); break;
+      case 2: mGroupUpsampler8x.Get(group)->process_block(pDst, pSrc, nFrames); break;
+      case 3: mGroupUpsampler16x.Get(group)->process_block(pDst, pSrc, nFrames); break;
+      default: break;
+    }
+  }
+  
+  /** Down sample a group of channels by one stage of the cascade, where stage 0 is 2x to 1x */
+  void DownsampleGroup(int group, int stage, T* pDst, const T* pSrc, int nFrames)
+  {
+    if (mMode == kLinearPhase)
+    {
+      mGroupFIRDownsamplers.Get(group * kNumStages + stage)->ProcessBlock(pDst, pSrc, nFrames);
+      return;
+    }
+    
+    switch (stage)
+    {
+      case 0: mGroupDownsampler2x.Get(group)->process_block(pDst, pSrc, nFrames); break;
+      case 1: mGroupDownsampler4x.Get(group)->process_block(pDst, pSrc, nFrames); break;
+      case 2: mGroupDownsampler8x.Get(group)->process_block(pDst, pSrc, nFrames); break;
+      case 3: mGroupDownsampler16x.Get(group)->process_block(pDst, pSrc, nFrames); break;
+      default: break;
+    }
+  }
+  
+  /** Clear the up sampling stages from firstUp and the down sampling stages from firstDown, where stage 0 is between 1x and 2x */
+  void ClearStages(int firstUp, int firstDown)
+  {
+    for (auto g = 0; g < NGroups(mNInChannels); g++)
+    {
+      if (firstUp <= 0) mGroupUpsampler2x.Get(g)->clear_buffers();
+      if (firstUp <= 1) mGroupUpsampler4x.Get(g)->clear_buffers();
+      if (firstUp <= 2) mGroupUpsampler8x.Get(g)->clear_buffers();
+      if (firstUp <= 3) mGroupUpsampler16x.Get(g)->clear_buffers();
+      
+      for (auto stage = firstUp; stage < kNumStages; stage++)
+        mGroupFIRUpsamplers.Get(g * kNumStages + stage)->Clear();
+      
+      mGroupFIRDelays.Get(g)->SetDelay(GetFIRPadding(mFactor));
+    }
+    
+    for (auto g = 0; g < NGroups(mNOutChannels); g++)
+    {
+      if (firstDown <= 0) mGroupDownsampler2x.Get(g)->clear_buffers();
+      if (firstDown <= 1) mGroupDownsampler4x.Get(g)->clear_buffers();
+      if (firstDown <= 2) mGroupDownsampler8x.Get(g)->clear_buffers();
+      if (firstDown <= 3) mGroupDownsampler16x.Get(g)->clear_buffers();
+      
+      for (auto stage = firstDown; stage < kNumStages; stage++)
+        mGroupFIRDownsamplers.Get(g * kNumStages + stage)->Clear();
+    }
+    
+    if (firstUp <= 0) mUpsampler2x.clear_buffers();
+    if (firstUp <= 1) mUpsampler4x.clear_buffers();
+    if (firstUp <= 2) mUpsampler8x.clear_buffers();
+    if (firstUp <= 3) mUpsampler16x.clear_buffers();
+    
+    if (firstDown <= 0) mDownsampler2x.clear_buffers();
+    if (firstDown <= 1) mDownsampler4x.clear_buffers();
+    if (firstDown <= 2) mDownsampler8x.clear_buffers();
+    if (firstDown <= 3) mDownsampler16x.clear_buffers();
+  }
+  
+  /** Called by the processing thread before each block, to start fading out for a new factor, to switch once the output is silent, or to fade back in if the factor was changed back */
+  void UpdateFactorFade()
+  {
+    const EFactor pending = static_cast<EFactor>(mPendingFactor.load(std::memory_order_acquire));
+    
+    if (pending != mFactor)
+    {
+      if (mFadeDir == 0)
+      {
+        mFadeDir = -1;
+        mFadePos = mFadeLength;
+      }
+      else if (mFadeDir < 0 && mFadePos == 0)
+      {
+        // the stages below both factors have been running all along, and the ones above them are either stale or about to be unused
+        const EFactor old = mFactor;
+        mFactor = pending;
+        mRate = 1 << mFactor;
+        mWritePos = 0;
+        ClearStages(old, std::min(old, mFactor));
+        mFadeDir = 1;
+      }
+      else if (mFadeDir > 0)
+      {
+        mFadeDir = -1;
+      }
+    }
+    else if (mFadeDir < 0)
+    {
+      mFadeDir = 1;
+    }
+  }
+  
+  /** Apply the fade gain to a block of output, at the base rate */
+  void ApplyFactorFade(T** outputs, int nChans, int nFrames)
+  {
+    if (mFadeDir == 0 || mFadeLength == 0)
+      return;
+    
+    const T step = static_cast<T>(1) / mFadeLength;
+    
+    for (auto c = 0; c < nChans; c++)
+    {
+      T* pOutput = outputs[c];
+      
+      for (auto s = 0; s < nFrames; s++)
+      {
+        const int pos = Clip(mFadePos + mFadeDir * (s + 1), 0, mFadeLength);
+        pOutput[s] *= pos * step;
+      }
+    }
+    
+    mFadePos = Clip(mFadePos + mFadeDir * nFrames, 0, mFadeLength);
+    
+    if (mFadeDir > 0 && mFadePos == mFadeLength)
+      mFadeDir = 0;
+  }
+  
+  void UpdateLatency()
+  {
+    // nothing to report to, which also stops ComputeIIRLatencies() recursing
+    if (!mLatencyChangedFunc)
+      return;
+    
+    const int latency = GetLatency();
+    
+    if (latency != mLatency)
+    {
+      mLatency = latency;
+      
+      mLatencyChangedFunc(mLatency);
+    }
+  }
+  
+  static int GetFIRTaps(int stage)
+  {
+    static constexpr int sTaps[kNumStages] = { 171, 31, 23, 19 };
+    return sTaps[stage];
+  }
+  
+  /** The kernels are designed once and shared. The first stage needs a narrow transition band to keep the audio band flat up to 20kHz at 44.1kHz,
+   * the later stages only need to reject the images above it, so they are much shorter. All of them attenuate by more than 105dB */
+  static const std::vector<double>& GetFIRKernel(int stage)
+  {
+    static const std::vector<double> sKernels[kNumStages] = {
+      DesignHalfBandFIR(GetFIRTaps(0), 120.),
+      DesignHalfBandFIR(GetFIRTaps(1), 120.),
+      DesignHalfBandFIR(GetFIRTaps(2), 120.),
+      DesignHalfBandFIR(GetFIRTaps(3), 120.)
+    };
+    
+    return sKernels[stage];
+  }
+  
+  /** @return The delay of the up and down sampling FIR cascades in samples at the highest rate. Each stage delays by its centre tap at its higher rate */
+  static int GetFIRDelay(EFactor factor)
+  {
+    int delay = 0;
+    
+    for (auto stage = 0; stage < factor; stage++)
+      delay += 2 * ((GetFIRTaps(stage) - 1) / 2) << (factor - stage - 1);
+      
+    return delay;
+  }
+  
+  /** @return The delay to add at the highest rate so that the linear phase latency is a whole number of samples at the base rate */
+  static int GetFIRPadding(EFactor factor)
+  {
+    const int rate = 1 << factor;
+    return (rate - GetFIRDelay(factor) % rate) % rate;
+  }
+  
+  /** Measure the group delay at DC of each IIR cascade, as the centroid of an impulse response through the up and down samplers */
+  static std::array<int, kNumFactors> ComputeIIRLatencies()
+  {
+    std::array<int, kNumFactors> latencies = {};
+    
+    for (auto f = 1; f < kNumFactors; f++)
+    {
+      OverSampler<double> overSampler(static_cast<EFactor>(f), false);
+      double sum = 0., weightedSum = 0.;
+      
+      for (auto s = 0; s < 4096; s++)
+      {
+        const double output = overSampler.Process(s == 0 ? 1. : 0., [](double x) { return x; });
+        sum += output;
+        weightedSum += output * s;
+      }
+      
+      latencies[f] = static_cast<int>(std::round(weightedSum / sum));
+    }
+    
+    return latencies;
+  }
+  
+  /** Interleave a group of four channels, zero filling any channels beyond nChans */
+  static void Interleave(T* pDest, T** ppSrc, int group, int nChans, int nFrames)
+  {
+    for (auto i = 0; i < kNumGroupChannels; i++)
+    {
+      const int c = group * kNumGroupChannels + i;
+      
+      if (c < nChans)
+      {
+        const T* pSrc = ppSrc[c];
+        
+        for (auto s = 0; s < nFrames; s++)
+          pDest[s * kNumGroupChannels + i] = pSrc[s];
+      }
+      else
+      {
+        for (auto s = 0; s < nFrames; s++)
+          pDest[s * kNumGroupChannels + i] = 0;
+      }
+    }
+  }
+  
+  /** De-interleave a group of four channels, skipping any channels beyond nChans */
+  static void Deinterleave(T** ppDest, const T* pSrc, int group, int nChans, int nFrames)
+  {
+    for (auto i = 0; i < kNumGroupChannels; i++)
+    {
+      const int c = group * kNumGroupChannels + i;
+      
+      if (c >= nChans)
+        break;
+      
+      T* pDest = ppDest[c];
+
+      for (auto s = 0; s < nFrames; s++)
+        pDest[s] = pSrc[s * kNumGroupChannels + i];
+    }
+  }
+  
+  EFactor mFactor = kNone; // the factor being processed, which lags mRequestedFactor during a fade
+  EFactor mRequestedFactor = kNone;
+  EFactor mMaxFactor = k16x;
+  EFactor mAllocatedFactor = kNone;
+  std::atomic<int> mPendingFactor {kNone};
+  int mFadeLength = 0;
+  int mFadePos = 0;
+  int mFadeDir = 0; // -1 fading out, 1 fading in
   int mRate = 1;
   int mWritePos = 0;
+  int mBlockSize = DEFAULT_BLOCK_SIZE;
+  int mMaxBlockSize = 0;
   T mDownSamplerOutput = 0.;
   bool mBlockProcessing; // false
+  bool mInPlace = false;
   int mNInChannels; // 1
   int mNOutChannels;
+  EOverSamplingMode mMode; // kMinimumLatency
+  int mLatency = 0;
+  LatencyChangedFunc mLatencyChangedFunc = nullptr;
   
-  // the actual data
-  WDL_TypedBuf<T> mUp16x;
-  WDL_TypedBuf<T> mUp8x;
-  WDL_TypedBuf<T> mUp4x;
-  WDL_TypedBuf<T> mUp2x;
-
-  WDL_TypedBuf<T> mDown16x;
-  WDL_TypedBuf<T> mDown8x;
-  WDL_TypedBuf<T> mDown4x;
-  WDL_TypedBuf<T> mDown2x;
+  // the actual data for the per-sample functions
+  IAlignedBuf<T> mUp16x;
+  IAlignedBuf<T> mUp8x;
+  IAlignedBuf<T> mUp4x;
+  IAlignedBuf<T> mUp2x;
+
+  IAlignedBuf<T> mDown16x;
+  IAlignedBuf<T> mDown8x;
+  IAlignedBuf<T> mDown4x;
+  IAlignedBuf<T> mDown2x;
   
-  //Ptrs into buffer data
-  WDL_PtrList<T> mUp16BufferPtrs;
-  WDL_PtrList<T> mUp8BufferPtrs;
-  WDL_PtrList<T> mUp4BufferPtrs;
-  WDL_PtrList<T> mUp2BufferPtrs;
+  // the actual data for block processing
+  IAlignedBuf<T> mInterleaved[2];
+  IAlignedBuf<T> mUpData;
+  IAlignedBuf<T> mDownData;
   
-  WDL_PtrList<T> mDown16BufferPtrs;
-  WDL_PtrList<T> mDown8BufferPtrs;
-  WDL_PtrList<T> mDown4BufferPtrs;
-  WDL_PtrList<T> mDown2BufferPtrs;
+  //Ptrs into the block processing data at the highest rate, the output ptrs are the same as the input ptrs when in place
+  WDL_PtrList<T> mInputPtrs;
+  WDL_PtrList<T> mOutputPtrs;
 
   WDL_PtrList<T> mNextInputPtrs;
   WDL_PtrList<T> mNextOutputPtrs;
-
-  //Ptrs to the buffer data ptrs, changed depending on rate (block processing only)
-  WDL_PtrList<T>* mInPtrLoopSrc = nullptr;
-  WDL_PtrList<T>* mOutPtrLoopSrc = nullptr;
   
-  //Ptrs to oversamplers for each channel
-  WDL_PtrList<Upsampler2xFPU<12, T>> mUpsampler2x; // for 1x to 2x SR
-  WDL_PtrList<Upsampler2xFPU<4, T>> mUpsampler4x;  // for 2x to 4x SR
-  WDL_PtrList<Upsampler2xFPU<3, T>> mUpsampler8x;  // for 4x to 8x SR
-  WDL_PtrList<Upsampler2xFPU<2, T>> mUpsampler16x; // for 8x to 16x SR
-
-  WDL_PtrList<Downsampler2xFPU<12, T>> mDownsampler2x; // decimator for 2x to 1x SR
-  WDL_PtrList<Downsampler2xFPU<4, T>> mDownsampler4x;  // decimator for 4x to 2x SR
-  WDL_PtrList<Downsampler2xFPU<3, T>> mDownsampler8x;  // decimator for 8x to 4x SR
-  WDL_PtrList<Downsampler2xFPU<2, T>> mDownsampler16x; // decimator for 16x to 8x SR
+  //Single channel oversamplers, for the per-sample functions
+  Upsampler2xFPU<12, T> mUpsampler2x; // for 1x to 2x SR
+  Upsampler2xFPU<4, T> mUpsampler4x;  // for 2x to 4x SR
+  Upsampler2xFPU<3, T> mUpsampler8x;  // for 4x to 8x SR
+  Upsampler2xFPU<2, T> mUpsampler16x; // for 8x to 16x SR
+
+  Downsampler2xFPU<12, T> mDownsampler2x; // decimator for 2x to 1x SR
+  Downsampler2xFPU<4, T> mDownsampler4x;  // decimator for 4x to 2x SR
+  Downsampler2xFPU<3, T> mDownsampler8x;  // decimator for 8x to 4x SR
+  Downsampler2xFPU<2, T> mDownsampler16x; // decimator for 16x to 8x SR
+  
+  //Ptrs to channel interleaved oversamplers for each group of four channels, for block processing
+  WDL_PtrList<Upsampler2x4<12, T>> mGroupUpsampler2x;
+  WDL_PtrList<Upsampler2x4<4, T>> mGroupUpsampler4x;
+  WDL_PtrList<Upsampler2x4<3, T>> mGroupUpsampler8x;
+  WDL_PtrList<Upsampler2x4<2, T>> mGroupUpsampler16x;
+
+  WDL_PtrList<Downsampler2x4<12, T>> mGroupDownsampler2x;
+  WDL_PtrList<Downsampler2x4<4, T>> mGroupDownsampler4x;
+  WDL_PtrList<Downsampler2x4<3, T>> mGroupDownsampler8x;
+  WDL_PtrList<Downsampler2x4<2, T>> mGroupDownsampler16x;
+  
+  //Ptrs to channel interleaved FIR stages, kNumStages per group of four channels, for block processing in kLinearPhase mode
+  WDL_PtrList<HalfBandFIRUpsampler2x4<T>> mGroupFIRUpsamplers;
+  WDL_PtrList<HalfBandFIRDownsampler2x4<T>> mGroupFIRDownsamplers;
+  WDL_PtrList<InterleavedDelay4<T>> mGroupFIRDelays;
 };
 
 END_IPLUG_NAMESPACE
@@ -0,0 +1,756 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @brief A partitioned convolution engine that convolves long tails on worker threads, and a wrapper that loads impulses in the background
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "convoengine.h"
+
+#include "IPlugPlatform.h"
+#include "IPlugMemoryStats.h"
+#include "IPlugQueue.h"
+#include "IPlugUtilities.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** A non-uniformly partitioned convolution engine for long impulse responses, which splits the impulse into a head and a series of tail stages.
+ * The head is convolved on the audio thread by a WDL_ConvolutionEngine_Div, so the latency is the head's. Each tail stage convolves a later
+ * section of the impulse with larger uniform partitions, on its own worker thread. A tail stage with block size B at offset O is handed a
+ * block of input once it has B new samples, and its output is not needed until some O - B samples later, which is the worker's deadline.
+ * If a worker misses it, the audio thread waits for the result, so the output is always correct, and the miss is counted by GetNumLateBlocks().
+ *
+ * Call SetImpulse() and Reset() from OnReset(), not the audio thread, and report GetLatency() with SetLatency(). Nothing is allocated by ProcessBlock().
+ * As with WDL_ConvolutionEngine, define WDL_FFT_REALSIZE to match the sample type before including this.
+ * To use a faster FFT backend for the engines, see IPLUG_FFT_CONVOLUTION_HOOK in FFT.h */
+class PartitionedConvolutionEngine
+{
+public:
+  static constexpr int kMinTailBlockSize = 64;
+  static constexpr int kMaxTailBlockSize = 16384; // WDL's largest FFT is twice this
+
+  /** A section of the impulse convolved by a worker thread, from offset up to the next partition's offset, or the end of the impulse */
+  struct TailPartition
+  {
+    int offset;
+    int blockSize; // a power of two, between kMinTailBlockSize and kMaxTailBlockSize
+  };
+
+  /** How the impulse is split up. The head covers everything before the first tail partition */
+  struct Scheme
+  {
+    int headLatency = 0; // the latency allowed for the head, which makes it cheaper
+    int headMaxBlockSize = 4096; // the largest partition of the head
+    std::vector<TailPartition> tail;
+#ifdef OS_WEB
+    bool multithreaded = false; // true to convolve the tail on worker threads, where they are available
+#else
+    bool multithreaded = true; // false to convolve the tail on the audio thread, e.g. where threads are not available
+#endif
+  };
+
+  /** Make a scheme where the tail block size grows by a factor of growth from partition to partition. Each partition starts at least twice its
+   * block size plus the host block size into the impulse, so that its worker gets at least a whole block of time before its output is due
+   * @param irLength The length of the impulse in samples
+   * @param maxBlockSize The largest host block size
+   * @param firstTailBlockSize The block size of the first tail partition, which is also the head's largest partition
+   * @param maxTailBlockSize The largest block size, clipped to kMaxTailBlockSize
+   * @param growth The ratio between one tail partition's block size and the next
+   * @param headLatency The latency allowed for the head
+   * @return The scheme, with no tail partitions if the impulse is short enough for the head alone */
+  static Scheme MakeScheme(int irLength, int maxBlockSize, int firstTailBlockSize = 2048, int maxTailBlockSize = kMaxTailBlockSize, int growth = 4, int headLatency = 0)
+  {
+    Scheme scheme;
+    scheme.headLatency = headLatency;
+    scheme.headMaxBlockSize = firstTailBlockSize;
+
+    maxTailBlockSize = std::min(maxTailBlockSize, kMaxTailBlockSize);
+    int blockSize = RoundUpToPowerOf2(std::max(firstTailBlockSize, kMinTailBlockSize));
+    int offset = 2 * blockSize + maxBlockSize;
+
+    while (offset < irLength)
+    {
+      scheme.tail.push_back({offset, blockSize});
+
+      const int nextBlockSize = std::min(RoundUpToPowerOf2(blockSize * std::max(growth, 2)), maxTailBlockSize);
+
+      if (nextBlockSize == blockSize)
+        break;
+
+      // whole blocks of this partition up to where the next one can start
+      const int nextOffset = 2 * nextBlockSize + maxBlockSize;
+      offset += std::max((nextOffset - offset + blockSize - 1) / blockSize, 1) * blockSize;
+      blockSize = nextBlockSize;
+    }
+
+    return scheme;
+  }
+
+  PartitionedConvolutionEngine() = default;
+
+  ~PartitionedConvolutionEngine()
+  {
+    StopWorkers();
+  }
+
+  PartitionedConvolutionEngine(const PartitionedConvolutionEngine&) = delete;
+  PartitionedConvolutionEngine& operator=(const PartitionedConvolutionEngine&) = delete;
+
+  /** Set the impulse with a scheme from MakeScheme()
+   * @param pImpulse The impulse, which is copied, so it can be freed or changed afterwards
+   * @param nChans The number of channels that will be processed. Channels beyond the impulse's use its channels again, from the first
+   * @param maxBlockSize The largest number of frames that will be passed to ProcessBlock() */
+  void SetImpulse(WDL_ImpulseBuffer* pImpulse, int nChans, int maxBlockSize)
+  {
+    SetImpulse(pImpulse, nChans, maxBlockSize, MakeScheme(pImpulse->GetLength(), maxBlockSize));
+  }
+
+  /** Set the impulse and how it is partitioned. This stops and restarts the worker threads.
+   * Tail partitions that start beyond the end of the impulse are dropped, and offsets are moved up to at least the block size, which is the least that is workable
+   * @param pImpulse The impulse, which is copied, so it can be freed or changed afterwards
+   * @param nChans The number of channels that will be processed. Channels beyond the impulse's use its channels again, from the first
+   * @param maxBlockSize The largest number of frames that will be passed to ProcessBlock()
+   * @param scheme How the impulse is partitioned */
+  void SetImpulse(WDL_ImpulseBuffer* pImpulse, int nChans, int maxBlockSize, const Scheme& scheme)
+  {
+    StopWorkers();
+
+    const int irLength = pImpulse->GetLength();
+    mNChans = nChans;
+    mMaxBlockSize = std::max(maxBlockSize, 1);
+    mScheme = scheme;
+    mScheme.tail.clear();
+
+    int prevOffset = 0;
+
+    for (auto partition : scheme.tail)
+    {
+      partition.blockSize = Clip(RoundUpToPowerOf2(partition.blockSize), kMinTailBlockSize, kMaxTailBlockSize);
+      partition.offset = std::max({partition.offset, partition.blockSize, prevOffset + 1});
+
+      if (partition.offset >= irLength)
+        break;
+
+      mScheme.tail.push_back(partition);
+      prevOffset = partition.offset;
+    }
+
+    const int headLength = mScheme.tail.empty() ? irLength : mScheme.tail[0].offset;
+    mHead.SetImpulse(pImpulse, mScheme.headMaxBlockSize, mMaxBlockSize, headLength, 0, mScheme.headLatency);
+    mLatency = mHead.GetLatency();
+
+    mStages.clear();
+
+    for (auto i = 0; i < static_cast<int>(mScheme.tail.size()); i++)
+    {
+      const TailPartition& partition = mScheme.tail[i];
+      const int end = i + 1 < static_cast<int>(mScheme.tail.size()) ? mScheme.tail[i + 1].offset : irLength;
+      std::unique_ptr<TailStage> pStage(new TailStage);
+
+      pStage->mBlockSize = partition.blockSize;
+      pStage->mDelay = partition.offset + mLatency;
+      // enough blocks that neither the worker nor the audio thread can overwrite a block the other one still needs
+      pStage->mNumBlocks = (pStage->mDelay + mMaxBlockSize) / partition.blockSize + 2;
+      pStage->mRingSize = pStage->mNumBlocks * partition.blockSize;
+      pStage->mInput.Resize(nChans * pStage->mRingSize);
+      pStage->mOutput.Resize(nChans * pStage->mRingSize);
+      pStage->mPtrs.Resize(nChans);
+      pStage->mEngine.SetImpulse(pImpulse, 2 * partition.blockSize, partition.offset, end - partition.offset);
+      mStages.push_back(std::move(pStage));
+    }
+
+    mPtrs.Resize(nChans);
+    UpdateMemory(pImpulse->GetNumChannels(), irLength);
+    Reset();
+    StartWorkers();
+  }
+
+  /** Count the engine's memory against IMemoryStats::kImpulses. Call this before SetImpulse(), or from the same thread as it
+   * @param pStats The stats, e.g. the plug-in's GetMemoryStats(), or nullptr to stop counting */
+  void SetMemoryStats(IMemoryStats* pStats)
+  {
+    mMemoryStats = pStats;
+    mMemory.Set(pStats, IMemoryStats::kImpulses, mMemory.GetBytes());
+  }
+
+  /** @return The latency in samples, which is the head's allowed latency as rounded by WDL_ConvolutionEngine_Div */
+  int GetLatency() const { return mLatency; }
+
+  /** @return The scheme in use, after the adjustments made by SetImpulse() */
+  const Scheme& GetScheme() const { return mScheme; }
+
+  /** @return The number of times the audio thread had to wait for a worker since the last Reset(). This can be called from any thread */
+  int GetNumLateBlocks() const { return mNumLateBlocks.load(std::memory_order_relaxed); }
+
+  /** Clear any latent samples. Call this when the audio thread is not processing, it waits for the workers to finish what they were given */
+  void Reset()
+  {
+    for (auto& pStage : mStages)
+    {
+      while (pStage->mDone.load(std::memory_order_acquire) < pStage->mSubmitted.load(std::memory_order_relaxed))
+        std::this_thread::yield();
+
+      pStage->mEngine.Reset();
+      memset(pStage->mInput.Get(), 0, pStage->mInput.GetSize() * sizeof(WDL_FFT_REAL));
+      memset(pStage->mOutput.Get(), 0, pStage->mOutput.GetSize() * sizeof(WDL_FFT_REAL));
+      pStage->mSubmitted.store(0, std::memory_order_relaxed);
+      pStage->mDone.store(0, std::memory_order_release);
+    }
+
+    mHead.Reset();
+    mPos = 0;
+    mNumLateBlocks.store(0, std::memory_order_relaxed);
+  }
+
+  /** Convolve a block. The outputs are the wet signal only, and can be the same buffers as the inputs
+   * @param inputs The input buffers, one per channel
+   * @param outputs The output buffers, one per channel
+   * @param nFrames The number of frames, which can be more than the maxBlockSize passed to SetImpulse(), in which case it is split up */
+  void ProcessBlock(WDL_FFT_REAL** inputs, WDL_FFT_REAL** outputs, int nFrames)
+  {
+    for (auto start = 0; start < nFrames; start += mMaxBlockSize)
+    {
+      const int n = std::min(nFrames - start, mMaxBlockSize);
+      WDL_FFT_REAL** ptrs = mPtrs.Get();
+
+      for (auto c = 0; c < mNChans; c++)
+        ptrs[c] = inputs[c] + start;
+
+      for (auto& pStage : mStages)
+        WriteInput(*pStage, ptrs, n);
+
+      ProcessHead(ptrs, outputs, start, n);
+
+      for (auto& pStage : mStages)
+        ReadOutput(*pStage, outputs, start, n);
+
+      mPos += n;
+    }
+  }
+
+private:
+  void UpdateMemory(int nImpulseChans, int irLength)
+  {
+    // the rings are exact, but WDL's engines don't expose their buffers, so they are estimated as a spectrum of the impulse per impulse channel and of the input per channel
+    int64_t bytes = static_cast<int64_t>(nImpulseChans + mNChans) * irLength * 2 * sizeof(WDL_FFT_REAL);
+
+    for (const auto& pStage : mStages)
+      bytes += static_cast<int64_t>(pStage->mInput.GetSize() + pStage->mOutput.GetSize()) * sizeof(WDL_FFT_REAL);
+
+    mMemory.Set(mMemoryStats, IMemoryStats::kImpulses, bytes);
+  }
+
+  /** One tail partition. The input and output are rings of mNumBlocks blocks per channel, block k being written to slot k % mNumBlocks.
+   * The audio thread owns mInput up to mSubmitted blocks, and the worker owns mOutput up to mDone blocks */
+  struct TailStage
+  {
+    WDL_ConvolutionEngine mEngine;
+    WDL_TypedBuf<WDL_FFT_REAL> mInput;
+    WDL_TypedBuf<WDL_FFT_REAL> mOutput;
+    WDL_TypedBuf<WDL_FFT_REAL*> mPtrs;
+    int mBlockSize = 0;
+    int mNumBlocks = 0;
+    int mRingSize = 0;
+    int64_t mDelay = 0; // the partition's offset plus the latency, in samples
+
+    std::thread mWorker;
+    std::mutex mMutex;
+    std::condition_variable mWakeUp;
+    char mPad0[IPLUG_CACHE_LINE_SIZE];
+    std::atomic<int64_t> mSubmitted {0}; // the number of blocks of input handed to the worker
+    char mPad1[IPLUG_CACHE_LINE_SIZE];
+    std::atomic<int64_t> mDone {0}; // the number of blocks of output the worker has finished
+  };
+
+  static int RoundUpToPowerOf2(int x)
+  {
+    int p = 1;
+
+    while (p < x)
+      p <<= 1;
+
+    return p;
+  }
+
+  void WriteInput(TailStage& stage, WDL_FFT_REAL** inputs, int nFrames)
+  {
+    const int ringPos = static_cast<int>(mPos % stage.mRingSize);
+    const int n1 = std::min(nFrames, stage.mRingSize - ringPos);
+
+    for (auto c = 0; c < mNChans; c++)
+    {
+      WDL_FFT_REAL* pRing = stage.mInput.Get() + c * stage.mRingSize;
+      memcpy(pRing + ringPos, inputs[c], n1 * sizeof(WDL_FFT_REAL));
+      memcpy(pRing, inputs[c] + n1, (nFrames - n1) * sizeof(WDL_FFT_REAL));
+    }
+
+    const int64_t nComplete = (mPos + nFrames) / stage.mBlockSize;
+
+    if (nComplete == stage.mSubmitted.load(std::memory_order_relaxed))
+      return;
+
+    if (!mScheme.multithreaded)
+    {
+      while (stage.mDone.load(std::memory_order_relaxed) < nComplete)
+        ConvolveBlock(stage);
+
+      stage.mSubmitted.store(nComplete, std::memory_order_relaxed);
+      return;
+    }
+
+    stage.mSubmitted.store(nComplete, std::memory_order_release);
+
+    // the worker waits with a timeout, which covers a wake up that is missed because the audio thread never blocks on the lock
+    if (stage.mMutex.try_lock())
+      stage.mMutex.unlock();
+
+    stage.mWakeUp.notify_one();
+  }
+
+  void ProcessHead(WDL_FFT_REAL** inputs, WDL_FFT_REAL** outputs, int start, int nFrames)
+  {
+    mHead.Add(inputs, nFrames, mNChans);
+
+    // silence until the latency has passed, after which WDL_ConvolutionEngine_Div always has the samples
+    const int nWanted = static_cast<int>(std::min<int64_t>(nFrames, std::max<int64_t>(0, mPos + nFrames - mLatency)));
+    const int nAvail = nWanted ? std::min(mHead.Avail(nWanted), nWanted) : 0;
+    const int nSilent = nFrames - nAvail;
+    WDL_FFT_REAL** wet = nAvail ? mHead.Get() : nullptr;
+
+    for (auto c = 0; c < mNChans; c++)
+    {
+      memset(outputs[c] + start, 0, nSilent * sizeof(WDL_FFT_REAL));
+
+      if (nAvail)
+        memcpy(outputs[c] + start + nSilent, wet[c], nAvail * sizeof(WDL_FFT_REAL));
+    }
+
+    if (nAvail)
+      mHead.Advance(nAvail);
+  }
+
+  void ReadOutput(TailStage& stage, WDL_FFT_REAL** outputs, int start, int nFrames)
+  {
+    // the stage's output for time t is sample t - mDelay of its output stream
+    const int64_t first = std::max<int64_t>(mPos, stage.mDelay);
+    const int64_t last = mPos + nFrames;
+
+    if (first >= last)
+      return;
+
+    const int64_t lastBlock = (last - 1 - stage.mDelay) / stage.mBlockSize;
+
+    if (stage.mDone.load(std::memory_order_acquire) <= lastBlock)
+    {
+      mNumLateBlocks.fetch_add(1, std::memory_order_relaxed);
+
+      while (stage.mDone.load(std::memory_order_acquire) <= lastBlock)
+        std::this_thread::yield();
+    }
+
+    const int offset = static_cast<int>(first - mPos);
+    const int n = static_cast<int>(last - first);
+    const int ringPos = static_cast<int>((first - stage.mDelay) % stage.mRingSize);
+    const int n1 = std::min(n, stage.mRingSize - ringPos);
+
+    for (auto c = 0; c < mNChans; c++)
+    {
+      const WDL_FFT_REAL* pRing = stage.mOutput.Get() + c * stage.mRingSize;
+      WDL_FFT_REAL* pOutput = outputs[c] + start + offset;
+
+      for (auto s = 0; s < n1; s++)
+        pOutput[s] += pRing[ringPos + s];
+
+      for (auto s = n1; s < n; s++)
+        pOutput[s] += pRing[s - n1];
+    }
+  }
+
+  /** Convolve the next submitted block of a stage, on its worker or, if not multithreaded, the audio thread */
+  void ConvolveBlock(TailStage& stage)
+  {
+    const int64_t block = stage.mDone.load(std::memory_order_relaxed);
+    const int ringPos = static_cast<int>(block % stage.mNumBlocks) * stage.mBlockSize;
+    WDL_FFT_REAL** ptrs = stage.mPtrs.Get();
+
+    for (auto c = 0; c < mNChans; c++)
+      ptrs[c] = stage.mInput.Get() + c * stage.mRingSize + ringPos;
+
+    // with an FFT of twice the block size, a whole block in gives a whole block out
+    stage.mEngine.Add(ptrs, stage.mBlockSize, mNChans);
+    const int nAvail = std::min(stage.mEngine.Avail(stage.mBlockSize), stage.mBlockSize);
+    WDL_FFT_REAL** wet = stage.mEngine.Get();
+
+    for (auto c = 0; c < mNChans; c++)
+    {
+      WDL_FFT_REAL* pOutput = stage.mOutput.Get() + c * stage.mRingSize + ringPos;
+      memcpy(pOutput, wet[c], nAvail * sizeof(WDL_FFT_REAL));
+      memset(pOutput + nAvail, 0, (stage.mBlockSize - nAvail) * sizeof(WDL_FFT_REAL));
+    }
+
+    stage.mEngine.Advance(nAvail);
+    stage.mDone.store(block + 1, std::memory_order_release);
+  }
+
+  void WorkerLoop(TailStage* pStage)
+  {
+    TailStage& stage = *pStage;
+
+    while (mRunning.load(std::memory_order_relaxed))
+    {
+      if (stage.mDone.load(std::memory_order_relaxed) < stage.mSubmitted.load(std::memory_order_acquire))
+      {
+        ConvolveBlock(stage);
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock(stage.mMutex);
+      stage.mWakeUp.wait_for(lock, std::chrono::milliseconds(2), [&]() {
+        return !mRunning.load(std::memory_order_relaxed) || stage.mDone.load(std::memory_order_relaxed) < stage.mSubmitted.load(std::memory_order_acquire);
+      });
+    }
+  }
+
+  void StartWorkers()
+  {
+    if (!mScheme.multithreaded)
+      return;
+
+    mRunning = true;
+
+    for (auto& pStage : mStages)
+      pStage->mWorker = std::thread(&PartitionedConvolutionEngine::WorkerLoop, this, pStage.get());
+  }
+
+  void StopWorkers()
+  {
+    mRunning = false;
+
+    for (auto& pStage : mStages)
+    {
+      {
+        std::lock_guard<std::mutex> lock(pStage->mMutex);
+      }
+
+      pStage->mWakeUp.notify_all();
+
+      if (pStage->mWorker.joinable())
+        pStage->mWorker.join();
+    }
+  }
+
+  WDL_ConvolutionEngine_Div mHead;
+  std::vector<std::unique_ptr<TailStage>> mStages;
+  WDL_TypedBuf<WDL_FFT_REAL*> mPtrs;
+  Scheme mScheme;
+  int mNChans = 0;
+  int mMaxBlockSize = 1;
+  int mLatency = 0;
+  int64_t mPos = 0; // samples processed since Reset()
+  std::atomic<int> mNumLateBlocks {0};
+  std::atomic<bool> mRunning {false};
+  IMemoryStats* mMemoryStats = nullptr;
+  IMemoryStats::Allocation mMemory;
+};
+
+/** Wraps PartitionedConvolutionEngine so that impulses can be changed while processing, e.g. when browsing impulses, without glitches or blocking the audio thread.
+ * Impulses are decoded, resampled and prepared by a loader thread into a spare engine, which is handed to the audio thread with an atomic pointer exchange.
+ * The audio thread then crossfades from the old engine to the new one, after which the old engine is handed back to the loader for reuse.
+ * If impulses are loaded faster than they can be swapped in, only the latest is kept. Three engines are enough for one to be fading out, one to be fading in and one to be loading */
+class CrossfadingConvolutionEngine
+{
+public:
+  /** Fills the impulse, on the loader thread. It should return false if there is no impulse, e.g. if a file could not be decoded */
+  using PrepareFunc = std::function<bool(WDL_ImpulseBuffer& impulse)>;
+
+  /** @param crossfadeLength The length of the crossfade from one impulse to the next, in samples
+   * @param headLatency The latency allowed for the head of each engine, see PartitionedConvolutionEngine::Scheme */
+  CrossfadingConvolutionEngine(int crossfadeLength = 1024, int headLatency = 0)
+  : mCrossfadeLength(std::max(crossfadeLength, 1))
+  , mHeadLatency(headLatency)
+  {
+    for (auto i = 0; i < kNumEngines; i++)
+    {
+      mEngines[i].reset(new PartitionedConvolutionEngine);
+      mFree[i].store(true, std::memory_order_relaxed);
+    }
+
+    mLoader = std::thread(&CrossfadingConvolutionEngine::LoaderLoop, this);
+  }
+
+  ~CrossfadingConvolutionEngine()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mRunning = false;
+    }
+
+    mWakeUp.notify_all();
+    mLoader.join();
+  }
+
+  CrossfadingConvolutionEngine(const CrossfadingConvolutionEngine&) = delete;
+  CrossfadingConvolutionEngine& operator=(const CrossfadingConvolutionEngine&) = delete;
+
+  /** Set the channel count and block size, dropping any impulse, as the engines have to be prepared for them. Call this from OnReset(), and then LoadImpulse() again
+   * @param nChans The number of channels that will be processed
+   * @param maxBlockSize The largest number of frames that will be passed to ProcessBlock() */
+  void Reset(int nChans, int maxBlockSize)
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mIdle.wait(lock, [&]() { return !mRequest && !mLoading; });
+
+    mNChans = nChans;
+    mMaxBlockSize = std::max(maxBlockSize, 1);
+    mPending.store(nullptr, std::memory_order_relaxed);
+    mActive = mFading = -1;
+
+    for (auto i = 0; i < kNumEngines; i++)
+      mFree[i].store(true, std::memory_order_relaxed);
+
+    mFadeBuffer.Resize(nChans * mMaxBlockSize);
+    mFadePtrs.Resize(nChans);
+    mInputPtrs.Resize(nChans);
+    mOutputPtrs.Resize(nChans);
+  }
+
+  /** Count the engines' memory against IMemoryStats::kImpulses. Call this before the first LoadImpulse(), e.g. in the plug-in's constructor
+   * @param pStats The stats, e.g. the plug-in's GetMemoryStats(), or nullptr to stop counting */
+  void SetMemoryStats(IMemoryStats* pStats)
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mIdle.wait(lock, [&]() { return !mRequest && !mLoading; });
+
+    for (auto i = 0; i < kNumEngines; i++)
+      mEngines[i]->SetMemoryStats(pStats);
+  }
+
+  /** Load an impulse in the background, replacing any load that has not started yet. This can be called from any thread except the audio thread
+   * @param prepare Fills the impulse, on the loader thread */
+  void LoadImpulse(PrepareFunc prepare)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mRequest = std::move(prepare);
+    }
+
+    mWakeUp.notify_all();
+  }
+
+  /** Block until the last impulse passed to LoadImpulse() is ready, e.g. in OnReset() so that rendering starts with it */
+  void WaitUntilLoaded()
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+    mIdle.wait(lock, [&]() { return !mRequest && !mLoading; });
+  }
+
+  /** @return true if an impulse is being prepared or waiting to be prepared */
+  bool IsLoading() const
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mRequest || mLoading;
+  }
+
+  /** @return The latency of the last impulse loaded, to report with SetLatency(). It only changes with the block size or head latency */
+  int GetLatency() const { return mLatency.load(std::memory_order_relaxed); }
+
+  /** Convolve a block with the current impulse, crossfading to a newly loaded one if there is one. The outputs are the wet signal only, silent until an impulse is loaded
+   * @param inputs The input buffers, one per channel
+   * @param outputs The output buffers, one per channel, which can be the same buffers as the inputs
+   * @param nFrames The number of frames */
+  void ProcessBlock(WDL_FFT_REAL** inputs, WDL_FFT_REAL** outputs, int nFrames)
+  {
+    for (auto start = 0; start < nFrames; start += mMaxBlockSize)
+    {
+      const int n = std::min(nFrames - start, mMaxBlockSize);
+      WDL_FFT_REAL** ins = mInputPtrs.Get();
+      WDL_FFT_REAL** outs = mOutputPtrs.Get();
+
+      for (auto c = 0; c < mNChans; c++)
+      {
+        ins[c] = inputs[c] + start;
+        outs[c] = outputs[c] + start;
+      }
+
+      ProcessChunk(ins, outs, n);
+    }
+  }
+
+private:
+  static constexpr int kNumEngines = 3;
+
+  void ProcessChunk(WDL_FFT_REAL** inputs, WDL_FFT_REAL** outputs, int nFrames)
+  {
+    // only swap once the last crossfade has finished, so that one engine is always free for the loader
+    if (mFading < 0)
+    {
+      if (PartitionedConvolutionEngine* pNew = mPending.exchange(nullptr, std::memory_order_acq_rel))
+      {
+        mFading = mActive;
+        mFadePos = 0;
+        mActive = IndexOf(pNew);
+      }
+    }
+
+    if (mActive < 0)
+    {
+      for (auto c = 0; c < mNChans; c++)
+        memset(outputs[c], 0, nFrames * sizeof(WDL_FFT_REAL));
+
+      return;
+    }
+
+    if (mFading < 0)
+    {
+      mEngines[mActive]->ProcessBlock(inputs, outputs, nFrames);
+      return;
+    }
+
+    // the old engine first, as the outputs may be the inputs
+    WDL_FFT_REAL** fade = mFadePtrs.Get();
+
+    for (auto c = 0; c < mNChans; c++)
+      fade[c] = mFadeBuffer.Get() + c * mMaxBlockSize;
+
+    mEngines[mFading]->ProcessBlock(inputs, fade, nFrames);
+    mEngines[mActive]->ProcessBlock(inputs, outputs, nFrames);
+
+    const WDL_FFT_REAL step = static_cast<WDL_FFT_REAL>(1.) / mCrossfadeLength;
+
+    for (auto c = 0; c < mNChans; c++)
+    {
+      for (auto s = 0; s < nFrames; s++)
+      {
+        const WDL_FFT_REAL gain = std::min((mFadePos + s) * step, static_cast<WDL_FFT_REAL>(1.));
+        outputs[c][s] = fade[c][s] + gain * (outputs[c][s] - fade[c][s]);
+      }
+    }
+
+    mFadePos += nFrames;
+
+    if (mFadePos >= mCrossfadeLength)
+    {
+      mFree[mFading].store(true, std::memory_order_release);
+      mFading = -1;
+    }
+  }
+
+  int IndexOf(const PartitionedConvolutionEngine* pEngine) const
+  {
+    for (auto i = 0; i < kNumEngines; i++)
+    {
+      if (mEngines[i].get() == pEngine)
+        return i;
+    }
+
+    return -1;
+  }
+
+  /** @return The index of an engine that is not in use by the audio thread, taking the pending one back if need be */
+  int ClaimEngine()
+  {
+    while (true)
+    {
+      for (auto i = 0; i < kNumEngines; i++)
+      {
+        bool free = true;
+
+        if (mFree[i].compare_exchange_strong(free, false, std::memory_order_acquire))
+          return i;
+      }
+
+      // one engine fading in and another fading out, so the third must be pending, unless the audio thread has just swapped it in
+      if (PartitionedConvolutionEngine* pPending = mPending.exchange(nullptr, std::memory_order_acquire))
+        return IndexOf(pPending);
+
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+
+  void LoaderLoop()
+  {
+    std::unique_lock<std::mutex> lock(mMutex);
+
+    while (true)
+    {
+      mWakeUp.wait(lock, [&]() { return !mRunning || mRequest; });
+
+      if (!mRunning)
+        return;
+
+      PrepareFunc prepare = std::move(mRequest);
+      mRequest = nullptr;
+      mLoading = true;
+      const int nChans = mNChans;
+      const int maxBlockSize = mMaxBlockSize;
+      lock.unlock();
+
+      if (prepare(mImpulse) && mImpulse.GetLength() > 0 && nChans > 0)
+      {
+        const int idx = ClaimEngine();
+        PartitionedConvolutionEngine& engine = *mEngines[idx];
+        engine.SetImpulse(&mImpulse, nChans, maxBlockSize, PartitionedConvolutionEngine::MakeScheme(mImpulse.GetLength(), maxBlockSize, 2048, PartitionedConvolutionEngine::kMaxTailBlockSize, 4, mHeadLatency));
+        mLatency.store(engine.GetLatency(), std::memory_order_relaxed);
+
+        // an older impulse that was never swapped in goes straight back to the loader
+        if (PartitionedConvolutionEngine* pOld = mPending.exchange(&engine, std::memory_order_acq_rel))
+          mFree[IndexOf(pOld)].store(true, std::memory_order_release);
+      }
+
+      lock.lock();
+      mLoading = false;
+      mIdle.notify_all();
+    }
+  }
+
+  std::unique_ptr<PartitionedConvolutionEngine> mEngines[kNumEngines];
+  std::atomic<bool> mFree[kNumEngines];
+  std::atomic<PartitionedConvolutionEngine*> mPending {nullptr};
+  std::atomic<int> mLatency {0};
+
+  // audio thread
+  int mActive = -1;
+  int mFading = -1;
+  int mFadePos = 0;
+  WDL_TypedBuf<WDL_FFT_REAL> mFadeBuffer;
+  WDL_TypedBuf<WDL_FFT_REAL*> mFadePtrs;
+  WDL_TypedBuf<WDL_FFT_REAL*> mInputPtrs;
+  WDL_TypedBuf<WDL_FFT_REAL*> mOutputPtrs;
+  const int mCrossfadeLength;
+  const int mHeadLatency;
+  int mNChans = 0;
+  int mMaxBlockSize = 1;
+
+  // loader thread, guarded by mMutex apart from mImpulse
+  WDL_ImpulseBuffer mImpulse;
+  PrepareFunc mRequest;
+  bool mLoading = false;
+  bool mRunning = true;
+  std::thread mLoader;
+  mutable std::mutex mMutex;
+  std::condition_variable mWakeUp;
+  std::condition_variable mIdle;
+};
+
+END_IPLUG_NAMESPACE
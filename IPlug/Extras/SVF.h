@@ -19,6 +19,7 @@
 #include <complex>
 
 #include "IPlugPlatform.h"
+#include "IPlugUtilities.h"
 
 BEGIN_IPLUG_NAMESPACE
 
@@ -98,45 +99,141 @@ public:
   void ProcessBlock(T** inputs, T** outputs, int nChans, int nFrames)
   {
     assert(nChans <= NC);
+    DispatchNChans(nChans, [&](auto fixed) { ProcessBlockT<decltype(fixed)::value>(inputs, outputs, nChans, nFrames); });
+  }
+
+  /** Process a block with a channel count that is known at compile time, so that the loop over the channels is unrolled
+   * @tparam NCHANS The number of channels to process, less than or equal to NC */
+  template <int NCHANS>
+  void ProcessBlock(T** inputs, T** outputs, int nFrames)
+  {
+    static_assert(NCHANS > 0 && NCHANS <= NC, "NCHANS must be between 1 and NC");
+    ProcessBlockT<NCHANS>(inputs, outputs, NCHANS, nFrames);
+  }
+  
+  /** Process a block with the cutoff modulated every sample. The mode, Q and gain are still set at block rate, but the coefficients that
+   * depend on the cutoff are recalculated per sample with FastTan(), rather than std::tan(). The channels are processed together in the inner
+   * loop, so that the compiler can vectorise across them
+   * @param inputs The input buffers, one per channel
+   * @param outputs The output buffers, one per channel
+   * @param freqCPS The cutoff frequency in Hz for each sample, shared by all channels
+   * @param nChans The number of channels to process, less than or equal to NC
+   * @param nFrames The number of samples per channel */
+  void ProcessBlock(T** inputs, T** outputs, const T* freqCPS, int nChans, int nFrames)
+  {
+    assert(nChans <= NC);
+    DispatchNChans(nChans, [&](auto fixed) { ProcessBlockModulatedT<decltype(fixed)::value>(inputs, outputs, freqCPS, nChans, nFrames); });
+  }
+
+  /** Process a block with the cutoff modulated every sample, with a channel count that is known at compile time
+   * @tparam NCHANS The number of channels to process, less than or equal to NC */
+  template <int NCHANS>
+  void ProcessBlock(T** inputs, T** outputs, const T* freqCPS, int nFrames)
+  {
+    static_assert(NCHANS > 0 && NCHANS <= NC, "NCHANS must be between 1 and NC");
+    ProcessBlockModulatedT<NCHANS>(inputs, outputs, freqCPS, NCHANS, nFrames);
+  }
+  
+  /** A rational approximation of tan(), from the continued fraction, with a relative error below 1e-8 up to 1.5 radians, which is
+   * about 0.48 times the sample rate when used for the cutoff
+   * @param x The angle in radians, between 0 and 1.5
+   * @return tan(x) */
+  static inline double FastTan(double x)
+  {
+    const double x2 = x * x;
+    return x * (135135. + x2 * (-17325. + x2 * (378. - x2))) / (135135. + x2 * (-62370. + x2 * (3150. - 28. * x2)));
+  }
+
+  void Reset()
+  {
+    for (auto c = 0; c < NC; c++)
+    {
+      mIc1eq[c] = 0.;
+      mIc2eq[c] = 0.;
+    }
+  }
 
+private:
+  /** The body of ProcessBlock(). NCHANS is the number of channels if it is known at compile time, or 0 to use nChans */
+  template <int NCHANS>
+  void ProcessBlockT(T** inputs, T** outputs, int nChans, int nFrames)
+  {
     if(mState != mNewState)
       UpdateCoefficients();
 
-    for (auto c = 0; c < nChans; c++)
+    const int n = NCHANS ? NCHANS : nChans;
+    const double a1 = m_a1, a2 = m_a2, a3 = m_a3;
+    const double m0 = m_m0, m1 = m_m1, m2 = m_m2;
+    // the state is kept in locals for the block, so that it can stay in registers
+    double ic1eq[NC], ic2eq[NC];
+
+    for (auto c = 0; c < n; c++)
+    {
+      ic1eq[c] = mIc1eq[c];
+      ic2eq[c] = mIc2eq[c];
+    }
+
+    for (auto s = 0; s < nFrames; s++)
     {
-      for (auto s = 0; s < nFrames; s++)
+      for (auto c = 0; c < n; c++)
       {
         const double v0 = (double) inputs[c][s];
+        const double v3 = v0 - ic2eq[c];
+        const double v1 = a1 * ic1eq[c] + a2 * v3;
+        const double v2 = ic2eq[c] + a2 * ic1eq[c] + a3 * v3;
+        ic1eq[c] = 2. * v1 - ic1eq[c];
+        ic2eq[c] = 2. * v2 - ic2eq[c];
 
-        mV3[c] = v0 - mIc2eq[c];
-        mV1[c] = m_a1 * mIc1eq[c] + m_a2*mV3[c];
-        mV2[c] = mIc2eq[c] + m_a2 * mIc1eq[c] + m_a3 * mV3[c];
-        mIc1eq[c] = 2. * mV1[c] - mIc1eq[c];
-        mIc2eq[c] = 2. * mV2[c] - mIc2eq[c];
-
-        outputs[c][s] = (T) m_m0 * v0 + m_m1 * mV1[c] + m_m2 * mV2[c];
+        outputs[c][s] = (T) (m0 * v0 + m1 * v1 + m2 * v2);
       }
     }
+
+    for (auto c = 0; c < n; c++)
+    {
+      mIc1eq[c] = ic1eq[c];
+      mIc2eq[c] = ic2eq[c];
+    }
   }
 
-  void Reset()
+  /** The body of the modulated ProcessBlock(). NCHANS is the number of channels if it is known at compile time, or 0 to use nChans */
+  template <int NCHANS>
+  void ProcessBlockModulatedT(T** inputs, T** outputs, const T* freqCPS, int nChans, int nFrames)
   {
-    for (auto c = 0; c < NC; c++)
+    if(mState != mNewState)
+      UpdateCoefficients();
+
+    const int n = NCHANS ? NCHANS : nChans;
+    const double k = 1. / mState.Q;
+    const double piOverSR = PI / mState.sampleRate;
+    const double maxFreq = std::min(20000., 0.48 * mState.sampleRate);
+
+    for (auto s = 0; s < nFrames; s++)
     {
-      mV1[c] = 0.;
-      mV2[c] = 0.;
-      mV3[c] = 0.;
-      mIc1eq[c] = 0.;
-      mIc2eq[c] = 0.;
+      const double g = FastTan(piOverSR * Clip((double) freqCPS[s], 10., maxFreq)) * mGScale;
+      const double a1 = 1./(1. + g * (g + k));
+      const double a2 = g * a1;
+      const double a3 = g * a2;
+
+      for (auto c = 0; c < n; c++)
+      {
+        const double v0 = (double) inputs[c][s];
+        const double v3 = v0 - mIc2eq[c];
+        const double v1 = a1 * mIc1eq[c] + a2 * v3;
+        const double v2 = mIc2eq[c] + a2 * mIc1eq[c] + a3 * v3;
+        mIc1eq[c] = 2. * v1 - mIc1eq[c];
+        mIc2eq[c] = 2. * v2 - mIc2eq[c];
+
+        outputs[c][s] = (T) (m_m0 * v0 + m_m1 * v1 + m_m2 * v2);
+      }
     }
   }
 
-private:
   void UpdateCoefficients()
   {
     mState = mNewState;
 
     const double w = std::tan(PI * mState.freq/mState.sampleRate);
+    mGScale = 1.;
 
     switch(mState.mode)
     {
@@ -216,7 +313,8 @@ private:
       case kLowPassShelf:
       {
         const double A = std::pow(10., mState.gain/40.);
-        const double g = w / std::sqrt(A);
+        mGScale = 1. / std::sqrt(A);
+        const double g = w * mGScale;
         const double k = 1. / mState.Q;
         m_a1 = 1./(1. + g * (g + k));
         m_a2 = g * m_a1;
@@ -229,7 +327,8 @@ private:
       case kHighPassShelf:
       {
         const double A = std::pow(10., mState.gain/40.);
-        const double g = w / std::sqrt(A);
+        mGScale = 1. / std::sqrt(A);
+        const double g = w * mGScale;
         const double k = 1. / mState.Q;
         m_a1 = 1./(1. + g * (g + k));
         m_a2 = g * m_a1;
@@ -245,9 +344,6 @@ private:
   }
 
 private:
-  double mV1[NC] = {};
-  double mV2[NC] = {};
-  double mV3[NC] = {};
   double mIc1eq[NC] = {};
   double mIc2eq[NC] = {};
   double m_a1 = 0.;
@@ -256,6 +352,7 @@ private:
   double m_m0 = 0.;
   double m_m1 = 0.;
   double m_m2 = 0.;
+  double mGScale = 1.; // the shelves scale the cutoff by 1 / sqrt(A)
 
   struct Settings
   {
@@ -0,0 +1,156 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc SharedData
+ */
+
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+
+#include "IPlugPlatform.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** A process wide registry of immutable DSP data, such as lookup tables, filter kernels or resampled impulse responses, so that plug-in instances which
+ * need the same data compute it once and share it. This does for DSP data what IGraphics' StaticStorage does for fonts and bitmaps.
+ *
+ * Entries are keyed by a name, a hash of the content they are made from and the sample rate they were made for. Get() returns the existing data if
+ * another instance still holds it, otherwise it calls the builder. The registry only keeps weak references, so the data is freed with the last instance that uses it.
+ * If two threads ask for the same key at once, the data is built once and the second one waits for it.
+ * NOTE: Get() can call the builder and wait, so call it on the main thread or a loader thread, not the audio thread. Keep the pointer it returns for use when processing.
+ * "Process wide" means per plug-in binary, since each binary has its own statics */
+template <class T>
+class SharedData
+{
+public:
+  using Ptr = std::shared_ptr<const T>;
+
+  /** Get shared data, building it if nobody holds it
+   * @param name What the data is, e.g. "wavetable"
+   * @param contentHash A hash of whatever the data is made from, see Hash(). 0 if the name and sample rate say it all
+   * @param sampleRate The sample rate the data is for, or 0 if it doesn't depend on it
+   * @param build Makes the data, returning a Ptr, or nullptr if it can't, in which case nothing is stored
+   * @return The data */
+  template <class Builder>
+  static Ptr Get(const char* name, uint64_t contentHash, double sampleRate, Builder build)
+  {
+    const Key key(name, contentHash, sampleRate);
+    std::unique_lock<std::mutex> lock(GetMutex());
+    auto& entries = GetEntries();
+    auto it = entries.find(key);
+
+    if (it != entries.end())
+    {
+      if (Ptr pData = it->second.data.lock())
+        return pData;
+
+      if (it->second.building.valid())
+      {
+        std::shared_future<Ptr> building = it->second.building;
+        lock.unlock();
+        return building.get();
+      }
+    }
+    else
+    {
+      Purge();
+      it = entries.emplace(key, Entry()).first;
+    }
+
+    // build without the lock, so that other keys aren't held up
+    std::promise<Ptr> promise;
+    it->second.building = promise.get_future().share();
+    lock.unlock();
+
+    Ptr pData = build();
+
+    lock.lock();
+    it->second.data = pData;
+    it->second.building = std::shared_future<Ptr>();
+    lock.unlock();
+
+    promise.set_value(pData);
+    return pData;
+  }
+
+  /** @return The number of entries whose data is still held */
+  static int NEntries()
+  {
+    std::lock_guard<std::mutex> lock(GetMutex());
+    int n = 0;
+
+    for (auto& entry : GetEntries())
+      n += !entry.second.data.expired();
+
+    return n;
+  }
+
+  /** FNV-1a, to hash the content that data is made from
+   * @param pData The content
+   * @param size The size in bytes
+   * @param seed The hash to continue from, so that several pieces of content can be combined
+   * @return The hash */
+  static uint64_t Hash(const void* pData, size_t size, uint64_t seed = 14695981039346656037ULL)
+  {
+    const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+    uint64_t hash = seed;
+
+    for (size_t i = 0; i < size; i++)
+      hash = (hash ^ pBytes[i]) * 1099511628211ULL;
+
+    return hash;
+  }
+
+private:
+  using Key = std::tuple<std::string, uint64_t, double>;
+
+  struct Entry
+  {
+    std::weak_ptr<const T> data;
+    std::shared_future<Ptr> building;
+  };
+
+  /** Drop entries that are no longer held, called with the lock held when a new one is added */
+  static void Purge()
+  {
+    auto& entries = GetEntries();
+
+    for (auto it = entries.begin(); it != entries.end();)
+    {
+      if (it->second.data.expired() && !it->second.building.valid())
+        it = entries.erase(it);
+      else
+        ++it;
+    }
+  }
+
+  static std::mutex& GetMutex()
+  {
+    static std::mutex sMutex;
+    return sMutex;
+  }
+
+  static std::map<Key, Entry>& GetEntries()
+  {
+    static std::map<Key, Entry> sEntries;
+    return sEntries;
+  }
+};
+
+END_IPLUG_NAMESPACE
@@ -0,0 +1,418 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc IShmChannel
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#include "wdlstring.h"
+
+#include "IPlugPlatform.h"
+#include "IPlugStructs.h"
+
+#if defined OS_WIN
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+BEGIN_IPLUG_NAMESPACE
+
+/** A single producer, single consumer queue of variable sized messages, in memory that may be shared between two processes.
+ * Neither side ever blocks or takes a lock, so a crashed or hung process on one side can't stall the other. The positions count bytes without wrapping,
+ * and each message is written as its size followed by its bytes, which may wrap around the end of the buffer.
+ * The ring doesn't own its memory, it is placed in a block that is laid out by IShmChannel */
+class IShmRing
+{
+public:
+  struct Header
+  {
+    std::atomic<uint32_t> writePos;
+    std::atomic<uint32_t> readPos;
+    uint32_t capacity;
+  };
+
+  static_assert(std::atomic<uint32_t>::is_always_lock_free, "shared memory rings need lock-free, address-free atomics");
+
+  IShmRing() = default;
+
+  /** @param pHeader The header, which is followed in memory by the ring's bytes
+   * @param init \c true for the side that creates the memory, to set the header up, \c false for the side that opens it
+   * @param capacity The number of bytes after the header, which must be a power of two */
+  void Attach(Header* pHeader, bool init, uint32_t capacity = 0)
+  {
+    mHeader = pHeader;
+    mData = reinterpret_cast<uint8_t*>(pHeader + 1);
+
+    if (init)
+    {
+      mHeader->writePos.store(0, std::memory_order_relaxed);
+      mHeader->readPos.store(0, std::memory_order_relaxed);
+      mHeader->capacity = capacity;
+    }
+  }
+
+  /** Add a message, from the producer side only
+   * @return \c false if there isn't room for it, in which case nothing was written */
+  bool Write(const void* pData, int size)
+  {
+    if (!mHeader || size < 0)
+      return false;
+
+    const uint32_t capacity = mHeader->capacity;
+    const uint32_t writePos = mHeader->writePos.load(std::memory_order_relaxed);
+    const uint32_t readPos = mHeader->readPos.load(std::memory_order_acquire);
+    const uint32_t needed = sizeof(uint32_t) + static_cast<uint32_t>(size);
+
+    if (needed > capacity - (writePos - readPos))
+      return false;
+
+    const uint32_t size32 = static_cast<uint32_t>(size);
+    CopyIn(writePos, &size32, sizeof(uint32_t));
+    CopyIn(writePos + sizeof(uint32_t), pData, size32);
+    mHeader->writePos.store(writePos + needed, std::memory_order_release);
+    return true;
+  }
+
+  /** Take the next message, from the consumer side only. The chunk is resized to the message's size
+   * @return \c false if the ring is empty, or the other side has corrupted it, in which case it is emptied */
+  bool Read(IByteChunk& msg)
+  {
+    if (!mHeader)
+      return false;
+
+    const uint32_t readPos = mHeader->readPos.load(std::memory_order_relaxed);
+    const uint32_t writePos = mHeader->writePos.load(std::memory_order_acquire);
+    const uint32_t used = writePos - readPos;
+
+    if (used < sizeof(uint32_t))
+      return false;
+
+    uint32_t size = 0;
+    CopyOut(readPos, &size, sizeof(uint32_t));
+
+    // the other process writes this memory, so don't trust it
+    if (size > used - sizeof(uint32_t))
+    {
+      mHeader->readPos.store(writePos, std::memory_order_release);
+      return false;
+    }
+
+    msg.Resize(static_cast<int>(size));
+    CopyOut(readPos + sizeof(uint32_t), msg.GetData(), size);
+    mHeader->readPos.store(readPos + sizeof(uint32_t) + size, std::memory_order_release);
+    return true;
+  }
+
+  /** @return \c true if there are no messages to read */
+  bool IsEmpty() const
+  {
+    return !mHeader || mHeader->writePos.load(std::memory_order_acquire) == mHeader->readPos.load(std::memory_order_relaxed);
+  }
+
+private:
+  void CopyIn(uint32_t pos, const void* pSrc, uint32_t size)
+  {
+    const uint32_t mask = mHeader->capacity - 1;
+    const uint32_t start = pos & mask;
+    const uint32_t first = std::min(size, mHeader->capacity - start);
+    memcpy(mData + start, pSrc, first);
+    memcpy(mData, static_cast<const uint8_t*>(pSrc) + first, size - first);
+  }
+
+  void CopyOut(uint32_t pos, void* pDst, uint32_t size) const
+  {
+    const uint32_t mask = mHeader->capacity - 1;
+    const uint32_t start = pos & mask;
+    const uint32_t first = std::min(size, mHeader->capacity - start);
+    memcpy(pDst, mData + start, first);
+    memcpy(static_cast<uint8_t*>(pDst) + first, mData, size - first);
+  }
+
+  Header* mHeader = nullptr;
+  uint8_t* mData = nullptr;
+};
+
+/** A two way connection between a plug-in and a helper process, through a named block of shared memory that holds an IShmRing in each direction.
+ * The plug-in Create()s the block and passes its name to the helper, for example on the command line, which Open()s it.
+ * Each side calls Beat() regularly, e.g. on its idle timer, so that the other side can tell with OtherSideIsAlive() whether it has crashed or hung.
+ * There is no wake up between the processes, the rings are polled, which suits editors that are updated on a timer anyway */
+class IShmChannel
+{
+public:
+  static constexpr uint32_t kMagic = 'IShm';
+  static constexpr uint32_t kVersion = 1;
+  static constexpr uint32_t kDefaultRingSize = 1 << 20;
+
+  IShmChannel() = default;
+
+  ~IShmChannel()
+  {
+    Close();
+  }
+
+  IShmChannel(const IShmChannel&) = delete;
+  IShmChannel& operator=(const IShmChannel&) = delete;
+
+  /** Make a new block of shared memory, as the plug-in side
+   * @param ringSize The bytes in each ring, rounded up to a power of two
+   * @return \c true on success, after which GetName() is the name to pass to the helper */
+  bool Create(uint32_t ringSize = kDefaultRingSize)
+  {
+    Close();
+
+    uint32_t capacity = 1024;
+    while (capacity < ringSize)
+      capacity <<= 1;
+
+    const size_t size = GetBlockSize(capacity);
+    static std::atomic<int> sCount {0};
+
+#if defined OS_WIN
+    mName.SetFormatted(64, "Local\\IPlugShm_%lu_%d", GetCurrentProcessId(), ++sCount);
+    mMapping = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE, 0, static_cast<DWORD>(size), mName.Get());
+
+    if (!mMapping || GetLastError() == ERROR_ALREADY_EXISTS)
+    {
+      Close();
+      return false;
+    }
+
+    mBlock = MapViewOfFile(mMapping, FILE_MAP_ALL_ACCESS, 0, 0, size);
+#else
+    // macOS limits the names to 31 characters
+    mName.SetFormatted(32, "/ipshm%d_%d", static_cast<int>(getpid()), ++sCount);
+    const int fd = shm_open(mName.Get(), O_CREAT | O_EXCL | O_RDWR, 0600);
+
+    if (fd < 0)
+      return false;
+
+    mOwner = true;
+
+    if (ftruncate(fd, static_cast<off_t>(size)) == 0)
+    {
+      mBlock = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+      if (mBlock == MAP_FAILED)
+        mBlock = nullptr;
+    }
+
+    close(fd);
+#endif
+
+    if (!mBlock)
+    {
+      Close();
+      return false;
+    }
+
+    mBlockSize = size;
+    Block* pBlock = GetBlock();
+    pBlock->version = kVersion;
+    pBlock->ringSize = capacity;
+    pBlock->beats[0].store(0, std::memory_order_relaxed);
+    pBlock->beats[1].store(0, std::memory_order_relaxed);
+    AttachRings(true);
+    mSide = 0;
+    std::atomic_thread_fence(std::memory_order_release);
+    pBlock->magic = kMagic;
+    return true;
+  }
+
+  /** Open a block made by Create() in another process, as the helper side
+   * @param name The name from the other side's GetName()
+   * @return \c false if there is no such block, or it was made by an incompatible version */
+  bool Open(const char* name)
+  {
+    Close();
+    mName.Set(name);
+
+#if defined OS_WIN
+    mMapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, name);
+
+    if (mMapping)
+    {
+      mBlock = MapViewOfFile(mMapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+
+      MEMORY_BASIC_INFORMATION info;
+      if (mBlock && VirtualQuery(mBlock, &info, sizeof(info)))
+        mBlockSize = info.RegionSize;
+    }
+#else
+    const int fd = shm_open(name, O_RDWR, 0600);
+
+    if (fd >= 0)
+    {
+      struct stat info;
+
+      if (fstat(fd, &info) == 0 && info.st_size > 0)
+      {
+        mBlock = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+        if (mBlock == MAP_FAILED)
+          mBlock = nullptr;
+        else
+          mBlockSize = static_cast<size_t>(info.st_size);
+      }
+
+      close(fd);
+    }
+#endif
+
+    Block* pBlock = GetBlock();
+
+    if (!pBlock || mBlockSize < sizeof(Block) || pBlock->magic != kMagic || pBlock->version != kVersion
+        || (pBlock->ringSize & (pBlock->ringSize - 1)) || GetBlockSize(pBlock->ringSize) > mBlockSize)
+    {
+      Close();
+      return false;
+    }
+
+    std::atomic_thread_fence(std::memory_order_acquire);
+    AttachRings(false);
+    mSide = 1;
+    return true;
+  }
+
+  /** Unmap the block. The side that created it also removes its name, the memory goes when both sides have closed it */
+  void Close()
+  {
+#if defined OS_WIN
+    if (mBlock)
+      UnmapViewOfFile(mBlock);
+
+    if (mMapping)
+      CloseHandle(mMapping);
+
+    mMapping = nullptr;
+#else
+    if (mBlock)
+      munmap(mBlock, mBlockSize);
+
+    if (mOwner)
+      shm_unlink(mName.Get());
+
+    mOwner = false;
+#endif
+    mBlock = nullptr;
+    mBlockSize = 0;
+    mSend = IShmRing();
+    mReceive = IShmRing();
+    mLastOtherBeatTime = -1.;
+  }
+
+  /** @return \c true if the block was created or opened */
+  bool IsOpen() const { return mBlock != nullptr; }
+
+  /** @return The name of the block, to pass to the other process */
+  const char* GetName() const { return mName.Get(); }
+
+  /** Send a message to the other side. Never blocks
+   * @return \c false if the ring is full, or the channel isn't open */
+  bool Send(const void* pData, int size) { return mSend.Write(pData, size); }
+
+  /** Send a chunk to the other side, see Send() */
+  bool Send(const IByteChunk& msg) { return mSend.Write(msg.GetData(), msg.Size()); }
+
+  /** Take the next message from the other side. Never blocks
+   * @return \c false if there are no messages */
+  bool Receive(IByteChunk& msg) { return mReceive.Read(msg); }
+
+  /** Show the other side that this one is still running, call this regularly on the side's main thread */
+  void Beat()
+  {
+    if (Block* pBlock = GetBlock())
+      pBlock->beats[mSide].fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /** Check the other side's heartbeat, call this regularly
+   * @param timeoutMs How long the heartbeat may stand still before the other side counts as gone
+   * @param nowMs The current time in milliseconds, from any steady clock
+   * @return \c false if the other side hasn't called Beat() within the timeout */
+  bool OtherSideIsAlive(double timeoutMs, double nowMs)
+  {
+    Block* pBlock = GetBlock();
+
+    if (!pBlock)
+      return false;
+
+    const uint32_t beat = pBlock->beats[1 - mSide].load(std::memory_order_relaxed);
+
+    if (beat != mLastOtherBeat || mLastOtherBeatTime < 0.)
+    {
+      mLastOtherBeat = beat;
+      mLastOtherBeatTime = nowMs;
+    }
+
+    return nowMs - mLastOtherBeatTime <= timeoutMs;
+  }
+
+private:
+  struct Block
+  {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t ringSize;
+    std::atomic<uint32_t> beats[2]; // [0] the creating side, [1] the opening side
+  };
+
+  // the header and each ring start on a cache line, so the two sides don't share lines they both write
+  static constexpr size_t kAlign = 64;
+
+  static size_t Align(size_t size) { return (size + kAlign - 1) & ~(kAlign - 1); }
+
+  static size_t GetRingOffset(uint32_t capacity, int ring)
+  {
+    return Align(sizeof(Block)) + ring * Align(sizeof(IShmRing::Header) + capacity);
+  }
+
+  static size_t GetBlockSize(uint32_t capacity) { return GetRingOffset(capacity, 2); }
+
+  Block* GetBlock() const { return static_cast<Block*>(mBlock); }
+
+  void AttachRings(bool init)
+  {
+    uint8_t* pBytes = static_cast<uint8_t*>(mBlock);
+    const uint32_t capacity = GetBlock()->ringSize;
+    auto* pRing0 = reinterpret_cast<IShmRing::Header*>(pBytes + GetRingOffset(capacity, 0));
+    auto* pRing1 = reinterpret_cast<IShmRing::Header*>(pBytes + GetRingOffset(capacity, 1));
+
+    // ring 0 goes from the creating side to the opening side
+    mSend.Attach(init ? pRing0 : pRing1, init, capacity);
+    mReceive.Attach(init ? pRing1 : pRing0, init, capacity);
+  }
+
+  WDL_String mName;
+  void* mBlock = nullptr;
+  size_t mBlockSize = 0;
+  int mSide = 0;
+  IShmRing mSend;
+  IShmRing mReceive;
+  uint32_t mLastOtherBeat = 0;
+  double mLastOtherBeatTime = -1.;
+#if defined OS_WIN
+  HANDLE mMapping = nullptr;
+#else
+  bool mOwner = false;
+#endif
+};
+
+END_IPLUG_NAMESPACE
@@ -0,0 +1,219 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#include "IShmEditorClient.h"
+
+#include <chrono>
+#include <cstdlib>
+
+using namespace iplug;
+
+static double GetTimeMs()
+{
+  using namespace std::chrono;
+  return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+IShmEditorClient::IShmEditorClient(int nParams)
+: IGEditorDelegate(nParams)
+{
+}
+
+bool IShmEditorClient::Connect(int argc, const char* argv[])
+{
+  const char* name = nullptr;
+
+  for (int i = 1; i < argc - 1; i++)
+  {
+    if (strcmp(argv[i], "-shm") == 0)
+      name = argv[i + 1];
+    else if (strcmp(argv[i], "-parent") == 0)
+      mParentWindow = reinterpret_cast<void*>(static_cast<uintptr_t>(strtoull(argv[i + 1], nullptr, 16)));
+  }
+
+  return name && Connect(name);
+}
+
+bool IShmEditorClient::Connect(const char* channelName)
+{
+  mCloseRequested = false;
+
+  if (!mChannel.Open(channelName))
+    return false;
+
+  mChannel.Beat();
+  mChannel.OtherSideIsAlive(mTimeoutMs, GetTimeMs()); // starts the timeout
+  return true;
+}
+
+bool IShmEditorClient::ProcessShmQueue()
+{
+  if (!mChannel.IsOpen())
+    return false;
+
+  mChannel.Beat();
+
+  while (!mCloseRequested && mChannel.Receive(mReceiveChunk))
+    HandleMessage(mReceiveChunk);
+
+  // parameter values are applied together, so the controls are only locked once
+  if (!mParamChanges.empty())
+  {
+    SendParameterValuesFromDelegate(mParamChanges.data(), static_cast<int>(mParamChanges.size()), true);
+    mParamChanges.clear();
+  }
+
+  if (mCloseRequested || !mChannel.OtherSideIsAlive(mTimeoutMs, GetTimeMs()))
+  {
+    mChannel.Close();
+    return false;
+  }
+
+  return true;
+}
+
+void IShmEditorClient::NotifyWindowClosed()
+{
+  mSendChunk.Clear();
+  mSendChunk.PutStr("CLOSED");
+  mChannel.Send(mSendChunk);
+}
+
+void IShmEditorClient::HandleMessage(const IByteChunk& msg)
+{
+  // the tag is only compared, so it's viewed in the message rather than copied
+  std::string_view tag;
+  int pos = msg.GetStrView(tag, 0);
+
+  if (pos < 0)
+    return;
+
+  if (tag == "SPVFD")
+  {
+    int paramIdx = kNoParameter;
+    double value = 0.;
+    pos = msg.Get(&paramIdx, pos);
+    pos = pos < 0 ? pos : msg.Get(&value, pos);
+
+    if (pos > 0 && paramIdx >= 0 && paramIdx < NParams())
+    {
+      GetParam(paramIdx)->SetNormalized(value);
+      mParamChanges.push_back({paramIdx, value});
+    }
+  }
+  else if (tag == "SCVFD")
+  {
+    int ctrlTag = kNoTag;
+    double value = 0.;
+    pos = msg.Get(&ctrlTag, pos);
+    pos = pos < 0 ? pos : msg.Get(&value, pos);
+
+    if (pos > 0)
+      SendControlValueFromDelegate(ctrlTag, value);
+  }
+  else if (tag == "SCMFD" || tag == "SAMFD" || tag == "SSMFD")
+  {
+    const char type = tag[1];
+    int ctrlTag = kNoTag, msgTag = kNoTag, dataSize = 0;
+
+    if (type == 'C')
+      pos = msg.Get(&ctrlTag, pos);
+
+    if (type != 'S')
+      pos = pos < 0 ? pos : msg.Get(&msgTag, pos);
+
+    pos = pos < 0 ? pos : msg.Get(&dataSize, pos);
+
+    if (pos < 0 || dataSize < 0 || dataSize > msg.Size() - pos)
+      return;
+
+    const uint8_t* pData = dataSize ? msg.GetData() + pos : nullptr;
+
+    if (type == 'C')
+      SendControlMsgFromDelegate(ctrlTag, msgTag, dataSize, pData);
+    else if (type == 'A')
+      SendArbitraryMsgFromDelegate(msgTag, dataSize, pData);
+    else
+      SendSysexMsgFromDelegate(ISysEx(0, pData, dataSize));
+  }
+  else if (tag == "SMMFD")
+  {
+    IMidiMsg midi;
+    pos = msg.Get(&midi.mStatus, pos);
+    pos = pos < 0 ? pos : msg.Get(&midi.mData1, pos);
+    pos = pos < 0 ? pos : msg.Get(&midi.mData2, pos);
+
+    if (pos > 0)
+      SendMidiMsgFromDelegate(midi);
+  }
+  else if (tag == "CLOSE")
+  {
+    mCloseRequested = true;
+  }
+}
+
+void IShmEditorClient::SendParamMsg(const char* tag, int paramIdx)
+{
+  mSendChunk.Clear();
+  mSendChunk.PutStr(tag);
+  mSendChunk.Put(&paramIdx);
+  mChannel.Send(mSendChunk);
+}
+
+void IShmEditorClient::BeginInformHostOfParamChangeFromUI(int paramIdx)
+{
+  SendParamMsg("BIHFUI", paramIdx);
+}
+
+void IShmEditorClient::SendParameterValueFromUI(int paramIdx, double normalizedValue)
+{
+  mSendChunk.Clear();
+  mSendChunk.PutStr("SPVFUI");
+  mSendChunk.Put(&paramIdx);
+  mSendChunk.Put(&normalizedValue);
+  mChannel.Send(mSendChunk);
+
+  IGEditorDelegate::SendParameterValueFromUI(paramIdx, normalizedValue);
+}
+
+void IShmEditorClient::EndInformHostOfParamChangeFromUI(int paramIdx)
+{
+  SendParamMsg("EIHFUI", paramIdx);
+}
+
+void IShmEditorClient::SendMidiMsgFromUI(const IMidiMsg& msg)
+{
+  mSendChunk.Clear();
+  mSendChunk.PutStr("SMMFUI");
+  mSendChunk.Put(&msg.mStatus);
+  mSendChunk.Put(&msg.mData1);
+  mSendChunk.Put(&msg.mData2);
+  mChannel.Send(mSendChunk);
+}
+
+void IShmEditorClient::SendSysexMsgFromUI(const ISysEx& msg)
+{
+  mSendChunk.Clear();
+  mSendChunk.PutStr("SSMFUI");
+  mSendChunk.Put(&msg.mSize);
+  mSendChunk.PutBytes(msg.mData, msg.mSize);
+  mChannel.Send(mSendChunk);
+}
+
+void IShmEditorClient::SendArbitraryMsgFromUI(int msgTag, int ctrlTag, int dataSize, const void* pData)
+{
+  mSendChunk.Clear();
+  mSendChunk.PutStr("SAMFUI");
+  mSendChunk.Put(&msgTag);
+  mSendChunk.Put(&ctrlTag);
+  mSendChunk.Put(&dataSize);
+  mSendChunk.PutBytes(pData, dataSize);
+  mChannel.Send(mSendChunk);
+}
@@ -0,0 +1,77 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+#include "IGraphicsEditorDelegate.h"
+#include "IPlugShmChannel.h"
+
+#include <vector>
+
+/**
+ * @file
+ * @copydoc IShmEditorClient
+ */
+
+BEGIN_IPLUG_NAMESPACE
+
+/** The editor delegate of a helper process that shows a plug-in's editor, for a plug-in using IShmEditorDelegate.
+ * The helper makes the same parameters as the plug-in, in the same order, and sets mMakeGraphicsFunc and mLayoutFunc as the plug-in does, ideally with code shared between the two.
+ * It calls Connect() with its command line, opens the editor with OpenWindow(GetParentWindow()), and then calls ProcessShmQueue() on its main thread, e.g. from a timer,
+ * until it returns \c false, when it should close the window and quit. The event loop and the window are the helper application's, as for any standalone app.
+ * The plug-in's parameter values, control messages and MIDI are applied to the editor here as they would be in the plug-in, and the editor's edits are sent to the plug-in */
+class IShmEditorClient : public igraphics::IGEditorDelegate
+{
+public:
+  IShmEditorClient(int nParams);
+
+  /** Open the channel named on the command line from IShmEditorDelegate::LaunchEditorProcess()
+   * @return \c false if there is no channel argument, or it can't be opened */
+  bool Connect(int argc, const char* argv[]);
+
+  /** Open a channel by name
+   * @return \c false if it can't be opened */
+  bool Connect(const char* channelName);
+
+  /** @return The host's parent window from the command line, or nullptr if there was none */
+  void* GetParentWindow() const { return mParentWindow; }
+
+  /** Set how long the plug-in can go without a heartbeat before it counts as gone, and the helper should quit, 3000 ms by default */
+  void SetHostTimeout(double timeoutMs) { mTimeoutMs = timeoutMs; }
+
+  /** Call this regularly on the main thread, to apply what the plug-in has sent and show it that the helper is still running
+   * @return \c false when the helper should quit, because the plug-in has asked it to, or has gone */
+  bool ProcessShmQueue();
+
+  /** Tell the plug-in that the user closed the editor window, before quitting */
+  void NotifyWindowClosed();
+
+  //IEditorDelegate
+  void BeginInformHostOfParamChangeFromUI(int paramIdx) override;
+  void SendParameterValueFromUI(int paramIdx, double normalizedValue) override;
+  void EndInformHostOfParamChangeFromUI(int paramIdx) override;
+  void SendMidiMsgFromUI(const IMidiMsg& msg) override;
+  void SendSysexMsgFromUI(const ISysEx& msg) override;
+  void SendArbitraryMsgFromUI(int msgTag, int ctrlTag, int dataSize, const void* pData) override;
+
+private:
+  void HandleMessage(const IByteChunk& msg);
+  void SendParamMsg(const char* tag, int paramIdx);
+
+  IShmChannel mChannel;
+  IByteChunk mSendChunk;
+  IByteChunk mReceiveChunk;
+  std::vector<ParamTuple> mParamChanges;
+  void* mParentWindow = nullptr;
+  double mTimeoutMs = 3000.;
+  bool mCloseRequested = false;
+};
+
+END_IPLUG_NAMESPACE
@@ -0,0 +1,439 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#include "IShmEditorDelegate.h"
+
+#include <chrono>
+
+#if defined OS_WIN
+  #include <windows.h>
+#else
+  #include <csignal>
+  #include <spawn.h>
+  #include <sys/wait.h>
+  extern char** environ;
+#endif
+
+using namespace iplug;
+
+static double GetTimeMs()
+{
+  using namespace std::chrono;
+  return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+IShmEditorDelegate::IShmEditorDelegate(int nParams)
+: IGEditorDelegate(nParams)
+{
+}
+
+IShmEditorDelegate::~IShmEditorDelegate()
+{
+  CloseEditorProcess();
+
+#if defined OS_WIN
+  if (mProcess)
+    CloseHandle(mProcess);
+#else
+  // the helper has been asked to quit, but nothing is left to reap it after this
+  if (mProcess > 0 && !ProcessHasExited())
+  {
+    kill(mProcess, SIGKILL);
+    waitpid(mProcess, nullptr, 0);
+  }
+#endif
+}
+
+bool IShmEditorDelegate::LaunchEditorProcess(const char* helperPath, void* pParent, uint32_t ringSize)
+{
+  CloseEditorProcess();
+
+  if (!mChannel.Create(ringSize))
+    return false;
+
+  // the ring is there before the helper is, so it finds the current state waiting
+  SendAllParamValues();
+
+  if (!StartProcess(helperPath, pParent))
+  {
+    mChannel.Close();
+    return false;
+  }
+
+  mChannel.Beat();
+  mChannel.OtherSideIsAlive(mTimeoutMs, GetTimeMs()); // starts the timeout
+  return true;
+}
+
+void IShmEditorDelegate::CloseEditorProcess()
+{
+  if (!mChannel.IsOpen())
+    return;
+
+  mSendChunk.Clear();
+  mSendChunk.PutStr("CLOSE");
+  mChannel.Send(mSendChunk);
+  mChannel.Close();
+  mPendingParams.clear();
+  mParamIsPending.assign(mParamIsPending.size(), false);
+}
+
+void IShmEditorDelegate::ProcessShmQueue()
+{
+#if !defined OS_WIN
+  // reap a helper that was closed
+  if (!mChannel.IsOpen() && mProcess > 0 && ProcessHasExited())
+    mProcess = 0;
+#endif
+
+  if (!mChannel.IsOpen())
+    return;
+
+  mChannel.Beat();
+
+  while (mChannel.IsOpen() && mChannel.Receive(mReceiveChunk))
+    HandleMessage(mReceiveChunk);
+
+  if (!mChannel.IsOpen())
+    return;
+
+  FlushPendingParamValues();
+
+  if (ProcessHasExited() || !mChannel.OtherSideIsAlive(mTimeoutMs, GetTimeMs()))
+    LoseEditorProcess();
+}
+
+void IShmEditorDelegate::HandleMessage(const IByteChunk& msg)
+{
+  // the tag is only compared, so it's viewed in the message rather than copied
+  std::string_view tag;
+  int pos = msg.GetStrView(tag, 0);
+
+  if (pos < 0)
+    return;
+
+  if (tag == "SPVFUI" || tag == "BIHFUI" || tag == "EIHFUI")
+  {
+    int paramIdx = kNoParameter;
+    double value = 0.;
+    pos = msg.Get(&paramIdx, pos);
+
+    if (pos < 0 || paramIdx < 0 || paramIdx >= NParams())
+      return;
+
+    if (tag[0] == 'B')
+      BeginInformHostOfParamChangeFromUI(paramIdx);
+    else if (tag[0] == 'E')
+      EndInformHostOfParamChangeFromUI(paramIdx);
+    else if (msg.Get(&value, pos) > 0)
+      SendParameterValueFromUI(paramIdx, Clip(value, 0., 1.));
+  }
+  else if (tag == "SMMFUI")
+  {
+    IMidiMsg midi;
+    pos = msg.Get(&midi.mStatus, pos);
+    pos = pos < 0 ? pos : msg.Get(&midi.mData1, pos);
+    pos = pos < 0 ? pos : msg.Get(&midi.mData2, pos);
+
+    if (pos > 0)
+      SendMidiMsgFromUI(midi);
+  }
+  else if (tag == "SSMFUI" || tag == "SAMFUI")
+  {
+    const bool isSysex = tag[1] == 'S';
+    int msgTag = kNoTag, ctrlTag = kNoTag, dataSize = 0;
+
+    if (!isSysex)
+    {
+      pos = msg.Get(&msgTag, pos);
+      pos = pos < 0 ? pos : msg.Get(&ctrlTag, pos);
+    }
+
+    pos = pos < 0 ? pos : msg.Get(&dataSize, pos);
+
+    if (pos < 0 || dataSize < 0 || dataSize > msg.Size() - pos)
+      return;
+
+    const uint8_t* pData = dataSize ? msg.GetData() + pos : nullptr;
+
+    if (isSysex)
+      SendSysexMsgFromUI(ISysEx(0, pData, dataSize));
+    else
+      SendArbitraryMsgFromUI(msgTag, ctrlTag, dataSize, pData);
+  }
+  else if (tag == "CLOSED")
+  {
+    // the user closed the helper's window
+    LoseEditorProcess();
+  }
+}
+
+void IShmEditorDelegate::SendParamValue(int paramIdx, double normalizedValue)
+{
+  if (!mChannel.IsOpen() || paramIdx < 0 || paramIdx >= NParams())
+    return;
+
+  if (mParamIsPending.size() != static_cast<size_t>(NParams()))
+    mParamIsPending.assign(NParams(), false);
+
+  // once a value is waiting, later ones wait behind it, so the order is kept
+  if (!mParamIsPending[paramIdx])
+  {
+    mSendChunk.Clear();
+    mSendChunk.PutStr("SPVFD");
+    mSendChunk.Put(&paramIdx);
+    mSendChunk.Put(&normalizedValue);
+
+    if (mChannel.Send(mSendChunk))
+      return;
+
+    mParamIsPending[paramIdx] = true;
+    mPendingParams.push_back(paramIdx);
+  }
+}
+
+void IShmEditorDelegate::SendAllParamValues()
+{
+  for (int i = 0; i < NParams(); i++)
+    SendParamValue(i, GetParam(i)->GetNormalized());
+}
+
+void IShmEditorDelegate::FlushPendingParamValues()
+{
+  size_t nSent = 0;
+
+  for (; nSent < mPendingParams.size(); nSent++)
+  {
+    int paramIdx = mPendingParams[nSent];
+    double value = GetParam(paramIdx)->GetNormalized();
+
+    mSendChunk.Clear();
+    mSendChunk.PutStr("SPVFD");
+    mSendChunk.Put(&paramIdx);
+    mSendChunk.Put(&value);
+
+    if (!mChannel.Send(mSendChunk))
+      break;
+
+    mParamIsPending[paramIdx] = false;
+  }
+
+  mPendingParams.erase(mPendingParams.begin(), mPendingParams.begin() + nSent);
+}
+
+void IShmEditorDelegate::SendControlMsg(int ctrlTag, int msgTag, int dataSize, const void* pData)
+{
+  if (!mChannel.IsOpen())
+    return;
+
+  mSendChunk.Clear();
+  mSendChunk.PutStr("SCMFD");
+  mSendChunk.Put(&ctrlTag);
+  mSendChunk.Put(&msgTag);
+  mSendChunk.Put(&dataSize);
+  mSendChunk.PutBytes(pData, dataSize);
+  mChannel.Send(mSendChunk);
+}
+
+void IShmEditorDelegate::SendControlValueFromDelegate(int ctrlTag, double normalizedValue)
+{
+  if (mChannel.IsOpen())
+  {
+    mSendChunk.Clear();
+    mSendChunk.PutStr("SCVFD");
+    mSendChunk.Put(&ctrlTag);
+    mSendChunk.Put(&normalizedValue);
+    mChannel.Send(mSendChunk);
+  }
+
+  IGEditorDelegate::SendControlValueFromDelegate(ctrlTag, normalizedValue);
+}
+
+void IShmEditorDelegate::SendControlMsgFromDelegate(int ctrlTag, int msgTag, int dataSize, const void* pData)
+{
+  SendControlMsg(ctrlTag, msgTag, dataSize, pData);
+  IGEditorDelegate::SendControlMsgFromDelegate(ctrlTag, msgTag, dataSize, pData);
+}
+
+void IShmEditorDelegate::SendControlMsgsFromDelegate(const ControlMsg* pMsgs, int nMsgs)
+{
+  for (int i = 0; i < nMsgs; i++)
+    SendControlMsg(pMsgs[i].ctrlTag, pMsgs[i].msgTag, pMsgs[i].dataSize, pMsgs[i].pData);
+
+  IGEditorDelegate::SendControlMsgsFromDelegate(pMsgs, nMsgs);
+}
+
+void IShmEditorDelegate::SendArbitraryMsgFromDelegate(int msgTag, int dataSize, const void* pData)
+{
+  if (mChannel.IsOpen())
+  {
+    mSendChunk.Clear();
+    mSendChunk.PutStr("SAMFD");
+    mSendChunk.Put(&msgTag);
+    mSendChunk.Put(&dataSize);
+    mSendChunk.PutBytes(pData, dataSize);
+    mChannel.Send(mSendChunk);
+  }
+
+  IGEditorDelegate::SendArbitraryMsgFromDelegate(msgTag, dataSize, pData);
+}
+
+void IShmEditorDelegate::SendMidiMsgFromDelegate(const IMidiMsg& msg)
+{
+  if (mChannel.IsOpen())
+  {
+    mSendChunk.Clear();
+    mSendChunk.PutStr("SMMFD");
+    mSendChunk.Put(&msg.mStatus);
+    mSendChunk.Put(&msg.mData1);
+    mSendChunk.Put(&msg.mData2);
+    mChannel.Send(mSendChunk);
+  }
+
+  IGEditorDelegate::SendMidiMsgFromDelegate(msg);
+}
+
+void IShmEditorDelegate::SendMidiMsgsFromDelegate(const IMidiMsg* pMsgs, int nMsgs)
+{
+  for (int i = 0; i < nMsgs && mChannel.IsOpen(); i++)
+  {
+    mSendChunk.Clear();
+    mSendChunk.PutStr("SMMFD");
+    mSendChunk.Put(&pMsgs[i].mStatus);
+    mSendChunk.Put(&pMsgs[i].mData1);
+    mSendChunk.Put(&pMsgs[i].mData2);
+    mChannel.Send(mSendChunk);
+  }
+
+  IGEditorDelegate::SendMidiMsgsFromDelegate(pMsgs, nMsgs);
+}
+
+void IShmEditorDelegate::SendSysexMsgFromDelegate(const ISysEx& msg)
+{
+  if (mChannel.IsOpen())
+  {
+    mSendChunk.Clear();
+    mSendChunk.PutStr("SSMFD");
+    mSendChunk.Put(&msg.mSize);
+    mSendChunk.PutBytes(msg.mData, msg.mSize);
+    mChannel.Send(mSendChunk);
+  }
+
+  IGEditorDelegate::SendSysexMsgFromDelegate(msg);
+}
+
+void IShmEditorDelegate::SendParameterValueFromDelegate(int paramIdx, double value, bool normalized)
+{
+  if (mChannel.IsOpen() && paramIdx >= 0 && paramIdx < NParams())
+    SendParamValue(paramIdx, normalized ? value : GetParam(paramIdx)->ToNormalized(value));
+
+  IGEditorDelegate::SendParameterValueFromDelegate(paramIdx, value, normalized);
+}
+
+void IShmEditorDelegate::SendParameterValuesFromDelegate(const ParamTuple* pParams, int nParams, bool normalized)
+{
+  for (int i = 0; i < nParams && mChannel.IsOpen(); i++)
+  {
+    const int paramIdx = pParams[i].idx;
+
+    if (paramIdx >= 0 && paramIdx < NParams())
+      SendParamValue(paramIdx, normalized ? pParams[i].value : GetParam(paramIdx)->ToNormalized(pParams[i].value));
+  }
+
+  IGEditorDelegate::SendParameterValuesFromDelegate(pParams, nParams, normalized);
+}
+
+bool IShmEditorDelegate::StartProcess(const char* helperPath, void* pParent)
+{
+  WDL_String parent;
+  parent.SetFormatted(32, "%llx", static_cast<unsigned long long>(reinterpret_cast<uintptr_t>(pParent)));
+
+#if defined OS_WIN
+  if (mProcess)
+    CloseHandle(mProcess);
+
+  mProcess = nullptr;
+
+  WDL_String cmdLine;
+  cmdLine.SetFormatted(4096, "\"%s\" -shm %s -parent %s", helperPath, mChannel.GetName(), parent.Get());
+
+  STARTUPINFOA startupInfo = {};
+  startupInfo.cb = sizeof(startupInfo);
+  PROCESS_INFORMATION processInfo = {};
+
+  if (!CreateProcessA(helperPath, cmdLine.Get(), nullptr, nullptr, FALSE, 0, nullptr, nullptr, &startupInfo, &processInfo))
+    return false;
+
+  CloseHandle(processInfo.hThread);
+  mProcess = processInfo.hProcess;
+  return true;
+#else
+  // a helper closed earlier may still be exiting, it has been asked to quit so it can go now
+  if (mProcess > 0 && !ProcessHasExited())
+  {
+    kill(mProcess, SIGKILL);
+    waitpid(mProcess, nullptr, 0);
+  }
+
+  mProcess = 0;
+
+  WDL_String name(mChannel.GetName());
+  WDL_String path(helperPath);
+  char shmArg[] = "-shm";
+  char parentArg[] = "-parent";
+  char* argv[] = {path.Get(), shmArg, name.Get(), parentArg, parent.Get(), nullptr};
+
+  pid_t pid = 0;
+
+  if (posix_spawn(&pid, helperPath, nullptr, nullptr, argv, environ) != 0)
+    return false;
+
+  mProcess = pid;
+  return true;
+#endif
+}
+
+bool IShmEditorDelegate::ProcessHasExited()
+{
+#if defined OS_WIN
+  return !mProcess || WaitForSingleObject(mProcess, 0) == WAIT_OBJECT_0;
+#else
+  if (mProcess <= 0)
+    return true;
+
+  if (waitpid(mProcess, nullptr, WNOHANG) == mProcess)
+  {
+    mProcess = 0;
+    return true;
+  }
+
+  return false;
+#endif
+}
+
+void IShmEditorDelegate::LoseEditorProcess()
+{
+  // a helper that has hung won't notice the channel going, so end it
+  if (!ProcessHasExited())
+  {
+#if defined OS_WIN
+    TerminateProcess(mProcess, 1);
+#else
+    kill(mProcess, SIGKILL);
+    waitpid(mProcess, nullptr, 0);
+    mProcess = 0;
+#endif
+  }
+
+  mChannel.Close();
+  mPendingParams.clear();
+  mParamIsPending.assign(mParamIsPending.size(), false);
+  OnEditorProcessLost();
+}
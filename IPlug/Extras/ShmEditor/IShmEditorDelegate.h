@@ -0,0 +1,99 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+#include "IGraphicsEditorDelegate.h"
+#include "IPlugShmChannel.h"
+
+#include <vector>
+
+/**
+ * @file
+ * @copydoc IShmEditorDelegate
+ */
+
+BEGIN_IPLUG_NAMESPACE
+
+/** An editor delegate base class for plug-ins that can run their editor in a helper process, so that a crash in the UI doesn't take the host down,
+ * and the UI's drawing doesn't compete with the host's main thread. Choose it with SHM_EDITOR, see IPlugDelegate_select.h.
+ *
+ * LaunchEditorProcess() makes an IShmChannel and starts the helper with its name on the command line. The helper is a small application made from the plug-in's
+ * parameters and layout, with an IShmEditorClient as its delegate, see IShmEditorClient.h. Parameter values, control values and control messages such as ISender data,
+ * MIDI and arbitrary messages are then sent to the helper as well as to the in-process editor, and the helper's edits come back as if they were made in the plug-in's own UI.
+ * Call ProcessShmQueue() regularly on the main thread, e.g. from OnIdle(), to handle the helper's messages and check that it is still running.
+ *
+ * Nothing ever waits on the helper. If a ring is full, parameter values are kept and sent again later, and other messages are dropped, like a missed frame of meter data.
+ * If the helper stops responding it is treated as gone, and OnEditorProcessLost() is called, so the plug-in can fall back to its in-process editor or start a new helper.
+ * Putting the helper's window inside the host's is up to the helper and the platform. The parent window handle is passed to it, which works on Windows, where
+ * windows can have parents in another process, but on macOS the helper has to show its own window */
+class IShmEditorDelegate : public igraphics::IGEditorDelegate
+{
+public:
+  IShmEditorDelegate(int nParams);
+  virtual ~IShmEditorDelegate();
+
+  /** Start an editor helper process, closing any that is already running
+   * @param helperPath The path of the helper's executable
+   * @param pParent The host's parent window for the editor, which is passed to the helper as a number, or nullptr
+   * @param ringSize The bytes in each direction of the channel, enough for the biggest control message with room to spare
+   * @return \c true if the channel was made and the process started */
+  bool LaunchEditorProcess(const char* helperPath, void* pParent = nullptr, uint32_t ringSize = IShmChannel::kDefaultRingSize);
+
+  /** Ask the helper to quit, and close the channel */
+  void CloseEditorProcess();
+
+  /** @return \c true if a helper was launched and hasn't been lost or closed */
+  bool EditorProcessIsRunning() const { return mChannel.IsOpen(); }
+
+  /** Set how long the helper can go without a heartbeat before it counts as gone, 3000 ms by default, more than a helper stalled by a modal dialog is likely to take */
+  void SetEditorProcessTimeout(double timeoutMs) { mTimeoutMs = timeoutMs; }
+
+  /** Call this regularly on the main thread, in order to handle messages from the helper, send it any parameter values that didn't fit and check that it is still running */
+  void ProcessShmQueue();
+
+  /** Called on the main thread when the helper exits, crashes or stops responding, after the channel has been closed */
+  virtual void OnEditorProcessLost() {}
+
+  //IEditorDelegate
+  void SendControlValueFromDelegate(int ctrlTag, double normalizedValue) override;
+  void SendControlMsgFromDelegate(int ctrlTag, int msgTag, int dataSize, const void* pData) override;
+  void SendControlMsgsFromDelegate(const ControlMsg* pMsgs, int nMsgs) override;
+  void SendArbitraryMsgFromDelegate(int msgTag, int dataSize, const void* pData) override;
+  void SendMidiMsgFromDelegate(const IMidiMsg& msg) override;
+  void SendMidiMsgsFromDelegate(const IMidiMsg* pMsgs, int nMsgs) override;
+  void SendSysexMsgFromDelegate(const ISysEx& msg) override;
+  void SendParameterValueFromDelegate(int paramIdx, double value, bool normalized) override;
+  void SendParameterValuesFromDelegate(const ParamTuple* pParams, int nParams, bool normalized) override;
+
+private:
+  void HandleMessage(const IByteChunk& msg);
+  void SendParamValue(int paramIdx, double normalizedValue);
+  void SendAllParamValues();
+  void FlushPendingParamValues();
+  void SendControlMsg(int ctrlTag, int msgTag, int dataSize, const void* pData);
+  bool StartProcess(const char* helperPath, void* pParent);
+  bool ProcessHasExited();
+  void LoseEditorProcess();
+
+  IShmChannel mChannel;
+  IByteChunk mSendChunk;
+  IByteChunk mReceiveChunk;
+  std::vector<int> mPendingParams; // parameters whose latest value hasn't fitted in the ring, by index
+  std::vector<bool> mParamIsPending;
+  double mTimeoutMs = 3000.;
+#if defined OS_WIN
+  void* mProcess = nullptr;
+#else
+  int mProcess = 0;
+#endif
+};
+
+END_IPLUG_NAMESPACE
@@ -8,8 +8,15 @@
  ==============================================================================
 */
 
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
 #include "denormal.h"
 #include "IPlugConstants.h"
+#include "IPlugUtilities.h"
 
 BEGIN_IPLUG_NAMESPACE
 
@@ -57,6 +64,8 @@ public:
     }
   }
 
+  double GetCoefficient() const { return mA; }
+  
   void SetSmoothTime(double timeMs, double sampleRate)
   {
     static constexpr double TWO_PI = 6.283185307179586476925286766559;
@@ -65,24 +74,56 @@ public:
     mB = 1.0 - mA;
   }
 
+  /** Smooth towards inputs, which are constant for the block. Since the input is constant, the one-pole has a closed form,
+   * so each channel is filled with Ramp(), which doesn't depend on the previous sample and can be vectorised */
   void ProcessBlock(T inputs[NC], T** outputs, int nFrames, int channelOffset = 0)
   {
-    const T b = mB;
-    const T a = mA;
-
-    for (auto s = 0; s < nFrames; ++s)
+    for (auto c = 0; c < NC; c++)
     {
-      for (auto c = 0; c < NC; c++)
-      {
-        T output = (inputs[channelOffset + c] * b) + (mOutM1[c] * a);
-#ifndef OS_IOS
-        denormal_fix(&output);
-#endif
-        mOutM1[c] = output;
-        outputs[channelOffset + c][s] = output;
-      }
+      mOutM1[c] = Ramp(outputs[channelOffset + c], nFrames, mOutM1[c], inputs[channelOffset + c], mA);
     }
   }
+  
+  /** Fill a buffer with the output of a one-pole smoother going from start towards a constant target
+   * pOutput[s] = target + (start - target) * a^(s + 1), worked out four samples at a time
+   * @param pOutput Buffer for nFrames samples
+   * @param nFrames The number of samples
+   * @param start The previous output of the smoother
+   * @param target The input of the smoother
+   * @param a The feedback coefficient, see SetSmoothTime()
+   * @return The last output */
+  static T Ramp(T* pOutput, int nFrames, T start, T target, double a)
+  {
+    T powers[4];
+    double power = a;
+    
+    for (auto j = 0; j < 4; j++)
+    {
+      powers[j] = (T) power;
+      power *= a;
+    }
+    
+    const T a4 = (T) (a * a * a * a);
+    T diff = start - target;
+    int s = 0;
+    
+    for (; s + 4 <= nFrames; s += 4)
+    {
+      for (auto j = 0; j < 4; j++)
+        pOutput[s + j] = target + diff * powers[j];
+      
+      diff *= a4;
+      
+      // instead of denormal_fix() on every sample
+      if (std::abs(diff) < (T) 1e-15)
+        diff = 0;
+    }
+    
+    for (auto j = 0; j < (nFrames & 3); j++)
+      pOutput[s + j] = target + diff * powers[j];
+    
+    return nFrames ? pOutput[nFrames - 1] : start;
+  }
 
 } WDL_FIXALIGN;
 
@@ -92,19 +133,160 @@ class SmoothedGain
 public:
   void ProcessBlock(T** inputs, T** outputs, int nChans, int nFrames, double gainValue)
   {
+    DispatchNChans(nChans, [&](auto fixed) { ProcessBlockT<decltype(fixed)::value>(inputs, outputs, nChans, nFrames, gainValue); });
+  }
+  
+  /** Process a block with a channel count that is known at compile time, so that the loop over the channels is unrolled
+   * @tparam NCHANS The number of channels */
+  template <int NCHANS>
+  void ProcessBlock(T** inputs, T** outputs, int nFrames, double gainValue)
+  {
+    static_assert(NCHANS > 0, "NCHANS must be at least 1");
+    ProcessBlockT<NCHANS>(inputs, outputs, NCHANS, nFrames, gainValue);
+  }
+  
+private:
+  /** NCHANS is the number of channels if it is known at compile time, or 0 to use nChans */
+  template <int NCHANS>
+  void ProcessBlockT(T** inputs, T** outputs, int nChans, int nFrames, double gainValue)
+  {
+    const int n = NCHANS ? NCHANS : nChans;
+    
     for (auto s = 0; s < nFrames; ++s)
     {
       const double smoothedGain = mSmoother.Process(gainValue);
       
-      for (auto c = 0; c < nChans; c++)
+      for (auto c = 0; c < n; c++)
       {
         outputs[c][s] = inputs[c][s] * smoothedGain;
       }
     }
   }
   
-private:
+
   LogParamSmooth<double, 1> mSmoother;
 };
 
+/** Smooths a set of parameters, indexed like IParams, skipping the ones that are not moving.
+ * Call SetTarget() when a parameter changes, e.g. from OnParamChange(), then ProcessBlock() once per block, before reading Get().
+ * Each moving parameter is filled with LogParamSmooth::Ramp(), and once it is within the tolerance of its target it is snapped to it
+ * and dropped from the moving list, so a settled parameter costs nothing until its target changes again.
+ * NOTE: SetTarget() is not thread safe, so it should be called on the audio thread, or with the audio thread locked */
+template<typename T>
+class ParamSmoothers
+{
+public:
+  /** @param nParams The number of parameters, usually kNumParams
+   * @param timeMs The smoothing time
+   * @param tolerance How close to its target a parameter has to be to stop smoothing, relative to the larger of 1 and the target's magnitude */
+  ParamSmoothers(int nParams, double timeMs = 5., T tolerance = 1e-5)
+  : mTimeMs(timeMs)
+  , mTolerance(tolerance)
+  , mValues(nParams, 0)
+  , mTargets(nParams, 0)
+  , mMoving(nParams, false)
+  {
+    mMovingList.reserve(nParams);
+    Reset(DEFAULT_SAMPLE_RATE, DEFAULT_BLOCK_SIZE);
+  }
+  
+  /** Allocates the buffers, so call this from OnReset(), not while processing
+   * @param sampleRate The sample rate
+   * @param maxBlockSize The largest number of frames that will be passed to ProcessBlock() */
+  void Reset(double sampleRate, int maxBlockSize)
+  {
+    LogParamSmooth<T> smoother(mTimeMs);
+    smoother.SetSmoothTime(mTimeMs, sampleRate);
+    mA = smoother.GetCoefficient();
+    mMaxBlockSize = maxBlockSize;
+    mBuffers.resize(mValues.size() * maxBlockSize);
+    
+    for (auto i = 0; i < NParams(); i++)
+      SetValue(i, mTargets[i]);
+  }
+  
+  /** @param paramIdx The parameter
+   * @param target The value to smooth towards */
+  void SetTarget(int paramIdx, T target)
+  {
+    mTargets[paramIdx] = target;
+    
+    if (!mMoving[paramIdx] && target != mValues[paramIdx])
+    {
+      mMoving[paramIdx] = true;
+      mMovingList.push_back(paramIdx);
+    }
+  }
+  
+  /** Jump to a value without smoothing, e.g. when a preset is loaded
+   * @param paramIdx The parameter
+   * @param value The new value */
+  void SetValue(int paramIdx, T value)
+  {
+    mTargets[paramIdx] = mValues[paramIdx] = value;
+    std::fill_n(GetBuffer(paramIdx), mMaxBlockSize, value);
+    
+    // it stays on the moving list until the next ProcessBlock(), which finds it settled
+  }
+  
+  /** Smooth the moving parameters for a block
+   * @param nFrames The number of frames, no more than the maxBlockSize passed to Reset() */
+  void ProcessBlock(int nFrames)
+  {
+    assert(nFrames <= mMaxBlockSize);
+    
+    for (auto i = 0; i < static_cast<int>(mMovingList.size());)
+    {
+      const int paramIdx = mMovingList[i];
+      const T target = mTargets[paramIdx];
+      T* pBuffer = GetBuffer(paramIdx);
+      const T value = LogParamSmooth<T>::Ramp(pBuffer, nFrames, mValues[paramIdx], target, mA);
+      
+      if (std::abs(value - target) <= mTolerance * std::max((T) 1, std::abs(target)))
+      {
+        // settled, so the buffer is filled with the target once, then left alone until it moves again
+        SetValue(paramIdx, target);
+        mMoving[paramIdx] = false;
+        mMovingList[i] = mMovingList.back();
+        mMovingList.pop_back();
+      }
+      else
+      {
+        mValues[paramIdx] = value;
+        i++;
+      }
+    }
+  }
+  
+  /** @param paramIdx The parameter
+   * @return The smoothed values for the last block processed */
+  const T* Get(int paramIdx) const { return mBuffers.data() + paramIdx * mMaxBlockSize; }
+  
+  /** @param paramIdx The parameter
+   * @return The last smoothed value, which is constant over the block if the parameter is not moving */
+  T GetValue(int paramIdx) const { return mValues[paramIdx]; }
+  
+  /** @param paramIdx The parameter
+   * @return \c true if the parameter was moving in the last block, otherwise every value in Get() is the same */
+  bool IsMoving(int paramIdx) const { return mMoving[paramIdx]; }
+  
+  /** @return The number of parameters that are being smoothed */
+  int NMoving() const { return static_cast<int>(mMovingList.size()); }
+  
+  int NParams() const { return static_cast<int>(mValues.size()); }
+  
+private:
+  T* GetBuffer(int paramIdx) { return mBuffers.data() + paramIdx * mMaxBlockSize; }
+  
+  double mTimeMs;
+  double mA = 0.;
+  T mTolerance;
+  int mMaxBlockSize = 0;
+  std::vector<T> mValues;
+  std::vector<T> mTargets;
+  std::vector<bool> mMoving;
+  std::vector<int> mMovingList;
+  std::vector<T> mBuffers;
+};
+
 END_IPLUG_NAMESPACE
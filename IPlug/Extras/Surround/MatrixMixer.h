@@ -0,0 +1,416 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc MatrixMixer
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "IPlugPlatform.h"
+#include "IPlugUtilities.h"
+
+#include "SpeakerLayout.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** Mixes N input channels to M output channels through a matrix of gains, e.g. to downmix, upmix, reorder or pan between speaker layouts.
+ * Gain changes are ramped linearly over a number of frames, so they can be automated without zipper noise. Only the gains that are non zero or ramping are mixed,
+ * so a sparse matrix such as a reorder or a 7.1.4 to stereo downmix costs about as much as its non zero gains, and the inner loops use SSE2, NEON or WASM SIMD where IPlugPlatform.h enables them.
+ * SetSize() and SetDownmix() allocate, the other methods can be called on the audio thread.
+ * @tparam T The sample type */
+template <typename T = sample>
+class MatrixMixer
+{
+public:
+  /** @param nInputs The number of input channels
+   * @param nOutputs The number of output channels
+   * @param rampFrames The number of frames over which gain changes are ramped, see SetRampLength() */
+  MatrixMixer(int nInputs = 0, int nOutputs = 0, int rampFrames = 64)
+  : mRampFrames(std::max(rampFrames, 1))
+  {
+    SetSize(nInputs, nOutputs);
+  }
+
+  /** Resize the matrix, which sets all the gains to 0. Not for the audio thread
+   * @param nInputs The number of input channels
+   * @param nOutputs The number of output channels */
+  void SetSize(int nInputs, int nOutputs)
+  {
+    mNInputs = nInputs;
+    mNOutputs = nOutputs;
+    mGains.assign(nInputs * nOutputs, Gain());
+    mActive.assign(nOutputs, std::vector<int>());
+
+    for (auto& active : mActive)
+      active.reserve(nInputs);
+
+    mActiveChanged = true;
+  }
+
+  int NInputs() const { return mNInputs; }
+  int NOutputs() const { return mNOutputs; }
+
+  /** @param nFrames The number of frames over which the gain changes that follow are ramped, at least 1 */
+  void SetRampLength(int nFrames) { mRampFrames = std::max(nFrames, 1); }
+
+  /** Set the gain from an input to an output
+   * @param inIdx The input channel
+   * @param outIdx The output channel
+   * @param gain The linear gain
+   * @param immediate If \c true the gain changes at the start of the next block, rather than over the ramp length */
+  void SetGain(int inIdx, int outIdx, T gain, bool immediate = false)
+  {
+    assert(inIdx >= 0 && inIdx < mNInputs && outIdx >= 0 && outIdx < mNOutputs);
+    Gain& g = GetGainRef(inIdx, outIdx);
+
+    if (immediate)
+    {
+      g.mCurrent = g.mTarget = gain;
+      g.mRemaining = 0;
+    }
+    else if (gain != g.mTarget)
+    {
+      g.mTarget = gain;
+      g.mStep = (gain - g.mCurrent) / mRampFrames;
+      g.mRemaining = mRampFrames;
+    }
+
+    mActiveChanged = true;
+  }
+
+  /** @return The gain from an input to an output, ignoring any ramp in progress */
+  T GetGain(int inIdx, int outIdx) const { return mGains[outIdx * mNInputs + inIdx].mTarget; }
+
+  /** Set all the gains to 0
+   * @param immediate If \c false they are ramped */
+  void Clear(bool immediate = false)
+  {
+    for (auto o = 0; o < mNOutputs; o++)
+    {
+      for (auto i = 0; i < mNInputs; i++)
+        SetGain(i, o, T(0), immediate);
+    }
+  }
+
+  /** Connect each input to the output with the same index at unity gain, and disconnect everything else
+   * @param immediate If \c false the changes are ramped */
+  void SetIdentity(bool immediate = false)
+  {
+    for (auto o = 0; o < mNOutputs; o++)
+    {
+      for (auto i = 0; i < mNInputs; i++)
+        SetGain(i, o, T(i == o ? 1 : 0), immediate);
+    }
+  }
+
+  /** Size the matrix for two layouts and set the gains for a mix from one to the other. Speakers both layouts have are connected at unity gain, whatever their channel orders,
+   * and the others are folded into the nearest speakers the output has at -3 dB per step, e.g. the centre into left and right, the sides into the rear surrounds and the heights into the bed.
+   * Ambisonic and discrete layouts are connected channel for channel, this is not an ambisonic decoder. Allocates, so call it when the bus layout changes, not on the audio thread
+   * @param in The input layout
+   * @param out The output layout
+   * @param lfeGain The gain of the LFE into the main channels when the output has no LFE. ITU downmixes discard it
+   * @param immediate If \c false and the size is unchanged the changes are ramped */
+  void SetDownmix(const SpeakerLayout& in, const SpeakerLayout& out, T lfeGain = T(0), bool immediate = false)
+  {
+    const int nIn = in.NChans();
+    const int nOut = out.NChans();
+    std::vector<T> gains(nIn * nOut, T(0));
+
+    if (nIn != mNInputs || nOut != mNOutputs)
+    {
+      SetSize(nIn, nOut);
+      immediate = true;
+    }
+
+    if (in.GetType() != SpeakerLayout::kTypeSpeakers || out.GetType() != SpeakerLayout::kTypeSpeakers)
+    {
+      for (auto c = 0; c < std::min(nIn, nOut); c++)
+        gains[c * nIn + c] = T(1);
+    }
+    else
+    {
+      for (auto i = 0; i < nIn; i++)
+        FoldSpeaker(in.GetSpeaker(i), T(1), lfeGain, out, &gains[i], nIn);
+    }
+
+    for (auto o = 0; o < nOut; o++)
+    {
+      for (auto i = 0; i < nIn; i++)
+        SetGain(i, o, gains[o * nIn + i], immediate);
+    }
+  }
+
+  /** Mix a block. Every output channel is written, outputs without any input are zeroed
+   * @param inputs The input buffers, which must not be the same buffers as the outputs
+   * @param outputs The output buffers
+   * @param nFrames The number of frames */
+  void ProcessBlock(T** inputs, T** outputs, int nFrames)
+  {
+    if (mActiveChanged)
+      UpdateActive();
+
+    for (auto o = 0; o < mNOutputs; o++)
+    {
+      T* pOut = outputs[o];
+      bool written = false;
+
+      for (auto i : mActive[o])
+      {
+        Gain& g = GetGainRef(i, o);
+        MixChannel(pOut, inputs[i], g, nFrames, written);
+        written = true;
+
+        if (g.mRemaining == 0 && g.mCurrent == T(0))
+          mActiveChanged = true; // faded out
+      }
+
+      if (!written)
+        memset(pOut, 0, nFrames * sizeof(T));
+    }
+  }
+
+  /** pDest = pSrc * gain (or pDest += pSrc * gain), with the gain starting at gain and changing by step each frame
+   * @tparam Add If \c true the input is added to pDest */
+  template <bool Add>
+  static void Mix(float* pDest, const float* pSrc, float gain, float step, int n)
+  {
+    int i = 0;
+#if defined IPLUG_SIMD_SSE2
+    __m128 g = _mm_set_ps(gain + 3.f * step, gain + 2.f * step, gain + step, gain);
+    const __m128 inc = _mm_set1_ps(4.f * step);
+    for (; i + 4 <= n; i += 4)
+    {
+      __m128 y = _mm_mul_ps(_mm_loadu_ps(pSrc + i), g);
+      if (Add)
+        y = _mm_add_ps(_mm_loadu_ps(pDest + i), y);
+      _mm_storeu_ps(pDest + i, y);
+      g = _mm_add_ps(g, inc);
+    }
+#elif defined IPLUG_SIMD_NEON
+    const float lanes[4] = { gain, gain + step, gain + 2.f * step, gain + 3.f * step };
+    float32x4_t g = vld1q_f32(lanes);
+    const float32x4_t inc = vdupq_n_f32(4.f * step);
+    for (; i + 4 <= n; i += 4)
+    {
+      float32x4_t y = vmulq_f32(vld1q_f32(pSrc + i), g);
+      if (Add)
+        y = vaddq_f32(vld1q_f32(pDest + i), y);
+      vst1q_f32(pDest + i, y);
+      g = vaddq_f32(g, inc);
+    }
+#elif defined IPLUG_SIMD_WASM
+    v128_t g = wasm_f32x4_make(gain, gain + step, gain + 2.f * step, gain + 3.f * step);
+    const v128_t inc = wasm_f32x4_splat(4.f * step);
+    for (; i + 4 <= n; i += 4)
+    {
+      v128_t y = wasm_f32x4_mul(wasm_v128_load(pSrc + i), g);
+      if (Add)
+        y = wasm_f32x4_add(wasm_v128_load(pDest + i), y);
+      wasm_v128_store(pDest + i, y);
+      g = wasm_f32x4_add(g, inc);
+    }
+#endif
+    for (; i < n; ++i)
+      pDest[i] = (Add ? pDest[i] : 0.f) + pSrc[i] * (gain + step * i);
+  }
+
+  /** Double version of Mix() */
+  template <bool Add>
+  static void Mix(double* pDest, const double* pSrc, double gain, double step, int n)
+  {
+    int i = 0;
+#if defined IPLUG_SIMD_SSE2
+    __m128d g = _mm_set_pd(gain + step, gain);
+    const __m128d inc = _mm_set1_pd(2. * step);
+    for (; i + 2 <= n; i += 2)
+    {
+      __m128d y = _mm_mul_pd(_mm_loadu_pd(pSrc + i), g);
+      if (Add)
+        y = _mm_add_pd(_mm_loadu_pd(pDest + i), y);
+      _mm_storeu_pd(pDest + i, y);
+      g = _mm_add_pd(g, inc);
+    }
+#elif defined IPLUG_SIMD_NEON
+    const double lanes[2] = { gain, gain + step };
+    float64x2_t g = vld1q_f64(lanes);
+    const float64x2_t inc = vdupq_n_f64(2. * step);
+    for (; i + 2 <= n; i += 2)
+    {
+      float64x2_t y = vmulq_f64(vld1q_f64(pSrc + i), g);
+      if (Add)
+        y = vaddq_f64(vld1q_f64(pDest + i), y);
+      vst1q_f64(pDest + i, y);
+      g = vaddq_f64(g, inc);
+    }
+#elif defined IPLUG_SIMD_WASM
+    v128_t g = wasm_f64x2_make(gain, gain + step);
+    const v128_t inc = wasm_f64x2_splat(2. * step);
+    for (; i + 2 <= n; i += 2)
+    {
+      v128_t y = wasm_f64x2_mul(wasm_v128_load(pSrc + i), g);
+      if (Add)
+        y = wasm_f64x2_add(wasm_v128_load(pDest + i), y);
+      wasm_v128_store(pDest + i, y);
+      g = wasm_f64x2_add(g, inc);
+    }
+#endif
+    for (; i < n; ++i)
+      pDest[i] = (Add ? pDest[i] : 0.) + pSrc[i] * (gain + step * i);
+  }
+
+private:
+  struct Gain
+  {
+    T mCurrent = T(0);
+    T mTarget = T(0);
+    T mStep = T(0);
+    int mRemaining = 0; // frames left in the ramp
+  };
+
+  Gain& GetGainRef(int inIdx, int outIdx) { return mGains[outIdx * mNInputs + inIdx]; }
+
+  /** Rebuild the lists of the inputs that contribute to each output */
+  void UpdateActive()
+  {
+    for (auto o = 0; o < mNOutputs; o++)
+    {
+      mActive[o].clear();
+
+      for (auto i = 0; i < mNInputs; i++)
+      {
+        const Gain& g = GetGainRef(i, o);
+
+        if (g.mRemaining > 0 || g.mCurrent != T(0))
+          mActive[o].push_back(i); // capacity reserved in SetSize()
+      }
+    }
+
+    mActiveChanged = false;
+  }
+
+  /** Mix or copy one input into an output, advancing its ramp */
+  static void MixChannel(T* pOut, const T* pIn, Gain& g, int nFrames, bool add)
+  {
+    int done = 0;
+
+    if (g.mRemaining > 0)
+    {
+      done = std::min(nFrames, g.mRemaining);
+
+      if (add)
+        Mix<true>(pOut, pIn, g.mCurrent, g.mStep, done);
+      else
+        Mix<false>(pOut, pIn, g.mCurrent, g.mStep, done);
+
+      g.mRemaining -= done;
+      g.mCurrent = g.mRemaining > 0 ? g.mCurrent + g.mStep * done : g.mTarget;
+    }
+
+    const int n = nFrames - done;
+
+    if (n == 0)
+      return;
+
+    if (g.mCurrent != T(0))
+    {
+      if (add)
+        Mix<true>(pOut + done, pIn + done, g.mCurrent, T(0), n);
+      else if (g.mCurrent == T(1))
+        memcpy(pOut + done, pIn + done, n * sizeof(T));
+      else
+        Mix<false>(pOut + done, pIn + done, g.mCurrent, T(0), n);
+    }
+    else if (!add)
+    {
+      memset(pOut + done, 0, n * sizeof(T));
+    }
+  }
+
+  /** Add the gains of one input speaker to the speakers of the output layout that it folds into
+   * @param pGains The input's gain to output 0, with the gains to the other outputs stride apart */
+  static void FoldSpeaker(ESpeaker speaker, T gain, T lfeGain, const SpeakerLayout& out, T* pGains, int stride)
+  {
+    static constexpr T kMinus3dB = T(0.70710678118654752);
+
+    auto has = [&](ESpeaker s) { return out.FindSpeaker(s) >= 0; };
+    auto add = [&](ESpeaker s, T g) { pGains[out.FindSpeaker(s) * stride] += g; };
+    auto fold = [&](ESpeaker s, T g) { FoldSpeaker(s, g, lfeGain, out, pGains, stride); };
+
+    if (has(speaker))
+    {
+      add(speaker, gain);
+      return;
+    }
+
+    // L, R, C and M only fold into each other, everything else folds towards them, so this terminates
+    switch (speaker)
+    {
+      case kSpeakerL:
+      case kSpeakerR:
+        if (has(kSpeakerM)) add(kSpeakerM, gain * kMinus3dB);
+        else if (has(kSpeakerC)) add(kSpeakerC, gain * kMinus3dB);
+        break;
+      case kSpeakerC:
+        if (has(kSpeakerL) || has(kSpeakerR))
+        {
+          if (has(kSpeakerL)) add(kSpeakerL, gain * kMinus3dB);
+          if (has(kSpeakerR)) add(kSpeakerR, gain * kMinus3dB);
+        }
+        else if (has(kSpeakerM)) add(kSpeakerM, gain);
+        break;
+      case kSpeakerM:
+        if (has(kSpeakerC)) add(kSpeakerC, gain);
+        else
+        {
+          if (has(kSpeakerL)) add(kSpeakerL, gain * kMinus3dB);
+          if (has(kSpeakerR)) add(kSpeakerR, gain * kMinus3dB);
+        }
+        break;
+      case kSpeakerLFE:
+      case kSpeakerLFE2:
+        if (has(kSpeakerLFE)) add(kSpeakerLFE, gain);
+        else if (has(kSpeakerLFE2)) add(kSpeakerLFE2, gain);
+        else if (lfeGain != T(0)) fold(kSpeakerC, gain * lfeGain);
+        break;
+      case kSpeakerLs: if (has(kSpeakerSl)) add(kSpeakerSl, gain); else fold(kSpeakerL, gain * kMinus3dB); break;
+      case kSpeakerRs: if (has(kSpeakerSr)) add(kSpeakerSr, gain); else fold(kSpeakerR, gain * kMinus3dB); break;
+      case kSpeakerSl: if (has(kSpeakerLs)) add(kSpeakerLs, gain); else fold(kSpeakerL, gain * kMinus3dB); break;
+      case kSpeakerSr: if (has(kSpeakerRs)) add(kSpeakerRs, gain); else fold(kSpeakerR, gain * kMinus3dB); break;
+      case kSpeakerLc: fold(kSpeakerL, gain); break;
+      case kSpeakerRc: fold(kSpeakerR, gain); break;
+      case kSpeakerCs: fold(kSpeakerLs, gain * kMinus3dB); fold(kSpeakerRs, gain * kMinus3dB); break;
+      case kSpeakerTc: fold(kSpeakerC, gain * kMinus3dB); break;
+      case kSpeakerTfc: fold(kSpeakerC, gain * kMinus3dB); break;
+      case kSpeakerTfl: if (has(kSpeakerTsl)) add(kSpeakerTsl, gain); else fold(kSpeakerL, gain * kMinus3dB); break;
+      case kSpeakerTfr: if (has(kSpeakerTsr)) add(kSpeakerTsr, gain); else fold(kSpeakerR, gain * kMinus3dB); break;
+      case kSpeakerTsl: if (has(kSpeakerTfl)) add(kSpeakerTfl, gain); else fold(kSpeakerL, gain * kMinus3dB); break;
+      case kSpeakerTsr: if (has(kSpeakerTfr)) add(kSpeakerTfr, gain); else fold(kSpeakerR, gain * kMinus3dB); break;
+      case kSpeakerTrl: if (has(kSpeakerTsl)) add(kSpeakerTsl, gain); else fold(kSpeakerLs, gain * kMinus3dB); break;
+      case kSpeakerTrr: if (has(kSpeakerTsr)) add(kSpeakerTsr, gain); else fold(kSpeakerRs, gain * kMinus3dB); break;
+      case kSpeakerTrc: fold(kSpeakerCs, gain * kMinus3dB); break;
+      default: break;
+    }
+  }
+
+  int mNInputs = 0;
+  int mNOutputs = 0;
+  int mRampFrames;
+  std::vector<Gain> mGains; // mGains[outIdx * mNInputs + inIdx]
+  std::vector<std::vector<int>> mActive; // for each output, the inputs with non zero or ramping gains
+  bool mActiveChanged = true;
+};
+
+END_IPLUG_NAMESPACE
@@ -0,0 +1,377 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc SpeakerLayout
+ */
+
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+#include "IPlugPlatform.h"
+
+#if defined VST3_API
+  #include "pluginterfaces/vst/vstspeaker.h"
+#elif defined AU_API || defined AUv3_API
+  #include <CoreAudio/CoreAudioTypes.h>
+#elif defined AAX_API
+  #include "AAX_Enums.h"
+#endif
+
+BEGIN_IPLUG_NAMESPACE
+
+/** Speaker positions, in the order of the VST3 speaker bits, so that a layout sorted by speaker is in VST3 channel order.
+ * In 7.1 and above, Ls and Rs are the rear surrounds and Sl and Sr the side surrounds, as in VST3 */
+enum ESpeaker
+{
+  kSpeakerL = 0,
+  kSpeakerR,
+  kSpeakerC,
+  kSpeakerLFE,
+  kSpeakerLs,
+  kSpeakerRs,
+  kSpeakerLc,
+  kSpeakerRc,
+  kSpeakerCs,
+  kSpeakerSl,
+  kSpeakerSr,
+  kSpeakerTc,
+  kSpeakerTfl,
+  kSpeakerTfc,
+  kSpeakerTfr,
+  kSpeakerTrl,
+  kSpeakerTrc,
+  kSpeakerTrr,
+  kSpeakerLFE2,
+  kSpeakerM,
+  kSpeakerTsl,
+  kSpeakerTsr,
+  kNumSpeakers,
+  kSpeakerUnknown = kNumSpeakers
+};
+
+/** Describes the channels of a bus: which speaker each channel feeds, or that they are ambisonic components in ACN order, or just discrete channels.
+ * Layouts made from an API's speaker arrangement are in that API's channel order, e.g. AAX puts the centre second and the LFE after the surrounds, so compare layouts with HasSameSpeakers()
+ * and look channels up with FindSpeaker() rather than assuming an order. MatrixMixer::SetDownmix() makes a mix between any two layouts */
+class SpeakerLayout
+{
+public:
+  enum EType { kTypeSpeakers, kTypeAmbisonic, kTypeDiscrete };
+
+  SpeakerLayout() = default;
+
+  /** A speaker layout, with the channels in the order given */
+  SpeakerLayout(std::initializer_list<ESpeaker> speakers)
+  : mSpeakers(speakers)
+  {}
+
+  static SpeakerLayout Mono() { return { kSpeakerM }; }
+  static SpeakerLayout Stereo() { return { kSpeakerL, kSpeakerR }; }
+  static SpeakerLayout LCR() { return { kSpeakerL, kSpeakerR, kSpeakerC }; }
+  static SpeakerLayout Quad() { return { kSpeakerL, kSpeakerR, kSpeakerLs, kSpeakerRs }; }
+  static SpeakerLayout Surround50() { return { kSpeakerL, kSpeakerR, kSpeakerC, kSpeakerLs, kSpeakerRs }; }
+  static SpeakerLayout Surround51() { return { kSpeakerL, kSpeakerR, kSpeakerC, kSpeakerLFE, kSpeakerLs, kSpeakerRs }; }
+  static SpeakerLayout Surround71() { return { kSpeakerL, kSpeakerR, kSpeakerC, kSpeakerLFE, kSpeakerLs, kSpeakerRs, kSpeakerSl, kSpeakerSr }; }
+  static SpeakerLayout Surround714() { return { kSpeakerL, kSpeakerR, kSpeakerC, kSpeakerLFE, kSpeakerLs, kSpeakerRs, kSpeakerSl, kSpeakerSr, kSpeakerTfl, kSpeakerTfr, kSpeakerTrl, kSpeakerTrr }; }
+
+  /** @param order The ambisonic order, with (order + 1)^2 channels in ACN order */
+  static SpeakerLayout Ambisonic(int order)
+  {
+    SpeakerLayout layout;
+    layout.mType = kTypeAmbisonic;
+    layout.mNChans = (order + 1) * (order + 1);
+    return layout;
+  }
+
+  /** @param nChans The number of channels, which have no speaker positions */
+  static SpeakerLayout Discrete(int nChans)
+  {
+    SpeakerLayout layout;
+    layout.mType = kTypeDiscrete;
+    layout.mNChans = nChans;
+    return layout;
+  }
+
+  /** The usual layout for a number of channels, as the IPlugSurroundEffect example assumes, otherwise discrete channels */
+  static SpeakerLayout ForNumChannels(int nChans)
+  {
+    switch (nChans)
+    {
+      case 1: return Mono();
+      case 2: return Stereo();
+      case 3: return LCR();
+      case 4: return Quad();
+      case 5: return Surround50();
+      case 6: return Surround51();
+      case 8: return Surround71();
+      case 12: return Surround714();
+      default: return Discrete(nChans);
+    }
+  }
+
+  EType GetType() const { return mType; }
+
+  int NChans() const { return mType == kTypeSpeakers ? static_cast<int>(mSpeakers.size()) : mNChans; }
+
+  /** @return The ambisonic order, or -1 if the layout is not ambisonic */
+  int GetAmbisonicOrder() const
+  {
+    if (mType != kTypeAmbisonic)
+      return -1;
+
+    int order = 0;
+
+    while ((order + 1) * (order + 1) < mNChans)
+      order++;
+
+    return order;
+  }
+
+  /** @return The speaker a channel feeds, kSpeakerUnknown for ambisonic and discrete channels */
+  ESpeaker GetSpeaker(int chanIdx) const
+  {
+    return (mType == kTypeSpeakers && chanIdx >= 0 && chanIdx < NChans()) ? mSpeakers[chanIdx] : kSpeakerUnknown;
+  }
+
+  /** @return The channel that feeds a speaker, or -1 if the layout doesn't have it */
+  int FindSpeaker(ESpeaker speaker) const
+  {
+    for (auto c = 0; c < NChans(); c++)
+    {
+      if (GetSpeaker(c) == speaker)
+        return c;
+    }
+
+    return -1;
+  }
+
+  /** @return A bit per speaker in the layout, (1 << ESpeaker) */
+  uint32_t GetSpeakerMask() const
+  {
+    uint32_t mask = 0;
+
+    for (auto c = 0; c < NChans(); c++)
+    {
+      if (GetSpeaker(c) != kSpeakerUnknown)
+        mask |= 1u << GetSpeaker(c);
+    }
+
+    return mask;
+  }
+
+  /** @return \c true if the layouts have the same speakers or channel count and type, in any order */
+  bool HasSameSpeakers(const SpeakerLayout& other) const
+  {
+    if (mType != other.mType || NChans() != other.NChans())
+      return false;
+
+    return mType != kTypeSpeakers || GetSpeakerMask() == other.GetSpeakerMask();
+  }
+
+  bool operator==(const SpeakerLayout& other) const
+  {
+    return mType == other.mType && NChans() == other.NChans() && mSpeakers == other.mSpeakers;
+  }
+
+  bool operator!=(const SpeakerLayout& other) const { return !(*this == other); }
+
+#if defined VST3_API
+  /** @param arr A VST3 speaker arrangement, whose channels are in the order of its speaker bits */
+  static SpeakerLayout FromVST3(Steinberg::Vst::SpeakerArrangement arr)
+  {
+    using namespace Steinberg::Vst;
+
+    if (arr == SpeakerArr::kAmbi1stOrderACN) return Ambisonic(1);
+    if (arr == SpeakerArr::kAmbi2cdOrderACN) return Ambisonic(2);
+    if (arr == SpeakerArr::kAmbi3rdOrderACN) return Ambisonic(3);
+
+    SpeakerLayout layout;
+    const int nChans = SpeakerArr::getChannelCount(arr);
+
+    for (auto c = 0; c < nChans; c++)
+    {
+      const ESpeaker speaker = FromVST3Speaker(SpeakerArr::getSpeaker(arr, c));
+
+      if (speaker == kSpeakerUnknown)
+        return Discrete(nChans);
+
+      layout.mSpeakers.push_back(speaker);
+    }
+
+    return layout;
+  }
+
+  /** @return The VST3 speaker arrangement, which has its own channel order, so reorder with FindSpeaker() if this layout was not sorted by speaker */
+  Steinberg::Vst::SpeakerArrangement ToVST3() const
+  {
+    using namespace Steinberg::Vst;
+
+    switch (mType)
+    {
+      case kTypeAmbisonic:
+        switch (GetAmbisonicOrder())
+        {
+          case 1: return SpeakerArr::kAmbi1stOrderACN;
+          case 2: return SpeakerArr::kAmbi2cdOrderACN;
+          case 3: return SpeakerArr::kAmbi3rdOrderACN;
+          default: return SpeakerArr::kEmpty;
+        }
+      case kTypeDiscrete:
+        return SpeakerArr::kEmpty;
+      default:
+      {
+        SpeakerArrangement arr = 0;
+
+        for (auto speaker : mSpeakers)
+          arr |= ToVST3Speaker(speaker);
+
+        return arr;
+      }
+    }
+  }
+
+  static ESpeaker FromVST3Speaker(Steinberg::Vst::Speaker speaker)
+  {
+    for (auto s = 0; s < kNumSpeakers; s++)
+    {
+      if (ToVST3Speaker(static_cast<ESpeaker>(s)) == speaker)
+        return static_cast<ESpeaker>(s);
+    }
+
+    return kSpeakerUnknown;
+  }
+
+  static Steinberg::Vst::Speaker ToVST3Speaker(ESpeaker speaker)
+  {
+    using namespace Steinberg::Vst;
+
+    static const Speaker speakers[kNumSpeakers] = {
+      kSpeakerL, kSpeakerR, kSpeakerC, kSpeakerLfe, kSpeakerLs, kSpeakerRs, kSpeakerLc, kSpeakerRc, kSpeakerCs, kSpeakerSl, kSpeakerSr,
+      kSpeakerTc, kSpeakerTfl, kSpeakerTfc, kSpeakerTfr, kSpeakerTrl, kSpeakerTrc, kSpeakerTrr, kSpeakerLfe2, kSpeakerM, kSpeakerTsl, kSpeakerTsr
+    };
+
+    return speaker < kNumSpeakers ? speakers[speaker] : 0;
+  }
+
+  /** @return The value for GetAPIBusTypeForChannelIOConfig() */
+  uint64_t ToAPIBusType() const { return ToVST3(); }
+#endif
+
+#if defined AU_API || defined AUv3_API
+  /** @param tag An AudioChannelLayoutTag, in the channel order Core Audio defines for it */
+  static SpeakerLayout FromAudioChannelLayoutTag(AudioChannelLayoutTag tag)
+  {
+    switch (tag)
+    {
+      case kAudioChannelLayoutTag_Mono: return Mono();
+      case kAudioChannelLayoutTag_Stereo: return Stereo();
+      case kAudioChannelLayoutTag_MPEG_3_0_A: return LCR();
+      case kAudioChannelLayoutTag_Quadraphonic: return Quad();
+      case kAudioChannelLayoutTag_MPEG_5_0_A: return Surround50();
+      case kAudioChannelLayoutTag_MPEG_5_1_A: return Surround51();
+      // Core Audio's Ls/Rs are the sides in 7.1, and Rls/Rrs the rears
+      case kAudioChannelLayoutTag_AudioUnit_7_1: return { kSpeakerL, kSpeakerR, kSpeakerC, kSpeakerLFE, kSpeakerSl, kSpeakerSr, kSpeakerLs, kSpeakerRs };
+      case kAudioChannelLayoutTag_Atmos_7_1_4: return { kSpeakerL, kSpeakerR, kSpeakerC, kSpeakerLFE, kSpeakerSl, kSpeakerSr, kSpeakerLs, kSpeakerRs, kSpeakerTfl, kSpeakerTfr, kSpeakerTrl, kSpeakerTrr };
+      default: break;
+    }
+
+    const int nChans = static_cast<int>(AudioChannelLayoutTag_GetNumberOfChannels(tag));
+
+    if ((tag & 0xFFFF0000) == kAudioChannelLayoutTag_HOA_ACN_SN3D)
+    {
+      SpeakerLayout layout = Ambisonic(0);
+      layout.mNChans = nChans;
+      return layout;
+    }
+
+    return Discrete(nChans);
+  }
+
+  /** @return The AudioChannelLayoutTag with the same speakers */
+  AudioChannelLayoutTag ToAudioChannelLayoutTag() const
+  {
+    if (mType == kTypeAmbisonic)
+      return kAudioChannelLayoutTag_HOA_ACN_SN3D | NChans();
+
+    if (mType == kTypeSpeakers)
+    {
+      static const AudioChannelLayoutTag tags[] = {
+        kAudioChannelLayoutTag_Mono, kAudioChannelLayoutTag_Stereo, kAudioChannelLayoutTag_MPEG_3_0_A, kAudioChannelLayoutTag_Quadraphonic,
+        kAudioChannelLayoutTag_MPEG_5_0_A, kAudioChannelLayoutTag_MPEG_5_1_A, kAudioChannelLayoutTag_AudioUnit_7_1, kAudioChannelLayoutTag_Atmos_7_1_4
+      };
+
+      for (auto tag : tags)
+      {
+        if (HasSameSpeakers(FromAudioChannelLayoutTag(tag)))
+          return tag;
+      }
+    }
+
+    return kAudioChannelLayoutTag_DiscreteInOrder | NChans();
+  }
+
+  /** @return The value for GetAPIBusTypeForChannelIOConfig() */
+  uint64_t ToAPIBusType() const { return ToAudioChannelLayoutTag(); }
+#endif
+
+#if defined AAX_API
+  /** @param format An AAX stem format, in Pro Tools' channel order, e.g. L C R Ls Rs LFE for 5.1 */
+  static SpeakerLayout FromAAXStemFormat(AAX_EStemFormat format)
+  {
+    switch (format)
+    {
+      case AAX_eStemFormat_Mono: return Mono();
+      case AAX_eStemFormat_Stereo: return Stereo();
+      case AAX_eStemFormat_LCR: return { kSpeakerL, kSpeakerC, kSpeakerR };
+      case AAX_eStemFormat_Quad: return Quad();
+      case AAX_eStemFormat_5_0: return { kSpeakerL, kSpeakerC, kSpeakerR, kSpeakerLs, kSpeakerRs };
+      case AAX_eStemFormat_5_1: return { kSpeakerL, kSpeakerC, kSpeakerR, kSpeakerLs, kSpeakerRs, kSpeakerLFE };
+      // Lss/Rss are the sides and Lsr/Rsr the rears
+      case AAX_eStemFormat_7_1_DTS: return { kSpeakerL, kSpeakerC, kSpeakerR, kSpeakerSl, kSpeakerSr, kSpeakerLs, kSpeakerRs, kSpeakerLFE };
+      case AAX_eStemFormat_7_1_4: return { kSpeakerL, kSpeakerC, kSpeakerR, kSpeakerSl, kSpeakerSr, kSpeakerLs, kSpeakerRs, kSpeakerLFE, kSpeakerTfl, kSpeakerTfr, kSpeakerTrl, kSpeakerTrr };
+      case AAX_eStemFormat_Ambi_1_ACN: return Ambisonic(1);
+      case AAX_eStemFormat_Ambi_2_ACN: return Ambisonic(2);
+      case AAX_eStemFormat_Ambi_3_ACN: return Ambisonic(3);
+      default: return Discrete(AAX_STEM_FORMAT_CHANNEL_COUNT(format));
+    }
+  }
+
+  /** @return The AAX stem format with the same speakers */
+  AAX_EStemFormat ToAAXStemFormat() const
+  {
+    static const AAX_EStemFormat formats[] = {
+      AAX_eStemFormat_Mono, AAX_eStemFormat_Stereo, AAX_eStemFormat_LCR, AAX_eStemFormat_Quad, AAX_eStemFormat_5_0, AAX_eStemFormat_5_1,
+      AAX_eStemFormat_7_1_DTS, AAX_eStemFormat_7_1_4, AAX_eStemFormat_Ambi_1_ACN, AAX_eStemFormat_Ambi_2_ACN, AAX_eStemFormat_Ambi_3_ACN
+    };
+
+    for (auto format : formats)
+    {
+      if (HasSameSpeakers(FromAAXStemFormat(format)))
+        return format;
+    }
+
+    return AAX_eStemFormat_None;
+  }
+
+  /** @return The value for GetAPIBusTypeForChannelIOConfig() */
+  uint64_t ToAPIBusType() const { return ToAAXStemFormat(); }
+#endif
+
+private:
+  EType mType = kTypeSpeakers;
+  int mNChans = 0; // for ambisonic and discrete layouts
+  std::vector<ESpeaker> mSpeakers;
+};
+
+END_IPLUG_NAMESPACE
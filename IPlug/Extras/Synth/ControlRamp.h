@@ -47,6 +47,17 @@ struct ControlRamp
     return (startValue != 0.) || (endValue != 0.);
   }
 
+  /** @return The value of the piecewise function at a sample index in the block */
+  double ValueAt(int sampleIdx) const
+  {
+    if(sampleIdx <= transitionStart)
+      return startValue;
+    if(sampleIdx >= transitionEnd)
+      return endValue;
+
+    return startValue + (endValue - startValue) * (sampleIdx - transitionStart) / (transitionEnd - transitionStart);
+  }
+
   /** Writes the ramp signal to an output buffer.
    * @param buffer Pointer to the start of an output buffer.
    * @param startIdx Sample index of the start of the desired write within the buffer.
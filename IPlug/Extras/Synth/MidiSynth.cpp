@@ -146,22 +146,22 @@ VoiceInputEvent MidiSynth::MidiMessageToEventMPE(const IMidiMsg& msg)
       float bendRange = mChannelStates[event.mAddress.mChannel].pitchBendRange;
       event.mValue = static_cast<float>(msg.PitchWheel()) * bendRange / 12.f;
 
-      pChannelDestValue = &(mChannelStates[event.mAddress.mChannel].pitchBend);
-      masterChannelStoredValue = mChannelStates[MasterChannelFor(event.mAddress.mChannel)].pitchBend;
+      pChannelDestValue = &mChannelExpressions[kChannelPitchBend][event.mAddress.mChannel];
+      masterChannelStoredValue = mChannelExpressions[kChannelPitchBend][MasterChannelFor(event.mAddress.mChannel)];
     }
     else if(isChannelPressure)
     {
       event.mAction = kPressureAction;
       event.mValue = mAfterTouchLUT[msg.ChannelAfterTouch()];
-      pChannelDestValue = &(mChannelStates[event.mAddress.mChannel].pressure);
-      masterChannelStoredValue = mChannelStates[MasterChannelFor(event.mAddress.mChannel)].pressure;
+      pChannelDestValue = &mChannelExpressions[kChannelPressure][event.mAddress.mChannel];
+      masterChannelStoredValue = mChannelExpressions[kChannelPressure][MasterChannelFor(event.mAddress.mChannel)];
     }
     else if(isTimbre)
     {
       event.mAction = kTimbreAction;
       event.mValue = static_cast<float>(msg.ControlChange(msg.ControlChangeIdx()));
-      pChannelDestValue = &(mChannelStates[event.mAddress.mChannel].timbre);
-      masterChannelStoredValue = mChannelStates[MasterChannelFor(event.mAddress.mChannel)].timbre;
+      pChannelDestValue = &mChannelExpressions[kChannelTimbre][event.mAddress.mChannel];
+      masterChannelStoredValue = mChannelExpressions[kChannelTimbre][MasterChannelFor(event.mAddress.mChannel)];
     }
 
     if(IsMasterChannel(event.mAddress.mChannel))
@@ -256,6 +256,92 @@ VoiceInputEvent MidiSynth::MidiMessageToEvent(const IMidiMsg& msg)
   return (mMPEMode ? MidiMessageToEventMPE(msg) : MidiMessageToEventBasic(msg));
 }
 
+VoiceInputEvent MidiSynth::MidiMessageToEvent(const IMidi2Msg& msg)
+{
+  VoiceInputEvent event{};
+  event.mSampleOffset = msg.mOffset;
+  event.mAddress.mChannel = msg.Channel();
+  event.mAddress.mKey = msg.NoteNumber();
+
+  switch (msg.StatusMsg())
+  {
+    case IMidi2Msg::kNoteOn:
+    {
+      event.mAction = kNoteOnAction;
+      event.mValue = static_cast<float>(msg.Velocity());
+      break;
+    }
+    case IMidi2Msg::kNoteOff:
+    {
+      event.mAction = kNoteOffAction;
+      event.mValue = static_cast<float>(msg.Velocity());
+      break;
+    }
+    case IMidi2Msg::kPolyPressure:
+    case IMidi2Msg::kChannelPressure:
+    {
+      event.mAction = kPressureAction;
+      event.mValue = static_cast<float>(msg.Value());
+      break;
+    }
+    case IMidi2Msg::kPitchBend:
+    {
+      event.mAction = kPitchBendAction;
+      float bendRange = mChannelStates[event.mAddress.mChannel].pitchBendRange;
+      event.mValue = static_cast<float>(msg.PitchBend()) * bendRange / 12.f;
+      break;
+    }
+    case IMidi2Msg::kPerNotePitchBend:
+    {
+      event.mAction = kPitchBendAction;
+      event.mValue = static_cast<float>(msg.PitchBend()) * IMidi2Msg::kDefaultPerNotePitchBendRange / 12.f;
+      break;
+    }
+    case IMidi2Msg::kControlChange:
+    case IMidi2Msg::kRegisteredPerNoteController:
+    {
+      // registered per-note controllers use the same numbers as the CCs they correspond to
+      event.mControllerNumber = msg.ControllerIdx();
+      event.mValue = static_cast<float>(msg.Value());
+      switch(event.mControllerNumber)
+      {
+        case IMidiMsg::kCutoffFrequency:
+        {
+          event.mAction = kTimbreAction;
+          break;
+        }
+        case IMidiMsg::kAllNotesOff:
+        {
+          if(msg.StatusMsg() == IMidi2Msg::kControlChange)
+          {
+            event.mAddress.mFlags = kVoicesAll;
+            event.mAction = kNoteOffAction;
+          }
+          break;
+        }
+        default:
+        {
+          event.mAction = kControllerAction;
+          break;
+        }
+      }
+      break;
+    }
+    case IMidi2Msg::kProgramChange:
+    {
+      event.mAction = kProgramChangeAction;
+      event.mControllerNumber = msg.Program();
+      break;
+    }
+    default:
+    {
+      break;
+    }
+  }
+
+  return event;
+}
+
 // sets the number of channels in the lo or hi MPE zones.
 void MidiSynth::SetMPEZones(int channel, int nChans)
 {
@@ -398,7 +484,10 @@ bool MidiSynth::ProcessBlock(sample** inputs, sample** outputs, int nInputs, int
 {
   assert(NVoices());
 
-  if (mVoicesAreActive | !mMidiQueue.Empty())
+  // tick the shared modulation while the synth is silent too, so that e.g. free running LFOs keep their phase
+  mModulationBus.ProcessBlock(0, nFrames);
+
+  if (mVoicesAreActive | !mMidiQueue.Empty() | !mMidi2Queue.Empty())
   {
     int blockSize = mBlockSize;
     int samplesRemaining = nFrames;
@@ -409,8 +498,29 @@ bool MidiSynth::ProcessBlock(sample** inputs, sample** outputs, int nInputs, int
       if(samplesRemaining < blockSize)
         blockSize = samplesRemaining;
 
-      while (!mMidiQueue.Empty())
+      while (!mMidiQueue.Empty() || !mMidi2Queue.Empty())
       {
+        // take the earliest message from either queue, MIDI 1.0 first at the same offset, so that a note on comes before per-note messages for it
+        if (!mMidi2Queue.Empty() && (mMidiQueue.Empty() || mMidi2Queue.Peek().mOffset < mMidiQueue.Peek().mOffset))
+        {
+          IMidi2Msg msg = mMidi2Queue.Peek();
+
+          if (msg.mOffset > startIndex + blockSize) break;
+
+          if(msg.StatusMsg() == IMidi2Msg::kRegisteredController && msg.ControllerIdx() == 0 && ((msg.mWords[0] >> 8) & 0x7F) == 0)
+          {
+            // RPN 0 : pitch bend range, in semitones in the top 7 bits
+            SetChannelPitchBendRange(msg.Channel(), msg.mWords[1] >> 25);
+          }
+          else
+          {
+            msg.mOffset -= startIndex;
+            mVoiceAllocator.AddEvent(MidiMessageToEvent(msg));
+          }
+          mMidi2Queue.Remove();
+          continue;
+        }
+
         IMidiMsg msg = mMidiQueue.Peek();
 
         // we assume the messages are in chronological order. If we find one later than the current block we are done.
@@ -460,6 +570,7 @@ bool MidiSynth::ProcessBlock(sample** inputs, sample** outputs, int nInputs, int
     mVoicesAreActive = voicesbusy;
 
     mMidiQueue.Flush(nFrames);
+    mMidi2Queue.Flush(nFrames);
   }
   else // empty block
   {
@@ -474,11 +585,17 @@ void MidiSynth::SetSampleRateAndBlockSize(double sampleRate, int blockSize)
   Reset();
 
   mSampleRate = sampleRate;
-  mMidiQueue.Resize(blockSize);
+  // the queues have a fixed size on the audio thread, so leave room for dense MIDI in small blocks
+  mMidiQueue.Resize(std::max(blockSize, DEFAULT_BLOCK_SIZE));
+  mMidi2Queue.Resize(std::max(blockSize, DEFAULT_BLOCK_SIZE));
   mVoiceAllocator.SetSampleRateAndBlockSize(sampleRate, blockSize);
+  mModulationBus.SetSampleRateAndBlockSize(sampleRate, blockSize);
 
   for(int v = 0; v < NVoices(); v++)
   {
     GetVoice(v)->SetSampleRateAndBlockSize(sampleRate, blockSize);
   }
+
+  if(SynthVoiceBank* pBank = mVoiceAllocator.GetVoiceBank())
+    pBank->SetSampleRateAndBlockSize(sampleRate, blockSize);
 }
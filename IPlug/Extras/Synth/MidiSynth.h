@@ -94,6 +94,19 @@ public:
     mVoiceAllocator.mATMode = mode;
   }
 
+  /** Choose whether the oldest or the quietest voice is stolen when all voices are busy */
+  void SetStealMode(VoiceAllocator::EStealMode mode)
+  {
+    mVoiceAllocator.SetStealMode(mode);
+  }
+
+  /** Stop rendering released voices once their level drops below a threshold
+   * @param level Linear level, 0. disables this */
+  void SetSilenceThreshold(float level)
+  {
+    mVoiceAllocator.SetSilenceThreshold(level);
+  }
+
   /** Set this function to something other than the default
    * if you need to implement a tuning table for microtonal support
    * @param fn A function taking an integer key value and returning a double-precision
@@ -137,14 +150,37 @@ public:
   /** adds a SynthVoice to this MidiSynth, taking ownership of the object. */
   void AddVoice(SynthVoice* pVoice, uint8_t zone)
   {
+    pVoice->mModulation = &mModulationBus;
     mVoiceAllocator.AddVoice(pVoice, zone);
   }
 
+  /** The global modulation sources shared by all of the voices, which the synth ticks at the start of every ProcessBlock(), whether or not voices are active.
+   * Add sources and set the control rate when setting up the synth, voices read the buffers through SynthVoice::mModulation */
+  ModulationBus<sample>& GetModulationBus()
+  {
+    return mModulationBus;
+  }
+
+  /** Render busy voices through a SynthVoiceBank rather than one at a time. We do not take ownership of the bank.
+   * @param pBank Pointer to the bank, or nullptr to render voices individually */
+  void SetVoiceBank(SynthVoiceBank* pBank)
+  {
+    mVoiceAllocator.SetVoiceBank(pBank);
+  }
+
   void AddMidiMsgToQueue(const IMidiMsg& msg)
   {
     mMidiQueue.Add(msg);
   }
 
+  /** Add a MIDI 2.0 message, e.g. from IPlugProcessor::ProcessMidi2Msg(). Values are passed to the voices at full resolution, and per-note controllers
+   * and per-note pitch bend are sent to the voice playing the key. These messages are not subject to the MPE zone logic, since per-note messages make member channels unnecessary
+   * @param msg The MIDI 2.0 message */
+  void AddMidi2MsgToQueue(const IMidi2Msg& msg)
+  {
+    mMidi2Queue.Add(msg);
+  }
+
   /** Processes a block of audio samples
    * @param inputs Pointer to input Arrays
    * @param outputs Pointer to output Arrays
@@ -164,11 +200,11 @@ private:
     uint8_t valueMSB;
     uint8_t valueLSB;
     uint8_t pitchBendRange; // in semitones
-    float pitchBend;
-    float pressure;
-    float timbre;
   };
 
+  // the summed MPE expression values are kept apart from the RPN state, with the values for all channels side by side
+  enum EChannelExpression { kChannelPitchBend = 0, kChannelPressure, kChannelTimbre, kNumChannelExpressions };
+
   // MPE helper functions
   const int kMPELowerZoneMasterChannel = 0;
   const int kMPEUpperZoneMasterChannel = 15;
@@ -190,15 +226,19 @@ private:
   VoiceInputEvent MidiMessageToEventBasic(const IMidiMsg& msg);
   VoiceInputEvent MidiMessageToEventMPE(const IMidiMsg& msg);
   VoiceInputEvent MidiMessageToEvent(const IMidiMsg& msg);
+  VoiceInputEvent MidiMessageToEvent(const IMidi2Msg& msg);
   void HandleRPN(IMidiMsg msg);
 
   // basic MIDI data
   VoiceAllocator mVoiceAllocator;
+  ModulationBus<sample> mModulationBus;
   uint16_t mUnisonVoices{1};
-  IMidiQueue mMidiQueue;
+  IFixedMidiQueue mMidiQueue;
+  IFixedMidi2Queue mMidi2Queue;
   float mVelocityLUT[128];
   float mAfterTouchLUT[128];
   ChannelState mChannelStates[16]{};
+  float mChannelExpressions[kNumChannelExpressions][16]{};
   int mBlockSize;
   int64_t mSampleTime{0};
   double mSampleRate = DEFAULT_SAMPLE_RATE;
@@ -0,0 +1,199 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+ */
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc ModulationBus
+ */
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include "IPlugConstants.h"
+#include "IPlugUtilities.h"
+#include "ControlRamp.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** A ModulationBus computes global modulation sources, such as LFOs and smoothed parameters, once per block for all voices,
+ * rather than each voice computing them. Sources are ticked at a control rate, every few samples, and the values in between are interpolated linearly
+ * into a block buffer per source, which voices read directly with GetBuffer(), at the same startIdx as SynthVoice::ProcessSamplesAccumulating().
+ * MidiSynth owns one and ticks it for every block, so a voice reaches it through SynthVoice::mModulation.
+ * WriteRamp() gives voices the same control rate treatment for their own ControlRamp inputs. */
+template <typename T = sample>
+class ModulationBus
+{
+public:
+  static constexpr int kDefaultControlRate = 16;
+  static constexpr int kMaxControlRate = 256;
+
+  /** A source is called once per control tick with the tick length in samples, and returns its value at the end of the tick. It is called on the audio thread */
+  using SourceFunc = std::function<T(int nSamples)>;
+
+  /** Sets how many samples there are between control ticks. The rate is rounded up to a power of two, up to kMaxControlRate, so 1 ticks the sources every sample
+   * @param nSamples The number of samples per tick, e.g. 16 or 32 */
+  void SetControlRate(int nSamples)
+  {
+    int rate = 1;
+
+    while (rate < nSamples && rate < kMaxControlRate)
+      rate <<= 1;
+
+    mControlRate = rate;
+    mTickPos = 0;
+  }
+
+  int GetControlRate() const { return mControlRate; }
+
+  /** Adds a global modulation source. Call this when setting up the synth, not on the audio thread
+   * @param func The function that computes the source, see SourceFunc
+   * @return The index of the source, which is its buffer index for GetBuffer() */
+  int AddSource(SourceFunc func)
+  {
+    Source source;
+    source.func = std::move(func);
+    source.buffer.resize(mBlockSize);
+    mSources.push_back(std::move(source));
+    return NSources() - 1;
+  }
+
+  int NSources() const { return static_cast<int>(mSources.size()); }
+
+  void SetSampleRateAndBlockSize(double sampleRate, int blockSize)
+  {
+    mSampleRate = sampleRate;
+    mBlockSize = blockSize;
+
+    for (auto& source : mSources)
+      source.buffer.resize(blockSize);
+
+    Reset();
+  }
+
+  double GetSampleRate() const { return mSampleRate; }
+
+  /** Restarts the tick grid, so that the next block starts with a tick and each source jumps to its first value rather than gliding from the last */
+  void Reset()
+  {
+    mTickPos = 0;
+
+    for (auto& source : mSources)
+      source.started = false;
+  }
+
+  /** Ticks the sources for a block and writes their interpolated values into their buffers. The tick grid carries on across blocks, so a block need not be a multiple of the control rate.
+   * @param startIdx The start index in the buffers, as for SynthVoice::ProcessSamplesAccumulating()
+   * @param nFrames The number of samples to write */
+  void ProcessBlock(int startIdx, int nFrames)
+  {
+    assert(startIdx + nFrames <= mBlockSize);
+
+    const int rate = mControlRate;
+    int tickPos = mTickPos;
+
+    for (auto& source : mSources)
+    {
+      T* pDest = source.buffer.data() + startIdx;
+      int pos = tickPos;
+      int s = 0;
+
+      while (s < nFrames)
+      {
+        if (pos == 0)
+        {
+          const T next = source.func(rate);
+          source.start = source.started ? source.end : next;
+          source.end = next;
+          source.inc = (source.end - source.start) / static_cast<T>(rate);
+          source.started = true;
+        }
+
+        const int n = std::min(rate - pos, nFrames - s);
+        T value = source.start + source.inc * static_cast<T>(pos);
+
+        for (auto i = 0; i < n; i++)
+        {
+          value += source.inc;
+          pDest[s + i] = value;
+        }
+
+        s += n;
+        pos = (pos + n) & (rate - 1);
+      }
+    }
+
+    mTickPos = (tickPos + nFrames) & (rate - 1);
+  }
+
+  /** @return The block buffer of a source, to be indexed from the same startIdx as was passed to ProcessBlock() */
+  const T* GetBuffer(int sourceIdx) const { return mSources[sourceIdx].buffer.data(); }
+
+  /** @return The value of a source at the end of its latest tick, for voices that only need one value per block */
+  T GetValue(int sourceIdx) const { return mSources[sourceIdx].end; }
+
+  /** Writes a voice's ControlRamp through a mapping function, which is only evaluated at the control rate, interpolating linearly in between.
+   * Use this for inputs that go through something expensive, e.g. pitch to frequency, rather than mapping every sample of ControlRamp::Write()
+   * @param ramp The ramp to write
+   * @param mapFunc The function applied to the ramp's value, e.g. [](double pitch) { return 440. * std::pow(2., pitch); }
+   * @param pDest The output buffer
+   * @param startIdx The start index in pDest, and the ramp's sample index 0
+   * @param nFrames The number of samples to write
+   * @param controlRate The number of samples between evaluations of mapFunc */
+  template <typename F>
+  static void WriteRamp(const ControlRamp& ramp, F&& mapFunc, T* pDest, int startIdx, int nFrames, int controlRate = kDefaultControlRate)
+  {
+    T value = static_cast<T>(mapFunc(ramp.ValueAt(0)));
+
+    if (ramp.startValue == ramp.endValue)
+    {
+      for (auto i = 0; i < nFrames; i++)
+        pDest[startIdx + i] = value;
+
+      return;
+    }
+
+    for (auto s = 0; s < nFrames; s += controlRate)
+    {
+      const int n = std::min(controlRate, nFrames - s);
+      const T next = static_cast<T>(mapFunc(ramp.ValueAt(s + n)));
+      const T inc = (next - value) / static_cast<T>(n);
+
+      for (auto i = 0; i < n; i++)
+      {
+        value += inc;
+        pDest[startIdx + s + i] = value;
+      }
+
+      value = next;
+    }
+  }
+
+private:
+  struct Source
+  {
+    SourceFunc func;
+    std::vector<T> buffer;
+    T start = 0;
+    T end = 0;
+    T inc = 0;
+    bool started = false;
+  };
+
+  std::vector<Source> mSources;
+  double mSampleRate = DEFAULT_SAMPLE_RATE;
+  int mBlockSize = DEFAULT_BLOCK_SIZE;
+  int mControlRate = kDefaultControlRate;
+  int mTickPos = 0;
+};
+
+END_IPLUG_NAMESPACE
@@ -0,0 +1,694 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc SampleStreamer
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#ifdef OS_WIN
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+#include "IPlugPaths.h"
+#include "IPlugSignal.h"
+#include "IPlugUtilities.h"
+#include "ADSREnvelope.h"
+#include "SynthVoice.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** A .wav file for a SampleStreamer, whose first frames are kept in memory. The rest is read by the streamer's I/O thread, either with file reads, or
+ * from a memory mapping of the file. 16, 24 and 32 bit integer and 32 bit float PCM are supported, converted to float. The key and velocity range
+ * it is mapped to are used by SampleStreamer::FindSample() */
+class StreamingSample
+{
+public:
+  StreamingSample(int rootKey, int lowKey, int highKey, int lowVelocity, int highVelocity)
+  : mRootKey(rootKey), mLowKey(lowKey), mHighKey(highKey), mLowVelocity(lowVelocity), mHighVelocity(highVelocity)
+  {
+  }
+
+  ~StreamingSample() { Close(); }
+
+  StreamingSample(const StreamingSample&) = delete;
+  StreamingSample& operator=(const StreamingSample&) = delete;
+
+  /** Open a .wav file, and read its first frames into memory
+   * @param path The UTF-8 path of the file
+   * @param preloadFrames The number of frames to keep in memory, which have to cover the time it takes the I/O thread to start streaming
+   * @param memoryMap If \c true the file is accessed through a memory mapping rather than file reads
+   * @return \c true on success */
+  bool Open(const char* path, int preloadFrames, bool memoryMap)
+  {
+    Close();
+
+#ifdef OS_WIN
+    wchar_t pathW[MAX_WIN32_PATH_LEN];
+    UTF8ToUTF16(pathW, path, MAX_WIN32_PATH_LEN);
+    mFile = _wfopen(pathW, L"rb");
+#else
+    mFile = fopen(path, "rb");
+#endif
+
+    if (!mFile || !ReadHeader())
+    {
+      Close();
+      return false;
+    }
+
+    if (memoryMap)
+      MapFile(path);
+
+    mNPreloadFrames = static_cast<int>(std::min<int64_t>(preloadFrames, mNFrames));
+    mPreload.resize(static_cast<size_t>(mNPreloadFrames) * mNChans);
+    std::vector<uint8_t> scratch;
+
+    if (!Read(0, mNPreloadFrames, mPreload.data(), scratch))
+    {
+      Close();
+      return false;
+    }
+
+    return true;
+  }
+
+  void Close()
+  {
+#ifdef OS_WIN
+    if (mMapping)
+    {
+      UnmapViewOfFile(mMapping);
+      CloseHandle(mMapHandle);
+      CloseHandle(mMapFile);
+    }
+#else
+    if (mMapping)
+      munmap(const_cast<uint8_t*>(mMapping), mMapSize);
+#endif
+    mMapping = nullptr;
+
+    if (mFile)
+      fclose(mFile);
+
+    mFile = nullptr;
+  }
+
+  /** Read frames and convert them to interleaved floats. This is called by the I/O thread, and by Open() for the preload
+   * @param startFrame The first frame
+   * @param nFrames The number of frames, which must be within the file
+   * @param pDest Space for nFrames * NChans() floats
+   * @param scratch Storage for the raw data when not memory mapped, which grows on the first use
+   * @return \c true on success */
+  bool Read(int64_t startFrame, int nFrames, float* pDest, std::vector<uint8_t>& scratch) const
+  {
+    const size_t nBytes = static_cast<size_t>(nFrames) * mFrameBytes;
+    const int64_t offset = mDataOffset + startFrame * mFrameBytes;
+    const uint8_t* pSrc = nullptr;
+
+    if (mMapping)
+    {
+      pSrc = mMapping + offset; // page faults happen here, on the I/O thread
+    }
+    else
+    {
+      if (scratch.size() < nBytes)
+        scratch.resize(nBytes);
+
+#ifdef OS_WIN
+      if (_fseeki64(mFile, offset, SEEK_SET) || fread(scratch.data(), 1, nBytes, mFile) != nBytes)
+#else
+      if (fseeko(mFile, offset, SEEK_SET) || fread(scratch.data(), 1, nBytes, mFile) != nBytes)
+#endif
+        return false;
+
+      pSrc = scratch.data();
+    }
+
+    Convert(pSrc, pDest, nFrames * mNChans);
+    return true;
+  }
+
+  int NChans() const { return mNChans; }
+  int64_t NFrames() const { return mNFrames; }
+  int NPreloadFrames() const { return mNPreloadFrames; }
+  double GetSampleRate() const { return mSampleRate; }
+  const float* GetPreload() const { return mPreload.data(); }
+  bool IsMemoryMapped() const { return mMapping != nullptr; }
+
+  /** @return \c true if the sample is mapped to the key and the velocity */
+  bool Matches(int key, int velocity) const
+  {
+    return key >= mLowKey && key <= mHighKey && velocity >= mLowVelocity && velocity <= mHighVelocity;
+  }
+
+  const int mRootKey;
+  const int mLowKey;
+  const int mHighKey;
+  const int mLowVelocity;
+  const int mHighVelocity;
+
+private:
+  enum class EFormat { kInt16, kInt24, kInt32, kFloat32 };
+
+  static uint32_t ReadLE32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24); }
+  static uint16_t ReadLE16(const uint8_t* p) { return static_cast<uint16_t>(p[0] | (p[1] << 8)); }
+
+  bool ReadHeader()
+  {
+    uint8_t riff[12];
+
+    if (fread(riff, 1, 12, mFile) != 12 || memcmp(riff, "RIFF", 4) || memcmp(riff + 8, "WAVE", 4))
+      return false;
+
+    bool gotFormat = false;
+    uint8_t chunk[8];
+
+    while (fread(chunk, 1, 8, mFile) == 8)
+    {
+      const uint32_t size = ReadLE32(chunk + 4);
+
+      if (!memcmp(chunk, "fmt ", 4))
+      {
+        uint8_t fmt[40] = {};
+
+        if (size < 16 || fread(fmt, 1, std::min<uint32_t>(size, 40), mFile) != std::min<uint32_t>(size, 40))
+          return false;
+
+        uint16_t tag = ReadLE16(fmt);
+        mNChans = ReadLE16(fmt + 2);
+        mSampleRate = ReadLE32(fmt + 4);
+        const int bits = ReadLE16(fmt + 14);
+
+        if (tag == 0xFFFE && size >= 26) // WAVE_FORMAT_EXTENSIBLE, the sub format starts with the tag
+          tag = ReadLE16(fmt + 24);
+
+        if (tag == 1 && bits == 16) mFormat = EFormat::kInt16;
+        else if (tag == 1 && bits == 24) mFormat = EFormat::kInt24;
+        else if (tag == 1 && bits == 32) mFormat = EFormat::kInt32;
+        else if (tag == 3 && bits == 32) mFormat = EFormat::kFloat32;
+        else return false;
+
+        mFrameBytes = mNChans * (bits / 8);
+        gotFormat = mNChans > 0;
+
+        if (size > 40)
+          fseek(mFile, size - 40, SEEK_CUR);
+        if (size & 1)
+          fseek(mFile, 1, SEEK_CUR);
+      }
+      else if (!memcmp(chunk, "data", 4))
+      {
+        if (!gotFormat)
+          return false;
+
+        mDataOffset = ftell(mFile);
+        mNFrames = size / mFrameBytes;
+        return mNFrames > 0;
+      }
+      else
+      {
+        fseek(mFile, size + (size & 1), SEEK_CUR); // chunks are padded to an even size
+      }
+    }
+
+    return false;
+  }
+
+  void MapFile(const char* path)
+  {
+    const size_t size = static_cast<size_t>(mDataOffset + mNFrames * mFrameBytes);
+
+#ifdef OS_WIN
+    wchar_t pathW[MAX_WIN32_PATH_LEN];
+    UTF8ToUTF16(pathW, path, MAX_WIN32_PATH_LEN);
+    mMapFile = CreateFileW(pathW, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+
+    if (mMapFile == INVALID_HANDLE_VALUE)
+      return;
+
+    mMapHandle = CreateFileMappingW(mMapFile, NULL, PAGE_READONLY, 0, 0, NULL);
+
+    if (mMapHandle)
+      mMapping = static_cast<const uint8_t*>(MapViewOfFile(mMapHandle, FILE_MAP_READ, 0, 0, 0));
+
+    if (!mMapping)
+    {
+      if (mMapHandle)
+        CloseHandle(mMapHandle);
+      CloseHandle(mMapFile);
+    }
+#else
+    const int fd = open(path, O_RDONLY);
+
+    if (fd < 0)
+      return;
+
+    void* pMapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping keeps the file open
+
+    if (pMapping != MAP_FAILED)
+    {
+      mMapping = static_cast<const uint8_t*>(pMapping);
+      mMapSize = size;
+    }
+#endif
+  }
+
+  void Convert(const uint8_t* pSrc, float* pDest, int nSamples) const
+  {
+    switch (mFormat)
+    {
+      case EFormat::kInt16:
+        for (auto i = 0; i < nSamples; i++, pSrc += 2)
+          pDest[i] = static_cast<int16_t>(ReadLE16(pSrc)) * (1.f / 32768.f);
+        break;
+      case EFormat::kInt24:
+        for (auto i = 0; i < nSamples; i++, pSrc += 3)
+          pDest[i] = static_cast<int32_t>((pSrc[0] << 8) | (pSrc[1] << 16) | (static_cast<uint32_t>(pSrc[2]) << 24)) * (1.f / 2147483648.f);
+        break;
+      case EFormat::kInt32:
+        for (auto i = 0; i < nSamples; i++, pSrc += 4)
+          pDest[i] = static_cast<int32_t>(ReadLE32(pSrc)) * (1.f / 2147483648.f);
+        break;
+      case EFormat::kFloat32:
+        memcpy(pDest, pSrc, nSamples * sizeof(float)); // little endian on every platform we build for
+        break;
+    }
+  }
+
+  FILE* mFile = nullptr;
+  const uint8_t* mMapping = nullptr;
+#ifdef OS_WIN
+  HANDLE mMapFile = INVALID_HANDLE_VALUE;
+  HANDLE mMapHandle = NULL;
+#else
+  size_t mMapSize = 0;
+#endif
+  EFormat mFormat = EFormat::kInt16;
+  int mNChans = 0;
+  int mFrameBytes = 0;
+  double mSampleRate = 44100.;
+  int64_t mDataOffset = 0;
+  int64_t mNFrames = 0;
+  int mNPreloadFrames = 0;
+  std::vector<float> mPreload;
+};
+
+/** A SampleStreamer plays multi GB sample libraries with a small memory footprint. Each StreamingSample keeps only its first frames in memory,
+ * and a background I/O thread streams the rest from disk into a ring buffer per voice, well ahead of where the voice is playing.
+ * The rings hold absolute frame numbers, so a voice and the I/O thread exchange only atomic frame counters, and nothing blocks the audio thread.
+ *
+ * Usage: construct it with one stream per voice, add samples with AddSample() before processing starts, and give each StreamingSamplerVoice its own stream index.
+ * If the disk can't keep up, the voice plays silence for the missing frames and GetNumUnderruns() counts them. */
+class SampleStreamer
+{
+public:
+  /** A ring buffer that one voice reads from, and the I/O thread fills. Frames [mFilledEnd - capacity, mFilledEnd) of the requested sample are in the ring */
+  class Stream
+  {
+  public:
+    /** Ask the I/O thread to stream a sample from a frame on, called by the voice
+     * @param pSample The sample, or nullptr to stop streaming
+     * @param startFrame The first frame to stream
+     * @return The generation of the request, which Available() checks */
+    uint32_t Request(const StreamingSample* pSample, int64_t startFrame)
+    {
+      mReadFrame.store(startFrame, std::memory_order_relaxed);
+      mRequestSample.store(pSample, std::memory_order_relaxed);
+      mRequestStart.store(startFrame, std::memory_order_relaxed);
+      const uint32_t generation = mRequestGeneration.load(std::memory_order_relaxed) + 1;
+      mRequestGeneration.store(generation, std::memory_order_release);
+      mSignal->Notify();
+      return generation;
+    }
+
+    /** @return The end of the frames in the ring for the request's generation, or 0 if the I/O thread hasn't picked the request up yet */
+    int64_t Available(uint32_t generation) const
+    {
+      if (mServedGeneration.load(std::memory_order_acquire) != generation)
+        return 0;
+
+      return mFilledEnd.load(std::memory_order_acquire);
+    }
+
+    /** @return The first channel of a frame that Available() said is in the ring */
+    const float* GetFrame(int64_t frame) const { return mData.data() + static_cast<size_t>(frame % mCapacity) * mMaxChans; }
+
+    /** Tell the I/O thread that frames before this one are no longer needed, so it can reuse their space */
+    void SetReadFrame(int64_t frame) { mReadFrame.store(frame, std::memory_order_release); }
+
+  private:
+    std::vector<float> mData;
+    int mCapacity = 0;
+    int mMaxChans = 0;
+    IPlugSignal* mSignal = nullptr; // wakes the I/O thread for a new request
+
+    // written by the voice
+    std::atomic<const StreamingSample*> mRequestSample {nullptr};
+    std::atomic<int64_t> mRequestStart {0};
+    std::atomic<uint32_t> mRequestGeneration {0};
+    std::atomic<int64_t> mReadFrame {0};
+
+    // written by the I/O thread
+    std::atomic<uint32_t> mServedGeneration {0};
+    std::atomic<int64_t> mFilledEnd {0};
+    const StreamingSample* mSample = nullptr;
+    int64_t mFilePos = 0;
+
+    friend class SampleStreamer;
+  };
+
+  /** @param nStreams The number of streams, usually one per voice
+   * @param streamFrames The size of each stream's ring buffer, in frames
+   * @param maxChans The maximum number of channels of the samples
+   * @param preloadFrames The number of frames of each sample that are kept in memory
+   * @param useMemoryMap If \c true samples are read through memory mappings of their files, rather than file reads
+   * @param pollIntervalMs How often the I/O thread tops up the streams. New requests wake it straight away */
+  SampleStreamer(int nStreams, int streamFrames = 32768, int maxChans = 2, int preloadFrames = 16384, bool useMemoryMap = false, double pollIntervalMs = 2.)
+  : mMaxChans(maxChans)
+  , mPreloadFrames(preloadFrames)
+  , mUseMemoryMap(useMemoryMap)
+  , mPollInterval(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli>(pollIntervalMs)))
+  {
+    for (auto s = 0; s < nStreams; s++)
+    {
+      mStreams.emplace_back(new Stream);
+      mStreams.back()->mCapacity = streamFrames;
+      mStreams.back()->mMaxChans = maxChans;
+      mStreams.back()->mSignal = &mSignal;
+      mStreams.back()->mData.resize(static_cast<size_t>(streamFrames) * maxChans);
+    }
+
+    mThread = std::thread(&SampleStreamer::ThreadLoop, this);
+  }
+
+  ~SampleStreamer()
+  {
+    mRunning = false;
+    mSignal.Notify();
+    mThread.join();
+  }
+
+  SampleStreamer(const SampleStreamer&) = delete;
+  SampleStreamer& operator=(const SampleStreamer&) = delete;
+
+  /** Add a .wav file, mapped to a range of keys and velocities. Call this before processing starts, or while it is suspended, since the audio thread reads the list of samples without a lock
+   * @param path The UTF-8 path of the file
+   * @param rootKey The MIDI note at which the sample plays at its original pitch
+   * @param lowKey The lowest key the sample is mapped to
+   * @param highKey The highest key the sample is mapped to
+   * @param lowVelocity The lowest velocity the sample is mapped to
+   * @param highVelocity The highest velocity the sample is mapped to
+   * @return The sample, or nullptr if the file could not be opened or its format is not supported */
+  const StreamingSample* AddSample(const char* path, int rootKey, int lowKey = 0, int highKey = 127, int lowVelocity = 0, int highVelocity = 127)
+  {
+    std::unique_ptr<StreamingSample> pSample(new StreamingSample(rootKey, lowKey, highKey, lowVelocity, highVelocity));
+
+    if (!pSample->Open(path, mPreloadFrames, mUseMemoryMap) || pSample->NChans() > mMaxChans)
+      return nullptr;
+
+    mSamples.push_back(std::move(pSample));
+    return mSamples.back().get();
+  }
+
+  /** @return The first sample that is mapped to the key and velocity, or nullptr */
+  const StreamingSample* FindSample(int key, int velocity) const
+  {
+    for (auto& pSample : mSamples)
+    {
+      if (pSample->Matches(key, velocity))
+        return pSample.get();
+    }
+
+    return nullptr;
+  }
+
+  Stream* GetStream(int idx) { return mStreams[idx].get(); }
+  int NStreams() const { return static_cast<int>(mStreams.size()); }
+
+  /** @return The number of frames that voices played as silence because they weren't streamed in time */
+  int64_t GetNumUnderruns() const { return mUnderruns.load(std::memory_order_relaxed); }
+  void AddUnderruns(int64_t nFrames) { mUnderruns.fetch_add(nFrames, std::memory_order_relaxed); }
+
+  /** @return The bytes of memory used for the preloaded frames and the stream buffers */
+  size_t GetMemoryUsage() const
+  {
+    size_t bytes = 0;
+
+    for (auto& pSample : mSamples)
+      bytes += static_cast<size_t>(pSample->NPreloadFrames()) * pSample->NChans() * sizeof(float);
+
+    for (auto& pStream : mStreams)
+      bytes += pStream->mData.size() * sizeof(float);
+
+    return bytes;
+  }
+
+private:
+  static constexpr int kReadFrames = 4096; // the most frames read at once, so that one stream can't hold up the others for long
+
+  void ThreadLoop()
+  {
+    std::vector<uint8_t> scratch;
+
+    while (mRunning)
+    {
+      bool busy = false;
+
+      for (auto& pStream : mStreams)
+        busy |= Fill(*pStream, scratch);
+
+      // go round again straight away while there is a backlog, otherwise wait for the voices to consume some frames, or for a new request
+      if (!busy)
+        mSignal.Wait(std::chrono::duration<double, std::milli>(mPollInterval).count());
+    }
+  }
+
+  /** @return \c true if a read was done, and the stream might want more */
+  bool Fill(Stream& stream, std::vector<uint8_t>& scratch)
+  {
+    const uint32_t generation = stream.mRequestGeneration.load(std::memory_order_acquire);
+
+    if (generation != stream.mServedGeneration.load(std::memory_order_relaxed))
+    {
+      stream.mSample = stream.mRequestSample.load(std::memory_order_relaxed);
+      stream.mFilePos = stream.mRequestStart.load(std::memory_order_relaxed);
+      stream.mFilledEnd.store(stream.mFilePos, std::memory_order_relaxed);
+      stream.mServedGeneration.store(generation, std::memory_order_release);
+    }
+
+    const StreamingSample* pSample = stream.mSample;
+
+    if (!pSample || stream.mFilePos >= pSample->NFrames())
+      return false;
+
+    // don't overwrite frames the voice still needs, and stop at the end of the ring so that each read is contiguous
+    const int64_t limit = stream.mReadFrame.load(std::memory_order_acquire) + stream.mCapacity;
+    const int64_t ringEnd = stream.mFilePos - (stream.mFilePos % stream.mCapacity) + stream.mCapacity;
+    const int64_t end = std::min({limit, ringEnd, pSample->NFrames(), stream.mFilePos + kReadFrames});
+    const int nFrames = static_cast<int>(end - stream.mFilePos);
+
+    if (nFrames <= 0)
+      return false;
+
+    float* pDest = stream.mData.data() + static_cast<size_t>(stream.mFilePos % stream.mCapacity) * stream.mMaxChans;
+
+    if (pSample->NChans() == stream.mMaxChans)
+    {
+      if (!pSample->Read(stream.mFilePos, nFrames, pDest, scratch))
+        return false;
+    }
+    else
+    {
+      // a sample with fewer channels than the ring, spread into frames of mMaxChans
+      mConvertBuffer.resize(static_cast<size_t>(nFrames) * pSample->NChans());
+
+      if (!pSample->Read(stream.mFilePos, nFrames, mConvertBuffer.data(), scratch))
+        return false;
+
+      for (auto f = 0; f < nFrames; f++)
+        memcpy(pDest + f * stream.mMaxChans, mConvertBuffer.data() + f * pSample->NChans(), pSample->NChans() * sizeof(float));
+    }
+
+    stream.mFilePos = end;
+    stream.mFilledEnd.store(end, std::memory_order_release);
+    return true;
+  }
+
+  std::vector<std::unique_ptr<Stream>> mStreams;
+  std::vector<std::unique_ptr<StreamingSample>> mSamples;
+  std::vector<float> mConvertBuffer;
+  const int mMaxChans;
+  const int mPreloadFrames;
+  const bool mUseMemoryMap;
+  const std::chrono::steady_clock::duration mPollInterval;
+  std::atomic<bool> mRunning {true};
+  IPlugSignal mSignal;
+  std::atomic<int64_t> mUnderruns {0};
+  std::thread mThread;
+};
+
+/** A SynthVoice that plays the StreamingSample mapped to its key and velocity, from a SampleStreamer, with an amplitude envelope.
+ * The pitch follows the voice's pitch and pitch bend inputs, with linear interpolation. Each voice needs its own stream of the streamer. */
+template<typename T>
+class StreamingSamplerVoice : public SynthVoice
+{
+public:
+  /** @param streamer The streamer, which must outlive the voice
+   * @param streamIdx The stream this voice reads from, which no other voice may use */
+  StreamingSamplerVoice(SampleStreamer& streamer, int streamIdx)
+  : mStreamer(streamer)
+  , mStream(*streamer.GetStream(streamIdx))
+  , mAmpEnv("gain")
+  {
+  }
+
+  bool GetBusy() const override
+  {
+    return mSample != nullptr && mAmpEnv.GetBusy();
+  }
+
+  void Trigger(double level, bool isRetrigger) override
+  {
+    mSample = mStreamer.FindSample(mKey, static_cast<int>(level * 127.));
+
+    if (!mSample)
+      return;
+
+    mPos = 0.;
+
+    // the preload covers the start, so streaming begins after it
+    mGeneration = mStream.Request(mSample->NFrames() > mSample->NPreloadFrames() ? mSample : nullptr, mSample->NPreloadFrames());
+
+    if (isRetrigger)
+      mAmpEnv.Retrigger(level);
+    else
+      mAmpEnv.Start(level);
+  }
+
+  void Release() override
+  {
+    mAmpEnv.Release();
+  }
+
+  float GetLevel() const override
+  {
+    return static_cast<float>(std::fabs(mAmpEnv.GetPrevOutput()) * mGain);
+  }
+
+  void Kill() override
+  {
+    mAmpEnv.Kill(true);
+    Stop();
+  }
+
+  void ProcessSamplesAccumulating(T** inputs, T** outputs, int nInputs, int nOutputs, int startIdx, int nFrames) override
+  {
+    if (!mSample)
+      return;
+
+    // convert from "1v/oct" pitch space, where 0 is A4, to a playback rate in frames of the sample per output frame
+    const double pitch = mInputs[kVoiceControlPitch].endValue + mInputs[kVoiceControlPitchBend].endValue - (mSample->mRootKey - 69) / 12.;
+    const double rate = std::pow(2., pitch) * mSample->GetSampleRate() / mSampleRate;
+
+    const int nChans = mSample->NChans();
+    const int64_t nSampleFrames = mSample->NFrames();
+    const int64_t nPreload = mSample->NPreloadFrames();
+    const int64_t streamed = mStream.Available(mGeneration);
+    const float* pPreload = mSample->GetPreload();
+    int64_t underruns = 0;
+
+    for (auto s = startIdx; s < startIdx + nFrames; s++)
+    {
+      const int64_t frame = static_cast<int64_t>(mPos);
+
+      if (frame + 1 >= nSampleFrames)
+      {
+        Kill();
+        break;
+      }
+
+      const float* pA = frame < nPreload ? pPreload + frame * nChans : (frame < streamed ? mStream.GetFrame(frame) : nullptr);
+      const float* pB = frame + 1 < nPreload ? pPreload + (frame + 1) * nChans : (frame + 1 < streamed ? mStream.GetFrame(frame + 1) : nullptr);
+      const T gain = mAmpEnv.Process(mSustainLevel) * static_cast<T>(mGain);
+
+      if (pA && pB)
+      {
+        const float frac = static_cast<float>(mPos - frame);
+
+        for (auto c = 0; c < nOutputs; c++)
+        {
+          const int chan = c % nChans;
+          outputs[c][s] += static_cast<T>(pA[chan] + (pB[chan] - pA[chan]) * frac) * gain;
+        }
+      }
+      else
+        underruns++;
+
+      mPos += rate;
+    }
+
+    if (mSample && !mAmpEnv.GetBusy())
+      Stop(); // the release has ended, so the stream is free for the next note
+    else if (mSample)
+      mStream.SetReadFrame(static_cast<int64_t>(mPos));
+
+    if (underruns)
+      mStreamer.AddUnderruns(underruns);
+  }
+
+  void SetSampleRateAndBlockSize(double sampleRate, int blockSize) override
+  {
+    mSampleRate = sampleRate;
+    mAmpEnv.SetSampleRate(sampleRate);
+  }
+
+  ADSREnvelope<T>& GetAmpEnvelope() { return mAmpEnv; }
+
+  /** @param level The sustain level of the amplitude envelope, 0 to 1 */
+  void SetSustainLevel(T level) { mSustainLevel = level; }
+
+private:
+  void Stop()
+  {
+    if (mSample)
+      mGeneration = mStream.Request(nullptr, 0);
+
+    mSample = nullptr;
+  }
+
+  SampleStreamer& mStreamer;
+  SampleStreamer::Stream& mStream;
+  ADSREnvelope<T> mAmpEnv;
+  const StreamingSample* mSample = nullptr;
+  uint32_t mGeneration = 0;
+  double mPos = 0.;
+  double mSampleRate = 44100.;
+  T mSustainLevel = 1.;
+};
+
+END_IPLUG_NAMESPACE
@@ -27,6 +27,7 @@
 
 #include "IPlugQueue.h"
 #include "ControlRamp.h"
+#include "ModulationBus.h"
 
 BEGIN_IPLUG_NAMESPACE
 
@@ -68,6 +69,15 @@ public:
   /** As with Trigger, called to do optional tasks when a voice is released. */
   virtual void Release() {};
 
+  /** Implement this to report how loud the voice currently is, e.g. its amplitude envelope's last output. The VoiceAllocator uses this to steal the quietest voice
+   * and to stop released voices that have dropped below its silence threshold. The default reports full level, so the voice is never treated as silent.
+   * @return The voice's current linear output level, normally between 0. and 1. */
+  virtual float GetLevel() const { return 1.f; }
+
+  /** Called by the VoiceAllocator to stop a released voice whose level has dropped below the silence threshold. After this GetBusy() should return \c false.
+   * Implement this if you implement GetLevel(). */
+  virtual void Kill() {};
+
   /** Process a block of audio data for the voice
    @param inputs Pointer to input channel arrays. Sometimes synthesisers have audio inputs. Alternatively you can pass in modulation from global LFOs etc here.
    @param outputs Pointer to output channel arrays. You should add to the existing data in these arrays (so that all the voices get summed)
@@ -103,6 +113,7 @@ public:
 
 protected:
   VoiceInputs mInputs;
+  const ModulationBus<sample>* mModulation{nullptr}; // the global modulation sources of the MidiSynth that the voice was added to
   int64_t mLastTriggeredTime{-1};
   uint8_t mVoiceNumber{0};
   uint8_t mZone{0};
@@ -115,4 +126,32 @@ protected:
   friend class VoiceAllocator;
 };
 
+#pragma mark - Voice bank class
+
+/** A SynthVoiceBank can render all of the busy voices of a VoiceAllocator in a single call, instead of the allocator calling
+ * SynthVoice::ProcessSamplesAccumulating() once per voice. This avoids a virtual call per voice, and lets an implementation
+ * render several voices side by side in lanes and write their sum to the outputs once, rather than every voice accumulating
+ * into the same output memory. The bank does not own the voices, it is handed the busy ones on each call. */
+class SynthVoiceBank
+{
+public:
+  virtual ~SynthVoiceBank() {};
+
+  /** Process a block of audio data for a set of busy voices
+   @param voices Pointer to an array of nVoices busy voices. These are the voices that were added to the VoiceAllocator, so can be cast to the concrete voice type
+   @param nVoices The number of voices in the array
+   @param inputs Pointer to input channel arrays, as for SynthVoice::ProcessSamplesAccumulating()
+   @param outputs Pointer to output channel arrays. You should add the sum of all the voices to the existing data in these arrays
+   @param nInputs The number of input channels that contain valid data
+   @param nOutputs The number of output channels that contain valid data
+   @param startIdx The start index of the block of samples to process
+   @param nFrames The number of samples to process in this block */
+  virtual void ProcessVoicesAccumulating(SynthVoice* const* voices, int nVoices, sample** inputs, sample** outputs, int nInputs, int nOutputs, int startIdx, int nFrames) = 0;
+
+  /** Implement this if you need to do work when the sample rate or block size changes, e.g. resizing lane buffers.
+   * @param sampleRate The new sample rate
+   * @param blockSize The new block size in samples */
+  virtual void SetSampleRateAndBlockSize(double sampleRate, int blockSize) {};
+};
+
 END_IPLUG_NAMESPACE
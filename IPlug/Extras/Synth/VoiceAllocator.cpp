@@ -11,6 +11,7 @@
 #include "VoiceAllocator.h"
 
 #include <algorithm>
+#include <limits>
 #include <numeric>
 #include <iostream>
 
@@ -56,6 +57,19 @@ void VoiceAllocator::AddVoice(SynthVoice* pVoice, uint8_t zone)
   if(mVoicePtrs.size() + 1 < UCHAR_MAX)
   {
     mVoicePtrs.push_back(pVoice);
+    mBusyVoicePtrs.reserve(mVoicePtrs.size());
+
+    // reserve room for every voice on every channel, so that SetVoiceChannel() never allocates
+    for(auto& channelVoices : mChannelVoices)
+    {
+      channelVoices.reserve(mVoicePtrs.size());
+    }
+
+    if(pVoice->mChannel < kNumMidiChannels)
+    {
+      mChannelVoices[pVoice->mChannel].push_back(static_cast<uint8_t>(mVoicePtrs.size() - 1));
+    }
+
     ClearVoiceInputs(pVoice);
     pVoice->mKey = -1;
     pVoice->mZone = zone;
@@ -71,84 +85,65 @@ void VoiceAllocator::AddVoice(SynthVoice* pVoice, uint8_t zone)
 
 VoiceAllocator::VoiceBitsArray VoiceAllocator::VoicesMatchingAddress(VoiceAddress addr)
 {
-  const int n = static_cast<int>(mVoicePtrs.size());
-  VoiceBitsArray v;
-
-  // set all bits to true
-  for(int i=0; i<n; ++i)
-  {
-    v[i] = true;
-  }
+  // setting the flag kVoicesAll returns all voices matching the zone of the address.
+  const bool allInZone = addr.mFlags & kVoicesAll;
+  const bool matchChannel = !allInZone && addr.mChannel != kAllChannels;
+  const bool matchKey = !allInZone && addr.mKey != kAllKeys;
+  const bool matchBusy = !allInZone && (addr.mFlags & kVoicesBusy);
 
-  // for each criterion present in address, clear any voice bits not matching
+  // start from the smallest set of voices that can match, so that e.g. a note off only visits the voices playing its key
+  VoiceBitsArray candidates;
 
-  // zone
-  if(addr.mZone != kAllZones)
+  if(matchKey && addr.mKey < kNumKeys)
   {
-    for(int i=0; i<n; ++i)
-    {
-      v[i] = v[i] & (mVoicePtrs[i]->mZone == addr.mZone);
-    }
+    candidates = mKeyVoices[addr.mKey];
   }
-
-  // setting the flag kVoicesAll returns all voices matching the zone of the address.
-  if(addr.mFlags & kVoicesAll) return v;
-
-  // channel
-  if(addr.mChannel != kAllChannels)
+  else if(matchChannel && addr.mChannel < kNumMidiChannels)
   {
-    for(int i=0; i<n; ++i)
+    for(auto voiceIdx : mChannelVoices[addr.mChannel])
     {
-      v[i] = v[i] & (mVoicePtrs[i]->mChannel == addr.mChannel);
+      candidates.Set(voiceIdx);
     }
   }
-
-  // Key
-  if(addr.mKey != kAllKeys)
+  else
   {
-    for(int i=0; i<n; ++i)
-    {
-      v[i] = v[i] & (mVoicePtrs[i]->mKey == addr.mKey);
-    }
+    candidates.SetFirst(static_cast<int>(mVoicePtrs.size()));
   }
 
-  // busy flag
-  if(addr.mFlags & kVoicesBusy)
-  {
-    for(int i=0; i<n; ++i)
-    {
-      v[i] = v[i] & mVoicePtrs[i]->GetBusy();
-    }
-  }
+  // for each criterion present in address, skip any voices not matching
+  VoiceBitsArray v;
+
+  candidates.ForEach([&](int i) {
+    SynthVoice* pVoice = mVoicePtrs[i];
+
+    if(addr.mZone != kAllZones && pVoice->mZone != addr.mZone) return;
+    if(matchChannel && pVoice->mChannel != addr.mChannel) return;
+    if(matchKey && pVoice->mKey != addr.mKey) return;
+    if(matchBusy && !pVoice->GetBusy()) return;
+
+    v.Set(i);
+  });
 
   // most recent
-  if(addr.mFlags & kVoicesMostRecent)
+  if(!allInZone && (addr.mFlags & kVoicesMostRecent))
   {
     int64_t maxT = -1;
     int maxIdx = -1;
-    for(int i=0; i<n; ++i)
-    {
-      if(v[i])
+
+    v.ForEach([&](int i) {
+      int64_t vt = mVoicePtrs[i]->mLastTriggeredTime;
+      if(vt > maxT)
       {
-        int64_t vt = mVoicePtrs[i]->mLastTriggeredTime;
-        if(vt > maxT)
-        {
-          maxT = vt;
-          maxIdx = i;
-        }
+        maxT = vt;
+        maxIdx = i;
       }
-    }
+    });
 
-    // set all bits to false
-    //v.reset();
-    for(int i=0; i<n; ++i)
-    {
-      v[i] = 0;
-    }
+    v = VoiceBitsArray();
 
     if(maxIdx >= 0)
     {
-      v[maxIdx] = true;
+      v.Set(maxIdx);
     }
   }
   return v;
@@ -157,35 +152,112 @@ VoiceAllocator::VoiceBitsArray VoiceAllocator::VoicesMatchingAddress(VoiceAddres
 void VoiceAllocator::SendControlToVoiceInputs(VoiceBitsArray v, int ctlIdx, float val, int glideSamples)
 {
   // send control change to all matched voices through glide generators
-  for(int i=0; i<mVoicePtrs.size(); ++i)
-  {
-    if(v[i])
-    {
-      mVoiceGlides[i]->at(ctlIdx).SetTarget(val, 0, glideSamples, mBlockSize);
-    }
-  }
+  v.ForEach([&](int i) {
+    mVoiceGlides[i]->at(ctlIdx).SetTarget(val, 0, glideSamples, mBlockSize);
+  });
 }
 
 void VoiceAllocator::SendControlToVoicesDirect(VoiceBitsArray v, int ctlIdx, float val)
 {
   // send generic control change directly to voice
-  for(int i=0; i<mVoicePtrs.size(); ++i)
+  v.ForEach([&](int i) {
+    mVoicePtrs[i]->SetControl(ctlIdx, val);
+  });
+}
+
+void VoiceAllocator::SendProgramChangeToVoices(VoiceBitsArray v, int pgm)
+{
+  v.ForEach([&](int i) {
+    mVoicePtrs[i]->SetProgramNumber(pgm);
+  });
+}
+
+// pitch bend, pressure and timbre for a whole channel, which can be routed with mChannelVoices
+bool VoiceAllocator::IsChannelExpression(const VoiceInputEvent& e) const
+{
+  const bool isExpression = e.mAction == kPitchBendAction || e.mAction == kPressureAction || e.mAction == kTimbreAction;
+  return isExpression && e.mAddress.mChannel < kNumMidiChannels && e.mAddress.mKey == kAllKeys && e.mAddress.mFlags == 0;
+}
+
+void VoiceAllocator::AddChannelExpression(const VoiceInputEvent& e)
+{
+  const uint8_t channel = e.mAddress.mChannel;
+  const uint8_t expression = static_cast<uint8_t>(e.mAction - kPitchBendAction);
+  ChannelExpression& pending = mChannelExpressions[channel][expression];
+
+  // a different zone would match different voices, so send what we have first
+  if(pending.pending && pending.zone != e.mAddress.mZone)
   {
-    if(v[i])
+    FlushChannelExpressions();
+  }
+
+  if(!pending.pending)
+  {
+    pending.pending = true;
+    mPendingExpressions[mNPendingExpressions++] = {channel, expression};
+  }
+
+  pending.value = e.mValue;
+  pending.zone = e.mAddress.mZone;
+}
+
+void VoiceAllocator::FlushChannelExpressions()
+{
+  for(int i=0; i<mNPendingExpressions; ++i)
+  {
+    const int channel = mPendingExpressions[i].first;
+    const int expression = mPendingExpressions[i].second;
+    ChannelExpression& pending = mChannelExpressions[channel][expression];
+
+    for(auto voiceIdx : mChannelVoices[channel])
     {
-      mVoicePtrs[i]->SetControl(ctlIdx, val);
+      if(pending.zone == kAllZones || mVoicePtrs[voiceIdx]->mZone == pending.zone)
+      {
+        mVoiceGlides[voiceIdx]->at(kVoiceControlPitchBend + expression).SetTarget(pending.value, 0, mControlGlideSamples, mBlockSize);
+      }
     }
+
+    pending.pending = false;
   }
+
+  mNPendingExpressions = 0;
 }
 
-void VoiceAllocator::SendProgramChangeToVoices(VoiceBitsArray v, int pgm)
+void VoiceAllocator::SetVoiceChannel(int voiceIdx, int channel)
 {
-  for(int i=0; i<mVoicePtrs.size(); ++i)
+  SynthVoice* pVoice = mVoicePtrs[voiceIdx];
+
+  if(pVoice->mChannel != channel)
   {
-    if(v[i])
+    if(pVoice->mChannel < kNumMidiChannels)
+    {
+      auto& oldChannel = mChannelVoices[pVoice->mChannel];
+      oldChannel.erase(std::find(oldChannel.begin(), oldChannel.end(), voiceIdx));
+    }
+
+    if(channel < kNumMidiChannels)
     {
-      mVoicePtrs[i]->SetProgramNumber(pgm);
+      mChannelVoices[channel].push_back(static_cast<uint8_t>(voiceIdx));
     }
+
+    pVoice->mChannel = channel;
+  }
+}
+
+void VoiceAllocator::SetVoiceKey(int voiceIdx, int key)
+{
+  SynthVoice* pVoice = mVoicePtrs[voiceIdx];
+
+  if(pVoice->mKey < kNumKeys)
+  {
+    mKeyVoices[pVoice->mKey].Reset(voiceIdx);
+  }
+
+  pVoice->mKey = key;
+
+  if(pVoice->mKey < kNumKeys)
+  {
+    mKeyVoices[pVoice->mKey].Set(voiceIdx);
   }
 }
 
@@ -195,7 +267,20 @@ void VoiceAllocator::ProcessEvents(int blockSize, int64_t sampleTime)
   {
     VoiceInputEvent event;
     mInputQueue.Pop(event);
-    VoiceAllocator::VoiceBitsArray voices = VoicesMatchingAddress(event.mAddress);
+
+    if(event.mAction == kNullAction)
+    {
+      continue;
+    }
+
+    // dense MPE expression is coalesced per channel, and sent before any other event so that the order of events is kept
+    if(IsChannelExpression(event))
+    {
+      AddChannelExpression(event);
+      continue;
+    }
+
+    FlushChannelExpressions();
 
     switch(event.mAction)
     {
@@ -218,17 +303,17 @@ void VoiceAllocator::ProcessEvents(int blockSize, int64_t sampleTime)
       }
       case kPitchBendAction:
       {
-        SendControlToVoiceInputs(voices, kVoiceControlPitchBend, event.mValue, mControlGlideSamples);
+        SendControlToVoiceInputs(VoicesMatchingAddress(event.mAddress), kVoiceControlPitchBend, event.mValue, mControlGlideSamples);
         break;
       }
       case kPressureAction:
       {
-        SendControlToVoiceInputs(voices, kVoiceControlPressure, event.mValue, mControlGlideSamples);
+        SendControlToVoiceInputs(VoicesMatchingAddress(event.mAddress), kVoiceControlPressure, event.mValue, mControlGlideSamples);
         break;
       }
       case kTimbreAction:
       {
-        SendControlToVoiceInputs(voices, kVoiceControlTimbre, event.mValue, mControlGlideSamples);
+        SendControlToVoiceInputs(VoicesMatchingAddress(event.mAddress), kVoiceControlTimbre, event.mValue, mControlGlideSamples);
         break;
       }
       case kSustainAction:
@@ -258,12 +343,12 @@ void VoiceAllocator::ProcessEvents(int blockSize, int64_t sampleTime)
       case kControllerAction:
       {
         // called for any continuous controller other than the special #74 specified in MPE
-        SendControlToVoicesDirect(voices, event.mControllerNumber, event.mValue);
+        SendControlToVoicesDirect(VoicesMatchingAddress(event.mAddress), event.mControllerNumber, event.mValue);
         break;
       }
       case kProgramChangeAction:
       {
-        SendProgramChangeToVoices(voices, event.mControllerNumber);
+        SendProgramChangeToVoices(VoicesMatchingAddress(event.mAddress), event.mControllerNumber);
         break;
       }
       case kNullAction:
@@ -274,6 +359,8 @@ void VoiceAllocator::ProcessEvents(int blockSize, int64_t sampleTime)
     }
   }
 
+  FlushChannelExpressions();
+
   // update any glides in progress, writing voice control outputs
   for(auto& glides : mVoiceGlides)
   {
@@ -310,6 +397,24 @@ int VoiceAllocator::FindVoiceIndexToSteal(int64_t sampleTime) const
   size_t voices = mVoicePtrs.size();
   int64_t earliestTime = sampleTime;
   int longestPlayingVoiceIdx = 0;
+
+  if(mStealMode == kStealModeQuietest)
+  {
+    float lowestLevel = std::numeric_limits<float>::max();
+    for(int i=0; i<voices; ++i)
+    {
+      SynthVoice* pv = mVoicePtrs[i];
+      const float level = pv->GetLevel();
+      if(level < lowestLevel || (level == lowestLevel && pv->mLastTriggeredTime < earliestTime))
+      {
+        lowestLevel = level;
+        earliestTime = pv->mLastTriggeredTime;
+        longestPlayingVoiceIdx = i;
+      }
+    }
+    return longestPlayingVoiceIdx;
+  }
+
   for(int i=0; i<voices; ++i)
   {
     SynthVoice* pv = mVoicePtrs[i];
@@ -322,6 +427,21 @@ int VoiceAllocator::FindVoiceIndexToSteal(int64_t sampleTime) const
   return longestPlayingVoiceIdx;
 }
 
+// a voice needs processing if it's busy, unless it has been released and reports a level under the silence threshold, in which case we kill it
+bool VoiceAllocator::VoiceNeedsProcessing(SynthVoice* pVoice) const
+{
+  if(!pVoice->GetBusy())
+    return false;
+
+  if(pVoice->mKey < 0 && pVoice->GetLevel() < mSilenceThreshold)
+  {
+    pVoice->Kill();
+    return false;
+  }
+
+  return true;
+}
+
 // start a single voice and set its current channel and key.
 void VoiceAllocator::StartVoice(int voiceIdx, int channel, int key, float pitch, float velocity, int sampleOffset, int64_t sampleTime, bool retrig)
 {
@@ -337,8 +457,8 @@ void VoiceAllocator::StartVoice(int voiceIdx, int channel, int key, float pitch,
   // set things directly in voice
   SynthVoice* pVoice = mVoicePtrs[voiceIdx];
   pVoice->mLastTriggeredTime = sampleTime;
-  pVoice->mChannel = channel;
-  pVoice->mKey = key;
+  SetVoiceChannel(voiceIdx, channel);
+  SetVoiceKey(voiceIdx, key);
   pVoice->mGain = 1.;
 
   // call voice's Trigger method
@@ -348,32 +468,24 @@ void VoiceAllocator::StartVoice(int voiceIdx, int channel, int key, float pitch,
 // start all of the voice indexes marked in the VoieBitsArray and set the current channel and key of each.
 void VoiceAllocator::StartVoices(VoiceBitsArray vbits, int channel, int key, float pitch, float velocity, int sampleOffset, int64_t sampleTime, bool retrig)
 {
-  for(int i=0; i<mVoicePtrs.size(); ++i)
-  {
-    if(vbits[i])
-    {
-      StartVoice(i, channel, key, pitch, velocity, sampleOffset, sampleTime, retrig);
-    }
-  }
+  vbits.ForEach([&](int i) {
+    StartVoice(i, channel, key, pitch, velocity, sampleOffset, sampleTime, retrig);
+  });
 }
 
 void VoiceAllocator::StopVoice(int voiceIdx, int sampleOffset)
 {
   mVoiceGlides[voiceIdx]->at(kVoiceControlGate).SetTarget(0.0, sampleOffset, 1, mBlockSize);
-  mVoicePtrs[voiceIdx]->mKey = -1;
+  SetVoiceKey(voiceIdx, -1);
   mVoicePtrs[voiceIdx]->Release();
 }
 
 // stop all voices marked in the VoiceBitsArray.
 void VoiceAllocator::StopVoices(VoiceBitsArray vbits, int sampleOffset)
 {
-  for(int i=0; i<mVoicePtrs.size(); ++i)
-  {
-    if(vbits[i])
-    {
-      StopVoice(i, sampleOffset);
-    }
-  }
+  vbits.ForEach([&](int i) {
+    StopVoice(i, sampleOffset);
+  });
 }
 
 void VoiceAllocator::SoftKillAllVoices()
@@ -529,10 +641,26 @@ void VoiceAllocator::NoteOff(VoiceInputEvent e, int64_t sampleTime)
 
 void VoiceAllocator::ProcessVoices(sample** inputs, sample** outputs, int nInputs, int nOutputs, int startIndex, int blockSize)
 {
+  if(mVoiceBank)
+  {
+    mBusyVoicePtrs.clear();
+
+    for(auto pVoice : mVoicePtrs)
+    {
+      if(VoiceNeedsProcessing(pVoice))
+        mBusyVoicePtrs.push_back(pVoice);
+    }
+
+    if(mBusyVoicePtrs.size())
+      mVoiceBank->ProcessVoicesAccumulating(mBusyVoicePtrs.data(), static_cast<int>(mBusyVoicePtrs.size()), inputs, outputs, nInputs, nOutputs, startIndex, blockSize);
+
+    return;
+  }
+
   for(auto pVoice : mVoicePtrs)
   {
     // TODO distribute voices across cores
-    if(pVoice->GetBusy())
+    if(VoiceNeedsProcessing(pVoice))
     {
       pVoice->ProcessSamplesAccumulating(inputs, outputs, nInputs, nOutputs, startIndex, blockSize);
     }
@@ -19,9 +19,15 @@
 #include <vector>
 #include <stdint.h>
 #include <functional>
-#include <bitset>
+#include <algorithm>
+#include <utility>
+#include <climits>
 //#include <iostream>
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
 #include "IPlugLogger.h"
 #include "IPlugQueue.h"
 
@@ -96,7 +102,17 @@ public:
     kNumPolyModes
   };
 
+  enum EStealMode
+  {
+    kStealModeOldest = 0,
+    kStealModeQuietest,
+    kNumStealModes
+  };
+
   static constexpr int kVoiceMostRecent = 1 << 7;
+  static constexpr int kNumMidiChannels = 16;
+  static constexpr int kNumKeys = 128;
+  static constexpr int kNumChannelExpressions = 3; // pitch bend, pressure, timbre
 
   // one voice worth of ramp generators
   using VoiceControlRamps = ControlRampProcessor::ProcessorArray<kNumVoiceControlRamps>;
@@ -137,16 +153,81 @@ public:
 
   void ProcessVoices(sample** inputs, sample** outputs, int nInputs, int nOutputs, int startIndex, int blockSize);
 
+  /** Render busy voices through a SynthVoiceBank instead of calling each voice individually. We do not take ownership of the bank.
+   @param pBank Pointer to the bank, or nullptr to go back to rendering voices one at a time */
+  void SetVoiceBank(SynthVoiceBank* pBank) { mVoiceBank = pBank; }
+  SynthVoiceBank* GetVoiceBank() const { return mVoiceBank; }
+
   size_t GetNVoices() const {return mVoicePtrs.size();}
   SynthVoice* GetVoice(int voiceIndex) const {return mVoicePtrs[voiceIndex];}
   void SetPitchOffset(float offset) { mPitchOffset = offset; }
 
+  /** Choose which voice is stolen when all voices are busy. kStealModeQuietest uses SynthVoice::GetLevel(), ties going to the oldest voice. */
+  void SetStealMode(EStealMode mode) { mStealMode = mode; }
+
+  /** Released voices whose SynthVoice::GetLevel() is below this threshold are killed and no longer rendered.
+   * @param level Linear level, 0. (the default) disables this */
+  void SetSilenceThreshold(float level) { mSilenceThreshold = level; }
+
 private:
-  using VoiceBitsArray = std::bitset<UCHAR_MAX>;
+  /** A set of voice indexes, kept in 64 bit words so that ForEach() visits only the voices in the set, with a bit scan per voice, rather than testing every voice */
+  class VoiceBitsArray
+  {
+  public:
+    static constexpr int kNumWords = (UCHAR_MAX + 63) / 64;
+
+    void Set(int i) { mWords[i >> 6] |= uint64_t(1) << (i & 63); }
+    void Reset(int i) { mWords[i >> 6] &= ~(uint64_t(1) << (i & 63)); }
+    bool Test(int i) const { return (mWords[i >> 6] >> (i & 63)) & 1; }
+
+    /** Sets voices 0 to n - 1 */
+    void SetFirst(int n)
+    {
+      for (int w = 0; w < kNumWords; ++w)
+      {
+        const int nBits = std::min(std::max(n - w * 64, 0), 64);
+        mWords[w] = nBits == 64 ? ~uint64_t(0) : (uint64_t(1) << nBits) - 1;
+      }
+    }
+
+    template <typename F>
+    void ForEach(F&& func) const
+    {
+      for (int w = 0; w < kNumWords; ++w)
+      {
+        uint64_t bits = mWords[w];
+
+        while (bits)
+        {
+          func(w * 64 + CountTrailingZeros(bits));
+          bits &= bits - 1;
+        }
+      }
+    }
+
+  private:
+    static inline int CountTrailingZeros(uint64_t bits)
+    {
+#if defined(_MSC_VER)
+      unsigned long idx;
+      _BitScanForward64(&idx, bits);
+      return static_cast<int>(idx);
+#else
+      return __builtin_ctzll(bits);
+#endif
+    }
+
+    uint64_t mWords[kNumWords] {};
+  };
 
   VoiceBitsArray VoicesMatchingAddress(VoiceAddress va);
 
   void SendControlToVoiceInputs(VoiceBitsArray v, int ctlIdx, float val, int glideSamples);
+  bool IsChannelExpression(const VoiceInputEvent& e) const;
+  void AddChannelExpression(const VoiceInputEvent& e);
+  void FlushChannelExpressions();
+  void SetVoiceChannel(int voiceIdx, int channel);
+  void SetVoiceKey(int voiceIdx, int key);
   void SendControlToVoicesDirect(VoiceBitsArray v, int ctlIdx, float val);
   void SendProgramChangeToVoices(VoiceBitsArray v, int pgm);
 
@@ -158,6 +239,7 @@ private:
 
   void CalcGlideTimesInSamples();
   void ClearVoiceInputs(SynthVoice* pVoice);
+  bool VoiceNeedsProcessing(SynthVoice* pVoice) const;
   int FindFreeVoiceIndex(int startIndex) const;
   int FindVoiceIndexToSteal(int64_t sampleTime) const;
 
@@ -167,10 +249,29 @@ private:
   IPlugQueue<VoiceInputEvent> mInputQueue{1024};
 
   std::vector<SynthVoice*> mVoicePtrs;
+  std::vector<SynthVoice*> mBusyVoicePtrs; // scratch list of the busy voices handed to mVoiceBank
+  SynthVoiceBank* mVoiceBank{nullptr};
   std::vector<std::unique_ptr<VoiceControlRamps>> mVoiceGlides;
   std::vector<int> mHeldKeys; // The currently physically held keys on the keyboard
   std::vector<int> mSustainedNotes; // Any notes that are sustained, including those that are physically held
 
+  // the voices on each MIDI channel, so that per channel expression (e.g. MPE) is routed without scanning every voice
+  std::array<std::vector<uint8_t>, kNumMidiChannels> mChannelVoices;
+
+  // the voices playing each key, so that a note off only visits those voices
+  std::array<VoiceBitsArray, kNumKeys> mKeyVoices;
+
+  // the latest pitch bend, pressure and timbre of each channel in this block. Each is a glide target set at offset 0, so only the last one counts
+  struct ChannelExpression
+  {
+    float value;
+    uint8_t zone;
+    bool pending;
+  };
+  ChannelExpression mChannelExpressions[kNumMidiChannels][kNumChannelExpressions] {};
+  std::array<std::pair<uint8_t, uint8_t>, kNumMidiChannels * kNumChannelExpressions> mPendingExpressions; // channel, expression
+  int mNPendingExpressions{0};
+
   std::function<float(int)> mKeyToPitchFn;
   double mPitchOffset{0.};
 
@@ -190,6 +291,8 @@ private:
 public:
   EPolyMode mPolyMode {kPolyModePoly};
   EATMode mATMode {kATModeChannel};
+  EStealMode mStealMode {kStealModeOldest};
+  float mSilenceThreshold {0.f};
 };
 
 END_IPLUG_NAMESPACE
@@ -0,0 +1,315 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc VoiceRenderPool
+ */
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "heapbuf.h"
+
+#include "IPlugProcessor.h"
+#include "IPlugUtilities.h"
+#include "SynthVoice.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** A VoiceRenderPool is a SynthVoiceBank that spreads the busy voices of a VoiceAllocator across a pool of worker threads.
+ * Threads are spawned up front, and nothing is allocated on the audio thread. The audio thread publishes a block, then renders
+ * voices itself alongside the workers, each voice being claimed by whichever thread gets to it first.
+ * Each thread accumulates into its own buffers, which are summed into the outputs by the audio thread at the end of the block.
+ *
+ * Idle workers spin for up to the spin time waiting for the next block, after which they park until woken. If no worker picks up
+ * a block the audio thread simply renders all of it, so the pool never does worse than waiting for the slowest voice in flight.
+ *
+ * Voices must be safe to render concurrently, i.e. not write to any state shared with other voices. To opt in, pass the pool
+ * to MidiSynth::SetVoiceBank(). SetNumActiveThreads() can be used to e.g. use every core only when GetRenderingOffline() is true.
+ *
+ * With SetHostExecutor(), blocks are rendered as tasks on the host's thread pool instead, where the host supports it, so that the plug-in doesn't compete with
+ * the host's own threads. The workers then stay parked, falling back to rendering the block on the audio thread if the host declines it.
+ *
+ * With SetAudioWorkgroup(), the workers join the host's audio workgroup (see IPlugProcessor::GetAudioWorkgroup()), so that the OS schedules them to meet the host's deadline. */
+class VoiceRenderPool final : public SynthVoiceBank
+{
+public:
+  /** @param nThreads The total number of threads to render on, including the audio thread
+   * @param maxOutputs The maximum number of output channels the voices will write to
+   * @param spinTimeMs How long an idle worker will spin waiting for work, before parking */
+  VoiceRenderPool(int nThreads = static_cast<int>(std::thread::hardware_concurrency()), int maxOutputs = 2, double spinTimeMs = 1.)
+  : mMaxOutputs(maxOutputs)
+  , mSpinTime(std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli>(spinTimeMs)))
+  {
+    nThreads = std::max(nThreads, 1);
+    mNumActiveThreads = nThreads;
+
+    for (auto t = 0; t < nThreads; t++)
+      mContexts.emplace_back(new ThreadContext);
+
+    // thread 0 is the audio thread
+    for (auto t = 1; t < nThreads; t++)
+      mWorkers.emplace_back(&VoiceRenderPool::WorkerLoop, this, t);
+  }
+
+  ~VoiceRenderPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mRunning = false;
+    }
+
+    mWakeUp.notify_all();
+
+    for (auto& worker : mWorkers)
+      worker.join();
+  }
+
+  VoiceRenderPool(const VoiceRenderPool&) = delete;
+  VoiceRenderPool& operator=(const VoiceRenderPool&) = delete;
+
+  /** @return The total number of threads in the pool, including the audio thread */
+  int GetNumThreads() const { return static_cast<int>(mContexts.size()); }
+
+  /** Limit the number of threads that render voices, for example to use all of them only when rendering offline. This can be called from any thread.
+   * @param nThreads The number of threads to use, including the audio thread. 1 renders everything on the audio thread */
+  void SetNumActiveThreads(int nThreads)
+  {
+    mNumActiveThreads = Clip(nThreads, 1, GetNumThreads());
+  }
+
+  /** Render on the host's thread pool rather than on the pool's workers, for APIs that support IPlugProcessor::ExecuteParallel(). Call this before processing starts
+   * @param pProcessor The plug-in, or nullptr to use the pool's workers again */
+  void SetHostExecutor(IPlugProcessor* pProcessor)
+  {
+    mHostExecutor = pProcessor;
+  }
+
+  /** Have the workers join the host's audio workgroup, which they do the next time they render a block. This can be called from any thread
+   * @param pWorkgroup Usually the plug-in's IPlugProcessor::GetAudioWorkgroup(), which must outlive the pool, or nullptr for the workers to leave it */
+  void SetAudioWorkgroup(IAudioWorkgroup* pWorkgroup)
+  {
+    mAudioWorkgroup.store(pWorkgroup, std::memory_order_release);
+  }
+
+  void SetSampleRateAndBlockSize(double sampleRate, int blockSize) override
+  {
+    mBlockSize = blockSize;
+
+    for (auto& pContext : mContexts)
+    {
+      pContext->mData.Resize(mMaxOutputs * blockSize);
+
+      for (auto c = 0; c < mMaxOutputs; c++)
+        pContext->mOutputs[c] = pContext->mData.Get() + (c * blockSize);
+    }
+  }
+
+  void ProcessVoicesAccumulating(SynthVoice* const* voices, int nVoices, sample** inputs, sample** outputs, int nInputs, int nOutputs, int startIdx, int nFrames) override
+  {
+    if (nVoices == 1 || mNumActiveThreads.load(std::memory_order_relaxed) == 1 || nOutputs > mMaxOutputs || startIdx + nFrames > mBlockSize)
+    {
+      for (auto v = 0; v < nVoices; v++)
+        voices[v]->ProcessSamplesAccumulating(inputs, outputs, nInputs, nOutputs, startIdx, nFrames);
+
+      return;
+    }
+
+    mJob = {voices, inputs, nInputs, nOutputs, startIdx, nFrames};
+    mNumDone.store(0, std::memory_order_relaxed);
+
+    // publish the block, resetting the claim index to 0 for the new generation
+    const uint32_t generation = ++mGeneration;
+    const bool onHost = mHostExecutor != nullptr;
+    mClaim.store(MakeClaim(generation, nVoices, 0, onHost), std::memory_order_release);
+
+    if (onHost)
+    {
+      // the host runs its tasks on the thread contexts by task index, which the workers would clash with, so they leave host blocks alone
+      if (!mHostExecutor->ExecuteParallel(HostTask, this, mNumActiveThreads.load(std::memory_order_relaxed)))
+        RenderVoices(0, generation);
+    }
+    else
+    {
+      // only wake parked workers, so that a busy pool stays on the lock free path
+      if (mNumParked.load(std::memory_order_relaxed))
+        mWakeUp.notify_all();
+
+      RenderVoices(0, generation);
+    }
+
+    // wait for voices claimed by workers that are still in flight
+    while (mNumDone.load(std::memory_order_acquire) < nVoices)
+      std::this_thread::yield();
+
+    for (auto& pContext : mContexts)
+    {
+      if (pContext->mGeneration != generation)
+        continue;
+
+      for (auto c = 0; c < nOutputs; c++)
+      {
+        const sample* pSrc = pContext->mOutputs[c] + startIdx;
+        sample* pDst = outputs[c] + startIdx;
+
+        for (auto s = 0; s < nFrames; s++)
+          pDst[s] += pSrc[s];
+      }
+    }
+  }
+
+private:
+  static constexpr int kMaxOutputs = 64;
+  static constexpr uint64_t kClaimOnHost = 1ULL << 31;
+
+  /** The parameters of the block currently being rendered, valid while its generation is current */
+  struct Job
+  {
+    SynthVoice* const* mVoices;
+    sample** mInputs;
+    int mNInputs;
+    int mNOutputs;
+    int mStartIdx;
+    int mNFrames;
+  };
+
+  /** Per-thread accumulation buffers, only touched by the thread that owns them until the block is complete */
+  struct ThreadContext
+  {
+    WDL_TypedBuf<sample> mData;
+    sample* mOutputs[kMaxOutputs] = {};
+    uint32_t mGeneration = 0; // the generation this thread last rendered into mData
+    char mPad[IPLUG_CACHE_LINE_SIZE];
+  };
+
+  static uint64_t MakeClaim(uint32_t generation, int nVoices, int voiceIdx, bool onHost)
+  {
+    return (static_cast<uint64_t>(generation) << 32) | (onHost ? kClaimOnHost : 0) | (static_cast<uint64_t>(nVoices) << 16) | static_cast<uint64_t>(voiceIdx);
+  }
+
+  static uint32_t GetClaimGeneration(uint64_t claim) { return static_cast<uint32_t>(claim >> 32); }
+  static int GetClaimNVoices(uint64_t claim) { return static_cast<int>((claim >> 16) & 0x7FFF); }
+  static bool GetClaimOnHost(uint64_t claim) { return claim & kClaimOnHost; }
+
+  /** The IPlugProcessor::ParallelTask for host blocks, task indices map to thread contexts */
+  static void HostTask(void* pContext, int taskIdx)
+  {
+    VoiceRenderPool* pPool = static_cast<VoiceRenderPool*>(pContext);
+
+    if (taskIdx < pPool->GetNumThreads())
+      pPool->RenderVoices(taskIdx, pPool->mGeneration);
+  }
+
+  /** Claim voices from the current generation until there are none left, rendering them into this thread's buffers */
+  void RenderVoices(int threadIdx, uint32_t generation)
+  {
+    ThreadContext& context = *mContexts[threadIdx];
+    uint64_t claim = mClaim.load(std::memory_order_acquire);
+
+    while (true)
+    {
+      // claims are tagged with their generation, so a thread that wakes up late can never take a voice from a newer block with stale parameters
+      const int voiceIdx = static_cast<int>(claim & 0xFFFF);
+
+      if (GetClaimGeneration(claim) != generation || voiceIdx >= GetClaimNVoices(claim))
+        return;
+
+      if (!mClaim.compare_exchange_weak(claim, claim + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+        continue;
+
+      if (context.mGeneration != generation)
+      {
+        for (auto c = 0; c < mJob.mNOutputs; c++)
+          memset(context.mOutputs[c] + mJob.mStartIdx, 0, mJob.mNFrames * sizeof(sample));
+
+        context.mGeneration = generation;
+      }
+
+      mJob.mVoices[voiceIdx]->ProcessSamplesAccumulating(mJob.mInputs, context.mOutputs, mJob.mNInputs, mJob.mNOutputs, mJob.mStartIdx, mJob.mNFrames);
+
+      mNumDone.fetch_add(1, std::memory_order_release);
+      claim = mClaim.load(std::memory_order_acquire);
+    }
+  }
+
+  void WorkerLoop(int threadIdx)
+  {
+    uint32_t lastGeneration = 0;
+    IAudioWorkgroup::Membership workgroupMembership;
+
+    while (mRunning.load(std::memory_order_relaxed))
+    {
+      // spin for new work until the deadline, then park
+      const auto deadline = std::chrono::steady_clock::now() + mSpinTime;
+      uint64_t claim = mClaim.load(std::memory_order_acquire);
+      uint32_t generation = GetClaimGeneration(claim);
+
+      while (generation == lastGeneration && std::chrono::steady_clock::now() < deadline && mRunning.load(std::memory_order_relaxed))
+      {
+        std::this_thread::yield();
+        claim = mClaim.load(std::memory_order_acquire);
+        generation = GetClaimGeneration(claim);
+      }
+
+      if (generation == lastGeneration)
+      {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mNumParked++;
+        // the timeout covers a wake up that is missed because the audio thread never takes the lock
+        mWakeUp.wait_for(lock, std::chrono::milliseconds(10), [&]() {
+          return !mRunning.load(std::memory_order_relaxed) || GetClaimGeneration(mClaim.load(std::memory_order_acquire)) != lastGeneration;
+        });
+        mNumParked--;
+        continue;
+      }
+
+      lastGeneration = generation;
+
+      if (!GetClaimOnHost(claim) && threadIdx < mNumActiveThreads.load(std::memory_order_relaxed))
+      {
+        workgroupMembership.Update(mAudioWorkgroup.load(std::memory_order_acquire));
+        RenderVoices(threadIdx, generation);
+      }
+    }
+  }
+
+  const int mMaxOutputs;
+  const std::chrono::steady_clock::duration mSpinTime;
+  int mBlockSize = 0;
+  Job mJob {};
+  uint32_t mGeneration = 0;
+  IPlugProcessor* mHostExecutor = nullptr;
+
+  std::vector<std::unique_ptr<ThreadContext>> mContexts;
+  std::vector<std::thread> mWorkers;
+  std::atomic<int> mNumActiveThreads {1};
+  std::atomic<IAudioWorkgroup*> mAudioWorkgroup {nullptr};
+
+  char mPad0[IPLUG_CACHE_LINE_SIZE];
+  std::atomic<uint64_t> mClaim {0}; // generation in the high 32 bits, then the host flag, the number of voices in 15 bits and the index of the next voice to claim in 16 bits
+  char mPad1[IPLUG_CACHE_LINE_SIZE];
+  std::atomic<int> mNumDone {0};
+  char mPad2[IPLUG_CACHE_LINE_SIZE];
+
+  std::atomic<bool> mRunning {true};
+  std::atomic<int> mNumParked {0};
+  std::mutex mMutex;
+  std::condition_variable mWakeUp;
+};
+
+END_IPLUG_NAMESPACE
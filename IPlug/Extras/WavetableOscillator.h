@@ -0,0 +1,323 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @brief A band-limited wavetable oscillator, with mip-mapped tables that are shared between instances, and unison voices
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#include "IPlugUtilities.h"
+#include "Oscillator.h"
+#include "SharedData.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** A single cycle waveform stored as a band-limited table per octave, so that WavetableOscillator can always pick a table with no harmonics above Nyquist.
+ * Building the tables is too slow for the audio thread, so build them once and share them between oscillators, see GetShared() */
+template <typename T>
+class Wavetable
+{
+public:
+  static constexpr int kTableSize = 2048;
+  static constexpr int kNumLevels = 11; // level l holds the harmonics up to (kTableSize / 2) >> l, so 1024 down to 1
+
+  enum EShape
+  {
+    kSaw = 0,
+    kSquare,
+    kTriangle,
+    kNumShapes
+  };
+
+  /** Build the tables by additive synthesis
+   * @param amplitudes The amplitude of each harmonic, starting with the fundamental. Harmonics above kTableSize / 2 are ignored
+   * @param phases The phase of each harmonic in radians, relative to a sine, or empty for all sines */
+  Wavetable(const std::vector<double>& amplitudes, const std::vector<double>& phases = {})
+  : mTables(kNumLevels * (kTableSize + 1))
+  {
+    const int nHarmonics = std::min(static_cast<int>(amplitudes.size()), kTableSize / 2);
+    std::vector<double> sine(kTableSize);
+    std::vector<double> cosine(kTableSize);
+    std::vector<double> sum(kTableSize);
+
+    for (auto i = 0; i < kTableSize; i++)
+    {
+      sine[i] = std::sin(2. * PI * i / kTableSize);
+      cosine[i] = std::cos(2. * PI * i / kTableSize);
+    }
+
+    double peak = 0.;
+
+    // build from the level with the fewest harmonics up, adding each octave's harmonics to the running sum
+    for (auto level = kNumLevels - 1, h = 1; level >= 0; level--)
+    {
+      const int maxHarmonic = std::min((kTableSize / 2) >> level, nHarmonics);
+
+      for (; h <= maxHarmonic; h++)
+      {
+        const double phase = h - 1 < static_cast<int>(phases.size()) ? phases[h - 1] : 0.;
+        const double sinAmp = amplitudes[h - 1] * std::cos(phase);
+        const double cosAmp = amplitudes[h - 1] * std::sin(phase);
+
+        for (auto i = 0; i < kTableSize; i++)
+        {
+          const int idx = (h * i) & (kTableSize - 1);
+          sum[i] += sinAmp * sine[idx] + cosAmp * cosine[idx];
+        }
+      }
+
+      T* pTable = mTables.data() + level * (kTableSize + 1);
+
+      for (auto i = 0; i < kTableSize; i++)
+      {
+        pTable[i] = static_cast<T>(sum[i]);
+        peak = std::max(peak, std::abs(sum[i]));
+      }
+
+      pTable[kTableSize] = pTable[0]; // guard point for interpolation
+    }
+
+    // normalise every level by the peak of the full bandwidth one, so that the levels match
+    if (peak > 0.)
+    {
+      for (auto& x : mTables)
+        x = static_cast<T>(x / peak);
+    }
+  }
+
+  /** Build the tables from a single cycle of any length, which is analysed with a DFT. The tables are shared through SharedData,
+   * so instances that load the same cycle get the same tables, and only the first one does the analysis
+   * @param pCycle The samples of one cycle
+   * @param size The number of samples */
+  static std::shared_ptr<const Wavetable> FromCycle(const T* pCycle, int size)
+  {
+    const uint64_t hash = SharedData<Wavetable>::Hash(pCycle, size * sizeof(T));
+
+    return SharedData<Wavetable>::Get("wavetable", hash, 0., [&]() { return Analyse(pCycle, size); });
+  }
+
+  /** @param shape The basic shape
+   * @return Tables for a basic shape, shared by every caller. They are all built by the first call */
+  static std::shared_ptr<const Wavetable> GetShared(EShape shape)
+  {
+    static const std::shared_ptr<const Wavetable> sShapes[kNumShapes] = { MakeShape(kSaw), MakeShape(kSquare), MakeShape(kTriangle) };
+    return sShapes[shape];
+  }
+
+  /** @param level The level, from 0 for the most harmonics to kNumLevels - 1 for a sine
+   * @return The table, which has kTableSize + 1 samples, the last being a copy of the first */
+  const T* GetTable(int level) const { return mTables.data() + level * (kTableSize + 1); }
+
+  /** @param phaseIncr The frequency divided by the sample rate
+   * @return The level with the most harmonics that are all below Nyquist at this frequency */
+  static int GetLevel(double phaseIncr)
+  {
+    int level = 0;
+
+    while (level < kNumLevels - 1 && ((kTableSize / 2) >> level) * phaseIncr > 0.5)
+      level++;
+
+    return level;
+  }
+
+private:
+  static std::shared_ptr<const Wavetable> Analyse(const T* pCycle, int size)
+  {
+    const int nHarmonics = std::min(size / 2, kTableSize / 2);
+    std::vector<double> amplitudes(nHarmonics);
+    std::vector<double> phases(nHarmonics);
+
+    for (auto h = 1; h <= nHarmonics; h++)
+    {
+      double re = 0., im = 0.;
+
+      for (auto i = 0; i < size; i++)
+      {
+        const double w = 2. * PI * h * i / size;
+        re += pCycle[i] * std::cos(w);
+        im += pCycle[i] * std::sin(w);
+      }
+
+      amplitudes[h - 1] = 2. * std::sqrt(re * re + im * im) / size;
+      phases[h - 1] = std::atan2(re, im);
+    }
+
+    return std::make_shared<const Wavetable>(amplitudes, phases);
+  }
+
+  static std::shared_ptr<const Wavetable> MakeShape(EShape shape)
+  {
+    std::vector<double> amplitudes(kTableSize / 2);
+
+    for (auto h = 1; h <= kTableSize / 2; h++)
+    {
+      switch (shape)
+      {
+        case kSaw: amplitudes[h - 1] = (h & 1 ? 2. : -2.) / (PI * h); break;
+        case kSquare: amplitudes[h - 1] = h & 1 ? 4. / (PI * h) : 0.; break;
+        case kTriangle: amplitudes[h - 1] = h & 1 ? ((h / 2) & 1 ? -8. : 8.) / (PI * PI * h * h) : 0.; break;
+        default: break;
+      }
+    }
+
+    return std::make_shared<const Wavetable>(amplitudes);
+  }
+
+  std::vector<T> mTables;
+};
+
+/** A band-limited wavetable oscillator with up to NV unison voices, which are detuned and spread across the stereo field.
+ * The voices are processed together in fixed size lanes, so the phase and interpolation maths can be vectorised across them,
+ * and the table is picked once per block, rather than per sample. Stacking 7 voices costs much less than 7 oscillators */
+template <typename T, int NV = 8>
+class WavetableOscillator : public IOscillator<T>
+{
+public:
+  WavetableOscillator(std::shared_ptr<const Wavetable<T>> wavetable = Wavetable<T>::GetShared(Wavetable<T>::kSaw), double startPhase = 0., double startFreq = 1.)
+  : IOscillator<T>(startPhase, startFreq)
+  , mWavetable(wavetable)
+  {
+    SetUnison(1, 0.);
+    Reset();
+  }
+
+  /** @param wavetable The tables to play, which can be shared with other oscillators. Swapping them is not click-free */
+  void SetWavetable(std::shared_ptr<const Wavetable<T>> wavetable) { mWavetable = wavetable; }
+
+  /** @param nVoices The number of unison voices, between 1 and NV
+   * @param detuneCents The detune between the lowest and highest voices, in cents
+   * @param stereoWidth How far the voices are spread across the stereo field by the stereo ProcessBlock(), between 0 and 1 */
+  void SetUnison(int nVoices, double detuneCents, double stereoWidth = 0.)
+  {
+    assert(nVoices >= 1 && nVoices <= NV);
+
+    mNVoices = nVoices;
+    const double gain = 1. / std::sqrt(nVoices);
+
+    for (auto v = 0; v < NV; v++)
+    {
+      // -1 to +1 across the active voices
+      const double spread = nVoices > 1 ? (2. * v / (nVoices - 1)) - 1. : 0.;
+      const double pan = (Clip(stereoWidth, 0., 1.) * spread + 1.) * PI / 4.;
+      const bool active = v < nVoices;
+
+      mDetune[v] = std::pow(2., spread * detuneCents / 2400.);
+      mGain[v] = active ? static_cast<T>(gain) : T(0);
+      mGainL[v] = active ? static_cast<T>(gain * std::sqrt(2.) * std::cos(pan)) : T(0);
+      mGainR[v] = active ? static_cast<T>(gain * std::sqrt(2.) * std::sin(pan)) : T(0);
+    }
+  }
+
+  /** Reset the phases, spreading the unison voices so that they start out of phase with each other */
+  void Reset()
+  {
+    for (auto v = 0; v < NV; v++)
+    {
+      const double phase = IOscillator<T>::mStartPhase + v * 0.381966011250105; // 1 - 1 / golden ratio
+      mPhases[v] = phase - std::floor(phase);
+    }
+  }
+
+  inline T Process(double freqHz) override
+  {
+    IOscillator<T>::SetFreqCPS(freqHz);
+
+    T output = 0.;
+    ProcessBlock(&output, 1);
+
+    return output;
+  }
+
+  /** Render the voices mixed to mono, at the frequency set with SetFreqCPS()
+   * @param pOutput The output buffer
+   * @param nFrames The number of samples */
+  void ProcessBlock(T* pOutput, int nFrames)
+  {
+    ProcessVoices(nFrames, [&](int s, const T* pSamples) {
+      T sum = 0;
+
+      for (auto v = 0; v < NV; v++)
+        sum += pSamples[v] * mGain[v];
+
+      pOutput[s] = sum;
+    });
+  }
+
+  /** Render the voices spread across the stereo field by SetUnison(), at the frequency set with SetFreqCPS()
+   * @param pLeft The left output buffer
+   * @param pRight The right output buffer
+   * @param nFrames The number of samples */
+  void ProcessBlock(T* pLeft, T* pRight, int nFrames)
+  {
+    ProcessVoices(nFrames, [&](int s, const T* pSamples) {
+      T left = 0;
+      T right = 0;
+
+      for (auto v = 0; v < NV; v++)
+      {
+        left += pSamples[v] * mGainL[v];
+        right += pSamples[v] * mGainR[v];
+      }
+
+      pLeft[s] = left;
+      pRight[s] = right;
+    });
+  }
+
+private:
+  template <typename MixFunc>
+  inline void ProcessVoices(int nFrames, MixFunc mix)
+  {
+    using WT = Wavetable<T>;
+
+    double incr[NV];
+
+    for (auto v = 0; v < NV; v++)
+      incr[v] = IOscillator<T>::mPhaseIncr * mDetune[v];
+
+    // the highest voice is the last one, as the detune is ascending
+    const T* pTable = mWavetable->GetTable(WT::GetLevel(std::abs(incr[mNVoices - 1])));
+    T samples[NV];
+
+    for (auto s = 0; s < nFrames; s++)
+    {
+      for (auto v = 0; v < NV; v++)
+      {
+        double phase = mPhases[v] + incr[v];
+        phase -= std::floor(phase);
+        mPhases[v] = phase;
+
+        const double pos = phase * WT::kTableSize;
+        const int idx = static_cast<int>(pos);
+        const T frac = static_cast<T>(pos - idx);
+        samples[v] = pTable[idx] + frac * (pTable[idx + 1] - pTable[idx]);
+      }
+
+      mix(s, samples);
+    }
+  }
+
+  std::shared_ptr<const Wavetable<T>> mWavetable;
+  int mNVoices = 1;
+  double mPhases[NV] = {};
+  double mDetune[NV] = {};
+  T mGain[NV] = {};
+  T mGainL[NV] = {};
+  T mGainR[NV] = {};
+};
+
+END_IPLUG_NAMESPACE
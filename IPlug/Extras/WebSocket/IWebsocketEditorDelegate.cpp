@@ -16,6 +16,7 @@ IWebsocketEditorDelegate::~IWebsocketEditorDelegate()
 void IWebsocketEditorDelegate::OnWebsocketReady(int connIdx)
 {
   //TODO: need to send serialize state and send it to the client
+  mClientsChanged = true;
 }
 
 bool IWebsocketEditorDelegate::OnWebsocketText(int connIdx, const char* pStr, size_t dataSize)
@@ -122,6 +123,14 @@ void IWebsocketEditorDelegate::SendParameterValueFromUI(int paramIdx, double val
 
 void IWebsocketEditorDelegate::SendControlValueFromDelegate(int ctrlTag, double normalizedValue)
 {
+  if (mClientUpdateIntervalMs)
+  {
+    mPendingControlValues[ctrlTag] = normalizedValue;
+    FlushClientUpdatesIfDue();
+    IGEditorDelegate::SendControlValueFromDelegate(ctrlTag, normalizedValue);
+    return;
+  }
+
   IByteChunk data;
   data.PutStr("SCVFD");
   data.Put(&ctrlTag);
@@ -134,18 +143,39 @@ void IWebsocketEditorDelegate::SendControlValueFromDelegate(int ctrlTag, double
 
 void IWebsocketEditorDelegate::SendControlMsgFromDelegate(int ctrlTag, int msgTag, int dataSize, const void* pData)
 {
-  IByteChunk data;
-  data.PutStr("SCMFD");
-  data.Put(&ctrlTag);
-  data.Put(&msgTag);
-  data.Put(&dataSize);
-  data.PutBytes(pData, dataSize);
-  
-  SendDataToConnection(-1, data.GetData(), data.Size());
+  if (mClientUpdateIntervalMs)
+  {
+    const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+    mPendingControlMsgs[MsgTags(ctrlTag, msgTag)].assign(pBytes, pBytes + dataSize);
+    FlushClientUpdatesIfDue();
+  }
+  else
+    DoSCMFDToClients(ctrlTag, msgTag, dataSize, pData);
   
   IGEditorDelegate::SendControlMsgFromDelegate(ctrlTag, msgTag, dataSize, pData);
 }
 
+void IWebsocketEditorDelegate::SendControlMsgsFromDelegate(const ControlMsg* pMsgs, int nMsgs)
+{
+  for (int i = 0; i < nMsgs; i++)
+  {
+    const ControlMsg& msg = pMsgs[i];
+
+    if (mClientUpdateIntervalMs)
+    {
+      const uint8_t* pBytes = static_cast<const uint8_t*>(msg.pData);
+      mPendingControlMsgs[MsgTags(msg.ctrlTag, msg.msgTag)].assign(pBytes, pBytes + msg.dataSize);
+    }
+    else
+      DoSCMFDToClients(msg.ctrlTag, msg.msgTag, msg.dataSize, msg.pData);
+  }
+
+  if (mClientUpdateIntervalMs)
+    FlushClientUpdatesIfDue();
+
+  IGEditorDelegate::SendControlMsgsFromDelegate(pMsgs, nMsgs);
+}
+
 void IWebsocketEditorDelegate::SendArbitraryMsgFromDelegate(int msgTag, int dataSize, const void* pData)
 {
   IByteChunk data;
@@ -172,6 +202,23 @@ void IWebsocketEditorDelegate::SendMidiMsgFromDelegate(const IMidiMsg& msg)
   IGEditorDelegate::SendMidiMsgFromDelegate(msg);
 }
 
+void IWebsocketEditorDelegate::SendMidiMsgsFromDelegate(const IMidiMsg* pMsgs, int nMsgs)
+{
+  // clients get one message each, as from SendMidiMsgFromDelegate()
+  for (int i = 0; i < nMsgs; i++)
+  {
+    IByteChunk data;
+    data.PutStr("SMMFD");
+    data.Put(&pMsgs[i].mStatus);
+    data.Put(&pMsgs[i].mData1);
+    data.Put(&pMsgs[i].mData2);
+
+    SendDataToConnection(-1, data.GetData(), data.Size());
+  }
+
+  IGEditorDelegate::SendMidiMsgsFromDelegate(pMsgs, nMsgs);
+}
+
 void IWebsocketEditorDelegate::SendSysexMsgFromDelegate(const ISysEx& msg)
 {
   IByteChunk data;
@@ -184,6 +231,40 @@ void IWebsocketEditorDelegate::SendSysexMsgFromDelegate(const ISysEx& msg)
   IGEditorDelegate::SendSysexMsgFromDelegate(msg);
 }
 
+void IWebsocketEditorDelegate::SendParameterValuesFromDelegate(const ParamTuple* pParams, int nParams, bool normalized)
+{
+  if (mClientUpdateIntervalMs)
+  {
+    for (int i = 0; i < nParams; i++)
+    {
+      const IParam* pParam = GetParam(pParams[i].idx);
+      double value = (normalized || !pParam) ? pParams[i].value : pParam->ToNormalized(pParams[i].value);
+      mPendingParamValues[pParams[i].idx] = ParamTupleCX { pParams[i].idx, value, -1 };
+    }
+
+    FlushClientUpdatesIfDue();
+    IGEditorDelegate::SendParameterValuesFromDelegate(pParams, nParams, normalized);
+    return;
+  }
+
+  // clients always get normalized values, all in one message
+  IByteChunk data;
+  data.PutStr("SPVSFD");
+  data.Put(&nParams);
+
+  for (int i = 0; i < nParams; i++)
+  {
+    const IParam* pParam = GetParam(pParams[i].idx);
+    double value = (normalized || !pParam) ? pParams[i].value : pParam->ToNormalized(pParams[i].value);
+    data.Put(&pParams[i].idx);
+    data.Put(&value);
+  }
+
+  SendDataToConnection(-1, data.GetData(), data.Size());
+
+  IGEditorDelegate::SendParameterValuesFromDelegate(pParams, nParams, normalized);
+}
+
 void IWebsocketEditorDelegate::ProcessWebsocketQueue()
 {
   while(mParamChangeFromClients.ElementsAvailable())
@@ -212,10 +293,139 @@ void IWebsocketEditorDelegate::ProcessWebsocketQueue()
     IGEditorDelegate::SendMidiMsgFromDelegate(msg); // Call the superclass, since we don't want to send another MIDI message to the websocket
     DeferMidiMsg(msg); // can't just call SendMidiMsgFromUI here which would cause a feedback loop
   }
+
+  FlushClientUpdatesIfDue();
+}
+
+void IWebsocketEditorDelegate::SetClientUpdatePolicy(int maxUpdatesPerSecond, bool deltaControlMsgs)
+{
+  FlushClientUpdates();
+
+  mClientUpdateIntervalMs = maxUpdatesPerSecond > 0 ? std::max(1000 / maxUpdatesPerSecond, 1) : 0;
+  mDeltaControlMsgs = deltaControlMsgs;
+  mLastControlMsgs.clear();
+}
+
+void IWebsocketEditorDelegate::FlushClientUpdatesIfDue()
+{
+  const auto now = std::chrono::steady_clock::now();
+
+  if (now - mLastClientUpdate >= std::chrono::milliseconds(mClientUpdateIntervalMs))
+  {
+    mLastClientUpdate = now;
+    FlushClientUpdates();
+  }
+}
+
+void IWebsocketEditorDelegate::FlushClientUpdates()
+{
+  // one message for each client that is excluded, usually just -1 for none
+  std::map<int, std::vector<ParamTupleCX>> paramsByExclude;
+
+  for (const auto& pending : mPendingParamValues)
+    paramsByExclude[pending.second.connection].push_back(pending.second);
+
+  for (const auto& params : paramsByExclude)
+  {
+    IByteChunk data;
+    int nParams = static_cast<int>(params.second.size());
+    data.PutStr("SPVSFD");
+    data.Put(&nParams);
+
+    for (const auto& param : params.second)
+    {
+      data.Put(&param.idx);
+      data.Put(&param.value);
+    }
+
+    SendDataToConnection(-1, data.GetData(), data.Size(), params.first);
+  }
+
+  for (const auto& pending : mPendingControlValues)
+  {
+    IByteChunk data;
+    data.PutStr("SCVFD");
+    data.Put(&pending.first);
+    data.Put(&pending.second);
+    SendDataToConnection(-1, data.GetData(), data.Size());
+  }
+
+  for (const auto& pending : mPendingControlMsgs)
+    DoSCMFDToClients(pending.first.first, pending.first.second, static_cast<int>(pending.second.size()), pending.second.data());
+
+  mPendingParamValues.clear();
+  mPendingControlValues.clear();
+  mPendingControlMsgs.clear();
+}
+
+void IWebsocketEditorDelegate::DoSCMFDToClients(int ctrlTag, int msgTag, int dataSize, const void* pData)
+{
+  IByteChunk data;
+
+  if (mDeltaControlMsgs)
+  {
+    if (mClientsChanged.exchange(false))
+      mLastControlMsgs.clear();
+
+    std::vector<uint8_t>& last = mLastControlMsgs[MsgTags(ctrlTag, msgTag)];
+    const bool canDelta = dataSize > 0 && static_cast<int>(last.size()) == dataSize && (dataSize % 4) == 0;
+
+    if (canDelta)
+    {
+      const int nWords = dataSize / 4;
+      std::vector<int> changed;
+
+      for (int w = 0; w < nWords; w++)
+      {
+        if (memcmp(last.data() + w * 4, static_cast<const uint8_t*>(pData) + w * 4, 4))
+          changed.push_back(w);
+      }
+
+      // each changed word costs 8 bytes, so only worth it when less than half have changed
+      if (static_cast<int>(changed.size()) * 8 < dataSize)
+      {
+        int nChanged = static_cast<int>(changed.size());
+        data.PutStr("SCMDFD");
+        data.Put(&ctrlTag);
+        data.Put(&msgTag);
+        data.Put(&dataSize);
+        data.Put(&nChanged);
+
+        for (auto w : changed)
+        {
+          data.Put(&w);
+          data.PutBytes(static_cast<const uint8_t*>(pData) + w * 4, 4);
+        }
+      }
+    }
+
+    last.assign(static_cast<const uint8_t*>(pData), static_cast<const uint8_t*>(pData) + dataSize);
+
+    if (canDelta && data.Size())
+    {
+      SendDataToConnection(-1, data.GetData(), data.Size());
+      return;
+    }
+  }
+
+  data.PutStr("SCMFD");
+  data.Put(&ctrlTag);
+  data.Put(&msgTag);
+  data.Put(&dataSize);
+  data.PutBytes(pData, dataSize);
+
+  SendDataToConnection(-1, data.GetData(), data.Size());
 }
 
 void IWebsocketEditorDelegate::DoSPVFDToClients(int paramIdx, double value, int excludeIdx)
 {
+  if (mClientUpdateIntervalMs)
+  {
+    mPendingParamValues[paramIdx] = ParamTupleCX { paramIdx, value, excludeIdx };
+    FlushClientUpdatesIfDue();
+    return;
+  }
+
   IByteChunk data;
   data.PutStr("SPVFD");
   data.Put(&paramIdx);
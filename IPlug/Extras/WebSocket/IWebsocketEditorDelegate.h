@@ -5,6 +5,11 @@
 #include "IPlugStructs.h"
 #include "IPlugQueue.h"
 
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <vector>
+
 /**
  * @file
  * @copydoc IWebsocketEditorDelegate
@@ -37,16 +42,30 @@ public:
 
   void SendControlValueFromDelegate(int ctrlTag, double normalizedValue) override;
   void SendControlMsgFromDelegate(int ctrlTag, int msgTag, int dataSize, const void* pData) override;
+  void SendControlMsgsFromDelegate(const ControlMsg* pMsgs, int nMsgs) override;
   void SendArbitraryMsgFromDelegate(int msgTag, int dataSize, const void* pData) override;
   void SendMidiMsgFromDelegate(const IMidiMsg& msg) override;
+  void SendMidiMsgsFromDelegate(const IMidiMsg* pMsgs, int nMsgs) override;
   void SendSysexMsgFromDelegate(const ISysEx& msg) override;
 //  void SendParameterValueFromDelegate(int paramIdx, double value, bool normalized) override;
+  void SendParameterValuesFromDelegate(const ParamTuple* pParams, int nParams, bool normalized) override;
   
   // Call this repeatedly in order to handle incoming data
   void ProcessWebsocketQueue();
-  
+
+  /** Set how clients are updated, for remote editors on slow networks. When the rate is limited, parameter values, control values and control messages
+   * are held back and only the latest of each is sent, at most maxUpdatesPerSecond times a second. ProcessWebsocketQueue() sends anything still waiting
+   * @param maxUpdatesPerSecond The most updates a second, or 0 to send everything straight away
+   * @param deltaControlMsgs If \c true a control message that is the same size as the last one with the same tags, such as meter data, is sent as only the 32 bit words that changed */
+  void SetClientUpdatePolicy(int maxUpdatesPerSecond, bool deltaControlMsgs = false);
+
+  /** Send everything held back by SetClientUpdatePolicy() now */
+  void FlushClientUpdates();
+
 private:
   void DoSPVFDToClients(int paramIdx, double value, int excludeIdx);
+  void DoSCMFDToClients(int ctrlTag, int msgTag, int dataSize, const void* pData);
+  void FlushClientUpdatesIfDue();
   
   struct ParamTupleCX
   {
@@ -63,6 +82,17 @@ private:
 
   IPlugQueue<ParamTupleCX> mParamChangeFromClients {PARAM_TRANSFER_SIZE};
   IPlugQueue<IMidiMsg> mMIDIFromClients {MIDI_TRANSFER_SIZE};
+
+  using MsgTags = std::pair<int, int>; // ctrlTag, msgTag
+
+  int mClientUpdateIntervalMs = 0;
+  bool mDeltaControlMsgs = false;
+  std::chrono::steady_clock::time_point mLastClientUpdate;
+  std::map<int, ParamTupleCX> mPendingParamValues; // connection is the client to exclude
+  std::map<int, double> mPendingControlValues;
+  std::map<MsgTags, std::vector<uint8_t>> mPendingControlMsgs;
+  std::map<MsgTags, std::vector<uint8_t>> mLastControlMsgs; // what the clients have, to send deltas against
+  std::atomic<bool> mClientsChanged {false}; // new clients need whole control messages
 };
 
 END_IPLUG_NAMESPACE
@@ -19,6 +19,13 @@ IWebsocketServer::IWebsocketServer()
 IWebsocketServer::~IWebsocketServer()
 {
   DestroyServer();
+
+  WDL_MutexLock lock(&mMutex);
+
+  for (auto i = 0; i < mConnections.GetSize(); i++)
+    DeleteConnection(mConnections.Get(i));
+
+  mConnections.Empty();
 }
 
 bool IWebsocketServer::CreateServer(const char* DOCUMENT_ROOT, const char* PORT)
@@ -104,37 +111,96 @@ bool IWebsocketServer::OnWebsocketData(int idx, void* pData, size_t dataSize)
 
 bool IWebsocketServer::DoSendToConnection(int idx, int opcode, const char* pData, size_t sizeInBytes, int exclude)
 {
-  int nclients = NClients();
-  
-  std::function<bool(int)> sendFunc = [&](int connIdx) {
-    WDL_MutexLock lock(&mMutex);
-    mg_connection* pConn = mConnections.Get(connIdx);
-    
-    if(pConn) {
-      if(mg_websocket_write(pConn, opcode, pData, sizeInBytes))
-        return true;
-    }
-    
-    return false;
-  };
-  
-  bool success = false;
-  
+  // copied once, and shared by the queues of every connection it is sent to
+  Message msg = std::make_shared<const std::vector<char>>(pData, pData + sizeInBytes);
+
+  WDL_MutexLock lock(&mMutex);
+
+  bool success = true;
+
   if(idx == -1)
   {
-    for(int i=0;i<nclients;i++) // TODO: sending to self?
+    for(int i=0;i<mConnections.GetSize();i++) // TODO: sending to self?
     {
       if(i != exclude)
-        success &= sendFunc(i);
+        success &= EnqueueMessage(mConnections.Get(i), opcode, msg);
     }
   }
   else {
-    sendFunc(idx);
+    Connection* pConnection = mConnections.Get(idx);
+    success = pConnection && EnqueueMessage(pConnection, opcode, msg);
   }
   
   return success;
 }
 
+bool IWebsocketServer::EnqueueMessage(Connection* pConnection, int opcode, const Message& msg)
+{
+  std::lock_guard<std::mutex> lock(pConnection->mQueueMutex);
+
+  bool dropped = false;
+
+  while (!pConnection->mQueue.empty() && pConnection->mQueuedBytes + msg->size() > mMaxQueuedBytes)
+  {
+    pConnection->mQueuedBytes -= pConnection->mQueue.front().second->size();
+    pConnection->mQueue.pop_front();
+    dropped = true;
+  }
+
+  pConnection->mQueue.emplace_back(opcode, msg);
+  pConnection->mQueuedBytes += msg->size();
+  pConnection->mQueueCondition.notify_one();
+
+  return !dropped;
+}
+
+void IWebsocketServer::WriteMessages(Connection* pConnection)
+{
+  std::unique_lock<std::mutex> lock(pConnection->mQueueMutex);
+
+  while (true)
+  {
+    pConnection->mQueueCondition.wait(lock, [pConnection]() { return pConnection->mClosing || !pConnection->mQueue.empty(); });
+
+    if (pConnection->mClosing)
+      return;
+
+    std::pair<int, Message> next = std::move(pConnection->mQueue.front());
+    pConnection->mQueue.pop_front();
+    pConnection->mQueuedBytes -= next.second->size();
+
+    // write without the lock held, so that senders can keep queueing whilst a slow client catches up
+    lock.unlock();
+    mg_websocket_write(pConnection->mConn, next.first, next.second->data(), next.second->size());
+    lock.lock();
+  }
+}
+
+void IWebsocketServer::DeleteConnection(Connection* pConnection)
+{
+  {
+    std::lock_guard<std::mutex> lock(pConnection->mQueueMutex);
+    pConnection->mClosing = true;
+    pConnection->mQueueCondition.notify_one();
+  }
+
+  if (pConnection->mWriter.joinable())
+    pConnection->mWriter.join();
+
+  delete pConnection;
+}
+
+int IWebsocketServer::FindConnection(const mg_connection* pConn) const
+{
+  for (auto i = 0; i < mConnections.GetSize(); i++)
+  {
+    if (mConnections.Get(i)->mConn == pConn)
+      return i;
+  }
+
+  return -1;
+}
+
 // CivetWebSocketHandler
 // These methods are called on the server thread
 bool IWebsocketServer::handleConnection(CivetServer* pServer, const struct mg_connection* pConn)
@@ -149,7 +215,9 @@ void IWebsocketServer::handleReadyState(CivetServer* pServer, struct mg_connecti
 {
   WDL_MutexLock lock(&mMutex);
   
-  mConnections.Add(pConn);
+  Connection* pConnection = new Connection(pConn);
+  pConnection->mWriter = std::thread(&IWebsocketServer::WriteMessages, pConnection);
+  mConnections.Add(pConnection);
   
   DBGMSG("WS ready NClients %i\n", NClients());
   
@@ -164,11 +232,11 @@ bool IWebsocketServer::handleData(CivetServer* pServer, struct mg_connection* pC
   
   if(*firstByte == 129) // TODO: check that
   {
-    return OnWebsocketText(mConnections.Find(pConn), pData, dataSize);
+    return OnWebsocketText(FindConnection(pConn), pData, dataSize);
   }
   else if(*firstByte == 130) // TODO: check that
   {
-    return OnWebsocketData(mConnections.Find(pConn), (void*) pData, dataSize);
+    return OnWebsocketData(FindConnection(pConn), (void*) pData, dataSize);
   }
   
   return true;
@@ -178,7 +246,14 @@ void IWebsocketServer::handleClose(CivetServer* pServer, const struct mg_connect
 {
   WDL_MutexLock lock(&mMutex);
 
-  mConnections.DeletePtr(pConn);
+  const int idx = FindConnection(pConn);
+
+  // civetweb frees the connection after this returns, so its writer thread has to finish first
+  if (idx > -1)
+  {
+    DeleteConnection(mConnections.Get(idx));
+    mConnections.Delete(idx);
+  }
   
   DBGMSG("WS closed NClients %i\n", NClients());
 }
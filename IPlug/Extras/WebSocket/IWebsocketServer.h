@@ -9,8 +9,13 @@
 */
 
 #include "CivetServer.h"
+#include <condition_variable>
 #include <cstring>
+#include <deque>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include "ptrlist.h"
 #include "IPlugLogger.h"
@@ -24,8 +29,12 @@
 
 BEGIN_IPLUG_NAMESPACE
 
+/** A websocket server for remote editors. Messages are copied once and then queued for each connection, and every connection has a thread that writes its queue,
+ * so one slow client doesn't hold up the others or the thread sending. permessage-deflate is negotiated by civetweb itself when it is built with USE_ZLIB */
 class IWebsocketServer : public CivetWebSocketHandler
 {
+  static constexpr size_t kDefaultMaxQueuedBytes = 1024 * 1024;
+
 public:
   IWebsocketServer();
   virtual ~IWebsocketServer();
@@ -44,6 +53,11 @@ public:
   bool SendTextToConnection(int idx, const char* str, int exclude = -1);
   
   bool SendDataToConnection(int idx, void* pData, size_t sizeInBytes, int exclude = -1);
+
+  /** Set how much data may be waiting to be sent to one connection. When a connection falls further behind than this its oldest messages are dropped,
+   * which suits messages that carry the latest state, such as meters and parameter values
+   * @param maxBytes The limit for each connection, in bytes */
+  void SetMaxQueuedBytes(size_t maxBytes) { mMaxQueuedBytes = maxBytes; }
   
   virtual void OnWebsocketReady(int idx);
   
@@ -52,7 +66,36 @@ public:
   virtual bool OnWebsocketData(int idx, void* pData, size_t dataSize);
   
 private:
+  using Message = std::shared_ptr<const std::vector<char>>;
+
+  /** A connection, with the queue of messages waiting to be written by its thread */
+  struct Connection
+  {
+    Connection(mg_connection* pConn) : mConn(pConn) {}
+
+    mg_connection* mConn;
+    std::thread mWriter;
+    std::mutex mQueueMutex;
+    std::condition_variable mQueueCondition;
+    std::deque<std::pair<int, Message>> mQueue;
+    size_t mQueuedBytes = 0;
+    bool mClosing = false;
+  };
+
   bool DoSendToConnection(int idx, int opcode, const char* pData, size_t sizeInBytes, int exclude);
+
+  /** Queue a message for a connection, dropping its oldest messages if it is too far behind
+   * @return \c false if messages were dropped */
+  bool EnqueueMessage(Connection* pConnection, int opcode, const Message& msg);
+
+  /** The body of each connection's writer thread */
+  static void WriteMessages(Connection* pConnection);
+
+  /** Stops a connection's writer thread and deletes it */
+  static void DeleteConnection(Connection* pConnection);
+
+  /** @return The index of the connection in mConnections, or -1 */
+  int FindConnection(const mg_connection* pConn) const;
   
   // CivetWebSocketHandler
   bool handleConnection(CivetServer* pServer, const struct mg_connection* pConn) override;
@@ -63,7 +106,8 @@ private:
   
   void handleClose(CivetServer* pServer, const struct mg_connection* pConn) override;
   
-  WDL_PtrList<mg_connection> mConnections;
+  WDL_PtrList<Connection> mConnections;
+  size_t mMaxQueuedBytes = kDefaultMaxQueuedBytes;
   static std::unique_ptr<CivetServer> sServer;
   static int sInstances;
 
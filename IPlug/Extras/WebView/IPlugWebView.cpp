@@ -10,110 +10,350 @@ See LICENSE.txt for  more info.
 
 #include "IPlugWebView.h"
 #include "IPlugPaths.h"
+#include <algorithm>
+#include <map>
 #include <string>
+#include <vector>
 #include <windows.h>
 #include <cassert>
 
 using namespace iplug;
 using namespace Microsoft::WRL;
 
+namespace {
+
+typedef HRESULT(*TCCWebView2EnvWithOptions)(
+  PCWSTR browserExecutableFolder,
+  PCWSTR userDataFolder,
+  PCWSTR additionalBrowserArguments,
+  ICoreWebView2CreateCoreWebView2EnvironmentCompletedHandler* environment_created_handler);
+
+/** Creating a WebView2 environment starts the browser processes, which takes hundreds of milliseconds, so one environment per loader DLL and user data folder
+ * is shared by every IWebView in the process, and kept until the last IWebView is deleted. It also owns the hidden window that web views kept loaded are parented to whilst closed */
+class WebViewEnvironmentCache
+{
+public:
+  using EnvironmentFunc = std::function<void(ICoreWebView2Environment* pEnv)>;
+
+  static WebViewEnvironmentCache& Get()
+  {
+    static WebViewEnvironmentCache sCache;
+    return sCache;
+  }
+
+  void AddUser() { mNumUsers++; }
+
+  void RemoveUser()
+  {
+    if (--mNumUsers > 0)
+      return;
+
+    // environments still being created are dropped when they arrive
+    for (auto it = mEntries.begin(); it != mEntries.end();)
+    {
+      if (it->second.creating)
+      {
+        it->second.pending.clear();
+        ++it;
+        continue;
+      }
+
+      if (it->second.dllHandle)
+        FreeLibrary(it->second.dllHandle);
+
+      it = mEntries.erase(it);
+    }
+
+    if (mHostWnd)
+    {
+      DestroyWindow(mHostWnd);
+      mHostWnd = nullptr;
+    }
+  }
+
+  /** Call func with the environment for the paths, straight away if it exists, otherwise when it has been created. func gets nullptr if it couldn't be created
+   * @param pOwner The IWebView asking, so that CancelPending() can drop func if it is deleted first */
+  void GetEnvironment(const void* pOwner, const char* dllPath, const char* tmpPath, EnvironmentFunc func)
+  {
+    std::string key = std::string(dllPath) + "|" + tmpPath;
+    Entry& entry = mEntries[key];
+
+    if (entry.env)
+    {
+      func(entry.env.get());
+      return;
+    }
+
+    entry.pending.push_back({pOwner, func});
+
+    if (entry.creating)
+      return;
+
+    if (!entry.dllHandle)
+      entry.dllHandle = LoadLibraryA(dllPath);
+
+    TCCWebView2EnvWithOptions createEnv = entry.dllHandle ? (TCCWebView2EnvWithOptions) GetProcAddress(entry.dllHandle, "CreateCoreWebView2EnvironmentWithOptions") : nullptr;
+
+    if (createEnv == nullptr)
+    {
+      OnEnvironmentCreated(key, nullptr);
+      return;
+    }
+
+    WCHAR tmpPathWide[IPLUG_WIN_MAX_WIDE_PATH];
+    UTF8ToUTF16(tmpPathWide, tmpPath, IPLUG_WIN_MAX_WIDE_PATH);
+
+    entry.creating = true;
+
+    HRESULT hr = createEnv(nullptr, tmpPathWide, nullptr,
+      Callback<ICoreWebView2CreateCoreWebView2EnvironmentCompletedHandler>(
+        [this, key](HRESULT result, ICoreWebView2Environment* env) -> HRESULT {
+          OnEnvironmentCreated(key, SUCCEEDED(result) ? env : nullptr);
+          return S_OK;
+        }).Get());
+
+    if (FAILED(hr))
+      OnEnvironmentCreated(key, nullptr);
+  }
+
+  void CancelPending(const void* pOwner)
+  {
+    for (auto& entry : mEntries)
+    {
+      auto& pending = entry.second.pending;
+      pending.erase(std::remove_if(pending.begin(), pending.end(), [pOwner](const PendingFunc& p) { return p.first == pOwner; }), pending.end());
+    }
+  }
+
+  /** @return A hidden window to parent web views to whilst they are closed or preloading */
+  HWND GetHostWindow()
+  {
+    if (!mHostWnd)
+    {
+      WNDCLASSW wc = {};
+      wc.lpfnWndProc = DefWindowProcW;
+      wc.hInstance = GetModuleHandle(nullptr);
+      wc.lpszClassName = L"IPlugWebViewHost";
+      RegisterClassW(&wc); // fails harmlessly if another IPlug binary in the process registered it
+      mHostWnd = CreateWindowExW(WS_EX_TOOLWINDOW, L"IPlugWebViewHost", L"", WS_POPUP, 0, 0, 0, 0, nullptr, nullptr, wc.hInstance, nullptr);
+    }
+
+    return mHostWnd;
+  }
+
+private:
+  using PendingFunc = std::pair<const void*, EnvironmentFunc>;
+
+  struct Entry
+  {
+    HMODULE dllHandle = nullptr;
+    wil::com_ptr<ICoreWebView2Environment> env;
+    bool creating = false;
+    std::vector<PendingFunc> pending;
+  };
+
+  void OnEnvironmentCreated(const std::string& key, ICoreWebView2Environment* pEnv)
+  {
+    auto it = mEntries.find(key);
+
+    if (it == mEntries.end())
+      return;
+
+    Entry& entry = it->second;
+    std::vector<PendingFunc> pending;
+    std::swap(pending, entry.pending);
+    entry.creating = false;
+
+    if (mNumUsers > 0)
+      entry.env = pEnv;
+
+    for (auto& p : pending)
+      p.second(entry.env.get());
+
+    // tried again by the next GetEnvironment()
+    if (!entry.env)
+    {
+      if (entry.dllHandle)
+        FreeLibrary(entry.dllHandle);
+
+      mEntries.erase(it);
+    }
+  }
+
+  std::map<std::string, Entry> mEntries;
+  HWND mHostWnd = nullptr;
+  int mNumUsers = 0;
+};
+
+} // namespace
+
 IWebView::IWebView(bool opaque)
 {
+  WebViewEnvironmentCache::Get().AddUser();
 }
 
 IWebView::~IWebView()
 {
-  CloseWebView();
+  DestroyWebView();
+  WebViewEnvironmentCache::Get().CancelPending(this);
+  WebViewEnvironmentCache::Get().RemoveUser();
 }
 
-typedef HRESULT(*TCCWebView2EnvWithOptions)(
-  PCWSTR browserExecutableFolder,
-  PCWSTR userDataFolder,
-  PCWSTR additionalBrowserArguments,
-  ICoreWebView2CreateCoreWebView2EnvironmentCompletedHandler* environment_created_handler);
-
 void* IWebView::OpenWebView(void* pParent, float x, float y, float w, float h, float scale)
 {
-  HWND hWnd = (HWND) pParent;
-
   x *= scale;
   y *= scale;
   w *= scale;
   h *= scale;
 
-  assert(mDLLPath.GetLength() > 0);
+  mParentWnd = (HWND) pParent;
+  mBounds = { (LONG)x, (LONG)y, (LONG)(x + w), (LONG)(y + h) };
+  mVisible = true;
 
-  mDLLHandle = LoadLibraryA(mDLLPath.Get());
+  if (mWebViewCtrlr)
+  {
+    // kept loaded or preloaded, so only needs moving to the new parent
+    PlaceWebView();
 
-  TCCWebView2EnvWithOptions handle = (TCCWebView2EnvWithOptions) GetProcAddress(mDLLHandle, "CreateCoreWebView2EnvironmentWithOptions");
+    if (mContentLoaded)
+      OnWebContentLoaded();
+  }
+  else
+    CreateWebView();
 
-  if (handle != NULL)
-  {
-    WCHAR tmpPathWide[IPLUG_WIN_MAX_WIDE_PATH];
-    UTF8ToUTF16(tmpPathWide, mTmpPath.Get(), IPLUG_WIN_MAX_WIDE_PATH);
+  return nullptr;
+}
 
-    HRESULT  v = handle(nullptr, tmpPathWide, nullptr,
+void IWebView::PreloadWebView(float w, float h)
+{
+  mKeepLoaded = true;
 
-      Callback<ICoreWebView2CreateCoreWebView2EnvironmentCompletedHandler>(
-        [&, hWnd, x, y, w, h](HRESULT result, ICoreWebView2Environment* env) -> HRESULT {
-          env->CreateCoreWebView2Controller(hWnd,
-            Callback<ICoreWebView2CreateCoreWebView2ControllerCompletedHandler>(
-              [&, hWnd, x, y, w, h](HRESULT result, ICoreWebView2Controller* controller) -> HRESULT {
-                if (controller != nullptr) {
-                  mWebViewCtrlr = controller;
-                  mWebViewCtrlr->get_CoreWebView2(&mWebViewWnd);
-                }
+  if (mWebViewCtrlr || mCreating)
+    return;
 
-                ICoreWebView2Settings* Settings;
-                mWebViewWnd->get_Settings(&Settings);
-                Settings->put_IsScriptEnabled(TRUE);
-                Settings->put_AreDefaultScriptDialogsEnabled(TRUE);
-                Settings->put_IsWebMessageEnabled(TRUE);
-
-                // this script adds a function IPlugSendMsg that is used to call the platform webview messaging function in JS
-                mWebViewWnd->AddScriptToExecuteOnDocumentCreated(L"function IPlugSendMsg(m) {window.chrome.webview.postMessage(m)};",
-                  Callback<ICoreWebView2AddScriptToExecuteOnDocumentCreatedCompletedHandler>(
-                    [this](HRESULT error, PCWSTR id) -> HRESULT {
-                      return S_OK;
-                    }).Get());
-
-                mWebViewWnd->add_WebMessageReceived(
-                  Callback<ICoreWebView2WebMessageReceivedEventHandler>(
-                    [this](ICoreWebView2* sender, ICoreWebView2WebMessageReceivedEventArgs* args) {
-                      wil::unique_cotaskmem_string jsonString;
-                      args->get_WebMessageAsJson(&jsonString);
-                      std::wstring jsonWString = jsonString.get();
-                      WDL_String cStr;
-                      UTF16ToUTF8(cStr, jsonWString.c_str());
-                      OnMessageFromWebView(cStr.Get());
-                      return S_OK;
-                    }).Get(), &mWebMessageReceivedToken);
-
-                mWebViewWnd->add_NavigationCompleted(
-                  Callback<ICoreWebView2NavigationCompletedEventHandler>(
-                    [this](ICoreWebView2* sender, ICoreWebView2NavigationCompletedEventArgs* args) -> HRESULT {
-                      BOOL success;
-                      args->get_IsSuccess(&success);
-                      if (success)
-                      {
-                        OnWebContentLoaded();
-                      }
-                      return S_OK;
-                    })
-                  .Get(), &mNavigationCompletedToken);
-
-                mWebViewCtrlr->put_Bounds({ (LONG)x, (LONG)y, (LONG)(x + w), (LONG)(y + h) });
-                OnWebViewReady();
+  mParentWnd = WebViewEnvironmentCache::Get().GetHostWindow();
+  mBounds = { 0, 0, (LONG) w, (LONG) h };
+  mVisible = false;
+  CreateWebView();
+}
+
+void IWebView::CreateWebView()
+{
+  if (mCreating)
+    return;
+
+  assert(mDLLPath.GetLength() > 0);
+
+  mCreating = true;
+
+  WebViewEnvironmentCache::Get().GetEnvironment(this, mDLLPath.Get(), mTmpPath.Get(), [&](ICoreWebView2Environment* env) {
+    if (env == nullptr || mParentWnd == nullptr)
+    {
+      mCreating = false;
+      return;
+    }
+
+    mWebViewEnv = env;
+    env->CreateCoreWebView2Controller(mParentWnd,
+      Callback<ICoreWebView2CreateCoreWebView2ControllerCompletedHandler>(
+        [&](HRESULT result, ICoreWebView2Controller* controller) -> HRESULT {
+          mCreating = false;
+
+          if (controller == nullptr)
+            return S_OK;
+
+          // closed without being kept loaded before it was ready
+          if (mParentWnd == nullptr)
+          {
+            controller->Close();
+            return S_OK;
+          }
+
+          mWebViewCtrlr = controller;
+          mWebViewCtrlr->get_CoreWebView2(&mWebViewWnd);
+
+          ICoreWebView2Settings* Settings;
+          mWebViewWnd->get_Settings(&Settings);
+          Settings->put_IsScriptEnabled(TRUE);
+          Settings->put_AreDefaultScriptDialogsEnabled(TRUE);
+          Settings->put_IsWebMessageEnabled(TRUE);
+
+          // this script adds a function IPlugSendMsg that is used to call the platform webview messaging function in JS
+          // and forwards shared buffers from PostBinaryMessage() to SBMFD()
+          mWebViewWnd->AddScriptToExecuteOnDocumentCreated(L"function IPlugSendMsg(m) {window.chrome.webview.postMessage(m)};"
+                                                           L"window.chrome.webview.addEventListener('sharedbufferreceived', function(e) {"
+                                                           L"var b = e.getBuffer(); if (typeof SBMFD === 'function') SBMFD(e.additionalData, b); window.chrome.webview.releaseBuffer(b);});",
+            Callback<ICoreWebView2AddScriptToExecuteOnDocumentCreatedCompletedHandler>(
+              [this](HRESULT error, PCWSTR id) -> HRESULT {
                 return S_OK;
               }).Get());
+
+          mWebViewWnd->add_WebMessageReceived(
+            Callback<ICoreWebView2WebMessageReceivedEventHandler>(
+              [this](ICoreWebView2* sender, ICoreWebView2WebMessageReceivedEventArgs* args) {
+                wil::unique_cotaskmem_string jsonString;
+                args->get_WebMessageAsJson(&jsonString);
+                std::wstring jsonWString = jsonString.get();
+                WDL_String cStr;
+                UTF16ToUTF8(cStr, jsonWString.c_str());
+                OnMessageFromWebView(cStr.Get());
+                return S_OK;
+              }).Get(), &mWebMessageReceivedToken);
+
+          mWebViewWnd->add_NavigationCompleted(
+            Callback<ICoreWebView2NavigationCompletedEventHandler>(
+              [this](ICoreWebView2* sender, ICoreWebView2NavigationCompletedEventArgs* args) -> HRESULT {
+                BOOL success;
+                args->get_IsSuccess(&success);
+                if (success)
+                {
+                  mContentLoaded = true;
+
+                  // a preloaded page is reported when it is opened
+                  if (mVisible)
+                    OnWebContentLoaded();
+                }
+                return S_OK;
+              })
+            .Get(), &mNavigationCompletedToken);
+
+          // the web view may have been opened or closed whilst it was being made
+          PlaceWebView();
+          OnWebViewReady();
           return S_OK;
         }).Get());
-  }
+  });
+}
 
-  return nullptr;
+void IWebView::PlaceWebView()
+{
+  wil::com_ptr<ICoreWebView2Controller> controller = mWebViewCtrlr;
+  HWND currentParent = nullptr;
+  controller->get_ParentWindow(&currentParent);
+
+  if (currentParent != mParentWnd)
+    controller->put_ParentWindow(mParentWnd);
+
+  controller->put_Bounds(mBounds);
+  controller->put_IsVisible(mVisible ? TRUE : FALSE);
 }
 
 void IWebView::CloseWebView()
+{
+  if (!mKeepLoaded)
+  {
+    DestroyWebView();
+    return;
+  }
+
+  mParentWnd = WebViewEnvironmentCache::Get().GetHostWindow();
+  mVisible = false;
+
+  if (mWebViewCtrlr)
+    PlaceWebView();
+}
+
+void IWebView::DestroyWebView()
 {
   if (mWebViewCtrlr.get() != nullptr)
   {
@@ -122,11 +362,13 @@ void IWebView::CloseWebView()
     mWebViewWnd = nullptr;
   }
 
-  if (mDLLHandle)
-  {
-    FreeLibrary(mDLLHandle);
-    mDLLHandle = nullptr;
-  }
+  for (auto& buffer : mSharedBuffers)
+    buffer = nullptr;
+
+  mWebViewEnv = nullptr;
+  mContentLoaded = false;
+  mVisible = false;
+  mParentWnd = nullptr;
 }
 
 void IWebView::LoadHTML(const char* html)
@@ -166,10 +408,12 @@ void IWebView::EvaluateJavaScript(const char* scriptStr, completionHandlerFunc f
 {
   if (mWebViewWnd)
   {
-    WCHAR scriptWide[IPLUG_WIN_MAX_WIDE_PATH]; // TODO: error check/size
-    UTF8ToUTF16(scriptWide, scriptStr, IPLUG_WIN_MAX_WIDE_PATH); // TODO: error check/size
+    // batched scripts can be much longer than a path, and UTF-16 never needs more code units than UTF-8 has bytes
+    const int maxLen = static_cast<int>(strlen(scriptStr)) + 1;
+    std::vector<WCHAR> scriptWide(maxLen);
+    UTF8ToUTF16(scriptWide.data(), scriptStr, maxLen);
 
-    mWebViewWnd->ExecuteScript(scriptWide, Callback<ICoreWebView2ExecuteScriptCompletedHandler>(
+    mWebViewWnd->ExecuteScript(scriptWide.data(), Callback<ICoreWebView2ExecuteScriptCompletedHandler>(
       [func](HRESULT errorCode, LPCWSTR resultObjectAsJson) -> HRESULT {
         if (func && resultObjectAsJson) {
           WDL_String str;
@@ -181,6 +425,46 @@ void IWebView::EvaluateJavaScript(const char* scriptStr, completionHandlerFunc f
   }
 }
 
+bool IWebView::PostBinaryMessage(const void* pData, int size, const char* jsonInfo)
+{
+  if (!mWebViewWnd || !mWebViewEnv || size <= 0)
+    return false;
+
+  // shared buffers need a recent runtime
+  auto webView17 = mWebViewWnd.try_query<ICoreWebView2_17>();
+  auto env12 = mWebViewEnv.try_query<ICoreWebView2Environment12>();
+
+  if (!webView17 || !env12)
+    return false;
+
+  wil::com_ptr<ICoreWebView2SharedBuffer>& buffer = mSharedBuffers[mNextSharedBuffer];
+  UINT64 capacity = 0;
+
+  if (buffer)
+    buffer->get_Size(&capacity);
+
+  if (capacity < static_cast<UINT64>(size))
+  {
+    buffer = nullptr;
+
+    if (FAILED(env12->CreateSharedBuffer(size, &buffer)))
+      return false;
+  }
+
+  BYTE* pBuffer = nullptr;
+  buffer->get_Buffer(&pBuffer);
+  memcpy(pBuffer, pData, size);
+
+  WCHAR infoWide[IPLUG_WIN_MAX_WIDE_PATH];
+  UTF8ToUTF16(infoWide, jsonInfo, IPLUG_WIN_MAX_WIDE_PATH);
+
+  if (FAILED(webView17->PostSharedBufferToScript(buffer.get(), COREWEBVIEW2_SHARED_BUFFER_ACCESS_READ_ONLY, infoWide)))
+    return false;
+
+  mNextSharedBuffer = (mNextSharedBuffer + 1) % kNumSharedBuffers;
+  return true;
+}
+
 void IWebView::EnableScroll(bool enable)
 {
   // TODO?
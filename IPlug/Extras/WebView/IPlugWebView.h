@@ -41,6 +41,18 @@ public:
   
   void* OpenWebView(void* pParent, float x, float y, float w, float h, float scale = 1.);
   void CloseWebView();
+
+  /** Keep the web view, with its page loaded, when CloseWebView() is called, so that the next OpenWebView() just reparents it rather than making a new one and loading the page again.
+   * Whilst closed the web view is hidden (on Windows it is parented to a hidden window). It is destroyed with the IWebView
+   * @param keep \c true to keep the web view loaded */
+  void SetKeepWebViewLoaded(bool keep) { mKeepLoaded = keep; }
+
+  /** Make the web view before it is opened, hidden, so that OnWebViewReady() loads the page in advance and the first OpenWebView() reparents a ready view.
+   * This keeps the web view loaded, as SetKeepWebViewLoaded(true). Call it on the main thread, e.g. at the end of the plug-in's constructor, once whatever
+   * OnWebViewReady() does is set up (with WebViewEditorDelegate, mEditorInitFunc) and on Windows after SetWebViewPaths()
+   * @param w The width the web view is expected to open at
+   * @param h The height the web view is expected to open at */
+  void PreloadWebView(float w, float h);
   
   /** Load an HTML string into the webview */
   void LoadHTML(const char* html);
@@ -57,6 +69,14 @@ public:
    * @param scriptStr UTF8 encoded JavaScript code to run
    * @param func A function conforming to completionHandlerFunc that should be called on successful execution of the script */
   void EvaluateJavaScript(const char* scriptStr, completionHandlerFunc func = nullptr);
+
+  /** Send binary data to the web view without encoding it as text. The page receives it via a global function SBMFD(info, arrayBuffer), where info is the parsed jsonInfo.
+   * The ArrayBuffer is only valid until SBMFD() returns, so copy anything that is needed later. NOTE: currently only implemented with WebView2 runtimes that support shared buffers
+   * @param pData The data
+   * @param size The size of the data in bytes
+   * @param jsonInfo A UTF8 JSON object describing the data, for instance its tags
+   * @return \c true if the data was posted, \c false if there is no binary transport, in which case use EvaluateJavaScript() */
+  bool PostBinaryMessage(const void* pData, int size, const char* jsonInfo);
   
   /** Enable scrolling on the webview. NOTE: currently only implemented for iOS */
   void EnableScroll(bool enable);
@@ -64,10 +84,10 @@ public:
   /** Set the bounds of the webview in the parent window. xywh are specifed in relation to a 1:1 non retina screen. On Windows the screen scale is passed in. */
   void SetWebViewBounds(float x, float y, float w, float h, float scale = 1.); //TODO: get screen scale in impl?
 
-  /** Called when the web view is ready to receive navigation instructions*/
+  /** Called when the web view is ready to receive navigation instructions. A web view that was kept loaded (see SetKeepWebViewLoaded()) is not made again when it reopens, so this isn't called again */
   virtual void OnWebViewReady() {}
   
-  /** Called after navigation instructions have been exectued and e.g. a page has loaded */
+  /** Called after navigation instructions have been exectued and e.g. a page has loaded. Also called when a web view kept loaded reopens, since the page is then ready straight away */
   virtual void OnWebContentLoaded() {}
   
   /** When a script in the web view posts a message, it will arrive as a UTF8 json string here */
@@ -81,19 +101,34 @@ public:
 #endif
   
 private:
+  /** Destroy the web view, even if it is kept loaded */
+  void DestroyWebView();
+
   bool mOpaque = true;
+  bool mKeepLoaded = false;
 #if defined OS_MAC || defined OS_IOS
-  void* mWKWebView = nullptr;
+  void* mWKWebView = nullptr; // retained, so that a web view kept loaded survives being removed from its parent
   void* mWebConfig = nullptr;
   void* mScriptHandler = nullptr;
 #elif defined OS_WIN
+  void CreateWebView();
+  void PlaceWebView();
+
+  static constexpr int kNumSharedBuffers = 3; // posted in turn, so that a buffer is not overwritten whilst the page may still be reading it
+  wil::com_ptr<ICoreWebView2Environment> mWebViewEnv; // shared by every IWebView in the process, see WebViewEnvironmentCache in IPlugWebView.cpp
+  wil::com_ptr<ICoreWebView2SharedBuffer> mSharedBuffers[kNumSharedBuffers];
+  int mNextSharedBuffer = 0;
   wil::com_ptr<ICoreWebView2Controller> mWebViewCtrlr;
   wil::com_ptr<ICoreWebView2> mWebViewWnd;
   EventRegistrationToken mWebMessageReceivedToken;
   EventRegistrationToken mNavigationCompletedToken;
   WDL_String mDLLPath;
   WDL_String mTmpPath;
-  HMODULE mDLLHandle = nullptr;
+  bool mCreating = false;
+  bool mContentLoaded = false;
+  bool mVisible = false;
+  HWND mParentWnd = nullptr;
+  RECT mBounds = {};
 #endif
 };
 
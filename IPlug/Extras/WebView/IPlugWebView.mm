@@ -54,7 +54,9 @@ using namespace iplug;
 
 - (void) webView:(WKWebView*) webView didFinishNavigation:(WKNavigation*) navigation
 {
-  mWebView->OnWebContentLoaded();
+  // a page preloaded offscreen is reported when it is opened
+  if (webView.superview)
+    mWebView->OnWebContentLoaded();
 }
 
 @end
@@ -66,11 +68,24 @@ IWebView::IWebView(bool opaque)
 
 IWebView::~IWebView()
 {
-  CloseWebView();
+  DestroyWebView();
 }
 
 void* IWebView::OpenWebView(void* pParent, float x, float y, float w, float h, float scale)
-{  
+{
+  if (mWKWebView)
+  {
+    // kept loaded or preloaded, so only needs adding to the new parent, which the caller does
+    WKWebView* webView = (__bridge WKWebView*) mWKWebView;
+    [webView setFrame: MAKERECT(x, y, w, h)];
+    [webView setHidden:NO];
+
+    if (!webView.isLoading && webView.URL != nil)
+      OnWebContentLoaded();
+
+    return mWKWebView;
+  }
+
   WKWebViewConfiguration* webConfig = [[WKWebViewConfiguration alloc] init];
   WKPreferences* preferences = [[WKPreferences alloc] init];
   
@@ -121,19 +136,57 @@ void* IWebView::OpenWebView(void* pParent, float x, float y, float w, float h, f
 //#endif
 //  [parentView setAutoresizesSubviews:YES];
   
-  mWebConfig = (__bridge void*) webConfig;
-  mWKWebView = (__bridge void*) webView;
-  mScriptHandler = (__bridge void*) scriptHandler;
+  mWebConfig = (__bridge_retained void*) webConfig;
+  mWKWebView = (__bridge_retained void*) webView;
+  mScriptHandler = (__bridge_retained void*) scriptHandler;
   
   OnWebViewReady();
 
-  return (__bridge void*) webView;
+  return mWKWebView;
+}
+
+void IWebView::PreloadWebView(float w, float h)
+{
+  mKeepLoaded = true;
+
+  if (!mWKWebView)
+  {
+    OpenWebView(nullptr, 0, 0, w, h);
+    [(__bridge WKWebView*) mWKWebView setHidden:YES];
+  }
 }
 
 void IWebView::CloseWebView()
 {
+  if (!mKeepLoaded)
+  {
+    DestroyWebView();
+    return;
+  }
+
+  WKWebView* webView = (__bridge WKWebView*) mWKWebView;
+  [webView setHidden:YES];
+  [webView removeFromSuperview];
+}
+
+void IWebView::DestroyWebView()
+{
+  if (mWKWebView)
+  {
+    WKWebView* webView = (__bridge_transfer WKWebView*) mWKWebView;
+    [webView setNavigationDelegate:nil];
+    [webView.configuration.userContentController removeScriptMessageHandlerForName:@"callback"];
+    [webView removeFromSuperview];
+  }
+
+  if (mWebConfig)
+    CFBridgingRelease(mWebConfig);
+
+  if (mScriptHandler)
+    CFBridgingRelease(mScriptHandler);
+
   mWKWebView = nullptr;
-  mWKWebView = nullptr;
+  mWebConfig = nullptr;
   mScriptHandler = nullptr;
 }
 
@@ -189,6 +242,12 @@ void IWebView::EvaluateJavaScript(const char* scriptStr, completionHandlerFunc f
   }
 }
 
+bool IWebView::PostBinaryMessage(const void* pData, int size, const char* jsonInfo)
+{
+  // WKWebView has no way to pass an ArrayBuffer from native code to a page, so callers fall back to EvaluateJavaScript()
+  return false;
+}
+
 void IWebView::EnableScroll(bool enable)
 {
 #ifdef OS_IOS
@@ -11,6 +11,7 @@
 #pragma once
 
 #include "IPlugWebViewEditorDelegate.h"
+#include "IPlugStartupTimer.h"
 
 using namespace iplug;
 
@@ -29,6 +30,7 @@ extern float GetScaleForHWND(HWND hWnd);
 
 void* WebViewEditorDelegate::OpenWindow(void* pParent)
 {
+  ENTER_STARTUP_TIMING_SCOPE(kEditorOpen)
   auto scale = GetScaleForHWND((HWND) pParent);
   return OpenWebView(pParent, 0., 0., static_cast<float>((GetEditorWidth()) / scale), static_cast<float>((GetEditorHeight()) / scale), scale);
 }
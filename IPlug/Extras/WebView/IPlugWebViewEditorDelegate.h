@@ -12,9 +12,12 @@
 
 #include "IPlugEditorDelegate.h"
 #include "IPlugWebView.h"
+#include "IPlugTimer.h"
 #include "wdl_base64.h"
 #include "json.hpp"
 #include <functional>
+#include <map>
+#include <memory>
 
 BEGIN_IPLUG_NAMESPACE
 
@@ -33,11 +36,27 @@ public:
   
   void CloseWindow() override
   {
+    if (mBatchTimer)
+    {
+      mBatchTimer->Stop();
+      mBatchTimer = nullptr;
+    }
+
+    mPendingParamValues.clear();
+    mPendingControlValues.clear();
+    mPendingMsgs.Set("");
     CloseWebView();
   }
 
   void SendControlValueFromDelegate(int ctrlTag, double normalizedValue) override
   {
+    if (mBatchMessages)
+    {
+      mPendingControlValues[ctrlTag] = normalizedValue;
+      StartBatchTimer();
+      return;
+    }
+
     WDL_String str;
     str.SetFormatted(mMaxJSStringLength, "SCVFD(%i, %f)", ctrlTag, normalizedValue);
     EvaluateJavaScript(str.Get());
@@ -46,26 +65,88 @@ public:
   void SendControlMsgFromDelegate(int ctrlTag, int msgTag, int dataSize, const void* pData) override
   {
     WDL_String str;
+
+    if (mBinaryMessages)
+    {
+      str.SetFormatted(mMaxJSStringLength, "{\"msg\":\"SCMFD\",\"ctrlTag\":%i,\"msgTag\":%i,\"dataSize\":%i}", ctrlTag, msgTag, dataSize);
+
+      if (PostBinaryMessage(pData, dataSize, str.Get()))
+        return;
+    }
+
     std::vector<char> base64;
     base64.resize(GetBase64Length(dataSize));
     wdl_base64encode(reinterpret_cast<const unsigned char*>(pData), base64.data(), dataSize);
+
+    if (mBatchMessages)
+    {
+      mPendingMsgs.AppendFormatted(mMaxJSStringLength, "[\"SCMFD\",%i,%i,%i,\"%s\"],", ctrlTag, msgTag, dataSize, base64.data());
+      StartBatchTimer();
+      return;
+    }
+
     str.SetFormatted(mMaxJSStringLength, "SCMFD(%i, %i, %i, '%s')", ctrlTag, msgTag, dataSize, base64.data());
     EvaluateJavaScript(str.Get());
   }
 
   void SendParameterValueFromDelegate(int paramIdx, double value, bool normalized) override
   {
+    if (mBatchMessages)
+    {
+      mPendingParamValues[paramIdx] = value;
+      StartBatchTimer();
+      return;
+    }
+
     WDL_String str;
     str.SetFormatted(mMaxJSStringLength, "SPVFD(%i, %f)", paramIdx, value);
     EvaluateJavaScript(str.Get());
   }
 
+  void SendParameterValuesFromDelegate(const ParamTuple* pParams, int nParams, bool normalized) override
+  {
+    if (mBatchMessages)
+    {
+      for (int i = 0; i < nParams; i++)
+        mPendingParamValues[pParams[i].idx] = pParams[i].value;
+
+      StartBatchTimer();
+      return;
+    }
+
+    // one script for all of them, rather than a round trip to the web view per parameter
+    WDL_String str;
+
+    for (int i = 0; i < nParams; i++)
+      str.AppendFormatted(mMaxJSStringLength, "SPVFD(%i, %f);", pParams[i].idx, pParams[i].value);
+
+    if (str.GetLength())
+      EvaluateJavaScript(str.Get());
+  }
+
   void SendArbitraryMsgFromDelegate(int msgTag, int dataSize, const void* pData) override
   {
     WDL_String str;
+
+    if (mBinaryMessages)
+    {
+      str.SetFormatted(mMaxJSStringLength, "{\"msg\":\"SAMFD\",\"msgTag\":%i,\"dataSize\":%i}", msgTag, dataSize);
+
+      if (PostBinaryMessage(pData, dataSize, str.Get()))
+        return;
+    }
+
     std::vector<char> base64;
     base64.resize(GetBase64Length(dataSize));
     wdl_base64encode(reinterpret_cast<const unsigned char*>(pData), base64.data(), dataSize);
+
+    if (mBatchMessages)
+    {
+      mPendingMsgs.AppendFormatted(mMaxJSStringLength, "[\"SAMFD\",%i,%i,\"%s\"],", msgTag, dataSize, base64.data());
+      StartBatchTimer();
+      return;
+    }
+
     str.SetFormatted(mMaxJSStringLength, "SAMFD(%i, %i, %s)", msgTag, dataSize, base64.data());
     EvaluateJavaScript(str.Get());
   }
@@ -129,14 +210,73 @@ public:
   {
     mMaxJSStringLength = length;
   }
+
+  /** Collect parameter values, control values and messages, and send them to the page once per interval as a single IPlugBatchFD([[func, args...], ...]) call, rather than
+   * a script evaluation each. Only the latest value of each parameter or control is sent, and values are sent before messages. The page must define IPlugBatchFD(), see the IPlugWebUI example
+   * @param enable \c true to batch messages
+   * @param intervalMs How often to send the batch, which should be about the display refresh interval */
+  void EnableMessageBatching(bool enable, int intervalMs = 16)
+  {
+    if (!enable)
+      FlushMessageBatch();
+
+    mBatchMessages = enable;
+    mBatchIntervalMs = intervalMs;
+  }
+
+  /** Send any batched messages now, see EnableMessageBatching() */
+  void FlushMessageBatch()
+  {
+    if (mPendingParamValues.empty() && mPendingControlValues.empty() && !mPendingMsgs.GetLength())
+      return;
+
+    WDL_String str("IPlugBatchFD([");
+
+    for (const auto& value : mPendingParamValues)
+      str.AppendFormatted(mMaxJSStringLength, "[\"SPVFD\",%i,%f],", value.first, value.second);
+
+    for (const auto& value : mPendingControlValues)
+      str.AppendFormatted(mMaxJSStringLength, "[\"SCVFD\",%i,%f],", value.first, value.second);
+
+    str.Append(mPendingMsgs.Get());
+    str.SetLen(str.GetLength() - 1); // the trailing comma
+    str.Append("])");
+
+    mPendingParamValues.clear();
+    mPendingControlValues.clear();
+    mPendingMsgs.Set("");
+
+    EvaluateJavaScript(str.Get());
+  }
+
+  /** Send control and arbitrary messages to the page as ArrayBuffers where the platform supports it, see IWebView::PostBinaryMessage().
+   * The page must then define SBMFD(info, arrayBuffer), where info.msg is "SCMFD" or "SAMFD". Where it isn't supported the messages are base64 encoded as usual
+   * @param enable \c true to use binary messages */
+  void EnableBinaryMessages(bool enable)
+  {
+    mBinaryMessages = enable;
+  }
   
 protected:
   int GetBase64Length(int dataSize)
   {
     return static_cast<int>(4. * std::ceil((static_cast<double>(dataSize) / 3.)));
   }
+
+  void StartBatchTimer()
+  {
+    if (!mBatchTimer)
+      mBatchTimer = std::unique_ptr<Timer>(Timer::Create([this](Timer&) { FlushMessageBatch(); }, mBatchIntervalMs));
+  }
   
   int mMaxJSStringLength = kDefaultMaxJSStringLength;
+  bool mBinaryMessages = false;
+  bool mBatchMessages = false;
+  int mBatchIntervalMs = 16;
+  std::map<int, double> mPendingParamValues;
+  std::map<int, double> mPendingControlValues;
+  WDL_String mPendingMsgs;
+  std::unique_ptr<Timer> mBatchTimer;
   std::function<void()> mEditorInitFunc = nullptr;
   void* mHelperView = nullptr;
 };
@@ -13,6 +13,7 @@
 #endif
 
 #include "IPlugWebViewEditorDelegate.h"
+#include "IPlugStartupTimer.h"
 
 #ifdef OS_IOS
 #import <UIKit/UIKit.h>
@@ -75,6 +76,7 @@ WebViewEditorDelegate::~WebViewEditorDelegate()
 
 void* WebViewEditorDelegate::OpenWindow(void* pParent)
 {
+  ENTER_STARTUP_TIMING_SCOPE(kEditorOpen)
   PLATFORM_VIEW* pParentView = (PLATFORM_VIEW*) pParent;
     
   HELPER_VIEW* pHelperView = [[HELPER_VIEW alloc] initWithEditorDelegate: this];
@@ -83,10 +85,8 @@ void* WebViewEditorDelegate::OpenWindow(void* pParent)
   if(pParentView) {
     [pParentView addSubview: pHelperView];
   }
-  
-  if(mEditorInitFunc)
-    mEditorInitFunc();
 
+  // mEditorInitFunc is called by OnWebViewReady() when the web view is made, and not again for a web view kept loaded
   return mHelperView;
 }
 
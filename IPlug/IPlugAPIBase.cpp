@@ -13,15 +13,28 @@
  * @brief IPlugAPIBase implementation
  */
 
+#include <algorithm>
+#include <chrono>
 #include <cmath>
 #include <cstdio>
 #include <ctime>
 #include <cassert>
 
 #include "IPlugAPIBase.h"
+#include "IPlugProcessor.h"
 
 using namespace iplug;
 
+// the number of queued items moved from the processor queues per PopBatch() call in OnTimer()
+static constexpr int kTimerBatchSize = 32;
+
+#ifdef IPLUG_SHARED_IDLE_TIMER
+// one timer for every instance in the process, which lives while there are instances
+static WDL_Mutex sSharedTimerMutex;
+static WDL_PtrList<IPlugAPIBase> sSharedTimerInstances;
+static std::unique_ptr<Timer> sSharedTimer;
+#endif
+
 IPlugAPIBase::IPlugAPIBase(Config c, EAPI plugAPI)
   : IPluginBase(c.nParams, c.nPresets)
 {
@@ -29,6 +42,7 @@ IPlugAPIBase::IPlugAPIBase(Config c, EAPI plugAPI)
   mMfrID = c.mfrID;
   mVersion = c.vendorVersion;
   mPluginName.Set(c.pluginName, MAX_PLUGIN_NAME_LEN);
+  mMemoryStats.SetName(c.pluginName);
   mProductName.Set(c.productName, MAX_PLUGIN_NAME_LEN);
   mMfrName.Set(c.mfrName, MAX_PLUGIN_NAME_LEN);
   mHasUI = c.plugHasUI;
@@ -51,6 +65,24 @@ IPlugAPIBase::~IPlugAPIBase()
     mTimer->Stop();
   }
 
+#ifdef IPLUG_SHARED_IDLE_TIMER
+  {
+    WDL_MutexLock lock(&sSharedTimerMutex);
+    const int idx = sSharedTimerInstances.Find(this);
+
+    if (idx >= 0)
+    {
+      sSharedTimerInstances.Delete(idx);
+
+      if (!sSharedTimerInstances.GetSize() && sSharedTimer)
+      {
+        sSharedTimer->Stop();
+        sSharedTimer = nullptr;
+      }
+    }
+  }
+#endif
+
   TRACE
 }
 
@@ -65,7 +97,53 @@ void IPlugAPIBase::OnHostRequestingImportantParameters(int count, WDL_TypedBuf<i
 
 void IPlugAPIBase::CreateTimer()
 {
+#ifdef IPLUG_SHARED_IDLE_TIMER
+  WDL_MutexLock lock(&sSharedTimerMutex);
+
+  if (sSharedTimerInstances.Find(this) < 0)
+    sSharedTimerInstances.Add(this);
+
+  if (!sSharedTimer)
+    sSharedTimer = std::unique_ptr<Timer>(Timer::Create(&IPlugAPIBase::OnSharedTimer, IDLE_TIMER_RATE));
+#else
   mTimer = std::unique_ptr<Timer>(Timer::Create(std::bind(&IPlugAPIBase::OnTimer, this, std::placeholders::_1), IDLE_TIMER_RATE));
+#endif
+}
+
+#ifdef IPLUG_SHARED_IDLE_TIMER
+void IPlugAPIBase::OnSharedTimer(Timer& t)
+{
+  // the mutex is recursive, so an instance can be created or destroyed by another one's OnIdle()
+  WDL_MutexLock lock(&sSharedTimerMutex);
+
+  for (int i = 0; i < sSharedTimerInstances.GetSize(); i++)
+    sSharedTimerInstances.Get(i)->OnTimer(t);
+}
+#endif
+
+bool IPlugAPIBase::IdleTimerShouldRun()
+{
+#if IDLE_TIMER_MAX_BACKOFF > 1
+  const bool busy = mIdleWake.exchange(false, std::memory_order_acquire)
+                 || mParamChangeFromProcessor.ElementsAvailable()
+                 || mMidiMsgsFromProcessor.ElementsAvailable()
+                 || mSysExDataFromProcessor.ElementsAvailable();
+
+  if (busy)
+  {
+    mIdleInterval = 1;
+    mIdleCountdown = 0;
+    return true;
+  }
+
+  if (--mIdleCountdown > 0)
+    return false;
+
+  // nothing happened since the last run, so wait twice as long for the next one
+  mIdleInterval = std::min(mIdleInterval * 2, IDLE_TIMER_MAX_BACKOFF);
+  mIdleCountdown = mIdleInterval;
+#endif
+  return true;
 }
 
 bool IPlugAPIBase::CompareState(const uint8_t* pIncomingState, int startPos) const
@@ -112,14 +190,126 @@ void IPlugAPIBase::SetHost(const char* host, int version)
   OnHostIdentified();
 }
 
+static double HostParamChangeTimeMs()
+{
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
 void IPlugAPIBase::SetParameterValue(int idx, double normalizedValue)
 {
   Trace(TRACELOC, "%d:%f", idx, normalizedValue);
   GetParam(idx)->SetNormalized(normalizedValue);
-  InformHostOfParamChange(idx, normalizedValue);
+
+  if (mHostParamChangeIntervalMs > 0 && idx < mParamGestureDepth.GetSize() && mParamGestureDepth.Get()[idx] > 0)
+  {
+    const double now = HostParamChangeTimeMs();
+    double& lastTime = mHostParamChangeTimes.Get()[idx];
+
+    if (now - lastTime >= mHostParamChangeIntervalMs)
+    {
+      FlushHostParamChange(idx); // drops a pending value, this one is newer
+      InformHostOfParamChange(idx, normalizedValue);
+      lastTime = now;
+    }
+    else
+    {
+      // the latest value is sent by the idle timer once the interval has passed, or at the end of the gesture
+      if (mHostParamChangesPending.Find(idx) < 0)
+        mHostParamChangesPending.Add(idx);
+
+      mHostParamChangeValues.Get()[idx] = normalizedValue;
+      WakeIdleTimer();
+    }
+  }
+  else
+    InformHostOfParamChange(idx, normalizedValue);
+
   OnParamChange(idx, kUI);
 }
 
+void IPlugAPIBase::BeginInformHostOfParamChangeFromUI(int paramIdx)
+{
+  if (mParamGestureDepth.GetSize() != NParams())
+  {
+    mParamGestureDepth.Resize(NParams());
+    mHostParamChangeTimes.Resize(NParams());
+    mHostParamChangeValues.Resize(NParams());
+    std::fill_n(mParamGestureDepth.Get(), NParams(), 0);
+    std::fill_n(mHostParamChangeTimes.Get(), NParams(), -1e9);
+  }
+
+  if (paramIdx >= 0 && paramIdx < NParams())
+  {
+    mParamGestureDepth.Get()[paramIdx]++;
+    mHostParamChangeTimes.Get()[paramIdx] = -1e9; // so the first value of the gesture goes straight to the host
+  }
+
+  BeginInformHostOfParamChange(paramIdx);
+}
+
+void IPlugAPIBase::EndInformHostOfParamChangeFromUI(int paramIdx)
+{
+  if (paramIdx >= 0 && paramIdx < mParamGestureDepth.GetSize())
+  {
+    int& depth = mParamGestureDepth.Get()[paramIdx];
+    depth = std::max(depth - 1, 0);
+
+    // the host gets the final value inside the gesture
+    FlushHostParamChange(paramIdx);
+  }
+
+  EndInformHostOfParamChange(paramIdx);
+}
+
+void IPlugAPIBase::FlushHostParamChange(int paramIdx)
+{
+  const int pos = mHostParamChangesPending.Find(paramIdx);
+
+  if (pos < 0)
+    return;
+
+  mHostParamChangesPending.Delete(pos);
+  InformHostOfParamChange(paramIdx, mHostParamChangeValues.Get()[paramIdx]);
+  mHostParamChangeTimes.Get()[paramIdx] = HostParamChangeTimeMs();
+}
+
+void IPlugAPIBase::FlushHostParamChanges(bool force)
+{
+  if (!mHostParamChangesPending.GetSize())
+    return;
+
+  const double now = HostParamChangeTimeMs();
+
+  for (int i = mHostParamChangesPending.GetSize() - 1; i >= 0; i--)
+  {
+    const int idx = mHostParamChangesPending.Get()[i];
+
+    if (force || now - mHostParamChangeTimes.Get()[idx] >= mHostParamChangeIntervalMs)
+      FlushHostParamChange(idx);
+  }
+
+  // the rest are sent by a later tick
+  if (mHostParamChangesPending.GetSize())
+    WakeIdleTimer();
+}
+
+void IPlugAPIBase::FlushOutputParams()
+{
+  const double now = HostParamChangeTimeMs();
+
+  if (now - mOutputParamFlushTime < mOutputParamIntervalMs)
+    return;
+
+  mOutputParamFlushTime = now;
+
+  ForEachChangedOutputParam(mOutputParamValues, [&](int paramIdx, double normalizedValue) {
+    InformHostOfOutputParamChange(paramIdx, normalizedValue);
+
+    if (HasUI())
+      SendParameterValueFromDelegate(paramIdx, normalizedValue, true);
+  });
+}
+
 void IPlugAPIBase::DirtyParametersFromUI()
 {
   for (int p = 0; p < NParams(); p++)
@@ -131,6 +321,12 @@ void IPlugAPIBase::DirtyParametersFromUI()
 
 void IPlugAPIBase::SendParameterValueFromAPI(int paramIdx, double value, bool normalized)
 {
+#ifdef IPLUG_DEADLINE_MONITOR
+  // the API classes that don't schedule parameter changes all report them here, count them alongside the block they arrived with
+  if (auto* pProcessor = dynamic_cast<IPlugProcessor*>(this))
+    pProcessor->GetDeadlineMonitor()->NoteParamChange();
+#endif
+
   if (normalized)
     value = GetParam(paramIdx)->FromNormalized(value);
   
@@ -139,18 +335,34 @@ void IPlugAPIBase::SendParameterValueFromAPI(int paramIdx, double value, bool no
 
 void IPlugAPIBase::OnTimer(Timer& t)
 {
+  // latency changes from the audio thread are reported to the host here, on the main thread, see IPlugProcessor::ChangeLatency()
+  if (auto* pProcessor = dynamic_cast<IPlugProcessor*>(this))
+    pProcessor->ReportPendingLatency();
+
+  FlushHostParamChanges(false);
+
+#if !defined VST3P_API && !defined VST3_API
+  // VST3 reports output parameters from the audio thread, through the host, see IPlugVST3ProcessorBase::ProcessOutputParameterChanges()
+  FlushOutputParams();
+#endif
+
+  if (!IdleTimerShouldRun())
+    return;
+
   if(HasUI())
   {
 // VST3 ********************************************************************************
 #if defined VST3P_API || defined VST3_API
-    while (mMidiMsgsFromProcessor.ElementsAvailable())
+    IMidiMsg msgs[kTimerBatchSize];
+    int nMsgs;
+    
+    while ((nMsgs = mMidiMsgsFromProcessor.PopBatch(msgs, kTimerBatchSize)) > 0)
     {
-      IMidiMsg msg;
-      mMidiMsgsFromProcessor.Pop(msg);
 #ifdef VST3P_API // distributed
-      TransmitMidiMsgFromProcessor(msg);
+      for (int i = 0; i < nMsgs; i++)
+        TransmitMidiMsgFromProcessor(msgs[i]);
 #else
-      SendMidiMsgFromDelegate(msg);
+      SendMidiMsgsFromDelegate(msgs, nMsgs);
 #endif
     }
 
@@ -166,20 +378,52 @@ void IPlugAPIBase::OnTimer(Timer& t)
     }
 // !VST3 ******************************************************************************
 #else
-    while(mParamChangeFromProcessor.ElementsAvailable())
+    ParamTuple params[kTimerBatchSize];
+    int nParams;
+    
+    // coalesce the changes, so that the editor only gets the latest value of each parameter, once per tick
+    if (mParamChangeSlots.GetSize() != NParams())
     {
-      ParamTuple p;
-      mParamChangeFromProcessor.Pop(p);
-      SendParameterValueFromDelegate(p.idx, p.value, false);
+      mParamChangeSlots.Resize(NParams());
+      std::fill_n(mParamChangeSlots.Get(), NParams(), -1);
+      mParamChangesForUI.Resize(NParams());
     }
     
-    while (mMidiMsgsFromProcessor.ElementsAvailable())
+    int* pSlots = mParamChangeSlots.Get();
+    ParamTuple* pChanges = mParamChangesForUI.Get();
+    int nChanges = 0;
+    
+    while ((nParams = mParamChangeFromProcessor.PopBatch(params, kTimerBatchSize)) > 0)
     {
-      IMidiMsg msg;
-      mMidiMsgsFromProcessor.Pop(msg);
-      SendMidiMsgFromDelegate(msg);
+      for (int i = 0; i < nParams; i++)
+      {
+        const int idx = params[i].idx;
+        
+        if (idx < 0 || idx >= NParams())
+          continue;
+        
+        if (pSlots[idx] < 0)
+        {
+          pSlots[idx] = nChanges;
+          pChanges[nChanges++] = params[i];
+        }
+        else
+          pChanges[pSlots[idx]].value = params[i].value;
+      }
     }
     
+    for (int i = 0; i < nChanges; i++)
+      pSlots[pChanges[i].idx] = -1;
+    
+    if (nChanges)
+      SendParameterValuesFromDelegate(pChanges, nChanges, false);
+    
+    IMidiMsg msgs[kTimerBatchSize];
+    int nMsgs;
+    
+    while ((nMsgs = mMidiMsgsFromProcessor.PopBatch(msgs, kTimerBatchSize)) > 0)
+      SendMidiMsgsFromDelegate(msgs, nMsgs);
+    
     while (mSysExDataFromProcessor.ElementsAvailable())
     {
       SysExData msg;
@@ -210,3 +454,12 @@ void IPlugAPIBase::SendArbitraryMsgFromUI(int msgTag, int ctrlTag, int dataSize,
   
   EDITOR_DELEGATE_CLASS::SendArbitraryMsgFromUI(msgTag, ctrlTag, dataSize, pData);
 }
+
+bool IPlugAPIBase::SendArbitraryMsgToDSPFromUI(int msgTag, int ctrlTag, int dataSize, const void* pData)
+{
+  // the processor is only in this object for non distributed plug-ins
+  if (auto* pProcessor = dynamic_cast<IPlugProcessor*>(this))
+    return pProcessor->QueueMessageFromEditor(msgTag, ctrlTag, dataSize, pData);
+
+  return false;
+}
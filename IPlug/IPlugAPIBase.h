@@ -10,6 +10,7 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cstring>
 #include <cstdint>
 #include <memory>
@@ -116,6 +117,27 @@ public:
    * @param paramIdx The index of the parameter that changed
    * @param normalizedValue The new (normalised) value */
   void SetParameterValue(int paramIdx, double normalizedValue);
+
+  /** Limit how often the host is told about the value of a parameter during a gesture from the UI, since a drag can move a control hundreds of times a second, and some hosts
+   * handle each notification (VST3 performEdit(), AU parameter events) slowly. The parameter and OnParamChange() still get every value straight away, the host gets the latest
+   * value at most once per interval, from the UI thread or the idle timer, and the final value is always sent before EndInformHostOfParamChange().
+   * Values set outside a gesture are sent straight away. NOTE: in distributed plug-ins (VST3 with a separate controller) the host notification is how the processor gets the value, so it is throttled too
+   * @param intervalMs The shortest time between notifications for a parameter, e.g. 16 for about the display rate, or 0 to send every value */
+  void SetHostParamChangeInterval(int intervalMs) { mHostParamChangeIntervalMs = intervalMs; }
+
+  /** Set the value of an output parameter, one with IParam::kFlagOutput such as a meter, typically from ProcessBlock(). This only stores the value, so it is cheap enough to call every block.
+   * The host and the UI are told about output parameters whose value has changed at most once per SetOutputParamInterval(): VST3 writes them to the block's outputParameterChanges,
+   * and the other APIs tell the host and the UI from the main thread, e.g. AU listeners get a parameter value change event
+   * @param paramIdx The index of the output parameter
+   * @param value The new (non-normalised) value */
+  void SetOutputParamValue(int paramIdx, double value) { GetParam(paramIdx)->Set(value); }
+
+  /** Set how often the host and the UI are told about changed output parameters, see SetOutputParamValue()
+   * @param intervalMs The shortest time between reports, e.g. 33 for 30 updates a second. Reports from the main thread are also limited by the timer rate */
+  void SetOutputParamInterval(int intervalMs) { mOutputParamIntervalMs = std::max(intervalMs, 1); }
+
+  /** @return The shortest time between reports of changed output parameters in milliseconds, see SetOutputParamInterval() */
+  int GetOutputParamInterval() const { return mOutputParamIntervalMs; }
   
   /** Get the color of the track that the plug-in is inserted on */
   virtual void GetTrackColor(int& r, int& g, int& b) { r = 0; g = 0; b = 0; }
@@ -155,9 +177,9 @@ public:
   virtual void HostSpecificInit() {}
 
   //IEditorDelegate
-  void BeginInformHostOfParamChangeFromUI(int paramIdx) override { BeginInformHostOfParamChange(paramIdx); }
+  void BeginInformHostOfParamChangeFromUI(int paramIdx) override;
   
-  void EndInformHostOfParamChangeFromUI(int paramIdx) override { EndInformHostOfParamChange(paramIdx); }
+  void EndInformHostOfParamChangeFromUI(int paramIdx) override;
   
   bool EditorResizeFromUI(int viewWidth, int viewHeight, bool needsPlatformResize) override;
   
@@ -173,6 +195,8 @@ public:
   void SendSysexMsgFromUI(const ISysEx& msg) override;
   
   void SendArbitraryMsgFromUI(int msgTag, int ctrlTag = kNoTag, int dataSize = 0, const void* pData = nullptr) override;
+
+  bool SendArbitraryMsgToDSPFromUI(int msgTag, int ctrlTag = kNoTag, int dataSize = 0, const void* pData = nullptr) override;
   
   void DeferMidiMsg(const IMidiMsg& msg) override { mMidiMsgsFromEditor.Push(msg); }
   
@@ -182,8 +206,45 @@ public:
     mSysExDataFromEditor.Push(data);
   }
 
-  /** Called by the API class to create the timer that pumps the parameter/message queues */
+  /** Called by the API class to create the timer that pumps the parameter/message queues.
+   * If IPLUG_SHARED_IDLE_TIMER is defined, all the instances in the process share one timer instead of having one each */
   void CreateTimer();
+
+  /** Called by the API class to find the output parameters whose value has changed since it last reported them, see SetOutputParamValue().
+   * Only the thread that reports the values should call this. Size sentValues with NParams() before calling it on the audio thread, since otherwise the first call resizes it
+   * @param sentValues The normalised value last reported for each parameter, which is updated
+   * @param func Called as func(paramIdx, normalizedValue) for each output parameter whose value has changed */
+  template <class F>
+  void ForEachChangedOutputParam(WDL_TypedBuf<double>& sentValues, F func)
+  {
+    if (sentValues.GetSize() != NParams())
+    {
+      sentValues.Resize(NParams());
+      std::fill_n(sentValues.Get(), NParams(), -1.); // never a normalised value, so that the first report includes every output parameter
+    }
+
+    double* pSent = sentValues.Get();
+
+    for (int i = 0; i < NParams(); i++)
+    {
+      const IParam* pParam = GetParam(i);
+
+      if (!pParam->GetIsOutput())
+        continue;
+
+      const double value = pParam->GetNormalized();
+
+      if (value != pSent[i])
+      {
+        pSent[i] = value;
+        func(i, value);
+      }
+    }
+  }
+
+  /** Call this from any thread, for instance the audio thread after queuing data for the editor, to make the next timer tick call OnIdle() if it has backed off.
+   * Only needed for data the timer doesn't know about, since it checks its own queues, see IDLE_TIMER_MAX_BACKOFF */
+  void WakeIdleTimer() { mIdleWake.store(true, std::memory_order_release); }
   
 private:
   /** Implementations call into the APIs resize hooks
@@ -202,6 +263,11 @@ private:
    * @param paramIdx The parameter that is being changed
    * @param normalizedValue The new normalised value of the parameter being changed */
   virtual void InformHostOfParamChange(int paramIdx, double normalizedValue) {}
+
+  /** Implemented by API classes that tell the host about output parameters from the main thread, called at most once per SetOutputParamInterval() for each output parameter whose value has changed
+   * @param paramIdx The output parameter that changed
+   * @param normalizedValue The new normalised value of the parameter */
+  virtual void InformHostOfOutputParamChange(int paramIdx, double normalizedValue) {}
   
   //DISTRIBUTED ONLY (Currently only VST3)
   /** \todo */
@@ -212,6 +278,22 @@ private:
 
   void OnTimer(Timer& t);
 
+  /** @return \c true if this tick should pump the queues and call OnIdle(), rather than being skipped while backed off */
+  bool IdleTimerShouldRun();
+
+  /** Tell the host about throttled gesture values whose interval has passed, or all of them if force is \c true, see SetHostParamChangeInterval() */
+  void FlushHostParamChanges(bool force);
+
+  /** Tell the host about one throttled value, if it has one, and remove it from mHostParamChangesPending */
+  void FlushHostParamChange(int paramIdx);
+
+  /** Tell the host and the UI about output parameters whose value has changed, if the output parameter interval has passed, see SetOutputParamValue() */
+  void FlushOutputParams();
+
+#ifdef IPLUG_SHARED_IDLE_TIMER
+  static void OnSharedTimer(Timer& t);
+#endif
+
   friend class IPlugAPP;
   friend class IPlugAAX;
   friend class IPlugVST2;
@@ -222,17 +304,33 @@ private:
   friend class IPlugAUv3;
   friend class IPlugWEB;
   friend class IPlugWAM;
+  friend class IPlugCLAP;
 
 private:
   WDL_String mParamDisplayStr;
   std::unique_ptr<Timer> mTimer;
+  std::atomic<bool> mIdleWake {true};
+  int mIdleInterval = 1; // the number of ticks between runs while backed off
+  int mIdleCountdown = 0;
   
   IPlugQueue<ParamTuple> mParamChangeFromProcessor {PARAM_TRANSFER_SIZE};
+  WDL_TypedBuf<ParamTuple> mParamChangesForUI; // the latest value of each parameter that changed since the last OnTimer()
+  WDL_TypedBuf<int> mParamChangeSlots; // the index in mParamChangesForUI of each parameter, or -1
   IPlugQueue<IMidiMsg> mMidiMsgsFromEditor {MIDI_TRANSFER_SIZE}; // a queue of midi messages generated in the editor by clicking keyboard UI etc
   IPlugQueue<IMidiMsg> mMidiMsgsFromProcessor {MIDI_TRANSFER_SIZE}; // a queue of MIDI messages received (potentially on the high priority thread), by the processor to send to the editor
   IPlugQueue<SysExData> mSysExDataFromEditor {SYSEX_TRANSFER_SIZE}; // a queue of SYSEX data to send to the processor
   IPlugQueue<SysExData> mSysExDataFromProcessor {SYSEX_TRANSFER_SIZE}; // a queue of SYSEX data to send to the editor
   SysExData mSysexBuf;
+
+  int mHostParamChangeIntervalMs = 0;
+  WDL_TypedBuf<int> mParamGestureDepth; // the number of gestures from the UI each parameter is in
+  WDL_TypedBuf<double> mHostParamChangeTimes; // when the host was last told about each parameter during a gesture, in ms
+  WDL_TypedBuf<double> mHostParamChangeValues; // the normalised value the host is owed for each parameter in mHostParamChangesPending
+  WDL_TypedBuf<int> mHostParamChangesPending; // the parameters whose latest value the host hasn't been told about yet
+
+  int mOutputParamIntervalMs = 33;
+  double mOutputParamFlushTime = 0.; // when FlushOutputParams() last reported the output parameters, in ms
+  WDL_TypedBuf<double> mOutputParamValues; // the normalised value of each output parameter last reported from the main thread
 };
 
 END_IPLUG_NAMESPACE
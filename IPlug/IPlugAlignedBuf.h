@@ -0,0 +1,136 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc IAlignedBuf
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <type_traits>
+
+#include "IPlugPlatform.h"
+
+/** The alignment in bytes of IPlug's audio buffers. 64 is a cache line, and suits AVX-512. Define it as 16 or 32 to save a little memory */
+#ifndef IPLUG_BUFFER_ALIGNMENT
+#define IPLUG_BUFFER_ALIGNMENT 64
+#endif
+
+BEGIN_IPLUG_NAMESPACE
+
+/** A resizable buffer of trivially copyable elements, like WDL_TypedBuf, whose data is always ALIGN byte aligned, so that aligned SIMD loads and stores can be used on it.
+ * Resizing keeps the contents, up to the smaller of the two sizes, at the same alignment, which a WDL_TypedBuf's GetAligned() pointer wouldn't survive */
+template <class T, int ALIGN = IPLUG_BUFFER_ALIGNMENT>
+class IAlignedBuf
+{
+public:
+  static_assert(ALIGN > 0 && (ALIGN & (ALIGN - 1)) == 0, "the alignment must be a power of two");
+  static_assert(ALIGN >= static_cast<int>(alignof(T)), "the alignment must be at least that of the element type");
+  static_assert(std::is_trivially_copyable<T>::value, "IAlignedBuf copies its elements with memcpy");
+
+  static constexpr int kAlignment = ALIGN;
+
+  IAlignedBuf() = default;
+
+  ~IAlignedBuf()
+  {
+    free(mRaw);
+  }
+
+  IAlignedBuf(const IAlignedBuf&) = delete;
+  IAlignedBuf& operator=(const IAlignedBuf&) = delete;
+
+  IAlignedBuf(IAlignedBuf&& other) noexcept
+  {
+    Swap(other);
+  }
+
+  IAlignedBuf& operator=(IAlignedBuf&& other) noexcept
+  {
+    Swap(other);
+    return *this;
+  }
+
+  /** @return The ALIGN byte aligned data, or nullptr if the buffer is empty */
+  T* Get() const { return mData; }
+
+  /** @return The number of elements */
+  int GetSize() const { return mSize; }
+
+  /** Change the number of elements. This allocates unless the buffer is shrinking with resizeDown \c false, so don't call it on the audio thread
+   * @param n The new number of elements. The contents are kept up to the smaller of the old and new sizes, and new elements are uninitialised
+   * @param resizeDown \c false to keep the memory when shrinking, so that growing back up to the old size doesn't allocate
+   * @return The data, which is unchanged if the allocation failed */
+  T* Resize(int n, bool resizeDown = true)
+  {
+    n = std::max(n, 0);
+
+    if (n > mCapacity || (resizeDown && n < mCapacity))
+    {
+      if (n == 0)
+      {
+        free(mRaw);
+        mRaw = nullptr;
+        mData = nullptr;
+        mCapacity = 0;
+      }
+      else
+      {
+        void* pRaw = malloc(static_cast<size_t>(n) * sizeof(T) + ALIGN - 1);
+
+        if (!pRaw)
+          return mData;
+
+        T* pData = reinterpret_cast<T*>((reinterpret_cast<uintptr_t>(pRaw) + ALIGN - 1) & ~static_cast<uintptr_t>(ALIGN - 1));
+
+        if (mData)
+          memcpy(pData, mData, static_cast<size_t>(std::min(n, mSize)) * sizeof(T));
+
+        free(mRaw);
+        mRaw = pRaw;
+        mData = pData;
+        mCapacity = n;
+      }
+    }
+
+    mSize = n;
+    return mData;
+  }
+
+  /** @param n A number of elements
+   * @return n rounded up to a whole number of ALIGN bytes, so that buffers laid out end to end at that stride all stay aligned */
+  static int PaddedSize(int n)
+  {
+    static_assert(ALIGN % sizeof(T) == 0, "the elements must tile the alignment");
+    constexpr int perAlign = ALIGN / static_cast<int>(sizeof(T));
+    return (n + perAlign - 1) & ~(perAlign - 1);
+  }
+
+private:
+  void Swap(IAlignedBuf& other)
+  {
+    std::swap(mRaw, other.mRaw);
+    std::swap(mData, other.mData);
+    std::swap(mSize, other.mSize);
+    std::swap(mCapacity, other.mCapacity);
+  }
+
+  void* mRaw = nullptr;
+  T* mData = nullptr;
+  int mSize = 0;
+  int mCapacity = 0;
+};
+
+END_IPLUG_NAMESPACE
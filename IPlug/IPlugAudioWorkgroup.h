@@ -0,0 +1,117 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc IAudioWorkgroup
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+#include "IPlugPlatform.h"
+
+#if (defined OS_MAC || defined OS_IOS) && defined __has_include
+  #if __has_include(<os/workgroup.h>)
+    #include <os/workgroup.h>
+    #include <pthread/qos.h>
+    #define IPLUG_AUDIO_WORKGROUP 1
+  #endif
+#endif
+
+BEGIN_IPLUG_NAMESPACE
+
+/** IAudioWorkgroup holds the host's audio workgroup (an os_workgroup_t, macOS 11 and iOS 14 or later), which the plug-in's own realtime worker threads should join,
+ * so that the OS schedules them, e.g. on Apple Silicon's performance cores, to meet the same deadline as the host's render thread.
+ * The API class sets it when the host tells the plug-in its render context, which AUv2 and AUv3 do. Elsewhere, and on other platforms, there is no workgroup,
+ * and threads that "join" it are only promoted to the user interactive quality of service on Apple platforms, which is the best a plug-in can do without one.
+ *
+ * Worker threads keep an IAudioWorkgroup::Membership and call Update() each time they wake for a block, which joins the workgroup, or moves to a new one if the host has changed it.
+ * The workgroup is retained and released in IPlugProcessor.cpp, which is compiled as C++, since in Objective-C files with ARC os_workgroup_t is a managed object */
+class IAudioWorkgroup
+{
+public:
+  /** One thread's membership of a workgroup. It must only be used by the thread that owns it, and leaves the workgroup when it is destroyed */
+  class Membership
+  {
+  public:
+    Membership() = default;
+
+    ~Membership()
+    {
+      Leave();
+    }
+
+    Membership(const Membership&) = delete;
+    Membership& operator=(const Membership&) = delete;
+
+    /** Join the workgroup on the calling thread, if this thread isn't a member of it already. This only takes a lock when the workgroup has changed since the last call,
+     * so it can be called at the start of every block
+     * @param pWorkgroup The workgroup to join, or nullptr to leave the current one */
+    void Update(IAudioWorkgroup* pWorkgroup)
+    {
+      const uint32_t generation = pWorkgroup ? pWorkgroup->mGeneration.load(std::memory_order_acquire) : 0;
+
+      if (pWorkgroup != mWorkgroup || generation != mGeneration)
+        Join(pWorkgroup, generation);
+    }
+
+    /** Leave the workgroup the calling thread joined, if any */
+    void Leave();
+
+    /** @return \c true if the thread is a member of the host's workgroup */
+    bool IsJoined() const { return mJoined != nullptr; }
+
+  private:
+    void Join(IAudioWorkgroup* pWorkgroup, uint32_t generation);
+
+    IAudioWorkgroup* mWorkgroup = nullptr;
+    uint32_t mGeneration = 0;
+    void* mJoined = nullptr;
+#if IPLUG_AUDIO_WORKGROUP
+    bool mPromoted = false;
+    os_workgroup_join_token_s mToken {};
+#endif
+  };
+
+  IAudioWorkgroup() = default;
+
+  ~IAudioWorkgroup()
+  {
+    SetOSWorkgroup(nullptr);
+  }
+
+  IAudioWorkgroup(const IAudioWorkgroup&) = delete;
+  IAudioWorkgroup& operator=(const IAudioWorkgroup&) = delete;
+
+  /** Called by the API class when the host's workgroup changes, on whichever thread the host tells it on. The workgroup is retained until it is replaced
+   * @param pOSWorkgroup The os_workgroup_t, or nullptr if the host has none */
+  void SetOSWorkgroup(void* pOSWorkgroup);
+
+  /** @return \c true if the host has given the plug-in a workgroup */
+  bool HasOSWorkgroup() const
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mOSWorkgroup != nullptr;
+  }
+
+  /** @return The number of threads the host suggests should work in parallel in the workgroup, including its own render thread, or 0 if it doesn't say */
+  int GetMaxParallelThreads() const;
+
+private:
+  mutable std::mutex mMutex;
+  void* mOSWorkgroup = nullptr;
+  std::atomic<uint32_t> mGeneration {1};
+};
+
+END_IPLUG_NAMESPACE
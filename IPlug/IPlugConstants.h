@@ -112,6 +112,10 @@ static const int MAX_PARAM_DISPLAY_PRECISION = 6;
 #define IDLE_TIMER_RATE 20 // this controls the frequency of data going from processor to editor (and OnIdle calls)
 #endif
 
+#ifndef IDLE_TIMER_MAX_BACKOFF
+#define IDLE_TIMER_MAX_BACKOFF 1 // if > 1, an instance with nothing queued for the editor runs its idle tick (and OnIdle) less often, down to once every this many ticks
+#endif
+
 #ifndef MAX_SYSEX_SIZE
 #define MAX_SYSEX_SIZE 512
 #endif
@@ -120,9 +124,14 @@ static const int MAX_PARAM_DISPLAY_PRECISION = 6;
 #define MIDI_TRANSFER_SIZE 32
 #define SYSEX_TRANSFER_SIZE 4
 
+#ifndef RT_MESSAGE_TRANSFER_SIZE
+#define RT_MESSAGE_TRANSFER_SIZE 65536 // the bytes allocated for messages from the editor to IPlugProcessor::OnMessageRT(), on the first one sent
+#endif
+
 // All version ints are stored as 0xVVVVRRMM: V = version, R = revision, M = minor revision.
 #define IPLUG_VERSION 0x010000
 #define IPLUG_VERSION_MAGIC 'pfft'
+#define IPLUG_COMPRESSED_STATE_MAGIC 'IPzs'
 
 static const int DEFAULT_BLOCK_SIZE = 1024;
 static const double DEFAULT_TEMPO = 120.0;
@@ -184,7 +193,8 @@ enum EAPI
   kAPIAAX = 4,
   kAPIAPP = 5,
   kAPIWAM = 6,
-  kAPIWEB = 7
+  kAPIWEB = 7,
+  kAPICLAP = 8
 };
 
 /** @enum EHost
@@ -0,0 +1,246 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @brief Instrumentation that measures how much of the block deadline the audio processing takes, see IDeadlineMonitor
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "IPlugPlatform.h"
+#include "IPlugLogger.h"
+#include "IPlugEditorDelegate.h"
+#include "ISender.h"
+#include "wdlstring.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** The timing of one process call, and the events that arrived with it */
+struct IDeadlineBlock
+{
+  /** The number of blocks processed before this one, since the last reset */
+  int64_t mBlockIndex = 0;
+  /** The host's sample position at the start of the block */
+  double mSamplePos = 0.;
+  double mSampleRate = 0.;
+  int mNFrames = 0;
+  /** The time spent processing the block */
+  double mElapsedMs = 0.;
+  /** The time the block lasts for, nFrames / sample rate */
+  double mDeadlineMs = 0.;
+  /** mElapsedMs / mDeadlineMs, above 1 the host will drop out, unless it has more time than a block to spare */
+  double mLoad = 0.;
+  /** The number of MIDI and SysEx messages that arrived since the previous block */
+  int mNMidiMsgs = 0;
+  /** The number of parameter changes from the host since the previous block */
+  int mNParamChanges = 0;
+};
+
+/** A snapshot of the IDeadlineMonitor, which is sent to the UI */
+struct IDeadlineReport
+{
+  /** The histogram bins are kBinWidth of the deadline wide, the last one holds everything above */
+  static constexpr int kNumBins = 21;
+  static constexpr double kBinWidth = 0.1;
+  static constexpr int kNumWorstBlocks = 8;
+
+  std::array<uint32_t, kNumBins> mHistogram {};
+  /** The slowest blocks, relative to their deadlines, the slowest first */
+  std::array<IDeadlineBlock, kNumWorstBlocks> mWorstBlocks {};
+  int mNWorstBlocks = 0;
+  int64_t mNBlocks = 0;
+  /** The number of blocks that took longer than their deadline */
+  int64_t mNOverruns = 0;
+  double mTotalLoad = 0.;
+
+  double GetMeanLoad() const { return mNBlocks ? mTotalLoad / mNBlocks : 0.; }
+
+  /** Write the report as text, one line per histogram bin and worst block */
+  void GetText(WDL_String& str) const
+  {
+    str.SetFormatted(256, "%lld blocks, %lld overruns, mean load %.1f%%\n", (long long) mNBlocks, (long long) mNOverruns, GetMeanLoad() * 100.);
+
+    for (auto bin = 0; bin < kNumBins; bin++)
+    {
+      if (!mHistogram[bin])
+        continue;
+
+      if (bin == kNumBins - 1)
+        str.AppendFormatted(256, ">= %3.0f%%: %u\n", bin * kBinWidth * 100., mHistogram[bin]);
+      else
+        str.AppendFormatted(256, "%3.0f-%3.0f%%: %u\n", bin * kBinWidth * 100., (bin + 1) * kBinWidth * 100., mHistogram[bin]);
+    }
+
+    for (auto i = 0; i < mNWorstBlocks; i++)
+    {
+      const IDeadlineBlock& b = mWorstBlocks[i];
+      str.AppendFormatted(256, "block %lld at sample %.0f: %.3f of %.3f ms (%.1f%%), %i frames at %.0f Hz, %i MIDI messages, %i parameter changes\n",
+                          (long long) b.mBlockIndex, b.mSamplePos, b.mElapsedMs, b.mDeadlineMs, b.mLoad * 100., b.mNFrames, b.mSampleRate, b.mNMidiMsgs, b.mNParamChanges);
+    }
+  }
+};
+
+/** Measures the time taken by each process call against its deadline, which is the duration of the block.
+ * The audio thread keeps a histogram of the load, and a list of the slowest blocks along with the MIDI and parameter activity that arrived with them,
+ * and publishes a copy of them a few times a second through an ISenderFrameRing, so nothing on the audio thread waits for the UI, or allocates.
+ * Enabled in IPlugProcessor by defining IPLUG_DEADLINE_MONITOR, see IPlugProcessor::GetDeadlineMonitor() */
+class IDeadlineMonitor
+{
+public:
+  using Clock = std::chrono::steady_clock;
+
+  /** Times a process call, from construction to destruction. Audio thread only */
+  class Scope
+  {
+  public:
+    Scope(IDeadlineMonitor& monitor, int nFrames, double sampleRate, double samplePos)
+    : mMonitor(monitor)
+    , mNFrames(nFrames)
+    , mSampleRate(sampleRate)
+    , mSamplePos(samplePos)
+    , mStart(Clock::now())
+    {
+    }
+
+    ~Scope()
+    {
+      mMonitor.AddBlock(mNFrames, mSampleRate, mSamplePos, std::chrono::duration<double, std::milli>(Clock::now() - mStart).count());
+    }
+
+  private:
+    IDeadlineMonitor& mMonitor;
+    int mNFrames;
+    double mSampleRate;
+    double mSamplePos;
+    Clock::time_point mStart;
+  };
+
+  /** Count an incoming MIDI or SysEx message. This can be called on any thread */
+  void NoteMidiMsg() { mPendingMidiMsgs.fetch_add(1, std::memory_order_relaxed); }
+
+  /** Count a parameter change from the host. This can be called on any thread */
+  void NoteParamChange() { mPendingParamChanges.fetch_add(1, std::memory_order_relaxed); }
+
+  /** Clear the statistics, the next time a block is processed. This can be called on any thread */
+  void Reset() { mResetRequested.store(true, std::memory_order_relaxed); }
+
+  /** Record a process call. Audio thread only
+   * @param nFrames The number of frames in the block
+   * @param sampleRate The sample rate
+   * @param samplePos The host's sample position at the start of the block
+   * @param elapsedMs The time it took to process the block */
+  void AddBlock(int nFrames, double sampleRate, double samplePos, double elapsedMs)
+  {
+    if (nFrames <= 0 || sampleRate <= 0.)
+      return;
+
+    if (mResetRequested.exchange(false, std::memory_order_relaxed))
+      mReport = IDeadlineReport();
+
+    IDeadlineBlock block;
+    block.mBlockIndex = mReport.mNBlocks;
+    block.mSamplePos = samplePos;
+    block.mSampleRate = sampleRate;
+    block.mNFrames = nFrames;
+    block.mElapsedMs = elapsedMs;
+    block.mDeadlineMs = 1000. * nFrames / sampleRate;
+    block.mLoad = elapsedMs / block.mDeadlineMs;
+    block.mNMidiMsgs = mPendingMidiMsgs.exchange(0, std::memory_order_relaxed);
+    block.mNParamChanges = mPendingParamChanges.exchange(0, std::memory_order_relaxed);
+
+    const int bin = std::min(static_cast<int>(block.mLoad / IDeadlineReport::kBinWidth), IDeadlineReport::kNumBins - 1);
+    mReport.mHistogram[bin]++;
+    mReport.mNBlocks++;
+    mReport.mTotalLoad += block.mLoad;
+
+    if (block.mLoad > 1.)
+      mReport.mNOverruns++;
+
+    const bool worst = InsertWorstBlock(block);
+
+    // publish at least every kPublishIntervalMs of audio, or straight away when there is a new slow block to see
+    mMsSincePublish += block.mDeadlineMs;
+
+    if (worst || mMsSincePublish >= kPublishIntervalMs)
+    {
+      mRing.GetWriteFrame() = mReport;
+      mRing.Publish();
+      mMsSincePublish = 0.;
+    }
+  }
+
+  /** If the audio thread has published a new report since the last call, take it. Main thread only
+   * @return \c true if GetReport() changed */
+  bool Update() { return mRing.Update(); }
+
+  /** @return The last report taken by Update(). Main thread only */
+  const IDeadlineReport& GetReport() const { return *mRing.GetReadFrame(); }
+
+  /** If a new report has been published, sends a pointer to it to a control as an ISender<>::kFrameMessage, like IFrameSender.
+   * The IDeadlineReport stays valid until the next call. This must be called on the main thread - typically in MyPlugin::OnIdle()
+   * @param dlg The editor delegate, usually the plug-in
+   * @param ctrlTag The tag of the control that displays the report */
+  void TransmitData(IEditorDelegate& dlg, int ctrlTag)
+  {
+    if (Update())
+      dlg.SendControlMsgFromDelegate(ctrlTag, ISender<>::kFrameMessage, sizeof(IDeadlineReport), (const void*) &GetReport());
+  }
+
+  /** Write the latest report to the debug output and the trace log, see IPlugLogger.h. Main thread only */
+  void Dump()
+  {
+    Update();
+
+    WDL_String str;
+    GetReport().GetText(str);
+    DBGMSG("%s", str.Get());
+    Trace(TRACELOC, "%s", str.Get());
+  }
+
+private:
+  static constexpr double kPublishIntervalMs = 100.;
+
+  bool InsertWorstBlock(const IDeadlineBlock& block)
+  {
+    auto& worst = mReport.mWorstBlocks;
+    int& nWorst = mReport.mNWorstBlocks;
+
+    if (nWorst == IDeadlineReport::kNumWorstBlocks && block.mLoad <= worst[nWorst - 1].mLoad)
+      return false;
+
+    int pos = std::min(nWorst, IDeadlineReport::kNumWorstBlocks - 1);
+
+    while (pos > 0 && worst[pos - 1].mLoad < block.mLoad)
+    {
+      worst[pos] = worst[pos - 1];
+      pos--;
+    }
+
+    worst[pos] = block;
+    nWorst = std::min(nWorst + 1, IDeadlineReport::kNumWorstBlocks);
+    return true;
+  }
+
+  IDeadlineReport mReport;
+  double mMsSincePublish = 0.;
+  std::atomic<int> mPendingMidiMsgs {0};
+  std::atomic<int> mPendingParamChanges {0};
+  std::atomic<bool> mResetRequested {false};
+  ISenderFrameRing<IDeadlineReport> mRing;
+};
+
+END_IPLUG_NAMESPACE
@@ -26,6 +26,9 @@
   #if defined WEBSOCKET_SERVER
     #include "IWebsocketEditorDelegate.h"
     using EDITOR_DELEGATE_CLASS = iplug::IWebsocketEditorDelegate;
+  #elif defined SHM_EDITOR
+    #include "IShmEditorDelegate.h"
+    using EDITOR_DELEGATE_CLASS = iplug::IShmEditorDelegate;
   #else
     #include "IGraphicsEditorDelegate.h"
     using EDITOR_DELEGATE_CLASS = iplug::igraphics::IGEditorDelegate;
@@ -0,0 +1,431 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc IDirIndex
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/stat.h>
+
+#include "dirscan.h"
+#include "wdltypes.h"
+
+#include "IPlugPlatform.h"
+#include "IPlugSignal.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** IDirIndex lists the files with one extension in a set of folders and their subfolders on a worker thread, so that a preset browser can show them without scanning the file system on the UI thread,
+ * which can take seconds for a preset library on a network drive. The UI reads the latest listing with GetSnapshot(), and GetGeneration() tells it when the listing has changed.
+ *
+ * The index can be kept in a file, see SetIndexFile(). The file is read before the first scan, so that the last listing is available straight away, and each scan only lists the folders whose
+ * modification time has changed since they were indexed, which is one stat() per folder rather than a listing of every folder. The folders are rescanned in the same way every
+ * SetRescanInterval(), or when Rescan() is called, so that files that are added, removed or renamed appear without reopening the UI.
+ * Since a folder's modification time only changes when its entries do, edits to a file that keep its name aren't seen until its folder changes, although they don't change the listing */
+class IDirIndex
+{
+public:
+  /** A file in the index */
+  struct File
+  {
+    std::string name; // the file name, without the folder
+    int64_t mtime = 0; // the modification time from when its folder was listed, in seconds
+  };
+
+  /** A folder in the index, which lists its subfolders and its files with the extension, sorted by name */
+  struct Dir
+  {
+    int64_t mtime = -1; // the modification time of the folder when it was listed, in seconds
+    std::vector<std::string> subdirs;
+    std::vector<File> files;
+  };
+
+  /** A listing of every folder under the root paths, keyed by full path. A snapshot is never changed once it has been published, so it can be read on any thread */
+  struct Snapshot
+  {
+    std::vector<std::string> roots;
+    std::unordered_map<std::string, Dir> dirs;
+
+    /** @return The folder at a full path, or nullptr if it isn't in the index, e.g. because it doesn't exist */
+    const Dir* Find(const std::string& path) const
+    {
+      auto it = dirs.find(path);
+      return it != dirs.end() ? &it->second : nullptr;
+    }
+  };
+
+  /** @param extension The extension of the files to index, without the dot, e.g. "fxp" */
+  explicit IDirIndex(const char* extension)
+  : mExtension(extension)
+  {
+  }
+
+  ~IDirIndex()
+  {
+    Stop();
+  }
+
+  IDirIndex(const IDirIndex&) = delete;
+  IDirIndex& operator=(const IDirIndex&) = delete;
+
+  /** Add a folder to index, with its subfolders. Call this before Start() */
+  void AddPath(const char* path)
+  {
+    mRoots.emplace_back(path);
+
+    // trailing separators would make the paths of the subfolders differ from listing to listing
+    while (mRoots.back().size() > 1 && (mRoots.back().back() == '/' || mRoots.back().back() == '\\'))
+      mRoots.back().pop_back();
+  }
+
+  /** Keep the index in a file, so that it can be shown before the first scan, and later scans only list the folders that have changed. Call this before Start()
+   * @param path The path of the index file, e.g. in the plug-in's application support folder */
+  void SetIndexFile(const char* path) { mIndexFile = path ? path : ""; }
+
+  /** @param intervalMs How often the worker checks the folders for changes, or 0 to only check them when Rescan() is called */
+  void SetRescanInterval(double intervalMs) { mRescanIntervalMs = intervalMs; }
+
+  /** Start the worker, which reads the index file and scans the folders. Call this on the main thread */
+  void Start()
+  {
+    if (mRunning.exchange(true))
+      return;
+
+    mWorker = std::thread(&IDirIndex::ThreadLoop, this);
+  }
+
+  /** Stop the worker, waiting for a scan that is under way to notice. Call this on the main thread */
+  void Stop()
+  {
+    if (!mRunning.exchange(false))
+      return;
+
+    mSignal.Notify();
+    mWorker.join();
+  }
+
+  /** Ask the worker to check the folders for changes now, e.g. after the plug-in has saved a preset. This doesn't block */
+  void Rescan() { mSignal.Notify(); }
+
+  /** @return The latest listing, which is empty until the index file has been read or the first scan has finished. The snapshot stays valid while it is held */
+  std::shared_ptr<const Snapshot> GetSnapshot() const
+  {
+    std::lock_guard<std::mutex> lock(mSnapshotMutex);
+    return mSnapshot;
+  }
+
+  /** @return A number that changes each time a new snapshot is published, so that the UI can poll it cheaply, e.g. from IControl::IsDirty() */
+  int GetGeneration() const { return mGeneration.load(std::memory_order_acquire); }
+
+  /** @return The path of a subfolder or file in a folder */
+  static std::string JoinPath(const std::string& dir, const std::string& name)
+  {
+    return dir + WDL_DIRCHAR_STR + name;
+  }
+
+private:
+  void ThreadLoop()
+  {
+    std::shared_ptr<Snapshot> pOld = ReadIndexFile();
+    bool published = false;
+
+    // an index of other folders is still used by the scan for the folders they share, but only an index of these folders is shown before it
+    if (pOld && pOld->roots == mRoots)
+    {
+      Publish(pOld);
+      published = true;
+    }
+
+    while (mRunning)
+    {
+      auto pNew = std::make_shared<Snapshot>();
+      pNew->roots = mRoots;
+      bool changed = !pOld || pOld->roots != mRoots;
+
+      for (const std::string& root : mRoots)
+        ScanDir(root, pOld.get(), *pNew, changed);
+
+      // a scan that was stopped part of the way through is incomplete
+      if (!mRunning)
+        break;
+
+      // a folder that has gone is missing from the new listing, but its parent's modification time has changed too, or it is a root
+      if (!changed && pOld)
+        changed = pOld->dirs.size() != pNew->dirs.size();
+
+      if (changed || !published)
+      {
+        Publish(pNew);
+        WriteIndexFile(*pNew);
+        published = true;
+      }
+
+      pOld = pNew;
+      mSignal.Wait(mRescanIntervalMs > 0. ? mRescanIntervalMs : -1.);
+    }
+  }
+
+  void ScanDir(const std::string& path, const Snapshot* pOld, Snapshot& index, bool& changed)
+  {
+    if (!mRunning)
+      return;
+
+    const int64_t mtime = GetModificationTime(path.c_str());
+
+    if (mtime < 0)
+    {
+      if (pOld && pOld->Find(path))
+        changed = true;
+
+      return;
+    }
+
+    const Dir* pCached = pOld ? pOld->Find(path) : nullptr;
+    Dir dir;
+
+    if (pCached && pCached->mtime == mtime)
+    {
+      dir = *pCached;
+    }
+    else
+    {
+      changed = true;
+      ListDir(path, mtime, dir);
+    }
+
+    for (const std::string& subdir : dir.subdirs)
+      ScanDir(JoinPath(path, subdir), pOld, index, changed);
+
+    index.dirs[path] = std::move(dir);
+  }
+
+  void ListDir(const std::string& path, int64_t mtime, Dir& dir)
+  {
+    dir.mtime = mtime;
+
+    WDL_DirScan d;
+
+    if (!d.First(path.c_str()))
+    {
+      do
+      {
+        const char* f = d.GetCurrentFN();
+
+        if (!f || f[0] == '.')
+          continue;
+
+        if (d.GetCurrentIsDirectory())
+        {
+          dir.subdirs.emplace_back(f);
+        }
+        else if (HasExtension(f))
+        {
+          File file;
+          file.name = f;
+          file.mtime = GetModificationTime(JoinPath(path, file.name).c_str());
+          dir.files.push_back(std::move(file));
+        }
+      } while (!d.Next());
+    }
+
+    std::sort(dir.subdirs.begin(), dir.subdirs.end());
+    std::sort(dir.files.begin(), dir.files.end(), [](const File& a, const File& b) { return a.name < b.name; });
+  }
+
+  bool HasExtension(const char* fileName) const
+  {
+    const size_t len = strlen(fileName);
+    const size_t extLen = mExtension.size();
+
+    return extLen && len > extLen + 1 && fileName[len - extLen - 1] == '.' && !strcmp(fileName + len - extLen, mExtension.c_str());
+  }
+
+  /** @return The modification time of a file or folder in seconds, or -1 if it doesn't exist */
+  static int64_t GetModificationTime(const char* path)
+  {
+    struct stat st;
+
+    if (stat(path, &st))
+      return -1;
+
+    return static_cast<int64_t>(st.st_mtime);
+  }
+
+  void Publish(std::shared_ptr<const Snapshot> pSnapshot)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mSnapshotMutex);
+      mSnapshot = std::move(pSnapshot);
+    }
+
+    mGeneration.fetch_add(1, std::memory_order_release);
+  }
+
+  /** The index file is text, a header line and then a line for each root, folder, subfolder and file, which are written after the folder they are in:
+   * "R <path>", "D <mtime> <path>", "S <name>" and "F <mtime> <name>" */
+  std::shared_ptr<Snapshot> ReadIndexFile() const
+  {
+    if (mIndexFile.empty())
+      return nullptr;
+
+    FILE* fp = fopen(mIndexFile.c_str(), "rb");
+
+    if (!fp)
+      return nullptr;
+
+    auto pIndex = std::make_shared<Snapshot>();
+    std::vector<char> line(8192);
+    Dir* pDir = nullptr;
+    bool valid = false;
+
+    if (fgets(line.data(), static_cast<int>(line.size()), fp))
+    {
+      std::string header = StripNewline(line.data());
+      valid = header == "IPlugDirIndex 1 " + mExtension;
+    }
+
+    while (valid && fgets(line.data(), static_cast<int>(line.size()), fp))
+    {
+      const std::string entry = StripNewline(line.data());
+
+      if (entry.size() < 2 || entry[1] != ' ')
+      {
+        valid = false;
+        break;
+      }
+
+      std::string value = entry.substr(2);
+      int64_t mtime = 0;
+
+      if (entry[0] == 'D' || entry[0] == 'F')
+      {
+        const size_t space = value.find(' ');
+
+        if (space == std::string::npos)
+        {
+          valid = false;
+          break;
+        }
+
+        mtime = std::strtoll(value.c_str(), nullptr, 10);
+        value = value.substr(space + 1);
+      }
+
+      switch (entry[0])
+      {
+        case 'R':
+          pIndex->roots.push_back(value);
+          break;
+        case 'D':
+          pDir = &pIndex->dirs[value];
+          pDir->mtime = mtime;
+          break;
+        case 'S':
+          if (pDir)
+            pDir->subdirs.push_back(value);
+          break;
+        case 'F':
+          if (pDir)
+            pDir->files.push_back({value, mtime});
+          break;
+        default:
+          valid = false;
+          break;
+      }
+    }
+
+    fclose(fp);
+
+    return valid ? pIndex : nullptr;
+  }
+
+  void WriteIndexFile(const Snapshot& index) const
+  {
+    if (mIndexFile.empty())
+      return;
+
+    // written to a temporary file and renamed, so that a crash or another instance never sees half an index
+    const std::string tempFile = mIndexFile + ".tmp";
+    FILE* fp = fopen(tempFile.c_str(), "wb");
+
+    if (!fp)
+      return;
+
+    fprintf(fp, "IPlugDirIndex 1 %s\n", mExtension.c_str());
+
+    for (const std::string& root : index.roots)
+      fprintf(fp, "R %s\n", root.c_str());
+
+    for (const auto& entry : index.dirs)
+    {
+      fprintf(fp, "D %lld %s\n", static_cast<long long>(entry.second.mtime), entry.first.c_str());
+
+      for (const std::string& subdir : entry.second.subdirs)
+        fprintf(fp, "S %s\n", subdir.c_str());
+
+      for (const File& file : entry.second.files)
+        fprintf(fp, "F %lld %s\n", static_cast<long long>(file.mtime), file.name.c_str());
+    }
+
+    const bool ok = !ferror(fp);
+    fclose(fp);
+
+    if (ok)
+    {
+#ifdef OS_WIN
+      remove(mIndexFile.c_str()); // rename() doesn't replace an existing file on Windows
+#endif
+      rename(tempFile.c_str(), mIndexFile.c_str());
+    }
+    else
+      remove(tempFile.c_str());
+  }
+
+  static std::string StripNewline(const char* line)
+  {
+    std::string str(line);
+
+    while (!str.empty() && (str.back() == '\n' || str.back() == '\r'))
+      str.pop_back();
+
+    return str;
+  }
+
+  const std::string mExtension;
+  std::vector<std::string> mRoots;
+  std::string mIndexFile;
+  double mRescanIntervalMs = 5000.;
+
+  std::atomic<bool> mRunning {false};
+  std::thread mWorker;
+  IPlugSignal mSignal;
+
+  mutable std::mutex mSnapshotMutex;
+  std::shared_ptr<const Snapshot> mSnapshot = std::make_shared<const Snapshot>();
+  std::atomic<int> mGeneration {0};
+};
+
+END_IPLUG_NAMESPACE
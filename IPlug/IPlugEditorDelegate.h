@@ -15,9 +15,12 @@
  * @copydoc IEditorDelegate
  */
 
+#include <algorithm>
 #include <cassert>
 #include <cstring>
+#include <memory>
 #include <stdint.h>
+#include <vector>
 
 #include "ptrlist.h"
 
@@ -27,6 +30,8 @@
 
 BEGIN_IPLUG_NAMESPACE
 
+class IMemoryStats;
+
 /** This pure virtual interface delegates communication in both directions between a UI editor and something else (which is usually a plug-in)
  *  It is also the class that owns parameter objects (for historical reasons) - although it's not necessary to allocate them
  *
@@ -49,13 +54,27 @@ class IEditorDelegate
 public:
   IEditorDelegate(int nParams)
   {
-    for (int i = 0; i < nParams; i++)
-      AddParam();
+    // the plug-in's parameters are made in one allocation, only those added later with AddParam() are allocated one at a time
+    if (nParams > 0)
+      mParamStorage = std::make_unique<IParam[]>(nParams);
+
+    mNumStoredParams = std::max(nParams, 0);
+
+    for (int i = 0; i < mNumStoredParams; i++)
+      mParams.Add(&mParamStorage[i]);
+
+    BindParamValues();
   }
   
   virtual ~IEditorDelegate()
   {
-    mParams.Empty(true);
+    for (int i = 0; i < mParams.GetSize(); i++)
+    {
+      if (!IsStoredParam(mParams.Get(i)))
+        delete mParams.Get(i);
+    }
+
+    mParams.Empty();
   }
   
   IEditorDelegate(const IEditorDelegate&) = delete;
@@ -64,12 +83,19 @@ public:
   /** Adds an IParam to the parameters ptr list
    * Note: This is only used in special circumstances, since most plug-in formats don't support dynamic parameters
    * @return Ptr to the newly created IParam object */
-  IParam* AddParam() { return mParams.Add(new IParam()); }
+  IParam* AddParam() { IParam* pParam = mParams.Add(new IParam()); BindParamValues(); return pParam; }
   
   /** Remove an IParam at a particular index
    * Note: This is only used in special circumstances, since most plug-in formats don't support dynamic parameters
    * @param idx The index of the parameter to remove */
-  void RemoveParam(int idx) { return mParams.Delete(idx); }
+  void RemoveParam(int idx)
+  {
+    if (IParam* pParam = mParams.Get(idx))
+      pParam->BindValue(nullptr, 0);
+
+    mParams.Delete(idx);
+    BindParamValues();
+  }
   
   /** Get a pointer to one of the delegate's IParam objects
    * @param paramIdx The index of the parameter object to be got
@@ -83,6 +109,21 @@ public:
 
   /** @return Returns the number of parameters that belong to the plug-in. */
   int NParams() const { return mParams.GetSize(); }
+
+  /** Get the parameter values, which are stored contiguously, indexed by parameter
+   * @return NParams() atomic values, that can be read from any thread, and that are only moved by AddParam() and RemoveParam() */
+  const std::atomic<double>* GetParamValues() const { return mParamValues.Get(); }
+
+  /** Copy all the parameter values, as they were at one instant, into pValues. It doesn't lock, so it can be called on the audio thread,
+   * see ParamValueArray::Snapshot()
+   * @param pValues Somewhere to put NParams() values
+   * @return \c true if the copy is consistent, \c false if the values kept changing while it was made */
+  bool SnapshotParamValues(double* pValues) const { return mParamValues.Snapshot(pValues); }
+
+  /** Copy all the parameter values, as they were at one instant, into a buffer owned by the delegate. It is meant to be called once at the start of ProcessBlock(),
+   * so that the whole block uses the same values, read from one or two cache lines rather than from every IParam. Only call it from one thread
+   * @return NParams() values, indexed by parameter, valid until the next call */
+  const double* GetParamSnapshot() { mParamValues.Snapshot(mParamSnapshot.Get()); return mParamSnapshot.Get(); }
   
   /** If you are not using IGraphics, you can implement this method to attach to the native parent view e.g. NSView, UIView, HWND.
    *  Defer calling OnUIOpen() if necessary. */
@@ -161,14 +202,17 @@ public:
   virtual bool OnKeyUp(const IKeyPress& key) { return false; }
   
 #pragma mark - Methods for sending values TO the user interface
-  /** Loops through all parameters, calling SendParameterValueFromDelegate() with the current value of the parameter
+  /** Sends the current value of every parameter with one call to SendParameterValuesFromDelegate(), so that editors can update in bulk
    *  This is important when modifying groups of parameters, restoring state and opening the UI, in order to update it with the latest values*/
   void SendCurrentParamValuesFromDelegate()
   {
+    std::vector<ParamTuple> params(NParams());
+
     for (int i = 0; i < NParams(); ++i)
-    {
-      SendParameterValueFromDelegate(i, GetParam(i)->GetNormalized(), true);
-    }
+      params[i] = ParamTuple(i, GetParam(i)->GetNormalized());
+
+    if (!params.empty())
+      SendParameterValuesFromDelegate(params.data(), NParams(), true);
   }
   
   /** SendControlValueFromDelegate (Abbreviation: SCVFD)
@@ -189,6 +233,18 @@ public:
    * @param dataSize The size in bytes of the data payload pointed to by pData. Note: if this is nonzero, pData must be valid.
    * @param pData Ptr to the opaque data payload for the message */
   virtual void SendControlMsgFromDelegate(int ctrlTag, int msgTag, int dataSize = 0, const void* pData = nullptr) { OnMessage(msgTag, ctrlTag, dataSize, pData); }
+
+  /** SendControlMsgsFromDelegate
+   * WARNING: should not be called on the realtime audio thread.
+   * Sends several messages to controls at once, e.g. everything an ISender has queued since the last call. By default it calls SendControlMsgFromDelegate() for each one,
+   * editors can override it to deliver them together
+   * @param pMsgs The messages, whose data only needs to be valid for the duration of the call
+   * @param nMsgs The number of messages */
+  virtual void SendControlMsgsFromDelegate(const ControlMsg* pMsgs, int nMsgs)
+  {
+    for (int i = 0; i < nMsgs; i++)
+      SendControlMsgFromDelegate(pMsgs[i].ctrlTag, pMsgs[i].msgTag, pMsgs[i].dataSize, pMsgs[i].pData);
+  }
   
   /** SendArbitraryMsgFromDelegate (Abbreviation: SAMFD)
    * WARNING: should not be called on the realtime audio thread.
@@ -205,6 +261,18 @@ public:
    * The message can be handled at the destination via IEditorDelegate::OnMidiMsgUI()
    * @param msg an IMidiMsg Containing the MIDI message to send to the user interface. */
   virtual void SendMidiMsgFromDelegate(const IMidiMsg& msg) { OnMidiMsgUI(msg); }
+
+  /** SendMidiMsgsFromDelegate
+   * WARNING: should not be called on the realtime audio thread.
+   * Sends several MIDI messages to the user interface at once. IPlugAPIBase calls this once per timer tick, with the messages that came from the processor.
+   * By default it calls SendMidiMsgFromDelegate() for each one, editors can override it to deliver them together
+   * @param pMsgs The messages, in the order they were sent
+   * @param nMsgs The number of messages */
+  virtual void SendMidiMsgsFromDelegate(const IMidiMsg* pMsgs, int nMsgs)
+  {
+    for (int i = 0; i < nMsgs; i++)
+      SendMidiMsgFromDelegate(pMsgs[i]);
+  }
   
   /** SendSysexMsgFromDelegate (Abbreviation: SSMFD)
    * WARNING: should not be called on the realtime audio thread.
@@ -224,6 +292,20 @@ public:
    * @param normalized \c true if value is normalised */
   virtual void SendParameterValueFromDelegate(int paramIdx, double value, bool normalized) { OnParamChangeUI(paramIdx, EParamSource::kDelegate); } // TODO: normalised?
 
+  /** SendParameterValuesFromDelegate
+   * WARNING: should not be called on the realtime audio thread.
+   * Updates the user interface with several parameter values at once. IPlugAPIBase calls this once per timer tick, with the latest value of each parameter that changed.
+   * By default it calls SendParameterValueFromDelegate() for each one, but editors that send messages elsewhere, such as a web view or websocket clients,
+   * can override it to send them all in one message
+   * @param pParams The parameter indexes and values
+   * @param nParams The number of parameters
+   * @param normalized \c true if the values are normalised */
+  virtual void SendParameterValuesFromDelegate(const ParamTuple* pParams, int nParams, bool normalized)
+  {
+    for (int i = 0; i < nParams; i++)
+      SendParameterValueFromDelegate(pParams[i].idx, pParams[i].value, normalized);
+  }
+
 #pragma mark - Methods for sending values FROM the user interface
   // The following methods are called from the user interface in order to set or query values of parameters in the class implementing IEditorDelegate
   
@@ -279,6 +361,17 @@ public:
   * @param dataSize The size in bytes of the data payload pointed to by pData. Note: if this is nonzero, pData must be valid.
   * @param pData Ptr to the opaque data payload for the message */
   virtual void SendArbitraryMsgFromUI(int msgTag, int ctrlTag = kNoTag, int dataSize = 0, const void* pData = nullptr) {};
+
+  /** SendArbitraryMsgToDSPFromUI (Abbreviation: SAMTDFUI)
+   * Sends a message to IPlugProcessor::OnMessageRT() on the audio thread, at the start of the next block, rather than to OnMessage() on the UI thread.
+   * Use this for data the DSP needs, e.g. a drawn envelope, so that it doesn't need guarding with a lock. The data is copied into a preallocated lock-free queue.
+   * Not supported by distributed plug-ins, such as VST3 with a separate controller, where it returns \c false
+   * @param msgTag A unique tag to identify the message
+   * @param ctrlTag A unique tag to identify the control that sent the message, if desired
+   * @param dataSize The size in bytes of the data payload pointed to by pData. Note: if this is nonzero, pData must be valid.
+   * @param pData Ptr to the opaque data payload for the message
+   * @return \c true if the message was queued, \c false if it is not supported, the queue is full or the message is bigger than half of RT_MESSAGE_TRANSFER_SIZE */
+  virtual bool SendArbitraryMsgToDSPFromUI(int msgTag, int ctrlTag = kNoTag, int dataSize = 0, const void* pData = nullptr) { return false; }
   
 #pragma mark -
   /** This method is needed, for remote editors to avoid a feedback loop */
@@ -347,6 +440,9 @@ public:
    * @param scale The new screen scale*/
   virtual void SetScreenScale(float scale) {}
 
+  /** @return The memory stats of the plug-in, which the editor counts its own memory against, or nullptr if there are none, see IPluginBase::GetMemoryStats() */
+  virtual IMemoryStats* GetMemoryStats() { return nullptr; }
+
   friend class IPlugAPP;
   friend class IPlugAAX;
   friend class IPlugVST2;
@@ -361,8 +457,37 @@ public:
   friend class IPluginBase;
 
 private:
+  /** Move all the parameter values into a new mParamValues, in parameter order */
+  void BindParamValues()
+  {
+    const int n = mParams.GetSize();
+
+    // move the values back into the IParams first, so that nothing points at the old array while it is replaced
+    for (int i = 0; i < n; i++)
+      mParams.Get(i)->BindValue(nullptr, 0);
+
+    mParamValues.Resize(n);
+    mParamSnapshot.Resize(n);
+
+    for (int i = 0; i < n; i++)
+      mParams.Get(i)->BindValue(&mParamValues, i);
+  }
+
+  /** @return \c true if pParam is one of the parameters made by the constructor, in mParamStorage */
+  bool IsStoredParam(const IParam* pParam) const
+  {
+    return mParamStorage && pParam >= mParamStorage.get() && pParam < mParamStorage.get() + mNumStoredParams;
+  }
+
   /** A list of IParam objects. This list is populated in the delegate constructor depending on the number of parameters passed as an argument to MakeConfig() in the plug-in class implementation constructor */
   WDL_PtrList<IParam> mParams;
+  /** The IParams made by the constructor, which mParams points into */
+  std::unique_ptr<IParam[]> mParamStorage;
+  int mNumStoredParams = 0;
+  /** The values of mParams, which the IParams store their values in */
+  ParamValueArray mParamValues;
+  /** The copy made by GetParamSnapshot() */
+  WDL_TypedBuf<double> mParamSnapshot;
 
   /** The width of the plug-in editor in pixels. Can be updated by resizing, exists here for persistance, even if UI doesn't exist. */
   int mEditorWidth = 0;
@@ -648,3 +648,5 @@ static const char* VSTOpcodeStr(int opCode) { return ""; }
 #endif // !TRACER_BUILD
 
 END_IPLUG_NAMESPACE
+
+#include "IPlugRTLogger.h"
@@ -0,0 +1,238 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc IMemoryStats
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "wdlstring.h"
+
+#include "IPlugPlatform.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** IMemoryStats counts the bytes used by one plug-in instance, by category, so that large sessions can show which instances use the memory, and caches can be given budgets.
+ * Each plug-in has one, see IPluginBase::GetMemoryStats(), and the caches that are shared by every instance in the process, like the IGraphics bitmap cache, count against Shared().
+ * Every IMemoryStats in the process can be listed with ForEach(), and IGraphics::ShowMemoryStats() draws them over the UI.
+ *
+ * Memory is counted where it is allocated, with an IMemoryStats::Allocation kept alongside it, which takes its bytes off again when it is destroyed.
+ * Memory that has no one place where it is allocated, like the presets, can be measured when the stats are read instead, see SetGauge().
+ * The counts are atomic so that they can be updated on any thread, including the audio thread, but they only track what the code that allocates reports */
+class IMemoryStats
+{
+public:
+  enum ECategory
+  {
+    kBitmaps = 0,   // decoded bitmaps in the IGraphics cache, as 32 bit pixels whether they are in memory or on the GPU
+    kLayers,        // IGraphics layers, including those that controls cache between frames
+    kAudioBuffers,  // IPlugProcessor's channel, precision conversion and scratch arena buffers
+    kImpulses,      // convolution impulses and their buffers, see PartitionedConvolutionEngine::SetMemoryStats()
+    kPresets,       // the factory and user presets' state
+    kOther,         // anything else the plug-in chooses to count
+    kNumCategories
+  };
+
+  /** A record of one block of memory counted against a category, which is kept with the memory, for example as a member of the class that owns it.
+   * Call Set() again when the memory is reallocated, and the difference is counted. It is not thread safe, so it should only be updated by the thread that owns the memory */
+  class Allocation
+  {
+  public:
+    Allocation() = default;
+
+    ~Allocation()
+    {
+      Reset();
+    }
+
+    Allocation(const Allocation&) = delete;
+    Allocation& operator=(const Allocation&) = delete;
+
+    /** @param pStats The stats to count the memory against, or nullptr to stop counting it
+     * @param category The category of the memory
+     * @param bytes The size of the memory */
+    void Set(IMemoryStats* pStats, ECategory category, int64_t bytes)
+    {
+      if (pStats == mStats && category == mCategory)
+      {
+        if (mStats)
+          mStats->Add(mCategory, bytes - mBytes);
+      }
+      else
+      {
+        Reset();
+
+        if (pStats)
+          pStats->Add(category, bytes);
+
+        mStats = pStats;
+        mCategory = category;
+      }
+
+      mBytes = pStats ? bytes : 0;
+    }
+
+    /** Change the size of the memory, keeping the stats and category */
+    void SetBytes(int64_t bytes) { Set(mStats, mCategory, bytes); }
+
+    /** Stop counting the memory, when it is freed */
+    void Reset()
+    {
+      if (mStats)
+        mStats->Add(mCategory, -mBytes);
+
+      mStats = nullptr;
+      mBytes = 0;
+    }
+
+    /** @return The bytes counted */
+    int64_t GetBytes() const { return mBytes; }
+
+  private:
+    IMemoryStats* mStats = nullptr;
+    ECategory mCategory = kOther;
+    int64_t mBytes = 0;
+  };
+
+  /** A function that measures the bytes of a category at the time the stats are read */
+  using GaugeFunc = std::function<int64_t()>;
+
+  /** @param name How the stats are labelled in reports, e.g. the plug-in's name */
+  explicit IMemoryStats(const char* name = "")
+  : mName(name)
+  {
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mMutex);
+    mID = ++registry.mLastID;
+    registry.mStats.push_back(this);
+  }
+
+  ~IMemoryStats()
+  {
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mMutex);
+    registry.mStats.erase(std::remove(registry.mStats.begin(), registry.mStats.end(), this), registry.mStats.end());
+  }
+
+  IMemoryStats(const IMemoryStats&) = delete;
+  IMemoryStats& operator=(const IMemoryStats&) = delete;
+
+  /** Count bytes against a category. This can be called from any thread
+   * @param category The category of the memory
+   * @param bytes The number of bytes allocated, or negative for bytes freed */
+  void Add(ECategory category, int64_t bytes)
+  {
+    const int64_t total = mBytes[category].fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    int64_t peak = mPeakBytes[category].load(std::memory_order_relaxed);
+
+    while (total > peak && !mPeakBytes[category].compare_exchange_weak(peak, total, std::memory_order_relaxed)) {}
+  }
+
+  /** Measure a category when the stats are read, as well as counting what Add() is given. Set gauges before the stats are read, e.g. in the constructor of the owner.
+   * The function is called by whichever thread reads the stats, normally the UI thread, so it should only look at memory that the UI thread can safely look at */
+  void SetGauge(ECategory category, GaugeFunc func)
+  {
+    std::lock_guard<std::mutex> lock(mGaugeMutex);
+    mGauges[category] = func;
+  }
+
+  /** @return The bytes currently used by a category */
+  int64_t GetBytes(ECategory category) const
+  {
+    int64_t bytes = mBytes[category].load(std::memory_order_relaxed);
+
+    std::lock_guard<std::mutex> lock(mGaugeMutex);
+
+    if (mGauges[category])
+      bytes += mGauges[category]();
+
+    return bytes;
+  }
+
+  /** @return The most bytes counted with Add() for a category at any one time, which doesn't include gauges */
+  int64_t GetPeakBytes(ECategory category) const { return mPeakBytes[category].load(std::memory_order_relaxed); }
+
+  /** @return The bytes currently used by every category */
+  int64_t GetTotalBytes() const
+  {
+    int64_t bytes = 0;
+
+    for (auto c = 0; c < kNumCategories; c++)
+      bytes += GetBytes(static_cast<ECategory>(c));
+
+    return bytes;
+  }
+
+  /** Label the stats in reports */
+  void SetName(const char* name) { mName.Set(name); }
+
+  /** @return The label of the stats */
+  const char* GetName() const { return mName.Get(); }
+
+  /** @return A number that is unique to these stats in the process, to tell apart instances of the same plug-in */
+  int GetID() const { return mID; }
+
+  /** @return The name of a category */
+  static const char* GetCategoryName(ECategory category)
+  {
+    static const char* sNames[kNumCategories] = {"Bitmaps", "Layers", "Audio buffers", "Impulses", "Presets", "Other"};
+    return category >= 0 && category < kNumCategories ? sNames[category] : "";
+  }
+
+  /** @return The stats for memory that is shared by every plug-in instance in the process, such as the IGraphics bitmap cache */
+  static IMemoryStats& Shared()
+  {
+    // never destroyed, since static caches that count against it may be destroyed after it would be
+    static IMemoryStats* sShared = new IMemoryStats("Shared");
+    return *sShared;
+  }
+
+  /** Call a function for every IMemoryStats in the process, in the order they were made. The stats can't be destroyed while it runs, so it shouldn't make or destroy any */
+  static void ForEach(const std::function<void(const IMemoryStats&)>& func)
+  {
+    Registry& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock(registry.mMutex);
+
+    for (const IMemoryStats* pStats : registry.mStats)
+      func(*pStats);
+  }
+
+private:
+  struct Registry
+  {
+    std::mutex mMutex;
+    std::vector<IMemoryStats*> mStats;
+    int mLastID = 0;
+  };
+
+  static Registry& GetRegistry()
+  {
+    static Registry sRegistry;
+    return sRegistry;
+  }
+
+  WDL_String mName;
+  int mID = 0;
+  std::atomic<int64_t> mBytes[kNumCategories] = {};
+  std::atomic<int64_t> mPeakBytes[kNumCategories] = {};
+  mutable std::mutex mGaugeMutex;
+  GaugeFunc mGauges[kNumCategories];
+};
+
+END_IPLUG_NAMESPACE
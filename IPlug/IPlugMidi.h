@@ -21,6 +21,8 @@
 #include <cstdio>
 #include <algorithm>
 
+#include "heapbuf.h"
+
 #include "IPlugLogger.h"
 
 BEGIN_IPLUG_NAMESPACE
@@ -594,6 +596,429 @@ struct ISysEx
 
 };
 
+/** Encapsulates a MIDI 2.0 channel voice message, a 64 bit Universal MIDI Packet (UMP) of message type 4, and provides helper functions.
+ * Compared to IMidiMsg, velocities are 16 bit, controllers, pressure and pitch bend are 32 bit, and there are per-note controllers and per-note pitch bend,
+ * so dense high resolution controller data doesn't have to be split into 14 bit CC or NRPN pairs.
+ * Values are scaled to and from MIDI 1.0 as described in the MIDI 2.0 UMP specification, see FromMidi1() and ToMidi1()
+ * @ingroup IPlugStructs */
+struct IMidi2Msg
+{
+  int mOffset;
+  uint32_t mWords[2];
+
+  /** The UMP message type of MIDI 2.0 channel voice messages */
+  static constexpr uint32_t kMessageType = 0x4;
+
+  /** The default range of per-note pitch bend in semitones, as in the MIDI 2.0 specification */
+  static constexpr int kDefaultPerNotePitchBendRange = 48;
+
+  /** Constants for the status nibble of a MIDI 2.0 channel voice message */
+  enum EStatusMsg
+  {
+    kRegisteredPerNoteController = 0,
+    kAssignablePerNoteController = 1,
+    kRegisteredController = 2,
+    kAssignableController = 3,
+    kRelativeRegisteredController = 4,
+    kRelativeAssignableController = 5,
+    kPerNotePitchBend = 6,
+    kNoteOff = 8,
+    kNoteOn = 9,
+    kPolyPressure = 10,
+    kControlChange = 11,
+    kProgramChange = 12,
+    kChannelPressure = 13,
+    kPitchBend = 14,
+    kPerNoteManagement = 15
+  };
+
+  /** Constants for the index of registered per-note controllers */
+  enum EPerNoteController
+  {
+    kPerNoteModulation = 1,
+    kPerNoteBreath = 2,
+    kPerNotePitch = 3, // absolute pitch, 7 bit note number and 25 bit fraction
+    kPerNoteVolume = 7,
+    kPerNoteBalance = 8,
+    kPerNotePan = 10,
+    kPerNoteExpression = 11,
+    kPerNoteTimbre = 74
+  };
+
+  /** Create an IMidi2Msg
+   * @param offset Sample offset in block
+   * @param word0 The first word of the packet: message type, group, status, channel and two bytes that depend on the status
+   * @param word1 The second word of the packet, the data */
+  IMidi2Msg(int offset = 0, uint32_t word0 = 0, uint32_t word1 = 0)
+  : mOffset(offset)
+  {
+    mWords[0] = word0;
+    mWords[1] = word1;
+  }
+
+  /** Make a Note On message
+   * @param noteNumber Note number
+   * @param velocity Note on velocity [0, 1], note that a velocity of 0 is a note on in MIDI 2.0
+   * @param offset Sample offset in block
+   * @param channel MIDI channel [0, 15]
+   * @param group UMP group [0, 15] */
+  void MakeNoteOnMsg(int noteNumber, double velocity, int offset, int channel = 0, int group = 0)
+  {
+    Set(offset, group, kNoteOn, channel, noteNumber, 0, static_cast<uint32_t>(ToUnipolar16(velocity)) << 16);
+  }
+
+  /** Make a Note Off message
+   * @param noteNumber Note number
+   * @param velocity Note off velocity [0, 1]
+   * @param offset Sample offset in block
+   * @param channel MIDI channel [0, 15]
+   * @param group UMP group [0, 15] */
+  void MakeNoteOffMsg(int noteNumber, double velocity, int offset, int channel = 0, int group = 0)
+  {
+    Set(offset, group, kNoteOff, channel, noteNumber, 0, static_cast<uint32_t>(ToUnipolar16(velocity)) << 16);
+  }
+
+  /** Make a Poly Pressure message
+   * @param noteNumber Note number
+   * @param pressure Pressure [0, 1]
+   * @param offset Sample offset in block
+   * @param channel MIDI channel [0, 15]
+   * @param group UMP group [0, 15] */
+  void MakePolyPressureMsg(int noteNumber, double pressure, int offset, int channel = 0, int group = 0)
+  {
+    Set(offset, group, kPolyPressure, channel, noteNumber, 0, ToUnipolar32(pressure));
+  }
+
+  /** Make a Control Change message
+   * @param idx Controller number [0, 127]
+   * @param value Value [0, 1]
+   * @param offset Sample offset in block
+   * @param channel MIDI channel [0, 15]
+   * @param group UMP group [0, 15] */
+  void MakeControlChangeMsg(int idx, double value, int offset, int channel = 0, int group = 0)
+  {
+    Set(offset, group, kControlChange, channel, idx, 0, ToUnipolar32(value));
+  }
+
+  /** Make a Program Change message, without a bank
+   * @param program Program [0, 127]
+   * @param offset Sample offset in block
+   * @param channel MIDI channel [0, 15]
+   * @param group UMP group [0, 15] */
+  void MakeProgramChangeMsg(int program, int offset, int channel = 0, int group = 0)
+  {
+    Set(offset, group, kProgramChange, channel, 0, 0, static_cast<uint32_t>(program & 0x7F) << 24);
+  }
+
+  /** Make a Channel Pressure message
+   * @param pressure Pressure [0, 1]
+   * @param offset Sample offset in block
+   * @param channel MIDI channel [0, 15]
+   * @param group UMP group [0, 15] */
+  void MakeChannelPressureMsg(double pressure, int offset, int channel = 0, int group = 0)
+  {
+    Set(offset, group, kChannelPressure, channel, 0, 0, ToUnipolar32(pressure));
+  }
+
+  /** Make a Pitch Bend message
+   * @param value Bend [-1, 1]
+   * @param offset Sample offset in block
+   * @param channel MIDI channel [0, 15]
+   * @param group UMP group [0, 15] */
+  void MakePitchBendMsg(double value, int offset, int channel = 0, int group = 0)
+  {
+    Set(offset, group, kPitchBend, channel, 0, 0, ToBipolar32(value));
+  }
+
+  /** Make a Per-Note Pitch Bend message
+   * @param noteNumber Note number
+   * @param value Bend [-1, 1]
+   * @param offset Sample offset in block
+   * @param channel MIDI channel [0, 15]
+   * @param group UMP group [0, 15] */
+  void MakePerNotePitchBendMsg(int noteNumber, double value, int offset, int channel = 0, int group = 0)
+  {
+    Set(offset, group, kPerNotePitchBend, channel, noteNumber, 0, ToBipolar32(value));
+  }
+
+  /** Make a Per-Note Controller message
+   * @param noteNumber Note number
+   * @param idx Controller index [0, 255], see EPerNoteController for registered controllers
+   * @param value Value [0, 1]
+   * @param offset Sample offset in block
+   * @param channel MIDI channel [0, 15]
+   * @param registered \c true for a registered per-note controller, \c false for an assignable one
+   * @param group UMP group [0, 15] */
+  void MakePerNoteControllerMsg(int noteNumber, int idx, double value, int offset, int channel = 0, bool registered = true, int group = 0)
+  {
+    Set(offset, group, registered ? kRegisteredPerNoteController : kAssignablePerNoteController, channel, noteNumber, idx, ToUnipolar32(value));
+  }
+
+  /** @return \c true if this is a MIDI 2.0 channel voice message */
+  bool IsChannelVoiceMsg() const
+  {
+    return (mWords[0] >> 28) == kMessageType;
+  }
+
+  /** @return The UMP group [0, 15] */
+  int Group() const
+  {
+    return (mWords[0] >> 24) & 0x0F;
+  }
+
+  /** Gets the MIDI 2.0 status message
+   * @return EStatusMsg */
+  EStatusMsg StatusMsg() const
+  {
+    return static_cast<EStatusMsg>((mWords[0] >> 20) & 0x0F);
+  }
+
+  /** Gets the channel of a MIDI message
+   * @return [0, 15] for midi channels 1 ... 16 */
+  int Channel() const
+  {
+    return (mWords[0] >> 16) & 0x0F;
+  }
+
+  /** Gets the MIDI note number
+   * @return [0, 127], -1 if NA */
+  int NoteNumber() const
+  {
+    switch (StatusMsg())
+    {
+      case kRegisteredPerNoteController:
+      case kAssignablePerNoteController:
+      case kPerNotePitchBend:
+      case kNoteOff:
+      case kNoteOn:
+      case kPolyPressure:
+      case kPerNoteManagement:
+        return (mWords[0] >> 8) & 0x7F;
+      default:
+        return -1;
+    }
+  }
+
+  /** Get the velocity of a NoteOn/NoteOff message
+   * @return [0, 1], -1 if NA */
+  double Velocity() const
+  {
+    switch (StatusMsg())
+    {
+      case kNoteOn:
+      case kNoteOff:
+        return (mWords[1] >> 16) / 65535.0;
+      default:
+        return -1.0;
+    }
+  }
+
+  /** Gets the controller index of a Control Change or per-note controller message, or the index within the bank of a registered or assignable controller
+   * @return [0, 127] for Control Change, [0, 255] for per-note controllers, -1 if NA */
+  int ControllerIdx() const
+  {
+    switch (StatusMsg())
+    {
+      case kControlChange:
+        return (mWords[0] >> 8) & 0x7F;
+      case kRegisteredPerNoteController:
+      case kAssignablePerNoteController:
+      case kRegisteredController:
+      case kAssignableController:
+      case kRelativeRegisteredController:
+      case kRelativeAssignableController:
+        return mWords[0] & 0xFF;
+      default:
+        return -1;
+    }
+  }
+
+  /** Get the program index from a Program Change message
+   * @return [0, 127], -1 if NA */
+  int Program() const
+  {
+    if (StatusMsg() == kProgramChange)
+      return mWords[1] >> 24;
+
+    return -1;
+  }
+
+  /** Get the value of a pressure or controller message, which have 32 bit resolution
+   * @return [0, 1] */
+  double Value() const
+  {
+    return mWords[1] / 4294967295.0;
+  }
+
+  /** Get the value of a Pitch Bend or Per-Note Pitch Bend message
+   * @return [-1.0, 1.0], zero if NA */
+  double PitchBend() const
+  {
+    const EStatusMsg status = StatusMsg();
+
+    if (status == kPitchBend || status == kPerNotePitchBend)
+      return (static_cast<double>(mWords[1]) - 2147483648.0) / 2147483648.0;
+
+    return 0.0;
+  }
+
+  /** Convert a MIDI 1.0 message, with values scaled up as described in the UMP specification
+   * @param msg The MIDI 1.0 message
+   * @param group UMP group [0, 15]
+   * @return The MIDI 2.0 message, or a message for which IsChannelVoiceMsg() is \c false if msg is not a channel voice message */
+  static IMidi2Msg FromMidi1(const IMidiMsg& msg, int group = 0)
+  {
+    IMidi2Msg msg2(msg.mOffset);
+    const int channel = msg.Channel();
+
+    switch (msg.StatusMsg())
+    {
+      case IMidiMsg::kNoteOn:
+        if (msg.mData2 == 0) // MIDI 1.0 note on with a velocity of 0 is a note off
+          msg2.Set(msg.mOffset, group, kNoteOff, channel, msg.mData1, 0, 0);
+        else
+          msg2.Set(msg.mOffset, group, kNoteOn, channel, msg.mData1, 0, Upscale(msg.mData2, 7, 16) << 16);
+        break;
+      case IMidiMsg::kNoteOff:
+        msg2.Set(msg.mOffset, group, kNoteOff, channel, msg.mData1, 0, Upscale(msg.mData2, 7, 16) << 16);
+        break;
+      case IMidiMsg::kPolyAftertouch:
+        msg2.Set(msg.mOffset, group, kPolyPressure, channel, msg.mData1, 0, Upscale(msg.mData2, 7, 32));
+        break;
+      case IMidiMsg::kControlChange:
+        msg2.Set(msg.mOffset, group, kControlChange, channel, msg.mData1, 0, Upscale(msg.mData2, 7, 32));
+        break;
+      case IMidiMsg::kProgramChange:
+        msg2.Set(msg.mOffset, group, kProgramChange, channel, 0, 0, static_cast<uint32_t>(msg.mData1 & 0x7F) << 24);
+        break;
+      case IMidiMsg::kChannelAftertouch:
+        msg2.Set(msg.mOffset, group, kChannelPressure, channel, 0, 0, Upscale(msg.mData1, 7, 32));
+        break;
+      case IMidiMsg::kPitchWheel:
+        msg2.Set(msg.mOffset, group, kPitchBend, channel, 0, 0, Upscale((msg.mData2 << 7) | msg.mData1, 14, 32));
+        break;
+      default:
+        break;
+    }
+
+    return msg2;
+  }
+
+  /** Convert to a MIDI 1.0 message, with values scaled down as described in the UMP specification
+   * @param msg The MIDI 1.0 message, which is set if this message can be converted
+   * @return \c true if this message has a MIDI 1.0 equivalent. Per-note controllers, per-note pitch bend, per-note management and registered or assignable controllers do not */
+  bool ToMidi1(IMidiMsg& msg) const
+  {
+    if (!IsChannelVoiceMsg())
+      return false;
+
+    const int channel = Channel();
+    const uint8_t data1 = (mWords[0] >> 8) & 0x7F;
+
+    switch (StatusMsg())
+    {
+      case kNoteOn:
+      {
+        // a MIDI 2.0 note on with a velocity of 0 is still a note on
+        const uint8_t velocity = static_cast<uint8_t>(std::max<uint32_t>(mWords[1] >> 25, 1));
+        msg = IMidiMsg(mOffset, (IMidiMsg::kNoteOn << 4) | channel, data1, velocity);
+        return true;
+      }
+      case kNoteOff:
+        msg = IMidiMsg(mOffset, (IMidiMsg::kNoteOff << 4) | channel, data1, mWords[1] >> 25);
+        return true;
+      case kPolyPressure:
+        msg = IMidiMsg(mOffset, (IMidiMsg::kPolyAftertouch << 4) | channel, data1, mWords[1] >> 25);
+        return true;
+      case kControlChange:
+        msg = IMidiMsg(mOffset, (IMidiMsg::kControlChange << 4) | channel, data1, mWords[1] >> 25);
+        return true;
+      case kProgramChange:
+        msg = IMidiMsg(mOffset, (IMidiMsg::kProgramChange << 4) | channel, (mWords[1] >> 24) & 0x7F, 0);
+        return true;
+      case kChannelPressure:
+        msg = IMidiMsg(mOffset, (IMidiMsg::kChannelAftertouch << 4) | channel, mWords[1] >> 25, 0);
+        return true;
+      case kPitchBend:
+      {
+        const uint32_t bend = mWords[1] >> 18;
+        msg = IMidiMsg(mOffset, (IMidiMsg::kPitchWheel << 4) | channel, bend & 0x7F, (bend >> 7) & 0x7F);
+        return true;
+      }
+      default:
+        return false;
+    }
+  }
+
+  /** Scale a value up to a higher resolution, so that the minimum, the center and the maximum are kept, as described in the UMP specification
+   * @param value The value
+   * @param srcBits The resolution of the value
+   * @param dstBits The resolution to scale to, up to 32
+   * @return The scaled value */
+  static uint32_t Upscale(uint32_t value, int srcBits, int dstBits)
+  {
+    const int scaleBits = dstBits - srcBits;
+    uint32_t result = value << scaleBits;
+    const uint32_t center = 1u << (srcBits - 1);
+
+    if (value <= center)
+      return result;
+
+    // above the center, repeat the bits below the top bit of the value to fill the lower bits, so that the maximum maps to the maximum
+    const int repeatBits = srcBits - 1;
+    uint32_t repeatValue = value & ((1u << repeatBits) - 1);
+
+    if (scaleBits > repeatBits)
+      repeatValue <<= scaleBits - repeatBits;
+    else
+      repeatValue >>= repeatBits - scaleBits;
+
+    while (repeatValue)
+    {
+      result |= repeatValue;
+      repeatValue >>= repeatBits;
+    }
+
+    return result;
+  }
+
+  /** Clear the message */
+  void Clear()
+  {
+    mOffset = 0;
+    mWords[0] = mWords[1] = 0;
+  }
+
+  /** Print a message (DEBUG BUILDS) */
+  void PrintMsg() const
+  {
+    DBGMSG("midi2: offset %i, (%d:%d:%d:%08X:%08X)\n", mOffset, Group(), StatusMsg(), Channel(), mWords[0], mWords[1]);
+  }
+
+private:
+  void Set(int offset, int group, EStatusMsg status, int channel, int byte2, int byte3, uint32_t data)
+  {
+    mOffset = offset;
+    mWords[0] = (kMessageType << 28) | ((group & 0x0F) << 24) | (status << 20) | ((channel & 0x0F) << 16) | ((byte2 & 0xFF) << 8) | (byte3 & 0xFF);
+    mWords[1] = data;
+  }
+
+  static uint16_t ToUnipolar16(double value)
+  {
+    return static_cast<uint16_t>(std::min(std::max(value, 0.0), 1.0) * 65535.0 + 0.5);
+  }
+
+  static uint32_t ToUnipolar32(double value)
+  {
+    return static_cast<uint32_t>(std::min(std::max(value, 0.0), 1.0) * 4294967295.0 + 0.5);
+  }
+
+  static uint32_t ToBipolar32(double value)
+  {
+    return static_cast<uint32_t>(std::min((std::min(std::max(value, -1.0), 1.0) + 1.0) * 2147483648.0, 4294967295.0));
+  }
+};
+
 /*
 
 IMidiQueue
@@ -672,25 +1097,26 @@ void MyPlug::ProcessBlock(double** inputs, double** outputs, int nFrames)
   #define DEFAULT_BLOCK_SIZE 512
 #endif
 
-/** A class to help with queuing timestamped MIDI messages
+/** A class to help with queuing timestamped MIDI messages, IMidiMsg or IMidi2Msg, see IMidiQueue and IMidi2Queue
   * @ingroup IPlugUtilities */
-class IMidiQueue
+template <class T>
+class IMidiQueueBase
 {
 public:
-  IMidiQueue(int size = DEFAULT_BLOCK_SIZE)
+  IMidiQueueBase(int size = DEFAULT_BLOCK_SIZE)
   : mBuf(NULL), mSize(0), mGrow(Granulize(size)), mFront(0), mBack(0)
   {
     Expand();
   }
   
-  ~IMidiQueue()
+  ~IMidiQueueBase()
   {
     free(mBuf);
   }
 
   // Adds a MIDI message at the back of the queue. If the queue is full,
   // it will automatically expand itself.
-  void Add(const IMidiMsg& msg)
+  void Add(const T& msg)
   {
     if (mBack >= mSize)
     {
@@ -706,7 +1132,7 @@ public:
       int i = mBack - 2;
       while (i >= mFront && msg.mOffset < mBuf[i].mOffset) --i;
       i++;
-      memmove(&mBuf[i + 1], &mBuf[i], (mBack - i) * sizeof(IMidiMsg));
+      memmove(&mBuf[i + 1], &mBuf[i], (mBack - i) * sizeof(T));
       mBuf[i] = msg;
     }
     else
@@ -731,7 +1157,7 @@ public:
 
   // Returns the "next" MIDI message (all the way in the front of the
   // queue), but does *not* remove it from the queue.
-  inline IMidiMsg& Peek() const { return mBuf[mFront]; }
+  inline T& Peek() const { return mBuf[mFront]; }
 
   // Moves back MIDI messages all the way to the front of the queue, thus
   // freeing up space at the back, and updates the sample offset of the
@@ -757,10 +1183,10 @@ public:
     if (size < mBack) size = Granulize(mBack);
     if (size == mSize) return mSize;
 
-    void* buf = realloc(mBuf, size * sizeof(IMidiMsg));
+    void* buf = realloc(mBuf, size * sizeof(T));
     if (!buf) return mSize;
 
-    mBuf = (IMidiMsg*)buf;
+    mBuf = (T*)buf;
     mSize = size;
     return size;
   }
@@ -772,10 +1198,10 @@ protected:
     if (!mGrow) return false;
     int size = (mSize / mGrow + 1) * mGrow;
 
-    void* buf = realloc(mBuf, size * sizeof(IMidiMsg));
+    void* buf = realloc(mBuf, size * sizeof(T));
     if (!buf) return false;
 
-    mBuf = (IMidiMsg*)buf;
+    mBuf = (T*)buf;
     mSize = size;
     return true;
   }
@@ -784,23 +1210,171 @@ protected:
   inline void Compact()
   {
     mBack -= mFront;
-    if (mBack > 0) memmove(&mBuf[0], &mBuf[mFront], mBack * sizeof(IMidiMsg));
+    if (mBack > 0) memmove(&mBuf[0], &mBuf[mFront], mBack * sizeof(T));
     mFront = 0;
   }
 
   // Rounds the MIDI queue size up to the next 4 kB memory page size.
   inline int Granulize(int size) const
   {
-    int bytes = size * sizeof(IMidiMsg);
+    int bytes = size * sizeof(T);
     int rest = bytes % 4096;
-    if (rest) size = (bytes - rest + 4096) / sizeof(IMidiMsg);
+    if (rest) size = (bytes - rest + 4096) / sizeof(T);
     return size;
   }
 
-  IMidiMsg* mBuf;
+  T* mBuf;
 
   int mSize, mGrow;
   int mFront, mBack;
 };
 
+using IMidiQueue = IMidiQueueBase<IMidiMsg>;
+using IMidi2Queue = IMidiQueueBase<IMidi2Msg>;
+
+/** A fixed capacity queue of timestamped MIDI messages, IMidiMsg or IMidi2Msg, with the same interface as IMidiQueueBase, that is safe to use on the audio thread.
+ * Memory is only allocated by Resize(), and a message that doesn't fit is dropped and counted, see GetNumDropped(), rather than the queue growing.
+ * The messages are kept in a binary heap ordered by offset, so adding one out of order costs O(log n) rather than moving the ones after it,
+ * and messages with the same offset come out in the order they were added. See IFixedMidiQueue and IFixedMidi2Queue
+ * @ingroup IPlugUtilities */
+template <class T>
+class IFixedMidiQueueBase
+{
+public:
+  IFixedMidiQueueBase(int size = DEFAULT_BLOCK_SIZE)
+  {
+    Resize(size);
+  }
+
+  /** Adds a message, which will come out in order of its offset
+   * @return \c false if the queue is full and the message was dropped */
+  bool Add(const T& msg)
+  {
+    if (mCount >= mBuf.GetSize())
+    {
+      mNumDropped++;
+      return false;
+    }
+
+    // the sequence only needs to order the messages in the queue, so it restarts whenever the queue empties
+    if (!mCount)
+      mNextSeq = 0;
+
+    const Entry entry { msg, mNextSeq++ };
+    Entry* pHeap = mBuf.Get();
+    int i = mCount++;
+
+    while (i > 0)
+    {
+      const int parent = (i - 1) / 2;
+
+      if (!Before(entry, pHeap[parent]))
+        break;
+
+      pHeap[i] = pHeap[parent];
+      i = parent;
+    }
+
+    pHeap[i] = entry;
+    return true;
+  }
+
+  /** Removes the message at the front of the queue, the one with the lowest offset */
+  void Remove()
+  {
+    if (!mCount)
+      return;
+
+    Entry* pHeap = mBuf.Get();
+    const Entry last = pHeap[--mCount];
+    int i = 0;
+
+    for (;;)
+    {
+      int child = 2 * i + 1;
+
+      if (child >= mCount)
+        break;
+
+      if (child + 1 < mCount && Before(pHeap[child + 1], pHeap[child]))
+        child++;
+
+      if (!Before(pHeap[child], last))
+        break;
+
+      pHeap[i] = pHeap[child];
+      i = child;
+    }
+
+    pHeap[i] = last;
+  }
+
+  /** @return \c true if the queue is empty */
+  bool Empty() const { return mCount == 0; }
+
+  /** @return The number of messages in the queue */
+  int ToDo() const { return mCount; }
+
+  /** @return The number of messages the queue can hold */
+  int GetSize() const { return mBuf.GetSize(); }
+
+  /** @return The message at the front of the queue, without removing it. The queue must not be empty */
+  T& Peek() { return mBuf.Get()[0].msg; }
+  const T& Peek() const { return mBuf.Get()[0].msg; }
+
+  /** Subtracts nFrames from the offsets of the messages that are left, at the end of a block */
+  void Flush(int nFrames)
+  {
+    Entry* pHeap = mBuf.Get();
+
+    // every offset moves by the same amount, so the heap stays in order
+    for (auto i = 0; i < mCount; ++i)
+      pHeap[i].msg.mOffset -= nFrames;
+  }
+
+  /** Removes all of the messages */
+  void Clear() { mCount = 0; }
+
+  /** Sets the capacity of the queue. This allocates, so don't call it on the audio thread, e.g. call it in OnReset() with the block size
+   * @param size The number of messages to make room for. The queue doesn't shrink below the messages already in it
+   * @return The new capacity */
+  int Resize(int size)
+  {
+    size = std::max(size, mCount);
+
+    if (size != mBuf.GetSize())
+      mBuf.Resize(size, false);
+
+    return mBuf.GetSize();
+  }
+
+  /** @return The number of messages that were dropped because the queue was full, since the queue was created or ResetNumDropped() was called */
+  int GetNumDropped() const { return mNumDropped; }
+
+  void ResetNumDropped() { mNumDropped = 0; }
+
+private:
+  struct Entry
+  {
+    T msg;
+    uint32_t seq;
+  };
+
+  static bool Before(const Entry& a, const Entry& b)
+  {
+    if (a.msg.mOffset != b.msg.mOffset)
+      return a.msg.mOffset < b.msg.mOffset;
+
+    return static_cast<int32_t>(a.seq - b.seq) < 0;
+  }
+
+  WDL_TypedBuf<Entry> mBuf;
+  int mCount = 0;
+  int mNumDropped = 0;
+  uint32_t mNextSeq = 0;
+};
+
+using IFixedMidiQueue = IFixedMidiQueueBase<IMidiMsg>;
+using IFixedMidi2Queue = IFixedMidiQueueBase<IMidi2Msg>;
+
 END_IPLUG_NAMESPACE
@@ -0,0 +1,306 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc IParamDesc
+ */
+
+#include <array>
+#include <cstddef>
+
+#include "IPlugParameter.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** A description of a parameter that can be made at compile time, so that a plug-in's parameters can be written as one constexpr table,
+ * checked with static_assert(ParamDescsAreValid()), and initialised in one go with IPluginBase::InitParams(), rather than one Init call each in the plug-in's constructor.
+ * The factories mirror the IParam::Init methods, with the same defaults, and InitParam() calls the matching one, so a parameter made from a description
+ * is the same as one made the usual way.
+ * @code
+ * static constexpr const char* kModeNames[] = {"Clean", "Warm", "Hot"};
+ *
+ * static constexpr IParamDesc kParamDescs[] = {
+ *   IParamDesc::Gain(kGain, "Gain", 0., -70., 12.),
+ *   IParamDesc::Frequency(kCutoff, "Cutoff", 1000., 20., 20000.),
+ *   IParamDesc::Enum(kMode, "Mode", 0, kModeNames),
+ * };
+ *
+ * static_assert(ParamDescsAreValid(kParamDescs, kNumParams), "Bad parameter table");
+ *
+ * // in the constructor
+ * InitParams(kParamDescs);
+ * @endcode */
+struct IParamDesc
+{
+  /** The kind of parameter, which is the IParam::Init method that InitParam() calls */
+  enum EKind { kKindDouble, kKindBool, kKindInt, kKindEnum, kKindGain, kKindPercentage, kKindFrequency, kKindMilliseconds, kKindSeconds };
+
+  /** The shape of a kKindDouble parameter */
+  enum EShape { kShapeLinear, kShapePowCurve, kShapeExp };
+
+  int paramIdx = kNoParameter;
+  EKind kind = kKindDouble;
+  const char* name = "";
+  double defaultVal = 0.;
+  double minVal = 0.;
+  double maxVal = 1.;
+  double step = 0.001;
+  const char* label = "";
+  int flags = 0;
+  const char* group = "";
+  EShape shape = kShapeLinear;
+  double shapeValue = 1.; // the ShapePowCurve exponent
+  IParam::EParamUnit unit = IParam::kUnitCustom;
+  const char* const* enumTexts = nullptr;
+  int nEnums = 0;
+  const char* offText = "off";
+  const char* onText = "on";
+
+  /** @see IParam::InitDouble() */
+  static constexpr IParamDesc Double(int paramIdx, const char* name, double defaultVal, double minVal, double maxVal, double step, const char* label = "", int flags = 0, const char* group = "", IParam::EParamUnit unit = IParam::kUnitCustom)
+  {
+    IParamDesc d;
+    d.paramIdx = paramIdx; d.kind = kKindDouble; d.name = name; d.defaultVal = defaultVal; d.minVal = minVal; d.maxVal = maxVal; d.step = step;
+    d.label = label; d.flags = flags; d.group = group; d.unit = unit;
+    return d;
+  }
+
+  /** @see IParam::InitBool() */
+  static constexpr IParamDesc Bool(int paramIdx, const char* name, bool defaultVal, const char* label = "", int flags = 0, const char* group = "", const char* offText = "off", const char* onText = "on")
+  {
+    IParamDesc d = Double(paramIdx, name, defaultVal ? 1. : 0., 0., 1., 1., label, flags, group);
+    d.kind = kKindBool; d.offText = offText; d.onText = onText;
+    return d;
+  }
+
+  /** @see IParam::InitInt() */
+  static constexpr IParamDesc Int(int paramIdx, const char* name, int defaultVal, int minVal, int maxVal, const char* label = "", int flags = 0, const char* group = "")
+  {
+    IParamDesc d = Double(paramIdx, name, defaultVal, minVal, maxVal, 1., label, flags, group);
+    d.kind = kKindInt;
+    return d;
+  }
+
+  /** @see IParam::InitEnum()
+   * @param texts An array of the display texts, which must outlive the description, so normally a static constexpr array */
+  template <size_t N>
+  static constexpr IParamDesc Enum(int paramIdx, const char* name, int defaultVal, const char* const (&texts)[N], int flags = 0, const char* group = "")
+  {
+    IParamDesc d = Double(paramIdx, name, defaultVal, 0., static_cast<double>(N - 1), 1., "", flags, group);
+    d.kind = kKindEnum; d.enumTexts = texts; d.nEnums = static_cast<int>(N);
+    return d;
+  }
+
+  /** @see IParam::InitGain() */
+  static constexpr IParamDesc Gain(int paramIdx, const char* name, double defaultVal = 0., double minVal = -70., double maxVal = 24., double step = 0.5, int flags = 0, const char* group = "")
+  {
+    IParamDesc d = Double(paramIdx, name, defaultVal, minVal, maxVal, step, "dB", flags, group, IParam::kUnitDB);
+    d.kind = kKindGain;
+    return d;
+  }
+
+  /** @see IParam::InitPercentage() */
+  static constexpr IParamDesc Percentage(int paramIdx, const char* name, double defaultVal = 0., double minVal = 0., double maxVal = 100., int flags = 0, const char* group = "")
+  {
+    IParamDesc d = Double(paramIdx, name, defaultVal, minVal, maxVal, 1., "%", flags, group, IParam::kUnitPercentage);
+    d.kind = kKindPercentage;
+    return d;
+  }
+
+  /** @see IParam::InitFrequency() */
+  static constexpr IParamDesc Frequency(int paramIdx, const char* name, double defaultVal = 1000., double minVal = 0.1, double maxVal = 10000., double step = 0.1, int flags = 0, const char* group = "")
+  {
+    IParamDesc d = Double(paramIdx, name, defaultVal, minVal, maxVal, step, "Hz", flags, group, IParam::kUnitFrequency);
+    d.kind = kKindFrequency; d.shape = kShapeExp;
+    return d;
+  }
+
+  /** @see IParam::InitMilliseconds() */
+  static constexpr IParamDesc Milliseconds(int paramIdx, const char* name, double defaultVal = 1., double minVal = 0., double maxVal = 100., int flags = 0, const char* group = "")
+  {
+    IParamDesc d = Double(paramIdx, name, defaultVal, minVal, maxVal, 1., "ms", flags, group, IParam::kUnitMilliseconds);
+    d.kind = kKindMilliseconds;
+    return d;
+  }
+
+  /** @see IParam::InitSeconds() */
+  static constexpr IParamDesc Seconds(int paramIdx, const char* name, double defaultVal = 1., double minVal = 0., double maxVal = 10., double step = 0.1, int flags = 0, const char* group = "")
+  {
+    IParamDesc d = Double(paramIdx, name, defaultVal, minVal, maxVal, step, "Seconds", flags, group, IParam::kUnitSeconds);
+    d.kind = kKindSeconds;
+    return d;
+  }
+
+  /** @return A copy of a kKindDouble description with a ShapePowCurve, e.g. IParamDesc::Double(...).WithPowCurve(3.) */
+  constexpr IParamDesc WithPowCurve(double exponent) const
+  {
+    IParamDesc d = *this;
+    d.shape = kShapePowCurve; d.shapeValue = exponent;
+    return d;
+  }
+
+  /** @return A copy of a kKindDouble description with a ShapeExp */
+  constexpr IParamDesc WithExpShape() const
+  {
+    IParamDesc d = *this;
+    d.shape = kShapeExp;
+    return d;
+  }
+
+  /** Initialise a parameter from the description, with the IParam::Init method for its kind */
+  void InitParam(IParam& param) const
+  {
+    switch (kind)
+    {
+      case kKindBool: param.InitBool(name, defaultVal > 0.5, label, flags, group, offText, onText); break;
+      case kKindInt: param.InitInt(name, static_cast<int>(defaultVal), static_cast<int>(minVal), static_cast<int>(maxVal), label, flags, group); break;
+      case kKindEnum:
+        param.InitEnum(name, static_cast<int>(defaultVal), nEnums, label, flags, group);
+        for (int i = 0; i < nEnums; i++)
+          param.SetDisplayText(i, enumTexts[i]);
+        break;
+      case kKindGain: param.InitGain(name, defaultVal, minVal, maxVal, step, flags, group); break;
+      case kKindPercentage: param.InitPercentage(name, defaultVal, minVal, maxVal, flags, group); break;
+      case kKindFrequency: param.InitFrequency(name, defaultVal, minVal, maxVal, step, flags, group); break;
+      case kKindMilliseconds: param.InitMilliseconds(name, defaultVal, minVal, maxVal, flags, group); break;
+      case kKindSeconds: param.InitSeconds(name, defaultVal, minVal, maxVal, step, flags, group); break;
+      case kKindDouble:
+      default:
+        if (shape == kShapePowCurve)
+          param.InitDouble(name, defaultVal, minVal, maxVal, step, label, flags, group, IParam::ShapePowCurve(shapeValue), unit);
+        else if (shape == kShapeExp)
+          param.InitDouble(name, defaultVal, minVal, maxVal, step, label, flags, group, IParam::ShapeExp(), unit);
+        else
+          param.InitDouble(name, defaultVal, minVal, maxVal, step, label, flags, group, IParam::ShapeLinear(), unit);
+        break;
+    }
+  }
+
+  /** @return The length of a CString, at compile time */
+  static constexpr int StrLen(const char* str)
+  {
+    int len = 0;
+
+    while (str && str[len])
+      len++;
+
+    return len;
+  }
+
+  /** @return \c true if the description can make a parameter: a name that fits, a default within a range that isn't empty, and a ShapeExp that doesn't cross 0 */
+  constexpr bool IsValid() const
+  {
+    return StrLen(name) > 0 && StrLen(name) < MAX_PARAM_NAME_LEN && StrLen(label) < MAX_PARAM_LABEL_LEN && StrLen(group) < MAX_PARAM_GROUP_LEN
+      && minVal < maxVal && defaultVal >= minVal && defaultVal <= maxVal && step > 0.
+      && (shape != kShapeExp || minVal >= 0.) && (shape != kShapePowCurve || shapeValue > 0.)
+      && (kind != kKindEnum || (enumTexts && nEnums > 1));
+  }
+};
+
+/** Check a plug-in's table of parameter descriptions at compile time, with static_assert(ParamDescsAreValid(kParamDescs, kNumParams))
+ * @return \c true if there is one description for each parameter, in order of its index, and each is IParamDesc::IsValid() */
+template <size_t N>
+constexpr bool ParamDescsAreValid(const IParamDesc (&descs)[N], int nParams)
+{
+  if (static_cast<int>(N) != nParams)
+    return false;
+
+  for (size_t i = 0; i < N; i++)
+  {
+    if (descs[i].paramIdx != static_cast<int>(i) || !descs[i].IsValid())
+      return false;
+  }
+
+  return true;
+}
+
+/** A function of the plug-in that handles changes to one parameter, for IParamDispatchTable */
+template <class Plug>
+struct IParamHandler
+{
+  int paramIdx;
+  void (Plug::*func)(double value);
+};
+
+/** Maps each parameter index to a member function of the plug-in that handles its changes, built at compile time from a list of IParamHandler,
+ * so that OnParamChange() is one indexed call instead of a switch.
+ * @code
+ * static constexpr IParamHandler<MyPlugin> kHandlers[] = {
+ *   {kGain, &MyPlugin::OnGainChange},
+ *   {kCutoff, &MyPlugin::OnCutoffChange},
+ * };
+ *
+ * static_assert(ParamHandlersAreValid(kHandlers, kNumParams), "Bad handler table");
+ * static constexpr IParamDispatchTable<MyPlugin, kNumParams> kDispatch {kHandlers};
+ *
+ * void MyPlugin::OnParamChange(int paramIdx) { kDispatch.Dispatch(*this, paramIdx, GetParam(paramIdx)->Value()); }
+ * @endcode */
+template <class Plug, int NParams>
+class IParamDispatchTable
+{
+public:
+  using Handler = void (Plug::*)(double value);
+
+  /** @param handlers The handlers, which should be checked with ParamHandlersAreValid(), as ones with an index out of range are ignored */
+  template <size_t N>
+  constexpr IParamDispatchTable(const IParamHandler<Plug> (&handlers)[N])
+  {
+    for (size_t i = 0; i < N; i++)
+    {
+      if (handlers[i].paramIdx >= 0 && handlers[i].paramIdx < NParams)
+        mHandlers[handlers[i].paramIdx] = handlers[i].func;
+    }
+  }
+
+  /** Call the handler of a parameter
+   * @param plug The plug-in
+   * @param paramIdx The index of the parameter that changed
+   * @param value The parameter's value, passed to the handler
+   * @return \c false if the parameter has no handler */
+  bool Dispatch(Plug& plug, int paramIdx, double value) const
+  {
+    if (paramIdx < 0 || paramIdx >= NParams || !mHandlers[paramIdx])
+      return false;
+
+    (plug.*mHandlers[paramIdx])(value);
+    return true;
+  }
+
+  /** @return \c true if the parameter has a handler */
+  constexpr bool HasHandler(int paramIdx) const { return paramIdx >= 0 && paramIdx < NParams && mHandlers[paramIdx] != nullptr; }
+
+private:
+  std::array<Handler, NParams> mHandlers {};
+};
+
+/** Check a list of IParamHandler at compile time
+ * @return \c true if every handler has a parameter index in range, a function, and no two handle the same parameter */
+template <class Plug, size_t N>
+constexpr bool ParamHandlersAreValid(const IParamHandler<Plug> (&handlers)[N], int nParams)
+{
+  for (size_t i = 0; i < N; i++)
+  {
+    if (handlers[i].paramIdx < 0 || handlers[i].paramIdx >= nParams || !handlers[i].func)
+      return false;
+
+    for (size_t j = i + 1; j < N; j++)
+    {
+      if (handlers[j].paramIdx == handlers[i].paramIdx)
+        return false;
+    }
+  }
+
+  return true;
+}
+
+END_IPLUG_NAMESPACE
@@ -15,6 +15,7 @@
 
 #include <cstdio>
 #include <algorithm>
+#include <typeinfo>
 
 #include "IPlugParameter.h"
 #include "IPlugLogger.h"
@@ -79,11 +80,75 @@ double IParam::ShapeExp::ValueToNormalized(double value, const IParam& param) co
   return (std::log(value) - mAdd) / mMul;
 }
 
+IParam::ShapeLUT::ShapeLUT(const Shape& shape, int size)
+: mShape(shape.Clone())
+, mSize(std::max(size, 1))
+{
+}
+
+IParam::ShapeLUT::ShapeLUT(const ShapeLUT& other)
+: mShape(other.mShape->Clone())
+, mSize(other.mSize)
+, mTable(other.mTable)
+{
+}
+
+void IParam::ShapeLUT::Init(const IParam& param)
+{
+  mShape->Init(param);
+  mTable.resize(mSize + 1);
+
+  for (int i = 0; i <= mSize; i++)
+    mTable[i] = mShape->NormalizedToValue(static_cast<double>(i) / mSize, param);
+}
+
+double IParam::ShapeLUT::NormalizedToValue(double value, const IParam& param) const
+{
+  const double pos = Clip(value, 0., 1.) * mSize;
+  const int idx = std::min(static_cast<int>(pos), mSize - 1);
+  return mTable[idx] + (pos - idx) * (mTable[idx + 1] - mTable[idx]);
+}
+
+double IParam::ShapeLUT::ValueToNormalized(double value, const IParam& param) const
+{
+  // the table is ascending, so search it rather than keeping an inverse table, which would be poor where the shape is steep
+  const auto it = std::upper_bound(mTable.begin() + 1, mTable.end() - 1, value);
+  const int idx = static_cast<int>(it - mTable.begin()) - 1;
+  const double width = mTable[idx + 1] - mTable[idx];
+  const double frac = width > 0. ? Clip((value - mTable[idx]) / width, 0., 1.) : 0.;
+  return (idx + frac) / mSize;
+}
+
+void IParam::ShapeLUT::NormalizedToValues(const double* pValues, double* pResults, int n, const IParam& param) const
+{
+  const double* pTable = mTable.data();
+  const double size = mSize;
+
+  for (int i = 0; i < n; i++)
+  {
+    const double pos = Clip(pValues[i], 0., 1.) * size;
+    const int idx = std::min(static_cast<int>(pos), mSize - 1);
+    pResults[i] = pTable[idx] + (pos - idx) * (pTable[idx + 1] - pTable[idx]);
+  }
+}
+
 #pragma mark -
 
+void IParam::ShapeDeleter::operator()(Shape* pShape) const
+{
+  if (pShape != GetSharedLinearShape())
+    delete pShape;
+}
+
+IParam::Shape* IParam::GetSharedLinearShape()
+{
+  static ShapeLinear sLinear;
+  return &sLinear;
+}
+
 IParam::IParam()
+: mShape(GetSharedLinearShape())
 {
-  mShape = std::make_unique<ShapeLinear>();
   memset(mName, 0, MAX_PARAM_NAME_LEN * sizeof(char));
   memset(mLabel, 0, MAX_PARAM_LABEL_LEN * sizeof(char));
   memset(mParamGroup, 0, MAX_PARAM_LABEL_LEN * sizeof(char));
@@ -166,7 +231,11 @@ void IParam::InitDouble(const char* name, double defaultVal, double minVal, doub
     ;
   }
     
-  mShape = std::unique_ptr<Shape>(shape.Clone());
+  if (typeid(shape) == typeid(ShapeLinear))
+    mShape.reset(GetSharedLinearShape());
+  else
+    mShape.reset(shape.Clone());
+
   mShape->Init(*this);
 }
 
@@ -245,6 +314,14 @@ void IParam::Init(const IParam& p, const char* searchStr, const char* replaceStr
   }
 }
 
+void IParam::FromNormalized(const double* pNormalizedValues, double* pValues, int n) const
+{
+  mShape->NormalizedToValues(pNormalizedValues, pValues, n, *this);
+
+  for (int i = 0; i < n; i++)
+    pValues[i] = Constrain(pValues[i]);
+}
+
 void IParam::SetDisplayText(double value, const char* str)
 {
   int n = mDisplayTexts.GetSize();
@@ -311,7 +388,7 @@ const char* IParam::GetName() const
 
 const char* IParam::GetLabel() const
 {
-  return (CStringHasContents(GetDisplayText(static_cast<int>(mValue.load())))) ? "" : mLabel;
+  return (CStringHasContents(GetDisplayText(static_cast<int>(mpValue->load())))) ? "" : mLabel;
 }
 
 const char* IParam::GetGroup() const
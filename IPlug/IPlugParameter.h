@@ -19,6 +19,7 @@
 #include <cstring>
 #include <functional>
 #include <memory>
+#include <vector>
 
 #include "wdlstring.h"
 
@@ -26,6 +27,66 @@
 
 BEGIN_IPLUG_NAMESPACE
 
+/** Contiguous storage for the values of a list of parameters, so that DSP code can read them all without chasing a pointer per IParam.
+ * Each value is an atomic, and writers bump a version as well, so that Snapshot() can copy all the values as they were at one instant without a lock */
+class ParamValueArray
+{
+public:
+  ParamValueArray() = default;
+  ParamValueArray(const ParamValueArray&) = delete;
+  ParamValueArray& operator=(const ParamValueArray&) = delete;
+
+  /** Reallocates the storage, which invalidates the slots. IEditorDelegate calls this when it rebinds its parameters
+   * @param size The number of values */
+  void Resize(int size)
+  {
+    mValues.reset(size ? new std::atomic<double>[size] : nullptr);
+    mSize = size;
+  }
+
+  int GetSize() const { return mSize; }
+
+  std::atomic<double>* GetSlot(int idx) { return mValues.get() + idx; }
+
+  /** @return The values, which can be read individually at any time */
+  const std::atomic<double>* Get() const { return mValues.get(); }
+
+  /** Called by IParam around each write */
+  void BeginWrite() { mWriters.fetch_add(1); }
+  void EndWrite() { mVersion.fetch_add(1); mWriters.fetch_sub(1); }
+
+  /** Copy all the values, as they were at one instant. This never blocks: if writes keep happening it gives up after maxAttempts,
+   * and the last copy has every value valid, but possibly from different writes
+   * @param pDst GetSize() values
+   * @param maxAttempts The number of times to try to copy the values without a write happening
+   * @return \c true if the copy is consistent */
+  bool Snapshot(double* pDst, int maxAttempts = 4) const
+  {
+    for (int attempt = 0; attempt < maxAttempts; attempt++)
+    {
+      const uint32_t version = mVersion.load();
+      const bool idle = mWriters.load() == 0;
+
+      for (int i = 0; i < mSize; i++)
+        pDst[i] = mValues[i].load(std::memory_order_relaxed);
+
+      std::atomic_thread_fence(std::memory_order_acquire);
+
+      // a write that started during the copy has either finished, and bumped the version, or is still in progress
+      if (idle && mWriters.load() == 0 && mVersion.load() == version)
+        return true;
+    }
+
+    return false;
+  }
+
+private:
+  std::unique_ptr<std::atomic<double>[]> mValues;
+  int mSize = 0;
+  std::atomic<uint32_t> mVersion {0};
+  std::atomic<uint32_t> mWriters {0};
+};
+
 /** IPlug's parameter class */
 class IParam
 {
@@ -55,6 +116,8 @@ public:
     kFlagSignDisplay      = 0x8,
     /** Indicates that the parameter may influence the state of other parameters */
     kFlagMeta             = 0x10,
+    /** Indicates that the parameter is an output of the plug-in, such as a meter or a gain reduction amount, which the plug-in sets while processing, see IPlugAPIBase::SetOutputParamValue(). Hosts show it, but can't change or automate it */
+    kFlagOutput           = 0x20,
   };
   
   /** DisplayFunc allows custom parameter display functions, defined by a lambda matching this signature */
@@ -88,6 +151,17 @@ public:
      * @param param The IParam to do the calculation against
      * @return double The normalized value */
     virtual double ValueToNormalized(double value, const IParam& param) const = 0;
+
+    /** Converts a block of normalized values to real values, see NormalizedToValue(). Override this if the shape can do it faster than one value at a time
+     * @param pValues The normalized values
+     * @param pResults The real values, which may be the same buffer as pValues
+     * @param n The number of values
+     * @param param The IParam to do the calculation against */
+    virtual void NormalizedToValues(const double* pValues, double* pResults, int n, const IParam& param) const
+    {
+      for (int i = 0; i < n; i++)
+        pResults[i] = NormalizedToValue(pValues[i], param);
+    }
   };
 
   /** Linear parameter shaping */
@@ -126,6 +200,26 @@ public:
     double mAdd = 1.0;
   };
 
+  /** Wraps another shape with a table of its values, built by Init(), so that conversions interpolate the table rather than calling pow(), exp() or log().
+   * It is an approximation: the error is largest where the wrapped shape curves the most, for instance near the minimum of a ShapePowCurve with a shape below 1 */
+  struct ShapeLUT : public Shape
+  {
+    /** @param shape The shape to tabulate
+     * @param size The number of segments in the table */
+    ShapeLUT(const Shape& shape, int size = 1024);
+    ShapeLUT(const ShapeLUT& other);
+    void Init(const IParam& param) override;
+    Shape* Clone() const override { return new ShapeLUT(*this); }
+    IParam::EDisplayType GetDisplayType() const override { return mShape->GetDisplayType(); }
+    double NormalizedToValue(double value, const IParam& param) const override;
+    double ValueToNormalized(double value, const IParam& param) const override;
+    void NormalizedToValues(const double* pValues, double* pResults, int n, const IParam& param) const override;
+
+    std::unique_ptr<Shape> mShape;
+    int mSize;
+    std::vector<double> mTable; // mSize + 1 values of the wrapped shape, at evenly spaced normalized values
+  };
+
 #pragma mark -
 
   IParam();
@@ -296,9 +390,15 @@ public:
     return Constrain(mShape->NormalizedToValue(normalizedValue, *this));
   }
 
+  /** Convert a block of normalized values to real values for this parameter, for instance a block of automation
+   * @param pNormalizedValues The normalized input values in the range 0. to 1.
+   * @param pValues The corresponding real values, which may be the same buffer as pNormalizedValues
+   * @param n The number of values */
+  void FromNormalized(const double* pNormalizedValues, double* pValues, int n) const;
+
   /** Sets the parameter value
    * @param value Value to be set. Will be stepped and clamped between \c mMin and \c mMax */
-  void Set(double value) { mValue.store(Constrain(value)); }
+  void Set(double value) { StoreValue(Constrain(value)); }
 
   /** Sets the parameter value from a normalized range (usually coming from the linked IControl)
    * @param normalizedValue The expected normalized value between 0. and 1. */
@@ -306,10 +406,10 @@ public:
 
   /** Set the parameter value using a textual representation
    * @param str The textual representations as a CString */
-  void SetString(const char* str) { mValue.store(StringToValue(str)); }
+  void SetString(const char* str) { StoreValue(StringToValue(str)); }
 
   /** Replaces the parameter's current value with the default one  */
-  void SetToDefault() { mValue.store(mDefault); }
+  void SetToDefault() { StoreValue(mDefault); }
 
   /** Set the parameter's default value, and set the parameter to that default
    * @param value The new default value */
@@ -334,30 +434,30 @@ public:
 
   /** Gets a readable value of the parameter
    * @return double Current value of the parameter */
-  double Value() const { return mValue.load(); }
+  double Value() const { return mpValue->load(); }
 
   /** Returns the parameter's value as a boolean
    * @return \c true if value >= 0.5, else otherwise */
-  bool Bool() const { return (mValue.load() >= 0.5); }
+  bool Bool() const { return (mpValue->load() >= 0.5); }
 
   /** Returns the parameter's value as an integer
   @return Current value of the parameter as an integer */
-  int Int() const { return static_cast<int>(mValue.load()); }
+  int Int() const { return static_cast<int>(mpValue->load()); }
   
   /** Gain based on parameter's current value in dB
    * @return double Gain calculated as an approximation of
    * \f$ 10^{\frac{x}{20}} \f$
    * @see #IAMP_DB */
-  double DBToAmp() const { return iplug::DBToAmp(mValue.load()); }
+  double DBToAmp() const { return iplug::DBToAmp(mpValue->load()); }
 
   /** Returns the parameter's normalized value
    * @return double The resulting normalized value */
-  double GetNormalized() const { return ToNormalized(mValue.load()); }
+  double GetNormalized() const { return ToNormalized(mpValue->load()); }
 
   /** Get the current textual display for the current parameter value
    * @param display \c WDL_String to fill with the results
    * @param withDisplayText Should the output include display texts */
-  void GetDisplay(WDL_String& display, bool withDisplayText = true) const { GetDisplay(mValue.load(), false, display, withDisplayText); }
+  void GetDisplay(WDL_String& display, bool withDisplayText = true) const { GetDisplay(mpValue->load(), false, display, withDisplayText); }
 
   /** Get the current textual display for a specified parameter value
    * @param value The value to get the display for
@@ -371,7 +471,7 @@ public:
    * @param withDisplayText Should the output include display texts */
   void GetDisplayWithLabel(WDL_String& display, bool withDisplayText = true) const
   {
-    GetDisplay(mValue.load(), false, display, withDisplayText);
+    GetDisplay(mpValue->load(), false, display, withDisplayText);
     const char* hostlabel = GetLabel();
     if (CStringHasContents(hostlabel))
     {
@@ -467,7 +567,7 @@ public:
   int GetFlags() const { return mFlags; }
 
   /** @return \c true If the parameter should be automateable  */
-  bool GetCanAutomate() const { return !(mFlags & kFlagCannotAutomate); }
+  bool GetCanAutomate() const { return !(mFlags & (kFlagCannotAutomate | kFlagOutput)); }
 
   /** @return \c true If the parameter should be discrete (stepped)  */
   bool GetStepped() const { return mFlags & kFlagStepped; }
@@ -480,6 +580,9 @@ public:
 
   /** @return \c true If the parameter is flagged as a "meta" parameter, e.g. one that could modify other parameters */
   bool GetMeta() const { return mFlags & kFlagMeta; }
+
+  /** @return \c true If the parameter is an output of the plug-in, which the host can't change, e.g. a meter */
+  bool GetIsOutput() const { return mFlags & kFlagOutput; }
  
   /** Get a JSON description of the parameter. 
    * @param json WDL_String to fill with the JSON
@@ -488,7 +591,31 @@ public:
 
   /** Helper to print the parameter details to debug console in debug builds */
   void PrintDetails() const;
+
+  /** Move the value into a slot of a ParamValueArray, or back into the IParam. IEditorDelegate does this for all of its parameters
+   * @param pArray The array, or nullptr to store the value in the IParam
+   * @param idx The index of the slot */
+  void BindValue(ParamValueArray* pArray, int idx)
+  {
+    std::atomic<double>* pValue = pArray ? pArray->GetSlot(idx) : &mValue;
+    pValue->store(mpValue->load());
+    mpValue = pValue;
+    mpValueArray = pArray;
+  }
+
 private:
+  void StoreValue(double value)
+  {
+    if (mpValueArray)
+    {
+      mpValueArray->BeginWrite();
+      mpValue->store(value);
+      mpValueArray->EndWrite();
+    }
+    else
+      mpValue->store(value);
+  }
+
   /** A DisplayText is used to link a certain real value of the parameter with a CString. For example -70 on a decibel gain parameter could instead read "-inf" */
   struct DisplayText
   {
@@ -499,6 +626,9 @@ private:
   EParamType mType = kTypeNone;
   EParamUnit mUnit = kUnitCustom;
   std::atomic<double> mValue{0.0};
+  /** Where the value is stored, which is mValue unless the IParam has been bound to a ParamValueArray */
+  std::atomic<double>* mpValue = &mValue;
+  ParamValueArray* mpValueArray = nullptr;
   double mMin = 0.0;
   double mMax = 1.0;
   double mStep = 1.0;
@@ -510,7 +640,16 @@ private:
   char mLabel[MAX_PARAM_LABEL_LEN];
   char mParamGroup[MAX_PARAM_GROUP_LEN];
   
-  std::unique_ptr<Shape> mShape;
+  /** Deletes the shape, unless it is the linear shape that is shared by all linear parameters */
+  struct ShapeDeleter
+  {
+    void operator()(Shape* pShape) const;
+  };
+
+  /** @return The ShapeLinear that linear parameters share, as it has no state, so making lots of them doesn't make lots of allocations */
+  static Shape* GetSharedLinearShape();
+
+  std::unique_ptr<Shape, ShapeDeleter> mShape;
   DisplayFunc mDisplayFunction = nullptr;
 
   WDL_TypedBuf<DisplayText> mDisplayTexts;
@@ -257,7 +257,12 @@ EResourceLocation LocateResource(const char* name, const char* type, WDL_String&
     
     if(strcmp(type, "png") == 0) { //TODO: lowercase/uppercase png
       plusSlash.SetFormatted(strlen("/resources/img/") + strlen(file) + 1, "/resources/img/%s", file);
-      foundResource = emscripten::val::global("Module")["preloadedImages"].call<bool>("hasOwnProperty", std::string(plusSlash.Get()));
+      emscripten::val module = emscripten::val::global("Module");
+      foundResource = module["preloadedImages"].call<bool>("hasOwnProperty", std::string(plusSlash.Get()));
+      
+      // images listed by Scripts/make_lazy_images.py are fetched when they are loaded
+      if (!foundResource && !module["lazyImages"].isUndefined())
+        foundResource = module["lazyImages"].call<bool>("hasOwnProperty", std::string(plusSlash.Get()));
     }
     else if(strcmp(type, "ttf") == 0) { //TODO: lowercase/uppercase ttf
       plusSlash.SetFormatted(strlen("/resources/fonts/") + strlen(file) + 1, "/resources/fonts/%s", file);
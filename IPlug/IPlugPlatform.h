@@ -40,6 +40,17 @@
 #define IPLUG_CPP14
 #endif
 
+// SIMD instruction sets that are guaranteed on the target architecture, define IPLUG_NO_SIMD to use scalar code only
+#ifndef IPLUG_NO_SIMD
+  #if defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(_M_X64)
+    #define IPLUG_SIMD_SSE2
+  #elif defined(__ARM_NEON) && defined(__aarch64__)
+    #define IPLUG_SIMD_NEON
+  #elif defined(__wasm_simd128__) // emscripten with -msimd128, see WASM_SIMD in common-web.mk
+    #define IPLUG_SIMD_WASM
+  #endif
+#endif
+
 //these two components of the c standard library are used thoughtout IPlug/WDL 
 #include <cstring>
 #include <cstdlib>
@@ -14,9 +14,14 @@
  */
 
 #include "IPlugPluginBase.h"
+#include "IPlugPresetBank.h"
 #include "wdlendian.h"
 #include "wdl_base64.h"
 
+#ifdef IPLUG_COMPRESS_STATE
+#include "zlib/zlib.h"
+#endif
+
 using namespace iplug;
 
 IPluginBase::IPluginBase(int nParams, int nPresets)
@@ -24,10 +29,21 @@ IPluginBase::IPluginBase(int nParams, int nPresets)
 {  
   for (int i = 0; i < nPresets; ++i)
     mPresets.Add(new IPreset());
+
+  // presets are changed in too many places to count as they change, so they are measured when the stats are read
+  mMemoryStats.SetGauge(IMemoryStats::kPresets, [this]() {
+    int64_t bytes = 0;
+
+    for (auto i = 0; i < mPresets.GetSize(); i++)
+      bytes += sizeof(IPreset) + mPresets.Get(i)->mChunk.Size();
+
+    return bytes;
+  });
 }
 
 IPluginBase::~IPluginBase()
 {
+  mMemoryStats.SetGauge(IMemoryStats::kPresets, nullptr);
   mPresets.Empty(true);
 }
 
@@ -75,6 +91,7 @@ const char* IPluginBase::GetAPIStr() const
     case kAPIAPP: return "APP";
     case kAPIWAM: return "WAM";
     case kAPIWEB: return "WEB";
+    case kAPICLAP: return "CLAP";
     default: return "";
   }
 }
@@ -104,16 +121,23 @@ void IPluginBase::GetBuildInfoStr(WDL_String& str, const char* date, const char*
 bool IPluginBase::SerializeParams(IByteChunk& chunk) const
 {
   TRACE
-  bool savedOK = true;
   int i, n = mParams.GetSize();
-  for (i = 0; i < n && savedOK; ++i)
+  const int size = n * static_cast<int>(sizeof(double));
+  const int startPos = chunk.Resize(chunk.Size() + size);
+
+  if (chunk.Size() != startPos + size)
+    return false;
+
+  uint8_t* pDst = chunk.GetData() + startPos;
+
+  for (i = 0; i < n; ++i)
   {
     IParam* pParam = mParams.Get(i);
     Trace(TRACELOC, "%d %s %f", i, pParam->GetName(), pParam->Value());
     double v = pParam->Value();
-    savedOK &= (chunk.Put(&v) > 0);
+    memcpy(pDst + i * sizeof(double), &v, sizeof(double));
   }
-  return savedOK;
+  return true;
 }
 
 int IPluginBase::UnserializeParams(const IByteChunk& chunk, int startPos)
@@ -130,12 +154,173 @@ int IPluginBase::UnserializeParams(const IByteChunk& chunk, int startPos)
     Trace(TRACELOC, "%d %s %f", i, pParam->GetName(), pParam->Value());
   }
 
+  MarkStateChanged(); // the custom state was likely unserialized along with these
   OnParamReset(kPresetRecall);
   LEAVE_PARAMS_MUTEX
 
   return pos;
 }
 
+bool IPluginBase::ParamsChangedSinceSnapshot() const
+{
+  const int n = mParams.GetSize();
+
+  if (mSnapshotValues.GetSize() != n)
+    return true;
+
+  const double* pValues = mSnapshotValues.Get();
+
+  for (int i = 0; i < n; ++i)
+  {
+    // compare bits, so that a NaN counts as unchanged
+    const double v = mParams.Get(i)->Value();
+    if (memcmp(&v, pValues + i, sizeof(double)))
+      return true;
+  }
+
+  return false;
+}
+
+const IByteChunk* IPluginBase::GetStateSnapshot(bool* pChanged) const
+{
+  TRACE
+  WDL_MutexLock lock(&mSnapshotMutex);
+
+  // claim the flag before serializing, so that a change made while serializing is caught next time
+  const bool customChanged = mStateChanged.exchange(false, std::memory_order_acquire) || (DoesStateChunks() && !mTracksStateChanges);
+  const bool changed = !mSnapshotValid || customChanged || ParamsChangedSinceSnapshot();
+
+  if (pChanged)
+    *pChanged = changed;
+
+  if (changed)
+  {
+    const int n = mParams.GetSize();
+    mSnapshotValues.Resize(n, false);
+
+    for (int i = 0; i < n; ++i)
+      mSnapshotValues.Get()[i] = mParams.Get(i)->Value();
+
+    mStateSnapshot.Clear();
+    mStateSnapshot.Reserve(EstimateStateSize());
+    mSnapshotValid = SerializeState(mStateSnapshot);
+    mSnapshotCompressed = false;
+
+    // the values copied above could be older than the ones serialized, in which case the next call serializes again
+
+#ifdef IPLUG_COMPRESS_STATE
+    const int size = mStateSnapshot.Size();
+
+    if (mSnapshotValid && mStateCompressionThreshold > 0 && size >= mStateCompressionThreshold)
+    {
+      // magic, uncompressed size and compressed size, then the zlib stream
+      int header[3] = { IPLUG_COMPRESSED_STATE_MAGIC, size, 0 };
+      const int headerSize = static_cast<int>(sizeof(header));
+      uLongf compressedSize = compressBound(size);
+      mCompressedSnapshot.Resize(headerSize + static_cast<int>(compressedSize));
+
+      if (compress2(mCompressedSnapshot.GetData() + headerSize, &compressedSize, mStateSnapshot.GetData(), size, Z_DEFAULT_COMPRESSION) == Z_OK
+          && headerSize + static_cast<int>(compressedSize) < size)
+      {
+        header[2] = static_cast<int>(compressedSize);
+        memcpy(mCompressedSnapshot.GetData(), header, headerSize);
+        mCompressedSnapshot.Resize(headerSize + header[2]);
+        mSnapshotCompressed = true;
+      }
+    }
+#endif
+  }
+
+  if (!mSnapshotValid)
+    return nullptr;
+
+  return mSnapshotCompressed ? &mCompressedSnapshot : &mStateSnapshot;
+}
+
+int IPluginBase::UnserializeStateSnapshot(const IByteChunk& chunk, int startPos)
+{
+  TRACE
+  int header[3] = {};
+  const int pos = chunk.GetBytes(header, sizeof(header), startPos);
+
+  // anything else is an uncompressed state
+  if (pos < 0 || header[0] != IPLUG_COMPRESSED_STATE_MAGIC || header[1] < 0 || header[2] < 0 || header[2] > chunk.Size() - pos)
+    return UnserializeState(chunk, startPos);
+
+#ifdef IPLUG_COMPRESS_STATE
+  IByteChunk state;
+  state.Resize(header[1]);
+  uLongf size = header[1];
+
+  if (uncompress(state.GetData(), &size, chunk.GetData() + pos, header[2]) == Z_OK && size == static_cast<uLongf>(header[1]))
+  {
+    const int endPos = UnserializeState(state, 0);
+    return endPos < 0 ? endPos : pos + header[2];
+  }
+
+  DBGMSG("Could not decompress the state\n");
+#else
+  DBGMSG("The state is compressed, define IPLUG_COMPRESS_STATE to load it\n");
+#endif
+  return -1;
+}
+
+int IPluginBase::SerializeParamsDelta(IByteChunk& chunk) const
+{
+  TRACE
+  WDL_MutexLock lock(&mSnapshotMutex);
+  const int n = mParams.GetSize();
+  const bool haveSnapshot = mSnapshotValues.GetSize() == n;
+  const int countPos = chunk.Size();
+  int count = 0;
+  chunk.Put(&count);
+
+  for (int i = 0; i < n; ++i)
+  {
+    double v = mParams.Get(i)->Value();
+
+    if (!haveSnapshot || memcmp(&v, mSnapshotValues.Get() + i, sizeof(double)))
+    {
+      chunk.Put(&i);
+      chunk.Put(&v);
+      count++;
+    }
+  }
+
+  memcpy(chunk.GetData() + countPos, &count, sizeof(int));
+  return count;
+}
+
+int IPluginBase::UnserializeParamsDelta(const IByteChunk& chunk, int startPos)
+{
+  TRACE
+  int count = 0;
+  int pos = chunk.Get(&count, startPos);
+
+  if (pos < 0 || count < 0)
+    return -1;
+
+  ENTER_PARAMS_MUTEX
+  for (int i = 0; i < count && pos >= 0; ++i)
+  {
+    int idx = kNoParameter;
+    double v = 0.0;
+    pos = chunk.Get(&idx, pos);
+    pos = pos >= 0 ? chunk.Get(&v, pos) : pos;
+
+    if (pos >= 0 && idx >= 0 && idx < NParams())
+    {
+      IParam* pParam = mParams.Get(idx);
+      pParam->Set(v);
+      Trace(TRACELOC, "%d %s %f", idx, pParam->GetName(), pParam->Value());
+      OnParamChange(idx, kPresetRecall);
+    }
+  }
+  LEAVE_PARAMS_MUTEX
+
+  return pos;
+}
+
 void IPluginBase::InitParamRange(int startIdx, int endIdx, int countStart, const char* nameFmtStr, double defaultVal, double minVal, double maxVal, double step, const char *label, int flags, const char *group, const IParam::Shape& shape, IParam::EParamUnit unit, IParam::DisplayFunc displayFunc)
 {
   WDL_String nameStr;
@@ -146,6 +331,18 @@ void IPluginBase::InitParamRange(int startIdx, int endIdx, int countStart, const
   }
 }
 
+void IPluginBase::InitParams(const IParamDesc* pDescs, int nDescs)
+{
+  for (auto i = 0; i < nDescs; i++)
+  {
+    const IParamDesc& desc = pDescs[i];
+    assert(desc.paramIdx >= 0 && desc.paramIdx < NParams());
+
+    if (IParam* pParam = GetParam(desc.paramIdx))
+      desc.InitParam(*pParam);
+  }
+}
+
 void IPluginBase::CloneParamRange(int cloneStartIdx, int cloneEndIdx, int startIdx, const char* searchStr, const char* replaceStr, const char* newGroup)
 {
   for (auto p = cloneStartIdx; p <= cloneEndIdx; p++)
@@ -387,12 +584,14 @@ static void MakeDefaultUserPresetName(WDL_PtrList<IPreset>* pPresets, char* str)
 void IPluginBase::EnsureDefaultPreset()
 {
   TRACE
+  EnsureFactoryPresets();
   MakeDefaultPreset("Empty", mPresets.GetSize());
 }
 
 void IPluginBase::PruneUninitializedPresets()
 {
   TRACE
+  EnsureFactoryPresets();
   int i = 0;
   while (i < mPresets.GetSize())
   {
@@ -411,6 +610,7 @@ void IPluginBase::PruneUninitializedPresets()
 bool IPluginBase::RestorePreset(int idx)
 {
   TRACE
+  EnsureFactoryPresets();
   bool restoredOK = false;
   if (idx >= 0 && idx < mPresets.GetSize())
   {
@@ -424,6 +624,7 @@ bool IPluginBase::RestorePreset(int idx)
     }
     else
     {
+      DecodePreset(pPreset);
       restoredOK = (UnserializeState(pPreset->mChunk, 0) > 0);
     }
     
@@ -439,8 +640,18 @@ bool IPluginBase::RestorePreset(int idx)
 
 bool IPluginBase::RestorePreset(const char* name)
 {
+  EnsureFactoryPresets();
   if (CStringHasContents(name))
   {
+    // the bank's hash table finds the preset directly, as long as it has not been renamed since the bank was loaded
+    if (mPresetBank)
+    {
+      const int idx = mPresetBank->Find(name);
+
+      if (idx >= 0 && idx < mPresets.GetSize() && !strcmp(mPresets.Get(idx)->mName, name))
+        return RestorePreset(idx);
+    }
+
     int n = mPresets.GetSize();
     for (int i = 0; i < n; ++i)
     {
@@ -456,6 +667,7 @@ bool IPluginBase::RestorePreset(const char* name)
 
 const char* IPluginBase::GetPresetName(int idx) const
 {
+  EnsureFactoryPresets();
   if (idx >= 0 && idx < mPresets.GetSize())
   {
     return mPresets.Get(idx)->mName;
@@ -465,10 +677,12 @@ const char* IPluginBase::GetPresetName(int idx) const
 
 void IPluginBase::ModifyCurrentPreset(const char* name)
 {
+  EnsureFactoryPresets();
   if (mCurrentPresetIdx >= 0 && mCurrentPresetIdx < mPresets.GetSize())
   {
     IPreset* pPreset = mPresets.Get(mCurrentPresetIdx);
     pPreset->mChunk.Clear();
+    pPreset->mBankIdx = -1;
     
     Trace(TRACELOC, "%d %s", mCurrentPresetIdx, pPreset->mName);
     
@@ -484,8 +698,26 @@ void IPluginBase::ModifyCurrentPreset(const char* name)
 bool IPluginBase::SerializePresets(IByteChunk& chunk) const
 {
   TRACE
+  EnsureFactoryPresets();
   bool savedOK = true;
   int n = mPresets.GetSize();
+  int size = 0;
+
+  // size the whole bank first, so that it is put without reallocating
+  for (int i = 0; i < n; ++i)
+  {
+    IPreset* pPreset = mPresets.Get(i);
+    size += static_cast<int>(sizeof(int) + strlen(pPreset->mName) + sizeof(bool));
+
+    if (pPreset->mInitialized)
+    {
+      DecodePreset(pPreset);
+      size += pPreset->mChunk.Size();
+    }
+  }
+
+  chunk.Reserve(size);
+
   for (int i = 0; i < n && savedOK; ++i)
   {
     IPreset* pPreset = mPresets.Get(i);
@@ -496,6 +728,7 @@ bool IPluginBase::SerializePresets(IByteChunk& chunk) const
     chunk.Put(&pPreset->mInitialized);
     if (pPreset->mInitialized)
     {
+      DecodePreset(pPreset);
       savedOK &= (chunk.PutChunk(&(pPreset->mChunk)) > 0);
     }
   }
@@ -505,13 +738,16 @@ bool IPluginBase::SerializePresets(IByteChunk& chunk) const
 int IPluginBase::UnserializePresets(const IByteChunk& chunk, int startPos)
 {
   TRACE
-  WDL_String name;
+  EnsureFactoryPresets();
+  std::string_view name;
   int n = mPresets.GetSize(), pos = startPos;
   for (int i = 0; i < n && pos >= 0; ++i)
   {
     IPreset* pPreset = mPresets.Get(i);
-    pos = chunk.GetStr(name, pos);
-    strcpy(pPreset->mName, name.Get());
+    pos = chunk.GetStrView(name, pos);
+    const size_t nameLen = std::min(name.size(), static_cast<size_t>(MAX_PRESET_NAME_LEN - 1));
+    memcpy(pPreset->mName, name.data(), nameLen);
+    pPreset->mName[nameLen] = '\0';
     
     Trace(TRACELOC, "%d %s", i, pPreset->mName);
     
@@ -522,6 +758,7 @@ int IPluginBase::UnserializePresets(const IByteChunk& chunk, int startPos)
       if (pos > 0)
       {
         pPreset->mChunk.Clear();
+        pPreset->mBankIdx = -1;
         SerializeState(pPreset->mChunk);
       }
     }
@@ -615,6 +852,7 @@ void IPluginBase::DumpMakePresetFromNamedParamsSrc(const char* filename, const c
 
 void IPluginBase::DumpPresetBlob(const char* filename) const
 {
+  EnsureFactoryPresets();
   FILE* fp = fopen(filename, "a");
   
   if (!fp)
@@ -625,6 +863,7 @@ void IPluginBase::DumpPresetBlob(const char* filename) const
   
   char buf[MAX_BLOB_LENGTH];
   
+  DecodePreset(mPresets.Get(mCurrentPresetIdx));
   IByteChunk* pPresetChunk = &mPresets.Get(mCurrentPresetIdx)->mChunk;
   uint8_t* byteStart = pPresetChunk->GetData();
   
@@ -667,6 +906,7 @@ bool IPluginBase::SavePresetAsFXP(const char* file) const
       fxpMagic = WDL_bswap32('FPCh');
       
       IByteChunk::InitChunkWithIPlugVer(state);
+      state.Reserve(EstimateStateSize());
       SerializeState(state);
       
       chunkSize = WDL_bswap32(state.Size());
@@ -713,6 +953,7 @@ bool IPluginBase::SavePresetAsFXP(const char* file) const
 
 bool IPluginBase::SaveBankAsFXB(const char* file) const
 {
+  EnsureFactoryPresets();
   if (CStringHasContents(file))
   {
     FILE* fp = fopen(file, "wb");
@@ -777,6 +1018,7 @@ bool IPluginBase::SaveBankAsFXB(const char* file) const
       for (int p = 0; p < NPresets(); p++)
       {
         IPreset* pPreset = mPresets.Get(p);
+        DecodePreset(pPreset);
         
         char prgName[28];
         memset(prgName, 0, 28);
@@ -1042,3 +1284,90 @@ bool IPluginBase::LoadBankFromFXB(const char* file)
   
   return false;
 }
+
+bool IPluginBase::LoadPresetBank(const char* file)
+{
+  TRACE
+  std::unique_ptr<IPresetBank> pBank(new IPresetBank);
+
+  if (!CStringHasContents(file) || !pBank->Open(file) || !pBank->NPresets())
+    return false;
+
+  if (pBank->GetPluginID() && pBank->GetPluginID() != GetUniqueID())
+    return false;
+
+  const int n = pBank->NPresets();
+
+  while (mPresets.GetSize() > n)
+    mPresets.Delete(mPresets.GetSize() - 1, true);
+
+  while (mPresets.GetSize() < n)
+    mPresets.Add(new IPreset());
+
+  for (int i = 0; i < n; ++i)
+  {
+    IPreset* pPreset = mPresets.Get(i);
+    strncpy(pPreset->mName, pBank->GetName(i), MAX_PRESET_NAME_LEN - 1);
+    pPreset->mName[MAX_PRESET_NAME_LEN - 1] = 0;
+    pPreset->mChunk.Clear();
+    pPreset->mInitialized = true;
+    pPreset->mBankIdx = i;
+  }
+
+  mPresetBank = std::move(pBank);
+  mFactoryPresetsFunc = nullptr; // the bank replaces the factory presets, so there is no need to make them
+  mCurrentPresetIdx = 0;
+  OnPresetsModified();
+  return true;
+}
+
+bool IPluginBase::SavePresetBank(const char* file) const
+{
+  TRACE
+  EnsureFactoryPresets();
+  if (!CStringHasContents(file))
+    return false;
+
+  IPresetBank::Writer writer;
+
+  for (int i = 0; i < mPresets.GetSize(); ++i)
+  {
+    IPreset* pPreset = mPresets.Get(i);
+
+    if (pPreset->mInitialized)
+    {
+      // presets still in a loaded bank are written straight from the mapped file
+      int size = 0;
+      const uint8_t* pData = (pPreset->mBankIdx >= 0 && mPresetBank) ? mPresetBank->GetData(pPreset->mBankIdx, size) : nullptr;
+
+      if (pData)
+        writer.Add(pPreset->mName, pData, size);
+      else
+        writer.Add(pPreset->mName, pPreset->mChunk);
+    }
+  }
+
+  return writer.Write(file, GetUniqueID(), GetPluginVersion(false));
+}
+
+void IPluginBase::EnsureFactoryPresets() const
+{
+  if (mFactoryPresetsFunc)
+  {
+    // cleared first, so that presets accessed from the function don't call it again
+    auto func = std::move(mFactoryPresetsFunc);
+    mFactoryPresetsFunc = nullptr;
+    func();
+  }
+}
+
+void IPluginBase::DecodePreset(IPreset* pPreset) const
+{
+  if (pPreset->mBankIdx >= 0)
+  {
+    if (mPresetBank)
+      mPresetBank->GetChunk(pPreset->mBankIdx, pPreset->mChunk);
+
+    pPreset->mBankIdx = -1;
+  }
+}
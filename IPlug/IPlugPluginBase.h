@@ -15,13 +15,23 @@
  * @copydoc IPluginBase
  */
 
+#include <atomic>
+#include <functional>
+#include <memory>
+
+#include "mutex.h"
+
 #include "IPlugDelegate_select.h"
 #include "IPlugParameter.h"
+#include "IPlugParamDesc.h"
 #include "IPlugStructs.h"
 #include "IPlugLogger.h"
+#include "IPlugMemoryStats.h"
 
 BEGIN_IPLUG_NAMESPACE
 
+class IPresetBank;
+
 /** Base class that contains plug-in info and state manipulation methods */
 class IPluginBase : public EDITOR_DELEGATE_CLASS
 {
@@ -99,6 +109,10 @@ public:
   
   /*** @return a CString with the bundle identifier (macOS/IOS only) */
   const char* GetBundleID() const { return mBundleID.Get(); }
+
+  /** @return The bytes used by this instance, by category, which the IPlug buffers, the editor and the presets count against. Count the plug-in's own large allocations,
+   * such as sample data, against it too, with an IMemoryStats::Allocation. The presets are measured when the stats are read, so read them on the main thread */
+  IMemoryStats* GetMemoryStats() override { return &mMemoryStats; }
     
 #pragma mark - Parameters
   
@@ -137,6 +151,11 @@ public:
    * @param chunk The output bytechunk where data can be serialized
    * @return \c true if serialization was successful*/
   virtual bool SerializeState(IByteChunk& chunk) const { TRACE return SerializeParams(chunk); }
+
+  /** Override this method if you serialize custom state data, to return roughly how many bytes SerializeState() will put.
+   * The chunk is reserved to this size before serializing, so that it is only allocated once
+   * @return The expected size of the state in bytes */
+  virtual int EstimateStateSize() const { return NParams() * static_cast<int>(sizeof(double)); }
   
   /** Override this method to unserialize custom state data, if your plugin does state chunks.
    * Implementations should call UnserializeParams() after custom data is unserialized
@@ -154,6 +173,45 @@ public:
    * @param chunk chunk The incoming chunk containing the state data.
    * @return The new chunk position (endPos) */
   virtual int UnserializeVST3CtrlrState(const IByteChunk& chunk, int startPos) { return startPos; }
+
+#pragma mark - State Snapshots
+  /** Hosts can ask for the state very often, for instance REAPER does for every undo point. GetStateSnapshot() keeps the last state it serialized,
+   * and only serializes again when a parameter value has changed, or when custom state data might have changed.
+   * It can only know about custom data if the plug-in tells it, so plug-ins that do state chunks must opt in with this, and then call MarkStateChanged() whenever their custom data changes.
+   * Otherwise custom state is serialized every time
+   * @param enable \c true if the plug-in calls MarkStateChanged() */
+  void SetTracksStateChanges(bool enable) { mTracksStateChanges = enable; MarkStateChanged(); }
+
+  /** Call this when custom data written by SerializeState() changes, see SetTracksStateChanges(). Parameter changes are found without it. Thread safe */
+  void MarkStateChanged() { mStateChanged.store(true, std::memory_order_release); }
+
+  /** Get the state as serialized by SerializeState(), reusing the previous snapshot if nothing has changed since it was taken
+   * @param pChanged Optionally set to \c true if the state was serialized again, or \c false if the previous snapshot was returned
+   * @return The snapshot, which is valid until the next call, or nullptr if serialization failed */
+  const IByteChunk* GetStateSnapshot(bool* pChanged = nullptr) const;
+
+  /** Serializes only the parameters whose values differ from those in the last GetStateSnapshot(), as an int count followed by pairs of int index and double value
+   * @param chunk The output chunk to serialize to. Will append data if the chunk has already been started.
+   * @return The number of parameters that have changed */
+  int SerializeParamsDelta(IByteChunk& chunk) const;
+
+  /** Unserializes parameter values written by SerializeParamsDelta(), leaving the other parameters as they are
+   * @param chunk The incoming chunk where the changed parameter values are stored
+   * @param startPos The start position in the chunk where they are stored
+   * @return The new chunk position (endPos), or -1 if the chunk is invalid */
+  int UnserializeParamsDelta(const IByteChunk& chunk, int startPos);
+
+#pragma mark - State Compression
+  /** Compress the state returned by GetStateSnapshot() with zlib, when SerializeState() writes at least this many bytes. Only has an effect if IPLUG_COMPRESS_STATE is defined,
+   * and WDL/zlib is compiled into the plug-in. Builds without it, and versions of the plug-in from before it was enabled, can't load compressed states
+   * @param nBytes The threshold in bytes, or 0 to never compress */
+  void SetStateCompressionThreshold(int nBytes) { mStateCompressionThreshold = nBytes; MarkStateChanged(); }
+
+  /** Unserializes a state that came from GetStateSnapshot(), decompressing it first if it was compressed. API classes call this rather than UnserializeState()
+   * @param chunk The incoming chunk containing the state data
+   * @param startPos The position in the chunk where the data starts
+   * @return The new chunk position (endPos), or -1 if a compressed state could not be decompressed */
+  int UnserializeStateSnapshot(const IByteChunk& chunk, int startPos);
   
   /** Get the index of the current, active preset
    * @return The index of the current preset */
@@ -170,7 +228,7 @@ public:
   
   /** Get a ptr to a factory preset
    * @ param idx The index number of the preset you are referring to */
-  IPreset* GetPreset(int idx) { return mPresets.Get(idx); }
+  IPreset* GetPreset(int idx) { EnsureFactoryPresets(); return mPresets.Get(idx); }
   
   /** This method should update the current preset with current values
    * NOTE: This is only relevant for VST2 plug-ins, which is the only format to have the notion of banks?
@@ -201,11 +259,14 @@ public:
   * @param destIdx index of internal destination preset */
   void CopyPreset(IPreset* pSrc, int destIdx, bool copyname = false)
   {
+    EnsureFactoryPresets();
     IPreset* pDst = mPresets.Get(destIdx);
 
+    DecodePreset(pSrc);
     pDst->mChunk.Clear();
     pDst->mChunk.PutChunk(&pSrc->mChunk);
     pDst->mInitialized = true;
+    pDst->mBankIdx = -1;
     strncpy(pDst->mName, pSrc->mName, MAX_PRESET_NAME_LEN - 1);
   }
   
@@ -246,6 +307,12 @@ public:
    * @param sizeOfChunk The binary string size */
   void MakePresetFromBlob(const char* name, const char* blob, int sizeOfChunk);
   
+  /** Set a function that makes the factory presets with MakePreset() etc, instead of making them in the constructor. It is called the first time the presets are used,
+   * which for many hosts is never when a plug-in is scanned or a project with hundreds of instances is loaded.
+   * NPresets() is fixed by the constructor, so the function should fill the presets it was given. AUv2 prunes the uninitialized presets on construction, which calls the function
+   * @param func The function, usually a lambda capturing \c this */
+  void SetFactoryPresetsFunc(std::function<void()> func) { mFactoryPresetsFunc = std::move(func); }
+
   /** [AUV2 only] Removes any presets that weren't initialized */
   void PruneUninitializedPresets();
   
@@ -299,6 +366,18 @@ public:
    * @return /c true on success */
   bool LoadBankFromFXB(const char* file);
 
+  /** Replace the factory presets with those in an IPresetBank file, which is memory-mapped. Only the names are read here,
+   * each preset's state is copied out of the file the first time it is restored, so this is fast even for thousands of presets.
+   * Call it in your plug-in's constructor, as the number of presets becomes the number in the bank, and hosts expect that to be fixed
+   * @param file The full path of the file to load
+   * @return /c true on success, \c false if the file is not a valid bank, or is for a different plug-in */
+  bool LoadPresetBank(const char* file);
+
+  /** Save the presets as an IPresetBank file, which can be loaded with LoadPresetBank(). Uninitialized presets are not saved
+   * @param file The full path of the file to write or overwrite
+   * @return /c true on success */
+  bool SavePresetBank(const char* file) const;
+
   
 #pragma mark - Parameter manipulation
     
@@ -319,6 +398,16 @@ public:
    * @param displayFunc An IParam::DisplayFunc lambda function to specify a custom display function */
   void InitParamRange(int startIdx, int endIdx, int countStart, const char* nameFmtStr, double defaultVal, double minVal, double maxVal, double step, const char* label = "", int flags = 0, const char* group = "", const IParam::Shape& shape = IParam::ShapeLinear(), IParam::EParamUnit unit = IParam::kUnitCustom, IParam::DisplayFunc displayFunc = nullptr);
   
+  /** Initialise parameters from a table of descriptions, which is normally constexpr, see IParamDesc. The parameters were all made in one allocation
+   * when the plug-in was constructed, so this only fills them in
+   * @param pDescs The descriptions, each of which initialises the parameter at its paramIdx
+   * @param nDescs The number of descriptions */
+  void InitParams(const IParamDesc* pDescs, int nDescs);
+
+  /** Initialise parameters from an array of descriptions, see IParamDesc */
+  template <size_t N>
+  void InitParams(const IParamDesc (&descs)[N]) { InitParams(descs, static_cast<int>(N)); }
+
   /** Clone a range of parameters, optionally doing a string substitution on the parameter name.
    * @param cloneStartIdx The index of the first parameter to clone
    * @param cloneEndIdx The index of the last parameter to clone
@@ -421,6 +510,33 @@ private:
   WDL_PtrList<const char> mParamGroups;
   /** "Baked in" Factory presets */
   WDL_PtrList<IPreset> mPresets;
+  /** The bank loaded by LoadPresetBank(), which presets that have not been restored yet are copied from */
+  std::unique_ptr<IPresetBank> mPresetBank;
+  /** The memory used by this instance, see GetMemoryStats() */
+  IMemoryStats mMemoryStats;
+
+  /** Set by SetFactoryPresetsFunc(), cleared when it has been called */
+  mutable std::function<void()> mFactoryPresetsFunc;
+
+  /** Call mFactoryPresetsFunc, if it has not been already */
+  void EnsureFactoryPresets() const;
+
+  /** Copy a preset's state from mPresetBank, if it has not been already */
+  void DecodePreset(IPreset* pPreset) const;
+
+  /** \c true if a parameter value differs from mSnapshotValues */
+  bool ParamsChangedSinceSnapshot() const;
+
+  /** The last state serialized by GetStateSnapshot(), and the parameter values it was serialized with */
+  mutable IByteChunk mStateSnapshot;
+  mutable IByteChunk mCompressedSnapshot;
+  mutable bool mSnapshotCompressed = false;
+  int mStateCompressionThreshold = 0;
+  mutable WDL_TypedBuf<double> mSnapshotValues;
+  mutable bool mSnapshotValid = false;
+  mutable WDL_Mutex mSnapshotMutex;
+  mutable std::atomic<bool> mStateChanged {true};
+  bool mTracksStateChanges = false;
 
 #ifdef PARAMS_MUTEX
   friend class IPlugVST3ProcessorBase;
@@ -0,0 +1,369 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc IPresetBank
+ */
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+#include "fileread.h"
+#include "heapbuf.h"
+#include "wdlstring.h"
+
+#include "IPlugPlatform.h"
+#include "IPlugStructs.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** A read-only preset bank file, which is memory-mapped so that opening a bank of thousands of presets only reads its table of contents.
+ * Each preset is the IByteChunk that SerializeState() made for it, stored as is, and is only copied out when it is asked for.
+ * Presets can be found by index, or by name via a hash table in the file, both in constant time.
+ *
+ * The format is little endian, version kVersion:
+ * - Header: the kMagic bytes, then version, header size, preset count, hash table size, plug-in unique ID, plug-in version and a reserved word, all uint32,
+ *   then the offsets of the table of contents and the hash table as uint64
+ * - Table of contents: per preset, the offsets of its data and its NUL terminated name as uint64, then the size of its data and the hash of its name as uint32
+ * - Hash table: a power of two number of uint32 slots, each being a preset index + 1 or 0 when empty, with linear probing
+ * - The names and the data, anywhere in the file
+ *
+ * Banks are written with IPresetBank::Writer, or IPluginBase::SavePresetBank() */
+class IPresetBank
+{
+public:
+  static constexpr char kMagic[4] = {'I', 'P', 'B', 'K'};
+  static constexpr uint32_t kVersion = 1;
+
+  /** Collects presets in memory and writes them to a bank file, e.g. to convert a preset library offline */
+  class Writer
+  {
+  public:
+    /** Add a preset
+     * @param name The preset name
+     * @param pData The serialized state of the preset
+     * @param size The size of the data in bytes */
+    void Add(const char* name, const void* pData, int size)
+    {
+      Entry entry;
+      entry.nameOffset = mNames.GetSize();
+      entry.dataOffset = mData.GetSize();
+      entry.dataSize = size;
+
+      const int nameLen = static_cast<int>(strlen(name)) + 1;
+      memcpy(mNames.ResizeOK(entry.nameOffset + nameLen, false) + entry.nameOffset, name, nameLen);
+      memcpy(mData.ResizeOK(entry.dataOffset + size, false) + entry.dataOffset, pData, size);
+      mEntries.Add(entry);
+    }
+
+    void Add(const char* name, const IByteChunk& chunk)
+    {
+      Add(name, chunk.GetData(), chunk.Size());
+    }
+
+    int NPresets() const { return mEntries.GetSize(); }
+
+    /** Write the bank
+     * @param path The full path of the file to write or overwrite
+     * @param pluginID The plug-in's unique ID, checked by IPluginBase::LoadPresetBank(), or 0 to allow any plug-in
+     * @param pluginVersion The plug-in's version, for information
+     * @return \c true on success */
+    bool Write(const char* path, int pluginID = 0, int pluginVersion = 0) const
+    {
+      const uint32_t nPresets = mEntries.GetSize();
+      uint32_t hashSize = 1;
+
+      while (hashSize < nPresets * 2)
+        hashSize <<= 1;
+
+      const uint64_t tocOffset = kHeaderSize;
+      const uint64_t hashOffset = tocOffset + nPresets * kTOCEntrySize;
+      const uint64_t namesOffset = hashOffset + hashSize * sizeof(uint32_t);
+      const uint64_t dataOffset = namesOffset + mNames.GetSize();
+
+      WDL_TypedBuf<uint8_t> header;
+      uint8_t* pHeader = header.Resize(static_cast<int>(namesOffset));
+      memset(pHeader, 0, header.GetSize());
+
+      memcpy(pHeader, kMagic, 4);
+      WriteU32(pHeader + 4, kVersion);
+      WriteU32(pHeader + 8, kHeaderSize);
+      WriteU32(pHeader + 12, nPresets);
+      WriteU32(pHeader + 16, hashSize);
+      WriteU32(pHeader + 20, static_cast<uint32_t>(pluginID));
+      WriteU32(pHeader + 24, static_cast<uint32_t>(pluginVersion));
+      WriteU64(pHeader + 32, tocOffset);
+      WriteU64(pHeader + 40, hashOffset);
+
+      uint8_t* pHash = pHeader + hashOffset;
+
+      for (uint32_t i = 0; i < nPresets; i++)
+      {
+        const Entry& entry = mEntries.Get()[i];
+        const uint32_t hash = Hash(mNames.Get() + entry.nameOffset);
+        uint8_t* pTOC = pHeader + tocOffset + i * kTOCEntrySize;
+
+        WriteU64(pTOC, dataOffset + entry.dataOffset);
+        WriteU64(pTOC + 8, namesOffset + entry.nameOffset);
+        WriteU32(pTOC + 16, static_cast<uint32_t>(entry.dataSize));
+        WriteU32(pTOC + 20, hash);
+
+        // the first preset with a name wins, as with IPluginBase::RestorePreset(const char*)
+        for (uint32_t slot = hash & (hashSize - 1); ; slot = (slot + 1) & (hashSize - 1))
+        {
+          const uint32_t existing = ReadU32(pHash + slot * sizeof(uint32_t));
+
+          if (!existing)
+          {
+            WriteU32(pHash + slot * sizeof(uint32_t), i + 1);
+            break;
+          }
+
+          if (!strcmp(mNames.Get() + mEntries.Get()[existing - 1].nameOffset, mNames.Get() + entry.nameOffset))
+            break;
+        }
+      }
+
+      // written to a temporary file that then replaces the bank, so that a bank that is mapped by IPresetBank is never changed underneath it
+      WDL_String tempPath(path);
+      tempPath.Append(".tmp");
+      FILE* fp = fopen(tempPath.Get(), "wb");
+
+      if (!fp)
+        return false;
+
+      bool writtenOK = fwrite(pHeader, 1, header.GetSize(), fp) == static_cast<size_t>(header.GetSize());
+      writtenOK &= fwrite(mNames.Get(), 1, mNames.GetSize(), fp) == static_cast<size_t>(mNames.GetSize());
+      writtenOK &= fwrite(mData.Get(), 1, mData.GetSize(), fp) == static_cast<size_t>(mData.GetSize());
+      writtenOK &= fclose(fp) == 0;
+
+#ifdef OS_WIN
+      // rename() does not replace existing files on Windows. This fails if the bank is open, as it can't be deleted while it is mapped
+      remove(path);
+#endif
+
+      if (!writtenOK || rename(tempPath.Get(), path))
+      {
+        remove(tempPath.Get());
+        return false;
+      }
+
+      return true;
+    }
+
+  private:
+    struct Entry
+    {
+      int nameOffset;
+      int dataOffset;
+      int dataSize;
+    };
+
+    WDL_TypedBuf<Entry> mEntries;
+    WDL_TypedBuf<char> mNames;
+    WDL_TypedBuf<uint8_t> mData;
+  };
+
+  /** Open and map a bank, checking that its table of contents is consistent with the file. Preset data is not read until it is asked for
+   * @param path The full path of the file
+   * @return \c true on success */
+  bool Open(const char* path)
+  {
+    Close();
+
+    // map the whole file, or read it into memory if it can't be mapped
+    std::unique_ptr<WDL_FileRead> pFile(new WDL_FileRead(path, 0, 8192, 4, 0, 0x7fffffff));
+
+    if (!pFile->IsOpen() || pFile->GetSize() < kHeaderSize || pFile->GetSize() >= 0x7fffffff)
+      return false;
+
+    int size = static_cast<int>(pFile->GetSize());
+    const uint8_t* pBase = static_cast<const uint8_t*>(pFile->GetMappedView(0, &size));
+
+    if (!pBase || memcmp(pBase, kMagic, 4) || ReadU32(pBase + 4) != kVersion)
+      return false;
+
+    const uint64_t headerSize = ReadU32(pBase + 8);
+    const uint64_t nPresets = ReadU32(pBase + 12);
+    const uint64_t hashSize = ReadU32(pBase + 16);
+    const uint64_t tocOffset = ReadU64(pBase + 32);
+    const uint64_t hashOffset = ReadU64(pBase + 40);
+    const uint64_t fileSize = static_cast<uint64_t>(size);
+
+    // written so that nothing can overflow, as the offsets come from the file
+    auto inFile = [fileSize](uint64_t offset, uint64_t size) { return offset <= fileSize && size <= fileSize - offset; };
+
+    if (headerSize < kHeaderSize || !hashSize || (hashSize & (hashSize - 1)) || hashSize < nPresets
+        || !inFile(tocOffset, nPresets * kTOCEntrySize) || !inFile(hashOffset, hashSize * sizeof(uint32_t)))
+      return false;
+
+    for (uint64_t i = 0; i < nPresets; i++)
+    {
+      const uint8_t* pTOC = pBase + tocOffset + i * kTOCEntrySize;
+      const uint64_t dataOffset = ReadU64(pTOC);
+      const uint64_t nameOffset = ReadU64(pTOC + 8);
+
+      if (!inFile(dataOffset, ReadU32(pTOC + 16)) || nameOffset >= fileSize || !memchr(pBase + nameOffset, 0, static_cast<size_t>(fileSize - nameOffset)))
+        return false;
+    }
+
+    for (uint64_t slot = 0; slot < hashSize; slot++)
+    {
+      if (ReadU32(pBase + hashOffset + slot * sizeof(uint32_t)) > nPresets)
+        return false;
+    }
+
+    mFile = std::move(pFile);
+    mBase = pBase;
+    mNPresets = static_cast<int>(nPresets);
+    mHashSize = static_cast<uint32_t>(hashSize);
+    mTOC = pBase + tocOffset;
+    mHash = pBase + hashOffset;
+    mPluginID = static_cast<int>(ReadU32(pBase + 20));
+    mPluginVersion = static_cast<int>(ReadU32(pBase + 24));
+    return true;
+  }
+
+  void Close()
+  {
+    mFile = nullptr;
+    mBase = mTOC = mHash = nullptr;
+    mNPresets = 0;
+    mHashSize = 0;
+    mPluginID = mPluginVersion = 0;
+  }
+
+  bool IsOpen() const { return mBase != nullptr; }
+
+  int NPresets() const { return mNPresets; }
+
+  /** @return The unique ID of the plug-in the bank was written for, or 0 if it is for any plug-in */
+  int GetPluginID() const { return mPluginID; }
+
+  int GetPluginVersion() const { return mPluginVersion; }
+
+  /** @param idx The index of the preset
+   * @return The name of the preset, which points into the mapped file, so is valid until the bank is closed */
+  const char* GetName(int idx) const
+  {
+    return (idx >= 0 && idx < mNPresets) ? reinterpret_cast<const char*>(mBase + ReadU64(mTOC + idx * kTOCEntrySize + 8)) : "";
+  }
+
+  /** @param name The name of the preset
+   * @return The index of the first preset with that name, or -1 if there is none */
+  int Find(const char* name) const
+  {
+    if (!IsOpen())
+      return -1;
+
+    const uint32_t hash = Hash(name);
+
+    for (uint32_t slot = hash & (mHashSize - 1), n = 0; n < mHashSize; slot = (slot + 1) & (mHashSize - 1), n++)
+    {
+      const uint32_t entry = ReadU32(mHash + slot * sizeof(uint32_t));
+
+      if (!entry)
+        return -1;
+
+      const int idx = static_cast<int>(entry - 1);
+
+      if (ReadU32(mTOC + idx * kTOCEntrySize + 20) == hash && !strcmp(GetName(idx), name))
+        return idx;
+    }
+
+    return -1;
+  }
+
+  /** @param idx The index of the preset
+   * @param size Set to the size of the data in bytes
+   * @return The serialized state of the preset, which points into the mapped file, so is valid until the bank is closed */
+  const uint8_t* GetData(int idx, int& size) const
+  {
+    if (idx < 0 || idx >= mNPresets)
+    {
+      size = 0;
+      return nullptr;
+    }
+
+    const uint8_t* pTOC = mTOC + idx * kTOCEntrySize;
+    size = static_cast<int>(ReadU32(pTOC + 16));
+    return mBase + ReadU64(pTOC);
+  }
+
+  /** Copy the serialized state of a preset into a chunk, replacing its contents
+   * @param idx The index of the preset
+   * @param chunk The chunk to copy it into
+   * @return \c true on success */
+  bool GetChunk(int idx, IByteChunk& chunk) const
+  {
+    int size = 0;
+    const uint8_t* pData = GetData(idx, size);
+
+    if (!pData)
+      return false;
+
+    chunk.Clear();
+    chunk.PutBytes(pData, size);
+    return true;
+  }
+
+private:
+  static constexpr int kHeaderSize = 48;
+  static constexpr int kTOCEntrySize = 24;
+
+  /** 32 bit FNV-1a */
+  static uint32_t Hash(const char* str)
+  {
+    uint32_t hash = 2166136261u;
+
+    while (*str)
+      hash = (hash ^ static_cast<uint8_t>(*str++)) * 16777619u;
+
+    return hash;
+  }
+
+  static uint32_t ReadU32(const uint8_t* p)
+  {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+  }
+
+  static uint64_t ReadU64(const uint8_t* p)
+  {
+    return ReadU32(p) | (static_cast<uint64_t>(ReadU32(p + 4)) << 32);
+  }
+
+  static void WriteU32(uint8_t* p, uint32_t v)
+  {
+    for (auto i = 0; i < 4; i++)
+      p[i] = static_cast<uint8_t>(v >> (i * 8));
+  }
+
+  static void WriteU64(uint8_t* p, uint64_t v)
+  {
+    WriteU32(p, static_cast<uint32_t>(v));
+    WriteU32(p + 4, static_cast<uint32_t>(v >> 32));
+  }
+
+  std::unique_ptr<WDL_FileRead> mFile;
+  const uint8_t* mBase = nullptr;
+  const uint8_t* mTOC = nullptr;
+  const uint8_t* mHash = nullptr;
+  int mNPresets = 0;
+  uint32_t mHashSize = 0;
+  int mPluginID = 0;
+  int mPluginVersion = 0;
+};
+
+END_IPLUG_NAMESPACE
@@ -13,12 +13,95 @@
  * @brief IPlugProcessor implementation.
  */
 
+#ifdef IPLUG_FLUSH_DENORMALS
+  // must be defined before anything includes denormal.h
+  #define WDL_DENORMAL_WANTS_SCOPED_FTZ
+  #include "denormal.h"
+#endif
+
 #include "IPlugProcessor.h"
+#include "IPlugEditorDelegate.h"
+#include "IPlugLogger.h"
 
 #ifdef OS_WIN
 #define strtok_r strtok_s
 #endif
 
+// Define IPLUG_FLUSH_DENORMALS (project wide, like PARAMS_MUTEX) to set the flush-to-zero (and where available denormals-are-zero) FPU flags
+// (MXCSR on x86, FPCR on ARM) whilst running ProcessBlock(), restoring the previous flags afterwards.
+// On platforms without these flags it does nothing, and the denormal_filter() functions in WDL's denormal.h should be used in DSP code instead
+#if defined IPLUG_FLUSH_DENORMALS && defined WDL_DENORMAL_FTZMODE
+  #define ENTER_DENORMAL_FTZ_SCOPE WDL_denormal_ftz_scope ftzScope;
+#else
+  #define ENTER_DENORMAL_FTZ_SCOPE
+#endif
+
+// Define IPLUG_DETECT_AUDIO_THREAD_ALLOCATIONS in a debug build to replace the global operator new and delete with versions that assert
+// when they are called from inside ProcessBlock(), which catches std containers and strings growing on the audio thread.
+// WDL's buffers use malloc() directly, so they are not caught, use the scratch arena (see SetScratchArenaSize()) for those.
+// Define IPLUG_COUNT_AUDIO_THREAD_ALLOCATIONS in any build to count them instead, see GetAudioThreadAllocationCount()
+#if (!defined NDEBUG && defined IPLUG_DETECT_AUDIO_THREAD_ALLOCATIONS) || defined IPLUG_COUNT_AUDIO_THREAD_ALLOCATIONS
+  #include <new>
+
+  static thread_local int sInProcessBlock = 0;
+  static thread_local int64_t sAudioThreadAllocations = 0;
+
+  struct AudioThreadAllocationScope
+  {
+    AudioThreadAllocationScope() { sInProcessBlock++; }
+    ~AudioThreadAllocationScope() { sInProcessBlock--; }
+  };
+
+  static void* AllocateChecked(std::size_t size)
+  {
+  #ifdef IPLUG_COUNT_AUDIO_THREAD_ALLOCATIONS
+    if (sInProcessBlock)
+      sAudioThreadAllocations++;
+  #else
+    assert(!sInProcessBlock && "heap allocation on the audio thread");
+  #endif
+
+    if (void* p = malloc(size ? size : 1))
+      return p;
+
+    throw std::bad_alloc();
+  }
+
+  static void FreeChecked(void* p) noexcept
+  {
+  #ifndef IPLUG_COUNT_AUDIO_THREAD_ALLOCATIONS
+    assert(!sInProcessBlock && "heap deallocation on the audio thread");
+  #endif
+    free(p);
+  }
+
+  void* operator new(std::size_t size) { return AllocateChecked(size); }
+  void* operator new[](std::size_t size) { return AllocateChecked(size); }
+  void* operator new(std::size_t size, const std::nothrow_t&) noexcept { try { return AllocateChecked(size); } catch (...) { return nullptr; } }
+  void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { try { return AllocateChecked(size); } catch (...) { return nullptr; } }
+  void operator delete(void* p) noexcept { FreeChecked(p); }
+  void operator delete[](void* p) noexcept { FreeChecked(p); }
+  void operator delete(void* p, std::size_t) noexcept { FreeChecked(p); }
+  void operator delete[](void* p, std::size_t) noexcept { FreeChecked(p); }
+
+  #define ENTER_AUDIO_THREAD_ALLOCATION_SCOPE AudioThreadAllocationScope allocationScope;
+
+  int64_t iplug::GetAudioThreadAllocationCount() { return sAudioThreadAllocations; }
+#else
+  #define ENTER_AUDIO_THREAD_ALLOCATION_SCOPE
+
+  int64_t iplug::GetAudioThreadAllocationCount() { return -1; }
+#endif
+
+// Define IPLUG_DEADLINE_MONITOR to time each ProcessBuffers() call against the duration of the block, see GetDeadlineMonitor()
+#ifdef IPLUG_DEADLINE_MONITOR
+  #define ENTER_DEADLINE_MONITOR_SCOPE(nFrames) IDeadlineMonitor::Scope deadlineScope(mDeadlineMonitor, nFrames, mSampleRate, mTimeInfo.mSamplePos);
+  #define NOTE_DEADLINE_MONITOR(func) mDeadlineMonitor.func();
+#else
+  #define ENTER_DEADLINE_MONITOR_SCOPE(nFrames)
+  #define NOTE_DEADLINE_MONITOR(func)
+#endif
+
 using namespace iplug;
 
 IPlugProcessor::IPlugProcessor(const Config& config, EAPI plugAPI)
@@ -27,7 +110,14 @@ IPlugProcessor::IPlugProcessor(const Config& config, EAPI plugAPI)
 , mDoesMIDIOut(config.plugDoesMidiOut)
 , mDoesMPE(config.plugDoesMPE)
 , mLatency(config.latency)
+, mMaxBlockSize(std::max(config.maxBlockSize, 0))
+, mMaxSampleRate(config.maxSampleRate)
 {
+#ifndef NDEBUG
+  // start the RTLOG thread here, rather than on the first call on the audio thread
+  IRTLogger::Get();
+#endif
+
   int totalNInBuses, totalNOutBuses;
   int totalNInChans, totalNOutChans;
 
@@ -35,6 +125,12 @@ IPlugProcessor::IPlugProcessor(const Config& config, EAPI plugAPI)
 
   mScratchData[ERoute::kInput].Resize(totalNInChans);
   mScratchData[ERoute::kOutput].Resize(totalNOutChans);
+  mSegmentData[ERoute::kInput].Resize(totalNInChans);
+  mSegmentData[ERoute::kOutput].Resize(totalNOutChans);
+  mOtherPrecisionData[ERoute::kInput].Resize(totalNInChans);
+  mOtherPrecisionData[ERoute::kOutput].Resize(totalNOutChans);
+  mOtherPrecisionSegmentData[ERoute::kInput].Resize(totalNInChans);
+  mOtherPrecisionSegmentData[ERoute::kOutput].Resize(totalNOutChans);
 
   sample** ppInData = mScratchData[ERoute::kInput].Get();
 
@@ -56,6 +152,35 @@ IPlugProcessor::IPlugProcessor(const Config& config, EAPI plugAPI)
     pOutChannel->mIncomingData = nullptr;
     mChannelData[ERoute::kOutput].Add(pOutChannel);
   }
+
+  // the bus layout never changes, only how many channels on each bus are connected
+  for (auto d = 0; d < 2; d++)
+  {
+    const ERoute direction = static_cast<ERoute>(d);
+    const int nChans = d == ERoute::kInput ? totalNInChans : totalNOutChans;
+    const int nBuses = MaxNBuses(direction);
+
+    mConnected[d].Resize(nChans);
+    memset(mConnected[d].Get(), 0, nChans);
+    mBusBuffers[d].Resize(nBuses);
+    mBusOffsets[d].Resize(nBuses);
+
+    for (auto bus = 0, offset = 0; bus < nBuses; bus++)
+    {
+      const int maxNChans = MaxNChannelsForBus(direction, bus);
+      const int busNChans = maxNChans < 0 ? nChans - offset : std::min(maxNChans, nChans - offset); // wildcards take the remaining channels
+      mBusOffsets[d].Get()[bus] = offset;
+      mBusBuffers[d].Get()[bus] = IBusBuffer { nullptr, busNChans, 0 };
+      offset += busNChans;
+    }
+  }
+
+  // with a declared maximum, resets only update state
+  if (mMaxBlockSize > 0)
+  {
+    ResizeChannelScratch(mMaxBlockSize);
+    ResizeScratchArena();
+  }
 }
 
 IPlugProcessor::~IPlugProcessor()
@@ -65,6 +190,10 @@ IPlugProcessor::~IPlugProcessor()
   mChannelData[ERoute::kInput].Empty(true);
   mChannelData[ERoute::kOutput].Empty(true);
   mIOConfigs.Empty(true);
+
+#ifdef IPLUG_STARTUP_TIMING
+  IStartupTimer::Write();
+#endif
 }
 
 void IPlugProcessor::ProcessBlock(sample** inputs, sample** outputs, int nFrames)
@@ -93,6 +222,14 @@ void IPlugProcessor::ProcessMidiMsg(const IMidiMsg& msg)
   SendMidiMsg(msg);
 }
 
+void IPlugProcessor::ProcessMidi2Msg(const IMidi2Msg& msg)
+{
+  IMidiMsg msg1;
+
+  if (msg.ToMidi1(msg1))
+    ProcessMidiMsg(msg1);
+}
+
 bool IPlugProcessor::SendMidiMsgs(WDL_TypedBuf<IMidiMsg>& msgs)
 {
   bool rc = true;
@@ -275,6 +412,43 @@ void IPlugProcessor::SetLatency(int samples)
 
   if (mLatencyDelay)
     mLatencyDelay->SetDelayTime(mLatency);
+
+  if (mLatencyCompensation)
+    mCompensationTarget.store(std::max(samples - mDSPLatency.load(std::memory_order_relaxed), 0), std::memory_order_release);
+}
+
+void IPlugProcessor::EnableLatencyChanges(int maxLatency)
+{
+  const int nChans = MaxNChannels(ERoute::kOutput);
+  mLatencyCompensation = std::make_unique<NChanDelayLine<sample>>(nChans, nChans);
+  mLatencyCompensation->SetMaxDelayTime(std::max(maxLatency, mLatency));
+  mDSPLatency.store(mLatency);
+  mCompensationTarget.store(0);
+  mCompensationDelay = 0;
+}
+
+void IPlugProcessor::ChangeLatency(int latency, int crossfadeFrames)
+{
+  assert(mLatencyCompensation); // call EnableLatencyChanges() first
+
+  if (!mLatencyCompensation)
+    return;
+
+  const int reported = mLatency;
+  mDSPLatency.store(latency, std::memory_order_relaxed);
+  mCompensationFadeFrames.store(crossfadeFrames, std::memory_order_relaxed);
+  mCompensationTarget.store(std::max(reported - latency, 0), std::memory_order_release);
+
+  if (latency > reported)
+    mPendingLatency.store(latency, std::memory_order_release);
+}
+
+void IPlugProcessor::ReportPendingLatency()
+{
+  const int latency = mPendingLatency.exchange(-1, std::memory_order_acq_rel);
+
+  if (latency >= 0 && latency != mLatency)
+    SetLatency(latency);
 }
 
 //static
@@ -432,7 +606,14 @@ void IPlugProcessor::SetChannelConnections(ERoute direction, int idx, int n, boo
   for (auto i = idx; i < endIdx; ++i)
   {
     IChannelData<>* pChannel = channelData.Get(i);
-    pChannel->mConnected = connected;
+
+    // most API classes set the connections every block, so only flag actual changes
+    if (pChannel->mConnected != connected)
+    {
+      pChannel->mConnected = connected;
+      mConnected[direction].Get()[i] = connected;
+      mBusConnectionsChanged = true;
+    }
 
     if (!connected)
       *(pChannel->mData) = pChannel->mScratchBuf.Get();
@@ -441,22 +622,27 @@ void IPlugProcessor::SetChannelConnections(ERoute direction, int idx, int n, boo
 
 void IPlugProcessor::AttachBuffers(ERoute direction, int idx, int n, PLUG_SAMPLE_DST** ppData, int)
 {
-  WDL_PtrList<IChannelData<>>& channelData = mChannelData[direction];
+  mOtherPrecisionAttached = false;
 
-  const auto endIdx = std::min(idx + n, channelData.GetSize());
+  // each IChannelData::mData points at its own slot in mScratchData
+  const uint8_t* pConnected = mConnected[direction].Get();
+  sample** ppScratch = mScratchData[direction].Get();
+
+  const auto endIdx = std::min(idx + n, mConnected[direction].GetSize());
 
   for (auto i = idx; i < endIdx; ++i)
   {
-    IChannelData<>* pChannel = channelData.Get(i);
-
-    if (pChannel->mConnected)
-      *(pChannel->mData) = *(ppData++);
+    if (pConnected[i])
+      ppScratch[i] = *(ppData++);
   }
 }
 
 void IPlugProcessor::AttachBuffers(ERoute direction, int idx, int n, PLUG_SAMPLE_SRC** ppData, int nFrames)
 {
   WDL_PtrList<IChannelData<>>& channelData = mChannelData[direction];
+  PLUG_SAMPLE_SRC** ppOther = mOtherPrecisionData[direction].Get();
+
+  mOtherPrecisionAttached = CanProcessOtherPrecision(nFrames);
 
   const auto endIdx = std::min(idx + n, channelData.GetSize());
 
@@ -466,23 +652,73 @@ void IPlugProcessor::AttachBuffers(ERoute direction, int idx, int n, PLUG_SAMPLE
 
     if (pChannel->mConnected)
     {
+      PLUG_SAMPLE_SRC* pHostData = *(ppData++);
+      ppOther[i] = pHostData;
+
       if (direction == ERoute::kInput)
       {
-        PLUG_SAMPLE_DST* pScratch = pChannel->mScratchBuf.Get();
-        CastCopy(pScratch, *(ppData++), nFrames);
-        *(pChannel->mData) = pScratch;
+        // the inputs are only converted if they are needed at ::sample precision, see ConvertOtherPrecisionInputs()
+        if (!mOtherPrecisionAttached)
+        {
+          PLUG_SAMPLE_DST* pScratch = pChannel->mScratchBuf.Get();
+          CastCopy(pScratch, pHostData, nFrames);
+          *(pChannel->mData) = pScratch;
+        }
       }
       else // output
       {
         *(pChannel->mData) = pChannel->mScratchBuf.Get();
-        pChannel->mIncomingData = *(ppData++);
+        pChannel->mIncomingData = pHostData;
       }
     }
   }
 }
 
+bool IPlugProcessor::CanProcessOtherPrecision(int nFrames) const
+{
+  // the plug-in can process the host's buffers itself, unless the block has to go through ProcessBuses() or the latency compensation
+  if (!DoesOtherPrecision() || mProcessBuses || mLatencyCompensation || nFrames > mBlockSize)
+    return false;
+
+  for (auto d = 0; d < 2; d++)
+  {
+    if (mOtherPrecisionScratch[d].GetSize() != mOtherPrecisionData[d].GetSize() * IAlignedBuf<PLUG_SAMPLE_SRC>::PaddedSize(mBlockSize))
+      return false;
+  }
+
+  return true;
+}
+
+void IPlugProcessor::ConvertOtherPrecisionInputs(int nFrames)
+{
+  if (!mOtherPrecisionAttached)
+    return;
+
+  WDL_PtrList<IChannelData<>>& channelData = mChannelData[ERoute::kInput];
+  PLUG_SAMPLE_SRC** ppOther = mOtherPrecisionData[ERoute::kInput].Get();
+
+  for (auto i = 0; i < channelData.GetSize(); ++i)
+  {
+    IChannelData<>* pChannel = channelData.Get(i);
+
+    if (pChannel->mConnected)
+    {
+      PLUG_SAMPLE_DST* pScratch = pChannel->mScratchBuf.Get();
+      CastCopy(pScratch, ppOther[i], nFrames);
+      *(pChannel->mData) = pScratch;
+    }
+  }
+
+  mOtherPrecisionAttached = false;
+}
+
 void IPlugProcessor::PassThroughBuffers(PLUG_SAMPLE_DST type, int nFrames)
 {
+  ENTER_DENORMAL_FTZ_SCOPE
+
+  // when bypassed, events are not split, but they must still reach the plug-in to keep its state up to date
+  FlushScheduledEvents();
+
   if (mLatency && mLatencyDelay)
     mLatencyDelay->ProcessBlock(mScratchData[ERoute::kInput].Get(), mScratchData[ERoute::kOutput].Get(), nFrames);
   else
@@ -492,29 +728,264 @@ void IPlugProcessor::PassThroughBuffers(PLUG_SAMPLE_DST type, int nFrames)
 void IPlugProcessor::PassThroughBuffers(PLUG_SAMPLE_SRC type, int nFrames)
 {
   // for PLUG_SAMPLE_SRC bit buffers, first run the delay (if mLatency) on the PLUG_SAMPLE_DST IPlug buffers
+  ConvertOtherPrecisionInputs(nFrames);
   PassThroughBuffers(PLUG_SAMPLE_DST(0.), nFrames);
+  CopyOutgoingBuffers(type, nFrames);
+}
 
-  int i, n = MaxNChannels(ERoute::kOutput);
-  IChannelData<>** ppOutChannel = mChannelData[ERoute::kOutput].GetList();
+void IPlugProcessor::ProcessBuffers(PLUG_SAMPLE_DST type, int nFrames)
+{
+  ENTER_DEADLINE_MONITOR_SCOPE(nFrames)
+  ENTER_DENORMAL_FTZ_SCOPE
 
-  for (i = 0; i < n; ++i, ++ppOutChannel)
+#ifdef IPLUG_STARTUP_TIMING
+  IStartupTimer::Scope startupTimingScope(IStartupTimer::kFirstProcess, !mFirstBlockTimed);
+  mFirstBlockTimed = true;
+#endif
+
+  mTransportMap.Finish(nFrames);
+
+  if (!mMessagesFromEditor.WasEmpty())
   {
-    IChannelData<>* pOutChannel = *ppOutChannel;
-    if (pOutChannel->mConnected)
-    {
-      CastCopy(pOutChannel->mIncomingData, *(pOutChannel->mData), nFrames);
-    }
+    mMessagesFromEditor.PopAll([this](int msgTag, int ctrlTag, int dataSize, const void* pData) {
+      OnMessageRT(msgTag, ctrlTag, dataSize, pData);
+    });
   }
+
+  UpdateSidechainActive(mScratchData[ERoute::kInput].Get(), nFrames);
+
+  if (mScheduledEvents.GetSize())
+    ProcessBuffersScheduled(nFrames, [this](int startFrame, int nSegmentFrames) { ProcessBuffersSegment(startFrame, nSegmentFrames); });
+  else
+    DispatchProcessBlock(mScratchData[ERoute::kInput].Get(), mScratchData[ERoute::kOutput].Get(), nFrames);
+
+  if (mLatencyCompensation)
+    ProcessLatencyCompensation(nFrames);
 }
 
-void IPlugProcessor::ProcessBuffers(PLUG_SAMPLE_DST type, int nFrames)
+void IPlugProcessor::ProcessLatencyCompensation(int nFrames)
 {
-  ProcessBlock(mScratchData[ERoute::kInput].Get(), mScratchData[ERoute::kOutput].Get(), nFrames);
+  const int target = mCompensationTarget.load(std::memory_order_acquire);
+
+  if (target != mCompensationDelay)
+  {
+    mLatencyCompensation->CrossfadeToDelayTime(target, mCompensationFadeFrames.load(std::memory_order_relaxed));
+    mCompensationDelay = target;
+  }
+
+  // always run, so the delay holds the recent output when it has to grow from zero
+  sample** ppOutputs = mScratchData[ERoute::kOutput].Get();
+  mLatencyCompensation->ProcessBlock(ppOutputs, ppOutputs, nFrames);
 }
 
 void IPlugProcessor::ProcessBuffers(PLUG_SAMPLE_SRC type, int nFrames)
 {
+  if (mOtherPrecisionAttached)
+  {
+    ProcessBuffersOtherPrecision(nFrames);
+    return;
+  }
+
   ProcessBuffers((PLUG_SAMPLE_DST) 0, nFrames);
+  CopyOutgoingBuffers(type, nFrames);
+}
+
+void IPlugProcessor::ProcessBuffersOtherPrecision(int nFrames)
+{
+  ENTER_DEADLINE_MONITOR_SCOPE(nFrames)
+  ENTER_DENORMAL_FTZ_SCOPE
+
+#ifdef IPLUG_STARTUP_TIMING
+  IStartupTimer::Scope startupTimingScope(IStartupTimer::kFirstProcess, !mFirstBlockTimed);
+  mFirstBlockTimed = true;
+#endif
+
+  mTransportMap.Finish(nFrames);
+
+  if (!mMessagesFromEditor.WasEmpty())
+  {
+    mMessagesFromEditor.PopAll([this](int msgTag, int ctrlTag, int dataSize, const void* pData) {
+      OnMessageRT(msgTag, ctrlTag, dataSize, pData);
+    });
+  }
+
+  // the unconnected channels get a block of scratch each, which is silent for the inputs
+  for (auto d = 0; d < 2; d++)
+  {
+    const int nChans = mOtherPrecisionData[d].GetSize();
+    const int stride = IAlignedBuf<PLUG_SAMPLE_SRC>::PaddedSize(mBlockSize);
+
+    const uint8_t* pConnected = mConnected[d].Get();
+    PLUG_SAMPLE_SRC** ppOther = mOtherPrecisionData[d].Get();
+
+    for (auto i = 0; i < nChans; i++)
+    {
+      if (!pConnected[i])
+        ppOther[i] = mOtherPrecisionScratch[d].Get() + i * stride;
+    }
+  }
+
+  PLUG_SAMPLE_SRC** ppInputs = mOtherPrecisionData[ERoute::kInput].Get();
+  PLUG_SAMPLE_SRC** ppOutputs = mOtherPrecisionData[ERoute::kOutput].Get();
+
+  UpdateSidechainActive(ppInputs, nFrames);
+
+  if (!mScheduledEvents.GetSize())
+  {
+    DispatchProcessBlock(ppInputs, ppOutputs, nFrames);
+    return;
+  }
+
+  ProcessBuffersScheduled(nFrames, [this, ppInputs, ppOutputs](int startFrame, int nSegmentFrames) {
+    PLUG_SAMPLE_SRC** ppData[2] = { ppInputs, ppOutputs };
+
+    for (auto d = 0; d < 2; d++)
+    {
+      PLUG_SAMPLE_SRC** ppDst = mOtherPrecisionSegmentData[d].Get();
+      const int n = mOtherPrecisionSegmentData[d].GetSize();
+
+      for (auto i = 0; i < n; ++i)
+        ppDst[i] = ppData[d][i] + startFrame;
+    }
+
+    DispatchProcessBlock(mOtherPrecisionSegmentData[ERoute::kInput].Get(), mOtherPrecisionSegmentData[ERoute::kOutput].Get(), nSegmentFrames);
+  });
+}
+
+template <typename T>
+void IPlugProcessor::UpdateSidechainActive(T** ppInputs, int nFrames)
+{
+  mSidechainActiveInBlock = false;
+
+  if (mBusOffsets[ERoute::kInput].GetSize() < 2 || mSidechainFlaggedSilent)
+    return;
+
+  const uint8_t* pConnected = mConnected[ERoute::kInput].Get();
+  const int nChans = mConnected[ERoute::kInput].GetSize();
+
+  // every bus after the main input is treated as side-chain
+  for (auto c = mBusOffsets[ERoute::kInput].Get()[1]; c < nChans; c++)
+  {
+    if (!pConnected[c])
+      continue;
+
+    if (!mDetectSilentSidechain)
+    {
+      mSidechainActiveInBlock = true;
+      return;
+    }
+
+    const T* pData = ppInputs[c];
+
+    for (auto s = 0; s < nFrames; s++)
+    {
+      if (pData[s] != 0.)
+      {
+        mSidechainActiveInBlock = true;
+        return;
+      }
+    }
+  }
+}
+
+void IPlugProcessor::ProcessBuffersSegment(int startFrame, int nFrames)
+{
+  if (startFrame == 0)
+  {
+    DispatchProcessBlock(mScratchData[ERoute::kInput].Get(), mScratchData[ERoute::kOutput].Get(), nFrames);
+    return;
+  }
+
+  for (auto d = 0; d < 2; d++)
+  {
+    sample** ppSrc = mScratchData[d].Get();
+    sample** ppDst = mSegmentData[d].Get();
+    const int n = mScratchData[d].GetSize();
+
+    for (auto i = 0; i < n; ++i)
+      ppDst[i] = ppSrc[i] + startFrame;
+  }
+
+  DispatchProcessBlock(mSegmentData[ERoute::kInput].Get(), mSegmentData[ERoute::kOutput].Get(), nFrames);
+}
+
+void IPlugProcessor::DispatchProcessBlock(sample** inputs, sample** outputs, int nFrames)
+{
+  ENTER_AUDIO_THREAD_ALLOCATION_SCOPE
+  mScratchArena.Reset();
+
+  if (!mProcessBuses)
+  {
+    ProcessBlock(inputs, outputs, nFrames);
+    return;
+  }
+
+  sample** ppChannels[2] = { inputs, outputs };
+
+  for (auto d = 0; d < 2; d++)
+  {
+    IBusBuffer* pBuses = mBusBuffers[d].Get();
+    const int* pOffsets = mBusOffsets[d].Get();
+    const int nBuses = mBusBuffers[d].GetSize();
+
+    if (mBusConnectionsChanged)
+    {
+      const uint8_t* pConnected = mConnected[d].Get();
+
+      for (auto bus = 0; bus < nBuses; bus++)
+      {
+        int nConnected = 0;
+
+        for (auto c = 0; c < pBuses[bus].mNChans; c++)
+          nConnected += pConnected[pOffsets[bus] + c];
+
+        pBuses[bus].mNConnected = nConnected;
+      }
+    }
+
+    for (auto bus = 0; bus < nBuses; bus++)
+      pBuses[bus].mData = ppChannels[d] + pOffsets[bus];
+  }
+
+  mBusConnectionsChanged = false;
+
+  ProcessBuses(mBusBuffers[ERoute::kInput].Get(), mBusBuffers[ERoute::kInput].GetSize(), mBusBuffers[ERoute::kOutput].Get(), mBusBuffers[ERoute::kOutput].GetSize(), nFrames);
+}
+
+void IPlugProcessor::DispatchProcessBlock(PLUG_SAMPLE_SRC** inputs, PLUG_SAMPLE_SRC** outputs, int nFrames)
+{
+  ENTER_AUDIO_THREAD_ALLOCATION_SCOPE
+  mScratchArena.Reset();
+  ProcessBlockOtherPrecision(inputs, outputs, nFrames);
+}
+
+template <typename F>
+void IPlugProcessor::ProcessBuffersScheduled(int nFrames, F&& processSegment)
+{
+  int startFrame = 0;
+  
+  while (startFrame < nFrames)
+  {
+    mSegmentStart = startFrame;
+    DispatchScheduledEvents(startFrame);
+    
+    int endFrame = nFrames;
+    
+    if (mScheduledEventsRead < mScheduledEvents.GetSize())
+      endFrame = std::min(endFrame, QuantiseOffset(mScheduledEvents.Get()[mScheduledEventsRead].mOffset));
+    
+    processSegment(startFrame, endFrame - startFrame);
+    startFrame = endFrame;
+  }
+  
+  mSegmentStart = 0;
+  
+  // events with offsets beyond the end of the block
+  FlushScheduledEvents();
+}
+
+void IPlugProcessor::CopyOutgoingBuffers(PLUG_SAMPLE_SRC type, int nFrames)
+{
   int i, n = MaxNChannels(ERoute::kOutput);
   IChannelData<>** ppOutChannel = mChannelData[ERoute::kOutput].GetList();
 
@@ -531,6 +1002,7 @@ void IPlugProcessor::ProcessBuffers(PLUG_SAMPLE_SRC type, int nFrames)
 
 void IPlugProcessor::ProcessBuffersAccumulating(int nFrames)
 {
+  ConvertOtherPrecisionInputs(nFrames);
   ProcessBuffers((PLUG_SAMPLE_DST) 0, nFrames);
   int i, n = MaxNChannels(ERoute::kOutput);
   IChannelData<>** ppOutChannel = mChannelData[ERoute::kOutput].GetList();
@@ -571,22 +1043,317 @@ void IPlugProcessor::SetBlockSize(int blockSize)
 {
   if (blockSize != mBlockSize)
   {
-    int i, nIn = MaxNChannels(ERoute::kInput), nOut = MaxNChannels(ERoute::kOutput);
+    if (mMaxBlockSize > 0 && blockSize > mMaxBlockSize)
+      DBGMSG("IPlugProcessor: block size %i is larger than PLUG_MAX_BLOCK_SIZE %i, so the buffers are reallocated\n", blockSize, mMaxBlockSize);
+
+    ResizeChannelScratch(blockSize);
+    mBlockSize = blockSize;
+    ResizeScratchArena();
+  }
+
+  // only plug-ins that process the host's buffers directly need a block of the other precision per channel.
+  // this is checked even if the block size hasn't changed, as it may first have been set from a constructor, before DoesOtherPrecision() was overridden.
+  // DoesOtherPrecision() can't be called from the constructor, so with a maximum block size this allocates once, on the first call
+  for (auto d = 0; d < 2; d++)
+  {
+    const int size = DoesOtherPrecision() ? mOtherPrecisionData[d].GetSize() * IAlignedBuf<PLUG_SAMPLE_SRC>::PaddedSize(std::max(blockSize, mMaxBlockSize)) : 0;
 
-    for (i = 0; i < nIn; ++i)
+    if (mOtherPrecisionScratch[d].GetSize() != size)
     {
-      IChannelData<>* pInChannel = mChannelData[ERoute::kInput].Get(i);
-      pInChannel->mScratchBuf.Resize(blockSize);
-      memset(pInChannel->mScratchBuf.Get(), 0, blockSize * sizeof(PLUG_SAMPLE_DST));
+      mOtherPrecisionScratch[d].Resize(size);
+      memset(mOtherPrecisionScratch[d].Get(), 0, size * sizeof(PLUG_SAMPLE_SRC));
     }
+  }
 
-    for (i = 0; i < nOut; ++i)
+  UpdateAudioBufferMemory();
+}
+
+void IPlugProcessor::SetScratchArenaSize(int nBuffersPerChannel, int nExtraBytes)
+{
+  mScratchArenaBuffersPerChannel = nBuffersPerChannel;
+  mScratchArenaExtraBytes = nExtraBytes;
+  ResizeScratchArena();
+}
+
+void IPlugProcessor::ResizeChannelScratch(int blockSize)
+{
+  // IAlignedBuf doesn't reallocate for the size it already has, so with a maximum block size this only clears
+  const int size = std::max(blockSize, mMaxBlockSize);
+
+  for (auto d = 0; d < 2; d++)
+  {
+    const int nChans = MaxNChannels(static_cast<ERoute>(d));
+
+    for (auto i = 0; i < nChans; ++i)
     {
-      IChannelData<>* pOutChannel = mChannelData[ERoute::kOutput].Get(i);
-      pOutChannel->mScratchBuf.Resize(blockSize);
-      memset(pOutChannel->mScratchBuf.Get(), 0, blockSize * sizeof(PLUG_SAMPLE_DST));
+      IChannelData<>* pChannel = mChannelData[d].Get(i);
+      pChannel->mScratchBuf.Resize(size);
+      memset(pChannel->mScratchBuf.Get(), 0, size * sizeof(PLUG_SAMPLE_DST));
     }
+  }
+}
 
-    mBlockSize = blockSize;
+void IPlugProcessor::ResizeScratchArena()
+{
+  const int nChans = MaxNChannels(ERoute::kInput) + MaxNChannels(ERoute::kOutput);
+  const int bufferSize = IScratchArena::PaddedSize(std::max(mBlockSize, mMaxBlockSize) * static_cast<int>(sizeof(sample)));
+  const int size = nChans * mScratchArenaBuffersPerChannel * bufferSize + IScratchArena::PaddedSize(mScratchArenaExtraBytes);
+
+  if (size != mScratchArena.GetSize())
+    mScratchArena.Resize(size);
+
+  UpdateAudioBufferMemory();
+}
+
+void IPlugProcessor::UpdateAudioBufferMemory()
+{
+  // the API class is the plug-in's IEditorDelegate, which can't be reached until it is constructed
+  if (!mMemoryStats)
+  {
+    if (IEditorDelegate* pDelegate = dynamic_cast<IEditorDelegate*>(this))
+      mMemoryStats = pDelegate->GetMemoryStats();
   }
+
+  int64_t bytes = mScratchArena.GetSize();
+
+  for (auto d = 0; d < 2; d++)
+  {
+    for (auto i = 0; i < mChannelData[d].GetSize(); i++)
+      bytes += static_cast<int64_t>(mChannelData[d].Get(i)->mScratchBuf.GetSize()) * sizeof(PLUG_SAMPLE_DST);
+
+    bytes += static_cast<int64_t>(mOtherPrecisionScratch[d].GetSize()) * sizeof(PLUG_SAMPLE_SRC);
+  }
+
+  mAudioBufferMemory.Set(mMemoryStats, IMemoryStats::kAudioBuffers, bytes);
+}
+
+#pragma mark - Sample accurate events
+
+void IPlugProcessor::SetSampleAccurateEvents(bool enable, int granularity)
+{
+  mSampleAccurateEvents = enable;
+  mEventGranularity = std::max(granularity, 1);
+  
+  if (enable)
+  {
+    // Preallocate so that typical amounts of events in a block don't cause allocations on the audio thread
+    mScheduledEvents.Resize(MIDI_TRANSFER_SIZE + PARAM_TRANSFER_SIZE);
+  }
+  
+  mScheduledEvents.Resize(0, false);
+  mScheduledEventsRead = 0;
+}
+
+void IPlugProcessor::ScheduleMidiMsg(const IMidiMsg& msg)
+{
+  NOTE_DEADLINE_MONITOR(NoteMidiMsg)
+
+  if (mSampleAccurateEvents)
+  {
+    IScheduledEvent event;
+    event.mType = IScheduledEvent::kMidiMsg;
+    event.mOffset = msg.mOffset;
+    event.mMidiMsg = msg;
+    AddScheduledEvent(event);
+  }
+  else
+    ProcessMidiMsg(msg);
+}
+
+void IPlugProcessor::ScheduleMidi2Msg(const IMidi2Msg& msg)
+{
+  NOTE_DEADLINE_MONITOR(NoteMidiMsg)
+
+  if (mSampleAccurateEvents)
+  {
+    IScheduledEvent event;
+    event.mType = IScheduledEvent::kMidi2Msg;
+    event.mOffset = msg.mOffset;
+    event.mMidi2Msg = msg;
+    AddScheduledEvent(event);
+  }
+  else
+    ProcessMidi2Msg(msg);
+}
+
+void IPlugProcessor::ScheduleSysEx(const ISysEx& msg)
+{
+  NOTE_DEADLINE_MONITOR(NoteMidiMsg)
+
+  if (mSampleAccurateEvents)
+  {
+    IScheduledEvent event;
+    event.mType = IScheduledEvent::kSysEx;
+    event.mOffset = msg.mOffset;
+    event.mSysEx = msg;
+    AddScheduledEvent(event);
+  }
+  else
+  {
+    ISysEx sysex = msg;
+    ProcessSysEx(sysex);
+  }
+}
+
+void IPlugProcessor::ScheduleParamChange(int paramIdx, double normalizedValue, int offset)
+{
+  NOTE_DEADLINE_MONITOR(NoteParamChange)
+
+  if (mSampleAccurateEvents)
+  {
+    IScheduledEvent event;
+    event.mType = IScheduledEvent::kParamChange;
+    event.mOffset = offset;
+    event.mParam = ParamTuple(paramIdx, normalizedValue);
+    AddScheduledEvent(event);
+  }
+  else
+    ProcessScheduledParamChange(paramIdx, normalizedValue, offset);
+}
+
+void IPlugProcessor::FlushScheduledEvents()
+{
+  DispatchScheduledEvents(0, true);
+}
+
+void IPlugProcessor::AddScheduledEvent(const IScheduledEvent& event)
+{
+  int insertIdx = mScheduledEvents.GetSize();
+  
+  // events usually arrive in time order, but different sources (e.g. MIDI and parameter queues) must be merged
+  while (insertIdx > mScheduledEventsRead && mScheduledEvents.Get()[insertIdx - 1].mOffset > event.mOffset)
+    insertIdx--;
+  
+  mScheduledEvents.Insert(event, insertIdx);
+}
+
+void IPlugProcessor::DispatchScheduledEvents(int startFrame, bool all)
+{
+  const int nEvents = mScheduledEvents.GetSize();
+  
+  while (mScheduledEventsRead < nEvents)
+  {
+    IScheduledEvent& event = mScheduledEvents.Get()[mScheduledEventsRead];
+    
+    if (!all && QuantiseOffset(event.mOffset) > startFrame)
+      break;
+    
+    mScheduledEventsRead++;
+    
+    const int offset = std::max(event.mOffset - startFrame, 0);
+    
+    switch (event.mType)
+    {
+      case IScheduledEvent::kMidiMsg:
+        event.mMidiMsg.mOffset = offset;
+        ProcessMidiMsg(event.mMidiMsg);
+        break;
+      case IScheduledEvent::kMidi2Msg:
+        event.mMidi2Msg.mOffset = offset;
+        ProcessMidi2Msg(event.mMidi2Msg);
+        break;
+      case IScheduledEvent::kSysEx:
+        event.mSysEx.mOffset = offset;
+        ProcessSysEx(event.mSysEx);
+        break;
+      case IScheduledEvent::kParamChange:
+        ProcessScheduledParamChange(event.mParam.idx, event.mParam.value, offset);
+        break;
+    }
+  }
+  
+  if (mScheduledEventsRead >= mScheduledEvents.GetSize())
+  {
+    mScheduledEvents.Resize(0, false);
+    mScheduledEventsRead = 0;
+  }
+}
+
+#pragma mark - Audio workgroup
+
+void IAudioWorkgroup::SetOSWorkgroup(void* pOSWorkgroup)
+{
+#if IPLUG_AUDIO_WORKGROUP
+  if (__builtin_available(macOS 11.0, iOS 14.0, *))
+  {
+    void* pOld = nullptr;
+
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+
+      if (pOSWorkgroup == mOSWorkgroup)
+        return;
+
+      pOld = mOSWorkgroup;
+      mOSWorkgroup = pOSWorkgroup ? os_retain(static_cast<os_workgroup_t>(pOSWorkgroup)) : nullptr;
+      mGeneration.fetch_add(1, std::memory_order_release);
+    }
+
+    if (pOld)
+      os_release(static_cast<os_workgroup_t>(pOld));
+  }
+#endif
+}
+
+int IAudioWorkgroup::GetMaxParallelThreads() const
+{
+#if IPLUG_AUDIO_WORKGROUP
+  if (__builtin_available(macOS 11.0, iOS 14.0, *))
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    if (mOSWorkgroup)
+      return os_workgroup_max_parallel_threads(static_cast<os_workgroup_t>(mOSWorkgroup), nullptr);
+  }
+#endif
+  return 0;
+}
+
+void IAudioWorkgroup::Membership::Join(IAudioWorkgroup* pWorkgroup, uint32_t generation)
+{
+  Leave();
+  mWorkgroup = pWorkgroup;
+  mGeneration = generation;
+
+  if (!pWorkgroup)
+    return;
+
+#if IPLUG_AUDIO_WORKGROUP
+  if (__builtin_available(macOS 11.0, iOS 14.0, *))
+  {
+    std::lock_guard<std::mutex> lock(pWorkgroup->mMutex);
+
+    if (pWorkgroup->mOSWorkgroup)
+    {
+      os_workgroup_t osWorkgroup = static_cast<os_workgroup_t>(pWorkgroup->mOSWorkgroup);
+
+      // retained while joined, since the host can replace the workgroup before this thread gets round to leaving it
+      if (os_workgroup_join(osWorkgroup, &mToken) == 0)
+        mJoined = os_retain(osWorkgroup);
+    }
+  }
+
+  // without a workgroup, the user interactive QoS at least keeps the thread off the efficiency cores
+  if (!mJoined && !mPromoted)
+    mPromoted = pthread_set_qos_class_self_np(QOS_CLASS_USER_INTERACTIVE, 0) == 0;
+#endif
+}
+
+void IAudioWorkgroup::Membership::Leave()
+{
+#if IPLUG_AUDIO_WORKGROUP
+  if (mJoined)
+  {
+    if (__builtin_available(macOS 11.0, iOS 14.0, *))
+    {
+      os_workgroup_t osWorkgroup = static_cast<os_workgroup_t>(mJoined);
+      os_workgroup_leave(osWorkgroup, &mToken);
+      os_release(osWorkgroup);
+    }
+
+    mJoined = nullptr;
+  }
+#endif
+  mWorkgroup = nullptr;
+  mGeneration = 0;
 }
@@ -16,6 +16,8 @@
 #include <cmath>
 #include <cstdio>
 #include <cassert>
+#include <atomic>
+#include <functional>
 #include <memory>
 #include <vector>
 
@@ -23,9 +25,18 @@
 
 #include "IPlugPlatform.h"
 #include "IPlugConstants.h"
+#include "IPlugQueue.h"
 #include "IPlugStructs.h"
+#include "ITransportMap.h"
+#include "IPlugStartupTimer.h"
 #include "IPlugUtilities.h"
 #include "NChanDelay.h"
+#include "IPlugAudioWorkgroup.h"
+#include "IPlugMemoryStats.h"
+
+#ifdef IPLUG_DEADLINE_MONITOR
+#include "IPlugDeadlineMonitor.h"
+#endif
 
 /**
  * @file
@@ -35,6 +46,18 @@
 BEGIN_IPLUG_NAMESPACE
 
 struct Config;
+class IDeadlineMonitor;
+
+/** The channels of one bus for a block, as passed to IPlugProcessor::ProcessBuses() */
+struct IBusBuffer
+{
+  /** One pointer per channel on the bus */
+  sample** mData = nullptr;
+  /** The number of channels on the bus, which is the most it has in any I/O config */
+  int mNChans = 0;
+  /** How many of the channels the host has connected. The others are silent scratch buffers */
+  int mNConnected = 0;
+};
 
 /** The base class for IPlug Audio Processing. It knows nothing about presets or parameters or user interface.  */
 class IPlugProcessor
@@ -56,24 +79,75 @@ public:
    * (the maximum possible input channel count and the maximum possible output channel count including multiple buses).
    * If the host hasn't connected all the pins, the unconnected channels will be full of zeros.
    * THIS METHOD IS CALLED BY THE HIGH PRIORITY AUDIO THREAD - You should be careful not to do any unbounded, blocking operations such as file I/O which could cause audio dropouts
+   * Channels that IPlug provides, i.e. unconnected ones and those converted from the host's precision, are IPLUG_BUFFER_ALIGNMENT byte aligned (see IAlignedBuf).
+   * Channels the host passes in its own precision are used in place, so they are only as aligned as the host makes them, and blocks split for sample accurate events
+   * start part way into the buffers, so always check the alignment before using aligned SIMD loads and stores.
    * @param inputs Two-dimensional array containing the non-interleaved input buffers of audio samples for all channels
    * @param outputs Two-dimensional array for audio output (non-interleaved).
    * @param nFrames The block size for this block: number of samples per channel.*/
   virtual void ProcessBlock(sample** inputs, sample** outputs, int nFrames);
 
+  /** Override this as well as ProcessBlock() to process the host's buffers directly when the host runs at the other precision to ::sample, usually single precision,
+   * rather than having them converted to and from ::sample scratch buffers. It is only called if DoesOtherPrecision() returns \c true.
+   * The easiest way to implement both is a member template ProcessBlockT<T>() and the IPLUG_PROCESS_BLOCK_BOTH_PRECISIONS macro.
+   * Bus processing, latency changes and bypass still convert, see DoesOtherPrecision()
+   * THIS METHOD IS CALLED BY THE HIGH PRIORITY AUDIO THREAD
+   * @param inputs The non-interleaved input buffers, as for ProcessBlock()
+   * @param outputs The non-interleaved output buffers, as for ProcessBlock()
+   * @param nFrames The block size for this block: number of samples per channel */
+  virtual void ProcessBlockOtherPrecision(PLUG_SAMPLE_SRC** inputs, PLUG_SAMPLE_SRC** outputs, int nFrames) {}
+
+  /** Override this to return \c true if the plug-in implements ProcessBlockOtherPrecision(). It is not used when SetProcessBuses() or EnableLatencyChanges() have been called,
+   * as ProcessBuses() and the latency compensation only work at ::sample precision */
+  virtual bool DoesOtherPrecision() const { return false; }
+
+  /** Override this method instead of ProcessBlock() to get the channels split into buses, for instance a main bus and a sidechain, and call SetProcessBuses() in your constructor.
+   * The layout is worked out from the I/O configs once, and the connection counts are only updated when the host changes them, so there is no per-channel work per block.
+   * The default implementation calls ProcessBlock() with all the channels.
+   * THIS METHOD IS CALLED BY THE HIGH PRIORITY AUDIO THREAD
+   * @param pInputs One IBusBuffer per input bus
+   * @param nInputBuses The number of input buses, the most in any I/O config
+   * @param pOutputs One IBusBuffer per output bus
+   * @param nOutputBuses The number of output buses, the most in any I/O config
+   * @param nFrames The block size for this block: number of samples per channel */
+  virtual void ProcessBuses(const IBusBuffer* pInputs, int nInputBuses, const IBusBuffer* pOutputs, int nOutputBuses, int nFrames)
+  {
+    ProcessBlock(nInputBuses ? pInputs[0].mData : nullptr, nOutputBuses ? pOutputs[0].mData : nullptr, nFrames);
+  }
+
   /** Override this method to handle incoming MIDI messages. The method is called prior to ProcessBlock().
-   * You can use IMidiQueue in combination with this method in order to queue the message and process at the appropriate time in ProcessBlock()
+   * You can use IFixedMidiQueue in combination with this method in order to queue the message and process at the appropriate time in ProcessBlock()
    * THIS METHOD IS CALLED BY THE HIGH PRIORITY AUDIO THREAD - You should be careful not to do any unbounded, blocking operations such as file I/O which could cause audio dropouts
    * @param msg The incoming midi message (includes a timestamp to indicate the offset in the forthcoming block of audio to be processed in ProcessBlock()) */
   virtual void ProcessMidiMsg(const IMidiMsg& msg);
 
+  /** Override this method to handle incoming MIDI 2.0 channel voice messages, which have high resolution values and per-note controllers. The method is called prior to ProcessBlock(), like ProcessMidiMsg().
+   * API classes call this for events that don't fit in an IMidiMsg, such as VST3 note expression, or for all MIDI if the host sends MIDI 2.0.
+   * The default implementation converts the message to MIDI 1.0 and calls ProcessMidiMsg(), dropping messages that have no MIDI 1.0 equivalent, so plug-ins that don't override it see no difference.
+   * THIS METHOD IS CALLED BY THE HIGH PRIORITY AUDIO THREAD - You should be careful not to do any unbounded, blocking operations such as file I/O which could cause audio dropouts
+   * @param msg The incoming MIDI 2.0 message (includes a timestamp to indicate the offset in the forthcoming block of audio to be processed in ProcessBlock()) */
+  virtual void ProcessMidi2Msg(const IMidi2Msg& msg);
+
   /** Override this method to handle incoming MIDI System Exclusive (SysEx) messages. The method is called prior to ProcessBlock().
    * THIS METHOD IS CALLED BY THE HIGH PRIORITY AUDIO THREAD - You should be careful not to do any unbounded, blocking operations such as file I/O which could cause audio dropouts */
   virtual void ProcessSysEx(ISysEx& msg) {}
 
+  /** Override this method to receive messages sent by the editor with IEditorDelegate::SendArbitraryMsgToDSPFromUI(), such as a drawn envelope or a step sequencer pattern.
+   * The messages are delivered in the order they were sent, at the start of the next block, before ProcessBlock(). Unlike OnMessage() no locking or copying is needed,
+   * but pData points into the queue, so copy what you need to keep.
+   * THIS METHOD IS CALLED BY THE HIGH PRIORITY AUDIO THREAD - You should be careful not to do any unbounded, blocking operations such as file I/O which could cause audio dropouts
+   * @param msgTag A unique tag to identify the message
+   * @param ctrlTag A unique tag to identify the control that sent the message, if desired
+   * @param dataSize The size in bytes of the data payload pointed to by pData
+   * @param pData Ptr to the opaque data payload for the message, which is only valid during the call */
+  virtual void OnMessageRT(int msgTag, int ctrlTag, int dataSize, const void* pData) {}
+
   /** Override this method in your plug-in class to do something prior to playback etc. (e.g.clear buffers, update internal DSP with the latest sample rate) */
   virtual void OnReset() { TRACE }
 
+  /** Called by the API classes to call OnReset(), which is timed when built with IPLUG_STARTUP_TIMING defined, see IStartupTimer */
+  void ResetFromAPI() { ENTER_STARTUP_TIMING_SCOPE(kReset) OnReset(); }
+
   /** Override OnActivate() which should be called by the API class when a plug-in is "switched on" by the host on a track when the channel count is known.
    * This may not work reliably because different hosts have different interpretations of "activate".
    * Unlike OnReset() which called when the transport is reset or the sample rate changes OnActivate() is a good place to handle change of I/O connections.
@@ -82,6 +156,26 @@ public:
 
 #pragma mark - Methods you can call - some of which have custom implementations in the API classes, some implemented in IPlugProcessor.cpp
 
+  /** Set a function that builds data the DSP needs but the constructor doesn't, such as tables, filter banks or samples, so that instantiating the plug-in is quick.
+   * Hosts create plug-ins to scan them and load projects with hundreds of instances, and many are never processed. The function is called once,
+   * before the first OnReset() or OnActivate(), on the thread the host calls them on. Call this in your constructor
+   * @param func The function, usually a lambda capturing \c this */
+  void SetDeferredInitFunc(std::function<void()> func) { mDeferredInitFunc = std::move(func); }
+
+  /** Called by the API classes before OnReset() and OnActivate(), to call the function given to SetDeferredInitFunc() if it has not been already */
+  void EnsureDeferredInit()
+  {
+    if (mDeferredInitFunc)
+    {
+      auto func = std::move(mDeferredInitFunc);
+      mDeferredInitFunc = nullptr;
+      func();
+    }
+  }
+
+  /** @return \c true if there is no deferred initialization left to do */
+  bool IsDeferredInitDone() const { return !mDeferredInitFunc; }
+
   /** Send a single MIDI message // TODO: info about what thread should this be called on or not called on!
    * @param msg The IMidiMsg to send
    * @return \c true if successful */
@@ -103,9 +197,35 @@ public:
   /** @return Maximum block size in samples, actual blocksize may vary each ProcessBlock() */
   int GetBlockSize() const { return mBlockSize; }
 
+  /** @return The largest block size declared with PLUG_MAX_BLOCK_SIZE in config.h, or 0 if none was. When it is declared, the framework's channel scratch buffers
+   * and the scratch arena are allocated for it when the plug-in is made, so that a host changing the block size up to it, even while processing, doesn't allocate.
+   * Size the plug-in's own block based buffers (and OverSampler::SetMaxBlockSize()) with it too, in the constructor, and only update state in OnReset() */
+  int GetMaxBlockSize() const { return mMaxBlockSize; }
+
+  /** @return The largest sample rate declared with PLUG_MAX_SAMPLE_RATE in config.h, or 0 if none was, to size delay lines and other buffers that depend on the sample rate
+   * in the constructor, rather than in OnReset() */
+  double GetMaxSampleRate() const { return mMaxSampleRate; }
+
   /** @return Plugin latency (in samples) */
   int GetLatency() const { return mLatency; }
 
+  /** Reserve a scratch arena for temporary buffers in ProcessBlock(). It is resized whenever the block size changes, before OnReset(), and reset before every ProcessBlock() call,
+   * so buffers from GetScratchArena().Allocate() last for one block and there is no allocation on the audio thread. Call this in your constructor or OnReset()
+   * @param nBuffersPerChannel The number of block sized sample buffers needed for each input and output channel
+   * @param nExtraBytes Room for anything else, which won't depend on the block size */
+  void SetScratchArenaSize(int nBuffersPerChannel, int nExtraBytes = 0);
+
+  /** @return The scratch arena reserved by SetScratchArenaSize(), which is reset before every ProcessBlock() call. Only use it on the audio thread */
+  IScratchArena& GetScratchArena() { return mScratchArena; }
+
+#ifdef IPLUG_DEADLINE_MONITOR
+  /** @return The monitor that times every process call against its deadline, when built with IPLUG_DEADLINE_MONITOR defined, otherwise nullptr.
+   * Call TransmitData() on it in OnIdle() to send its reports to a control, or Dump() to log them */
+  IDeadlineMonitor* GetDeadlineMonitor() { return &mDeadlineMonitor; }
+#else
+  IDeadlineMonitor* GetDeadlineMonitor() { return nullptr; }
+#endif
+
   /** @return The tail size in samples (useful for reverberation plug-ins, that may need to decay after the transport stops or an audio item ends) */
   int GetTailSize() { return mTailSize; }
 
@@ -135,6 +255,9 @@ public:
    *  @param denominator The lower part of the current time signature e.g "8" in the time signature 6/8 */
   void GetTimeSig(int& numerator, int& denominator) const { numerator = mTimeInfo.mNumerator; denominator = mTimeInfo.mDenominator; }
 
+  /** @return How the transport moves through the current block, including tempo changes and loop wraps within it, for exact tempo sync. See ITransportMap */
+  const ITransportMap& GetTransportMap() const { return mTransportMap; }
+
 #pragma mark -
   
   /** Get the name for a particular bus
@@ -177,7 +300,7 @@ public:
   /** @param direction Whether you want to test inputs or outputs
     * @param chIdx channel index
     * @return \c true if the host has connected this channel*/
-  bool IsChannelConnected(ERoute direction, int chIdx) const { return (chIdx < mChannelData[direction].GetSize() && mChannelData[direction].Get(chIdx)->mConnected); }
+  bool IsChannelConnected(ERoute direction, int chIdx) const { return (chIdx < mConnected[direction].GetSize() && mConnected[direction].Get()[chIdx]); }
 
   /** @param direction Whether you want to test inputs or outputs
    * @return The number of channels connected for input/output. WARNING: this assumes consecutive channel connections */
@@ -200,6 +323,16 @@ public:
   /** @return \c true if this plug-in has a side-chain input, which may not necessarily be active in the current I/O config */
   bool HasSidechainInput() const { return MaxNBuses(ERoute::kInput) > 1; }
 
+  /** Check this in ProcessBlock() to skip side-chain detectors (keyed compressors, gates, duckers...) when there is nothing to detect
+   * @return \c true if a side-chain channel is connected in this block, the host has not flagged all of the side-chain channels silent (VST3, AU and CLAP)
+   * and, if SetDetectSilentSidechain() is enabled, the connected side-chain channels are not all zeros */
+  bool IsSidechainActive() const { return mSidechainActiveInBlock; }
+
+  /** Call this (e.g. in your plug-in constructor) to have IsSidechainActive() return \c false when the side-chain buffers are all zeros, for hosts that pass silent buffers without flagging them.
+   * The scan stops at the first non-zero sample, so it only costs a full pass over the buffers when they are silent
+   * @param enable \c true to scan the side-chain for silence */
+  void SetDetectSilentSidechain(bool enable) { mDetectSilentSidechain = enable; }
+
   /** This is called by IPlugVST in order to limit a plug-in to stereo I/O for certain picky hosts \todo may no longer be relevant*/
   void LimitToStereoIO();//TODO: this should be updated
 
@@ -234,12 +367,43 @@ public:
    @param latency Latency in samples */
   virtual void SetLatency(int latency);
 
+  /** Call this in your constructor to be able to change the latency while processing with ChangeLatency(), e.g. to switch lookahead or oversampling on the fly.
+   * Allocates a delay for the outputs, which is used to keep their timing when the latency gets shorter
+   * @param maxLatency The longest latency the plug-in will have, in samples */
+  void EnableLatencyChanges(int maxLatency);
+
+  /** Call this when the latency of your DSP changes while processing, e.g. in OnParamChange() or ProcessBlock() when a high quality mode is toggled. Requires EnableLatencyChanges(), and can be called on the audio thread.
+   * If the new latency is no longer than the one reported to the host, the outputs are delayed by the difference so that their timing doesn't change, and the host needn't be told.
+   * If it is longer, it is reported to the host from the main thread, which asks for a restart with the APIs that need one, and the outputs are not delayed.
+   * Either way changes of the output delay are crossfaded, to hide the jump. To drop extra latency that is no longer needed, call SetLatency() with GetDSPLatency() when a glitch won't matter, e.g. in OnReset()
+   * @param latency The new latency of the DSP in samples, at most the maxLatency given to EnableLatencyChanges()
+   * @param crossfadeFrames The length of the crossfade when the output delay changes */
+  void ChangeLatency(int latency, int crossfadeFrames = 256);
+
+  /** @return The latency of the DSP, set by ChangeLatency(), which may be shorter than the reported GetLatency() */
+  int GetDSPLatency() const { return mLatencyCompensation ? mDSPLatency.load(std::memory_order_relaxed) : mLatency; }
+
+  /** Called on the main thread by IPlugAPIBase's timer, reports a latency queued by ChangeLatency() to the host with SetLatency() */
+  void ReportPendingLatency();
+
   /** Call this method if you need to update the tail size at runtime, for example if the decay time of your reverb effect changes
    * Some apis have special interpretations of certain numbers. For VST3 set to 0xffffffff for infinite tail, or 0 for none (default)
    * For VST2 setting to 1 means no tail
    * @param tailSize the new tailsize in samples*/
   void SetTailSize(int tailSize) { mTailSize = tailSize; }
 
+#pragma mark - Sample accurate events
+  
+  /** Call this (e.g. in your plug-in constructor) to split ProcessBlock() into segments at the offsets of incoming MIDI, SysEx and parameter automation events.
+   * ProcessMidiMsg(), ProcessSysEx() and OnParamChange() are then called immediately before the segment that starts at the event, with offsets relative to that segment,
+   * so that the accuracy of events no longer depends on the host's buffer size. Parameter automation is only scheduled for APIs that provide timestamped parameter changes.
+   * @param enable \c true to enable sample accurate events
+   * @param granularity Event offsets are rounded down to a multiple of this many samples, in order to limit the number of segments when there are dense events */
+  void SetSampleAccurateEvents(bool enable, int granularity = 1);
+  
+  /** @return \c true if sample accurate event scheduling has been enabled, see SetSampleAccurateEvents() */
+  bool GetSampleAccurateEvents() const { return mSampleAccurateEvents; }
+
   /** A static method to parse the config.h channel I/O string.
    * @param IOStr Space separated cstring list of I/O configurations for this plug-in in the format ninchans-noutchans.
    * A hypen character \c(-) deliminates input-output. Supports multiple buses, which are indicated using a period \c(.) character.
@@ -253,6 +417,57 @@ public:
    * @return The number of space separated channel I/O configs that have been detected in IOStr */
   static int ParseChannelIOStr(const char* IOStr, WDL_PtrList<IOConfig>& channelIOList, int& totalNInChans, int& totalNOutChans, int& totalNInBuses, int& totalNOutBuses);
 
+  /** Call this (e.g. in your plug-in constructor) to let the host skip processing while the plug-in is silent. Once every input channel has been flagged silent by the host
+   * for longer than the tail and the latency, ProcessBlock() is not called, the outputs are cleared, and they are flagged silent, so the host can skip work downstream too.
+   * Only for plug-ins whose output depends on their input, with a finite tail, see SetTailSize(). Currently only supported by VST3
+   * @param enable \c true to skip silent blocks */
+  void SetSkipSilentBlocks(bool enable) { mSkipSilentBlocks = enable; }
+
+  /** @return \c true if silent blocks may be skipped, see SetSkipSilentBlocks() */
+  bool GetSkipSilentBlocks() const { return mSkipSilentBlocks; }
+
+  /** Call this in your constructor to have ProcessBuses() called rather than ProcessBlock()
+   * @param enable \c true to process buses */
+  void SetProcessBuses(bool enable) { mProcessBuses = enable; }
+
+  /** Call this in your constructor if you override ProcessMidi2Msg(), to ask hosts that can send MIDI 2.0 to do so. Currently used by AUv3 on macOS 12 and iOS 15 or later.
+   * VST3 note expression is always passed to ProcessMidi2Msg(), define VST3_NOTE_EXPRESSIONS 1 to advertise it to the host
+   * @param enable \c true to receive MIDI 2.0 */
+  void SetMidi2Input(bool enable) { mMidi2Input = enable; }
+
+  /** @return \c true if the plug-in asks for MIDI 2.0 input, see SetMidi2Input() */
+  bool GetMidi2Input() const { return mMidi2Input; }
+
+#pragma mark - Host thread pool
+
+  /** A function that ExecuteParallel() calls once for each task, on one of the host's threads */
+  using ParallelTask = void (*)(void* pContext, int taskIdx);
+
+  /** Call this on the audio thread, from ProcessBlock(), to have the host run tasks on its own worker threads, for example to render voices in parallel without
+   * competing with the host's threads for the cores. It returns when all the tasks are done. Currently only supported by CLAP, using the thread-pool extension
+   * @param task Called once for each task index from 0 to nTasks - 1, possibly concurrently
+   * @param pContext Passed to task
+   * @param nTasks The number of tasks
+   * @return \c true if the host ran all the tasks, \c false if it can't, in which case none were run and the caller should run them itself */
+  virtual bool ExecuteParallel(ParallelTask task, void* pContext, int nTasks) { return false; }
+
+  /** @return The host's audio workgroup, which the plug-in's own realtime worker threads should join with an IAudioWorkgroup::Membership, so that they are
+   * scheduled to meet the host's deadline. The host provides one with AUv2 and AUv3 on macOS 11 and iOS 14 or later, elsewhere joining it only raises the threads' priority */
+  IAudioWorkgroup& GetAudioWorkgroup() { return mAudioWorkgroup; }
+
+#pragma mark - Messages from the editor
+
+  /** Copies a message into the queue for OnMessageRT(). This is called by IPlugAPIBase::SendArbitraryMsgToDSPFromUI(), on the UI thread, so you should not need to call it.
+   * The queue is allocated with RT_MESSAGE_TRANSFER_SIZE bytes on the first message
+   * @return \c false if the queue is full, in which case the message is dropped */
+  bool QueueMessageFromEditor(int msgTag, int ctrlTag, int dataSize, const void* pData)
+  {
+    if (!mMessagesFromEditor.GetCapacity())
+      mMessagesFromEditor.Resize(RT_MESSAGE_TRANSFER_SIZE); // nothing has been pushed, so the audio thread doesn't touch the ring yet
+
+    return mMessagesFromEditor.Push(msgTag, ctrlTag, dataSize, pData);
+  }
+
 protected:
 #pragma mark - Methods called by the API class - you do not call these methods in your plug-in class
   void SetChannelConnections(ERoute direction, int idx, int n, bool connected);
@@ -266,15 +481,67 @@ protected:
   void ProcessBuffers(PLUG_SAMPLE_SRC type, int nFrames);
   void ProcessBuffers(PLUG_SAMPLE_DST type, int nFrames);
   void ProcessBuffersAccumulating(int nFrames); // only for VST2 deprecated method single precision
+  void ProcessBuffersSegment(int startFrame, int nFrames); // calls ProcessBlock() on a sub-range of the attached scratch buffers, for splitting blocks at event offsets
+  void CopyOutgoingBuffers(PLUG_SAMPLE_SRC type, int nFrames);
+  void CopyOutgoingBuffers(PLUG_SAMPLE_DST type, int nFrames) {} // nothing to do when the host buffers are attached directly
+  
+  /** Called by the API class with an incoming MIDI message. If sample accurate events are enabled the message is queued until the segment at its offset, otherwise ProcessMidiMsg() is called straight away */
+  void ScheduleMidiMsg(const IMidiMsg& msg);
+  /** Called by the API class with an incoming MIDI 2.0 message, which is queued or passed to ProcessMidi2Msg() in the same way as ScheduleMidiMsg() */
+  void ScheduleMidi2Msg(const IMidi2Msg& msg);
+  /** Called by the API class with an incoming SysEx message. The data must stay valid until the end of the current block */
+  void ScheduleSysEx(const ISysEx& msg);
+  /** Called by the API class with a timestamped parameter change, which will be passed to ProcessScheduledParamChange() at its offset */
+  void ScheduleParamChange(int paramIdx, double normalizedValue, int offset);
+  /** Dispatches any events that have not been consumed by ProcessBuffers(). API classes should call this at the end of a process call in which ProcessBuffers() may not be reached */
+  void FlushScheduledEvents();
+  /** @return When processing a segment, the offset of the segment in the current block. API classes add this to the offsets of outgoing events */
+  int GetSegmentStart() const { return mSegmentStart; }
+  
+  /** Implemented by API classes that schedule parameter changes, in order to update the parameter and call OnParamChange()
+   * @param paramIdx The index of the parameter
+   * @param normalizedValue The new normalized value
+   * @param offset The offset relative to the start of the segment that is about to be processed */
+  virtual void ProcessScheduledParamChange(int paramIdx, double normalizedValue, int offset) {}
   void ZeroScratchBuffers();
   void SetSampleRate(double sampleRate) { mSampleRate = sampleRate; }
   void SetBlockSize(int blockSize);
   void SetBypassed(bool bypassed) { mBypassed = bypassed; }
-  void SetTimeInfo(const ITimeInfo& timeInfo) { mTimeInfo = timeInfo; }
+  /** Called by API classes before processing a block with the host transport at its start
+   * @param timeInfo The host transport
+   * @param tempoIncrement The change in tempo per sample, for hosts that ramp the tempo within a block */
+  void SetTimeInfo(const ITimeInfo& timeInfo, double tempoIncrement = 0.) { mTimeInfo = timeInfo; mTransportMap.Begin(timeInfo, mSampleRate, tempoIncrement); }
+  /** Called by API classes that get transport changes within a block, after SetTimeInfo(), see ITransportMap::AddTransport() */
+  void AddTransportChange(int offset, const ITimeInfo& timeInfo, double tempoIncrement = 0.) { mTransportMap.AddTransport(offset, timeInfo, tempoIncrement); }
   void SetRenderingOffline(bool renderingOffline) { mRenderingOffline = renderingOffline; }
+  /** Called by API classes that get silence flags from the host, with \c true if every channel of the side-chain buses is flagged silent in the current block, see IsSidechainActive() */
+  void SetSidechainSilent(bool silent) { mSidechainFlaggedSilent = silent; }
   const WDL_String& GetChannelLabel(ERoute direction, int idx) { return mChannelData[direction].Get(idx)->mLabel; }
 
 private:
+  /** Adds an event to mScheduledEvents, keeping the events sorted by offset */
+  void AddScheduledEvent(const IScheduledEvent& event);
+  /** Calls ProcessMidiMsg(), ProcessMidi2Msg(), ProcessSysEx() or ProcessScheduledParamChange() for queued events
+   * @param startFrame Events before or at this (quantised) offset are dispatched, with their offsets made relative to startFrame
+   * @param all If \c true dispatch all remaining events */
+  void DispatchScheduledEvents(int startFrame, bool all = false);
+  /** Splits the block at the offsets of the queued events and calls ProcessBlock() for each segment */
+  template <typename F>
+  void ProcessBuffersScheduled(int nFrames, F&& processSegment);
+  /** Sets the value returned by IsSidechainActive() for the block about to be processed */
+  template <typename T>
+  void UpdateSidechainActive(T** ppInputs, int nFrames);
+  /** ProcessBuffers() for host buffers that the plug-in processes directly, see DoesOtherPrecision() */
+  void ProcessBuffersOtherPrecision(int nFrames);
+  /** @return \c true if the host's buffers for a block of nFrames can be passed to ProcessBlockOtherPrecision() */
+  bool CanProcessOtherPrecision(int nFrames) const;
+  /** Converts the host's inputs to the ::sample scratch buffers, for when they were attached for ProcessBlockOtherPrecision() but are needed at ::sample precision */
+  void ConvertOtherPrecisionInputs(int nFrames);
+  /** Delays the outputs by the difference between the reported and the DSP latency, see ChangeLatency() */
+  void ProcessLatencyCompensation(int nFrames);
+  /** Rounds an offset down to a multiple of mEventGranularity */
+  int QuantiseOffset(int offset) const { return offset > 0 ? offset - (offset % mEventGranularity) : 0; }
+
   /** See EIPlugPluginTypes */
   EIPlugPluginType mPlugType;
   /** \c true if the plug-in accepts MIDI input */
@@ -289,23 +556,128 @@ private:
   double mSampleRate = DEFAULT_SAMPLE_RATE;
   /** Current block size (in samples) */
   int mBlockSize = 0;
+  /** The maximum block size and sample rate from the config, or 0 */
+  int mMaxBlockSize = 0;
+  double mMaxSampleRate = 0.;
   /** Current tail size (in samples) */
   int mTailSize = 0;
   /** \c true if the plug-in is bypassed */
   bool mBypassed = false;
   /** \c true if the plug-in is rendering off-line*/
   bool mRenderingOffline = false;
+  /** \c true if ProcessBlock() should be split at event offsets, see SetSampleAccurateEvents() */
+  bool mSampleAccurateEvents = false;
+  /** \c true if processing can be skipped while the inputs and the tail are silent, see SetSkipSilentBlocks() */
+  bool mSkipSilentBlocks = false;
+  /** \c true if the host should send MIDI 2.0, see SetMidi2Input() */
+  bool mMidi2Input = false;
+  /** The host's workgroup, set by the API class */
+  IAudioWorkgroup mAudioWorkgroup;
+  /** \c true if the side-chain has audio in the current block, see IsSidechainActive() */
+  bool mSidechainActiveInBlock = false;
+  /** \c true if the host flagged the side-chain silent in the current block */
+  bool mSidechainFlaggedSilent = false;
+  /** \c true if the side-chain buffers should be scanned for silence, see SetDetectSilentSidechain() */
+  bool mDetectSilentSidechain = false;
+  /** Set by SetDeferredInitFunc(), cleared when it has been called */
+  std::function<void()> mDeferredInitFunc;
+  /** Event offsets are rounded down to a multiple of this many samples */
+  int mEventGranularity = 1;
+  /** The offset of the segment currently being processed */
+  int mSegmentStart = 0;
+  /** Incoming events for the current block, sorted by offset */
+  WDL_TypedBuf<IScheduledEvent> mScheduledEvents;
+  /** The index of the next event in mScheduledEvents to dispatch */
+  int mScheduledEventsRead = 0;
   /** A list of IOConfig structures populated by ParseChannelIOStr in the IPlugProcessor constructor */
   WDL_PtrList<IOConfig> mIOConfigs;
   /* Manages pointers to the actual data for each channel */
   WDL_TypedBuf<sample*> mScratchData[2];
+  /* Pointers into mScratchData offset to the start of the current segment, see ProcessBuffersSegment() */
+  WDL_TypedBuf<sample*> mSegmentData[2];
   /* A list of IChannelData structures corresponding to every input/output channel */
   WDL_PtrList<IChannelData<>> mChannelData[2];
+  /* The IChannelData::mConnected flags, contiguous, so that attaching buffers doesn't dereference every IChannelData */
+  WDL_TypedBuf<uint8_t> mConnected[2];
+  /* One IBusBuffer per bus, whose mData is pointed at the current block by ProcessBuses() */
+  WDL_TypedBuf<IBusBuffer> mBusBuffers[2];
+  /* The index of each bus's first channel */
+  WDL_TypedBuf<int> mBusOffsets[2];
+  /** \c true if mBusBuffers' connection counts need updating */
+  bool mBusConnectionsChanged = true;
+  /** \c true if ProcessBuses() is called rather than ProcessBlock(), see SetProcessBuses() */
+  bool mProcessBuses = false;
+  /** \c true if the host's buffers for the current block were attached for ProcessBlockOtherPrecision() */
+  bool mOtherPrecisionAttached = false;
+  /* The host's buffers for ProcessBlockOtherPrecision(), with unconnected channels pointed at mOtherPrecisionScratch */
+  WDL_TypedBuf<PLUG_SAMPLE_SRC*> mOtherPrecisionData[2];
+  /* Pointers into mOtherPrecisionData offset to the start of the current segment */
+  WDL_TypedBuf<PLUG_SAMPLE_SRC*> mOtherPrecisionSegmentData[2];
+  /* A block for each unconnected channel when processing the host's buffers directly, the inputs are kept silent. The blocks are padded so each is aligned */
+  IAlignedBuf<PLUG_SAMPLE_SRC> mOtherPrecisionScratch[2];
+
+  /** Messages from the editor for OnMessageRT(), delivered at the start of ProcessBuffers() */
+  IPlugMessageQueue mMessagesFromEditor;
+
+  /** Calls ProcessBuses() or ProcessBlock() */
+  void DispatchProcessBlock(sample** inputs, sample** outputs, int nFrames);
+  /** Calls ProcessBlockOtherPrecision() */
+  void DispatchProcessBlock(PLUG_SAMPLE_SRC** inputs, PLUG_SAMPLE_SRC** outputs, int nFrames);
+  /** Resizes mScratchArena for the current block size, or the maximum block size if it is larger, and channel counts */
+  void ResizeScratchArena();
+
+  /** Resizes each channel's scratch buffer for a block size, or the maximum block size if it is larger, and clears it */
+  void ResizeChannelScratch(int blockSize);
+  /** Counts the channel, precision conversion and scratch arena buffers against the plug-in's IMemoryStats */
+  void UpdateAudioBufferMemory();
+
+  /** Temporary memory for ProcessBlock(), see SetScratchArenaSize() */
+  IScratchArena mScratchArena;
+  /** The number of block sized buffers in mScratchArena, per channel */
+  int mScratchArenaBuffersPerChannel = 0;
+  /** The bytes in mScratchArena that don't depend on the block size */
+  int mScratchArenaExtraBytes = 0;
+  /** The plug-in's stats, found the first time the buffers are counted, since the plug-in isn't fully constructed when this is */
+  IMemoryStats* mMemoryStats = nullptr;
+  /** The bytes of the buffers, see UpdateAudioBufferMemory() */
+  IMemoryStats::Allocation mAudioBufferMemory;
+#ifdef IPLUG_DEADLINE_MONITOR
+  /** Times ProcessBuffers() against the duration of the block, see GetDeadlineMonitor() */
+  IDeadlineMonitor mDeadlineMonitor;
+#endif
 protected: // these members are protected because they need to be access by the API classes, and don't want a setter/getter
   /** A multi-channel delay line used to delay the bypassed signal when a plug-in with latency is bypassed. */
   std::unique_ptr<NChanDelayLine<sample>> mLatencyDelay = nullptr;
+  /** Delays the outputs while the DSP latency is shorter than the reported latency, see EnableLatencyChanges() */
+  std::unique_ptr<NChanDelayLine<sample>> mLatencyCompensation = nullptr;
+  /** The latency of the DSP, see ChangeLatency() */
+  std::atomic<int> mDSPLatency {0};
+  /** The output delay that ProcessLatencyCompensation() should crossfade to */
+  std::atomic<int> mCompensationTarget {0};
+  /** The length of the next output delay crossfade */
+  std::atomic<int> mCompensationFadeFrames {0};
+  /** A latency for ReportPendingLatency() to report to the host, or -1 */
+  std::atomic<int> mPendingLatency {-1};
+  /** The output delay on the audio thread */
+  int mCompensationDelay = 0;
   /** Contains detailed information about the transport state */
   ITimeInfo mTimeInfo;
+  /** The transport through the current block, see GetTransportMap() */
+  ITransportMap mTransportMap;
+#ifdef IPLUG_STARTUP_TIMING
+  /** Whether the first block has been timed, see IStartupTimer */
+  bool mFirstBlockTimed = false;
+#endif
 };
 
+/** Put this in the declaration of a plug-in class that implements template <typename T> void ProcessBlockT(T** inputs, T** outputs, int nFrames),
+ * so that its DSP is compiled for both precisions and runs at whichever one the host processes, see IPlugProcessor::DoesOtherPrecision() */
+#define IPLUG_PROCESS_BLOCK_BOTH_PRECISIONS \
+  void ProcessBlock(iplug::sample** inputs, iplug::sample** outputs, int nFrames) override { ProcessBlockT(inputs, outputs, nFrames); } \
+  void ProcessBlockOtherPrecision(iplug::PLUG_SAMPLE_SRC** inputs, iplug::PLUG_SAMPLE_SRC** outputs, int nFrames) override { ProcessBlockT(inputs, outputs, nFrames); } \
+  bool DoesOtherPrecision() const override { return true; }
+
+/** @return The number of operator new calls made inside ProcessBlock() on the calling thread, when built with IPLUG_COUNT_AUDIO_THREAD_ALLOCATIONS, otherwise -1 */
+int64_t GetAudioThreadAllocationCount();
+
 END_IPLUG_NAMESPACE
@@ -13,14 +13,24 @@
 /**
  * @file
  * @copydoc IPlugQueue
+ * @copydoc IPlugMPMCQueue
+ * @copydoc IPlugMessageQueue
  */
 
+#include <algorithm>
 #include <atomic>
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
 
 #include "heapbuf.h"
 
 #include "IPlugPlatform.h"
+#include "IPlugSignal.h"
+
+#ifndef IPLUG_CACHE_LINE_SIZE
+  #define IPLUG_CACHE_LINE_SIZE 64
+#endif
 
 BEGIN_IPLUG_NAMESPACE
 
@@ -62,6 +72,10 @@ public:
     {
       mData.Get()[currentWriteIndex] = item;
       mWriteIndex.store(nextWriteIndex, std::memory_order_release);
+
+      if (mSignal)
+        mSignal->Notify();
+
       return true;
     }
     return false;
@@ -83,6 +97,60 @@ public:
     return true;
   }
 
+  /** Push a contiguous span of items, publishing the write index once for the whole span
+   * @param pItems Ptr to the items to push
+   * @param nItems The number of items in pItems
+   * @return The number of items that were pushed, which may be fewer than nItems if the queue is full */
+  int PushBatch(const T* pItems, int nItems)
+  {
+    const auto currentWriteIndex = mWriteIndex.load(std::memory_order_relaxed);
+    const auto currentReadIndex = mReadIndex.load(std::memory_order_acquire);
+    const size_t size = mData.GetSize();
+    const size_t space = (currentReadIndex + size - currentWriteIndex - 1) % size;
+    const int nToPush = static_cast<int>(std::min(space, static_cast<size_t>(std::max(nItems, 0))));
+
+    T* pData = mData.Get();
+    size_t idx = currentWriteIndex;
+
+    for (int i = 0; i < nToPush; i++)
+    {
+      pData[idx] = pItems[i];
+      idx = Increment(idx);
+    }
+
+    mWriteIndex.store(idx, std::memory_order_release);
+
+    if (nToPush && mSignal)
+      mSignal->Notify();
+
+    return nToPush;
+  }
+
+  /** Pop up to maxItems items into a contiguous span, publishing the read index once for the whole span
+   * @param pItems Ptr to a buffer that can hold at least maxItems
+   * @param maxItems The maximum number of items to pop
+   * @return The number of items that were popped */
+  int PopBatch(T* pItems, int maxItems)
+  {
+    const auto currentReadIndex = mReadIndex.load(std::memory_order_relaxed);
+    const auto currentWriteIndex = mWriteIndex.load(std::memory_order_acquire);
+    const size_t size = mData.GetSize();
+    const size_t available = (currentWriteIndex + size - currentReadIndex) % size;
+    const int nToPop = static_cast<int>(std::min(available, static_cast<size_t>(std::max(maxItems, 0))));
+
+    const T* pData = mData.Get();
+    size_t idx = currentReadIndex;
+
+    for (int i = 0; i < nToPop; i++)
+    {
+      pItems[i] = pData[idx];
+      idx = Increment(idx);
+    }
+
+    mReadIndex.store(idx, std::memory_order_release);
+    return nToPop;
+  }
+
   /** \todo 
    * @return size_t \todo */
   size_t ElementsAvailable() const
@@ -120,6 +188,24 @@ public:
     return (nextWriteIndex == mReadIndex.load());
   }
 
+  /** Attach a signal that is notified whenever items are pushed, so that the consumer can sleep in Wait() rather than polling. Set it before the producer starts pushing
+   * @param pSignal The signal, which may be shared with other queues, or nullptr to detach it */
+  void SetSignal(IPlugSignal* pSignal) { mSignal = pSignal; }
+
+  /** Sleep until there is an item to pop, or the timeout passes (consumer side, never the audio thread). This needs a signal, see SetSignal()
+   * @param timeoutMs The longest time to wait in milliseconds, or a negative value to wait without a timeout
+   * @return \c true if the queue has items */
+  bool Wait(double timeoutMs = -1.)
+  {
+    if (!WasEmpty())
+      return true;
+
+    if (mSignal)
+      mSignal->Wait(timeoutMs);
+
+    return !WasEmpty();
+  }
+
 private:
   /** \todo 
    * @param idx \todo
@@ -130,8 +216,360 @@ private:
   }
 
   WDL_TypedBuf<T> mData;
+  IPlugSignal* mSignal = nullptr;
+  // the indices are padded onto separate cache lines, so that the producer and consumer threads don't invalidate each other's cache line on every operation
+  char mPad0[IPLUG_CACHE_LINE_SIZE];
   std::atomic<size_t> mWriteIndex{0};
+  char mPad1[IPLUG_CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
   std::atomic<size_t> mReadIndex{0};
+  char mPad2[IPLUG_CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+};
+
+/** A lock-free bounded MPMC queue, which can be pushed to and popped from by any number of threads
+ * based on Dmitry Vyukov's bounded MPMC queue http://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+ * Each slot carries a sequence number, so producers and consumers only contend on claiming positions, never on the data itself */
+template<typename T>
+class IPlugMPMCQueue final
+{
+public:
+  /** IPlugMPMCQueue constructor
+   * @param size The minimum capacity of the queue, which will be rounded up to a power of two */
+  IPlugMPMCQueue(int size)
+  {
+    Resize(size);
+  }
+
+  IPlugMPMCQueue(const IPlugMPMCQueue&) = delete;
+  IPlugMPMCQueue& operator=(const IPlugMPMCQueue&) = delete;
+
+  /** Resize the queue, discarding its contents. This is not thread safe.
+   * @param size The minimum capacity of the queue, which will be rounded up to a power of two */
+  void Resize(int size)
+  {
+    size_t capacity = 2;
+    while (capacity < static_cast<size_t>(size))
+      capacity <<= 1;
+
+    mCells.Resize(static_cast<int>(capacity));
+    mMask = capacity - 1;
+
+    for (size_t i = 0; i < capacity; i++)
+      mCells.Get()[i].mSequence.store(i, std::memory_order_relaxed);
+
+    mEnqueuePos.store(0, std::memory_order_relaxed);
+    mDequeuePos.store(0, std::memory_order_relaxed);
+  }
+
+  /** Push an item (from any thread)
+   * @param item The item to push
+   * @return \c true if the item was pushed, \c false if the queue was full */
+  bool Push(const T& item)
+  {
+    return PushBatch(&item, 1) == 1;
+  }
+
+  /** Pop an item (from any thread)
+   * @param item The popped item is copied here
+   * @return \c true if an item was popped, \c false if the queue was empty */
+  bool Pop(T& item)
+  {
+    return PopBatch(&item, 1) == 1;
+  }
+
+  /** Push a contiguous span of items, claiming their positions in the queue with a single atomic operation
+   * @param pItems Ptr to the items to push
+   * @param nItems The number of items in pItems
+   * @return The number of items that were pushed, which may be fewer than nItems if the queue is full */
+  int PushBatch(const T* pItems, int nItems)
+  {
+    size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+    int nClaimed = 0;
+
+    for (;;)
+    {
+      // count how many consecutive cells from pos are free
+      nClaimed = 0;
+      while (nClaimed < nItems && GetCell(pos + nClaimed).mSequence.load(std::memory_order_acquire) == pos + nClaimed)
+        nClaimed++;
+
+      if (nClaimed == 0)
+      {
+        const size_t seq = GetCell(pos).mSequence.load(std::memory_order_acquire);
+
+        if (static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos) < 0)
+          return 0; // full
+
+        pos = mEnqueuePos.load(std::memory_order_relaxed); // another producer got here first
+        continue;
+      }
+
+      if (mEnqueuePos.compare_exchange_weak(pos, pos + nClaimed, std::memory_order_relaxed))
+        break;
+    }
+
+    for (int i = 0; i < nClaimed; i++)
+    {
+      Cell& cell = GetCell(pos + i);
+      cell.mData = pItems[i];
+      cell.mSequence.store(pos + i + 1, std::memory_order_release);
+    }
+
+    if (mSignal)
+      mSignal->Notify();
+
+    return nClaimed;
+  }
+
+  /** Pop up to maxItems items, claiming their positions in the queue with a single atomic operation
+   * @param pItems Ptr to a buffer that can hold at least maxItems
+   * @param maxItems The maximum number of items to pop
+   * @return The number of items that were popped */
+  int PopBatch(T* pItems, int maxItems)
+  {
+    size_t pos = mDequeuePos.load(std::memory_order_relaxed);
+    int nClaimed = 0;
+
+    for (;;)
+    {
+      // count how many consecutive cells from pos have been published
+      nClaimed = 0;
+      while (nClaimed < maxItems && GetCell(pos + nClaimed).mSequence.load(std::memory_order_acquire) == pos + nClaimed + 1)
+        nClaimed++;
+
+      if (nClaimed == 0)
+      {
+        const size_t seq = GetCell(pos).mSequence.load(std::memory_order_acquire);
+
+        if (static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1) < 0)
+          return 0; // empty
+
+        pos = mDequeuePos.load(std::memory_order_relaxed); // another consumer got here first
+        continue;
+      }
+
+      if (mDequeuePos.compare_exchange_weak(pos, pos + nClaimed, std::memory_order_relaxed))
+        break;
+    }
+
+    for (int i = 0; i < nClaimed; i++)
+    {
+      Cell& cell = GetCell(pos + i);
+      pItems[i] = cell.mData;
+      cell.mSequence.store(pos + i + mMask + 1, std::memory_order_release);
+    }
+
+    return nClaimed;
+  }
+
+  /** @return An approximation of the number of items in the queue, which may be out of date by the time it is used */
+  size_t ElementsAvailable() const
+  {
+    const size_t enqueuePos = mEnqueuePos.load(std::memory_order_acquire);
+    const size_t dequeuePos = mDequeuePos.load(std::memory_order_acquire);
+    return enqueuePos > dequeuePos ? enqueuePos - dequeuePos : 0;
+  }
+
+  /** Attach a signal that is notified whenever items are pushed, so that consumers can sleep in Wait() rather than polling. Set it before any thread starts pushing
+   * @param pSignal The signal, which may be shared with other queues, or nullptr to detach it */
+  void SetSignal(IPlugSignal* pSignal) { mSignal = pSignal; }
+
+  /** Sleep until there may be an item to pop, or the timeout passes (consumer side, never the audio thread). With several consumers, another one may pop the item first. This needs a signal, see SetSignal()
+   * @param timeoutMs The longest time to wait in milliseconds, or a negative value to wait without a timeout
+   * @return \c true if the queue has items */
+  bool Wait(double timeoutMs = -1.)
+  {
+    if (ElementsAvailable())
+      return true;
+
+    if (mSignal)
+      mSignal->Wait(timeoutMs);
+
+    return ElementsAvailable() > 0;
+  }
+
+private:
+  struct Cell
+  {
+    std::atomic<size_t> mSequence;
+    T mData;
+  };
+
+  Cell& GetCell(size_t pos) const
+  {
+    return mCells.Get()[pos & mMask];
+  }
+
+  WDL_TypedBuf<Cell> mCells;
+  size_t mMask = 0;
+  IPlugSignal* mSignal = nullptr;
+  char mPad0[IPLUG_CACHE_LINE_SIZE];
+  std::atomic<size_t> mEnqueuePos{0};
+  char mPad1[IPLUG_CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> mDequeuePos{0};
+  char mPad2[IPLUG_CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+};
+
+/** A lock-free SPSC queue of variable size messages, for sending blocks of data such as drawn envelopes or step sequencer patterns between threads.
+ * Messages are copied into a preallocated ring of bytes, each one kept contiguous, so the consumer gets a pointer to the whole payload without a copy.
+ * A message that doesn't fit before the end of the ring starts again at the beginning, so that it can always be queued once the consumer catches up, the largest message is half of the capacity, less a 16 byte header */
+class IPlugMessageQueue final
+{
+public:
+  /** IPlugMessageQueue constructor
+   * @param capacity The minimum capacity in bytes, which will be rounded up to a power of two, or 0 to allocate later with Resize() */
+  IPlugMessageQueue(int capacity = 0)
+  {
+    Resize(capacity);
+  }
+
+  IPlugMessageQueue(const IPlugMessageQueue&) = delete;
+  IPlugMessageQueue& operator=(const IPlugMessageQueue&) = delete;
+
+  /** Resize the queue, discarding its contents. This is not thread safe, unless nothing has been pushed yet, since the consumer doesn't touch the ring while the queue is empty
+   * @param capacity The minimum capacity in bytes, which will be rounded up to a power of two */
+  void Resize(int capacity)
+  {
+    size_t bytes = 0;
+
+    if (capacity > 0)
+    {
+      bytes = kAlignment * 2;
+      while (bytes < static_cast<size_t>(capacity))
+        bytes <<= 1;
+    }
+
+    mData.Resize(static_cast<int>(bytes));
+    mCapacity = bytes;
+    mWritePos.store(0, std::memory_order_relaxed);
+    mReadPos.store(0, std::memory_order_relaxed);
+  }
+
+  /** @return The capacity in bytes, 0 if the queue has not been allocated */
+  int GetCapacity() const { return static_cast<int>(mCapacity); }
+
+  /** Copy a message into the queue (from the producer thread)
+   * @param msgTag A tag to identify the message
+   * @param ctrlTag A second tag, e.g. the control that sent the message
+   * @param dataSize The size of the payload in bytes
+   * @param pData The payload, which may be nullptr if dataSize is 0
+   * @return \c true if the message was queued, \c false if there isn't room for it */
+  bool Push(int msgTag, int ctrlTag, int dataSize, const void* pData)
+  {
+    const size_t recordSize = RecordSize(dataSize);
+    const size_t writePos = mWritePos.load(std::memory_order_relaxed);
+    const size_t used = writePos - mReadPos.load(std::memory_order_acquire);
+    const size_t offset = writePos & (mCapacity - 1);
+    const size_t tail = mCapacity - offset; // bytes before the end of the ring
+    const size_t padding = recordSize > tail ? tail : 0;
+
+    if (!mCapacity || dataSize < 0 || recordSize > mCapacity / 2 || used + padding + recordSize > mCapacity)
+      return false;
+
+    if (padding)
+    {
+      // mark the tail as skipped, headers are aligned so there is always room for one
+      Header* pSkip = GetHeader(offset);
+      pSkip->dataSize = -1;
+      pSkip->recordSize = static_cast<int>(padding);
+    }
+
+    Header* pHeader = GetHeader((offset + padding) & (mCapacity - 1));
+    pHeader->msgTag = msgTag;
+    pHeader->ctrlTag = ctrlTag;
+    pHeader->dataSize = dataSize;
+    pHeader->recordSize = static_cast<int>(recordSize);
+
+    if (dataSize)
+      memcpy(pHeader + 1, pData, dataSize);
+
+    mWritePos.store(writePos + padding + recordSize, std::memory_order_release);
+
+    if (mSignal)
+      mSignal->Notify();
+
+    return true;
+  }
+
+  /** Pop every message in the queue (from the consumer thread), passing each one to a function
+   * @param func Called as func(msgTag, ctrlTag, dataSize, pData). pData points into the queue, and is only valid during the call
+   * @return The number of messages */
+  template <class F>
+  int PopAll(F&& func)
+  {
+    size_t readPos = mReadPos.load(std::memory_order_relaxed);
+    const size_t writePos = mWritePos.load(std::memory_order_acquire);
+    int nMessages = 0;
+
+    while (readPos != writePos)
+    {
+      const Header* pHeader = GetHeader(readPos & (mCapacity - 1));
+
+      if (pHeader->dataSize >= 0)
+      {
+        func(pHeader->msgTag, pHeader->ctrlTag, pHeader->dataSize, static_cast<const void*>(pHeader + 1));
+        nMessages++;
+      }
+
+      readPos += pHeader->recordSize;
+    }
+
+    mReadPos.store(readPos, std::memory_order_release);
+    return nMessages;
+  }
+
+  /** @return \c true if the queue was empty, which may be out of date by the time it is used */
+  bool WasEmpty() const
+  {
+    return mWritePos.load(std::memory_order_acquire) == mReadPos.load(std::memory_order_acquire);
+  }
+
+  /** Attach a signal that is notified whenever a message is pushed, so that the consumer can sleep in Wait() rather than polling. Set it before the producer starts pushing
+   * @param pSignal The signal, which may be shared with other queues, or nullptr to detach it */
+  void SetSignal(IPlugSignal* pSignal) { mSignal = pSignal; }
+
+  /** Sleep until there is a message to pop, or the timeout passes (consumer side, never the audio thread). This needs a signal, see SetSignal()
+   * @param timeoutMs The longest time to wait in milliseconds, or a negative value to wait without a timeout
+   * @return \c true if the queue has messages */
+  bool Wait(double timeoutMs = -1.)
+  {
+    if (!WasEmpty())
+      return true;
+
+    if (mSignal)
+      mSignal->Wait(timeoutMs);
+
+    return !WasEmpty();
+  }
+
+private:
+  struct Header
+  {
+    int msgTag;
+    int ctrlTag;
+    int dataSize; // -1 marks padding before the end of the ring
+    int recordSize;
+  };
+
+  static constexpr size_t kAlignment = 16;
+
+  static size_t RecordSize(int dataSize)
+  {
+    return (sizeof(Header) + static_cast<size_t>(std::max(dataSize, 0)) + kAlignment - 1) & ~(kAlignment - 1);
+  }
+
+  Header* GetHeader(size_t offset) const
+  {
+    return reinterpret_cast<Header*>(mData.Get() + offset);
+  }
+
+  WDL_TypedBuf<uint8_t> mData;
+  size_t mCapacity = 0;
+  IPlugSignal* mSignal = nullptr;
+  char mPad0[IPLUG_CACHE_LINE_SIZE];
+  std::atomic<size_t> mWritePos{0};
+  char mPad1[IPLUG_CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+  std::atomic<size_t> mReadPos{0};
+  char mPad2[IPLUG_CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
 };
 
 END_IPLUG_NAMESPACE
@@ -0,0 +1,331 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @brief Real-time safe logging, for use on the audio thread where DBGMSG and Trace would glitch
+ *
+ * To log from ProcessBlock():    RTLOG("voice %i stolen at %f", voiceIdx, time);
+ * Like DBGMSG, RTLOG is a no-op when NDEBUG is defined, and its arguments are not evaluated.
+ * The format must be a string literal. Up to IRTLogRecord::kMaxArgs numbers, pointers and strings can be passed, strings are truncated to fit in the record.
+ * Messages are written by a background thread with DBGMSG, and also to the Trace log in a TRACER_BUILD.
+ */
+
+#ifdef NDEBUG
+  #define RTLOG(...) do {} while(0)
+#else
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+#include "wdlstring.h"
+
+#include "IPlugPlatform.h"
+#include "IPlugLogger.h"
+#include "IPlugQueue.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** A fixed size log message, which holds the format and the arguments, to be formatted later on the IRTLogger thread */
+struct IRTLogRecord
+{
+  static constexpr int kMaxArgs = 6;
+  static constexpr int kStringBytes = 64;
+
+  enum EArgType : uint8_t
+  {
+    kInt = 0,
+    kUInt,
+    kDouble,
+    kPointer,
+    kString // an offset into mStrings
+  };
+
+  union IRTLogArg
+  {
+    int64_t mInt;
+    uint64_t mUInt;
+    double mDouble;
+    const void* mPointer;
+  };
+
+  const char* mFormat = nullptr;
+  const char* mFuncName = nullptr;
+  int mLine = 0;
+  /** A small number for the thread that logged the message, in order of first use */
+  int mThread = 0;
+  /** Milliseconds since the logger started */
+  double mTimeMs = 0.;
+  int mNArgs = 0;
+  EArgType mTypes[kMaxArgs] = {};
+  IRTLogArg mArgs[kMaxArgs] = {};
+  char mStrings[kStringBytes] = {};
+  int mStringsUsed = 0;
+
+  template <typename T>
+  void AddArg(T arg)
+  {
+    if constexpr (std::is_floating_point<T>::value)
+      Add(kDouble).mDouble = static_cast<double>(arg);
+    else if constexpr (std::is_enum<T>::value)
+      Add(kInt).mInt = static_cast<int64_t>(arg);
+    else if constexpr (std::is_integral<T>::value && std::is_signed<T>::value)
+      Add(kInt).mInt = static_cast<int64_t>(arg);
+    else if constexpr (std::is_integral<T>::value)
+      Add(kUInt).mUInt = static_cast<uint64_t>(arg);
+    else if constexpr (std::is_convertible<T, const char*>::value)
+      AddString(arg);
+    else
+    {
+      static_assert(std::is_pointer<T>::value, "RTLOG arguments must be numbers, pointers or C strings");
+      Add(kPointer).mPointer = static_cast<const void*>(arg);
+    }
+  }
+
+private:
+  IRTLogArg& Add(EArgType type)
+  {
+    mTypes[mNArgs] = type;
+    return mArgs[mNArgs++];
+  }
+
+  void AddString(const char* str)
+  {
+    const int offset = mStringsUsed;
+    int len = 0;
+
+    if (str)
+    {
+      while (str[len] && offset + len < kStringBytes - 1)
+        len++;
+
+      memcpy(mStrings + offset, str, len);
+    }
+
+    mStrings[offset + len] = '\0';
+    mStringsUsed = std::min(offset + len + 1, kStringBytes - 1);
+    Add(kString).mInt = offset;
+  }
+};
+
+/** Logging for the realtime audio thread. Log() copies the message and its arguments into a fixed size IRTLogRecord in a lock-free queue,
+ * without formatting, locking or allocating, and a background thread formats and writes the messages.
+ * If the queue is full, messages are dropped and the number dropped is written instead.
+ * There is one logger per binary, which is created by the IPlugProcessor constructor, so that the first log call on the audio thread doesn't start the thread */
+class IRTLogger
+{
+public:
+  static constexpr int kQueueSize = 4096;
+  static constexpr int kWriteIntervalMs = 10;
+
+  static IRTLogger& Get()
+  {
+    static IRTLogger sLogger;
+    return sLogger;
+  }
+
+  ~IRTLogger()
+  {
+    mRunning.store(false);
+
+    while (!mFinished.load())
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+#ifdef OS_WIN
+    mThread.detach(); // joining whilst a DLL is being unloaded deadlocks on the loader lock, and the thread has already finished its work
+#else
+    mThread.join();
+#endif
+    WriteRecords();
+  }
+
+  IRTLogger(const IRTLogger&) = delete;
+  IRTLogger& operator=(const IRTLogger&) = delete;
+
+  /** Queue a message. This can be called on any thread, including the realtime audio thread, use the RTLOG macro rather than calling it directly
+   * @param funcName The function the message comes from
+   * @param line The line the message comes from
+   * @param format A printf style format, which must stay valid until the message is written, so a string literal
+   * @param args Numbers, pointers and C strings for the format */
+  template <typename... Args>
+  void Log(const char* funcName, int line, const char* format, Args... args)
+  {
+    static_assert(sizeof...(Args) <= IRTLogRecord::kMaxArgs, "Too many RTLOG arguments");
+
+    IRTLogRecord record;
+    record.mFormat = format;
+    record.mFuncName = funcName;
+    record.mLine = line;
+    record.mThread = GetThreadOrdinal();
+    record.mTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - mStartTime).count();
+    (record.AddArg(args), ...);
+
+    if (!mQueue.Push(record))
+      mNDropped.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  /** Format a record, without writing it. Exposed for loggers that write somewhere else */
+  static void Format(const IRTLogRecord& record, WDL_String& str)
+  {
+    str.SetFormatted(128, "[%.3f:%i:%s:%d]", record.mTimeMs, record.mThread, record.mFuncName, record.mLine);
+
+    const char* pFmt = record.mFormat;
+    int arg = 0;
+
+    while (*pFmt)
+    {
+      if (*pFmt != '%')
+      {
+        const char* pEnd = strchr(pFmt, '%');
+        const int len = pEnd ? static_cast<int>(pEnd - pFmt) : static_cast<int>(strlen(pFmt));
+        str.Append(pFmt, len);
+        pFmt += len;
+        continue;
+      }
+
+      if (pFmt[1] == '%')
+      {
+        str.Append("%");
+        pFmt += 2;
+        continue;
+      }
+
+      // copy the flags, width and precision, skipping the length modifiers, which are replaced with the stored argument's type
+      char spec[32] = "%";
+      int specLen = 1;
+      pFmt++;
+
+      while (*pFmt && strchr("-+ #0123456789.", *pFmt) && specLen < 24)
+        spec[specLen++] = *pFmt++;
+
+      while (*pFmt && strchr("hljztL", *pFmt))
+        pFmt++;
+
+      const char conversion = *pFmt;
+
+      if (!conversion)
+        break;
+
+      pFmt++;
+
+      if (arg >= record.mNArgs)
+      {
+        str.Append("<missing>");
+        continue;
+      }
+
+      const IRTLogRecord::EArgType type = record.mTypes[arg];
+      const IRTLogRecord::IRTLogArg value = record.mArgs[arg++];
+
+      switch (conversion)
+      {
+        case 'd': case 'i': case 'u': case 'x': case 'X': case 'o':
+        {
+          spec[specLen++] = 'l'; spec[specLen++] = 'l'; spec[specLen++] = conversion; spec[specLen] = '\0';
+          const long long i = type == IRTLogRecord::kDouble ? static_cast<long long>(value.mDouble) : static_cast<long long>(value.mInt);
+          str.AppendFormatted(64, spec, i);
+          break;
+        }
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+        {
+          spec[specLen++] = conversion; spec[specLen] = '\0';
+          const double d = type == IRTLogRecord::kDouble ? value.mDouble : type == IRTLogRecord::kUInt ? static_cast<double>(value.mUInt) : static_cast<double>(value.mInt);
+          str.AppendFormatted(64, spec, d);
+          break;
+        }
+        case 'c':
+          spec[specLen++] = 'c'; spec[specLen] = '\0';
+          str.AppendFormatted(32, spec, static_cast<int>(value.mInt));
+          break;
+        case 's':
+          spec[specLen++] = 's'; spec[specLen] = '\0';
+          str.AppendFormatted(IRTLogRecord::kStringBytes + 32, spec, type == IRTLogRecord::kString ? record.mStrings + value.mInt : "<not a string>");
+          break;
+        case 'p':
+          str.AppendFormatted(32, "%p", value.mPointer);
+          break;
+        default:
+          str.Append("<unsupported>");
+          break;
+      }
+    }
+  }
+
+private:
+  IRTLogger()
+  : mQueue(kQueueSize)
+  , mStartTime(std::chrono::steady_clock::now())
+  {
+    mThread = std::thread([this]() {
+      while (mRunning.load())
+      {
+        WriteRecords();
+        std::this_thread::sleep_for(std::chrono::milliseconds(kWriteIntervalMs));
+      }
+
+      mFinished.store(true);
+    });
+  }
+
+  static int GetThreadOrdinal()
+  {
+    static std::atomic<int> sNextThread {0};
+    static thread_local int sThread = -1;
+
+    if (sThread < 0)
+      sThread = sNextThread.fetch_add(1, std::memory_order_relaxed);
+
+    return sThread;
+  }
+
+  void WriteRecords()
+  {
+    IRTLogRecord record;
+    WDL_String str;
+
+    while (mQueue.Pop(record))
+    {
+      Format(record, str);
+      Write(str.Get());
+    }
+
+    if (const int nDropped = mNDropped.exchange(0, std::memory_order_relaxed))
+    {
+      str.SetFormatted(64, "**************** %d RTLOG MESSAGES DROPPED ****************", nDropped);
+      Write(str.Get());
+    }
+  }
+
+  static void Write(const char* str)
+  {
+    DBGMSG("%s\n", str);
+    Trace("RTLOG", 0, "%s", str); // does nothing unless TRACER_BUILD is defined
+  }
+
+  IPlugMPMCQueue<IRTLogRecord> mQueue;
+  std::chrono::steady_clock::time_point mStartTime;
+  std::atomic<int> mNDropped {0};
+  std::atomic<bool> mRunning {true};
+  std::atomic<bool> mFinished {false};
+  std::thread mThread;
+};
+
+END_IPLUG_NAMESPACE
+
+#define RTLOG(...) iplug::IRTLogger::Get().Log(__FUNCTION__, __LINE__, __VA_ARGS__)
+
+#endif // !NDEBUG
@@ -0,0 +1,164 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc IPlugSignal
+ */
+
+#include <atomic>
+#include <cmath>
+
+#include "IPlugPlatform.h"
+
+#if defined OS_WIN
+  #include <windows.h>
+#elif defined OS_MAC || defined OS_IOS
+  #include <mach/mach.h>
+#else
+  #include <cerrno>
+  #include <ctime>
+  #include <semaphore.h>
+#endif
+
+BEGIN_IPLUG_NAMESPACE
+
+/** An auto-reset event that a real-time thread can signal without blocking, so that a background thread can sleep until there is work for it, rather than polling.
+ * Notify() is lock-free, and only makes a system call (a semaphore post, which never blocks) when a thread is actually waiting, so it can be called from the audio thread for every push to a queue.
+ * Notifications don't accumulate: any number of them before a Wait() wake it once, so the waiting thread should drain everything that is pending each time it wakes.
+ * It can be attached to IPlugQueue, IPlugMPMCQueue and IPlugMessageQueue with SetSignal(), and one signal can be attached to several queues that are served by the same thread.
+ * The status counts down below 0 for each waiting thread, based on Jeff Preshing's AutoResetEvent https://preshing.com/20150316/semaphores-are-surprisingly-versatile/ */
+class IPlugSignal final
+{
+public:
+  IPlugSignal()
+  {
+#if defined OS_WIN
+    mSemaphore = CreateSemaphoreW(nullptr, 0, MAXLONG, nullptr);
+#elif defined OS_MAC || defined OS_IOS
+    semaphore_create(mach_task_self(), &mSemaphore, SYNC_POLICY_FIFO, 0);
+#else
+    sem_init(&mSemaphore, 0, 0);
+#endif
+  }
+
+  ~IPlugSignal()
+  {
+#if defined OS_WIN
+    CloseHandle(mSemaphore);
+#elif defined OS_MAC || defined OS_IOS
+    semaphore_destroy(mach_task_self(), mSemaphore);
+#else
+    sem_destroy(&mSemaphore);
+#endif
+  }
+
+  IPlugSignal(const IPlugSignal&) = delete;
+  IPlugSignal& operator=(const IPlugSignal&) = delete;
+
+  /** Wake one waiting thread, or the next thread to wait if none is waiting. This never blocks, and can be called from any thread, including the audio thread */
+  void Notify()
+  {
+    int status = mStatus.load(std::memory_order_relaxed);
+
+    while (!mStatus.compare_exchange_weak(status, status < 1 ? status + 1 : 1, std::memory_order_release, std::memory_order_relaxed)) {}
+
+    // a thread is asleep, or about to sleep, on the semaphore
+    if (status < 0)
+      Post();
+  }
+
+  /** Sleep until Notify() is called, or the timeout passes. Returns straight away if Notify() was called since the last Wait(). Never call this from the audio thread
+   * @param timeoutMs The longest time to wait in milliseconds, or a negative value to wait without a timeout
+   * @return \c true if the thread was notified, \c false if the wait timed out */
+  bool Wait(double timeoutMs = -1.)
+  {
+    if (mStatus.fetch_sub(1, std::memory_order_acquire) > 0)
+      return true;
+
+    if (OSWait(timeoutMs))
+      return true;
+
+    // timed out, so stop counting as a waiter, unless a notification arrived meanwhile, in which case its post has to be consumed
+    int status = mStatus.load(std::memory_order_relaxed);
+
+    while (status < 0)
+    {
+      if (mStatus.compare_exchange_weak(status, status + 1, std::memory_order_relaxed))
+        return false;
+    }
+
+    OSWait(-1.);
+    return true;
+  }
+
+private:
+  void Post()
+  {
+#if defined OS_WIN
+    ReleaseSemaphore(mSemaphore, 1, nullptr);
+#elif defined OS_MAC || defined OS_IOS
+    semaphore_signal(mSemaphore);
+#else
+    sem_post(&mSemaphore);
+#endif
+  }
+
+  /** @return \c true if the semaphore was taken, \c false if the wait timed out */
+  bool OSWait(double timeoutMs)
+  {
+#if defined OS_WIN
+    const DWORD ms = timeoutMs < 0. ? INFINITE : static_cast<DWORD>(std::ceil(timeoutMs));
+    return WaitForSingleObject(mSemaphore, ms) == WAIT_OBJECT_0;
+#elif defined OS_MAC || defined OS_IOS
+    if (timeoutMs < 0.)
+    {
+      while (semaphore_wait(mSemaphore) == KERN_ABORTED) {}
+      return true;
+    }
+
+    const double seconds = timeoutMs / 1000.;
+    mach_timespec_t timeout;
+    timeout.tv_sec = static_cast<unsigned int>(seconds);
+    timeout.tv_nsec = static_cast<clock_res_t>((seconds - timeout.tv_sec) * 1e9);
+    return semaphore_timedwait(mSemaphore, timeout) == KERN_SUCCESS;
+#else
+    if (timeoutMs < 0.)
+    {
+      while (sem_wait(&mSemaphore) != 0 && errno == EINTR) {}
+      return true;
+    }
+
+    // sem_timedwait() takes an absolute CLOCK_REALTIME time
+    timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    const long long ns = deadline.tv_nsec + static_cast<long long>(timeoutMs * 1e6);
+    deadline.tv_sec += static_cast<time_t>(ns / 1000000000LL);
+    deadline.tv_nsec = static_cast<long>(ns % 1000000000LL);
+
+    int result;
+    while ((result = sem_timedwait(&mSemaphore, &deadline)) != 0 && errno == EINTR) {}
+    return result == 0;
+#endif
+  }
+
+  std::atomic<int> mStatus {0}; // 1 if notified, 0 if idle, -n if n threads are waiting
+#if defined OS_WIN
+  HANDLE mSemaphore;
+#elif defined OS_MAC || defined OS_IOS
+  semaphore_t mSemaphore;
+#else
+  sem_t mSemaphore;
+#endif
+};
+
+END_IPLUG_NAMESPACE
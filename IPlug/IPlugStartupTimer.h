@@ -0,0 +1,151 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @brief Instrumentation that times how long a plug-in takes to start up, see IStartupTimer
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+
+#include "IPlugPlatform.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** IStartupTimer times the stages of bringing up a plug-in: construction, OnReset(), the first block of each instance and opening the editor.
+ * It is compiled in when IPLUG_STARTUP_TIMING is defined, and Scripts/validate_plugins.py uses it to run the validators for each format in parallel
+ * and fail if startup gets slower than the thresholds.
+ *
+ * The timings of every instance in the process are summarised in the file named by the IPLUG_STARTUP_TIMING_FILE environment variable,
+ * one line per stage of "name count mean_ms max_ms". The file is rewritten off the audio thread after each stage, and when a processor is destroyed,
+ * so the audio thread only updates atomics */
+class IStartupTimer
+{
+public:
+  enum EStage
+  {
+    kConstruct = 0,
+    kReset,
+    kFirstProcess,
+    kEditorOpen,
+    kNumStages
+  };
+
+  /** Times the rest of the enclosing block */
+  class Scope
+  {
+  public:
+    /** @param stage The stage being timed
+     * @param enabled \c false to skip timing, e.g. for every block after the first */
+    Scope(EStage stage, bool enabled = true)
+    : mStage(stage)
+    , mEnabled(enabled)
+    {
+      if (enabled)
+        mStart = std::chrono::steady_clock::now();
+    }
+
+    ~Scope()
+    {
+      if (!mEnabled)
+        return;
+
+      const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - mStart;
+      Record(mStage, elapsed.count());
+
+      if (mStage != kFirstProcess)
+        Write();
+    }
+
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+  private:
+    EStage mStage;
+    bool mEnabled;
+    std::chrono::steady_clock::time_point mStart;
+  };
+
+  static const char* GetStageName(EStage stage)
+  {
+    static const char* names[kNumStages] = { "construct", "reset", "first_process", "editor_open" };
+    return names[stage];
+  }
+
+  /** Adds a timing to a stage. This only updates atomics, so it may be called on the audio thread */
+  static void Record(EStage stage, double ms)
+  {
+    Stats& stats = GetStats()[stage];
+    const int64_t us = static_cast<int64_t>(ms * 1000.);
+
+    stats.count.fetch_add(1, std::memory_order_relaxed);
+    stats.totalUs.fetch_add(us, std::memory_order_relaxed);
+
+    int64_t max = stats.maxUs.load(std::memory_order_relaxed);
+
+    while (us > max && !stats.maxUs.compare_exchange_weak(max, us, std::memory_order_relaxed)) {}
+  }
+
+  /** Rewrites the summary file, if IPLUG_STARTUP_TIMING_FILE is set. Not for the audio thread */
+  static void Write()
+  {
+    const char* path = getenv("IPLUG_STARTUP_TIMING_FILE");
+
+    if (!path || !*path)
+      return;
+
+    static std::mutex sMutex;
+    std::lock_guard<std::mutex> lock(sMutex);
+
+    FILE* fp = fopen(path, "w");
+
+    if (!fp)
+      return;
+
+    for (auto s = 0; s < kNumStages; s++)
+    {
+      const Stats& stats = GetStats()[s];
+      const int64_t count = stats.count.load(std::memory_order_relaxed);
+
+      if (count)
+        fprintf(fp, "%s %lld %.3f %.3f\n", GetStageName(static_cast<EStage>(s)), static_cast<long long>(count), stats.totalUs.load(std::memory_order_relaxed) / (1000. * count), stats.maxUs.load(std::memory_order_relaxed) / 1000.);
+    }
+
+    fclose(fp);
+  }
+
+private:
+  struct Stats
+  {
+    std::atomic<int64_t> count {0};
+    std::atomic<int64_t> totalUs {0};
+    std::atomic<int64_t> maxUs {0};
+  };
+
+  static Stats* GetStats()
+  {
+    static Stats sStats[kNumStages];
+    return sStats;
+  }
+};
+
+END_IPLUG_NAMESPACE
+
+#ifdef IPLUG_STARTUP_TIMING
+  #define ENTER_STARTUP_TIMING_SCOPE(stage) iplug::IStartupTimer::Scope startupTimingScope(iplug::IStartupTimer::stage);
+#else
+  #define ENTER_STARTUP_TIMING_SCOPE(stage)
+#endif
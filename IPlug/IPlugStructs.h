@@ -18,6 +18,9 @@
  */
 
 #include <algorithm>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
 #include "wdlstring.h"
 #include "ptrlist.h"
 
@@ -25,6 +28,7 @@
 #include "IPlugPlatform.h"
 #include "IPlugMidi.h" // <- Midi related structs in here
 #include "IPlugUtilities.h"
+#include "IPlugAlignedBuf.h"
 
 BEGIN_IPLUG_NAMESPACE
 
@@ -40,6 +44,22 @@ struct ParamTuple
   {}
 };
 
+/** A message for a control, used to send several at once with IEditorDelegate::SendControlMsgsFromDelegate() */
+struct ControlMsg
+{
+  int ctrlTag;
+  int msgTag;
+  int dataSize;
+  const void* pData;
+
+  ControlMsg(int ctrlTag = kNoTag, int msgTag = kNoTag, int dataSize = 0, const void* pData = nullptr)
+  : ctrlTag(ctrlTag)
+  , msgTag(msgTag)
+  , dataSize(dataSize)
+  , pData(pData)
+  {}
+};
+
 /** This structure is used when queueing Sysex messages. You may need to set MAX_SYSEX_SIZE to reflect the max sysex payload in bytes */
 struct SysExData
 {
@@ -60,6 +80,25 @@ struct SysExData
   uint8_t mData[MAX_SYSEX_SIZE];
 };
 
+/** A timestamped MIDI, MIDI 2.0, SysEx or parameter event. IPlugProcessor uses these to split a block at event offsets, see IPlugProcessor::SetSampleAccurateEvents() */
+struct IScheduledEvent
+{
+  enum EType
+  {
+    kMidiMsg,
+    kMidi2Msg,
+    kSysEx,
+    kParamChange
+  };
+  
+  EType mType = kMidiMsg;
+  int mOffset = 0;
+  IMidiMsg mMidiMsg;
+  IMidi2Msg mMidi2Msg;
+  ISysEx mSysEx;
+  ParamTuple mParam; // normalized value
+};
+
 /** A helper class for IByteChunk and IByteStream that avoids code duplication */
 struct IByteGetter
 {
@@ -105,6 +144,53 @@ struct IByteGetter
     }
     return -1;
   }
+
+  /** Get a pointer to typed data in a byte array, rather than copying it out, returning the new position for subsequent calls
+   * @param pSrc The source buffer
+   * @param srcSize The size of the source data in bytes
+   * @param pView Set to point at the data in pSrc, or nullptr if it can't
+   * @param count The number of values of type T
+   * @param startPos The starting position in bytes in pSrc
+   * @return int The end position in bytes after the values, or -1 if they would run past the end of the src buffer, or aren't aligned for T, in which case copy them with GetBytes() */
+  template <class T>
+  static inline int GetView(const uint8_t* pSrc, int srcSize, const T*& pView, int count, int startPos)
+  {
+    static_assert(std::is_trivially_copyable<T>::value, "GetView() can only view trivially copyable types");
+    pView = nullptr;
+
+    if (startPos < 0 || startPos > srcSize || count < 0 || static_cast<int64_t>(count) * static_cast<int64_t>(sizeof(T)) > srcSize - startPos)
+      return -1;
+
+    const uint8_t* pStart = pSrc + startPos;
+
+    if (reinterpret_cast<uintptr_t>(pStart) % alignof(T))
+      return -1;
+
+    pView = reinterpret_cast<const T*>(pStart);
+    return startPos + count * static_cast<int>(sizeof(T));
+  }
+
+  /** Get a string from a byte array as a view of its characters, without copying it, returning the new position for subsequent calls.
+   * The view isn't null terminated
+   * @param pSrc The source buffer
+   * @param srcSize The size of the source data in bytes
+   * @param str Set to view the string in pSrc, or an empty view if it can't
+   * @param startPos The starting position in bytes in pSrc
+   * @return int The end position in bytes after the string, or -1 if it would run past the end of the src buffer */
+  static inline int GetStrView(const uint8_t* pSrc, int srcSize, std::string_view& str, int startPos)
+  {
+    str = std::string_view();
+    int len;
+    int strStartPos = GetBytes(pSrc, srcSize, &len, sizeof(len), startPos);
+
+    if (strStartPos < 0 || len < 0 || len > srcSize - strStartPos)
+      return -1;
+
+    if (len > 0)
+      str = std::string_view(reinterpret_cast<const char*>(pSrc + strStartPos), len);
+
+    return strStartPos + len;
+  }
 };
   
 /** Manages a block of memory, for plug-in settings store/recall */
@@ -147,10 +233,26 @@ public:
   inline int PutBytes(const void* pSrc, int nBytesToCopy)
   {
     int n = mBytes.GetSize();
-    mBytes.Resize(n + nBytesToCopy);
+    mBytes.Resize(n + nBytesToCopy, false);
     memcpy(mBytes.Get() + n, pSrc, nBytesToCopy);
     return mBytes.GetSize();
   }
+
+  /** Allocates enough memory up front for nBytes more to be put into the chunk without it being reallocated
+   * @param nBytes The number of bytes that will be put */
+  inline void Reserve(int nBytes)
+  {
+    int n = mBytes.GetSize();
+    mBytes.Resize(n + nBytes, false);
+    mBytes.Resize(n, false);
+  }
+
+  /** Sets how the chunk grows when it runs out of memory. It always grows by at least half its size, so this only matters for small chunks
+   * @param nBytes The smallest number of bytes to grow by, 4096 by default */
+  inline void SetGranularity(int nBytes)
+  {
+    mBytes.SetGranul(nBytes);
+  }
   
   /** Copy raw bytes from the IByteChunk, returning the new position for subsequent calls
    * @param pDst The destination buffer
@@ -183,6 +285,31 @@ public:
     return GetBytes(pDst, sizeof(T), startPos);
   }
   
+  /** Copies an array of plain data into the IByteChunk in one go
+   * @tparam T The type of the values, which must be trivially copyable
+   * @param pVals Ptr to the first value
+   * @param count The number of values
+   * @return int The size of the chunk after insertion  */
+  template <class T>
+  inline int PutArray(const T* pVals, int count)
+  {
+    static_assert(std::is_trivially_copyable<T>::value, "PutArray() can only copy trivially copyable types");
+    return PutBytes(pVals, count * static_cast<int>(sizeof(T)));
+  }
+
+  /** Get an array of plain data from the IByteChunk, as put by PutArray()
+   * @tparam T The type of the values, which must be trivially copyable
+   * @param pDst Ptr to the destination for the values
+   * @param count The number of values
+   * @param startPos The starting position in bytes in the chunk
+   * @return int The end position in the chunk (in bytes) after the copy, or -1 if the copy would have copied more data than in the chunk  */
+  template <class T>
+  inline int GetArray(T* pDst, int count, int startPos) const
+  {
+    static_assert(std::is_trivially_copyable<T>::value, "GetArray() can only copy trivially copyable types");
+    return GetBytes(pDst, count * static_cast<int>(sizeof(T)), startPos);
+  }
+
   /** Put a string into the IByteChunk
    * @param str CString to insert into the chunk
    * @return int The size of the chunk after insertion  */
@@ -201,6 +328,27 @@ public:
   {
     return IByteGetter::GetStr(mBytes.Get(), Size(), str, startPos);
   }
+
+  /** Get a pointer to typed data in the IByteChunk, rather than copying it out. It is only valid until the chunk is next changed
+   * @tparam T The type of data to view, which must be trivially copyable
+   * @param pView Set to point at the data, or nullptr if it can't
+   * @param startPos The starting position in bytes in the chunk
+   * @param count The number of values of type T, as put by PutArray()
+   * @return int The end position in the chunk (in bytes) after the data, or -1 if it would run past the end of the chunk or isn't aligned for T, in which case use Get() */
+  template <class T>
+  inline int GetView(const T*& pView, int startPos, int count = 1) const
+  {
+    return IByteGetter::GetView(mBytes.Get(), Size(), pView, count, startPos);
+  }
+
+  /** Get a string from the IByteChunk as a view of its characters, without copying it. It is only valid until the chunk is next changed, and isn't null terminated
+   * @param str Set to view the string
+   * @param startPos The starting position in bytes in the chunk
+   * @return int The end position in the chunk (in bytes) after the string, or -1 if it would run past the end of the chunk */
+  inline int GetStrView(std::string_view& str, int startPos) const
+  {
+    return IByteGetter::GetStrView(mBytes.Get(), Size(), str, startPos);
+  }
   
   /** Put another IByteChunk into this one
    * @param pRHS Ptr to the IByteChunk to copy in
@@ -210,10 +358,10 @@ public:
     return PutBytes(pRHS->GetData(), pRHS->Size());
   }
   
-  /** Clears the chunk (resizes to 0) */
+  /** Clears the chunk (resizes to 0). The memory is kept, so that refilling the chunk with a similar amount of data doesn't reallocate */
   inline void Clear()
   {
-    mBytes.Resize(0);
+    mBytes.Resize(0, false);
   }
   
   /** Returns the current size of the chunk
@@ -299,6 +447,27 @@ public:
   {
     return IByteGetter::GetStr(mBytes, Size(), str, startPos);
   }
+
+  /** Get a pointer to typed data in the stream, rather than copying it out. It is valid for as long as the stream's data
+   * @tparam T The type of data to view, which must be trivially copyable
+   * @param pView Set to point at the data, or nullptr if it can't
+   * @param startPos The starting position in bytes in the stream
+   * @param count The number of values of type T
+   * @return int The end position in the stream (in bytes) after the data, or -1 if it would run past the end of the stream or isn't aligned for T, in which case use Get() */
+  template <class T>
+  inline int GetView(const T*& pView, int startPos, int count = 1) const
+  {
+    return IByteGetter::GetView(mBytes, Size(), pView, count, startPos);
+  }
+
+  /** Get a string from the stream as a view of its characters, without copying it. It is valid for as long as the stream's data, and isn't null terminated
+   * @param str Set to view the string
+   * @param startPos The starting position in bytes in the stream
+   * @return int The end position in the stream (in bytes) after the string, or -1 if it would run past the end of the stream */
+  inline int GetStrView(std::string_view& str, int startPos) const
+  {
+    return IByteGetter::GetStrView(mBytes, Size(), str, startPos);
+  }
   
   /** Returns the  size of the stream
    * @return size (in bytes) */
@@ -366,6 +535,27 @@ public:
     mPos = mChunk.GetStr(str, mPos);
     return mPos;
   }
+
+  /** Get a pointer to typed data in the managed IByteChunk at the current position, rather than copying it out, and update the position
+   * @tparam T The type of data to view, see IByteChunk::GetView()
+   * @param pView Set to point at the data, or nullptr if it can't
+   * @param count The number of values of type T
+   * @return int Next read position in the IByteChunk */
+  template <class T>
+  inline int GetView(const T*& pView, int count = 1)
+  {
+    mPos = mChunk.GetView(pView, mPos, count);
+    return mPos;
+  }
+
+  /** Get a view of a string in the managed IByteChunk at the current position, see IByteChunk::GetStrView()
+   * @param str Set to view the string
+   * @return int Next read position in the IByteChunk */
+  inline int GetStrView(std::string_view& str)
+  {
+    mPos = mChunk.GetStrView(str, mPos);
+    return mPos;
+  }
   
   /** Return the current position in the managed IByteChunk
    * @return The current position in the IByteChunk */
@@ -413,6 +603,8 @@ struct Config
   int plugMaxHeight;
   bool plugHostResize;
   const char* bundleID;
+  int maxBlockSize = 0; // PLUG_MAX_BLOCK_SIZE, the largest block size that buffers are allocated for when the plug-in is made, or 0 to allocate as block sizes change
+  double maxSampleRate = 0.; // PLUG_MAX_SAMPLE_RATE, the largest sample rate the plug-in sizes its own buffers for, or 0 if it doesn't declare one
   
   Config(int nParams,
               int nPresets,
@@ -473,10 +665,65 @@ struct IChannelData
   bool mConnected = false;
   TOUT** mData = nullptr; // If this is for an input channel, points into IPlugProcessor::mInData, if it's for an output channel points into IPlugProcessor::mOutData
   TIN* mIncomingData = nullptr;
-  WDL_TypedBuf<TOUT> mScratchBuf;
+  IAlignedBuf<TOUT> mScratchBuf;
   WDL_String mLabel;
 };
 
+/** A bump allocator for temporary buffers on the audio thread. Memory is reserved up front, Allocate() hands out aligned slices of it,
+ * and Reset() makes all of it available again, so nothing is allocated or freed whilst processing. See IPlugProcessor::SetScratchArenaSize() */
+class IScratchArena
+{
+public:
+  static constexpr int kAlignment = IPLUG_BUFFER_ALIGNMENT;
+
+  /** Reserve memory, discarding anything allocated. This allocates, so don't call it on the audio thread
+   * @param size The number of bytes to make available, before alignment padding */
+  void Resize(int size)
+  {
+    mBuf.Resize(size + kAlignment, false);
+    mUsed = 0;
+  }
+
+  /** @param size The number of bytes that are going to be requested in one Allocate() call
+   * @return The space that allocation takes up, including its alignment padding */
+  static int PaddedSize(int size) { return (size + kAlignment - 1) & ~(kAlignment - 1); }
+
+  /** Get an uninitialised, kAlignment aligned buffer that is valid until the next Reset()
+   * @param n The number of elements
+   * @return The buffer, or nullptr if the arena doesn't have room left */
+  template <typename T>
+  T* Allocate(int n)
+  {
+    static_assert(std::is_trivially_destructible<T>::value, "the arena doesn't call destructors");
+
+    const uintptr_t base = reinterpret_cast<uintptr_t>(mBuf.Get());
+    const uintptr_t start = (base + mUsed + kAlignment - 1) & ~static_cast<uintptr_t>(kAlignment - 1);
+    const int end = static_cast<int>(start - base) + n * static_cast<int>(sizeof(T));
+
+    if (!mBuf.Get() || end > mBuf.GetSize())
+    {
+      assert(!"IScratchArena exhausted, reserve more with SetScratchArenaSize()");
+      return nullptr;
+    }
+
+    mUsed = end;
+    return reinterpret_cast<T*>(start);
+  }
+
+  /** Make all of the memory available again. Any buffers handed out before are invalid after this */
+  void Reset() { mUsed = 0; }
+
+  /** @return The number of bytes handed out since the last Reset(), including alignment padding */
+  int GetUsed() const { return mUsed; }
+
+  /** @return The number of bytes reserved */
+  int GetSize() const { return std::max(mBuf.GetSize() - kAlignment, 0); }
+
+private:
+  WDL_HeapBuf mBuf;
+  int mUsed = 0;
+};
+
 /** Used to manage information about a bus such as whether it's an input or output, channel count */
 class IBusInfo
 {
@@ -601,6 +848,7 @@ struct IPreset
   char mName[MAX_PRESET_NAME_LEN];
 
   IByteChunk mChunk;
+  int mBankIdx = -1; // the index in the IPresetBank that mChunk will be copied from when it is first needed, or -1 if mChunk is up to date
 
   IPreset()
   {
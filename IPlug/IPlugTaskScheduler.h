@@ -0,0 +1,378 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc TaskScheduler
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "IPlugPlatform.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** A pool of worker threads shared by all the plug-in instances in a process, for background work such as loading impulses and samples, analysis and preset scanning.
+ * Without it fifty instances each with a few threads of their own overcommit the CPU, with this there is one thread per core (less one for the audio thread) whatever the number of instances.
+ *
+ * Tasks have a priority class. Idle workers always take a pending kPriorityRealtime task before a kPriorityUI one, and those before kPriorityBackground ones,
+ * but a running task is never preempted, so long real-time work should be split into short tasks. Each worker has its own queues: tasks submitted from a worker go to
+ * the back of its own queue and it takes them from the back, while idle workers steal from the front of the others' queues, so related work tends to stay on one core.
+ * Tasks submitted from other threads are spread over the workers.
+ *
+ * A pending task can be cancelled, in which case it never runs, and a running task can check Task::IsCancelled() to stop early.
+ * Submit() allocates and takes a lock, so it should not be called from the audio thread; hand work to a thread that can, or use a lock-free queue.
+ *
+ * Get() returns the shared instance and starts it if need be. The pool is stopped when the last instance releases it, so each plug-in (or object) that submits tasks
+ * should keep the pointer for as long as it needs it, and must not release the last reference from one of the tasks. "Process wide" means per plug-in binary, since each binary has its own statics.
+ * On the web there are no threads and tasks are run when they are submitted */
+class TaskScheduler
+{
+public:
+  enum EPriority
+  {
+    kPriorityRealtime = 0, // work the audio thread is waiting for, e.g. the next part of a streamed file
+    kPriorityUI, // work the user is waiting for, e.g. loading graphics or a preset
+    kPriorityBackground, // everything else, e.g. scanning a folder or building a cache
+    kNumPriorities
+  };
+
+  /** A submitted task, which can be used to cancel it or wait for it */
+  class Task
+  {
+  public:
+    /** @return \c true if Cancel() has been called. Long running tasks can check this and return early */
+    bool IsCancelled() const { return mCancelRequested.load(std::memory_order_acquire); }
+
+    /** @return \c true if the task has run, or was cancelled before it could */
+    bool IsDone() const
+    {
+      const int state = mState.load(std::memory_order_acquire);
+      return state == kFinished || state == kCancelled;
+    }
+
+    /** Ask the task to stop. If no worker has started it, it never will
+     * @return \c true if the task had not started, so it will not run */
+    bool Cancel()
+    {
+      mCancelRequested.store(true, std::memory_order_release);
+      int expected = kPending;
+
+      if (mState.compare_exchange_strong(expected, kCancelled, std::memory_order_acq_rel))
+      {
+        Finish(kCancelled);
+        return true;
+      }
+
+      return false;
+    }
+
+    /** Run the task on the calling thread, if no worker has started it. Useful when a thread needs the result now
+     * @return \c true if it was run here */
+    bool RunIfPending()
+    {
+      int expected = kPending;
+
+      if (!mState.compare_exchange_strong(expected, kRunning, std::memory_order_acq_rel))
+        return false;
+
+      Run();
+      return true;
+    }
+
+    /** Block until the task has run or has been cancelled. If this is called from one of the workers, it runs other tasks while it waits, so that tasks can wait for tasks they submit */
+    void Wait()
+    {
+      if (CurrentWorker().mScheduler == mScheduler)
+      {
+        while (!IsDone())
+        {
+          if (!mScheduler->RunOne())
+          {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mDoneCV.wait_for(lock, std::chrono::milliseconds(1), [&]() { return IsDone(); });
+          }
+        }
+
+        return;
+      }
+
+      std::unique_lock<std::mutex> lock(mMutex);
+      mDoneCV.wait(lock, [&]() { return IsDone(); });
+    }
+
+    Task(TaskScheduler* pScheduler, std::function<void(const Task&)> func)
+    : mScheduler(pScheduler)
+    , mFunc(std::move(func))
+    {}
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+  private:
+    friend class TaskScheduler;
+
+    enum EState { kPending, kRunning, kFinished, kCancelled };
+
+    void Run()
+    {
+      if (!IsCancelled())
+        mFunc(*this);
+
+      mFunc = nullptr; // release anything it captured before anyone is told it is done
+      Finish(kFinished);
+    }
+
+    void Finish(EState state)
+    {
+      {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mState.store(state, std::memory_order_release);
+      }
+
+      mDoneCV.notify_all();
+    }
+
+    TaskScheduler* mScheduler; // only used by workers of that scheduler, so it can outlive it
+    std::function<void(const Task&)> mFunc;
+    std::atomic<int> mState {kPending};
+    std::atomic<bool> mCancelRequested {false};
+    std::mutex mMutex;
+    std::condition_variable mDoneCV;
+  };
+
+  using TaskPtr = std::shared_ptr<Task>;
+  using Ptr = std::shared_ptr<TaskScheduler>;
+
+  /** @return The scheduler shared by this process, started if nobody holds it */
+  static Ptr Get()
+  {
+    static std::mutex sMutex;
+    static std::weak_ptr<TaskScheduler> sScheduler;
+
+    std::lock_guard<std::mutex> lock(sMutex);
+    Ptr pScheduler = sScheduler.lock();
+
+    if (!pScheduler)
+    {
+      pScheduler = std::make_shared<TaskScheduler>(DefaultNumThreads());
+      sScheduler = pScheduler;
+    }
+
+    return pScheduler;
+  }
+
+  /** @return One thread per core, leaving one for the audio thread */
+  static int DefaultNumThreads()
+  {
+#if defined OS_WEB
+    return 0;
+#else
+    return std::max(static_cast<int>(std::thread::hardware_concurrency()) - 1, 1);
+#endif
+  }
+
+  /** Use Get() for the shared scheduler, this is for a private pool
+   * @param nThreads The number of workers, with none tasks are run when they are submitted */
+  TaskScheduler(int nThreads)
+  {
+    for (auto i = 0; i < nThreads; i++)
+      mWorkers.emplace_back(new Worker);
+
+    for (auto i = 0; i < nThreads; i++)
+      mWorkers[i]->mThread = std::thread(&TaskScheduler::WorkerLoop, this, i);
+  }
+
+  /** Stops the workers after their current tasks. Tasks that haven't started are cancelled */
+  ~TaskScheduler()
+  {
+    assert(!IsWorkerThread()); // the last reference must not be released by a task
+
+    {
+      std::lock_guard<std::mutex> lock(mSleepMutex);
+      mRunning.store(false, std::memory_order_release);
+    }
+
+    mWakeUp.notify_all();
+
+    for (auto& pWorker : mWorkers)
+      pWorker->mThread.join();
+
+    for (auto& pWorker : mWorkers)
+    {
+      for (auto p = 0; p < kNumPriorities; p++)
+      {
+        for (auto& pTask : pWorker->mQueues[p])
+          pTask->Cancel();
+      }
+    }
+  }
+
+  TaskScheduler(const TaskScheduler&) = delete;
+  TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+  /** Queue a task. Not for the audio thread, see the class description
+   * @param priority The priority class
+   * @param func The task, called on a worker with its Task, which it can check for cancellation
+   * @return The task, which can be ignored if it doesn't need to be cancelled or waited for */
+  TaskPtr Submit(EPriority priority, std::function<void(const Task&)> func)
+  {
+    TaskPtr pTask = std::make_shared<Task>(this, std::move(func));
+
+    if (mWorkers.empty())
+    {
+      pTask->RunIfPending();
+      return pTask;
+    }
+
+    const int self = CurrentWorker().mScheduler == this ? CurrentWorker().mIdx : -1;
+    const int idx = self >= 0 ? self : static_cast<int>(mNextWorker.fetch_add(1, std::memory_order_relaxed) % mWorkers.size());
+
+    {
+      Worker& worker = *mWorkers[idx];
+      std::lock_guard<std::mutex> lock(worker.mMutex);
+      worker.mQueues[priority].push_back(pTask);
+    }
+
+    mNumQueued.fetch_add(1, std::memory_order_release);
+
+    {
+      std::lock_guard<std::mutex> lock(mSleepMutex);
+    }
+
+    mWakeUp.notify_one();
+    return pTask;
+  }
+
+  /** @return The number of worker threads */
+  int GetNumThreads() const { return static_cast<int>(mWorkers.size()); }
+
+  /** @return \c true if the calling thread is one of this scheduler's workers */
+  bool IsWorkerThread() const { return CurrentWorker().mScheduler == this; }
+
+private:
+  struct Worker
+  {
+    std::mutex mMutex;
+    std::deque<TaskPtr> mQueues[kNumPriorities];
+    std::thread mThread;
+  };
+
+  struct WorkerIdx
+  {
+    const TaskScheduler* mScheduler = nullptr;
+    int mIdx = -1;
+  };
+
+  /** @return The scheduler and index of the worker running on the calling thread, if it is one */
+  static WorkerIdx& CurrentWorker()
+  {
+    static thread_local WorkerIdx sWorker;
+    return sWorker;
+  }
+
+  /** Take the highest priority pending task, from the back of the calling worker's own queue or the front of another's
+   * @param self The index of the calling worker, or -1 */
+  TaskPtr Take(int self)
+  {
+    const int nWorkers = static_cast<int>(mWorkers.size());
+
+    for (auto p = 0; p < kNumPriorities; p++)
+    {
+      if (self >= 0)
+      {
+        Worker& worker = *mWorkers[self];
+        std::lock_guard<std::mutex> lock(worker.mMutex);
+        auto& queue = worker.mQueues[p];
+
+        if (!queue.empty())
+        {
+          TaskPtr pTask = std::move(queue.back());
+          queue.pop_back();
+          return pTask;
+        }
+      }
+
+      for (auto i = 1; i <= nWorkers; i++)
+      {
+        const int victim = (std::max(self, 0) + i) % nWorkers;
+
+        if (victim == self)
+          continue;
+
+        Worker& worker = *mWorkers[victim];
+        std::lock_guard<std::mutex> lock(worker.mMutex);
+        auto& queue = worker.mQueues[p];
+
+        if (!queue.empty())
+        {
+          TaskPtr pTask = std::move(queue.front());
+          queue.pop_front();
+          return pTask;
+        }
+      }
+    }
+
+    return nullptr;
+  }
+
+  /** Run one pending task on the calling worker, if there is one. Cancelled tasks are dropped without counting as run
+   * @return \c true if a task was run */
+  bool RunOne()
+  {
+    while (TaskPtr pTask = Take(CurrentWorker().mScheduler == this ? CurrentWorker().mIdx : -1))
+    {
+      mNumQueued.fetch_sub(1, std::memory_order_acq_rel);
+
+      if (pTask->RunIfPending())
+        return true;
+    }
+
+    return false;
+  }
+
+  void WorkerLoop(int idx)
+  {
+    CurrentWorker().mScheduler = this;
+    CurrentWorker().mIdx = idx;
+
+    while (mRunning.load(std::memory_order_acquire))
+    {
+      if (RunOne())
+        continue;
+
+      std::unique_lock<std::mutex> lock(mSleepMutex);
+      mWakeUp.wait(lock, [&]() { return !mRunning.load(std::memory_order_acquire) || mNumQueued.load(std::memory_order_acquire) > 0; });
+    }
+
+    CurrentWorker() = WorkerIdx();
+  }
+
+  std::vector<std::unique_ptr<Worker>> mWorkers;
+  std::atomic<unsigned int> mNextWorker {0};
+  std::atomic<int> mNumQueued {0}; // tasks in the queues, including cancelled ones that haven't been dropped yet
+  std::mutex mSleepMutex;
+  std::condition_variable mWakeUp;
+  std::atomic<bool> mRunning {true};
+};
+
+END_IPLUG_NAMESPACE
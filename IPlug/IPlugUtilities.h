@@ -24,12 +24,21 @@
 #include <cstdlib>
 #include <cstring>
 #include <cctype>
+#include <type_traits>
 
 #include "wdlstring.h"
 
 #include "IPlugConstants.h"
 #include "IPlugPlatform.h"
 
+#if defined IPLUG_SIMD_SSE2
+  #include <emmintrin.h>
+#elif defined IPLUG_SIMD_NEON
+  #include <arm_neon.h>
+#elif defined IPLUG_SIMD_WASM
+  #include <wasm_simd128.h>
+#endif
+
 #ifdef OS_WIN
 #pragma warning(disable:4018 4267)	// size_t/signed/unsigned mismatch..
 #pragma warning(disable:4800)		// if (pointer) ...
@@ -152,6 +161,231 @@ void CastCopy(DEST* pDest, SRC* pSrc, int n)
   }
 }
 
+/** Vectorised float to double version of CastCopy(), used when converting between host and plug-in sample types
+ * @param pDest Ptr to the destination buffer
+ * @param pSrc Ptr to the source buffer
+ * @param n The number of or elements in the buffer */
+inline void CastCopy(double* pDest, float* pSrc, int n)
+{
+  int i = 0;
+#if defined IPLUG_SIMD_SSE2
+  for (; i + 4 <= n; i += 4)
+  {
+    const __m128 f = _mm_loadu_ps(pSrc + i);
+    _mm_storeu_pd(pDest + i, _mm_cvtps_pd(f));
+    _mm_storeu_pd(pDest + i + 2, _mm_cvtps_pd(_mm_movehl_ps(f, f)));
+  }
+#elif defined IPLUG_SIMD_NEON
+  for (; i + 4 <= n; i += 4)
+  {
+    const float32x4_t f = vld1q_f32(pSrc + i);
+    vst1q_f64(pDest + i, vcvt_f64_f32(vget_low_f32(f)));
+    vst1q_f64(pDest + i + 2, vcvt_high_f64_f32(f));
+  }
+#elif defined IPLUG_SIMD_WASM
+  for (; i + 4 <= n; i += 4)
+  {
+    const v128_t f = wasm_v128_load(pSrc + i);
+    wasm_v128_store(pDest + i, wasm_f64x2_promote_low_f32x4(f));
+    wasm_v128_store(pDest + i + 2, wasm_f64x2_promote_low_f32x4(wasm_i64x2_shuffle(f, f, 1, 1)));
+  }
+#endif
+  for (; i < n; ++i)
+    pDest[i] = (double) pSrc[i];
+}
+
+/** Vectorised double to float version of CastCopy(), used when converting between host and plug-in sample types
+ * @param pDest Ptr to the destination buffer
+ * @param pSrc Ptr to the source buffer
+ * @param n The number of or elements in the buffer */
+inline void CastCopy(float* pDest, double* pSrc, int n)
+{
+  int i = 0;
+#if defined IPLUG_SIMD_SSE2
+  for (; i + 4 <= n; i += 4)
+  {
+    const __m128 lo = _mm_cvtpd_ps(_mm_loadu_pd(pSrc + i));
+    const __m128 hi = _mm_cvtpd_ps(_mm_loadu_pd(pSrc + i + 2));
+    _mm_storeu_ps(pDest + i, _mm_movelh_ps(lo, hi));
+  }
+#elif defined IPLUG_SIMD_NEON
+  for (; i + 4 <= n; i += 4)
+  {
+    const float32x2_t lo = vcvt_f32_f64(vld1q_f64(pSrc + i));
+    vst1q_f32(pDest + i, vcvt_high_f32_f64(lo, vld1q_f64(pSrc + i + 2)));
+  }
+#elif defined IPLUG_SIMD_WASM
+  for (; i + 4 <= n; i += 4)
+  {
+    const v128_t lo = wasm_f32x4_demote_f64x2_zero(wasm_v128_load(pSrc + i));
+    const v128_t hi = wasm_f32x4_demote_f64x2_zero(wasm_v128_load(pSrc + i + 2));
+    wasm_v128_store(pDest + i, wasm_i64x2_shuffle(lo, hi, 0, 2));
+  }
+#endif
+  for (; i < n; ++i)
+    pDest[i] = (float) pSrc[i];
+}
+
+/** Accumulate the minimum, maximum and sum of squares of a buffer, four samples at a time where SIMD is available
+ * @param pSrc Ptr to the source buffer
+ * @param n The number of elements in the buffer
+ * @param minVal Running minimum, updated in place
+ * @param maxVal Running maximum, updated in place
+ * @param sumSq Running sum of squares, updated in place */
+inline void AccumulateMinMaxSumSq(const float* pSrc, int n, float& minVal, float& maxVal, float& sumSq)
+{
+  int i = 0;
+#if defined IPLUG_SIMD_SSE2
+  if (n >= 4)
+  {
+    __m128 vMin = _mm_set1_ps(minVal), vMax = _mm_set1_ps(maxVal), vSum = _mm_setzero_ps();
+    for (; i + 4 <= n; i += 4)
+    {
+      const __m128 x = _mm_loadu_ps(pSrc + i);
+      vMin = _mm_min_ps(vMin, x);
+      vMax = _mm_max_ps(vMax, x);
+      vSum = _mm_add_ps(vSum, _mm_mul_ps(x, x));
+    }
+    float lMin[4], lMax[4], lSum[4];
+    _mm_storeu_ps(lMin, vMin);
+    _mm_storeu_ps(lMax, vMax);
+    _mm_storeu_ps(lSum, vSum);
+    for (int j = 0; j < 4; j++)
+    {
+      minVal = std::min(minVal, lMin[j]);
+      maxVal = std::max(maxVal, lMax[j]);
+      sumSq += lSum[j];
+    }
+  }
+#elif defined IPLUG_SIMD_NEON
+  if (n >= 4)
+  {
+    float32x4_t vMin = vdupq_n_f32(minVal), vMax = vdupq_n_f32(maxVal), vSum = vdupq_n_f32(0.f);
+    for (; i + 4 <= n; i += 4)
+    {
+      const float32x4_t x = vld1q_f32(pSrc + i);
+      vMin = vminq_f32(vMin, x);
+      vMax = vmaxq_f32(vMax, x);
+      vSum = vmlaq_f32(vSum, x, x);
+    }
+    minVal = std::min(minVal, vminvq_f32(vMin));
+    maxVal = std::max(maxVal, vmaxvq_f32(vMax));
+    sumSq += vaddvq_f32(vSum);
+  }
+#elif defined IPLUG_SIMD_WASM
+  if (n >= 4)
+  {
+    v128_t vMin = wasm_f32x4_splat(minVal), vMax = wasm_f32x4_splat(maxVal), vSum = wasm_f32x4_splat(0.f);
+    for (; i + 4 <= n; i += 4)
+    {
+      const v128_t x = wasm_v128_load(pSrc + i);
+      vMin = wasm_f32x4_pmin(vMin, x); // pmin/pmax match std::min/max and SSE, rather than propagating NaNs
+      vMax = wasm_f32x4_pmax(vMax, x);
+      vSum = wasm_f32x4_add(vSum, wasm_f32x4_mul(x, x));
+    }
+    float lMin[4], lMax[4], lSum[4];
+    wasm_v128_store(lMin, vMin);
+    wasm_v128_store(lMax, vMax);
+    wasm_v128_store(lSum, vSum);
+    for (int j = 0; j < 4; j++)
+    {
+      minVal = std::min(minVal, lMin[j]);
+      maxVal = std::max(maxVal, lMax[j]);
+      sumSq += lSum[j];
+    }
+  }
+#endif
+  for (; i < n; ++i)
+  {
+    minVal = std::min(minVal, pSrc[i]);
+    maxVal = std::max(maxVal, pSrc[i]);
+    sumSq += pSrc[i] * pSrc[i];
+  }
+}
+
+/** Double precision version of AccumulateMinMaxSumSq(), two samples at a time where SIMD is available
+ * @param pSrc Ptr to the source buffer
+ * @param n The number of elements in the buffer
+ * @param minVal Running minimum, updated in place
+ * @param maxVal Running maximum, updated in place
+ * @param sumSq Running sum of squares, updated in place */
+inline void AccumulateMinMaxSumSq(const double* pSrc, int n, double& minVal, double& maxVal, double& sumSq)
+{
+  int i = 0;
+#if defined IPLUG_SIMD_SSE2
+  if (n >= 2)
+  {
+    __m128d vMin = _mm_set1_pd(minVal), vMax = _mm_set1_pd(maxVal), vSum = _mm_setzero_pd();
+    for (; i + 2 <= n; i += 2)
+    {
+      const __m128d x = _mm_loadu_pd(pSrc + i);
+      vMin = _mm_min_pd(vMin, x);
+      vMax = _mm_max_pd(vMax, x);
+      vSum = _mm_add_pd(vSum, _mm_mul_pd(x, x));
+    }
+    double lMin[2], lMax[2], lSum[2];
+    _mm_storeu_pd(lMin, vMin);
+    _mm_storeu_pd(lMax, vMax);
+    _mm_storeu_pd(lSum, vSum);
+    minVal = std::min(minVal, std::min(lMin[0], lMin[1]));
+    maxVal = std::max(maxVal, std::max(lMax[0], lMax[1]));
+    sumSq += lSum[0] + lSum[1];
+  }
+#elif defined IPLUG_SIMD_NEON
+  if (n >= 2)
+  {
+    float64x2_t vMin = vdupq_n_f64(minVal), vMax = vdupq_n_f64(maxVal), vSum = vdupq_n_f64(0.);
+    for (; i + 2 <= n; i += 2)
+    {
+      const float64x2_t x = vld1q_f64(pSrc + i);
+      vMin = vminq_f64(vMin, x);
+      vMax = vmaxq_f64(vMax, x);
+      vSum = vfmaq_f64(vSum, x, x);
+    }
+    minVal = std::min(minVal, vminvq_f64(vMin));
+    maxVal = std::max(maxVal, vmaxvq_f64(vMax));
+    sumSq += vaddvq_f64(vSum);
+  }
+#elif defined IPLUG_SIMD_WASM
+  if (n >= 2)
+  {
+    v128_t vMin = wasm_f64x2_splat(minVal), vMax = wasm_f64x2_splat(maxVal), vSum = wasm_f64x2_splat(0.);
+    for (; i + 2 <= n; i += 2)
+    {
+      const v128_t x = wasm_v128_load(pSrc + i);
+      vMin = wasm_f64x2_pmin(vMin, x);
+      vMax = wasm_f64x2_pmax(vMax, x);
+      vSum = wasm_f64x2_add(vSum, wasm_f64x2_mul(x, x));
+    }
+    minVal = std::min(minVal, std::min(wasm_f64x2_extract_lane(vMin, 0), wasm_f64x2_extract_lane(vMin, 1)));
+    maxVal = std::max(maxVal, std::max(wasm_f64x2_extract_lane(vMax, 0), wasm_f64x2_extract_lane(vMax, 1)));
+    sumSq += wasm_f64x2_extract_lane(vSum, 0) + wasm_f64x2_extract_lane(vSum, 1);
+  }
+#endif
+  for (; i < n; ++i)
+  {
+    minVal = std::min(minVal, pSrc[i]);
+    maxVal = std::max(maxVal, pSrc[i]);
+    sumSq += pSrc[i] * pSrc[i];
+  }
+}
+
+/** Call a function with a channel count as a compile time constant, so that loops over the channels can be unrolled and vectorised.
+ * Mono and stereo, which cover most plug-ins, get their own instantiations, any other count is passed as 0, which means use nChans at runtime, e.g.
+ * DispatchNChans(nChans, [&](auto fixed) { ProcessBlockT<decltype(fixed)::value>(inputs, outputs, nChans, nFrames); });
+ * @param nChans The number of channels
+ * @param func A callable taking a std::integral_constant<int, N>, where N is 1, 2 or 0 */
+template <typename F>
+inline void DispatchNChans(int nChans, F&& func)
+{
+  switch (nChans)
+  {
+    case 1: func(std::integral_constant<int, 1>()); break;
+    case 2: func(std::integral_constant<int, 2>()); break;
+    default: func(std::integral_constant<int, 0>()); break;
+  }
+}
+
 /** \todo  
  * @param cDest \todo
  * @param cSrc \todo */
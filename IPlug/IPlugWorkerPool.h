@@ -0,0 +1,202 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc IWorkerPool
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "IPlugSignal.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** A pool of worker threads owned by the plug-in, for APIs where the host has no thread pool of its own, such as WAM built with WASM_THREADS=1.
+ * The audio thread can split work between the workers with ExecuteParallel(), e.g. through IPlugProcessor::ExecuteParallel() for VoiceRenderPool::SetHostExecutor().
+ * Handing the tasks over takes no locks and no allocations: they are claimed with a compare and swap on one word that packs the block's generation, the number of tasks
+ * and the next task index, as VoiceRenderPool does, and the audio thread claims tasks too, so a block never waits for a worker to wake up.
+ * Other threads can Dispatch() slower background jobs, such as preparing impulse responses or analysis, which the workers run when there are no parallel tasks */
+class IWorkerPool
+{
+public:
+  /** A function that ExecuteParallel() calls once for each task, the same as IPlugProcessor::ParallelTask */
+  using Task = void (*)(void* pContext, int taskIdx);
+
+  /** @param nThreads The number of worker threads, not counting the audio thread */
+  explicit IWorkerPool(int nThreads)
+  {
+    for (int i = 0; i < nThreads; i++)
+      mWorkers.push_back(std::make_unique<Worker>());
+
+    for (int i = 0; i < nThreads; i++)
+      mWorkers[i]->mThread = std::thread(&IWorkerPool::ThreadLoop, this, i);
+  }
+
+  ~IWorkerPool()
+  {
+    mRunning = false;
+
+    for (auto& pWorker : mWorkers)
+      pWorker->mSignal.Notify();
+
+    for (auto& pWorker : mWorkers)
+      pWorker->mThread.join();
+  }
+
+  IWorkerPool(const IWorkerPool&) = delete;
+  IWorkerPool& operator=(const IWorkerPool&) = delete;
+
+  /** @return The number of worker threads */
+  int NThreads() const { return static_cast<int>(mWorkers.size()); }
+
+  /** Run tasks on the workers and the calling thread, returning when they are all done. Call this from one thread at a time, normally the audio thread
+   * @param task Called once for each task index from 0 to nTasks - 1, possibly concurrently
+   * @param pContext Passed to task
+   * @param nTasks The number of tasks, up to 65535
+   * @return \c false if there are no workers or too many tasks, in which case none were run */
+  bool ExecuteParallel(Task task, void* pContext, int nTasks)
+  {
+    if (mWorkers.empty() || nTasks < 1 || nTasks > 0xFFFF)
+      return false;
+
+    mTask = task;
+    mContext = pContext;
+    mNumDone.store(0, std::memory_order_relaxed);
+
+    const uint64_t generation = ++mGeneration;
+    mClaim.store(MakeClaim(generation, nTasks, 0), std::memory_order_release);
+
+    // the signal only makes a system call for a worker that is asleep
+    const int nToWake = std::min(nTasks - 1, NThreads());
+
+    for (int i = 0; i < nToWake; i++)
+      mWorkers[i]->mSignal.Notify();
+
+    RunTasks();
+
+    // wait for tasks that workers claimed and are still running, the browser's audio thread can't block, so this spins
+    while (mNumDone.load(std::memory_order_acquire) < nTasks)
+      std::this_thread::yield();
+
+    return true;
+  }
+
+  /** Queue a job to run on one of the workers, when they have no parallel tasks. This locks and allocates, so don't call it from the audio thread.
+   * Jobs run in the order they were queued, but can run concurrently on different workers */
+  void Dispatch(std::function<void()> job)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mJobMutex);
+      mJobs.push_back(std::move(job));
+    }
+
+    if (!mWorkers.empty())
+      mWorkers[mNextWorker++ % mWorkers.size()]->mSignal.Notify();
+  }
+
+private:
+  struct Worker
+  {
+    IPlugSignal mSignal;
+    std::thread mThread;
+  };
+
+  // [63..48] generation, [47..32] number of tasks, [31..0] next task index
+  static uint64_t MakeClaim(uint64_t generation, int nTasks, uint32_t next)
+  {
+    return ((generation & 0xFFFF) << 48) | (static_cast<uint64_t>(nTasks) << 32) | next;
+  }
+
+  /** Claim and run tasks of the current block until there are none left
+   * @return \c true if any were run */
+  bool RunTasks()
+  {
+    bool ranAny = false;
+    uint64_t claim = mClaim.load(std::memory_order_acquire);
+
+    while (true)
+    {
+      const uint32_t next = static_cast<uint32_t>(claim);
+      const uint32_t nTasks = static_cast<uint32_t>(claim >> 32) & 0xFFFF;
+
+      if (next >= nTasks)
+        return ranAny;
+
+      if (mClaim.compare_exchange_weak(claim, claim + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+      {
+        // the block can't finish, so mTask and mContext can't change, until this task is done
+        mTask(mContext, static_cast<int>(next));
+        mNumDone.fetch_add(1, std::memory_order_release);
+        ranAny = true;
+        claim = mClaim.load(std::memory_order_acquire);
+      }
+    }
+  }
+
+  bool RunJob()
+  {
+    std::function<void()> job;
+
+    {
+      std::lock_guard<std::mutex> lock(mJobMutex);
+
+      if (mJobs.empty())
+        return false;
+
+      job = std::move(mJobs.front());
+      mJobs.pop_front();
+    }
+
+    job();
+    return true;
+  }
+
+  void ThreadLoop(int workerIdx)
+  {
+    Worker& worker = *mWorkers[workerIdx];
+
+    while (mRunning)
+    {
+      if (RunTasks())
+        continue;
+
+      if (RunJob())
+        continue;
+
+      worker.mSignal.Wait();
+    }
+  }
+
+  std::vector<std::unique_ptr<Worker>> mWorkers;
+  std::atomic<bool> mRunning {true};
+
+  std::atomic<uint64_t> mClaim {0};
+  std::atomic<int> mNumDone {0};
+  uint64_t mGeneration = 0;
+  Task mTask = nullptr;
+  void* mContext = nullptr;
+
+  std::mutex mJobMutex;
+  std::deque<std::function<void()>> mJobs;
+  std::atomic<unsigned> mNextWorker {0};
+};
+
+END_IPLUG_NAMESPACE
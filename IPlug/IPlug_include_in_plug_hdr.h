@@ -69,6 +69,10 @@
 #elif defined WEB_API
   #include "IPlugWeb.h"
   #define PLUGIN_API_BASE IPlugWeb
+#elif defined CLAP_API
+  #include "IPlugCLAP.h"
+  #define PLUGIN_API_BASE IPlugCLAP
+  #define API_EXT "clap"
 #elif defined VST3_API
   #define IPLUG_VST3
   #include "IPlugVST3.h"
@@ -24,7 +24,7 @@
 
 #if defined OS_WIN && !defined VST3C_API
   HINSTANCE gHINSTANCE = 0;
-  #if defined(VST2_API) || defined(AAX_API)
+  #if defined(VST2_API) || defined(AAX_API) || defined(CLAP_API)
   #ifdef __MINGW32__
   extern "C"
   #endif
@@ -271,6 +271,74 @@
     
     return 0;
   }
+#pragma mark - CLAP
+#elif defined CLAP_API
+  #ifndef CLAP_FEATURES
+    #if PLUG_TYPE == 1
+      #define CLAP_FEATURES CLAP_PLUGIN_FEATURE_INSTRUMENT
+    #elif PLUG_TYPE == 2
+      #define CLAP_FEATURES CLAP_PLUGIN_FEATURE_NOTE_EFFECT
+    #else
+      #define CLAP_FEATURES CLAP_PLUGIN_FEATURE_AUDIO_EFFECT
+    #endif
+  #endif
+
+  static const char* gClapFeatures[] = { CLAP_FEATURES, nullptr };
+
+  static const clap_plugin_descriptor gClapDescriptor = {
+    CLAP_VERSION_INIT,
+    BUNDLE_DOMAIN "." BUNDLE_MFR "." BUNDLE_NAME,
+    PLUG_NAME,
+    PLUG_MFR,
+    PLUG_URL_STR,
+    "",
+    "",
+    PLUG_VERSION_STR,
+    "",
+    gClapFeatures
+  };
+
+  static uint32_t ClapGetPluginCount(const clap_plugin_factory* pFactory)
+  {
+    return 1;
+  }
+
+  static const clap_plugin_descriptor* ClapGetPluginDescriptor(const clap_plugin_factory* pFactory, uint32_t index)
+  {
+    return index == 0 ? &gClapDescriptor : nullptr;
+  }
+
+  static const clap_plugin* ClapCreatePlugin(const clap_plugin_factory* pFactory, const clap_host* pHost, const char* pluginID)
+  {
+    using namespace iplug;
+
+    if (!clap_version_is_compatible(pHost->clap_version) || strcmp(pluginID, gClapDescriptor.id))
+      return nullptr;
+
+    IPlugCLAP* pPlug = MakePlug(InstanceInfo{&gClapDescriptor, pHost});
+    return pPlug ? pPlug->GetClapPlugin() : nullptr;
+  }
+
+  static const clap_plugin_factory gClapFactory = { ClapGetPluginCount, ClapGetPluginDescriptor, ClapCreatePlugin };
+
+  static bool ClapEntryInit(const char* pluginPath)
+  {
+    return true;
+  }
+
+  static void ClapEntryDeinit()
+  {
+  }
+
+  static const void* ClapEntryGetFactory(const char* factoryID)
+  {
+    return strcmp(factoryID, CLAP_PLUGIN_FACTORY_ID) ? nullptr : &gClapFactory;
+  }
+
+  extern "C"
+  {
+    CLAP_EXPORT extern const clap_plugin_entry clap_entry = { CLAP_VERSION_INIT, ClapEntryInit, ClapEntryDeinit, ClapEntryGetFactory };
+  }
 #elif defined AUv3_API || defined AAX_API || defined APP_API
 // Nothing to do here
 #else
@@ -282,15 +350,16 @@
 BEGIN_IPLUG_NAMESPACE
 
 #pragma mark -
-#pragma mark VST2, VST3, AAX, AUv3, APP, WAM, WEB
+#pragma mark VST2, VST3, AAX, AUv3, APP, WAM, WEB, CLAP
 
-#if defined VST2_API || defined VST3_API || defined AAX_API || defined AUv3_API || defined APP_API  || defined WAM_API || defined WEB_API
+#if defined VST2_API || defined VST3_API || defined AAX_API || defined AUv3_API || defined APP_API  || defined WAM_API || defined WEB_API || defined CLAP_API
 
 Plugin* MakePlug(const InstanceInfo& info)
 {
   // From VST3 - is this necessary?
   static WDL_Mutex sMutex;
   WDL_MutexLock lock(&sMutex);
+  ENTER_STARTUP_TIMING_SCOPE(kConstruct)
   
   return new PLUG_CLASS_NAME(info);
 }
@@ -302,6 +371,7 @@ Plugin* MakePlug(void* pMemory)
 {
   InstanceInfo info;
   info.mCocoaViewFactoryClassName.Set(AUV2_VIEW_CLASS_STR);
+  ENTER_STARTUP_TIMING_SCOPE(kConstruct)
     
   if (pMemory)
     return new(pMemory) PLUG_CLASS_NAME(info);
@@ -344,7 +414,17 @@ Steinberg::FUnknown* MakeProcessor()
 
 static Config MakeConfig(int nParams, int nPresets)
 {
-  return Config(nParams, nPresets, PLUG_CHANNEL_IO, PLUG_NAME, PLUG_NAME, PLUG_MFR, PLUG_VERSION_HEX, PLUG_UNIQUE_ID, PLUG_MFR_ID, PLUG_LATENCY, PLUG_DOES_MIDI_IN, PLUG_DOES_MIDI_OUT, PLUG_DOES_MPE, PLUG_DOES_STATE_CHUNKS, PLUG_TYPE, PLUG_HAS_UI, PLUG_WIDTH, PLUG_HEIGHT, PLUG_HOST_RESIZE, PLUG_MIN_WIDTH, PLUG_MAX_WIDTH, PLUG_MIN_HEIGHT, PLUG_MAX_HEIGHT, BUNDLE_ID); // TODO: Product Name?
+  Config config(nParams, nPresets, PLUG_CHANNEL_IO, PLUG_NAME, PLUG_NAME, PLUG_MFR, PLUG_VERSION_HEX, PLUG_UNIQUE_ID, PLUG_MFR_ID, PLUG_LATENCY, PLUG_DOES_MIDI_IN, PLUG_DOES_MIDI_OUT, PLUG_DOES_MPE, PLUG_DOES_STATE_CHUNKS, PLUG_TYPE, PLUG_HAS_UI, PLUG_WIDTH, PLUG_HEIGHT, PLUG_HOST_RESIZE, PLUG_MIN_WIDTH, PLUG_MAX_WIDTH, PLUG_MIN_HEIGHT, PLUG_MAX_HEIGHT, BUNDLE_ID); // TODO: Product Name?
+
+  // optional, define them in config.h for the framework's buffers to be allocated once, when the plug-in is made, see IPlugProcessor::GetMaxBlockSize()
+#ifdef PLUG_MAX_BLOCK_SIZE
+  config.maxBlockSize = PLUG_MAX_BLOCK_SIZE;
+#endif
+#ifdef PLUG_MAX_SAMPLE_RATE
+  config.maxSampleRate = PLUG_MAX_SAMPLE_RATE;
+#endif
+
+  return config;
 }
 
 END_IPLUG_NAMESPACE
@@ -18,7 +18,14 @@
 
 #include "IPlugPlatform.h"
 #include "IPlugQueue.h"
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <vector>
 
 BEGIN_IPLUG_NAMESPACE
 
@@ -30,6 +37,7 @@ struct ISenderData
   int nChans = MAXNC;
   int chanOffset = 0;
   std::array<T, MAXNC> vals {0};
+  int64_t samplePos = -1; // the ISenderClock position of the audio the data describes, or -1 to show it as soon as it arrives
   
   ISenderData() {}
   
@@ -49,33 +57,253 @@ struct ISenderData
   }
 };
 
+/** ISenderClock relates the audio thread's sample positions to the time the audio is heard, so that ISender can show data together with the sound it describes,
+ * rather than as soon as the GUI timer picks it up, which is ahead of the sound by the buffer size plus the device's and the host's latency.
+ * The audio thread calls ProcessBlock() at the start of each block, the position counts every sample processed since the clock was made, whatever the transport does.
+ * The offset between the positions and the system clock is smoothed over the block callbacks, to even out their scheduling jitter */
+class ISenderClock
+{
+public:
+  /** Call this at the start of each block on the realtime audio thread, before pushing any data for the block
+   * @param nFrames The number of frames in the block
+   * @param sampleRate The sample rate
+   * @param latencySamples The latency after the block is processed, such as the plug-in's GetLatency() plus the device's output latency where it is known. The block itself is counted */
+  void ProcessBlock(int nFrames, double sampleRate, int latencySamples = 0)
+  {
+    const double now = Now();
+    const double offset = now - static_cast<double>(mNextPos) / sampleRate;
+
+    // jumps after dropouts, sample rate changes or the transport starting start the estimate again
+    if (sampleRate != mSampleRate || std::fabs(offset - mOffset) > 0.05)
+      mOffset = offset;
+    else
+      mOffset += (offset - mOffset) * 0.05;
+
+    mSampleRate = sampleRate;
+    mBlockStartPos.store(mNextPos, std::memory_order_relaxed);
+    mNextPos += nFrames;
+
+    mSharedOffset.store(mOffset + static_cast<double>(nFrames + latencySamples) / sampleRate, std::memory_order_relaxed);
+    mSharedSampleRate.store(sampleRate, std::memory_order_release);
+  }
+
+  /** @return The position of the first sample of the current block, to stamp ISenderData::samplePos with. Realtime audio thread only */
+  int64_t GetBlockStartPos() const { return mBlockStartPos.load(std::memory_order_relaxed); }
+
+  /** @return When the sample at a position is estimated to be heard, in seconds of Now(), or 0 before the first block. This can be called on any thread */
+  double GetPresentationTime(int64_t samplePos) const
+  {
+    const double sampleRate = mSharedSampleRate.load(std::memory_order_acquire);
+
+    if (sampleRate <= 0.)
+      return 0.;
+
+    return mSharedOffset.load(std::memory_order_relaxed) + static_cast<double>(samplePos) / sampleRate;
+  }
+
+  /** @return The time in seconds on the clock that presentation times are measured on */
+  static double Now()
+  {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+  }
+
+private:
+  // audio thread only
+  int64_t mNextPos = 0;
+  double mOffset = 0.;
+  double mSampleRate = 0.;
+
+  std::atomic<int64_t> mBlockStartPos {0};
+  std::atomic<double> mSharedOffset {0.}; // the presentation time of sample 0
+  std::atomic<double> mSharedSampleRate {0.};
+};
+
 /** ISender is a utility class which can be used to defer data from the realtime audio processing and send it to the GUI for visualization */
 template <int MAXNC = 1, int QUEUE_SIZE = 64, typename T = float>
 class ISender
 {
 public:
   static constexpr int kUpdateMessage = 0;
+  static constexpr int kFrameMessage = 1;
+
+  /** Schedule the data with a clock, so that TransmitData() holds each element back until the audio it describes is estimated to be heard.
+   * Elements pushed without a samplePos are stamped with the clock's current block. Call this before processing starts
+   * @param pClock The clock that the audio thread updates, which must outlive the sender, or nullptr to send data as soon as it arrives */
+  void SetClock(const ISenderClock* pClock) { mClock = pClock; }
 
   /** Pushes a data element onto the queue. This can be called on the realtime audio thread. */
   void PushData(const ISenderData<MAXNC, T>& d)
   {
-    mQueue.Push(d);
+    if (mClock && d.samplePos < 0)
+    {
+      ISenderData<MAXNC, T> stamped = d;
+      stamped.samplePos = mClock->GetBlockStartPos();
+      mQueue.Push(stamped);
+    }
+    else
+      mQueue.Push(d);
   }
 
-  /** Pops elements off the queue and sends messages to controls.
+  /** Pops elements off the queue and sends messages to controls, as one batch with IEditorDelegate::SendControlMsgsFromDelegate().
+   * With a clock, elements are held until their presentation time, so call this at least at the display rate.
    *  This must be called on the main thread - typically in MyPlugin::OnIdle() */
   void TransmitData(IEditorDelegate& dlg)
   {
-    while(mQueue.ElementsAvailable())
+    if (mBatch.empty())
+    {
+      // on the main thread, and only once
+      mBatch.resize(QUEUE_SIZE);
+      mHeld.reserve(kMaxHeld);
+    }
+
+    int nItems;
+
+    while ((nItems = mQueue.PopBatch(mBatch.data(), QUEUE_SIZE)) > 0)
     {
-      ISenderData<MAXNC, T> d;
-      mQueue.Pop(d);
-      dlg.SendControlMsgFromDelegate(d.ctrlTag, kUpdateMessage, sizeof(ISenderData<MAXNC, T>), (void*) &d);
+      if (!mClock)
+      {
+        Send(dlg, mBatch.data(), nItems);
+        continue;
+      }
+
+      for (int i = 0; i < nItems; i++)
+      {
+        // at large buffers the data can get too far ahead of the sound to hold, and the oldest is shown early
+        if (mHeld.size() == kMaxHeld)
+          SendHeld(dlg, 1);
+
+        mHeld.push_back(mBatch[i]);
+      }
     }
+
+    if (mHeld.empty())
+      return;
+
+    const double now = ISenderClock::Now();
+    size_t nDue = 0;
+
+    while (nDue < mHeld.size() && (mHeld[nDue].samplePos < 0 || mClock->GetPresentationTime(mHeld[nDue].samplePos) <= now))
+      nDue++;
+
+    SendHeld(dlg, nDue);
   }
 
 private:
+  static constexpr size_t kMaxHeld = 2 * QUEUE_SIZE;
+
+  void Send(IEditorDelegate& dlg, const ISenderData<MAXNC, T>* pItems, int nItems)
+  {
+    for (int i = 0; i < nItems; i++)
+      mMsgs[i] = ControlMsg(pItems[i].ctrlTag, kUpdateMessage, sizeof(ISenderData<MAXNC, T>), &pItems[i]);
+
+    dlg.SendControlMsgsFromDelegate(mMsgs.data(), nItems);
+  }
+
+  void SendHeld(IEditorDelegate& dlg, size_t nItems)
+  {
+    for (size_t i = 0; i < nItems; i += QUEUE_SIZE)
+      Send(dlg, mHeld.data() + i, static_cast<int>(std::min<size_t>(QUEUE_SIZE, nItems - i)));
+
+    mHeld.erase(mHeld.begin(), mHeld.begin() + nItems);
+  }
+
   IPlugQueue<ISenderData<MAXNC, T>> mQueue {QUEUE_SIZE};
+  std::vector<ISenderData<MAXNC, T>> mBatch; // the elements popped by TransmitData(), which can be large so are not on the stack
+  std::vector<ISenderData<MAXNC, T>> mHeld; // elements waiting for their presentation time, oldest first
+  std::array<ControlMsg, QUEUE_SIZE> mMsgs;
+  const ISenderClock* mClock = nullptr;
+};
+
+/** ISenderFrameRing is a "latest wins" triple buffer of preallocated frames.
+ * A single producer (typically the realtime audio thread) writes a frame in place and publishes it,
+ * a single consumer (the main thread) picks up the most recently published frame by pointer.
+ * Nothing is copied between the threads and frames that were never read are simply overwritten. */
+template <typename T>
+class ISenderFrameRing
+{
+public:
+  ISenderFrameRing() = default;
+  ISenderFrameRing(const ISenderFrameRing&) = delete;
+  ISenderFrameRing& operator=(const ISenderFrameRing&) = delete;
+
+  /** @return A reference to the frame owned by the producer. Fill it in, then call Publish(). Producer thread only. */
+  T& GetWriteFrame() { return mFrames[mBack]; }
+
+  /** Make the write frame the latest frame, and take ownership of a free one for the next write. Producer thread only. */
+  void Publish()
+  {
+    const int prev = mMiddle.exchange(mBack | kNewFrameBit, std::memory_order_acq_rel);
+    mBack = prev & kIndexMask;
+  }
+
+  /** If a new frame has been published since the last call, take ownership of it.
+   * @return \c true if the read frame changed. Consumer thread only. */
+  bool Update()
+  {
+    if (!(mMiddle.load(std::memory_order_relaxed) & kNewFrameBit))
+      return false;
+
+    const int prev = mMiddle.exchange(mFront, std::memory_order_acq_rel);
+    mFront = prev & kIndexMask;
+    return true;
+  }
+
+  /** @return A pointer to the frame owned by the consumer, which remains valid and unchanged until the next call to Update(). Consumer thread only. */
+  const T* GetReadFrame() const { return &mFrames[mFront]; }
+
+private:
+  static constexpr int kIndexMask = 0x3;
+  static constexpr int kNewFrameBit = 0x4;
+
+  T mFrames[3];
+  int mBack = 0;
+  int mFront = 1;
+  std::atomic<int> mMiddle {2};
+};
+
+/** IFrameSender is an alternative to ISender for large data packets, where only the most recent packet matters.
+ * Data is written in place into an ISenderFrameRing on the realtime audio thread, and the GUI is sent a pointer to the latest frame,
+ * so nothing is copied across the thread boundary. Controls receive ISender<>::kFrameMessage with pData pointing at an ISenderData<MAXNC, T>,
+ * which stays valid until the next call to TransmitData(). A frame sender carries a single stream, so use one per control tag. */
+template <int MAXNC = 1, typename T = float>
+class IFrameSender
+{
+public:
+  static constexpr int kFrameMessage = ISender<>::kFrameMessage;
+
+  /** @return The frame to fill in on the realtime audio thread. Call EndFrame() to publish it, or leave it unpublished to discard it. */
+  ISenderData<MAXNC, T>& BeginFrame()
+  {
+    return mRing.GetWriteFrame();
+  }
+
+  /** Publish the frame returned by BeginFrame(). This can be called on the realtime audio thread. */
+  void EndFrame()
+  {
+    mRing.Publish();
+  }
+
+  /** Copies a data element into a frame and publishes it. This can be called on the realtime audio thread. */
+  void PushData(const ISenderData<MAXNC, T>& d)
+  {
+    BeginFrame() = d;
+    EndFrame();
+  }
+
+  /** If a new frame has been published, sends a pointer to it to its control.
+   *  This must be called on the main thread - typically in MyPlugin::OnIdle() */
+  void TransmitData(IEditorDelegate& dlg)
+  {
+    if (mRing.Update())
+    {
+      const ISenderData<MAXNC, T>* pFrame = mRing.GetReadFrame();
+      dlg.SendControlMsgFromDelegate(pFrame->ctrlTag, kFrameMessage, sizeof(ISenderData<MAXNC, T>), (const void*) pFrame);
+    }
+  }
+
+private:
+  ISenderFrameRing<ISenderData<MAXNC, T>> mRing;
 };
 
 /** IPeakSender is a utility class which can be used to defer peak data from sample buffers for sending to the GUI */
@@ -174,4 +402,173 @@ protected:
   float mThreshold = 0.01f;
 };
 
+/** ISenderEnvelope is a decimated representation of one channel of a waveform, as the minimum, maximum and RMS level of each point */
+template <int MAXPOINTS = 128>
+struct ISenderEnvelope
+{
+  std::array<float, MAXPOINTS> lo {0.};
+  std::array<float, MAXPOINTS> hi {0.};
+  std::array<float, MAXPOINTS> rms {0.};
+};
+
+/** IEnvelopeSender is a utility class which can be used to defer decimated waveform data for sending to the GUI.
+ * Rather than queuing raw sample buffers like IBufferSender, each window of samples is reduced to MAXPOINTS min/max/RMS points
+ * on the audio thread. Drawing the min/max band is visually exact, but the queue bandwidth doesn't grow with the sample rate. */
+template <int MAXNC = 1, int QUEUE_SIZE = 64, int MAXPOINTS = 128>
+class IEnvelopeSender : public ISender<MAXNC, QUEUE_SIZE, ISenderEnvelope<MAXPOINTS>>
+{
+public:
+  /** @param windowSize The number of samples covered by each envelope that is sent
+   * @param minThresholdDb Envelopes are not sent while the signal is below this level */
+  IEnvelopeSender(int windowSize = 4096, double minThresholdDb = -90.)
+  : ISender<MAXNC, QUEUE_SIZE, ISenderEnvelope<MAXPOINTS>>()
+  , mThreshold(static_cast<float>(DBToAmp(minThresholdDb)))
+  {
+    SetWindowSize(windowSize);
+    ResetPoint();
+  }
+
+  /** Set the number of samples covered by each envelope, e.g. as a function of the sample rate in OnReset(). This must not be called concurrently with ProcessBlock() */
+  void SetWindowSize(int windowSize)
+  {
+    mSamplesPerPoint = std::max(1, windowSize / MAXPOINTS);
+    mPointCount = 0;
+    mPoint = 0;
+    ResetPoint();
+  }
+
+  /** Reduce sample buffers into envelopes and queue them, checking the data is over the required threshold. This can be called on the realtime audio thread. */
+  void ProcessBlock(sample** inputs, int nFrames, int ctrlTag, int nChans = MAXNC, int chanOffset = 0)
+  {
+    int s = 0;
+
+    while (s < nFrames)
+    {
+      const int n = std::min(nFrames - s, mSamplesPerPoint - mPointCount);
+
+      for (auto c = chanOffset; c < (chanOffset + nChans); c++)
+      {
+        AccumulateMinMaxSumSq(inputs[c] + s, n, mMin[c], mMax[c], mSumSq[c]);
+      }
+
+      s += n;
+      mPointCount += n;
+
+      if (mPointCount < mSamplesPerPoint)
+        break;
+
+      for (auto c = chanOffset; c < (chanOffset + nChans); c++)
+      {
+        const float rms = static_cast<float>(std::sqrt(mSumSq[c] / (sample) mSamplesPerPoint));
+        mEnvelope.vals[c].lo[mPoint] = static_cast<float>(mMin[c]);
+        mEnvelope.vals[c].hi[mPoint] = static_cast<float>(mMax[c]);
+        mEnvelope.vals[c].rms[mPoint] = rms;
+        mRunningSum[c] += rms;
+      }
+
+      ResetPoint();
+      mPointCount = 0;
+
+      if (++mPoint == MAXPOINTS)
+      {
+        float sum = 0.f;
+        for (auto c = chanOffset; c < (chanOffset + nChans); c++)
+        {
+          sum += mRunningSum[c] / (float) MAXPOINTS;
+          mRunningSum[c] = 0.f;
+        }
+
+        if (sum > mThreshold || mPreviousSum > mThreshold)
+        {
+          mEnvelope.ctrlTag = ctrlTag;
+          mEnvelope.nChans = nChans;
+          mEnvelope.chanOffset = chanOffset;
+          ISender<MAXNC, QUEUE_SIZE, ISenderEnvelope<MAXPOINTS>>::PushData(mEnvelope);
+        }
+
+        mPreviousSum = sum;
+        mPoint = 0;
+      }
+    }
+  }
+
+protected:
+  void ResetPoint()
+  {
+    mMin.fill(std::numeric_limits<sample>::max());
+    mMax.fill(std::numeric_limits<sample>::lowest());
+    mSumSq.fill(0.);
+  }
+
+  ISenderData<MAXNC, ISenderEnvelope<MAXPOINTS>> mEnvelope;
+  int mSamplesPerPoint = 1;
+  int mPointCount = 0;
+  int mPoint = 0;
+  std::array<sample, MAXNC> mMin;
+  std::array<sample, MAXNC> mMax;
+  std::array<sample, MAXNC> mSumSq;
+  std::array<float, MAXNC> mRunningSum {0.};
+  float mPreviousSum = 1.f;
+  float mThreshold = 0.01f;
+};
+
+/** IBufferFrameSender is a version of IBufferSender that writes sample buffers in place into an IFrameSender ring,
+ * rather than copying each buffer through a queue. The GUI only sees the latest buffer. */
+template <int MAXNC = 1, int MAXBUF = 128>
+class IBufferFrameSender : public IFrameSender<MAXNC, std::array<float, MAXBUF>>
+{
+public:
+  using TBase = IFrameSender<MAXNC, std::array<float, MAXBUF>>;
+
+  IBufferFrameSender(double minThresholdDb = -90.)
+  : TBase()
+  , mThreshold(static_cast<float>(DBToAmp(minThresholdDb)))
+  {
+  }
+
+  /** Write sample buffers into the sender, checking the data is over the required threshold. This can be called on the realtime audio thread. */
+  void ProcessBlock(sample** inputs, int nFrames, int ctrlTag, int nChans = MAXNC, int chanOffset = 0)
+  {
+    for (auto s = 0; s < nFrames; s++)
+    {
+      if(mBufCount == MAXBUF)
+      {
+        float sum = 0.f;
+        for (auto c = chanOffset; c < (chanOffset + nChans); c++)
+        {
+          sum += mRunningSum[c];
+          mRunningSum[c] = 0.f;
+        }
+
+        if (sum > mThreshold || mPreviousSum > mThreshold)
+        {
+          ISenderData<MAXNC, std::array<float, MAXBUF>>& frame = TBase::BeginFrame();
+          frame.ctrlTag = ctrlTag;
+          frame.nChans = nChans;
+          frame.chanOffset = chanOffset;
+          TBase::EndFrame();
+        }
+
+        mPreviousSum = sum;
+        mBufCount = 0;
+      }
+
+      ISenderData<MAXNC, std::array<float, MAXBUF>>& frame = TBase::BeginFrame();
+
+      for (auto c = chanOffset; c < (chanOffset + nChans); c++)
+      {
+        frame.vals[c][mBufCount] = (float) inputs[c][s];
+        mRunningSum[c] += std::fabs( (float) inputs[c][s]);
+      }
+
+      mBufCount++;
+    }
+  }
+protected:
+  int mBufCount = 0;
+  std::array<float, MAXNC> mRunningSum {0.};
+  float mPreviousSum = 1.f;
+  float mThreshold = 0.01f;
+};
+
 END_IPLUG_NAMESPACE
@@ -0,0 +1,147 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc ISharedResource
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "IPlugPlatform.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** ISharedResource lets the audio thread use immutable data, such as a wavetable, an impulse response or a sample map, while other threads replace it.
+ * A loader or the UI thread publishes a new version with Publish(), and the audio thread picks up the latest one with Acquire() at the start of each block,
+ * which is an atomic load and store, and never locks, allocates or frees.
+ *
+ * Versions that have been replaced are kept until the audio thread has moved past them, and are freed by Reclaim(), which should be called
+ * regularly off the audio thread, typically in OnIdle(). Publish() reclaims too. The audio thread announces the version it is using, in the manner of a hazard pointer,
+ * so a version is only freed once Acquire() has returned a newer one, and never while a block is using it.
+ *
+ * A resource has one reader, the audio thread: the pointer returned by Acquire() stays valid until the next call to Acquire().
+ * Versions are held by std::shared_ptr, so data from SharedData can be published, and the last reference is only ever released off the audio thread. */
+template <class T>
+class ISharedResource
+{
+public:
+  using Ptr = std::shared_ptr<const T>;
+
+  ISharedResource() = default;
+
+  explicit ISharedResource(Ptr pInitial)
+  {
+    Publish(std::move(pInitial));
+  }
+
+  ISharedResource(const ISharedResource&) = delete;
+  ISharedResource& operator=(const ISharedResource&) = delete;
+
+  /** Make a new version the current one. Call this on any thread but the audio thread
+   * @param pVersion The new version, which must not be changed after this, or nullptr for no data */
+  void Publish(Ptr pVersion)
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    const T* pRaw = pVersion.get();
+    const bool known = std::any_of(mVersions.begin(), mVersions.end(), [pRaw](const Ptr& p) { return p.get() == pRaw; });
+
+    if (pVersion && !known)
+      mVersions.push_back(pVersion);
+
+    mCurrentPtr = std::move(pVersion);
+    mCurrent.store(pRaw, std::memory_order_seq_cst);
+
+    ReclaimLocked();
+  }
+
+  /** Construct a new version in place and make it the current one. Call this on any thread but the audio thread */
+  template <typename... Args>
+  void Emplace(Args&&... args)
+  {
+    Publish(std::make_shared<const T>(std::forward<Args>(args)...));
+  }
+
+  /** Get the latest version for this block. Call this on the audio thread, once at the start of each block. It does not lock or allocate
+   * @param pChanged Optionally set to \c true if the version is different from the one the previous call returned, e.g. to start a crossfade
+   * @return The current version, or nullptr if there is none. It stays valid until the next call to Acquire() */
+  const T* Acquire(bool* pChanged = nullptr)
+  {
+    const T* pVersion = mCurrent.load(std::memory_order_seq_cst);
+
+    // announce the version before using it, then check it is still current, so that Reclaim() either sees it in use or had already retired it before we looked
+    for (;;)
+    {
+      mInUse.store(pVersion, std::memory_order_seq_cst);
+      const T* pCheck = mCurrent.load(std::memory_order_seq_cst);
+
+      if (pCheck == pVersion)
+        break;
+
+      pVersion = pCheck;
+    }
+
+    if (pChanged)
+      *pChanged = pVersion != mLastAcquired;
+
+    mLastAcquired = pVersion;
+    return pVersion;
+  }
+
+  /** @return The current version, holding a reference. Call this on any thread but the audio thread */
+  Ptr GetCurrent() const
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mCurrentPtr;
+  }
+
+  /** Free the versions that have been replaced and that the audio thread is no longer using. Call this regularly on any thread but the audio thread, typically in OnIdle()
+   * @return The number of replaced versions that are still waiting for the audio thread */
+  int Reclaim()
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    return ReclaimLocked();
+  }
+
+private:
+  int ReclaimLocked()
+  {
+    const T* pCurrent = mCurrent.load(std::memory_order_seq_cst);
+    const T* pInUse = mInUse.load(std::memory_order_seq_cst);
+
+    // the versions are released here, under the lock, so they are never freed on the audio thread
+    mVersions.erase(std::remove_if(mVersions.begin(), mVersions.end(), [pCurrent, pInUse](const Ptr& p) {
+      return p.get() != pCurrent && p.get() != pInUse;
+    }), mVersions.end());
+
+    return static_cast<int>(mVersions.size()) - (pCurrent ? 1 : 0);
+  }
+
+  std::atomic<const T*> mCurrent {nullptr};
+  std::atomic<const T*> mInUse {nullptr}; // the version the audio thread is using, which Reclaim() must keep
+
+  // audio thread
+  const T* mLastAcquired = nullptr;
+
+  // publishing and reclaiming threads, guarded by mMutex
+  std::vector<Ptr> mVersions; // the current version and any replaced ones still waiting to be freed
+  Ptr mCurrentPtr;
+  mutable std::mutex mMutex;
+};
+
+END_IPLUG_NAMESPACE
@@ -0,0 +1,346 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+#pragma once
+
+/**
+ * @file
+ * @copydoc ITransportMap
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "IPlugPlatform.h"
+#include "IPlugConstants.h"
+#include "IPlugStructs.h"
+#include "IPlugUtilities.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** A change in the host transport at a sample offset within a block, see ITransportMap. Each event holds the whole transport state from its offset on */
+struct ITransportEvent
+{
+  enum EType
+  {
+    kTempo,     // the tempo, or the rate it ramps at, changed
+    kLoopJump,  // the position jumped, e.g. when the loop wrapped or the host relocated
+    kTimeSig    // the time signature changed
+  };
+
+  EType mType = kTempo;
+  int mOffset = 0;
+  double mPPQPos = 0.;
+  double mTempo = DEFAULT_TEMPO;
+  double mTempoIncrement = 0.; // the change in tempo per sample, for hosts that ramp the tempo within a block
+  int mNumerator = 4;
+  int mDenominator = 4;
+};
+
+/** ITransportMap describes how the host transport moves through a block, where ITimeInfo only gives its state at the start.
+ * IPlugProcessor builds one for every block, from the time info the API class passes to it (VST3 ProcessContext, AU host callbacks, CLAP transport...),
+ * and adds the tempo and time signature changes that hosts such as CLAP ones send within the block. Loop wraps are worked out from the loop range,
+ * and a position that doesn't follow on from the previous block is reported as a loop jump at offset 0.
+ *
+ * Offsets are relative to the start of the host's block, so when IPlugProcessor splits a block at scheduled events, pass GetSegmentStart() as the startIdx of the helpers.
+ * The positions only advance while the transport is running. Nothing here locks or allocates, so it can be used anywhere in ProcessBlock() */
+class ITransportMap
+{
+public:
+  static constexpr int kMaxEvents = 64;
+  /** A tempo ramp is split into pieces of this many samples by ForEachSegment(), each at its average tempo */
+  static constexpr int kRampSegmentSize = 32;
+  /** Positions more than this many beats away from where the transport was expected to be are treated as jumps */
+  static constexpr double kJumpTolerance = 1e-3;
+
+  /** Starts the map for a new block. Called by IPlugProcessor::SetTimeInfo()
+   * @param timeInfo The host transport at the start of the block
+   * @param sampleRate The sample rate
+   * @param tempoIncrement The change in tempo per sample, if the host ramps it */
+  void Begin(const ITimeInfo& timeInfo, double sampleRate, double tempoIncrement = 0.)
+  {
+    const bool wasRunning = mFinished && mRunning;
+    const double expectedPPQPos = mExpectedPPQPos;
+
+    mSampleRate = sampleRate > 0. ? sampleRate : DEFAULT_SAMPLE_RATE;
+    mValid = timeInfo.mPPQPos >= 0.;
+    mRunning = mValid && timeInfo.mTransportIsRunning;
+    mLoopEnabled = timeInfo.mTransportLoopEnabled && timeInfo.mCycleEnd > timeInfo.mCycleStart && timeInfo.mCycleStart >= 0.;
+    mCycleStart = timeInfo.mCycleStart;
+    mCycleEnd = timeInfo.mCycleEnd;
+    mNEvents = 0;
+    mFinished = false;
+
+    mStart.mType = ITransportEvent::kTempo;
+    mStart.mOffset = 0;
+    mStart.mPPQPos = mValid ? timeInfo.mPPQPos : 0.;
+    mStart.mTempo = timeInfo.mTempo > 0. ? timeInfo.mTempo : DEFAULT_TEMPO;
+    mStart.mTempoIncrement = tempoIncrement;
+    mStart.mNumerator = timeInfo.mNumerator;
+    mStart.mDenominator = timeInfo.mDenominator;
+
+    if (wasRunning && mRunning && std::abs(mStart.mPPQPos - expectedPPQPos) > kJumpTolerance)
+    {
+      ITransportEvent jump = mStart;
+      jump.mType = ITransportEvent::kLoopJump;
+      Insert(jump);
+    }
+  }
+
+  /** Adds the transport state the host reports at an offset within the block. Called by API classes that get transport changes within a block, after Begin()
+   * @param offset The sample offset in the block
+   * @param timeInfo The host transport from the offset on
+   * @param tempoIncrement The change in tempo per sample from the offset on */
+  void AddTransport(int offset, const ITimeInfo& timeInfo, double tempoIncrement = 0.)
+  {
+    const ITransportEvent& current = GetStateAt(offset);
+
+    ITransportEvent event;
+    event.mOffset = offset;
+    event.mPPQPos = timeInfo.mPPQPos >= 0. ? timeInfo.mPPQPos : PPQPosAt(current, offset);
+    event.mTempo = timeInfo.mTempo > 0. ? timeInfo.mTempo : current.mTempo;
+    event.mTempoIncrement = tempoIncrement;
+    event.mNumerator = timeInfo.mNumerator;
+    event.mDenominator = timeInfo.mDenominator;
+
+    if (mRunning && std::abs(event.mPPQPos - PPQPosAt(current, offset)) > kJumpTolerance)
+      event.mType = ITransportEvent::kLoopJump;
+    else if (event.mTempo != TempoAt(current, offset) || event.mTempoIncrement != current.mTempoIncrement)
+      event.mType = ITransportEvent::kTempo;
+    else if (event.mNumerator != current.mNumerator || event.mDenominator != current.mDenominator)
+      event.mType = ITransportEvent::kTimeSig;
+    else
+      return;
+
+    Insert(event);
+  }
+
+  /** Adds the loop wraps in the block and remembers where the next block should start. Called by IPlugProcessor before ProcessBlock()
+   * @param nFrames The number of samples in the block */
+  void Finish(int nFrames)
+  {
+    if (mRunning && mLoopEnabled)
+    {
+      // a loop shorter than a sample would never end, so the wraps are limited to the space left
+      for (auto i = -1; i < mNEvents && mNEvents < kMaxEvents; i++)
+      {
+        const ITransportEvent& state = i < 0 ? mStart : mEvents[i];
+        const int end = i + 1 < mNEvents ? mEvents[i + 1].mOffset : nFrames;
+        const int wrap = FindLoopEnd(state, end);
+
+        if (wrap < end)
+        {
+          ITransportEvent jump = state;
+          jump.mType = ITransportEvent::kLoopJump;
+          jump.mOffset = wrap;
+          jump.mPPQPos = mCycleStart + (PPQPosAt(state, wrap) - mCycleEnd);
+          jump.mTempo = TempoAt(state, wrap);
+          Insert(jump);
+        }
+      }
+    }
+
+    mExpectedPPQPos = PPQPosAt(GetStateAt(nFrames), nFrames);
+    mFinished = true;
+  }
+
+  /** @return \c true if the host gave a musical position for this block */
+  bool IsValid() const { return mValid; }
+
+  /** @return \c true if the transport is running */
+  bool GetTransportIsRunning() const { return mRunning; }
+
+  /** @return The number of transport changes within the block */
+  int NEvents() const { return mNEvents; }
+
+  /** @return A transport change within the block, in order of offset */
+  const ITransportEvent& GetEvent(int idx) const { return mEvents[idx]; }
+
+  /** @return The transport state that applies at an offset, which is the last event at or before it, or the state at the start of the block */
+  const ITransportEvent& GetStateAt(int offset) const
+  {
+    for (auto i = mNEvents - 1; i >= 0; i--)
+    {
+      if (mEvents[i].mOffset <= offset)
+        return mEvents[i];
+    }
+
+    return mStart;
+  }
+
+  /** @return The position in beats (quarter notes) at an offset in the block */
+  double GetPPQPosAt(int offset) const { return PPQPosAt(GetStateAt(offset), offset); }
+
+  /** @return The tempo in beats per minute at an offset in the block */
+  double GetTempoAt(int offset) const { return TempoAt(GetStateAt(offset), offset); }
+
+  /** @return The number of samples in a beat at an offset in the block, e.g. for tempo synced delay times */
+  double GetSamplesPerBeatAt(int offset) const { return mSampleRate * 60. / GetTempoAt(offset); }
+
+  /** Calls a function for each stretch of the block in which the tempo is constant and the position doesn't jump, so that code that takes one position and tempo,
+   * such as LFO::ProcessBlock(), follows the transport exactly. A tempo ramp is split into pieces of kRampSegmentSize samples
+   * @param startIdx The offset in the block of the first sample, e.g. GetSegmentStart()
+   * @param nFrames The number of samples
+   * @param func Called as func(int idx, int nSamples, double ppqPos, double tempo), with idx relative to startIdx */
+  template <typename F>
+  void ForEachSegment(int startIdx, int nFrames, F&& func) const
+  {
+    const int endIdx = startIdx + nFrames;
+    int s = startIdx;
+
+    while (s < endIdx)
+    {
+      const ITransportEvent& state = GetStateAt(s);
+      int end = std::min(NextEventOffset(s), endIdx);
+
+      if (state.mTempoIncrement != 0.)
+        end = std::min(end, s + kRampSegmentSize);
+
+      const int n = end - s;
+      // the average tempo over the piece, which is the tempo at its middle
+      const double tempo = TempoAt(state, s) + state.mTempoIncrement * (n - 1) * 0.5;
+      func(s - startIdx, n, PPQPosAt(state, s), tempo);
+      s = end;
+    }
+  }
+
+  /** Writes the position in beats of every sample
+   * @param pDest The output buffer of nFrames samples
+   * @param startIdx The offset in the block of the first sample, e.g. GetSegmentStart()
+   * @param nFrames The number of samples */
+  void GetPPQPositions(double* pDest, int startIdx, int nFrames) const
+  {
+    const int endIdx = startIdx + nFrames;
+
+    for (auto s = startIdx; s < endIdx;)
+    {
+      const ITransportEvent& state = GetStateAt(s);
+      const int end = std::min(NextEventOffset(s), endIdx);
+
+      if (!mRunning)
+      {
+        std::fill(pDest + (s - startIdx), pDest + (end - startIdx), state.mPPQPos);
+        s = end;
+        continue;
+      }
+
+      double pos = PPQPosAt(state, s);
+      double inc = TempoAt(state, s) / (60. * mSampleRate);
+      const double incInc = state.mTempoIncrement / (60. * mSampleRate);
+
+      for (; s < end; s++)
+      {
+        pDest[s - startIdx] = pos;
+        pos += inc;
+        inc += incInc;
+      }
+    }
+  }
+
+  /** Writes the phase, from 0 to 1, of a tempo synced cycle at every sample, e.g. for an LFO or a tempo synced delay modulation
+   * @param pDest The output buffer of nFrames samples
+   * @param startIdx The offset in the block of the first sample, e.g. GetSegmentStart()
+   * @param nFrames The number of samples
+   * @param cyclesPerBeat The rate of the cycle, e.g. 0.25 for a bar of 4/4 or 2 for eighth notes */
+  void GetPhases(double* pDest, int startIdx, int nFrames, double cyclesPerBeat) const
+  {
+    GetPPQPositions(pDest, startIdx, nFrames);
+
+    for (auto s = 0; s < nFrames; s++)
+    {
+      const double phase = pDest[s] * cyclesPerBeat;
+      pDest[s] = phase - std::floor(phase);
+    }
+  }
+
+private:
+  double PPQPosAt(const ITransportEvent& state, int offset) const
+  {
+    if (!mRunning)
+      return state.mPPQPos;
+
+    const double n = offset - state.mOffset;
+    return state.mPPQPos + (n * state.mTempo + state.mTempoIncrement * n * (n - 1.) * 0.5) / (60. * mSampleRate);
+  }
+
+  double TempoAt(const ITransportEvent& state, int offset) const
+  {
+    return std::max(state.mTempo + state.mTempoIncrement * (offset - state.mOffset), 1.);
+  }
+
+  int NextEventOffset(int offset) const
+  {
+    for (auto i = 0; i < mNEvents; i++)
+    {
+      if (mEvents[i].mOffset > offset)
+        return mEvents[i].mOffset;
+    }
+
+    return std::numeric_limits<int>::max();
+  }
+
+  /** @return The first offset before end at which the position reaches the loop end, or end if it doesn't */
+  int FindLoopEnd(const ITransportEvent& state, int end) const
+  {
+    if (state.mPPQPos >= mCycleEnd || PPQPosAt(state, end) < mCycleEnd)
+      return end;
+
+    // estimate from the tempo at the start of the stretch, then correct for any ramp
+    int offset = state.mOffset + static_cast<int>(std::ceil((mCycleEnd - state.mPPQPos) * 60. * mSampleRate / state.mTempo));
+    offset = Clip(offset, state.mOffset, end);
+
+    while (offset > state.mOffset && PPQPosAt(state, offset - 1) >= mCycleEnd)
+      offset--;
+
+    while (offset < end && PPQPosAt(state, offset) < mCycleEnd)
+      offset++;
+
+    return offset;
+  }
+
+  void Insert(const ITransportEvent& event)
+  {
+    if (mNEvents >= kMaxEvents)
+      return;
+
+    int i = mNEvents;
+
+    // events at the same offset replace each other, as each holds the whole state
+    while (i > 0 && mEvents[i - 1].mOffset > event.mOffset)
+      i--;
+
+    if (i > 0 && mEvents[i - 1].mOffset == event.mOffset)
+    {
+      const ITransportEvent::EType type = mEvents[i - 1].mType == ITransportEvent::kLoopJump ? ITransportEvent::kLoopJump : event.mType;
+      mEvents[i - 1] = event;
+      mEvents[i - 1].mType = type;
+      return;
+    }
+
+    std::copy_backward(mEvents + i, mEvents + mNEvents, mEvents + mNEvents + 1);
+    mEvents[i] = event;
+    mNEvents++;
+  }
+
+  ITransportEvent mStart;
+  ITransportEvent mEvents[kMaxEvents];
+  int mNEvents = 0;
+  double mSampleRate = DEFAULT_SAMPLE_RATE;
+  double mCycleStart = 0.;
+  double mCycleEnd = 0.;
+  double mExpectedPPQPos = 0.;
+  bool mValid = false;
+  bool mRunning = false;
+  bool mLoopEnabled = false;
+  bool mFinished = false;
+};
+
+END_IPLUG_NAMESPACE
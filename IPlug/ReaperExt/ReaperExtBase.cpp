@@ -8,13 +8,124 @@ ReaperExtBase::ReaperExtBase(reaper_plugin_info_t* pRec)
 ReaperExtBase::~ReaperExtBase()
 {
   mTimer->Stop();
+
+  // the tasks capture this, so they must be finished before it goes
+  for (auto& pTask : mTasks)
+    pTask->Cancel();
+
+  for (auto& pTask : mTasks)
+    pTask->Wait();
 }
 
 void ReaperExtBase::OnTimer(Timer& t)
 {
+  mTimerTick++;
+
+  {
+    std::lock_guard<std::mutex> lock(mMainThreadFuncsMutex);
+    mMainThreadFuncsToRun.swap(mMainThreadFuncs);
+  }
+
+  for (auto& func : mMainThreadFuncsToRun)
+    func();
+
+  mMainThreadFuncsToRun.clear();
+  mTasks.erase(std::remove_if(mTasks.begin(), mTasks.end(), [](const TaskScheduler::TaskPtr& pTask) { return pTask->IsDone(); }), mTasks.end());
+
   OnIdle();
 }
 
+TaskScheduler::TaskPtr ReaperExtBase::RunInBackground(std::function<void()> work, std::function<void()> onDone)
+{
+  TaskScheduler::TaskPtr pTask = mScheduler->Submit(TaskScheduler::kPriorityBackground, [this, work, onDone](const TaskScheduler::Task& task) {
+    work();
+
+    if (onDone && !task.IsCancelled())
+      RunOnMainThread(onDone);
+  });
+
+  mTasks.push_back(pTask);
+  return pTask;
+}
+
+void ReaperExtBase::RunOnMainThread(std::function<void()> func)
+{
+  std::lock_guard<std::mutex> lock(mMainThreadFuncsMutex);
+  mMainThreadFuncs.push_back(std::move(func));
+}
+
+std::shared_ptr<const ReaperProjectSnapshot> ReaperExtBase::GetProjectSnapshot(bool includeItems)
+{
+  ReaProject* pProject = EnumProjects ? EnumProjects(-1, nullptr, 0) : nullptr;
+  const int changeCount = GetProjectStateChangeCount ? GetProjectStateChangeCount(pProject) : -1;
+
+  if (mSnapshot && (mSnapshot->mHasItems || !includeItems))
+  {
+    if (mSnapshotTick == mTimerTick)
+      return mSnapshot;
+
+    // without a change count, a snapshot only lasts for one tick
+    if (changeCount >= 0 && mSnapshot->mProject == pProject && mSnapshot->mStateChangeCount == changeCount)
+    {
+      mSnapshotTick = mTimerTick;
+      return mSnapshot;
+    }
+  }
+
+  auto pSnapshot = std::make_shared<ReaperProjectSnapshot>();
+  pSnapshot->mProject = pProject;
+  pSnapshot->mStateChangeCount = changeCount;
+  pSnapshot->mHasItems = includeItems;
+
+  const int nTracks = CountTracks(pProject);
+  pSnapshot->mTracks.resize(nTracks);
+  char name[256];
+
+  for (int t = 0; t < nTracks; t++)
+  {
+    ReaperProjectSnapshot::Track& track = pSnapshot->mTracks[t];
+    track.mTrack = GetTrack(pProject, t);
+
+    if (!track.mTrack)
+      continue;
+
+    if (GetTrackName && GetTrackName(track.mTrack, name, sizeof(name)))
+      track.mName.Set(name);
+
+    if (GetMediaTrackInfo_Value)
+    {
+      track.mSelected = GetMediaTrackInfo_Value(track.mTrack, "I_SELECTED") != 0.;
+      track.mMuted = GetMediaTrackInfo_Value(track.mTrack, "B_MUTE") != 0.;
+    }
+
+    if (!includeItems || !CountTrackMediaItems || !GetTrackMediaItem)
+      continue;
+
+    track.mFirstItemIdx = static_cast<int>(pSnapshot->mItems.size());
+    track.mNItems = CountTrackMediaItems(track.mTrack);
+
+    for (int i = 0; i < track.mNItems; i++)
+    {
+      ReaperProjectSnapshot::Item item;
+      item.mItem = GetTrackMediaItem(track.mTrack, i);
+      item.mTrackIdx = t;
+
+      if (item.mItem && GetMediaItemInfo_Value)
+      {
+        item.mPosition = GetMediaItemInfo_Value(item.mItem, "D_POSITION");
+        item.mLength = GetMediaItemInfo_Value(item.mItem, "D_LENGTH");
+        item.mSelected = GetMediaItemInfo_Value(item.mItem, "B_UISEL") != 0.;
+      }
+
+      pSnapshot->mItems.push_back(item);
+    }
+  }
+
+  mSnapshot = pSnapshot;
+  mSnapshotTick = mTimerTick;
+  return mSnapshot;
+}
+
 auto ClientResize = [](HWND hWnd, int nWidth, int nHeight) {
   RECT rcClient, rcWindow;
   POINT ptDiff;
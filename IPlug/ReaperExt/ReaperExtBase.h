@@ -16,13 +16,54 @@
  * Include this file in the main header for your reaper extension
 */
 
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "wdlstring.h"
+
 #include "IPlugTimer.h"
+#include "IPlugTaskScheduler.h"
 #include "IPlugDelegate_select.h"
 
 struct reaper_plugin_info_t;
+class ReaProject;
+class MediaTrack;
+class MediaItem;
 
 BEGIN_IPLUG_NAMESPACE
 
+/** A copy of the state of a REAPER project, made on the main thread by ReaperExtBase::GetProjectSnapshot(). It is plain data, so it can be handed to RunInBackground() work,
+ * but the track and item pointers must only be passed back to the REAPER API on the main thread, and only while they still exist */
+struct ReaperProjectSnapshot
+{
+  struct Track
+  {
+    MediaTrack* mTrack = nullptr;
+    WDL_String mName;
+    int mFirstItemIdx = 0; // into mItems
+    int mNItems = 0;
+    bool mSelected = false;
+    bool mMuted = false;
+  };
+
+  struct Item
+  {
+    MediaItem* mItem = nullptr;
+    int mTrackIdx = 0;
+    double mPosition = 0.; // seconds
+    double mLength = 0.;
+    bool mSelected = false;
+  };
+
+  ReaProject* mProject = nullptr;
+  int mStateChangeCount = -1; // GetProjectStateChangeCount() when the snapshot was made
+  bool mHasItems = false; // false if it was made without items
+  std::vector<Track> mTracks;
+  std::vector<Item> mItems;
+};
+
 /** Reaper extension base class interface */
 class ReaperExtBase : public EDITOR_DELEGATE_CLASS
 {
@@ -51,6 +92,37 @@ public:
   
   void ToggleDocking();
 
+  /** Run heavy work, such as analysing a large project, on a worker thread of the process wide TaskScheduler, so that REAPER's UI doesn't freeze.
+   * Most of the REAPER API may only be called on the main thread, so the work must not use it: take what it needs from GetProjectSnapshot() before, and apply the results in onDone
+   * @param work Called on a worker thread
+   * @param onDone Called with the work's result on the main thread, from the extension's timer before OnIdle(). Not called if the work was cancelled */
+  template <typename T>
+  TaskScheduler::TaskPtr RunInBackground(std::function<T()> work, std::function<void(T&)> onDone)
+  {
+    auto pResult = std::make_shared<T>();
+    return RunInBackground([work, pResult]() { *pResult = work(); }, [onDone, pResult]() { onDone(*pResult); });
+  }
+
+  /** As RunInBackground(), for work without a result
+   * @param work Called on a worker thread
+   * @param onDone If not nullptr, called on the main thread once the work is done
+   * @return The task, which can be cancelled. Tasks that are still running when the extension is destroyed are cancelled and waited for */
+  TaskScheduler::TaskPtr RunInBackground(std::function<void()> work, std::function<void()> onDone = nullptr);
+
+  /** Call a function on the main thread, from the extension's timer. Can be called from any thread
+   * @param func The function */
+  void RunOnMainThread(std::function<void()> func);
+
+  /** Get the tracks (and items) of the current project in one pass, rather than calling the REAPER API per track and item.
+   * The snapshot is reused for the rest of the timer tick, and in later ticks for as long as GetProjectStateChangeCount() says the project hasn't changed,
+   * so it can be called freely from OnIdle() and actions. Call this on the main thread only
+   * @param includeItems If \c true the media items are included as well as the tracks
+   * @return The snapshot, which stays valid for as long as it is held, so it can be passed to RunInBackground() */
+  std::shared_ptr<const ReaperProjectSnapshot> GetProjectSnapshot(bool includeItems = true);
+
+  /** Make the next GetProjectSnapshot() read the project again, e.g. after the extension has changed something that doesn't count as a state change */
+  void InvalidateProjectSnapshot() { mSnapshot = nullptr; }
+
 public:
   // Reaper calls back to this when it wants to execute an action registered by the extension plugin
   static bool HookCommandProc(int command, int flag);
@@ -66,6 +138,16 @@ private:
   reaper_plugin_info_t* mRec = nullptr;
   std::unique_ptr<Timer> mTimer;
   bool mDocked = false;
+
+  TaskScheduler::Ptr mScheduler = TaskScheduler::Get();
+  std::vector<TaskScheduler::TaskPtr> mTasks; // running background work, main thread only
+  std::mutex mMainThreadFuncsMutex;
+  std::vector<std::function<void()>> mMainThreadFuncs; // guarded by mMainThreadFuncsMutex
+  std::vector<std::function<void()>> mMainThreadFuncsToRun;
+
+  std::shared_ptr<const ReaperProjectSnapshot> mSnapshot;
+  uint64_t mTimerTick = 0;
+  uint64_t mSnapshotTick = ~uint64_t(0);
 };
 
 END_IPLUG_NAMESPACE
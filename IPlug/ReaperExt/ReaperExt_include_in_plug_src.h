@@ -35,6 +35,8 @@ std::vector<ReaperAction> gActions;
 
 // super nasty looking macro here but allows importing functions from Reaper with simple looking code
 #define IMPAPI(x) if (!((*((void **)&(x)) = (void*) pRec->GetFunc(#x)))) gErrorCount++;
+// for functions that the extension can do without, e.g. those used by ReaperExtBase::GetProjectSnapshot(), which are missing in older versions of Reaper
+#define IMPAPI_OPTIONAL(x) *((void **)&(x)) = (void*) pRec->GetFunc(#x);
 
 #pragma mark - ENTRY POINT
 extern "C"
@@ -58,6 +60,15 @@ extern "C"
       IMPAPI(ShowConsoleMsg);
       IMPAPI(DockWindowAdd);
       IMPAPI(DockWindowActivate);
+      IMPAPI(CountTracks);
+      IMPAPI(GetTrack);
+      IMPAPI_OPTIONAL(EnumProjects);
+      IMPAPI_OPTIONAL(GetProjectStateChangeCount);
+      IMPAPI_OPTIONAL(GetTrackName);
+      IMPAPI_OPTIONAL(GetMediaTrackInfo_Value);
+      IMPAPI_OPTIONAL(CountTrackMediaItems);
+      IMPAPI_OPTIONAL(GetTrackMediaItem);
+      IMPAPI_OPTIONAL(GetMediaItemInfo_Value);
       
       if (gErrorCount > 0)
         return 0;
@@ -247,7 +247,7 @@ bool IPlugVST2::SendMidiMsg(const IMidiMsg& msg)
 
   midiEvent.type = kVstMidiType;
   midiEvent.byteSize = sizeof(VstMidiEvent);  // Should this be smaller?
-  midiEvent.deltaFrames = msg.mOffset;
+  midiEvent.deltaFrames = msg.mOffset + GetSegmentStart();
   midiEvent.midiData[0] = msg.mStatus;
   midiEvent.midiData[1] = msg.mData1;
   midiEvent.midiData[2] = msg.mData2;
@@ -262,7 +262,7 @@ bool IPlugVST2::SendSysEx(const ISysEx& msg)
 
   sysexEvent.type = kVstSysExType;
   sysexEvent.byteSize = sizeof(VstMidiSysexEvent);
-  sysexEvent.deltaFrames = msg.mOffset;
+  sysexEvent.deltaFrames = msg.mOffset + GetSegmentStart();
   sysexEvent.dumpBytes = msg.mSize;
   sysexEvent.sysexDump = (char*) msg.mData;
 
@@ -427,24 +427,28 @@ VstIntPtr VSTCALLBACK IPlugVST2::VSTDispatcher(AEffect *pEffect, VstInt32 opCode
     case effSetSampleRate:
     {
       _this->SetSampleRate(opt);
-      _this->OnReset();
+      _this->EnsureDeferredInit();
+      _this->ResetFromAPI();
       return 0;
     }
     case effSetBlockSize:
     {
       _this->SetBlockSize((int) value);
-      _this->OnReset();
+      _this->EnsureDeferredInit();
+      _this->ResetFromAPI();
       return 0;
     }
     case effMainsChanged:
     {
       if (!value)
       {
+        _this->EnsureDeferredInit();
         _this->OnActivate(false);
-        _this->OnReset();
+        _this->ResetFromAPI();
       }
       else
       {
+        _this->EnsureDeferredInit();
         _this->OnActivate(true);
       }
       return 0;
@@ -496,17 +500,26 @@ VstIntPtr VSTCALLBACK IPlugVST2::VSTDispatcher(AEffect *pEffect, VstInt32 opCode
       {
         bool isBank = (!idx);
         IByteChunk& chunk = (isBank ? _this->mBankState : _this->mState);
-        IByteChunk::InitChunkWithIPlugVer(chunk);
         bool savedOK = true;
 
         if (isBank)
         {
+          IByteChunk::InitChunkWithIPlugVer(chunk);
           _this->ModifyCurrentPreset();
           savedOK = static_cast<IPluginBase*>(_this)->SerializePresets(chunk);
         }
         else
         {
-          savedOK = _this->SerializeState(chunk);
+          bool changed = true;
+          const IByteChunk* pState = _this->GetStateSnapshot(&changed);
+          savedOK = pState != nullptr;
+
+          // mState still holds the last chunk that was handed to the host if nothing has changed
+          if (savedOK && (changed || !chunk.Size()))
+          {
+            IByteChunk::InitChunkWithIPlugVer(chunk);
+            chunk.PutChunk(pState);
+          }
         }
 
         if (savedOK && chunk.Size())
@@ -535,7 +548,7 @@ VstIntPtr VSTCALLBACK IPlugVST2::VSTDispatcher(AEffect *pEffect, VstInt32 opCode
         }
         else
         {
-          pos = _this->UnserializeState(chunk, pos);
+          pos = _this->UnserializeStateSnapshot(chunk, pos);
           _this->ModifyCurrentPreset();
         }
 
@@ -561,7 +574,7 @@ VstIntPtr VSTCALLBACK IPlugVST2::VSTDispatcher(AEffect *pEffect, VstInt32 opCode
             {
               VstMidiEvent* pME = (VstMidiEvent*) pEvent;
               IMidiMsg msg(pME->deltaFrames, pME->midiData[0], pME->midiData[1], pME->midiData[2]);
-              _this->ProcessMidiMsg(msg);
+              _this->ScheduleMidiMsg(msg);
               _this->mMidiMsgsFromProcessor.Push(msg);
 
               //#ifdef TRACER_BUILD
@@ -572,7 +585,7 @@ VstIntPtr VSTCALLBACK IPlugVST2::VSTDispatcher(AEffect *pEffect, VstInt32 opCode
             {
               VstMidiSysexEvent* pSE = (VstMidiSysexEvent*) pEvent;
               ISysEx sysex(pSE->deltaFrames, (const uint8_t*)pSE->sysexDump, pSE->dumpBytes);
-              _this->ProcessSysEx(sysex);
+              _this->ScheduleSysEx(sysex);
             }
           }
         }
@@ -969,7 +982,7 @@ void IPlugVST2::VSTPreProcess(SAMPLETYPE** inputs, SAMPLETYPE** outputs, VstInt3
 
   while (mMidiMsgsFromEditor.Pop(msg))
   {
-    ProcessMidiMsg(msg);
+    ScheduleMidiMsg(msg);
   }
 }
 
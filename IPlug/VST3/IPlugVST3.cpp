@@ -76,6 +76,9 @@ tresult PLUGIN_API IPlugVST3::setActive(TBool state)
 {
   TRACE
 
+  if (state)
+    EnsureDeferredInit();
+
   OnActivate((bool) state);
   return SingleComponentEffect::setActive(state);
 }
@@ -48,6 +48,9 @@ class IPlugVST3 : public IPlugAPIBase
                 , public Steinberg::Vst::SingleComponentEffect
                 , public Steinberg::Vst::IMidiMapping
                 , public Steinberg::Vst::ChannelContext::IInfoListener
+#if VST3_NOTE_EXPRESSIONS
+                , public Steinberg::Vst::INoteExpressionController
+#endif
 {
 public:
   using ViewType = IPlugVST3View<IPlugVST3>;
@@ -111,6 +114,29 @@ public:
     return GetProgramListInfo(this, listIndex, info);
   }
   
+#if VST3_NOTE_EXPRESSIONS
+  // INoteExpressionController
+  Steinberg::int32 PLUGIN_API getNoteExpressionCount(Steinberg::int32 busIndex, Steinberg::int16 channel) override
+  {
+    return GetNoteExpressionCount(busIndex, channel);
+  }
+  
+  Steinberg::tresult PLUGIN_API getNoteExpressionInfo(Steinberg::int32 busIndex, Steinberg::int16 channel, Steinberg::int32 noteExpressionIndex, Steinberg::Vst::NoteExpressionTypeInfo& info) override
+  {
+    return GetNoteExpressionInfo(busIndex, channel, noteExpressionIndex, info);
+  }
+  
+  Steinberg::tresult PLUGIN_API getNoteExpressionStringByValue(Steinberg::int32 busIndex, Steinberg::int16 channel, Steinberg::Vst::NoteExpressionTypeID id, Steinberg::Vst::NoteExpressionValue valueNormalized, Steinberg::Vst::String128 string) override
+  {
+    return GetNoteExpressionStringByValue(id, valueNormalized, string);
+  }
+  
+  Steinberg::tresult PLUGIN_API getNoteExpressionValueByString(Steinberg::int32 busIndex, Steinberg::int16 channel, Steinberg::Vst::NoteExpressionTypeID id, const Steinberg::Vst::TChar* string, Steinberg::Vst::NoteExpressionValue& valueNormalized) override
+  {
+    return GetNoteExpressionValueByString(id, string, valueNormalized);
+  }
+#endif
+  
   // IInfoListener
   Steinberg::tresult PLUGIN_API setChannelContextInfos(Steinberg::Vst::IAttributeList* list) override;
 
@@ -163,6 +189,9 @@ public:
   DEFINE_INTERFACES
     DEF_INTERFACE(IMidiMapping)
     DEF_INTERFACE(IInfoListener)
+#if VST3_NOTE_EXPRESSIONS
+    DEF_INTERFACE(INoteExpressionController)
+#endif
   END_DEFINE_INTERFACES(SingleComponentEffect)
   REFCOUNT_METHODS(SingleComponentEffect)
 
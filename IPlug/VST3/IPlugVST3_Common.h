@@ -24,18 +24,17 @@ struct IPlugVST3State
   template <class T>
   static bool GetState(T* pPlug, Steinberg::IBStream* pState)
   {
-    IByteChunk chunk;
-    
     // TODO: IPlugVer should be in chunk!
     //  IByteChunk::GetIPlugVerFromChunk(chunk)
+    const IByteChunk* pChunk = pPlug->GetStateSnapshot();
     
-    if (pPlug->SerializeState(chunk))
+    if (pChunk)
     {
       /*
        int chunkSize = chunk.Size();
        void* data = (void*) &chunkSize;
        state->write(data, (Steinberg::int32) sizeof(int));*/
-      pState->write(chunk.GetData(), chunk.Size());
+      pState->write(const_cast<uint8_t*>(pChunk->GetData()), pChunk->Size());
     }
     else
       return false;
@@ -66,7 +65,7 @@ struct IPlugVST3State
       
       chunk.PutBytes(buffer, bytesRead);
     }
-    int pos = pPlug->UnserializeState(chunk,0);
+    int pos = pPlug->UnserializeStateSnapshot(chunk,0);
     
     Steinberg::int32 savedBypass = 0;
     
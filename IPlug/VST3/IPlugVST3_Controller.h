@@ -34,6 +34,9 @@ BEGIN_IPLUG_NAMESPACE
 class IPlugVST3Controller : public Steinberg::Vst::EditControllerEx1
                           , public Steinberg::Vst::IMidiMapping
                           , public Steinberg::Vst::ChannelContext::IInfoListener
+#if VST3_NOTE_EXPRESSIONS
+                          , public Steinberg::Vst::INoteExpressionController
+#endif
                           , public IPlugAPIBase
                           , public IPlugVST3ControllerBase
 {
@@ -79,6 +82,29 @@ public:
     return GetProgramListInfo(this, listIndex, info);
   }
   
+#if VST3_NOTE_EXPRESSIONS
+  // INoteExpressionController
+  Steinberg::int32 PLUGIN_API getNoteExpressionCount(Steinberg::int32 busIndex, Steinberg::int16 channel) override
+  {
+    return GetNoteExpressionCount(busIndex, channel);
+  }
+  
+  Steinberg::tresult PLUGIN_API getNoteExpressionInfo(Steinberg::int32 busIndex, Steinberg::int16 channel, Steinberg::int32 noteExpressionIndex, Steinberg::Vst::NoteExpressionTypeInfo& info) override
+  {
+    return GetNoteExpressionInfo(busIndex, channel, noteExpressionIndex, info);
+  }
+  
+  Steinberg::tresult PLUGIN_API getNoteExpressionStringByValue(Steinberg::int32 busIndex, Steinberg::int16 channel, Steinberg::Vst::NoteExpressionTypeID id, Steinberg::Vst::NoteExpressionValue valueNormalized, Steinberg::Vst::String128 string) override
+  {
+    return GetNoteExpressionStringByValue(id, valueNormalized, string);
+  }
+  
+  Steinberg::tresult PLUGIN_API getNoteExpressionValueByString(Steinberg::int32 busIndex, Steinberg::int16 channel, Steinberg::Vst::NoteExpressionTypeID id, const Steinberg::Vst::TChar* string, Steinberg::Vst::NoteExpressionValue& valueNormalized) override
+  {
+    return GetNoteExpressionValueByString(id, string, valueNormalized);
+  }
+#endif
+  
   // IInfoListener
   Steinberg::tresult PLUGIN_API setChannelContextInfos(Steinberg::Vst::IAttributeList* list) override;
 
@@ -102,6 +128,9 @@ public:
   DEFINE_INTERFACES
     DEF_INTERFACE(IMidiMapping)
     DEF_INTERFACE(IInfoListener)
+#if VST3_NOTE_EXPRESSIONS
+    DEF_INTERFACE(INoteExpressionController)
+#endif
   END_DEFINE_INTERFACES(EditControllerEx1)
   REFCOUNT_METHODS(EditControllerEx1)
   
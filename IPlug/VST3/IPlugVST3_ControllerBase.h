@@ -13,6 +13,7 @@
 #include "pluginterfaces/base/ibstream.h"
 #include "public.sdk/source/vst/vsteditcontroller.h"
 #include "pluginterfaces/vst/ivstchannelcontextinfo.h"
+#include "pluginterfaces/vst/ivstnoteexpression.h"
 
 #include "IPlugAPIBase.h"
 #include "IPlugVST3_Parameter.h"
@@ -191,6 +192,80 @@ public:
     return Steinberg::kResultFalse;
   }
   
+#if VST3_NOTE_EXPRESSIONS
+  // The standard note expression types, which IPlugVST3ProcessorBase passes to IPlugProcessor::ProcessMidi2Msg() as per-note messages
+  static constexpr int kNumNoteExpressions = 6;
+  static constexpr double kNoteExpressionTuningRange = 240.; // semitones, tuning is -120 to +120
+  
+  Steinberg::int32 PLUGIN_API GetNoteExpressionCount(Steinberg::int32 busIndex, Steinberg::int16 channel)
+  {
+    return busIndex == 0 ? kNumNoteExpressions : 0;
+  }
+  
+  Steinberg::tresult PLUGIN_API GetNoteExpressionInfo(Steinberg::int32 busIndex, Steinberg::int16 channel, Steinberg::int32 noteExpressionIndex, Steinberg::Vst::NoteExpressionTypeInfo& info)
+  {
+    using namespace Steinberg::Vst;
+    
+    static const struct { NoteExpressionTypeID typeId; const char* title; const char* shortTitle; const char* units; double defaultValue; bool bipolar; } sTypes[kNumNoteExpressions] = {
+      { kVolumeTypeID, "Volume", "Vol", "dB", 0.25, false },
+      { kPanTypeID, "Pan", "Pan", "", 0.5, true },
+      { kTuningTypeID, "Tuning", "Tune", "st", 0.5, true },
+      { kVibratoTypeID, "Vibrato", "Vib", "", 0., false },
+      { kExpressionTypeID, "Expression", "Expr", "", 0., false },
+      { kBrightnessTypeID, "Brightness", "Brt", "", 0.5, false }
+    };
+    
+    if (busIndex != 0 || noteExpressionIndex < 0 || noteExpressionIndex >= kNumNoteExpressions)
+      return Steinberg::kResultFalse;
+    
+    const auto& type = sTypes[noteExpressionIndex];
+    memset(&info, 0, sizeof(info));
+    info.typeId = type.typeId;
+    Steinberg::UString(info.title, 128).fromAscii(type.title);
+    Steinberg::UString(info.shortTitle, 128).fromAscii(type.shortTitle);
+    Steinberg::UString(info.units, 128).fromAscii(type.units);
+    info.unitId = kNoParentUnitId;
+    info.valueDesc.defaultValue = type.defaultValue;
+    info.valueDesc.minimum = 0.;
+    info.valueDesc.maximum = 1.;
+    info.associatedParameterId = kNoParamId;
+    info.flags = type.bipolar ? NoteExpressionTypeInfo::kIsBipolar : 0;
+    return Steinberg::kResultTrue;
+  }
+  
+  Steinberg::tresult PLUGIN_API GetNoteExpressionStringByValue(Steinberg::Vst::NoteExpressionTypeID id, Steinberg::Vst::NoteExpressionValue valueNormalized, Steinberg::Vst::String128 string)
+  {
+    WDL_String str;
+    
+    if (id == Steinberg::Vst::kTuningTypeID)
+      str.SetFormatted(32, "%.2f", kNoteExpressionTuningRange * (valueNormalized - 0.5));
+    else if (id == Steinberg::Vst::kVolumeTypeID)
+      str.SetFormatted(32, "%.1f", valueNormalized > 0. ? 20. * std::log10(4. * valueNormalized) : -144.);
+    else
+      str.SetFormatted(32, "%.3f", valueNormalized);
+    
+    Steinberg::UString(string, 128).fromAscii(str.Get());
+    return Steinberg::kResultTrue;
+  }
+  
+  Steinberg::tresult PLUGIN_API GetNoteExpressionValueByString(Steinberg::Vst::NoteExpressionTypeID id, const Steinberg::Vst::TChar* string, Steinberg::Vst::NoteExpressionValue& valueNormalized)
+  {
+    Steinberg::String str((Steinberg::Vst::TChar*) string);
+    double value = 0.;
+    
+    if (!str.scanFloat(value))
+      return Steinberg::kResultFalse;
+    
+    if (id == Steinberg::Vst::kTuningTypeID)
+      value = value / kNoteExpressionTuningRange + 0.5;
+    else if (id == Steinberg::Vst::kVolumeTypeID)
+      value = std::pow(10., value / 20.) / 4.;
+    
+    valueNormalized = Clip(value, 0., 1.);
+    return Steinberg::kResultTrue;
+  }
+#endif
+  
   Steinberg::Vst::ParamValue GetParamNormalized(Steinberg::Vst::ParamID tag)
   {
     Steinberg::Vst::Parameter* parameter = mParameters.getParameter(tag);
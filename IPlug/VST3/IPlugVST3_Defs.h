@@ -15,3 +15,7 @@
 #ifndef VST3_CC_UNITNAME
   #define VST3_CC_UNITNAME "MIDI CCs"
 #endif
+
+#ifndef VST3_NOTE_EXPRESSIONS
+  #define VST3_NOTE_EXPRESSIONS 0 // set to 1 to advertise VST3 note expression, which is passed to IPlugProcessor::ProcessMidi2Msg()
+#endif
@@ -61,6 +61,9 @@ tresult PLUGIN_API IPlugVST3Processor::setActive(TBool state)
 {
   TRACE
   
+  if (state)
+    EnsureDeferredInit();
+
   OnActivate((bool) state);
   return AudioEffect::setActive(state);
 }
@@ -82,7 +82,7 @@ private:
   Steinberg::tresult PLUGIN_API notify(Steinberg::Vst::IMessage* message) override;
   
 //  Steinberg::Vst::ParameterChanges mOutputParamChanges;
-  IMidiQueue mMidiOutputQueue;
+  IFixedMidiQueue mMidiOutputQueue;
 };
 
 Steinberg::FUnknown* MakeProcessor();
@@ -11,6 +11,7 @@
 #include "pluginterfaces/vst/ivstparameterchanges.h"
 #include "pluginterfaces/vst/vstspeaker.h"
 #include "pluginterfaces/vst/ivstmidicontrollers.h"
+#include "pluginterfaces/vst/ivstnoteexpression.h"
 #include "public.sdk/source/vst/vsteventshelper.h"
 #include "IPlugVST3_ProcessorBase.h"
 
@@ -74,6 +75,7 @@ void IPlugVST3ProcessorBase::ProcessMidiIn(IEventList* pEventList, IPlugQueue<IM
   if (pEventList)
   {
     int32 numEvent = pEventList->getEventCount();
+    mReceivedMidiInBlock |= numEvent > 0;
     for (int32 i=0; i<numEvent; i++)
     {
       Event event;
@@ -84,29 +86,40 @@ void IPlugVST3ProcessorBase::ProcessMidiIn(IEventList* pEventList, IPlugQueue<IM
           case Event::kNoteOnEvent:
           {
             msg.MakeNoteOnMsg(event.noteOn.pitch, event.noteOn.velocity * 127, event.sampleOffset, event.noteOn.channel);
-            ProcessMidiMsg(msg);
+            ScheduleMidiMsg(msg);
             processorQueue.Push(msg);
+            
+            if (event.noteOn.noteId != -1)
+              AddNoteID(event.noteOn.noteId, event.noteOn.pitch, event.noteOn.channel);
             break;
           }
             
           case Event::kNoteOffEvent:
           {
             msg.MakeNoteOffMsg(event.noteOff.pitch, event.sampleOffset, event.noteOff.channel);
-            ProcessMidiMsg(msg);
+            ScheduleMidiMsg(msg);
             processorQueue.Push(msg);
+            
+            if (NoteIDSlot* pNote = FindNoteID(event.noteOff.noteId))
+              pNote->noteId = -1;
             break;
           }
           case Event::kPolyPressureEvent:
           {
             msg.MakePolyATMsg(event.polyPressure.pitch, event.polyPressure.pressure * 127., event.sampleOffset, event.polyPressure.channel);
-            ProcessMidiMsg(msg);
+            ScheduleMidiMsg(msg);
             processorQueue.Push(msg);
             break;
           }
           case Event::kDataEvent:
           {
             ISysEx syx = ISysEx(event.sampleOffset, event.data.bytes, event.data.size);
-            ProcessSysEx(syx);
+            ScheduleSysEx(syx);
+            break;
+          }
+          case Event::kNoteExpressionValueEvent:
+          {
+            ProcessNoteExpression(event.noteExpressionValue, event.sampleOffset);
             break;
           }
         }
@@ -116,8 +129,76 @@ void IPlugVST3ProcessorBase::ProcessMidiIn(IEventList* pEventList, IPlugQueue<IM
   
   while (editorQueue.Pop(msg))
   {
-    ProcessMidiMsg(msg);
+    ScheduleMidiMsg(msg);
+    mReceivedMidiInBlock = true;
+  }
+}
+
+void IPlugVST3ProcessorBase::AddNoteID(int32 noteId, int16 pitch, int16 channel)
+{
+  NoteIDSlot* pSlot = &mNoteIDs[noteId & 127];
+  
+  // if the slot is taken by a note that is still playing use any free one, and if there is none, replace it
+  if (pSlot->noteId != -1)
+  {
+    NoteIDSlot* pFree = std::find_if(std::begin(mNoteIDs), std::end(mNoteIDs), [](const NoteIDSlot& slot) { return slot.noteId == -1; });
+    
+    if (pFree != std::end(mNoteIDs))
+      pSlot = pFree;
   }
+  
+  *pSlot = { noteId, pitch, channel };
+}
+
+IPlugVST3ProcessorBase::NoteIDSlot* IPlugVST3ProcessorBase::FindNoteID(int32 noteId)
+{
+  if (noteId == -1)
+    return nullptr;
+  
+  NoteIDSlot* pSlot = &mNoteIDs[noteId & 127];
+  
+  if (pSlot->noteId == noteId)
+    return pSlot;
+  
+  // the note was put in another slot by AddNoteID()
+  pSlot = std::find_if(std::begin(mNoteIDs), std::end(mNoteIDs), [noteId](const NoteIDSlot& slot) { return slot.noteId == noteId; });
+  return pSlot != std::end(mNoteIDs) ? pSlot : nullptr;
+}
+
+void IPlugVST3ProcessorBase::ProcessNoteExpression(const NoteExpressionValueEvent& event, int32 offset)
+{
+  const NoteIDSlot* pNote = FindNoteID(event.noteId);
+  
+  if (!pNote)
+    return;
+  
+  IMidi2Msg msg;
+  
+  if (event.typeId == kTuningTypeID)
+  {
+    // VST3 tuning is -120 to +120 semitones, per-note pitch bend is +/- kDefaultPerNotePitchBendRange semitones
+    const double semitones = 240. * (event.value - 0.5);
+    msg.MakePerNotePitchBendMsg(pNote->pitch, semitones / IMidi2Msg::kDefaultPerNotePitchBendRange, offset, pNote->channel);
+  }
+  else
+  {
+    int controllerIdx;
+    
+    switch (event.typeId)
+    {
+      case kVolumeTypeID: controllerIdx = IMidi2Msg::kPerNoteVolume; break;
+      case kPanTypeID: controllerIdx = IMidi2Msg::kPerNotePan; break;
+      case kVibratoTypeID: controllerIdx = IMidi2Msg::kPerNoteModulation; break;
+      case kExpressionTypeID: controllerIdx = IMidi2Msg::kPerNoteExpression; break;
+      case kBrightnessTypeID: controllerIdx = IMidi2Msg::kPerNoteTimbre; break;
+      default: return;
+    }
+    
+    msg.MakePerNoteControllerMsg(pNote->pitch, controllerIdx, event.value, offset, pNote->channel);
+  }
+  
+  ScheduleMidi2Msg(msg);
+  mReceivedMidiInBlock = true;
 }
 
 void IPlugVST3ProcessorBase::ProcessMidiOut(IPlugQueue<SysExData>& sysExQueue, SysExData& sysExBuf, IEventList* pOutputEvents, int32 numSamples)
@@ -227,7 +308,11 @@ bool IPlugVST3ProcessorBase::SetupProcessing(const ProcessSetup& setup, ProcessS
   SetSampleRate(setup.sampleRate);
   IPlugProcessor::SetBlockSize(setup.maxSamplesPerBlock); // TODO: should IPlugVST3Processor call SetBlockSize in construct unlike other APIs?
   mMidiOutputQueue.Resize(setup.maxSamplesPerBlock);
-  OnReset();
+  mOutputParamValues.Resize(mPlug.NParams());
+  std::fill_n(mOutputParamValues.Get(), mPlug.NParams(), -1.);
+  mOutputParamCountdown = 0;
+  EnsureDeferredInit();
+  ResetFromAPI();
     
   return true;
 }
@@ -235,11 +320,68 @@ bool IPlugVST3ProcessorBase::SetupProcessing(const ProcessSetup& setup, ProcessS
 bool IPlugVST3ProcessorBase::SetProcessing(bool state)
 {
   if (!state)
-    OnReset();
+    ResetFromAPI();
+  
+  mNSilentSamples = 0;
+  return true;
+}
+
+bool IPlugVST3ProcessorBase::InputsSilent(ProcessData& data) const
+{
+  if (!data.numInputs || mReceivedMidiInBlock)
+    return false;
+  
+  for (int32 bus = 0; bus < data.numInputs; bus++)
+  {
+    const int32 nChans = data.inputs[bus].numChannels;
+    const uint64 allSilent = nChans >= 64 ? ~uint64(0) : (uint64(1) << nChans) - 1;
+    
+    if ((data.inputs[bus].silenceFlags & allSilent) != allSilent)
+      return false;
+  }
   
   return true;
 }
 
+bool IPlugVST3ProcessorBase::SidechainSilent(ProcessData& data) const
+{
+  if (data.numInputs < 2)
+    return false;
+  
+  for (int32 bus = 1; bus < data.numInputs; bus++)
+  {
+    const int32 nChans = data.inputs[bus].numChannels;
+    const uint64 allSilent = nChans >= 64 ? ~uint64(0) : (uint64(1) << nChans) - 1;
+    
+    if ((data.inputs[bus].silenceFlags & allSilent) != allSilent)
+      return false;
+  }
+  
+  return true;
+}
+
+void IPlugVST3ProcessorBase::SetOutputsSilent(ProcessData& data, int32 sampleSize, bool silent)
+{
+  for (int32 bus = 0; bus < data.numOutputs; bus++)
+  {
+    AudioBusBuffers& buffers = data.outputs[bus];
+    const int32 nChans = buffers.numChannels;
+    buffers.silenceFlags = silent ? (nChans >= 64 ? ~uint64(0) : (uint64(1) << nChans) - 1) : 0;
+    
+    if (!silent)
+      continue;
+    
+    // the host may still read the buffers, so they must hold silence as well as be flagged
+    for (int32 c = 0; c < nChans; c++)
+    {
+      if (sampleSize == kSample32 && buffers.channelBuffers32 && buffers.channelBuffers32[c])
+        memset(buffers.channelBuffers32[c], 0, data.numSamples * sizeof(Sample32));
+      else if (sampleSize == kSample64 && buffers.channelBuffers64 && buffers.channelBuffers64[c])
+        memset(buffers.channelBuffers64[c], 0, data.numSamples * sizeof(Sample64));
+    }
+  }
+}
+
 bool IPlugVST3ProcessorBase::CanProcessSampleSize(int32 symbolicSampleSize)
 {
   switch (symbolicSampleSize)
@@ -290,56 +432,53 @@ void IPlugVST3ProcessorBase::ProcessParameterChanges(ProcessData& data, IPlugQue
         int32 offsetSamples;
         double value;
         
-        if (paramQueue->getPoint(numPoints - 1,  offsetSamples, value) == kResultTrue)
+        // without sample accurate events only the last point in the queue is used
+        const int32 firstPoint = GetSampleAccurateEvents() ? 0 : numPoints - 1;
+        
+        for (int32 pointIdx = firstPoint; pointIdx < numPoints; pointIdx++)
         {
-          int idx = paramQueue->getParameterId();
-          
-          switch (idx)
+          if (paramQueue->getPoint(pointIdx, offsetSamples, value) == kResultTrue)
           {
-            case kBypassParam:
-            {
-              const bool bypassed = (value > 0.5);
-
-              if (bypassed != GetBypassed())
-                SetBypassed(bypassed);
-
-              break;
-            }
-            default:
+            int idx = paramQueue->getParameterId();
+            
+            switch (idx)
             {
-              if (idx >= 0 && idx < mPlug.NParams())
+              case kBypassParam:
               {
-#ifdef PARAMS_MUTEX
-                mPlug.mParams_mutex.Enter();
-#endif
-                mPlug.GetParam(idx)->SetNormalized(value);
-              
-                // In VST3 non distributed the same parameter value is also set via IPlugVST3Controller::setParamNormalized(ParamID tag, ParamValue value)
-                mPlug.OnParamChange(idx, kHost, offsetSamples);
-#ifdef PARAMS_MUTEX
-                mPlug.mParams_mutex.Leave();
-#endif
+                const bool bypassed = (value > 0.5);
+                
+                if (bypassed != GetBypassed())
+                  SetBypassed(bypassed);
+                
+                break;
               }
-              else if (idx >= kMIDICCParamStartIdx)
+              default:
               {
-                int index = idx - kMIDICCParamStartIdx;
-                int channel = index / kCountCtrlNumber;
-                int ctrlr = index % kCountCtrlNumber;
-
-                IMidiMsg msg;
-
-                if (ctrlr == kAfterTouch)
-                  msg.MakeChannelATMsg((int) (value * 127.), offsetSamples, channel);
-                else if (ctrlr == kPitchBend)
-                  msg.MakePitchWheelMsg((value * 2.)-1., channel, offsetSamples);
-                else
-                  msg.MakeControlChangeMsg((IMidiMsg::EControlChangeMsg) ctrlr, value, channel, offsetSamples);
-
-                fromProcessor.Push(msg);
-                ProcessMidiMsg(msg);
+                if (idx >= 0 && idx < mPlug.NParams())
+                {
+                  ScheduleParamChange(idx, value, offsetSamples);
+                }
+                else if (idx >= kMIDICCParamStartIdx)
+                {
+                  int index = idx - kMIDICCParamStartIdx;
+                  int channel = index / kCountCtrlNumber;
+                  int ctrlr = index % kCountCtrlNumber;
+                  
+                  IMidiMsg msg;
+                  
+                  if (ctrlr == kAfterTouch)
+                    msg.MakeChannelATMsg((int) (value * 127.), offsetSamples, channel);
+                  else if (ctrlr == kPitchBend)
+                    msg.MakePitchWheelMsg((value * 2.)-1., channel, offsetSamples);
+                  else
+                    msg.MakeControlChangeMsg((IMidiMsg::EControlChangeMsg) ctrlr, value, channel, offsetSamples);
+                  
+                  fromProcessor.Push(msg);
+                  ScheduleMidiMsg(msg);
+                }
               }
+                break;
             }
-              break;
           }
         }
       }
@@ -347,6 +486,20 @@ void IPlugVST3ProcessorBase::ProcessParameterChanges(ProcessData& data, IPlugQue
   }
 }
 
+void IPlugVST3ProcessorBase::ProcessScheduledParamChange(int paramIdx, double normalizedValue, int offset)
+{
+#ifdef PARAMS_MUTEX
+  mPlug.mParams_mutex.Enter();
+#endif
+  mPlug.GetParam(paramIdx)->SetNormalized(normalizedValue);
+  
+  // In VST3 non distributed the same parameter value is also set via IPlugVST3Controller::setParamNormalized(ParamID tag, ParamValue value)
+  mPlug.OnParamChange(paramIdx, kHost, offset);
+#ifdef PARAMS_MUTEX
+  mPlug.mParams_mutex.Leave();
+#endif
+}
+
 void IPlugVST3ProcessorBase::ProcessAudio(ProcessData& data, ProcessSetup& setup, const BusList& ins, const BusList& outs)
 {
   int32 sampleSize = setup.symbolicSampleSize;
@@ -380,6 +533,8 @@ void IPlugVST3ProcessorBase::ProcessAudio(ProcessData& data, ProcessSetup& setup
         
         if(mSidechainActive)
           AttachBuffers(ERoute::kInput, mMaxNChansForMainInputBus, data.inputs[1].numChannels, data.inputs[1], data.numSamples, sampleSize);
+        
+        SetSidechainSilent(SidechainSilent(data));
       }
       else
       {
@@ -407,6 +562,19 @@ void IPlugVST3ProcessorBase::ProcessAudio(ProcessData& data, ProcessSetup& setup
     }
     else
     {
+      if (GetSkipSilentBlocks())
+      {
+        const int tailSize = GetTailSize(); // negative for an infinite tail
+        const bool inputsSilent = InputsSilent(data);
+        const bool outputsSilent = inputsSilent && tailSize >= 0 && mNSilentSamples >= static_cast<int64>(tailSize) + GetLatency();
+        
+        mNSilentSamples = inputsSilent ? mNSilentSamples + data.numSamples : 0;
+        SetOutputsSilent(data, sampleSize, outputsSilent);
+        
+        if (outputsSilent)
+          return; // scheduled events are dispatched by FlushScheduledEvents()
+      }
+      
 #ifdef PARAMS_MUTEX
       mPlug.mParams_mutex.Enter();
 #endif
@@ -425,6 +593,7 @@ void IPlugVST3ProcessorBase::Process(ProcessData& data, ProcessSetup& setup, con
 {
   PrepareProcessContext(data, setup);
   ProcessParameterChanges(data, fromProcessor);
+  mReceivedMidiInBlock = false;
   
   if (DoesMIDIIn())
   {
@@ -433,14 +602,48 @@ void IPlugVST3ProcessorBase::Process(ProcessData& data, ProcessSetup& setup, con
   
   ProcessAudio(data, setup, ins, outs);
   
+  // dispatch any events that weren't consumed by ProcessAudio(), e.g. for a parameter flush with no audio
+  FlushScheduledEvents();
+  
   if (DoesMIDIOut())
   {
     ProcessMidiOut(sysExFromEditor, sysExBuf, data.outputEvents, data.numSamples);
   }
+
+  ProcessOutputParameterChanges(data, setup);
+}
+
+void IPlugVST3ProcessorBase::ProcessOutputParameterChanges(ProcessData& data, ProcessSetup& setup)
+{
+  IParameterChanges* pOutputChanges = data.outputParameterChanges;
+
+  if (!pOutputChanges)
+    return;
+
+  mOutputParamCountdown -= data.numSamples;
+
+  if (mOutputParamCountdown > 0)
+    return;
+
+  mOutputParamCountdown = std::max<int64>(static_cast<int64>(setup.sampleRate * mPlug.GetOutputParamInterval() / 1000.), 1);
+
+  // the value is the one at the end of the block, or the start of a parameter flush with no audio
+  const int32 offset = std::max<int32>(data.numSamples - 1, 0);
+
+  mPlug.ForEachChangedOutputParam(mOutputParamValues, [&](int paramIdx, double normalizedValue) {
+    int32 queueIdx = 0;
+
+    if (IParamValueQueue* pQueue = pOutputChanges->addParameterData(paramIdx, queueIdx))
+    {
+      int32 pointIdx = 0;
+      pQueue->addPoint(offset, normalizedValue, pointIdx);
+    }
+  });
 }
 
 bool IPlugVST3ProcessorBase::SendMidiMsg(const IMidiMsg& msg)
 {
-  mMidiOutputQueue.Add(msg);
-  return true;
+  IMidiMsg msgInBlock = msg;
+  msgInBlock.mOffset += GetSegmentStart();
+  return mMidiOutputQueue.Add(msgInBlock);
 }
@@ -180,17 +180,54 @@ public:
   void PrepareProcessContext(Steinberg::Vst::ProcessData& data, Steinberg::Vst::ProcessSetup& setup);
   void ProcessParameterChanges(Steinberg::Vst::ProcessData& data, IPlugQueue<IMidiMsg>& fromProcessor);
   void ProcessAudio(Steinberg::Vst::ProcessData& data, Steinberg::Vst::ProcessSetup& setup, const Steinberg::Vst::BusList& ins, const Steinberg::Vst::BusList& outs);
+  /** Writes the output parameters whose value has changed to the block's outputParameterChanges, at most once per IPlugAPIBase::GetOutputParamInterval() */
+  void ProcessOutputParameterChanges(Steinberg::Vst::ProcessData& data, Steinberg::Vst::ProcessSetup& setup);
   void Process(Steinberg::Vst::ProcessData& data, Steinberg::Vst::ProcessSetup& setup, const Steinberg::Vst::BusList& ins, const Steinberg::Vst::BusList& outs, IPlugQueue<IMidiMsg>& fromEditor, IPlugQueue<IMidiMsg>& fromProcessor, IPlugQueue<SysExData>& sysExFromEditor, SysExData& sysExBuf);
   
   // IPlugProcessor overrides
   bool SendMidiMsg(const IMidiMsg& msg) override;
+  void ProcessScheduledParamChange(int paramIdx, double normalizedValue, int offset) override;
 
 private:
+  /** @return \c true if every channel of every input bus has been flagged silent by the host, and no MIDI arrived in this block */
+  bool InputsSilent(Steinberg::Vst::ProcessData& data) const;
+  /** @return \c true if every channel of the side-chain buses has been flagged silent by the host, see IsSidechainActive() */
+  bool SidechainSilent(Steinberg::Vst::ProcessData& data) const;
+  /** Sets the silence flags of the output buses, and if silent clears the buffers */
+  void SetOutputsSilent(Steinberg::Vst::ProcessData& data, Steinberg::int32 sampleSize, bool silent);
+
   int mMaxNChansForMainInputBus = 0;
   IPlugAPIBase& mPlug;
   Steinberg::Vst::ProcessContext mProcessContext;
-  IMidiQueue mMidiOutputQueue;
+  IFixedMidiQueue mMidiOutputQueue;
   bool mSidechainActive = false;
+  /** \c true if MIDI arrived from the host or the editor in the current block, see SetSkipSilentBlocks() */
+  bool mReceivedMidiInBlock = false;
+  /** The number of samples for which the inputs have been silent, see SetSkipSilentBlocks() */
+  Steinberg::int64 mNSilentSamples = 0;
+  /** The normalised value of each output parameter last written to outputParameterChanges */
+  WDL_TypedBuf<double> mOutputParamValues;
+  /** The number of samples until the output parameters are next written */
+  Steinberg::int64 mOutputParamCountdown = 0;
+  
+  /** Passes a VST3 note expression value to ProcessMidi2Msg() as a per-note controller or per-note pitch bend message */
+  void ProcessNoteExpression(const Steinberg::Vst::NoteExpressionValueEvent& event, Steinberg::int32 offset);
+  
+  /** The key and channel of a playing note, note expression events only have the note ID */
+  struct NoteIDSlot
+  {
+    Steinberg::int32 noteId = -1;
+    Steinberg::int16 pitch = 0;
+    Steinberg::int16 channel = 0;
+  };
+  
+  /** Remembers the key and channel of a note that has started */
+  void AddNoteID(Steinberg::int32 noteId, Steinberg::int16 pitch, Steinberg::int16 channel);
+  /** @return The slot of a playing note, or nullptr if the note isn't playing */
+  NoteIDSlot* FindNoteID(Steinberg::int32 noteId);
+  
+  /** Playing notes by note ID, in the slot given by the low bits of the ID, which hosts usually increment from note to note, or in any free slot if that one is taken */
+  NoteIDSlot mNoteIDs[128];
 };
 
 END_IPLUG_NAMESPACE
@@ -10,15 +10,53 @@
 
 #include "IPlugWAM.h"
 
+#include <emscripten.h>
+
 using namespace iplug;
 
+// Writes one message into the ring that IPlugWAM-awp.js installs, as a 32 bit length then the bytes. The read and write positions are the first
+// two Int32s of the SharedArrayBuffer, and one byte is always left free so that a full ring can be told from an empty one.
+// The ring is shared by every instance of the same plug-in in an AudioContext, so only the first instance to write claims it
+EM_JS(int, IPlugSharedRingWrite, (void* pInstance, const uint8_t* pData, int size), {
+  var ring = Module.IPlugRing;
+
+  if (!ring)
+    return 0;
+
+  if (!ring.owner)
+    ring.owner = pInstance;
+
+  if (ring.owner != pInstance)
+    return 0;
+
+  var cap = ring.data.length;
+  var w = Atomics.load(ring.header, 0);
+  var r = Atomics.load(ring.header, 1);
+  var free = cap - 1 - ((w - r + cap) % cap);
+
+  if (free < size + 4)
+    return 0;
+
+  var bytes = new Uint8Array(4 + size);
+  new DataView(bytes.buffer).setInt32(0, size, true);
+  bytes.set(HEAPU8.subarray(pData, pData + size), 4);
+
+  var first = Math.min(bytes.length, cap - w);
+  ring.data.set(bytes.subarray(0, first), w);
+  ring.data.set(bytes.subarray(first), 0);
+
+  Atomics.store(ring.header, 0, (w + bytes.length) % cap);
+  return 1;
+});
+
 IPlugWAM::IPlugWAM(const InstanceInfo& info, const Config& config)
 : IPlugAPIBase(config, kAPIWAM)
 , IPlugProcessor(config, kAPIWAM)
 {
   int nInputs = MaxNChannels(ERoute::kInput), nOutputs = MaxNChannels(ERoute::kOutput);
 
-  SetChannelConnections(ERoute::kInput, 0, nInputs, true);
+  // the WAM SDK always passes the same buses, so the connections never change
+  SetChannelConnections(ERoute::kInput, 0, nInputs, !IsInstrument());
   SetChannelConnections(ERoute::kOutput, 0, nOutputs, true);
 }
 
@@ -29,6 +67,12 @@ const char* IPlugWAM::init(uint32_t bufsize, uint32_t sr, void* pDesc)
   SetSampleRate(sr);
   SetBlockSize(bufsize);
 
+#if IPLUG_WASM_THREADS
+  // the workers are web workers that IPlugWAM-awp.js asks the page to start, so they begin running after init() returns
+  if (!mWorkerPool)
+    mWorkerPool = std::make_unique<IWorkerPool>(IPLUG_WASM_THREAD_COUNT);
+#endif
+
   DBGMSG("%i %i\n", sr, bufsize);
 
   WDL_String json;
@@ -51,18 +95,25 @@ const char* IPlugWAM::init(uint32_t bufsize, uint32_t sr, void* pDesc)
 
   //TODO: correct place? - do we need a WAM reset message?
   OnParamReset(kReset);
-  OnReset();
+  EnsureDeferredInit();
+  ResetFromAPI();
   postMessage("StartIdleTimer", nullptr, nullptr);
 
   return json.Get();
 }
 
+#if IPLUG_WASM_THREADS
+bool IPlugWAM::ExecuteParallel(ParallelTask task, void* pContext, int nTasks)
+{
+  return mWorkerPool && mWorkerPool->ExecuteParallel(task, pContext, nTasks);
+}
+#endif
+
 void IPlugWAM::onProcess(WAM::AudioBus* pAudio, void* pData)
 {
   const int blockSize = GetBlockSize();
-  
-  SetChannelConnections(ERoute::kInput, 0, MaxNChannels(ERoute::kInput), !IsInstrument()); //TODO: go elsewhere
-  SetChannelConnections(ERoute::kOutput, 0, MaxNChannels(ERoute::kOutput), true); //TODO: go elsewhere
+
+  // with SAMPLE_TYPE_FLOAT these point straight at the WAM SDK's buffers in the module's memory, so there is no copy on this side
   AttachBuffers(ERoute::kInput, 0, NChannelsConnected(ERoute::kInput), pAudio->inputs, blockSize);
   AttachBuffers(ERoute::kOutput, 0, NChannelsConnected(ERoute::kOutput), pAudio->outputs, blockSize);
   
@@ -189,8 +240,38 @@ void IPlugWAM::onSysex(byte* pData, uint32_t size)
   postMessage("SSMFD", dataStr.Get(), "");
 }
 
+bool IPlugWAM::WriteToSharedRing(char type, int tag, int tag2, double value, const void* pData, int dataSize)
+{
+  const int hasTag2 = type == 'M';
+  const int hasValue = type == 'P' || type == 'C';
+  const int size = 1 + sizeof(int) * (1 + hasTag2) + sizeof(double) * hasValue + dataSize;
+
+  mRingMsg.Resize(size, false);
+  uint8_t* pMsg = mRingMsg.Get();
+  *pMsg++ = type;
+  memcpy(pMsg, &tag, sizeof(int)); pMsg += sizeof(int);
+
+  if (hasTag2)
+  {
+    memcpy(pMsg, &tag2, sizeof(int)); pMsg += sizeof(int);
+  }
+
+  if (hasValue)
+  {
+    memcpy(pMsg, &value, sizeof(double)); pMsg += sizeof(double);
+  }
+
+  if (dataSize)
+    memcpy(pMsg, pData, dataSize);
+
+  return IPlugSharedRingWrite(this, mRingMsg.Get(), size);
+}
+
 void IPlugWAM::SendControlValueFromDelegate(int ctrlTag, double normalizedValue)
 {
+  if (WriteToSharedRing('C', ctrlTag, 0, normalizedValue))
+    return;
+
   WDL_String propStr;
   WDL_String dataStr;
 
@@ -203,6 +284,9 @@ void IPlugWAM::SendControlValueFromDelegate(int ctrlTag, double normalizedValue)
 
 void IPlugWAM::SendControlMsgFromDelegate(int ctrlTag, int msgTag, int dataSize, const void* pData)
 {
+  if (WriteToSharedRing('M', ctrlTag, msgTag, 0., pData, dataSize))
+    return;
+
   WDL_String propStr;
   propStr.SetFormatted(16, "%i:%i", ctrlTag, msgTag);
   
@@ -212,6 +296,9 @@ void IPlugWAM::SendControlMsgFromDelegate(int ctrlTag, int msgTag, int dataSize,
 
 void IPlugWAM::SendParameterValueFromDelegate(int paramIdx, double value, bool normalized)
 {
+  if (WriteToSharedRing('P', paramIdx, 0, value))
+    return;
+
   WDL_String propStr;
   WDL_String dataStr;
   propStr.SetFormatted(16, "%i", paramIdx);
@@ -223,6 +310,9 @@ void IPlugWAM::SendParameterValueFromDelegate(int paramIdx, double value, bool n
 
 void IPlugWAM::SendArbitraryMsgFromDelegate(int msgTag, int dataSize, const void* pData)
 {
+  if (WriteToSharedRing('A', msgTag, 0, 0., pData, dataSize))
+    return;
+
   WDL_String propStr;
   propStr.SetFormatted(16, "%i", msgTag);
   
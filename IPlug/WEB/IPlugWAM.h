@@ -15,6 +15,15 @@
 #include "IPlugProcessor.h"
 #include "processor.h"
 
+#if IPLUG_WASM_THREADS
+  #include <memory>
+  #include "IPlugWorkerPool.h"
+
+  #ifndef IPLUG_WASM_THREAD_COUNT
+    #define IPLUG_WASM_THREAD_COUNT 3
+  #endif
+#endif
+
 using namespace WAM;
 
 BEGIN_IPLUG_NAMESPACE
@@ -49,6 +58,14 @@ public:
   void SetLatency(int samples) override {};
   bool SendMidiMsg(const IMidiMsg& msg) override { return false; }
   bool SendSysEx(const ISysEx& msg) override { return false; }
+
+#if IPLUG_WASM_THREADS
+  /** In a WASM_THREADS=1 build, tasks run on the plug-in's worker pool, see GetWorkerPool() */
+  bool ExecuteParallel(ParallelTask task, void* pContext, int nTasks) override;
+
+  /** @return The worker pool of a WASM_THREADS=1 build, which has IPLUG_WASM_THREAD_COUNT workers and is made in init(), where background jobs can be dispatched */
+  IWorkerPool* GetWorkerPool() { return mWorkerPool.get(); }
+#endif
   
   //IEditorDelegate - these are overwritten because we need to use WAM messaging system
   void SendControlValueFromDelegate(int ctrlTag, double normalizedValue) override;
@@ -59,6 +76,22 @@ public:
 private:
   /** Called repeatedly to emulate IPlugAPIBase::OnTimer() */
   void OnEditorIdleTick();
+
+  /** If the page is cross-origin isolated, the controller (see IPlugWAM-awn.js) shares a SharedArrayBuffer ring with the processor, which carries
+   * messages to the UI without postMessage() and its structured clone. Each message is a type byte, 'P' 'C' 'M' or 'A' for SPVFD, SCVFD, SCMFD or SAMFD, then its fields
+   * @param type The message type
+   * @param tag The parameter index, control tag or message tag
+   * @param tag2 The message tag for 'M', otherwise unused
+   * @param value The value for 'P' and 'C'
+   * @param pData The data for 'M' and 'A'
+   * @param dataSize The size of pData
+   * @return \c false if there is no ring or it is full, in which case the caller posts the message instead */
+  bool WriteToSharedRing(char type, int tag, int tag2, double value, const void* pData = nullptr, int dataSize = 0);
+
+  WDL_TypedBuf<uint8_t> mRingMsg;
+#if IPLUG_WASM_THREADS
+  std::unique_ptr<IWorkerPool> mWorkerPool;
+#endif
 };
 
 IPlugWAM* MakePlug(const InstanceInfo& info);
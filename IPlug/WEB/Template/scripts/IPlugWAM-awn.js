@@ -10,7 +10,67 @@ class NAME_PLACEHOLDERController extends WAMController
     if (options.processorOptions.inputChannelCount === undefined) options.processorOptions = {inputChannelCount:[]};
 
     options.buflenSPN = 1024;
+
+    // if the page is cross-origin isolated, messages from the processor come through a SharedArrayBuffer ring, rather than postMessage
+    var ring = undefined;
+
+    if (self.crossOriginIsolated && typeof SharedArrayBuffer !== 'undefined') {
+      var sab = new SharedArrayBuffer(8 + 65536);
+      options.processorOptions.iplugRing = sab;
+      ring = { header: new Int32Array(sab, 0, 2), data: new Uint8Array(sab, 8) };
+    }
+
     super(actx, "NAME_PLACEHOLDER", options);
+
+    this.ring = ring;
+
+    if (ring)
+      requestAnimationFrame(() => this.readRing());
+  }
+
+  // reads the messages written by IPlugWAM::WriteToSharedRing() once per display frame
+  readRing() {
+    var ring = this.ring;
+    var cap = ring.data.length;
+    var w = Atomics.load(ring.header, 0);
+    var r = Atomics.load(ring.header, 1);
+
+    var read = (n) => {
+      var bytes = new Uint8Array(n);
+      var first = Math.min(n, cap - r);
+      bytes.set(ring.data.subarray(r, r + first), 0);
+      bytes.set(ring.data.subarray(0, n - first), first);
+      r = (r + n) % cap;
+      return bytes;
+    };
+
+    while (r != w) {
+      var size = new DataView(read(4).buffer).getInt32(0, true);
+      var msg = read(size);
+      var dv = new DataView(msg.buffer);
+      var type = String.fromCharCode(msg[0]);
+
+      if (type == 'P')
+        Module.SPVFD(dv.getInt32(1, true), dv.getFloat64(5, true));
+      else if (type == 'C')
+        Module.SCVFD(dv.getInt32(1, true), dv.getFloat64(5, true));
+      else if (type == 'M' || type == 'A') {
+        var offset = type == 'M' ? 9 : 5;
+        var data = msg.subarray(offset);
+        const buffer = Module._malloc(data.length);
+        Module.HEAPU8.set(data, buffer);
+
+        if (type == 'M')
+          Module.SCMFD(dv.getInt32(1, true), dv.getInt32(5, true), data.length, buffer);
+        else
+          Module.SAMFD(dv.getInt32(1, true), data.length, buffer);
+
+        Module._free(buffer);
+      }
+    }
+
+    Atomics.store(ring.header, 1, r);
+    requestAnimationFrame(() => this.readRing());
   }
 
   static importScripts (actx) {
@@ -25,6 +85,25 @@ class NAME_PLACEHOLDERController extends WAMController
     })
   }
 
+  // starts a worker for one of the processor's threads, relaying messages between it and the processor's stand-in Worker
+  startWorker(name, port) {
+    var url = new URL("ORIGIN_PLACEHOLDER" + "scripts/NAME_PLACEHOLDER-wam.js", location.href).href;
+
+    // the thread runs the same script as the processor, which expects the worklet's global scope
+    var src = "self.AudioWorkletGlobalScope = self; importScripts('" + url + "');";
+    var worker = new Worker(URL.createObjectURL(new Blob([src], { type: "text/javascript" })), { name: name });
+
+    worker.onmessage = (e) => port.postMessage(e.data);
+    worker.onerror = (e) => console.error("NAME_PLACEHOLDER worker: " + e.message);
+
+    port.onmessage = (e) => {
+      if (e.data && e.data.iplugTerminate)
+        worker.terminate();
+      else
+        worker.postMessage(e.data);
+    };
+  }
+
   onmessage(msg) {
     //Received the WAM descriptor from the processor - could create an HTML UI here, based on descriptor
     if(msg.type == "descriptor") {
@@ -72,6 +151,10 @@ class NAME_PLACEHOLDERController extends WAMController
     else if(msg.verb == "StartIdleTimer") {
       Module.StartIdleTimer();
     }
+    // a WASM_THREADS=1 build's processor can't start web workers itself, see IPlugWAM-awp.js
+    else if(msg.type == "iplugStartWorker") {
+      this.startWorker(msg.name, msg.port);
+    }
 
   }
 }
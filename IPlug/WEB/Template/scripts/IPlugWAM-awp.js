@@ -1,11 +1,77 @@
 /* Declares the NAME_PLACEHOLDER Audio Worklet Processor */
 
+// In a WASM_THREADS=1 build emscripten starts each pthread with new Worker(), which the AudioWorklet doesn't have. This stands in for it, and asks the
+// controller on the page (see IPlugWAM-awn.js) to start a real worker, with the messages between them relayed through a MessagePort. The messages only
+// start the threads, once they are running they share the wasm memory with the processor
+if (typeof AudioWorkletGlobalScope.Worker === 'undefined') {
+  class IPlugWorkletWorker {
+    constructor(url, options) {
+      this.onmessage = null;
+      this.onerror = null;
+      this.name = options && options.name ? options.name : "";
+      this.pending = [];
+      this.port = null;
+
+      if (IPlugWorkletWorker.processorPort)
+        this.connect();
+      else
+        IPlugWorkletWorker.waiting.push(this);
+    }
+
+    connect() {
+      var channel = new MessageChannel();
+      IPlugWorkletWorker.processorPort.postMessage({ type: "iplugStartWorker", name: this.name, port: channel.port2 }, [channel.port2]);
+      this.port = channel.port1;
+      this.port.onmessage = (e) => { if (this.onmessage) this.onmessage(e); };
+      this.pending.forEach((msg) => this.port.postMessage(msg));
+      this.pending = [];
+    }
+
+    postMessage(msg) {
+      if (this.port)
+        this.port.postMessage(msg);
+      else
+        this.pending.push(msg);
+    }
+
+    addEventListener(type, listener) {
+      if (type == "message")
+        this.onmessage = listener;
+      else if (type == "error")
+        this.onerror = listener;
+    }
+
+    terminate() {
+      this.postMessage({ iplugTerminate: true });
+    }
+  }
+
+  IPlugWorkletWorker.waiting = [];
+  IPlugWorkletWorker.processorPort = null;
+  AudioWorkletGlobalScope.Worker = IPlugWorkletWorker;
+}
+
 class NAME_PLACEHOLDER_AWP extends AudioWorkletGlobalScope.WAMProcessor
 {
   constructor(options) {
     options = options || {}
     options.mod = AudioWorkletGlobalScope.WAM.NAME_PLACEHOLDER;
     super(options);
+
+    // the ring buffer for messages to the UI, if the controller could make one (see IPlugWAM-awn.js)
+    var sab = options.processorOptions ? options.processorOptions.iplugRing : undefined;
+
+    if (sab && !options.mod.IPlugRing)
+      options.mod.IPlugRing = { header: new Int32Array(sab, 0, 2), data: new Uint8Array(sab, 8) };
+
+    // workers asked for before there was a processor to ask the page through
+    var WorkletWorker = AudioWorkletGlobalScope.Worker;
+
+    if (WorkletWorker && WorkletWorker.waiting && !WorkletWorker.processorPort) {
+      WorkletWorker.processorPort = this.port;
+      WorkletWorker.waiting.forEach((worker) => worker.connect());
+      WorkletWorker.waiting = [];
+    }
   }
 }
 
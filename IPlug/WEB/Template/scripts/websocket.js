@@ -1,5 +1,15 @@
 /* Sets up a websocket client connection, for iPlug2 remote editors */
 
+// the last control message with each pair of tags, which deltas (SCMDFD) are applied to
+var lastControlMsgs = {};
+
+function sendControlMsgToModule(ctrlTag, msgTag, data) {
+  const esbuf = Module._malloc(data.length);
+  Module.HEAPU8.set(data, esbuf);
+  Module.SCMFD(ctrlTag, msgTag, data.length, esbuf);
+  Module._free(esbuf);
+}
+
 function setupWebSocket(onCompleted) {
   ws = new WebSocket('ws://' + window.location.host + '/ws');
   ws.binaryType = 'arraybuffer';
@@ -27,8 +37,17 @@ function setupWebSocket(onCompleted) {
           var value = dv.getFloat64(pos, true); pos += 8;
           Module.SPVFD(paramIdx, value);
         }
-        //Send Control Message From Delegate
-        else if(prefix == "SCVDD") {
+        //Send Parameter Values From Delegate, several at once
+        else if(prefix == "SPVSFD") {
+          var count = dv.getInt32(pos, true); pos += 4;
+          for (var i = 0; i < count; i++) {
+            var paramIdx = dv.getInt32(pos, true); pos += 4;
+            var value = dv.getFloat64(pos, true); pos += 8;
+            Module.SPVFD(paramIdx, value);
+          }
+        }
+        //Send Control Value From Delegate
+        else if(prefix == "SCVFD" || prefix == "SCVDD") {
           var ctrlTag = dv.getInt32(pos, true); pos += 4;
           var value = dv.getFloat64(pos, true); pos += 8;
           Module.SCVFD(ctrlTag, value);
@@ -40,10 +59,25 @@ function setupWebSocket(onCompleted) {
           var dataSize = dv.getInt32(pos, true); pos += 4;
           var data = new Uint8Array(buf, pos, dataSize);
 
-          const esbuf = Module._malloc(data.length);
-          Module.HEAPU8.set(data, esbuf);
-          Module.SCMFD(ctrlTag, msgTag, data.length, esbuf);
-          Module._free(esbuf);
+          lastControlMsgs[ctrlTag + ":" + msgTag] = new Uint8Array(data);
+          sendControlMsgToModule(ctrlTag, msgTag, data);
+        }
+        //Send Control Message Delta From Delegate, the 32 bit words that changed since the last message with the same tags
+        else if(prefix == "SCMDFD") {
+          var ctrlTag = dv.getInt32(pos, true); pos += 4;
+          var msgTag = dv.getInt32(pos, true); pos += 4;
+          var dataSize = dv.getInt32(pos, true); pos += 4;
+          var count = dv.getInt32(pos, true); pos += 4;
+          var data = lastControlMsgs[ctrlTag + ":" + msgTag];
+
+          if (data && data.length == dataSize) {
+            for (var i = 0; i < count; i++) {
+              var word = dv.getInt32(pos, true); pos += 4;
+              data.set(new Uint8Array(buf, pos, 4), word * 4); pos += 4;
+            }
+
+            sendControlMsgToModule(ctrlTag, msgTag, data);
+          }
         }
         //Send Arbitrary Message From Delegate
         else if(prefix == "SAMFD") {
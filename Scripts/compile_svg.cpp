@@ -0,0 +1,68 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+// Parses SVGs with NanoSVG and writes them in the format read by ICompiledSVG, so that the plug-in doesn't parse XML when it loads them.
+// This is built and run by compile_svgs.py, and takes the units and dpi, followed by pairs of input SVG and output paths:
+//
+//   compile_svg px 72 knob.svg knob.svg.svgbin
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "ICompiledSVG.h"
+
+// after ICompiledSVG.h's include of the declarations, since the implementation isn't include guarded
+#define NANOSVG_IMPLEMENTATION
+#include "nanosvg.h"
+
+using namespace iplug::igraphics;
+
+int main(int argc, char* argv[])
+{
+  if (argc < 5 || (argc - 3) % 2)
+  {
+    fprintf(stderr, "usage: compile_svg units dpi input.svg output.svgbin [input.svg output.svgbin ...]\n");
+    return 1;
+  }
+
+  const char* units = argv[1];
+  const float dpi = static_cast<float>(atof(argv[2]));
+  int result = 0;
+
+  for (int i = 3; i < argc; i += 2)
+  {
+    NSVGimage* pImage = nsvgParseFromFile(argv[i], units, dpi);
+
+    if (!pImage)
+    {
+      fprintf(stderr, "compile_svg: couldn't parse %s\n", argv[i]);
+      result = 1;
+      continue;
+    }
+
+    std::vector<uint8_t> data;
+    ICompiledSVG::Write(pImage, data);
+    nsvgDelete(pImage);
+
+    FILE* pFile = fopen(argv[i + 1], "wb");
+
+    if (!pFile || fwrite(data.data(), 1, data.size(), pFile) != data.size())
+    {
+      fprintf(stderr, "compile_svg: couldn't write %s\n", argv[i + 1]);
+      result = 1;
+    }
+
+    if (pFile)
+      fclose(pFile);
+  }
+
+  return result;
+}
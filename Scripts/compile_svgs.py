@@ -0,0 +1,86 @@
+#!/usr/bin/env python3
+
+# Compiles SVGs into the binary format read by ICompiledSVG, which is NanoSVG's parsed image, so that LoadSVG() doesn't parse XML when the editor opens.
+# Each <name>.svg is written as <name>.svg.svgbin next to it:
+#
+#   python3 $IPLUG2_ROOT/Scripts/compile_svgs.py ../resources/img/
+#
+# LoadSVG() with the NanoSVG renderers (NanoVG, and Skia when IGRAPHICS_NO_SKIA_SVG is defined) loads <name>.svg.svgbin in place of <name>.svg when it is next to it
+# (or, on Windows, when the .rc has a resource of type SVGBIN with the same name as the SVG, e.g. KNOB_FN SVGBIN "knob.svg.svgbin"). The .svgbin can also be embedded
+# with bin2c.py and passed to the LoadSVG() overload that takes memory.
+#
+# The SVGs are parsed with the units and dpi given here, rather than those passed to LoadSVG(). The parser is compile_svg.cpp, which is built with the C++ compiler
+# in $CXX (or c++) the first time the script runs, using the NanoSVG in Dependencies.
+
+import argparse
+import os
+import subprocess
+import sys
+import tempfile
+
+scriptpath = os.path.dirname(os.path.realpath(__file__))
+IPLUG2_ROOT = os.path.normpath(os.path.join(scriptpath, os.pardir))
+TOOL_SOURCES = [os.path.join(scriptpath, "compile_svg.cpp"), os.path.join(IPLUG2_ROOT, "IGraphics", "ICompiledSVG.h")]
+
+def build_tool(cxx):
+  exe = os.path.join(tempfile.gettempdir(), "iplug_compile_svg" + (".exe" if sys.platform == "win32" else ""))
+
+  if os.path.exists(exe) and all(os.path.getmtime(exe) >= os.path.getmtime(src) for src in TOOL_SOURCES):
+    return exe
+
+  includes = [os.path.join(IPLUG2_ROOT, "Dependencies", "IGraphics", "NanoSVG", "src"), os.path.join(IPLUG2_ROOT, "IGraphics"), os.path.join(IPLUG2_ROOT, "IPlug")]
+
+  if os.path.basename(cxx).lower().startswith("cl"):
+    command = [cxx, "/nologo", "/O2", "/EHsc", "/std:c++17"] + ["/I" + i for i in includes] + [TOOL_SOURCES[0], "/Fe" + exe]
+  else:
+    command = [cxx, "-O2", "-std=c++17"] + ["-I" + i for i in includes] + [TOOL_SOURCES[0], "-o", exe]
+
+  print("building " + exe)
+  subprocess.check_call(command)
+  return exe
+
+def find_svgs(paths):
+  svgs = []
+
+  for path in paths:
+    if os.path.isdir(path):
+      for root, dirs, files in os.walk(path):
+        svgs += [os.path.join(root, f) for f in sorted(files) if f.lower().endswith(".svg")]
+    else:
+      svgs.append(path)
+
+  return svgs
+
+def main():
+  parser = argparse.ArgumentParser(description="Compile SVGs for ICompiledSVG, writing <name>.svg.svgbin next to each SVG")
+  parser.add_argument("inputs", nargs="+", help="SVG files, or folders to search for them")
+  parser.add_argument("--units", default="px", help="the units passed to NanoSVG, as for LoadSVG()")
+  parser.add_argument("--dpi", type=float, default=72., help="the dpi passed to NanoSVG, as for LoadSVG()")
+  parser.add_argument("--cxx", default=os.environ.get("CXX", "c++"), help="the C++ compiler used to build the parser")
+  parser.add_argument("--force", action="store_true", help="compile SVGs that are older than their .svgbin")
+  args = parser.parse_args()
+
+  svgs = find_svgs(args.inputs)
+  pairs = []
+
+  for svg in svgs:
+    out = svg + ".svgbin"
+
+    if args.force or not os.path.exists(out) or os.path.getmtime(out) < os.path.getmtime(svg):
+      pairs += [svg, out]
+
+  if not pairs:
+    print("%d SVGs up to date" % len(svgs))
+    return 0
+
+  exe = build_tool(args.cxx)
+  result = subprocess.call([exe, args.units, str(args.dpi)] + pairs)
+
+  for svg, out in zip(pairs[0::2], pairs[1::2]):
+    if os.path.exists(out):
+      print("%s: %d bytes -> %d bytes" % (svg, os.path.getsize(svg), os.path.getsize(out)))
+
+  return result
+
+if __name__ == '__main__':
+  sys.exit(main())
@@ -0,0 +1,496 @@
+/*
+ ==============================================================================
+
+ This file is part of the iPlug 2 library. Copyright (C) the iPlug 2 developers.
+
+ See LICENSE.txt for  more info.
+
+ ==============================================================================
+*/
+
+// Times the DSP classes in IPlug/Extras and prints the ns per sample (per frame per channel) of each, for each sample type, channel count and block size, as JSON.
+// This is built and run by dsp_benchmark.py, which also compares the results against a baseline:
+//
+//   dsp_benchmark --blocks 16,64,512 --channels 1,2,8 --seconds 0.2 [--filter SVF]
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "IPlugConstants.h"
+#include "ADSREnvelope.h"
+#include "LFO.h"
+#include "NChanDelay.h"
+#include "Oscillator.h"
+#include "Oversampler.h"
+#include "Smoothers.h"
+#include "SVF.h"
+#include "VoiceAllocator.h"
+
+using namespace iplug;
+
+namespace
+{
+
+struct Options
+{
+  std::vector<int> blockSizes {16, 64, 512};
+  std::vector<int> channelCounts {1, 2, 8};
+  double seconds = 0.2;
+  int repeats = 5;
+  std::string filter;
+};
+
+/** Signal buffers for one benchmark case, filled with a deterministic noise, so that the filters never settle into denormals or silence */
+template <typename T>
+struct Buffers
+{
+  Buffers(int nChans, int blockSize)
+  : mData(static_cast<size_t>(nChans) * blockSize * 2)
+  {
+    uint32_t seed = 22222;
+
+    for (auto& v : mData)
+    {
+      seed = seed * 196314165 + 907633515;
+      v = static_cast<T>(static_cast<double>(seed) / UINT_MAX * 2. - 1.);
+    }
+
+    for (auto c = 0; c < nChans; c++)
+    {
+      mInputs.push_back(mData.data() + c * blockSize);
+      mOutputs.push_back(mData.data() + (nChans + c) * blockSize);
+    }
+  }
+
+  /** Keep the outputs live, so that the compiler can't drop the work */
+  void Consume(int nFrames)
+  {
+    for (auto* pOutput : mOutputs)
+      mSink += static_cast<double>(pOutput[nFrames - 1]);
+  }
+
+  std::vector<T> mData;
+  std::vector<T*> mInputs, mOutputs;
+  double mSink = 0.;
+};
+
+/** The median time of a number of runs of processBlock(), each as many blocks as fit in the time, in ns per frame per channel */
+double Measure(const Options& options, int nChans, int blockSize, const std::function<void()>& processBlock)
+{
+  using Clock = std::chrono::steady_clock;
+
+  // warm up the caches and the branch predictor, and find how many blocks the time allows
+  int64_t nBlocks = 0;
+  const auto warmUpStart = Clock::now();
+
+  while (std::chrono::duration<double>(Clock::now() - warmUpStart).count() < options.seconds / options.repeats)
+  {
+    processBlock();
+    nBlocks++;
+  }
+
+  std::vector<double> nsPerSample;
+
+  for (auto r = 0; r < options.repeats; r++)
+  {
+    const auto start = Clock::now();
+
+    for (int64_t b = 0; b < nBlocks; b++)
+      processBlock();
+
+    const double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    nsPerSample.push_back(ns / (static_cast<double>(nBlocks) * blockSize * nChans));
+  }
+
+  std::sort(nsPerSample.begin(), nsPerSample.end());
+  return nsPerSample[nsPerSample.size() / 2];
+}
+
+class Benchmark
+{
+public:
+  explicit Benchmark(const Options& options) : mOptions(options) {}
+
+  /** Run a case for every block size and channel count
+   * @param makeCase Set up a case for a channel count and block size, returning the function that processes one block */
+  void Run(const char* name, const char* type, const std::function<std::function<void()>(int nChans, int blockSize)>& makeCase)
+  {
+    if (!mOptions.filter.empty() && std::string(name).find(mOptions.filter) == std::string::npos)
+      return;
+
+    for (auto nChans : mOptions.channelCounts)
+    {
+      for (auto blockSize : mOptions.blockSizes)
+      {
+        const double ns = Measure(mOptions, nChans, blockSize, makeCase(nChans, blockSize));
+        fprintf(stderr, "%-28s %-6s %2d ch %5d frames %8.3f ns/sample\n", name, type, nChans, blockSize, ns);
+        mResults.push_back({name, type, nChans, blockSize, ns});
+      }
+    }
+  }
+
+  void PrintJSON(FILE* pFile) const
+  {
+    fprintf(pFile, "{\n  \"results\": [\n");
+
+    for (size_t i = 0; i < mResults.size(); i++)
+    {
+      const Result& r = mResults[i];
+      fprintf(pFile, "    {\"name\": \"%s\", \"type\": \"%s\", \"channels\": %d, \"block_size\": %d, \"ns_per_sample\": %.4f}%s\n",
+              r.name.c_str(), r.type.c_str(), r.nChans, r.blockSize, r.nsPerSample, i + 1 < mResults.size() ? "," : "");
+    }
+
+    fprintf(pFile, "  ]\n}\n");
+  }
+
+private:
+  struct Result
+  {
+    std::string name;
+    std::string type;
+    int nChans;
+    int blockSize;
+    double nsPerSample;
+  };
+
+  const Options& mOptions;
+  std::vector<Result> mResults;
+};
+
+template <typename T>
+const char* TypeName() { return sizeof(T) == sizeof(float) ? "float" : "double"; }
+
+template <typename T>
+void RunOverSampler(Benchmark& bench, const char* name, EFactor factor, EOverSamplingMode mode)
+{
+  bench.Run(name, TypeName<T>(), [factor, mode](int nChans, int blockSize) {
+    auto pBufs = std::make_shared<Buffers<T>>(nChans, blockSize);
+    auto pOverSampler = std::make_shared<OverSampler<T>>(factor, true, nChans, nChans, mode);
+    pOverSampler->Reset(blockSize);
+
+    return [pBufs, pOverSampler, nChans, blockSize]() {
+      // the oversampled process is a gain, so that the time is that of the resampling
+      pOverSampler->ProcessBlock(pBufs->mInputs.data(), pBufs->mOutputs.data(), blockSize, nChans, nChans, [nChans](T** inputs, T** outputs, int nFrames) {
+        for (auto c = 0; c < nChans; c++)
+          for (auto s = 0; s < nFrames; s++)
+            outputs[c][s] = inputs[c][s] * static_cast<T>(0.5);
+      });
+      pBufs->Consume(blockSize);
+    };
+  });
+}
+
+template <typename T>
+void RunSVF(Benchmark& bench)
+{
+  static constexpr int kMaxChans = 8;
+
+  bench.Run("SVF", TypeName<T>(), [](int nChans, int blockSize) {
+    auto pBufs = std::make_shared<Buffers<T>>(nChans, blockSize);
+    auto pFilter = std::make_shared<SVF<T, kMaxChans>>(SVF<T, kMaxChans>::kLowPass, 1000.);
+    pFilter->SetQ(2.);
+
+    return [pBufs, pFilter, nChans, blockSize]() {
+      pFilter->ProcessBlock(pBufs->mInputs.data(), pBufs->mOutputs.data(), std::min(nChans, kMaxChans), blockSize);
+      pBufs->Consume(blockSize);
+    };
+  });
+
+  bench.Run("SVF modulated", TypeName<T>(), [](int nChans, int blockSize) {
+    auto pBufs = std::make_shared<Buffers<T>>(nChans, blockSize);
+    auto pFilter = std::make_shared<SVF<T, kMaxChans>>(SVF<T, kMaxChans>::kLowPass, 1000.);
+    auto pFreqs = std::make_shared<std::vector<T>>(blockSize);
+
+    for (auto s = 0; s < blockSize; s++)
+      (*pFreqs)[s] = static_cast<T>(500. + 4000. * s / blockSize);
+
+    return [pBufs, pFilter, pFreqs, nChans, blockSize]() {
+      pFilter->ProcessBlock(pBufs->mInputs.data(), pBufs->mOutputs.data(), pFreqs->data(), std::min(nChans, kMaxChans), blockSize);
+      pBufs->Consume(blockSize);
+    };
+  });
+}
+
+/** Mono classes are run once per channel */
+template <typename T>
+void RunOscillators(Benchmark& bench)
+{
+  bench.Run("FastSinOscillator", TypeName<T>(), [](int nChans, int blockSize) {
+    auto pBufs = std::make_shared<Buffers<T>>(nChans, blockSize);
+    auto pOscs = std::make_shared<std::vector<FastSinOscillator<T>>>(nChans);
+
+    for (auto c = 0; c < nChans; c++)
+      (*pOscs)[c].SetFreqCPS(110. * (c + 1));
+
+    return [pBufs, pOscs, nChans, blockSize]() {
+      for (auto c = 0; c < nChans; c++)
+        (*pOscs)[c].ProcessBlock(pBufs->mOutputs[c], blockSize);
+      pBufs->Consume(blockSize);
+    };
+  });
+
+  bench.Run("LFO", TypeName<T>(), [](int nChans, int blockSize) {
+    auto pBufs = std::make_shared<Buffers<T>>(nChans, blockSize);
+    auto pLFOs = std::make_shared<std::vector<LFO<T>>>(nChans);
+
+    for (auto c = 0; c < nChans; c++)
+    {
+      (*pLFOs)[c].SetFreqCPS(1. + c);
+      (*pLFOs)[c].SetShape(c % LFO<T>::kNumShapes);
+    }
+
+    return [pBufs, pLFOs, nChans, blockSize]() {
+      for (auto c = 0; c < nChans; c++)
+        (*pLFOs)[c].ProcessBlock(pBufs->mOutputs[c], blockSize);
+      pBufs->Consume(blockSize);
+    };
+  });
+}
+
+template <typename T>
+void RunADSREnvelope(Benchmark& bench)
+{
+  bench.Run("ADSREnvelope", TypeName<T>(), [](int nChans, int blockSize) {
+    auto pBufs = std::make_shared<Buffers<T>>(nChans, blockSize);
+    auto pEnvs = std::make_shared<std::vector<ADSREnvelope<T>>>(nChans);
+    auto pFrame = std::make_shared<int64_t>(0);
+
+    for (auto& env : *pEnvs)
+    {
+      env.SetSampleRate(44100.);
+      env.SetStageTime(ADSREnvelope<T>::kAttack, 5.);
+      env.SetStageTime(ADSREnvelope<T>::kDecay, 20.);
+      env.SetStageTime(ADSREnvelope<T>::kRelease, 30.);
+    }
+
+    return [pBufs, pEnvs, pFrame, nChans, blockSize]() {
+      // a note of about 100 ms every 200 ms, so that every stage is timed
+      const int64_t phase = *pFrame % 8820;
+      *pFrame += blockSize;
+
+      for (auto c = 0; c < nChans; c++)
+      {
+        ADSREnvelope<T>& env = (*pEnvs)[c];
+
+        if (phase < blockSize && !env.GetBusy())
+          env.Start(1.);
+        else if (phase >= 4410 && phase < 4410 + blockSize)
+          env.Release();
+
+        env.ProcessBlock(pBufs->mOutputs[c], blockSize, static_cast<T>(0.5));
+      }
+
+      pBufs->Consume(blockSize);
+    };
+  });
+}
+
+template <typename T, int NC>
+std::function<void()> MakeLogParamSmoothCase(int blockSize)
+{
+  auto pBufs = std::make_shared<Buffers<T>>(NC, blockSize);
+  auto pSmoother = std::make_shared<LogParamSmooth<T, NC>>(5.);
+  auto pBlock = std::make_shared<int>(0);
+
+  return [pBufs, pSmoother, pBlock, blockSize]() {
+    T targets[NC];
+
+    // a new target every few blocks, as when a parameter is automated
+    for (auto c = 0; c < NC; c++)
+      targets[c] = static_cast<T>(((*pBlock / 4) + c) % 2);
+
+    (*pBlock)++;
+    pSmoother->ProcessBlock(targets, pBufs->mOutputs.data(), blockSize);
+    pBufs->Consume(blockSize);
+  };
+}
+
+template <typename T>
+void RunLogParamSmooth(Benchmark& bench)
+{
+  bench.Run("LogParamSmooth", TypeName<T>(), [](int nChans, int blockSize) {
+    switch (nChans)
+    {
+      case 1: return MakeLogParamSmoothCase<T, 1>(blockSize);
+      case 2: return MakeLogParamSmoothCase<T, 2>(blockSize);
+      case 4: return MakeLogParamSmoothCase<T, 4>(blockSize);
+      default: return MakeLogParamSmoothCase<T, 8>(blockSize);
+    }
+  });
+}
+
+template <typename T>
+void RunNChanDelayLine(Benchmark& bench)
+{
+  bench.Run("NChanDelayLine", TypeName<T>(), [](int nChans, int blockSize) {
+    auto pBufs = std::make_shared<Buffers<T>>(nChans, blockSize);
+    auto pDelay = std::make_shared<NChanDelayLine<T>>(nChans, nChans);
+    pDelay->SetMaxDelayTime(48000.);
+    pDelay->SetDelayTime(1234);
+
+    return [pBufs, pDelay, blockSize]() {
+      pDelay->ProcessBlock(pBufs->mInputs.data(), pBufs->mOutputs.data(), blockSize);
+      pBufs->Consume(blockSize);
+    };
+  });
+}
+
+/** A voice that does very little, so that the time is the allocator's */
+class BenchmarkVoice : public SynthVoice
+{
+public:
+  bool GetBusy() const override { return mBusy; }
+  void Trigger(double level, bool isRetrigger) override { mBusy = true; }
+  void Release() override { mBusy = false; }
+
+  void ProcessSamplesAccumulating(sample** inputs, sample** outputs, int nInputs, int nOutputs, int startIdx, int nFrames) override
+  {
+    const sample gain = static_cast<sample>(mInputs[kVoiceControlGate].endValue * 0.1);
+
+    for (auto c = 0; c < nOutputs; c++)
+      for (auto s = startIdx; s < startIdx + nFrames; s++)
+        outputs[c][s] += gain;
+  }
+
+private:
+  bool mBusy = false;
+};
+
+/** The allocator's event handling and voice dispatch for 16 voices, with a note on and the previous note's note off every 1024 frames, and a pitch bend every block */
+void RunVoiceAllocator(Benchmark& bench)
+{
+  static constexpr int kNVoices = 16;
+
+  bench.Run("VoiceAllocator", TypeName<sample>(), [](int nChans, int blockSize) {
+    struct State
+    {
+      VoiceAllocator allocator;
+      BenchmarkVoice voices[kNVoices];
+      int64_t frame = 0;
+      int key = 60;
+    };
+
+    auto pBufs = std::make_shared<Buffers<sample>>(nChans, blockSize);
+    auto pState = std::make_shared<State>();
+
+    for (auto& voice : pState->voices)
+      pState->allocator.AddVoice(&voice, 0);
+
+    pState->allocator.SetSampleRateAndBlockSize(44100., blockSize);
+
+    return [pBufs, pState, nChans, blockSize]() {
+      State& state = *pState;
+      VoiceInputEvent event {};
+
+      for (auto offset = static_cast<int>((1024 - state.frame % 1024) % 1024); offset < blockSize; offset += 1024)
+      {
+        event.mSampleOffset = offset;
+        event.mAction = kNoteOffAction;
+        event.mAddress.mKey = static_cast<uint8_t>(state.key);
+        state.allocator.AddEvent(event);
+
+        state.key = 36 + (state.key - 36 + 7) % 48;
+        event.mAction = kNoteOnAction;
+        event.mAddress.mKey = static_cast<uint8_t>(state.key);
+        event.mValue = 0.8f;
+        state.allocator.AddEvent(event);
+      }
+
+      event.mSampleOffset = 0;
+      event.mAction = kPitchBendAction;
+      event.mAddress.mKey = 0;
+      event.mValue = static_cast<float>((state.frame / blockSize) % 64) / 64.f;
+      state.allocator.AddEvent(event);
+
+      for (auto c = 0; c < nChans; c++)
+        memset(pBufs->mOutputs[c], 0, blockSize * sizeof(sample));
+
+      state.allocator.ProcessEvents(blockSize, state.frame);
+      state.allocator.ProcessVoices(pBufs->mInputs.data(), pBufs->mOutputs.data(), nChans, nChans, 0, blockSize);
+      state.frame += blockSize;
+      pBufs->Consume(blockSize);
+    };
+  });
+}
+
+template <typename T>
+void RunAll(Benchmark& bench)
+{
+  RunOverSampler<T>(bench, "OverSampler 4x", EFactor::k4x, EOverSamplingMode::kMinimumLatency);
+  RunOverSampler<T>(bench, "OverSampler 4x linear phase", EFactor::k4x, EOverSamplingMode::kLinearPhase);
+  RunSVF<T>(bench);
+  RunOscillators<T>(bench);
+  RunADSREnvelope<T>(bench);
+  RunLogParamSmooth<T>(bench);
+  RunNChanDelayLine<T>(bench);
+}
+
+std::vector<int> ParseList(const char* str)
+{
+  std::vector<int> values;
+
+  for (const char* p = str; *p; )
+  {
+    char* pEnd = nullptr;
+    const long value = strtol(p, &pEnd, 10);
+
+    if (pEnd == p)
+      break;
+
+    if (value > 0)
+      values.push_back(static_cast<int>(value));
+
+    p = *pEnd == ',' ? pEnd + 1 : pEnd;
+  }
+
+  return values;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+  Options options;
+
+  for (auto i = 1; i < argc; i++)
+  {
+    const bool hasValue = i + 1 < argc;
+
+    if (!strcmp(argv[i], "--blocks") && hasValue)
+      options.blockSizes = ParseList(argv[++i]);
+    else if (!strcmp(argv[i], "--channels") && hasValue)
+      options.channelCounts = ParseList(argv[++i]);
+    else if (!strcmp(argv[i], "--seconds") && hasValue)
+      options.seconds = std::max(atof(argv[++i]), 0.001);
+    else if (!strcmp(argv[i], "--repeats") && hasValue)
+      options.repeats = std::max(atoi(argv[++i]), 1);
+    else if (!strcmp(argv[i], "--filter") && hasValue)
+      options.filter = argv[++i];
+    else
+    {
+      fprintf(stderr, "usage: dsp_benchmark [--blocks 16,64,512] [--channels 1,2,8] [--seconds 0.2] [--repeats 5] [--filter name]\n");
+      return 1;
+    }
+  }
+
+  if (options.blockSizes.empty() || options.channelCounts.empty())
+  {
+    fprintf(stderr, "dsp_benchmark: no block sizes or channel counts\n");
+    return 1;
+  }
+
+  Benchmark bench(options);
+  RunAll<float>(bench);
+  RunAll<double>(bench);
+  RunVoiceAllocator(bench);
+  bench.PrintJSON(stdout);
+  return 0;
+}
@@ -0,0 +1,134 @@
+#!/usr/bin/env python3
+
+# Benchmarks the DSP classes in IPlug/Extras (OverSampler, SVF, FastSinOscillator, LFO, ADSREnvelope, LogParamSmooth, NChanDelayLine and VoiceAllocator),
+# printing the ns per sample of each for float and double, and for each channel count and block size, and writing the results as JSON:
+#
+#   python3 $IPLUG2_ROOT/Scripts/dsp_benchmark.py --output results.json
+#
+# With --baseline, the results are compared against an earlier run's JSON, and the script fails if any case is slower than the baseline by more than the tolerance,
+# so that optimisations can be checked and regressions caught. Timings are only comparable on the same machine and compiler, so baselines aren't kept in the repo:
+#
+#   python3 dsp_benchmark.py --output baseline.json
+#   (make the change)
+#   python3 dsp_benchmark.py --baseline baseline.json --tolerance 0.1
+#
+# The benchmark is dsp_benchmark.cpp, which is built with the C++ compiler in $CXX (or c++) when it changes, with -O3, and -march=native if --native is given.
+# --float builds VoiceAllocator, which renders iplug::sample, with SAMPLE_TYPE_FLOAT; the other classes are timed with both types in every build.
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import tempfile
+
+scriptpath = os.path.dirname(os.path.realpath(__file__))
+IPLUG2_ROOT = os.path.normpath(os.path.join(scriptpath, os.pardir))
+EXTRAS = os.path.join(IPLUG2_ROOT, "IPlug", "Extras")
+TOOL_SOURCES = [os.path.join(scriptpath, "dsp_benchmark.cpp"), os.path.join(EXTRAS, "Synth", "VoiceAllocator.cpp")]
+HEADER_DIRS = [os.path.join(IPLUG2_ROOT, "IPlug"), EXTRAS, os.path.join(EXTRAS, "Synth"), os.path.join(IPLUG2_ROOT, "WDL")]
+
+def newest_source_time():
+  newest = max(os.path.getmtime(src) for src in TOOL_SOURCES)
+
+  # the classes being timed are header only, so the benchmark is rebuilt whenever any IPlug header changes
+  for d in HEADER_DIRS[:3]:
+    for f in os.listdir(d):
+      if f.endswith(".h"):
+        newest = max(newest, os.path.getmtime(os.path.join(d, f)))
+
+  return newest
+
+def build_tool(cxx, native, use_float):
+  suffix = ("_native" if native else "") + ("_float" if use_float else "")
+  exe = os.path.join(tempfile.gettempdir(), "iplug_dsp_benchmark" + suffix + (".exe" if sys.platform == "win32" else ""))
+
+  if os.path.exists(exe) and os.path.getmtime(exe) >= newest_source_time():
+    return exe
+
+  if os.path.basename(cxx).lower().startswith("cl"):
+    command = [cxx, "/nologo", "/O2", "/EHsc", "/std:c++17", "/DNOMINMAX"] + ["/I" + i for i in HEADER_DIRS] + TOOL_SOURCES + ["/Fe" + exe]
+    command += ["/arch:AVX2"] if native else []
+    command += ["/DSAMPLE_TYPE_FLOAT"] if use_float else []
+  else:
+    command = [cxx, "-O3", "-std=c++17", "-Wno-multichar"] + ["-I" + i for i in HEADER_DIRS] + TOOL_SOURCES + ["-o", exe]
+    command += ["-march=native"] if native else []
+    command += ["-DSAMPLE_TYPE_FLOAT"] if use_float else []
+
+  print("building " + exe)
+  subprocess.check_call(command)
+  return exe
+
+def result_key(result):
+  return (result["name"], result["type"], result["channels"], result["block_size"])
+
+def compare(results, baseline, tolerance):
+  baseline_by_key = {result_key(r): r["ns_per_sample"] for r in baseline["results"]}
+  regressions = 0
+
+  print("\n%-28s %-6s %4s %6s %10s %10s %8s" % ("name", "type", "ch", "block", "baseline", "ns/sample", "change"))
+
+  for r in results["results"]:
+    key = result_key(r)
+
+    if key not in baseline_by_key:
+      print("%-28s %-6s %4d %6d %10s %10.3f %8s" % (key + ("-", r["ns_per_sample"], "new")))
+      continue
+
+    old = baseline_by_key[key]
+    change = r["ns_per_sample"] / old - 1. if old > 0. else 0.
+    flag = ""
+
+    if change > tolerance:
+      flag = "  SLOWER"
+      regressions += 1
+    elif change < -tolerance:
+      flag = "  faster"
+
+    print("%-28s %-6s %4d %6d %10.3f %10.3f %+7.1f%%%s" % (key + (old, r["ns_per_sample"], change * 100., flag)))
+
+  if regressions:
+    print("\n%d of %d cases are more than %d%% slower than the baseline" % (regressions, len(results["results"]), tolerance * 100.))
+  else:
+    print("\nno case is more than %d%% slower than the baseline" % (tolerance * 100.))
+
+  return regressions
+
+def main():
+  parser = argparse.ArgumentParser(description="Benchmark the DSP classes in IPlug/Extras, optionally comparing against a baseline")
+  parser.add_argument("--blocks", default="16,64,512", help="comma separated block sizes")
+  parser.add_argument("--channels", default="1,2,8", help="comma separated channel counts")
+  parser.add_argument("--seconds", type=float, default=0.2, help="the time spent on each case")
+  parser.add_argument("--repeats", type=int, default=5, help="the number of runs of each case, of which the median is reported")
+  parser.add_argument("--filter", default="", help="only run the classes whose name contains this")
+  parser.add_argument("--output", help="write the results as JSON to this file")
+  parser.add_argument("--baseline", help="compare against the JSON of an earlier run")
+  parser.add_argument("--tolerance", type=float, default=0.1, help="the fraction by which a case may be slower than the baseline")
+  parser.add_argument("--native", action="store_true", help="build for the instruction sets of this machine")
+  parser.add_argument("--float", action="store_true", help="build with SAMPLE_TYPE_FLOAT")
+  parser.add_argument("--cxx", default=os.environ.get("CXX", "c++"), help="the C++ compiler used to build the benchmark")
+  args = parser.parse_args()
+
+  exe = build_tool(args.cxx, args.native, args.float)
+  command = [exe, "--blocks", args.blocks, "--channels", args.channels, "--seconds", str(args.seconds), "--repeats", str(args.repeats)]
+
+  if args.filter:
+    command += ["--filter", args.filter]
+
+  output = subprocess.check_output(command)
+  results = json.loads(output)
+
+  if args.output:
+    with open(args.output, "w") as f:
+      json.dump(results, f, indent=2)
+
+  if args.baseline:
+    with open(args.baseline) as f:
+      baseline = json.load(f)
+
+    return 1 if compare(results, baseline, args.tolerance) else 0
+
+  return 0
+
+if __name__ == '__main__':
+  sys.exit(main())
@@ -0,0 +1,235 @@
+#!/usr/bin/env python3
+
+# Converts PNG bitmaps, e.g. large film-strip knobs, into GPU compressed textures in KTX (version 1) files, which take 4x less video memory than RGBA
+# and skip PNG decoding when they are loaded. Each <name>.png is written as <name>.png.ktx, including the @2x versions:
+#
+#   python3 $IPLUG2_ROOT/Scripts/make_compressed_textures.py --format bc7 ../resources/img/knob.png ../resources/img/knob@2x.png
+#
+# LoadBitmap() with the NanoVG GL and Metal back-ends loads <name>.png.ktx in place of <name>.png when it is next to it (or, on Windows, when the .rc
+# has a resource of type KTX with the same name as the PNG, e.g. KNOB_FN KTX "knob.png.ktx"), and the GPU supports the format. Otherwise the PNG is loaded.
+# On iOS, .ktx files in the bundle are already preloaded as textures by IGraphicsIOS.
+#
+# BC7 is supported by desktop GPUs, and is encoded by this script (mode 6 only, using the python standard library, on all cores). Mode 6 fits one line of RGBA
+# colors per 4x4 block, so antialiased edges between several colors lose detail: for those, any encoder that writes BC7 KTX files can be used instead.
+# ASTC 4x4 is supported by Apple silicon and mobile GPUs, and is encoded with ARM's astcenc, which must be installed (https://github.com/ARM-software/astc-encoder).
+
+import argparse
+import multiprocessing
+import os
+import struct
+import subprocess
+import sys
+import tempfile
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from pack_bitmaps import read_png
+
+KTX_IDENTIFIER = b'\xabKTX 11\xbb\r\n\x1a\n'
+GL_RGBA = 0x1908
+GL_COMPRESSED_RGBA_BPTC_UNORM = 0x8E8C
+GL_COMPRESSED_RGBA_ASTC_4x4_KHR = 0x93B0
+ASTC_MAGIC = 0x5CA1AB13
+
+BC7_WEIGHTS = [0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64]
+
+def write_ktx(path, internal_format, width, height, data):
+  header = struct.pack('<12s13I', KTX_IDENTIFIER, 0x04030201,
+    0, 1, 0, internal_format, GL_RGBA, # glType, glTypeSize, glFormat, glInternalFormat, glBaseInternalFormat
+    width, height, 0, 0, 1, 1, 0) # pixelDepth, numberOfArrayElements, numberOfFaces, numberOfMipmapLevels, bytesOfKeyValueData
+
+  with open(path, 'wb') as fd:
+    fd.write(header)
+    fd.write(struct.pack('<I', len(data)))
+    fd.write(data)
+
+def block_pixels(image, bx, by):
+  # the 16 RGBA pixels of a 4x4 block, repeating the edge pixels of images that aren't a multiple of 4
+  pixels = []
+  for y in range(4):
+    row = image.rows[min(by * 4 + y, image.height - 1)]
+    for x in range(4):
+      i = min(bx * 4 + x, image.width - 1) * 4
+      pixels.append(tuple(row[i:i + 4]))
+  return pixels
+
+def quantize_endpoint(c):
+  # the 7 bit channels and the shared p-bit of a mode 6 endpoint that are closest to c
+  best = None
+  for p in (0, 1):
+    q = [max(0, min(127, int(round((v - p) / 2.0)))) for v in c]
+    err = sum((((v << 1) | p) - t) ** 2 for v, t in zip(q, c))
+    if best is None or err < best[0]:
+      best = (err, q, p)
+  return best[1], best[2]
+
+def bc7_palette(q0, p0, q1, p1):
+  c0 = [(v << 1) | p0 for v in q0]
+  c1 = [(v << 1) | p1 for v in q1]
+  return [[((64 - w) * a + w * b + 32) >> 6 for a, b in zip(c0, c1)] for w in BC7_WEIGHTS]
+
+def bc7_pixel_error(p, e):
+  # the color of a pixel matters in proportion to its alpha
+  a = (p[3] + 1) / 256.0
+  return a * sum((p[c] - e[c]) ** 2 for c in range(3)) + (p[3] - e[3]) ** 2
+
+def bc7_fit_indices(pixels, palette):
+  indices = []
+  total = 0.0
+  for p in pixels:
+    errors = [bc7_pixel_error(p, e) for e in palette]
+    error = min(errors)
+    indices.append(errors.index(error))
+    total += error
+  return indices, total
+
+def bc7_fit_endpoints(pixels, indices):
+  # the least squares endpoints for the weights given by the indices, per channel, with the color of each pixel weighted by its alpha as in bc7_pixel_error()
+  e0 = [0.0] * 4
+  e1 = [0.0] * 4
+  for ch in range(4):
+    a = b = c = x0 = x1 = 0.0
+    for p, index in zip(pixels, indices):
+      w = BC7_WEIGHTS[index] / 64.0
+      k = 1.0 if ch == 3 else (p[3] + 1) / 256.0
+      a += k * (1 - w) * (1 - w)
+      b += k * (1 - w) * w
+      c += k * w * w
+      x0 += k * (1 - w) * p[ch]
+      x1 += k * w * p[ch]
+    det = a * c - b * b
+    if abs(det) < 1e-9:
+      return None
+    e0[ch] = max(0, min(255, (c * x0 - b * x1) / det))
+    e1[ch] = max(0, min(255, (a * x1 - b * x0) / det))
+  return e0, e1
+
+def encode_bc7_block(pixels):
+  # BC7 mode 6: one subset, 7 bit RGBA endpoints with a p-bit each and 4 bit indices.
+  # The endpoints start as the extremes along the principal axis, and are refined by least squares
+  n = len(pixels)
+  mean = [sum(p[c] for p in pixels) / n for c in range(4)]
+  axis = [max(p[c] for p in pixels) - min(p[c] for p in pixels) for c in range(4)]
+
+  for _ in range(4):
+    new_axis = [0.0] * 4
+    for p in pixels:
+      d = [p[c] - mean[c] for c in range(4)]
+      dot = sum(d[c] * axis[c] for c in range(4))
+      for c in range(4):
+        new_axis[c] += d[c] * dot
+    length = sum(v * v for v in new_axis) ** 0.5
+    if length < 1e-6:
+      break
+    axis = [v / length for v in new_axis]
+
+  length = sum(v * v for v in axis) ** 0.5
+  if length > 1e-6:
+    axis = [v / length for v in axis]
+    proj = [sum((p[c] - mean[c]) * axis[c] for c in range(4)) for p in pixels]
+    lo, hi = min(proj), max(proj)
+  else:
+    lo = hi = 0.0
+
+  # the extremes along the principal axis, the two pixels that are furthest apart, and the least and most opaque pixels
+  seeds = [([max(0, min(255, mean[c] + lo * axis[c])) for c in range(4)], [max(0, min(255, mean[c] + hi * axis[c])) for c in range(4)])]
+  seeds.append(max(((p, q) for p in pixels for q in pixels), key=lambda pq: bc7_pixel_error(pq[0], pq[1]) + bc7_pixel_error(pq[1], pq[0])))
+  seeds.append((min(pixels, key=lambda p: p[3]), max(pixels, key=lambda p: p[3])))
+  best = None
+
+  for e0, e1 in seeds:
+    for _ in range(3):
+      q0, p0 = quantize_endpoint(e0)
+      q1, p1 = quantize_endpoint(e1)
+      indices, error = bc7_fit_indices(pixels, bc7_palette(q0, p0, q1, p1))
+      if best is None or error < best[0]:
+        best = (error, q0, p0, q1, p1, indices)
+      endpoints = bc7_fit_endpoints(pixels, indices)
+      if endpoints is None:
+        break
+      e0, e1 = endpoints
+
+  _, q0, p0, q1, p1, indices = best
+
+  # the most significant bit of the first index is implicitly 0
+  if indices[0] >= 8:
+    q0, q1, p0, p1 = q1, q0, p1, p0
+    indices = [15 - i for i in indices]
+
+  bits = 1 << 6 # mode 6
+  pos = 7
+  for c in range(4):
+    bits |= q0[c] << pos
+    bits |= q1[c] << (pos + 7)
+    pos += 14
+  bits |= p0 << pos
+  bits |= p1 << (pos + 1)
+  pos += 2
+  for i, index in enumerate(indices):
+    bits |= index << pos
+    pos += 3 if i == 0 else 4
+
+  return bits.to_bytes(16, 'little')
+
+_image = None
+
+def init_bc7_worker(path):
+  global _image
+  _image = read_png(path)
+
+def encode_bc7_row(by):
+  return b''.join(encode_bc7_block(block_pixels(_image, bx, by)) for bx in range((_image.width + 3) // 4))
+
+def encode_bc7(path):
+  image = read_png(path)
+
+  # each worker process decodes the PNG once, and encodes rows of blocks
+  with multiprocessing.Pool(initializer=init_bc7_worker, initargs=(path,)) as pool:
+    rows = pool.map(encode_bc7_row, range((image.height + 3) // 4))
+
+  return image.width, image.height, b''.join(rows)
+
+def encode_astc(path, astcenc, quality):
+  with tempfile.TemporaryDirectory() as tmp:
+    out = os.path.join(tmp, 'out.astc')
+    subprocess.check_call([astcenc, '-cl', path, out, '4x4', '-' + quality])
+
+    with open(out, 'rb') as fd:
+      data = fd.read()
+
+  magic, bw, bh, _ = struct.unpack('<IBBB', data[:7])
+  if magic != ASTC_MAGIC or (bw, bh) != (4, 4):
+    raise Exception('astcenc did not write a 4x4 .astc file for %s' % path)
+
+  width = data[7] | (data[8] << 8) | (data[9] << 16)
+  height = data[10] | (data[11] << 8) | (data[12] << 16)
+  return width, height, data[16:]
+
+def main(argv):
+  parser = argparse.ArgumentParser(description='Convert PNG bitmaps into BC7 or ASTC compressed textures in KTX files')
+  parser.add_argument('-f', '--format', choices=['bc7', 'astc'], default='bc7',
+    help='The compressed format')
+  parser.add_argument('-o', '--output-dir', type=str, default=None,
+    help='Directory to write the textures to, by default next to each PNG')
+  parser.add_argument('--astcenc', type=str, default='astcenc',
+    help='The astcenc executable, for --format astc')
+  parser.add_argument('--astc-quality', choices=['fastest', 'fast', 'medium', 'thorough', 'exhaustive'], default='thorough',
+    help='The astcenc quality preset')
+  parser.add_argument('inputs', type=str, nargs='+',
+    help='Input PNG files')
+  args = parser.parse_args(argv)
+
+  for path in args.inputs:
+    if args.format == 'bc7':
+      width, height, data = encode_bc7(path)
+      internal_format = GL_COMPRESSED_RGBA_BPTC_UNORM
+    else:
+      width, height, data = encode_astc(path, args.astcenc, args.astc_quality)
+      internal_format = GL_COMPRESSED_RGBA_ASTC_4x4_KHR
+
+    out_dir = args.output_dir if args.output_dir else os.path.dirname(path)
+    out_path = os.path.join(out_dir, os.path.basename(path) + '.ktx')
+    write_ktx(out_path, internal_format, width, height, data)
+    print('%s: %ix%i, %i KB' % (out_path, width, height, len(data) // 1024))
+
+if __name__ == '__main__':
+  main(sys.argv[1:])
@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+
+# Writes a script listing the PNG and JPEG bitmaps of a web build, so that IGraphicsWeb can fetch them when they are first loaded by LoadBitmap(),
+# rather than preloading them all in imgs.data before the UI appears. Use it in place of the file_packager.py step for the images in makedist-web.sh:
+#
+#   python3 $IPLUG2_ROOT/Scripts/make_lazy_images.py ../resources/img/ > imgs.js
+#   mkdir -p resources/img && cp ../resources/img/*.png resources/img/
+#
+# Each entry records the size of the image, so that a blank bitmap of the right size can be drawn until it arrives.
+# The images are fetched relative to Module.lazyImagesURL (the page's folder by default), and kept with the Cache API
+# in the cache named by Module.lazyImagesCacheName, which should be changed when the images change.
+# Only uses the python standard library. Only works with the Canvas2D back-end (IGRAPHICS_CANVAS).
+
+import argparse
+import json
+import os
+import struct
+import sys
+
+PNG_SIGNATURE = b'\x89PNG\r\n\x1a\n'
+
+def png_size(data):
+  if data[:8] != PNG_SIGNATURE or data[12:16] != b'IHDR':
+    return None
+  return struct.unpack('>II', data[16:24])
+
+def jpeg_size(data):
+  if data[:2] != b'\xff\xd8':
+    return None
+  pos = 2
+  while pos + 9 < len(data):
+    if data[pos] != 0xff:
+      return None
+    marker = data[pos + 1]
+    length = struct.unpack('>H', data[pos + 2:pos + 4])[0]
+    # start of frame markers, apart from DHT, JPG and DAC
+    if 0xc0 <= marker <= 0xcf and marker not in (0xc4, 0xc8, 0xcc):
+      height, width = struct.unpack('>HH', data[pos + 5:pos + 9])
+      return width, height
+    pos += 2 + length
+  return None
+
+def main():
+  parser = argparse.ArgumentParser(description='List the images of a web build, for IGraphicsWeb to fetch on demand')
+  parser.add_argument('folder', help='the folder of images, e.g. resources/img/')
+  parser.add_argument('--prefix', default='/resources/img/', help='the path the images are looked up by, which is also the path they are fetched from')
+  args = parser.parse_args()
+
+  images = {}
+
+  for name in sorted(os.listdir(args.folder)):
+    ext = os.path.splitext(name)[1].lower()
+
+    if ext not in ('.png', '.jpg', '.jpeg'):
+      continue
+
+    with open(os.path.join(args.folder, name), 'rb') as f:
+      data = f.read()
+
+    size = png_size(data) if ext == '.png' else jpeg_size(data)
+
+    if size is None:
+      print('Skipping ' + name + ', which could not be read', file=sys.stderr)
+      continue
+
+    images[args.prefix + name] = list(size)
+
+  sys.stdout.write('var Module = typeof Module !== \'undefined\' ? Module : {};\n')
+  sys.stdout.write('Module.preloadedImages = Module.preloadedImages || {};\n')
+  sys.stdout.write('Module.lazyImages = ' + json.dumps(images, separators=(',', ':')) + ';\n')
+
+if __name__ == '__main__':
+  main()
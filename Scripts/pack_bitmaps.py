@@ -0,0 +1,231 @@
+#!/usr/bin/env python3
+
+# Packs PNG bitmaps, e.g. film-strip knobs and small icons, into a few atlas pages and writes a header with the region of each bitmap.
+# A region is drawn by constructing an IBitmap from the page, which means every bitmap on a page is drawn from the same texture:
+#
+#   IBitmap page = pGraphics->LoadBitmap(KNOB_ATLAS_PAGE);
+#   IBitmap knob(page, KNOB_ATLAS_RECT, 60, false);
+#
+# If every input has an @2x version, an @2x version of each page is written with the same layout, so that LoadBitmap() can pick it on hi-dpi screens.
+# Only uses the python standard library, supporting 8 bit non-interlaced PNGs.
+
+import argparse
+import os
+import re
+import struct
+import sys
+import zlib
+
+PNG_SIGNATURE = b'\x89PNG\r\n\x1a\n'
+NON_NAME_PATTERN = re.compile(r'[^A-Za-z0-9_]')
+
+class Image:
+  def __init__(self, width, height, rows=None):
+    self.width = width
+    self.height = height
+    # rows of RGBA bytes
+    self.rows = rows if rows is not None else [bytearray(width * 4) for _ in range(height)]
+
+  def blit(self, src, x, y):
+    for r in range(src.height):
+      self.rows[y + r][x * 4:(x + src.width) * 4] = src.rows[r]
+
+def paeth(a, b, c):
+  p = a + b - c
+  pa, pb, pc = abs(p - a), abs(p - b), abs(p - c)
+  if pa <= pb and pa <= pc:
+    return a
+  if pb <= pc:
+    return b
+  return c
+
+def read_png(path):
+  with open(path, 'rb') as fd:
+    data = fd.read()
+
+  if data[:8] != PNG_SIGNATURE:
+    raise Exception('%s is not a PNG file' % path)
+
+  pos = 8
+  idat = []
+  palette = None
+  trns = None
+
+  while pos < len(data):
+    length, ctype = struct.unpack('>I4s', data[pos:pos + 8])
+    chunk = data[pos + 8:pos + 8 + length]
+    pos += 12 + length
+
+    if ctype == b'IHDR':
+      width, height, depth, color_type, _, _, interlace = struct.unpack('>IIBBBBB', chunk)
+    elif ctype == b'PLTE':
+      palette = chunk
+    elif ctype == b'tRNS':
+      trns = chunk
+    elif ctype == b'IDAT':
+      idat.append(chunk)
+    elif ctype == b'IEND':
+      break
+
+  if depth != 8 or interlace != 0:
+    raise Exception('%s: only 8 bit non-interlaced PNGs are supported' % path)
+
+  channels = {0: 1, 2: 3, 3: 1, 4: 2, 6: 4}[color_type]
+  stride = width * channels
+  raw = zlib.decompress(b''.join(idat))
+  rows = []
+  prev = bytearray(stride)
+
+  for y in range(height):
+    offset = y * (stride + 1)
+    ftype = raw[offset]
+    row = bytearray(raw[offset + 1:offset + 1 + stride])
+
+    for i in range(stride):
+      a = row[i - channels] if i >= channels else 0
+      b = prev[i]
+      c = prev[i - channels] if i >= channels else 0
+      if ftype == 1:
+        row[i] = (row[i] + a) & 0xFF
+      elif ftype == 2:
+        row[i] = (row[i] + b) & 0xFF
+      elif ftype == 3:
+        row[i] = (row[i] + ((a + b) >> 1)) & 0xFF
+      elif ftype == 4:
+        row[i] = (row[i] + paeth(a, b, c)) & 0xFF
+
+    prev = row
+
+    # convert to RGBA
+    if color_type == 6:
+      rgba = row
+    else:
+      rgba = bytearray(width * 4)
+      for x in range(width):
+        if color_type == 0:
+          v = row[x]
+          rgba[x * 4:x * 4 + 4] = bytes((v, v, v, 255))
+        elif color_type == 4:
+          v = row[x * 2]
+          rgba[x * 4:x * 4 + 4] = bytes((v, v, v, row[x * 2 + 1]))
+        elif color_type == 2:
+          rgba[x * 4:x * 4 + 3] = row[x * 3:x * 3 + 3]
+          rgba[x * 4 + 3] = 255
+        else:
+          idx = row[x]
+          rgba[x * 4:x * 4 + 3] = palette[idx * 3:idx * 3 + 3]
+          rgba[x * 4 + 3] = trns[idx] if trns is not None and idx < len(trns) else 255
+    rows.append(rgba)
+
+  return Image(width, height, rows)
+
+def write_png(path, image):
+  def chunk(ctype, data):
+    return struct.pack('>I', len(data)) + ctype + data + struct.pack('>I', zlib.crc32(ctype + data) & 0xFFFFFFFF)
+
+  raw = b''.join(b'\x00' + bytes(row) for row in image.rows)
+  ihdr = struct.pack('>IIBBBBB', image.width, image.height, 8, 6, 0, 0, 0)
+
+  with open(path, 'wb') as fd:
+    fd.write(PNG_SIGNATURE + chunk(b'IHDR', ihdr) + chunk(b'IDAT', zlib.compress(raw, 9)) + chunk(b'IEND', b''))
+
+def pack(sizes, page_size, padding):
+  """
+  Shelf pack rectangles into pages, tallest first.
+  :param sizes: List of (width, height)
+  :return: List of (page, x, y) in the same order as sizes
+  """
+  order = sorted(range(len(sizes)), key=lambda i: (-sizes[i][1], -sizes[i][0]))
+  placements = [None] * len(sizes)
+  pages = [] # each page is a list of shelves [y, height, next x]
+
+  for i in order:
+    w, h = sizes[i][0] + padding, sizes[i][1] + padding
+
+    if w > page_size or h > page_size:
+      raise Exception('A bitmap of %ix%i does not fit in a page of %i, use a larger --page-size' % (sizes[i][0], sizes[i][1], page_size))
+
+    placed = False
+    for p, shelves in enumerate(pages):
+      for shelf in shelves:
+        if h <= shelf[1] and shelf[2] + w <= page_size:
+          placements[i] = (p, shelf[2], shelf[0])
+          shelf[2] += w
+          placed = True
+          break
+      if not placed:
+        top = shelves[-1][0] + shelves[-1][1]
+        if top + h <= page_size:
+          shelves.append([top, h, w])
+          placements[i] = (p, 0, top)
+          placed = True
+      if placed:
+        break
+
+    if not placed:
+      pages.append([[0, h, w]])
+      placements[i] = (len(pages) - 1, 0, 0)
+
+  return placements, len(pages)
+
+def make_cname(s):
+  return re.sub(NON_NAME_PATTERN, '_', s).upper()
+
+def scaled_path(path, scale):
+  root, ext = os.path.splitext(path)
+  return '%s@%ix%s' % (root, scale, ext)
+
+def main(argv):
+  parser = argparse.ArgumentParser(description='Pack PNG bitmaps into atlas pages')
+  parser.add_argument('-n', '--name', type=str, default='atlas',
+    help='Base file name of the pages, which are written as <name>0.png, <name>1.png etc.')
+  parser.add_argument('-o', '--output-dir', type=str, default='.',
+    help='Directory to write the pages to')
+  parser.add_argument('-p', '--page-size', type=int, default=2048,
+    help='Maximum width and height of a page at 1x')
+  parser.add_argument('--padding', type=int, default=2,
+    help='Transparent pixels between bitmaps, to avoid bleeding when filtering')
+  parser.add_argument('output_header', type=str,
+    help='Output header file')
+  parser.add_argument('inputs', type=str, nargs='+',
+    help='Input PNG files, the header defines <FILE_NAME>_ATLAS_PAGE and <FILE_NAME>_ATLAS_RECT for each')
+  args = parser.parse_args(argv)
+
+  images = [read_png(path) for path in args.inputs]
+  placements, nPages = pack([(im.width, im.height) for im in images], args.page_size, args.padding)
+
+  scaled = all(os.path.exists(scaled_path(path, 2)) for path in args.inputs)
+
+  for scale in ([1, 2] if scaled else [1]):
+    for p in range(nPages):
+      entries = [(i, placements[i]) for i in range(len(images)) if placements[i][0] == p]
+      width = max(placements[i][1] + images[i].width for i, _ in entries)
+      height = max(placements[i][2] + images[i].height for i, _ in entries)
+      page = Image(width * scale, height * scale)
+
+      for i, (_, x, y) in entries:
+        im = images[i] if scale == 1 else read_png(scaled_path(args.inputs[i], scale))
+
+        if im.width != images[i].width * scale or im.height != images[i].height * scale:
+          raise Exception('%s is not %ix the size of %s' % (scaled_path(args.inputs[i], scale), scale, args.inputs[i]))
+
+        page.blit(im, x * scale, y * scale)
+
+      page_path = os.path.join(args.output_dir, '%s%i.png' % (args.name, p))
+      write_png(page_path if scale == 1 else scaled_path(page_path, scale), page)
+
+  with open(args.output_header, 'w') as fd:
+    fd.write('// Generated by pack_bitmaps.py, do not edit\n\n#pragma once\n\n')
+
+    for p in range(nPages):
+      fd.write('#define %s_PAGE%i_FN "%s%i.png"\n' % (make_cname(args.name), p, args.name, p))
+    fd.write('\n')
+
+    for i, path in enumerate(args.inputs):
+      page, x, y = placements[i]
+      cname = make_cname(os.path.splitext(os.path.basename(path))[0])
+      fd.write('#define %s_ATLAS_PAGE %s_PAGE%i_FN\n' % (cname, make_cname(args.name), page))
+      fd.write('#define %s_ATLAS_RECT IRECT(%i, %i, %i, %i)\n' % (cname, x, y, x + images[i].width, y + images[i].height))
+
+if __name__ == '__main__':
+  main(sys.argv[1:])
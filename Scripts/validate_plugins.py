@@ -0,0 +1,157 @@
+#!/usr/bin/env python3
+
+# python script to validate the built formats of a plug-in in parallel, one validator process per format, and to check how long they take to start up.
+# build the plug-in with IPLUG_STARTUP_TIMING defined to get the construction, OnReset(), first block and editor open timings, see IPlugStartupTimer.h
+#
+# usage: validate_plugins.py project_dir build_dir [--formats vst3,clap,au,vst2] [--thresholds thresholds.json] [--pluginval path] [--clap-validator path] [--skip-gui-tests]
+#
+# the thresholds file holds the maximum time in ms for each stage, optionally per format, e.g.
+# { "construct": 50, "reset": 20, "first_process": 10, "editor_open": 200, "validate": 120000, "clap": { "editor_open": 300 } }
+# the script exits with 1 if a validator fails or a stage takes longer than its threshold
+
+import argparse, json, os, platform, subprocess, sys, tempfile, time
+from concurrent.futures import ThreadPoolExecutor
+
+scriptpath = os.path.dirname(os.path.realpath(__file__))
+sys.path.insert(0, scriptpath)
+
+from parse_config import parse_config
+
+STAGES = ["construct", "reset", "first_process", "editor_open"]
+
+DEFAULT_THRESHOLDS = {
+  "construct": 100.,
+  "reset": 50.,
+  "first_process": 20.,
+  "editor_open": 500.,
+  "validate": 300000.
+}
+
+def bundle_path(config, build_dir, fmt):
+  name = config["BUNDLE_NAME"] or config["PLUG_NAME"]
+  win = platform.system() == "Windows"
+
+  extensions = {
+    "vst2": ".dll" if win else ".vst",
+    "vst3": ".vst3",
+    "clap": ".clap",
+    "au": ".component"
+  }
+
+  return os.path.join(build_dir, name + extensions[fmt])
+
+def au_type(config):
+  if config["PLUG_TYPE"] == 1:
+    return "aumu"
+  if config["PLUG_TYPE"] == 2:
+    return "aumi"
+  return "aumf" if config["PLUG_DOES_MIDI_IN"] else "aufx"
+
+def validator_command(args, config, fmt, path):
+  if fmt == "clap":
+    return [args.clap_validator, "validate", path]
+
+  if fmt == "au" and not args.pluginval_au:
+    return ["auval", "-strict", "-v", au_type(config), config["PLUG_UNIQUE_ID"], config["PLUG_MFR_ID"]]
+
+  command = [args.pluginval, "--validate-in-process", "--strictness-level", str(args.strictness), "--validate", path]
+
+  if args.skip_gui_tests:
+    command.insert(1, "--skip-gui-tests")
+
+  return command
+
+def read_timings(path):
+  timings = {}
+
+  if not os.path.exists(path):
+    return timings
+
+  with open(path) as f:
+    for line in f:
+      fields = line.split()
+
+      if len(fields) == 4:
+        timings[fields[0]] = { "count": int(fields[1]), "mean": float(fields[2]), "max": float(fields[3]) }
+
+  return timings
+
+def run_format(args, config, fmt, timing_dir):
+  path = bundle_path(config, args.build_dir, fmt)
+
+  if fmt != "au" and not os.path.exists(path):
+    return { "format": fmt, "ok": False, "error": "not found: " + path, "timings": {}, "validate": 0. }
+
+  timing_file = os.path.join(timing_dir, fmt + ".txt")
+  env = dict(os.environ, IPLUG_STARTUP_TIMING_FILE=timing_file)
+  log_file = os.path.join(timing_dir, fmt + ".log")
+
+  start = time.monotonic()
+
+  with open(log_file, "w") as log:
+    try:
+      result = subprocess.run(validator_command(args, config, fmt, path), stdout=log, stderr=subprocess.STDOUT, env=env, timeout=args.timeout)
+      ok, error = result.returncode == 0, "" if result.returncode == 0 else "validator returned " + str(result.returncode) + ", see " + log_file
+    except subprocess.TimeoutExpired:
+      ok, error = False, "timed out, see " + log_file
+    except OSError as e:
+      ok, error = False, str(e)
+
+  return { "format": fmt, "ok": ok, "error": error, "timings": read_timings(timing_file), "validate": (time.monotonic() - start) * 1000. }
+
+def threshold(thresholds, fmt, stage):
+  return thresholds.get(fmt, {}).get(stage, thresholds.get(stage))
+
+def main():
+  parser = argparse.ArgumentParser(description="Validate the formats of a plug-in in parallel and check its startup timings")
+  parser.add_argument("project", help="the folder of the plug-in project, holding config.h")
+  parser.add_argument("build_dir", help="the folder holding the built plug-ins")
+  parser.add_argument("--formats", default="vst3,clap,au" if platform.system() == "Darwin" else "vst3,clap")
+  parser.add_argument("--thresholds", help="a json file of thresholds in ms, see the top of this script")
+  parser.add_argument("--pluginval", default="pluginval")
+  parser.add_argument("--pluginval-au", action="store_true", help="validate the AU with pluginval rather than auval")
+  parser.add_argument("--clap-validator", default="clap-validator")
+  parser.add_argument("--strictness", type=int, default=5)
+  parser.add_argument("--skip-gui-tests", action="store_true")
+  parser.add_argument("--timeout", type=float, default=600.)
+  args = parser.parse_args()
+
+  config = parse_config(args.project)
+  thresholds = dict(DEFAULT_THRESHOLDS)
+
+  if args.thresholds:
+    with open(args.thresholds) as f:
+      thresholds.update(json.load(f))
+
+  formats = [fmt.strip() for fmt in args.formats.split(",") if fmt.strip()]
+  timing_dir = tempfile.mkdtemp(prefix="iplug_validate_")
+
+  with ThreadPoolExecutor(max_workers=len(formats)) as pool:
+    results = list(pool.map(lambda fmt: run_format(args, config, fmt, timing_dir), formats))
+
+  failed = False
+
+  for result in results:
+    fmt = result["format"]
+    print("\n" + fmt + ": " + ("passed" if result["ok"] else "FAILED " + result["error"]))
+    failed |= not result["ok"]
+
+    measurements = [("validate", result["validate"])]
+
+    for stage in STAGES:
+      if stage in result["timings"]:
+        measurements.append((stage, result["timings"][stage]["max"]))
+      elif stage != "editor_open" or not args.skip_gui_tests:
+        print("  %-14s not measured, build with IPLUG_STARTUP_TIMING" % stage)
+
+    for stage, ms in measurements:
+      limit = threshold(thresholds, fmt, stage)
+      over = limit is not None and ms > limit
+      failed |= over
+      print("  %-14s %10.3f ms%s" % (stage, ms, "  over the threshold of %.3f ms" % limit if over else ""))
+
+  print("\nlogs and timings in " + timing_dir)
+  return 1 if failed else 0
+
+if __name__ == '__main__':
+  sys.exit(main())
@@ -3,6 +3,10 @@
 
 #include "IControls.h"
 
+static constexpr int kNumButtons = 7;
+
+static const char* kTestNames[kNumTests] = {"Start", "DrawRect", "FillRect", "DrawRoundRect", "FillRoundRect", "DrawEllipse", "FillEllipse", "DrawArc", "FillArc", "DrawLine", "DrawDottedLine", "DrawFittedBitmap", "DrawSVG", "DrawText", "Layer", "LayerDropShadow"};
+
 IGraphicsStressTest::IGraphicsStressTest(const InstanceInfo& info)
 : Plugin(info, MakeConfig(kNumParams, 1))
 {
@@ -36,8 +40,8 @@ void IGraphicsStressTest::LayoutUI(IGraphics* pGraphics)
     pGraphics->GetControlWithTag(kCtrlTagNumThings)->SetTargetAndDrawRECTs(labelsArea.GetGridCell(0, 1, 2));
     pGraphics->GetControlWithTag(kCtrlTagTestNum)->SetTargetAndDrawRECTs(labelsArea.GetGridCell(1, 1, 2));
     
-    for(int button=0;button<6;button++) {
-      pGraphics->GetControlWithTag(kCtrlTagButton1 + button)->SetTargetAndDrawRECTs(buttonsArea.GetGridCell(button, 1, 6));
+    for(int button=0;button<kNumButtons;button++) {
+      pGraphics->GetControlWithTag(kCtrlTagButton1 + button)->SetTargetAndDrawRECTs(buttonsArea.GetGridCell(button, 1, kNumButtons));
     }
     return;
   }
@@ -58,17 +62,18 @@ void IGraphicsStressTest::LayoutUI(IGraphics* pGraphics)
     }
     
     GetUI()->GetControlWithTag(kCtrlTagNumThings)->As<ITextControl>()->SetStrFmt(64, "Number of things = %i", mNumberOfThings);
-    GetUI()->GetControlWithTag(kCtrlTagTestNum)->As<ITextControl>()->SetStrFmt(64, "Test %i/%i", this->mKindOfThing, 32);
+    GetUI()->GetControlWithTag(kCtrlTagTestNum)->As<ITextControl>()->SetStrFmt(64, "Test %i/%i", this->mKindOfThing, kNumTests - 1);
     GetUI()->SetAllControlsDirty();
   };
   
-  pGraphics->SetKeyHandlerFunc([DoFunc](const IKeyPress& key, bool isUp)
+  pGraphics->SetKeyHandlerFunc([this, DoFunc](const IKeyPress& key, bool isUp)
   {
     if(!isUp) {
       switch (key.VK) {
         case kVK_UP: DoFunc(EFunc::More); return true;
         case kVK_DOWN: DoFunc(EFunc::Less); return true;
         case kVK_TAB: key.S ? DoFunc(EFunc::Prev) : DoFunc(EFunc::Next); return true;
+        case kVK_B: this->StartBenchmark(); return true;
         default: return false;
       }
     }
@@ -79,56 +84,26 @@ void IGraphicsStressTest::LayoutUI(IGraphics* pGraphics)
   pGraphics->LoadFont("Roboto-Regular", ROBOTO_FN);
   pGraphics->AttachPanelBackground(COLOR_GRAY);
   pGraphics->AttachControl(new ILambdaControl(visualsArea, [&](ILambdaControl* pCaller, IGraphics& g, IRECT& r) {
-    static IBitmap smiley = g.LoadBitmap(SMILEY_FN);
-    static ISVG tiger = g.LoadSVG(TIGER_FN);
-    
     g.FillRect(COLOR_WHITE, r);
     
-    if(this->mKindOfThing == 0)
+    if(this->mBenchmarking)
+    {
+      auto start = std::chrono::steady_clock::now();
+      DrawTest(g, pCaller, r, this->mBenchmarkTest, this->mBenchmarkResults.back().mNumThings);
+      OnBenchmarkFrame(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+      
+      // keep redrawing until every test has run
+      if(this->mBenchmarking)
+        pCaller->SetDirty(false);
+    }
+    else if(this->mKindOfThing == kTestStart)
     {
       g.DrawText(IText(30), "Press tab to go to next test", r);
       g.DrawText(IText(30), "up/down to change the # of things", r.GetVShifted(40.f));
+      g.DrawText(IText(30), "B to benchmark every test", r.GetVShifted(80.f));
     }
     else
-    //      if (!g.CheckLayer(pCaller->mLayer))
-    {
-      //        g.StartLayer(r);
-      
-      for (int i=0; i<this->mNumberOfThings; i++)
-      {
-        IRECT rr = r.GetRandomSubRect();
-        IColor rc = IColor::GetRandomColor();
-        IBlend rb = {};
-        static bool dir = 0;
-        static float thickness = 5.f;
-        static float roundness = 5.f;
-        float rrad1 = rand() % 360;
-        float rrad2 = rand() % 360;
-        
-        switch (this->mKindOfThing)
-        {
-          case 1:  g.DrawRect(rc, rr, &rb); break;
-          case 2:  g.FillRect(rc, rr, &rb); break;
-          case 3:  g.DrawRoundRect(rc, rr, roundness, &rb); break;
-          case 4:  g.FillRoundRect(rc, rr, roundness, &rb); break;
-          case 5:  g.DrawEllipse(rc, rr, &rb); break;
-          case 6:  g.FillEllipse(rc, rr, &rb); break;
-          case 7:  g.DrawArc(rc, rr.MW(), rr.MH(), rr.W() > rr.H() ? rr.H() : rr.W(), rrad1, rrad2, &rb,thickness); break;
-          case 8:  g.FillArc(rc, rr.MW(), rr.MH(), rr.W() > rr.H() ? rr.H() : rr.W(), rrad1, rrad2, &rb); break;
-          case 9:  g.DrawLine(rc, dir == 0 ? rr.L : rr.R, rr.B, dir == 0 ? rr.R : rr.L, rr.T, &rb,thickness); break;
-          case 10: g.DrawDottedLine(rc, dir == 0 ? rr.L : rr.R, rr.B, dir == 0 ? rr.R : rr.L, rr.T, &rb, thickness); break;
-          case 11: g.DrawFittedBitmap(smiley, rr, &rb); break;
-          case 12: g.DrawSVG(tiger, rr); break;
-          default:
-            break;
-        }
-        
-        dir = !dir;
-      }
-      //        pCaller->mLayer = g.EndLayer();
-    }
-    
-    //      g.DrawLayer(pCaller->mLayer);
+      DrawTest(g, pCaller, r, this->mKindOfThing, this->mNumberOfThings);
     
   }, 10000, false, false));
   
@@ -136,16 +111,21 @@ void IGraphicsStressTest::LayoutUI(IGraphics* pGraphics)
   pGraphics->AttachControl(new ITextControl(labelsArea.GetGridCell(1, 1, 2), "", IText(20)), kCtrlTagTestNum);
   
   int button = 0;
-  for (auto buttonLabel : {"Select test", "Next test", "Prev test", "Things++", "Things--"}) {
-    pGraphics->AttachControl(new IVButtonControl(buttonsArea.GetGridCell(button, 1, 6), SplashClickActionFunc, buttonLabel, DEFAULT_STYLE.WithLabelText(DEFAULT_TEXT.WithVAlign(EVAlign::Middle)).WithRoundness(0.2)), kCtrlTagButton1 + button)->SetAnimationEndActionFunction([button, DoFunc, pGraphics](IControl* pCaller) {
+  for (auto buttonLabel : {"Select test", "Next test", "Prev test", "Things++", "Things--", "Benchmark"}) {
+    pGraphics->AttachControl(new IVButtonControl(buttonsArea.GetGridCell(button, 1, kNumButtons), SplashClickActionFunc, buttonLabel, DEFAULT_STYLE.WithLabelText(DEFAULT_TEXT.WithVAlign(EVAlign::Middle)).WithRoundness(0.2)), kCtrlTagButton1 + button)->SetAnimationEndActionFunction([this, button, DoFunc, pGraphics](IControl* pCaller) {
       
       switch (button){
         case 0:
         {
-          static IPopupMenu menu {"Test", {"Start", "DrawRect", "FillRect", "DrawRoundRect", "FillRoundRect", "DrawEllipse", "FillEllipse", "DrawArc", "FillArc", "DrawLine", "DrawDottedLine", "DrawFittedBitmap", "DrawSVG"},
-            [DoFunc](IPopupMenu* pMenu) {
-              DoFunc(EFunc::Set, pMenu->GetChosenItemIdx());
-            }};
+          static IPopupMenu menu {"Test", {}, [DoFunc](IPopupMenu* pMenu) {
+            DoFunc(EFunc::Set, pMenu->GetChosenItemIdx());
+          }};
+          
+          if(!menu.NItems())
+          {
+            for (auto name : kTestNames)
+              menu.AddItem(name);
+          }
           
           pGraphics->CreatePopupMenu(*pCaller, menu, pCaller->GetRECT());
           break;
@@ -154,6 +134,7 @@ void IGraphicsStressTest::LayoutUI(IGraphics* pGraphics)
         case 2: DoFunc(EFunc::Prev); break;
         case 3: DoFunc(EFunc::More); break;
         case 4: DoFunc(EFunc::Less); break;
+        case 5: this->StartBenchmark(); break;
         default:
           break;
       }
@@ -162,9 +143,151 @@ void IGraphicsStressTest::LayoutUI(IGraphics* pGraphics)
     button++;
   }
   
-  pGraphics->AttachControl(new IVToggleControl(buttonsArea.GetGridCell(button, 1, 6), SplashClickActionFunc, "", DEFAULT_STYLE.WithRoundness(0.2), "FPS OFF", "FPS ON"), kCtrlTagButton6)->SetAnimationEndActionFunction([](IControl* pCaller){
+  pGraphics->AttachControl(new IVToggleControl(buttonsArea.GetGridCell(button, 1, kNumButtons), SplashClickActionFunc, "", DEFAULT_STYLE.WithRoundness(0.2), "FPS OFF", "FPS ON"), kCtrlTagButton1 + button)->SetAnimationEndActionFunction([](IControl* pCaller){
       pCaller->GetUI()->ShowFPSDisplay(pCaller->GetValue() > 0.5);
   });
 
 }
+void IGraphicsStressTest::DrawTest(IGraphics& g, ILambdaControl* pCaller, const IRECT& r, int test, int nThings)
+{
+  static IBitmap smiley = g.LoadBitmap(SMILEY_FN);
+  static ISVG tiger = g.LoadSVG(TIGER_FN);
+  
+  // the layer tests draw fills off-screen, then composite the layer, which is redrawn every frame
+  const bool layer = test == kTestLayer || test == kTestLayerDropShadow;
+  
+  if(layer)
+    g.StartLayer(pCaller, r);
+  
+  for (int i=0; i<nThings; i++)
+  {
+    IRECT rr = r.GetRandomSubRect();
+    IColor rc = IColor::GetRandomColor();
+    IBlend rb = {};
+    static bool dir = 0;
+    static float thickness = 5.f;
+    static float roundness = 5.f;
+    float rrad1 = rand() % 360;
+    float rrad2 = rand() % 360;
+    
+    switch (test)
+    {
+      case kTestDrawRect:  g.DrawRect(rc, rr, &rb); break;
+      case kTestFillRect:  g.FillRect(rc, rr, &rb); break;
+      case kTestDrawRoundRect:  g.DrawRoundRect(rc, rr, roundness, &rb); break;
+      case kTestFillRoundRect:  g.FillRoundRect(rc, rr, roundness, &rb); break;
+      case kTestDrawEllipse:  g.DrawEllipse(rc, rr, &rb); break;
+      case kTestFillEllipse:  g.FillEllipse(rc, rr, &rb); break;
+      case kTestDrawArc:  g.DrawArc(rc, rr.MW(), rr.MH(), rr.W() > rr.H() ? rr.H() : rr.W(), rrad1, rrad2, &rb,thickness); break;
+      case kTestFillArc:  g.FillArc(rc, rr.MW(), rr.MH(), rr.W() > rr.H() ? rr.H() : rr.W(), rrad1, rrad2, &rb); break;
+      case kTestDrawLine:  g.DrawLine(rc, dir == 0 ? rr.L : rr.R, rr.B, dir == 0 ? rr.R : rr.L, rr.T, &rb,thickness); break;
+      case kTestDrawDottedLine: g.DrawDottedLine(rc, dir == 0 ? rr.L : rr.R, rr.B, dir == 0 ? rr.R : rr.L, rr.T, &rb, thickness); break;
+      case kTestDrawFittedBitmap: g.DrawFittedBitmap(smiley, rr, &rb); break;
+      case kTestDrawSVG: g.DrawSVG(tiger, rr); break;
+      case kTestDrawText: g.DrawText(IText(10.f + (rand() % 30), rc), "IGraphics", rr, &rb); break;
+      case kTestLayer:
+      case kTestLayerDropShadow: g.FillRoundRect(rc, rr, roundness, &rb); break;
+      default:
+        break;
+    }
+    
+    dir = !dir;
+  }
+  
+  if(layer)
+  {
+    ILayerPtr pLayer = g.EndLayer();
+    
+    if(test == kTestLayerDropShadow)
+      g.ApplyLayerDropShadow(pLayer, IShadow(COLOR_BLACK_DROP_SHADOW, 10.f, 5.f, 10.f, 0.7f, true));
+    
+    g.DrawLayer(pLayer);
+  }
+}
+
+void IGraphicsStressTest::StartBenchmark()
+{
+  if(mBenchmarking || !GetUI())
+    return;
+  
+  mBenchmarking = true;
+  mBenchmarkResults.clear();
+  StartBenchmarkTest(kTestDrawRect);
+  GetUI()->SetAllControlsDirty();
+}
+
+void IGraphicsStressTest::StartBenchmarkTest(int test)
+{
+  BenchmarkResult result;
+  result.mTest = test;
+  // SVGs are much slower than everything else, so draw fewer of them to keep the run short
+  result.mNumThings = test == kTestDrawSVG ? 32 : 512;
+  mBenchmarkResults.push_back(result);
+  mBenchmarkTest = test;
+  mBenchmarkFrame = 0;
+  // the same things are drawn in every run of the benchmark
+  srand(test);
+  
+  GetUI()->GetControlWithTag(kCtrlTagTestNum)->As<ITextControl>()->SetStrFmt(64, "Benchmarking %s", kTestNames[test]);
+  GetUI()->GetControlWithTag(kCtrlTagNumThings)->As<ITextControl>()->SetStrFmt(64, "Number of things = %i", result.mNumThings);
+}
+
+void IGraphicsStressTest::OnBenchmarkFrame(double drawMs)
+{
+  auto now = std::chrono::steady_clock::now();
+  const double frameMs = std::chrono::duration<double, std::milli>(now - mLastFrameTime).count();
+  mLastFrameTime = now;
+  
+  // the warm-up frames load the resources, and fill any caches in the drawing API
+  if(mBenchmarkFrame++ >= kBenchmarkWarmUpFrames)
+  {
+    BenchmarkResult& result = mBenchmarkResults.back();
+    result.mNumFrames++;
+    result.mTotalDrawMs += drawMs;
+    result.mWorstDrawMs = std::max(result.mWorstDrawMs, drawMs);
+    result.mTotalFrameMs += frameMs;
+  }
+  
+  if(mBenchmarkFrame < kBenchmarkWarmUpFrames + kBenchmarkFrames)
+    return;
+  
+  if(mBenchmarkTest + 1 < kNumTests)
+    StartBenchmarkTest(mBenchmarkTest + 1);
+  else
+  {
+    mBenchmarking = false;
+    WriteBenchmarkResults();
+  }
+}
+
+void IGraphicsStressTest::WriteBenchmarkResults()
+{
+  IGraphics* pGraphics = GetUI();
+  WDL_String csv;
+  csv.Set("api,test,things,frames,mean draw ms,worst draw ms,mean frame ms\n");
+  
+  for (auto& result : mBenchmarkResults)
+  {
+    csv.AppendFormatted(256, "%s,%s,%i,%i,%.4f,%.4f,%.4f\n", pGraphics->GetDrawingAPIStr(), kTestNames[result.mTest], result.mNumThings, result.mNumFrames,
+                        result.mTotalDrawMs / result.mNumFrames, result.mWorstDrawMs, result.mTotalFrameMs / result.mNumFrames);
+  }
+  
+  DBGMSG("%s", csv.Get());
+  
+  WDL_String path;
+  DesktopPath(path);
+  path.AppendFormatted(256, "/IGraphicsStressTest-%s.csv", pGraphics->GetDrawingAPIStr());
+  
+  FILE* fp = fopen(path.Get(), "w");
+  const bool written = fp != nullptr;
+  
+  if(fp)
+  {
+    fputs(csv.Get(), fp);
+    fclose(fp);
+  }
+  
+  pGraphics->GetControlWithTag(kCtrlTagTestNum)->As<ITextControl>()->SetStrFmt(256, written ? "Benchmark written to %s" : "Could not write %s", path.Get());
+  pGraphics->SetAllControlsDirty();
+}
 #endif
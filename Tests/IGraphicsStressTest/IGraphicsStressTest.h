@@ -2,6 +2,9 @@
 
 #include "IPlug_include_in_plug_hdr.h"
 
+#include <chrono>
+#include <vector>
+
 enum EParam
 {
   kParamDummy = 0,
@@ -17,7 +20,30 @@ enum EControlTags
   kCtrlTagButton3,
   kCtrlTagButton4,
   kCtrlTagButton5,
-  kCtrlTagButton6
+  kCtrlTagButton6,
+  kCtrlTagButton7
+};
+
+/** The tests, in the order of the test menu. kTestStart is the instructions page */
+enum ETest
+{
+  kTestStart = 0,
+  kTestDrawRect,
+  kTestFillRect,
+  kTestDrawRoundRect,
+  kTestFillRoundRect,
+  kTestDrawEllipse,
+  kTestFillEllipse,
+  kTestDrawArc,
+  kTestFillArc,
+  kTestDrawLine,
+  kTestDrawDottedLine,
+  kTestDrawFittedBitmap,
+  kTestDrawSVG,
+  kTestDrawText,
+  kTestLayer,
+  kTestLayerDropShadow,
+  kNumTests
 };
 
 using namespace iplug;
@@ -30,8 +56,35 @@ public:
 #if IPLUG_EDITOR
   void LayoutUI(IGraphics* pGraphics) override;
   void OnParentWindowResize(int width, int height) override;
+  void DrawTest(IGraphics& g, ILambdaControl* pCaller, const IRECT& r, int test, int nThings);
+
+  /** Run every test for a fixed number of frames, with a fixed number of things and random seed, and write the timings for this drawing API to a CSV file on the desktop */
+  void StartBenchmark();
+  void StartBenchmarkTest(int test);
+  void OnBenchmarkFrame(double drawMs);
+  void WriteBenchmarkResults();
 public:
   int mNumberOfThings = 16;
   int mKindOfThing = 0;
+
+private:
+  struct BenchmarkResult
+  {
+    int mTest = 0;
+    int mNumThings = 0;
+    int mNumFrames = 0;
+    double mTotalDrawMs = 0.;
+    double mWorstDrawMs = 0.;
+    double mTotalFrameMs = 0.;
+  };
+
+  static constexpr int kBenchmarkWarmUpFrames = 10;
+  static constexpr int kBenchmarkFrames = 120;
+
+  bool mBenchmarking = false;
+  int mBenchmarkTest = 0;
+  int mBenchmarkFrame = 0;
+  std::chrono::steady_clock::time_point mLastFrameTime;
+  std::vector<BenchmarkResult> mBenchmarkResults;
 #endif
 };
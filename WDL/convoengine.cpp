@@ -35,6 +35,14 @@
 //#define TIMING
 #include "timing.c"
 
+// define WDL_CONVO_FFT to the name of a function with WDL_fft()'s signature to use another FFT. It must be consistent
+// forwards and backwards, but the order of the bins doesn't matter
+#ifdef WDL_CONVO_FFT
+extern void WDL_CONVO_FFT(WDL_FFT_COMPLEX *buf, int len, int isInverse);
+#else
+#define WDL_CONVO_FFT WDL_fft
+#endif
+
 #define CONVOENGINE_SILENCE_THRESH 1.0e-12 // -240dB
 #define CONVOENGINE_IMPULSE_SILENCE_THRESH 1.0e-15 // -300dB
 
@@ -263,7 +271,7 @@ int WDL_ConvolutionEngine::SetImpulse(WDL_ImpulseBuffer *impulse, int fft_size,
       if (mv>CONVOENGINE_IMPULSE_SILENCE_THRESH||mv2>CONVOENGINE_IMPULSE_SILENCE_THRESH)
       {
         *zbuf++=mv>CONVOENGINE_IMPULSE_SILENCE_THRESH ? 2 : 1; // 1 means only second channel has content
-        WDL_fft((WDL_FFT_COMPLEX*)impout,fft_size,0);
+        WDL_CONVO_FFT((WDL_FFT_COMPLEX*)impout,fft_size,0);
 
         if (smallerSizeMode)
         {
@@ -575,7 +583,7 @@ int WDL_ConvolutionEngine::Avail(int want)
       m_zl_fftcnt++;
 #endif
 
-      if (nonzflag) WDL_fft((WDL_FFT_COMPLEX*)optr,m_fft_size,0);
+      if (nonzflag) WDL_CONVO_FFT((WDL_FFT_COMPLEX*)optr,m_fft_size,0);
 
       if (useSilentList) useSilentList[histpos]=nonzflag ? (mono_input_mode ? 1 : 2) : 0;
     
@@ -618,7 +626,7 @@ int WDL_ConvolutionEngine::Avail(int want)
       if (!applycnt)
         memset(workbuf2,0,m_fft_size*2*sizeof(WDL_FFT_REAL));
       else
-        WDL_fft((WDL_FFT_COMPLEX*)workbuf2,m_fft_size,1);
+        WDL_CONVO_FFT((WDL_FFT_COMPLEX*)workbuf2,m_fft_size,1);
 
       WDL_FFT_REAL *olhist=pinf->overlaphist.Get(); // errors from last time
       WDL_FFT_REAL *p1=workbuf2,*p3=workbuf2+m_fft_size,*p1o=workbuf2;
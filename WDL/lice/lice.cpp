@@ -17,6 +17,7 @@
 #include <stdio.h> // only included in case we need to debug with sprintf etc
 
 #include "lice_combine.h"
+#include "lice_simd.h"
 #include "lice_extended.h"
 
 #ifndef _WIN32
@@ -1068,6 +1069,10 @@ static void LICE_BlitInt(LICE_IBitmap *dest, LICE_IBitmap *src, int dstx, int ds
   else 
   {
     int ia=(int)(alpha*256.0);
+    #ifdef LICE_SIMD
+      // the kernels work on 4 pixels at a time, so they can't be used if the source and destination might overlap
+      if (src != dest && __LICE_SIMD_Blit(pdest,psrc,cpsize,i,src_span,dest_span,ia,mode)) return;
+    #endif
     #ifdef LICE_FAVOR_SIZE
         LICE_COMBINEFUNC blitfunc=NULL;      
         #define __LICE__ACTION(comb) blitfunc=comb::doPix;
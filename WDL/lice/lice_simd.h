@@ -0,0 +1,232 @@
+#ifndef _LICE_SIMD_H_
+#define _LICE_SIMD_H_
+
+// SSE2 and NEON versions of the copy and source alpha blends of LICE_Blit(), which are the
+// blits used most, 4 pixels at a time. They give exactly the same results as the scalar
+// code in lice_combine.h.
+//
+// SSE2 is part of every x86-64 CPU (and is required by 32-bit builds with /arch:SSE2 or
+// -msse2), and NEON of every ARM64 one, so the kernels are selected when compiling for
+// those targets, with no test at runtime. Define LICE_NO_SIMD to use the scalar code only.
+
+#ifndef LICE_NO_SIMD
+  #if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define LICE_SIMD_SSE2
+  #elif (defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)) && !defined(__BIG_ENDIAN__)
+    #include <arm_neon.h>
+    #define LICE_SIMD_NEON
+  #endif
+#endif
+
+#if defined(LICE_SIMD_SSE2) || defined(LICE_SIMD_NEON)
+#define LICE_SIMD
+
+#ifdef LICE_SIMD_SSE2
+
+// s + trunc((d-s)*sc/256) for each 16-bit channel, sc 0-256. The products fit in 16 bits,
+// and the truncation towards zero of the scalar code is kept by taking whichever of
+// P-Q and Q-P is positive
+static inline __m128i __LICE_SIMD_Lerp16(__m128i s16, __m128i d16, __m128i sc16)
+{
+  const __m128i p = _mm_mullo_epi16(d16, sc16);
+  const __m128i q = _mm_mullo_epi16(s16, sc16);
+  return _mm_sub_epi16(_mm_add_epi16(s16, _mm_srli_epi16(_mm_subs_epu16(p, q), 8)), _mm_srli_epi16(_mm_subs_epu16(q, p), 8));
+}
+
+// s + trunc((d-s)*sc/256) for 4 pixels, sc16lo/sc16hi holding the factor of each channel of pixels 0-1 and 2-3
+static inline __m128i __LICE_SIMD_Lerp(__m128i s, __m128i d, __m128i sc16lo, __m128i sc16hi)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i lo = __LICE_SIMD_Lerp16(_mm_unpacklo_epi8(s, zero), _mm_unpacklo_epi8(d, zero), sc16lo);
+  const __m128i hi = __LICE_SIMD_Lerp16(_mm_unpackhi_epi8(s, zero), _mm_unpackhi_epi8(d, zero), sc16hi);
+  return _mm_packus_epi16(lo, hi);
+}
+
+// spreads a 0-256 factor in the low 16 bits of each pixel to its 4 channels
+static inline void __LICE_SIMD_SpreadFactor(__m128i sc32, __m128i *sc16lo, __m128i *sc16hi)
+{
+  const __m128i sc = _mm_or_si128(sc32, _mm_slli_epi32(sc32, 16));
+  *sc16lo = _mm_unpacklo_epi32(sc, sc);
+  *sc16hi = _mm_unpackhi_epi32(sc, sc);
+}
+
+// _LICE_CombinePixelsCopyNoClamp, 0 < ia < 256
+static inline void __LICE_SIMD_CopyRow(LICE_pixel_chan *pout, const LICE_pixel_chan *pin, int n, int ia)
+{
+  const __m128i sc = _mm_set1_epi16((short)(256-ia));
+  while (n >= 4)
+  {
+    const __m128i s = _mm_loadu_si128((const __m128i *)pin);
+    const __m128i d = _mm_loadu_si128((const __m128i *)pout);
+    _mm_storeu_si128((__m128i *)pout, __LICE_SIMD_Lerp(s, d, sc, sc));
+    pin += 16;
+    pout += 16;
+    n -= 4;
+  }
+  while (n-- > 0)
+  {
+    _LICE_CombinePixelsCopyNoClamp::doPix(pout,pin[LICE_PIXEL_R],pin[LICE_PIXEL_G],pin[LICE_PIXEL_B],pin[LICE_PIXEL_A],ia);
+    pin += 4;
+    pout += 4;
+  }
+}
+
+// _LICE_CombinePixelsCopySourceAlphaNoClamp and, for ia == 256, _LICE_CombinePixelsCopySourceAlphaIgnoreAlphaParmNoClamp
+static inline void __LICE_SIMD_CopySourceAlphaRow(LICE_pixel_chan *pout, const LICE_pixel_chan *pin, int n, int ia)
+{
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i amask = _mm_set1_epi32((int)(0xffu << (LICE_PIXEL_A*8)));
+  const __m128i ff = _mm_set1_epi32(255);
+  const __m128i iav = _mm_set1_epi32(ia);
+  const __m128i one = _mm_set1_epi32(1);
+  while (n >= 4)
+  {
+    const __m128i s = _mm_loadu_si128((const __m128i *)pin);
+    const __m128i d = _mm_loadu_si128((const __m128i *)pout);
+    const __m128i a = _mm_and_si128(_mm_srli_epi32(s, LICE_PIXEL_A*8), ff);
+    __m128i sc2; // the weight of the source, which is added to the destination alpha
+    if (ia == 256) sc2 = a;
+    else sc2 = _mm_srli_epi32(_mm_mullo_epi16(iav, _mm_add_epi32(a, one)), 8); // fits in 16 bits
+    // the other channels are weighted by 255-a when ia is 256, otherwise 256-sc2
+    const __m128i sc = _mm_sub_epi32(ia == 256 ? ff : _mm_set1_epi32(256), sc2);
+
+    __m128i sc16lo, sc16hi;
+    __LICE_SIMD_SpreadFactor(sc, &sc16lo, &sc16hi);
+    const __m128i rgb = __LICE_SIMD_Lerp(s, d, sc16lo, sc16hi);
+    const __m128i alpha = _mm_adds_epu8(_mm_slli_epi32(sc2, LICE_PIXEL_A*8), d);
+    __m128i out = _mm_or_si128(_mm_andnot_si128(amask, rgb), _mm_and_si128(amask, alpha));
+
+    // pixels with no source alpha are left alone
+    const __m128i keep = _mm_cmpeq_epi32(a, zero);
+    out = _mm_or_si128(_mm_and_si128(keep, d), _mm_andnot_si128(keep, out));
+    _mm_storeu_si128((__m128i *)pout, out);
+    pin += 16;
+    pout += 16;
+    n -= 4;
+  }
+  while (n-- > 0)
+  {
+    if (ia == 256) _LICE_CombinePixelsCopySourceAlphaIgnoreAlphaParmNoClamp::doPix(pout,pin[LICE_PIXEL_R],pin[LICE_PIXEL_G],pin[LICE_PIXEL_B],pin[LICE_PIXEL_A],ia);
+    else _LICE_CombinePixelsCopySourceAlphaNoClamp::doPix(pout,pin[LICE_PIXEL_R],pin[LICE_PIXEL_G],pin[LICE_PIXEL_B],pin[LICE_PIXEL_A],ia);
+    pin += 4;
+    pout += 4;
+  }
+}
+
+#else // LICE_SIMD_NEON
+
+// s + trunc((d-s)*sc/256) for each 16-bit channel, as in the SSE2 version
+static inline uint16x8_t __LICE_SIMD_Lerp16(uint16x8_t s16, uint16x8_t d16, uint16x8_t sc16)
+{
+  const uint16x8_t p = vmulq_u16(d16, sc16);
+  const uint16x8_t q = vmulq_u16(s16, sc16);
+  return vsubq_u16(vaddq_u16(s16, vshrq_n_u16(vqsubq_u16(p, q), 8)), vshrq_n_u16(vqsubq_u16(q, p), 8));
+}
+
+static inline uint8x16_t __LICE_SIMD_Lerp(uint8x16_t s, uint8x16_t d, uint16x8_t sc16lo, uint16x8_t sc16hi)
+{
+  const uint16x8_t lo = __LICE_SIMD_Lerp16(vmovl_u8(vget_low_u8(s)), vmovl_u8(vget_low_u8(d)), sc16lo);
+  const uint16x8_t hi = __LICE_SIMD_Lerp16(vmovl_u8(vget_high_u8(s)), vmovl_u8(vget_high_u8(d)), sc16hi);
+  return vcombine_u8(vmovn_u16(lo), vmovn_u16(hi));
+}
+
+static inline void __LICE_SIMD_SpreadFactor(uint32x4_t sc32, uint16x8_t *sc16lo, uint16x8_t *sc16hi)
+{
+  const uint16x4_t sc = vmovn_u32(sc32);
+  const uint16x4x2_t pairs = vzip_u16(sc, sc); // 0 0 1 1, 2 2 3 3
+  const uint16x4x2_t lo = vzip_u16(pairs.val[0], pairs.val[0]);
+  const uint16x4x2_t hi = vzip_u16(pairs.val[1], pairs.val[1]);
+  *sc16lo = vcombine_u16(lo.val[0], lo.val[1]);
+  *sc16hi = vcombine_u16(hi.val[0], hi.val[1]);
+}
+
+static inline void __LICE_SIMD_CopyRow(LICE_pixel_chan *pout, const LICE_pixel_chan *pin, int n, int ia)
+{
+  const uint16x8_t sc = vdupq_n_u16((uint16_t)(256-ia));
+  while (n >= 4)
+  {
+    const uint8x16_t s = vld1q_u8((const uint8_t *)pin);
+    const uint8x16_t d = vld1q_u8((const uint8_t *)pout);
+    vst1q_u8((uint8_t *)pout, __LICE_SIMD_Lerp(s, d, sc, sc));
+    pin += 16;
+    pout += 16;
+    n -= 4;
+  }
+  while (n-- > 0)
+  {
+    _LICE_CombinePixelsCopyNoClamp::doPix(pout,pin[LICE_PIXEL_R],pin[LICE_PIXEL_G],pin[LICE_PIXEL_B],pin[LICE_PIXEL_A],ia);
+    pin += 4;
+    pout += 4;
+  }
+}
+
+static inline void __LICE_SIMD_CopySourceAlphaRow(LICE_pixel_chan *pout, const LICE_pixel_chan *pin, int n, int ia)
+{
+  const uint32x4_t amask = vdupq_n_u32(0xffu << (LICE_PIXEL_A*8));
+  const uint32x4_t ff = vdupq_n_u32(255);
+  while (n >= 4)
+  {
+    const uint8x16_t s = vld1q_u8((const uint8_t *)pin);
+    const uint8x16_t d = vld1q_u8((const uint8_t *)pout);
+    const uint32x4_t a = vandq_u32(vshrq_n_u32(vreinterpretq_u32_u8(s), LICE_PIXEL_A*8), ff);
+    uint32x4_t sc2;
+    if (ia == 256) sc2 = a;
+    else sc2 = vshrq_n_u32(vmulq_n_u32(vaddq_u32(a, vdupq_n_u32(1)), (uint32_t)ia), 8);
+    const uint32x4_t sc = vsubq_u32(vdupq_n_u32(ia == 256 ? 255 : 256), sc2);
+
+    uint16x8_t sc16lo, sc16hi;
+    __LICE_SIMD_SpreadFactor(sc, &sc16lo, &sc16hi);
+    const uint32x4_t rgb = vreinterpretq_u32_u8(__LICE_SIMD_Lerp(s, d, sc16lo, sc16hi));
+    const uint32x4_t alpha = vreinterpretq_u32_u8(vqaddq_u8(vreinterpretq_u8_u32(vshlq_n_u32(sc2, LICE_PIXEL_A*8)), d));
+    uint32x4_t out = vbslq_u32(amask, alpha, rgb);
+
+    const uint32x4_t keep = vceqq_u32(a, vdupq_n_u32(0));
+    out = vbslq_u32(keep, vreinterpretq_u32_u8(d), out);
+    vst1q_u8((uint8_t *)pout, vreinterpretq_u8_u32(out));
+    pin += 16;
+    pout += 16;
+    n -= 4;
+  }
+  while (n-- > 0)
+  {
+    if (ia == 256) _LICE_CombinePixelsCopySourceAlphaIgnoreAlphaParmNoClamp::doPix(pout,pin[LICE_PIXEL_R],pin[LICE_PIXEL_G],pin[LICE_PIXEL_B],pin[LICE_PIXEL_A],ia);
+    else _LICE_CombinePixelsCopySourceAlphaNoClamp::doPix(pout,pin[LICE_PIXEL_R],pin[LICE_PIXEL_G],pin[LICE_PIXEL_B],pin[LICE_PIXEL_A],ia);
+    pin += 4;
+    pout += 4;
+  }
+}
+
+#endif // LICE_SIMD_NEON
+
+// LICE_Blit() with the blends above, returns false if the mode is not one of them
+static inline bool __LICE_SIMD_Blit(LICE_pixel_chan *dest, const LICE_pixel_chan *src, int w, int h, int src_span, int dest_span, int ia, int mode)
+{
+  const int m = mode&(LICE_BLIT_MODE_MASK|LICE_BLIT_USE_ALPHA);
+  if (ia <= 0 || ia > 256) return false;
+  if (m == LICE_BLIT_MODE_COPY && ia < 256)
+  {
+    while (h-- > 0)
+    {
+      __LICE_SIMD_CopyRow(dest, src, w, ia);
+      dest += dest_span;
+      src += src_span;
+    }
+    return true;
+  }
+  if (m == (LICE_BLIT_MODE_COPY|LICE_BLIT_USE_ALPHA))
+  {
+    while (h-- > 0)
+    {
+      __LICE_SIMD_CopySourceAlphaRow(dest, src, w, ia);
+      dest += dest_span;
+      src += src_span;
+    }
+    return true;
+  }
+  return false;
+}
+
+#endif // LICE_SIMD_SSE2 || LICE_SIMD_NEON
+
+#endif // _LICE_SIMD_H_
@@ -33,10 +33,27 @@
   #endif
 #endif
 
+// AVX is used when the compiler targets it (e.g. -mavx or /arch:AVX), and NEON on arm64. Define WDL_RESAMPLE_NO_AVX / WDL_RESAMPLE_NO_NEON to disable them
+#if defined(WDL_RESAMPLE_USE_SSE) && !defined(WDL_RESAMPLE_NO_AVX) && !defined(WDL_RESAMPLE_USE_AVX) && defined(__AVX__)
+  #define WDL_RESAMPLE_USE_AVX
+#endif
+
+#if !defined(WDL_RESAMPLE_NO_NEON) && !defined(WDL_RESAMPLE_USE_NEON) && defined(__ARM_NEON) && defined(__aarch64__)
+  #define WDL_RESAMPLE_USE_NEON
+#endif
+
 #ifdef WDL_RESAMPLE_USE_SSE
   #include <emmintrin.h>
 #endif
 
+#ifdef WDL_RESAMPLE_USE_AVX
+  #include <immintrin.h>
+#endif
+
+#ifdef WDL_RESAMPLE_USE_NEON
+  #include <arm_neon.h>
+#endif
+
 #ifndef PI
 #define PI 3.1415926535897932384626433832795
 #endif
@@ -429,6 +446,7 @@ static void inline SincSampleN(double *outptr, const double *inptr, double fracp
 
 }
 
+#ifndef WDL_RESAMPLE_USE_AVX // the AVX versions below replace the mono kernels
 static void inline SincSample1(double *outptr, const double *inptr, double fracpos, const float *filter, int filtsz, int oversize)
 {
   fracpos *= oversize;
@@ -556,115 +574,7 @@ static void inline SincSample1N(double *outptr, const double *inptr, double frac
   outptr[0]=sum2;
 }
 
-static void inline SincSample2(double *outptr, const double *inptr, double fracpos, const float *filter, int filtsz, int oversize)
-{
-  fracpos *= oversize;
-  const int ifpos=(int)fracpos;
-  fracpos -= ifpos;
-
-  const float *fptr2=filter + (oversize-ifpos) * filtsz;
-  const float *fptr=fptr2 - filtsz;
-
-  double sum, sum2, sumb, sum2b;
-  const double *iptr=inptr;
-  int i=filtsz/2;
-
-  __m128d xmm0 = _mm_setzero_pd();
-  __m128d xmm1 = _mm_setzero_pd();
-  __m128d xmm2, xmm3;
-  __m128 xmm4;
-
-  while (i--)
-  {
-    xmm2 = _mm_loadu_pd(iptr);
-
-    xmm4 = _mm_set1_ps(fptr[0]);
-    xmm3 = _mm_cvtps_pd(xmm4);
-    xmm3 = _mm_mul_pd(xmm3, xmm2);
-    xmm0 = _mm_add_pd(xmm0, xmm3);
-
-    xmm4 = _mm_set1_ps(fptr2[0]);
-    xmm3 = _mm_cvtps_pd(xmm4);
-    xmm3 = _mm_mul_pd(xmm3, xmm2);
-    xmm1 = _mm_add_pd(xmm1, xmm3);
-
-    xmm2 = _mm_loadu_pd(iptr+2);
-
-    xmm4 = _mm_set1_ps(fptr[1]);
-    xmm3 = _mm_cvtps_pd(xmm4);
-    xmm3 = _mm_mul_pd(xmm3, xmm2);
-    xmm0 = _mm_add_pd(xmm0, xmm3);
-
-    xmm4 = _mm_set1_ps(fptr2[1]);
-    xmm3 = _mm_cvtps_pd(xmm4);
-    xmm3 = _mm_mul_pd(xmm3, xmm2);
-    xmm1 = _mm_add_pd(xmm1, xmm3);
-
-    iptr+=4;
-    fptr+=2;
-    fptr2+=2;
-  }
-
-  xmm2 = xmm0;
-  _mm_store_sd(&sum, xmm0);
-  xmm2 = _mm_unpackhi_pd(xmm2, xmm0);
-  _mm_store_sd(&sum2, xmm2);
-
-  xmm3 = xmm1;
-  _mm_store_sd(&sumb, xmm1);
-  xmm3 = _mm_unpackhi_pd(xmm3, xmm1);
-  _mm_store_sd(&sum2b, xmm3);
-
-  outptr[0]=sum*fracpos + sumb*(1.0-fracpos);
-  outptr[1]=sum2*fracpos + sum2b*(1.0-fracpos);
-}
-
-static void inline SincSample2N(double *outptr, const double *inptr, double fracpos, const float *filter, int filtsz, int oversize)
-{
-  const int ifpos=(int)(fracpos*oversize+0.5);
-
-  const float *fptr2=filter + (oversize-ifpos) * filtsz;
-
-  double sumb, sum2b;
-  const double *iptr=inptr;
-  int i=filtsz/2;
-
-  __m128d xmm0 = _mm_setzero_pd();
-  __m128d xmm1 = _mm_setzero_pd();
-  __m128d xmm2, xmm3;
-  __m128 xmm4;
-
-  while (i--)
-  {
-    xmm2 = _mm_loadu_pd(iptr);
-
-    xmm4 = _mm_set1_ps(fptr2[0]);
-    xmm3 = _mm_cvtps_pd(xmm4);
-    xmm3 = _mm_mul_pd(xmm3, xmm2);
-    xmm0 = _mm_add_pd(xmm0, xmm3);
-
-    xmm2 = _mm_loadu_pd(iptr+2);
-
-    xmm4 = _mm_set1_ps(fptr2[1]);
-    xmm3 = _mm_cvtps_pd(xmm4);
-    xmm3 = _mm_mul_pd(xmm3, xmm2);
-    xmm1 = _mm_add_pd(xmm1, xmm3);
-
-    iptr+=4;
-    fptr2+=2;
-  }
-
-  xmm1 = _mm_add_pd(xmm1, xmm0);
-
-  xmm3 = xmm1;
-  _mm_store_sd(&sumb, xmm1);
-  xmm3 = _mm_unpackhi_pd(xmm3, xmm1);
-  _mm_store_sd(&sum2b, xmm3);
-
-  outptr[0]=sumb;
-  outptr[1]=sum2b;
-}
-
+#endif // !WDL_RESAMPLE_USE_AVX
 
 static void inline SincSample(double *outptr, const double *inptr, double fracpos, int nch, const double *filter, int filtsz, int oversize)
 {
@@ -804,6 +714,7 @@ static void inline SincSampleN(double *outptr, const double *inptr, double fracp
 
 }
 
+#ifndef WDL_RESAMPLE_USE_AVX
 static void inline SincSample1(double *outptr, const double *inptr, double fracpos, const double *filter, int filtsz, int oversize)
 {
   fracpos *= oversize;
@@ -924,154 +835,420 @@ static void inline SincSample1N(double *outptr, const double *inptr, double frac
   outptr[0]=sum2;
 }
 
-static void inline SincSample2(double *outptr, const double *inptr, double fracpos, const double *filter, int filtsz, int oversize)
+#endif // !WDL_RESAMPLE_USE_AVX
+
+
+// stereo interleaved, deinterleaving 2 frames into [L0 L1] and [R0 R1] so the filter taps load as they are stored
+
+static inline __m128d wdl_resample_load2(const float *p) { return _mm_cvtps_pd(_mm_castpd_ps(_mm_load_sd((const double *)p))); }
+static inline __m128d wdl_resample_load2(const double *p) { return _mm_loadu_pd(p); }
+
+template <class T2> static void inline SincSample2_SSE(double *outptr, const double *inptr, double fracpos, const T2 *filter, int filtsz, int oversize)
 {
   fracpos *= oversize;
   const int ifpos=(int)fracpos;
   fracpos -= ifpos;
 
-  const double *fptr2=filter + (oversize-ifpos) * filtsz;
-  const double *fptr=fptr2 - filtsz;
-
-  double sum, sum2, sumb, sum2b;
+  const T2 *fptr2=filter + (oversize-ifpos) * filtsz;
+  const T2 *fptr=fptr2 - filtsz;
   const double *iptr=inptr;
   int i=filtsz/2;
 
-  __m128d xmm0 = _mm_setzero_pd();
-  __m128d xmm1 = _mm_setzero_pd();
-  __m128d xmm2 = _mm_setzero_pd();
-  __m128d xmm3 = _mm_setzero_pd();
-  __m128d xmm4, xmm5, xmm6, xmm7;
+  __m128d sum = _mm_setzero_pd(), sum2 = _mm_setzero_pd();
+  __m128d sumb = _mm_setzero_pd(), sum2b = _mm_setzero_pd();
 
   while (i--)
   {
-    xmm4 = _mm_load_pd(fptr);
-    xmm5 = _mm_load_pd(fptr2);
+    const __m128d in = _mm_loadu_pd(iptr), in2 = _mm_loadu_pd(iptr+2);
+    const __m128d l = _mm_unpacklo_pd(in, in2), r = _mm_unpackhi_pd(in, in2);
+    const __m128d f = wdl_resample_load2(fptr), f2 = wdl_resample_load2(fptr2);
+    sum = _mm_add_pd(sum, _mm_mul_pd(f, l));
+    sum2 = _mm_add_pd(sum2, _mm_mul_pd(f, r));
+    sumb = _mm_add_pd(sumb, _mm_mul_pd(f2, l));
+    sum2b = _mm_add_pd(sum2b, _mm_mul_pd(f2, r));
+    iptr+=4;
+    fptr+=2;
+    fptr2+=2;
+  }
 
-    xmm6 = _mm_loadu_pd(iptr);
+  // [sumL sumR] for each phase
+  const __m128d lr = _mm_add_pd(_mm_unpacklo_pd(sum, sum2), _mm_unpackhi_pd(sum, sum2));
+  const __m128d lrb = _mm_add_pd(_mm_unpacklo_pd(sumb, sum2b), _mm_unpackhi_pd(sumb, sum2b));
 
-    xmm7 = xmm4;
-    xmm7 = _mm_unpacklo_pd(xmm7, xmm4);
-    xmm7 = _mm_mul_pd(xmm7, xmm6);
-    xmm0 = _mm_add_pd(xmm0, xmm7);
+  _mm_storeu_pd(outptr, _mm_add_pd(_mm_mul_pd(lr, _mm_set1_pd(fracpos)), _mm_mul_pd(lrb, _mm_set1_pd(1.0-fracpos))));
+}
 
-    xmm7 = xmm5;
-    xmm7 = _mm_unpacklo_pd(xmm7, xmm5);
-    xmm7 = _mm_mul_pd(xmm7, xmm6);
-    xmm1 = _mm_add_pd(xmm1, xmm7);
+template <class T2> static void inline SincSample2N_SSE(double *outptr, const double *inptr, double fracpos, const T2 *filter, int filtsz, int oversize)
+{
+  const int ifpos=(int)(fracpos*oversize+0.5);
 
-    xmm6 = _mm_loadu_pd(iptr+2);
+  const T2 *fptr2=filter + (oversize-ifpos) * filtsz;
+  const double *iptr=inptr;
+  int i=filtsz/2;
 
-    xmm4 = _mm_unpackhi_pd(xmm4, xmm4);
-    xmm4 = _mm_mul_pd(xmm4, xmm6);
-    xmm2 = _mm_add_pd(xmm2, xmm4);
+  __m128d sum = _mm_setzero_pd(), sum2 = _mm_setzero_pd();
+  __m128d sumb = _mm_setzero_pd(), sum2b = _mm_setzero_pd();
 
-    xmm5 = _mm_unpackhi_pd(xmm5, xmm5);
-    xmm5 = _mm_mul_pd(xmm5, xmm6);
-    xmm3 = _mm_add_pd(xmm3, xmm5);
+  while (i >= 2)
+  {
+    const __m128d in = _mm_loadu_pd(iptr), in2 = _mm_loadu_pd(iptr+2);
+    const __m128d inb = _mm_loadu_pd(iptr+4), in2b = _mm_loadu_pd(iptr+6);
+    const __m128d f = wdl_resample_load2(fptr2), fb = wdl_resample_load2(fptr2+2);
+    sum = _mm_add_pd(sum, _mm_mul_pd(f, _mm_unpacklo_pd(in, in2)));
+    sum2 = _mm_add_pd(sum2, _mm_mul_pd(f, _mm_unpackhi_pd(in, in2)));
+    sumb = _mm_add_pd(sumb, _mm_mul_pd(fb, _mm_unpacklo_pd(inb, in2b)));
+    sum2b = _mm_add_pd(sum2b, _mm_mul_pd(fb, _mm_unpackhi_pd(inb, in2b)));
+    iptr+=8;
+    fptr2+=4;
+    i-=2;
+  }
 
-    iptr+=4;
-    fptr+=2;
-    fptr2+=2;
+  if (i)
+  {
+    const __m128d in = _mm_loadu_pd(iptr), in2 = _mm_loadu_pd(iptr+2);
+    const __m128d f = wdl_resample_load2(fptr2);
+    sum = _mm_add_pd(sum, _mm_mul_pd(f, _mm_unpacklo_pd(in, in2)));
+    sum2 = _mm_add_pd(sum2, _mm_mul_pd(f, _mm_unpackhi_pd(in, in2)));
   }
 
-  xmm0 = _mm_add_pd(xmm0, xmm2);
-  xmm1 = _mm_add_pd(xmm1, xmm3);
+  sum = _mm_add_pd(sum, sumb);
+  sum2 = _mm_add_pd(sum2, sum2b);
 
-  xmm2 = xmm0;
-  _mm_store_sd(&sum, xmm0);
-  xmm2 = _mm_unpackhi_pd(xmm2, xmm0);
-  _mm_store_sd(&sum2, xmm2);
+  _mm_storeu_pd(outptr, _mm_add_pd(_mm_unpacklo_pd(sum, sum2), _mm_unpackhi_pd(sum, sum2)));
+}
 
-  xmm3 = xmm1;
-  _mm_store_sd(&sumb, xmm1);
-  xmm3 = _mm_unpackhi_pd(xmm3, xmm1);
-  _mm_store_sd(&sum2b, xmm3);
+#ifndef WDL_RESAMPLE_USE_AVX
+static void inline SincSample2(double *outptr, const double *inptr, double fracpos, const float *filter, int filtsz, int oversize) { SincSample2_SSE(outptr, inptr, fracpos, filter, filtsz, oversize); }
+static void inline SincSample2N(double *outptr, const double *inptr, double fracpos, const float *filter, int filtsz, int oversize) { SincSample2N_SSE(outptr, inptr, fracpos, filter, filtsz, oversize); }
+static void inline SincSample2(double *outptr, const double *inptr, double fracpos, const double *filter, int filtsz, int oversize) { SincSample2_SSE(outptr, inptr, fracpos, filter, filtsz, oversize); }
+static void inline SincSample2N(double *outptr, const double *inptr, double fracpos, const double *filter, int filtsz, int oversize) { SincSample2N_SSE(outptr, inptr, fracpos, filter, filtsz, oversize); }
+#endif
 
-  outptr[0]=sum*fracpos + sumb*(1.0-fracpos);
-  outptr[1]=sum2*fracpos + sum2b*(1.0-fracpos);
+#endif // WDL_RESAMPLE_USE_SSE
+
+#ifdef WDL_RESAMPLE_USE_AVX
+
+// 4 taps per instruction, for the mono and stereo interleaved cases. filtsz is always even, so at most 2 taps are left over after the 4 wide loops
+
+static inline __m256d wdl_resample_load4(const float *p) { return _mm256_cvtps_pd(_mm_loadu_ps(p)); }
+static inline __m256d wdl_resample_load4(const double *p) { return _mm256_loadu_pd(p); }
+
+static inline __m128d wdl_resample_fold(__m256d v) { return _mm_add_pd(_mm256_castpd256_pd128(v), _mm256_extractf128_pd(v, 1)); }
+
+static inline double wdl_resample_hsum(__m256d v, __m128d tail)
+{
+  __m128d s = _mm_add_pd(wdl_resample_fold(v), tail);
+  s = _mm_add_sd(s, _mm_unpackhi_pd(s, s));
+  return _mm_cvtsd_f64(s);
 }
 
-static void inline SincSample2N(double *outptr, const double *inptr, double fracpos, const double *filter, int filtsz, int oversize)
+template <class T2> static void inline SincSample1_AVX(double *outptr, const double *inptr, double fracpos, const T2 *filter, int filtsz, int oversize)
+{
+  fracpos *= oversize;
+  const int ifpos=(int)fracpos;
+  fracpos -= ifpos;
+
+  const T2 *fptr2=filter + (oversize-ifpos) * filtsz;
+  const T2 *fptr=fptr2 - filtsz;
+  const double *iptr=inptr;
+  int i=filtsz;
+
+  __m256d sum = _mm256_setzero_pd();
+  __m256d sum2 = _mm256_setzero_pd();
+  __m128d tail = _mm_setzero_pd();
+  __m128d tail2 = _mm_setzero_pd();
+
+  while (i >= 4)
+  {
+    const __m256d in = _mm256_loadu_pd(iptr);
+    sum = _mm256_add_pd(sum, _mm256_mul_pd(wdl_resample_load4(fptr), in));
+    sum2 = _mm256_add_pd(sum2, _mm256_mul_pd(wdl_resample_load4(fptr2), in));
+    iptr+=4;
+    fptr+=4;
+    fptr2+=4;
+    i-=4;
+  }
+
+  if (i)
+  {
+    const __m128d in = _mm_loadu_pd(iptr);
+    tail = _mm_mul_pd(wdl_resample_load2(fptr), in);
+    tail2 = _mm_mul_pd(wdl_resample_load2(fptr2), in);
+  }
+
+  outptr[0]=wdl_resample_hsum(sum, tail)*fracpos + wdl_resample_hsum(sum2, tail2)*(1.0-fracpos);
+}
+
+template <class T2> static void inline SincSample1N_AVX(double *outptr, const double *inptr, double fracpos, const T2 *filter, int filtsz, int oversize)
 {
   const int ifpos=(int)(fracpos*oversize+0.5);
 
-  const double *fptr2=filter + (oversize-ifpos) * filtsz;
+  const T2 *fptr2=filter + (oversize-ifpos) * filtsz;
+  const double *iptr=inptr;
+  int i=filtsz;
+
+  // two accumulators, since there is only one filter phase to hide the latency of the adds behind
+  __m256d sum = _mm256_setzero_pd();
+  __m256d sumb = _mm256_setzero_pd();
+  __m128d tail = _mm_setzero_pd();
+
+  while (i >= 8)
+  {
+    sum = _mm256_add_pd(sum, _mm256_mul_pd(wdl_resample_load4(fptr2), _mm256_loadu_pd(iptr)));
+    sumb = _mm256_add_pd(sumb, _mm256_mul_pd(wdl_resample_load4(fptr2+4), _mm256_loadu_pd(iptr+4)));
+    iptr+=8;
+    fptr2+=8;
+    i-=8;
+  }
+
+  if (i >= 4)
+  {
+    sum = _mm256_add_pd(sum, _mm256_mul_pd(wdl_resample_load4(fptr2), _mm256_loadu_pd(iptr)));
+    iptr+=4;
+    fptr2+=4;
+    i-=4;
+  }
+
+  if (i)
+    tail = _mm_mul_pd(wdl_resample_load2(fptr2), _mm_loadu_pd(iptr));
+
+  outptr[0]=wdl_resample_hsum(_mm256_add_pd(sum, sumb), tail);
+}
+
+// deinterleave 4 stereo frames into [L0 L1 L2 L3] and [R0 R1 R2 R3], 4 shuffles shared by both filter phases
+static inline void wdl_resample_deinterleave4(const double *iptr, __m256d &l, __m256d &r)
+{
+  const __m256d in = _mm256_loadu_pd(iptr), inb = _mm256_loadu_pd(iptr+4);
+  const __m256d lo = _mm256_permute2f128_pd(in, inb, 0x20), hi = _mm256_permute2f128_pd(in, inb, 0x31);
+  l = _mm256_unpacklo_pd(lo, hi);
+  r = _mm256_unpackhi_pd(lo, hi);
+}
+
+template <class T2> static void inline SincSample2_AVX(double *outptr, const double *inptr, double fracpos, const T2 *filter, int filtsz, int oversize)
+{
+  fracpos *= oversize;
+  const int ifpos=(int)fracpos;
+  fracpos -= ifpos;
 
-  double sumb, sum2b;
+  const T2 *fptr2=filter + (oversize-ifpos) * filtsz;
+  const T2 *fptr=fptr2 - filtsz;
   const double *iptr=inptr;
-  int i=filtsz/2;
+  int i=filtsz;
 
-  __m128d xmm0 = _mm_setzero_pd();
-  __m128d xmm1 = _mm_setzero_pd();
-  __m128d xmm2 = _mm_setzero_pd();
-  __m128d xmm3 = _mm_setzero_pd();
-  __m128d xmm4, xmm5, xmm6;
+  __m256d sum = _mm256_setzero_pd(), sum2 = _mm256_setzero_pd();
+  __m256d sumb = _mm256_setzero_pd(), sum2b = _mm256_setzero_pd();
+  __m128d tail = _mm_setzero_pd(), tailb = _mm_setzero_pd();
 
-  while (i >= 2)
+  while (i >= 4)
   {
-    xmm4 = _mm_load_pd(fptr2);
-    xmm5 = xmm4;
+    __m256d l, r;
+    wdl_resample_deinterleave4(iptr, l, r);
+    const __m256d f = wdl_resample_load4(fptr), f2 = wdl_resample_load4(fptr2);
+    sum = _mm256_add_pd(sum, _mm256_mul_pd(f, l));
+    sum2 = _mm256_add_pd(sum2, _mm256_mul_pd(f, r));
+    sumb = _mm256_add_pd(sumb, _mm256_mul_pd(f2, l));
+    sum2b = _mm256_add_pd(sum2b, _mm256_mul_pd(f2, r));
+    iptr+=8;
+    fptr+=4;
+    fptr2+=4;
+    i-=4;
+  }
 
-    xmm6 = _mm_loadu_pd(iptr);
-    xmm4 = _mm_unpacklo_pd(xmm4, xmm5);
-    xmm6 = _mm_mul_pd(xmm6, xmm4);
-    xmm0 = _mm_add_pd(xmm0, xmm6);
+  if (i) // tail holds [L R] for each phase
+  {
+    const __m128d in = _mm_loadu_pd(iptr), inb = _mm_loadu_pd(iptr+2);
+    const __m128d f = wdl_resample_load2(fptr), f2 = wdl_resample_load2(fptr2);
+    tail = _mm_add_pd(_mm_mul_pd(_mm_unpacklo_pd(f, f), in), _mm_mul_pd(_mm_unpackhi_pd(f, f), inb));
+    tailb = _mm_add_pd(_mm_mul_pd(_mm_unpacklo_pd(f2, f2), in), _mm_mul_pd(_mm_unpackhi_pd(f2, f2), inb));
+  }
 
-    xmm6 = _mm_loadu_pd(iptr+2);
-    xmm5 = _mm_unpackhi_pd(xmm5, xmm5);
-    xmm6 = _mm_mul_pd(xmm6, xmm5);
-    xmm1 = _mm_add_pd(xmm1, xmm6);
+  // [sumL sumR] for each phase
+  const __m128d lr = _mm_add_pd(_mm_hadd_pd(wdl_resample_fold(sum), wdl_resample_fold(sum2)), tail);
+  const __m128d lrb = _mm_add_pd(_mm_hadd_pd(wdl_resample_fold(sumb), wdl_resample_fold(sum2b)), tailb);
 
-    xmm4 = _mm_load_pd(fptr2+2);
-    xmm5 = xmm4;
+  _mm_storeu_pd(outptr, _mm_add_pd(_mm_mul_pd(lr, _mm_set1_pd(fracpos)), _mm_mul_pd(lrb, _mm_set1_pd(1.0-fracpos))));
+}
 
-    xmm6 = _mm_loadu_pd(iptr+4);
-    xmm4 = _mm_unpacklo_pd(xmm4, xmm5);
-    xmm6 = _mm_mul_pd(xmm6, xmm4);
-    xmm2 = _mm_add_pd(xmm2, xmm6);
+template <class T2> static void inline SincSample2N_AVX(double *outptr, const double *inptr, double fracpos, const T2 *filter, int filtsz, int oversize)
+{
+  const int ifpos=(int)(fracpos*oversize+0.5);
+
+  const T2 *fptr2=filter + (oversize-ifpos) * filtsz;
+  const double *iptr=inptr;
+  int i=filtsz;
 
-    xmm6 = _mm_loadu_pd(iptr+6);
-    xmm5 = _mm_unpackhi_pd(xmm5, xmm5);
-    xmm6 = _mm_mul_pd(xmm6, xmm5);
-    xmm3 = _mm_add_pd(xmm3, xmm6);
+  __m256d sum = _mm256_setzero_pd(), sum2 = _mm256_setzero_pd();
+  __m128d tail = _mm_setzero_pd();
 
+  while (i >= 4)
+  {
+    __m256d l, r;
+    wdl_resample_deinterleave4(iptr, l, r);
+    const __m256d f = wdl_resample_load4(fptr2);
+    sum = _mm256_add_pd(sum, _mm256_mul_pd(f, l));
+    sum2 = _mm256_add_pd(sum2, _mm256_mul_pd(f, r));
     iptr+=8;
     fptr2+=4;
-    i-=2;
+    i-=4;
   }
 
   if (i)
   {
-    xmm4 = _mm_load_pd(fptr2);
-    xmm5 = xmm4;
-
-    xmm6 = _mm_loadu_pd(iptr);
-    xmm4 = _mm_unpacklo_pd(xmm4, xmm5);
-    xmm6 = _mm_mul_pd(xmm6, xmm4);
-    xmm0 = _mm_add_pd(xmm0, xmm6);
-
-    xmm6 = _mm_loadu_pd(iptr+2);
-    xmm5 = _mm_unpackhi_pd(xmm5, xmm5);
-    xmm6 = _mm_mul_pd(xmm6, xmm5);
-    xmm1 = _mm_add_pd(xmm1, xmm6);
+    const __m128d f = wdl_resample_load2(fptr2);
+    tail = _mm_add_pd(_mm_mul_pd(_mm_unpacklo_pd(f, f), _mm_loadu_pd(iptr)), _mm_mul_pd(_mm_unpackhi_pd(f, f), _mm_loadu_pd(iptr+2)));
   }
 
-  xmm0 = _mm_add_pd(xmm0, xmm2);
-  xmm1 = _mm_add_pd(xmm1, xmm3);
+  _mm_storeu_pd(outptr, _mm_add_pd(_mm_hadd_pd(wdl_resample_fold(sum), wdl_resample_fold(sum2)), tail));
+}
 
-  xmm1 = _mm_add_pd(xmm1, xmm0);
+static void inline SincSample1(double *outptr, const double *inptr, double fracpos, const float *filter, int filtsz, int oversize) { SincSample1_AVX(outptr, inptr, fracpos, filter, filtsz, oversize); }
+static void inline SincSample1N(double *outptr, const double *inptr, double fracpos, const float *filter, int filtsz, int oversize) { SincSample1N_AVX(outptr, inptr, fracpos, filter, filtsz, oversize); }
+static void inline SincSample2(double *outptr, const double *inptr, double fracpos, const float *filter, int filtsz, int oversize) { SincSample2_AVX(outptr, inptr, fracpos, filter, filtsz, oversize); }
+static void inline SincSample2N(double *outptr, const double *inptr, double fracpos, const float *filter, int filtsz, int oversize) { SincSample2N_AVX(outptr, inptr, fracpos, filter, filtsz, oversize); }
+static void inline SincSample1(double *outptr, const double *inptr, double fracpos, const double *filter, int filtsz, int oversize) { SincSample1_AVX(outptr, inptr, fracpos, filter, filtsz, oversize); }
+static void inline SincSample1N(double *outptr, const double *inptr, double fracpos, const double *filter, int filtsz, int oversize) { SincSample1N_AVX(outptr, inptr, fracpos, filter, filtsz, oversize); }
+static void inline SincSample2(double *outptr, const double *inptr, double fracpos, const double *filter, int filtsz, int oversize) { SincSample2_AVX(outptr, inptr, fracpos, filter, filtsz, oversize); }
+static void inline SincSample2N(double *outptr, const double *inptr, double fracpos, const double *filter, int filtsz, int oversize) { SincSample2N_AVX(outptr, inptr, fracpos, filter, filtsz, oversize); }
 
-  xmm3 = xmm1;
-  _mm_store_sd(&sumb, xmm1);
-  xmm3 = _mm_unpackhi_pd(xmm3, xmm1);
-  _mm_store_sd(&sum2b, xmm3);
+#endif // WDL_RESAMPLE_USE_AVX
 
-  outptr[0]=sumb;
-  outptr[1]=sum2b;
+
+#ifdef WDL_RESAMPLE_USE_NEON
+
+// 2 doubles per register, for the mono and stereo interleaved cases. filtsz is always even
+
+static inline float64x2_t wdl_resample_load2(const float *p) { return vcvt_f64_f32(vld1_f32(p)); }
+static inline float64x2_t wdl_resample_load2(const double *p) { return vld1q_f64(p); }
+
+template <class T2> static void inline SincSample1_NEON(double *outptr, const double *inptr, double fracpos, const T2 *filter, int filtsz, int oversize)
+{
+  fracpos *= oversize;
+  const int ifpos=(int)fracpos;
+  fracpos -= ifpos;
+
+  const T2 *fptr2=filter + (oversize-ifpos) * filtsz;
+  const T2 *fptr=fptr2 - filtsz;
+  const double *iptr=inptr;
+  int i=filtsz;
+
+  float64x2_t sum = vdupq_n_f64(0.0), sumb = vdupq_n_f64(0.0);
+  float64x2_t sum2 = vdupq_n_f64(0.0), sum2b = vdupq_n_f64(0.0);
+
+  while (i >= 4)
+  {
+    const float64x2_t in = vld1q_f64(iptr);
+    const float64x2_t inb = vld1q_f64(iptr+2);
+    sum = vfmaq_f64(sum, wdl_resample_load2(fptr), in);
+    sumb = vfmaq_f64(sumb, wdl_resample_load2(fptr+2), inb);
+    sum2 = vfmaq_f64(sum2, wdl_resample_load2(fptr2), in);
+    sum2b = vfmaq_f64(sum2b, wdl_resample_load2(fptr2+2), inb);
+    iptr+=4;
+    fptr+=4;
+    fptr2+=4;
+    i-=4;
+  }
+
+  if (i)
+  {
+    const float64x2_t in = vld1q_f64(iptr);
+    sum = vfmaq_f64(sum, wdl_resample_load2(fptr), in);
+    sum2 = vfmaq_f64(sum2, wdl_resample_load2(fptr2), in);
+  }
+
+  outptr[0]=vaddvq_f64(vaddq_f64(sum, sumb))*fracpos + vaddvq_f64(vaddq_f64(sum2, sum2b))*(1.0-fracpos);
 }
 
-#endif // WDL_RESAMPLE_USE_SSE
+template <class T2> static void inline SincSample1N_NEON(double *outptr, const double *inptr, double fracpos, const T2 *filter, int filtsz, int oversize)
+{
+  const int ifpos=(int)(fracpos*oversize+0.5);
+
+  const T2 *fptr2=filter + (oversize-ifpos) * filtsz;
+  const double *iptr=inptr;
+  int i=filtsz;
+
+  float64x2_t sum = vdupq_n_f64(0.0), sumb = vdupq_n_f64(0.0);
+
+  while (i >= 4)
+  {
+    sum = vfmaq_f64(sum, wdl_resample_load2(fptr2), vld1q_f64(iptr));
+    sumb = vfmaq_f64(sumb, wdl_resample_load2(fptr2+2), vld1q_f64(iptr+2));
+    iptr+=4;
+    fptr2+=4;
+    i-=4;
+  }
+
+  if (i)
+    sum = vfmaq_f64(sum, wdl_resample_load2(fptr2), vld1q_f64(iptr));
+
+  outptr[0]=vaddvq_f64(vaddq_f64(sum, sumb));
+}
+
+template <class T2> static void inline SincSample2_NEON(double *outptr, const double *inptr, double fracpos, const T2 *filter, int filtsz, int oversize)
+{
+  fracpos *= oversize;
+  const int ifpos=(int)fracpos;
+  fracpos -= ifpos;
+
+  const T2 *fptr2=filter + (oversize-ifpos) * filtsz;
+  const T2 *fptr=fptr2 - filtsz;
+  const double *iptr=inptr;
+  int i=filtsz/2;
+
+  // each register holds L and R, the even and odd taps accumulate separately
+  float64x2_t sum = vdupq_n_f64(0.0), sumb = vdupq_n_f64(0.0);
+  float64x2_t sum2 = vdupq_n_f64(0.0), sum2b = vdupq_n_f64(0.0);
+
+  while (i--)
+  {
+    const float64x2_t in = vld1q_f64(iptr);
+    const float64x2_t inb = vld1q_f64(iptr+2);
+    const float64x2_t f = wdl_resample_load2(fptr);
+    const float64x2_t f2 = wdl_resample_load2(fptr2);
+    sum = vfmaq_laneq_f64(sum, in, f, 0);
+    sumb = vfmaq_laneq_f64(sumb, inb, f, 1);
+    sum2 = vfmaq_laneq_f64(sum2, in, f2, 0);
+    sum2b = vfmaq_laneq_f64(sum2b, inb, f2, 1);
+    iptr+=4;
+    fptr+=2;
+    fptr2+=2;
+  }
+
+  const float64x2_t out = vaddq_f64(vmulq_n_f64(vaddq_f64(sum, sumb), fracpos), vmulq_n_f64(vaddq_f64(sum2, sum2b), 1.0-fracpos));
+  vst1q_f64(outptr, out);
+}
+
+template <class T2> static void inline SincSample2N_NEON(double *outptr, const double *inptr, double fracpos, const T2 *filter, int filtsz, int oversize)
+{
+  const int ifpos=(int)(fracpos*oversize+0.5);
+
+  const T2 *fptr2=filter + (oversize-ifpos) * filtsz;
+  const double *iptr=inptr;
+  int i=filtsz/2;
+
+  float64x2_t sum = vdupq_n_f64(0.0), sumb = vdupq_n_f64(0.0);
+
+  while (i--)
+  {
+    const float64x2_t f = wdl_resample_load2(fptr2);
+    sum = vfmaq_laneq_f64(sum, vld1q_f64(iptr), f, 0);
+    sumb = vfmaq_laneq_f64(sumb, vld1q_f64(iptr+2), f, 1);
+    iptr+=4;
+    fptr2+=2;
+  }
+
+  vst1q_f64(outptr, vaddq_f64(sum, sumb));
+}
+
+static void inline SincSample1(double *outptr, const double *inptr, double fracpos, const float *filter, int filtsz, int oversize) { SincSample1_NEON(outptr, inptr, fracpos, filter, filtsz, oversize); }
+static void inline SincSample1N(double *outptr, const double *inptr, double fracpos, const float *filter, int filtsz, int oversize) { SincSample1N_NEON(outptr, inptr, fracpos, filter, filtsz, oversize); }
+static void inline SincSample2(double *outptr, const double *inptr, double fracpos, const float *filter, int filtsz, int oversize) { SincSample2_NEON(outptr, inptr, fracpos, filter, filtsz, oversize); }
+static void inline SincSample2N(double *outptr, const double *inptr, double fracpos, const float *filter, int filtsz, int oversize) { SincSample2N_NEON(outptr, inptr, fracpos, filter, filtsz, oversize); }
+static void inline SincSample1(double *outptr, const double *inptr, double fracpos, const double *filter, int filtsz, int oversize) { SincSample1_NEON(outptr, inptr, fracpos, filter, filtsz, oversize); }
+static void inline SincSample1N(double *outptr, const double *inptr, double fracpos, const double *filter, int filtsz, int oversize) { SincSample1N_NEON(outptr, inptr, fracpos, filter, filtsz, oversize); }
+static void inline SincSample2(double *outptr, const double *inptr, double fracpos, const double *filter, int filtsz, int oversize) { SincSample2_NEON(outptr, inptr, fracpos, filter, filtsz, oversize); }
+static void inline SincSample2N(double *outptr, const double *inptr, double fracpos, const double *filter, int filtsz, int oversize) { SincSample2N_NEON(outptr, inptr, fracpos, filter, filtsz, oversize); }
+
+#endif // WDL_RESAMPLE_USE_NEON
 
 
 WDL_Resampler::WDL_Resampler()
@@ -70,11 +70,31 @@ CFLAGS = $(INCLUDE_PATHS) \
 -DWDL_NO_DEFINE_MINMAX \
 -DNDEBUG=1
 
+# Set WASM_SIMD=1 (e.g. make WASM_SIMD=1) to build with wasm SIMD, which IPlugPlatform.h detects as IPLUG_SIMD_WASM for the vectorised kernels in IPlug and HIIR.
+# The module then needs a browser with wasm SIMD support (Chrome 91, Firefox 89, Safari 16.4 or later)
+WASM_SIMD ?= 0
+
+ifeq ($(WASM_SIMD), 1)
+CFLAGS += -msimd128
+endif
+
 WAM_CFLAGS = -DWAM_API \
 -DIPLUG_DSP=1 \
 -DNO_IGRAPHICS \
 -DSAMPLE_TYPE_FLOAT
 
+# Set WASM_THREADS=1 (e.g. make WASM_THREADS=1) to build the WAM processor with emscripten pthreads, giving IPlugWAM an IWorkerPool of WASM_THREAD_COUNT workers
+# for IPlugProcessor::ExecuteParallel() and background jobs. The AudioWorklet can't start workers itself, so IPlugWAM-awp.js asks the page to, which needs
+# a cross-origin isolated page (COOP/COEP headers) for SharedArrayBuffer. The UI module stays single threaded
+WASM_THREADS ?= 0
+WASM_THREAD_COUNT ?= 3
+
+ifeq ($(WASM_THREADS), 1)
+WAM_CFLAGS += -pthread \
+-DIPLUG_WASM_THREADS=1 \
+-DIPLUG_WASM_THREAD_COUNT=$(WASM_THREAD_COUNT)
+endif
+
 WEB_CFLAGS = -DWEB_API \
 -DIPLUG_EDITOR=1
 
@@ -97,6 +117,12 @@ WAM_LDFLAGS = -s EXPORTED_RUNTIME_METHODS="['ccall', 'cwrap', 'setValue', 'UTF8T
 -s SINGLE_FILE=1
 #-s ENVIRONMENT=worker
 
+# the workers are started on demand rather than as a pool when the module loads, which can't happen in the AudioWorklet
+ifeq ($(WASM_THREADS), 1)
+WAM_LDFLAGS += -pthread \
+-s PTHREAD_POOL_SIZE=0
+endif
+
 WEB_LDFLAGS = -s EXPORTED_FUNCTIONS=$(WEB_EXPORTS) \
 -s EXPORTED_RUNTIME_METHODS="['UTF8ToString']" \
 -s BINARYEN_ASYNC_COMPILATION=1 \